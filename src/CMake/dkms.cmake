@@ -51,6 +51,7 @@ SET (XRT_DKMS_DRIVER_SRCS
   xocl/xocl_subdev.c
   xocl/xocl_ctx.c
   xocl/xocl_thread.c
+  xocl/xocl_chan_arb.c
   xocl/xocl_fdt.c
   xocl/xocl_test.c
   xocl/userpf/common.h
@@ -59,6 +60,7 @@ SET (XRT_DKMS_DRIVER_SRCS
   xocl/userpf/xocl_drm.c
   xocl/userpf/xocl_ioctl.c
   xocl/userpf/xocl_sysfs.c
+  xocl/userpf/xocl_peer_mem.c
   xocl/userpf/xocl_drv.c
   xocl/userpf/xocl.dracut.conf
   xocl/userpf/10-xocl.rules
@@ -79,6 +79,15 @@ find_package(Boost REQUIRED COMPONENTS system filesystem )
 INCLUDE (FindCurses)
 find_package(Curses REQUIRED)
 
+# --- USDT probes (optional) ---
+# Static probes are nops unless attached by perf/bpftrace, see
+# runtime_src/core/common/probe.h
+INCLUDE (CheckIncludeFile)
+CHECK_INCLUDE_FILE(sys/sdt.h HAVE_SYS_SDT_H)
+if (HAVE_SYS_SDT_H)
+  add_definitions(-DXRT_ENABLE_PROBES)
+endif()
+
 
 # --- XRT Variables ---
 set (XRT_INSTALL_DIR "${CMAKE_INSTALL_PREFIX}/xrt")
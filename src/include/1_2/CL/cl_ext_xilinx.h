@@ -104,6 +104,11 @@ typedef struct cl_mem_ext_ptr_t {
 
 /* New flags for cl_queue */
 #define CL_QUEUE_DPDK                               (1 << 31)
+/* Split each NDRange across all context devices loaded with the program */
+#define CL_QUEUE_SPLIT_NDRANGE                      (1 << 30)
+/* Service DMA of the queue's buffer transfers ahead of other queues' bulk transfers,
+ * and start the queue's kernels on free CUs ahead of other queues' kernels */
+#define CL_QUEUE_HIGH_PRIORITY_XILINX               (1 << 29)
 
 #define CL_MEM_REGISTER_MAP                         (1 << 27)
 #ifdef PMD_OCL
@@ -191,6 +196,19 @@ typedef uint64_t cl_stream_flags;
 #define CL_STREAM_READ_ONLY			    (1 << 0)
 #define CL_STREAM_WRITE_ONLY                        (1 << 1)
 #define CL_STREAM_POLLING                           (1 << 2)
+/* Completions are polled per stream with clPollStream() */
+#define CL_STREAM_PRIVATE_COMPLETIONS               (1 << 3)
+/* Write stream may share its route with other streams with this flag */
+#define CL_STREAM_SHARED                            (1 << 4)
+/* Completions are busy polled by clPollStream() from a ring shared with
+ * the driver, no interrupt or AIO completion on the way */
+#define CL_STREAM_BUSY_POLL                         (1 << 5)
+/* Write stream opens n (2 to 15) hardware queues on its route.  Packets
+ * go round robin over the queues, with CL_STREAM_SHARDS_BY_SIZE packets
+ * up to 64KB keep to the first queue and larger ones go round robin over
+ * the others.  Packets on different queues may arrive out of order */
+#define CL_STREAM_SHARDS(n)                         (((cl_stream_flags)(n) & 0xf) << 8)
+#define CL_STREAM_SHARDS_BY_SIZE                    (1 << 12)
 
 /**
  * cl_stream_attributes. eg set it to CL_STREAM for stream mode. Used
@@ -199,6 +217,11 @@ typedef uint64_t cl_stream_flags;
 typedef uint32_t cl_stream_attributes;
 #define CL_STREAM                                   (1 << 0)
 #define CL_PACKET                                   (1 << 1)
+/* QoS of the stream.  Priority 0 (default) to 3, streams of higher
+ * priority are served first.  Weight 1 to 255 is the share of DMA
+ * bandwidth among busy streams, default 1 */
+#define CL_STREAM_PRIORITY(p)                       (((p) & 0x3) << 8)
+#define CL_STREAM_WEIGHT(w)                         (((w) & 0xff) << 16)
 
 /**
  * cl_stream_attributes.
@@ -210,6 +233,12 @@ typedef uint32_t cl_stream_attributes;
 #define CL_STREAM_CDH                               (1 << 1)
 #define CL_STREAM_NONBLOCKING                       (1 << 2)
 #define CL_STREAM_SILENT                            (1 << 3)
+/* ptr of clReadStream() / clWriteStream() is a frame index, see
+ * clRegisterStreamBuffer() */
+#define CL_STREAM_FRAME                             (1 << 4)
+/* with CL_STREAM_FRAME on a read stream, land many packets in the frame,
+ * the frame starts with a packet table, see struct xocl_qdma_aggr_hdr */
+#define CL_STREAM_AGGREGATE                         (1 << 5)
 
 typedef stream_xfer_req_type         cl_stream_xfer_req_type;
 typedef streams_poll_req_completions cl_streams_poll_req_completions;
@@ -291,6 +320,25 @@ clCreateStreamBuffer(cl_device_id device,
 extern CL_API_ENTRY cl_int CL_API_CALL
 clReleaseStreamBuffer(cl_stream_mem /*stream memobj */) CL_API_SUFFIX__VERSION_1_0;
 
+/* clRegisterStreamBuffer - Use a stream buffer as frames of a stream.
+ * @stream      : The stream
+ * @mem         : Buffer from clCreateStreamBuffer()
+ * @frame_size  : The buffer is divided in frames of this size
+ * @num_frames  : Returns the number of frames
+ * errcode_ret  : The return value, eg CL_SUCCESS
+ * Return a cl_int.
+ *
+ * Reads and writes with CL_STREAM_FRAME pass (void*)index as ptr.  The
+ * driver keeps the buffer mapped for DMA, no pages are pinned and no
+ * scatter list is built per transfer.
+ */
+extern CL_API_ENTRY cl_int CL_API_CALL
+clRegisterStreamBuffer(cl_stream        /* stream */,
+	cl_stream_mem         /* mem */,
+	size_t                /* frame_size */,
+	cl_uint*              /* num_frames */,
+	cl_int *              /* errcode_ret*/) CL_API_SUFFIX__VERSION_1_0;
+
 /* clPollStreams - Poll streams on a device for completion.
  * @device_id             : The device
  * @completions           : Completions array
@@ -310,6 +358,29 @@ clPollStreams(cl_device_id /*device*/,
 	cl_int /*timeout in ms*/,
 	cl_int * /*errcode_ret*/) CL_API_SUFFIX__VERSION_1_0;
 
+/* clPollStream - Poll one stream for completion.
+ * @stream                : Stream created with CL_STREAM_PRIVATE_COMPLETIONS
+ * @completions           : Completions array
+ * @min_num_completions   : Minimum number of completions requested
+ * @max_num_completions   : Maximum number of completions requested
+ * @actual_num_completions: Actual number of completions returned.
+ * @timeout               : Timeout in milliseconds (ms)
+ * @errcode_ret :         : The return value eg CL_SUCCESS
+ * Return a cl_int.
+ *
+ * Completions of such a stream are not returned by clPollStreams(), so
+ * threads that each poll their own streams do not steal each other's
+ * completions.
+ */
+extern CL_API_ENTRY cl_int CL_API_CALL
+clPollStream(cl_stream /*stream*/,
+	cl_streams_poll_req_completions* /*completions*/,
+	cl_int  /*min_num_completion*/,
+	cl_int  /*max_num_completion*/,
+	cl_int* /*actual num_completion*/,
+	cl_int /*timeout in ms*/,
+	cl_int * /*errcode_ret*/) CL_API_SUFFIX__VERSION_1_0;
+
 //End QDMA APIs
 
 typedef struct _cl_mem * rte_mbuf;
@@ -325,8 +396,12 @@ typedef struct _cl_image_filler_xilinx {
 } cl_image_fillier_xilinx;
 
 /* New flag RTE_MBUF_READ_ONLY or RTE_MBUF_WRITE_ONLY
- * OpenCL runtime will use rte_eth_rx_queue_setup to create DPDK RX Ring. The API will return cl_pipe object.
- * OpenCL runtime will use rte_eth_tx_queue_setup to create DPDK TX Ring. The API will return cl_pipe object.
+ * The pipe is a QDMA read or write stream on the route given by the attribute
+ * following CL_PIPE_ATTRIBUTE_DPDK_ID, with max_packets buffers of packet_size
+ * bytes from one stream buffer. The API will return cl_pipe object.
+ *
+ * As with a DPDK rte_mbuf, the first word of a pipe buffer is the address of
+ * its data, followed by the 32 bit data length. The data is DMA'ed in place.
  */
 extern CL_API_ENTRY cl_pipe CL_API_CALL
     clCreateHostPipe(cl_device_id device,
@@ -336,9 +411,9 @@ extern CL_API_ENTRY cl_pipe CL_API_CALL
 	    const cl_pipe_attributes *attributes, //TODO: properties?
 	    cl_int *errcode_ret) CL_API_SUFFIX__VERSION_1_0;
 
-/* OpenCL runtime will use rte_eth_tx_burst to send the buffers to TX queue.
- * The API will return count of buffers successfully sent. The API would bind the buffers
- * to descriptors in the TX Ring
+/* Submit the buffers as non-blocking writes to the stream of the pipe.
+ * The API will return count of buffers successfully sent. Sent buffers return to
+ * the pipe when their write completes.
  */
 extern CL_API_ENTRY cl_uint CL_API_CALL
     clWritePipeBuffers(cl_command_queue command_queue,
@@ -347,9 +422,9 @@ extern CL_API_ENTRY cl_uint CL_API_CALL
 	    cl_uint count,
 	    cl_int* errcode_ret) CL_API_SUFFIX__VERSION_1_0;
 
-/* OpenCL runtime will use rte_eth_rx_burst to receive buffers from RX queue.
- * The API will return count of buffers received. The API would unbind the buffers
- * from the descriptors in the RX Ring.
+/* Receive the buffers whose read completed on the stream of the pipe.
+ * The API will return count of buffers received. Received buffers are owned by
+ * the application until released with clReleasePipeBuffer.
  */
 extern CL_API_ENTRY cl_uint CL_API_CALL
     clReadPipeBuffers(cl_command_queue command_queue,
@@ -358,8 +433,8 @@ extern CL_API_ENTRY cl_uint CL_API_CALL
 	    cl_uint count,
 	    cl_int* errcode_ret) CL_API_SUFFIX__VERSION_1_0;
 
-/*Use rte_pktmbuf_alloc to allocate a buffer from the same mempool used by the pipe.
- * This buffer is not yet bound to any descriptor in the RX/TX queue referred to by the pipe.
+/* Allocate a buffer from the buffers of the pipe, NULL if all are in use.
+ * This buffer is not yet bound to any transfer on the stream referred to by the pipe.
  */
 extern CL_API_ENTRY rte_mbuf* CL_API_CALL
     clAcquirePipeBuffer(cl_command_queue command_queue,
@@ -367,8 +442,9 @@ extern CL_API_ENTRY rte_mbuf* CL_API_CALL
 	    cl_int* errcode_ret) CL_API_SUFFIX__VERSION_1_0;
 
 
-/*Use rte_pktmbuf_free to return a buffer to the same mempool used by the pipe.
- * This buffer should not be bound to any descriptor in the RX/TX queue referred to by the pipe.
+/* Return a buffer to the buffers of the pipe, a read pipe posts it for
+ * reading again on next clReadPipeBuffers. A NULL buffer releases the pipe.
+ * This buffer should not be bound to any transfer on the stream referred to by the pipe.
  */
 extern CL_API_ENTRY cl_int CL_API_CALL
     clReleasePipeBuffer(cl_command_queue command_queue,
@@ -431,6 +507,23 @@ xclGetComputeUnitInfo(cl_kernel             kernel,
 #define XCL_COMPUTE_UNIT_INDEX       0x1321 // scheduler index of CU
 #define XCL_COMPUTE_UNIT_CONNECTIONS 0x1322 // connectivity
 
+/**
+ * Mark a region of interest for profiling
+ *
+ * With profile=true and profile_regions=true in xrt.ini, host side
+ * profiling is captured only between xclProfileRegionBegin and the
+ * matching xclProfileRegionEnd.  Regions may nest, capture stops when
+ * the outermost region ends.  Without profile_regions the calls have
+ * no effect.
+ *
+ * Return: CL_SUCCESS
+ */
+extern CL_API_ENTRY cl_int CL_API_CALL
+xclProfileRegionBegin(void);
+
+extern CL_API_ENTRY cl_int CL_API_CALL
+xclProfileRegionEnd(void);
+
 /*
   Host Accessible Program Scope Globals
 */
@@ -498,6 +498,38 @@ def xclMapBO(handle, boHandle, write, buf_type='char', buf_size=1):
     ptr = libc.xclMapBO(handle, boHandle, write)
     return ptr
 
+def xclMapBOView(handle, boHandle, write):
+    """
+    Memory map BO into user's address space as a memoryview
+
+    :param handle: (xclDeviceHandle) device handle
+    :param boHandle: (unsigned int) BO handle
+    :param write: (boolean) READ only or READ/WRITE mapping
+    :return: (memoryview) view of the whole BO, None on failure
+
+    The view exposes the mapping through the buffer protocol, so
+    numpy.frombuffer() and similar consumers access BO memory directly
+    without copying.  The view must not be used after the BO is freed
+    or unmapped.
+
+    Calls through ctypes.CDLL release the GIL, so other Python threads
+    keep running during xclSyncBO() and xclExecWait().
+    """
+    prop = xclBOProperties()
+    if xclGetBOProperties(handle, boHandle, prop):
+        return None
+
+    libc.xclMapBO.restype = ctypes.c_void_p
+    libc.xclMapBO.argtypes = [xclDeviceHandle, ctypes.c_uint, ctypes.c_bool]
+    addr = libc.xclMapBO(handle, boHandle, write)
+    if not addr or addr == ctypes.c_void_p(-1).value:
+        return None
+
+    view = memoryview((ctypes.c_char * prop.size).from_address(addr)).cast('B')
+    if not write and hasattr(view, 'toreadonly'):
+        view = view.toreadonly()
+    return view
+
 def xclSyncBO(handle, boHandle, direction, size, offset):
     """
     Synchronize buffer contents in requested direction
@@ -513,6 +545,30 @@ def xclSyncBO(handle, boHandle, direction, size, offset):
     libc.xclSyncBO.argtypes = [xclDeviceHandle, ctypes.c_uint, ctypes.c_int, ctypes.c_size_t, ctypes.c_size_t]
     return libc.xclSyncBO(handle, boHandle, direction, size, offset)
 
+class xclBOSyncItem(ctypes.Structure):
+    _fields_ = [
+     ("boHandle", ctypes.c_uint),
+     ("dir", ctypes.c_int),
+     ("size", ctypes.c_size_t),
+     ("offset", ctypes.c_size_t)
+    ]
+
+def xclSyncBOBatch(handle, items):
+    """
+    Synchronize several buffers in one call
+
+    :param handle: (xclDeviceHandle) device handle
+    :param items: list of (boHandle, direction, size, offset) tuples
+    :return: 0 on success or standard errno of first failed request
+
+    All transfers are queued natively before any is waited for, with a
+    single Python to C transition for the whole list
+    """
+    arr = (xclBOSyncItem * len(items))(*[xclBOSyncItem(*item) for item in items])
+    libc.xclSyncBOBatch.restype = ctypes.c_int
+    libc.xclSyncBOBatch.argtypes = [xclDeviceHandle, ctypes.POINTER(xclBOSyncItem), ctypes.c_uint]
+    return libc.xclSyncBOBatch(handle, arr, len(items))
+
 def xclCopyBO(handle, dstBoHandle, srcBoHandle, size, dst_offset, src_offset):
     """
     Copy device buffer contents to another buffer
@@ -656,6 +712,40 @@ def xclExecBuf(handle, cmdBO):
     libc.xclExecBuf.argtypes = [xclDeviceHandle, ctypes.c_uint]
     return libc.xclExecBuf(handle, cmdBO)
 
+def xclExecBufBatch(handle, cmdBOs):
+    """
+    xclExecBufBatch() - Submit several exec buffers for execution in one call
+    :param handle: Device handle
+    :param cmdBOs: list of BO handles containing command packets
+    :return: number of exec buffers submitted or standard error number
+    """
+    arr = (ctypes.c_uint * len(cmdBOs))(*cmdBOs)
+    libc.xclExecBufBatch.restype = ctypes.c_int
+    libc.xclExecBufBatch.argtypes = [xclDeviceHandle, ctypes.POINTER(ctypes.c_uint), ctypes.c_uint]
+    return libc.xclExecBufBatch(handle, arr, len(cmdBOs))
+
+def xclExecBufWaitDone(handle, count, minimum, timeoutMilliSec):
+    """
+    xclExecBufWaitDone() - Wait until at least a number of exec buffers completed
+    :param handle: Device handle
+    :param count: maximum number of completions to retrieve
+    :param minimum: number of completions to wait for
+    :param timeoutMilliSec: How long to wait for, negative to wait forever
+    :return: (list of completed exec BO handles, overflow) or standard error number
+
+    If overflow is set, completions were lost and the state of all
+    outstanding exec buffers must be checked
+    """
+    arr = (ctypes.c_uint * count)()
+    overflow = ctypes.c_int(0)
+    libc.xclExecBufWaitDone.restype = ctypes.c_int
+    libc.xclExecBufWaitDone.argtypes = [xclDeviceHandle, ctypes.POINTER(ctypes.c_uint), ctypes.c_uint,
+                                        ctypes.c_uint, ctypes.c_int, ctypes.POINTER(ctypes.c_int)]
+    ret = libc.xclExecBufWaitDone(handle, arr, count, minimum, timeoutMilliSec, ctypes.byref(overflow))
+    if ret < 0:
+        return ret
+    return list(arr[:ret]), bool(overflow.value)
+
 def xclExecBufWithWaitList(handle, cmdBO, num_bo_in_wait_list, bo_wait_list):
     """
     Submit an execution request to the embedded (or software) scheduler
@@ -0,0 +1,231 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef core_common_bo_pool_h_
+#define core_common_bo_pool_h_
+
+#include <map>
+#include <deque>
+#include <mutex>
+#include <chrono>
+#include <functional>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+namespace xrt_core {
+
+/**
+ * Size classed pool of data BOs
+ *
+ * Data BOs are recycled per memory bank (BO flags) and size class, to
+ * avoid the DRM GEM create and mmap cost of frequently allocated and
+ * freed buffers.  Sizes are rounded up to one of four classes per
+ * power of 2, e.g. 1M, 1.25M, 1.5M, 1.75M, 2M, 2.5M, ...  so a
+ * recycled BO wastes at most 25% of the requested size.
+ *
+ * The pool caches at most @high_water bytes.  Cached BOs that have
+ * been idle longer than @idle are destroyed when the pool is next
+ * accessed.
+ *
+ * The pool is agnostic to the BO type, which is copied in and out of
+ * the pool.  The destroy function is called for BOs that are evicted
+ * from the pool.
+ */
+template <typename BO>
+class bo_pool {
+public:
+  struct statistics {
+    uint64_t hits = 0;       // acquire served from pool
+    uint64_t misses = 0;     // acquire requiring new allocation
+    uint64_t recycled = 0;   // release accepted by pool
+    uint64_t rejected = 0;   // release refused, e.g. above high water mark
+    uint64_t trimmed = 0;    // BOs destroyed because idle
+    size_t   cached = 0;     // number of BOs currently cached
+    size_t   bytes = 0;      // bytes currently cached
+  };
+
+private:
+  using clock = std::chrono::steady_clock;
+  using key_type = std::pair<uint64_t, size_t>;  // flags, class size
+
+  struct entry {
+    BO bo;
+    clock::time_point released;
+  };
+
+  std::function<void(BO&)> mDestroy;
+  const size_t mHighWater;
+  const clock::duration mIdle;
+  std::map<key_type, std::deque<entry>> mFree;
+  statistics mStats;
+  std::mutex mMutex;
+  bool mClosed = false;
+
+  // Destroy BOs idle for more than mIdle.  Caller holds lock.
+  void
+  trim_nolock(clock::time_point now)
+  {
+    for (auto itr = mFree.begin(); itr != mFree.end(); ) {
+      auto& lst = (*itr).second;
+      // entries are released in time order, oldest first
+      while (!lst.empty() && now - lst.front().released > mIdle) {
+        destroy_nolock((*itr).first, lst.front());
+        lst.pop_front();
+        ++mStats.trimmed;
+      }
+      itr = lst.empty() ? mFree.erase(itr) : std::next(itr);
+    }
+  }
+
+  void
+  destroy_nolock(const key_type& key, entry& e)
+  {
+    mDestroy(e.bo);
+    --mStats.cached;
+    mStats.bytes -= key.second;
+  }
+
+public:
+  bo_pool(size_t high_water, std::chrono::milliseconds idle, std::function<void(BO&)> destroy)
+    : mDestroy(std::move(destroy)), mHighWater(high_water), mIdle(idle)
+  {}
+
+  ~bo_pool()
+  {
+    clear();
+  }
+
+  /**
+   * Round size up to its size class
+   */
+  static size_t
+  size_class(size_t size)
+  {
+    const size_t min_class = 4096;
+    if (size <= min_class)
+      return min_class;
+    size_t pow2 = min_class;
+    while (pow2 < size)
+      pow2 <<= 1;
+    // four sub classes between pow2/2 and pow2
+    size_t step = pow2 >> 3;
+    size_t cls = pow2 >> 1;
+    while (cls < size)
+      cls += step;
+    return cls;
+  }
+
+  bool
+  enabled() const
+  {
+    return mHighWater > 0;
+  }
+
+  /**
+   * Acquire a BO of specified class size for specified flags
+   *
+   * @return
+   *   true if pool had a BO, false if caller must allocate
+   */
+  bool
+  acquire(uint64_t flags, size_t class_size, BO& bo)
+  {
+    std::lock_guard<std::mutex> lk(mMutex);
+    if (mClosed)
+      return false;
+    auto now = clock::now();
+    trim_nolock(now);
+    auto itr = mFree.find(key_type(flags, class_size));
+    if (itr == mFree.end() || (*itr).second.empty()) {
+      ++mStats.misses;
+      return false;
+    }
+    // most recently released is most likely to be warm
+    bo = (*itr).second.back().bo;
+    (*itr).second.pop_back();
+    --mStats.cached;
+    mStats.bytes -= class_size;
+    ++mStats.hits;
+    return true;
+  }
+
+  /**
+   * Release a BO of specified class size back to the pool
+   *
+   * @return
+   *   true if pool took ownership of the BO, false if caller must
+   *   destroy it
+   */
+  bool
+  release(uint64_t flags, size_t class_size, const BO& bo)
+  {
+    std::lock_guard<std::mutex> lk(mMutex);
+    if (mClosed)
+      return false;
+    auto now = clock::now();
+    trim_nolock(now);
+    if (mStats.bytes + class_size > mHighWater) {
+      ++mStats.rejected;
+      return false;
+    }
+    mFree[key_type(flags, class_size)].push_back({bo, now});
+    ++mStats.cached;
+    mStats.bytes += class_size;
+    ++mStats.recycled;
+    return true;
+  }
+
+  /**
+   * Destroy all cached BOs
+   */
+  void
+  clear()
+  {
+    std::lock_guard<std::mutex> lk(mMutex);
+    for (auto& kv : mFree)
+      for (auto& e : kv.second)
+        destroy_nolock(kv.first, e);
+    mFree.clear();
+  }
+
+  /**
+   * Destroy all cached BOs and stop pooling
+   *
+   * Subsequent acquire and release return false, such that BOs
+   * released after the device is closed are destroyed by the caller.
+   */
+  void
+  close()
+  {
+    std::lock_guard<std::mutex> lk(mMutex);
+    mClosed = true;
+    for (auto& kv : mFree)
+      for (auto& e : kv.second)
+        destroy_nolock(kv.first, e);
+    mFree.clear();
+  }
+
+  statistics
+  get_statistics()
+  {
+    std::lock_guard<std::mutex> lk(mMutex);
+    return mStats;
+  }
+};
+
+} // xrt_core
+#endif
@@ -22,6 +22,8 @@
 #include <boost/filesystem/operations.hpp>
 #include <iostream>
 #include <cstdlib>
+#include <sstream>
+#include <unordered_map>
 
 #ifdef __GNUC__
 # include <linux/limits.h>
@@ -107,6 +109,29 @@ struct tree
   boost::property_tree::ptree m_tree;
   const boost::property_tree::ptree null_tree;
 
+  // All values of m_tree keyed by full path, e.g. "Runtime.verbosity",
+  // so that lookups are a single hash probe rather than a ptree walk
+  std::unordered_map<std::string,std::string> m_values;
+
+  void
+  flatten(const boost::property_tree::ptree& node, const std::string& path)
+  {
+    for (auto& child : node) {
+      auto key = path.empty() ? child.first : path + "." + child.first;
+      if (child.second.empty())
+        m_values[key] = child.second.data();
+      else
+        flatten(child.second,key);
+    }
+  }
+
+  const std::string*
+  find(const char* key) const
+  {
+    auto itr = m_values.find(key);
+    return (itr != m_values.end()) ? &(*itr).second : nullptr;
+  }
+
   void
   setenv()
   {
@@ -119,6 +144,8 @@ struct tree
   {
     try {
       read_ini(path,m_tree);
+      m_values.clear();
+      flatten(m_tree,"");
 
       // inform which .ini was read
       xrt_core::message::send(xrt_core::message::severity_level::XRT_INFO, "XRT", std::string("Read ") + path);
@@ -167,16 +194,30 @@ get_bool_value(const char* key, bool default_value)
   if (auto env = get_env_value(key))
     return is_true(env);
 
-  return s_tree.m_tree.get<bool>(key,default_value);
+  auto val = s_tree.find(key);
+  if (!val)
+    return default_value;
+
+  // Same conversion as ptree's bool translator
+  bool value = default_value;
+  std::istringstream istr(*val);
+  istr >> value;
+  if (istr.fail()) {
+    istr.clear();
+    istr.str(*val);
+    istr >> std::boolalpha >> value;
+  }
+  return (!istr.fail() && (istr >> std::ws).eof()) ? value : default_value;
 }
 
 std::string
 get_string_value(const char* key, const std::string& default_value)
 {
-  std::string val = s_tree.m_tree.get<std::string>(key,default_value);
+  auto found = s_tree.find(key);
+  std::string val = found ? *found : default_value;
   // Although INI file entries are not supposed to have quotes around strings
   // but we want to be cautious
-  if ((val.front() == '"') && (val.back() == '"')) {
+  if (!val.empty() && (val.front() == '"') && (val.back() == '"')) {
     val.erase(0, 1);
     val.erase(val.size()-1);
   }
@@ -186,7 +227,14 @@ get_string_value(const char* key, const std::string& default_value)
 unsigned int
 get_uint_value(const char* key, unsigned int default_value)
 {
-  return s_tree.m_tree.get<unsigned int>(key,default_value);
+  auto val = s_tree.find(key);
+  if (!val)
+    return default_value;
+
+  unsigned int value = default_value;
+  std::istringstream istr(*val);
+  istr >> value;
+  return (!istr.fail() && (istr >> std::ws).eof()) ? value : default_value;
 }
 
 
@@ -142,6 +142,18 @@ get_stall_trace()
   return value;
 }
 
+/**
+ * Interval in msec at which device counters are read for the sampled
+ * stall breakdown in the profile summary, 0 turns sampling off.
+ * Unlike stall_trace this uses no trace bandwidth.
+ */
+inline unsigned int
+get_stall_sample_interval()
+{
+  static unsigned int value = (!get_profile()) ? 0 : detail::get_uint_value("Debug.stall_sample_interval_ms",0);
+  return value;
+}
+
 inline bool
 get_timeline_trace()
 {
@@ -149,6 +161,62 @@ get_timeline_trace()
   return value;
 }
 
+/**
+ * Format of the timeline trace file: csv, binary or binary_compressed.
+ * Binary traces are converted with xdp_trace_convert.
+ */
+inline std::string
+get_timeline_trace_format()
+{
+  static std::string value = detail::get_string_value("Debug.timeline_trace_format","csv");
+  return value;
+}
+
+/**
+ * Size in MB of the device memory buffer that device trace is
+ * offloaded to.  Used on designs with a trace offload IP (TS2MM)
+ * instead of a trace FIFO, the buffer is circular.
+ */
+inline unsigned int
+get_trace_buffer_size()
+{
+  static unsigned int value = detail::get_uint_value("Debug.trace_buffer_size",64);
+  return value;
+}
+
+/**
+ * Rate in Hz at which device counters are sampled to shared memory
+ * for external collectors, 0 turns sampling off.
+ */
+inline unsigned int
+get_device_counter_sample_rate()
+{
+  static unsigned int value = detail::get_uint_value("Debug.device_counter_sample_rate",0);
+  return value;
+}
+
+/**
+ * Publish running profile aggregates to shared memory for external
+ * monitoring agents while the application runs.
+ */
+inline bool
+get_live_telemetry()
+{
+  static bool value = detail::get_bool_value("Debug.live_telemetry",false);
+  return value;
+}
+
+/**
+ * Capture host profiling only between xclProfileRegionBegin and
+ * xclProfileRegionEnd instead of for the whole application.
+ */
+inline bool
+get_profile_regions()
+{
+  static bool value = get_profile() && detail::get_bool_value("Debug.profile_regions",false);
+  return value;
+}
+
 inline bool
 get_api_checks()
 {
@@ -170,6 +238,20 @@ get_verbosity()
   return value;
 }
 
+/**
+ * Write runtime log messages from a background thread.  Callers only
+ * queue the message; the thread writes queued messages in batches and
+ * flushes once per batch.  Errors and more severe messages are written
+ * before the sender returns, other queued messages are lost if the
+ * process terminates abnormally.  Off by default.
+ */
+inline bool
+get_logging_async()
+{
+  static bool value = detail::get_bool_value("Runtime.runtime_log_async",false);
+  return value;
+}
+
 inline unsigned int
 get_dma_threads()
 {
@@ -177,6 +259,169 @@ get_dma_threads()
   return value;
 }
 
+/**
+ * Number of workers of the HAL misc task queue (buffer copies, fills,
+ * host copies to and from mapped buffers).  Short misc tasks have their
+ * own worker in addition to these.
+ */
+inline unsigned int
+get_misc_threads()
+{
+  static unsigned int value = detail::get_uint_value("Runtime.misc_threads",2);
+  return value;
+}
+
+/**
+ * Number of threads running OpenCL user callbacks (event callbacks
+ * and memory object destructor callbacks).  Callbacks are run off the
+ * thread that completes the event, so a slow callback does not stall
+ * command completion.  A value of 0 runs callbacks inline.
+ */
+inline unsigned int
+get_callback_threads()
+{
+  static unsigned int value = detail::get_uint_value("Runtime.callback_threads",1);
+  return value;
+}
+
+/**
+ * Use lock-free ring buffers for xrt task queues (HAL DMA queues).
+ * The ring capacity is specified by task_queue_capacity.
+ */
+inline bool
+get_task_queue_lockfree()
+{
+  static bool value = detail::get_bool_value("Runtime.task_queue_lockfree",false);
+  return value;
+}
+
+inline unsigned int
+get_task_queue_capacity()
+{
+  static unsigned int value = detail::get_uint_value("Runtime.task_queue_capacity",1024);
+  return value;
+}
+
+/**
+ * Affinity of HAL DMA worker threads.  "numa" (default) pins the
+ * workers to the cpus of the NUMA node the device is attached to,
+ * "none" leaves the workers unpinned.
+ */
+inline std::string
+get_dma_thread_affinity()
+{
+  static std::string value = detail::get_string_value("Runtime.dma_thread_affinity","numa");
+  return value;
+}
+
+/**
+ * DMA transfers of at most dma_poll_threshold bytes are serviced by
+ * polling the DMA engine instead of waiting for its interrupt.  A
+ * value of 0 (default) disables polling.
+ */
+inline unsigned int
+get_dma_poll_threshold()
+{
+  static unsigned int value = detail::get_uint_value("Runtime.dma_poll_threshold",0);
+  return value;
+}
+
+/**
+ * DMA transfers of at most dma_prio_threshold bytes get a DMA channel
+ * ahead of larger transfers waiting for one.  A value of 0 disables
+ * prioritization.
+ */
+inline unsigned int
+get_dma_prio_threshold()
+{
+  static unsigned int value = detail::get_uint_value("Runtime.dma_prio_threshold",65536);
+  return value;
+}
+
+/**
+ * Synchronous and worker thread buffer syncs larger than dma_chunk KB
+ * are issued to the driver as chunks of dma_chunk KB, so that latency
+ * class transfers get a DMA channel between chunks of a bulk
+ * transfer.  A value of 0 disables chunking.
+ */
+inline unsigned int
+get_dma_chunk()
+{
+  static unsigned int value = detail::get_uint_value("Runtime.dma_chunk",16384);
+  return value;
+}
+
+/**
+ * Writes of more than write_pipeline_chunk KB to a device resident
+ * buffer are split into chunks, the copy of each chunk into the
+ * buffer object overlaps the DMA of the chunks before it.  A value
+ * of 0 disables pipelining.
+ */
+inline unsigned int
+get_write_pipeline_chunk()
+{
+  static unsigned int value = detail::get_uint_value("Runtime.write_pipeline_chunk",1024);
+  return value;
+}
+
+/**
+ * Allow buffers to oversubscribe device memory.  When a buffer object
+ * cannot be allocated, buffers not used by enqueued commands are
+ * evicted to host memory, least recently used first, and migrate
+ * back to the device when a kernel next uses them.
+ */
+inline bool
+get_device_oversubscription()
+{
+  static bool value = detail::get_bool_value("Runtime.device_oversubscription",false);
+  return value;
+}
+
+/**
+ * How DDR is cleared on devices that need it for ECC (XPR shells).
+ * "off" (default) skips clearing, "eager" clears all banks at xclbin
+ * load, "lazy" clears the range of each BO as it is allocated.
+ */
+inline std::string
+get_ddr_clear()
+{
+  static std::string value = detail::get_string_value("Runtime.ddr_clear","off");
+  return value;
+}
+
+/**
+ * Cpus for software scheduler threads, one thread per device.  A
+ * comma separated list, the thread of the n'th initialized device is
+ * pinned to the n'th cpu (modulo list size).  "none" (default) leaves
+ * the threads unpinned.
+ */
+inline std::string
+get_sws_cpu_affinity()
+{
+  static std::string value = detail::get_string_value("Runtime.sws_cpu_affinity","none");
+  return value;
+}
+
+/**
+ * Async backend of QDMA stream queues, "aio" (default) or "uring".
+ * io_uring falls back to aio on kernels without it.  With
+ * stream_uring_sqpoll a kernel thread polls the submission ring, so
+ * submitting stream requests needs no syscall.
+ */
+inline std::string
+get_stream_io()
+{
+  static std::string value = detail::get_string_value("Runtime.stream_io","aio");
+  return value;
+}
+
+inline bool
+get_stream_uring_sqpoll()
+{
+  static bool value = detail::get_bool_value("Runtime.stream_uring_sqpoll",false);
+  return value;
+}
+
 inline unsigned int
 get_polling_throttle()
 {
@@ -236,6 +481,52 @@ get_ert_polling()
 }
 
 
+/**
+ * Allow OpenCL kernel launches to use the compact ERT_EXEC_WRITE
+ * {offset,value} encoding when the CU register map is sparse.
+ */
+inline bool
+get_exec_write()
+{
+  static bool value = get_kds() && detail::get_bool_value("Runtime.exec_write",true);
+  return value;
+}
+
+/**
+ * Pack start kernel commands that are submitted together into one
+ * ERT_START_DAG command processed by ERT in one command slot
+ */
+inline bool
+get_kds_pack()
+{
+  static bool value = get_kds() && detail::get_bool_value("Runtime.kds_pack",false);
+  return value;
+}
+
+/**
+ * Busy poll the driver completion ring for command completion instead
+ * of sleeping in the driver.  Trades a host core for lower latency.
+ */
+inline bool
+get_kds_busy_poll()
+{
+  static bool value = get_kds() && detail::get_bool_value("Runtime.kds_busy_poll",false);
+  return value;
+}
+
+/**
+ * Spin for up to exec_wait_spin_us microseconds checking for command
+ * completion before xclExecWait() sleeps in the driver.  Saves the
+ * sleep/wakeup latency for short kernels at the cost of a busy core.
+ * 0 (default) disables spinning.  Currently honored on edge.
+ */
+inline unsigned int
+get_exec_wait_spin_us()
+{
+  static unsigned int value = detail::get_uint_value("Runtime.exec_wait_spin_us",0);
+  return value;
+}
+
 /**
  * Enable embedded scheduler CUDMA module
  */
@@ -267,7 +558,39 @@ get_ert_cqint()
 }
 
 /**
- * Set slot size for embedded scheduler CQ
+ * CU selection policy for commands that can run on several CUs,
+ * "first" (default), "roundrobin", or "leastused".  Applies to the
+ * embedded scheduler and to kernel driver scheduling, per xclbin.
+ */
+inline unsigned int
+get_cu_policy()
+{
+  static unsigned int value = [] {
+    auto policy = detail::get_string_value("Runtime.cu_policy","first");
+    if (policy == "roundrobin")
+      return 1u; // ERT_CU_POLICY_ROUND_ROBIN
+    if (policy == "leastused")
+      return 2u; // ERT_CU_POLICY_LEAST_USED
+    return 0u;   // ERT_CU_POLICY_FIRST
+  }();
+  return value;
+}
+
+/**
+ * Embedded scheduler notifies host after ert_intr_coalesce command
+ * completions (max 63) instead of per command.  0 (default) disables
+ * coalescing and defers to kds_intr_coalesce in sysfs.
+ */
+inline unsigned int
+get_ert_intr_coalesce()
+{
+  static unsigned int value = get_ert() ? detail::get_uint_value("Runtime.ert_intr_coalesce",0) : 0;
+  return value;
+}
+
+/**
+ * Set max slot size for embedded scheduler CQ.  The slot size used is
+ * the smallest that fits the commands of the loaded xclbin.
  */
 inline unsigned int
 get_ert_slotsize()
@@ -297,6 +620,10 @@ get_frequency_scaling()
   return value;
 }
 
+/**
+ * Uncached lookup of a boolean key, callers on hot paths should
+ * cache the result
+ */
 inline bool
 get_feature_toggle(const std::string& feature)
 {
@@ -313,6 +640,60 @@ get_cmdbo_cache()
   return value;
 }
 
+/**
+ * Size in MB of per device pool of recycled data BOs.  A value of 0
+ * disables the pool.  BOs idle in the pool for more than bo_pool_idle
+ * milliseconds are freed.
+ */
+inline unsigned int
+get_bo_pool_size()
+{
+  static unsigned int value = detail::get_uint_value("Runtime.bo_pool_size",0);
+  return value;
+}
+
+inline unsigned int
+get_bo_pool_idle()
+{
+  static unsigned int value = detail::get_uint_value("Runtime.bo_pool_idle",1000);
+  return value;
+}
+
+/**
+ * Poll mode (DPDK) stream backend.  When pmd_library names the pmdhal
+ * wrapper library, streams of device N are served by ethdev port N,
+ * which is started with pmd_queues rx and tx queues of
+ * pmd_queue_depth descriptors.  pmd_eal_args are passed to EAL init,
+ * e.g. "-l 2-3 --socket-mem 1024" to pick lcores and hugepage memory.
+ */
+inline std::string
+get_pmd_library()
+{
+  static std::string value = detail::get_string_value("Runtime.pmd_library","");
+  return value;
+}
+
+inline std::string
+get_pmd_eal_args()
+{
+  static std::string value = detail::get_string_value("Runtime.pmd_eal_args","");
+  return value;
+}
+
+inline unsigned int
+get_pmd_queues()
+{
+  static unsigned int value = detail::get_uint_value("Runtime.pmd_queues",4);
+  return value;
+}
+
+inline unsigned int
+get_pmd_queue_depth()
+{
+  static unsigned int value = detail::get_uint_value("Runtime.pmd_queue_depth",1024);
+  return value;
+}
+
 inline std::string
 get_hw_em_driver()
 {
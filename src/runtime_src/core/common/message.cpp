@@ -22,9 +22,15 @@
 #include <unistd.h>
 #include <syslog.h>
 #include <map>
+#include <atomic>
+#include <condition_variable>
 #include <fstream>
+#include <future>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <thread>
+#include <vector>
 #include <climits>
 #include <sys/types.h>
 #ifdef __GNUC__
@@ -48,6 +54,22 @@ get_exe_path()
 
 using severity_level = xrt_core::message::severity_level;
 
+// A message with the context captured on the sending thread
+struct record
+{
+  severity_level level;
+  std::string tag;
+  std::string msg;
+  std::thread::id tid;
+  std::string time;
+  record* next = nullptr;
+  std::promise<void>* written = nullptr;
+
+  record(severity_level l, const char* t, const char* m)
+    : level(l), tag(t), msg(m), tid(std::this_thread::get_id()), time(xrt_core::timestamp())
+  {}
+};
+
 //--
 class message_dispatch
 {
@@ -56,7 +78,8 @@ public:
   virtual ~message_dispatch() {}
   static message_dispatch* make_dispatcher(const std::string& choice);
 public:
-  virtual void send(severity_level l, const char* tag, const char* msg) = 0;
+  virtual void send(const record& r) = 0;
+  virtual void flush() {}
 };
 
 //--
@@ -65,7 +88,7 @@ class null_dispatch : public message_dispatch
 public:
   null_dispatch() {}
   virtual ~null_dispatch() {}
-  virtual void send(severity_level l, const char* tag, const char* msg) {};
+  virtual void send(const record& r) {};
 };
 
 //--
@@ -74,7 +97,8 @@ class console_dispatch : public message_dispatch
 public:
   console_dispatch();
   virtual ~console_dispatch() {}
-  virtual void send(severity_level l, const char* tag, const char* msg) override;
+  virtual void send(const record& r) override;
+  virtual void flush() override;
 private:
   std::map<severity_level, const char*> severityMap = {
     { severity_level::XRT_EMERGENCY, "EMERGENCY: "},
@@ -94,7 +118,7 @@ class syslog_dispatch : public message_dispatch
 public:
   syslog_dispatch();
   virtual ~syslog_dispatch();
-  virtual void send(severity_level l, const char* tag, const char* msg) override;
+  virtual void send(const record& r) override;
 private:
   std::map<severity_level, int> severityMap = {
     { severity_level::XRT_EMERGENCY, LOG_EMERG},
@@ -115,7 +139,8 @@ public:
   explicit
   file_dispatch(const std::string& file);
   virtual ~file_dispatch();
-  virtual void send(severity_level l, const char* tag, const char* msg) override;
+  virtual void send(const record& r) override;
+  virtual void flush() override;
 private:
   std::ofstream handle;
   std::map<severity_level, const char*> severityMap = {
@@ -168,9 +193,9 @@ syslog_dispatch::
 
 void
 syslog_dispatch::
-send(severity_level l, const char* tag, const char* msg)
+send(const record& r)
 {
-  syslog(severityMap[l], "%s", msg);
+  syslog(severityMap[r.level], "%s", r.msg.c_str());
 }
 
 //file ops
@@ -198,11 +223,18 @@ file_dispatch::~file_dispatch() {
 
 void
 file_dispatch::
-send(severity_level l, const char* tag, const char* msg)
+send(const record& r)
+{
+  handle << r.time <<" [" << r.tag << "] Tid: "
+         << r.tid << ", " << " " << severityMap[r.level]
+         << r.msg << '\n';
+}
+
+void
+file_dispatch::
+flush()
 {
-  handle << xrt_core::timestamp() <<" [" << tag << "] Tid: "
-         << std::this_thread::get_id() << ", " << " " << severityMap[l]
-         << msg << std::endl;
+  handle.flush();
 }
 
 //console ops
@@ -225,27 +257,159 @@ console_dispatch()
 
 void
 console_dispatch::
-send(severity_level l, const char* tag, const char* msg)
+send(const record& r)
+{
+  std::cout << "[" << r.tag << "] " << severityMap[r.level]
+            << r.msg << '\n';
+}
+
+void
+console_dispatch::
+flush()
 {
-  std::cout << "[" << tag << "] " << severityMap[l]
-            << msg << std::endl;
+  std::cout.flush();
 }
 
+// Set once the background writer has been destroyed during static
+// destruction, later messages are written synchronously
+static std::atomic<bool> s_async_stopped {false};
+
+// Writes messages to a dispatcher from a background thread.
+//
+// Senders push records on a lock free list and only take the mutex
+// to wake the writer when the list was empty.  The writer takes the
+// whole list at once, writes it in send order, and flushes once per
+// batch.  Once the writer has exited, a sender that finds the list
+// empty writes the list itself under the mutex.  The dispatcher is
+// not owned, it must outlive this object.
+class async_dispatch
+{
+  message_dispatch* m_sink;
+  std::atomic<record*> m_head {nullptr};
+  std::mutex m_mutex;
+  std::condition_variable m_work;
+  bool m_stop = false;
+  bool m_exited = false;
+  std::thread m_thread;
+
+  void
+  write(record* list)
+  {
+    // list is newest first, reverse to send order
+    record* ordered = nullptr;
+    while (list) {
+      auto next = list->next;
+      list->next = ordered;
+      ordered = list;
+      list = next;
+    }
+
+    std::vector<std::promise<void>*> written;
+    while (ordered) {
+      std::unique_ptr<record> r(ordered);
+      ordered = ordered->next;
+      m_sink->send(*r);
+      if (r->written)
+        written.push_back(r->written);
+    }
+    m_sink->flush();
+    for (auto w : written)
+      w->set_value();
+  }
+
+  void
+  run()
+  {
+    while (true) {
+      auto list = m_head.exchange(nullptr, std::memory_order_acquire);
+      if (list) {
+        write(list);
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lk(m_mutex);
+      if (m_stop && !m_head.load(std::memory_order_acquire)) {
+        m_exited = true;
+        return;
+      }
+      m_work.wait(lk, [this] { return m_stop || m_head.load(std::memory_order_acquire); });
+    }
+  }
+
+public:
+  explicit
+  async_dispatch(message_dispatch* sink)
+    : m_sink(sink), m_thread([this] { run(); })
+  {}
+
+  ~async_dispatch()
+  {
+    {
+      std::lock_guard<std::mutex> lk(m_mutex);
+      m_stop = true;
+    }
+    m_work.notify_one();
+    m_thread.join();
+    s_async_stopped.store(true, std::memory_order_release);
+  }
+
+  // Errors and more severe messages are written before send returns
+  void
+  send(severity_level l, const char* tag, const char* msg)
+  {
+    auto r = new record(l, tag, msg);
+    std::promise<void> written;
+    if (l <= severity_level::XRT_ERROR)
+      r->written = &written;
+
+    auto head = m_head.load(std::memory_order_relaxed);
+    do {
+      r->next = head;
+    } while (!m_head.compare_exchange_weak(head, r, std::memory_order_release, std::memory_order_relaxed));
+
+    if (!head) {
+      std::lock_guard<std::mutex> lk(m_mutex);
+      if (m_exited)
+        write(m_head.exchange(nullptr, std::memory_order_acquire));
+      else
+        m_work.notify_one();
+    }
+
+    if (l <= severity_level::XRT_ERROR)
+      written.get_future().wait();
+  }
+};
+
 } //end unnamed namespace
 
 namespace xrt_core { namespace message {
 
+bool
+should_send(severity_level l)
+{
+  static const int ver = xrt_core::config::get_verbosity();
+  return ver >= static_cast<int>(l);
+}
+
 void
 send(severity_level l, const char* tag, const char* msg)
 {
-  static const std::string logger =  xrt_core::config::get_logging();
-  int ver = xrt_core::config::get_verbosity();
-  int lev = static_cast<int>(l);
+  if (!should_send(l))
+    return;
 
-  if(ver >= lev) {
-    static message_dispatch* dispatcher = message_dispatch::make_dispatcher(logger);
-    dispatcher->send(l, tag, msg);
+  static const std::string logger =  xrt_core::config::get_logging();
+  static message_dispatch* dispatcher = message_dispatch::make_dispatcher(logger);
+  static bool async_enabled = xrt_core::config::get_logging_async()
+    && logger != "null" && !logger.empty();
+  if (async_enabled && !s_async_stopped.load(std::memory_order_acquire)) {
+    static async_dispatch async(dispatcher);
+    async.send(l, tag, msg);
+    return;
   }
+
+  record r(l, tag, msg);
+  dispatcher->send(r);
+  dispatcher->flush();
 }
 
 }} // message,xrt
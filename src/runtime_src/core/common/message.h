@@ -34,6 +34,15 @@ enum class severity_level : unsigned short
 };
 
 
+/**
+ * Check if a message of severity @l would be dispatched
+ *
+ * Lets callers skip formatting of messages that are filtered
+ * by the configured verbosity.
+ */
+bool
+should_send(severity_level l);
+
 void
 send(severity_level l, const char* tag, const char* msg);
 
@@ -0,0 +1,49 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef xrtcore_probe_h_
+#define xrtcore_probe_h_
+
+/**
+ * Static user space probe points (USDT) under provider 'xrt'.
+ *
+ * When built with XRT_ENABLE_PROBES (sys/sdt.h present), each probe
+ * is a single nop instruction plus an ELF note, so the probes cost
+ * nothing until attached by perf, bpftrace, or systemtap, e.g.
+ *
+ *   % perf probe -x libxilinxopencl.so sdt_xrt:cl_enqueue_ndrange_kernel_entry
+ *   % bpftrace -e 'usdt:libxrt_core.so:xrt:exec_buf_return { ... }'
+ *
+ * XRT_PROBE_SCOPE(name) fires name_entry at the point of use and
+ * name_return when the enclosing scope exits, which is what is needed
+ * to attribute host latency to each stage of the enqueue path.
+ */
+#if defined(XRT_ENABLE_PROBES)
+# include <sys/sdt.h>
+# define XRT_PROBE0(name) DTRACE_PROBE(xrt,name)
+# define XRT_PROBE1(name,a1) DTRACE_PROBE1(xrt,name,a1)
+# define XRT_PROBE2(name,a1,a2) DTRACE_PROBE2(xrt,name,a1,a2)
+# define XRT_PROBE_SCOPE(name)                                          \
+  DTRACE_PROBE(xrt,name##_entry);                                       \
+  struct xrt_probe_##name { ~xrt_probe_##name() { DTRACE_PROBE(xrt,name##_return); } } xrt_probe_##name##_guard
+#else
+# define XRT_PROBE0(name)
+# define XRT_PROBE1(name,a1)
+# define XRT_PROBE2(name,a1,a2)
+# define XRT_PROBE_SCOPE(name)
+#endif
+
+#endif
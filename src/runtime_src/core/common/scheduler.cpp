@@ -21,6 +21,7 @@
 #include "ert.h"
 
 #include <sys/mman.h>
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <cstring>
@@ -96,7 +97,7 @@ init(xclDeviceHandle handle, const axlf* top)
 
   auto cus = xclbin::get_cus(top, true);
 
-  ecmd->slot_size = config::get_ert_slotsize();
+  ecmd->slot_size = xclbin::get_ert_slot_size(top,config::get_ert_slotsize());
   ecmd->num_cus = cus.size();
   ecmd->cu_shift = 16;
   ecmd->cu_base_addr = xclbin::get_cu_base_offset(top);
@@ -106,6 +107,8 @@ init(xclDeviceHandle handle, const axlf* top)
   ecmd->cu_isr  = xrt_core::config::get_ert_cuisr() && xclbin::get_cuisr(top);
   ecmd->cq_int  = xrt_core::config::get_ert_cqint();
   ecmd->dataflow = xclbin::get_dataflow(top) || xrt_core::config::get_feature_toggle("Runtime.dataflow");
+  ecmd->cu_policy = xrt_core::config::get_cu_policy();
+  ecmd->intr_coalesce = std::min(xrt_core::config::get_ert_intr_coalesce(),63u);
 
   // cu addr map
   std::copy(cus.begin(), cus.end(), ecmd->data);
@@ -19,7 +19,99 @@
 #include <chrono>
 #include <string>
 #include <ctime>
+#include <cstdint>
 #include <cstring>
+#include <time.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+# include <cpuid.h>
+# define XRT_TIME_TSC 1
+#endif
+
+namespace {
+
+static inline uint64_t
+raw_ns()
+{
+  struct timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// Clock behind time_ns().  Uses the TSC scaled to nanoseconds when
+// the CPU has an invariant TSC, otherwise CLOCK_MONOTONIC_RAW.  The
+// TSC rate is calibrated once against CLOCK_MONOTONIC_RAW.
+struct clock_source
+{
+  uint64_t zero = 0;
+  uint64_t mult = 0;    // ns per tick as 32.32 fixed point, 0 if no tsc
+  static constexpr unsigned int shift = 32;
+
+#ifdef XRT_TIME_TSC
+  static bool
+  has_invariant_tsc()
+  {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007)
+      return false;
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    return edx & (1 << 8);
+  }
+
+  static uint64_t
+  tsc()
+  {
+    return __builtin_ia32_rdtsc();
+  }
+
+  void
+  calibrate()
+  {
+    // Spin for a few msec, long enough to make read jitter negligible
+    auto ns0 = raw_ns();
+    auto tsc0 = tsc();
+    uint64_t ns1 = ns0;
+    while ((ns1 = raw_ns()) - ns0 < 5000000)
+      ;
+    auto tsc1 = tsc();
+    if (tsc1 <= tsc0)
+      return;
+    mult = static_cast<uint64_t>((static_cast<unsigned __int128>(ns1 - ns0) << shift) / (tsc1 - tsc0));
+  }
+#endif
+
+  clock_source()
+  {
+#ifdef XRT_TIME_TSC
+    if (has_invariant_tsc())
+      calibrate();
+    if (mult) {
+      zero = tsc();
+      return;
+    }
+#endif
+    zero = raw_ns();
+  }
+
+  uint64_t
+  now() const
+  {
+#ifdef XRT_TIME_TSC
+    if (mult)
+      return static_cast<uint64_t>((static_cast<unsigned __int128>(tsc() - zero) * mult) >> shift);
+#endif
+    return raw_ns() - zero;
+  }
+};
+
+static const clock_source&
+get_clock()
+{
+  static clock_source clock;
+  return clock;
+}
+
+} // namespace
 
 namespace xrt_core {
 
@@ -30,10 +122,7 @@ namespace xrt_core {
 unsigned long
 time_ns()
 {
-  static auto zero = std::chrono::high_resolution_clock::now();
-  auto now = std::chrono::high_resolution_clock::now();
-  auto integral_duration = std::chrono::duration_cast<std::chrono::nanoseconds>(now-zero).count();
-  return static_cast<unsigned long>(integral_duration);
+  return static_cast<unsigned long>(get_clock().now());
 }
 
 /**
@@ -22,6 +22,12 @@
 namespace xrt_core {
 
 /**
+ * Monotonic clock shared by all of XRT
+ *
+ * Reads the TSC when the CPU has an invariant TSC, calibrated once
+ * against CLOCK_MONOTONIC_RAW, and falls back on CLOCK_MONOTONIC_RAW
+ * otherwise.
+ *
  * @return
  *   nanoseconds since first call
  */
@@ -15,6 +15,15 @@
  */
 
 #include "xclbin_parser.h"
+#include "ert.h"
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <sstream>
 
 // This is xclbin parser. Update this file if xclbin format has changed.
 
@@ -46,25 +55,20 @@ get_base_addr(const ip_data& ip)
   return addr;
 }
 
+static size_t
+convert(const std::string& str)
+{
+  return str.empty() ? 0 : std::stoul(str,0,0);
 }
 
-namespace xrt_core { namespace xclbin {
+}
 
-std::string
-memidx_to_name(const axlf* top,  int32_t midx)
-{
-  auto mem_topology = axlf_section_type<const ::mem_topology*>::get(top,axlf_section_kind::MEM_TOPOLOGY);
-  if (!mem_topology)
-    return std::to_string(midx);
-  if (midx >= mem_topology->m_count)
-    return std::to_string(midx);
+namespace xrt_core { namespace xclbin {
 
-  auto& md = mem_topology->m_mem_data[midx];
-  return std::string(reinterpret_cast<const char*>(md.m_tag));
-}
+namespace {
 
-std::vector<uint64_t>
-get_cus(const axlf* top, bool encoding)
+static std::vector<uint64_t>
+parse_cus(const axlf* top, bool encoding)
 {
   std::vector<uint64_t> cus;
   auto ip_layout = axlf_section_type<const ::ip_layout*>::get(top,axlf_section_kind::IP_LAYOUT);
@@ -85,8 +89,8 @@ get_cus(const axlf* top, bool encoding)
   return cus;
 }
 
-std::vector<std::pair<uint64_t, size_t>>
-get_debug_ips(const axlf* top)
+static std::vector<std::pair<uint64_t, size_t>>
+parse_debug_ips(const axlf* top)
 {
   std::vector<std::pair<uint64_t, size_t>> ips;
   auto debug_ip_layout = axlf_section_type<const ::debug_ip_layout*>::
@@ -112,10 +116,9 @@ get_debug_ips(const axlf* top)
   return ips;
 }
 
-uint64_t
-get_cu_base_offset(const axlf* top)
+static uint64_t
+parse_cu_base_offset(const axlf* top)
 {
-  std::vector<uint64_t> cus;
   auto ip_layout = axlf_section_type<const ::ip_layout*>::get(top,axlf_section_kind::IP_LAYOUT);
   if (!ip_layout)
     return 0;
@@ -129,8 +132,8 @@ get_cu_base_offset(const axlf* top)
   return base;
 }
 
-bool
-get_cuisr(const axlf* top)
+static bool
+parse_cuisr(const axlf* top)
 {
   auto ip_layout = axlf_section_type<const ::ip_layout*>::get(top,axlf_section_kind::IP_LAYOUT);
   if (!ip_layout)
@@ -144,8 +147,8 @@ get_cuisr(const axlf* top)
   return true;
 }
 
-bool
-get_dataflow(const axlf* top)
+static bool
+parse_dataflow(const axlf* top)
 {
   auto ip_layout = axlf_section_type<const ::ip_layout*>::get(top,axlf_section_kind::IP_LAYOUT);
   if (!ip_layout)
@@ -160,16 +163,169 @@ get_dataflow(const axlf* top)
   return false;
 }
 
+static size_t
+parse_regmap_size(const axlf* top)
+{
+  auto header = ::xclbin::get_axlf_section(top,axlf_section_kind::EMBEDDED_METADATA);
+  if (!header)
+    return 0;
+
+  namespace pt = boost::property_tree;
+  pt::ptree xml_project;
+  try {
+    std::stringstream xml_stream;
+    xml_stream.write(reinterpret_cast<const char*>(top) + header->m_sectionOffset,header->m_sectionSize);
+    pt::read_xml(xml_stream,xml_project);
+  }
+  catch (const std::exception&) {
+    return 0;
+  }
+
+  size_t size = 0;
+  pt::ptree empty;
+  for (auto& xml_kernel : xml_project.get_child("project.platform.device.core",empty)) {
+    if (xml_kernel.first != "kernel")
+      continue;
+    for (auto& xml_arg : xml_kernel.second) {
+      if (xml_arg.first != "arg")
+        continue;
+      auto offset = convert(xml_arg.second.get<std::string>("<xmlattr>.offset",""));
+      auto argsize = convert(xml_arg.second.get<std::string>("<xmlattr>.size",""));
+      size = std::max(size,offset+argsize);
+    }
+  }
+  return size;
+}
+
+static std::shared_ptr<const index>
+make_index(const axlf* top)
+{
+  auto idx = std::make_shared<index>();
+  idx->cus = parse_cus(top,false);
+  idx->encoded_cus = parse_cus(top,true);
+  idx->debug_ips = parse_debug_ips(top);
+  idx->cu_base_offset = parse_cu_base_offset(top);
+  idx->cuisr = parse_cuisr(top);
+  idx->dataflow = parse_dataflow(top);
+  idx->regmap_size = parse_regmap_size(top);
+
+  if (auto mem_topology = axlf_section_type<const ::mem_topology*>::get(top,axlf_section_kind::MEM_TOPOLOGY))
+    idx->mem_topology.assign(mem_topology->m_mem_data,mem_topology->m_mem_data+mem_topology->m_count);
+  if (auto connectivity = axlf_section_type<const ::connectivity*>::get(top,axlf_section_kind::CONNECTIVITY))
+    idx->connectivity.assign(connectivity->m_connection,connectivity->m_connection+connectivity->m_count);
+  return idx;
+}
+
+// Identity of an xclbin, empty if the xclbin has no uuid
+static std::string
+index_key(const axlf* top)
+{
+  auto uuid = reinterpret_cast<const char*>(&top->m_header.uuid);
+  if (std::all_of(uuid,uuid+sizeof(xuid_t),[](char c) { return c==0; }))
+    return "";
+
+  std::string key(uuid,sizeof(xuid_t));
+  key.append(reinterpret_cast<const char*>(&top->m_header.m_length),sizeof(top->m_header.m_length));
+  key.append(reinterpret_cast<const char*>(&top->m_header.m_timeStamp),sizeof(top->m_header.m_timeStamp));
+  return key;
+}
+
+} // namespace
+
+std::shared_ptr<const index>
+get_index(const axlf* top)
+{
+  auto key = index_key(top);
+  if (key.empty())
+    return make_index(top);
+
+  // Indices are few and small, they live for the process
+  static std::mutex mutex;
+  static std::map<std::string,std::shared_ptr<const index>> indices;
+  std::lock_guard<std::mutex> lk(mutex);
+  auto& idx = indices[key];
+  if (!idx)
+    idx = make_index(top);
+  return idx;
+}
+
+std::string
+memidx_to_name(const axlf* top,  int32_t midx)
+{
+  auto idx = get_index(top);
+  if (midx < 0 || static_cast<size_t>(midx) >= idx->mem_topology.size())
+    return std::to_string(midx);
+
+  auto& md = idx->mem_topology[midx];
+  return std::string(reinterpret_cast<const char*>(md.m_tag));
+}
+
+std::vector<uint64_t>
+get_cus(const axlf* top, bool encoding)
+{
+  auto idx = get_index(top);
+  return encoding ? idx->encoded_cus : idx->cus;
+}
+
+std::vector<std::pair<uint64_t, size_t>>
+get_debug_ips(const axlf* top)
+{
+  return get_index(top)->debug_ips;
+}
+
+uint64_t
+get_cu_base_offset(const axlf* top)
+{
+  return get_index(top)->cu_base_offset;
+}
+
+bool
+get_cuisr(const axlf* top)
+{
+  return get_index(top)->cuisr;
+}
+
+bool
+get_dataflow(const axlf* top)
+{
+  return get_index(top)->dataflow;
+}
+
+size_t
+get_regmap_size(const axlf* top)
+{
+  return get_index(top)->regmap_size;
+}
+
+size_t
+get_ert_slot_size(const axlf* top, size_t max_slot_size)
+{
+  auto idx = get_index(top);
+  auto regmap_size = idx->regmap_size;
+  if (!regmap_size)
+    return max_slot_size;
+
+  // Start kernel command is header, up to 4 CU masks, and regmap,
+  // CU control commands (configure, cu stat) have a word per CU
+  size_t num_cus = idx->cus.size();
+  size_t words = std::max<size_t>(1 + 4 + (regmap_size+3)/4, 1 + 5 + num_cus);
+
+  // At most 128 slots
+  size_t slot_size = ERT_CQ_SIZE / 128;
+  while (slot_size < words*sizeof(uint32_t) && slot_size < max_slot_size)
+    slot_size <<= 1;
+  return std::min(slot_size,max_slot_size);
+}
+
 std::vector<std::pair<uint64_t, size_t>>
 get_cus_pair(const axlf* top)
 {
-  std::vector<uint64_t> cus;
   std::vector<std::pair<uint64_t, size_t>> ret;
-  cus = get_cus(top, false);
+  auto idx = get_index(top);
 
-  for (auto it = cus.begin(); it != cus.end(); ++it)
+  for (auto addr : idx->cus)
     // CU size is 64KB
-    ret.push_back(std::make_pair(*it, 0x10000));
+    ret.push_back(std::make_pair(addr, 0x10000));
 
   return ret;
 }
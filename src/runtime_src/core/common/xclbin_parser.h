@@ -18,7 +18,9 @@
 #define xclbin_parser_h_
 
 #include "xclbin.h"
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace xrt_core { namespace xclbin {
@@ -45,6 +47,35 @@ struct axlf_section_type<SectionType*>
   }
 };
 
+/**
+ * struct index - Parse results of one xclbin
+ *
+ * Sections are scanned and sorted once per xclbin, see get_index().
+ * The functions below return results from the index.
+ */
+struct index
+{
+  std::vector<uint64_t> cus;          // sorted CU base addresses
+  std::vector<uint64_t> encoded_cus;  // sorted, control protocol in lower bits
+  std::vector<std::pair<uint64_t, size_t>> debug_ips; // sorted address, size
+  uint64_t cu_base_offset = 0;
+  bool cuisr = false;
+  bool dataflow = false;
+  size_t regmap_size = 0;
+  std::vector<mem_data> mem_topology;
+  std::vector<connection> connectivity;
+};
+
+/**
+ * get_index() - Get parsed and immutable index of xclbin
+ *
+ * The index is built on first call for an xclbin and shared by all
+ * later callers passing an xclbin with the same uuid, length, and
+ * time stamp.  An xclbin without uuid is parsed on every call.
+ */
+std::shared_ptr<const index>
+get_index(const axlf* top);
+
 /**
  * memidx_to_name() - Convert mem topology memory index to name
  */
@@ -80,6 +111,28 @@ get_cuisr(const axlf* top);
 bool
 get_dataflow(const axlf* top);
 
+/**
+ * get_regmap_size() - Get max CU register map size in bytes
+ *
+ * The size is computed from the kernel argument offsets and sizes
+ * in the embedded meta data.
+ * Return: 0 if xclbin has no kernel meta data
+ */
+size_t
+get_regmap_size(const axlf* top);
+
+/**
+ * get_ert_slot_size() - Get ERT command queue slot size for xclbin
+ *
+ * @max_slot_size: slot size used if xclbin has no kernel meta data,
+ *  and upper bound of the returned slot size
+ * Return: Smallest power of 2 slot size that holds start kernel
+ *  commands for all CUs and CU control commands.  The smaller the
+ *  slot size, the more commands can be in flight.
+ */
+size_t
+get_ert_slot_size(const axlf* top, size_t max_slot_size);
+
 /**
  * get_cus_pair() - Get list CUs physical address & size pair
  */
@@ -22,6 +22,7 @@
 #include <linux/kthread.h>
 #include <linux/delay.h>
 #include <linux/sched.h>
+#include <linux/module.h>
 #include "ert.h"
 #include "sched_exec.h"
 #include "zocl_sk.h"
@@ -69,17 +70,45 @@ static struct sched_ops ps_ert_ops;
 static LIST_HEAD(free_cmds);
 static DEFINE_MUTEX(free_cmds_mutex);
 
-/**
- * List of new pending sched_cmd objects
- *
- * @pending_cmds: populated from user space with new commands for buffer objects
- * @num_pending: number of pending commands
- *
- * Scheduler copies pending commands to its private queue when necessary
+/*
+ * Cpu on which the scheduler thread busy polls for work instead of sleeping
+ * on its wait queue.  Intended for an A53 core dedicated to scheduling
+ * (isolcpus).  A negative value (default) disables polling.
+ */
+static int sched_poll_cpu = -1;
+module_param(sched_poll_cpu, int, 0444);
+MODULE_PARM_DESC(sched_poll_cpu,
+	"Cpu for busy polling scheduler thread (-1 = sleep on wait queue)");
+
+/*
+ * Only write CU argument registers that changed since the previous
+ * command on the same CU. Off by default: it assumes nothing but the
+ * scheduler writes those registers, which does not hold if user space
+ * also pokes the CU through its mapped control aperture.
+ */
+static bool cu_regmap_diff;
+module_param(cu_regmap_diff, bool, 0644);
+MODULE_PARM_DESC(cu_regmap_diff,
+	"Only write changed CU argument registers (default off)");
+
+/*
+ * Write contiguous CU register ranges with 64-bit stores so that the
+ * interconnect can burst them. Requires CU register slaves that accept
+ * accesses wider than 32 bits.
  */
-static LIST_HEAD(pending_cmds);
-static DEFINE_MUTEX(pending_cmds_mutex);
-static atomic_t num_pending = ATOMIC_INIT(0);
+static bool cu_regmap_burst;
+module_param(cu_regmap_burst, bool, 0644);
+MODULE_PARM_DESC(cu_regmap_burst,
+	"Burst contiguous CU register writes (default off)");
+
+/*
+ * Number of memcpy DMA channels used for copy BO commands. More channels
+ * let independent copies run at the same time.
+ */
+static int copybo_dma_chans = 4;
+module_param(copybo_dma_chans, int, 0444);
+MODULE_PARM_DESC(copybo_dma_chans,
+	"Max DMA channels used for copy BO commands (1 - 8, default 4)");
 
 /**
  * is_ert() - Check if running in embedded (ert) mode.
@@ -391,16 +420,72 @@ set_cmd_int_state(struct sched_cmd *cmd, enum ert_cmd_state state)
 	SCHED_DEBUG("<- set_cmd_int_state\n");
 }
 
+/**
+ * write_cu_regs - Write a contiguous range of CU registers
+ *
+ * With cu_regmap_burst, aligned register pairs are written with one
+ * relaxed 64-bit store so the interconnect can merge them; the odd head
+ * and tail still use iowrite32(). The CU start that follows is a
+ * non-relaxed write and thus ordered after these.
+ */
+static inline void
+write_cu_regs(u32 *reg_data, u32 *base_addr, u32 count)
+{
+#ifdef CONFIG_64BIT
+	if (cu_regmap_burst && count > 1) {
+		if (!IS_ALIGNED((unsigned long)base_addr, sizeof(u64))) {
+			iowrite32(*reg_data++, base_addr++);
+			count--;
+		}
+		for (; count >= 2; count -= 2, reg_data += 2, base_addr += 2)
+			writeq_relaxed(reg_data[0] | ((u64)reg_data[1] << 32),
+			    base_addr);
+	}
+#endif
+	for (; count; count--)
+		iowrite32(*reg_data++, base_addr++);
+}
+
+/**
+ * cu_shadow_get - Get CU shadow regmap able to hold @size words
+ *
+ * Return: shadow or NULL if register diffing is off or out of memory
+ */
+static u32 *
+cu_shadow_get(struct zocl_cu *cu, u32 size)
+{
+	u32 *shadow;
+
+	if (!cu_regmap_diff || !cu)
+		return NULL;
+
+	if (size > cu->zc_shadow_cap) {
+		shadow = krealloc(cu->zc_shadow, size * sizeof(u32),
+		    GFP_KERNEL);
+		if (!shadow)
+			return NULL;
+		cu->zc_shadow = shadow;
+		cu->zc_shadow_cap = size;
+	}
+
+	return cu->zc_shadow;
+}
+
 /**
  * write_cu_regmap - Write CU regmap
  *
+ * @cu: CU state, tracks previously written regmap, may be NULL
  * @reg_data: start address of regmap data
  * @base_addr: CU regmap base virtual address
+ *
+ * With cu_regmap_diff, only registers that differ from the previous
+ * invocation of the CU are written.
  */
 static inline void
-write_cu_regmap(u32 *reg_data, u32 *base_addr, u32 size)
+write_cu_regmap(struct zocl_cu *cu, u32 *reg_data, u32 *base_addr, u32 size)
 {
-	u32 i;
+	u32 *shadow = cu_shadow_get(cu, size);
+	u32 i, start, valid;
 
 	/* Write register map, starting at base_addr + 0x10 (byte)
 	 * This based on the fact that kernel used
@@ -409,8 +494,48 @@ write_cu_regmap(u32 *reg_data, u32 *base_addr, u32 size)
 	 *	0x0C -- Interrupt Status Register
 	 * Skip the first 4 words in user regmap.
 	 */
-	for (i = 4; i < size; ++i)
-		iowrite32(reg_data[i], base_addr + i);
+	if (!shadow) {
+		if (size > 4)
+			write_cu_regs(reg_data + 4, base_addr + 4, size - 4);
+		return;
+	}
+
+	valid = cu->zc_shadow_valid;
+	i = 4;
+	while (i < size) {
+		if (i < valid && shadow[i] == reg_data[i]) {
+			++i;
+			continue;
+		}
+		/* Write the run of changed registers in one go */
+		start = i;
+		while (i < size && !(i < valid && shadow[i] == reg_data[i]))
+			++i;
+		write_cu_regs(reg_data + start, base_addr + start, i - start);
+		memcpy(shadow + start, reg_data + start,
+		    (i - start) * sizeof(u32));
+	}
+	cu->zc_shadow_valid = max(valid, size);
+}
+
+static inline struct zocl_cu *
+cu_idx_to_cu(struct drm_device *dev, int cu_idx)
+{
+	struct drm_zocl_dev *zdev = dev->dev_private;
+
+	return zdev->exec->cu ? &zdev->exec->cu[cu_idx] : NULL;
+}
+
+static void
+cu_shadow_fini(struct sched_exec_core *exec)
+{
+	unsigned int i;
+
+	if (!exec->cu)
+		return;
+
+	for (i = 0; i < exec->num_cus; i++)
+		kfree(exec->cu[i].zc_shadow);
 }
 
 /*
@@ -638,7 +763,8 @@ init_cu_by_idx(struct sched_cmd *cmd, int cu_idx)
 
 	ik = (struct ert_init_kernel_cmd *)cmd->packet;
 
-	write_cu_regmap(ik->data + ik->extra_cu_masks, virt_addr, size);
+	write_cu_regmap(cu_idx_to_cu(cmd->ddev, cu_idx),
+	    ik->data + ik->extra_cu_masks, virt_addr, size);
 }
 
 /**
@@ -770,7 +896,7 @@ configure(struct sched_cmd *cmd)
 	if (sched_error_on(exec, opcode(cmd) != ERT_CONFIGURE))
 		return 1;
 
-	if (!list_empty(&pending_cmds)) {
+	if (atomic_read(&g_sched0.num_pending)) {
 		DRM_ERROR("Pending commands list not empty\n");
 		return 1;
 	}
@@ -820,6 +946,10 @@ configure(struct sched_cmd *cmd)
 	}
 
 	exec->cu = vzalloc(sizeof(struct zocl_cu) * exec->num_cus);
+	if (!exec->cu) {
+		write_unlock(&zdev->attr_rwlock);
+		return 1;
+	}
 
 	for (i = 0; i < exec->num_cus; i++) {
 		/* CU address should be masked by encoded handshake for KDS. */
@@ -1037,6 +1167,8 @@ unconfigure_soft_kernel(struct sched_cmd *cmd)
 	for (i = cfg->start_cuidx; i < cfg->start_cuidx + cfg->num_cus; i++) {
 		scu = sk->sk_cu[i];
 		scu->sc_flags |= ZOCL_SCU_FLAGS_RELEASE;
+		if (scu->sc_ring && zocl_sk_ring_post(scu, NULL, 0, true))
+			DRM_WARN("Soft Kernel CU %d ring is full.\n", i);
 		up(&scu->sc_sem);
 	}
 
@@ -1192,6 +1324,10 @@ reset_cu(struct sched_cmd *cmd)
 	/* Bit 5 AP_RESET */
 	iowrite32(1 << 5, virt_addr);
 
+	/* Reset clears the argument registers, forget what we wrote */
+	if (cu_idx_to_cu(cmd->ddev, cu_idx))
+		cu_idx_to_cu(cmd->ddev, cu_idx)->zc_shadow_valid = 0;
+
 	SCHED_DEBUG("<- reset_cu \n");
 }
 
@@ -1272,10 +1408,22 @@ scu_done(struct sched_cmd *cmd)
 	struct drm_zocl_dev *zdev = cmd->ddev->dev_private;
 	int cu_idx = cmd->cu_idx;
 	struct soft_kernel *sk = zdev->soft_kernel;
-	u32 *virt_addr = sk->sk_cu[cu_idx]->sc_vregs;
+	struct soft_cu *scu = sk->sk_cu[cu_idx];
+	u32 *virt_addr = scu->sc_vregs;
 
 	SCHED_DEBUG("-> scu_done(,%d) checks scu at address 0x%p\n",
 		    cu_idx, virt_addr);
+
+	/* Ring CU is done when the daemon has caught up with the ring */
+	if (scu->sc_ring) {
+		if (!zocl_sk_ring_idle(scu))
+			return false;
+		zdev->exec->scu_status[cu_mask_idx(cu_idx)] ^=
+		    1 << cu_idx_in_mask(cu_idx);
+		SCHED_DEBUG("<- scu_done returns 1\n");
+		return true;
+	}
+
 	/* We simulate hard CU here.
 	 * done is indicated by AP_DONE(2) alone or by AP_DONE(2) | AP_IDLE(4)
 	 * but not by AP_IDLE itself.  Since 0x10 | (0x10 | 0x100) = 0x110
@@ -1508,16 +1656,20 @@ void zocl_gem_object_unref(struct sched_cmd *cmd)
 /*
  * add_cmd() - Add a new command to the pending list
  *
- * @ddev: drm device owning adding the buffer object
- * @bo: buffer objects from user space from which new command is created
+ * @cmd: command to add
+ * @client: submitting client, NULL for commands from ERT command queue
  *
- * Scheduler copies pending commands to its internal command queue.
+ * Command is pushed lock-free on the submit list of the client, the
+ * first command of a batch also puts the client on the scheduler list
+ * of clients.  Scheduler copies pending commands to its internal
+ * command queue.
  *
  * Return: 0 on success, -errno on failure
  */
 static int
-add_cmd(struct sched_cmd *cmd)
+add_cmd(struct sched_cmd *cmd, struct sched_client_ctx *client)
 {
+	struct scheduler *sched = cmd->sched;
 	int ret = 0;
 
 	SCHED_DEBUG("-> add_cmd\n");
@@ -1527,13 +1679,19 @@ add_cmd(struct sched_cmd *cmd)
 	DRM_DEBUG("packet header 0x%08x, data 0x%08x\n",
 		  cmd->packet->header, cmd->packet->data[0]);
 	set_cmd_state(cmd, ERT_CMD_STATE_NEW);
-	mutex_lock(&pending_cmds_mutex);
-	list_add_tail(&cmd->list, &pending_cmds);
-	mutex_unlock(&pending_cmds_mutex);
+
+	/* count before publishing, scheduler subtracts what it drains */
+	atomic_inc(&sched->num_pending);
+	if (client) {
+		llist_add(&cmd->pending, &client->submit);
+		if (!atomic_cmpxchg(&client->queued, 0, 1))
+			llist_add(&client->sched_node, &sched->clients);
+	} else
+		llist_add(&cmd->pending, &sched->submit);
 
 	/* wake scheduler */
-	atomic_inc(&num_pending);
-	wake_up_interruptible(&cmd->sched->wait_queue);
+	if (!sched->busy_poll)
+		wake_up_interruptible(&sched->wait_queue);
 
 	SCHED_DEBUG("<- add_cmd\n");
 	return ret;
@@ -1551,7 +1709,8 @@ add_cmd(struct sched_cmd *cmd)
  * Return: 0 on success, -errno on failure
  */
 static int
-add_gem_bo_cmd(struct drm_device *dev, struct drm_zocl_bo *bo)
+add_gem_bo_cmd(struct drm_device *dev, struct drm_zocl_bo *bo,
+	       struct sched_client_ctx *client)
 {
 	struct sched_cmd *cmd;
 	struct drm_zocl_dev *zdev = dev->dev_private;
@@ -1575,7 +1734,7 @@ add_gem_bo_cmd(struct drm_device *dev, struct drm_zocl_bo *bo)
 	cmd->cq_slot_idx = 0;
 	cmd->free_buffer = zocl_gem_object_unref;
 
-	ret = add_cmd(cmd);
+	ret = add_cmd(cmd, client);
 
 	SCHED_DEBUG("<- add_gem_bo_cmd\n");
 	return ret;
@@ -1618,6 +1777,67 @@ delete_cmd_list(void)
 	mutex_unlock(&free_cmds_mutex);
 }
 
+/**
+ * queue_submitted() - Move a detached submit list to scheduler command queue
+ *
+ * @sched: scheduler owning the command queue
+ * @first: first node of list detached with llist_del_all()
+ *
+ * Return: number of commands moved
+ */
+static unsigned int
+queue_submitted(struct scheduler *sched, struct llist_node *first)
+{
+	struct sched_cmd *cmd, *next;
+	unsigned int count = 0;
+
+	/* llist is LIFO, restore submission order */
+	first = llist_reverse_order(first);
+	llist_for_each_entry_safe(cmd, next, first, pending) {
+		list_add_tail(&cmd->list, &sched->cq);
+		set_cmd_int_state(cmd, ERT_CMD_STATE_QUEUED);
+		++count;
+	}
+	return count;
+}
+
+/**
+ * scheduler_queue_cmds() - Queue any pending commands
+ *
+ * The scheduler copies pending commands to its internal command queue where
+ * is is now in queued state.  Each submit list is detached as one batch, a
+ * client that submits while its batch is drained is put back on the list of
+ * clients for the next pass.
+ */
+static void
+scheduler_queue_cmds(struct scheduler *sched)
+{
+	struct sched_client_ctx *client, *next;
+	struct llist_node *clients;
+	unsigned int count;
+
+	if (!atomic_read(&sched->num_pending))
+		return;
+
+	SCHED_DEBUG("-> scheduler_queue_cmds\n");
+	count = queue_submitted(sched, llist_del_all(&sched->submit));
+
+	mutex_lock(&sched->drain_lock);
+	clients = llist_reverse_order(llist_del_all(&sched->clients));
+	llist_for_each_entry_safe(client, next, clients, sched_node) {
+		count += queue_submitted(sched, llist_del_all(&client->submit));
+		atomic_set(&client->queued, 0);
+		smp_mb__after_atomic();
+		if (!llist_empty(&client->submit) &&
+		    !atomic_cmpxchg(&client->queued, 0, 1))
+			llist_add(&client->sched_node, &sched->clients);
+	}
+	mutex_unlock(&sched->drain_lock);
+
+	atomic_sub(count, &sched->num_pending);
+	SCHED_DEBUG("<- scheduler_queue_cmds\n");
+}
+
 /**
  * reset_exec() - Reset the scheduler
  *
@@ -1635,15 +1855,7 @@ reset_exec(struct sched_exec_core *exec)
 	struct sched_cmd *cmd;
 
 	/* clear stale command objects if any */
-	list_for_each_safe(pos, next, &pending_cmds) {
-		cmd = list_entry(pos, struct sched_cmd, list);
-		zdev = cmd->ddev->dev_private;
-		if (zdev->exec != exec)
-			continue;
-		DRM_INFO("deleting stale pending cmd\n");
-		cmd->free_buffer(cmd);
-		recycle_cmd(cmd);
-	}
+	scheduler_queue_cmds(&g_sched0);
 	list_for_each_safe(pos, next, &g_sched0.cq) {
 		cmd = list_entry(pos, struct sched_cmd, list);
 		zdev = cmd->ddev->dev_private;
@@ -1664,18 +1876,10 @@ reset_exec(struct sched_exec_core *exec)
 static void
 reset_all(void)
 {
-	struct drm_zocl_dev *zdev;
 	struct sched_cmd *cmd;
 
 	/* clear stale command object if any */
-	while (!list_empty(&pending_cmds)) {
-		cmd = list_first_entry(&pending_cmds, struct sched_cmd, list);
-
-		zdev = cmd->ddev->dev_private;
-		DRM_INFO("deleting stale pending cmd\n");
-		cmd->free_buffer(cmd);
-		recycle_cmd(cmd);
-	}
+	scheduler_queue_cmds(&g_sched0);
 	while (!list_empty(&g_sched0.cq)) {
 		cmd = list_first_entry(&g_sched0.cq, struct sched_cmd, list);
 
@@ -1754,7 +1958,8 @@ configure_cu(struct sched_cmd *cmd, int cu_idx)
 
 	sk = (struct ert_start_kernel_cmd *)cmd->packet;
 
-	write_cu_regmap(sk->data + sk->extra_cu_masks, virt_addr, size);
+	write_cu_regmap(cu_idx_to_cu(cmd->ddev, cu_idx),
+	    sk->data + sk->extra_cu_masks, virt_addr, size);
 
 	/* Let user know which CU execute this command */
 	set_cmd_ext_cu_idx(cmd, cu_idx);
@@ -1824,6 +2029,15 @@ ert_configure_scu(struct sched_cmd *cmd, int cu_idx)
 		return -ENXIO;
 	}
 
+	if (scu->sc_ring) {
+		int ret = zocl_sk_ring_post(scu, skc->data +
+		    skc->extra_cu_masks, size, false);
+
+		mutex_unlock(&sk->sk_lock);
+		SCHED_DEBUG("<- ert_configure_scu ring %d\n", ret);
+		return ret;
+	}
+
 	cu_regfile = scu->sc_vregs;
 
 	SCHED_DEBUG("cu_idx=%d, cu_addr=0x%p, regmap_size=%d\n",
@@ -1987,33 +2201,6 @@ complete_to_free(struct sched_cmd *cmd)
 }
 
 
-/**
- * scheduler_queue_cmds() - Queue any pending commands
- *
- * The scheduler copies pending commands to its internal command queue where
- * is is now in queued state.
- */
-static void
-scheduler_queue_cmds(struct scheduler *sched)
-{
-	struct sched_cmd *cmd;
-	struct list_head *pos, *next;
-
-	SCHED_DEBUG("-> scheduler_queue_cmds\n");
-	mutex_lock(&pending_cmds_mutex);
-	list_for_each_safe(pos, next, &pending_cmds) {
-		cmd = list_entry(pos, struct sched_cmd, list);
-		if (cmd->sched != sched)
-			continue;
-		list_del(&cmd->list);
-		list_add_tail(&cmd->list, &sched->cq);
-		set_cmd_int_state(cmd, ERT_CMD_STATE_QUEUED);
-		atomic_dec(&num_pending);
-	}
-	mutex_unlock(&pending_cmds_mutex);
-	SCHED_DEBUG("<- scheduler_queue_cmds\n");
-}
-
 /**
  * scheduler_iterate_cmds() - Iterate all commands in scheduler command queue
  */
@@ -2068,7 +2255,7 @@ sched_wait_cond(struct scheduler *sched)
 		return 0;
 	}
 
-	if (atomic_read(&num_pending)) {
+	if (atomic_read(&sched->num_pending)) {
 		SCHED_DEBUG("scheduler wakes to copy new pending commands\n");
 		return 0;
 	}
@@ -2101,6 +2288,11 @@ sched_wait_cond(struct scheduler *sched)
 static void
 scheduler_wait(struct scheduler *sched)
 {
+	if (sched->busy_poll) {
+		if (sched_wait_cond(sched))
+			cond_resched();
+		return;
+	}
 	wait_event_interruptible(sched->wait_queue, !sched_wait_cond(sched));
 }
 
@@ -2173,13 +2365,31 @@ init_scheduler_thread(void)
 	g_sched0.poll = 0;
 	atomic_set(&g_sched0.check, 0);
 
-	g_sched0.sched_thread = kthread_run(scheduler, &g_sched0, name);
+	init_llist_head(&g_sched0.submit);
+	init_llist_head(&g_sched0.clients);
+	atomic_set(&g_sched0.num_pending, 0);
+	mutex_init(&g_sched0.drain_lock);
+	g_sched0.busy_poll = 0;
+
+	g_sched0.sched_thread = kthread_create(scheduler, &g_sched0, name);
 	if (IS_ERR(g_sched0.sched_thread)) {
 		int ret = PTR_ERR(g_sched0.sched_thread);
 
 		DRM_ERROR(__func__);
 		return ret;
 	}
+
+	if (sched_poll_cpu >= 0) {
+		if (sched_poll_cpu < nr_cpu_ids && cpu_online(sched_poll_cpu)) {
+			kthread_bind(g_sched0.sched_thread, sched_poll_cpu);
+			g_sched0.busy_poll = 1;
+			DRM_INFO("scheduler polls on cpu %d\n", sched_poll_cpu);
+		} else
+			DRM_WARN("cpu %d offline, scheduler will not poll\n",
+				 sched_poll_cpu);
+	}
+
+	wake_up_process(g_sched0.sched_thread);
 	return 0;
 }
 
@@ -2258,25 +2468,41 @@ static void zocl_dma_complete(void *arg)
 	wake_up_interruptible(&cmd->sched->wait_queue);
 }
 
+/*
+ * Pick a DMA channel for a copy BO command. Channels are requested on the
+ * first copy, up to copybo_dma_chans of them, and commands are spread
+ * over them round robin. Copies on different channels run concurrently;
+ * copies on the same channel are queued by the dma engine in order.
+ * Only called from the scheduler thread.
+ */
 static int
 zocl_dma_channel_instance(zocl_dma_handle_t *dma_handle,
     struct drm_zocl_dev *zdev)
 {
 	dma_cap_mask_t dma_mask;
+	struct dma_chan *chan;
+	int want;
 
 	if (!dma_handle->dma_chan && ZOCL_PLATFORM_ARM64) {
-		/* If zdev_dma_chan is NULL, we haven't initialized it yet. */
-		if (!zdev->zdev_dma_chan) {
+		/* If no channel yet, we haven't initialized it yet. */
+		if (!zdev->num_dma_chan) {
+			want = clamp(copybo_dma_chans, 1, ZOCL_MAX_DMA_CHANS);
 			dma_cap_zero(dma_mask);
 			dma_cap_set(DMA_MEMCPY, dma_mask);
-			zdev->zdev_dma_chan =
-			    dma_request_channel(dma_mask, 0, NULL);
-			if (!zdev->zdev_dma_chan) {
+			while (zdev->num_dma_chan < want) {
+				chan = dma_request_channel(dma_mask, 0, NULL);
+				if (!chan)
+					break;
+				zdev->zdev_dma_chan[zdev->num_dma_chan++] =
+				    chan;
+			}
+			if (!zdev->num_dma_chan) {
 				DRM_WARN("no DMA Channel available.\n");
 				return -EBUSY;
 			}
 		}
-		dma_handle->dma_chan = zdev->zdev_dma_chan;
+		dma_handle->dma_chan = zdev->zdev_dma_chan[
+		    zdev->dma_chan_next++ % zdev->num_dma_chan];
 	}
 
 	return dma_handle->dma_chan ? 0 : -EINVAL;
@@ -2578,7 +2804,7 @@ zocl_execbuf_ioctl(struct drm_device *dev, void *data, struct drm_file *filp)
 		goto out;
 	}
 
-	if (add_gem_bo_cmd(dev, zocl_bo)) {
+	if (add_gem_bo_cmd(dev, zocl_bo, filp->driver_priv)) {
 		ret = -EINVAL;
 		goto out;
 	}
@@ -2682,7 +2908,7 @@ add_ert_cq_cmd(struct drm_device *drm, void *buffer, unsigned int cq_idx)
 	cmd->cq_slot_idx = cq_idx;
 	cmd->free_buffer = zocl_cmd_buffer_free;
 
-	ret = add_cmd(cmd);
+	ret = add_cmd(cmd, NULL);
 
 	SCHED_DEBUG("<- add_ert_cq_cmd\n");
 	return ret;
@@ -2874,6 +3100,7 @@ int sched_fini_exec(struct drm_device *drm)
 		kthread_stop(zdev->exec->cq_thread);
 
 	fini_scheduler_thread();
+	cu_shadow_fini(zdev->exec);
 	vfree(zdev->exec->cu);
 	zocl_cleanup_cu_timer(zdev);
 	SCHED_DEBUG("<- sched_fini_exec\n");
@@ -2895,8 +3122,21 @@ void zocl_untrack_ctx(struct drm_device *dev, struct sched_client_ctx *fpriv)
 {
 	unsigned long flags;
 	struct drm_zocl_dev *zdev = dev->dev_private;
+	struct scheduler *sched = zdev->exec->scheduler;
 
 	spin_lock_irqsave(&zdev->exec->ctx_list_lock, flags);
 	list_del(&fpriv->link);
 	spin_unlock_irqrestore(&zdev->exec->ctx_list_lock, flags);
+
+	/*
+	 * The client can not submit anymore, but its last batch may still
+	 * be on the scheduler list of clients.  Wait for the scheduler to
+	 * drain it and to leave the drain loop before fpriv is freed.
+	 */
+	while (atomic_read(&fpriv->queued) && !sched->stop) {
+		wake_up_interruptible(&sched->wait_queue);
+		usleep_range(10, 100);
+	}
+	mutex_lock(&sched->drain_lock);
+	mutex_unlock(&sched->drain_lock);
 }
@@ -23,6 +23,7 @@
 #include <linux/mutex.h>
 #include <linux/init_task.h>
 #include <linux/list.h>
+#include <linux/llist.h>
 #include <linux/wait.h>
 #include "ert.h"
 #include "zocl_drv.h"
@@ -66,15 +67,33 @@ enum zocl_cu_type {
 struct sched_dev;
 struct sched_ops;
 
+/**
+ * struct sched_client_ctx: Per drm_file client context
+ *
+ * @submit: commands submitted by this client, not yet seen by scheduler
+ * @sched_node: link in scheduler list of clients with submitted commands
+ * @queued: set while client is in scheduler list of clients
+ *
+ * Only the execbuf ioctl of the client adds to @submit and only the
+ * scheduler thread removes from it, no lock is taken on submission.
+ */
 struct sched_client_ctx {
 	struct list_head    link;
 	atomic_t            trigger;
 	struct mutex        lock;
+
+	struct llist_head   submit;
+	struct llist_node   sched_node;
+	atomic_t            queued;
 };
 
 struct zocl_cu {
 	uint32_t            zc_timeout;
 	uint32_t            zc_reset_timeout;
+	/* Last regmap written to the CU, see cu_regmap_diff */
+	uint32_t           *zc_shadow;
+	uint32_t            zc_shadow_cap;
+	uint32_t            zc_shadow_valid;
 };
 
 /**
@@ -165,6 +184,11 @@ struct sched_exec_core {
  * @intc: set when there is a pending interrupt for command completion
  * @poll: number of running commands in polling mode
  * @check: flag to indicate a CU timerout check
+ * @submit: commands submitted without a client (ERT command queue)
+ * @clients: clients with submitted commands
+ * @num_pending: number of submitted commands not yet in @cq
+ * @drain_lock: held by scheduler while draining @clients
+ * @busy_poll: set when scheduler polls instead of sleeping
  */
 struct scheduler {
 	struct task_struct        *sched_thread;
@@ -178,6 +202,12 @@ struct scheduler {
 	unsigned int               intc; /* pending intr shared with isr*/
 	unsigned int               poll; /* number of cmds to poll */
 	atomic_t                   check;
+
+	struct llist_head          submit;
+	struct llist_head          clients;
+	atomic_t                   num_pending;
+	struct mutex               drain_lock;
+	unsigned int               busy_poll;
 };
 
 /**
@@ -195,6 +225,7 @@ struct scheduler {
  */
 struct sched_cmd {
 	struct list_head list;
+	struct llist_node pending;
 	struct drm_device *ddev;
 	struct scheduler *sched;
 	struct sched_exec_core *exec;
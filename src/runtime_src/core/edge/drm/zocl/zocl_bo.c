@@ -62,11 +62,20 @@ int zocl_iommu_map_bo(struct drm_device *dev, struct drm_zocl_bo *bo)
 	size_t bo_size = bo->gem_base.size;
 	ssize_t err;
 
-	/* Create scatter gather list from user's pages */
-	bo->sgt = drm_prime_pages_to_sg(bo->pages, bo_size >> PAGE_SHIFT);
-	if (IS_ERR(bo->sgt)) {
-		bo->uaddr = 0;
-		return PTR_ERR(bo->sgt);
+	/*
+	 * Create scatter gather list from user's pages, unless it was
+	 * built at allocation time already. Rebuilding it on every mmap
+	 * is costly for multi GB BOs and leaked the previous table.
+	 */
+	if (!bo->sgt) {
+		bo->sgt = drm_prime_pages_to_sg(bo->pages,
+		    bo_size >> PAGE_SHIFT);
+		if (IS_ERR(bo->sgt)) {
+			err = PTR_ERR(bo->sgt);
+			bo->sgt = NULL;
+			bo->uaddr = 0;
+			return err;
+		}
 	}
 
 	/* MAP user's VA to pages table into IOMMU */
@@ -235,30 +244,44 @@ zocl_create_svm_bo(struct drm_device *dev, void *data, struct drm_file *filp)
 		return -EINVAL;
 
 	bo = zocl_create_bo(dev, args->size, args->flags);
-	bo->flags |= ZOCL_BO_FLAGS_SVM;
-	bo->bank = GET_MEM_BANK(args->flags);
-
 	if (IS_ERR(bo)) {
 		DRM_DEBUG("object creation failed\n");
 		return PTR_ERR(bo);
 	}
+	bo->flags |= ZOCL_BO_FLAGS_SVM;
+	bo->bank = GET_MEM_BANK(args->flags);
+
+	/*
+	 * Backed by discontiguous shmem pages, the PL sees them through the
+	 * SMMU at a contiguous IOVA once mapped, so BO size is not bound by
+	 * the CMA pool.
+	 */
 	bo->pages = drm_gem_get_pages(&bo->gem_base);
 	if (IS_ERR(bo->pages)) {
 		ret = PTR_ERR(bo->pages);
+		bo->pages = NULL;
 		goto out_free;
 	}
 
 	bo_size = bo->gem_base.size;
 	bo->sgt = drm_prime_pages_to_sg(bo->pages, bo_size >> PAGE_SHIFT);
-	if (IS_ERR(bo->sgt))
+	if (IS_ERR(bo->sgt)) {
+		ret = PTR_ERR(bo->sgt);
+		bo->sgt = NULL;
 		goto out_free;
+	}
 
-	bo->vmapping = vmap(bo->pages, bo->gem_base.size >> PAGE_SHIFT, VM_MAP,
-			pgprot_writecombine(PAGE_KERNEL));
-
-	if (!bo->vmapping) {
-		ret = -ENOMEM;
-		goto out_free;
+	/*
+	 * Only exec buffers are read by the kernel, don't eat vmalloc space
+	 * with kernel mappings of large data BOs.
+	 */
+	if (args->flags & ZOCL_BO_FLAGS_EXECBUF) {
+		bo->vmapping = vmap(bo->pages, bo_size >> PAGE_SHIFT, VM_MAP,
+				pgprot_writecombine(PAGE_KERNEL));
+		if (!bo->vmapping) {
+			ret = -ENOMEM;
+			goto out_free;
+		}
 	}
 
 	ret = drm_gem_create_mmap_offset(&bo->gem_base);
@@ -489,15 +512,57 @@ out:
 	return ret;
 }
 
+/*
+ * Cache maintenance on [offset, offset + size) of a CMA BO, the range
+ * has been checked by the caller.
+ */
+static int zocl_sync_bo_range(struct drm_device *dev,
+		struct drm_gem_object *gem_obj, enum drm_zocl_sync_bo_dir dir,
+		uint64_t offset, uint64_t size)
+{
+	struct drm_gem_cma_object	*cma_obj;
+	dma_addr_t			bus_addr;
+
+	cma_obj = to_drm_gem_cma_obj(gem_obj);
+	bus_addr = cma_obj->paddr;
+
+	/* only invalidate the range of addresses requested by the user */
+	bus_addr += offset;
+
+	/**
+	 * NOTE: We a little bit abuse the dma_sync_single_* API here because
+	 *       it is documented as for the DMA buffer mapped by dma_map_*
+	 *       API. The buffer we are syncing here is mapped through
+	 *       remap_pfn_range(). But so far this is our best choice
+	 *       and it works.
+	 */
+	if (dir == DRM_ZOCL_SYNC_BO_TO_DEVICE) {
+		dma_sync_single_for_device(dev->dev, bus_addr, size,
+		    DMA_TO_DEVICE);
+	} else if (dir == DRM_ZOCL_SYNC_BO_FROM_DEVICE) {
+		dma_sync_single_for_cpu(dev->dev, bus_addr, size,
+		    DMA_FROM_DEVICE);
+	} else
+		return -EINVAL;
+
+	return 0;
+}
+
+static inline bool
+zocl_sync_range_valid(struct drm_gem_object *gem_obj, uint64_t offset,
+		uint64_t size)
+{
+	return offset <= gem_obj->size && size <= gem_obj->size &&
+	    offset + size <= gem_obj->size;
+}
+
 int zocl_sync_bo_ioctl(struct drm_device *dev,
 		void *data,
 		struct drm_file *filp)
 {
 	const struct drm_zocl_sync_bo	*args = data;
 	struct drm_gem_object		*gem_obj;
-	struct drm_gem_cma_object	*cma_obj;
 	struct drm_zocl_bo		*bo;
-	dma_addr_t			bus_addr;
 	int				rc = 0;
 
 	gem_obj = zocl_gem_object_lookup(dev, filp, args->handle);
@@ -506,8 +571,7 @@ int zocl_sync_bo_ioctl(struct drm_device *dev,
 		return -EINVAL;
 	}
 
-	if ((args->offset > gem_obj->size) || (args->size > gem_obj->size) ||
-			((args->offset + args->size) > gem_obj->size)) {
+	if (!zocl_sync_range_valid(gem_obj, args->offset, args->size)) {
 		rc = -EINVAL;
 		goto out;
 	}
@@ -519,28 +583,80 @@ int zocl_sync_bo_ioctl(struct drm_device *dev,
 		goto out;
 	}
 
-	cma_obj = to_drm_gem_cma_obj(gem_obj);
-	bus_addr = cma_obj->paddr;
+	rc = zocl_sync_bo_range(dev, gem_obj, args->dir, args->offset,
+	    args->size);
 
-	/* only invalidate the range of addresses requested by the user */
-	bus_addr += args->offset;
+out:
+	ZOCL_DRM_GEM_OBJECT_PUT_UNLOCKED(gem_obj);
 
-	/**
-	 * NOTE: We a little bit abuse the dma_sync_single_* API here because
-	 *       it is documented as for the DMA buffer mapped by dma_map_*
-	 *       API. The buffer we are syncing here is mapped through
-	 *       remap_pfn_range(). But so far this is our best choice
-	 *       and it works.
-	 */
-	if (args->dir == DRM_ZOCL_SYNC_BO_TO_DEVICE) {
-		dma_sync_single_for_device(dev->dev, bus_addr, args->size,
-		    DMA_TO_DEVICE);
-	} else if (args->dir == DRM_ZOCL_SYNC_BO_FROM_DEVICE) {
-		dma_sync_single_for_cpu(dev->dev, bus_addr, args->size,
-		    DMA_FROM_DEVICE);
-	} else
-		rc = -EINVAL;
+	return rc;
+}
 
+int zocl_sync_bo_vec_ioctl(struct drm_device *dev,
+		void *data,
+		struct drm_file *filp)
+{
+	const struct drm_zocl_sync_bo_vec	*args = data;
+	struct drm_zocl_sync_range __user	*uranges;
+	struct drm_zocl_sync_range		*ranges;
+	struct drm_gem_object			*gem_obj;
+	struct drm_zocl_bo			*bo;
+	uint32_t				i;
+	int					rc = 0;
+
+	if (args->pad || args->count > DRM_ZOCL_SYNC_MAX_RANGES)
+		return -EINVAL;
+
+	if (args->dir != DRM_ZOCL_SYNC_BO_TO_DEVICE &&
+	    args->dir != DRM_ZOCL_SYNC_BO_FROM_DEVICE)
+		return -EINVAL;
+
+	if (!args->count)
+		return 0;
+
+	gem_obj = zocl_gem_object_lookup(dev, filp, args->handle);
+	if (!gem_obj) {
+		DRM_ERROR("Failed to look up GEM BO %d\n", args->handle);
+		return -EINVAL;
+	}
+
+	bo = to_zocl_bo(gem_obj);
+	if (bo->flags & ZOCL_BO_FLAGS_COHERENT)
+		/* The CMA buf is coherent, we don't need to do anything */
+		goto out;
+
+	ranges = kvmalloc_array(args->count, sizeof(*ranges), GFP_KERNEL);
+	if (!ranges) {
+		rc = -ENOMEM;
+		goto out;
+	}
+
+	uranges = to_user_ptr(args->ranges);
+	if (copy_from_user(ranges, uranges, args->count * sizeof(*ranges))) {
+		rc = -EFAULT;
+		goto out_free;
+	}
+
+	/* Validate everything first, a bad range must not sync half */
+	for (i = 0; i < args->count; i++) {
+		if (!zocl_sync_range_valid(gem_obj, ranges[i].offset,
+		    ranges[i].size)) {
+			rc = -EINVAL;
+			goto out_free;
+		}
+	}
+
+	for (i = 0; i < args->count; i++) {
+		if (!ranges[i].size)
+			continue;
+		rc = zocl_sync_bo_range(dev, gem_obj, args->dir,
+		    ranges[i].offset, ranges[i].size);
+		if (rc)
+			break;
+	}
+
+out_free:
+	kvfree(ranges);
 out:
 	ZOCL_DRM_GEM_OBJECT_PUT_UNLOCKED(gem_obj);
 
@@ -238,8 +238,10 @@ void zocl_free_bo(struct drm_gem_object *obj)
 			    zocl_obj->bank);
 		}
 	}
-	if (zocl_obj->sgt)
+	if (zocl_obj->sgt) {
 		sg_free_table(zocl_obj->sgt);
+		kfree(zocl_obj->sgt);
+	}
 	zocl_obj->sgt = NULL;
 	zocl_obj->pages = NULL;
 	kfree(zocl_obj);
@@ -442,6 +444,8 @@ static int zocl_client_open(struct drm_device *dev, struct drm_file *filp)
 	filp->driver_priv = fpriv;
 	mutex_init(&fpriv->lock);
 	atomic_set(&fpriv->trigger, 0);
+	init_llist_head(&fpriv->submit);
+	atomic_set(&fpriv->queued, 0);
 	zocl_track_ctx(dev, fpriv);
 	DRM_INFO("Pid %d opened device\n", pid_nr(task_tgid(current)));
 	return 0;
@@ -523,6 +527,8 @@ static const struct drm_ioctl_desc zocl_ioctls[] = {
 #endif
 	DRM_IOCTL_DEF_DRV(ZOCL_INFO_CU, zocl_info_cu_ioctl,
 			DRM_AUTH|DRM_UNLOCKED|DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(ZOCL_SYNC_BO_VEC, zocl_sync_bo_vec_ioctl,
+			DRM_AUTH|DRM_UNLOCKED|DRM_RENDER_ALLOW),
 };
 
 static const struct file_operations zocl_driver_fops = {
@@ -658,14 +664,16 @@ static int zocl_drm_platform_probe(struct platform_device *pdev)
 		if (ret) {
 			DRM_INFO("IOMMU attach device failed. ret(%d)\n", ret);
 			iommu_domain_free(zdev->domain);
-		}
-
-		geometry = &zdev->domain->geometry;
-		start = geometry->aperture_start;
-		end = geometry->aperture_end;
+			/* Fall back to CMA backed BOs */
+			zdev->domain = NULL;
+		} else {
+			geometry = &zdev->domain->geometry;
+			start = geometry->aperture_start;
+			end = geometry->aperture_end;
 
-		DRM_INFO("IOMMU aperture initialized (%#llx-%#llx)\n",
-				start, end);
+			DRM_INFO("IOMMU aperture initialized (%#llx-%#llx)\n",
+					start, end);
+		}
 	}
 
 	platform_set_drvdata(pdev, zdev);
@@ -680,7 +688,7 @@ static int zocl_drm_platform_probe(struct platform_device *pdev)
 		goto err0;
 
 	/* During attach, we don't request dma channel */
-	zdev->zdev_dma_chan = NULL;
+	zdev->num_dma_chan = 0;
 
 	/* doen with zdev initialization */
 	drm->dev_private = zdev;
@@ -711,17 +719,19 @@ static int zocl_drm_platform_remove(struct platform_device *pdev)
 {
 	struct drm_zocl_dev *zdev = platform_get_drvdata(pdev);
 	struct drm_device *drm = zdev->ddev;
+	int i;
 
 	if (zdev->domain) {
 		iommu_detach_device(zdev->domain, drm->dev);
 		iommu_domain_free(zdev->domain);
 	}
 
-	/* If dma channel has been requested, make sure it is released */
-	if (zdev->zdev_dma_chan) {
-		dma_release_channel(zdev->zdev_dma_chan);
-		zdev->zdev_dma_chan = NULL;
+	/* If dma channels have been requested, make sure they are released */
+	for (i = 0; i < zdev->num_dma_chan; i++) {
+		dma_release_channel(zdev->zdev_dma_chan[i]);
+		zdev->zdev_dma_chan[i] = NULL;
 	}
+	zdev->num_dma_chan = 0;
 
 #if defined(XCLBIN_DOWNLOAD)
 	fpga_mgr_put(zdev->fpga_mgr);
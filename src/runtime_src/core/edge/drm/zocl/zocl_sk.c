@@ -18,6 +18,7 @@
  * GNU General Public License for more details.
  */
 
+#include <linux/eventfd.h>
 #include "ert.h"
 #include "zocl_drv.h"
 #include "zocl_sk.h"
@@ -79,14 +80,44 @@ zocl_sk_create_ioctl(struct drm_device *dev, void *data, struct drm_file *filp)
 	struct drm_zocl_sk_create *args = data; 
 	struct drm_gem_object *gem_obj;
 	struct drm_zocl_bo *bo;
+	struct zocl_sk_ring *ring = NULL;
+	struct eventfd_ctx *efd = NULL;
 	uint32_t cu_idx = args->cu_idx;
 
+	if (args->ring_handle) {
+		gem_obj = zocl_gem_object_lookup(dev, filp, args->ring_handle);
+		if (!gem_obj) {
+			DRM_ERROR("Fail to create soft kernel: ring BO %d "
+			    "does not exist.\n", args->ring_handle);
+			return -ENXIO;
+		}
+		if (gem_obj->size < sizeof (struct zocl_sk_ring)) {
+			DRM_ERROR("Fail to create soft kernel: ring BO %d "
+			    "too small.\n", args->ring_handle);
+			ZOCL_DRM_GEM_OBJECT_PUT_UNLOCKED(gem_obj);
+			return -EINVAL;
+		}
+		ring = to_zocl_bo(gem_obj)->cma_base.vaddr;
+		ZOCL_DRM_GEM_OBJECT_PUT_UNLOCKED(gem_obj);
+
+		efd = eventfd_ctx_fdget(args->efd);
+		if (IS_ERR(efd)) {
+			DRM_ERROR("Fail to create soft kernel: bad eventfd.\n");
+			return PTR_ERR(efd);
+		}
+		WRITE_ONCE(ring->head, 0);
+		WRITE_ONCE(ring->tail, 0);
+		WRITE_ONCE(ring->waiting, 0);
+	}
+
 	mutex_lock(&sk->sk_lock);
 
 	if (sk->sk_cu[cu_idx]) {
 		DRM_ERROR("Fail to create soft kernel: CU %d created.\n",
 		    cu_idx);
 		mutex_unlock(&sk->sk_lock);
+		if (efd)
+			eventfd_ctx_put(efd);
 		return -EINVAL;
 	}
 
@@ -94,10 +125,16 @@ zocl_sk_create_ioctl(struct drm_device *dev, void *data, struct drm_file *filp)
 	if (!sk->sk_cu[cu_idx]) {
 		DRM_ERROR("Fail to create soft kernel: no memory.\n");
 		mutex_unlock(&sk->sk_lock);
+		if (efd)
+			eventfd_ctx_put(efd);
 		return -ENOMEM;
 	
 	}
 
+	/* Set ring before the CU can be picked by the scheduler */
+	sk->sk_cu[cu_idx]->sc_ring = ring;
+	sk->sk_cu[cu_idx]->sc_efd = efd;
+
 	mutex_unlock(&sk->sk_lock);
 
 	gem_obj = zocl_gem_object_lookup(dev, filp, args->handle);
@@ -160,6 +197,8 @@ zocl_sk_report_ioctl(struct drm_device *dev, void *data,
 			 * If we are interrupted or explictly
 			 * told to exit.
 			 */
+			if (scu->sc_efd)
+				eventfd_ctx_put(scu->sc_efd);
 			kfree(sk->sk_cu[args->cu_idx]);
 			sk->sk_cu[args->cu_idx] = NULL;
 
@@ -185,6 +224,58 @@ zocl_sk_report_ioctl(struct drm_device *dev, void *data,
 	return 0;
 }
 
+/**
+ * zocl_sk_ring_post() - Post a command on the ring of a soft CU
+ *
+ * @scu: soft CU with a ring
+ * @regmap: register map of the command, word 0 is not copied
+ * @size: number of words in @regmap
+ * @exit: tell the daemon to leave its command loop
+ *
+ * Caller holds sk_lock.
+ *
+ * Return: 0 on success, -EBUSY if the ring is full
+ */
+int
+zocl_sk_ring_post(struct soft_cu *scu, u32 *regmap, u32 size, bool exit)
+{
+	struct zocl_sk_ring *ring = scu->sc_ring;
+	struct zocl_sk_ring_slot *slot;
+	u32 head = ring->head;
+	u32 i;
+
+	if (head - READ_ONCE(ring->tail) >= ZOCL_SK_RING_SLOTS)
+		return -EBUSY;
+
+	if (size > ZOCL_SK_RING_REGMAP_WORDS)
+		return -EINVAL;
+
+	slot = &ring->slots[head % ZOCL_SK_RING_SLOTS];
+	slot->exit = exit;
+	slot->regmap_size = size;
+	for (i = 1; i < size; ++i)
+		slot->regmap[i] = regmap[i];
+
+	/* Publish the slot, then ring the doorbell if daemon sleeps */
+	smp_store_release(&ring->head, head + 1);
+	smp_mb();
+	if (READ_ONCE(ring->waiting))
+		eventfd_signal(scu->sc_efd, 1);
+
+	return 0;
+}
+
+/**
+ * zocl_sk_ring_idle() - Check if all posted commands have completed
+ */
+bool
+zocl_sk_ring_idle(struct soft_cu *scu)
+{
+	struct zocl_sk_ring *ring = scu->sc_ring;
+
+	return smp_load_acquire(&ring->tail) == ring->head;
+}
+
 int
 zocl_init_soft_kernel(struct drm_device *drm)
 {
@@ -36,6 +36,15 @@ struct soft_cu {
 	struct semaphore	sc_sem;
 
 	uint32_t		sc_flags;
+
+	/*
+	 * Optional command ring shared with the soft kernel
+	 * daemon.  When set, commands are posted on the ring
+	 * and sc_efd is the doorbell, sc_sem is only used to
+	 * release the CU.
+	 */
+	struct zocl_sk_ring	*sc_ring;
+	struct eventfd_ctx	*sc_efd;
 };
 
 struct soft_kernel {
@@ -58,5 +67,7 @@ struct soft_kernel_cmd {
 };
 
 int zocl_init_soft_kernel(struct drm_device *drm);
+int zocl_sk_ring_post(struct soft_cu *scu, u32 *regmap, u32 size, bool exit);
+bool zocl_sk_ring_idle(struct soft_cu *scu);
 
 #endif
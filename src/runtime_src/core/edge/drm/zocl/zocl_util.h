@@ -29,6 +29,7 @@
 #define _64KB	0x10000
 
 #define MAX_CU_NUM 128
+#define ZOCL_MAX_DMA_CHANS 8
 #define CU_SIZE _64KB
 
 #define CLEAR(x) \
@@ -114,7 +115,14 @@ struct drm_zocl_dev {
 	rwlock_t		attr_rwlock;
 
 	struct soft_kernel	*soft_kernel;
-	struct dma_chan 	*zdev_dma_chan;
+
+	/*
+	 * DMA channels for copy BO commands, requested on first use and
+	 * handed out round robin so that independent copies overlap.
+	 */
+	struct dma_chan 	*zdev_dma_chan[ZOCL_MAX_DMA_CHANS];
+	int			 num_dma_chan;
+	unsigned int		 dma_chan_next;
 };
 
 #endif
@@ -45,6 +45,30 @@ enum xrt_scu_state {
     XRT_SCU_STATE_DONE,
 };
 
+struct xclBOSyncRange {
+    size_t offset;
+    size_t size;
+};
+
+/**
+ * xclSyncBORanges() - Synchronize several ranges of a buffer in one call
+ *
+ * @handle:        Device handle
+ * @boHandle:      Buffer Object handle
+ * @dir:           To device or from device
+ * @ranges:        Array of ranges to synchronize
+ * @count:         Number of entries in @ranges
+ * Return:         0 on success or appropriate error number
+ *
+ * Equivalent to calling xclSyncBO() on each range, but with a single
+ * trip into the driver. Meant for cacheable BOs where only a few
+ * disjoint lines of a large buffer were touched by the CPU.
+ */
+XCL_DRIVER_DLLESPEC int xclSyncBORanges(xclDeviceHandle handle, unsigned int boHandle,
+                                        xclBOSyncDirection dir,
+                                        const struct xclBOSyncRange *ranges,
+                                        unsigned int count);
+
 /**
  * xclGetHostBO() - Get Host allocated BO
  *
@@ -77,6 +101,22 @@ XCL_DRIVER_DLLESPEC int xclSKGetCmd(xclDeviceHandle handle, xclSKCmd *cmd);
  */
 XCL_DRIVER_DLLESPEC int xclSKCreate(xclDeviceHandle handle, unsigned int boHandle, uint32_t cu_idx);
 
+/**
+ * xclSKCreateRing() - Create a soft kernel compute unit dispatched by ring
+ *
+ * @handle:        Device handle
+ * @boHandle:      Bo handle for the CU's reg file
+ * @ringHandle:    Bo handle for the CU's command ring (struct zocl_sk_ring)
+ * @efd:           eventfd signaled when a command is posted on the ring
+ * @cu_idx:        CU index
+ * Return:         0 on success or appropriate error number
+ *
+ * Commands are read from the ring, completion is reported by advancing
+ * the ring tail instead of calling xclSKReport().
+ */
+XCL_DRIVER_DLLESPEC int xclSKCreateRing(xclDeviceHandle handle, unsigned int boHandle,
+                                        unsigned int ringHandle, int efd, uint32_t cu_idx);
+
 /**
  * xclSKReport() - Report a soft kernel compute unit state change
  *
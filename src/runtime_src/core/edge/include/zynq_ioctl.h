@@ -45,6 +45,7 @@ enum {
 	DRM_ZOCL_SK_CREATE,
 	DRM_ZOCL_SK_REPORT,
 	DRM_ZOCL_INFO_CU,
+	DRM_ZOCL_SYNC_BO_VEC,
 	DRM_ZOCL_NUM_IOCTLS
 };
 
@@ -93,6 +94,38 @@ struct drm_zocl_sync_bo {
 	uint64_t size;
 };
 
+/**
+ * struct drm_zocl_sync_range - one range of a SYNC_BO_VEC request
+ * @offset:	Offset into the object
+ * @size:	Length of the range
+ */
+struct drm_zocl_sync_range {
+	uint64_t offset;
+	uint64_t size;
+};
+
+/**
+ * struct drm_zocl_sync_bo_vec - used for SYNC_BO_VEC IOCTL
+ * @handle:	GEM object handle
+ * @dir:	DRM_ZOCL_SYNC_DIR_XXX
+ * @count:	Number of entries in @ranges, at most DRM_ZOCL_SYNC_MAX_RANGES
+ * @pad:	Must be 0
+ * @ranges:	User pointer to array of struct drm_zocl_sync_range
+ *
+ * Same as SYNC_BO applied to each range in turn, for strided accesses
+ * touching a few lines of a large BO. Nothing is synced if any range
+ * is outside of the BO.
+ */
+#define DRM_ZOCL_SYNC_MAX_RANGES	4096
+
+struct drm_zocl_sync_bo_vec {
+	uint32_t handle;
+	enum drm_zocl_sync_bo_dir dir;
+	uint32_t count;
+	uint32_t pad;
+	uint64_t ranges;
+};
+
 /**
  * struct drm_zocl_info_bo - used for INFO_BO IOCTL
  * @handle:	GEM object handle
@@ -216,9 +249,49 @@ struct drm_zocl_sk_getcmd {
 	char		name[ZOCL_MAX_NAME_LENGTH];
 };
 
+/**
+ * struct drm_zocl_sk_create - create a soft kernel CU
+ * used with DRM_IOCTL_ZOCL_SK_CREATE ioctl
+ *
+ * @cu_idx:	CU index
+ * @handle:	BO handle of the CU reg file
+ * @ring_handle: optional BO handle of a struct zocl_sk_ring, 0 for none
+ * @efd:	eventfd signaled when a command is posted on the ring
+ *
+ * With a ring the CU is dispatched through shared memory and the
+ * daemon does not call DRM_IOCTL_ZOCL_SK_REPORT per command.
+ */
 struct drm_zocl_sk_create {
 	uint32_t	cu_idx;
 	uint32_t	handle;
+	uint32_t	ring_handle;
+	int32_t		efd;
+};
+
+/*
+ * Soft kernel command ring shared by zocl and the soft kernel daemon.
+ *
+ * zocl fills slot (head % ZOCL_SK_RING_SLOTS) and advances head, the
+ * daemon advances tail when the command in slot (tail % ZOCL_SK_RING_SLOTS)
+ * has completed.  The daemon sets waiting before it sleeps on the eventfd,
+ * zocl only signals the eventfd when waiting is set.
+ */
+#define	ZOCL_SK_RING_SLOTS		4
+#define	ZOCL_SK_RING_REGMAP_WORDS	1024
+
+struct zocl_sk_ring_slot {
+	uint32_t	exit;
+	uint32_t	regmap_size;
+	uint32_t	regmap[ZOCL_SK_RING_REGMAP_WORDS];
+};
+
+struct zocl_sk_ring {
+	uint32_t	head;
+	uint32_t	pad0[15];
+	uint32_t	tail;
+	uint32_t	waiting;
+	uint32_t	pad1[14];
+	struct zocl_sk_ring_slot slots[ZOCL_SK_RING_SLOTS];
 };
 
 enum drm_zocl_scu_state {
@@ -264,4 +337,6 @@ struct drm_zocl_sk_report {
                                        DRM_ZOCL_SK_REPORT, struct drm_zocl_sk_report)
 #define DRM_IOCTL_ZOCL_INFO_CU         DRM_IOWR(DRM_COMMAND_BASE + \
                                        DRM_ZOCL_INFO_CU, struct drm_zocl_info_cu)
+#define DRM_IOCTL_ZOCL_SYNC_BO_VEC     DRM_IOWR(DRM_COMMAND_BASE + \
+                                       DRM_ZOCL_SYNC_BO_VEC, struct drm_zocl_sync_bo_vec)
 #endif
@@ -21,10 +21,15 @@
 #include <sys/wait.h>
 #include <sys/mman.h>
 #include <sys/prctl.h>
+#include <sys/eventfd.h>
 
 #include "sk_types.h"
 #include "sk_daemon.h"
 #include "xclhal2_mpsoc.h"
+#include "zynq_ioctl.h"
+
+/* Polls of the command ring before sleeping on the eventfd doorbell */
+#define SK_RING_SPIN	10000
 
 xclDeviceHandle devHdl;
 
@@ -54,7 +59,8 @@ void freeBO(unsigned int boHandle)
  * unit. Before create soft kernel CU, we allocate a BO to hold the
  * reg file for that CU.
  */
-static int createSoftKernel(unsigned int *boh, uint32_t cu_idx)
+static int createSoftKernel(unsigned int *boh, uint32_t cu_idx,
+                            unsigned int ringBoh, int efd)
 {
   int ret;
 
@@ -64,11 +70,53 @@ static int createSoftKernel(unsigned int *boh, uint32_t cu_idx)
     return -1;
   }
 
-  ret = xclSKCreate(devHdl, *boh, cu_idx);
+  if (ringBoh)
+    ret = xclSKCreateRing(devHdl, *boh, ringBoh, efd, cu_idx);
+  else
+    ret = xclSKCreate(devHdl, *boh, cu_idx);
 
   return ret;
 }
 
+/*
+ * Allocate and map the command ring of a soft kernel CU, and the
+ * eventfd zocl signals when it posts a command on a sleeping ring.
+ */
+static struct zocl_sk_ring *createRing(unsigned int *ringBoh, int *efd)
+{
+  struct zocl_sk_ring *ring;
+
+  *ringBoh = xclAllocBO(devHdl, sizeof(struct zocl_sk_ring), 0, 0);
+  if (*ringBoh == 0xFFFFFFFF) {
+    syslog(LOG_ERR, "Cannot alloc bo for soft kernel ring.\n");
+    return NULL;
+  }
+
+  ring = (struct zocl_sk_ring *)xclMapBO(devHdl, *ringBoh, true);
+  if (ring == MAP_FAILED) {
+    syslog(LOG_ERR, "Cannot map soft kernel ring.\n");
+    xclFreeBO(devHdl, *ringBoh);
+    return NULL;
+  }
+
+  *efd = eventfd(0, 0);
+  if (*efd < 0) {
+    syslog(LOG_ERR, "Cannot create soft kernel eventfd.\n");
+    munmap(ring, sizeof(struct zocl_sk_ring));
+    xclFreeBO(devHdl, *ringBoh);
+    return NULL;
+  }
+
+  return ring;
+}
+
+static void destroyRing(struct zocl_sk_ring *ring, unsigned int ringBoh, int efd)
+{
+  munmap(ring, sizeof(struct zocl_sk_ring));
+  xclFreeBO(devHdl, ringBoh);
+  close(efd);
+}
+
 /* This function release the resources allocated for soft kernel. */
 static int destroySoftKernel(unsigned int boh, void *mapAddr)
 {
@@ -103,6 +151,56 @@ void *getKernelArg(unsigned int boHdl, uint32_t cu_idx)
   return xclMapBO(devHdl, boHdl, false);
 }
 
+/*
+ * Wait for zocl to post the next command on the ring.  Back to back
+ * dispatches are the common case, so spin on the ring head for a while
+ * before sleeping on the eventfd doorbell.
+ */
+static struct zocl_sk_ring_slot *waitRingCmd(struct zocl_sk_ring *ring, int efd)
+{
+  uint32_t tail = ring->tail;
+  uint64_t cnt;
+  int i;
+
+  for (i = 0; i < SK_RING_SPIN; i++)
+    if (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) != tail)
+      return &ring->slots[tail % ZOCL_SK_RING_SLOTS];
+
+  __atomic_store_n(&ring->waiting, 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  while (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == tail) {
+    if (read(efd, &cnt, sizeof(cnt)) < 0 && errno != EINTR) {
+      __atomic_store_n(&ring->waiting, 0, __ATOMIC_RELAXED);
+      return NULL;
+    }
+  }
+  __atomic_store_n(&ring->waiting, 0, __ATOMIC_RELAXED);
+
+  return &ring->slots[tail % ZOCL_SK_RING_SLOTS];
+}
+
+/*
+ * Command loop of a soft kernel CU dispatched through its ring.  The
+ * command is completed by advancing the ring tail, zocl polls for it.
+ */
+static void ringLoop(char *name, kernel_t kernel, struct sk_operations *ops,
+                     struct zocl_sk_ring *ring, int efd)
+{
+  struct zocl_sk_ring_slot *slot;
+
+  while (1) {
+    slot = waitRingCmd(ring, efd);
+    if (!slot || slot->exit) {
+      syslog(LOG_INFO, "Exit soft kernel %s\n", name);
+      break;
+    }
+
+    kernel(&slot->regmap[1], ops);
+
+    __atomic_store_n(&ring->tail, ring->tail + 1, __ATOMIC_RELEASE);
+  }
+}
+
 xclDeviceHandle initXRTHandle(unsigned deviceIndex)
 {
   if (deviceIndex >= xclProbe()) {
@@ -126,13 +224,19 @@ static void softKernelLoop(char *name, char *path, uint32_t cu_idx)
   struct sk_operations ops;
   unsigned *args_from_host;
   unsigned int boh;
+  struct zocl_sk_ring *ring;
+  unsigned int ringBoh;
+  int efd;
   int ret;
 
   devHdl = initXRTHandle(0);
 
-  ret = createSoftKernel(&boh, cu_idx);
+  ring = createRing(&ringBoh, &efd);
+  ret = createSoftKernel(&boh, cu_idx, ring ? ringBoh : 0, ring ? efd : -1);
   if (ret) {
     syslog(LOG_ERR, "Cannot create soft kernel.");
+    if (ring)
+      destroyRing(ring, ringBoh, efd);
     return;
   }
 
@@ -164,25 +268,33 @@ static void softKernelLoop(char *name, char *path, uint32_t cu_idx)
       return;
   }
 
-  while (1) {
-    ret = waitNextCmd(cu_idx);
-
-    if (ret) {
-      /* We are told to exit the soft kernel loop */
-      syslog(LOG_INFO, "Exit soft kernel %s\n", name);
-      break;
-    }
+  if (ring) {
+    ringLoop(name, kernel, &ops, ring, efd);
+    /* zocl flagged the CU for release, this returns right away */
+    (void) waitNextCmd(cu_idx);
+  } else {
+    while (1) {
+      ret = waitNextCmd(cu_idx);
+
+      if (ret) {
+        /* We are told to exit the soft kernel loop */
+        syslog(LOG_INFO, "Exit soft kernel %s\n", name);
+        break;
+      }
 
-    /* Reg file indicates the kernel should not be running. */
-    if (args_from_host[0] != 0x1)
-      continue;
+      /* Reg file indicates the kernel should not be running. */
+      if (args_from_host[0] != 0x1)
+        continue;
 
-    /* Start run the soft kernel. */
-    kernel(&args_from_host[1], &ops);
+      /* Start run the soft kernel. */
+      kernel(&args_from_host[1], &ops);
+    }
   }
 
   dlclose(sk_handle);
   (void) destroySoftKernel(boh, args_from_host);
+  if (ring)
+    destroyRing(ring, ringBoh, efd);
 }
 
 static inline void getSoftKernelPathName(uint32_t cu_idx, char *path)
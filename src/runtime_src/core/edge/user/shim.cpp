@@ -379,6 +379,29 @@ int ZYNQShim::xclSyncBO(unsigned int boHandle, xclBOSyncDirection dir, size_t si
   return ioctl(mKernelFD, DRM_IOCTL_ZOCL_SYNC_BO, &syncInfo);
 }
 
+int ZYNQShim::xclSyncBORanges(unsigned int boHandle, xclBOSyncDirection dir,
+                              const xclBOSyncRange *ranges, unsigned int count)
+{
+  drm_zocl_sync_bo_dir zocl_dir;
+  if (dir == XCL_BO_SYNC_BO_TO_DEVICE)
+      zocl_dir = DRM_ZOCL_SYNC_BO_TO_DEVICE;
+  else if (dir == XCL_BO_SYNC_BO_FROM_DEVICE)
+      zocl_dir = DRM_ZOCL_SYNC_BO_FROM_DEVICE;
+  else
+      return -EINVAL;
+  if (count > DRM_ZOCL_SYNC_MAX_RANGES)
+      return -EINVAL;
+
+  std::vector<drm_zocl_sync_range> zranges(count);
+  for (unsigned int i = 0; i < count; i++) {
+      zranges[i].offset = ranges[i].offset;
+      zranges[i].size = ranges[i].size;
+  }
+  drm_zocl_sync_bo_vec syncInfo = { boHandle, zocl_dir, count, 0,
+                                    reinterpret_cast<uint64_t>(zranges.data()) };
+  return ioctl(mKernelFD, DRM_IOCTL_ZOCL_SYNC_BO_VEC, &syncInfo);
+}
+
 int ZYNQShim::xclCopyBO(unsigned int dst_boHandle, unsigned int src_boHandle, size_t size,
                         size_t dst_offset, size_t src_offset)
 {
@@ -507,6 +530,7 @@ unsigned int ZYNQShim::xclGetBOProperties(unsigned int boHandle, xclBOProperties
   properties->flags  = DRM_ZOCL_BO_FLAGS_COHERENT | DRM_ZOCL_BO_FLAGS_CMA;
   properties->size   = info.size;
   properties->paddr  = info.paddr;
+  properties->numa_node = -1;
   return result;
 }
 
@@ -551,6 +575,19 @@ int ZYNQShim::xclExecWait(int timeoutMilliSec)
   std::vector<pollfd> uifdVector;
   pollfd info = {mKernelFD, POLLIN, 0};
   uifdVector.push_back(info);
+
+  // Optionally spin on non-blocking polls before sleeping, so that a
+  // completion posted by the scheduler is seen without a wakeup.
+  static const auto spin = std::chrono::microseconds(xrt_core::config::get_exec_wait_spin_us());
+  if (spin.count() > 0 && timeoutMilliSec != 0) {
+    auto end = std::chrono::steady_clock::now() + spin;
+    do {
+      int ret = poll(&uifdVector[0], uifdVector.size(), 0);
+      if (ret != 0)
+        return ret;
+    } while (std::chrono::steady_clock::now() < end);
+  }
+
   return poll(&uifdVector[0], uifdVector.size(), timeoutMilliSec);
 }
 
@@ -595,9 +632,14 @@ int ZYNQShim::xclSKGetCmd(xclSKCmd *cmd)
 }
 
 int ZYNQShim::xclSKCreate(unsigned int boHandle, uint32_t cu_idx)
+{
+  return xclSKCreateRing(boHandle, 0, -1, cu_idx);
+}
+
+int ZYNQShim::xclSKCreateRing(unsigned int boHandle, unsigned int ringHandle, int efd, uint32_t cu_idx)
 {
   int ret;
-  drm_zocl_sk_create scmd = {cu_idx, boHandle};
+  drm_zocl_sk_create scmd = {cu_idx, boHandle, ringHandle, efd};
 
   ret = ioctl(mKernelFD, DRM_IOCTL_ZOCL_SK_CREATE, &scmd);
 
@@ -892,6 +934,25 @@ int xclSKCreate(xclDeviceHandle handle, unsigned int boHandle, uint32_t cu_idx)
   return drv->xclSKCreate(boHandle, cu_idx);
 }
 
+int xclSyncBORanges(xclDeviceHandle handle, unsigned int boHandle,
+                    xclBOSyncDirection dir, const xclBOSyncRange *ranges,
+                    unsigned int count)
+{
+  ZYNQ::ZYNQShim *drv = ZYNQ::ZYNQShim::handleCheck(handle);
+  if (!drv)
+    return -EINVAL;
+  return drv->xclSyncBORanges(boHandle, dir, ranges, count);
+}
+
+int xclSKCreateRing(xclDeviceHandle handle, unsigned int boHandle,
+                    unsigned int ringHandle, int efd, uint32_t cu_idx)
+{
+  ZYNQ::ZYNQShim *drv = ZYNQ::ZYNQShim::handleCheck(handle);
+  if (!drv)
+    return -EINVAL;
+  return drv->xclSKCreateRing(boHandle, ringHandle, efd, cu_idx);
+}
+
 int xclSKReport(xclDeviceHandle handle, uint32_t cu_idx, xrt_scu_state state)
 {
   ZYNQ::ZYNQShim *drv = ZYNQ::ZYNQShim::handleCheck(handle);
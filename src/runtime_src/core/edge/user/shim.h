@@ -73,6 +73,7 @@ public:
   int xclExecWait(int timeoutMilliSec);
   int xclSKGetCmd(xclSKCmd *cmd);
   int xclSKCreate(unsigned int boHandle, uint32_t cu_idx);
+  int xclSKCreateRing(unsigned int boHandle, unsigned int ringHandle, int efd, uint32_t cu_idx);
   int xclSKReport(uint32_t cu_idx, xrt_scu_state state);
 
   uint xclGetNumLiveProcesses();
@@ -86,6 +87,8 @@ public:
 
   int xclSyncBO(unsigned int boHandle, xclBOSyncDirection dir, size_t size,
                 size_t offset);
+  int xclSyncBORanges(unsigned int boHandle, xclBOSyncDirection dir,
+                      const xclBOSyncRange *ranges, unsigned int count);
   int xclCopyBO(unsigned int dst_boHandle, unsigned int src_boHandle, size_t size,
                 size_t dst_offset, size_t src_offset);
 
@@ -79,6 +79,9 @@ struct ert_packet {
  * struct ert_start_kernel_cmd: ERT start kernel command format
  *
  * @state:           [3-0] current state of a command
+ * @persistent:      [4] restart CU when done, see below
+ * @stat_enabled:    [5] record phase timestamps, see below
+ * @priority:        [6] high priority command, see below
  * @extra_cu_masks:  [11-10] extra CU masks in addition to mandatory mask
  * @count:           [22-12] number of words following header
  * @opcode:          [27-23] 0, opcode for start_kernel
@@ -90,12 +93,39 @@ struct ert_packet {
  * The packet payload is comprised of reserved id field, a mandatory CU mask,
  * and extra_cu_masks per header field, followed by a CU register map of size
  * (count - (1 + extra_cu_masks)) uint32_t words.
+ *
+ * A persistent start_kernel or exec_write command is restarted on its CU
+ * each time the CU completes, until the requested number of iterations is
+ * done or the host cancels the command.  The command completes once.  The
+ * first register map words, which alias CU control registers that are never
+ * written from the register map, are then used as
+ *  [ERT_PERSISTENT_ITERATIONS]: iterations to run, 0 runs until cancelled
+ *  [ERT_PERSISTENT_COMPLETED]:  completed iterations, updated by scheduler
+ *  [ERT_PERSISTENT_CANCEL]:     set by host to stop after current iteration
+ * Persistent commands are supported when KDS schedules CUs (penguin and
+ * ert polling mode).
+ *
+ * With stat_enabled, the kernel driver records the phase timestamps of a
+ * start_kernel or exec_write command in a struct ert_cmd_timestamps that
+ * follows the packet payload, see ert_start_kernel_timestamps().  The exec
+ * buffer must be large enough to hold it, otherwise no timestamps are
+ * recorded.
+ *
+ * A start_kernel or exec_write command with priority set is started on a
+ * free CU ahead of queued normal priority commands, by KDS and by ERT.
+ * Commands of the same priority are started in the usual order.
  */
+#define ERT_PERSISTENT_ITERATIONS 0
+#define ERT_PERSISTENT_COMPLETED  1
+#define ERT_PERSISTENT_CANCEL     2
 struct ert_start_kernel_cmd {
   union {
     struct {
       uint32_t state:4;          /* [3-0]   */
-      uint32_t unused:6;         /* [9-4]  */
+      uint32_t persistent:1;     /* [4]  */
+      uint32_t stat_enabled:1;   /* [5]  */
+      uint32_t priority:1;       /* [6]  */
+      uint32_t unused:3;         /* [9-7]  */
       uint32_t extra_cu_masks:2; /* [11-10]  */
       uint32_t count:11;         /* [22-12] */
       uint32_t opcode:5;         /* [27-23] */
@@ -109,6 +139,40 @@ struct ert_start_kernel_cmd {
   uint32_t data[1];          /* count-1 number of words */
 };
 
+/**
+ * struct ert_cmd_timestamps: phase timestamps of a command
+ *
+ * @submit:  command was submitted to kernel driver (exec buffer ioctl)
+ * @queued:  command was moved to the scheduler queue
+ * @start:   command was started on a CU, or submitted to ERT in ert mode
+ * @done:    scheduler observed completion of the command
+ * @notify:  command state was updated in the exec buffer for the host
+ *
+ * Timestamps are CLOCK_MONOTONIC nanoseconds, comparable with
+ * clock_gettime(CLOCK_MONOTONIC) in user space.  A persistent command
+ * records start and done of its last iteration.
+ */
+struct ert_cmd_timestamps {
+  uint64_t submit;
+  uint64_t queued;
+  uint64_t start;
+  uint64_t done;
+  uint64_t notify;
+};
+
+/**
+ * ert_start_kernel_timestamps() - Location of timestamps of a command
+ *
+ * The timestamps follow the packet payload (header + count words)
+ * at the next 8 byte boundary.
+ */
+static inline struct ert_cmd_timestamps*
+ert_start_kernel_timestamps(struct ert_start_kernel_cmd *pkt)
+{
+  return (struct ert_cmd_timestamps*)
+    ((char*)pkt + ((((1 + pkt->count) * sizeof(uint32_t)) + 7) & ~7));
+}
+
 /**
  * struct ert_init_kernel_cmd: ERT initialize kernel command format
  * this command initializes CUs by writing CU registers. CUs are
@@ -156,6 +220,52 @@ struct ert_init_kernel_cmd {
   uint32_t data[1];          /* count-9 number of words */
 };
 
+/**
+ * struct ert_start_dag_cmd: ERT start DAG of kernels command format
+ *
+ * @state:           [3-0] current state of a command
+ * @extra_cu_masks:  [11-10] extra CU masks in addition to mandatory mask
+ * @count:           [22-12] number of words following header
+ * @opcode:          [27-23] 12, opcode for start_dag
+ * @type:            [31-27] 3, ERT_CU
+ *
+ * @cu_mask:         first mandatory CU mask, union of CUs of all nodes
+ * @data:            extra CU masks followed by the DAG
+ *
+ * The CU masks are followed by the number of nodes in the DAG and then
+ * the nodes back to back.  Each node is a bitmask of the nodes it
+ * depends on followed by a complete ERT_START_CU or ERT_EXEC_WRITE
+ * packet (header, CU masks, register map), see struct ert_dag_node.
+ * Nodes without dependencies are used by XRT to pack independent
+ * start kernel commands into one command slot.  A node can depend
+ * only on nodes with lower index.  The scheduler starts each node as
+ * soon as its dependencies have completed and completes the command,
+ * and notifies the host, once when all nodes have completed.
+ */
+#define ERT_DAG_MAX_NODES 16
+struct ert_start_dag_cmd {
+  union {
+    struct {
+      uint32_t state:4;          /* [3-0]   */
+      uint32_t unused:6;         /* [9-4]  */
+      uint32_t extra_cu_masks:2; /* [11-10]  */
+      uint32_t count:11;         /* [22-12] */
+      uint32_t opcode:5;         /* [27-23] */
+      uint32_t type:4;           /* [31-27] */
+    };
+    uint32_t header;
+  };
+
+  /* payload */
+  uint32_t cu_mask;          /* mandatory cu mask */
+  uint32_t data[1];          /* extra cu masks, num_nodes, nodes */
+};
+
+struct ert_dag_node {
+  uint32_t deps;                     /* mask of nodes this node depends on */
+  struct ert_start_kernel_cmd cmd;   /* ERT_START_CU packet of the node */
+};
+
 #define KDMA_BLOCK_SIZE 64   /* Limited by KDMA CU */
 struct ert_start_copybo_cmd {
   uint32_t state:4;          /* [3-0], must be ERT_CMD_STATE_NEW */
@@ -195,7 +305,12 @@ struct ert_start_copybo_cmd {
  * @cu_isr:1         enable CUISR custom module for HW scheduler
  * @cq_int:1         enable interrupt from host to HW scheduler
  * @cdma:1           enable CDMA kernel
- * @unused:25
+ * @dataflow:1       enable dataflow mode
+ * @cu_policy:2      CU selection policy for commands with multiple CUs,
+ *                   enum ert_cu_policy
+ * @intr_coalesce:6  notify host after this many command completions or when
+ *                   scheduler has no more completions, 0 notifies per command
+ * @unused:16
  * @dsa52:1          reserved for internal use
  *
  * @data:            addresses of @num_cus CUs
@@ -226,7 +341,9 @@ struct ert_configure_cmd {
   uint32_t cq_int:1;
   uint32_t cdma:1;
   uint32_t dataflow:1;
-  uint32_t unusedf:24;
+  uint32_t cu_policy:2;
+  uint32_t intr_coalesce:6;
+  uint32_t unusedf:16;
   uint32_t dsa52:1;
 
   /* cu address map size is num_cus */
@@ -346,13 +463,16 @@ enum ert_cmd_state {
  * @ERT_START_CU:       start a workgroup on a CU
  * @ERT_START_KERNEL:   currently aliased to ERT_START_CU
  * @ERT_CONFIGURE:      configure command scheduler
- * @ERT_EXEC_WRITE:     execute a specified CU after writing
+ * @ERT_EXEC_WRITE:     execute a specified CU after writing {offset,value}
+ *                      pairs, offsets are relative to the CU
  * @ERT_CU_STAT:        get stats about CU execution
  * @ERT_START_COPYBO:   start KDMA CU or P2P, may be converted to ERT_START_CU
  *                      before cmd reach to scheduler, short-term hack
  * @ERT_SK_CONFIG:      configure soft kernel
  * @ERT_SK_START:       start a soft kernel
  * @ERT_SK_UNCONFIG:    unconfigure a soft kernel
+ * @ERT_INIT_CU:        initialize CU registers
+ * @ERT_START_DAG:      start a DAG of dependent CU commands
  */
 enum ert_cmd_opcode {
   ERT_START_CU      = 0,
@@ -367,6 +487,7 @@ enum ert_cmd_opcode {
   ERT_SK_START      = 9,
   ERT_SK_UNCONFIG   = 10,
   ERT_INIT_CU       = 11,
+  ERT_START_DAG     = 12,
 };
 
 /**
@@ -384,6 +505,19 @@ enum ert_cmd_type {
   ERT_CU = 3,
 };
 
+/**
+ * CU selection policy, used when a command can run on several CUs
+ *
+ * @ERT_CU_POLICY_FIRST:        lowest index ready CU (default)
+ * @ERT_CU_POLICY_ROUND_ROBIN:  ready CU after the most recently started CU
+ * @ERT_CU_POLICY_LEAST_USED:   ready CU with the lowest usage count
+ */
+enum ert_cu_policy {
+  ERT_CU_POLICY_FIRST = 0,
+  ERT_CU_POLICY_ROUND_ROBIN = 1,
+  ERT_CU_POLICY_LEAST_USED = 2,
+};
+
 /**
  * Address constants per spec
  */
@@ -44,23 +44,36 @@
 extern "C" {
 #endif
 
-    typedef void* xclDeviceHandle;
-    struct rte_mempool;
-    //struct rte_mbuf;
-    typedef unsigned short StreamHandle;
-    typedef struct rte_mempool * PacketObjectPool;
-    //typedef struct rte_mbuf * PacketObject;
-    typedef void* PacketObject;
-    struct xclDeviceInfo2;
-    //struct xclAddressSpace;
+/*
+ * Poll mode driver (DPDK) HAL.  Every function takes the ethdev port
+ * number, a StreamHandle is a receive or transmit queue id of the
+ * port, and a PacketObject is an opaque packet buffer (rte_mbuf)
+ * allocated from the port's hugepage backed packet pool.
+ */
+typedef unsigned short StreamHandle;
+typedef void* PacketObject;
+struct xclDeviceInfo2;
 
+#define PMD_INVALID_STREAM 0xFFFF
 
-    XCL_PMD_DRIVER_DLLESPEC StreamHandle pmdOpenStream(xclDeviceHandle handle, unsigned q, unsigned depth, unsigned dir); /* host2dev == 0, dev2host == 1 */
-    XCL_PMD_DRIVER_DLLESPEC void pmdCloseStream(xclDeviceHandle handle, StreamHandle strm);
-    XCL_PMD_DRIVER_DLLESPEC unsigned pmdSendPkts(xclDeviceHandle handle, StreamHandle strm, PacketObject *pkts, unsigned count);
-    XCL_PMD_DRIVER_DLLESPEC unsigned pmdRecvPkts(xclDeviceHandle handle, StreamHandle strm, PacketObject *pkts, unsigned count);
-    XCL_PMD_DRIVER_DLLESPEC PacketObject pmdAcquirePkts(xclDeviceHandle handle);
-    XCL_PMD_DRIVER_DLLESPEC void pmdReleasePkts(xclDeviceHandle handle, PacketObject pkt);
+/* Initialize EAL with argc/argv, return number of ports or 0xFFFFFFFF on error */
+XCL_PMD_DRIVER_DLLESPEC unsigned pmdProbe(int argc, char *argv[]);
+/* Configure port with rxq/txq queues of depth descriptors and start it, return 0 on success */
+XCL_PMD_DRIVER_DLLESPEC int pmdOpen(unsigned port, unsigned rxq, unsigned txq, unsigned depth);
+XCL_PMD_DRIVER_DLLESPEC void pmdClose(unsigned port);
+XCL_PMD_DRIVER_DLLESPEC unsigned pmdGetDeviceInfo(unsigned port, struct xclDeviceInfo2 *info);
+/* Claim a free queue, host2dev == 0, dev2host == 1, return PMD_INVALID_STREAM if none */
+XCL_PMD_DRIVER_DLLESPEC StreamHandle pmdOpenStream(unsigned port, unsigned dir);
+XCL_PMD_DRIVER_DLLESPEC void pmdCloseStream(unsigned port, StreamHandle strm, unsigned dir);
+XCL_PMD_DRIVER_DLLESPEC unsigned pmdSendPkts(unsigned port, StreamHandle strm, PacketObject *pkts, unsigned count);
+XCL_PMD_DRIVER_DLLESPEC unsigned pmdRecvPkts(unsigned port, StreamHandle strm, PacketObject *pkts, unsigned count);
+/* Allocate count packets, all or nothing, return 0 on success */
+XCL_PMD_DRIVER_DLLESPEC int pmdAcquirePkts(unsigned port, PacketObject *pkts, unsigned count);
+XCL_PMD_DRIVER_DLLESPEC void pmdReleasePkts(unsigned port, PacketObject *pkts, unsigned count);
+XCL_PMD_DRIVER_DLLESPEC void *pmdPktData(PacketObject pkt);
+XCL_PMD_DRIVER_DLLESPEC unsigned pmdPktLen(PacketObject pkt);
+XCL_PMD_DRIVER_DLLESPEC void pmdPktSetLen(PacketObject pkt, unsigned len);
+XCL_PMD_DRIVER_DLLESPEC unsigned pmdPktRoom(PacketObject pkt);
 
 #ifdef __cplusplus
 }
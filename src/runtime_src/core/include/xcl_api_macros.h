@@ -327,6 +327,54 @@ mtx.unlock();
     xclCopyBufferDevice2Host_RETURN();
 
 
+//-----------xclSetupSharedMemory-----------------
+#define xclSetupSharedMemory_SET_PROTOMESSAGE(name,size) \
+    c_msg.set_name(name); \
+    c_msg.set_size(size);
+
+#define xclSetupSharedMemory_SET_PROTO_RESPONSE() \
+    ack = r_msg.ack();
+
+#define xclSetupSharedMemory_RPC_CALL(func_name,name,size) \
+    RPC_PROLOGUE(func_name); \
+    xclSetupSharedMemory_SET_PROTOMESSAGE(name,size); \
+    SERIALIZE_AND_SEND_MSG(func_name)\
+    xclSetupSharedMemory_SET_PROTO_RESPONSE(); \
+    FREE_BUFFERS();
+
+//-----------xclCopyBufferHost2DeviceShm-----------------
+//Shared memory is filled under the RPC mutex so concurrent copies do not overlap
+#define xclCopyBufferHost2DeviceShm_SET_PROTOMESSAGE(dest,src,size,space) \
+    memcpy(mShmBuf,src,size); \
+    c_msg.set_dest(dest); \
+    c_msg.set_size(size); \
+    c_msg.set_space(space);
+
+#define xclCopyBufferHost2DeviceShm_SET_PROTO_RESPONSE()
+
+#define xclCopyBufferHost2DeviceShm_RPC_CALL(func_name,dest,src,size,space) \
+    RPC_PROLOGUE(func_name); \
+    xclCopyBufferHost2DeviceShm_SET_PROTOMESSAGE(dest,src,size,space); \
+    SERIALIZE_AND_SEND_MSG(func_name)\
+    xclCopyBufferHost2DeviceShm_SET_PROTO_RESPONSE(); \
+    FREE_BUFFERS();
+
+//-----------xclCopyBufferDevice2HostShm-----------------
+#define xclCopyBufferDevice2HostShm_SET_PROTOMESSAGE(src,size,space) \
+    c_msg.set_src(src); \
+    c_msg.set_size(size); \
+    c_msg.set_space(space);
+
+#define xclCopyBufferDevice2HostShm_SET_PROTO_RESPONSE(c_dest) \
+    memcpy(c_dest,mShmBuf,r_msg.size());
+
+#define xclCopyBufferDevice2HostShm_RPC_CALL(func_name,dest,src,size,space) \
+    RPC_PROLOGUE(func_name); \
+    xclCopyBufferDevice2HostShm_SET_PROTOMESSAGE(src,size,space); \
+    SERIALIZE_AND_SEND_MSG(func_name)\
+    xclCopyBufferDevice2HostShm_SET_PROTO_RESPONSE(dest); \
+    FREE_BUFFERS();
+
 //----------xclPerfMonReadCounters------------
 //----------xclPerfMonReadCounters------------
 #define xclPerfMonReadCounters_SET_PROTOMESSAGE() \
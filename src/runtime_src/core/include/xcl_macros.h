@@ -59,4 +59,8 @@
 #define xclPerfMonReadCounters_Streaming_n 30
 #define xclPerfMonReadTrace_Streaming_n 31
 
+#define xclSetupSharedMemory_n 32
+#define xclCopyBufferHost2DeviceShm_n 33
+#define xclCopyBufferDevice2HostShm_n 34
+
 #endif
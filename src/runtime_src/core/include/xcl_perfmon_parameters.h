@@ -37,6 +37,25 @@
 #define AXI_FIFO_SRR                    0x28
 #define AXI_FIFO_RESET_VALUE            0xA5
 
+/************************ Trace S2MM (trace offload to memory) ****************/
+
+/* Address offsets in core */
+#define TS2MM_AP_CTRL                   0x0
+#define TS2MM_COUNT_LOW                 0x10
+#define TS2MM_COUNT_HIGH                0x14
+#define TS2MM_RST                       0x1c
+#define TS2MM_WRITE_OFFSET_LOW          0x2c
+#define TS2MM_WRITE_OFFSET_HIGH         0x30
+#define TS2MM_WRITTEN_LOW               0x38
+#define TS2MM_WRITTEN_HIGH              0x3c
+#define TS2MM_CIRCULAR_BUF              0x50
+
+/* Commands */
+#define TS2MM_AP_START                  0x1
+
+/* Trace words are 64 bit */
+#define TS2MM_WORD_BYTES                8
+
 /************************ AXI Interface Monitor (AIM, earlier SPM) ***********************/
 
 /* Address offsets in core */
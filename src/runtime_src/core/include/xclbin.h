@@ -307,7 +307,8 @@ extern "C" {
         AXI_MONITOR_FIFO_FULL,
         ACCEL_MONITOR,
         AXI_STREAM_MONITOR,
-	AXI_STREAM_PROTOCOL_CHECKER
+	AXI_STREAM_PROTOCOL_CHECKER,
+        TRACE_S2MM
     };
 
     struct debug_ip_data {
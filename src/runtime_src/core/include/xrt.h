@@ -225,7 +225,7 @@ struct xclBOProperties {
     uint32_t flags;
     uint64_t size;
     uint64_t paddr;
-    int reserved; // not implemented
+    int numa_node; // NUMA node of host pages, -1 if none, mixed or unknown
 };
 
 #define	NULLBO	0xffffffff
@@ -314,6 +314,32 @@ XCL_DRIVER_DLLESPEC int xclGetErrorStatus(xclDeviceHandle handle, struct xclErro
  * handled by the driver.
  */
 XCL_DRIVER_DLLESPEC int xclLoadXclBin(xclDeviceHandle handle, const struct axlf *buffer);
+
+/**
+ * xclLoadXclBinAsync() - Start download of FPGA image (xclbin) to the device
+ *
+ * @handle:        Device handle
+ * @buffer:        Pointer to device image (xclbin) in memory
+ * Return:         0 if the download was started, -EBUSY if another download
+ *                 started with this function is pending
+ *
+ * Same as xclLoadXclBin() but returns right away, the download runs on a
+ * thread of the library.  Host side work that does not need the device
+ * image, e.g. parsing the xclbin metadata or preparing host buffers, can
+ * overlap with the download.  @buffer must stay valid, and device buffers
+ * must not be allocated, until xclLoadXclBinWait() has returned.
+ */
+XCL_DRIVER_DLLESPEC int xclLoadXclBinAsync(xclDeviceHandle handle, const struct axlf *buffer);
+
+/**
+ * xclLoadXclBinWait() - Wait for download started by xclLoadXclBinAsync()
+ *
+ * @handle:          Device handle
+ * @timeoutMilliSec: How long to wait, negative waits until done
+ * Return:           Result of the download as for xclLoadXclBin(), -ETIMEDOUT
+ *                   if it is still running or -ENOENT if none was started
+ */
+XCL_DRIVER_DLLESPEC int xclLoadXclBinWait(xclDeviceHandle handle, int timeoutMilliSec);
 /**
  * xclGetSectionInfo() - Get Information from sysfs about the downloaded xclbin sections
  *
@@ -392,6 +418,23 @@ XCL_DRIVER_DLLESPEC int xclOpenContext(xclDeviceHandle handle, uuid_t xclbinId,
  */
 XCL_DRIVER_DLLESPEC int xclCloseContext(xclDeviceHandle handle, uuid_t xclbinId, unsigned ipIndex);
 
+/**
+ * xclResetCU() - Abort the commands of a hung compute unit and reset its state
+ *
+ * @handle:        Device handle
+ * @ipIndex:       IP/CU index in the IP LAYOUT array
+ * Return:         0 on success, -EBUSY if the CU did not return to idle or
+ *                 appropriate error number
+ *
+ * Commands running on the compute unit complete with ERT_CMD_STATE_ABORT,
+ * commands on other compute units keep running.  A compute unit that does
+ * not return to idle is not used until the next xclbin is loaded or the
+ * device is reset with xclResetDevice().  The caller must have a context
+ * on the compute unit.  Not supported when compute units are scheduled by
+ * the embedded scheduler (ERT).
+ */
+XCL_DRIVER_DLLESPEC int xclResetCU(xclDeviceHandle handle, unsigned int ipIndex);
+
 /*
  * Update the device BPI PROM with new image
  */
@@ -475,6 +518,33 @@ XCL_DRIVER_DLLESPEC unsigned int xclAllocBO(xclDeviceHandle handle, size_t size,
 XCL_DRIVER_DLLESPEC unsigned int xclAllocUserPtrBO(xclDeviceHandle handle,
 	void *userptr, size_t size, unsigned flags);
 
+/**
+ * xclAllocHostBuffer() - Allocate host memory for zero copy DMA by the device
+ *
+ * @handle:        Device handle
+ * @size:          Size of buffer
+ * @flags:         Flags of the userptr BO registered for the buffer
+ * @boHandle:      BO handle registered for the buffer (out), may be NULL
+ * Return:         Pointer to buffer or NULL on failure
+ *
+ * The buffer is 2MB aligned and its size is rounded up to 2MB.  It is backed
+ * by reserved 2MB huge pages when available, by transparent huge pages
+ * otherwise, and placed on the NUMA node of the device.  The buffer is
+ * registered as a userptr BO at allocation, so its pages are resident and
+ * pinned before first use.  The BO is owned by the buffer and must not be
+ * freed with xclFreeBO(); free the buffer with xclFreeHostBuffer().
+ */
+XCL_DRIVER_DLLESPEC void *xclAllocHostBuffer(xclDeviceHandle handle, size_t size,
+                                             unsigned flags, unsigned int *boHandle);
+
+/**
+ * xclFreeHostBuffer() - Free buffer allocated with xclAllocHostBuffer()
+ *
+ * @handle:        Device handle
+ * @ptr:           Pointer returned by xclAllocHostBuffer()
+ */
+XCL_DRIVER_DLLESPEC void xclFreeHostBuffer(xclDeviceHandle handle, void *ptr);
+
 /**
  * xclFreeBO() - Free a previously allocated BO
  *
@@ -515,6 +585,49 @@ XCL_DRIVER_DLLESPEC size_t xclWriteBO(xclDeviceHandle handle, unsigned int boHan
 XCL_DRIVER_DLLESPEC size_t xclReadBO(xclDeviceHandle handle, unsigned int boHandle,
                                      void *dst, size_t size, size_t skip);
 
+/**
+ * struct xclBOIovec - One range of a vectored BO copy
+ *
+ * @data:          Host data pointer
+ * @size:          Size of data to copy
+ * @offset:        Offset within the BO
+ */
+struct xclBOIovec {
+    void *data;
+    size_t size;
+    size_t offset;
+};
+
+/**
+ * xclWriteBOv() - Copy-in several ranges of user data to host backing storage of BO
+ *
+ * @handle:        Device handle
+ * @boHandle:      BO handle
+ * @iov:           Array of ranges, ``data`` is the source of each range
+ * @count:         Number of ranges in ``iov``
+ * Return:         0 on success or appropriate error number
+ *
+ * Same as calling xclWriteBO() for each range but with a single call into
+ * the driver.  Use for rectangular and strided regions.
+ */
+XCL_DRIVER_DLLESPEC int xclWriteBOv(xclDeviceHandle handle, unsigned int boHandle,
+                                    const struct xclBOIovec *iov, unsigned int count);
+
+/**
+ * xclReadBOv() - Copy-out several ranges of host backing storage of BO to user data
+ *
+ * @handle:        Device handle
+ * @boHandle:      BO handle
+ * @iov:           Array of ranges, ``data`` is the destination of each range
+ * @count:         Number of ranges in ``iov``
+ * Return:         0 on success or appropriate error number
+ *
+ * Same as calling xclReadBO() for each range but with a single call into
+ * the driver.
+ */
+XCL_DRIVER_DLLESPEC int xclReadBOv(xclDeviceHandle handle, unsigned int boHandle,
+                                   const struct xclBOIovec *iov, unsigned int count);
+
 /**
  * xclMapBO() - Memory map BO into user's address space
  *
@@ -543,6 +656,69 @@ XCL_DRIVER_DLLESPEC void *xclMapBO(xclDeviceHandle handle, unsigned int boHandle
  */
 XCL_DRIVER_DLLESPEC int xclSyncBO(xclDeviceHandle handle, unsigned int boHandle, enum xclBOSyncDirection dir,
                                   size_t size, size_t offset);
+
+/**
+ * xclSyncBOAsync() - Start synchronization of buffer contents without waiting for completion
+ *
+ * @handle:        Device handle
+ * @boHandle:      BO handle
+ * @dir:           To device or from device
+ * @size:          Size of data to synchronize
+ * @offset:        Offset within the BO
+ * @efd:           eventfd signaled when synchronization completes, or -1
+ * @fence:         Fence identifying the synchronization (out)
+ * Return:         0 on success or standard errno
+ *
+ * Same as xclSyncBO() but returns as soon as the transfer is queued.  Large
+ * transfers are split across all DMA channels.  Each fence must be retired
+ * with xclSyncBOWait().  A return value of -ENOSYS means the driver does not
+ * support asynchronous synchronization, use xclSyncBO() instead.
+ */
+XCL_DRIVER_DLLESPEC int xclSyncBOAsync(xclDeviceHandle handle, unsigned int boHandle, enum xclBOSyncDirection dir,
+                                       size_t size, size_t offset, int efd, uint64_t *fence);
+
+/**
+ * xclSyncBOWait() - Wait for asynchronous synchronization to complete
+ *
+ * @handle:          Device handle
+ * @fence:           Fence returned by xclSyncBOAsync()
+ * @timeoutMilliSec: Timeout in milliseconds, 0 to poll, negative to wait forever
+ * Return:           0 if synchronization succeeded, -ETIMEDOUT if not yet
+ *                   complete, or standard errno of failed synchronization
+ *
+ * The fence is released unless -ETIMEDOUT is returned.
+ */
+XCL_DRIVER_DLLESPEC int xclSyncBOWait(xclDeviceHandle handle, uint64_t fence, int timeoutMilliSec);
+/**
+ * struct xclBOSyncItem - One synchronization request of xclSyncBOBatch()
+ *
+ * @boHandle:      BO handle
+ * @dir:           To device or from device
+ * @size:          Size of data to synchronize
+ * @offset:        Offset within the BO
+ */
+struct xclBOSyncItem {
+    unsigned int boHandle;
+    enum xclBOSyncDirection dir;
+    size_t size;
+    size_t offset;
+};
+
+/**
+ * xclSyncBOBatch() - Synchronize several buffers in one call
+ *
+ * @handle:        Device handle
+ * @items:         Array of synchronization requests
+ * @count:         Number of entries in @items
+ * Return:         0 on success or standard errno of first failed request
+ *
+ * Same as calling xclSyncBO() for each request, but all transfers are
+ * queued before waiting for any of them so that they overlap on the DMA
+ * channels.  All requests are attempted even if one fails.
+ */
+XCL_DRIVER_DLLESPEC int xclSyncBOBatch(xclDeviceHandle handle, const struct xclBOSyncItem *items,
+                                       unsigned int count);
+
 /**
  * xclCopyBO() - Copy device buffer contents to another buffer
  *
@@ -561,6 +737,28 @@ XCL_DRIVER_DLLESPEC int xclSyncBO(xclDeviceHandle handle, unsigned int boHandle,
 XCL_DRIVER_DLLESPEC int xclCopyBO(xclDeviceHandle handle, unsigned int dstBoHandle, unsigned int srcBoHandle,
                                    size_t size, size_t dst_offset, size_t src_offset);
 
+/**
+ * xclCopyBOPeer() - Copy device buffer contents to a buffer on another device
+ *
+ * @dstHandle:     Device handle owning the destination BO
+ * @dstBoHandle:   Destination BO handle
+ * @srcHandle:     Device handle owning the source BO
+ * @srcBoHandle:   Source BO handle
+ * @size:          Size of data to copy
+ * @dst_offset:    dst  Offset within the BO
+ * @src_offset:    src  Offset within the BO
+ * Return:         0 on success, -EOPNOTSUPP if neither BO is a P2P BO, or standard errno
+ *
+ * Card to card copy without bouncing through host memory.  One of the BOs
+ * must be allocated with XCL_BO_FLAGS_P2P, it is imported into the other
+ * device whose DMA engine then performs the copy.  A P2P destination BO is
+ * preferred since the copy is then a DMA write into the peer BAR.  Same
+ * device handles are equivalent to xclCopyBO().
+ */
+XCL_DRIVER_DLLESPEC int xclCopyBOPeer(xclDeviceHandle dstHandle, unsigned int dstBoHandle,
+                                       xclDeviceHandle srcHandle, unsigned int srcBoHandle,
+                                       size_t size, size_t dst_offset, size_t src_offset);
+
 /**
  * xclExportBO() - Obtain DMA-BUF file descriptor for a BO
  *
@@ -595,6 +793,9 @@ XCL_DRIVER_DLLESPEC unsigned int xclImportBO(xclDeviceHandle handle, int fd, uns
  * Return:         0 on success
  *
  * This is the prefered method for obtaining BO property information.
+ * numa_node reports the NUMA node the host pages of the BO live on.
+ * The driver allocates host pages of BOs on the node of the device,
+ * userptr BOs are where the application allocated them.
  */
 XCL_DRIVER_DLLESPEC int xclGetBOProperties(xclDeviceHandle handle, unsigned int boHandle,
                                            struct xclBOProperties *properties);
@@ -779,6 +980,23 @@ XCL_DRIVER_DLLESPEC int xclExecBuf(xclDeviceHandle handle, unsigned int cmdBO);
 XCL_DRIVER_DLLESPEC int xclExecBufWithWaitList(xclDeviceHandle handle, unsigned int cmdBO,
                                                size_t num_bo_in_wait_list, unsigned int *bo_wait_list);
 
+/**
+ * xclExecBufBatch() - Submit several exec buffers for execution in one call
+ *
+ * @handle:        Device handle
+ * @cmdBOs:        Array of BO handles of exec buffers to submit
+ * @count:         Number of BO handles in @cmdBOs
+ * Return:         Number of exec buffers submitted or standard error number
+ *
+ * Same as calling xclExecBuf() for each exec buffer in order, but with
+ * fewer system calls and one scheduler wakeup for the batch.  Exec buffers
+ * submitted in a batch cannot have dependencies.  If an exec buffer is
+ * rejected, the exec buffers before it remain submitted and the return
+ * value is the number submitted.  An error is returned only if no exec
+ * buffer was submitted.
+ */
+XCL_DRIVER_DLLESPEC int xclExecBufBatch(xclDeviceHandle handle, unsigned int *cmdBOs, unsigned int count);
+
 /**
  * xclExecWait() - Wait for one or more execution events on the device
  *
@@ -794,6 +1012,49 @@ XCL_DRIVER_DLLESPEC int xclExecBufWithWaitList(xclDeviceHandle handle, unsigned
  */
 XCL_DRIVER_DLLESPEC int xclExecWait(xclDeviceHandle handle, int timeoutMilliSec);
 
+/**
+ * xclExecBufDone() - Retrieve exec buffers that completed since last call
+ *
+ * @handle:        Device handle
+ * @cmdBOs:        Array receiving BO handles of completed exec buffers
+ * @count:         Capacity of @cmdBOs
+ * @overflow:      Set to 1 if completions were lost since last call
+ * Return:         Number of handles returned or standard error number
+ *
+ * Complements xclExecWait() by returning exactly which exec buffers
+ * have reached a final state, so that the caller does not have to scan
+ * all outstanding exec buffers.  If @overflow is set, the driver could
+ * not record all completions and the caller must check the state of all
+ * its outstanding exec buffers.  A return value of -ENOSYS means the
+ * driver does not support completion tracking.
+ *
+ * When the driver supports it, completions are read from a ring shared
+ * with the driver, in which case the call does not enter the kernel and
+ * can be used to busy poll for completions.
+ */
+XCL_DRIVER_DLLESPEC int xclExecBufDone(xclDeviceHandle handle, unsigned int *cmdBOs,
+                                       unsigned int count, int *overflow);
+
+/**
+ * xclExecBufWaitDone() - Wait until at least a number of exec buffers completed
+ *
+ * @handle:          Device handle
+ * @cmdBOs:          Array receiving BO handles of completed exec buffers
+ * @count:           Capacity of @cmdBOs
+ * @min:             Number of completions to wait for
+ * @timeoutMilliSec: Timeout in milliseconds, negative to wait forever
+ * @overflow:        Set to 1 if completions were lost, may be NULL
+ * Return:           Number of BO handles stored in @cmdBOs or standard error number
+ *
+ * Combines xclExecWait() and xclExecBufDone() in one call.  Returns when
+ * @min completions were retrieved, @cmdBOs is full, the timeout expired,
+ * or the driver reported lost completions.  Fewer than @min completions
+ * are returned on timeout.
+ */
+XCL_DRIVER_DLLESPEC int xclExecBufWaitDone(xclDeviceHandle handle, unsigned int *cmdBOs,
+                                           unsigned int count, unsigned int min,
+                                           int timeoutMilliSec, int *overflow);
+
 /**
  * xclRegisterInterruptNotify() - register *eventfd* file handle for a MSIX interrupt
  *
@@ -825,8 +1086,21 @@ XCL_DRIVER_DLLESPEC int xclRegisterInterruptNotify(xclDeviceHandle handle, unsig
 enum xclStreamContextFlags {
 	/* Enum for xclQueueContext.flags */
 	XRT_QUEUE_FLAG_POLLING		= (1 << 2),
+	/* Completions go to a context of this queue, see xclPollQueue() */
+	XRT_QUEUE_FLAG_PRIVATE_COMPL	= (1 << 3),
+	/* Write queue may share its route with other shared queues */
+	XRT_QUEUE_FLAG_SHARED		= (1 << 4),
+	/* Completions go to a ring shared with the driver, polled by
+	 * xclPollQueue() without syscall or interrupt while completions are
+	 * ready.  Implies XRT_QUEUE_FLAG_PRIVATE_COMPL */
+	XRT_QUEUE_FLAG_BUSY_POLL	= (1 << 5),
 };
 
+/* QoS in stream attributes, has to be the same with opencl
+ * CL_STREAM_PRIORITY() and CL_STREAM_WEIGHT() */
+#define XRT_QUEUE_ATTR_PRIO(attr)	(((attr) >> 8) & 0x3)
+#define XRT_QUEUE_ATTR_WEIGHT(attr)	(((attr) >> 16) & 0xff)
+
 /*
  * struct xclQueueContext - structure to describe a Queue
  */
@@ -838,6 +1112,8 @@ struct xclQueueContext {
     uint32_t	qsize;	   /* number of descriptors */
     uint32_t	desc_size; /* this might imply max inline msg size */
     uint64_t	flags;	   /* isr en, wb en, etc */
+    uint32_t	priority;  /* 0 (default) to 3, higher is served first */
+    uint32_t	weight;	   /* share of DMA bandwidth among busy queues, 0 is 1 */
 };
 
 /*
@@ -945,6 +1221,8 @@ enum xclQueueRequestFlag {
     XCL_QUEUE_REQ_CDH			= 1 << 1,
     XCL_QUEUE_REQ_NONBLOCKING		= 1 << 2,
     XCL_QUEUE_REQ_SILENT		= 1 << 3,
+    XCL_QUEUE_REQ_FRAME			= 1 << 4,
+    XCL_QUEUE_REQ_AGGR			= 1 << 5,
 };
 
 /*
@@ -1031,6 +1309,37 @@ XCL_DRIVER_DLLESPEC ssize_t xclReadQueue(xclDeviceHandle handle, uint64_t q_hdl,
 XCL_DRIVER_DLLESPEC int xclPollCompletion(xclDeviceHandle handle, int min_compl, int max_compl,
                                           struct xclReqCompletion *comps, int* actual_compl, int timeout);
 
+/*
+ * xclRegisterQueueBuf - register frame buffer of a queue
+ * @q_hdl:		Queue handle
+ * @buf:		Buffer returned by xclAllocQDMABuf()
+ * @frame_size:		buf is divided in frames of this size
+ *
+ * Once registered, requests with XCL_QUEUE_REQ_FRAME refer to a frame
+ * by its index in the va of struct xclReqBuffer.  The driver transfers
+ * frames without pinning pages or building an sg list per request.
+ * One buffer can be registered per queue.
+ *
+ * A read with XCL_QUEUE_REQ_FRAME | XCL_QUEUE_REQ_AGGR lands as many
+ * whole packets as fit in the frame, after a table of their offsets,
+ * lengths and EOT flags (struct xocl_qdma_aggr_hdr in qdma_ioctl.h).
+ * It completes once at least one packet arrived and returns the number
+ * of data bytes.
+ *
+ * Return: number of frames or error code.
+ */
+XCL_DRIVER_DLLESPEC int xclRegisterQueueBuf(xclDeviceHandle handle, uint64_t q_hdl, void *buf, size_t frame_size);
+
+/*
+ * xclPollQueue - poll completions of one queue
+ * @q_hdl:		Queue created with XRT_QUEUE_FLAG_PRIVATE_COMPL
+ *
+ * Same as xclPollCompletion(), but returns only completions of requests
+ * on q_hdl.  Threads polling different queues do not contend.
+ */
+XCL_DRIVER_DLLESPEC int xclPollQueue(xclDeviceHandle handle, uint64_t q_hdl, int min_compl, int max_compl,
+                                     struct xclReqCompletion *comps, int* actual_compl, int timeout);
+
 XCL_DRIVER_DLLESPEC const struct axlf_section_header* wrap_get_axlf_section(const struct axlf* top, enum axlf_section_kind kind);
 
 /**
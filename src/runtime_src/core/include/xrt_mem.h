@@ -32,6 +32,8 @@ extern "C" {
 
 #define XRT_BO_FLAGS_MEMIDX_MASK	(0xFFFFFFUL)
 #define	XCL_BO_FLAGS_CACHEABLE		(1 << 24)
+#define	XCL_BO_FLAGS_PREBUILT		(1 << 25)
+#define	XCL_BO_FLAGS_HUGEPAGE		(1 << 26)
 #define	XCL_BO_FLAGS_SVM		(1 << 27)
 #define	XCL_BO_FLAGS_DEV_ONLY		(1 << 28)
 #define	XCL_BO_FLAGS_HOST_ONLY		(1 << 29)
@@ -17,11 +17,25 @@
  */
 
 #include "dd.h"
+#include "core/common/memalign.h"
+
 #include <getopt.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
 #include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace dd {
-const char *ddOptString = "i:o:b:c:p:e:";
+const char *ddOptString = "i:o:b:c:p:e:n:D";
 
 static const struct option longOpts[] = {
     { "if",    required_argument, NULL, 'i' },
@@ -29,7 +43,10 @@ static const struct option longOpts[] = {
     { "bs",    required_argument, 0,    'b' },
     { "count", required_argument, 0,    'c' },
     { "skip",  required_argument, 0,    'p' },
-    { "seek",  required_argument, 0,    'e' }
+    { "seek",  required_argument, 0,    'e' },
+    { "depth", required_argument, 0,    'n' },
+    { "direct", no_argument,      0,    'D' },
+    { 0,       0,                 0,    0 }
 };
 
 
@@ -85,6 +102,16 @@ ddArgs_t parse_dd_options( int argc, char *argv[] )
             std::cout << "seek found: " << args.seek << std::endl;
             break;
 
+        case 'n':
+            args.depth = atoi( optarg );
+            std::cout << "depth found: " << args.depth << std::endl;
+            break;
+
+        case 'D':
+            args.direct = true;
+            std::cout << "direct found" << std::endl;
+            break;
+
         default:
             break;
         }
@@ -110,11 +137,9 @@ ddArgs_t parse_dd_options( int argc, char *argv[] )
         args.isValid = false;
     }
 
-    // Test for legal combinations of skip/seek.
-    if( args.dir == deviceToFile && args.skip > 0 ) {
-        args.isValid = false;
-    }
-    if( args.dir == fileToDevice && args.seek > 0 ) {
+    // skip is the source offset and seek the destination offset, as in
+    // Unix dd, so both are legal in either direction.
+    if( args.blockSize <= 0 || args.depth < 1 ) {
         args.isValid = false;
     }
 
@@ -126,4 +151,210 @@ ddArgs_t parse_dd_options( int argc, char *argv[] )
     return args;
 }
 
+namespace {
+
+struct block {
+    char *buf;
+    size_t size;        // valid bytes in buf
+    unsigned long long offset;  // from the start of the transfer
+};
+
+/*
+ * Blocks cycle from the free list to the producer, through the full
+ * list to the consumer and back. Either side may abort, after which
+ * both lists report empty.
+ */
+class ring {
+    std::mutex mMutex;
+    std::condition_variable mCond;
+    std::vector<block> mBlocks;
+    std::deque<block*> mFree;
+    std::deque<block*> mFull;
+    bool mFinished = false;
+    bool mAborted = false;
+
+    block *take( std::deque<block*>& list, bool waitFinished ) {
+        std::unique_lock<std::mutex> lk( mMutex );
+        mCond.wait( lk, [&] { return mAborted || !list.empty() ||
+                                     (waitFinished && mFinished); } );
+        if( mAborted || list.empty() )
+            return nullptr;
+        block *b = list.front();
+        list.pop_front();
+        return b;
+    }
+
+    void give( std::deque<block*>& list, block *b ) {
+        std::lock_guard<std::mutex> lk( mMutex );
+        list.push_back( b );
+        mCond.notify_all();
+    }
+
+public:
+    ring( size_t depth, size_t blockSize ) : mBlocks( depth ) {
+        for( auto& b : mBlocks ) {
+            void *buf = nullptr;
+            if( xrt_core::posix_memalign( &buf, getpagesize(), blockSize ) )
+                throw std::bad_alloc();
+            b.buf = static_cast<char*>( buf );
+            mFree.push_back( &b );
+        }
+    }
+    ~ring() {
+        for( auto& b : mBlocks )
+            free( b.buf );
+    }
+
+    block *getFree() { return take( mFree, false ); }
+    block *getFull() { return take( mFull, true ); }
+    void putFull( block *b ) { give( mFull, b ); }
+    void putFree( block *b ) { give( mFree, b ); }
+
+    void finish() {
+        std::lock_guard<std::mutex> lk( mMutex );
+        mFinished = true;
+        mCond.notify_all();
+    }
+    void abort() {
+        std::lock_guard<std::mutex> lk( mMutex );
+        mAborted = true;
+        mCond.notify_all();
+    }
+};
+
+// pread/pwrite until done; regular files only come up short at EOF
+ssize_t fileIO( bool write, int fd, char *buf, size_t size, off_t offset ) {
+    size_t done = 0;
+    while( done < size ) {
+        ssize_t n = write ? pwrite( fd, buf + done, size - done, offset + done )
+                          : pread( fd, buf + done, size - done, offset + done );
+        if( n < 0 && errno == EINTR )
+            continue;
+        if( n < 0 )
+            return -errno;
+        if( n == 0 )
+            break;
+        done += n;
+    }
+    return done;
+}
+
+}
+
+int copy( xclDeviceHandle handle, const ddArgs_t& args )
+{
+    const bool toDevice = ( args.dir == fileToDevice );
+    const size_t bs = args.blockSize;
+    const unsigned long long srcOffset = args.skip > 0 ? args.skip : 0;
+    const unsigned long long dstOffset = args.seek > 0 ? args.seek : 0;
+
+    if( args.direct && ( bs % getpagesize() ) ) {
+        std::cout << "ERROR: --direct needs a block size that is a multiple of "
+                  << getpagesize() << std::endl;
+        return -EINVAL;
+    }
+
+    int flags = toDevice ? O_RDONLY : ( O_WRONLY | O_CREAT | ( dstOffset ? 0 : O_TRUNC ) );
+    if( args.direct )
+        flags |= O_DIRECT;
+    int fd = open( args.file.c_str(), flags, 0644 );
+    if( fd < 0 ) {
+        int err = errno;
+        std::cout << "ERROR: cannot open " << args.file << ": " << strerror( err ) << std::endl;
+        return -err;
+    }
+
+    // Copy the remainder of the input file when no count is given
+    long long count = args.count;
+    if( toDevice && count <= 0 ) {
+        struct stat st;
+        if( fstat( fd, &st ) ) {
+            int err = errno;
+            close( fd );
+            return -err;
+        }
+        unsigned long long remain = st.st_size > (off_t)srcOffset ? st.st_size - srcOffset : 0;
+        count = ( remain + bs - 1 ) / bs;
+    }
+
+    int result = 0;
+    std::mutex errMutex;
+    auto fail = [&]( int err, const std::string& what ) {
+        std::lock_guard<std::mutex> lk( errMutex );
+        if( !result ) {
+            result = err;
+            std::cout << "ERROR: " << what << ": " << strerror( -err ) << std::endl;
+        }
+    };
+
+    unsigned long long total = 0;
+    auto start = std::chrono::steady_clock::now();
+    try {
+        ring blocks( args.depth, bs );
+
+        // Producer: file reads or device reads into free blocks
+        std::thread producer( [&] {
+            for( long long i = 0; i < count; i++ ) {
+                block *b = blocks.getFree();
+                if( !b )
+                    return;
+                b->offset = i * bs;
+                ssize_t n;
+                if( toDevice ) {
+                    n = fileIO( false, fd, b->buf, bs, srcOffset + b->offset );
+                } else {
+                    n = xclUnmgdPread( handle, 0, b->buf, bs, srcOffset + b->offset );
+                    if( n < 0 )
+                        n = -errno;
+                }
+                if( n < 0 ) {
+                    fail( n, toDevice ? "reading " + args.file : "reading device memory" );
+                    blocks.abort();
+                    return;
+                }
+                if( n == 0 ) {
+                    blocks.putFree( b );
+                    break;
+                }
+                b->size = n;
+                blocks.putFull( b );
+                if( (size_t)n < bs )
+                    break;
+            }
+            blocks.finish();
+        } );
+
+        // Consumer: DMA to the device or file writes
+        while( block *b = blocks.getFull() ) {
+            ssize_t n;
+            if( toDevice ) {
+                n = xclUnmgdPwrite( handle, 0, b->buf, b->size, dstOffset + b->offset );
+                if( n < 0 )
+                    n = -errno;
+            } else {
+                n = fileIO( true, fd, b->buf, b->size, dstOffset + b->offset );
+            }
+            if( n < 0 ) {
+                fail( n, toDevice ? "writing device memory" : "writing " + args.file );
+                blocks.abort();
+                break;
+            }
+            total += b->size;
+            blocks.putFree( b );
+        }
+        producer.join();
+    }
+    catch( const std::bad_alloc& ) {
+        fail( -ENOMEM, "allocating transfer buffers" );
+    }
+    close( fd );
+
+    double secs = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+    std::cout << "INFO: copied " << total << " bytes in " << secs << " s";
+    if( secs > 0 )
+        std::cout << " (" << total / secs / 0x100000 << " MB/s)";
+    std::cout << std::endl;
+    return result;
+}
+
 };
@@ -21,9 +21,12 @@
 
 #include <string>
 
+#include "xclhal2.h"
+
 namespace dd {
 
 const int defaultBS = 4096;
+const int defaultDepth = 3;
 
 enum e_direction {
     deviceToFile,
@@ -40,12 +43,25 @@ struct ddArgs_t {
     int count = -1;
     int skip = -1;
     int seek = -1;
+    bool direct = false;      // O_DIRECT file I/O
+    int depth = defaultDepth; // number of blocks in flight
 };
 /*
  * parse_dd_options
  */
 ddArgs_t parse_dd_options( int argc, char *argv[] );
 
+/*
+ * copy
+ *
+ * Copy 'count' blocks between the file and device memory. File I/O and
+ * DMA run on separate threads and hand blocks over through a ring of
+ * 'depth' page aligned buffers, so the copy runs at the rate of the
+ * slower side rather than the sum of both.
+ * Returns 0 on success, negative errno on failure.
+ */
+int copy( xclDeviceHandle handle, const ddArgs_t& args );
+
 };
 
 #endif /* DD_H_ */
@@ -19,6 +19,7 @@
 #ifndef DMATEST_H
 #define DMATEST_H
 
+#include <algorithm>
 #include <chrono>
 #include <future>
 #include <vector>
@@ -44,6 +45,13 @@ namespace xcldev {
     };
 
     class DMARunner {
+    public:
+        struct Measurement {
+            double mbps;     // aggregate bandwidth in MB/s
+            double latency;  // mean time of one xclSyncBO in usec
+        };
+
+    private:
         std::vector<unsigned int> mBOList;
         xclDeviceHandle mHandle;
         size_t mSize;
@@ -62,27 +70,44 @@ namespace xcldev {
             return result;
         }
 
-        int runSync(xclBOSyncDirection dir, bool mt) const {
-            const std::vector<unsigned>::const_iterator b = mBOList.begin();
-            const std::vector<unsigned>::const_iterator e = mBOList.end();
-            if (mt) {
-                auto len = e - b;
-                auto mid = b + len/2;
-                auto future0 = std::async(std::launch::async, &DMARunner::runSyncWorker, this, b, mid, dir);
-                auto future1 = std::async(std::launch::async, &DMARunner::runSyncWorker, this, mid, e, dir);
-                return (future0.get() + future1.get());
-            }
-            else {
-                auto future0 = std::async(std::launch::async, &DMARunner::runSyncWorker, this, b, e, dir);
-                return future0.get();
+        int runSyncThreads(std::vector<unsigned>::const_iterator b,
+                           std::vector<unsigned>::const_iterator e,
+                           xclBOSyncDirection dir, unsigned threads) const {
+            std::vector<std::future<int>> futures;
+            auto len = e - b;
+            for (unsigned t = 0; t < threads; t++) {
+                auto first = b + len * t / threads;
+                auto last = b + len * (t + 1) / threads;
+                futures.push_back(std::async(std::launch::async, &DMARunner::runSyncWorker, this, first, last, dir));
             }
+            int result = 0;
+            for (auto& f : futures)
+                result += f.get();
+            return result;
+        }
+
+        int runSync(xclBOSyncDirection dir, bool mt) const {
+            return runSyncThreads(mBOList.begin(), mBOList.end(), dir, mt ? 2 : 1);
+        }
+
+        Measurement toMeasurement(double usec, size_t count, unsigned threads) const {
+            Measurement m;
+            m.mbps = (usec > 0) ? (count * mSize) / (double)0x100000 / usec * 1000000 : 0;
+            // Each worker issues its share of the syncs back to back
+            size_t perThread = (count + threads - 1) / threads;
+            m.latency = perThread ? usec / perThread : 0;
+            return m;
         }
 
     public:
-        DMARunner(xclDeviceHandle handle, size_t size, unsigned flags=0) : mHandle(handle), mSize(size), mFlags(flags) {
-            long long count = 0x100000000/size;
-            if (count > 0x40000)
-                count = 0x40000;
+        DMARunner(xclDeviceHandle handle, size_t size, unsigned flags=0,
+                  unsigned long long total=0x100000000, long long maxCount=0x40000)
+            : mHandle(handle), mSize(size), mFlags(flags) {
+            long long count = total/size;
+            if (count > maxCount)
+                count = maxCount;
+            if (count == 0)
+                count = 1;
 
             for (long long i = 0; i < count; i++) {
                 unsigned bo = xclAllocBO(mHandle, mSize, 0, mFlags);
@@ -97,6 +122,40 @@ namespace xcldev {
                 xclFreeBO(mHandle, i);
         }
 
+        size_t count() const {
+            return mBOList.size();
+        }
+
+        /*
+         * Sync all BOs in one direction with 'threads' concurrent workers
+         */
+        int measure(xclBOSyncDirection dir, unsigned threads, Measurement& m) const {
+            threads = std::max(1u, std::min<unsigned>(threads, mBOList.size()));
+            Timer timer;
+            int result = runSyncThreads(mBOList.begin(), mBOList.end(), dir, threads);
+            m = toMeasurement(timer.stop(), mBOList.size(), threads);
+            return result;
+        }
+
+        /*
+         * Sync the first half of the BOs to the device while the second
+         * half is synced from the device, 'threads' workers each way
+         */
+        int measureDuplex(unsigned threads, Measurement& m) const {
+            auto mid = mBOList.begin() + mBOList.size() / 2;
+            threads = std::max(1u, std::min<unsigned>(threads, mBOList.size() / 2));
+            if (mid == mBOList.begin())
+                return -EINVAL;
+            Timer timer;
+            auto h2c = std::async(std::launch::async, &DMARunner::runSyncThreads, this,
+                                  mBOList.begin(), mid, XCL_BO_SYNC_BO_TO_DEVICE, threads);
+            auto c2h = std::async(std::launch::async, &DMARunner::runSyncThreads, this,
+                                  mid, mBOList.end(), XCL_BO_SYNC_BO_FROM_DEVICE, threads);
+            int result = h2c.get() + c2h.get();
+            m = toMeasurement(timer.stop(), mBOList.size(), 2 * threads);
+            return result;
+        }
+
         int validate(const char *buf) const {
             std::unique_ptr<char[]> bufCmp(new char[mSize]);
             int result = 0;
@@ -0,0 +1,340 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * PCIe QDMA Stream Test implementation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef STREAMTEST_H
+#define STREAMTEST_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "xclhal2.h"
+
+namespace xcldev {
+
+    /*
+     * Sweeps packet sizes and queue depths over blocking and non-blocking
+     * xclWriteQueue() / xclReadQueue() and reports throughput, p50 / p99
+     * request latency and CPU cycles per packet.
+     *
+     * h2c only writes.  c2h only reads, it needs a kernel producing
+     * packets.  loopback writes and reads concurrently and needs an
+     * xclbin looping the write stream back to the read stream, latency
+     * and throughput are those of the reads.
+     */
+    class StreamRunner {
+    public:
+        enum mode {
+            H2C,
+            C2H,
+            LOOPBACK,
+        };
+
+    private:
+        static const uint64_t INVALID_QUEUE = ~0ULL;
+        // Largest buffer of one sweep point, depth * packet size
+        static const size_t MAX_BYTES = 64 * 1024 * 1024;
+        static const size_t MAX_PACKET = 4 * 1024 * 1024;
+        static const unsigned MAX_DEPTH = 256;
+        // Per sweep point
+        static const size_t TOTAL_BYTES = 256 * 1024 * 1024;
+        static const unsigned MAX_PACKETS = 20000;
+        static const int POLL_TIMEOUT_MS = 5000;
+
+        struct slot {
+            bool write;
+            unsigned idx;
+            std::chrono::steady_clock::time_point start;
+        };
+
+        struct stats {
+            size_t bytes = 0;
+            unsigned packets = 0;
+            std::vector<double> latencies; // us
+            double elapsed = 0;            // us
+            double cpu = 0;                // us
+            uint64_t tsc = 0;
+        };
+
+        xclDeviceHandle mHandle;
+        uint64_t mWrQueue = INVALID_QUEUE;
+        uint64_t mRdQueue = INVALID_QUEUE;
+        uint64_t mWrBufHdl = 0;
+        uint64_t mRdBufHdl = 0;
+        char *mWrBuf = nullptr;
+        char *mRdBuf = nullptr;
+
+        static double cpuTime() {
+            struct timespec ts;
+            clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+            return ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0;
+        }
+
+        static uint64_t tsc() {
+#if defined(__x86_64__) || defined(__i386__)
+            return __rdtsc();
+#else
+            return 0;
+#endif
+        }
+
+        int post(slot& s, size_t size, bool nonblocking) {
+            xclReqBuffer buf;
+            xclQueueRequest req;
+
+            std::memset(&buf, 0, sizeof(buf));
+            buf.buf = (s.write ? mWrBuf : mRdBuf) + s.idx * size;
+            buf.len = size;
+            std::memset(&req, 0, sizeof(req));
+            req.op_code = s.write ? XCL_QUEUE_WRITE : XCL_QUEUE_READ;
+            req.bufs = &buf;
+            req.buf_num = 1;
+            req.flag = XCL_QUEUE_REQ_EOT;
+            if (nonblocking)
+                req.flag |= XCL_QUEUE_REQ_NONBLOCKING;
+            req.priv_data = &s;
+
+            s.start = std::chrono::steady_clock::now();
+            ssize_t rc = s.write ? xclWriteQueue(mHandle, mWrQueue, &req) :
+                xclReadQueue(mHandle, mRdQueue, &req);
+            if (rc < 0)
+                return (int)rc;
+            return 0;
+        }
+
+        static double since(std::chrono::steady_clock::time_point start) {
+            return std::chrono::duration<double, std::micro>(
+                std::chrono::steady_clock::now() - start).count();
+        }
+
+        int runBlocking(mode m, size_t size, unsigned count, stats& st) {
+            slot w = { true, 0, {} };
+            slot r = { false, 0, {} };
+
+            for (unsigned i = 0; i < count; i++) {
+                auto start = std::chrono::steady_clock::now();
+                if (m != C2H && post(w, size, false))
+                    return -EIO;
+                if (m != H2C && post(r, size, false))
+                    return -EIO;
+                st.latencies.push_back(since(start));
+                st.bytes += size;
+                st.packets++;
+            }
+            return 0;
+        }
+
+        int runNonBlocking(mode m, size_t size, unsigned depth, unsigned count, stats& st) {
+            std::vector<slot> wslots(depth), rslots(depth);
+            std::vector<xclReqCompletion> comps(depth * 2);
+            unsigned wneed = (m != C2H) ? count : 0;
+            unsigned rneed = (m != H2C) ? count : 0;
+            unsigned wposted = 0, rposted = 0, wdone = 0, rdone = 0;
+
+            // Reads go first so loopback data has somewhere to land
+            for (unsigned i = 0; i < depth; i++) {
+                rslots[i] = { false, i, {} };
+                wslots[i] = { true, i, {} };
+                if (rposted < rneed) {
+                    if (post(rslots[i], size, true))
+                        return -EIO;
+                    rposted++;
+                }
+                if (wposted < wneed) {
+                    if (post(wslots[i], size, true))
+                        return -EIO;
+                    wposted++;
+                }
+            }
+
+            while (wdone < wneed || rdone < rneed) {
+                int actual = 0;
+                int rc = xclPollCompletion(mHandle, 1, comps.size(), comps.data(),
+                    &actual, POLL_TIMEOUT_MS);
+                if (rc < 0 || actual <= 0) {
+                    std::cout << "ERROR: stream request timed out, "
+                        << wdone << "/" << wneed << " writes, "
+                        << rdone << "/" << rneed << " reads done\n";
+                    return rc < 0 ? rc : -ETIMEDOUT;
+                }
+
+                for (int i = 0; i < actual; i++) {
+                    slot *s = (slot *)comps[i].priv_data;
+                    if (comps[i].err_code) {
+                        std::cout << "ERROR: stream request failed "
+                            << comps[i].err_code << "\n";
+                        return -EIO;
+                    }
+                    // Latency and bytes of the direction that ends a packet
+                    if (s->write == (m == H2C)) {
+                        st.latencies.push_back(since(s->start));
+                        st.bytes += comps[i].nbytes;
+                        st.packets++;
+                    }
+                    unsigned& done = s->write ? wdone : rdone;
+                    unsigned& posted = s->write ? wposted : rposted;
+                    unsigned need = s->write ? wneed : rneed;
+                    done++;
+                    if (posted < need) {
+                        if (post(*s, size, true))
+                            return -EIO;
+                        posted++;
+                    }
+                }
+            }
+            return 0;
+        }
+
+        static double percentile(std::vector<double>& v, double p) {
+            if (v.empty())
+                return 0;
+            size_t n = (size_t)(p * (v.size() - 1));
+            std::nth_element(v.begin(), v.begin() + n, v.end());
+            return v[n];
+        }
+
+        void report(const char *name, bool nonblocking, size_t size, unsigned depth, stats& st) {
+            double rate = st.bytes;
+            rate /= 0x100000;
+            rate /= st.elapsed;
+            rate *= 1000000;
+            double p50 = percentile(st.latencies, 0.50);
+            double p99 = percentile(st.latencies, 0.99);
+
+            std::cout << std::left << std::setw(10) << name
+                      << std::setw(13) << (nonblocking ? "non-blocking" : "blocking")
+                      << std::right << std::setw(9) << size
+                      << std::setw(7) << depth
+                      << std::fixed << std::setprecision(1)
+                      << std::setw(11) << rate
+                      << std::setw(11) << p50
+                      << std::setw(11) << p99;
+            if (st.tsc && st.packets) {
+                // cpu time of this thread, scaled by measured tsc rate
+                double cycles = st.cpu * (st.tsc / st.elapsed) / st.packets;
+                std::cout << std::setw(12) << std::setprecision(0) << cycles;
+            } else {
+                std::cout << std::setw(12) << "n/a";
+            }
+            std::cout << std::defaultfloat << std::setprecision(6) << "\n";
+        }
+
+        int runOne(mode m, const char *name, bool nonblocking, size_t size, unsigned depth) {
+            unsigned count = std::min<size_t>(TOTAL_BYTES / size, MAX_PACKETS);
+            count = std::max(count, depth * 4);
+            stats st;
+
+            double cpu = cpuTime();
+            uint64_t tsc0 = tsc();
+            auto start = std::chrono::steady_clock::now();
+            int result = nonblocking ? runNonBlocking(m, size, depth, count, st) :
+                runBlocking(m, size, count, st);
+            st.elapsed = std::chrono::duration<double, std::micro>(
+                std::chrono::steady_clock::now() - start).count();
+            st.tsc = tsc() - tsc0;
+            st.cpu = cpuTime() - cpu;
+            if (result)
+                return result;
+
+            report(name, nonblocking, size, depth, st);
+            return 0;
+        }
+
+    public:
+        StreamRunner(xclDeviceHandle handle, const mem_data *wr, const mem_data *rd)
+            : mHandle(handle) {
+            xclQueueContext ctx;
+
+            if (wr) {
+                std::memset(&ctx, 0, sizeof(ctx));
+                ctx.route = wr->route_id;
+                ctx.flow = wr->flow_id;
+                if (xclCreateWriteQueue(mHandle, &ctx, &mWrQueue))
+                    mWrQueue = INVALID_QUEUE;
+                else
+                    mWrBuf = (char *)xclAllocQDMABuf(mHandle, MAX_BYTES, &mWrBufHdl);
+            }
+            if (rd) {
+                std::memset(&ctx, 0, sizeof(ctx));
+                ctx.route = rd->route_id;
+                ctx.flow = rd->flow_id;
+                if (xclCreateReadQueue(mHandle, &ctx, &mRdQueue))
+                    mRdQueue = INVALID_QUEUE;
+                else
+                    mRdBuf = (char *)xclAllocQDMABuf(mHandle, MAX_BYTES, &mRdBufHdl);
+            }
+            if (mWrBuf)
+                std::memset(mWrBuf, 'x', MAX_BYTES);
+        }
+
+        ~StreamRunner() {
+            if (mWrQueue != INVALID_QUEUE)
+                xclDestroyQueue(mHandle, mWrQueue);
+            if (mRdQueue != INVALID_QUEUE)
+                xclDestroyQueue(mHandle, mRdQueue);
+            if (mWrBuf)
+                xclFreeQDMABuf(mHandle, mWrBufHdl);
+            if (mRdBuf)
+                xclFreeQDMABuf(mHandle, mRdBufHdl);
+        }
+
+        int run(mode m) {
+            static const char *names[] = { "h2c", "c2h", "loopback" };
+            const char *name = names[m];
+
+            if ((m != C2H && !mWrBuf) || (m != H2C && !mRdBuf)) {
+                std::cout << "ERROR: unable to create " << name << " stream queues\n";
+                return -EINVAL;
+            }
+
+            std::cout << std::left << std::setw(10) << "mode"
+                      << std::setw(13) << "path"
+                      << std::right << std::setw(9) << "bytes"
+                      << std::setw(7) << "depth"
+                      << std::setw(11) << "MB/s"
+                      << std::setw(11) << "p50(us)"
+                      << std::setw(11) << "p99(us)"
+                      << std::setw(12) << "cycles/pkt" << "\n";
+
+            for (size_t size = 64; size <= MAX_PACKET; size *= 4) {
+                int result = runOne(m, name, false, size, 1);
+                if (result)
+                    return result;
+                for (unsigned depth = 1; depth <= MAX_DEPTH; depth *= 4) {
+                    if (depth * size > MAX_BYTES)
+                        break;
+                    result = runOne(m, name, true, size, depth);
+                    if (result)
+                        return result;
+                }
+            }
+            return 0;
+        }
+    };
+}
+
+#endif /* STREAMTEST_H */
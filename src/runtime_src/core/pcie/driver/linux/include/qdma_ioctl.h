@@ -49,6 +49,8 @@ enum XOCL_QDMA_IOC_TYPES {
 
 enum XOCL_QDMA_QUEUE_IOC_TYPES {
 	XOCL_QDMA_QUEUE_MODIFY,
+	XOCL_QDMA_QUEUE_REG_BUF,
+	XOCL_QDMA_QUEUE_SERVICE,
 	XOCL_QDMA_QUEUE_MAX
 };
 
@@ -62,10 +64,21 @@ enum XOCL_QDMA_REQ_FLAG {
 	XOCL_QDMA_REQ_FLAG_EOT		= (1 << 0),
 	XOCL_QDMA_REQ_FLAG_CDH		= (1 << 1),
 	XOCL_QDMA_REQ_FLAG_SILENT	= (1 << 3),
+	XOCL_QDMA_REQ_FLAG_FRAME	= (1 << 4),
+	XOCL_QDMA_REQ_FLAG_AGGR		= (1 << 5),
+	/* driver only, complete to the completion ring of the queue */
+	XOCL_QDMA_REQ_FLAG_RING		= (1 << 6),
 };
 
+/* frame index of a XOCL_QDMA_REQ_FLAG_FRAME request, in header flags */
+#define	XOCL_QDMA_REQ_FRAME_SHIFT	32
+
 enum XOCL_QDMA_QUEUE_FLAG {
 	XOCL_QDMA_QUEUE_FLAG_POLLING	= (1 << 2),
+	/* H2C queue may share its route with other shared queues */
+	XOCL_QDMA_QUEUE_FLAG_SHARED	= (1 << 4),
+	/* completion ring mapped to user space, see xocl_qdma_cmpl_ring */
+	XOCL_QDMA_QUEUE_FLAG_CMPL_RING	= (1 << 5),
 };
 
 /**
@@ -73,6 +86,11 @@ enum XOCL_QDMA_QUEUE_FLAG {
  * used with XOCL_QDMA_IOC_CREATE_QUEUE ioctl
  *
  * @handle:	queue handle returned by the driver
+ * @priority:	0 to 3, requests of higher priority queues go first
+ * @weight:	share of in flight DMA among busy queues, 0 is 1
+ *
+ * The driver arbitrates between queues of one direction once any queue
+ * was created with a priority or weight.
  */
 struct xocl_qdma_ioc_create_queue {
 	uint32_t		write;		/* read or write */
@@ -83,6 +101,8 @@ struct xocl_qdma_ioc_create_queue {
 	uint32_t		desc_size;	/* size of each desc */
 	uint64_t		flags;		/* isr en, wb en, etc */
 	uint64_t		handle;		/* out: queue handle */
+	uint32_t		priority;
+	uint32_t		weight;
 };
 
 /**
@@ -96,12 +116,101 @@ struct xocl_qdma_ioc_alloc_buf {
 	int		buf_fd;
 };
 
+/**
+ * struct xocl_qdma_ioc_reg_buf - Register frame buffer of a queue
+ * used with XOCL_QDMA_IOC_QUEUE_REG_BUF ioctl on the queue fd
+ *
+ * @addr:	user address of a buffer from XOCL_QDMA_IOC_ALLOC_BUFFER
+ * @frame_size:	buffer is divided in frames of this size
+ * @frame_num:	out: number of frames
+ *
+ * A request with XOCL_QDMA_REQ_FLAG_FRAME transfers from / to frame
+ * (header flags >> XOCL_QDMA_REQ_FRAME_SHIFT) of the buffer, using
+ * the DMA mapping set up at allocation.  No pages are pinned and no
+ * sg list is built per request.
+ */
+struct xocl_qdma_ioc_reg_buf {
+	uint64_t	addr;
+	uint32_t	frame_size;
+	uint32_t	frame_num;
+};
+
+/**
+ * struct xocl_qdma_aggr_hdr - packet table of an aggregated C2H frame
+ *
+ * A C2H request with XOCL_QDMA_REQ_FLAG_FRAME | XOCL_QDMA_REQ_FLAG_AGGR
+ * receives as many whole packets as fit back to back after the first
+ * XOCL_QDMA_AGGR_HDR_SIZE bytes of the frame, which hold this table.
+ * The request completes as soon as it holds one packet and no other is
+ * waiting, when the next packet does not fit, the table is full, or
+ * after an EOT packet if the request has XOCL_QDMA_REQ_FLAG_EOT.  The
+ * return value is the number of data bytes.
+ *
+ * @num:	number of packets
+ * @pkt:	offset from frame start, length and flags of each packet
+ */
+#define	XOCL_QDMA_AGGR_HDR_SIZE		4096
+#define	XOCL_QDMA_AGGR_PKT_EOT		(1 << 0)
+
+struct xocl_qdma_aggr_pkt {
+	uint32_t	offset;
+	uint32_t	len;
+	uint32_t	flags;
+	uint32_t	resv;
+};
+
+struct xocl_qdma_aggr_hdr {
+	uint32_t	num;
+	uint32_t	resv[3];
+	struct xocl_qdma_aggr_pkt pkt[];
+};
+
+#define	XOCL_QDMA_AGGR_PKT_MAX		((XOCL_QDMA_AGGR_HDR_SIZE -	\
+	sizeof(struct xocl_qdma_aggr_hdr)) / sizeof(struct xocl_qdma_aggr_pkt))
+
+/**
+ * struct xocl_qdma_cmpl_ring - completion ring of a queue
+ *
+ * Created by XOCL_QDMA_QUEUE_FLAG_CMPL_RING, mmap() offset 0 of the
+ * queue fd.  A read() / write() with XOCL_QDMA_REQ_FLAG_RING returns as
+ * soon as the request is queued, its completion is written at tail with
+ * the tag of the request header and no AIO completion takes place.  User
+ * space consumes entries from head.  A request fails with -EAGAIN when
+ * the ring could overflow, i.e. num entries are in flight or unconsumed.
+ *
+ * XOCL_QDMA_IOC_QUEUE_SERVICE reaps completions of the queue from the
+ * engine in the calling context, so a busy poller need not wait for the
+ * interrupt.
+ *
+ * @num:	number of entries, power of 2
+ * @tail:	next entry written by driver
+ * @head:	next entry consumed by user space
+ * @ent:	tag, transferred bytes and error of each request
+ */
+struct xocl_qdma_cmpl_entry {
+	uint64_t	tag;
+	uint32_t	nbytes;
+	int32_t		err;
+};
+
+struct xocl_qdma_cmpl_ring {
+	uint32_t	num;
+	uint32_t	resv0[15];
+	uint32_t	tail;
+	uint32_t	resv1[15];
+	uint32_t	head;
+	uint32_t	resv2[15];
+	struct xocl_qdma_cmpl_entry ent[];
+};
+
 /**
  * struct xocl_qdma_req_header - per request header for out bind data
  *
+ * @tag:	only read with XOCL_QDMA_REQ_FLAG_RING
  */
 struct xocl_qdma_req_header {
 	uint64_t	flags;		/* EOT, etc */
+	uint64_t	tag;
 };
 
 /**
@@ -114,4 +223,8 @@ struct xocl_qdma_req_header {
 
 #define	XOCL_QDMA_IOC_QUEUE_MODIFY		_IO(XOCL_QDMA_QUEUE_IOC_MAGIC, \
 	XOCL_QDMA_QUEUE_MODIFY)
+#define	XOCL_QDMA_IOC_QUEUE_REG_BUF		_IO(XOCL_QDMA_QUEUE_IOC_MAGIC, \
+	XOCL_QDMA_QUEUE_REG_BUF)
+#define	XOCL_QDMA_IOC_QUEUE_SERVICE		_IO(XOCL_QDMA_QUEUE_IOC_MAGIC, \
+	XOCL_QDMA_QUEUE_SERVICE)
 #endif
@@ -79,6 +79,19 @@
  *      interrupt
  * 13   Update device view with a specific     DRM_XOCL_READ_AXLF             drm_xocl_axlf
  *      xclbin image
+ * 14   Retrieve handles of exec buffers that  DRM_IOCTL_XOCL_EXECBUF_DONE    drm_xocl_execbuf_done
+ *      completed since last call
+ * 15   Send several execute jobs in one call  DRM_IOCTL_XOCL_EXECBUF_BATCH   drm_xocl_execbuf_batch
+ * 16   Start asynchronous synchronization of  DRM_IOCTL_XOCL_SYNC_BO_ASYNC   drm_xocl_sync_bo_async
+ *      buffer, returns a fence
+ * 17   Wait for asynchronous synchronization  DRM_IOCTL_XOCL_SYNC_BO_WAIT    drm_xocl_sync_bo_wait
+ *      to complete
+ * 18   Update several ranges of bo backing    DRM_IOCTL_XOCL_PWRITE_BO_V     drm_xocl_rw_bo_v
+ *      storage with user's data
+ * 19   Read back several ranges of bo         DRM_IOCTL_XOCL_PREAD_BO_V      drm_xocl_rw_bo_v
+ *      backing storage
+ * 20   Abort the commands of a hung compute   DRM_IOCTL_XOCL_RESET_CU        drm_xocl_reset_cu
+ *      unit and reset its state
  * ==== ====================================== ============================== ==================================
  */
 
@@ -153,6 +166,17 @@ enum drm_xocl_ops {
 	DRM_XOCL_HOT_RESET,
 	/* Reclock through userpf*/
 	DRM_XOCL_RECLOCK,
+	/* Completed exec buffers */
+	DRM_XOCL_EXECBUF_DONE,
+	DRM_XOCL_EXECBUF_BATCH,
+	/* Asynchronous sync bo */
+	DRM_XOCL_SYNC_BO_ASYNC,
+	DRM_XOCL_SYNC_BO_WAIT,
+	/* Vectored pwrite/pread */
+	DRM_XOCL_PWRITE_BO_V,
+	DRM_XOCL_PREAD_BO_V,
+	/* Reset of one CU */
+	DRM_XOCL_RESET_CU,
 	DRM_XOCL_NUM_IOCTLS
 };
 
@@ -222,13 +246,25 @@ struct drm_xocl_map_bo {
 	uint64_t offset;
 };
 
+/*
+ * Poll for DMA completion instead of waiting for the DMA interrupt.
+ * Lowers latency of small transfers at the cost of cpu time.
+ */
+#define DRM_XOCL_DMA_POLL	(1 << 0)
+
+/*
+ * Latency class transfer, acquires a DMA channel ahead of regular
+ * transfers waiting for one.  Meant for small transfers only.
+ */
+#define DRM_XOCL_DMA_PRIO	(1 << 1)
+
 /**
  * struct drm_xocl_sync_bo - Synchronize the buffer in the requested direction
  * between device and host
  * used with DRM_IOCTL_XOCL_SYNC_BO ioctl
  *
  * @handle:	bo handle
- * @flags:	Unused
+ * @flags:	DRM_XOCL_DMA_POLL, DRM_XOCL_DMA_PRIO or 0
  * @size:	Number of bytes to synchronize
  * @offset:	Offset into the object to synchronize
  * @dir:	DRM_XOCL_SYNC_DIR_XXX
@@ -241,20 +277,72 @@ struct drm_xocl_sync_bo {
 	enum drm_xocl_sync_bo_dir dir;
 };
 
+/**
+ * struct drm_xocl_sync_bo_async - Start synchronization of the buffer in the
+ * requested direction between device and host without waiting for completion
+ * used with DRM_IOCTL_XOCL_SYNC_BO_ASYNC ioctl
+ *
+ * The transfer is split across all DMA channels of the requested direction.
+ * Completion is retrieved with DRM_IOCTL_XOCL_SYNC_BO_WAIT, which must be
+ * called once for each fence.
+ *
+ * @handle:	bo handle
+ * @efd:	eventfd signaled when the transfer completes, or -1
+ * @size:	Number of bytes to synchronize
+ * @offset:	Offset into the object to synchronize
+ * @dir:	DRM_XOCL_SYNC_DIR_XXX
+ * @fence:	Fence identifying the transfer (out)
+ */
+struct drm_xocl_sync_bo_async {
+	uint32_t handle;
+	int32_t efd;
+	uint64_t size;
+	uint64_t offset;
+	enum drm_xocl_sync_bo_dir dir;
+	uint64_t fence;
+};
+
+/**
+ * struct drm_xocl_sync_bo_wait - Wait for asynchronous synchronization of
+ * buffer to complete
+ * used with DRM_IOCTL_XOCL_SYNC_BO_WAIT ioctl
+ *
+ * The ioctl fails with ETIMEDOUT if the transfer did not complete within
+ * @timeout, in which case the fence remains valid.  Once the ioctl succeeds
+ * the fence is released.
+ *
+ * @fence:	Fence returned by DRM_IOCTL_XOCL_SYNC_BO_ASYNC
+ * @timeout:	Timeout in milliseconds, 0 to poll, negative to wait forever
+ * @status:	0 if transfer succeeded, negative error code otherwise (out)
+ */
+struct drm_xocl_sync_bo_wait {
+	uint64_t fence;
+	int32_t timeout;
+	int32_t status;
+};
+
 /**
  * struct drm_xocl_info_bo - Obtain information about an allocated buffer obbject
  * used with DRM_IOCTL_XOCL_INFO_BO IOCTL
  *
  * @handle:	bo handle
- * @flags:      Unused
+ * @flags:	XCL_BO_FLAGS_P2P if bo is exposed through the P2P BAR (out)
  * @size:	Size of buffer object (out)
  * @paddr:	Physical address (out)
+ * @numa_node:	NUMA node of the host pages of the bo, -1 if the bo has no
+ *		host pages or they are on several nodes (out)
+ * @pad:	Reserved, must be 0
+ *
+ * Callers set @numa_node to -1, drivers older than @numa_node return it
+ * unchanged.
  */
 struct drm_xocl_info_bo {
 	uint32_t handle;
 	uint32_t flags;
 	uint64_t size;
 	uint64_t paddr;
+	int32_t numa_node;
+	uint32_t pad;
 };
 
 /**
@@ -263,6 +351,11 @@ struct drm_xocl_info_bo {
  * NOTE: This ioctl will be removed in next release
  *
  * @xclbin:	Pointer to user's xclbin structure in memory
+ *
+ * An xclbin loaded earlier may be loaded again by passing only its header,
+ * with m_numSections set to 0 and m_header.m_length set to
+ * sizeof(struct axlf). The driver then uses its cached copy of the image
+ * (see icap xclbin_cache sysfs node) and fails with -ENOENT if there is none.
  */
 struct drm_xocl_axlf {
 	struct axlf *xclbin;
@@ -273,14 +366,14 @@ struct drm_xocl_axlf {
  * used with DRM_IOCTL_XOCL_PWRITE_BO ioctl
  *
  * @handle:	bo handle
- * @pad:	Unused
+ * @flags:	DRM_XOCL_DMA_POLL, DRM_XOCL_DMA_PRIO or 0
  * @offset:	Offset into the buffer object to write to
  * @size:	Length of data to write
  * @data_ptr:	User's pointer to read the data from
  */
 struct drm_xocl_pwrite_bo {
 	uint32_t handle;
-	uint32_t pad;
+	uint32_t flags;
 	uint64_t offset;
 	uint64_t size;
 	uint64_t data_ptr;
@@ -291,19 +384,58 @@ struct drm_xocl_pwrite_bo {
  * used with DRM_IOCTL_XOCL_PREAD_BO ioctl
  *
  * @handle:	bo handle
- * @pad:	Unused
+ * @flags:	DRM_XOCL_DMA_POLL, DRM_XOCL_DMA_PRIO or 0
  * @offset:	Offset into the buffer object to read from
  * @size:	Length of data to read
  * @data_ptr:	User's pointer to write the data into
  */
 struct drm_xocl_pread_bo {
 	uint32_t handle;
-	uint32_t pad;
+	uint32_t flags;
 	uint64_t offset;
 	uint64_t size;
 	uint64_t data_ptr;
 };
 
+/*
+ * Max number of ranges in one drm_xocl_rw_bo_v
+ */
+#define DRM_XOCL_RW_BO_V_MAX (1024)
+
+/**
+ * struct drm_xocl_bo_iovec - One range of a vectored pwrite or pread
+ *
+ * @offset:	Offset into the buffer object
+ * @size:	Length of data
+ * @data_ptr:	User's pointer to the data
+ */
+struct drm_xocl_bo_iovec {
+	uint64_t offset;
+	uint64_t size;
+	uint64_t data_ptr;
+};
+
+/**
+ * struct drm_xocl_rw_bo_v - Write or read several ranges of bo
+ * used with DRM_IOCTL_XOCL_PWRITE_BO_V and DRM_IOCTL_XOCL_PREAD_BO_V ioctls
+ *
+ * All ranges are validated before any data is copied.  Meant for strided
+ * and rectangular regions that would otherwise need one ioctl per row.
+ *
+ * @handle:	bo handle
+ * @flags:	DRM_XOCL_DMA_POLL, DRM_XOCL_DMA_PRIO or 0
+ * @count:	Number of ranges in @iov, at most DRM_XOCL_RW_BO_V_MAX
+ * @pad:	Unused
+ * @iov:	User pointer to array of struct drm_xocl_bo_iovec
+ */
+struct drm_xocl_rw_bo_v {
+	uint32_t handle;
+	uint32_t flags;
+	uint32_t count;
+	uint32_t pad;
+	uint64_t iov;
+};
+
 enum drm_xocl_ctx_code {
 	XOCL_CTX_OP_ALLOC_CTX = 0,
 	XOCL_CTX_OP_FREE_CTX
@@ -349,14 +481,14 @@ struct drm_xocl_info {
  * used with DRM_IOCTL_XOCL_PWRITE_UNMGD ioctl
  *
  * @address_space: Address space in the DSA; currently only 0 is suported
- * @pad:	   Unused
+ * @flags:	   DRM_XOCL_DMA_POLL, DRM_XOCL_DMA_PRIO or 0
  * @paddr:	   Physical address in the specified address space
  * @size:	   Length of data to write
  * @data_ptr:	   User's pointer to read the data from
  */
 struct drm_xocl_pwrite_unmgd {
 	uint32_t address_space;
-	uint32_t pad;
+	uint32_t flags;
 	uint64_t paddr;
 	uint64_t size;
 	uint64_t data_ptr;
@@ -367,14 +499,14 @@ struct drm_xocl_pwrite_unmgd {
  * used with DRM_IOCTL_XOCL_PREAD_UNMGD ioctl
  *
  * @address_space: Address space in the DSA; currently only 0 is valid
- * @pad:	   Unused
+ * @flags:	   DRM_XOCL_DMA_POLL, DRM_XOCL_DMA_PRIO or 0
  * @paddr:	   Physical address in the specified address space
  * @size:	   Length of data to write
  * @data_ptr:	   User's pointer to write the data to
  */
 struct drm_xocl_pread_unmgd {
 	uint32_t address_space;
-	uint32_t pad;
+	uint32_t flags;
 	uint64_t paddr;
 	uint64_t size;
 	uint64_t data_ptr;
@@ -443,6 +575,147 @@ struct drm_xocl_execbuf {
 	uint32_t deps[8];
 };
 
+/*
+ * Max number of command buffers in one drm_xocl_execbuf_batch
+ */
+#define DRM_XOCL_EXECBUF_BATCH_MAX (256)
+
+/**
+ * struct drm_xocl_execbuf_batch - Submit several command buffers for execution
+ * used with DRM_IOCTL_XOCL_EXECBUF_BATCH ioctl
+ *
+ * @ctx_id:         Pass 0
+ * @count:          In: number of handles in @handles (at most
+ *                  DRM_XOCL_EXECBUF_BATCH_MAX), Out: number of command
+ *                  buffers queued
+ * @handles:        User pointer to array of uint32_t command buffer BO handles
+ *
+ * The command buffers are queued in order with one scheduler wakeup.
+ * Commands submitted in a batch cannot have dependencies.  If a command
+ * buffer is rejected, the commands before it remain queued, @count is
+ * set to the number queued and the ioctl returns an error.
+ */
+struct drm_xocl_execbuf_batch {
+	uint32_t ctx_id;
+	uint32_t count;
+	uint64_t handles;
+};
+
+/*
+ * Set by driver in drm_xocl_execbuf_done.flags when completions were
+ * dropped because the client did not drain them fast enough.  User
+ * space must then check all its outstanding exec buffers.
+ */
+#define DRM_XOCL_EXECBUF_DONE_OVERFLOW (0x1)
+
+/**
+ * struct drm_xocl_execbuf_done - Retrieve completed exec buffers
+ * used with DRM_IOCTL_XOCL_EXECBUF_DONE ioctl
+ *
+ * @ctx_id:         Pass 0
+ * @count:          In: capacity of @handles, Out: number of handles returned
+ * @flags:          Out: DRM_XOCL_EXECBUF_DONE_XXX flags
+ * @handles:        User pointer to array of uint32_t exec BO handles
+ *
+ * Exec buffers submitted by this client are recorded when they reach
+ * a final state (completed, error, abort).  Each call drains up to
+ * @count recorded handles.
+ */
+struct drm_xocl_execbuf_done {
+	uint32_t ctx_id;
+	uint32_t count;
+	uint32_t flags;
+	uint32_t pad;
+	uint64_t handles;
+};
+
+/**
+ * struct drm_xocl_reset_cu - Reset one compute unit
+ * used with DRM_IOCTL_XOCL_RESET_CU ioctl
+ *
+ * @cu_index:       Index of the CU, the client must have a context on it
+ * @pad:            Pass 0
+ *
+ * Commands running on the CU are aborted, commands of other CUs are not
+ * affected.  The CU is disabled until the next xclbin if it does not
+ * return to idle, the ioctl then fails with EBUSY.  Supported when the
+ * CUs are scheduled by the driver (no ERT) only.
+ */
+struct drm_xocl_reset_cu {
+	uint32_t cu_index;
+	uint32_t pad;
+};
+
+/*
+ * Completion ring shared between driver and user space.
+ *
+ * Mapped read/write with mmap() of the device file at page offset
+ * XOCL_COMPLETION_RING_PGOFF, the mapping size is the size of struct
+ * xocl_completion_ring rounded up to page size.  Once a client has
+ * mapped the ring, the driver publishes completed exec buffers into
+ * the ring instead of the fifo drained by DRM_IOCTL_XOCL_EXECBUF_DONE.
+ *
+ * The driver writes entries and advances @head; user space consumes
+ * entries from @tail up to @head and advances @tail.  Both indices
+ * increase monotonically and are masked by (@size - 1).  If the ring
+ * is full when a command completes, the driver sets @overflow, which
+ * user space clears before checking all its outstanding exec buffers.
+ */
+#define XOCL_COMPLETION_RING_PGOFF	(0x8000)
+#define XOCL_COMPLETION_RING_ENTRIES	(1024)
+
+struct xocl_completion_entry {
+	uint32_t handle;
+	uint32_t state;
+};
+
+struct xocl_completion_ring {
+	uint32_t head;
+	uint32_t pad0[15];
+	uint32_t tail;
+	uint32_t pad1[15];
+	uint32_t size;
+	uint32_t overflow;
+	uint32_t pad2[14];
+	struct xocl_completion_entry entries[XOCL_COMPLETION_RING_ENTRIES];
+};
+
+/*
+ * Device usage statistics shared with user space.
+ *
+ * Mapped read only with mmap() of the device file at page offset
+ * XOCL_USAGE_PAGE_PGOFF, the mapping size is the size of struct
+ * xocl_usage_page rounded up to page size.  The page is per device and
+ * updated in place by the driver, so querying the counters is a plain
+ * memory read.  Each 64-bit counter is updated atomically; counters are
+ * not updated together, so a snapshot may be off by in-flight operations.
+ *
+ * @dma_channel_count: Number of valid entries in @h2c and @c2h
+ * @mm_channel_count:  Number of valid entries in @mm
+ * @cu_count:          Number of valid entries in @cu_usage
+ * @h2c, @c2h:         Bytes transferred per DMA channel
+ * @mm:                Bytes allocated and number of BOs per memory bank
+ * @cu_usage:          Commands started per CU since the xclbin was loaded
+ */
+#define XOCL_USAGE_PAGE_PGOFF		(0x8001)
+#define XOCL_USAGE_MAX_DMA_CHANNELS	(8)
+#define XOCL_USAGE_MAX_BANKS		(16)
+#define XOCL_USAGE_MAX_CUS		(128)
+
+struct xocl_usage_page {
+	uint32_t dma_channel_count;
+	uint32_t mm_channel_count;
+	uint32_t cu_count;
+	uint32_t pad;
+	uint64_t h2c[XOCL_USAGE_MAX_DMA_CHANNELS];
+	uint64_t c2h[XOCL_USAGE_MAX_DMA_CHANNELS];
+	struct {
+		uint64_t memory_usage;
+		uint64_t bo_count;
+	} mm[XOCL_USAGE_MAX_BANKS];
+	uint64_t cu_usage[XOCL_USAGE_MAX_CUS];
+};
+
 /**
  * struct drm_xocl_user_intr - Register user's eventfd for MSIX interrupt
  * used with DRM_IOCTL_XOCL_USER_INTR ioctl
@@ -487,5 +760,12 @@ struct drm_xocl_reclock_info {
 #define DRM_IOCTL_XOCL_USER_INTR	XOCL_IOC_ARG(USER_INTR, user_intr)
 #define DRM_IOCTL_XOCL_HOT_RESET	XOCL_IOC(HOT_RESET)
 #define DRM_IOCTL_XOCL_RECLOCK		XOCL_IOC_ARG(USER_INTR, reclock_info)
+#define DRM_IOCTL_XOCL_EXECBUF_DONE	XOCL_IOC_ARG(EXECBUF_DONE, execbuf_done)
+#define DRM_IOCTL_XOCL_EXECBUF_BATCH	XOCL_IOC_ARG(EXECBUF_BATCH, execbuf_batch)
+#define DRM_IOCTL_XOCL_SYNC_BO_ASYNC	XOCL_IOC_ARG(SYNC_BO_ASYNC, sync_bo_async)
+#define DRM_IOCTL_XOCL_SYNC_BO_WAIT	XOCL_IOC_ARG(SYNC_BO_WAIT, sync_bo_wait)
+#define DRM_IOCTL_XOCL_PWRITE_BO_V	XOCL_IOC_ARG(PWRITE_BO_V, rw_bo_v)
+#define DRM_IOCTL_XOCL_PREAD_BO_V	XOCL_IOC_ARG(PREAD_BO_V, rw_bo_v)
+#define DRM_IOCTL_XOCL_RESET_CU		XOCL_IOC_ARG(RESET_CU, reset_cu)
 
 #endif
@@ -36,6 +36,7 @@
 #include "qdma_st_c2h.h"
 #include "thread.h"
 #include "version.h"
+#include "../../xocl_trace.h"
 
 #ifdef DEBUGFS
 #include "qdma_debugfs_queue.h"
@@ -282,7 +283,8 @@ static ssize_t qdma_request_submit_st_c2h(struct xlnx_dma_dev *xdev,
 		/* any rcv'ed packet not yet read ? */
 		/** read the data from the device */
 		descq_st_c2h_read(descq, req, 1, 1);
-		if (!cb->left || (req->eot && req->eot_rcved)) {
+		if (!cb->left || (req->eot && req->eot_rcved) ||
+		    (req->aggr && cb->pkt_cnt)) {
 			list_del(&cb->list);
 			descq->stat.complete_requests++;
 			descq->stat.pending_requests--;
@@ -291,6 +293,13 @@ static ssize_t qdma_request_submit_st_c2h(struct xlnx_dma_dev *xdev,
 			pr_debug("%s: 0x%p done, req len %u, %u,%u.\n",
 				descq->conf.name, req, req->count,
 				cb->offset, cb->left);
+			/* data was already waiting, async callers still
+			 * expect their completion callback
+			 */
+			if (req->fp_done) {
+				req->fp_done(req->uld_data, cb->offset, 0);
+				return 0;
+			}
 			return (req->count - cb->left);
 		}
 		descq->pend_list_empty = 0;
@@ -1926,12 +1935,16 @@ ssize_t qdma_request_submit(unsigned long dev_hndl, unsigned long id,
 
 	pr_debug("%s: cb 0x%p submitted.\n", descq->conf.name, cb);
 
+	trace_qdma_request_submit(xdev->conf.idx, descq->conf.qidx,
+		descq->conf.c2h, req->count);
 	qdma_descq_proc_sgt_request(descq);
 
 	if (!wait)
 		return 0;
 
 	rv = qdma_request_wait_for_cmpl(xdev, descq, req);
+	trace_qdma_request_done(xdev->conf.idx, descq->conf.qidx,
+		descq->conf.c2h, rv < 0 ? rv : cb->offset);
 	if (rv < 0)
 		goto unmap_sgl;
 
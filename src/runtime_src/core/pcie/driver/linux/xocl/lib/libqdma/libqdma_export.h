@@ -990,6 +990,11 @@ struct qdma_request {
 	unsigned long uld_data;		/** for the calling function */
 	/** set fp_done for non-blocking mode */
 	int (*fp_done)(unsigned long uld_data, unsigned int bytes_done, int err);
+	/** c2h aggregation: called before a packet is copied to byte offset
+	 *  of the data buffers, return < 0 to complete the request instead
+	 */
+	int (*fp_pkt)(unsigned long uld_data, unsigned int offset,
+			unsigned int len, bool eot);
 	unsigned int timeout_ms; /** timeout in mili-seconds, 0 - no timeout */
 	unsigned int count;	/** total bytes to be dma'ed */
 	unsigned int offset;	/** offset into the data buffers */
@@ -1008,6 +1013,7 @@ struct qdma_request {
 	u8 eot:1;	/** request is end of transfer */
 	u8 use_sgt:1;	/** data buffers in sg_table format */
 	u8 eot_rcved:1;	/** c2h only: eot received, set by libqdma */
+	u8 aggr:1;	/** c2h only: pack whole packets back to back */
 
 	/** indicates end of transfer towards user kernel */
 	u8 udd_len;
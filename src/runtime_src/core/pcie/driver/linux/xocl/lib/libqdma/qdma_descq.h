@@ -387,6 +387,7 @@ struct qdma_sgt_req_cb {
 	unsigned int desc_nr;	/** # descriptors used */
 	unsigned int offset;	/** offset in the page*/
 	unsigned int left;	/** number of descriptors yet to be proccessed*/
+	unsigned int pkt_cnt;	/** c2h aggregation: # of packets copied */
 
 	void *sg;		/** sg entry being worked on currently */
 	unsigned int sg_idx;	/** sg's index */
@@ -237,6 +237,90 @@ static int qdma_flq_refill(struct qdma_descq *descq, int idx, int count,
 	return i;
 }
 
+/*
+ * aggregated read: copy whole packets back to back into the request, the
+ * caller is told of each packet through fp_pkt.  A packet is never split
+ * across requests, the request ends at the first packet that does not fit
+ * or is refused by fp_pkt, or after an EOT packet.
+ */
+static int descq_st_c2h_read_aggr(struct qdma_descq *descq,
+			struct qdma_request *req, bool update_pidx, bool refill)
+{
+	struct xlnx_dma_dev *xdev = descq->xdev;
+	struct qdma_flq *flq = (struct qdma_flq *)descq->flq;
+	struct qdma_sgt_req_cb *cb = qdma_req_cb_get(req);
+	unsigned int start = flq->pidx_pend;
+	unsigned int pidx = start;
+	unsigned int fsgcnt = ring_idx_delta(descq->pidx, pidx, flq->size);
+	unsigned int copied_total = 0;
+	unsigned int fl_used = 0;
+
+	while (fsgcnt && !req->eot_rcved) {
+		unsigned int idx = pidx;
+		unsigned int last = pidx;
+		unsigned int n = 0;
+		unsigned int len = 0;
+		unsigned int copied = 0;
+		bool eot;
+
+		/* find the packet boundary */
+		do {
+			last = idx;
+			len += flq->sdesc[idx].len;
+			idx = ring_idx_incr(idx, 1, flq->size);
+			n++;
+		} while (n < fsgcnt && !flq->sdesc_info[last].f.eop);
+
+		if (!flq->sdesc_info[last].f.eop)
+			break;
+
+		eot = xdev->stm_en && flq->sdesc_info[last].f.stm_eot;
+		if (len > cb->left) {
+			if (cb->pkt_cnt)
+				break;
+			pr_info("%s, req 0x%p, pkt %u > buffer %u.\n",
+				descq->conf.name, req, len, cb->left);
+			return -EMSGSIZE;
+		}
+		if (req->fp_pkt(req->uld_data, cb->offset, len, eot) < 0)
+			break;
+
+		if (len)
+			qdma_req_copy_fl(flq->sdesc + pidx, n, req, &copied);
+
+		cb->pkt_cnt++;
+		if (eot && req->eot) {
+			req->eot_rcved = 1;
+			pr_debug("%s, req 0x%p, %u pkts rcv EOT.\n",
+				descq->conf.name, req, cb->pkt_cnt);
+		}
+		copied_total += copied;
+		fl_used += n;
+		fsgcnt -= n;
+		pidx = idx;
+	}
+
+	if (!fl_used)
+		return 0;
+
+	descq->stat.complete_bytes += copied_total;
+	incr_cmpl_desc_cnt(descq, fl_used);
+
+	if (refill)
+		qdma_flq_refill(descq, start, fl_used, 1, GFP_ATOMIC);
+
+	flq->pidx_pend = pidx;
+
+	if (update_pidx) {
+		pidx = ring_idx_decr(flq->pidx_pend, 1, flq->size);
+		descq_c2h_pidx_update(descq, pidx);
+	}
+
+	flq->pkt_dlen -= copied_total;
+
+	return copied_total;
+}
+
 /*
  *
  */
@@ -250,6 +334,9 @@ int descq_st_c2h_read(struct qdma_descq *descq, struct qdma_request *req,
 	unsigned int copied = 0;
 	int fl_used;
 
+	if (req->aggr)
+		return descq_st_c2h_read_aggr(descq, req, update_pidx, refill);
+
 	if (!fsgcnt)
 		return 0;
 
@@ -321,6 +408,8 @@ static int qdma_c2h_packets_proc_dflt(struct qdma_descq *descq)
 			qdma_sgt_req_done(descq, cb, 0);
 		else if (req->eot && req->eot_rcved)
 			qdma_sgt_req_done(descq, cb, 0);
+		else if (req->aggr && cb->pkt_cnt)
+			qdma_sgt_req_done(descq, cb, 0);
 		else
 			break;
 	}
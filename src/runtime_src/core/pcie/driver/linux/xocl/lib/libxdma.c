@@ -48,6 +48,10 @@ static unsigned int poll_mode;
 module_param(poll_mode, uint, 0644);
 MODULE_PARM_DESC(poll_mode, "Set 1 for hw polling, default is 0 (interrupts)");
 
+static unsigned int poll_threshold;
+module_param(poll_threshold, uint, 0644);
+MODULE_PARM_DESC(poll_threshold, "Poll for completion of transfers up to this many bytes in interrupt mode, default is 0 (disabled)");
+
 static unsigned int interrupt_mode;
 module_param(interrupt_mode, uint, 0644);
 MODULE_PARM_DESC(interrupt_mode, "0 - MSI-x , 1 - MSI, 2 - Legacy");
@@ -503,7 +507,7 @@ static void xdma_engine_stop(struct xdma_engine *engine)
 	dbg_tfr("xdma_engine_stop(%s) done\n", engine->name);
 }
 
-static void engine_start_mode_config(struct xdma_engine *engine)
+static void engine_start_mode_config(struct xdma_engine *engine, bool poll)
 {
 	u32 w;
 
@@ -531,7 +535,7 @@ static void engine_start_mode_config(struct xdma_engine *engine)
 	w |= (u32)XDMA_CTRL_IE_DESC_ALIGN_MISMATCH;
 	w |= (u32)XDMA_CTRL_IE_MAGIC_STOPPED;
 
-	if (poll_mode) {
+	if (poll) {
 		w |= (u32)XDMA_CTRL_POLL_MODE_WB;
 	} else {
 		w |= (u32)XDMA_CTRL_IE_DESC_STOPPED;
@@ -628,7 +632,8 @@ static struct xdma_transfer *engine_start(struct xdma_engine *engine)
 		&engine->regs->status);
 	mmiowb();
 
-	engine_start_mode_config(engine);
+	engine_start_mode_config(engine,
+		poll_mode || (transfer->flags & XFER_FLAG_POLL));
 
 	engine_status_read(engine, 0, 0);
 
@@ -1120,7 +1125,7 @@ static int engine_service(struct xdma_engine *engine, int desc_writeback)
 	}
 
 	/* Before starting engine again, clear the writeback data */
-        if (poll_mode) {
+        if (engine->poll_mode_addr_virt) {
 		wb_data = (struct xdma_poll_wb *)engine->poll_mode_addr_virt;
 		wb_data->completed_desc_count = 0;
 	}
@@ -1163,13 +1168,20 @@ static void engine_service_work(struct work_struct *work)
 	spin_unlock_irqrestore(&engine->lock, flags);
 }
 
+/*
+ * With @backoff the writeback is polled continuously for POLL_SPIN_US,
+ * then the thread sleeps between polls with exponentially increasing
+ * sleep times up to POLL_SLEEP_MAX_US.
+ */
 static u32 engine_service_wb_monitor(struct xdma_engine *engine,
-	u32 expected_wb)
+	u32 expected_wb, bool backoff)
 {
 	struct xdma_poll_wb *wb_data;
 	u32 desc_wb = 0;
 	u32 sched_limit = 0;
 	unsigned long timeout;
+	ktime_t spin_end = ktime_add_us(ktime_get(), POLL_SPIN_US);
+	unsigned int sleep_us = 1;
 
 	BUG_ON(!engine);
 	wb_data = (struct xdma_poll_wb *)engine->poll_mode_addr_virt;
@@ -1201,6 +1213,16 @@ static u32 engine_service_wb_monitor(struct xdma_engine *engine,
 			break;
 		}
 
+		if (backoff) {
+			if (ktime_before(ktime_get(), spin_end)) {
+				cpu_relax();
+				continue;
+			}
+			usleep_range(sleep_us, sleep_us * 2);
+			sleep_us = min(sleep_us * 2, POLL_SLEEP_MAX_US);
+			continue;
+		}
+
 		/*
  		 * Define NUM_POLLS_PER_SCHED to limit how much time is spent
  		 * in the scheduler
@@ -1217,7 +1239,7 @@ static u32 engine_service_wb_monitor(struct xdma_engine *engine,
 }
 
 static int engine_service_poll(struct xdma_engine *engine,
-                u32 expected_desc_count)
+                u32 expected_desc_count, bool backoff)
 {
 	struct xdma_poll_wb *writeback_data;
 	u32 desc_wb = 0;
@@ -1241,7 +1263,8 @@ static int engine_service_poll(struct xdma_engine *engine,
  	 * determined before the function is called
  	 */
 
-	desc_wb = engine_service_wb_monitor(engine, expected_desc_count);
+	desc_wb = engine_service_wb_monitor(engine, expected_desc_count,
+		backoff);
 
 	spin_lock_irqsave(&engine->lock, flags);
 	dbg_tfr("%s service.\n", engine->name);
@@ -2601,15 +2624,19 @@ static int engine_init_regs(struct xdma_engine *engine)
 	reg_value |= XDMA_CTRL_IE_READ_ERROR;
 	reg_value |= XDMA_CTRL_IE_DESC_ERROR;
 
-	/* if using polled mode, configure writeback address */
-	if (poll_mode) {
+	/*
+	 * configure writeback address, also used in interrupt mode by
+	 * requests that poll for completion
+	 */
+	if (engine->poll_mode_addr_virt) {
 		rv = engine_writeback_setup(engine);
 		if (rv) {
 			dbg_init("%s descr writeback setup failed.\n",
 				engine->name);
 			goto fail_wb;
 		}
-	} else {
+	}
+	if (!poll_mode) {
 		/* enable the relevant completion interrupts */
 		reg_value |= XDMA_CTRL_IE_DESC_STOPPED;
 		reg_value |= XDMA_CTRL_IE_DESC_COMPLETED;
@@ -2657,16 +2684,14 @@ static int engine_alloc_resource(struct xdma_engine *engine)
 		goto err_out;
 	}
 
-	if (poll_mode) {
-		engine->poll_mode_addr_virt = dma_alloc_coherent(
-					&xdev->pdev->dev,
-					sizeof(struct xdma_poll_wb),
-					&engine->poll_mode_bus, GFP_KERNEL);
-		if (!engine->poll_mode_addr_virt) {
+	engine->poll_mode_addr_virt = dma_alloc_coherent(
+				&xdev->pdev->dev,
+				sizeof(struct xdma_poll_wb),
+				&engine->poll_mode_bus, GFP_KERNEL);
+	if (!engine->poll_mode_addr_virt) {
                         pr_warn("%s, %s poll pre-alloc writeback OOM.\n",
-				dev_name(&xdev->pdev->dev), engine->name);
-			goto err_out;
-		}
+			dev_name(&xdev->pdev->dev), engine->name);
+		goto err_out;
 	}
 
 	if (engine->streaming && engine->dir == DMA_FROM_DEVICE) {
@@ -2788,15 +2813,37 @@ static int transfer_build(struct xdma_engine *engine,
 	return 0;
 }
 
+/* transfer_desc_finish() - terminate the descriptor list of a transfer */
+static void transfer_desc_finish(struct xdma_transfer *xfer,
+		unsigned int desc_max)
+{
+	int i = 0;
+	int last = 0;
+	u32 control;
+
+	/* terminate last descriptor */
+	last = desc_max - 1;
+	xdma_desc_link(xfer->desc_virt + last, 0, 0);
+	/* stop engine, EOP for AXI ST, req IRQ on last descriptor */
+	control = XDMA_DESC_STOPPED;
+	control |= XDMA_DESC_EOP;
+	control |= XDMA_DESC_COMPLETED;
+	xdma_desc_control_set(xfer->desc_virt + last, control);
+
+	xfer->desc_num = xfer->desc_adjacent = desc_max;
+
+	dbg_sg("transfer 0x%p has %d descriptors\n", xfer, xfer->desc_num);
+	/* fill in adjacent numbers */
+	for (i = 0; i < xfer->desc_num; i++)
+		xdma_desc_adjacent(xfer->desc_virt + i, xfer->desc_num - i - 1);
+}
+
 static int transfer_init(struct xdma_engine *engine, struct xdma_request_cb *req)
 {
 	struct xdma_transfer *xfer = &req->xfer;
 	unsigned int desc_max = min_t(unsigned int,
 				req->sw_desc_cnt - req->sw_desc_idx,
 				XDMA_TRANSFER_MAX_DESC);
-	int i = 0;
-	int last = 0;
-	u32 control;
 
 	memset(xfer, 0, sizeof(*xfer));
 
@@ -2815,21 +2862,7 @@ static int transfer_init(struct xdma_engine *engine, struct xdma_request_cb *req
 
 	transfer_build(engine, req, desc_max);
 
-	/* terminate last descriptor */
-	last = desc_max - 1;
-	xdma_desc_link(xfer->desc_virt + last, 0, 0);
-	/* stop engine, EOP for AXI ST, req IRQ on last descriptor */
-	control = XDMA_DESC_STOPPED;
-	control |= XDMA_DESC_EOP;
-	control |= XDMA_DESC_COMPLETED;
-	xdma_desc_control_set(xfer->desc_virt + last, control);
-
-	xfer->desc_num = xfer->desc_adjacent = desc_max;
-
-	dbg_sg("transfer 0x%p has %d descriptors\n", xfer, xfer->desc_num);
-	/* fill in adjacent numbers */
-	for (i = 0; i < xfer->desc_num; i++)
-		xdma_desc_adjacent(xfer->desc_virt + i, xfer->desc_num - i - 1);
+	transfer_desc_finish(xfer, desc_max);
 
 	return 0;
 }
@@ -2945,8 +2978,108 @@ static struct xdma_request_cb * xdma_init_request(struct sg_table *sgt,
 	return req;
 }
 
+/*
+ * transfer_wait() - wait for a queued transfer to complete
+ *
+ * @ep_addr end point address of the transfer, for logging only
+ *
+ * Returns 0 if the transfer completed, -EIO if it failed, -ERESTARTSYS
+ * if it timed out and was aborted.  Called with the engine descriptor
+ * lock held.
+ */
+static int transfer_wait(struct xdma_engine *engine,
+		struct xdma_transfer *xfer, u64 ep_addr, bool poll,
+		int timeout_ms)
+{
+	unsigned long flags;
+	int rv;
+
+	/*
+	 * When polling, determine how many descriptors have been queued
+	 * on the engine to determine the writeback value expected
+	 */
+	if (poll) {
+		unsigned int desc_count;
+
+		spin_lock_irqsave(&engine->lock, flags);
+		desc_count = xfer->desc_num;
+		spin_unlock_irqrestore(&engine->lock, flags);
+
+		dbg_tfr("%s poll desc_count=%d\n",
+			engine->name, desc_count);
+		rv = engine_service_poll(engine, desc_count, !poll_mode);
+
+	} else {
+		rv = wait_event_timeout(xfer->wq,
+			(xfer->state != TRANSFER_STATE_SUBMITTED),
+			msecs_to_jiffies(timeout_ms));
+	}
+
+	spin_lock_irqsave(&engine->lock, flags);
+
+	switch(xfer->state) {
+	case TRANSFER_STATE_COMPLETED:
+		spin_unlock_irqrestore(&engine->lock, flags);
+
+		dbg_tfr("transfer %p, %u, ep 0x%llx compl.\n",
+			xfer, xfer->len, ep_addr);
+		rv = 0;
+		break;
+	case TRANSFER_STATE_FAILED:
+		pr_info("xfer 0x%p,%u, failed, ep 0x%llx.\n",
+			 xfer, xfer->len, ep_addr);
+		spin_unlock_irqrestore(&engine->lock, flags);
+
+#ifdef __LIBXDMA_DEBUG__
+		transfer_dump(xfer);
+		if (xfer->sgt)
+			sgt_dump(xfer->sgt);
+#endif
+		rv = -EIO;
+		break;
+	default:
+		if (!poll && rv == -ERESTARTSYS) {
+			pr_info("xfer 0x%p,%u, canceled, ep 0x%llx.\n",
+				xfer, xfer->len, ep_addr);
+			spin_unlock_irqrestore(&engine->lock, flags);
+			wait_event_timeout(xfer->wq, (xfer->state !=
+				TRANSFER_STATE_SUBMITTED),
+				msecs_to_jiffies(timeout_ms));
+			xdma_engine_stop(engine);
+			break;
+		}
+		/* transfer can still be in-flight */
+		pr_info("xfer 0x%p,%u, s 0x%x timed out, ep 0x%llx.\n",
+			 xfer, xfer->len, xfer->state, ep_addr);
+		engine_status_read(engine, 0, 1);
+		//engine_status_dump(engine);
+		transfer_abort(engine, xfer);
+
+		xdma_engine_stop(engine);
+		spin_unlock_irqrestore(&engine->lock, flags);
+
+#ifdef __LIBXDMA_DEBUG__
+		transfer_dump(xfer);
+		if (xfer->sgt)
+			sgt_dump(xfer->sgt);
+#endif
+		rv = -ERESTARTSYS;
+		break;
+	}
+
+	return rv;
+}
+
 ssize_t xdma_xfer_submit(void *dev_hndl, int channel, bool write, u64 ep_addr,
 			struct sg_table *sgt, bool dma_mapped, int timeout_ms)
+{
+	return xdma_xfer_submit_flags(dev_hndl, channel, write, ep_addr, sgt,
+		dma_mapped, timeout_ms, 0);
+}
+
+ssize_t xdma_xfer_submit_flags(void *dev_hndl, int channel, bool write,
+			u64 ep_addr, struct sg_table *sgt, bool dma_mapped,
+			int timeout_ms, u32 flags)
 {
 	struct xdma_dev *xdev = (struct xdma_dev *)dev_hndl;
 	struct xdma_engine *engine;
@@ -2956,6 +3089,7 @@ ssize_t xdma_xfer_submit(void *dev_hndl, int channel, bool write, u64 ep_addr,
 	int nents;
 	enum dma_data_direction dir = write ? DMA_TO_DEVICE : DMA_FROM_DEVICE;
 	struct xdma_request_cb *req = NULL;
+	bool poll = poll_mode;
 
 	if (!dev_hndl)
 		return -EINVAL;
@@ -3018,10 +3152,15 @@ ssize_t xdma_xfer_submit(void *dev_hndl, int channel, bool write, u64 ep_addr,
 	dbg_tfr("%s, len %u sg cnt %u.\n",
 		engine->name, req->total_len, req->sw_desc_cnt);
 
+	/* per request polling requires the writeback buffer */
+	if (!poll && engine->poll_mode_addr_virt &&
+	    ((flags & XDMA_XFER_FLAG_POLL) ||
+	     (poll_threshold && req->total_len <= poll_threshold)))
+		poll = true;
+
 	sg = sgt->sgl;
 	nents = req->sw_desc_cnt;
 	while (nents) {
-		unsigned long flags;
 		struct xdma_transfer *xfer;
 
 		/* one transfer at a time */
@@ -3045,6 +3184,8 @@ ssize_t xdma_xfer_submit(void *dev_hndl, int channel, bool write, u64 ep_addr,
 
 		if (!dma_mapped)
 			xfer->flags = XFER_FLAG_NEED_UNMAP;
+		if (poll)
+			xfer->flags |= XFER_FLAG_POLL;
 
 		/* last transfer for the given request? */
 		nents -= xfer->desc_num;
@@ -3072,77 +3213,10 @@ ssize_t xdma_xfer_submit(void *dev_hndl, int channel, bool write, u64 ep_addr,
 			goto unmap_sgl;
 		}
 
-		/*
-		 * When polling, determine how many descriptors have been queued		 * on the engine to determine the writeback value expected
-		 */
-		if (poll_mode) {
-			unsigned int desc_count;
-
-			spin_lock_irqsave(&engine->lock, flags);
-                        desc_count = xfer->desc_num;
-			spin_unlock_irqrestore(&engine->lock, flags);
-
-                        dbg_tfr("%s poll desc_count=%d\n",
-				engine->name, desc_count);
-			rv = engine_service_poll(engine, desc_count);
-
-		} else {
-			rv = wait_event_timeout(xfer->wq,
-                	        (xfer->state != TRANSFER_STATE_SUBMITTED),
-				msecs_to_jiffies(timeout_ms));
-		}
-
-		spin_lock_irqsave(&engine->lock, flags);
-
-		switch(xfer->state) {
-		case TRANSFER_STATE_COMPLETED:
-			spin_unlock_irqrestore(&engine->lock, flags);
-
-			dbg_tfr("transfer %p, %u, ep 0x%llx compl, +%lu.\n",
-				xfer, xfer->len, req->ep_addr - xfer->len, done);
+		rv = transfer_wait(engine, xfer, req->ep_addr - xfer->len, poll,
+				timeout_ms);
+		if (!rv)
 			done += xfer->len;
-			rv = 0;
-			break;
-		case TRANSFER_STATE_FAILED:
-			pr_info("xfer 0x%p,%u, failed, ep 0x%llx.\n",
-				 xfer, xfer->len, req->ep_addr - xfer->len);
-			spin_unlock_irqrestore(&engine->lock, flags);
-
-#ifdef __LIBXDMA_DEBUG__
-			transfer_dump(xfer);
-			sgt_dump(sgt);
-#endif
-			rv = -EIO;
-			break;
-		default:
-			if (!poll_mode && rv == -ERESTARTSYS) {
-				pr_info("xfer 0x%p,%u, canceled, ep 0x%llx.\n",
-					xfer, xfer->len,
-					req->ep_addr - xfer->len);
-				spin_unlock_irqrestore(&engine->lock, flags);
-				wait_event_timeout(xfer->wq, (xfer->state !=
-					TRANSFER_STATE_SUBMITTED),
-					msecs_to_jiffies(timeout_ms));
-				xdma_engine_stop(engine);
-				break;
-			}
-			/* transfer can still be in-flight */
-			pr_info("xfer 0x%p,%u, s 0x%x timed out, ep 0x%llx.\n",
-				 xfer, xfer->len, xfer->state, req->ep_addr - xfer->len);
-			engine_status_read(engine, 0, 1);
-			//engine_status_dump(engine);
-			transfer_abort(engine, xfer);
-
-			xdma_engine_stop(engine);
-			spin_unlock_irqrestore(&engine->lock, flags);
-
-#ifdef __LIBXDMA_DEBUG__
-			transfer_dump(xfer);
-			sgt_dump(sgt);
-#endif
-			rv = -ERESTARTSYS;
-			break;
-		}
 		transfer_destroy(xdev, xfer);
 #ifndef CONFIG_PREEMPT_COUNT
 			spin_unlock(&engine->desc_lock);
@@ -3169,6 +3243,220 @@ unmap_sgl:
 	return done;
 }
 EXPORT_SYMBOL_GPL(xdma_xfer_submit);
+EXPORT_SYMBOL_GPL(xdma_xfer_submit_flags);
+
+/*
+ * Pre-built descriptor chains
+ *
+ * A chain maps a scatter gather table once and keeps one descriptor list
+ * per direction describing the whole table.  Submitting a chain only
+ * queues the already built list on an engine, which saves building the
+ * request and writing the descriptors for every transfer of a buffer
+ * that is synced over and over with the same layout.
+ */
+struct xdma_chain {
+	struct xdma_dev *xdev;
+	struct sg_table *sgt;
+	unsigned int len;
+	unsigned int desc_num;
+	size_t desc_size;
+	/* one transfer per direction, indexed by write */
+	struct mutex lock[2];
+	struct xdma_transfer xfer[2];
+};
+
+static void chain_desc_free(struct xdma_chain *chain)
+{
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		if (!chain->xfer[i].desc_virt)
+			continue;
+		dma_free_coherent(&chain->xdev->pdev->dev, chain->desc_size,
+			chain->xfer[i].desc_virt, chain->xfer[i].desc_bus);
+	}
+}
+
+void *xdma_chain_create(void *dev_hndl, u64 ep_addr, struct sg_table *sgt)
+{
+	struct xdma_dev *xdev = (struct xdma_dev *)dev_hndl;
+	struct xdma_request_cb *req = NULL;
+	struct xdma_chain *chain;
+	int nents;
+	int rv = 0;
+	int i, j;
+
+	if (!dev_hndl)
+		return ERR_PTR(-EINVAL);
+
+	if (debug_check_dev_hndl(__func__, xdev->pdev, dev_hndl) < 0)
+		return ERR_PTR(-EINVAL);
+
+	chain = kzalloc(sizeof(*chain), GFP_KERNEL);
+	if (!chain)
+		return ERR_PTR(-ENOMEM);
+	chain->xdev = xdev;
+	chain->sgt = sgt;
+
+	nents = pci_map_sg(xdev->pdev, sgt->sgl, sgt->orig_nents,
+		DMA_BIDIRECTIONAL);
+	if (!nents) {
+		pr_info("map sgl failed, sgt 0x%p.\n", sgt);
+		kfree(chain);
+		return ERR_PTR(-EIO);
+	}
+	sgt->nents = nents;
+
+	req = xdma_init_request(sgt, ep_addr);
+	if (!req) {
+		rv = -ENOMEM;
+		goto fail;
+	}
+
+	/* a chain is queued as a single transfer */
+	if (req->sw_desc_cnt > XDMA_TRANSFER_MAX_DESC) {
+		rv = -E2BIG;
+		goto fail;
+	}
+	chain->len = req->total_len;
+	chain->desc_num = req->sw_desc_cnt;
+	chain->desc_size = chain->desc_num * sizeof(struct xdma_desc);
+
+	for (i = 0; i < 2; i++) {
+		struct xdma_transfer *xfer = &chain->xfer[i];
+		u64 addr = ep_addr;
+
+		mutex_init(&chain->lock[i]);
+		xfer->dir = i ? DMA_TO_DEVICE : DMA_FROM_DEVICE;
+		xfer->desc_virt = dma_alloc_coherent(&xdev->pdev->dev,
+			chain->desc_size, &xfer->desc_bus, GFP_KERNEL);
+		if (!xfer->desc_virt) {
+			rv = -ENOMEM;
+			goto fail;
+		}
+
+		transfer_desc_init(xfer, chain->desc_num);
+		for (j = 0; j < chain->desc_num; j++) {
+			xdma_desc_set(xfer->desc_virt + j, req->sdesc[j].addr,
+				addr, req->sdesc[j].len, xfer->dir);
+			addr += req->sdesc[j].len;
+		}
+		transfer_desc_finish(xfer, chain->desc_num);
+	}
+
+	xdma_request_free(req);
+	return chain;
+
+fail:
+	chain_desc_free(chain);
+	if (req)
+		xdma_request_free(req);
+	pci_unmap_sg(xdev->pdev, sgt->sgl, sgt->orig_nents, DMA_BIDIRECTIONAL);
+	sgt->nents = 0;
+	kfree(chain);
+	return ERR_PTR(rv);
+}
+EXPORT_SYMBOL_GPL(xdma_chain_create);
+
+void xdma_chain_free(void *dev_hndl, void *chain_hndl)
+{
+	struct xdma_chain *chain = chain_hndl;
+	struct sg_table *sgt;
+
+	if (!chain)
+		return;
+
+	sgt = chain->sgt;
+	chain_desc_free(chain);
+	pci_unmap_sg(chain->xdev->pdev, sgt->sgl, sgt->orig_nents,
+		DMA_BIDIRECTIONAL);
+	sgt->nents = 0;
+	kfree(chain);
+}
+EXPORT_SYMBOL_GPL(xdma_chain_free);
+
+ssize_t xdma_chain_submit(void *dev_hndl, void *chain_hndl, int channel,
+			bool write, int timeout_ms, u32 flags)
+{
+	struct xdma_dev *xdev = (struct xdma_dev *)dev_hndl;
+	struct xdma_chain *chain = chain_hndl;
+	struct xdma_engine *engine;
+	struct xdma_transfer *xfer;
+	bool poll = poll_mode;
+	int rv;
+
+	if (!dev_hndl || !chain)
+		return -EINVAL;
+
+	if (write) {
+		if (channel >= xdev->h2c_channel_max)
+			return -EINVAL;
+		engine = &xdev->engine_h2c[channel];
+	} else {
+		if (channel >= xdev->c2h_channel_max)
+			return -EINVAL;
+		engine = &xdev->engine_c2h[channel];
+	}
+
+	BUG_ON(engine->magic != MAGIC_ENGINE);
+
+	/* the chain was built with incrementing end point addresses */
+	if (engine->non_incr_addr)
+		return -EINVAL;
+
+	if (xdma_device_flag_check(xdev, XDEV_FLAG_OFFLINE)) {
+		pr_info("xdev 0x%p, offline.\n", xdev);
+		return -EBUSY;
+	}
+
+	if (!poll && engine->poll_mode_addr_virt &&
+	    ((flags & XDMA_XFER_FLAG_POLL) ||
+	     (poll_threshold && chain->len <= poll_threshold)))
+		poll = true;
+
+	pci_dma_sync_sg_for_device(xdev->pdev, chain->sgt->sgl,
+		chain->sgt->orig_nents, DMA_BIDIRECTIONAL);
+
+	/* the chain transfer of a direction is queued at most once */
+	mutex_lock(&chain->lock[write]);
+#ifndef CONFIG_PREEMPT_COUNT
+	spin_lock(&engine->desc_lock);
+#else
+	mutex_lock(&engine->desc_mutex);
+#endif
+
+	xfer = &chain->xfer[write];
+	init_waitqueue_head(&xfer->wq);
+	xfer->state = TRANSFER_STATE_NEW;
+	xfer->desc_adjacent = chain->desc_num;
+	xfer->flags = poll ? XFER_FLAG_POLL : 0;
+	xfer->last_in_request = 1;
+	xfer->len = chain->len;
+	xfer->sgt = chain->sgt;
+
+	rv = transfer_queue(engine, xfer);
+	if (rv < 0)
+		pr_info("unable to submit %s, %d.\n", engine->name, rv);
+	else
+		rv = transfer_wait(engine, xfer, 0, poll, timeout_ms);
+
+#ifndef CONFIG_PREEMPT_COUNT
+	spin_unlock(&engine->desc_lock);
+#else
+	mutex_unlock(&engine->desc_mutex);
+#endif
+	mutex_unlock(&chain->lock[write]);
+
+	if (rv < 0)
+		return rv;
+
+	if (!write)
+		pci_dma_sync_sg_for_cpu(xdev->pdev, chain->sgt->sgl,
+			chain->sgt->orig_nents, DMA_BIDIRECTIONAL);
+
+	return chain->len;
+}
+EXPORT_SYMBOL_GPL(xdma_chain_submit);
 
 int xdma_performance_submit(struct xdma_dev *xdev, struct xdma_engine *engine)
 {
@@ -3940,7 +4228,7 @@ static int transfer_monitor_cyclic(struct xdma_engine *engine,
 	if (poll_mode) {
 		int i ;
 		for (i = 0; i < 5; i++) {
-			rc = engine_service_poll(engine, 0);
+			rc = engine_service_poll(engine, 0, false);
 			if (rc) {
 				pr_info("%s service_poll failed %d.\n",
 					engine->name, rc);
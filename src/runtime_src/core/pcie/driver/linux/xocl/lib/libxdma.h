@@ -47,6 +47,9 @@
 
 /* Use this definition to poll several times between calls to schedule */
 #define NUM_POLLS_PER_SCHED 100
+/* per request polling, spin time before sleeping and max sleep */
+#define POLL_SPIN_US		50
+#define POLL_SLEEP_MAX_US	1000
 
 #define XDMA_CHANNEL_NUM_MAX (4)
 /*
@@ -397,6 +400,7 @@ struct xdma_transfer {
 	enum transfer_state state;	/* state of the transfer */
 	unsigned int flags;
 #define XFER_FLAG_NEED_UNMAP	0x1
+#define XFER_FLAG_POLL		0x2
 	int cyclic;			/* flag if transfer is cyclic */
 	int last_in_request;		/* flag if last within request */
 	unsigned int len;
@@ -150,6 +150,38 @@ int xdma_user_isr_disable(void *dev_hndl, unsigned int mask);
  */
 ssize_t xdma_xfer_submit(void *dev_hndl, int channel, bool write, u64 ep_addr,
 			struct sg_table *sgt, bool dma_mapped, int timeout_ms);
+
+/*
+ * xdma_xfer_submit_flags - same as xdma_xfer_submit with XDMA_XFER_FLAG_XXX
+ * flags
+ *
+ * XDMA_XFER_FLAG_POLL polls for completion of this request instead of
+ * waiting for the completion interrupt; the poll spins briefly and then
+ * backs off sleeping.  Requests no larger than the poll_threshold module
+ * parameter are always polled.
+ */
+#define XDMA_XFER_FLAG_POLL	0x1
+ssize_t xdma_xfer_submit_flags(void *dev_hndl, int channel, bool write,
+			u64 ep_addr, struct sg_table *sgt, bool dma_mapped,
+			int timeout_ms, u32 flags);
+
+/*
+ * xdma_chain_create - map a scatter gather table once and pre-build the
+ *	descriptor lists transferring the whole table to or from ep_addr
+ * return an opaque chain handle or ERR_PTR(), -E2BIG if the table needs
+ *	more descriptors than a single transfer can carry
+ * the table stays dma mapped until xdma_chain_free
+ */
+void *xdma_chain_create(void *dev_hndl, u64 ep_addr, struct sg_table *sgt);
+void xdma_chain_free(void *dev_hndl, void *chain_hndl);
+
+/*
+ * xdma_chain_submit - transfer a pre-built chain, blocking call
+ * @flags: XDMA_XFER_FLAG_XXX
+ * return # of bytes transfered or < 0 in case of error
+ */
+ssize_t xdma_chain_submit(void *dev_hndl, void *chain_hndl, int channel,
+			bool write, int timeout_ms, u32 flags);
 			
 /*
  * xdma_device_online - bring device offline
@@ -43,6 +43,11 @@ module_param(health_interval, int, (S_IRUGO|S_IWUSR));
 MODULE_PARM_DESC(health_interval,
 	"Interval (in sec) after which the health thread is run. (1 = Minimum, 5 = default)");
 
+int health_interval_max = 60;
+module_param(health_interval_max, int, (S_IRUGO|S_IWUSR));
+MODULE_PARM_DESC(health_interval_max,
+	"Interval (in sec) the health thread backs off to while the device is healthy. (<= health_interval disables back off, 60 = default)");
+
 int health_check = 1;
 module_param(health_check, int, (S_IRUGO|S_IWUSR));
 MODULE_PARM_DESC(health_check,
@@ -393,25 +398,31 @@ struct pci_dev *find_user_node(const struct pci_dev *pdev)
 	return user_dev;
 }
 
-inline void check_temp_within_range(struct xclmgmt_dev *lro, u32 temp)
+inline bool check_temp_within_range(struct xclmgmt_dev *lro, u32 temp)
 {
 	if (temp < LOW_TEMP || temp > HI_TEMP) {
 		mgmt_err(lro, "Temperature outside normal range (%d-%d) %d.",
 			LOW_TEMP, HI_TEMP, temp);
+		return false;
 	}
+	return true;
 }
 
-inline void check_volt_within_range(struct xclmgmt_dev *lro, u16 volt)
+inline bool check_volt_within_range(struct xclmgmt_dev *lro, u16 volt)
 {
 	if (volt != 0 && (volt < LOW_MILLVOLT || volt > HI_MILLVOLT)) {
 		mgmt_err(lro, "Voltage outside normal range (%d-%d)mV %d.",
 			LOW_MILLVOLT, HI_MILLVOLT, volt);
+		return false;
 	}
+	return true;
 }
 
-static void check_sensor(struct xclmgmt_dev *lro)
+/* Returns false if any sensor is out of range. */
+static bool check_sensor(struct xclmgmt_dev *lro)
 {
 	int ret;
+	bool ok = true;
 	struct xcl_sensor s = { 0 };
 
 	ret = xocl_xmc_get_data(lro, &s);
@@ -427,10 +438,12 @@ static void check_sensor(struct xclmgmt_dev *lro)
 			XOCL_SYSMON_PROP_VCC_BRAM, &s.vol_0v85);
 	}
 
-	check_temp_within_range(lro, s.fpga_temp);
-	check_volt_within_range(lro, s.vccint_vol);
-	check_volt_within_range(lro, s.vol_1v8);
-	check_volt_within_range(lro, s.vol_0v85);
+	ok &= check_temp_within_range(lro, s.fpga_temp);
+	ok &= check_volt_within_range(lro, s.vccint_vol);
+	ok &= check_volt_within_range(lro, s.vol_1v8);
+	ok &= check_volt_within_range(lro, s.vol_0v85);
+
+	return ok;
 }
 
 static int health_check_cb(void *data)
@@ -445,10 +458,12 @@ static int health_check_cb(void *data)
 	tripped = xocl_af_check(lro, NULL);
 
 	if (!tripped) {
-		check_sensor(lro);
+		if (!check_sensor(lro))
+			return 1;
 	} else {
 		mgmt_info(lro, "firewall tripped, notify peer");
 		(void) xocl_peer_notify(lro, &mbreq, sizeof(struct mailbox_req));
+		return 1;
 	}
 
 	return 0;
@@ -762,6 +777,12 @@ void xclmgmt_mailbox_srv(void *arg, void *data, size_t len,
 	if (err != 0)
 		return;
 
+	/*
+	 * Peer activity usually means a workload is (re)starting. Check the
+	 * device now instead of waiting out a backed off interval.
+	 */
+	health_thread_kick(lro);
+
 	if (xocl_mailbox_get(lro, CHAN_SWITCH, &ch_switch) != 0)
 		return;
 
@@ -1000,6 +1021,8 @@ static void xclmgmt_extended_probe(struct xclmgmt_dev *lro)
 	lro->core.thread_arg.health_cb = health_check_cb;
 	lro->core.thread_arg.arg = lro;
 	lro->core.thread_arg.interval = health_interval * 1000;
+	lro->core.thread_arg.max_interval = health_interval_max > 0 ?
+		health_interval_max * 1000 : 0;
 	health_thread_start(lro);
 
 	/* Launch the mailbox server. */
@@ -1219,6 +1242,10 @@ static struct pci_driver xclmgmt_driver = {
 	.remove = xclmgmt_remove,
 	/* resume, suspend are optional */
 	.err_handler = &xclmgmt_err_handler,
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 2, 0)
+	/* Cards are independent; let several of them probe concurrently. */
+	.driver.probe_type = PROBE_PREFER_ASYNCHRONOUS,
+#endif
 };
 
 static int (*drv_reg_funcs[])(void) __initdata = {
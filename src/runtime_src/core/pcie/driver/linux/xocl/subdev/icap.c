@@ -22,6 +22,7 @@
 #include <linux/pid.h>
 #include <linux/key.h>
 #include <linux/efi.h>
+#include <linux/crc32.h>
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 7, 0)
 #include <linux/verification.h>
 #endif
@@ -37,6 +38,11 @@ static xuid_t uuid_null = NULL_UUID_LE;
 static DEFINE_MUTEX(icap_keyring_lock);
 static struct key *icap_keys;
 
+static uint xclbin_cache_mb = 256;
+module_param(xclbin_cache_mb, uint, (S_IRUGO|S_IWUSR));
+MODULE_PARM_DESC(xclbin_cache_mb,
+	"MB of recently downloaded xclbins kept on user pf for reloading by UUID, 0 disables (default 256)");
+
 #define	ICAP_ERR(icap, fmt, arg...)	\
 	xocl_err(&(icap)->icap_pdev->dev, fmt "\n", ##arg)
 #define	ICAP_INFO(icap, fmt, arg...)	\
@@ -123,6 +129,13 @@ struct icap_bitstream_user {
 	pid_t			ibu_pid;
 };
 
+/* An xclbin kept for reloading by UUID, see icap_cache_xclbin() */
+struct icap_cached_xclbin {
+	struct list_head	icx_list;
+	xuid_t			icx_uuid;
+	struct axlf		*icx_xclbin;
+};
+
 struct icap {
 	struct platform_device	*icap_pdev;
 	struct mutex		icap_lock;
@@ -134,6 +147,13 @@ struct icap {
 
 	u64			icap_bitstream_id;
 	xuid_t			icap_bitstream_uuid;
+	/*
+	 * CRC of sections programmed into the device, lets xclbins that
+	 * differ only in metadata skip reprogramming and calibration
+	 */
+	bool			icap_crc_valid;
+	u32			icap_bitstream_crc;
+	u32			icap_clock_crc;
 	int			icap_bitstream_ref;
 	struct list_head	icap_bitstream_users;
 
@@ -162,6 +182,10 @@ struct icap {
 	ktime_t			cache_expires;
 
 	enum icap_sec_level	sec_level;
+
+	/* Most recently used first, protected by icap_lock */
+	struct list_head	icap_xclbin_cache;
+	size_t			icap_xclbin_cache_sz;
 };
 
 static inline u32 reg_rd(void __iomem *reg)
@@ -784,6 +808,8 @@ static int icap_ocl_set_freqscaling(struct platform_device *pdev,
 	mutex_lock(&icap->icap_lock);
 
 	err = set_freqs(icap, freqs, num_freqs);
+	/* clocks no longer match CLOCK_FREQ_TOPOLOGY of loaded xclbin */
+	icap->icap_clock_crc = ~0U;
 
 	mutex_unlock(&icap->icap_lock);
 
@@ -1973,6 +1999,7 @@ static void icap_clean_bitstream_axlf(struct platform_device *pdev)
 	struct icap *icap = platform_get_drvdata(pdev);
 
 	icap->icap_bitstream_id = 0;
+	icap->icap_crc_valid = false;
 	uuid_copy(&icap->icap_bitstream_uuid, &uuid_null);
 	icap_clean_axlf_section(icap, IP_LAYOUT);
 	icap_clean_axlf_section(icap, MEM_TOPOLOGY);
@@ -1980,6 +2007,95 @@ static void icap_clean_bitstream_axlf(struct platform_device *pdev)
 	icap_clean_axlf_section(icap, CONNECTIVITY);
 }
 
+static void icap_xclbin_uuid(const struct axlf *xclbin, xuid_t *uuid)
+{
+	if (!uuid_is_null(&xclbin->m_header.uuid)) {
+		uuid_copy(uuid, &xclbin->m_header.uuid);
+	} else {
+		/* Legacy xclbin, convert legacy id to new id */
+		memset(uuid, 0, sizeof(*uuid));
+		memcpy(uuid, &xclbin->m_header.m_timeStamp, 8);
+	}
+}
+
+static void icap_free_cached_xclbin(struct icap *icap,
+	struct icap_cached_xclbin *c)
+{
+	icap->icap_xclbin_cache_sz -= c->icx_xclbin->m_header.m_length;
+	list_del(&c->icx_list);
+	vfree(c->icx_xclbin);
+	kfree(c);
+}
+
+/*
+ * Keep a copy of an xclbin that just went through download and verification,
+ * so a later switch back to it can name it by UUID instead of handing the
+ * whole image over again. Least recently used images are dropped once the
+ * cache holds more than xclbin_cache_mb.
+ */
+static void icap_cache_xclbin(struct icap *icap, const struct axlf *xclbin)
+{
+	struct icap_cached_xclbin *c, *tmp;
+	size_t limit = (size_t)xclbin_cache_mb << 20;
+	uint64_t len = xclbin->m_header.m_length;
+	xuid_t uuid;
+
+	BUG_ON(!mutex_is_locked(&icap->icap_lock));
+
+	icap_xclbin_uuid(xclbin, &uuid);
+	list_for_each_entry(c, &icap->icap_xclbin_cache, icx_list) {
+		if (uuid_equal(&c->icx_uuid, &uuid)) {
+			list_move(&c->icx_list, &icap->icap_xclbin_cache);
+			return;
+		}
+	}
+
+	if (len <= limit) {
+		c = kzalloc(sizeof(*c), GFP_KERNEL);
+		if (c)
+			c->icx_xclbin = vmalloc(len);
+		if (c && c->icx_xclbin) {
+			memcpy(c->icx_xclbin, xclbin, len);
+			uuid_copy(&c->icx_uuid, &uuid);
+			list_add(&c->icx_list, &icap->icap_xclbin_cache);
+			icap->icap_xclbin_cache_sz += len;
+		} else {
+			kfree(c);
+		}
+	}
+
+	list_for_each_entry_safe_reverse(c, tmp, &icap->icap_xclbin_cache,
+		icx_list) {
+		if (icap->icap_xclbin_cache_sz <= limit)
+			break;
+		icap_free_cached_xclbin(icap, c);
+	}
+}
+
+/* Returns a copy of the cached xclbin with @uuid, caller vfree()s it. */
+static struct axlf *icap_get_cached_axlf(struct platform_device *pdev,
+	const xuid_t *uuid)
+{
+	struct icap *icap = platform_get_drvdata(pdev);
+	struct icap_cached_xclbin *c;
+	struct axlf *xclbin = NULL;
+
+	mutex_lock(&icap->icap_lock);
+	list_for_each_entry(c, &icap->icap_xclbin_cache, icx_list) {
+		if (!uuid_equal(&c->icx_uuid, uuid))
+			continue;
+		xclbin = vmalloc(c->icx_xclbin->m_header.m_length);
+		if (xclbin) {
+			memcpy(xclbin, c->icx_xclbin,
+				c->icx_xclbin->m_header.m_length);
+		}
+		break;
+	}
+	mutex_unlock(&icap->icap_lock);
+
+	return xclbin;
+}
+
 static int icap_download_bitstream_axlf(struct platform_device *pdev,
 	const void *u_xclbin)
 {
@@ -2007,6 +2123,8 @@ static int icap_download_bitstream_axlf(struct platform_device *pdev,
 	struct mailbox_bitstream_kaddr mb_addr = {0};
 	xuid_t *peer_uuid;
 	uint64_t ch_state = 0;
+	u32 bitstream_crc = 0, clock_crc = 0;
+	bool same_bitstream = false, same_clock = false;
 
 	xocl_mailbox_get(xdev, CHAN_STATE, &ch_state);
 
@@ -2073,6 +2191,20 @@ static int icap_download_bitstream_axlf(struct platform_device *pdev,
 			}
 		}
 
+		/*
+		 * A new xclbin id may still carry the bitstream and clocks
+		 * already on the device, e.g. when only metadata changed.
+		 */
+		bitstream_crc = crc32_le(~0U, (char *)xclbin +
+			primaryFirmwareOffset, primaryFirmwareLength);
+		bitstream_crc = crc32_le(bitstream_crc, (char *)xclbin +
+			secondaryFirmwareOffset, secondaryFirmwareLength);
+		if (clockHeader != NULL) {
+			clock_crc = crc32_le(~0U, (char *)xclbin +
+				clockHeader->m_sectionOffset,
+				clockHeader->m_sectionSize);
+		}
+
 		mutex_lock(&icap->icap_lock);
 
 		if (icap_bitstream_in_use(icap, 0)) {
@@ -2081,9 +2213,15 @@ static int icap_download_bitstream_axlf(struct platform_device *pdev,
 			goto done;
 		}
 
+		if (icap->icap_crc_valid) {
+			same_bitstream = (icap->icap_bitstream_crc == bitstream_crc);
+			same_clock = (icap->icap_clock_crc == clock_crc);
+		}
+		icap->icap_crc_valid = false;
+
 		/* All clear, go ahead and start fiddling with hardware */
 
-		if (clockHeader != NULL) {
+		if (clockHeader != NULL && !same_clock) {
 			uint64_t clockFirmwareOffset = clockHeader->m_sectionOffset;
 			uint64_t clockFirmwareLength = clockHeader->m_sectionSize;
 
@@ -2095,26 +2233,35 @@ static int icap_download_bitstream_axlf(struct platform_device *pdev,
 			err = icap_setup_clock_freq_topology(icap, buffer, clockFirmwareLength);
 			if (err)
 				goto done;
+		} else if (clockHeader != NULL) {
+			ICAP_INFO(icap, "clocks unchanged, skip setting clocks");
 		}
 
-		buffer = (char *)xclbin;
-		buffer += primaryFirmwareOffset;
-		err = icap_download_user(icap, buffer, primaryFirmwareLength);
-		if (err)
-			goto done;
+		if (!same_bitstream) {
+			buffer = (char *)xclbin;
+			buffer += primaryFirmwareOffset;
+			err = icap_download_user(icap, buffer, primaryFirmwareLength);
+			if (err)
+				goto done;
 
-		buffer = (char *)u_xclbin;
-		buffer += secondaryFirmwareOffset;
-		err = icap_setup_clear_bitstream(icap, buffer, secondaryFirmwareLength);
-		if (err)
-			goto done;
+			buffer = (char *)u_xclbin;
+			buffer += secondaryFirmwareOffset;
+			err = icap_setup_clear_bitstream(icap, buffer, secondaryFirmwareLength);
+			if (err)
+				goto done;
 
-		if ((xocl_is_unified(xdev) || XOCL_DSA_XPR_ON(xdev)))
-			err = calibrate_mig(icap);
-		if (err)
-			goto done;
+			if ((xocl_is_unified(xdev) || XOCL_DSA_XPR_ON(xdev)))
+				err = calibrate_mig(icap);
+			if (err)
+				goto done;
+		} else {
+			ICAP_INFO(icap, "bitstream unchanged, skip downloading");
+		}
 		/* Remember "this" bitstream, so avoid redownload the next time. */
 		icap->icap_bitstream_id = xclbin->m_uniqueId;
+		icap->icap_bitstream_crc = bitstream_crc;
+		icap->icap_clock_crc = clock_crc;
+		icap->icap_crc_valid = true;
 		if (!uuid_is_null(&xclbin->m_header.uuid)) {
 			uuid_copy(&icap->icap_bitstream_uuid, &xclbin->m_header.uuid);
 		} else {
@@ -2220,6 +2367,8 @@ static int icap_download_bitstream_axlf(struct platform_device *pdev,
 done:
 	if (err)
 		icap_clean_bitstream_axlf(pdev);
+	else if (!ICAP_PRIVILEGED(icap))
+		icap_cache_xclbin(icap, xclbin);
 	mutex_unlock(&icap->icap_lock);
 	vfree(mb_req);
 	ICAP_INFO(icap, "%s err: %ld", __func__, err);
@@ -2541,6 +2690,7 @@ static int icap_reset_bitstream(struct platform_device *pdev)
 
 	msleep(4000);
 
+	icap->icap_crc_valid = false;
 	mutex_unlock(&icap->icap_lock);
 
 	ICAP_INFO(icap, "reset bitstream is done");
@@ -2867,6 +3017,7 @@ static struct xocl_icap_funcs icap_ops = {
 	.ocl_lock_bitstream = icap_lock_bitstream,
 	.ocl_unlock_bitstream = icap_unlock_bitstream,
 	.get_data = icap_get_data,
+	.get_cached_axlf = icap_get_cached_axlf,
 };
 
 static ssize_t clock_freq_topology_show(struct device *dev,
@@ -2976,6 +3127,26 @@ static ssize_t cache_expire_secs_store(struct device *dev,
 }
 static DEVICE_ATTR_RW(cache_expire_secs);
 
+static ssize_t xclbin_cache_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	struct icap *icap = platform_get_drvdata(to_platform_device(dev));
+	struct icap_cached_xclbin *c;
+	ssize_t cnt = 0;
+
+	mutex_lock(&icap->icap_lock);
+	list_for_each_entry(c, &icap->icap_xclbin_cache, icx_list) {
+		cnt += sprintf(buf + cnt, "%pUb %llu\n", &c->icx_uuid,
+			c->icx_xclbin->m_header.m_length);
+		if (cnt >= PAGE_SIZE - 64)
+			break;
+	}
+	mutex_unlock(&icap->icap_lock);
+
+	return cnt;
+}
+static DEVICE_ATTR_RO(xclbin_cache);
+
 static int icap_verify_signature(struct icap *icap,
 	const void *data, size_t data_len, const void *sig, size_t sig_len)
 {
@@ -3095,6 +3266,7 @@ static struct attribute *icap_attrs[] = {
 	&dev_attr_idcode.attr,
 	&dev_attr_cache_expire_secs.attr,
 	&dev_attr_sec_level.attr,
+	&dev_attr_xclbin_cache.attr,
 	NULL,
 };
 
@@ -3310,11 +3482,15 @@ static void icap_release_keyring(void)
 static int icap_remove(struct platform_device *pdev)
 {
 	struct icap *icap = platform_get_drvdata(pdev);
+	struct icap_cached_xclbin *c, *tmp;
 
 	BUG_ON(icap == NULL);
 
 	del_all_users(icap);
 
+	list_for_each_entry_safe(c, tmp, &icap->icap_xclbin_cache, icx_list)
+		icap_free_cached_xclbin(icap, c);
+
 	if (icap->rp_bit)
 		vfree(icap->rp_bit);
 	if (icap->rp_fdt)
@@ -3388,6 +3564,7 @@ static int icap_probe(struct platform_device *pdev)
 	icap->icap_pdev = pdev;
 	mutex_init(&icap->icap_lock);
 	INIT_LIST_HEAD(&icap->icap_bitstream_users);
+	INIT_LIST_HEAD(&icap->icap_xclbin_cache);
 
 	regs = (void **)&icap->icap_regs;
 	res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
@@ -90,6 +90,17 @@
  * provided.
  *
  *
+ * Burst mode
+ *
+ * Waiting for an interrupt (or a timer tick in polling mode) between every
+ * packet of a multi-packet msg makes large msgs slow. Once a msg is in flight,
+ * the TX and RX threads poll the HW status for the next packet for up to
+ * mailbox_burst_us between packets before going back to sleep. When the peer
+ * keeps up, a whole msg moves in one burst without any wake-up in between.
+ * The per-packet interrupts raised meanwhile only cause a few extra, empty
+ * worker passes.
+ *
+ *
  * Communication layer
  *
  * At the highest layer, the driver implements a request-response communication
@@ -206,6 +217,11 @@ module_param(mailbox_no_intr, int, (S_IRUGO|S_IWUSR));
 MODULE_PARM_DESC(mailbox_no_intr,
 	"Disable mailbox interrupt and do timer-driven msg passing");
 
+static uint mailbox_burst_us = 100;
+module_param(mailbox_burst_us, uint, (S_IRUGO|S_IWUSR));
+MODULE_PARM_DESC(mailbox_burst_us,
+	"Usecs to poll HW for the next packet of a msg in flight, 0 disables (default 100)");
+
 #define	PACKET_SIZE	16 /* Number of DWORD. */
 
 #define	FLAG_STI	(1 << 0)
@@ -1040,25 +1056,52 @@ static void do_sw_rx(struct mailbox_channel *ch)
 	chan_msg_done(ch, 0);
 }
 
-static void do_hw_rx(struct mailbox_channel *ch)
+/*
+ * Spin for up to mailbox_burst_us waiting for the HW to be ready for the next
+ * packet of the msg in flight.
+ */
+static bool chan_burst_wait(struct mailbox_channel *ch,
+	bool (*ready)(struct mailbox_channel *))
+{
+	ktime_t deadline;
+
+	if (mailbox_burst_us == 0)
+		return false;
+
+	cond_resched();
+	deadline = ktime_add_us(ktime_get(), mailbox_burst_us);
+	do {
+		if (test_bit(MBXCS_BIT_STOP, &ch->mbc_state))
+			return false;
+		if (ready(ch))
+			return true;
+		cpu_relax();
+	} while (ktime_before(ktime_get(), deadline));
+
+	return false;
+}
+
+/* Check if a packet is ready for reading. */
+static bool is_rx_chan_ready(struct mailbox_channel *ch)
 {
 	struct mailbox *mbx = ch->mbc_parent;
-	struct mailbox_pkt *pkt = &ch->mbc_packet;
-	u32 type;
-	bool eom = false, read_hw = false;
 	u32 st = mailbox_reg_rd(mbx, &mbx->mbx_regs->mbr_status);
 
-	/* Check if a packet is ready for reading. */
 	if (st == 0xffffffff) {
 		/* Device is still being reset. */
-		read_hw = false;
+		return false;
 	} else if (test_bit(MBXCS_BIT_POLL_MODE, &ch->mbc_state)) {
-		read_hw = ((st & STATUS_EMPTY) == 0);
-	} else {
-		read_hw = ((st & STATUS_RTA) != 0);
+		return ((st & STATUS_EMPTY) == 0);
 	}
-	if (!read_hw)
-		return;
+	return ((st & STATUS_RTA) != 0);
+}
+
+static void do_hw_rx_pkt(struct mailbox_channel *ch)
+{
+	struct mailbox *mbx = ch->mbc_parent;
+	struct mailbox_pkt *pkt = &ch->mbc_packet;
+	u32 type;
+	bool eom = false;
 
 	chan_recv_pkt(ch);
 	type = pkt->hdr.type & PKT_TYPE_MASK;
@@ -1106,6 +1149,19 @@ static void do_hw_rx(struct mailbox_channel *ch)
 	}
 }
 
+static void do_hw_rx(struct mailbox_channel *ch)
+{
+	if (!is_rx_chan_ready(ch))
+		return;
+
+	do_hw_rx_pkt(ch);
+
+	/* Pick up the rest of the msg while the peer is pushing it. */
+	while (ch->mbc_cur_msg && !ch->mbc_cur_msg->mbm_chan_sw &&
+		chan_burst_wait(ch, is_rx_chan_ready))
+		do_hw_rx_pkt(ch);
+}
+
 static void handle_timer_event(struct mailbox_channel *ch)
 {
 	if (!test_bit(MBXCS_BIT_TICK, &ch->mbc_state))
@@ -1258,10 +1314,16 @@ static void chan_do_tx(struct mailbox_channel *ch)
 
 		if (ch->mbc_cur_msg) {
 			/* Sending msg. */
-			if (ch->mbc_cur_msg->mbm_chan_sw)
+			if (ch->mbc_cur_msg->mbm_chan_sw) {
 				do_sw_tx(ch);
-			else
+			} else {
 				do_hw_tx(ch);
+				/* Push the rest as fast as the peer drains. */
+				while (ch->mbc_cur_msg->mbm_len !=
+					ch->mbc_bytes_done &&
+					chan_burst_wait(ch, is_tx_chan_ready))
+					do_hw_tx(ch);
+			}
 		} else if (valid_pkt(&mbx->mbx_tst_pkt)) {
 			/* Sending test pkt. */
 			(void) memcpy(&ch->mbc_packet, &mbx->mbx_tst_pkt,
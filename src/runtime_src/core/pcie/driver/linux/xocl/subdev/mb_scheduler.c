@@ -61,8 +61,11 @@
 #include <linux/list.h>
 #include <linux/eventfd.h>
 #include <linux/kthread.h>
+#include <linux/vmalloc.h>
+#include <linux/hrtimer.h>
 #include <ert.h>
 #include "../xocl_drv.h"
+#include "../xocl_trace.h"
 #include "../userpf/common.h"
 
 //#define SCHED_VERBOSE
@@ -96,6 +99,9 @@
 #define csr_write32(val, base, r_off)		\
 	iowrite32((val), (base) + (r_off) - ERT_CSR_ADDR)
 
+/* Command latency histogram, bucket n counts latencies in [2^(n-1),2^n) us */
+#define KDS_LATENCY_BUCKETS	16
+
 /* Highest bit in ip_reference indicate if it's exclusively reserved. */
 #define	IP_EXCL_RSVD_MASK	(~(1 << 31))
 
@@ -109,6 +115,10 @@ static const u32 AP_IDLE     = 0x4;
 static const u32 AP_READY    = 0x8;
 static const u32 AP_CONTINUE = 0x10;
 
+/* CU interrupt registers, AP_DONE is bit 0 */
+static const u32 CU_IER_OFFSET = 0x8;
+static const u32 CU_ISR_OFFSET = 0xC;
+
 /* Forward declaration */
 struct exec_core;
 struct exec_ops;
@@ -121,6 +131,8 @@ static void exec_ert_clear_csr(struct exec_core *exec);
 static void scheduler_wake_up(struct xocl_scheduler *xs);
 static void scheduler_intr(struct xocl_scheduler *xs);
 static void scheduler_decr_poll(struct xocl_scheduler *xs);
+static unsigned long scheduler_iteration(struct xocl_scheduler *xs);
+static void scheduler_spin(struct xocl_scheduler *xs, ktime_t deadline);
 
 /*
  */
@@ -202,6 +214,7 @@ slot_idx_in_mask(unsigned int slot_idx)
  * @chain: list of commands to trigger upon completion; maximum chain depth is 8
  * @deps: list of commands this object depends on, converted to chain when command is queued
  * @packet: mapped ert packet object from user space
+ * @handle: user space handle of @bo, recorded in client done fifo upon completion
  */
 
 struct xocl_cmd {
@@ -234,39 +247,20 @@ struct xocl_cmd {
 	};
 
 	unsigned long uid;     // unique id for this command
+	ktime_t start;         // time command was started on device
+	struct ert_cmd_timestamps *ts; // phase timestamps in exec bo if enabled
 	unsigned int cu_idx;   // index of CU running this cmd (penguin mode)
 	unsigned int slot_idx; // index in exec core submit queue
+	u32 handle;            // user space exec bo handle
+	bool admitted;         // moved from pending list to scheduler queue
 };
 
 /*
- * List of free xocl_cmd objects.
- *
- * @free_cmds: populated with recycled xocl_cmd objects
- * @cmd_mutex: mutex lock for cmd_list
- *
- * Command objects are recycled for later use and only freed when kernel
- * module is unloaded.
+ * Command objects are allocated from a slab cache of the device, see
+ * exec_core.  Freed objects stay in the per CPU slabs of the cache, so
+ * allocation and free do not contend across devices and CPUs.
  */
-static LIST_HEAD(free_cmds);
-static DEFINE_MUTEX(free_cmds_mutex);
-
-/**
- * delete_cmd_list() - reclaim memory for all allocated command objects
- */
-static void
-cmd_list_delete(void)
-{
-	struct xocl_cmd *xcmd;
-	struct list_head *pos, *next;
-
-	mutex_lock(&free_cmds_mutex);
-	list_for_each_safe(pos, next, &free_cmds) {
-		xcmd = list_entry(pos, struct xocl_cmd, cq_list);
-		list_del(pos);
-		kfree(xcmd);
-	}
-	mutex_unlock(&free_cmds_mutex);
-}
+static struct kmem_cache *exec_cmd_cache(struct exec_core *exec);
 
 /*
  * opcode() - Command opcode
@@ -382,6 +376,55 @@ cmd_regmap(struct xocl_cmd *xcmd)
 	return xcmd->ert_cu->data + xcmd->ert_cu->extra_cu_masks;
 }
 
+/**
+ * cmd_priority() - Check if CU command is high priority
+ *
+ * High priority commands are iterated before other commands in the
+ * scheduler, see scheduler_iterate_cmds().
+ */
+static inline bool
+cmd_priority(struct xocl_cmd *xcmd)
+{
+	u32 opcode = cmd_opcode(xcmd);
+
+	return (opcode == ERT_START_CU || opcode == ERT_EXEC_WRITE) &&
+		xcmd->ert_cu->priority;
+}
+
+/**
+ * cmd_persistent() - Check if CU command restarts its CU when done
+ */
+static inline bool
+cmd_persistent(struct xocl_cmd *xcmd)
+{
+	u32 opcode = cmd_opcode(xcmd);
+
+	return (opcode == ERT_START_CU || opcode == ERT_EXEC_WRITE) &&
+		xcmd->ert_cu->persistent &&
+		cmd_regmap_size(xcmd) > ERT_PERSISTENT_CANCEL;
+}
+
+/**
+ * cmd_persistent_next() - Count completed iteration of persistent command
+ *
+ * Return: true if the command should be restarted
+ *
+ * The iteration counters are in the command BO, so host can monitor
+ * progress and cancel the command while it is running.
+ */
+static bool
+cmd_persistent_next(struct xocl_cmd *xcmd)
+{
+	u32 *regmap = cmd_regmap(xcmd);
+	u32 iterations = READ_ONCE(regmap[ERT_PERSISTENT_ITERATIONS]);
+	u32 completed = ++regmap[ERT_PERSISTENT_COMPLETED];
+
+	if (READ_ONCE(regmap[ERT_PERSISTENT_CANCEL]))
+		return false;
+
+	return !iterations || completed < iterations;
+}
+
 /**
  * cmd_set_int_state() - Set internal command state used by scheduler only
  *
@@ -393,9 +436,77 @@ cmd_set_int_state(struct xocl_cmd *xcmd, enum ert_cmd_state state)
 {
 	SCHED_DEBUGF("-> %s(%lu,%d)\n", __func__, xcmd->uid, state);
 	xcmd->state = state;
+	trace_xocl_cmd_state(XDEV(xcmd->xdev)->dev_minor, xcmd->uid,
+		xcmd->ert_pkt ? cmd_opcode(xcmd) : 0, state);
 	SCHED_DEBUGF("<- %s\n", __func__);
 }
 
+static inline bool
+cmd_state_final(enum ert_cmd_state state)
+{
+	return state != ERT_CMD_STATE_SUBMITTED && state >= ERT_CMD_STATE_COMPLETED;
+}
+
+/**
+ * cmd_record_done() - Record command handle in the client completion ring or done fifo
+ *
+ * Only commands created from user exec buffers are recorded.  If the
+ * client has mapped a completion ring, the handle and state are
+ * published in the ring, otherwise the handle is added to the done
+ * fifo.  If the ring or fifo is full, the client is flagged to indicate
+ * that completions were lost, user space must then fall back to
+ * scanning its commands.
+ *
+ * The ring head is tracked privately, user space can only affect the
+ * tail, which at worst results in lost or repeated completions.
+ *
+ * @xcmd: command object that reached a final state
+ */
+static inline void
+cmd_record_done(struct xocl_cmd *xcmd)
+{
+	struct client_ctx *client = xcmd->client;
+	struct xocl_completion_ring *ring;
+	struct xocl_completion_entry *entry;
+	unsigned long flags;
+	u32 head;
+
+	if (!xcmd->bo || !client)
+		return;
+
+	spin_lock_irqsave(&client->done_lock, flags);
+	ring = client->ring;
+	if (!ring) {
+		if (!kfifo_in(&client->done_fifo, &xcmd->handle, 1))
+			atomic_set(&client->done_overflow, 1);
+		spin_unlock_irqrestore(&client->done_lock, flags);
+		return;
+	}
+
+	head = client->ring_head;
+	if (head - READ_ONCE(ring->tail) >= XOCL_COMPLETION_RING_ENTRIES) {
+		WRITE_ONCE(ring->overflow, 1);
+	} else {
+		entry = &ring->entries[head & (XOCL_COMPLETION_RING_ENTRIES - 1)];
+		entry->handle = xcmd->handle;
+		entry->state = xcmd->state;
+		/* entry must be visible before head */
+		smp_wmb();
+		client->ring_head = head + 1;
+		WRITE_ONCE(ring->head, head + 1);
+	}
+	spin_unlock_irqrestore(&client->done_lock, flags);
+}
+
+/*
+ * cmd_timestamp() - Record phase timestamp of command if enabled
+ */
+#define cmd_timestamp(xcmd, phase)					\
+	do {								\
+		if ((xcmd)->ts)						\
+			(xcmd)->ts->phase = ktime_get_ns();		\
+	} while (0)
+
 /**
  * cmd_set_state() - Set both internal and external state of a command
  *
@@ -408,9 +519,17 @@ cmd_set_int_state(struct xocl_cmd *xcmd, enum ert_cmd_state state)
 static inline void
 cmd_set_state(struct xocl_cmd *xcmd, enum ert_cmd_state state)
 {
+	bool was_final = cmd_state_final(xcmd->state);
+
 	SCHED_DEBUGF("->%s(%lu,%d)\n", __func__, xcmd->uid, state);
 	xcmd->state = state;
+	trace_xocl_cmd_state(XDEV(xcmd->xdev)->dev_minor, xcmd->uid,
+		cmd_opcode(xcmd), state);
+	if (!was_final && cmd_state_final(state))
+		cmd_timestamp(xcmd, notify);
 	xcmd->ert_pkt->state = state;
+	if (!was_final && cmd_state_final(state))
+		cmd_record_done(xcmd);
 	SCHED_DEBUGF("<-%s\n", __func__);
 }
 
@@ -527,7 +646,7 @@ cmd_trigger_chain(struct xocl_cmd *xcmd)
 /**
  * cmd_get() - Get a free command object
  *
- * Get from free/recycled list or allocate a new command if necessary.
+ * Allocate from the command cache of @exec.
  *
  * Return: Free command object
  */
@@ -537,13 +656,7 @@ cmd_get(struct xocl_scheduler *xs, struct exec_core *exec, struct client_ctx *cl
 	struct xocl_cmd *xcmd;
 	static unsigned long count;
 
-	mutex_lock(&free_cmds_mutex);
-	xcmd = list_first_entry_or_null(&free_cmds, struct xocl_cmd, cq_list);
-	if (xcmd)
-		list_del(&xcmd->cq_list);
-	mutex_unlock(&free_cmds_mutex);
-	if (!xcmd)
-		xcmd = kmalloc(sizeof(struct xocl_cmd), GFP_KERNEL);
+	xcmd = kmem_cache_alloc(exec_cmd_cache(exec), GFP_KERNEL);
 	if (!xcmd)
 		return ERR_PTR(-ENOMEM);
 	xcmd->uid = count++;
@@ -557,15 +670,23 @@ cmd_get(struct xocl_scheduler *xs, struct exec_core *exec, struct client_ctx *cl
 	xcmd->ert_pkt = NULL;
 	xcmd->chain_count = 0;
 	xcmd->wait_count = 0;
+	xcmd->handle = 0;
+	xcmd->start = 0;
+	xcmd->ts = NULL;
+	xcmd->admitted = false;
+	xcmd->state = ERT_CMD_STATE_NEW;
 	atomic_inc(&client->outstanding_execs);
 	SCHED_DEBUGF("xcmd(%lu) xcmd(%p) [-> new ]\n", xcmd->uid, xcmd);
 	return xcmd;
 }
 
+static void cmd_quota_wake(struct xocl_cmd *xcmd);
+static void cmd_share_release(struct xocl_cmd *xcmd);
+
 /**
  * cmd_free() - free a command object
  *
- * @xcmd: command object to free (move to freelist)
+ * @xcmd: command object to free (return to command cache)
  *
  * The command *is* in some current list (scheduler command queue)
  */
@@ -573,20 +694,20 @@ static void
 cmd_free(struct xocl_cmd *xcmd)
 {
 	cmd_release_gem_object_reference(xcmd);
-
-	mutex_lock(&free_cmds_mutex);
-	list_move_tail(&xcmd->cq_list, &free_cmds);
-	mutex_unlock(&free_cmds_mutex);
+	list_del(&xcmd->cq_list);
 
 	atomic_dec(&xcmd->xdev->outstanding_execs);
 	atomic_dec(&xcmd->client->outstanding_execs);
+	cmd_share_release(xcmd);
+	cmd_quota_wake(xcmd);
 	SCHED_DEBUGF("xcmd(%lu) [-> free]\n", xcmd->uid);
+	kmem_cache_free(exec_cmd_cache(xcmd->exec), xcmd);
 }
 
 /**
  * abort_cmd() - abort command object before it becomes pending
  *
- * @xcmd: command object to abort (move to freelist)
+ * @xcmd: command object to abort (return to command cache)
  *
  * Command object is *not* in any current list
  *
@@ -595,12 +716,10 @@ cmd_free(struct xocl_cmd *xcmd)
 static void
 cmd_abort(struct xocl_cmd *xcmd)
 {
-	mutex_lock(&free_cmds_mutex);
-	list_add_tail(&xcmd->cq_list, &free_cmds);
-	mutex_unlock(&free_cmds_mutex);
-
 	atomic_dec(&xcmd->client->outstanding_execs);
+	cmd_quota_wake(xcmd);
 	SCHED_DEBUGF("xcmd(%lu) [-> abort]\n", xcmd->uid);
+	kmem_cache_free(exec_cmd_cache(xcmd->exec), xcmd);
 }
 
 /*
@@ -639,6 +758,17 @@ cmd_bo_init(struct xocl_cmd *xcmd, struct drm_xocl_bo *bo,
 	memcpy(xcmd->deps, deps, numdeps*sizeof(struct drm_xocl_bo *));
 	xcmd->wait_count = numdeps;
 	xcmd->chain_count = 0;
+
+	// phase timestamps follow the packet payload if requested and room
+	if ((cmd_opcode(xcmd) == ERT_START_CU || cmd_opcode(xcmd) == ERT_EXEC_WRITE) &&
+	    xcmd->ert_cu->stat_enabled) {
+		struct ert_cmd_timestamps *ts = ert_start_kernel_timestamps(xcmd->ert_cu);
+
+		if ((char *)(ts + 1) <= (char *)bo->vmapping + bo->base.size) {
+			memset(ts, 0, sizeof(*ts));
+			xcmd->ts = ts;
+		}
+	}
 }
 
 /*
@@ -672,6 +802,7 @@ cmd_has_cu(struct xocl_cmd *xcmd, unsigned int cuidx)
  * @base: exec base address of this CU
  * @addr: base address of this CU
  * @polladdr: address of CU poll request register
+ * @isr: if set, AP_DONE is read from the CU interrupt status register
  * @ctrlreg: state of the CU (value of AXI-lite control register)
  * @done_cnt: number of commands that have completed (<=running_queue.size())
  * @run_cnt: number of commands that have bee started (<=running_queue.size())
@@ -686,6 +817,7 @@ struct xocl_cu {
 	u32                addr;
 	void __iomem       *polladdr;
 	u32                ap_check;
+	bool               isr;
 
 	u32                ctrlreg;
 	unsigned int       done_cnt;
@@ -703,6 +835,7 @@ cu_reset(struct xocl_cu *xcu, unsigned int idx, void __iomem *base, u32 addr, vo
 	xcu->addr = addr & ~(0xFF); // clear encoded handshake
 	xcu->polladdr = polladdr;
 	xcu->ap_check = (xcu->control == AP_CTRL_CHAIN) ? (AP_DONE) : (AP_DONE | AP_IDLE);
+	xcu->isr = false;
 	xcu->ctrlreg = 0;
 	xcu->done_cnt = 0;
 	xcu->run_cnt = 0;
@@ -782,6 +915,50 @@ cu_continue(struct xocl_cu *xcu)
 	SCHED_DEBUGF("<- %s\n", __func__);
 }
 
+/**
+ * cu_enable_isr() - Latch CU completion in its interrupt status register
+ *
+ * Penguin mode only.  With AP_DONE enabled in IER the CU latches done in
+ * ISR until it is acknowledged, so a poll tells exactly whether the CU
+ * finished since last poll.  The global interrupt enable is left off, the
+ * CU interrupt line is not connected to KDS.  Dataflow CUs keep polling
+ * the control register as readiness is tracked through AP_START.
+ */
+static void
+cu_enable_isr(struct xocl_cu *xcu)
+{
+	u32 isr;
+
+	if (!cu_valid(xcu) || cu_dataflow(xcu))
+		return;
+
+	iowrite32(0x1, xcu->base + xcu->addr + CU_IER_OFFSET);
+
+	// ISR is toggle on write, clear stale status
+	isr = ioread32(xcu->base + xcu->addr + CU_ISR_OFFSET);
+	if (isr)
+		iowrite32(isr, xcu->base + xcu->addr + CU_ISR_OFFSET);
+	xcu->isr = true;
+}
+
+/**
+ * cu_poll_isr() - Poll CU interrupt status register for AP_DONE
+ */
+static void
+cu_poll_isr(struct xocl_cu *xcu)
+{
+	u32 isr = ioread32(xcu->base + xcu->addr + CU_ISR_OFFSET);
+
+	SCHED_DEBUGF("+ isr(0x%x)\n", isr);
+
+	if (xcu->run_cnt && (isr & 0x1)) {
+		iowrite32(0x1, xcu->base + xcu->addr + CU_ISR_OFFSET);
+		xcu->ctrlreg &= ~AP_START;
+		++xcu->done_cnt;
+		--xcu->run_cnt;
+	}
+}
+
 /**
  * cu_poll() - Poll a CU for its status
  *
@@ -797,6 +974,13 @@ cu_poll(struct xocl_cu *xcu)
 	SCHED_DEBUGF("-> %s cu(%d) @0x%x done(%d) run(%d)\n", __func__,
 		     xcu->idx, xcu->addr, xcu->done_cnt, xcu->run_cnt);
 
+	if (xcu->isr) {
+		cu_poll_isr(xcu);
+		SCHED_DEBUGF("<- %s cu(%d) done(%d) run(%d)\n", __func__,
+			     xcu->idx, xcu->done_cnt, xcu->run_cnt);
+		return;
+	}
+
 	xcu->ctrlreg = ioread32(xcu->base + xcu->addr);
 
 	SCHED_DEBUGF("+ ctrlreg(0x%x)\n", xcu->ctrlreg);
@@ -872,6 +1056,8 @@ cu_pop_done(struct xocl_cu *xcu)
 
 /**
  * cu_configure_ooo() - Configure a CU with {addr,val} pairs
+ *
+ * The addr of a pair is a register offset relative to the CU
  */
 static void
 cu_configure_ooo(struct xocl_cu *xcu, struct xocl_cmd *xcmd)
@@ -886,7 +1072,7 @@ cu_configure_ooo(struct xocl_cu *xcu, struct xocl_cmd *xcmd)
 		u32 val = *(regmap + idx + 1);
 
 		SCHED_DEBUGF("+ base[0x%x] = 0x%x\n", offset, val);
-		iowrite32(val, xcu->base + offset);
+		iowrite32(val, xcu->base + xcu->addr + offset);
 	}
 	SCHED_DEBUGF("<- %s\n", __func__);
 }
@@ -1089,6 +1275,16 @@ static struct exec_ops penguin_ops;   // kds mode (no ert)
  * @stopped: Flag to indicate that the core data structure cannot be used
  * @flush: Flag to indicate that commands for this device should be flushed
  * @cu_usage: Usage count since last reset
+ * @cu_policy: CU selection policy in penguin mode (enum ert_cu_policy)
+ * @cu_next: CU index where round robin selection resumes
+ * @cu_busy: Bitmap of CUs with commands in their running queue (penguin mode)
+ * @cu_poll_iter: Scheduler iteration in which @cu_busy CUs were last polled
+ * @cu_reset_req: Bitmap of CUs to be reset by the scheduler (penguin mode)
+ * @cu_disabled: Bitmap of CUs that did not return to idle on reset, not
+ *  used until the next xclbin
+ * @cu_high_wanted: Bitmap of CUs wanted by high priority commands left queued
+ *  in scheduler iteration @cu_high_iter
+ * @cu_high_iter: Scheduler iteration in which @cu_high_wanted was updated
  * @slot_status: Bitmap to track status (busy(1)/free(0)) slots in command queue
  * @ctrl_busy: Flag to indicate that slot 0 (ctrl commands) is busy
  * @cu_status: Bitmap to track status (busy(1)/free(0)) of CUs. Unused in ERT mode.
@@ -1096,6 +1292,19 @@ static struct exec_ops penguin_ops;   // kds mode (no ert)
  * @sr1: If set, then status register [32..63] is pending with completed commands (ERT only).
  * @sr2: If set, then status register [64..95] is pending with completed commands (ERT only).
  * @sr3: If set, then status register [96..127] is pending with completed commands (ERT only).
+ * @intr_coalesce_cnt: Wake scheduler after this many interrupts, 0 disables coalescing
+ * @intr_coalesce_usecs: Wake scheduler at most this many usecs after first coalesced interrupt
+ * @intr_pending: Number of interrupts not yet signaled to scheduler
+ * @intr_timer: Timer bounding latency of coalesced interrupts
+ * @spin_budget_usecs: Poll this many usecs after a start before relying on interrupts, 0 disables
+ * @spin_deadline: End of current spin window
+ * @stat_spins: Number of status register polls while spinning
+ * @stat_spin_hits: Number of spinning polls that found completed commands
+ * @stat_wakeups: Number of scheduler wakeups by interrupt
+ * @stat_latency: Histogram of start to completion latency of commands
+ * @client_quota: Max outstanding commands per client, 0 for no limit
+ * @quota_wait_queue: Clients blocked on @client_quota
+ * @client_share: Max commands per client in scheduler queue, 0 for no limit
  * @ops: Scheduler operations vtable
  */
 struct exec_core {
@@ -1131,6 +1340,14 @@ struct exec_core {
 	struct xocl_ert		   *ert;
 
 	u32			   cu_usage[MAX_CUS];
+	unsigned int		   cu_policy;
+	unsigned int		   cu_next;
+	DECLARE_BITMAP(cu_busy, MAX_CUS);
+	unsigned long		   cu_poll_iter;
+	DECLARE_BITMAP(cu_reset_req, MAX_CUS);
+	DECLARE_BITMAP(cu_disabled, MAX_CUS);
+	DECLARE_BITMAP(cu_high_wanted, MAX_CUS);
+	unsigned long		   cu_high_iter;
 
 	// Bitmap tracks busy(1)/free(0) slots in cmd_slots
 	struct xocl_cmd		   *submitted_cmds[MAX_SLOTS];
@@ -1144,6 +1361,37 @@ struct exec_core {
 	atomic_t		   sr2;
 	atomic_t		   sr3;
 
+	// Interrupt coalescing, configured through sysfs
+	unsigned int		   intr_coalesce_cnt;
+	unsigned int		   intr_coalesce_usecs;
+	atomic_t		   intr_pending;
+	struct hrtimer		   intr_timer;
+
+	// Adaptive polling, configured through sysfs
+	unsigned int		   spin_budget_usecs;
+	ktime_t			   spin_deadline;
+	unsigned long		   stat_spins;
+	unsigned long		   stat_spin_hits;
+	atomic_t		   stat_wakeups;
+	u32			   stat_latency[KDS_LATENCY_BUCKETS];
+
+	// Per client admission limit, configured through sysfs
+	unsigned int		   client_quota;
+	wait_queue_head_t	   quota_wait_queue;
+
+	// Per client share of scheduler queue, configured through sysfs
+	unsigned int		   client_share;
+
+	// Command objects of this device
+	struct kmem_cache	   *cmd_cache;
+	char			   cmd_cache_name[32];
+
+	// New commands of this device, copied to scheduler queue by the
+	// scheduler, see scheduler_queue_cmds()
+	struct list_head	   pending_cmds;
+	struct mutex		   pending_cmds_mutex;
+	struct list_head	   sched_list; // entry in exec_list
+
 	// Operations for dynamic indirection dependt on MB
 	// or kernel scheduler
 	struct exec_ops		   *ops;
@@ -1158,6 +1406,26 @@ struct exec_core {
 	unsigned int		   ip_reference[MAX_CUS];
 };
 
+static struct kmem_cache *
+exec_cmd_cache(struct exec_core *exec)
+{
+	return exec->cmd_cache;
+}
+
+/**
+ * cmd_quota_wake() - wake clients waiting for admission under client quota
+ *
+ * @xcmd: command object that no longer counts against its client
+ */
+static void
+cmd_quota_wake(struct xocl_cmd *xcmd)
+{
+	struct exec_core *exec = xcmd->exec;
+
+	if (exec && exec->client_quota && waitqueue_active(&exec->quota_wait_queue))
+		wake_up_interruptible(&exec->quota_wait_queue);
+}
+
 /**
  * exec_get_pdev() -
  */
@@ -1212,6 +1480,32 @@ exec_is_polling(struct exec_core *exec)
 	return exec->polling_mode;
 }
 
+/**
+ * Check if exec core polls for completion in the spin window after a start
+ */
+static inline bool
+exec_is_spinning(struct exec_core *exec)
+{
+	return exec->spin_budget_usecs && !exec->polling_mode &&
+		ktime_before(ktime_get(), exec->spin_deadline);
+}
+
+/**
+ * exec_spin() - Open spin window after a command was started
+ *
+ * Completions are likely soon after a start, so the scheduler polls for
+ * spin_budget_usecs before it falls back to sleeping until interrupt.
+ */
+static void
+exec_spin(struct exec_core *exec)
+{
+	if (!exec->spin_budget_usecs || exec->polling_mode)
+		return;
+
+	exec->spin_deadline = ktime_add_us(ktime_get(), exec->spin_budget_usecs);
+	scheduler_spin(exec->scheduler, exec->spin_deadline);
+}
+
 /**
  * Check if exec core has been requested to flush commands
  */
@@ -1238,6 +1532,17 @@ exec_cu_usage(struct exec_core *exec, unsigned int cuidx)
 	return exec->cu_usage[cuidx];
 }
 
+/**
+ * exec_publish_cu_usage() - Mirror CU usage count into device usage page
+ */
+static inline void
+exec_publish_cu_usage(struct exec_core *exec, unsigned int cuidx)
+{
+	if (cuidx < XOCL_USAGE_MAX_CUS)
+		xocl_usage_set(exec_get_xdev(exec), cu_usage[cuidx],
+			       exec->cu_usage[cuidx]);
+}
+
 static bool
 exec_valid_cu(struct exec_core *exec, unsigned int cuidx)
 {
@@ -1285,10 +1590,18 @@ exec_cfg_cmd(struct exec_core *exec, struct xocl_cmd *xcmd)
 		return 1;
 	}
 
+	/* Slot size is computed per xclbin, at most MAX_SLOTS slots */
+	if (!cfg->slot_size || ERT_CQ_SIZE / cfg->slot_size > MAX_SLOTS)
+		cfg->slot_size = ERT_CQ_SIZE / MAX_SLOTS;
+
 	SCHED_DEBUG("configuring scheduler\n");
 	exec->num_slots = ERT_CQ_SIZE / cfg->slot_size;
 	exec->num_cus = cfg->num_cus;
 	exec->num_cdma = 0;
+	xocl_usage_set(xdev, cu_count,
+		       min_t(u32, exec->num_cus, XOCL_USAGE_MAX_CUS));
+	exec->cu_policy = cfg->cu_policy;
+	exec->cu_next = 0;
 
 	if (ert_poll)
 		// Adjust slot size for ert poll mode
@@ -1354,22 +1667,32 @@ exec_cfg_cmd(struct exec_core *exec, struct xocl_cmd *xcmd)
 		userpf_info(xdev, "configuring penguin scheduler mode\n");
 		exec->ops = &penguin_ops;
 		exec->polling_mode = true;
+		// KDMA CUs are last and keep polling the control register
+		if (cfg->cu_isr)
+			for (cuidx = 0; cuidx < exec->num_cus - exec->num_cdma; ++cuidx)
+				cu_enable_isr(exec->cus[cuidx]);
 	}
 
 	if (XDEV(xdev)->priv.flags & XOCL_DSAFLAG_CUDMA_OFF)
 		cfg->cu_dma = 0;
 
+	// sysfs coalescing applies to ERT unless configured by host
+	if (!cfg->intr_coalesce)
+		cfg->intr_coalesce = min_t(unsigned int, exec->intr_coalesce_cnt, 63);
+
 	// reserve slot 0 for control commands
 	set_bit(0, exec->slot_status);
 
-	userpf_info(xdev, "scheduler config ert(%d), dataflow(%d), slots(%d), cudma(%d), cuisr(%d), cdma(%d), cus(%d)\n"
+	userpf_info(xdev, "scheduler config ert(%d), dataflow(%d), slots(%d), cudma(%d), cuisr(%d), cdma(%d), cus(%d), cu_policy(%d), intr_coalesce(%d)\n"
 		 , ert_poll | ert_full
 		 , cfg->dataflow
 		 , exec->num_slots
 		 , cfg->cu_dma ? 1 : 0
 		 , cfg->cu_isr ? 1 : 0
 		 , exec->num_cdma
-		 , exec->num_cus);
+		 , exec->num_cus
+		 , exec->cu_policy
+		 , cfg->intr_coalesce);
 
 	exec->configured = true;
 	return 0;
@@ -1404,6 +1727,10 @@ exec_reset(struct exec_core *exec)
 	userpf_info(xdev, "%s resets", __func__);
 	userpf_info(xdev, "exec->xclbin(%pUb),xclbin(%pUb)\n", &exec->xclbin_id, xclbin_id);
 	memset(exec->cu_usage, 0, MAX_CUS * sizeof(u32));
+	xocl_usage_set(xdev, cu_count, 0);
+	if (XDEV(xdev)->usage)
+		memset(XDEV(xdev)->usage->cu_usage, 0,
+		       sizeof(XDEV(xdev)->usage->cu_usage));
 	uuid_copy(&exec->xclbin_id, xclbin_id);
 	exec->num_cus = 0;
 	exec->num_cdma = 0;
@@ -1419,6 +1746,12 @@ exec_reset(struct exec_core *exec)
 	bitmap_zero(exec->slot_status, MAX_SLOTS);
 	set_bit(0, exec->slot_status); // reserve for control command
 	exec->ctrl_busy = false;
+	bitmap_zero(exec->cu_busy, MAX_CUS);
+	exec->cu_poll_iter = 0;
+	bitmap_zero(exec->cu_reset_req, MAX_CUS);
+	bitmap_zero(exec->cu_disabled, MAX_CUS);
+	bitmap_zero(exec->cu_high_wanted, MAX_CUS);
+	exec->cu_high_iter = 0;
 
 	atomic_set(&exec->sr0, 0);
 	atomic_set(&exec->sr1, 0);
@@ -1490,6 +1823,54 @@ exec_stop(struct exec_core *exec)
 	bitmap_zero(exec->slot_status, MAX_SLOTS);
 	set_bit(0, exec->slot_status); // reserve for control command
 	exec->ctrl_busy = false;
+	bitmap_zero(exec->cu_busy, MAX_CUS);
+	exec->cu_poll_iter = 0;
+}
+
+/**
+ * exec_intr_timer() - Signal coalesced interrupts to scheduler
+ */
+static enum hrtimer_restart
+exec_intr_timer(struct hrtimer *timer)
+{
+	struct exec_core *exec = container_of(timer, struct exec_core, intr_timer);
+
+	atomic_set(&exec->intr_pending, 0);
+	atomic_inc(&exec->stat_wakeups);
+	scheduler_intr(exec->scheduler);
+	return HRTIMER_NORESTART;
+}
+
+/**
+ * exec_intr_coalesce() - Check if interrupt should wake scheduler
+ *
+ * Return: true if scheduler should be woken now
+ *
+ * With coalescing the scheduler is woken after intr_coalesce_cnt
+ * interrupts, or by timer intr_coalesce_usecs after the first pending
+ * interrupt.  Commands still complete individually, the status
+ * registers latched by the ISR are processed when scheduler wakes.
+ */
+static bool
+exec_intr_coalesce(struct exec_core *exec)
+{
+	int pending;
+
+	if (exec->intr_coalesce_cnt <= 1)
+		return true;
+
+	pending = atomic_inc_return(&exec->intr_pending);
+	if (pending >= exec->intr_coalesce_cnt) {
+		atomic_set(&exec->intr_pending, 0);
+		hrtimer_try_to_cancel(&exec->intr_timer);
+		return true;
+	}
+
+	if (pending == 1)
+		hrtimer_start(&exec->intr_timer,
+			      ns_to_ktime((u64)exec->intr_coalesce_usecs * NSEC_PER_USEC),
+			      HRTIMER_MODE_REL);
+	return false;
 }
 
 /*
@@ -1513,7 +1894,10 @@ exec_isr(int irq, void *arg)
 			atomic_set(&exec->sr3, 1);
 
 		/* wake up all scheduler ... currently one only */
-		scheduler_intr(exec->scheduler);
+		if (exec_intr_coalesce(exec)) {
+			atomic_inc(&exec->stat_wakeups);
+			scheduler_intr(exec->scheduler);
+		}
 	} else {
 		userpf_err(exec_get_xdev(exec), "unhandled isr irq %d", irq);
 	}
@@ -1580,9 +1964,29 @@ exec_create(struct platform_device *pdev, struct xocl_scheduler *xs)
 		exec->ert_cfg_priv = *(char *)XOCL_GET_SUBDEV_PRIV(&pdev->dev);
 
 	init_waitqueue_head(&exec->poll_wait_queue);
+	init_waitqueue_head(&exec->quota_wait_queue);
 	exec->scheduler = xs;
 	exec->uid = count++;
 
+	snprintf(exec->cmd_cache_name, sizeof(exec->cmd_cache_name),
+		 "xocl_cmd_%u", exec->uid);
+	exec->cmd_cache = kmem_cache_create(exec->cmd_cache_name,
+		sizeof(struct xocl_cmd), 0, SLAB_HWCACHE_ALIGN, NULL);
+	if (!exec->cmd_cache) {
+		if (exec->csr_base)
+			iounmap(exec->csr_base);
+		if (exec->cq_base)
+			iounmap(exec->cq_base);
+		xocl_err(&pdev->dev, "create command cache failed");
+		return NULL;
+	}
+	INIT_LIST_HEAD(&exec->pending_cmds);
+	mutex_init(&exec->pending_cmds_mutex);
+
+	hrtimer_init(&exec->intr_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	exec->intr_timer.function = exec_intr_timer;
+	atomic_set(&exec->intr_pending, 0);
+
 	for (i = 0; i < exec->intr_num; i++) {
 		xocl_user_interrupt_reg(xdev, i+exec->intr_base, exec_isr, exec);
 		xocl_user_interrupt_config(xdev, i + exec->intr_base, true);
@@ -1604,6 +2008,7 @@ exec_destroy(struct exec_core *exec)
 	int idx;
 
 	SCHED_DEBUGF("%s(%d)\n", __func__, exec->uid);
+	hrtimer_cancel(&exec->intr_timer);
 	for (idx = 0; idx < exec->num_cus; ++idx)
 		cu_destroy(exec->cus[idx]);
 	if (exec->ert)
@@ -1612,6 +2017,8 @@ exec_destroy(struct exec_core *exec)
 		iounmap(exec->csr_base);
 	if (exec->cq_base)
 		iounmap(exec->cq_base);
+	mutex_destroy(&exec->pending_cmds_mutex);
+	kmem_cache_destroy(exec->cmd_cache);
 
 	devm_kfree(&exec->pdev->dev, exec);
 }
@@ -1719,8 +2126,13 @@ exec_submit_cmd(struct exec_core *exec, struct xocl_cmd *xcmd)
 static int
 exec_finish_cmd(struct exec_core *exec, struct xocl_cmd *xcmd)
 {
-	if (cmd_opcode(xcmd) == ERT_CU_STAT && exec_is_ert(exec))
+	unsigned int cuidx;
+
+	if (cmd_opcode(xcmd) == ERT_CU_STAT && exec_is_ert(exec)) {
 		ert_read_custat(exec->ert, exec->num_cus, exec->cu_usage, xcmd);
+		for (cuidx = 0; cuidx < exec->num_cus; ++cuidx)
+			exec_publish_cu_usage(exec, cuidx);
+	}
 	return 0;
 }
 
@@ -1779,10 +2191,28 @@ exec_notify_host(struct exec_core *exec)
  * The external command state is changed to complete and the host
  * is notified that some command has completed.
  */
+/**
+ * exec_record_latency() - Add start to completion latency of a command to histogram
+ */
+static void
+exec_record_latency(struct exec_core *exec, struct xocl_cmd *xcmd)
+{
+	s64 usecs;
+
+	if (!xcmd->start)
+		return;
+
+	usecs = ktime_us_delta(ktime_get(), xcmd->start);
+	++exec->stat_latency[min_t(unsigned int, fls64(usecs), KDS_LATENCY_BUCKETS - 1)];
+	xcmd->start = 0;
+}
+
 static void
 exec_mark_cmd_complete(struct exec_core *exec, struct xocl_cmd *xcmd)
 {
 	SCHED_DEBUGF("-> %s(%d,%lu)\n", __func__, exec->uid, xcmd->uid);
+	cmd_timestamp(xcmd, done);
+	exec_record_latency(exec, xcmd);
 	if (cmd_type(xcmd) == ERT_CTRL)
 		exec_finish_cmd(exec, xcmd);
 
@@ -1801,6 +2231,28 @@ exec_mark_cmd_complete(struct exec_core *exec, struct xocl_cmd *xcmd)
 	SCHED_DEBUGF("<- %s\n", __func__);
 }
 
+/**
+ * cu_cmd_done() - Handle CU command that is done on its CU
+ *
+ * A persistent command is restarted on the CU without a round trip
+ * to host.  It completes when done iterating, or if the CU has been
+ * started by another command in the meantime.
+ */
+static void
+exec_cu_cmd_done(struct exec_core *exec, struct xocl_cu *xcu, struct xocl_cmd *xcmd)
+{
+	if (cmd_persistent(xcmd) && cmd_persistent_next(xcmd) &&
+	    cu_ready(xcu) && cu_start(xcu, xcmd)) {
+		++exec->cu_usage[xcu->idx];
+		exec_publish_cu_usage(exec, xcu->idx);
+		cmd_timestamp(xcmd, start);
+		SCHED_DEBUGF("%s restarted cmd(%lu) on cu(%d)\n", __func__, xcmd->uid, xcu->idx);
+		return;
+	}
+
+	exec_mark_cmd_complete(exec, xcmd);
+}
+
 /**
  * process_cmd_mask() - Move all commands in mask to complete state
  *
@@ -1865,7 +2317,7 @@ exec_process_cu_mask(struct exec_core *exec, u32 mask, unsigned int mask_idx)
 		// started; alas there can be more than one completed cmd
 		while ((xcmd = cu_first_done(xcu))) {
 			cu_pop_done(xcu);
-			exec_mark_cmd_complete(exec, xcmd);
+			exec_cu_cmd_done(exec, xcu, xcmd);
 		}
 	}
 	SCHED_DEBUGF("<- %s\n", __func__);
@@ -1885,8 +2337,10 @@ exec_process_cu_mask(struct exec_core *exec, u32 mask, unsigned int mask_idx)
 static bool
 exec_penguin_start_cmd(struct exec_core *exec, struct xocl_cmd *xcmd)
 {
-	unsigned int cuidx;
+	unsigned int cuidx, i, start;
+	int selected = -1;
 	u32 opcode = cmd_opcode(xcmd);
+	DECLARE_BITMAP(cus, MAX_CUS);
 
 	SCHED_DEBUGF("-> %s cmd(%lu) opcode(%d)\n", __func__, xcmd->uid, opcode);
 
@@ -1895,28 +2349,142 @@ exec_penguin_start_cmd(struct exec_core *exec, struct xocl_cmd *xcmd)
 		return false;
 	}
 
+	if (cmd_persistent(xcmd))
+		cmd_regmap(xcmd)[ERT_PERSISTENT_COMPLETED] = 0;
+
+	/* DAG commands are sequenced by embedded scheduler only */
+	if (opcode == ERT_START_DAG) {
+		userpf_err(exec_get_xdev(exec), "DAG commands require ERT\n");
+		cmd_set_state(xcmd, ERT_CMD_STATE_ERROR);
+		return false;
+	}
+
 	if (cmd_type(xcmd) != ERT_CU) {
 		SCHED_DEBUGF("<- %s not a CU style command -> true\n", __func__);
 		return true;
 	}
 
-	// Find a ready CU
-	for (cuidx = 0; cuidx < exec->num_cus; ++cuidx) {
-		struct xocl_cu *xcu = exec->cus[cuidx];
+	// Commands that can run on disabled CUs only would never start
+	bitmap_andnot(cus, xcmd->cu_bitmap, exec->cu_disabled, MAX_CUS);
+	if (bitmap_empty(cus, MAX_CUS)) {
+		userpf_err(exec_get_xdev(exec), "cmd(%lu) has no enabled CU\n", xcmd->uid);
+		cmd_set_state(xcmd, ERT_CMD_STATE_ERROR);
+		return false;
+	}
 
-		if (cmd_has_cu(xcmd, cuidx) && cu_ready(xcu) && cu_start(xcu, xcmd)) {
-			exec->submitted_cmds[xcmd->slot_idx] = NULL;
-			++exec->cu_usage[cuidx];
-			exec_release_slot(exec, xcmd);
-			xcmd->cu_idx = cuidx;
-			SCHED_DEBUGF("<- %s -> true\n", __func__);
-			return true;
+	// Find a ready CU per selection policy
+	start = (exec->cu_policy == ERT_CU_POLICY_ROUND_ROBIN &&
+		 exec->cu_next < exec->num_cus) ? exec->cu_next : 0;
+	for (i = 0, cuidx = start; i < exec->num_cus;
+	     ++i, cuidx = (cuidx + 1 == exec->num_cus) ? 0 : cuidx + 1) {
+		if (!cmd_has_cu(xcmd, cuidx) || test_bit(cuidx, exec->cu_disabled) ||
+		    !cu_ready(exec->cus[cuidx]))
+			continue;
+		if (exec->cu_policy != ERT_CU_POLICY_LEAST_USED) {
+			selected = cuidx;
+			break;
 		}
+		if (selected < 0 ||
+		    exec->cu_usage[cuidx] < exec->cu_usage[selected])
+			selected = cuidx;
+	}
+
+	if (selected >= 0 && cu_start(exec->cus[selected], xcmd)) {
+		exec->submitted_cmds[xcmd->slot_idx] = NULL;
+		set_bit(selected, exec->cu_busy);
+		++exec->cu_usage[selected];
+		exec_publish_cu_usage(exec, selected);
+		exec_release_slot(exec, xcmd);
+		xcmd->cu_idx = selected;
+		exec->cu_next = selected + 1;
+		SCHED_DEBUGF("<- %s -> true\n", __func__);
+		return true;
 	}
 	SCHED_DEBUGF("<- %s -> false\n", __func__);
 	return false;
 }
 
+/**
+ * exec_penguin_poll_cus() - Retire completed commands of all busy CUs
+ *
+ * @exec: device
+ *
+ * Each CU with commands in its running queue is polled once per scheduler
+ * iteration, rather than once per running command, and exactly the CUs
+ * that finished have their commands retired.  Idle CUs are not touched.
+ */
+static void
+exec_penguin_poll_cus(struct exec_core *exec)
+{
+	unsigned long iter = scheduler_iteration(exec->scheduler);
+	unsigned int cuidx;
+
+	if (exec->cu_poll_iter == iter)
+		return;
+	exec->cu_poll_iter = iter;
+
+	SCHED_DEBUGF("-> %s iter(%lu)\n", __func__, iter);
+	for_each_set_bit(cuidx, exec->cu_busy, exec->num_cus) {
+		struct xocl_cu *xcu = exec->cus[cuidx];
+		struct xocl_cmd *xcmd;
+
+		while ((xcmd = cu_first_done(xcu))) {
+			cu_pop_done(xcu);
+			exec_cu_cmd_done(exec, xcu, xcmd);
+		}
+
+		if (list_empty(&xcu->running_queue))
+			clear_bit(cuidx, exec->cu_busy);
+	}
+	SCHED_DEBUGF("<- %s\n", __func__);
+}
+
+/**
+ * exec_penguin_reset_cu() - Abort the commands of one CU and reset its state
+ *
+ * @exec: device
+ * @cuidx: index of the CU to reset
+ *
+ * Scheduler thread only, see scheduler_reset_cus().  The shell has no
+ * reset line per CU, so the CU itself is not reset.  Its running commands
+ * are aborted and the scheduler state of the CU is reset.  A CU that is
+ * still started after that is hung in hardware and is disabled until the
+ * next xclbin, the other CUs of the device keep running.
+ */
+static void
+exec_penguin_reset_cu(struct exec_core *exec, unsigned int cuidx)
+{
+	struct xocl_dev *xdev = exec_get_xdev(exec);
+	struct xocl_cu *xcu = exec->cus[cuidx];
+	struct xocl_cmd *xcmd, *next;
+	bool isr = xcu->isr;
+	u32 ctrlreg;
+
+	list_for_each_entry_safe(xcmd, next, &xcu->running_queue, rq_list) {
+		userpf_info(xdev, "aborting cmd(%lu) on cu(%d) reset\n", xcmd->uid, cuidx);
+		list_del(&xcmd->rq_list);
+		cmd_set_state(xcmd, ERT_CMD_STATE_ABORT);
+		if (exec->polling_mode)
+			scheduler_decr_poll(exec->scheduler);
+		cmd_mark_deactive(xcmd);
+		cmd_trigger_chain(xcmd);
+	}
+	clear_bit(cuidx, exec->cu_busy);
+
+	cu_reset(xcu, cuidx, xcu->base, xcu->addr | xcu->control, xcu->polladdr);
+
+	ctrlreg = ioread32(xcu->base + xcu->addr);
+	if ((ctrlreg & AP_START) && !(ctrlreg & AP_IDLE)) {
+		userpf_err(xdev, "cu(%d) is hung, ctrlreg(0x%x), disabled until next xclbin\n",
+			   cuidx, ctrlreg);
+		set_bit(cuidx, exec->cu_disabled);
+		return;
+	}
+
+	if (isr)
+		cu_enable_isr(xcu);
+}
+
 /**
  * penguin_query() - Check command status of argument command
  *
@@ -1925,7 +2493,9 @@ exec_penguin_start_cmd(struct exec_core *exec, struct xocl_cmd *xcmd)
  *
  * scheduler_ops penguin mode callback function
  *
- * Function is called in penguin mode where KDS polls CUs for completion
+ * Function is called in penguin mode where KDS polls CUs for completion.
+ * CU commands are retired for all busy CUs at once, the argument command
+ * may or may not be among them.
  */
 static void
 exec_penguin_query_cmd(struct exec_core *exec, struct xocl_cmd *xcmd)
@@ -1937,14 +2507,8 @@ exec_penguin_query_cmd(struct exec_core *exec, struct xocl_cmd *xcmd)
 
 	if (cmdtype == ERT_KDS_LOCAL || cmdtype == ERT_CTRL)
 		exec_mark_cmd_complete(exec, xcmd);
-	else if (cmdtype == ERT_CU) {
-		struct xocl_cu *xcu = exec->cus[xcmd->cu_idx];
-
-		if (cu_first_done(xcu) == xcmd) {
-			cu_pop_done(xcu);
-			exec_mark_cmd_complete(exec, xcmd);
-		}
-	}
+	else if (cmdtype == ERT_CU)
+		exec_penguin_poll_cus(exec);
 
 	SCHED_DEBUGF("<- %s\n", __func__);
 }
@@ -1965,6 +2529,13 @@ exec_ert_start_cmd(struct exec_core *exec, struct xocl_cmd *xcmd)
 	if (cmd_type(xcmd) == ERT_KDS_LOCAL)
 		return exec_penguin_start_cmd(exec, xcmd);
 
+	/* ERT completes CU commands per run, no device side restart */
+	if (cmd_persistent(xcmd)) {
+		userpf_err(exec_get_xdev(exec), "persistent commands require KDS scheduling\n");
+		cmd_set_state(xcmd, ERT_CMD_STATE_ERROR);
+		return false;
+	}
+
 	return ert_start_cmd(exec->ert, xcmd);
 }
 
@@ -2028,6 +2599,7 @@ exec_ert_query_csr(struct exec_core *exec, struct xocl_cmd *xcmd, unsigned int m
 {
 	u32 mask = 0;
 	u32 cmdtype = cmd_type(xcmd);
+	bool spin;
 
 	SCHED_DEBUGF("-> %s cmd(%lu), mask_idx(%d)\n", __func__, xcmd->uid, mask_idx);
 
@@ -2037,7 +2609,8 @@ exec_ert_query_csr(struct exec_core *exec, struct xocl_cmd *xcmd, unsigned int m
 		return;
 	}
 
-	if (exec->polling_mode
+	spin = exec_is_spinning(exec);
+	if (exec->polling_mode || spin
 	    || (mask_idx == 0 && atomic_xchg(&exec->sr0, 0))
 	    || (mask_idx == 1 && atomic_xchg(&exec->sr1, 0))
 	    || (mask_idx == 2 && atomic_xchg(&exec->sr2, 0))
@@ -2046,6 +2619,11 @@ exec_ert_query_csr(struct exec_core *exec, struct xocl_cmd *xcmd, unsigned int m
 
 		mask = csr_read32(exec->csr_base, csr_addr);
 		SCHED_DEBUGF("++ %s csr_addr=0x%x mask=0x%x\n", __func__, csr_addr, mask);
+		if (spin) {
+			++exec->stat_spins;
+			if (mask)
+				++exec->stat_spin_hits;
+		}
 	}
 
 	if (!mask) {
@@ -2168,6 +2746,9 @@ exec_start_cmd(struct exec_core *exec, struct xocl_cmd *xcmd)
 
 	if (cmdtype != ERT_CTRL && exec->ops->start_cmd(exec, xcmd)) {
 		cmd_set_int_state(xcmd, ERT_CMD_STATE_RUNNING);
+		xcmd->start = ktime_get();
+		cmd_timestamp(xcmd, start);
+		exec_spin(exec);
 		SCHED_DEBUGF("<- %s returns true for cmd type(%d)\n", __func__, cmdtype);
 		return true;
 	}
@@ -2260,28 +2841,33 @@ dev_get_xdev(struct device *dev)
 }
 
 /**
- * List of new pending xocl_cmd objects
+ * List of devices with new pending xocl_cmd objects
  *
- * @pending_cmds: populated from user space with new commands for buffer objects
- * @num_pending: number of pending commands
+ * @exec_list: exec cores, each with a pending_cmds list populated from user
+ *  space with new commands for buffer objects
+ * @num_pending: number of pending commands of all devices
  *
- * Scheduler copies pending commands to its private queue when necessary
+ * Scheduler copies pending commands to its private queue when necessary.
+ * The exec list is changed only on probe and remove, submission locks
+ * the pending list of its device only.
  */
-static LIST_HEAD(pending_cmds);
-static DEFINE_MUTEX(pending_cmds_mutex);
+static LIST_HEAD(exec_list);
+static DEFINE_MUTEX(exec_list_mutex);
 static atomic_t num_pending = ATOMIC_INIT(0);
 
 static void
-pending_cmds_reset(void)
+pending_cmds_reset(struct exec_core *exec)
 {
 	/* clear stale command objects if any */
-	while (!list_empty(&pending_cmds)) {
-		struct xocl_cmd *xcmd = list_first_entry(&pending_cmds, struct xocl_cmd, cq_list);
+	mutex_lock(&exec->pending_cmds_mutex);
+	while (!list_empty(&exec->pending_cmds)) {
+		struct xocl_cmd *xcmd = list_first_entry(&exec->pending_cmds, struct xocl_cmd, cq_list);
 
 		DRM_INFO("deleting stale pending cmd\n");
 		cmd_free(xcmd);
+		atomic_dec(&num_pending);
 	}
-	atomic_set(&num_pending, 0);
+	mutex_unlock(&exec->pending_cmds_mutex);
 }
 
 /**
@@ -2294,6 +2880,7 @@ pending_cmds_reset(void)
  * @stop: set to 1 to indicate scheduler should stop
  * @reset: set to 1 to reset the scheduler
  * @command_queue: list of command objects managed by scheduler
+ * @command_queue_hi: list of high priority command objects managed by scheduler
  * @intc: boolean flag set when there is a pending interrupt for command completion
  * @poll: number of running commands in polling mode
  */
@@ -2307,9 +2894,14 @@ struct xocl_scheduler {
 	unsigned int		   reset;
 
 	struct list_head	   command_queue;
+	struct list_head	   command_queue_hi;
 
 	unsigned int		   intc; /* pending intr shared with isr, word aligned atomic */
 	unsigned int		   poll; /* number of cmds to poll */
+	int			   held; /* pending cmds held back by client share */
+	unsigned int		   share_released; /* held cmds may be admissible */
+	unsigned long		   iteration; /* command queue iterations */
+	ktime_t			   spin_deadline; /* poll until, see exec_spin() */
 };
 
 static struct xocl_scheduler scheduler0;
@@ -2322,11 +2914,19 @@ scheduler_reset(struct xocl_scheduler *xs)
 	xs->poll = 0;
 	xs->reset = false;
 	xs->intc = 0;
+	xs->held = 0;
+	xs->share_released = 0;
 }
 
 static void
 scheduler_cq_reset(struct xocl_scheduler *xs)
 {
+	while (!list_empty(&xs->command_queue_hi)) {
+		struct xocl_cmd *xcmd = list_first_entry(&xs->command_queue_hi, struct xocl_cmd, cq_list);
+
+		DRM_INFO("deleting stale scheduler cmd\n");
+		cmd_free(xcmd);
+	}
 	while (!list_empty(&xs->command_queue)) {
 		struct xocl_cmd *xcmd = list_first_entry(&xs->command_queue, struct xocl_cmd, cq_list);
 
@@ -2354,28 +2954,68 @@ scheduler_decr_poll(struct xocl_scheduler *xs)
 	--xs->poll;
 }
 
+static inline unsigned long
+scheduler_iteration(struct xocl_scheduler *xs)
+{
+	return xs->iteration;
+}
+
+static inline void
+scheduler_spin(struct xocl_scheduler *xs, ktime_t deadline)
+{
+	if (ktime_after(deadline, xs->spin_deadline))
+		xs->spin_deadline = deadline;
+}
+
 
 /**
- * scheduler_queue_cmds() - Queue any pending commands
+ * cmd_share_release() - Account for command leaving the scheduler queue
  *
- * The scheduler copies pending commands to its internal command queue where
- * is is now in queued state.
+ * @xcmd: command object being freed
+ *
+ * If the command's client is limited by the client share, then pending
+ * commands of the client held back by scheduler_queue_cmds() may now be
+ * admitted, so make the scheduler look at the pending list again.
  */
 static void
-scheduler_queue_cmds(struct xocl_scheduler *xs)
+cmd_share_release(struct xocl_cmd *xcmd)
+{
+	if (!xcmd->admitted)
+		return;
+
+	xcmd->admitted = false;
+	atomic_dec(&xcmd->client->sched_cmds);
+	if (xcmd->exec->client_share)
+		xcmd->xs->share_released = 1;
+}
+
+/**
+ * scheduler_queue_exec_cmds() - Queue pending commands of one device
+ *
+ * @held: incremented for each command held back by the client share
+ */
+static void
+scheduler_queue_exec_cmds(struct xocl_scheduler *xs, struct exec_core *exec, int *held)
 {
 	struct xocl_cmd *xcmd;
 	struct list_head *pos, *next;
+	unsigned int share = READ_ONCE(exec->client_share);
 
-	SCHED_DEBUGF("-> %s\n", __func__);
-	mutex_lock(&pending_cmds_mutex);
-	list_for_each_safe(pos, next, &pending_cmds) {
+	mutex_lock(&exec->pending_cmds_mutex);
+	list_for_each_safe(pos, next, &exec->pending_cmds) {
 		xcmd = list_entry(pos, struct xocl_cmd, cq_list);
-		if (xcmd->xs != xs)
+		if (share && atomic_read(&xcmd->client->sched_cmds) >= share) {
+			++(*held);
 			continue;
+		}
 		SCHED_DEBUGF("+ queueing cmd(%lu)\n", xcmd->uid);
 		list_del(&xcmd->cq_list);
-		list_add_tail(&xcmd->cq_list, &xs->command_queue);
+		list_add_tail(&xcmd->cq_list,
+			      cmd_priority(xcmd) ? &xs->command_queue_hi : &xs->command_queue);
+		xcmd->admitted = true;
+		cmd_timestamp(xcmd, queued);
+		atomic_inc(&xcmd->client->sched_cmds);
+		atomic64_inc(&xcmd->client->sched_total);
 
 		/* chain active dependencies if any to this command object */
 		if (cmd_wait_count(xcmd) && cmd_chain_dependencies(xcmd))
@@ -2387,8 +3027,58 @@ scheduler_queue_cmds(struct xocl_scheduler *xs)
 		cmd_mark_active(xcmd);
 		atomic_dec(&num_pending);
 	}
-	mutex_unlock(&pending_cmds_mutex);
-	SCHED_DEBUGF("<- %s\n", __func__);
+	mutex_unlock(&exec->pending_cmds_mutex);
+}
+
+/**
+ * scheduler_queue_cmds() - Queue any pending commands
+ *
+ * The scheduler copies pending commands to its internal command queue where
+ * is is now in queued state.
+ *
+ * With a client share, a client can have at most client_share commands in
+ * the scheduler queue.  The remaining commands of the client stay pending
+ * in submission order, while commands of other clients are admitted past
+ * them.  Since the scheduler queue is iterated in order, this keeps one
+ * client with a deep backlog from starving other clients of CUs.
+ */
+static void
+scheduler_queue_cmds(struct xocl_scheduler *xs)
+{
+	struct exec_core *exec;
+	int held = 0;
+
+	SCHED_DEBUGF("-> %s\n", __func__);
+	xs->share_released = 0;
+	mutex_lock(&exec_list_mutex);
+	list_for_each_entry(exec, &exec_list, sched_list) {
+		if (exec->scheduler == xs)
+			scheduler_queue_exec_cmds(xs, exec, &held);
+	}
+	mutex_unlock(&exec_list_mutex);
+	xs->held = held;
+	SCHED_DEBUGF("<- %s held(%d)\n", __func__, held);
+}
+
+/**
+ * scheduler_reset_cus() - Reset the CUs requested through client_ioctl_reset_cu()
+ */
+static void
+scheduler_reset_cus(struct xocl_scheduler *xs)
+{
+	struct exec_core *exec;
+	unsigned int cuidx;
+
+	mutex_lock(&exec_list_mutex);
+	list_for_each_entry(exec, &exec_list, sched_list) {
+		if (exec->scheduler != xs || bitmap_empty(exec->cu_reset_req, MAX_CUS))
+			continue;
+		for_each_set_bit(cuidx, exec->cu_reset_req, exec->num_cus) {
+			exec_penguin_reset_cu(exec, cuidx);
+			clear_bit(cuidx, exec->cu_reset_req);
+		}
+	}
+	mutex_unlock(&exec_list_mutex);
 }
 
 /**
@@ -2482,8 +3172,62 @@ scheduler_abort_to_free(struct xocl_scheduler *xs, struct xocl_cmd *xcmd)
 	SCHED_DEBUGF("<- %s\n", __func__);
 }
 
+/**
+ * scheduler_held_for_high() - Check if queued command must leave its CUs
+ * to high priority commands
+ *
+ * A normal priority command that can use a CU wanted by a high priority
+ * command that could not be started in this iteration is not submitted,
+ * so that CUs completing later in the iteration go to the high priority
+ * command in next iteration.
+ */
+static bool
+scheduler_held_for_high(struct xocl_scheduler *xs, struct xocl_cmd *xcmd)
+{
+	struct exec_core *exec = cmd_exec(xcmd);
+
+	return exec->cu_high_iter == xs->iteration && !cmd_priority(xcmd) &&
+		bitmap_intersects(xcmd->cu_bitmap, exec->cu_high_wanted, MAX_CUS);
+}
+
+/**
+ * scheduler_iterate_cmd() - Advance a command through its states
+ *
+ * Return: %true if command is still queued, %false otherwise.  The
+ * command may have been freed if %false is returned.
+ */
+static bool
+scheduler_iterate_cmd(struct xocl_scheduler *xs, struct xocl_cmd *xcmd)
+{
+	bool queued;
+
+	cmd_update_state(xcmd);
+	SCHED_DEBUGF("+ processing cmd(%lu)\n", xcmd->uid);
+
+	if (xcmd->state == ERT_CMD_STATE_QUEUED && !scheduler_held_for_high(xs, xcmd))
+		scheduler_queued_to_submitted(xs, xcmd);
+	queued = (xcmd->state == ERT_CMD_STATE_QUEUED);
+	if (xcmd->state == ERT_CMD_STATE_SUBMITTED)
+		scheduler_submitted_to_running(xs, xcmd);
+	if (xcmd->state == ERT_CMD_STATE_RUNNING)
+		scheduler_running_to_complete(xs, xcmd);
+	if (xcmd->state == ERT_CMD_STATE_COMPLETED)
+		scheduler_complete_to_free(xs, xcmd);
+	if (xcmd->state == ERT_CMD_STATE_ERROR)
+		scheduler_error_to_free(xs, xcmd);
+	if (xcmd->state == ERT_CMD_STATE_ABORT)
+		scheduler_abort_to_free(xs, xcmd);
+
+	return queued;
+}
+
 /**
  * scheduler_iterator_cmds() - Iterate all commands in scheduler command queue
+ *
+ * High priority commands are iterated first and get the first pick of
+ * free CUs and command queue slots.  In penguin mode, CUs wanted by high
+ * priority commands that are left queued are recorded per device for
+ * scheduler_held_for_high().  With ERT, the ERT orders the commands.
  */
 static void
 scheduler_iterate_cmds(struct xocl_scheduler *xs)
@@ -2491,24 +3235,25 @@ scheduler_iterate_cmds(struct xocl_scheduler *xs)
 	struct list_head *pos, *next;
 
 	SCHED_DEBUGF("-> %s\n", __func__);
+	++xs->iteration;
+	list_for_each_safe(pos, next, &xs->command_queue_hi) {
+		struct xocl_cmd *xcmd = list_entry(pos, struct xocl_cmd, cq_list);
+		struct exec_core *exec = cmd_exec(xcmd);
+
+		if (!scheduler_iterate_cmd(xs, xcmd) || cmd_wait_count(xcmd) ||
+		    !exec_is_penguin(exec))
+			continue;
+
+		if (exec->cu_high_iter != xs->iteration) {
+			bitmap_zero(exec->cu_high_wanted, MAX_CUS);
+			exec->cu_high_iter = xs->iteration;
+		}
+		bitmap_or(exec->cu_high_wanted, exec->cu_high_wanted, xcmd->cu_bitmap, MAX_CUS);
+	}
 	list_for_each_safe(pos, next, &xs->command_queue) {
 		struct xocl_cmd *xcmd = list_entry(pos, struct xocl_cmd, cq_list);
 
-		cmd_update_state(xcmd);
-		SCHED_DEBUGF("+ processing cmd(%lu)\n", xcmd->uid);
-
-		if (xcmd->state == ERT_CMD_STATE_QUEUED)
-			scheduler_queued_to_submitted(xs, xcmd);
-		if (xcmd->state == ERT_CMD_STATE_SUBMITTED)
-			scheduler_submitted_to_running(xs, xcmd);
-		if (xcmd->state == ERT_CMD_STATE_RUNNING)
-			scheduler_running_to_complete(xs, xcmd);
-		if (xcmd->state == ERT_CMD_STATE_COMPLETED)
-			scheduler_complete_to_free(xs, xcmd);
-		if (xcmd->state == ERT_CMD_STATE_ERROR)
-			scheduler_error_to_free(xs, xcmd);
-		if (xcmd->state == ERT_CMD_STATE_ABORT)
-			scheduler_abort_to_free(xs, xcmd);
+		scheduler_iterate_cmd(xs, xcmd);
 	}
 	SCHED_DEBUGF("<- %s\n", __func__);
 }
@@ -2532,11 +3277,16 @@ scheduler_wait_condition(struct xocl_scheduler *xs)
 		return 0;
 	}
 
-	if (atomic_read(&num_pending)) {
+	if (atomic_read(&num_pending) > xs->held) {
 		SCHED_DEBUG("scheduler wakes to copy new pending commands\n");
 		return 0;
 	}
 
+	if (xs->held && xs->share_released) {
+		SCHED_DEBUG("scheduler wakes to admit held pending commands\n");
+		return 0;
+	}
+
 	if (xs->intc) {
 		SCHED_DEBUG("scheduler wakes on interrupt\n");
 		xs->intc = 0;
@@ -2548,6 +3298,11 @@ scheduler_wait_condition(struct xocl_scheduler *xs)
 		return 0;
 	}
 
+	if (xs->spin_deadline && ktime_before(ktime_get(), xs->spin_deadline)) {
+		SCHED_DEBUG("scheduler spins after command start\n");
+		return 0;
+	}
+
 	SCHED_DEBUG("scheduler waits ...\n");
 	return 1;
 }
@@ -2588,6 +3343,9 @@ scheduler_loop(struct xocl_scheduler *xs)
 	/* queue new pending commands */
 	scheduler_queue_cmds(xs);
 
+	/* abort commands of CUs to reset */
+	scheduler_reset_cus(xs);
+
 	/* iterate all commands */
 	scheduler_iterate_cmds(xs);
 
@@ -2639,10 +3397,11 @@ add_xcmd(struct xocl_cmd *xcmd)
 		goto err;
 
 	cmd_set_state(xcmd, ERT_CMD_STATE_NEW);
-	mutex_lock(&pending_cmds_mutex);
-	list_add_tail(&xcmd->cq_list, &pending_cmds);
+	cmd_timestamp(xcmd, submit);
+	mutex_lock(&exec->pending_cmds_mutex);
+	list_add_tail(&xcmd->cq_list, &exec->pending_cmds);
 	atomic_inc(&num_pending);
-	mutex_unlock(&pending_cmds_mutex);
+	mutex_unlock(&exec->pending_cmds_mutex);
 
 	/* wake scheduler */
 	atomic_inc(&xdev->outstanding_execs);
@@ -2662,6 +3421,62 @@ err:
 }
 
 
+/**
+ * add_xcmd_batch() - Add initialized xcmd objects to pending command list
+ *
+ * @exec: Targeted device
+ * @xcmds: Commands to add, all for @exec
+ * @num: Number of commands in @xcmds
+ *
+ * Same as add_xcmd() but for several commands with one acquisition of
+ * the pending list lock and one scheduler wakeup.  The commands are
+ * added all or none.
+ *
+ * Return: 0 on success
+ */
+static int
+add_xcmd_batch(struct exec_core *exec, struct xocl_cmd **xcmds, unsigned int num)
+{
+	struct xocl_dev *xdev = xocl_get_xdev(exec->pdev);
+	unsigned int i;
+
+	if (!num)
+		return 0;
+
+	// Prevent stop and reset
+	mutex_lock(&exec->exec_lock);
+
+	SCHED_DEBUGF("-> %s(%d) pid(%d)\n", __func__, num, pid_nr(task_tgid(current)));
+
+	if (exec->stopped || !exec->configured)
+		goto err;
+
+	for (i = 0; i < num; ++i) {
+		cmd_set_state(xcmds[i], ERT_CMD_STATE_NEW);
+		cmd_timestamp(xcmds[i], submit);
+	}
+
+	mutex_lock(&exec->pending_cmds_mutex);
+	for (i = 0; i < num; ++i)
+		list_add_tail(&xcmds[i]->cq_list, &exec->pending_cmds);
+	atomic_add(num, &num_pending);
+	mutex_unlock(&exec->pending_cmds_mutex);
+
+	/* wake scheduler */
+	atomic_add(num, &xdev->outstanding_execs);
+	atomic64_add(num, &xdev->total_execs);
+	scheduler_wake_up(xcmds[0]->xs);
+
+	SCHED_DEBUGF("<- %s ret(0) num_pending(%d)\n", __func__, atomic_read(&num_pending));
+	mutex_unlock(&exec->exec_lock);
+	return 0;
+
+err:
+	SCHED_DEBUGF("<- %s ret(1) num_pending(%d)\n", __func__, atomic_read(&num_pending));
+	mutex_unlock(&exec->exec_lock);
+	return 1;
+}
+
 /**
  * add_bo_cmd() - Add a new buffer object command to pending list
  *
@@ -2677,7 +3492,7 @@ err:
  */
 static int
 add_bo_cmd(struct exec_core *exec, struct client_ctx *client, struct drm_xocl_bo *bo,
-	   int numdeps, struct drm_xocl_bo **deps)
+	   u32 handle, int numdeps, struct drm_xocl_bo **deps)
 {
 	struct xocl_cmd *xcmd = cmd_get(exec_scheduler(exec), exec, client);
 
@@ -2687,6 +3502,7 @@ add_bo_cmd(struct exec_core *exec, struct client_ctx *client, struct drm_xocl_bo
 	SCHED_DEBUGF("-> %s(%lu)\n", __func__, xcmd->uid);
 
 	cmd_bo_init(xcmd, bo, numdeps, deps, (exec_is_penguin(exec) || exec_is_ert_poll(exec)));
+	xcmd->handle = handle;
 
 	if (add_xcmd(xcmd))
 		goto err;
@@ -2694,8 +3510,8 @@ add_bo_cmd(struct exec_core *exec, struct client_ctx *client, struct drm_xocl_bo
 	SCHED_DEBUGF("<- %s ret(0) opcode(%d) type(%d)\n", __func__, cmd_opcode(xcmd), cmd_type(xcmd));
 	return 0;
 err:
-	cmd_abort(xcmd);
 	SCHED_DEBUGF("<- %s ret(1) opcode(%d) type(%d)\n", __func__, cmd_opcode(xcmd), cmd_type(xcmd));
+	cmd_abort(xcmd);
 	return 1;
 }
 
@@ -2717,8 +3533,8 @@ add_ctrl_cmd(struct exec_core *exec, struct client_ctx *client, struct ert_packe
 	SCHED_DEBUGF("<- %s ret(0) opcode(%d) type(%d)\n", __func__, cmd_opcode(xcmd), cmd_type(xcmd));
 	return 0;
 err:
-	cmd_abort(xcmd);
 	SCHED_DEBUGF("<- %s ret(1) opcode(%d) type(%d)\n", __func__, cmd_opcode(xcmd), cmd_type(xcmd));
+	cmd_abort(xcmd);
 	return 1;
 }
 
@@ -2737,6 +3553,7 @@ init_scheduler_thread(struct xocl_scheduler *xs)
 
 	init_waitqueue_head(&xs->wait_queue);
 	INIT_LIST_HEAD(&xs->command_queue);
+	INIT_LIST_HEAD(&xs->command_queue_hi);
 	scheduler_reset(xs);
 
 	xs->scheduler_thread = kthread_run(scheduler, (void *)xs, "xocl-scheduler-thread0");
@@ -2766,12 +3583,8 @@ fini_scheduler_thread(struct xocl_scheduler *xs)
 	retval = kthread_stop(xs->scheduler_thread);
 
 	/* clear stale command objects if any */
-	pending_cmds_reset();
 	scheduler_cq_reset(xs);
 
-	/* reclaim memory for allocate command objects */
-	cmd_list_delete();
-
 	return retval;
 }
 
@@ -2808,11 +3621,56 @@ static void client_reserve_implicit_cus(struct exec_core *exec,
  */
 int
 add_exec_buffer(struct platform_device *pdev, struct client_ctx *client, void *buf,
-		int numdeps, struct drm_xocl_bo **deps)
+		u32 handle, int numdeps, struct drm_xocl_bo **deps)
 {
 	struct exec_core *exec = platform_get_drvdata(pdev);
 	// Add the command to pending list
-	return add_bo_cmd(exec, client, buf, numdeps, deps);
+	return add_bo_cmd(exec, client, buf, handle, numdeps, deps);
+}
+
+/**
+ * Entry point for batch of exec buffers without dependencies.
+ *
+ * Function adds all exec buffers to the pending list of commands
+ * with one scheduler wakeup.
+ *
+ * Return: 0 on success, 1 on failure in which case no exec buffer
+ * was added
+ */
+static int
+add_exec_buffer_batch(struct platform_device *pdev, struct client_ctx *client,
+		      struct drm_xocl_bo **bos, u32 *handles, unsigned int num)
+{
+	struct exec_core *exec = platform_get_drvdata(pdev);
+	struct xocl_scheduler *xs = exec_scheduler(exec);
+	bool penguin = exec_is_penguin(exec) || exec_is_ert_poll(exec);
+	struct xocl_cmd **xcmds;
+	unsigned int i;
+	int ret = 1;
+
+	xcmds = kmalloc_array(num, sizeof(*xcmds), GFP_KERNEL);
+	if (!xcmds)
+		return 1;
+
+	for (i = 0; i < num; ++i) {
+		xcmds[i] = cmd_get(xs, exec, client);
+		if (IS_ERR_OR_NULL(xcmds[i]))
+			goto err;
+		cmd_bo_init(xcmds[i], bos[i], 0, NULL, penguin);
+		xcmds[i]->handle = handles[i];
+	}
+
+	if (add_xcmd_batch(exec, xcmds, num))
+		goto err;
+
+	kfree(xcmds);
+	return 0;
+
+err:
+	while (i--)
+		cmd_abort(xcmds[i]);
+	kfree(xcmds);
+	return ret;
 }
 
 static int
@@ -2833,6 +3691,12 @@ create_client(struct platform_device *pdev, void **priv)
 		client->abort = false;
 		atomic_set(&client->trigger, 0);
 		atomic_set(&client->outstanding_execs, 0);
+		INIT_KFIFO(client->done_fifo);
+		spin_lock_init(&client->done_lock);
+		mutex_init(&client->done_read_lock);
+		atomic_set(&client->done_overflow, 0);
+		client->ring = NULL;
+		client->ring_head = 0;
 		client->num_cus = 0;
 		client->xdev = xocl_get_xdev(pdev);
 		list_add_tail(&client->link, &xdev->ctx_list);
@@ -2991,6 +3855,7 @@ static void destroy_client(struct platform_device *pdev, void **priv)
 
 done:
 	mutex_unlock(&xdev->dev_lock);
+	vfree(client->ring);
 	devm_kfree(XDEV2DEV(xdev), client);
 	*priv = NULL;
 }
@@ -3178,7 +4043,8 @@ static int convert_execbuf(struct xocl_dev *xdev, struct drm_file *filp,
 	struct ert_start_copybo_cmd *scmd = (struct ert_start_copybo_cmd *)xobj->vmapping;
 
 	/* CU style commands must specify CU type */
-	if (scmd->opcode == ERT_START_CU || scmd->opcode == ERT_EXEC_WRITE)
+	if (scmd->opcode == ERT_START_CU || scmd->opcode == ERT_EXEC_WRITE ||
+	    scmd->opcode == ERT_START_DAG)
 		scmd->type = ERT_CU;
 
 	/* Only convert COPYBO cmd for now. */
@@ -3232,33 +4098,29 @@ static int convert_execbuf(struct xocl_dev *xdev, struct drm_file *filp,
 	return 0;
 }
 
+/**
+ * lookup_execbuf() - Look up and validate exec buffer BO from user handle
+ *
+ * Looks up the gem object corresponding to the BO handle.  This adds a
+ * reference to the gem object.  On success the reference is returned
+ * in @xobjp and must be passed to kds or released by caller.  On error
+ * the reference is released here.
+ *
+ * Return: 0 on success, -errno otherwise
+ */
 static int
-client_ioctl_execbuf(struct platform_device *pdev,
-		     struct client_ctx *client, void *data, struct drm_file *filp)
+lookup_execbuf(struct platform_device *pdev, struct client_ctx *client,
+	       struct drm_file *filp, u32 handle, struct drm_xocl_bo **xobjp)
 {
-	struct drm_xocl_execbuf *args = data;
 	struct drm_xocl_bo *xobj;
 	struct drm_gem_object *obj;
-	struct drm_xocl_bo *deps[8] = {0};
-	int numdeps = -1;
-	int ret = 0;
 	struct xocl_dev	*xdev = xocl_get_xdev(pdev);
 	struct drm_device *ddev = filp->minor->dev;
-	struct exec_core *exec = platform_get_drvdata(pdev);
-
-	if (exec->needs_reset) {
-		userpf_err(xdev, "device needs reset, use 'xbutil reset'");
-		return -EBUSY;
-	}
+	int ret = 0;
 
-	/* Look up the gem object corresponding to the BO handle.
-	 * This adds a reference to the gem object.  The refernece is
-	 * passed to kds or released here if errors occur.
-	 */
-	obj = xocl_gem_object_lookup(ddev, filp, args->exec_bo_handle);
+	obj = xocl_gem_object_lookup(ddev, filp, handle);
 	if (!obj) {
-		userpf_err(xdev, "Failed to look up GEM BO %d\n",
-		args->exec_bo_handle);
+		userpf_err(xdev, "Failed to look up GEM BO %d\n", handle);
 		return -ENOENT;
 	}
 
@@ -3277,6 +4139,84 @@ client_ioctl_execbuf(struct platform_device *pdev,
 		goto out;
 	}
 
+	*xobjp = xobj;
+	return 0;
+
+out:
+	XOCL_DRM_GEM_OBJECT_PUT_UNLOCKED(&xobj->base);
+	return ret;
+}
+
+/**
+ * client_quota_admit() - Wait until client may queue more commands
+ *
+ * @exec: execution core
+ * @client: client submitting commands
+ * @num: number of commands the client wants to queue
+ *
+ * With a client quota, each client can have at most client_quota
+ * commands outstanding so that processes sharing CUs get fair access
+ * to the scheduler.  The caller is blocked until at least one command
+ * can be admitted.
+ *
+ * Return: number of commands admitted, or negative error code
+ */
+static int
+client_quota_admit(struct exec_core *exec, struct client_ctx *client,
+		   unsigned int num)
+{
+	unsigned int quota = READ_ONCE(exec->client_quota);
+	int outstanding;
+	int ret;
+
+	if (!quota)
+		return num;
+
+	outstanding = atomic_read(&client->outstanding_execs);
+	if (outstanding >= quota) {
+		ret = wait_event_interruptible(exec->quota_wait_queue,
+			(quota = READ_ONCE(exec->client_quota)) == 0 ||
+			atomic_read(&client->outstanding_execs) < quota);
+		if (ret)
+			return ret;
+		if (!quota)
+			return num;
+		outstanding = atomic_read(&client->outstanding_execs);
+	}
+
+	return min_t(unsigned int, num, quota - min_t(int, outstanding, quota - 1));
+}
+
+static int
+client_ioctl_execbuf(struct platform_device *pdev,
+		     struct client_ctx *client, void *data, struct drm_file *filp)
+{
+	struct drm_xocl_execbuf *args = data;
+	struct drm_xocl_bo *xobj;
+	struct drm_xocl_bo *deps[8] = {0};
+	int numdeps = -1;
+	int ret = 0;
+	struct xocl_dev	*xdev = xocl_get_xdev(pdev);
+	struct drm_device *ddev = filp->minor->dev;
+	struct exec_core *exec = platform_get_drvdata(pdev);
+
+	if (exec->needs_reset) {
+		userpf_err(xdev, "device needs reset, use 'xbutil reset'");
+		return -EBUSY;
+	}
+
+	ret = client_quota_admit(exec, client, 1);
+	if (ret < 0)
+		return ret;
+	ret = 0;
+
+	/* The reference acquired by lookup is passed to kds or
+	 * released here if errors occur.
+	 */
+	ret = lookup_execbuf(pdev, client, filp, args->exec_bo_handle, &xobj);
+	if (ret)
+		return ret;
+
 	/* Copy dependencies from user.	 It is an error if a BO handle specified
 	 * as a dependency does not exists. Lookup gem object corresponding to bo
 	 * handle.  Convert gem object to xocl_bo extension.  Note that the
@@ -3302,7 +4242,7 @@ client_ioctl_execbuf(struct platform_device *pdev,
 	 * drm object references acquired by xobj and deps.  It is vital
 	 * that the references are released properly.
 	 */
-	ret = add_exec_buffer(pdev, client, xobj, numdeps, deps);
+	ret = add_exec_buffer(pdev, client, xobj, args->exec_bo_handle, numdeps, deps);
 	if (ret) {
 		userpf_err(xdev, "Failed to add exec buffer to scheduler\n");
 		ret = -EINVAL;
@@ -3324,6 +4264,173 @@ out:
 	return ret;
 }
 
+/**
+ * client_ioctl_execbuf_batch() - Submit several exec buffers in one call
+ *
+ * Exec buffers are validated in order and all valid buffers up to the
+ * first failure are queued with one scheduler wakeup.  args->count is
+ * set to the number of buffers queued.
+ */
+static int
+client_ioctl_execbuf_batch(struct platform_device *pdev,
+			   struct client_ctx *client, void *data, struct drm_file *filp)
+{
+	struct drm_xocl_execbuf_batch *args = data;
+	struct xocl_dev	*xdev = xocl_get_xdev(pdev);
+	struct exec_core *exec = platform_get_drvdata(pdev);
+	struct drm_xocl_bo **xobjs = NULL;
+	u32 *handles = NULL;
+	unsigned int num = args->count;
+	unsigned int i = 0;
+	int ret = 0;
+
+	args->count = 0;
+
+	if (exec->needs_reset) {
+		userpf_err(xdev, "device needs reset, use 'xbutil reset'");
+		return -EBUSY;
+	}
+
+	if (!num)
+		return 0;
+	if (num > DRM_XOCL_EXECBUF_BATCH_MAX)
+		return -EINVAL;
+
+	/* Queue what the client quota admits, user resubmits the rest */
+	ret = client_quota_admit(exec, client, num);
+	if (ret < 0)
+		return ret;
+	num = ret;
+	ret = 0;
+
+	handles = kmalloc_array(num, sizeof(*handles), GFP_KERNEL);
+	xobjs = kmalloc_array(num, sizeof(*xobjs), GFP_KERNEL);
+	if (!handles || !xobjs) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	if (copy_from_user(handles, (void __user *)(uintptr_t)args->handles,
+			   num * sizeof(*handles))) {
+		ret = -EFAULT;
+		goto out;
+	}
+
+	/* Stop at first invalid exec buffer, but queue those before it */
+	for (i = 0; i < num; ++i) {
+		ret = lookup_execbuf(pdev, client, filp, handles[i], &xobjs[i]);
+		if (ret)
+			break;
+	}
+
+	if (i && add_exec_buffer_batch(pdev, client, xobjs, handles, i)) {
+		userpf_err(xdev, "Failed to add exec buffers to scheduler\n");
+		ret = -EINVAL;
+		goto out;
+	}
+
+	/* The gem object references are now managed by kds */
+	args->count = i;
+	i = 0;
+
+out:
+	while (i--)
+		XOCL_DRM_GEM_OBJECT_PUT_UNLOCKED(&xobjs[i]->base);
+	kfree(xobjs);
+	kfree(handles);
+	return ret;
+}
+
+/**
+ * client_ioctl_execbuf_done() - Drain completed exec buffer handles
+ *
+ * Copies up to args->count handles from the client done fifo to the
+ * user array and sets DRM_XOCL_EXECBUF_DONE_OVERFLOW if handles were
+ * lost since the last call.
+ */
+static int
+client_ioctl_execbuf_done(struct platform_device *pdev,
+			  struct client_ctx *client, void *data)
+{
+	struct drm_xocl_execbuf_done *args = data;
+	unsigned int copied = 0;
+	int ret = 0;
+
+	args->flags = 0;
+	if (atomic_xchg(&client->done_overflow, 0))
+		args->flags |= DRM_XOCL_EXECBUF_DONE_OVERFLOW;
+
+	if (!args->count) {
+		args->count = kfifo_len(&client->done_fifo);
+		return 0;
+	}
+
+	mutex_lock(&client->done_read_lock);
+	ret = kfifo_to_user(&client->done_fifo, (void __user *)(uintptr_t)args->handles,
+			    args->count * sizeof(u32), &copied);
+	mutex_unlock(&client->done_read_lock);
+
+	args->count = copied / sizeof(u32);
+	return ret;
+}
+
+/**
+ * client_ioctl_reset_cu() - Reset one CU of the device
+ *
+ * The reset is done by the scheduler thread, which owns the CU state.
+ * Wait for it to finish, so the status of the CU is known on return.
+ *
+ * Return: 0 if the CU is idle and usable, -EBUSY if the CU did not return
+ * to idle and is disabled, -EOPNOTSUPP if CUs are scheduled by ERT.
+ */
+static int
+client_ioctl_reset_cu(struct platform_device *pdev,
+		      struct client_ctx *client, void *data)
+{
+	struct drm_xocl_reset_cu *args = data;
+	struct xocl_dev *xdev = xocl_get_xdev(pdev);
+	struct exec_core *exec = platform_get_drvdata(pdev);
+	u32 cu_idx = args->cu_index;
+	unsigned int wait_ms = 10;
+	unsigned int retry = 200;  // 2 sec
+	int ret = 0;
+
+	mutex_lock(&exec->exec_lock);
+	if (!exec_is_penguin(exec)) {
+		userpf_err(xdev, "CU reset requires CUs scheduled by KDS\n");
+		ret = -EOPNOTSUPP;
+		goto out;
+	}
+
+	if (cu_idx >= exec->num_cus || !exec_valid_cu(exec, cu_idx)) {
+		userpf_err(xdev, "invalid CU(%d)", cu_idx);
+		ret = -EINVAL;
+		goto out;
+	}
+
+	if (!test_bit(cu_idx, client->cu_bitmap) && !client->virt_cu_ref) {
+		userpf_err(xdev, "no context on CU(%d)", cu_idx);
+		ret = -EPERM;
+		goto out;
+	}
+
+	userpf_info(xdev, "%s cu(%d) pid(%d)\n", __func__, cu_idx,
+		    pid_nr(task_tgid(current)));
+	set_bit(cu_idx, exec->cu_reset_req);
+	scheduler_intr(exec->scheduler);
+out:
+	mutex_unlock(&exec->exec_lock);
+	if (ret)
+		return ret;
+
+	while (--retry && test_bit(cu_idx, exec->cu_reset_req))
+		msleep(wait_ms);
+	if (test_bit(cu_idx, exec->cu_reset_req))
+		return -ETIMEDOUT;
+
+	return test_bit(cu_idx, exec->cu_disabled) ? -EBUSY : 0;
+}
+
 int client_ioctl(struct platform_device *pdev,
 		 int op, void *data, void *drm_filp)
 {
@@ -3338,6 +4445,15 @@ int client_ioctl(struct platform_device *pdev,
 	case DRM_XOCL_EXECBUF:
 		ret = client_ioctl_execbuf(pdev, client, data, drm_filp);
 		break;
+	case DRM_XOCL_EXECBUF_DONE:
+		ret = client_ioctl_execbuf_done(pdev, client, data);
+		break;
+	case DRM_XOCL_EXECBUF_BATCH:
+		ret = client_ioctl_execbuf_batch(pdev, client, data, drm_filp);
+		break;
+	case DRM_XOCL_RESET_CU:
+		ret = client_ioctl_reset_cu(pdev, client, data);
+		break;
 	default:
 		ret = -EINVAL;
 		break;
@@ -3416,6 +4532,54 @@ reconfig(struct platform_device *pdev)
 	return 0;
 }
 
+/**
+ * validate_dag() - Check structure of DAG command
+ *
+ * Nodes must fit in the command, depend only on nodes with lower
+ * index, and use only CUs that are in the command CU masks, which in
+ * turn are checked against the context by caller.
+ */
+static int
+validate_dag(struct ert_start_dag_cmd *dcmd)
+{
+	u32 cumasks = 1 + dcmd->extra_cu_masks;
+	u32 *cmd_cus = &dcmd->cu_mask;
+	u32 *end = cmd_cus + dcmd->count;
+	u32 *word = cmd_cus + cumasks;
+	u32 num_nodes, node, maskidx;
+
+	if (word >= end)
+		return 1;
+
+	num_nodes = *word++;
+	if (!num_nodes || num_nodes > ERT_DAG_MAX_NODES)
+		return 1;
+
+	for (node = 0; node < num_nodes; ++node) {
+		struct ert_dag_node *dnode = (struct ert_dag_node *)word;
+		u32 *node_cus = &dnode->cmd.cu_mask;
+		u32 nmasks;
+
+		if (word + 2 > end || word + 2 + dnode->cmd.count > end)
+			return 1;
+		if (dnode->deps & ~((1 << node) - 1))
+			return 1;
+
+		nmasks = 1 + dnode->cmd.extra_cu_masks;
+		if (dnode->cmd.count < nmasks)
+			return 1;
+		for (maskidx = 0; maskidx < nmasks; ++maskidx) {
+			u32 allowed = maskidx < cumasks ? cmd_cus[maskidx] : 0;
+
+			if (node_cus[maskidx] & ~allowed)
+				return 1;
+		}
+		word += 2 + dnode->cmd.count;
+	}
+
+	return 0;
+}
+
 /**
  * validate() - Check if requested cmd is valid in the current context
  */
@@ -3460,6 +4624,12 @@ validate(struct platform_device *pdev, struct client_ctx *client, const struct d
 		}
 	}
 
+	if (ecmd->opcode == ERT_START_DAG &&
+	    validate_dag((struct ert_start_dag_cmd *)ecmd)) {
+		userpf_err(xocl_get_xdev(pdev), "%s found malformed DAG\n", __func__);
+		err = 1;
+	}
+
 out:
 	mutex_unlock(&client->xdev->dev_lock);
 	SCHED_DEBUGF("<- %s(%d) cmd and ctx CUs match\n", __func__, err);
@@ -3523,6 +4693,24 @@ kds_numcus_show(struct device *dev, struct device_attribute *attr, char *buf)
 }
 static DEVICE_ATTR_RO(kds_numcus);
 
+/*
+ * Scheduling mode configured for the loaded xclbin, one of "ert",
+ * "ert_poll", or "penguin"
+ */
+static ssize_t
+kds_mode_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct exec_core *exec = dev_get_exec(dev);
+	const char *mode = "penguin";
+
+	if (exec && exec_is_ert(exec))
+		mode = "ert";
+	else if (exec && exec_is_ert_poll(exec))
+		mode = "ert_poll";
+	return sprintf(buf, "%s\n", mode);
+}
+static DEVICE_ATTR_RO(kds_mode);
+
 static ssize_t
 kds_cucounts_show(struct device *dev, struct device_attribute *attr, char *buf)
 {
@@ -3596,11 +4784,210 @@ kds_custat_show(struct device *dev, struct device_attribute *attr, char *buf)
 }
 static DEVICE_ATTR_RO(kds_custat);
 
+/*
+ * Interrupt coalescing, "<count> <usecs>".  The count also applies to
+ * ERT completion notifications from next xclbin configuration.
+ */
+static ssize_t
+kds_intr_coalesce_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct exec_core *exec = dev_get_exec(dev);
+
+	return sprintf(buf, "%u %u\n", exec->intr_coalesce_cnt, exec->intr_coalesce_usecs);
+}
+
+static ssize_t
+kds_intr_coalesce_store(struct device *dev, struct device_attribute *attr,
+	const char *buf, size_t count)
+{
+	struct exec_core *exec = dev_get_exec(dev);
+	unsigned int cnt, usecs;
+
+	if (sscanf(buf, "%u %u", &cnt, &usecs) != 2 || (cnt > 1 && !usecs) ||
+	    usecs > USEC_PER_SEC) {
+		xocl_err(dev, "usage: echo '<count> <usecs>' > kds_intr_coalesce, usecs <= 1000000");
+		return -EINVAL;
+	}
+
+	exec->intr_coalesce_usecs = usecs;
+	exec->intr_coalesce_cnt = cnt;
+	return count;
+}
+static DEVICE_ATTR_RW(kds_intr_coalesce);
+
+/*
+ * Adaptive polling budget in usecs.  After a command start the scheduler
+ * polls ERT status registers for this long before it sleeps until
+ * interrupt.  0 (default) disables spinning.  Applies in interrupt mode.
+ */
+static ssize_t
+kds_spin_budget_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct exec_core *exec = dev_get_exec(dev);
+
+	return sprintf(buf, "%u\n", exec->spin_budget_usecs);
+}
+
+static ssize_t
+kds_spin_budget_store(struct device *dev, struct device_attribute *attr,
+	const char *buf, size_t count)
+{
+	struct exec_core *exec = dev_get_exec(dev);
+	unsigned int usecs;
+
+	if (kstrtouint(buf, 10, &usecs) || usecs > USEC_PER_SEC) {
+		xocl_err(dev, "usage: echo <usecs> > kds_spin_budget, usecs <= 1000000");
+		return -EINVAL;
+	}
+
+	exec->spin_budget_usecs = usecs;
+	return count;
+}
+static DEVICE_ATTR_RW(kds_spin_budget);
+
+/*
+ * Max outstanding commands per client (process), 0 (default) for no
+ * limit.  Clients that share CUs then cannot flood the scheduler queue
+ * ahead of each other.  Submissions over quota block until commands of
+ * the client complete.
+ */
+static ssize_t
+kds_client_quota_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct exec_core *exec = dev_get_exec(dev);
+
+	return sprintf(buf, "%u\n", exec->client_quota);
+}
+
+static ssize_t
+kds_client_quota_store(struct device *dev, struct device_attribute *attr,
+	const char *buf, size_t count)
+{
+	struct exec_core *exec = dev_get_exec(dev);
+	unsigned int quota;
+
+	if (kstrtouint(buf, 10, &quota)) {
+		xocl_err(dev, "usage: echo <cmds> > kds_client_quota, 0 for no limit");
+		return -EINVAL;
+	}
+
+	WRITE_ONCE(exec->client_quota, quota);
+	wake_up_interruptible(&exec->quota_wait_queue);
+	return count;
+}
+static DEVICE_ATTR_RW(kds_client_quota);
+
+/*
+ * Max commands per client (process) in the scheduler queue, 0 (default)
+ * for no limit.  With a limit, clients sharing CUs are admitted to the
+ * scheduler queue round robin rather than in global submission order.
+ */
+static ssize_t
+kds_client_share_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct exec_core *exec = dev_get_exec(dev);
+
+	return sprintf(buf, "%u\n", exec->client_share);
+}
+
+static ssize_t
+kds_client_share_store(struct device *dev, struct device_attribute *attr,
+	const char *buf, size_t count)
+{
+	struct exec_core *exec = dev_get_exec(dev);
+	unsigned int share;
+
+	if (kstrtouint(buf, 10, &share)) {
+		xocl_err(dev, "usage: echo <cmds> > kds_client_share, 0 for no limit");
+		return -EINVAL;
+	}
+
+	WRITE_ONCE(exec->client_share, share);
+	exec->scheduler->share_released = 1;
+	scheduler_wake_up(exec->scheduler);
+	return count;
+}
+static DEVICE_ATTR_RW(kds_client_share);
+
+/*
+ * Per client scheduling statistics, one line per client context
+ * "<pid> <outstanding> <queued> <admitted>", where queued is the number
+ * of commands currently in the scheduler queue and admitted is the total
+ * number of commands moved to the scheduler queue.
+ */
+static ssize_t
+kds_client_stats_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct xocl_dev *xdev = dev_get_xdev(dev);
+	struct client_ctx *client;
+	ssize_t sz = 0;
+
+	if (!xdev)
+		return 0;
+
+	mutex_lock(&xdev->dev_lock);
+	list_for_each_entry(client, &xdev->ctx_list, link) {
+		if (sz > PAGE_SIZE - 64)
+			break;
+		sz += sprintf(buf+sz, "%d %d %d %lld\n",
+			      pid_nr(client->pid),
+			      atomic_read(&client->outstanding_execs),
+			      atomic_read(&client->sched_cmds),
+			      (long long)atomic64_read(&client->sched_total));
+	}
+	mutex_unlock(&xdev->dev_lock);
+	return sz;
+}
+static DEVICE_ATTR_RO(kds_client_stats);
+
+/*
+ * Adaptive polling statistics and command latency histogram, each
+ * latency line is "<from>-<to>us <count>", last line is open ended.
+ * Write to clear.
+ */
+static ssize_t
+kds_poll_stats_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct exec_core *exec = dev_get_exec(dev);
+	ssize_t sz;
+	unsigned int i;
+
+	sz = sprintf(buf, "spins %lu\nspin_hits %lu\nwakeups %d\n",
+		     exec->stat_spins, exec->stat_spin_hits,
+		     atomic_read(&exec->stat_wakeups));
+	for (i = 0; i < KDS_LATENCY_BUCKETS - 1; ++i)
+		sz += sprintf(buf+sz, "%u-%uus %u\n",
+			      i ? 1u << (i - 1) : 0, 1u << i, exec->stat_latency[i]);
+	sz += sprintf(buf+sz, "%u-us %u\n", 1u << (i - 1), exec->stat_latency[i]);
+	return sz;
+}
+
+static ssize_t
+kds_poll_stats_store(struct device *dev, struct device_attribute *attr,
+	const char *buf, size_t count)
+{
+	struct exec_core *exec = dev_get_exec(dev);
+
+	exec->stat_spins = 0;
+	exec->stat_spin_hits = 0;
+	atomic_set(&exec->stat_wakeups, 0);
+	memset(exec->stat_latency, 0, sizeof(exec->stat_latency));
+	return count;
+}
+static DEVICE_ATTR_RW(kds_poll_stats);
+
 static struct attribute *kds_sysfs_attrs[] = {
 	&dev_attr_kds_numcus.attr,
+	&dev_attr_kds_mode.attr,
 	&dev_attr_kds_cucounts.attr,
 	&dev_attr_kds_numcdmas.attr,
 	&dev_attr_kds_custat.attr,
+	&dev_attr_kds_intr_coalesce.attr,
+	&dev_attr_kds_spin_budget.attr,
+	&dev_attr_kds_client_quota.attr,
+	&dev_attr_kds_client_share.attr,
+	&dev_attr_kds_client_stats.attr,
+	&dev_attr_kds_poll_stats.attr,
 	NULL
 };
 
@@ -3640,12 +5027,16 @@ static int mb_scheduler_probe(struct platform_device *pdev)
 	init_scheduler_thread(&scheduler0);
 	platform_set_drvdata(pdev, exec);
 
+	mutex_lock(&exec_list_mutex);
+	list_add_tail(&exec->sched_list, &exec_list);
+	mutex_unlock(&exec_list_mutex);
+
 	DRM_INFO("command scheduler started\n");
 
 	return 0;
 
 err:
-	devm_kfree(&pdev->dev, exec);
+	exec_destroy(exec);
 	return 1;
 }
 
@@ -3659,6 +5050,11 @@ static int mb_scheduler_remove(struct platform_device *pdev)
 	struct exec_core *exec = platform_get_drvdata(pdev);
 
 	SCHED_DEBUGF("-> %s\n", __func__);
+	mutex_lock(&exec_list_mutex);
+	list_del(&exec->sched_list);
+	mutex_unlock(&exec_list_mutex);
+	pending_cmds_reset(exec);
+
 	fini_scheduler_thread(exec_scheduler(exec));
 
 	xdev = xocl_get_xdev(pdev);
@@ -29,8 +29,10 @@
 #include <linux/aio.h>
 #include <linux/uio.h>
 #include <linux/slab.h>
+#include <linux/vmalloc.h>
 #include "../xocl_drv.h"
 #include "../xocl_drm.h"
+#include "../xocl_trace.h"
 #include "../lib/libqdma/libqdma_export.h"
 #include "qdma_ioctl.h"
 
@@ -84,6 +86,14 @@ struct stream_async_arg {
 	bool			cancel;
 	struct kiocb		*kiocb;
 	struct stream_async_req *io_req;
+	struct xocl_qdma_aggr_hdr *aggr_hdr;
+	/* completes to the completion ring with ring_tag */
+	bool			ring;
+	u64			ring_tag;
+	/* QoS accounting, see stream_qos_admit() */
+	u32			qos_bytes;
+	u32			done_bytes;
+	ktime_t			qos_start;
 	spinlock_t		lock;
 	struct work_struct	work;
 };
@@ -110,6 +120,10 @@ struct stream_queue {
 	wait_queue_head_t 	wq;
 	int			flowid;
 	int			routeid;
+	/* H2C route shared with other shared queues */
+	bool			route_shared;
+	/* owns the route / flow link in sysfs */
+	bool			sysfs_link;
 	struct file		*file;
 	int			qfd;
 	kuid_t			uid;
@@ -117,6 +131,24 @@ struct stream_queue {
 	struct list_head	req_pend_list;
 	struct list_head	req_free_list;
 	struct stream_async_req *req_cache;
+	/* registered frame buffer */
+	struct drm_gem_object	*frame_bo;
+	u32			frame_size;
+	u32			frame_num;
+	/* completion ring, entries reserved by requests in flight */
+	struct xocl_qdma_cmpl_ring *cring;
+	size_t			cring_size;
+	u32			cring_pend;
+	spinlock_t		cring_lock;
+	/* QoS, protected by lock of qdma->qos[c2h] */
+	u32			qos_prio;
+	u32			qos_weight;
+	u64			qos_inflight;
+	u64			xfer_bytes;
+	u64			xfer_cnt;
+	u64			lat_total_ns;
+	u64			lat_max_ns;
+	ktime_t			xfer_start;
 	/* stats */
 	unsigned int 		req_pend_cnt;
 	unsigned int 		req_free_cnt;
@@ -126,6 +158,19 @@ struct stream_queue {
 	unsigned int 		req_cancel_cmpl_cnt;
 };
 
+/* in flight bytes shared by busy queues of one direction under QoS */
+#define	STREAM_QOS_BUDGET	(4 << 20)
+#define	STREAM_QOS_PRIO_NUM	4
+
+struct stream_qos {
+	spinlock_t		lock;
+	wait_queue_head_t	wq;
+	/* sum of weights of queues with requests in flight */
+	u32			weight_total;
+	/* queues waiting for admission, per priority */
+	u32			waiting[STREAM_QOS_PRIO_NUM];
+};
+
 struct xocl_qdma {
 	void			*dma_handle;
 
@@ -134,13 +179,8 @@ struct xocl_qdma {
 	struct platform_device	*pdev;
 	/* Number of bidirectional channels */
 	u32			channel;
-	/* Semaphore, one for each direction */
-	struct semaphore	channel_sem[2];
-	/*
-	 * Channel usage bitmasks, one for each direction
-	 * bit 1 indicates channel is free, bit 0 indicates channel is free
-	 */
-	volatile unsigned long	channel_bitmap[2];
+	/* Channel arbiter, one for each direction */
+	struct xocl_chan_arb	channel_arb[2];
 
 	struct mm_channel	*chans[2];
 
@@ -158,6 +198,11 @@ struct xocl_qdma {
 	spinlock_t		user_msix_table_lock;
 
 	struct stream_queue	*queues[QDMA_QSETS_MAX * 2];
+
+	/* stream QoS, one arbiter per direction, indexed by c2h */
+	struct stream_qos	qos[2];
+	/* queues created with priority or weight, protected by str_dev_lock */
+	int			qos_queues;
 };
 
 struct mm_channel {
@@ -259,6 +304,65 @@ static ssize_t stat_show(struct device *dev, struct device_attribute *da,
 }
 static DEVICE_ATTR_RO(stat);
 
+static ssize_t stream_stat_show(struct device *dev,
+	struct device_attribute *da, char *buf)
+{
+	struct stream_queue *queue = dev_get_drvdata(dev);
+	struct stream_qos *qos = &queue->qdma->qos[queue->qconf.c2h];
+	struct qdma_queue_stats stat, *pstat;
+	u64 inflight, bytes, cnt, lat_total, lat_max, elapsed_us;
+	ktime_t start;
+	int off = 0;
+
+	if (qdma_queue_get_stats((unsigned long)queue->qdma->dma_handle,
+				queue->queue, &stat) < 0)
+		return sprintf(buf, "Input invalid\n");
+
+	pstat = &stat;
+
+	__SHOW_MEMBER(pstat, pending_bytes);
+	__SHOW_MEMBER(pstat, pending_requests);
+	__SHOW_MEMBER(pstat, complete_bytes);
+	__SHOW_MEMBER(pstat, complete_requests);
+	__SHOW_MEMBER(queue, qos_prio);
+	__SHOW_MEMBER(queue, qos_weight);
+
+	spin_lock_irq(&qos->lock);
+	inflight = queue->qos_inflight;
+	bytes = queue->xfer_bytes;
+	cnt = queue->xfer_cnt;
+	lat_total = queue->lat_total_ns;
+	lat_max = queue->lat_max_ns;
+	start = queue->xfer_start;
+	spin_unlock_irq(&qos->lock);
+
+	/* bytes per us is MB/s */
+	elapsed_us = cnt ? ktime_us_delta(ktime_get(), start) : 0;
+	off += snprintf(buf + off, 64, "inflight_bytes:%llu\n", inflight);
+	off += snprintf(buf + off, 64, "xfer_bytes:%llu\n", bytes);
+	off += snprintf(buf + off, 64, "xfer_requests:%llu\n", cnt);
+	off += snprintf(buf + off, 64, "throughput_MBps:%llu\n",
+		elapsed_us ? div64_u64(bytes, elapsed_us) : 0);
+	off += snprintf(buf + off, 64, "latency_avg_us:%llu\n",
+		cnt ? div64_u64(lat_total, cnt * NSEC_PER_USEC) : 0);
+	off += snprintf(buf + off, 64, "latency_max_us:%llu\n",
+		div64_u64(lat_max, NSEC_PER_USEC));
+
+	return off;
+}
+static struct device_attribute dev_attr_stream_stat =
+	__ATTR(stat, 0444, stream_stat_show, NULL);
+
+static struct attribute *stream_attributes[] = {
+	&dev_attr_stream_stat.attr,
+	&dev_attr_qinfo.attr,
+	NULL,
+};
+
+static const struct attribute_group stream_attrgroup = {
+	.attrs = stream_attributes,
+};
+
 static struct attribute *queue_attributes[] = {
 	&dev_attr_stat.attr,
 	&dev_attr_qinfo.attr,
@@ -329,8 +433,9 @@ static void stream_sysfs_destroy(struct stream_queue *queue)
 		snprintf(name, sizeof(name) - 1, "route%d", queue->routeid);
 
 	if (get_device(&queue->dev)) {
-		sysfs_remove_link(&pdev->dev.kobj, (const char *)name);
-		sysfs_remove_group(&queue->dev.kobj, &queue_attrgroup);
+		if (queue->sysfs_link)
+			sysfs_remove_link(&pdev->dev.kobj, (const char *)name);
+		sysfs_remove_group(&queue->dev.kobj, &stream_attrgroup);
 		put_device(&queue->dev);
 		device_unregister(&queue->dev);
 	}
@@ -346,6 +451,7 @@ static int stream_sysfs_create(struct stream_queue *queue)
 	struct platform_device	*pdev = queue->qdma->pdev;
 	struct stream_queue	*temp_q;
 	char			name[32];
+	bool			link = true;
 	int			ret, i;
 
 #if 0
@@ -367,6 +473,11 @@ static int stream_sysfs_create(struct stream_queue *queue)
 
 		 if (!(temp_q->qconf.c2h) && !(queue->qconf.c2h) &&
 			temp_q->routeid == queue->routeid) {
+			if (temp_q->route_shared && queue->route_shared) {
+				/* first queue of the route keeps the link */
+				link = false;
+				continue;
+			}
 			 xocl_err(&pdev->dev,
 				"routeid overlapped with queue %d", i);
 			 return -EINVAL;
@@ -385,12 +496,15 @@ static int stream_sysfs_create(struct stream_queue *queue)
 		goto failed;
 	}
 
-	ret = sysfs_create_group(&queue->dev.kobj, &queue_attrgroup);
+	ret = sysfs_create_group(&queue->dev.kobj, &stream_attrgroup);
 	if (ret) {
 		xocl_err(&pdev->dev, "create sysfs group failed");
 		goto failed;
 	}
 
+	if (!link)
+		return 0;
+
 	if (queue->qconf.c2h)
 		snprintf(name, sizeof(name) - 1, "flow%d", queue->flowid);
 	else
@@ -400,9 +514,10 @@ static int stream_sysfs_create(struct stream_queue *queue)
 			(const char *)name);
 	if (ret) {
 		xocl_err(&pdev->dev, "create sysfs link %s failed", name);
-		sysfs_remove_group(&queue->dev.kobj, &queue_attrgroup);
+		sysfs_remove_group(&queue->dev.kobj, &stream_attrgroup);
 		goto failed;
 	}
+	queue->sysfs_link = true;
 
 	return 0;
 
@@ -457,7 +572,8 @@ static const struct attribute_group qdma_attrgroup = {
 /* end of sysfs */
 
 static ssize_t qdma_migrate_bo(struct platform_device *pdev,
-	struct sg_table *sgt, u32 write, u64 paddr, u32 channel, u64 len)
+	struct sg_table *sgt, u32 write, u64 paddr, u32 channel, u64 len,
+	u32 flags)
 {
 	struct mm_channel *chan;
 	struct xocl_qdma *qdma;
@@ -492,11 +608,14 @@ static ssize_t qdma_migrate_bo(struct platform_device *pdev,
 
 	req.dma_mapped = 1;
 
+	trace_xocl_dma_start(XDEV(xdev)->dev_minor, write, channel, paddr, len);
 	ret = qdma_request_submit((unsigned long)qdma->dma_handle, chan->queue,
 				&req);
+	trace_xocl_dma_done(XDEV(xdev)->dev_minor, write, channel, ret);
 
 	if (ret >= 0) {
 		chan->total_trans_bytes += ret;
+		xocl_usage_dma_add(xdev, write, channel, ret);
 	} else  {
 		xocl_err(&pdev->dev, "DMA failed, Dumping SG Page Table");
 		dump_sgtable(&pdev->dev, sgt);
@@ -513,36 +632,21 @@ static void release_channel(struct platform_device *pdev, u32 dir, u32 channel)
 
 
 	qdma = platform_get_drvdata(pdev);
-        set_bit(channel, &qdma->channel_bitmap[dir]);
-        up(&qdma->channel_sem[dir]);
+	xocl_chan_arb_release(&qdma->channel_arb[dir], channel);
 }
 
-static int acquire_channel(struct platform_device *pdev, u32 dir)
+static int acquire_channel(struct platform_device *pdev, u32 dir, u32 flags)
 {
 	struct xocl_qdma *qdma;
 	int channel = 0;
-	int result = 0;
 	u32 write;
 
 	qdma = platform_get_drvdata(pdev);
 
-	if (down_killable(&qdma->channel_sem[dir])) {
-		channel = -ERESTARTSYS;
+	channel = xocl_chan_arb_acquire(&qdma->channel_arb[dir],
+		flags & XOCL_DMA_FLAG_PRIO);
+	if (channel < 0)
 		goto out;
-	}
-
-	for (channel = 0; channel < qdma->channel; channel++) {
-		result = test_and_clear_bit(channel,
-			&qdma->channel_bitmap[dir]);
-		if (result)
-			break;
-        }
-        if (!result) {
-		// How is this possible?
-		up(&qdma->channel_sem[dir]);
-		channel = -EIO;
-		goto out;
-	}
 
 	write = dir ? 1 : 0;
 	if (strlen(qdma->chans[write][channel].qconf.name) == 0) {
@@ -607,14 +711,11 @@ static int set_max_chan(struct xocl_qdma *qdma, u32 count)
 	if (qdma->channel == count)
 		reset = true;
 	qdma->channel = count;
+	xocl_usage_set(xocl_get_xdev(pdev), dma_channel_count,
+		min_t(u32, count, XOCL_USAGE_MAX_DMA_CHANNELS));
 
-	sema_init(&qdma->channel_sem[0], qdma->channel);
-	sema_init(&qdma->channel_sem[1], qdma->channel);
-
-	/* Initialize bit mask to represent individual channels */
-	qdma->channel_bitmap[0] = BIT(qdma->channel);
-	qdma->channel_bitmap[0]--;
-	qdma->channel_bitmap[1] = qdma->channel_bitmap[0];
+	xocl_chan_arb_init(&qdma->channel_arb[0], qdma->channel);
+	xocl_chan_arb_init(&qdma->channel_arb[1], qdma->channel);
 
 	xocl_info(&pdev->dev, "Creating MM Queues, Channel %d", qdma->channel);
 	if (!reset) {
@@ -829,6 +930,88 @@ static const struct vm_operations_struct stream_vm_ops = {
 	.close = drm_gem_vm_close,
 };
 
+/*
+ * Stream QoS.  Once a queue with priority or weight exists, requests are
+ * admitted before they reach libqdma: a queue waits while a queue of
+ * higher priority in the same direction is waiting, and keeps no more
+ * than its weighted share of STREAM_QOS_BUDGET bytes in flight among the
+ * queues with requests in flight.  A queue with nothing in flight may
+ * always submit one request.  Throughput and latency are accounted for
+ * every queue.
+ */
+static bool stream_qos_allowed(struct stream_qos *qos,
+	struct stream_queue *queue, size_t sz)
+{
+	u32 prio;
+
+	for (prio = queue->qos_prio + 1; prio < STREAM_QOS_PRIO_NUM; prio++) {
+		if (qos->waiting[prio])
+			return false;
+	}
+
+	if (!queue->qos_inflight)
+		return true;
+
+	return queue->qos_inflight + sz <= div_u64((u64)STREAM_QOS_BUDGET *
+		queue->qos_weight, qos->weight_total);
+}
+
+static int stream_qos_admit(struct stream_queue *queue,
+	struct stream_async_req *io_req, size_t sz)
+{
+	struct xocl_qdma *qdma = queue->qdma;
+	struct stream_qos *qos = &qdma->qos[queue->qconf.c2h];
+	int ret;
+
+	spin_lock_irq(&qos->lock);
+	if (READ_ONCE(qdma->qos_queues)) {
+		qos->waiting[queue->qos_prio]++;
+		ret = wait_event_interruptible_lock_irq(qos->wq,
+			stream_qos_allowed(qos, queue, sz), qos->lock);
+		qos->waiting[queue->qos_prio]--;
+		/* lower priority queues may go now */
+		wake_up(&qos->wq);
+		if (ret) {
+			spin_unlock_irq(&qos->lock);
+			return ret;
+		}
+	}
+	if (!queue->qos_inflight)
+		qos->weight_total += queue->qos_weight;
+	queue->qos_inflight += sz;
+	if (!queue->xfer_cnt && !queue->xfer_bytes)
+		queue->xfer_start = ktime_get();
+	spin_unlock_irq(&qos->lock);
+
+	io_req->cb.qos_bytes = sz;
+	io_req->cb.qos_start = ktime_get();
+
+	return 0;
+}
+
+static void stream_qos_release(struct stream_queue *queue,
+	struct stream_async_req *io_req)
+{
+	struct stream_qos *qos = &queue->qdma->qos[queue->qconf.c2h];
+	struct stream_async_arg *cb = &io_req->cb;
+	u64 lat = ktime_to_ns(ktime_sub(ktime_get(), cb->qos_start));
+	unsigned long flags;
+
+	spin_lock_irqsave(&qos->lock, flags);
+	queue->qos_inflight -= cb->qos_bytes;
+	if (!queue->qos_inflight)
+		qos->weight_total -= queue->qos_weight;
+	queue->xfer_bytes += cb->done_bytes;
+	queue->xfer_cnt++;
+	queue->lat_total_ns += lat;
+	if (lat > queue->lat_max_ns)
+		queue->lat_max_ns = lat;
+	wake_up(&qos->wq);
+	spin_unlock_irqrestore(&qos->lock, flags);
+
+	cb->qos_bytes = 0;
+}
+
 static struct stream_async_req *queue_req_new(struct stream_queue *queue)
 {
 	struct stream_async_req *io_req;
@@ -855,6 +1038,9 @@ static void queue_req_free(struct stream_queue *queue,
 			struct stream_async_req *io_req,
 			bool completed)
 {
+	if (io_req->cb.qos_bytes)
+		stream_qos_release(queue, io_req);
+
 	spin_lock_bh(&queue->req_lock);
 
 	if (completed) {
@@ -903,6 +1089,46 @@ static void cmpl_aio_cancel(struct work_struct *work)
 	spin_unlock_bh(&cb->lock);
 }
 
+static int queue_ring_reserve(struct stream_queue *queue)
+{
+	struct xocl_qdma_cmpl_ring *ring = queue->cring;
+	int ret = 0;
+
+	spin_lock_bh(&queue->cring_lock);
+	if (ring->tail - READ_ONCE(ring->head) + queue->cring_pend >= ring->num)
+		ret = -EAGAIN;
+	else
+		queue->cring_pend++;
+	spin_unlock_bh(&queue->cring_lock);
+
+	return ret;
+}
+
+static void queue_ring_unreserve(struct stream_queue *queue)
+{
+	spin_lock_bh(&queue->cring_lock);
+	queue->cring_pend--;
+	spin_unlock_bh(&queue->cring_lock);
+}
+
+static void queue_ring_push(struct stream_queue *queue, u64 tag,
+	unsigned int done_bytes, int error)
+{
+	struct xocl_qdma_cmpl_ring *ring = queue->cring;
+	struct xocl_qdma_cmpl_entry *ent;
+
+	spin_lock_bh(&queue->cring_lock);
+	ent = &ring->ent[ring->tail & (ring->num - 1)];
+	ent->tag = tag;
+	ent->nbytes = done_bytes;
+	ent->err = error;
+	/* entry visible before tail */
+	smp_wmb();
+	WRITE_ONCE(ring->tail, ring->tail + 1);
+	queue->cring_pend--;
+	spin_unlock_bh(&queue->cring_lock);
+}
+
 static int queue_req_complete(unsigned long priv, unsigned int done_bytes,
 	int error)
 {
@@ -910,6 +1136,7 @@ static int queue_req_complete(unsigned long priv, unsigned int done_bytes,
 	struct stream_async_req *io_req = cb->io_req;
 	struct stream_queue *queue = cb->queue;
 
+	cb->done_bytes = done_bytes;
 	pr_debug("%s, q 0x%lx, req 0x%p,err %d, %u,%u, %u,%u, mem %u,%u.\n",
 		__func__, queue->queue, &io_req->req, error,
 		queue->req_submit_cnt, queue->req_cmpl_cnt,
@@ -926,6 +1153,11 @@ static int queue_req_complete(unsigned long priv, unsigned int done_bytes,
 		XOCL_DRM_GEM_OBJECT_PUT_UNLOCKED(&cb->xobj->base);
 	}
 
+	if (cb->ring) {
+		cb->ring = false;
+		queue_ring_push(queue, cb->ring_tag, done_bytes, error);
+	}
+
 	spin_lock_bh(&cb->lock);
 	if (cb->kiocb) {
 		cmpl_aio(cb->kiocb, done_bytes, error);
@@ -938,6 +1170,26 @@ static int queue_req_complete(unsigned long priv, unsigned int done_bytes,
 	return 0;
 }
 
+static int queue_req_pkt(unsigned long priv, unsigned int offset,
+	unsigned int len, bool eot)
+{
+	struct stream_async_arg *cb = (struct stream_async_arg *)priv;
+	struct xocl_qdma_aggr_hdr *hdr = cb->aggr_hdr;
+	struct xocl_qdma_aggr_pkt *pkt;
+
+	if (hdr->num >= XOCL_QDMA_AGGR_PKT_MAX)
+		return -ENOSPC;
+
+	pkt = &hdr->pkt[hdr->num];
+	pkt->offset = XOCL_QDMA_AGGR_HDR_SIZE + offset;
+	pkt->len = len;
+	pkt->flags = eot ? XOCL_QDMA_AGGR_PKT_EOT : 0;
+	pkt->resv = 0;
+	hdr->num++;
+
+	return 0;
+}
+
 static ssize_t stream_post_bo(struct xocl_qdma *qdma,
 	struct stream_queue *queue, struct drm_gem_object *gem_obj,
 	loff_t offset, size_t len, bool write,
@@ -947,6 +1199,7 @@ static ssize_t stream_post_bo(struct xocl_qdma *qdma,
 	struct stream_async_req  *io_req = NULL;
 	struct qdma_request *req;
 	struct stream_async_arg *cb;
+	bool ring = !kiocb && (header->flags & XOCL_QDMA_REQ_FLAG_RING);
 	ssize_t ret;
 
 	if (gem_obj->size < offset + len) {
@@ -975,16 +1228,30 @@ static ssize_t stream_post_bo(struct xocl_qdma *qdma,
 	req->count = len;
 	req->use_sgt = 1;
 	req->sgt = xobj->sgt;
+	req->offset = offset;
+	/* mapped at allocation */
+	req->dma_mapped = 1;
 	if (header->flags & XOCL_QDMA_REQ_FLAG_EOT)
 		req->eot = 1;
 	req->uld_data = (unsigned long)cb;
-	if (kiocb) {
+	if (header->flags & XOCL_QDMA_REQ_FLAG_AGGR) {
+		/* packet table sits in front of the data */
+		cb->aggr_hdr = xobj->vmapping + offset -
+			XOCL_QDMA_AGGR_HDR_SIZE;
+		cb->aggr_hdr->num = 0;
+		req->aggr = 1;
+		req->fp_pkt = queue_req_pkt;
+	}
+	if (kiocb || ring) {
 		cb->is_unmgd = false;
 		cb->kiocb = kiocb;
 		cb->xobj = xobj;
+		cb->ring = ring;
+		cb->ring_tag = header->tag;
 		req->fp_done = queue_req_complete;
 
-		kiocb->private = io_req;
+		if (kiocb)
+			kiocb->private = io_req;
 	}
 	queue_req_pending(queue, io_req);
 
@@ -994,6 +1261,10 @@ static ssize_t stream_post_bo(struct xocl_qdma *qdma,
 		(unsigned long)qdma->dma_handle, queue->queue, req->sgt->sgl,
 	req->sgt->orig_nents, req->sgt->nents, write ? "W":"R", len);
 
+	ret = stream_qos_admit(queue, io_req, len);
+	if (ret)
+		goto failed;
+
 	ret = qdma_request_submit((unsigned long)qdma->dma_handle, queue->queue,
 		req);
 	if (ret < 0) {
@@ -1001,7 +1272,8 @@ static ssize_t stream_post_bo(struct xocl_qdma *qdma,
 		goto failed;
 	}
 
-	if (!kiocb) {
+	if (!kiocb && !ring) {
+		cb->done_bytes = ret;
 		XOCL_DRM_GEM_OBJECT_PUT_UNLOCKED(gem_obj);
 		queue_req_free(queue, io_req, false);
 	} else {
@@ -1034,6 +1306,7 @@ static ssize_t queue_rw(struct xocl_qdma *qdma, struct stream_queue *queue,
 	struct stream_async_req  *io_req = NULL;
 	struct qdma_request *req;
 	struct stream_async_arg *cb;
+	bool	ring = false;
 	long	ret = 0;
 
 	xocl_dbg(&qdma->pdev->dev, "Read / Write Queue 0x%lx",
@@ -1051,18 +1324,71 @@ static ssize_t queue_rw(struct xocl_qdma *qdma, struct stream_queue *queue,
 	queue->refcnt++;
 	spin_unlock(&queue->qlock);
 
-	if (((uint64_t)(buf) & ~PAGE_MASK) && queue->qconf.c2h) {
-		xocl_err(&qdma->pdev->dev,
-			"C2H buffer has to be page aligned, buf %p", buf);
+	memset (&header, 0, sizeof (header));
+	if (u_header &&  copy_from_user((void *)&header.flags, u_header,
+		sizeof (header.flags))) {
+		xocl_err(&qdma->pdev->dev, "copy header failed.");
+		ret = -EFAULT;
+		goto failed;
+	}
+
+	if (header.flags & XOCL_QDMA_REQ_FLAG_RING) {
+		if (kiocb || !queue->cring) {
+			xocl_err(&qdma->pdev->dev,
+				"ring request on queue without ring");
+			ret = -EINVAL;
+			goto failed;
+		}
+		if (copy_from_user((void *)&header.tag, u_header +
+			offsetof(struct xocl_qdma_req_header, tag),
+			sizeof (header.tag))) {
+			xocl_err(&qdma->pdev->dev, "copy header failed.");
+			ret = -EFAULT;
+			goto failed;
+		}
+		ret = queue_ring_reserve(queue);
+		if (ret)
+			goto failed;
+		ring = true;
+	}
+
+	if (header.flags & XOCL_QDMA_REQ_FLAG_FRAME) {
+		u32 frame = header.flags >> XOCL_QDMA_REQ_FRAME_SHIFT;
+		loff_t offset = (loff_t)frame * queue->frame_size;
+
+		if (!queue->frame_bo || frame >= queue->frame_num ||
+			sz > queue->frame_size) {
+			xocl_err(&qdma->pdev->dev,
+				"invalid frame %u, sz 0x%lx", frame, sz);
+			ret = -EINVAL;
+			goto failed;
+		}
+		if (header.flags & XOCL_QDMA_REQ_FLAG_AGGR) {
+			if (!queue->qconf.c2h ||
+				sz <= XOCL_QDMA_AGGR_HDR_SIZE) {
+				xocl_err(&qdma->pdev->dev,
+					"invalid aggregation, sz 0x%lx", sz);
+				ret = -EINVAL;
+				goto failed;
+			}
+			offset += XOCL_QDMA_AGGR_HDR_SIZE;
+			sz -= XOCL_QDMA_AGGR_HDR_SIZE;
+		}
+		ret = stream_post_bo(qdma, queue, queue->frame_bo, offset, sz,
+			write, &header, kiocb);
+		goto failed;
+	}
+
+	if (header.flags & XOCL_QDMA_REQ_FLAG_AGGR) {
+		xocl_err(&qdma->pdev->dev, "aggregation needs a frame");
 		ret = -EINVAL;
 		goto failed;
 	}
 
-	memset (&header, 0, sizeof (header));
-	if (u_header &&  copy_from_user((void *)&header, u_header,
-		sizeof (struct xocl_qdma_req_header))) {
-		xocl_err(&qdma->pdev->dev, "copy header failed.");
-		ret = -EFAULT;
+	if (((uint64_t)(buf) & ~PAGE_MASK) && queue->qconf.c2h) {
+		xocl_err(&qdma->pdev->dev,
+			"C2H buffer has to be page aligned, buf %p", buf);
+		ret = -EINVAL;
 		goto failed;
 	}
 
@@ -1127,16 +1453,19 @@ static ssize_t queue_rw(struct xocl_qdma *qdma, struct stream_queue *queue,
 	req->sgt = unmgd.sgt;
 	if (header.flags & XOCL_QDMA_REQ_FLAG_EOT)
 		req->eot = 1;
-	if (kiocb) {
+	if (kiocb || ring) {
 		memcpy(&cb->unmgd, &unmgd, sizeof (unmgd));
 		cb->is_unmgd = true;
 		cb->queue = queue;
 		cb->kiocb = kiocb;
+		cb->ring = ring;
+		cb->ring_tag = header.tag;
 		cb->nsg = nents;
 		req->uld_data = (unsigned long)cb;
 		req->fp_done = queue_req_complete;
 
-		kiocb->private = io_req;
+		if (kiocb)
+			kiocb->private = io_req;
 	}
 	queue_req_pending(queue, io_req);
 
@@ -1146,6 +1475,13 @@ static ssize_t queue_rw(struct xocl_qdma *qdma, struct stream_queue *queue,
 		(unsigned long)qdma->dma_handle, queue->queue, req->sgt->sgl,
 		req->sgt->orig_nents, req->sgt->nents, write ? "W":"R", sz);
 
+	ret = stream_qos_admit(queue, io_req, sz);
+	if (ret) {
+		pci_unmap_sg(XDEV(xdev)->pdev, unmgd.sgt->sgl, nents, dir);
+		xocl_finish_unmgd(&unmgd);
+		goto failed;
+	}
+
 	ret = qdma_request_submit((unsigned long)qdma->dma_handle, queue->queue,
 		req);
 	if (ret < 0) {
@@ -1154,7 +1490,8 @@ static ssize_t queue_rw(struct xocl_qdma *qdma, struct stream_queue *queue,
 		goto failed;
 	}
 
-	if (!kiocb) {
+	if (!kiocb && !ring) {
+		cb->done_bytes = ret;
 		pci_unmap_sg(XDEV(xdev)->pdev, unmgd.sgt->sgl, nents, dir);
 		xocl_finish_unmgd(&unmgd);
 		queue_req_free(queue, io_req, false);
@@ -1169,9 +1506,13 @@ failed:
 	if (ret < 0) {
 		if (io_req)
 			queue_req_free(queue, io_req, false);
+		if (ring)
+			queue_ring_unreserve(queue);
 		return ret;
 	} else if (kiocb)
 		ret = -EIOCBQUEUED;
+	else if (ring)
+		ret = sz;
 
 	spin_lock(&queue->qlock);
 	queue->refcnt--;
@@ -1338,6 +1679,8 @@ static int queue_flush(struct file *file, fl_owner_t id)
 		qdma->queues[queue->qconf.qidx] = NULL;
 	else
 		qdma->queues[QDMA_QSETS_MAX + queue->qconf.qidx] = NULL;
+	if (queue->qos_prio || queue->qos_weight > 1)
+		WRITE_ONCE(qdma->qos_queues, qdma->qos_queues - 1);
 	mutex_unlock(&qdma->str_dev_lock);
 
 	ret = qdma_queue_stop((unsigned long)qdma->dma_handle, queue->queue,
@@ -1386,6 +1729,12 @@ static int queue_close(struct inode *inode, struct file *file)
 	if (queue->req_cache)
 		vfree(queue->req_cache);
 
+	if (queue->cring)
+		vfree(queue->cring);
+
+	if (queue->frame_bo)
+		XOCL_DRM_GEM_OBJECT_PUT_UNLOCKED(queue->frame_bo);
+
 	qdma = queue->qdma;
 	devm_kfree(&qdma->pdev->dev, queue);
 	file->private_data = NULL;
@@ -1393,8 +1742,116 @@ static int queue_close(struct inode *inode, struct file *file)
 	return 0;
 }
 
+static long queue_ioctl_reg_buf(struct stream_queue *queue,
+	void __user *arg)
+{
+	struct xocl_qdma *qdma = queue->qdma;
+	struct xocl_qdma_ioc_reg_buf req;
+	struct vm_area_struct *vma;
+	struct drm_gem_object *gem_obj;
+
+	if (copy_from_user((void *)&req, arg, sizeof (req))) {
+		xocl_err(&qdma->pdev->dev, "copy failed.");
+		return -EFAULT;
+	}
+
+	vma = find_vma(current->mm, req.addr);
+	if (!vma || vma->vm_ops != &stream_vm_ops ||
+		vma->vm_start != req.addr) {
+		xocl_err(&qdma->pdev->dev, "invalid stream buffer address");
+		return -EINVAL;
+	}
+	gem_obj = vma->vm_private_data;
+
+	if (!req.frame_size || req.frame_size > gem_obj->size) {
+		xocl_err(&qdma->pdev->dev, "invalid frame size %u",
+			req.frame_size);
+		return -EINVAL;
+	}
+
+	spin_lock(&queue->qlock);
+	if (queue->frame_bo) {
+		spin_unlock(&queue->qlock);
+		xocl_err(&qdma->pdev->dev, "frame buffer already registered");
+		return -EBUSY;
+	}
+	XOCL_DRM_GEM_OBJECT_GET(gem_obj);
+	queue->frame_size = req.frame_size;
+	queue->frame_num = gem_obj->size / req.frame_size;
+	queue->frame_bo = gem_obj;
+	spin_unlock(&queue->qlock);
+
+	req.frame_num = queue->frame_num;
+	if (copy_to_user(arg, &req, sizeof (req))) {
+		xocl_err(&qdma->pdev->dev, "Copy to user failed");
+		return -EFAULT;
+	}
+
+	xocl_info(&qdma->pdev->dev, "Queue 0x%lx, %u frames of %u bytes",
+		queue->queue, queue->frame_num, queue->frame_size);
+	return 0;
+}
+
+static long queue_ioctl_service(struct stream_queue *queue)
+{
+	struct xocl_qdma *qdma = queue->qdma;
+
+	if (!queue->cring)
+		return -EINVAL;
+
+	qdma_queue_service((unsigned long)qdma->dma_handle, queue->queue, 0,
+		true);
+	return 0;
+}
+
+static long queue_ioctl(struct file *file, unsigned int cmd,
+	unsigned long arg)
+{
+	struct stream_queue *queue;
+	long result;
+
+	queue = (struct stream_queue *)file->private_data;
+	if (!queue)
+		return -EINVAL;
+
+	switch (cmd) {
+	case XOCL_QDMA_IOC_QUEUE_REG_BUF:
+		result = queue_ioctl_reg_buf(queue, (void __user *)arg);
+		break;
+	case XOCL_QDMA_IOC_QUEUE_SERVICE:
+		result = queue_ioctl_service(queue);
+		break;
+	default:
+		xocl_err(&queue->qdma->pdev->dev, "Invalid request %u",
+			cmd & 0xff);
+		result = -EINVAL;
+		break;
+	}
+
+	return result;
+}
+
+static int queue_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct stream_queue *queue;
+
+	queue = (struct stream_queue *)file->private_data;
+	if (!queue || !queue->cring)
+		return -EINVAL;
+
+	if (vma->vm_pgoff ||
+		vma->vm_end - vma->vm_start > queue->cring_size) {
+		xocl_err(&queue->qdma->pdev->dev, "invalid ring mapping");
+		return -EINVAL;
+	}
+
+	return remap_vmalloc_range(vma, queue->cring, 0);
+}
+
 static struct file_operations queue_fops = {
 		.owner = THIS_MODULE,
+		.unlocked_ioctl = queue_ioctl,
+		.mmap = queue_mmap,
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(3,16,0)
 		.write_iter = queue_write_iter,
 		.read_iter = queue_read_iter,
@@ -1421,6 +1878,12 @@ static long stream_ioctl_create_queue(struct xocl_qdma *qdma,
 		return -EFAULT;
 	}
 
+	if (req.priority >= STREAM_QOS_PRIO_NUM || req.weight > 255) {
+		xocl_err(&qdma->pdev->dev, "invalid priority %u, weight %u",
+			req.priority, req.weight);
+		return -EINVAL;
+	}
+
 	queue = devm_kzalloc(&qdma->pdev->dev, sizeof (*queue), GFP_KERNEL);
 	if (!queue) {
 		xocl_err(&qdma->pdev->dev, "out of memeory");
@@ -1431,6 +1894,7 @@ static long stream_ioctl_create_queue(struct xocl_qdma *qdma,
 	INIT_LIST_HEAD(&queue->req_free_list);
 	spin_lock_init(&queue->req_lock);
 	spin_lock_init(&queue->qlock);
+	spin_lock_init(&queue->cring_lock);
 	init_waitqueue_head(&queue->wq);
 
 	qconf = &queue->qconf;
@@ -1465,6 +1929,10 @@ static long stream_ioctl_create_queue(struct xocl_qdma *qdma,
 	}
 	queue->flowid = req.flowid;
 	queue->routeid = req.rid;
+	queue->route_shared = req.write &&
+		(req.flags & XOCL_QDMA_QUEUE_FLAG_SHARED);
+	queue->qos_prio = req.priority;
+	queue->qos_weight = req.weight ? req.weight : 1;
 	xocl_info(&qdma->pdev->dev, "Creating %s queue with tdest %d, flow %d, "
 		"slr %d", qconf->c2h ? "C2H" : "H2C",
 		qconf->pipe_tdest, qconf->pipe_flow_id,
@@ -1517,6 +1985,21 @@ static long stream_ioctl_create_queue(struct xocl_qdma *qdma,
 		queue->req_free_cnt = i;
 	}
 
+	if (req.flags & XOCL_QDMA_QUEUE_FLAG_CMPL_RING) {
+		/* one entry per io request */
+		u32 num = roundup_pow_of_two(qconf->rngsz << 1);
+
+		queue->cring_size = PAGE_ALIGN(sizeof(*queue->cring) +
+			num * sizeof(struct xocl_qdma_cmpl_entry));
+		queue->cring = vmalloc_user(queue->cring_size);
+		if (!queue->cring) {
+			xocl_err(&qdma->pdev->dev, "completion ring OOM");
+			ret = -ENOMEM;
+			goto failed;
+		}
+		queue->cring->num = num;
+	}
+
 	xocl_info(&qdma->pdev->dev,
 		"Created %s Queue handle 0x%lx, idx %d, sz %d, %u",
 		qconf->c2h ? "C2H" : "H2C",
@@ -1559,6 +2042,8 @@ static long stream_ioctl_create_queue(struct xocl_qdma *qdma,
 		qdma->queues[queue->qconf.qidx] = queue;
 	else
 		qdma->queues[QDMA_QSETS_MAX + queue->qconf.qidx] = queue;
+	if (queue->qos_prio || queue->qos_weight > 1)
+		WRITE_ONCE(qdma->qos_queues, qdma->qos_queues + 1);
 	mutex_unlock(&qdma->str_dev_lock);
 
 	fd_install(queue->qfd, queue->file);
@@ -1578,6 +2063,8 @@ failed:
 	if (queue) {
 		if (queue->req_cache)
 			vfree(queue->req_cache);
+		if (queue->cring)
+			vfree(queue->cring);
 		devm_kfree(&qdma->pdev->dev, queue);
 	}
 
@@ -1644,6 +2131,8 @@ static long stream_ioctl_alloc_buffer(struct xocl_qdma *qdma,
 		ret = -EIO;
 		goto failed;
 	}
+	/* requests on this buffer use the mapping as is */
+	xobj->sgt->nents = xobj->dma_nsg;
 
 	ret = drm_gem_create_mmap_offset(&xobj->base);
 	if (ret < 0)
@@ -1759,7 +2248,7 @@ static int qdma_probe(struct platform_device *pdev)
 	struct qdma_dev_conf *conf;
 	xdev_handle_t	xdev;
 	struct resource *res = NULL;
-	int	ret = 0, dma_bar;
+	int	ret = 0, dma_bar, i;
 
 	xdev = xocl_get_xdev(pdev);
 
@@ -1830,6 +2319,10 @@ static int qdma_probe(struct platform_device *pdev)
 
 	mutex_init(&qdma->str_dev_lock);
 	spin_lock_init(&qdma->user_msix_table_lock);
+	for (i = 0; i < ARRAY_SIZE(qdma->qos); i++) {
+		spin_lock_init(&qdma->qos[i].lock);
+		init_waitqueue_head(&qdma->qos[i].wq);
+	}
 
 	platform_set_drvdata(pdev, qdma);
 
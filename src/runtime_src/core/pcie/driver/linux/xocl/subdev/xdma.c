@@ -27,6 +27,7 @@
 #include <drm/drm_mm.h>
 #include "../xocl_drv.h"
 #include "../xocl_drm.h"
+#include "../xocl_trace.h"
 #include "../lib/libxdma_api.h"
 
 #define XOCL_FILE_PAGE_OFFSET   0x100000
@@ -52,20 +53,16 @@ struct xocl_xdma {
 	struct xocl_drm		*drm;
 	/* Number of bidirectional channels */
 	u32			channel;
-	/* Semaphore, one for each direction */
-	struct semaphore	channel_sem[2];
-	/*
-	 * Channel usage bitmasks, one for each direction
-	 * bit 1 indicates channel is free, bit 0 indicates channel is free
-	 */
-	volatile unsigned long	channel_bitmap[2];
+	/* Channel arbiter, one for each direction */
+	struct xocl_chan_arb	channel_arb[2];
 	unsigned long long	*channel_usage[2];
 
 	struct mutex		stat_lock;
 };
 
 static ssize_t xdma_migrate_bo(struct platform_device *pdev,
-	struct sg_table *sgt, u32 dir, u64 paddr, u32 channel, u64 len)
+	struct sg_table *sgt, u32 dir, u64 paddr, u32 channel, u64 len,
+	u32 flags)
 {
 	struct xocl_xdma *xdma;
 	struct page *pg;
@@ -79,10 +76,16 @@ static ssize_t xdma_migrate_bo(struct platform_device *pdev,
 	xdma = platform_get_drvdata(pdev);
 	xocl_dbg(&pdev->dev, "TID %d, Channel:%d, Offset: 0x%llx, Dir: %d",
 		pid, channel, paddr, dir);
-	ret = xdma_xfer_submit(xdma->dma_handle, channel, dir,
-		paddr, sgt, false, 10000);
+	trace_xocl_dma_start(XDEV(xocl_get_xdev(pdev))->dev_minor, dir,
+		channel, paddr, len);
+	ret = xdma_xfer_submit_flags(xdma->dma_handle, channel, dir,
+		paddr, sgt, false, 10000,
+		(flags & XOCL_DMA_FLAG_POLL) ? XDMA_XFER_FLAG_POLL : 0);
+	trace_xocl_dma_done(XDEV(xocl_get_xdev(pdev))->dev_minor, dir,
+		channel, ret);
 	if (ret >= 0) {
 		xdma->channel_usage[dir][channel] += ret;
+		xocl_usage_dma_add(xocl_get_xdev(pdev), dir, channel, ret);
 		return ret;
 	}
 
@@ -99,42 +102,53 @@ static ssize_t xdma_migrate_bo(struct platform_device *pdev,
 	return ret;
 }
 
-static int acquire_channel(struct platform_device *pdev, u32 dir)
+static void *xdma_chain_create_bo(struct platform_device *pdev,
+	struct sg_table *sgt, u64 paddr)
 {
-	struct xocl_xdma *xdma;
-	int channel = 0;
-	int result = 0;
+	struct xocl_xdma *xdma = platform_get_drvdata(pdev);
 
-	xdma = platform_get_drvdata(pdev);
-	if (down_killable(&xdma->channel_sem[dir])) {
-		channel = -ERESTARTSYS;
-		goto out;
-	}
+	return xdma_chain_create(xdma->dma_handle, paddr, sgt);
+}
 
-	for (channel = 0; channel < xdma->channel; channel++) {
-		result = test_and_clear_bit(channel,
-			&xdma->channel_bitmap[dir]);
-		if (result)
-			break;
-        }
-        if (!result) {
-		// How is this possible?
-		up(&xdma->channel_sem[dir]);
-		channel = -EIO;
-	}
+static void xdma_chain_free_bo(struct platform_device *pdev, void *chain)
+{
+	struct xocl_xdma *xdma = platform_get_drvdata(pdev);
 
-out:
-	return channel;
+	xdma_chain_free(xdma->dma_handle, chain);
 }
 
-static void release_channel(struct platform_device *pdev, u32 dir, u32 channel)
+static ssize_t xdma_chain_submit_bo(struct platform_device *pdev,
+	void *chain, u32 dir, u32 channel, u32 flags)
+{
+	struct xocl_xdma *xdma = platform_get_drvdata(pdev);
+	ssize_t ret;
+
+	ret = xdma_chain_submit(xdma->dma_handle, chain, channel, dir, 10000,
+		(flags & XOCL_DMA_FLAG_POLL) ? XDMA_XFER_FLAG_POLL : 0);
+	if (ret >= 0) {
+		xdma->channel_usage[dir][channel] += ret;
+		xocl_usage_dma_add(xocl_get_xdev(pdev), dir, channel, ret);
+	} else
+		xocl_err(&pdev->dev, "DMA chain failed, %ld", ret);
+
+	return ret;
+}
+
+static int acquire_channel(struct platform_device *pdev, u32 dir, u32 flags)
 {
 	struct xocl_xdma *xdma;
 
+	xdma = platform_get_drvdata(pdev);
+	return xocl_chan_arb_acquire(&xdma->channel_arb[dir],
+		flags & XOCL_DMA_FLAG_PRIO);
+}
+
+static void release_channel(struct platform_device *pdev, u32 dir, u32 channel)
+{
+	struct xocl_xdma *xdma;
 
 	xdma = platform_get_drvdata(pdev);
-        set_bit(channel, &xdma->channel_bitmap[dir]);
-        up(&xdma->channel_sem[dir]);
+	xocl_chan_arb_release(&xdma->channel_arb[dir], channel);
 }
 
 static u32 get_channel_count(struct platform_device *pdev)
@@ -297,6 +311,9 @@ failed:
 
 static struct xocl_dma_funcs xdma_ops = {
 	.migrate_bo = xdma_migrate_bo,
+	.chain_create = xdma_chain_create_bo,
+	.chain_free = xdma_chain_free_bo,
+	.chain_submit = xdma_chain_submit_bo,
 	.ac_chan = acquire_channel,
 	.rel_chan = release_channel,
 	.get_chan_count = get_channel_count,
@@ -344,13 +361,11 @@ static int set_max_chan(struct platform_device *pdev,
 		return -ENOMEM;
 	}
 
-	sema_init(&xdma->channel_sem[0], xdma->channel);
-	sema_init(&xdma->channel_sem[1], xdma->channel);
+	xocl_usage_set(xocl_get_xdev(pdev), dma_channel_count,
+		min_t(u32, xdma->channel, XOCL_USAGE_MAX_DMA_CHANNELS));
 
-	/* Initialize bit mask to represent individual channels */
-	xdma->channel_bitmap[0] = BIT(xdma->channel);
-	xdma->channel_bitmap[0]--;
-	xdma->channel_bitmap[1] = xdma->channel_bitmap[0];
+	xocl_chan_arb_init(&xdma->channel_arb[0], xdma->channel);
+	xocl_chan_arb_init(&xdma->channel_arb[1], xdma->channel);
 
 	return 0;
 }
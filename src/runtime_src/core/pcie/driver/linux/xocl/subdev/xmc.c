@@ -265,6 +265,10 @@ struct xocl_xmc {
 	u64			cache_expire_secs;
 	struct xcl_sensor	cache;
 	ktime_t			cache_expires;
+	/* All sensors read in one go on mgmt pf, see xmc_get_data() */
+	struct mutex		snapshot_lock;
+	struct xcl_sensor	snapshot;
+	ktime_t			snapshot_expires;
 	/* Runtime clock scaling enabled status */
 	bool			runtime_cs_enabled;
 
@@ -581,9 +585,9 @@ static bool autonomous_xmc(struct platform_device *pdev)
 	return core->priv.flags & XOCL_DSAFLAG_SMARTN;
 }
 
-static int xmc_get_data(struct platform_device *pdev, void *buf)
+static void xmc_read_sensors(struct platform_device *pdev,
+	struct xcl_sensor *sensors)
 {
-	struct xcl_sensor *sensors = (struct xcl_sensor *)buf;
 
 	xmc_sensor(pdev, VOL_12V_PEX, &sensors->vol_12v_pex, SENSOR_INS);
 	xmc_sensor(pdev, VOL_12V_AUX, &sensors->vol_12v_aux, SENSOR_INS);
@@ -618,6 +622,36 @@ static int xmc_get_data(struct platform_device *pdev, void *buf)
 	xmc_sensor(pdev, CAGE_TEMP2, &sensors->cage_temp2, SENSOR_INS);
 	xmc_sensor(pdev, CAGE_TEMP3, &sensors->cage_temp3, SENSOR_INS);
 	xmc_sensor(pdev, HBM_TEMP, &sensors->hbm_temp0, SENSOR_INS);
+}
+
+/*
+ * Fetch all sensors at once. On mgmt pf the readings are kept for
+ * cache_expire_secs, so pollers reading every sensor of many cards, and
+ * the peer asking for them, cost one round of XMC register reads per
+ * expiry instead of one per sensor per reader. On user pf the readings
+ * come from the peer cache.
+ */
+static int xmc_get_data(struct platform_device *pdev, void *buf)
+{
+	struct xocl_xmc *xmc = platform_get_drvdata(pdev);
+	struct xcl_sensor *sensors = (struct xcl_sensor *)buf;
+
+	if (!XMC_PRIVILEGED(xmc)) {
+		safe_read_from_peer(xmc, pdev);
+		mutex_lock(&xmc->xmc_lock);
+		memcpy(sensors, &xmc->cache, sizeof(*sensors));
+		mutex_unlock(&xmc->xmc_lock);
+		return 0;
+	}
+
+	mutex_lock(&xmc->snapshot_lock);
+	if (ktime_compare(ktime_get_boottime(), xmc->snapshot_expires) > 0) {
+		xmc_read_sensors(pdev, &xmc->snapshot);
+		xmc->snapshot_expires = ktime_add(ktime_get_boottime(),
+			ktime_set(xmc->cache_expire_secs, 0));
+	}
+	memcpy(sensors, &xmc->snapshot, sizeof(*sensors));
+	mutex_unlock(&xmc->snapshot_lock);
 
 	return 0;
 }
@@ -790,9 +824,7 @@ static ssize_t cache_expire_secs_show(struct device *dev,
 	u64 val = 0;
 
 	mutex_lock(&xmc->xmc_lock);
-	if (!XMC_PRIVILEGED(xmc))
-		val = xmc->cache_expire_secs;
-
+	val = xmc->cache_expire_secs;
 	mutex_unlock(&xmc->xmc_lock);
 	return sprintf(buf, "%llu\n", val);
 }
@@ -802,16 +834,15 @@ static ssize_t cache_expire_secs_store(struct device *dev,
 	struct xocl_xmc *xmc = platform_get_drvdata(to_platform_device(dev));
 	u64 val;
 
-	mutex_lock(&xmc->xmc_lock);
 	if (kstrtou64(buf, 10, &val) == -EINVAL || val > 10) {
 		xocl_err(&to_platform_device(dev)->dev,
 			"usage: echo [0 ~ 10] > cache_expire_secs");
 		return -EINVAL;
 	}
 
-	if (!XMC_PRIVILEGED(xmc))
-		xmc->cache_expire_secs = val;
-
+	/* Also bounds sensor_snapshot refreshes on mgmt pf. */
+	mutex_lock(&xmc->xmc_lock);
+	xmc->cache_expire_secs = val;
 	mutex_unlock(&xmc->xmc_lock);
 	return count;
 }
@@ -1152,8 +1183,41 @@ static struct bin_attribute bin_dimm_temp_by_mem_topology_attr = {
 	.size = 0
 };
 
+/* All sensor readings as struct xcl_sensor, see mailbox_proto.h */
+static ssize_t read_sensor_snapshot(struct file *filp,
+	struct kobject *kobj, struct bin_attribute *attr, char *buffer,
+	loff_t offset, size_t count)
+{
+	struct xocl_xmc *xmc =
+		dev_get_drvdata(container_of(kobj, struct device, kobj));
+	struct xcl_sensor sensors = { 0 };
+	size_t size = sizeof(sensors);
+
+	if (offset >= size)
+		return 0;
+
+	xmc_get_data(xmc->pdev, &sensors);
+
+	if (count > size - offset)
+		count = size - offset;
+	memcpy(buffer, (char *)&sensors + offset, count);
+
+	return count;
+}
+
+static struct bin_attribute bin_sensor_snapshot_attr = {
+	.attr = {
+		.name = "sensor_snapshot",
+		.mode = 0444
+	},
+	.read = read_sensor_snapshot,
+	.write = NULL,
+	.size = sizeof(struct xcl_sensor)
+};
+
 static struct bin_attribute *xmc_bin_attrs[] = {
 	&bin_dimm_temp_by_mem_topology_attr,
+	&bin_sensor_snapshot_attr,
 	NULL,
 };
 
@@ -1776,6 +1840,7 @@ static int xmc_remove(struct platform_device *pdev)
 	}
 
 	mutex_destroy(&xmc->xmc_lock);
+	mutex_destroy(&xmc->snapshot_lock);
 	mutex_destroy(&xmc->mbx_lock);
 
 	platform_set_drvdata(pdev, NULL);
@@ -1841,6 +1906,7 @@ static int xmc_probe(struct platform_device *pdev)
 	}
 
 	mutex_init(&xmc->xmc_lock);
+	mutex_init(&xmc->snapshot_lock);
 	xmc->cache_expire_secs = XMC_DEFAULT_EXPIRE_SECS;
 
 	/*
@@ -24,6 +24,7 @@
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(3, 7, 0)
 #include <linux/hashtable.h>
 #endif
+#include <linux/kfifo.h>
 
 #define XOCL_DRIVER_DESC        "Xilinx PCIe Accelerator Device Manager"
 #define XOCL_DRIVER_DATE        "20180612"
@@ -125,6 +126,10 @@ struct xocl_dev	{
 	atomic_t                        outstanding_execs;
 	atomic64_t                      total_execs;
 	void				*p2p_res_grp;
+	/* Copy BO with imported peer BO, indexed by DMA direction */
+	atomic64_t			p2p_copy_bytes[2];
+	atomic64_t			p2p_copy_usecs[2];
+	atomic64_t			p2p_copy_cnt[2];
 
 	struct xocl_subdev		*dyn_subdev_store;
 	int dyn_subdev_num;
@@ -141,7 +146,14 @@ struct xocl_dev	{
  * @lock: Mutex lock for exclusive access
  * @cu_bitmap: CUs reserved by this context, may contain implicit resources
  * @virt_cu_ref: ref count for implicit resources reserved by this context.
+ * @done_fifo: Handles of exec buffers that have reached a final state
+ * @done_lock: Producer side lock for @done_fifo
+ * @done_read_lock: Consumer side lock for @done_fifo
+ * @done_overflow: Set when a handle could not be recorded in @done_fifo
+ * @sched_cmds: Commands of this context currently in the scheduler queue
+ * @sched_total: Commands of this context admitted to the scheduler queue
  */
+#define XOCL_CLIENT_DONE_FIFO_SIZE 4096
 struct client_ctx {
 	struct list_head	link;
 	unsigned int            abort;
@@ -152,12 +164,22 @@ struct client_ctx {
 	DECLARE_BITMAP		(cu_bitmap, MAX_CUS);
 	struct pid             *pid;
 	unsigned int		virt_cu_ref;
+	DECLARE_KFIFO(done_fifo, u32, XOCL_CLIENT_DONE_FIFO_SIZE);
+	spinlock_t		done_lock;
+	struct mutex		done_read_lock;
+	atomic_t		done_overflow;
+	struct xocl_completion_ring *ring; /* mmapped by user, protected by done_lock */
+	u32			ring_head;
+	struct xocl_userptr_cache *uptr_cache; /* userptr registrations */
+	atomic_t		sched_cmds;
+	atomic64_t		sched_total;
 };
 #define	CLIENT_NUM_CU_CTX(client) ((client)->num_cus + (client)->virt_cu_ref)
 
 struct xocl_mm_wrapper {
   struct drm_mm *mm;
   struct drm_xocl_mm_stat *mm_usage_stat;
+  struct mutex lock; /* allocations in this region */
   uint64_t start_addr;
   uint64_t size;
   uint32_t ddr;
@@ -179,11 +201,21 @@ int xocl_hot_reset_ioctl(struct drm_device *dev, void *data,
 	struct drm_file *filp);
 int xocl_reclock_ioctl(struct drm_device *dev, void *data,
 	struct drm_file *filp);
+int xocl_execbuf_done_ioctl(struct drm_device *dev, void *data,
+	struct drm_file *filp);
+int xocl_execbuf_batch_ioctl(struct drm_device *dev, void *data,
+	struct drm_file *filp);
+int xocl_reset_cu_ioctl(struct drm_device *dev, void *data,
+	struct drm_file *filp);
 
 /* sysfs functions */
 int xocl_init_sysfs(struct device *dev);
 void xocl_fini_sysfs(struct device *dev);
 
+/* RDMA peer memory client, no-op unless built with MLNX_OFED */
+int __init xocl_init_peer_mem(void);
+void xocl_fini_peer_mem(void);
+
 /* helper functions */
 int xocl_hot_reset(struct xocl_dev *xdev, bool force);
 void xocl_p2p_mem_release(struct xocl_dev *xdev, bool recov_bar_sz);
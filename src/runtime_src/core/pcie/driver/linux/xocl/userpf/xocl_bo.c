@@ -23,11 +23,20 @@
 #include <linux/dma-buf.h>
 #include <linux/pagemap.h>
 #include <linux/version.h>
+#include <linux/eventfd.h>
+#include <linux/workqueue.h>
+#include <linux/idr.h>
+#include <linux/sizes.h>
+#include <linux/mmu_notifier.h>
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 11, 0)
+#include <linux/sched/mm.h>
+#endif
 #if LINUX_VERSION_CODE <= KERNEL_VERSION(3, 0, 0)
 #include <drm/drm_backport.h>
 #endif
 #include <drm/drmP.h>
 #include "common.h"
+#include "../xocl_trace.h"
 
 #ifdef _XOCL_BO_DEBUG
 #define	BO_ENTER(fmt, args...)		\
@@ -95,19 +104,579 @@ static void xocl_free_mm_node(struct drm_xocl_bo *xobj)
 	struct xocl_drm *drm_p = ddev->dev_private;
 	unsigned ddr = xobj->mem_idx;
 
-	mutex_lock(&drm_p->mm_lock);
 	BO_ENTER("xobj %p, mm_node %p", xobj, xobj->mm_node);
 	if (!xobj->mm_node)
-		goto end;
+		return;
 
+	down_read(&drm_p->mm_lock);
+	mutex_lock(drm_p->mm_bank_lock[ddr]);
 	xocl_mm_update_usage_stat(drm_p, ddr, xobj->base.size, -1);
 	BO_DEBUG("remove mm_node:%p, start:%llx size: %llx", xobj->mm_node,
 		xobj->mm_node->start, xobj->mm_node->size);
 	drm_mm_remove_node(xobj->mm_node);
+	mutex_unlock(drm_p->mm_bank_lock[ddr]);
+	up_read(&drm_p->mm_lock);
 	kfree(xobj->mm_node);
 	xobj->mm_node = NULL;
-end:
-	mutex_unlock(&drm_p->mm_lock);
+}
+
+/*
+ * Page chunk index of a BO, built on first partial sync.  The BO pages
+ * are described as runs of physically contiguous pages, chunk i covers
+ * pages chunk_page[i] up to chunk_page[i + 1].  The sg table has one
+ * entry per chunk, which is enough for any sub-range of the BO, and is
+ * reused by partial syncs that hold the cache lock.
+ */
+#define XOCL_BO_CHUNK_MAX_PAGES	(SZ_1G >> PAGE_SHIFT)
+
+struct xocl_bo_sg_cache {
+	struct mutex		lock;
+	u32			nchunks;
+	u32			*chunk_page;
+	struct sg_table		sgt;
+	struct scatterlist	*end;
+};
+
+static void xocl_bo_sg_cache_free(struct drm_xocl_bo *xobj)
+{
+	struct xocl_bo_sg_cache *cache = xobj->sg_cache;
+
+	if (!cache)
+		return;
+
+	if (cache->end)
+		sg_unmark_end(cache->end);
+	cache->sgt.orig_nents = cache->sgt.nents = cache->nchunks;
+	sg_free_table(&cache->sgt);
+	drm_free_large(cache->chunk_page);
+	mutex_destroy(&cache->lock);
+	kfree(cache);
+	xobj->sg_cache = NULL;
+}
+
+static struct xocl_bo_sg_cache *xocl_bo_sg_cache_get(struct drm_xocl_bo *xobj)
+{
+	struct xocl_bo_sg_cache *cache = READ_ONCE(xobj->sg_cache);
+	u32 npages = xobj->base.size >> PAGE_SHIFT;
+	u32 i, n, first;
+
+	if (cache || !xobj->pages || !npages)
+		return cache;
+
+	cache = kzalloc(sizeof(*cache), GFP_KERNEL);
+	if (!cache)
+		return NULL;
+	mutex_init(&cache->lock);
+
+	for (i = 1, n = 1, first = 0; i < npages; i++) {
+		if (page_to_pfn(xobj->pages[i]) !=
+		    page_to_pfn(xobj->pages[i - 1]) + 1 ||
+		    i - first >= XOCL_BO_CHUNK_MAX_PAGES) {
+			first = i;
+			n++;
+		}
+	}
+
+	cache->chunk_page = drm_malloc_ab(n + 1, sizeof(u32));
+	if (!cache->chunk_page)
+		goto failed;
+	cache->chunk_page[0] = 0;
+	for (i = 1, n = 1, first = 0; i < npages; i++) {
+		if (page_to_pfn(xobj->pages[i]) !=
+		    page_to_pfn(xobj->pages[i - 1]) + 1 ||
+		    i - first >= XOCL_BO_CHUNK_MAX_PAGES) {
+			first = i;
+			cache->chunk_page[n++] = i;
+		}
+	}
+	cache->chunk_page[n] = npages;
+	cache->nchunks = n;
+
+	if (sg_alloc_table(&cache->sgt, n, GFP_KERNEL))
+		goto failed;
+
+	/* another thread may have raced us */
+	if (cmpxchg(&xobj->sg_cache, NULL, cache) == NULL)
+		return cache;
+
+	sg_free_table(&cache->sgt);
+	drm_free_large(cache->chunk_page);
+	kfree(cache);
+	return READ_ONCE(xobj->sg_cache);
+
+failed:
+	drm_free_large(cache->chunk_page);
+	kfree(cache);
+	return NULL;
+}
+
+/*
+ * Fill the cached sg table of a BO for the range [offset, offset + size).
+ * Returns NULL if the cache is unavailable or in use, in which case the
+ * caller allocates a one time sg table.  A successful call must be paired
+ * with xocl_bo_range_sgt_put().
+ */
+static struct sg_table *xocl_bo_range_sgt_get(struct drm_xocl_bo *xobj,
+	u64 offset, u64 size)
+{
+	struct xocl_bo_sg_cache *cache = xocl_bo_sg_cache_get(xobj);
+	struct scatterlist *sg;
+	u32 first = offset >> PAGE_SHIFT;
+	u32 lo, hi, i, n;
+	u64 pos, end, len;
+
+	if (!cache || !mutex_trylock(&cache->lock))
+		return NULL;
+
+	/* last chunk starting at or before first page */
+	lo = 0;
+	hi = cache->nchunks;
+	while (hi - lo > 1) {
+		u32 mid = lo + (hi - lo) / 2;
+
+		if (cache->chunk_page[mid] <= first)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	if (cache->end)
+		sg_unmark_end(cache->end);
+
+	sg = cache->sgt.sgl;
+	pos = offset;
+	end = offset + size;
+	for (i = lo, n = 0; ; i++) {
+		len = min_t(u64, end, (u64)cache->chunk_page[i + 1] << PAGE_SHIFT) - pos;
+		sg_set_page(sg, xobj->pages[pos >> PAGE_SHIFT], len,
+			offset_in_page(pos));
+		pos += len;
+		n++;
+		if (pos >= end)
+			break;
+		sg = sg_next(sg);
+	}
+	sg_mark_end(sg);
+	cache->end = sg;
+	cache->sgt.orig_nents = cache->sgt.nents = n;
+	return &cache->sgt;
+}
+
+static void xocl_bo_range_sgt_put(struct drm_xocl_bo *xobj)
+{
+	mutex_unlock(&xobj->sg_cache->lock);
+}
+
+struct xocl_userptr_reg {
+	struct kref		ref;
+	struct list_head	link;	/* cache lru, under cache lock */
+	u64			addr;
+	u32			npages;
+	struct page		**pages;
+};
+
+#ifdef CONFIG_MMU_NOTIFIER
+/*
+ * Userptr registration cache
+ *
+ * The pages pinned for a userptr BO stay registered with the client
+ * after the BO is freed, so wrapping the same host memory again skips
+ * get_user_pages.  A registration covers a virtual address range of the
+ * client mm; any BO inside the range reuses its pages.  Registrations
+ * are dropped when their range is unmapped or remapped (MMU notifier),
+ * when the client closes, or least recently used first when the client
+ * has more than userptr_cache_mb registered.  Each BO holds a reference
+ * on its registration, so its pages stay pinned for the BO lifetime.
+ */
+static unsigned int userptr_cache_mb = 1024;
+module_param(userptr_cache_mb, uint, (S_IRUGO|S_IWUSR));
+MODULE_PARM_DESC(userptr_cache_mb,
+	"MB of userptr pages kept pinned per client for reuse, 0 disables (default 1024)");
+
+struct xocl_userptr_cache {
+	struct mmu_notifier	mn;
+	struct mm_struct	*mm;
+	spinlock_t		lock;
+	struct list_head	lru;	/* most recently used first */
+	u64			npages;	/* pages held by the cache */
+};
+
+static void xocl_userptr_reg_release(struct kref *kref)
+{
+	struct xocl_userptr_reg *reg =
+		container_of(kref, struct xocl_userptr_reg, ref);
+
+	xocl_release_pages(reg->pages, reg->npages, 0);
+	drm_free_large(reg->pages);
+	kfree(reg);
+}
+
+static void xocl_userptr_reg_put(struct xocl_userptr_reg *reg)
+{
+	kref_put(&reg->ref, xocl_userptr_reg_release);
+}
+
+static void xocl_userptr_reg_put_list(struct list_head *dead)
+{
+	struct xocl_userptr_reg *reg, *next;
+
+	list_for_each_entry_safe(reg, next, dead, link) {
+		list_del_init(&reg->link);
+		xocl_userptr_reg_put(reg);
+	}
+}
+
+/* Move registrations overlapping [start, end) to dead, cache lock held */
+static void xocl_userptr_cache_evict(struct xocl_userptr_cache *cache,
+	u64 start, u64 end, struct list_head *dead)
+{
+	struct xocl_userptr_reg *reg, *next;
+
+	list_for_each_entry_safe(reg, next, &cache->lru, link) {
+		if (reg->addr >= end ||
+		    reg->addr + ((u64)reg->npages << PAGE_SHIFT) <= start)
+			continue;
+		list_move(&reg->link, dead);
+		cache->npages -= reg->npages;
+	}
+}
+
+static void xocl_userptr_cache_invalidate(struct xocl_userptr_cache *cache,
+	u64 start, u64 end)
+{
+	LIST_HEAD(dead);
+
+	spin_lock(&cache->lock);
+	xocl_userptr_cache_evict(cache, start, end, &dead);
+	spin_unlock(&cache->lock);
+
+	xocl_userptr_reg_put_list(&dead);
+}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 0, 0)
+static int xocl_userptr_invalidate_range_start(struct mmu_notifier *mn,
+	const struct mmu_notifier_range *range)
+{
+	/* releasing pages may sleep */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 2, 0)
+	if (!mmu_notifier_range_blockable(range))
+#else
+	if (!range->blockable)
+#endif
+		return -EAGAIN;
+
+	xocl_userptr_cache_invalidate(
+		container_of(mn, struct xocl_userptr_cache, mn),
+		range->start, range->end);
+	return 0;
+}
+#elif LINUX_VERSION_CODE >= KERNEL_VERSION(4, 19, 0)
+static int xocl_userptr_invalidate_range_start(struct mmu_notifier *mn,
+	struct mm_struct *mm, unsigned long start, unsigned long end,
+	bool blockable)
+{
+	/* releasing pages may sleep */
+	if (!blockable)
+		return -EAGAIN;
+
+	xocl_userptr_cache_invalidate(
+		container_of(mn, struct xocl_userptr_cache, mn), start, end);
+	return 0;
+}
+#else
+static void xocl_userptr_invalidate_range_start(struct mmu_notifier *mn,
+	struct mm_struct *mm, unsigned long start, unsigned long end)
+{
+	xocl_userptr_cache_invalidate(
+		container_of(mn, struct xocl_userptr_cache, mn), start, end);
+}
+#endif
+
+static void xocl_userptr_mm_release(struct mmu_notifier *mn,
+	struct mm_struct *mm)
+{
+	xocl_userptr_cache_invalidate(
+		container_of(mn, struct xocl_userptr_cache, mn), 0, U64_MAX);
+}
+
+static const struct mmu_notifier_ops xocl_userptr_mn_ops = {
+	.release = xocl_userptr_mm_release,
+	.invalidate_range_start = xocl_userptr_invalidate_range_start,
+};
+
+static struct xocl_userptr_cache *xocl_userptr_cache_get(
+	struct client_ctx *client)
+{
+	struct xocl_userptr_cache *cache = READ_ONCE(client->uptr_cache);
+	struct xocl_userptr_cache *old;
+
+	if (!cache) {
+		if (!userptr_cache_mb)
+			return NULL;
+
+		cache = kzalloc(sizeof(*cache), GFP_KERNEL);
+		if (!cache)
+			return NULL;
+		spin_lock_init(&cache->lock);
+		INIT_LIST_HEAD(&cache->lru);
+		cache->mm = current->mm;
+		cache->mn.ops = &xocl_userptr_mn_ops;
+		if (mmu_notifier_register(&cache->mn, cache->mm)) {
+			kfree(cache);
+			return NULL;
+		}
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 11, 0)
+		mmgrab(cache->mm);
+#else
+		atomic_inc(&cache->mm->mm_count);
+#endif
+
+		old = cmpxchg(&client->uptr_cache, NULL, cache);
+		if (old) {
+			mmu_notifier_unregister(&cache->mn, cache->mm);
+			mmdrop(cache->mm);
+			kfree(cache);
+			cache = old;
+		}
+	}
+
+	/* Only the mm that created the cache is tracked */
+	return (cache->mm == current->mm) ? cache : NULL;
+}
+
+/*
+ * Return the registration covering npages at addr with a reference for
+ * the caller and the index of the first page in *first, pinning and
+ * registering the range if needed.  Returns NULL if the cache is not in
+ * use for this client.
+ */
+static struct xocl_userptr_reg *xocl_userptr_reg_get(struct drm_file *filp,
+	u64 addr, u32 npages, u32 *first)
+{
+	struct client_ctx *client = filp->driver_priv;
+	struct xocl_userptr_cache *cache;
+	struct xocl_userptr_reg *reg;
+	u64 end = addr + ((u64)npages << PAGE_SHIFT);
+	u64 max = (u64)userptr_cache_mb << (20 - PAGE_SHIFT);
+	LIST_HEAD(dead);
+	int ret;
+
+	cache = client ? xocl_userptr_cache_get(client) : NULL;
+	if (!cache || npages > max)
+		return NULL;
+
+	spin_lock(&cache->lock);
+	list_for_each_entry(reg, &cache->lru, link) {
+		if (addr < reg->addr ||
+		    end > reg->addr + ((u64)reg->npages << PAGE_SHIFT))
+			continue;
+		kref_get(&reg->ref);
+		list_move(&reg->link, &cache->lru);
+		spin_unlock(&cache->lock);
+		*first = (addr - reg->addr) >> PAGE_SHIFT;
+		return reg;
+	}
+	spin_unlock(&cache->lock);
+
+	reg = kzalloc(sizeof(*reg), GFP_KERNEL);
+	if (!reg)
+		return ERR_PTR(-ENOMEM);
+	reg->pages = drm_malloc_ab(npages, sizeof(*reg->pages));
+	if (!reg->pages) {
+		kfree(reg);
+		return ERR_PTR(-ENOMEM);
+	}
+	ret = get_user_pages_fast(addr, npages, 1, reg->pages);
+	if (ret != npages) {
+		if (ret > 0)
+			xocl_release_pages(reg->pages, ret, 0);
+		drm_free_large(reg->pages);
+		kfree(reg);
+		return ERR_PTR(ret < 0 ? ret : -EFAULT);
+	}
+	reg->addr = addr;
+	reg->npages = npages;
+	/* one reference for the caller and one for the cache */
+	kref_init(&reg->ref);
+	kref_get(&reg->ref);
+
+	spin_lock(&cache->lock);
+	list_add(&reg->link, &cache->lru);
+	cache->npages += npages;
+	while (cache->npages > max) {
+		struct xocl_userptr_reg *lru = list_last_entry(&cache->lru,
+			struct xocl_userptr_reg, link);
+
+		list_move(&lru->link, &dead);
+		cache->npages -= lru->npages;
+	}
+	spin_unlock(&cache->lock);
+
+	xocl_userptr_reg_put_list(&dead);
+
+	*first = 0;
+	return reg;
+}
+
+void xocl_userptr_cache_release(struct drm_file *filp)
+{
+	struct client_ctx *client = filp->driver_priv;
+	struct xocl_userptr_cache *cache = client ? client->uptr_cache : NULL;
+
+	if (!cache)
+		return;
+
+	mmu_notifier_unregister(&cache->mn, cache->mm);
+	xocl_userptr_cache_invalidate(cache, 0, U64_MAX);
+	mmdrop(cache->mm);
+	kfree(cache);
+	client->uptr_cache = NULL;
+}
+#else
+static inline void xocl_userptr_reg_put(struct xocl_userptr_reg *reg)
+{
+}
+
+static inline struct xocl_userptr_reg *xocl_userptr_reg_get(struct drm_file *filp,
+	u64 addr, u32 npages, u32 *first)
+{
+	return NULL;
+}
+
+void xocl_userptr_cache_release(struct drm_file *filp)
+{
+}
+#endif
+
+/*
+ * BOs created with XCL_BO_FLAGS_HUGEPAGE are backed by physically
+ * contiguous chunks of up to 2MB instead of shmem pages, so the BO sg
+ * table and the DMA descriptor list have few entries.  Chunks are split
+ * into order 0 pages so each page can be mapped and freed on its own.
+ * The chunk order drops when an allocation fails, down to single pages.
+ *
+ * Unless bo_numa_local is cleared, other host BOs are also allocated by
+ * the driver, one page at a time, so that all driver allocated pages
+ * come from the NUMA node of the device instead of the node of the
+ * calling thread.  DMA to a page on the far socket crosses the socket
+ * interconnect.  Pages come from other nodes when the device node is
+ * out of memory.
+ */
+#define XOCL_BO_HUGE_ORDER	min_t(unsigned, get_order(SZ_2M), MAX_ORDER - 1)
+
+static bool bo_numa_local = true;
+module_param(bo_numa_local, bool, (S_IRUGO|S_IWUSR));
+MODULE_PARM_DESC(bo_numa_local,
+	"Allocate host BO pages on the NUMA node of the device (default 1)");
+
+static void xocl_bo_free_drv_pages(struct page **pages, u32 npages)
+{
+	u32 i;
+
+	for (i = 0; i < npages; i++)
+		__free_page(pages[i]);
+	drm_free_large(pages);
+}
+
+static struct page **xocl_bo_alloc_drv_pages(u32 npages, unsigned order,
+	int nid)
+{
+	struct page **pages;
+	u32 i = 0, j;
+
+	pages = drm_malloc_ab(npages, sizeof(*pages));
+	if (!pages)
+		return ERR_PTR(-ENOMEM);
+
+	while (i < npages) {
+		struct page *pg;
+		gfp_t gfp = GFP_HIGHUSER | __GFP_ZERO;
+
+		while (order && (1U << order) > npages - i)
+			order--;
+		if (order)
+			gfp |= __GFP_NOWARN | __GFP_NORETRY;
+
+		pg = alloc_pages_node(nid, gfp, order);
+		if (!pg) {
+			if (!order) {
+				xocl_bo_free_drv_pages(pages, i);
+				return ERR_PTR(-ENOMEM);
+			}
+			order--;
+			continue;
+		}
+
+		if (order)
+			split_page(pg, order);
+		for (j = 0; j < (1U << order); j++)
+			pages[i++] = pg + j;
+	}
+
+	return pages;
+}
+
+/* NUMA node of all pages of a BO, NUMA_NO_NODE if spread over nodes */
+static int xocl_bo_pages_node(struct page **pages, u32 npages)
+{
+	int nid;
+	u32 i;
+
+	if (!pages || !npages)
+		return NUMA_NO_NODE;
+
+	nid = page_to_nid(pages[0]);
+	for (i = 1; i < npages; i++) {
+		if (page_to_nid(pages[i]) != nid)
+			return NUMA_NO_NODE;
+	}
+	return nid;
+}
+
+/*
+ * BOs created with XCL_BO_FLAGS_PREBUILT keep a DMA descriptor chain for
+ * syncing the whole BO, built once at creation.  The chain maps its own
+ * sg table, so the BO sg table stays free for the regular DMA path.
+ */
+static void xocl_bo_dma_chain_free(struct xocl_dev *xdev,
+	struct drm_xocl_bo *xobj)
+{
+	if (xobj->dma_chain)
+		xocl_dma_chain_free(xdev, xobj->dma_chain);
+	xobj->dma_chain = NULL;
+
+	if (xobj->chain_sgt) {
+		sg_free_table(xobj->chain_sgt);
+		kfree(xobj->chain_sgt);
+	}
+	xobj->chain_sgt = NULL;
+}
+
+static void xocl_bo_dma_chain_init(struct xocl_dev *xdev,
+	struct drm_xocl_bo *xobj)
+{
+	u64 paddr = xocl_bo_physical_addr(xobj);
+	void *chain;
+
+	if (!xocl_bo_sync_able(xobj->flags) || !xobj->pages ||
+	    paddr == 0xffffffffffffffffull)
+		return;
+
+	xobj->chain_sgt = drm_prime_pages_to_sg(xobj->pages,
+		xobj->base.size >> PAGE_SHIFT);
+	if (IS_ERR(xobj->chain_sgt)) {
+		xobj->chain_sgt = NULL;
+		return;
+	}
+
+	/* Not fatal, the BO is synced through the regular path */
+	chain = xocl_dma_chain_create(xdev, xobj->chain_sgt, paddr);
+	if (IS_ERR(chain)) {
+		DRM_DEBUG("No DMA chain for BO %p, %ld\n", xobj, PTR_ERR(chain));
+		xocl_bo_dma_chain_free(xdev, xobj);
+		return;
+	}
+	xobj->dma_chain = chain;
 }
 
 static void xocl_free_bo(struct drm_gem_object *obj)
@@ -118,6 +687,7 @@ static void xocl_free_bo(struct drm_gem_object *obj)
 	struct xocl_dev *xdev = drm_p->xdev;
 	int npages = obj->size >> PAGE_SHIFT;
 	DRM_DEBUG("Freeing BO %p\n", xobj);
+	trace_xocl_bo_free(XDEV(xdev)->dev_minor, xobj, obj->size);
 
 	BO_ENTER("xobj %p pages %p", xobj, xobj->pages);
 	if (xobj->vmapping)
@@ -133,18 +703,28 @@ static void xocl_free_bo(struct drm_gem_object *obj)
 			PCI_DMA_BIDIRECTIONAL);
 	}
 
+	xocl_bo_dma_chain_free(xdev, xobj);
+
 	if (xobj->pages) {
-		if (xocl_bo_userptr(xobj)) {
+		if (xocl_bo_userptr(xobj) && xobj->uptr_reg) {
+			/* pages are owned by the registration */
+			xocl_userptr_reg_put(xobj->uptr_reg);
+			xobj->uptr_reg = NULL;
+		} else if (xocl_bo_userptr(xobj)) {
 			xocl_release_pages(xobj->pages, npages, 0);
 			drm_free_large(xobj->pages);
 		} else if (xocl_bo_p2p(xobj) || xocl_bo_import(xobj)) {
 			drm_free_large(xobj->pages);
+		} else if (xobj->drv_pages) {
+			xocl_bo_free_drv_pages(xobj->pages, npages);
 		} else {
 			drm_gem_put_pages(obj, xobj->pages, false, false);
 		}
 	}
 	xobj->pages = NULL;
 
+	xocl_bo_sg_cache_free(xobj);
+
 	if (!xocl_bo_import(xobj)) {
 		DRM_DEBUG("Freeing regular buffer\n");
 		if (xobj->sgt) {
@@ -155,6 +735,15 @@ static void xocl_free_bo(struct drm_gem_object *obj)
 		xocl_free_mm_node(xobj);
 	} else {
 		DRM_DEBUG("Freeing imported buffer\n");
+		/*
+		 * Failed imports are freed under import_lock, they were
+		 * never added to the import cache
+		 */
+		if (!list_empty(&xobj->import_link)) {
+			mutex_lock(&drm_p->import_lock);
+			list_del(&xobj->import_link);
+			mutex_unlock(&drm_p->import_lock);
+		}
 		if (obj->import_attach) {
 			DRM_DEBUG("Unnmapping attached dma buf\n");
 			dma_buf_unmap_attachment(obj->import_attach,
@@ -254,6 +843,8 @@ static struct drm_xocl_bo *xocl_create_bo(struct drm_device *dev,
 	BO_ENTER("xobj %p", xobj);
 
 	xobj->flags = bo_type;
+	xobj->numa_node = NUMA_NO_NODE;
+	INIT_LIST_HEAD(&xobj->import_link);
 	if (xobj->flags == XOCL_BO_EXECBUF)
 		xobj->metadata.state = DRM_XOCL_EXECBUF_STATE_ABORT;
 
@@ -268,8 +859,11 @@ static struct drm_xocl_bo *xocl_create_bo(struct drm_device *dev,
 
 	xobj_inited = true;
 
-	if (!(xobj->flags & XOCL_DEVICE_MEM))
+	if (!(xobj->flags & XOCL_DEVICE_MEM)) {
+		trace_xocl_bo_create(XDEV(xdev)->dev_minor, xobj,
+			xobj->base.size, user_flags, ddr);
 		return xobj;
+	}
 
 	/* Let's reserve some device memory */
 	xobj->mm_node = kzalloc(sizeof(*xobj->mm_node), GFP_KERNEL);
@@ -280,25 +874,34 @@ static struct drm_xocl_bo *xocl_create_bo(struct drm_device *dev,
 
 	ddr_count = XOCL_DDR_COUNT(xdev);
 
-	mutex_lock(&drm_p->mm_lock);
+	down_read(&drm_p->mm_lock);
+	if (!drm_p->mm || !drm_p->mm[ddr]) {
+		up_read(&drm_p->mm_lock);
+		err = -EINVAL;
+		goto failed;
+	}
 	/* Attempt to allocate buffer on the requested DDR */
 	xocl_xdev_dbg(xdev, "alloc bo from bank%u", ddr);
+	mutex_lock(drm_p->mm_bank_lock[ddr]);
 	err = xocl_mm_insert_node(drm_p, ddr, xobj->mm_node,
 		xobj->base.size);
 	BO_DEBUG("insert mm_node:%p, start:%llx size: %llx",
 		xobj->mm_node, xobj->mm_node->start,
 		xobj->mm_node->size);
+	if (!err)
+		xocl_mm_update_usage_stat(drm_p, ddr, xobj->base.size, 1);
+	mutex_unlock(drm_p->mm_bank_lock[ddr]);
+	up_read(&drm_p->mm_lock);
 	if (err)
 		goto failed;
 
-	xocl_mm_update_usage_stat(drm_p, ddr, xobj->base.size, 1);
-	mutex_unlock(&drm_p->mm_lock);
 	/* Record the DDR we allocated the buffer on */
 	xobj->mem_idx = ddr;
+	trace_xocl_bo_create(XDEV(xdev)->dev_minor, xobj,
+		xobj->base.size, user_flags, ddr);
 
 	return xobj;
 failed:
-	mutex_unlock(&drm_p->mm_lock);
 	kfree(xobj->mm_node);
 	if (xobj_inited)
 		drm_gem_object_release(&xobj->base);
@@ -384,13 +987,24 @@ int xocl_create_bo_ioctl(struct drm_device *dev,
 
 		if (xobj->flags & XOCL_P2P_MEM)
 			xobj->pages = xocl_p2p_get_pages(xobj->bar_vmapping, xobj->base.size >> PAGE_SHIFT);
-		else if (xobj->flags & XOCL_DRM_SHMEM)
+		else if ((xobj->flags & XOCL_DRM_SHMEM) &&
+			 ((args->flags & XCL_BO_FLAGS_HUGEPAGE) || bo_numa_local)) {
+			xobj->pages = xocl_bo_alloc_drv_pages(
+				xobj->base.size >> PAGE_SHIFT,
+				(args->flags & XCL_BO_FLAGS_HUGEPAGE) ?
+				XOCL_BO_HUGE_ORDER : 0,
+				dev_to_node(&xdev->core.pdev->dev));
+			xobj->drv_pages = !IS_ERR(xobj->pages);
+		} else if (xobj->flags & XOCL_DRM_SHMEM)
 			xobj->pages = drm_gem_get_pages(&xobj->base);
 
 		if (IS_ERR(xobj->pages)) {
 			ret = PTR_ERR(xobj->pages);
 			goto out_free;
 		}
+		if (!(xobj->flags & XOCL_P2P_MEM))
+			xobj->numa_node = xocl_bo_pages_node(xobj->pages,
+				xobj->base.size >> PAGE_SHIFT);
 		xobj->sgt = drm_prime_pages_to_sg(xobj->pages, xobj->base.size >> PAGE_SHIFT);
 		if (IS_ERR(xobj->sgt)) {
 			ret = PTR_ERR(xobj->sgt);
@@ -404,6 +1018,8 @@ int xocl_create_bo_ioctl(struct drm_device *dev,
 			}
 		}
 	}
+	if (args->flags & XCL_BO_FLAGS_PREBUILT)
+		xocl_bo_dma_chain_init(xdev, xobj);
 	ret = drm_gem_create_mmap_offset(&xobj->base);
 	if (ret < 0)
 		goto out_free;
@@ -428,6 +1044,8 @@ int xocl_userptr_bo_ioctl(struct drm_device *dev,
 	unsigned int page_count;
 	struct drm_xocl_userptr_bo *args = data;
 	unsigned user_flags = args->flags;
+	struct xocl_userptr_reg *reg;
+	u32 first = 0;
 
 	if (offset_in_page(args->addr))
 		return -EINVAL;
@@ -443,6 +1061,17 @@ int xocl_userptr_bo_ioctl(struct drm_device *dev,
 	/* Use the page rounded size so we can accurately account for number of pages */
 	page_count = xobj->base.size >> PAGE_SHIFT;
 
+	reg = xocl_userptr_reg_get(filp, args->addr, page_count, &first);
+	if (IS_ERR(reg)) {
+		ret = PTR_ERR(reg);
+		goto out1;
+	}
+	if (reg) {
+		xobj->uptr_reg = reg;
+		xobj->pages = reg->pages + first;
+		goto pinned;
+	}
+
 	xobj->pages = drm_malloc_ab(page_count, sizeof(*xobj->pages));
 	if (!xobj->pages) {
 		ret = -ENOMEM;
@@ -453,6 +1082,8 @@ int xocl_userptr_bo_ioctl(struct drm_device *dev,
 	if (ret != page_count)
 		goto out0;
 
+pinned:
+	xobj->numa_node = xocl_bo_pages_node(xobj->pages, page_count);
 	xobj->sgt = drm_prime_pages_to_sg(xobj->pages, page_count);
 	if (IS_ERR(xobj->sgt)) {
 		ret = PTR_ERR(xobj->sgt);
@@ -476,8 +1107,10 @@ int xocl_userptr_bo_ioctl(struct drm_device *dev,
 	return ret;
 
 out0:
-	drm_free_large(xobj->pages);
-	xobj->pages = NULL;
+	if (!xobj->uptr_reg) {
+		drm_free_large(xobj->pages);
+		xobj->pages = NULL;
+	}
 out1:
 	xocl_free_bo(&xobj->base);
 	DRM_DEBUG("handle creation failed\n");
@@ -542,11 +1175,12 @@ int xocl_sync_bo_ioctl(struct drm_device *dev,
 		       void *data,
 		       struct drm_file *filp)
 {
-	const struct drm_xocl_bo *xobj;
+	struct drm_xocl_bo *xobj;
 	struct sg_table *sgt;
 	u64 paddr = 0;
 	int channel = 0;
 	ssize_t ret = 0;
+	bool cached_sgt = false;
 	const struct drm_xocl_sync_bo *args = data;
 	struct xocl_drm *drm_p = dev->dev_private;
 	struct xocl_dev *xdev = drm_p->xdev;
@@ -563,6 +1197,13 @@ int xocl_sync_bo_ioctl(struct drm_device *dev,
 	BO_ENTER("xobj %p", xobj);
 	sgt = xobj->sgt;
 
+	/*
+	 * An imported BO is the exporter's buffer itself, there is no second
+	 * copy to bring up to date.  Device transfers go through copy_bo.
+	 */
+	if (xocl_bo_import(xobj))
+		goto out;
+
 	if (!xocl_bo_sync_able(xobj->flags)) {
 		DRM_DEBUG("This BO doesn't support sync_bo\n");
 		ret = -EOPNOTSUPP;
@@ -601,7 +1242,14 @@ int xocl_sync_bo_ioctl(struct drm_device *dev,
 	paddr += args->offset;
 
 	if (args->offset || (args->size != xobj->base.size)) {
-		sgt = alloc_onetime_sg_table(xobj->pages, args->offset, args->size);
+		if (!args->size) {
+			ret = 0;
+			goto out;
+		}
+		sgt = xocl_bo_range_sgt_get(xobj, args->offset, args->size);
+		cached_sgt = (sgt != NULL);
+		if (!cached_sgt)
+			sgt = alloc_onetime_sg_table(xobj->pages, args->offset, args->size);
 		if (IS_ERR(sgt)) {
 			ret = PTR_ERR(sgt);
 			goto out;
@@ -609,19 +1257,28 @@ int xocl_sync_bo_ioctl(struct drm_device *dev,
 	}
 
 	//drm_clflush_sg(sgt);
-	channel = xocl_acquire_channel(xdev, dir);
+	channel = xocl_acquire_channel_flags(xdev, dir,
+		(args->flags & DRM_XOCL_DMA_PRIO) ? XOCL_DMA_FLAG_PRIO : 0);
 
 	if (channel < 0) {
 		ret = -EINVAL;
 		goto clear;
 	}
 	/* Now perform DMA */
-	ret = xocl_migrate_bo(xdev, sgt, dir, paddr, channel, args->size);
+	if (xobj->dma_chain && sgt == xobj->sgt)
+		ret = xocl_dma_chain_submit(xdev, xobj->dma_chain, dir, channel,
+			(args->flags & DRM_XOCL_DMA_POLL) ? XOCL_DMA_FLAG_POLL : 0);
+	else
+		ret = xocl_migrate_bo_flags(xdev, sgt, dir, paddr, channel,
+			args->size,
+			(args->flags & DRM_XOCL_DMA_POLL) ? XOCL_DMA_FLAG_POLL : 0);
 	if (ret >= 0)
 		ret = (ret == args->size) ? 0 : -EIO;
 	xocl_release_channel(xdev, dir, channel);
 clear:
-	if (args->offset || (args->size != xobj->base.size)) {
+	if (cached_sgt) {
+		xocl_bo_range_sgt_put(xobj);
+	} else if (args->offset || (args->size != xobj->base.size)) {
 		sg_free_table(sgt);
 		kfree(sgt);
 	}
@@ -630,6 +1287,293 @@ out:
 	return ret;
 }
 
+/*
+ * Transfers of at least this size are split across DMA channels
+ */
+#define XOCL_SYNC_CHUNK_MIN	(4 * 1024 * 1024)
+
+struct xocl_sync_fence;
+
+struct xocl_sync_chunk {
+	struct work_struct	work;
+	struct xocl_sync_fence	*fence;
+	struct sg_table		*sgt;
+	u64			paddr;
+	u64			size;
+};
+
+/*
+ * Asynchronous sync bo, one chunk per DMA channel.  The fence is
+ * owned by the idr once all chunks are queued, and is freed by
+ * the first DRM_IOCTL_XOCL_SYNC_BO_WAIT that observes the fence done
+ * or when the file is closed.
+ */
+struct xocl_sync_fence {
+	struct xocl_drm		*drm_p;
+	struct drm_file		*filp;
+	struct drm_gem_object	*gem_obj;
+	struct eventfd_ctx	*efd;
+	u32			dir;
+	atomic_t		pending;
+	int			status;
+	bool			done;
+	u32			nchunks;
+	struct xocl_sync_chunk	chunks[0];
+};
+
+static void xocl_sync_fence_done(struct xocl_sync_fence *fence)
+{
+	struct xocl_drm *drm_p = fence->drm_p;
+
+	XOCL_DRM_GEM_OBJECT_PUT_UNLOCKED(fence->gem_obj);
+	if (fence->efd) {
+		eventfd_signal(fence->efd, 1);
+		eventfd_ctx_put(fence->efd);
+	}
+
+	/* fence can be freed by waiter as soon as done is set */
+	spin_lock(&drm_p->sync_lock);
+	fence->done = true;
+	spin_unlock(&drm_p->sync_lock);
+	wake_up_all(&drm_p->sync_done);
+}
+
+static void xocl_sync_chunk_work(struct work_struct *work)
+{
+	struct xocl_sync_chunk *chunk =
+		container_of(work, struct xocl_sync_chunk, work);
+	struct xocl_sync_fence *fence = chunk->fence;
+	struct xocl_dev *xdev = fence->drm_p->xdev;
+	ssize_t ret = 0;
+	int channel;
+
+	if (xdev->offline) {
+		ret = -ENODEV;
+		goto done;
+	}
+
+	channel = xocl_acquire_channel(xdev, fence->dir);
+	if (channel < 0) {
+		ret = -EINVAL;
+		goto done;
+	}
+	ret = xocl_migrate_bo(xdev, chunk->sgt, fence->dir, chunk->paddr,
+		channel, chunk->size);
+	if (ret >= 0)
+		ret = (ret == chunk->size) ? 0 : -EIO;
+	xocl_release_channel(xdev, fence->dir, channel);
+
+done:
+	sg_free_table(chunk->sgt);
+	kfree(chunk->sgt);
+	chunk->sgt = NULL;
+	if (ret)
+		cmpxchg(&fence->status, 0, (int)ret);
+	if (atomic_dec_and_test(&fence->pending))
+		xocl_sync_fence_done(fence);
+}
+
+int xocl_sync_bo_async_ioctl(struct drm_device *dev,
+			     void *data,
+			     struct drm_file *filp)
+{
+	const struct drm_xocl_bo *xobj;
+	struct drm_xocl_sync_bo_async *args = data;
+	struct xocl_drm *drm_p = dev->dev_private;
+	struct xocl_dev *xdev = drm_p->xdev;
+	struct xocl_sync_fence *fence = NULL;
+	struct drm_gem_object *gem_obj;
+	u64 paddr, chunk_size, off;
+	u32 nchunks, i;
+	int ret = 0;
+	int id;
+
+	gem_obj = xocl_gem_object_lookup(dev, filp, args->handle);
+	if (!gem_obj) {
+		DRM_ERROR("Failed to look up GEM BO %d\n", args->handle);
+		return -ENOENT;
+	}
+
+	xobj = to_xocl_bo(gem_obj);
+	BO_ENTER("xobj %p", xobj);
+
+	if (!xocl_bo_sync_able(xobj->flags)) {
+		DRM_DEBUG("This BO doesn't support sync_bo\n");
+		ret = -EOPNOTSUPP;
+		goto out;
+	}
+
+	paddr = xocl_bo_physical_addr(xobj);
+	if (paddr == 0xffffffffffffffffull || !args->size ||
+	    (args->offset + args->size) > gem_obj->size) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	if (xdev->offline) {
+		ret = -ENODEV;
+		goto out;
+	}
+
+	/* one page aligned chunk per channel */
+	nchunks = min_t(u32, max_t(u32, xocl_get_chan_count(xdev), 1),
+		DIV_ROUND_UP(args->size, XOCL_SYNC_CHUNK_MIN));
+	chunk_size = round_up(DIV_ROUND_UP(args->size, nchunks), PAGE_SIZE);
+	nchunks = DIV_ROUND_UP(args->size, chunk_size);
+
+	fence = kzalloc(sizeof(*fence) + nchunks * sizeof(fence->chunks[0]),
+		GFP_KERNEL);
+	if (!fence) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	fence->drm_p = drm_p;
+	fence->filp = filp;
+	fence->gem_obj = gem_obj;
+	fence->dir = (args->dir == DRM_XOCL_SYNC_BO_TO_DEVICE) ? 1 : 0;
+	fence->nchunks = nchunks;
+	atomic_set(&fence->pending, nchunks);
+
+	if (args->efd >= 0) {
+		fence->efd = eventfd_ctx_fdget(args->efd);
+		if (IS_ERR(fence->efd)) {
+			ret = PTR_ERR(fence->efd);
+			fence->efd = NULL;
+			goto out;
+		}
+	}
+
+	for (i = 0, off = 0; i < nchunks; i++, off += chunk_size) {
+		struct xocl_sync_chunk *chunk = &fence->chunks[i];
+
+		chunk->fence = fence;
+		chunk->paddr = paddr + args->offset + off;
+		chunk->size = min(chunk_size, args->size - off);
+		chunk->sgt = alloc_onetime_sg_table(xobj->pages,
+			args->offset + off, chunk->size);
+		if (IS_ERR(chunk->sgt)) {
+			ret = PTR_ERR(chunk->sgt);
+			chunk->sgt = NULL;
+			goto out;
+		}
+		INIT_WORK(&chunk->work, xocl_sync_chunk_work);
+	}
+
+	idr_preload(GFP_KERNEL);
+	spin_lock(&drm_p->sync_lock);
+	id = idr_alloc(&drm_p->sync_fences, fence, 1, 0, GFP_NOWAIT);
+	spin_unlock(&drm_p->sync_lock);
+	idr_preload_end();
+	if (id < 0) {
+		ret = id;
+		goto out;
+	}
+	args->fence = id;
+
+	/* fence and bo reference now owned by workers */
+	for (i = 0; i < nchunks; i++)
+		queue_work(drm_p->sync_wq, &fence->chunks[i].work);
+	return 0;
+
+out:
+	if (fence) {
+		for (i = 0; i < fence->nchunks; i++) {
+			if (!fence->chunks[i].sgt)
+				continue;
+			sg_free_table(fence->chunks[i].sgt);
+			kfree(fence->chunks[i].sgt);
+		}
+		if (fence->efd)
+			eventfd_ctx_put(fence->efd);
+		kfree(fence);
+	}
+	XOCL_DRM_GEM_OBJECT_PUT_UNLOCKED(gem_obj);
+	return ret;
+}
+
+/*
+ * Release fence if done, returns 1 if released, 0 if not yet done,
+ * or -ENOENT if no such fence
+ */
+static int xocl_sync_fence_reap(struct xocl_drm *drm_p,
+	struct drm_file *filp, u32 id, int *status)
+{
+	struct xocl_sync_fence *fence;
+	int ret = 0;
+
+	spin_lock(&drm_p->sync_lock);
+	fence = idr_find(&drm_p->sync_fences, id);
+	if (!fence || fence->filp != filp) {
+		ret = -ENOENT;
+	} else if (fence->done) {
+		idr_remove(&drm_p->sync_fences, id);
+		*status = fence->status;
+		ret = 1;
+	}
+	spin_unlock(&drm_p->sync_lock);
+
+	if (ret == 1)
+		kfree(fence);
+	return ret;
+}
+
+int xocl_sync_bo_wait_ioctl(struct drm_device *dev,
+			    void *data,
+			    struct drm_file *filp)
+{
+	struct drm_xocl_sync_bo_wait *args = data;
+	struct xocl_drm *drm_p = dev->dev_private;
+	int status = 0;
+	long wait = 0;
+	int ret = 0;
+
+	if (args->fence > U32_MAX)
+		return -ENOENT;
+
+	if (args->timeout < 0)
+		wait = wait_event_interruptible(drm_p->sync_done,
+			(ret = xocl_sync_fence_reap(drm_p, filp,
+			args->fence, &status)) != 0);
+	else if (args->timeout > 0)
+		wait = wait_event_interruptible_timeout(drm_p->sync_done,
+			(ret = xocl_sync_fence_reap(drm_p, filp,
+			args->fence, &status)) != 0,
+			msecs_to_jiffies(args->timeout));
+	else
+		ret = xocl_sync_fence_reap(drm_p, filp, args->fence, &status);
+
+	if (wait < 0)
+		return wait;
+	if (ret < 0)
+		return ret;
+	if (ret == 0)
+		return -ETIMEDOUT;
+
+	args->status = status;
+	return 0;
+}
+
+/*
+ * Release all fences of a file being closed, waits for outstanding
+ * transfers to complete
+ */
+void xocl_sync_bo_release(struct xocl_drm *drm_p, struct drm_file *filp)
+{
+	struct xocl_sync_fence *fence;
+	int id;
+
+	flush_workqueue(drm_p->sync_wq);
+
+	spin_lock(&drm_p->sync_lock);
+	idr_for_each_entry(&drm_p->sync_fences, fence, id) {
+		if (fence->filp != filp)
+			continue;
+		idr_remove(&drm_p->sync_fences, id);
+		kfree(fence);
+	}
+	spin_unlock(&drm_p->sync_lock);
+}
+
 int xocl_info_bo_ioctl(struct drm_device *dev,
 		       void *data,
 		       struct drm_file *filp)
@@ -650,13 +1594,16 @@ int xocl_info_bo_ioctl(struct drm_device *dev,
 	args->size = xobj->base.size;
 
 	args->paddr = xocl_bo_physical_addr(xobj);
+	args->flags = xocl_bo_p2p(xobj) ? XCL_BO_FLAGS_P2P : 0;
+	args->numa_node = xobj->numa_node;
 	xocl_describe(xobj);
 	XOCL_DRM_GEM_OBJECT_PUT_UNLOCKED(gem_obj);
 
 	return 0;
 }
 
-static int xocl_migrate_unmgd(struct xocl_dev *xdev, uint64_t data_ptr, uint64_t paddr, size_t size, bool dir)
+static int xocl_migrate_unmgd(struct xocl_dev *xdev, uint64_t data_ptr, uint64_t paddr, size_t size, bool dir,
+	u32 flags)
 {
 	int channel;
 	struct drm_xocl_unmgd unmgd;
@@ -669,7 +1616,8 @@ static int xocl_migrate_unmgd(struct xocl_dev *xdev, uint64_t data_ptr, uint64_t
 		return ret;
 	}
 
-	channel = xocl_acquire_channel(xdev, dir);
+	channel = xocl_acquire_channel_flags(xdev, dir,
+		(flags & DRM_XOCL_DMA_PRIO) ? XOCL_DMA_FLAG_PRIO : 0);
 
 	if (channel < 0) {
 		userpf_err(xdev, "acquire channel failed");
@@ -677,8 +1625,8 @@ static int xocl_migrate_unmgd(struct xocl_dev *xdev, uint64_t data_ptr, uint64_t
 		goto clear;
 	}
 	/* Now perform DMA */
-	migrated = xocl_migrate_bo(xdev, unmgd.sgt, dir, paddr, channel,
-		size);
+	migrated = xocl_migrate_bo_flags(xdev, unmgd.sgt, dir, paddr, channel,
+		size, (flags & DRM_XOCL_DMA_POLL) ? XOCL_DMA_FLAG_POLL : 0);
 	if (migrated >= 0)
 		ret = (migrated == size) ? 0 : -EIO;
 
@@ -736,7 +1684,8 @@ int xocl_pwrite_bo_ioctl(struct drm_device *dev, void *data,
 			ret = -EINVAL;
 			goto out;
 		}
-		ret = xocl_migrate_unmgd(xdev, args->data_ptr, ep_addr, args->size, 1);
+		ret = xocl_migrate_unmgd(xdev, args->data_ptr, ep_addr, args->size, 1,
+			args->flags);
 	} else {
 		kaddr = xobj->vmapping ? xobj->vmapping : xobj->bar_vmapping;
 		kaddr += args->offset;
@@ -798,7 +1747,8 @@ int xocl_pread_bo_ioctl(struct drm_device *dev, void *data,
 			ret = -EINVAL;
 			goto out;
 		}
-		ret = xocl_migrate_unmgd(xdev, args->data_ptr, ep_addr, args->size, 0);
+		ret = xocl_migrate_unmgd(xdev, args->data_ptr, ep_addr, args->size, 0,
+			args->flags);
 
 	} else {
 		kaddr = xobj->vmapping ? xobj->vmapping : xobj->bar_vmapping;
@@ -812,13 +1762,121 @@ out:
 	return ret;
 }
 
+/*
+ * Copy one range between user memory and the BO, write is to the BO.
+ * Device only BOs go through unmanaged DMA, others through the kernel
+ * mapping of the backing storage.
+ */
+static int xocl_bo_copy_iov(struct xocl_dev *xdev, struct drm_xocl_bo *xobj,
+	const struct drm_xocl_bo_iovec *iov, u32 flags, bool write)
+{
+	char __user *user_data = to_user_ptr(iov->data_ptr);
+	uint64_t ep_addr;
+	void *kaddr;
+
+	if (xobj->flags == XOCL_BO_DEV_ONLY) {
+		ep_addr = xocl_bo_physical_addr(xobj);
+		if (ep_addr == INVALID_BO_PADDR)
+			return -EINVAL;
+		return xocl_migrate_unmgd(xdev, iov->data_ptr,
+			ep_addr + iov->offset, iov->size, write, flags);
+	}
+
+	kaddr = xobj->vmapping ? xobj->vmapping : xobj->bar_vmapping;
+	kaddr += iov->offset;
+	if (write)
+		return copy_from_user(kaddr, user_data, iov->size) ? -EFAULT : 0;
+	return copy_to_user(user_data, kaddr, iov->size) ? -EFAULT : 0;
+}
+
+static int xocl_rw_bo_v(struct drm_device *dev, struct drm_file *filp,
+	const struct drm_xocl_rw_bo_v *args, bool write)
+{
+	struct drm_xocl_bo *xobj;
+	struct drm_gem_object *gem_obj;
+	struct drm_xocl_bo_iovec *iov = NULL;
+	struct xocl_drm *drm_p = dev->dev_private;
+	struct xocl_dev *xdev = drm_p->xdev;
+	int ret = 0;
+	u32 i;
+
+	if (args->count > DRM_XOCL_RW_BO_V_MAX)
+		return -EINVAL;
+	if (!args->count)
+		return 0;
+
+	gem_obj = xocl_gem_object_lookup(dev, filp, args->handle);
+	if (!gem_obj) {
+		DRM_ERROR("Failed to look up GEM BO %d\n", args->handle);
+		return -ENOENT;
+	}
+
+	xobj = to_xocl_bo(gem_obj);
+	BO_ENTER("xobj %p", xobj);
+
+	if (xocl_bo_userptr(xobj)) {
+		ret = -EPERM;
+		goto out;
+	}
+
+	iov = kmalloc_array(args->count, sizeof(*iov), GFP_KERNEL);
+	if (!iov) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	if (copy_from_user(iov, to_user_ptr(args->iov),
+	    args->count * sizeof(*iov))) {
+		ret = -EFAULT;
+		goto out;
+	}
+
+	for (i = 0; i < args->count; i++) {
+		if ((iov[i].offset > gem_obj->size) ||
+		    (iov[i].size > gem_obj->size) ||
+		    ((iov[i].offset + iov[i].size) > gem_obj->size)) {
+			ret = -EINVAL;
+			goto out;
+		}
+		if (!XOCL_ACCESS_OK(write ? VERIFY_READ : VERIFY_WRITE,
+		    to_user_ptr(iov[i].data_ptr), iov[i].size)) {
+			ret = -EFAULT;
+			goto out;
+		}
+	}
+
+	for (i = 0; i < args->count && !ret; i++) {
+		if (iov[i].size)
+			ret = xocl_bo_copy_iov(xdev, xobj, &iov[i], args->flags,
+				write);
+	}
+
+out:
+	kfree(iov);
+	XOCL_DRM_GEM_OBJECT_PUT_UNLOCKED(gem_obj);
+
+	return ret;
+}
+
+int xocl_pwrite_bo_v_ioctl(struct drm_device *dev, void *data,
+	struct drm_file *filp)
+{
+	return xocl_rw_bo_v(dev, filp, data, true);
+}
+
+int xocl_pread_bo_v_ioctl(struct drm_device *dev, void *data,
+	struct drm_file *filp)
+{
+	return xocl_rw_bo_v(dev, filp, data, false);
+}
+
 int xocl_copy_import_bo(struct drm_device *dev, struct drm_file *filp,
 	struct ert_start_copybo_cmd *cmd)
 {
-	const struct drm_xocl_bo *dst_xobj, *src_xobj;
-	const struct drm_xocl_bo *import_xobj, *local_xobj;
+	const struct drm_xocl_bo *dst_xobj, *src_xobj, *local_xobj;
+	struct drm_xocl_bo *import_xobj;
 	struct sg_table *sgt = NULL;
 	struct sg_table *tmp_sgt = NULL;
+	bool cached_sgt = false;
 	int channel = 0;
 	ssize_t ret = 0;
 	struct xocl_drm *drm_p = dev->dev_private;
@@ -830,6 +1888,7 @@ int xocl_copy_import_bo(struct drm_device *dev, struct drm_file *filp,
 	u64 local_offset = 0;
 	u64 import_offset = 0;
 	u64 cp_size = ert_copybo_size(cmd);
+	ktime_t start;
 
 	if (cmd->opcode != ERT_START_COPYBO)
 		return -EINVAL;
@@ -875,7 +1934,7 @@ int xocl_copy_import_bo(struct drm_device *dev, struct drm_file *filp,
 		/* src is local */
 		local_xobj = src_xobj;
 		local_offset = ert_copybo_src_offset(cmd);
-		import_xobj = dst_xobj;
+		import_xobj = to_xocl_bo(dst_gem_obj);
 		import_offset = ert_copybo_dst_offset(cmd);
 		dir = 0;
 	} else {
@@ -883,7 +1942,7 @@ int xocl_copy_import_bo(struct drm_device *dev, struct drm_file *filp,
 		DRM_ERROR("reading from remote BO, performance degraded");
 		local_xobj = dst_xobj;
 		local_offset = ert_copybo_dst_offset(cmd);
-		import_xobj = src_xobj;
+		import_xobj = to_xocl_bo(src_gem_obj);
 		import_offset = ert_copybo_src_offset(cmd);
 		dir = 1;
 	}
@@ -897,14 +1956,20 @@ int xocl_copy_import_bo(struct drm_device *dev, struct drm_file *filp,
 	local_pa += local_offset;
 
 	if (import_offset || (cp_size != import_xobj->base.size)) {
-		tmp_sgt = alloc_onetime_sg_table(import_xobj->pages,
-			import_offset, cp_size);
-		if (IS_ERR(tmp_sgt)) {
-			DRM_ERROR("failed to alloc tmp sgt, copy_bo aborted");
-			ret = PTR_ERR(tmp_sgt);
-			goto out;
+		/* Copies of parts of a shared buffer reuse its sg table */
+		sgt = xocl_bo_range_sgt_get(import_xobj, import_offset, cp_size);
+		cached_sgt = (sgt != NULL);
+		if (!cached_sgt) {
+			tmp_sgt = alloc_onetime_sg_table(import_xobj->pages,
+				import_offset, cp_size);
+			if (IS_ERR(tmp_sgt)) {
+				DRM_ERROR("failed to alloc tmp sgt, copy_bo aborted");
+				ret = PTR_ERR(tmp_sgt);
+				tmp_sgt = NULL;
+				goto out;
+			}
+			sgt = tmp_sgt;
 		}
-		sgt = tmp_sgt;
 	} else {
 		sgt = import_xobj->sgt;
 	}
@@ -920,12 +1985,22 @@ int xocl_copy_import_bo(struct drm_device *dev, struct drm_file *filp,
 	}
 
 	/* Now perform the copy via DMA engine */
+	start = ktime_get();
 	ret = xocl_migrate_bo(xdev, sgt, dir, local_pa, channel, cp_size);
 	if (ret >= 0)
 		ret = (ret == cp_size) ? 0 : -EIO;
 	xocl_release_channel(xdev, dir, channel);
 
+	if (!ret) {
+		atomic64_add(cp_size, &xdev->p2p_copy_bytes[dir]);
+		atomic64_add(ktime_us_delta(ktime_get(), start),
+			&xdev->p2p_copy_usecs[dir]);
+		atomic64_inc(&xdev->p2p_copy_cnt[dir]);
+	}
+
 out:
+	if (cached_sgt)
+		xocl_bo_range_sgt_put(import_xobj);
 	if (tmp_sgt) {
 		sg_free_table(tmp_sgt);
 		kfree(tmp_sgt);
@@ -947,6 +2022,44 @@ struct sg_table *xocl_gem_prime_get_sg_table(struct drm_gem_object *obj)
 	return drm_prime_pages_to_sg(xobj->pages, xobj->base.size >> PAGE_SHIFT);
 }
 
+/*
+ * Import cache
+ *
+ * The drm core reuses the handle when a client imports the same dma-buf
+ * twice, but every other client importing it, e.g. the consumer of a
+ * buffer handed back and forth between processes, attaches and maps the
+ * dma-buf again.  A dma-buf of another device is attached once per
+ * device instead, and all clients share the imported BO while any of
+ * them holds it.  The cache does not hold a reference, the BO leaves the
+ * cache when it is freed.  dma-bufs exported by this device are resolved
+ * to their BO by drm_gem_prime_import() and are never cached.
+ */
+struct drm_gem_object *xocl_gem_prime_import(struct drm_device *dev,
+	struct dma_buf *dma_buf)
+{
+	struct xocl_drm *drm_p = dev->dev_private;
+	struct drm_gem_object *obj;
+	struct drm_xocl_bo *xobj;
+
+	mutex_lock(&drm_p->import_lock);
+	list_for_each_entry(xobj, &drm_p->imports, import_link) {
+		if (xobj->base.import_attach->dmabuf != dma_buf)
+			continue;
+		/* Skip a BO whose last reference is being dropped */
+		if (kref_get_unless_zero(&xobj->base.refcount)) {
+			mutex_unlock(&drm_p->import_lock);
+			BO_DEBUG("reuse imported xobj %p", xobj);
+			return &xobj->base;
+		}
+	}
+
+	obj = drm_gem_prime_import(dev, dma_buf);
+	if (!IS_ERR(obj) && obj->import_attach)
+		list_add(&to_xocl_bo(obj)->import_link, &drm_p->imports);
+	mutex_unlock(&drm_p->import_lock);
+	return obj;
+}
+
 struct drm_gem_object *xocl_gem_prime_import_sg_table(struct drm_device *dev,
 	struct dma_buf_attachment *attach, struct sg_table *sgt)
 {
@@ -1130,7 +2243,8 @@ int xocl_pwrite_unmgd_ioctl(struct drm_device *dev, void *data,
 		 */
 	}
 
-	ret = xocl_migrate_unmgd(xdev, args->data_ptr, args->paddr, args->size, 1);
+	ret = xocl_migrate_unmgd(xdev, args->data_ptr, args->paddr, args->size, 1,
+		args->flags);
 
 	return ret;
 }
@@ -1161,7 +2275,8 @@ int xocl_pread_unmgd_ioctl(struct drm_device *dev, void *data,
 		 */
 	}
 
-	ret = xocl_migrate_unmgd(xdev, args->data_ptr, args->paddr, args->size, 0);
+	ret = xocl_migrate_unmgd(xdev, args->data_ptr, args->paddr, args->size, 0,
+		args->flags);
 
 	return ret;
 }
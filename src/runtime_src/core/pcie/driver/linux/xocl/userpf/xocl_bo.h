@@ -51,6 +51,9 @@
  */
 #define XOCL_BO_ARE  (1 << 26)
 
+/* User flags that tune how a BO is backed but do not change its type */
+#define XOCL_BO_USER_HINTS (XCL_BO_FLAGS_PREBUILT | XCL_BO_FLAGS_HUGEPAGE)
+
 static inline bool xocl_bo_userptr(const struct drm_xocl_bo *bo)
 {
 	return (bo->flags == XOCL_BO_USERPTR);
@@ -99,7 +102,8 @@ static inline unsigned xocl_bo_ddr_idx(unsigned user_flags)
 
 static inline unsigned xocl_bo_type(unsigned user_flags)
 {
-	unsigned type = (user_flags & ~XRT_BO_FLAGS_MEMIDX_MASK);
+	unsigned type = (user_flags & ~XRT_BO_FLAGS_MEMIDX_MASK &
+		~XOCL_BO_USER_HINTS);
 	unsigned bo_type = 0;
 
 	switch (type) {
@@ -134,6 +138,10 @@ int xocl_userptr_bo_ioctl(struct drm_device *dev, void *data,
 	struct drm_file *filp);
 int xocl_sync_bo_ioctl(struct drm_device *dev, void *data,
 	struct drm_file *filp);
+int xocl_sync_bo_async_ioctl(struct drm_device *dev, void *data,
+	struct drm_file *filp);
+int xocl_sync_bo_wait_ioctl(struct drm_device *dev, void *data,
+	struct drm_file *filp);
 int xocl_map_bo_ioctl(struct drm_device *dev, void *data,
 	struct drm_file *filp);
 int xocl_info_bo_ioctl(struct drm_device *dev, void *data,
@@ -142,6 +150,10 @@ int xocl_pwrite_bo_ioctl(struct drm_device *dev, void *data,
 	struct drm_file *filp);
 int xocl_pread_bo_ioctl(struct drm_device *dev, void *data,
 	struct drm_file *filp);
+int xocl_pwrite_bo_v_ioctl(struct drm_device *dev, void *data,
+	struct drm_file *filp);
+int xocl_pread_bo_v_ioctl(struct drm_device *dev, void *data,
+	struct drm_file *filp);
 int xocl_ctx_ioctl(struct drm_device *dev, void *data,
 	struct drm_file *filp);
 int xocl_pwrite_unmgd_ioctl(struct drm_device *dev, void *data,
@@ -152,6 +164,8 @@ int xocl_usage_stat_ioctl(struct drm_device *dev, void *data,
 	struct drm_file *filp);
 
 struct sg_table *xocl_gem_prime_get_sg_table(struct drm_gem_object *obj);
+struct drm_gem_object *xocl_gem_prime_import(struct drm_device *dev,
+	struct dma_buf *dma_buf);
 struct drm_gem_object *xocl_gem_prime_import_sg_table(struct drm_device *dev,
 	struct dma_buf_attachment *attach, struct sg_table *sgt);
 void *xocl_gem_prime_vmap(struct drm_gem_object *obj);
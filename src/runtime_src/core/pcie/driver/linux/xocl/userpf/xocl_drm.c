@@ -27,6 +27,7 @@
 #include "common.h"
 #if RHEL_P2P_SUPPORT
 #include <linux/pfn_t.h>
+#include <linux/vmalloc.h>
 #endif
 
 #if defined(__PPC64__)
@@ -92,6 +93,44 @@ static int xocl_release(struct inode *inode, struct file *filp)
 	return ret;
 }
 
+static bool bo_mmap_prefault;
+module_param(bo_mmap_prefault, bool, (S_IRUGO|S_IWUSR));
+MODULE_PARM_DESC(bo_mmap_prefault,
+	"Map all pages of a BO at mmap time instead of on fault (default false)");
+
+static int xocl_gem_insert_page(struct vm_area_struct *vma,
+	struct drm_xocl_bo *xobj, unsigned long addr, unsigned int page_offset)
+{
+#if RHEL_P2P_SUPPORT
+	pfn_t pfn;
+
+	if (xocl_bo_p2p(xobj)) {
+		pfn = phys_to_pfn_t(page_to_phys(xobj->pages[page_offset]),
+			PFN_MAP|PFN_DEV);
+		return vm_insert_mixed(vma, addr, pfn);
+	}
+#endif
+	return vm_insert_page(vma, addr, xobj->pages[page_offset]);
+}
+
+static int xocl_bo_prefault(struct vm_area_struct *vma,
+	struct drm_xocl_bo *xobj)
+{
+	loff_t num_pages = DIV_ROUND_UP(xobj->base.size, PAGE_SIZE);
+	unsigned long end = min(vma->vm_end,
+		vma->vm_start + ((unsigned long)num_pages << PAGE_SHIFT));
+	unsigned long va;
+	int ret;
+
+	for (va = vma->vm_start; va < end; va += PAGE_SIZE) {
+		ret = xocl_gem_insert_page(vma, xobj, va,
+			(va - vma->vm_start) >> PAGE_SHIFT);
+		if (ret && ret != -EBUSY)
+			return ret;
+	}
+	return 0;
+}
+
 static int xocl_bo_mmap(struct file *filp, struct vm_area_struct *vma)
 {
 	int ret;
@@ -132,6 +171,14 @@ static int xocl_bo_mmap(struct file *filp, struct vm_area_struct *vma)
 	else
 		vma->vm_page_prot = pgprot_writecombine(
 			vm_get_page_prot(vma->vm_flags));
+
+	/*
+	 * Failing to prefault is not fatal, the remaining pages are mapped
+	 * by xocl_gem_fault() when touched.
+	 */
+	if (bo_mmap_prefault && xocl_bo_prefault(vma, xobj))
+		DRM_DBG("prefault of BO %p stopped early", xobj);
+
 	return ret;
 }
 
@@ -197,6 +244,68 @@ static int xocl_native_mmap(struct file *filp, struct vm_area_struct *vma)
 	return ret;
 }
 
+/*
+ * Map the client completion ring, the ring is allocated on first mmap
+ * and freed when the client is destroyed.
+ */
+static int xocl_completion_ring_mmap(struct file *filp,
+	struct vm_area_struct *vma)
+{
+	struct drm_file *priv = filp->private_data;
+	struct client_ctx *client = priv->driver_priv;
+	struct xocl_completion_ring *ring;
+	unsigned long vsize = vma->vm_end - vma->vm_start;
+	unsigned long flags;
+
+	if (!client)
+		return -EINVAL;
+
+	if (vsize > PAGE_ALIGN(sizeof(*ring)))
+		return -EINVAL;
+
+	mutex_lock(&client->done_read_lock);
+	ring = client->ring;
+	if (!ring) {
+		ring = vmalloc_user(PAGE_ALIGN(sizeof(*ring)));
+		if (!ring) {
+			mutex_unlock(&client->done_read_lock);
+			return -ENOMEM;
+		}
+		ring->size = XOCL_COMPLETION_RING_ENTRIES;
+		spin_lock_irqsave(&client->done_lock, flags);
+		client->ring_head = 0;
+		client->ring = ring;
+		spin_unlock_irqrestore(&client->done_lock, flags);
+	}
+	mutex_unlock(&client->done_read_lock);
+
+	return remap_vmalloc_range(vma, ring, 0);
+}
+
+/*
+ * Map the device usage page read only, the page lives as long as the
+ * device and is shared by all clients.
+ */
+static int xocl_usage_page_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	struct drm_file *priv = filp->private_data;
+	struct xocl_drm *drm_p = priv->minor->dev->dev_private;
+	struct xocl_usage_page *up = XDEV(drm_p->xdev)->usage;
+	unsigned long vsize = vma->vm_end - vma->vm_start;
+
+	if (!up)
+		return -ENODEV;
+
+	if (vsize > PAGE_ALIGN(sizeof(*up)))
+		return -EINVAL;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+	return remap_vmalloc_range(vma, up, 0);
+}
+
 static int xocl_mmap(struct file *filp, struct vm_area_struct *vma)
 {
 	/*
@@ -206,6 +315,12 @@ static int xocl_mmap(struct file *filp, struct vm_area_struct *vma)
 	if (likely(vma->vm_pgoff >= XOCL_FILE_PAGE_OFFSET))
 		return xocl_bo_mmap(filp, vma);
 
+	if (vma->vm_pgoff == XOCL_COMPLETION_RING_PGOFF)
+		return xocl_completion_ring_mmap(filp, vma);
+
+	if (vma->vm_pgoff == XOCL_USAGE_PAGE_PGOFF)
+		return xocl_usage_page_mmap(filp, vma);
+
 	/*
 	 * Native BAR or CU mmap handling.
 	 * When pgoff is 0, we perform mmap of the PCIE BAR.
@@ -215,6 +330,38 @@ static int xocl_mmap(struct file *filp, struct vm_area_struct *vma)
 	return xocl_native_mmap(filp, vma);
 }
 
+/*
+ * Map the PMD sized (2MB) window around the faulting address in one go,
+ * clipped to the VMA and the BO. A CPU walking a large BO then takes
+ * one fault per 2MB instead of one per page. Pages already mapped in
+ * the window are skipped.
+ */
+static int xocl_gem_fault_around(struct vm_area_struct *vma,
+	struct drm_xocl_bo *xobj, unsigned long addr, loff_t num_pages)
+{
+	unsigned long start = max(addr & PMD_MASK, vma->vm_start);
+	unsigned long end = min3((addr & PMD_MASK) + PMD_SIZE, vma->vm_end,
+		vma->vm_start + ((unsigned long)num_pages << PAGE_SHIFT));
+	unsigned long va;
+	int ret;
+
+	/* The faulting page decides the outcome */
+	ret = xocl_gem_insert_page(vma, xobj, addr,
+		(addr - vma->vm_start) >> PAGE_SHIFT);
+	if (ret && ret != -EBUSY)
+		return ret;
+
+	for (va = start; va < end; va += PAGE_SIZE) {
+		if (va == addr)
+			continue;
+		ret = xocl_gem_insert_page(vma, xobj, va,
+			(va - vma->vm_start) >> PAGE_SHIFT);
+		if (ret && ret != -EBUSY)
+			break;
+	}
+	return 0;
+}
+
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 13, 0)
 int xocl_gem_fault(struct vm_fault *vmf)
 {
@@ -227,15 +374,13 @@ int xocl_gem_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
 	loff_t num_pages;
 	unsigned int page_offset;
 	int ret = 0;
-#if RHEL_P2P_SUPPORT
-	pfn_t pfn;
-#endif
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 10, 0)
 	unsigned long vmf_address = vmf->address;
 #else
 	unsigned long vmf_address = (unsigned long)vmf->virtual_address;
 #endif
+	vmf_address &= PAGE_MASK;
 	page_offset = (vmf_address - vma->vm_start) >> PAGE_SHIFT;
 
 
@@ -243,23 +388,15 @@ int xocl_gem_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
 		return VM_FAULT_SIGBUS;
 
 	num_pages = DIV_ROUND_UP(xobj->base.size, PAGE_SIZE);
-	if (page_offset > num_pages)
+	if (page_offset >= num_pages)
 		return VM_FAULT_SIGBUS;
 
-	if (xocl_bo_p2p(xobj)) {
-#if RHEL_P2P_SUPPORT
-		pfn = phys_to_pfn_t(page_to_phys(xobj->pages[page_offset]), PFN_MAP|PFN_DEV);
-		ret = vm_insert_mixed(vma, vmf_address, pfn);
-#else
-		ret = vm_insert_page(vma, vmf_address, xobj->pages[page_offset]);
-#endif
-	} else {
-		ret = vm_insert_page(vma, vmf_address, xobj->pages[page_offset]);
-	}
+	ret = xocl_gem_fault_around(vma, xobj, vmf_address, num_pages);
 	switch (ret) {
 	case -EAGAIN:
 	case 0:
 	case -ERESTARTSYS:
+	case -EBUSY:
 		return VM_FAULT_NOPAGE;
 	case -ENOMEM:
 		return VM_FAULT_OOM;
@@ -295,6 +432,8 @@ static void xocl_client_release(struct drm_device *dev, struct drm_file *filp)
 {
 	struct xocl_drm	*drm_p = dev->dev_private;
 
+	xocl_sync_bo_release(drm_p, filp);
+	xocl_userptr_cache_release(filp);
 	xocl_exec_destroy_client(drm_p->xdev, &filp->driver_priv);
 }
 
@@ -345,6 +484,20 @@ static const struct drm_ioctl_desc xocl_ioctls[] = {
 			  DRM_AUTH|DRM_UNLOCKED|DRM_RENDER_ALLOW),
 	DRM_IOCTL_DEF_DRV(XOCL_RECLOCK, xocl_reclock_ioctl,
 			  DRM_AUTH|DRM_UNLOCKED|DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(XOCL_EXECBUF_DONE, xocl_execbuf_done_ioctl,
+			  DRM_AUTH|DRM_UNLOCKED|DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(XOCL_SYNC_BO_ASYNC, xocl_sync_bo_async_ioctl,
+			  DRM_AUTH|DRM_UNLOCKED|DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(XOCL_SYNC_BO_WAIT, xocl_sync_bo_wait_ioctl,
+			  DRM_AUTH|DRM_UNLOCKED|DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(XOCL_PWRITE_BO_V, xocl_pwrite_bo_v_ioctl,
+			  DRM_AUTH|DRM_UNLOCKED|DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(XOCL_PREAD_BO_V, xocl_pread_bo_v_ioctl,
+			  DRM_AUTH|DRM_UNLOCKED|DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(XOCL_EXECBUF_BATCH, xocl_execbuf_batch_ioctl,
+			  DRM_AUTH|DRM_UNLOCKED|DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(XOCL_RESET_CU, xocl_reset_cu_ioctl,
+			  DRM_AUTH|DRM_UNLOCKED|DRM_RENDER_ALLOW),
 };
 
 static long xocl_drm_ioctl(struct file *filp,
@@ -369,6 +522,13 @@ static const struct vm_operations_struct xocl_vm_ops = {
 	.close = drm_gem_vm_close,
 };
 
+struct drm_xocl_bo *xocl_drm_vma_bo(struct vm_area_struct *vma)
+{
+	if (vma->vm_ops != &xocl_vm_ops || !vma->vm_private_data)
+		return NULL;
+	return to_xocl_bo(vma->vm_private_data);
+}
+
 static struct drm_driver mm_drm_driver = {
 	.driver_features		= DRIVER_GEM | DRIVER_PRIME |
 						DRIVER_RENDER,
@@ -391,7 +551,7 @@ static struct drm_driver mm_drm_driver = {
 
 	.prime_handle_to_fd		= drm_gem_prime_handle_to_fd,
 	.prime_fd_to_handle		= drm_gem_prime_fd_to_handle,
-	.gem_prime_import		= drm_gem_prime_import,
+	.gem_prime_import		= xocl_gem_prime_import,
 	.gem_prime_export		= drm_gem_prime_export,
 #if ((LINUX_VERSION_CODE >= KERNEL_VERSION(3, 18, 0)) && (LINUX_VERSION_CODE < KERNEL_VERSION(4, 14, 0)))
 	.set_busid			= drm_pci_set_busid,
@@ -432,6 +592,18 @@ void *xocl_drm_init(xdev_handle_t xdev_hdl)
 	}
 	drm_p->xdev = xdev_hdl;
 
+	drm_p->sync_wq = alloc_workqueue("xocl_sync", WQ_UNBOUND, 0);
+	if (!drm_p->sync_wq) {
+		xocl_xdev_err(xdev_hdl, "alloc sync workqueue failed");
+		ret = -ENOMEM;
+		goto failed;
+	}
+	idr_init(&drm_p->sync_fences);
+	spin_lock_init(&drm_p->sync_lock);
+	init_waitqueue_head(&drm_p->sync_done);
+	mutex_init(&drm_p->import_lock);
+	INIT_LIST_HEAD(&drm_p->imports);
+
 	ddev->pdev = XDEV(xdev_hdl)->pdev;
 
 	ret = drm_dev_register(ddev, 0);
@@ -451,7 +623,7 @@ void *xocl_drm_init(xdev_handle_t xdev_hdl)
 	}
 #endif
 
-	mutex_init(&drm_p->mm_lock);
+	init_rwsem(&drm_p->mm_lock);
 	ddev->dev_private = drm_p;
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(3, 7, 0)
 	hash_init(drm_p->mm_range);
@@ -465,6 +637,8 @@ failed:
 		drm_dev_unregister(ddev);
 	if (ddev)
 		XOCL_DRM_DEV_PUT(ddev);
+	if (drm_p && drm_p->sync_wq)
+		destroy_workqueue(drm_p->sync_wq);
 	if (drm_p)
 		xocl_drvinst_free(drm_p);
 
@@ -475,7 +649,9 @@ void xocl_drm_fini(struct xocl_drm *drm_p)
 {
 	xocl_cleanup_mem(drm_p);
 	drm_put_dev(drm_p->ddev);
-	mutex_destroy(&drm_p->mm_lock);
+	destroy_workqueue(drm_p->sync_wq);
+	idr_destroy(&drm_p->sync_fences);
+	mutex_destroy(&drm_p->import_lock);
 
 	xocl_drvinst_free(drm_p);
 }
@@ -483,12 +659,15 @@ void xocl_drm_fini(struct xocl_drm *drm_p)
 void xocl_mm_get_usage_stat(struct xocl_drm *drm_p, u32 ddr,
 	struct drm_xocl_mm_stat *pstat)
 {
-	pstat->memory_usage = drm_p->mm_usage_stat[ddr] ?
+	down_read(&drm_p->mm_lock);
+	pstat->memory_usage = (drm_p->mm_usage_stat && drm_p->mm_usage_stat[ddr]) ?
 		drm_p->mm_usage_stat[ddr]->memory_usage : 0;
-	pstat->bo_count = drm_p->mm_usage_stat[ddr] ?
+	pstat->bo_count = (drm_p->mm_usage_stat && drm_p->mm_usage_stat[ddr]) ?
 		drm_p->mm_usage_stat[ddr]->bo_count : 0;
+	up_read(&drm_p->mm_lock);
 }
 
+/* Caller holds mm_lock for read and the bank lock */
 void xocl_mm_update_usage_stat(struct xocl_drm *drm_p, u32 ddr,
 	u64 size, int count)
 {
@@ -496,14 +675,22 @@ void xocl_mm_update_usage_stat(struct xocl_drm *drm_p, u32 ddr,
 
 	drm_p->mm_usage_stat[ddr]->memory_usage += (count > 0) ? size : -size;
 	drm_p->mm_usage_stat[ddr]->bo_count += count;
+
+	if (ddr < XOCL_USAGE_MAX_BANKS) {
+		xocl_usage_set(drm_p->xdev, mm[ddr].memory_usage,
+			drm_p->mm_usage_stat[ddr]->memory_usage);
+		xocl_usage_set(drm_p->xdev, mm[ddr].bo_count,
+			drm_p->mm_usage_stat[ddr]->bo_count);
+	}
 }
 
+/* Caller holds mm_lock for read and the bank lock */
 int xocl_mm_insert_node(struct xocl_drm *drm_p, u32 ddr,
 			struct drm_mm_node *node, u64 size)
 {
-	BUG_ON(!mutex_is_locked(&drm_p->mm_lock));
 	if (drm_p->mm == NULL || drm_p->mm[ddr] == NULL)
 		return -EINVAL;
+	BUG_ON(!mutex_is_locked(drm_p->mm_bank_lock[ddr]));
 
 	return drm_mm_insert_node_generic(drm_p->mm[ddr], node, size, PAGE_SIZE,
 #if defined(XOCL_DRM_FREE_MALLOC)
@@ -513,6 +700,38 @@ int xocl_mm_insert_node(struct xocl_drm *drm_p, u32 ddr,
 #endif
 }
 
+/*
+ * Free space of a bank: total free bytes, the largest free range and the
+ * number of free ranges. A large free total with a small largest range
+ * means allocations fail due to fragmentation rather than usage.
+ */
+void xocl_mm_get_frag_stat(struct xocl_drm *drm_p, u32 ddr,
+	u64 *free, u64 *largest, u32 *holes)
+{
+	struct drm_mm_node *entry;
+	u64 hole_start, hole_end;
+
+	*free = 0;
+	*largest = 0;
+	*holes = 0;
+
+	down_read(&drm_p->mm_lock);
+	if (drm_p->mm == NULL || drm_p->mm[ddr] == NULL)
+		goto done;
+
+	mutex_lock(drm_p->mm_bank_lock[ddr]);
+	drm_mm_for_each_hole(entry, drm_p->mm[ddr], hole_start, hole_end) {
+		u64 size = hole_end - hole_start;
+
+		*free += size;
+		*largest = max(*largest, size);
+		(*holes)++;
+	}
+	mutex_unlock(drm_p->mm_bank_lock[ddr]);
+done:
+	up_read(&drm_p->mm_lock);
+}
+
 static int xocl_check_topology(struct xocl_drm *drm_p)
 {
 	struct mem_topology    *topology;
@@ -574,11 +793,11 @@ int xocl_cleanup_mem(struct xocl_drm *drm_p)
 	struct hlist_node *tmp;
 #endif
 
-	mutex_lock(&drm_p->mm_lock);
+	down_write(&drm_p->mm_lock);
 
 	err = xocl_check_topology(drm_p);
 	if (err) {
-		mutex_unlock(&drm_p->mm_lock);
+		up_write(&drm_p->mm_lock);
 		return err;
 	}
 
@@ -600,6 +819,7 @@ int xocl_cleanup_mem(struct xocl_drm *drm_p)
 				if (wrapper->ddr != i)
 					continue;
 				hash_del(&wrapper->node);
+				mutex_destroy(&wrapper->lock);
 				vfree(wrapper);
 				drm_mm_takedown(drm_p->mm[i]);
 				vfree(drm_p->mm[i]);
@@ -614,10 +834,17 @@ int xocl_cleanup_mem(struct xocl_drm *drm_p)
 	drm_p->mm = NULL;
 	vfree(drm_p->mm_usage_stat);
 	drm_p->mm_usage_stat = NULL;
+	vfree(drm_p->mm_bank_lock);
+	drm_p->mm_bank_lock = NULL;
 	vfree(drm_p->mm_p2p_off);
 	drm_p->mm_p2p_off = NULL;
 
-	mutex_unlock(&drm_p->mm_lock);
+	xocl_usage_set(drm_p->xdev, mm_channel_count, 0);
+	if (XDEV(drm_p->xdev)->usage)
+		memset(XDEV(drm_p->xdev)->usage->mm, 0,
+			sizeof(XDEV(drm_p->xdev)->usage->mm));
+
+	up_write(&drm_p->mm_lock);
 
 	return 0;
 }
@@ -658,12 +885,14 @@ int xocl_init_mem(struct xocl_drm *drm_p)
 	xocl_info(drm_p->ddev->dev, "Topology count = %d, data_length = %ld",
 		topo->m_count, length);
 
-	mutex_lock(&drm_p->mm_lock);
+	down_write(&drm_p->mm_lock);
 
 	drm_p->mm = vzalloc(size);
 	drm_p->mm_usage_stat = vzalloc(size);
+	drm_p->mm_bank_lock = vzalloc(size);
 	drm_p->mm_p2p_off = vzalloc(topo->m_count * sizeof(u64));
-	if (!drm_p->mm || !drm_p->mm_usage_stat || !drm_p->mm_p2p_off) {
+	if (!drm_p->mm || !drm_p->mm_usage_stat || !drm_p->mm_bank_lock ||
+		!drm_p->mm_p2p_off) {
 		err = -ENOMEM;
 		goto failed;
 	}
@@ -708,6 +937,7 @@ int xocl_init_mem(struct xocl_drm *drm_p)
 			xocl_info(drm_p->ddev->dev, "Found duplicated memory region!");
 			drm_p->mm[i] = drm_p->mm[shared];
 			drm_p->mm_usage_stat[i] = drm_p->mm_usage_stat[shared];
+			drm_p->mm_bank_lock[i] = drm_p->mm_bank_lock[shared];
 			continue;
 		}
 
@@ -726,6 +956,8 @@ int xocl_init_mem(struct xocl_drm *drm_p)
 		wrapper->mm = drm_p->mm[i];
 		wrapper->mm_usage_stat = drm_p->mm_usage_stat[i];
 		wrapper->ddr = i;
+		mutex_init(&wrapper->lock);
+		drm_p->mm_bank_lock[i] = &wrapper->lock;
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(3, 7, 0)
 		hash_add(drm_p->mm_range, &wrapper->node, wrapper->start_addr);
 #endif
@@ -737,7 +969,10 @@ int xocl_init_mem(struct xocl_drm *drm_p)
 		xocl_info(drm_p->ddev->dev, "drm_mm_init called");
 	}
 
-	mutex_unlock(&drm_p->mm_lock);
+	xocl_usage_set(drm_p->xdev, mm_channel_count,
+		min_t(u32, topo->m_count, XOCL_USAGE_MAX_BANKS));
+
+	up_write(&drm_p->mm_lock);
 	return 0;
 
 failed:
@@ -753,9 +988,11 @@ failed:
 	}
 	vfree(drm_p->mm_usage_stat);
 	drm_p->mm_usage_stat = NULL;
+	vfree(drm_p->mm_bank_lock);
+	drm_p->mm_bank_lock = NULL;
 	vfree(drm_p->mm_p2p_off);
 	drm_p->mm_p2p_off = NULL;
 
-	mutex_unlock(&drm_p->mm_lock);
+	up_write(&drm_p->mm_lock);
 	return err;
 }
@@ -23,6 +23,9 @@
 #include "../xocl_drv.h"
 #include "common.h"
 #include "version.h"
+
+#define CREATE_TRACE_POINTS
+#include "../xocl_trace.h"
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 5, 0) || RHEL_P2P_SUPPORT
 #include <linux/memremap.h>
 #endif
@@ -861,6 +864,7 @@ static void unmap_bar(struct xocl_dev *xdev)
 void xocl_userpf_remove(struct pci_dev *pdev)
 {
 	struct xocl_dev		*xdev;
+	struct xocl_usage_page	*usage;
 
 	xdev = pci_get_drvdata(pdev);
 	if (!xdev) {
@@ -891,8 +895,11 @@ void xocl_userpf_remove(struct pci_dev *pdev)
 	mutex_destroy(&xdev->core.lock);
 	mutex_destroy(&xdev->dev_lock);
 
+	usage = xdev->core.usage;
 	pci_set_drvdata(pdev, NULL);
 	xocl_drvinst_free(xdev);
+	/* may still be mapped until the last client is gone */
+	vfree(usage);
 }
 
 /* pci driver callbacks */
@@ -923,6 +930,11 @@ int xocl_userpf_probe(struct pci_dev *pdev,
 	mutex_init(&xdev->dev_lock);
 	atomic64_set(&xdev->total_execs, 0);
 	atomic_set(&xdev->outstanding_execs, 0);
+	for (i = 0; i < ARRAY_SIZE(xdev->p2p_copy_cnt); i++) {
+		atomic64_set(&xdev->p2p_copy_bytes[i], 0);
+		atomic64_set(&xdev->p2p_copy_usecs[i], 0);
+		atomic64_set(&xdev->p2p_copy_cnt[i], 0);
+	}
 	INIT_LIST_HEAD(&xdev->ctx_list);
 
 	for (i = XOCL_WORK_RESET; i < XOCL_WORK_NUM; i++) {
@@ -936,6 +948,14 @@ int xocl_userpf_probe(struct pci_dev *pdev,
 		goto failed;
 	}
 
+	/* Allocated ahead of subdevs, they publish counters into it */
+	xdev->core.usage = vmalloc_user(PAGE_ALIGN(sizeof(*xdev->core.usage)));
+	if (!xdev->core.usage) {
+		xocl_err(&pdev->dev, "failed to alloc usage page");
+		ret = -ENOMEM;
+		goto failed;
+	}
+
 	ret = xocl_alloc_dev_minor(xdev);
 	if (ret)
 		goto failed;
@@ -1055,6 +1075,10 @@ static struct pci_driver userpf_driver = {
 	.probe = xocl_userpf_probe,
 	.remove = xocl_userpf_remove,
 	.err_handler = &xocl_err_handler,
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 2, 0)
+	/* Cards are independent; let several of them probe concurrently. */
+	.driver.probe_type = PROBE_PREFER_ASYNCHRONOUS,
+#endif
 };
 
 /* INIT */
@@ -1071,6 +1095,7 @@ static int (*xocl_drv_reg_funcs[])(void) __initdata = {
 	xocl_init_firewall,
 	xocl_init_mig,
 	xocl_init_dna,
+	xocl_init_peer_mem,
 };
 
 static void (*xocl_drv_unreg_funcs[])(void) = {
@@ -1086,6 +1111,7 @@ static void (*xocl_drv_unreg_funcs[])(void) = {
 	xocl_fini_firewall,
 	xocl_fini_mig,
 	xocl_fini_dna,
+	xocl_fini_peer_mem,
 };
 
 static int __init xocl_init(void)
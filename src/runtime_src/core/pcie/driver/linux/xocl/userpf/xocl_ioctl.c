@@ -68,6 +68,42 @@ int xocl_execbuf_ioctl(struct drm_device *dev,
 	return ret;
 }
 
+int xocl_execbuf_done_ioctl(struct drm_device *dev,
+	void *data, struct drm_file *filp)
+{
+	struct xocl_drm *drm_p = dev->dev_private;
+	int ret = 0;
+
+	ret = xocl_exec_client_ioctl(drm_p->xdev,
+		       DRM_XOCL_EXECBUF_DONE, data, filp);
+
+	return ret;
+}
+
+int xocl_execbuf_batch_ioctl(struct drm_device *dev,
+	void *data, struct drm_file *filp)
+{
+	struct xocl_drm *drm_p = dev->dev_private;
+	int ret = 0;
+
+	ret = xocl_exec_client_ioctl(drm_p->xdev,
+		       DRM_XOCL_EXECBUF_BATCH, data, filp);
+
+	return ret;
+}
+
+int xocl_reset_cu_ioctl(struct drm_device *dev,
+	void *data, struct drm_file *filp)
+{
+	struct xocl_drm *drm_p = dev->dev_private;
+	int ret = 0;
+
+	ret = xocl_exec_client_ioctl(drm_p->xdev,
+		       DRM_XOCL_RESET_CU, data, filp);
+
+	return ret;
+}
+
 /*
  * Create a context (only shared supported today) on a CU. Take a lock on xclbin if
  * it has not been acquired before. Shared the same lock for all context requests
@@ -311,19 +347,35 @@ xocl_read_axlf_helper(struct xocl_drm *drm_p, struct drm_xocl_axlf *axlf_ptr)
 		goto done;
 	}
 
-	/* Copy from user space and proceed. */
-	axlf = vmalloc(bin_obj.m_header.m_length);
-	if (!axlf) {
-		DRM_ERROR("Unable to create axlf\n");
-		err = -ENOMEM;
-		goto done;
-	}
+	if (bin_obj.m_header.m_numSections == 0 &&
+		bin_obj.m_header.m_length == sizeof(struct axlf)) {
+		/*
+		 * Header only, the xclbin is named by UUID. Use the copy kept
+		 * by icap from an earlier download.
+		 */
+		axlf = xocl_icap_get_cached_axlf(xdev, &bin_obj.m_header.uuid);
+		if (!axlf) {
+			userpf_err(xdev, "xclbin %pUb is not cached",
+				&bin_obj.m_header.uuid);
+			err = -ENOENT;
+			goto done;
+		}
+	} else {
+		/* Copy from user space and proceed. */
+		axlf = vmalloc(bin_obj.m_header.m_length);
+		if (!axlf) {
+			DRM_ERROR("Unable to create axlf\n");
+			err = -ENOMEM;
+			goto done;
+		}
 
-	printk(KERN_INFO "XOCL: Marker 5\n");
+		printk(KERN_INFO "XOCL: Marker 5\n");
 
-	if (copy_from_user(axlf, axlf_ptr->xclbin, bin_obj.m_header.m_length)) {
-		err = -EFAULT;
-		goto done;
+		if (copy_from_user(axlf, axlf_ptr->xclbin,
+			bin_obj.m_header.m_length)) {
+			err = -EFAULT;
+			goto done;
+		}
 	}
 
 	/* Populating MEM_TOPOLOGY sections. */
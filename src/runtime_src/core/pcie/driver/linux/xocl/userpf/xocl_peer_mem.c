@@ -0,0 +1,258 @@
+/*
+ * Copyright (C) 2019 Xilinx, Inc. All rights reserved.
+ *
+ * RDMA peer memory client for P2P BOs
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "common.h"
+
+/*
+ * With the peer memory API of MLNX_OFED, RDMA NICs register memory
+ * regions backed by another PCIe device.  A process that mmaps a P2P
+ * BO can register the mapping as a memory region, the NIC then reads
+ * and writes card memory through the P2P BAR, without staging through
+ * host memory.
+ *
+ * acquire() claims a range that lies in one mapping of a P2P BO and
+ * holds a reference on the BO until release(), so the BO and its BAR
+ * window stay valid while the region is registered.  No invalidation
+ * is needed.  The BO is contiguous in the BAR, the sg table has one
+ * entry per XOCL_PEER_MEM_SEG of the range.
+ *
+ * Built when the driver is compiled against MLNX_OFED (XOCL_PEER_MEM).
+ */
+#ifdef XOCL_PEER_MEM
+
+#include <rdma/peer_mem.h>
+
+#define XOCL_PEER_MEM_NAME	"xocl_p2p"
+#define XOCL_PEER_MEM_SEG	SZ_2M
+
+struct xocl_peer_ctx {
+	struct drm_xocl_bo	*xobj;
+	struct xocl_dev		*xdev;
+	u64			offset;	/* page aligned offset in BO */
+	u64			size;	/* page aligned size */
+	bool			mapped;
+};
+
+static void *peer_reg_handle;
+
+static struct drm_xocl_bo *xocl_peer_vma_bo(unsigned long addr, size_t size,
+	u64 *offset)
+{
+	struct vm_area_struct *vma;
+	struct drm_xocl_bo *xobj = NULL;
+
+	if (!current->mm)
+		return NULL;
+
+	down_read(&current->mm->mmap_sem);
+	vma = find_vma(current->mm, addr);
+	if (!vma || addr < vma->vm_start || addr + size > vma->vm_end)
+		goto out;
+
+	xobj = xocl_drm_vma_bo(vma);
+	if (!xobj || !xocl_bo_p2p(xobj) || !xobj->bar_vmapping ||
+	    !xobj->pages) {
+		xobj = NULL;
+		goto out;
+	}
+
+	/* BO mappings start at offset 0 of the BO */
+	*offset = addr - vma->vm_start;
+	XOCL_DRM_GEM_OBJECT_GET(&xobj->base);
+out:
+	up_read(&current->mm->mmap_sem);
+	return xobj;
+}
+
+static int xocl_peer_acquire(unsigned long addr, size_t size,
+	void *peer_mem_private_data, char *peer_mem_name, void **client_context)
+{
+	struct xocl_peer_ctx *ctx;
+	struct drm_xocl_bo *xobj;
+	struct xocl_drm *drm_p;
+	u64 offset = 0;
+
+	xobj = xocl_peer_vma_bo(addr, size, &offset);
+	if (!xobj)
+		return 0;
+
+	ctx = kzalloc(sizeof(*ctx), GFP_KERNEL);
+	if (!ctx) {
+		XOCL_DRM_GEM_OBJECT_PUT_UNLOCKED(&xobj->base);
+		return 0;
+	}
+
+	drm_p = xobj->base.dev->dev_private;
+	ctx->xobj = xobj;
+	ctx->xdev = drm_p->xdev;
+	ctx->offset = offset & PAGE_MASK;
+	ctx->size = PAGE_ALIGN(offset + size) - ctx->offset;
+	*client_context = ctx;
+
+	/* 1 claims the range for this client */
+	return 1;
+}
+
+static int xocl_peer_get_pages(unsigned long addr, size_t size, int write,
+	int force, struct sg_table *sg_head, void *client_context,
+	u64 core_context)
+{
+	struct xocl_peer_ctx *ctx = client_context;
+	struct scatterlist *sg;
+	u32 nents = DIV_ROUND_UP(ctx->size, XOCL_PEER_MEM_SEG);
+	u64 pos = ctx->offset;
+	int ret, i;
+
+	ret = sg_alloc_table(sg_head, nents, GFP_KERNEL);
+	if (ret)
+		return ret;
+
+	for_each_sg(sg_head->sgl, sg, nents, i) {
+		u32 len = min_t(u64, XOCL_PEER_MEM_SEG,
+			ctx->offset + ctx->size - pos);
+
+		sg_set_page(sg, ctx->xobj->pages[pos >> PAGE_SHIFT], len, 0);
+		pos += len;
+	}
+	return 0;
+}
+
+/* Physical address of the BO in the P2P BAR */
+static phys_addr_t xocl_peer_bar_phys(struct xocl_peer_ctx *ctx)
+{
+	struct xocl_dev *xdev = ctx->xdev;
+
+	return pci_resource_start(xdev->core.pdev, xdev->p2p_bar_idx) +
+		((char *)ctx->xobj->bar_vmapping - (char *)xdev->p2p_bar_addr);
+}
+
+static int xocl_peer_dma_map(struct sg_table *sg_head, void *client_context,
+	struct device *dma_device, int dmasync, int *nmap)
+{
+	struct xocl_peer_ctx *ctx = client_context;
+	phys_addr_t phys = xocl_peer_bar_phys(ctx) + ctx->offset;
+	struct scatterlist *sg;
+	int i;
+
+	for_each_sg(sg_head->sgl, sg, sg_head->nents, i) {
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 9, 0)
+		/* Maps the BAR range in the IOMMU domain of the NIC */
+		dma_addr_t addr = dma_map_resource(dma_device, phys, sg->length,
+			DMA_BIDIRECTIONAL, 0);
+
+		if (dma_mapping_error(dma_device, addr)) {
+			struct scatterlist *s;
+			int j;
+
+			for_each_sg(sg_head->sgl, s, i, j)
+				dma_unmap_resource(dma_device,
+					sg_dma_address(s), sg_dma_len(s),
+					DMA_BIDIRECTIONAL, 0);
+			return -ENOMEM;
+		}
+		sg_dma_address(sg) = addr;
+#else
+		/* No IOMMU translation, NIC and card must share the bus */
+		sg_dma_address(sg) = pci_bus_address(ctx->xdev->core.pdev,
+			ctx->xdev->p2p_bar_idx) +
+			(phys - pci_resource_start(ctx->xdev->core.pdev,
+			ctx->xdev->p2p_bar_idx));
+#endif
+		sg_dma_len(sg) = sg->length;
+		phys += sg->length;
+	}
+
+	ctx->mapped = true;
+	*nmap = sg_head->nents;
+	return 0;
+}
+
+static int xocl_peer_dma_unmap(struct sg_table *sg_head, void *client_context,
+	struct device *dma_device)
+{
+	struct xocl_peer_ctx *ctx = client_context;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 9, 0)
+	struct scatterlist *sg;
+	int i;
+
+	if (!ctx->mapped)
+		return 0;
+	for_each_sg(sg_head->sgl, sg, sg_head->nents, i)
+		dma_unmap_resource(dma_device, sg_dma_address(sg),
+			sg_dma_len(sg), DMA_BIDIRECTIONAL, 0);
+#endif
+	ctx->mapped = false;
+	return 0;
+}
+
+static void xocl_peer_put_pages(struct sg_table *sg_head, void *client_context)
+{
+	sg_free_table(sg_head);
+}
+
+static unsigned long xocl_peer_get_page_size(void *client_context)
+{
+	return PAGE_SIZE;
+}
+
+static void xocl_peer_release(void *client_context)
+{
+	struct xocl_peer_ctx *ctx = client_context;
+
+	XOCL_DRM_GEM_OBJECT_PUT_UNLOCKED(&ctx->xobj->base);
+	kfree(ctx);
+}
+
+static const struct peer_memory_client xocl_peer_client = {
+	.name			= XOCL_PEER_MEM_NAME,
+	.version		= XRT_DRIVER_VERSION,
+	.acquire		= xocl_peer_acquire,
+	.get_pages		= xocl_peer_get_pages,
+	.dma_map		= xocl_peer_dma_map,
+	.dma_unmap		= xocl_peer_dma_unmap,
+	.put_pages		= xocl_peer_put_pages,
+	.get_page_size		= xocl_peer_get_page_size,
+	.release		= xocl_peer_release,
+};
+
+int __init xocl_init_peer_mem(void)
+{
+	/* No invalidation callback, registered BOs are held by reference */
+	peer_reg_handle = ib_register_peer_memory_client(&xocl_peer_client,
+		NULL);
+	if (!peer_reg_handle)
+		pr_warn("xocl: RDMA peer memory client not registered\n");
+	return 0;
+}
+
+void xocl_fini_peer_mem(void)
+{
+	if (peer_reg_handle)
+		ib_unregister_peer_memory_client(peer_reg_handle);
+	peer_reg_handle = NULL;
+}
+
+#else
+
+int __init xocl_init_peer_mem(void)
+{
+	return 0;
+}
+
+void xocl_fini_peer_mem(void)
+{
+}
+
+#endif
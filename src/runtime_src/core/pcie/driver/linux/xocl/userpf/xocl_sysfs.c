@@ -147,6 +147,37 @@ static ssize_t memstat_raw_show(struct device *dev,
 }
 static DEVICE_ATTR_RO(memstat_raw);
 
+/* -free space fragmentation per bank: free KB, largest free range KB, holes */
+static ssize_t memfrag_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	struct xocl_dev *xdev = dev_get_drvdata(dev);
+	struct mem_topology *topo = NULL;
+	ssize_t size = 0;
+	u64 free, largest;
+	u32 holes;
+	int i;
+
+	mutex_lock(&xdev->dev_lock);
+
+	topo = XOCL_MEM_TOPOLOGY(xdev);
+	if (!topo) {
+		mutex_unlock(&xdev->dev_lock);
+		return -EINVAL;
+	}
+
+	for (i = 0; i < topo->m_count; i++) {
+		xocl_mm_get_frag_stat(XOCL_DRM(xdev), i, &free, &largest,
+			&holes);
+		size += sprintf(buf + size, "[%d] %s: %lluKB %lluKB %u\n", i,
+			topo->m_mem_data[i].m_tag, free / 1024, largest / 1024,
+			holes);
+	}
+	mutex_unlock(&xdev->dev_lock);
+	return size;
+}
+static DEVICE_ATTR_RO(memfrag);
+
 static ssize_t p2p_enable_show(struct device *dev,
 		struct device_attribute *attr, char *buf)
 {
@@ -241,6 +272,26 @@ static ssize_t dev_offline_show(struct device *dev,
 
 static DEVICE_ATTR(dev_offline, 0444, dev_offline_show, NULL);
 
+/* -copy bo with peer device bo, write to peer then read from peer-- */
+static ssize_t p2p_copy_stat_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct xocl_dev *xdev = dev_get_drvdata(dev);
+	ssize_t size = 0;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(xdev->p2p_copy_cnt); i++) {
+		size += sprintf(buf + size, "%lld %lld %lld\n",
+			atomic64_read(&xdev->p2p_copy_cnt[i]),
+			atomic64_read(&xdev->p2p_copy_bytes[i]),
+			atomic64_read(&xdev->p2p_copy_usecs[i]));
+	}
+
+	return size;
+}
+
+static DEVICE_ATTR_RO(p2p_copy_stat);
+
 static ssize_t mig_calibration_show(struct device *dev,
 		struct device_attribute *attr, char *buf)
 {
@@ -350,9 +401,11 @@ static struct attribute *xocl_attrs[] = {
 	&dev_attr_kdsstat.attr,
 	&dev_attr_memstat.attr,
 	&dev_attr_memstat_raw.attr,
+	&dev_attr_memfrag.attr,
 	&dev_attr_user_pf.attr,
 	&dev_attr_p2p_enable.attr,
 	&dev_attr_dev_offline.attr,
+	&dev_attr_p2p_copy_stat.attr,
 	&dev_attr_mig_calibration.attr,
 	&dev_attr_link_width.attr,
 	&dev_attr_link_speed.attr,
@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2019 Xilinx, Inc. All rights reserved.
+ *
+ * DMA channel arbitration shared by the xdma and qdma subdevices
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/sched.h>
+#include "xocl_drv.h"
+
+/*
+ * Channels of one direction are handed out under three rules:
+ *
+ * - Fair share. A client (process) holding at least its share of the
+ *   channels, channels divided by the number of clients holding or
+ *   waiting for one, waits until another client had its turn. A burst
+ *   of large transfers from one process can no longer hold all
+ *   channels.
+ * - Priority. While a XOCL_DMA_FLAG_PRIO transfer waits, no regular
+ *   transfer gets a channel, so small latency sensitive transfers jump
+ *   ahead of queued bulk transfers.
+ * - Affinity. A thread always prefers the same channel, which keeps
+ *   descriptor rings and the channel's interrupt local to the thread.
+ *
+ * Clients beyond the size of the client table are not limited.
+ */
+
+void xocl_chan_arb_init(struct xocl_chan_arb *arb, u32 count)
+{
+	memset(arb, 0, sizeof(*arb));
+	spin_lock_init(&arb->lock);
+	init_waitqueue_head(&arb->wq);
+	arb->count = min_t(u32, count, BITS_PER_LONG);
+	arb->free = arb->count == BITS_PER_LONG ? ~0UL : BIT(arb->count) - 1;
+}
+
+static struct xocl_chan_client *chan_arb_client(struct xocl_chan_arb *arb,
+	pid_t tgid, bool alloc)
+{
+	struct xocl_chan_client *free = NULL;
+	int i;
+
+	for (i = 0; i < XOCL_CHAN_ARB_CLIENTS; i++) {
+		struct xocl_chan_client *client = &arb->clients[i];
+
+		if (client->tgid == tgid && (client->held || client->waiting))
+			return client;
+		if (!free && !client->held && !client->waiting)
+			free = client;
+	}
+	if (alloc && free)
+		free->tgid = tgid;
+	return alloc ? free : NULL;
+}
+
+static u32 chan_arb_active(struct xocl_chan_arb *arb)
+{
+	u32 active = 0;
+	int i;
+
+	for (i = 0; i < XOCL_CHAN_ARB_CLIENTS; i++)
+		if (arb->clients[i].held || arb->clients[i].waiting)
+			active++;
+	return active;
+}
+
+static bool chan_arb_try(struct xocl_chan_arb *arb,
+	struct xocl_chan_client *client, bool prio, int *channel)
+{
+	u32 active, pref;
+	bool ret = false;
+
+	spin_lock(&arb->lock);
+	if (!arb->free)
+		goto out;
+	if (!prio && arb->prio_waiting)
+		goto out;
+
+	active = chan_arb_active(arb);
+	if (client && active > 1 &&
+		client->held >= DIV_ROUND_UP(arb->count, active))
+		goto out;
+
+	pref = current->pid % arb->count;
+	*channel = test_bit(pref, &arb->free) ? pref : __ffs(arb->free);
+	clear_bit(*channel, &arb->free);
+	arb->owner[*channel] = current->tgid;
+	if (client) {
+		client->held++;
+		client->waiting--;
+	}
+	if (prio)
+		arb->prio_waiting--;
+	ret = true;
+out:
+	spin_unlock(&arb->lock);
+	return ret;
+}
+
+int xocl_chan_arb_acquire(struct xocl_chan_arb *arb, bool prio)
+{
+	struct xocl_chan_client *client;
+	int channel = -EIO;
+	int ret;
+
+	if (!arb->count)
+		return -ENODEV;
+
+	spin_lock(&arb->lock);
+	client = chan_arb_client(arb, current->tgid, true);
+	if (client)
+		client->waiting++;
+	if (prio)
+		arb->prio_waiting++;
+	spin_unlock(&arb->lock);
+
+	ret = wait_event_killable(arb->wq,
+		chan_arb_try(arb, client, prio, &channel));
+	if (!ret)
+		return channel;
+
+	spin_lock(&arb->lock);
+	if (client)
+		client->waiting--;
+	if (prio)
+		arb->prio_waiting--;
+	spin_unlock(&arb->lock);
+	/* Others may have waited on this client's share or priority */
+	wake_up_all(&arb->wq);
+	return ret;
+}
+
+void xocl_chan_arb_release(struct xocl_chan_arb *arb, u32 channel)
+{
+	struct xocl_chan_client *client;
+
+	if (channel >= arb->count)
+		return;
+
+	spin_lock(&arb->lock);
+	client = chan_arb_client(arb, arb->owner[channel], false);
+	if (client)
+		client->held--;
+	set_bit(channel, &arb->free);
+	spin_unlock(&arb->lock);
+
+	/* All waiters, fair share and priority are per waiter decisions */
+	wake_up_all(&arb->wq);
+}
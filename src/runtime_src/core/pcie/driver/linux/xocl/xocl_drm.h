@@ -37,9 +37,16 @@ struct xocl_drm {
 	xdev_handle_t		xdev;
 	/* memory management */
 	struct drm_device       *ddev;
-	/* Memory manager array, one per DDR channel, protected by mm_lock */
+	/*
+	 * Memory manager array, one per DDR channel. mm_lock is taken for
+	 * write to set up or tear down the arrays, and for read around
+	 * allocations. Each memory region then has its own lock in
+	 * mm_bank_lock (shared by banks aliasing the same region), so
+	 * allocations on different banks don't serialize.
+	 */
 	struct drm_mm           **mm;
-	struct mutex            mm_lock;
+	struct rw_semaphore     mm_lock;
+	struct mutex            **mm_bank_lock;
 	struct drm_xocl_mm_stat **mm_usage_stat;
 	u64                     *mm_p2p_off;
 
@@ -47,6 +54,15 @@ struct xocl_drm {
 	DECLARE_HASHTABLE(mm_range, 6);
 #endif
 
+	/* Asynchronous sync bo, fences protected by sync_lock */
+	struct workqueue_struct	*sync_wq;
+	struct idr		sync_fences;
+	spinlock_t		sync_lock;
+	wait_queue_head_t	sync_done;
+
+	/* BOs imported from dma-bufs of other devices, shared by all clients */
+	struct mutex		import_lock;
+	struct list_head	imports;
 };
 
 struct drm_xocl_bo {
@@ -63,6 +79,19 @@ struct drm_xocl_bo {
 	unsigned                dma_nsg;
 	unsigned              flags;
 	unsigned              mem_idx;
+	/* Page chunk index and sg table reused for partial syncs */
+	struct xocl_bo_sg_cache *sg_cache;
+	/* Pre-built DMA descriptor chain for whole BO syncs */
+	struct sg_table      *chain_sgt;
+	void                 *dma_chain;
+	/* Pages allocated by the driver on the device node, not shmem */
+	bool                  drv_pages;
+	/* NUMA node of all host pages, NUMA_NO_NODE if none or mixed */
+	int                   numa_node;
+	/* Userptr registration owning the pinned pages, if cached */
+	struct xocl_userptr_reg *uptr_reg;
+	/* Entry in xocl_drm imports, empty unless in the import cache */
+	struct list_head      import_link;
 };
 
 struct drm_xocl_unmgd {
@@ -75,6 +104,8 @@ struct drm_xocl_unmgd {
 struct drm_xocl_bo *xocl_drm_create_bo(struct xocl_drm *drm_p,
 	uint64_t unaligned_size, unsigned user_flags);
 void xocl_drm_free_bo(struct drm_gem_object *obj);
+/* BO mapped by @vma, NULL if @vma is not a BO mapping of xocl */
+struct drm_xocl_bo *xocl_drm_vma_bo(struct vm_area_struct *vma);
 
 
 void xocl_mm_get_usage_stat(struct xocl_drm *drm_p, u32 ddr,
@@ -83,10 +114,14 @@ void xocl_mm_update_usage_stat(struct xocl_drm *drm_p, u32 ddr,
         u64 size, int count);
 int xocl_mm_insert_node(struct xocl_drm *drm_p, u32 ddr,
                 struct drm_mm_node *node, u64 size);
+void xocl_mm_get_frag_stat(struct xocl_drm *drm_p, u32 ddr,
+	u64 *free, u64 *largest, u32 *holes);
 void *xocl_drm_init(xdev_handle_t xdev);
 void xocl_drm_fini(struct xocl_drm *drm_p);
 uint32_t xocl_get_shared_ddr(struct xocl_drm *drm_p, struct mem_data *m_data);
 int xocl_init_mem(struct xocl_drm *drm_p);
+void xocl_sync_bo_release(struct xocl_drm *drm_p, struct drm_file *filp);
+void xocl_userptr_cache_release(struct drm_file *filp);
 int xocl_cleanup_mem(struct xocl_drm *drm_p);
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 13, 0)
@@ -297,11 +297,19 @@ struct xocl_pci_funcs {
 	(XDEV_PCIOPS(xdev)->reset ? XDEV_PCIOPS(xdev)->reset(xdev) : \
 	-ENODEV)
 
+/*
+ * health_cb returns non-zero when it found something wrong. The thread then
+ * checks every interval ms, and backs off up to max_interval ms while the
+ * device stays healthy. health_thread_kick() runs a check right away.
+ */
 struct xocl_health_thread_arg {
 	int (*health_cb)(void *arg);
 	void		*arg;
 	u32		interval;    /* ms */
+	u32		max_interval;    /* ms, 0 means fixed interval */
 	struct device	*dev;
+	wait_queue_head_t	wq;
+	bool		kick;
 };
 
 struct xocl_drvinst_proc {
@@ -351,6 +359,7 @@ struct xocl_dev_core {
 	struct xocl_health_thread_arg thread_arg;
 
 	struct xocl_drm		*drm;
+	struct xocl_usage_page	*usage;
 
 	char			*fdt_blob;
 	struct xocl_board_private priv;
@@ -443,12 +452,43 @@ struct xocl_rom_funcs {
 	(ROM_CB(xdev, get_raw_header) ? ROM_OPS(xdev)->get_raw_header(ROM_DEV(xdev), header) :\
 	-ENODEV)
 
+/*
+ * DMA channel arbiter of one direction, see xocl_chan_arb.c
+ */
+#define	XOCL_CHAN_ARB_CLIENTS	16
+
+struct xocl_chan_client {
+	pid_t			tgid;
+	u32			held;
+	u32			waiting;
+};
+
+struct xocl_chan_arb {
+	spinlock_t		lock;
+	wait_queue_head_t	wq;
+	u32			count;
+	unsigned long		free;
+	u32			prio_waiting;
+	pid_t			owner[BITS_PER_LONG];
+	struct xocl_chan_client	clients[XOCL_CHAN_ARB_CLIENTS];
+};
+
+void xocl_chan_arb_init(struct xocl_chan_arb *arb, u32 count);
+int xocl_chan_arb_acquire(struct xocl_chan_arb *arb, bool prio);
+void xocl_chan_arb_release(struct xocl_chan_arb *arb, u32 channel);
+
 /* dma callbacks */
 struct xocl_dma_funcs {
 	struct xocl_subdev_funcs common_funcs;
 	ssize_t (*migrate_bo)(struct platform_device *pdev,
-		struct sg_table *sgt, u32 dir, u64 paddr, u32 channel, u64 sz);
-	int (*ac_chan)(struct platform_device *pdev, u32 dir);
+		struct sg_table *sgt, u32 dir, u64 paddr, u32 channel, u64 sz,
+		u32 flags);
+	void *(*chain_create)(struct platform_device *pdev,
+		struct sg_table *sgt, u64 paddr);
+	void (*chain_free)(struct platform_device *pdev, void *chain);
+	ssize_t (*chain_submit)(struct platform_device *pdev, void *chain,
+		u32 dir, u32 channel, u32 flags);
+	int (*ac_chan)(struct platform_device *pdev, u32 dir, u32 flags);
 	void (*rel_chan)(struct platform_device *pdev, u32 dir, u32 channel);
 	u32 (*get_chan_count)(struct platform_device *pdev);
 	u64 (*get_chan_stat)(struct platform_device *pdev, u32 channel,
@@ -466,12 +506,28 @@ struct xocl_dma_funcs {
 	((struct xocl_dma_funcs *)SUBDEV(xdev, XOCL_SUBDEV_DMA).ops)
 #define DMA_CB(xdev, cb)	\
 	(DMA_DEV(xdev) && DMA_OPS(xdev) && DMA_OPS(xdev)->cb)
-#define	xocl_migrate_bo(xdev, sgt, to_dev, paddr, chan, len)	\
+#define	XOCL_DMA_FLAG_POLL	0x1
+/* Acquire a channel ahead of waiting regular transfers */
+#define	XOCL_DMA_FLAG_PRIO	0x2
+#define	xocl_migrate_bo_flags(xdev, sgt, to_dev, paddr, chan, len, flags) \
 	(DMA_CB(xdev, migrate_bo) ? DMA_OPS(xdev)->migrate_bo(DMA_DEV(xdev), \
-	sgt, to_dev, paddr, chan, len) : 0)
+	sgt, to_dev, paddr, chan, len, flags) : 0)
+#define	xocl_migrate_bo(xdev, sgt, to_dev, paddr, chan, len)	\
+	xocl_migrate_bo_flags(xdev, sgt, to_dev, paddr, chan, len, 0)
+#define	xocl_dma_chain_create(xdev, sgt, paddr)			\
+	(DMA_CB(xdev, chain_create) ? DMA_OPS(xdev)->chain_create(DMA_DEV(xdev), \
+	sgt, paddr) : ERR_PTR(-EOPNOTSUPP))
+#define	xocl_dma_chain_free(xdev, chain)			\
+	(DMA_CB(xdev, chain_free) ? DMA_OPS(xdev)->chain_free(DMA_DEV(xdev), \
+	chain) : (void)0)
+#define	xocl_dma_chain_submit(xdev, chain, to_dev, chan, flags)	\
+	(DMA_CB(xdev, chain_submit) ? DMA_OPS(xdev)->chain_submit(DMA_DEV(xdev), \
+	chain, to_dev, chan, flags) : -EOPNOTSUPP)
+#define	xocl_acquire_channel_flags(xdev, dir, flags)	\
+	(DMA_CB(xdev, ac_chan) ? DMA_OPS(xdev)->ac_chan(DMA_DEV(xdev), dir, \
+	flags) : -ENODEV)
 #define	xocl_acquire_channel(xdev, dir)		\
-	(DMA_CB(xdev, ac_chan) ? DMA_OPS(xdev)->ac_chan(DMA_DEV(xdev), dir) : \
-	-ENODEV)
+	xocl_acquire_channel_flags(xdev, dir, 0)
 #define	xocl_release_channel(xdev, dir, chan)	\
 	(DMA_CB(xdev, rel_chan) ? DMA_OPS(xdev)->rel_chan(DMA_DEV(xdev), dir, \
 	chan) : NULL)
@@ -808,6 +864,8 @@ struct xocl_icap_funcs {
 		const xuid_t *uuid, pid_t pid);
 	uint64_t (*get_data)(struct platform_device *pdev,
 		enum data_kind kind);
+	struct axlf *(*get_cached_axlf)(struct platform_device *pdev,
+		const xuid_t *uuid);
 };
 #define	ICAP_DEV(xdev)	SUBDEV(xdev, XOCL_SUBDEV_ICAP).pldev
 #define	ICAP_OPS(xdev)							\
@@ -826,6 +884,10 @@ struct xocl_icap_funcs {
 	(ICAP_CB(xdev, download_bitstream_axlf) ?						\
 	ICAP_OPS(xdev)->download_bitstream_axlf(ICAP_DEV(xdev), xclbin) : \
 	-ENODEV)
+#define	xocl_icap_get_cached_axlf(xdev, uuid)				\
+	(ICAP_CB(xdev, get_cached_axlf) ?				\
+	ICAP_OPS(xdev)->get_cached_axlf(ICAP_DEV(xdev), uuid) :	\
+	NULL)
 #define	xocl_icap_download_boot_firmware(xdev)				\
 	(ICAP_CB(xdev, download_boot_firmware) ?						\
 	ICAP_OPS(xdev)->download_boot_firmware(ICAP_DEV(xdev)) :	\
@@ -1016,6 +1078,31 @@ static inline void xocl_dr_reg_write32(xdev_handle_t xdev, u32 value, void __iom
 	read_unlock(&XDEV(xdev)->rwlock);
 }
 
+/*
+ * Usage page helpers. The page only exists on user pf, callers make sure
+ * the index fits in the page layout.
+ */
+#define	xocl_usage_add(xdev, field, val) do {				\
+	struct xocl_usage_page *__up = XDEV(xdev)->usage;		\
+	if (__up)							\
+		atomic64_add(val, (atomic64_t *)&__up->field);		\
+} while (0)
+
+#define	xocl_usage_set(xdev, field, val) do {				\
+	struct xocl_usage_page *__up = XDEV(xdev)->usage;		\
+	if (__up)							\
+		WRITE_ONCE(__up->field, val);				\
+} while (0)
+
+#define	xocl_usage_dma_add(xdev, write, channel, bytes) do {		\
+	if ((channel) < XOCL_USAGE_MAX_DMA_CHANNELS) {			\
+		if (write)						\
+			xocl_usage_add(xdev, h2c[channel], bytes);	\
+		else							\
+			xocl_usage_add(xdev, c2h[channel], bytes);	\
+	}								\
+} while (0)
+
 /* context helpers */
 extern struct mutex xocl_drvinst_mutex;
 extern struct xocl_drvinst *xocl_drvinst_array[XOCL_MAX_DEVICES * 10];
@@ -1034,6 +1121,7 @@ int xocl_drvinst_kill_proc(void *data);
 /* health thread functions */
 int health_thread_start(xdev_handle_t xdev);
 int health_thread_stop(xdev_handle_t xdev);
+void health_thread_kick(xdev_handle_t xdev);
 
 /* subdev blob functions */
 int xocl_fdt_blob_input(xdev_handle_t xdev_hdl, char *blob);
@@ -21,12 +21,25 @@
 int health_thread(void *data)
 {
 	struct xocl_health_thread_arg *thread_arg = data;
+	u32 interval = thread_arg->interval;
 
 	while (!kthread_should_stop()) {
-		msleep_interruptible(thread_arg->interval);
+		wait_event_interruptible_timeout(thread_arg->wq,
+			thread_arg->kick || kthread_should_stop(),
+			msecs_to_jiffies(interval));
+		if (kthread_should_stop())
+			break;
+		thread_arg->kick = false;
 
-		if (thread_arg->health_cb)
-			thread_arg->health_cb(thread_arg->arg);
+		if (!thread_arg->health_cb)
+			continue;
+
+		/* Back off while healthy, check often again on trouble. */
+		if (thread_arg->health_cb(thread_arg->arg) ||
+			thread_arg->max_interval <= thread_arg->interval)
+			interval = thread_arg->interval;
+		else
+			interval = min(interval * 2, thread_arg->max_interval);
 	}
 	xocl_info(thread_arg->dev, "The health thread has terminated.");
 	return 0;
@@ -42,6 +55,10 @@ int health_thread_start(xdev_handle_t xdev)
 		return 0;
 	}
 
+	core->thread_arg.dev = &core->pdev->dev;
+	core->thread_arg.kick = false;
+	init_waitqueue_head(&core->thread_arg.wq);
+
 	core->health_thread = kthread_run(health_thread, &core->thread_arg,
 		"xocl_health_thread");
 
@@ -51,11 +68,20 @@ int health_thread_start(xdev_handle_t xdev)
 		return -ENOMEM;
 	}
 
-	core->thread_arg.dev = &core->pdev->dev;
-
 	return 0;
 }
 
+void health_thread_kick(xdev_handle_t xdev)
+{
+	struct xocl_dev_core *core = XDEV(xdev);
+
+	if (!core->health_thread)
+		return;
+
+	core->thread_arg.kick = true;
+	wake_up_interruptible(&core->thread_arg.wq);
+}
+
 int health_thread_stop(xdev_handle_t xdev)
 {
 	struct xocl_dev_core *core = XDEV(xdev);
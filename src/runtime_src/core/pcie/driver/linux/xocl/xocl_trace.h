@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2019 Xilinx, Inc. All rights reserved.
+ *
+ * Tracepoints of the xocl command scheduler, DMA and BO paths
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * The events are in the xocl system, e.g.
+ *
+ *   perf record -e 'xocl:*' -a
+ *   bpftrace -e 'tracepoint:xocl:xocl_cmd_state { ... }'
+ *
+ * A disabled tracepoint is a static branch around the event, the hot
+ * paths pay no more than that.  Devices are identified by their xocl
+ * minor (dev_minor), commands by their scheduler uid.
+ *
+ * The tracepoints are created in userpf/xocl_drv.c.
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM xocl
+
+#if !defined(_XOCL_TRACE_H_) || defined(TRACE_HEADER_MULTI_READ)
+#define _XOCL_TRACE_H_
+
+#include <linux/tracepoint.h>
+
+/* Command state transitions, see mb_scheduler.c */
+TRACE_EVENT(xocl_cmd_state,
+	TP_PROTO(int dev, unsigned long uid, u32 opcode, u32 state),
+	TP_ARGS(dev, uid, opcode, state),
+	TP_STRUCT__entry(
+		__field(int, dev)
+		__field(unsigned long, uid)
+		__field(u32, opcode)
+		__field(u32, state)
+	),
+	TP_fast_assign(
+		__entry->dev = dev;
+		__entry->uid = uid;
+		__entry->opcode = opcode;
+		__entry->state = state;
+	),
+	TP_printk("dev=%d cmd=%lu opcode=%u state=%u",
+		__entry->dev, __entry->uid, __entry->opcode, __entry->state)
+);
+
+/* BO DMA through the xdma and qdma migrate_bo callbacks */
+TRACE_EVENT(xocl_dma_start,
+	TP_PROTO(int dev, u32 dir, u32 channel, u64 paddr, u64 len),
+	TP_ARGS(dev, dir, channel, paddr, len),
+	TP_STRUCT__entry(
+		__field(int, dev)
+		__field(u32, dir)
+		__field(u32, channel)
+		__field(u64, paddr)
+		__field(u64, len)
+	),
+	TP_fast_assign(
+		__entry->dev = dev;
+		__entry->dir = dir;
+		__entry->channel = channel;
+		__entry->paddr = paddr;
+		__entry->len = len;
+	),
+	TP_printk("dev=%d dir=%u channel=%u paddr=0x%llx len=%llu",
+		__entry->dev, __entry->dir, __entry->channel,
+		__entry->paddr, __entry->len)
+);
+
+TRACE_EVENT(xocl_dma_done,
+	TP_PROTO(int dev, u32 dir, u32 channel, long ret),
+	TP_ARGS(dev, dir, channel, ret),
+	TP_STRUCT__entry(
+		__field(int, dev)
+		__field(u32, dir)
+		__field(u32, channel)
+		__field(long, ret)
+	),
+	TP_fast_assign(
+		__entry->dev = dev;
+		__entry->dir = dir;
+		__entry->channel = channel;
+		__entry->ret = ret;
+	),
+	TP_printk("dev=%d dir=%u channel=%u ret=%ld",
+		__entry->dev, __entry->dir, __entry->channel, __entry->ret)
+);
+
+/* Memory mapped requests on a libqdma queue */
+TRACE_EVENT(qdma_request_submit,
+	TP_PROTO(u32 dev, u32 qidx, bool c2h, u32 count),
+	TP_ARGS(dev, qidx, c2h, count),
+	TP_STRUCT__entry(
+		__field(u32, dev)
+		__field(u32, qidx)
+		__field(bool, c2h)
+		__field(u32, count)
+	),
+	TP_fast_assign(
+		__entry->dev = dev;
+		__entry->qidx = qidx;
+		__entry->c2h = c2h;
+		__entry->count = count;
+	),
+	TP_printk("qdma=%u queue=%u %s count=%u",
+		__entry->dev, __entry->qidx, __entry->c2h ? "C2H" : "H2C",
+		__entry->count)
+);
+
+TRACE_EVENT(qdma_request_done,
+	TP_PROTO(u32 dev, u32 qidx, bool c2h, long ret),
+	TP_ARGS(dev, qidx, c2h, ret),
+	TP_STRUCT__entry(
+		__field(u32, dev)
+		__field(u32, qidx)
+		__field(bool, c2h)
+		__field(long, ret)
+	),
+	TP_fast_assign(
+		__entry->dev = dev;
+		__entry->qidx = qidx;
+		__entry->c2h = c2h;
+		__entry->ret = ret;
+	),
+	TP_printk("qdma=%u queue=%u %s ret=%ld",
+		__entry->dev, __entry->qidx, __entry->c2h ? "C2H" : "H2C",
+		__entry->ret)
+);
+
+/* BO create and free */
+TRACE_EVENT(xocl_bo_create,
+	TP_PROTO(int dev, const void *xobj, u64 size, u32 flags, u32 mem_idx),
+	TP_ARGS(dev, xobj, size, flags, mem_idx),
+	TP_STRUCT__entry(
+		__field(int, dev)
+		__field(const void *, xobj)
+		__field(u64, size)
+		__field(u32, flags)
+		__field(u32, mem_idx)
+	),
+	TP_fast_assign(
+		__entry->dev = dev;
+		__entry->xobj = xobj;
+		__entry->size = size;
+		__entry->flags = flags;
+		__entry->mem_idx = mem_idx;
+	),
+	TP_printk("dev=%d bo=%p size=%llu flags=0x%x mem=%u",
+		__entry->dev, __entry->xobj, __entry->size, __entry->flags,
+		__entry->mem_idx)
+);
+
+TRACE_EVENT(xocl_bo_free,
+	TP_PROTO(int dev, const void *xobj, u64 size),
+	TP_ARGS(dev, xobj, size),
+	TP_STRUCT__entry(
+		__field(int, dev)
+		__field(const void *, xobj)
+		__field(u64, size)
+	),
+	TP_fast_assign(
+		__entry->dev = dev;
+		__entry->xobj = xobj;
+		__entry->size = size;
+	),
+	TP_printk("dev=%d bo=%p size=%llu",
+		__entry->dev, __entry->xobj, __entry->size)
+);
+
+#endif /* _XOCL_TRACE_H_ */
+
+/* Out of tree, found through -I of the xocl directory, see userpf/Makefile */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE xocl_trace
+#include <trace/define_trace.h>
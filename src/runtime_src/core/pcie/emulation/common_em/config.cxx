@@ -53,7 +53,10 @@ namespace xclemulation{
     mLaunchWaveform = LAUNCHWAVEFORM::OFF;
     mDontRun = false;
     mSimDir = "";
+    mBinaryCacheDir = "";
     mPacketSize = 0x800000;
+    mSharedMemoryCopy = false;
+    mSharedMemoryCopySize = MEMSIZE_64M;
     mMaxTraceCount = 1;
     mPaddingFactor = 1;
     mSuppressInfo = false ;
@@ -152,6 +155,10 @@ namespace xclemulation{
       {
         setSimDir(value);
       }
+      else if(name == "binary_cache_dir")
+      {
+        setBinaryCacheDir(value);
+      }
       else if(name == "verbosity")
       {
         unsigned int verbosity = strtoll(value.c_str(),NULL,0);
@@ -164,6 +171,16 @@ namespace xclemulation{
         if(packetSize > 0 )
           setPacketSize(packetSize);
       }
+      else if(name == "enable_shared_memory_copy")
+      {
+        enableSharedMemoryCopy(getBoolValue(value,false));
+      }
+      else if(name == "shared_memory_copy_size")
+      {
+        uint64_t shmSize = strtoull(value.c_str(),NULL,0);
+        if(shmSize > 0 )
+          setSharedMemoryCopySize(shmSize);
+      }
       else if(name == "max_trace_count")
       {
         unsigned int maxTraceCount = strtoll(value.c_str(),NULL,0);
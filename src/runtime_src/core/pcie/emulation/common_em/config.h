@@ -99,9 +99,12 @@ namespace xclemulation{
       inline void enableMemLogs (bool memLogs)                  { mMemLogs          = memLogs;       }
       inline void setDontRun( bool dontRun)                     { mDontRun          = dontRun;       }
       inline void setPacketSize( unsigned int packetSize)       { mPacketSize       = packetSize;    }
+      inline void enableSharedMemoryCopy(bool shmCopy)          { mSharedMemoryCopy = shmCopy;       }
+      inline void setSharedMemoryCopySize( uint64_t shmSize)    { mSharedMemoryCopySize = shmSize;   }
       inline void setMaxTraceCount( unsigned int maxTraceCount) { mMaxTraceCount    = maxTraceCount; }
       inline void setPaddingFactor( unsigned int paddingFactor) { mPaddingFactor    = paddingFactor; }
       inline void setSimDir( std::string& simDir)               { mSimDir           = simDir;        }
+      inline void setBinaryCacheDir( std::string& cacheDir)     { mBinaryCacheDir   = cacheDir;      }
       inline void setLaunchWaveform( LAUNCHWAVEFORM lWaveform)  { mLaunchWaveform   = lWaveform;     }
       inline void suppressInfo( bool suppress)                  { mSuppressInfo     = suppress;      }
       inline void suppressWarnings( bool suppress)              { mSuppressWarnings = suppress;      }
@@ -120,9 +123,12 @@ namespace xclemulation{
       inline bool isMemLogsEnabled()            const { return mMemLogs;        }
       inline bool isDontRun()                   const { return mDontRun;        }
       inline unsigned int getPacketSize()       const { return mPacketSize;     }
+      inline bool isSharedMemoryCopyEnabled()   const { return mSharedMemoryCopy; }
+      inline uint64_t getSharedMemoryCopySize() const { return mSharedMemoryCopySize; }
       inline unsigned int getMaxTraceCount()    const { return mMaxTraceCount;  }
       inline unsigned int getPaddingFactor()    const { if(!mOOBChecks) return 0; return mPaddingFactor;  }
       inline std::string getSimDir()            const { return mSimDir;         }
+      inline std::string getBinaryCacheDir()    const { return mBinaryCacheDir; }
       inline LAUNCHWAVEFORM getLaunchWaveform() const { return mLaunchWaveform; }
       inline bool isInfoSuppressed()            const { return mSuppressInfo;    }
       inline bool isWarningsuppressed()         const { return mSuppressWarnings;}
@@ -146,7 +152,10 @@ namespace xclemulation{
       bool mDontRun;
       LAUNCHWAVEFORM mLaunchWaveform;
       std::string mSimDir;
+      std::string mBinaryCacheDir;
       unsigned int mPacketSize;
+      bool mSharedMemoryCopy;
+      uint64_t mSharedMemoryCopySize;
       unsigned int mMaxTraceCount;
       unsigned int mPaddingFactor;
       bool mSuppressInfo;
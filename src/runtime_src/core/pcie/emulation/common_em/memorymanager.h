@@ -18,7 +18,8 @@
 #define _HWEM_MEMORY_MANAGER_H_
 
 #include <mutex>
-#include <list>
+#include <map>
+#include <set>
 #include <cassert>
 #include <algorithm>
 
@@ -27,19 +28,23 @@
 
 namespace xclemulation
 {
+    // Free blocks are indexed both by size (best fit allocation) and by
+    // address (coalescing with neighbours on free), so alloc, free and
+    // lookup are O(log n) in the number of blocks
     class MemoryManager 
     {
         std::mutex mMemManagerMutex;
-        std::list<std::pair<uint64_t, uint64_t> > mFreeBufferList;
-        std::list<std::pair<uint64_t, uint64_t> > mBusyBufferList;
+        // (size, start) of free blocks
+        std::set<std::pair<uint64_t, uint64_t> > mFreeBySize;
+        // start -> size of free blocks
+        std::map<uint64_t, uint64_t> mFreeByAddr;
+        // start -> size of allocated blocks
+        std::map<uint64_t, uint64_t> mBusyBuffers;
         uint64_t mSize;
         uint64_t mStart;
         uint64_t mAlignment;
-        const unsigned mCoalesceThreshold;
         uint64_t mFreeSize;
 
-        typedef std::list<std::pair<uint64_t, uint64_t> > PairList;
-
     public:
         static const uint64_t mNull = 0xffffffffffffffffull;
 
@@ -58,11 +63,9 @@ namespace xclemulation
         std::pair<uint64_t, uint64_t>lookup(uint64_t buf);
 
     private:
-        void coalesce();
-        PairList::iterator find(uint64_t buf);
+        void insertFree(uint64_t start, uint64_t size);
+        void eraseFree(std::map<uint64_t, uint64_t>::iterator i);
     };
 }
 
 #endif
-
-
@@ -61,12 +61,84 @@ namespace systemUtil {
         }
       case PERMISSIONS : 
         {
-          std::stringstream permissionsCommand ;
-          permissionsCommand << "chmod -R " << operand2 << " " << operand1;
-          int status = system(permissionsCommand.str().c_str());
-          printErrorMessage(permissionsCommand.str(),status);
+          // chmod -R without a shell, operand2 is the octal mode
+          boost::system::error_code ec;
+          boost::filesystem::perms mode = static_cast<boost::filesystem::perms>(std::stoul(operand2,nullptr,8));
+          boost::filesystem::permissions(operand1, mode, ec);
+          for (boost::filesystem::recursive_directory_iterator itr(operand1, ec), end; !ec && itr != end; itr.increment(ec))
+          {
+            if (!boost::filesystem::is_symlink(itr->symlink_status()))
+              boost::filesystem::permissions(itr->path(), mode, ec);
+          }
+          if (ec)
+            printErrorMessage("chmod -R " + operand2 + " " + operand1, ec.value());
           break;
         }
     }
   }
+
+  static std::string getCacheKey(const char* data, size_t size)
+  {
+    // FNV-1a, the size is part of the key as well
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; ++i)
+    {
+      hash ^= static_cast<unsigned char>(data[i]);
+      hash *= 0x100000001b3ull;
+    }
+    std::stringstream key;
+    key << std::hex << hash << "_" << std::dec << size;
+    return key.str();
+  }
+
+  static void copyTree(const boost::filesystem::path& src, const boost::filesystem::path& dst)
+  {
+    boost::filesystem::create_directories(dst);
+    for (boost::filesystem::recursive_directory_iterator itr(src), end; itr != end; ++itr)
+    {
+      boost::filesystem::path target = dst / boost::filesystem::relative(itr->path(), src);
+      boost::filesystem::file_status status = itr->symlink_status();
+      if (boost::filesystem::is_symlink(status))
+      {
+        boost::filesystem::remove(target);
+        boost::filesystem::copy_symlink(itr->path(), target);
+      }
+      else if (boost::filesystem::is_directory(status))
+        boost::filesystem::create_directories(target);
+      else
+        boost::filesystem::copy_file(itr->path(), target, boost::filesystem::copy_options::overwrite_existing);
+    }
+  }
+
+  void unzipCached(std::string &zipFile, const char* data, size_t size, std::string &directory, const std::string &cacheDir)
+  {
+    if (cacheDir.empty())
+    {
+      makeSystemCall(zipFile, UNZIP, directory);
+      return;
+    }
+
+    try
+    {
+      boost::filesystem::path cached = boost::filesystem::path(cacheDir) / getCacheKey(data, size);
+      if (!boost::filesystem::exists(cached))
+      {
+        // Extract to a private directory and publish it with an atomic
+        // rename, so concurrent processes never see a partial tree
+        std::string tmpDir = cached.string() + ".tmp" + std::to_string(getpid());
+        makeSystemCall(tmpDir, CREATE);
+        makeSystemCall(zipFile, UNZIP, tmpDir);
+        boost::system::error_code ec;
+        boost::filesystem::rename(tmpDir, cached, ec);
+        if (ec)
+          boost::filesystem::remove_all(tmpDir, ec);
+      }
+      copyTree(cached, directory);
+    }
+    catch (const boost::filesystem::filesystem_error& ex)
+    {
+      std::cout << "WARNING: [SDx 60-601] Unable to use binary cache " << cacheDir << ": " << ex.what() << std::endl;
+      makeSystemCall(zipFile, UNZIP, directory);
+    }
+  }
 }
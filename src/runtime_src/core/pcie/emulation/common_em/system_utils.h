@@ -25,5 +25,10 @@ namespace systemUtil {
 
   void makeSystemCall(std::string &operand1, systemOperation operation, std::string operand2 = "");
 
+  // Unzips zipFile, which holds data, into directory. With a non empty
+  // cacheDir the extracted tree is kept there keyed by a hash of data and
+  // reused by later loads, also by other processes, instead of unzipping.
+  void unzipCached(std::string &zipFile, const char* data, size_t size, std::string &directory, const std::string &cacheDir);
+
 }
 #endif
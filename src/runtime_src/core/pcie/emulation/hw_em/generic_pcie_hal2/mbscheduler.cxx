@@ -1,5 +1,7 @@
 #include "shim.h"
 #include <algorithm>
+#include <sys/time.h>
+#include <vector>
 //#define EM_DEBUG_KDS
 namespace xclhwemhal2 {
 
@@ -163,12 +165,11 @@ namespace xclhwemhal2 {
   {
     unsigned int size = regmap_size(xcmd);
     uint32_t *regmap = cmd_regmap(xcmd);
-    unsigned int idx;
 
-    for (idx = 4; idx < size; ++idx)
-    {
-      mParent->xclWrite(XCL_ADDR_KERNEL_CTRL, xcu->base + xcu->addr + (idx << 2), (void*)(regmap+idx) ,4);
-    }
+    // Every xclWrite is a simulator round trip, so write the contiguous
+    // register map in one go
+    if (size > 4)
+      mParent->xclWrite(XCL_ADDR_KERNEL_CTRL, xcu->base + xcu->addr + (4 << 2), (void*)(regmap+4), (size-4) << 2);
   }
 
   void MBScheduler::cu_configure_ooo(struct xocl_cu *xcu, struct xocl_cmd *xcmd)
@@ -176,13 +177,25 @@ namespace xclhwemhal2 {
     unsigned int size = regmap_size(xcmd);
     uint32_t *regmap = cmd_regmap(xcmd);
     unsigned int idx;
+    std::vector<uint32_t> vals;
+    uint32_t start = 0;
 
+    // Batch runs of consecutive registers into one write each
     for (idx = 4; idx < size - 1; idx += 2)
     {
       uint32_t offset = *(regmap + idx);
       uint32_t val = *(regmap + idx + 1);
-      mParent->xclWrite(XCL_ADDR_KERNEL_CTRL, xcu->base + offset , (void*)(&val) ,4);
+      if (!vals.empty() && offset != start + (vals.size() << 2))
+      {
+        mParent->xclWrite(XCL_ADDR_KERNEL_CTRL, xcu->base + xcu->addr + start, (void*)vals.data(), vals.size() << 2);
+        vals.clear();
+      }
+      if (vals.empty())
+        start = offset;
+      vals.push_back(val);
     }
+    if (!vals.empty())
+      mParent->xclWrite(XCL_ADDR_KERNEL_CTRL, xcu->base + xcu->addr + start, (void*)vals.data(), vals.size() << 2);
   }
 
   bool MBScheduler::cu_start(struct xocl_cu *xcu, struct xocl_cmd *xcmd)
@@ -903,7 +916,11 @@ namespace xclhwemhal2 {
     }
     if(bSchComeOutOfCond)
     {
+      // signal under state_lock so the wakeup cannot fall between the
+      // scheduler thread's check and its wait in scheduler_idle
+      pthread_mutex_lock(&mScheduler->state_lock);
       pthread_cond_signal(&mScheduler->state_cond);
+      pthread_mutex_unlock(&mScheduler->state_lock);
       return 0;
     }
     return 1;
@@ -935,8 +952,9 @@ namespace xclhwemhal2 {
     pending_cmds.clear();
   }
 
-  void MBScheduler::scheduler_iterate_cmds()
+  bool MBScheduler::scheduler_iterate_cmds()
   {
+     bool progress = false;
      auto end = mScheduler->command_queue.end();
 #ifdef EM_DEBUG_KDS
      //if(mScheduler->command_queue.size() > 0)
@@ -951,6 +969,7 @@ namespace xclhwemhal2 {
          std::cout<<xcmd << " is in QUEUED state  "<< std::endl;
 #endif
          queued_to_running(xcmd);
+         progress |= (xcmd->state != ERT_CMD_STATE_QUEUED);
        }
        if (xcmd->state == ERT_CMD_STATE_RUNNING)
        {
@@ -965,35 +984,70 @@ namespace xclhwemhal2 {
          complete_to_free(xcmd);
          itr = mScheduler->command_queue.erase(itr);
          end = mScheduler->command_queue.end();
+         progress = true;
        }
        else {
          ++itr;
        }
      }
+     return progress;
+  }
+
+  // Wait for the next scheduler pass. With nothing queued the thread sleeps
+  // until add_cmd or fini_scheduler_thread signals state_cond. While commands
+  // run without completing, every pass costs status register RPCs to the
+  // simulator, so the poll interval backs off from 10us up to 1ms. A new
+  // command still wakes the thread right away.
+  void MBScheduler::scheduler_idle(bool progress, unsigned int& backoff_us)
+  {
+    const unsigned int min_backoff_us = 10;
+    const unsigned int max_backoff_us = 1000;
 
+    pthread_mutex_lock(&mScheduler->state_lock);
+    if (!mScheduler->stop && !mScheduler->error && num_pending == 0)
+    {
+      if (mScheduler->command_queue.empty())
+      {
+        backoff_us = 0;
+        pthread_cond_wait(&mScheduler->state_cond, &mScheduler->state_lock);
+      }
+      else
+      {
+        backoff_us = progress ? min_backoff_us : std::min(std::max(backoff_us * 2, min_backoff_us), max_backoff_us);
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        uint64_t deadline_us = now.tv_sec * 1000000ull + now.tv_usec + backoff_us;
+        struct timespec deadline;
+        deadline.tv_sec = deadline_us / 1000000;
+        deadline.tv_nsec = (deadline_us % 1000000) * 1000;
+        pthread_cond_timedwait(&mScheduler->state_cond, &mScheduler->state_lock, &deadline);
+      }
+    }
+    pthread_mutex_unlock(&mScheduler->state_lock);
   }
 
-  void scheduler_loop(xocl_sched *xs)
+  bool scheduler_loop(xocl_sched *xs)
   {
     MBScheduler* pSch = xs->pSch;
     std::lock_guard<std::mutex> lk(pSch->pending_cmds_mutex);
 
-    if (xs->error) { return; }
+    if (xs->error) { return false; }
 
     /* queue new pending commands */
     pSch->scheduler_queue_cmds();
 
     /* iterate all commands */
-    pSch->scheduler_iterate_cmds();
+    return pSch->scheduler_iterate_cmds();
   }
 
   void* scheduler(void* data)
   {
     xocl_sched *xs = (xocl_sched *)data;
+    unsigned int backoff_us = 0;
     while (!xs->stop && !xs->error)
     {
-      scheduler_loop(xs);
-      usleep(10);
+      bool progress = scheduler_loop(xs);
+      xs->pSch->scheduler_idle(progress, backoff_us);
     }
     return NULL;
   }
@@ -166,7 +166,8 @@ namespace xclhwemhal2 {
     int add_cmd(exec_core *exec, xclemulation::drm_xocl_bo* bo) ;
     int scheduler_wait_condition() ;
     void scheduler_queue_cmds();
-    void scheduler_iterate_cmds();
+    bool scheduler_iterate_cmds();
+    void scheduler_idle(bool progress, unsigned int& backoff_us);
     int get_free_cu(struct xocl_cmd *xcmd);
     void configure_cu(struct xocl_cmd *xcmd, int cu_idx);
     bool cu_done(struct exec_core *exec, unsigned int cu_idx);
@@ -182,7 +183,7 @@ namespace xclhwemhal2 {
     bool cu_ready(xocl_cu *xcu);
     bool cu_start(xocl_cu *xcu, xocl_cmd *xcmd);
 
-    friend void scheduler_loop(xocl_sched *xs);
+    friend bool scheduler_loop(xocl_sched *xs);
     friend void* scheduler(void* data) ;
 
     int init_scheduler_thread(void) ;
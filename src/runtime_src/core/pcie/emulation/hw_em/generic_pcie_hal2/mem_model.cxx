@@ -19,9 +19,13 @@
 mem_model::~ mem_model()
 {
   serialize();
+  for (pageCacheItr=pageCache.begin(); pageCacheItr != pageCache.end(); ++pageCacheItr)
+    munmap(pageCacheItr->second, PAGESIZE);
 }
 
 mem_model::mem_model(std::string deviceName):
+  mLastPageIdx(0),
+  mLastPage(NULL),
   mDeviceName(deviceName),
   module_name("dr_wrapper_dr_i_sdaccel_generic_pcie_0.sdaccel_generic_pcie_model.ddrx_top_tlm_model_0.axi_app_tlm_model_0")
 {
@@ -37,7 +41,7 @@ mem_model::mem_model(std::string deviceName):
       while(written_bytes < size){
           uint64_t src_offset = written_bytes;
 
-          unsigned char* page_ptr  = get_page(addr);
+          unsigned char* page_ptr  = get_page(addr, true);
           uint64_t       page_addr = addr & ~(-1 << ADDRBITS);
 
           unsigned char* dest_buf_ptr = page_ptr + page_addr;
@@ -84,10 +88,9 @@ mem_model::mem_model(std::string deviceName):
 	  while(read_bytes < size){
 		  uint64_t dest_offset = read_bytes;
 
-		  unsigned char* page_ptr  = get_page(addr);
+		  unsigned char* page_ptr  = get_page(addr, false);
 		  uint64_t       page_addr = addr & ~(-1 << ADDRBITS);
 
-		  unsigned char* src_buf_ptr = page_ptr + page_addr;
 		  unsigned char* dest_buf_ptr  = (unsigned char*)(dest)      + dest_offset;
 
 		  uint64_t remaining_bytes_to_read = size - read_bytes;
@@ -101,7 +104,10 @@ mem_model::mem_model(std::string deviceName):
 		  }else{
 			  buf_size = bytes_upto_next_alignment;
 		  }
-	  memcpy(dest_buf_ptr,src_buf_ptr,buf_size);
+		  if(page_ptr)
+			  memcpy(dest_buf_ptr,page_ptr + page_addr,buf_size);
+		  else
+			  memset(dest_buf_ptr,0,buf_size);
 		  read_bytes += buf_size;
 		  addr += buf_size;
 	  }
@@ -118,36 +124,45 @@ mem_model::mem_model(std::string deviceName):
 
 	  return 0;
   }
-  unsigned char* mem_model::get_page(uint64_t offset) {
+  unsigned char* mem_model::get_page(uint64_t offset, bool create) {
 	  uint64_t page_idx = offset >> ADDRBITS;
-	  std::string file_name = get_mem_file_name(page_idx);
-	  if(pageCache.size() > N_1MBARRAYS)
+	  if(mLastPage && mLastPageIdx == page_idx)
+		  return mLastPage;
+
+	  unsigned char* page = NULL;
+	  pageCacheItr = pageCache.find(page_idx);
+	  if(pageCacheItr != pageCache.end())
 	  {
-		  std::cerr << "Out of Memory. DDR model does not support this much of memory\n";
-		  exit(1);
+		  page = pageCacheItr->second;
 	  } else {
-      FILE* pFile = NULL;
-		  if(pageCache.find(page_idx) != pageCache.end())
+		  std::string file_name = get_mem_file_name(page_idx);
+		  FILE* pFile = fopen(file_name.c_str(),"r");
+		  if(!pFile && !create)
+			  return NULL;
+
+		  void* mem = mmap(NULL, PAGESIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		  if(mem == MAP_FAILED)
 		  {
-			  return pageCache[page_idx];
-		  } else if(((pFile = fopen(file_name.c_str(),"r")) != NULL)) {
+			  std::cerr << "Out of Memory. DDR model does not support this much of memory\n";
+			  exit(1);
+		  }
+		  page = (unsigned char*)mem;
+		  if(pFile) {
 			  int fhandle = fileno(pFile);
 
 			  if (deserialize_msg.ParseFromFileDescriptor(fhandle) == false)
-        {
-          fclose(pFile);
-          exit(1);
-        }
-			  pageCache[page_idx] = new unsigned char[PAGESIZE];
-
-			  memcpy(pageCache[page_idx],deserialize_msg.data().c_str(),PAGESIZE);
+			  {
+				  fclose(pFile);
+				  exit(1);
+			  }
+			  memcpy(page,deserialize_msg.data().c_str(),PAGESIZE);
 			  fclose(pFile);
-			  return pageCache[page_idx];
-		  } else {
-			  pageCache[page_idx] = new unsigned char[PAGESIZE];
-			  return pageCache[page_idx];
 		  }
+		  pageCache[page_idx] = page;
 	  }
+	  mLastPageIdx = page_idx;
+	  mLastPage = page;
+	  return page;
   }
 
 
@@ -180,6 +195,9 @@ mem_model::mem_model(std::string deviceName):
  std::string mem_model::get_mem_file_name(uint64_t pageIdx)
  {
    std::string file_name("");
+   if(mMemFilePath.empty() == false)
+     return mMemFilePath + module_name + "_" + std::to_string(pageIdx);
+
    std::string user("");
    char* cUser = getenv("USER");
    if(cUser)
@@ -199,6 +217,7 @@ mem_model::mem_model(std::string deviceName):
      int rV = system(mkdirCommand.str().c_str());
      if(rV == -1) {std::cout<<"unable to open/create mem file"<<std::endl;}
    }
+    mMemFilePath = file_path;
     file_name = file_path + module_name + "_" + std::to_string(pageIdx);
 #ifdef DEBUGMSG
       cout<<"ddr fmodel file_name: "<< file_name<<endl;
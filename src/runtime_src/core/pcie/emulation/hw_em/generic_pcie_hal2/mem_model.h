@@ -23,6 +23,8 @@
 #include <sstream> // memcpy
 #include <stdlib.h> //realloc
 #include <map> //realloc
+#include <unordered_map>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -33,7 +35,6 @@
 #define ONE_MB (ONE_KB * ONE_KB)
 #define PAGESIZE (ONE_MB)
 #define ADDRBITS (20)
-#define N_1MBARRAYS 4096
 
 class mem_model{
 public:
@@ -42,10 +43,16 @@ unsigned int readDevMem(uint64_t offset, void* dest, unsigned int size);
 
 protected:
 private:
-  unsigned char* get_page(uint64_t offset);
+  // Pages are lazily mapped anonymous memory, so only touched 4K pages of
+  // the emulated DDR cost host memory. A page that is neither cached nor
+  // serialized reads as zero and is only created on write.
+  unsigned char* get_page(uint64_t offset, bool create);
   std::string get_mem_file_name(uint64_t pageIdx);
-  std::map<uint64_t,unsigned char*> pageCache;
-  std::map<uint64_t,unsigned char*>::iterator pageCacheItr;
+  std::unordered_map<uint64_t,unsigned char*> pageCache;
+  std::unordered_map<uint64_t,unsigned char*>::iterator pageCacheItr;
+  uint64_t mLastPageIdx;
+  unsigned char* mLastPage;
+  std::string mMemFilePath;
 
   ddr_mem_msg serialize_msg;
   ddr_mem_msg deserialize_msg;
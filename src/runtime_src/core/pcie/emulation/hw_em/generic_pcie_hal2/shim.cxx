@@ -368,7 +368,8 @@ namespace xclhwemhal2 {
       os.close();
 
       std::string emuDataFilePath(emuDataFileName.get());
-      systemUtil::makeSystemCall(emuDataFilePath, systemUtil::systemOperation::UNZIP, binaryDirectory);
+      systemUtil::unzipCached(emuDataFilePath, args.m_emuData, args.m_emuDataSize, binaryDirectory,
+                              xclemulation::config::getInstance()->getBinaryCacheDir());
     }
 
     readDebugIpLayout(debugFileName);
@@ -501,7 +502,8 @@ namespace xclhwemhal2 {
       if (userSpecifiedSimPath.empty())
       {
         std::string _sFilePath(fileName.get());
-        systemUtil::makeSystemCall(_sFilePath, systemUtil::systemOperation::UNZIP, binaryDirectory);
+        systemUtil::unzipCached(_sFilePath, args.m_zipFile, args.m_zipFileSize, binaryDirectory,
+                                xclemulation::config::getInstance()->getBinaryCacheDir());
         systemUtil::makeSystemCall(binaryDirectory, systemUtil::systemOperation::PERMISSIONS, "777");
       }
 
@@ -644,10 +646,58 @@ namespace xclhwemhal2 {
         //std::cout<<"environment is not set properly"<<std::endl;
       }
     }
+    if (sock)
+      setupSharedMemoryCopy();
 
     return 0;
   }
 
+  void HwEmShim::setupSharedMemoryCopy()
+  {
+    if (!xclemulation::config::getInstance()->isSharedMemoryCopyEnabled() || mShmBuf)
+      return;
+
+    // Copies are chunked in unsigned int sizes
+    mShmSize = std::min<uint64_t>(xclemulation::config::getInstance()->getSharedMemoryCopySize(), xclemulation::MEMSIZE_2G);
+    mShmName = "/xrt_hw_em_" + deviceName + "_" + std::to_string(getpid());
+    int fd = shm_open(mShmName.c_str(), O_CREAT | O_RDWR, 0600);
+    if (fd == -1 || ftruncate(fd, mShmSize) == -1) {
+      if (fd != -1) {
+        close(fd);
+        shm_unlink(mShmName.c_str());
+      }
+      std::string dMsg = "WARNING: [HW-EM 10] Unable to create shared memory for buffer copies, using RPC copies";
+      logMessage(dMsg, 0);
+      return;
+    }
+    void* shmBuf = mmap(NULL, mShmSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (shmBuf == MAP_FAILED) {
+      shm_unlink(mShmName.c_str());
+      std::string dMsg = "WARNING: [HW-EM 10] Unable to map shared memory for buffer copies, using RPC copies";
+      logMessage(dMsg, 0);
+      return;
+    }
+    mShmBuf = shmBuf;
+
+    bool ack = false;
+    xclSetupSharedMemory_RPC_CALL(xclSetupSharedMemory, mShmName, mShmSize);
+    if (!ack) {
+      std::string dMsg = "WARNING: [HW-EM 10] Simulator does not support shared memory buffer copies, using RPC copies";
+      logMessage(dMsg, 0);
+      releaseSharedMemoryCopy();
+    }
+  }
+
+  void HwEmShim::releaseSharedMemoryCopy()
+  {
+    if (!mShmBuf)
+      return;
+    munmap(mShmBuf, mShmSize);
+    shm_unlink(mShmName.c_str());
+    mShmBuf = NULL;
+  }
+
    size_t HwEmShim::xclWrite(xclAddressSpace space, uint64_t offset, const void *hostBuf, size_t size) {
 
      if (!simulator_started)
@@ -897,7 +947,9 @@ uint32_t HwEmShim::getAddressSpace (uint32_t topology)
     logMessage(dMsg,1);
     void *handle = this;
 
-    unsigned int messageSize = xclemulation::config::getInstance()->getPacketSize();
+    // With shared memory the RPC only carries the address, so chunks are as
+    // large as the segment
+    unsigned int messageSize = mShmBuf ? mShmSize : xclemulation::config::getInstance()->getPacketSize();
     unsigned int c_size = messageSize;
     unsigned int processed_bytes = 0;
     while(processed_bytes < size){
@@ -913,7 +965,11 @@ uint32_t HwEmShim::getAddressSpace (uint32_t topology)
       // TODO: Windows build support
       // *_RPC_CALL uses unix_socket
       uint32_t space = getAddressSpace(topology);
-      xclCopyBufferHost2Device_RPC_CALL(xclCopyBufferHost2Device,handle,c_dest,c_src,c_size,seek,space);
+      if (mShmBuf) {
+        xclCopyBufferHost2DeviceShm_RPC_CALL(xclCopyBufferHost2DeviceShm,c_dest,c_src,c_size,space);
+      } else {
+        xclCopyBufferHost2Device_RPC_CALL(xclCopyBufferHost2Device,handle,c_dest,c_src,c_size,seek,space);
+      }
 #endif
       processed_bytes += c_size;
     }
@@ -945,7 +1001,7 @@ uint32_t HwEmShim::getAddressSpace (uint32_t topology)
     logMessage(dMsg,1);
     void *handle = this;
 
-    unsigned int messageSize = xclemulation::config::getInstance()->getPacketSize();
+    unsigned int messageSize = mShmBuf ? mShmSize : xclemulation::config::getInstance()->getPacketSize();
     unsigned int c_size = messageSize;
     unsigned int processed_bytes = 0;
 
@@ -960,7 +1016,11 @@ uint32_t HwEmShim::getAddressSpace (uint32_t topology)
       uint64_t c_src = src + processed_bytes;
 #ifndef _WINDOWS
       uint32_t space = getAddressSpace(topology);
-      xclCopyBufferDevice2Host_RPC_CALL(xclCopyBufferDevice2Host,handle,c_dest,c_src,c_size,skip,space);
+      if (mShmBuf) {
+        xclCopyBufferDevice2HostShm_RPC_CALL(xclCopyBufferDevice2HostShm,c_dest,c_src,c_size,space);
+      } else {
+        xclCopyBufferDevice2Host_RPC_CALL(xclCopyBufferDevice2Host,handle,c_dest,c_src,c_size,skip,space);
+      }
 #endif
 
       processed_bytes += c_size;
@@ -1319,6 +1379,7 @@ uint32_t HwEmShim::getAddressSpace (uint32_t topology)
       saveWaveDataBase();
     }
     //ProfilerStop();
+    releaseSharedMemoryCopy();
     delete sock;
     sock = NULL;
     PRINTENDFUNC;
@@ -1343,6 +1404,7 @@ uint32_t HwEmShim::getAddressSpace (uint32_t topology)
   }
 
   HwEmShim::~HwEmShim() {
+    releaseSharedMemoryCopy();
     free(ci_buf);
     free(ri_buf);
     free(buf);
@@ -1459,6 +1521,8 @@ uint32_t HwEmShim::getAddressSpace (uint32_t topology)
     last_clk_time = clock();
     mCloseAll = false;
     mMemModel = NULL;
+    mShmBuf = NULL;
+    mShmSize = 0;
 
     // Delete detailed kernel trace data mining results file
     // NOTE: do this only if we're going to write a new one
@@ -186,6 +186,8 @@ using addr_type = uint64_t;
       void set_simulator_started(bool val){ simulator_started = val;}
       void fillDeviceInfo(xclDeviceInfo2* dest, xclDeviceInfo2* src);
       void saveWaveDataBase();
+      void setupSharedMemoryCopy();
+      void releaseSharedMemoryCopy();
 
       // Sanity checks
       static HwEmShim *handleCheck(void *handle);
@@ -285,6 +287,10 @@ using addr_type = uint64_t;
       clock_t last_clk_time;
       bool mCloseAll;
       mem_model* mMemModel;
+      // Shared memory segment for buffer copies with the simulator
+      std::string mShmName;
+      void* mShmBuf;
+      size_t mShmSize;
       bool bUnified;
       bool bXPR;
       //MemTopology topology;
@@ -27,6 +27,9 @@
 #include <unistd.h>
 #include <algorithm>
 #include <mutex>
+#include <atomic>
+#include <thread>
+#include <system_error>
 #include <sys/stat.h>
 #include <sys/file.h>
 #include <poll.h>
@@ -89,8 +92,26 @@ std::string pcidev::pci_device::get_sysfs_path(const std::string& subdev,
     const std::string& entry)
 {
     std::string subdir;
-    if (get_subdev_dir_name(sysfs_root + sysfs_name, subdev, subdir) != 0)
-        return "";
+    const std::string dir = sysfs_root + sysfs_name;
+
+    // Finding a subdevice reads the name of every entry under the device
+    // directory, so remember where it was. Subdevices come and go across
+    // resets, hence the existence check before trusting the cache.
+    if (!subdev.empty()) {
+        std::lock_guard<std::mutex> l(subdev_lock);
+        struct stat st;
+        auto it = subdev_dirs.find(subdev);
+        if (it != subdev_dirs.end() &&
+            stat((dir + "/" + it->second).c_str(), &st) == 0) {
+            subdir = it->second;
+        } else {
+            if (get_subdev_dir_name(dir, subdev, subdir) != 0) {
+                subdev_dirs.erase(subdev);
+                return "";
+            }
+            subdev_dirs[subdev] = subdir;
+        }
+    }
 
     std::string path = sysfs_root;
     path += sysfs_name;
@@ -571,10 +592,40 @@ static bool is_in_use(std::vector<std::shared_ptr<pcidev::pci_device>>& vec)
     return false;
 }
 
+// Probing a function is a handful of sysfs reads. Hosts with many cards
+// (and many other PCI functions) probe in parallel to keep xclProbe flat.
+static const unsigned max_scan_threads = 16;
+
+static std::vector<std::shared_ptr<pcidev::pci_device>>
+probe_devices(const std::vector<std::string>& names)
+{
+    std::vector<std::shared_ptr<pcidev::pci_device>> devs(names.size());
+    std::atomic<size_t> next(0);
+    auto worker = [&] {
+        for (size_t i = next++; i < names.size(); i = next++)
+            devs[i] = std::make_shared<pcidev::pci_device>(names[i]);
+    };
+
+    unsigned nthreads = std::min<size_t>(names.size(),
+        std::min(max_scan_threads, std::max(1u, std::thread::hardware_concurrency())));
+    std::vector<std::thread> threads;
+    try {
+        for (unsigned i = 1; i < nthreads; i++)
+            threads.emplace_back(worker);
+    } catch (const std::system_error&) {
+        // Out of threads, probe with what we have
+    }
+    worker();
+    for (auto& t : threads)
+        t.join();
+    return devs;
+}
+
 void pci_device_scanner::pci_device_scanner::rescan_nolock()
 {
     DIR *dir;
     struct dirent *entry;
+    std::vector<std::string> names;
 
     if (is_in_use(user_list) || is_in_use(mgmt_list)) {
         std::cout << "Device list is in use, can't rescan" << std::endl;
@@ -583,6 +634,8 @@ void pci_device_scanner::pci_device_scanner::rescan_nolock()
 
     user_list.clear();
     mgmt_list.clear();
+    num_user_ready = 0;
+    num_mgmt_ready = 0;
 
     dir = opendir(sysfs_root.c_str());
     if(!dir) {
@@ -591,8 +644,13 @@ void pci_device_scanner::pci_device_scanner::rescan_nolock()
     }
 
     while((entry = readdir(dir))) {
-        auto pf = std::make_shared<pcidev::pci_device>(
-            std::string(entry->d_name));
+        if (entry->d_name[0] != '.')
+            names.emplace_back(entry->d_name);
+    }
+    (void) closedir(dir);
+
+    // Lists are built in directory order, as before
+    for (auto& pf : probe_devices(names)) {
         if(pf->domain == INVALID_ID)
             continue;
 
@@ -605,8 +663,6 @@ void pci_device_scanner::pci_device_scanner::rescan_nolock()
             list->push_back(pf);
         }
     }
-
-    (void) closedir(dir);
 }
 
 
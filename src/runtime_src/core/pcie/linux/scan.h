@@ -19,6 +19,7 @@
 
 #include <string>
 #include <vector>
+#include <map>
 #include <memory>
 #include <sys/mman.h>
 #include <sys/ioctl.h>
@@ -101,6 +102,9 @@ private:
     int devfs_open_and_map(void);
 
     std::mutex lock;
+    // Subdevice name to sysfs directory, resolved on first use
+    std::mutex subdev_lock;
+    std::map<std::string, std::string> subdev_dirs;
     int dev_handle = -1;
     char *user_bar_map = reinterpret_cast<char *>(MAP_FAILED);
 };
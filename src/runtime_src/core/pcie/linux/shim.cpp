@@ -24,13 +24,17 @@
 #include "core/common/scheduler.h"
 #include "core/common/bo_cache.h"
 #include "core/common/config_reader.h"
+#include "core/common/probe.h"
 #include "xclbin.h"
 #include "ert.h"
 
 #include "core/pcie/driver/linux/include/mgmt-reg.h"
+#include "core/pcie/driver/linux/include/mailbox_proto.h"
 
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
+#include <atomic>
 #include <fstream>
 #include <sstream>
 #include <vector>
@@ -64,6 +68,8 @@
 #define ARRAY_SIZE(x)   (sizeof (x) / sizeof (x[0]))
 
 #define SHIM_QDMA_AIO_EVT_MAX   1024 * 64
+#define SHIM_QDMA_URING_ENTRIES 4096
+#define SHIM_QDMA_AIO_QUEUE_EVT_MAX 4096
 
 inline bool
 is_multiprocess_mode()
@@ -78,6 +84,25 @@ static inline void errlog(std::string& errstr)
         "XRT", errstr.c_str());
 }
 
+/*
+ * dmaFlags()
+ *
+ * Ask the driver to poll for completion of transfers small enough that
+ * the DMA interrupt latency dominates, and to hand small transfers a
+ * DMA channel ahead of bulk transfers.
+ */
+static inline uint32_t dmaFlags(size_t size)
+{
+    static unsigned threshold = xrt_core::config::get_dma_poll_threshold();
+    static unsigned prio_threshold = xrt_core::config::get_dma_prio_threshold();
+    uint32_t flags = 0;
+    if (size && size <= threshold)
+        flags |= DRM_XOCL_DMA_POLL;
+    if (size && size <= prio_threshold)
+        flags |= DRM_XOCL_DMA_PRIO;
+    return flags;
+}
+
 /*
  * numClocks()
  */
@@ -163,7 +188,12 @@ int shim::dev_init()
 	    return -errno;
 
     memset(&mAioContext, 0, sizeof(mAioContext));
-    mAioEnabled = (io_setup(SHIM_QDMA_AIO_EVT_MAX, &mAioContext) == 0);
+    if (xrt_core::config::get_stream_io() == "uring")
+        mUring = uring::create(SHIM_QDMA_URING_ENTRIES, xrt_core::config::get_stream_uring_sqpoll());
+    if (mUring)
+        mAioEnabled = true;
+    else
+        mAioEnabled = (io_setup(SHIM_QDMA_AIO_EVT_MAX, &mAioContext) == 0);
 
     return 0;
 }
@@ -176,9 +206,21 @@ void shim::dev_fini()
     }
 
     if (mAioEnabled) {
-        io_destroy(mAioContext);
-            mAioEnabled = false;
+        if (!mUring)
+            io_destroy(mAioContext);
+        mAioEnabled = false;
+    }
+    mUring.reset();
+
+    std::lock_guard<std::mutex> lk(mAioLock);
+    for (auto& q : mAioQueueCtx) {
+        if (!q.second->ring)
+            io_destroy(q.second->ctx);
+        for (auto req : q.second->busy)
+            delete req;
     }
+    mAioQueueCtx.clear();
+    mAioFreeReqs.clear();
 }
 
 /*
@@ -209,11 +251,26 @@ void shim::init(unsigned index, const char *logfileName,
  */
 shim::~shim()
 {
+    // A pending download uses the device, let it finish first
+    if (mLoad.valid())
+        mLoad.wait();
+
     if (mLogStream.is_open()) {
         mLogStream << __func__ << ", " << std::this_thread::get_id() << std::endl;
         mLogStream.close();
     }
 
+    if (mRing)
+        (void) munmap(mRing, ringMapSize());
+
+    if (mUsagePage)
+        (void) munmap(const_cast<xocl_usage_page *>(mUsagePage), usageMapSize());
+
+    for (auto& hb : mHostBuffers) {
+        xclFreeBO(hb.second.bo);
+        (void) munmap(hb.first, hb.second.length);
+    }
+
     dev_fini();
 
     for (auto p : mCuMaps) {
@@ -357,7 +414,18 @@ unsigned int shim::xclAllocBO(size_t size, int unused, unsigned flags)
 {
     drm_xocl_create_bo info = {size, mNullBO, flags};
     int result = mDev->ioctl(DRM_IOCTL_XOCL_CREATE_BO, &info);
-    return result ? mNullBO : info.handle;
+    if (result)
+        return mNullBO;
+
+    if (mZeroOnAlloc) {
+        xclBOProperties prop;
+        if (!xclGetBOProperties(info.handle, &prop) && prop.paddr != mNullAddr
+            && !zeroRange(prop.paddr, prop.size)) {
+            xclFreeBO(info.handle);
+            return mNullBO;
+        }
+    }
+    return info.handle;
 }
 
 /*
@@ -371,6 +439,84 @@ unsigned int shim::xclAllocUserPtrBO(void *userptr, size_t size, unsigned flags)
     return result ? mNullBO : user.handle;
 }
 
+/*
+ * xclAllocHostBuffer()
+ *
+ * Prefers reserved 2MB huge pages. Without those the mapping is over
+ * allocated to trim it to 2MB alignment, so that transparent huge pages
+ * can back it. The NUMA policy is set before the userptr BO faults in
+ * and pins the pages.
+ */
+void *shim::xclAllocHostBuffer(size_t size, unsigned flags, unsigned int *boHandle)
+{
+    const size_t hugeSize = 2 * 1024 * 1024;
+    if (!size)
+        return nullptr;
+    size_t len = (size + hugeSize - 1) & ~(hugeSize - 1);
+
+    int hugeFlags = MAP_HUGETLB;
+#ifdef MAP_HUGE_SHIFT
+    hugeFlags |= (21 << MAP_HUGE_SHIFT);
+#endif
+    void *ptr = ::mmap(nullptr, len, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | hugeFlags, -1, 0);
+    if (ptr == MAP_FAILED) {
+        char *raw = static_cast<char *>(::mmap(nullptr, len + hugeSize, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+        if (raw == MAP_FAILED)
+            return nullptr;
+        char *start = reinterpret_cast<char *>
+            ((reinterpret_cast<uintptr_t>(raw) + hugeSize - 1) & ~(hugeSize - 1));
+        if (start > raw)
+            ::munmap(raw, start - raw);
+        if (raw + len + hugeSize > start + len)
+            ::munmap(start + len, raw + len + hugeSize - (start + len));
+        ptr = start;
+        (void) ::madvise(ptr, len, MADV_HUGEPAGE);
+    }
+
+    std::string err;
+    int node = -1;
+    mDev->sysfs_get("", "numa_node", err, node);
+    if (err.empty() && node >= 0 && node < 64) {
+        unsigned long mask = 1UL << node;
+        const int mpolPreferred = 1; // MPOL_PREFERRED, no libnuma dependency
+        (void) syscall(SYS_mbind, ptr, len, mpolPreferred, &mask, sizeof(mask) * 8 + 1, 0);
+    }
+
+    unsigned int bo = xclAllocUserPtrBO(ptr, len, flags);
+    if (bo == mNullBO) {
+        ::munmap(ptr, len);
+        return nullptr;
+    }
+
+    {
+        std::lock_guard<std::mutex> l(mHostBufferLock);
+        mHostBuffers[ptr] = {len, bo};
+    }
+    if (boHandle)
+        *boHandle = bo;
+    return ptr;
+}
+
+/*
+ * xclFreeHostBuffer()
+ */
+void shim::xclFreeHostBuffer(void *ptr)
+{
+    host_buffer hb;
+    {
+        std::lock_guard<std::mutex> l(mHostBufferLock);
+        auto it = mHostBuffers.find(ptr);
+        if (it == mHostBuffers.end())
+            return;
+        hb = it->second;
+        mHostBuffers.erase(it);
+    }
+    xclFreeBO(hb.bo);
+    ::munmap(ptr, hb.length);
+}
+
 /*
  * xclFreeBO()
  */
@@ -386,7 +532,7 @@ void shim::xclFreeBO(unsigned int boHandle)
 int shim::xclWriteBO(unsigned int boHandle, const void *src, size_t size, size_t seek)
 {
     int ret;
-    drm_xocl_pwrite_bo pwriteInfo = { boHandle, 0, seek, size, reinterpret_cast<uint64_t>(src) };
+    drm_xocl_pwrite_bo pwriteInfo = { boHandle, dmaFlags(size), seek, size, reinterpret_cast<uint64_t>(src) };
     ret = mDev->ioctl(DRM_IOCTL_XOCL_PWRITE_BO, &pwriteInfo);
     return ret ? -errno : ret;
 }
@@ -397,11 +543,49 @@ int shim::xclWriteBO(unsigned int boHandle, const void *src, size_t size, size_t
 int shim::xclReadBO(unsigned int boHandle, void *dst, size_t size, size_t skip)
 {
     int ret;
-    drm_xocl_pread_bo preadInfo = { boHandle, 0, skip, size, reinterpret_cast<uint64_t>(dst) };
+    drm_xocl_pread_bo preadInfo = { boHandle, dmaFlags(size), skip, size, reinterpret_cast<uint64_t>(dst) };
     ret = mDev->ioctl(DRM_IOCTL_XOCL_PREAD_BO, &preadInfo);
     return ret ? -errno : ret;
 }
 
+/*
+ * xclRWBOv()
+ *
+ * Falls back to one pwrite/pread per range when the driver does not
+ * support the vectored ioctls.
+ */
+int shim::xclRWBOv(unsigned int boHandle, const xclBOIovec *iov, unsigned int count, bool write)
+{
+    while (count) {
+        unsigned int n = std::min(count, static_cast<unsigned int>(DRM_XOCL_RW_BO_V_MAX));
+        std::vector<drm_xocl_bo_iovec> kiov(n);
+        size_t maxSize = 0;
+        for (unsigned int i = 0; i < n; i++) {
+            kiov[i] = { iov[i].offset, iov[i].size, reinterpret_cast<uint64_t>(iov[i].data) };
+            maxSize = std::max(maxSize, iov[i].size);
+        }
+
+        drm_xocl_rw_bo_v info = { boHandle, dmaFlags(maxSize), n, 0, reinterpret_cast<uint64_t>(kiov.data()) };
+        int ret = mDev->ioctl(write ? DRM_IOCTL_XOCL_PWRITE_BO_V : DRM_IOCTL_XOCL_PREAD_BO_V, &info);
+        if (ret && (errno == EINVAL || errno == ENOTTY)) {
+            ret = 0;
+            for (unsigned int i = 0; i < n && !ret; i++) {
+                ret = write
+                    ? xclWriteBO(boHandle, iov[i].data, iov[i].size, iov[i].offset)
+                    : xclReadBO(boHandle, iov[i].data, iov[i].size, iov[i].offset);
+            }
+            if (ret)
+                return ret;
+        }
+        else if (ret)
+            return -errno;
+
+        iov += n;
+        count -= n;
+    }
+    return 0;
+}
+
 /*
  * xclMapBO()
  */
@@ -432,11 +616,69 @@ int shim::xclSyncBO(unsigned int boHandle, xclBOSyncDirection dir, size_t size,
     drm_xocl_sync_bo_dir drm_dir = (dir == XCL_BO_SYNC_BO_TO_DEVICE) ?
             DRM_XOCL_SYNC_BO_TO_DEVICE :
             DRM_XOCL_SYNC_BO_FROM_DEVICE;
-    drm_xocl_sync_bo syncInfo = {boHandle, 0, size, offset, drm_dir};
+    drm_xocl_sync_bo syncInfo = {boHandle, dmaFlags(size), size, offset, drm_dir};
     ret = mDev->ioctl(DRM_IOCTL_XOCL_SYNC_BO, &syncInfo);
     return ret ? -errno : ret;
 }
 
+/*
+ * xclSyncBOAsync()
+ */
+int shim::xclSyncBOAsync(unsigned int boHandle, xclBOSyncDirection dir, size_t size, size_t offset,
+    int efd, uint64_t *fence)
+{
+    drm_xocl_sync_bo_dir drm_dir = (dir == XCL_BO_SYNC_BO_TO_DEVICE) ?
+            DRM_XOCL_SYNC_BO_TO_DEVICE :
+            DRM_XOCL_SYNC_BO_FROM_DEVICE;
+    drm_xocl_sync_bo_async syncInfo = {boHandle, efd, size, offset, drm_dir, 0};
+    int ret = mDev->ioctl(DRM_IOCTL_XOCL_SYNC_BO_ASYNC, &syncInfo);
+    if (ret)
+        return (errno == EINVAL || errno == ENOTTY) ? -ENOSYS : -errno;
+    *fence = syncInfo.fence;
+    return 0;
+}
+
+/*
+ * xclSyncBOWait()
+ */
+int shim::xclSyncBOWait(uint64_t fence, int timeoutMilliSec)
+{
+    drm_xocl_sync_bo_wait waitInfo = {fence, timeoutMilliSec, 0};
+    int ret = mDev->ioctl(DRM_IOCTL_XOCL_SYNC_BO_WAIT, &waitInfo);
+    return ret ? -errno : waitInfo.status;
+}
+
+/*
+ * xclSyncBOBatch()
+ *
+ * Queue all transfers first, then retire the fences. Falls back on
+ * synchronous xclSyncBO() if the driver has no asynchronous sync.
+ */
+int shim::xclSyncBOBatch(const xclBOSyncItem *items, unsigned int count)
+{
+    std::vector<uint64_t> fences;
+    fences.reserve(count);
+    int err = 0;
+    for (unsigned int i = 0; i < count; ++i) {
+        const xclBOSyncItem& item = items[i];
+        uint64_t fence = 0;
+        int ret = xclSyncBOAsync(item.boHandle, item.dir, item.size, item.offset, -1, &fence);
+        if (ret == -ENOSYS)
+            ret = xclSyncBO(item.boHandle, item.dir, item.size, item.offset);
+        else if (!ret)
+            fences.push_back(fence);
+        if (ret && !err)
+            err = ret;
+    }
+
+    for (auto fence : fences) {
+        int ret = xclSyncBOWait(fence, -1);
+        if (ret && !err)
+            err = ret;
+    }
+    return err;
+}
+
 /*
  * xclCopyBO()
  */
@@ -468,6 +710,55 @@ int shim::xclCopyBO(unsigned int dst_bo_handle,
     return ret;
 }
 
+/*
+ * xclCopyBOPeer()
+ *
+ * Copy between BOs owned by this (dst) and another (src) device.  The
+ * P2P BO is exported to the peer device and the copy is scheduled on
+ * the peer so that its DMA engine moves the data directly across the
+ * PCIe fabric.  Writing into the P2P BAR of the destination is
+ * preferred over reading from the P2P BAR of the source.
+ */
+int shim::xclCopyBOPeer(unsigned int dst_bo_handle, shim *src_drv,
+    unsigned int src_bo_handle, size_t size, size_t dst_offset,
+    size_t src_offset)
+{
+    if (src_drv == this)
+        return xclCopyBO(dst_bo_handle, src_bo_handle, size, dst_offset, src_offset);
+
+    xclBOProperties prop;
+    bool dst_p2p = false;
+    bool src_p2p = false;
+    if (!xclGetBOProperties(dst_bo_handle, &prop))
+        dst_p2p = prop.flags & XCL_BO_FLAGS_P2P;
+    if (!dst_p2p && !src_drv->xclGetBOProperties(src_bo_handle, &prop))
+        src_p2p = prop.flags & XCL_BO_FLAGS_P2P;
+    if (!dst_p2p && !src_p2p)
+        return -EOPNOTSUPP;
+
+    // Device exporting its P2P BO and device running the copy
+    shim *exporter = dst_p2p ? this : src_drv;
+    shim *copier = dst_p2p ? src_drv : this;
+
+    int fd = exporter->xclExportBO(dst_p2p ? dst_bo_handle : src_bo_handle);
+    if (fd < 0)
+        return fd;
+
+    unsigned int import_bo = copier->xclImportBO(fd, 0);
+    if (import_bo == mNullBO) {
+        close(fd);
+        return -EINVAL;
+    }
+
+    int ret = dst_p2p
+        ? copier->xclCopyBO(import_bo, src_bo_handle, size, dst_offset, src_offset)
+        : copier->xclCopyBO(dst_bo_handle, import_bo, size, dst_offset, src_offset);
+
+    copier->xclFreeBO(import_bo);
+    close(fd);
+    return ret;
+}
+
 /*
  * xclSysfsGetErrorStatus()
  */
@@ -531,33 +822,70 @@ void shim::xclSysfsGetDeviceInfo(xclDeviceInfo2 *info)
     info->mNumClocks = numClocks(info->mName);
 
     mDev->sysfs_get("mb_scheduler", "kds_numcdmas", errmsg, info->mNumCDMA);
-    mDev->sysfs_get("xmc", "xmc_12v_pex_vol", errmsg, info->m12VPex);
-    mDev->sysfs_get("xmc", "xmc_12v_aux_vol", errmsg, info->m12VAux);
-    mDev->sysfs_get("xmc", "xmc_12v_pex_curr", errmsg, info->mPexCurr);
-    mDev->sysfs_get("xmc", "xmc_12v_aux_curr", errmsg, info->mAuxCurr);
-    mDev->sysfs_get("xmc", "xmc_dimm_temp0", errmsg, info->mDimmTemp[0]);
-    mDev->sysfs_get("xmc", "xmc_dimm_temp1", errmsg, info->mDimmTemp[1]);
-    mDev->sysfs_get("xmc", "xmc_dimm_temp2", errmsg, info->mDimmTemp[2]);
-    mDev->sysfs_get("xmc", "xmc_dimm_temp3", errmsg, info->mDimmTemp[3]);
-    mDev->sysfs_get("xmc", "xmc_se98_temp0", errmsg, info->mSE98Temp[0]);
-    mDev->sysfs_get("xmc", "xmc_se98_temp1", errmsg, info->mSE98Temp[1]);
-    mDev->sysfs_get("xmc", "xmc_se98_temp2", errmsg, info->mSE98Temp[2]);
-    mDev->sysfs_get("xmc", "xmc_fan_temp", errmsg, info->mFanTemp);
-    mDev->sysfs_get("xmc", "xmc_fan_rpm", errmsg, info->mFanRpm);
-    mDev->sysfs_get("xmc", "xmc_3v3_pex_vol", errmsg, info->m3v3Pex);
-    mDev->sysfs_get("xmc", "xmc_3v3_aux_vol", errmsg, info->m3v3Aux);
-    mDev->sysfs_get("xmc", "xmc_ddr_vpp_btm", errmsg, info->mDDRVppBottom);
-    mDev->sysfs_get("xmc", "xmc_ddr_vpp_top", errmsg, info->mDDRVppTop);
-    mDev->sysfs_get("xmc", "xmc_sys_5v5", errmsg, info->mSys5v5);
-    mDev->sysfs_get("xmc", "xmc_1v2_top", errmsg, info->m1v2Top);
-    mDev->sysfs_get("xmc", "xmc_1v8", errmsg, info->m1v8Top);
-    mDev->sysfs_get("xmc", "xmc_0v85", errmsg, info->m0v85);
-    mDev->sysfs_get("xmc", "xmc_mgt0v9avcc", errmsg, info->mMgt0v9);
-    mDev->sysfs_get("xmc", "xmc_12v_sw", errmsg, info->m12vSW);
-    mDev->sysfs_get("xmc", "xmc_mgtavtt", errmsg, info->mMgtVtt);
-    mDev->sysfs_get("xmc", "xmc_vcc1v2_btm", errmsg, info->m1v2Bottom);
-    mDev->sysfs_get("xmc", "xmc_vccint_vol", errmsg, info->mVccIntVol);
-    mDev->sysfs_get("xmc", "xmc_fpga_temp", errmsg, info->mOnChipTemp);
+
+    // All XMC sensors in one read, fall back to one file per sensor on
+    // drivers without the snapshot node.
+    std::vector<char> snapshot;
+    mDev->sysfs_get("xmc", "sensor_snapshot", errmsg, snapshot);
+    if (errmsg.empty() && snapshot.size() >= sizeof(xcl_sensor)) {
+        xcl_sensor s;
+        std::memcpy(&s, snapshot.data(), sizeof(s));
+        info->m12VPex = s.vol_12v_pex;
+        info->m12VAux = s.vol_12v_aux;
+        info->mPexCurr = s.cur_12v_pex;
+        info->mAuxCurr = s.cur_12v_aux;
+        info->mDimmTemp[0] = s.dimm_temp0;
+        info->mDimmTemp[1] = s.dimm_temp1;
+        info->mDimmTemp[2] = s.dimm_temp2;
+        info->mDimmTemp[3] = s.dimm_temp3;
+        info->mSE98Temp[0] = s.se98_temp0;
+        info->mSE98Temp[1] = s.se98_temp1;
+        info->mSE98Temp[2] = s.se98_temp2;
+        info->mFanTemp = s.fan_temp;
+        info->mFanRpm = s.fan_rpm;
+        info->m3v3Pex = s.vol_3v3_pex;
+        info->m3v3Aux = s.vol_3v3_aux;
+        info->mDDRVppBottom = s.ddr_vpp_btm;
+        info->mDDRVppTop = s.ddr_vpp_top;
+        info->mSys5v5 = s.sys_5v5;
+        info->m1v2Top = s.top_1v2;
+        info->m1v8Top = s.vol_1v8;
+        info->m0v85 = s.vol_0v85;
+        info->mMgt0v9 = s.mgt0v9avcc;
+        info->m12vSW = s.vol_12v_sw;
+        info->mMgtVtt = s.mgtavtt;
+        info->m1v2Bottom = s.vcc1v2_btm;
+        info->mVccIntVol = s.vccint_vol;
+        info->mOnChipTemp = s.fpga_temp;
+    } else {
+        mDev->sysfs_get("xmc", "xmc_12v_pex_vol", errmsg, info->m12VPex);
+        mDev->sysfs_get("xmc", "xmc_12v_aux_vol", errmsg, info->m12VAux);
+        mDev->sysfs_get("xmc", "xmc_12v_pex_curr", errmsg, info->mPexCurr);
+        mDev->sysfs_get("xmc", "xmc_12v_aux_curr", errmsg, info->mAuxCurr);
+        mDev->sysfs_get("xmc", "xmc_dimm_temp0", errmsg, info->mDimmTemp[0]);
+        mDev->sysfs_get("xmc", "xmc_dimm_temp1", errmsg, info->mDimmTemp[1]);
+        mDev->sysfs_get("xmc", "xmc_dimm_temp2", errmsg, info->mDimmTemp[2]);
+        mDev->sysfs_get("xmc", "xmc_dimm_temp3", errmsg, info->mDimmTemp[3]);
+        mDev->sysfs_get("xmc", "xmc_se98_temp0", errmsg, info->mSE98Temp[0]);
+        mDev->sysfs_get("xmc", "xmc_se98_temp1", errmsg, info->mSE98Temp[1]);
+        mDev->sysfs_get("xmc", "xmc_se98_temp2", errmsg, info->mSE98Temp[2]);
+        mDev->sysfs_get("xmc", "xmc_fan_temp", errmsg, info->mFanTemp);
+        mDev->sysfs_get("xmc", "xmc_fan_rpm", errmsg, info->mFanRpm);
+        mDev->sysfs_get("xmc", "xmc_3v3_pex_vol", errmsg, info->m3v3Pex);
+        mDev->sysfs_get("xmc", "xmc_3v3_aux_vol", errmsg, info->m3v3Aux);
+        mDev->sysfs_get("xmc", "xmc_ddr_vpp_btm", errmsg, info->mDDRVppBottom);
+        mDev->sysfs_get("xmc", "xmc_ddr_vpp_top", errmsg, info->mDDRVppTop);
+        mDev->sysfs_get("xmc", "xmc_sys_5v5", errmsg, info->mSys5v5);
+        mDev->sysfs_get("xmc", "xmc_1v2_top", errmsg, info->m1v2Top);
+        mDev->sysfs_get("xmc", "xmc_1v8", errmsg, info->m1v8Top);
+        mDev->sysfs_get("xmc", "xmc_0v85", errmsg, info->m0v85);
+        mDev->sysfs_get("xmc", "xmc_mgt0v9avcc", errmsg, info->mMgt0v9);
+        mDev->sysfs_get("xmc", "xmc_12v_sw", errmsg, info->m12vSW);
+        mDev->sysfs_get("xmc", "xmc_mgtavtt", errmsg, info->mMgtVtt);
+        mDev->sysfs_get("xmc", "xmc_vcc1v2_btm", errmsg, info->m1v2Bottom);
+        mDev->sysfs_get("xmc", "xmc_vccint_vol", errmsg, info->mVccIntVol);
+        mDev->sysfs_get("xmc", "xmc_fpga_temp", errmsg, info->mOnChipTemp);
+    }
 
     mDev->sysfs_get("", "link_width", errmsg, info->mPCIeLinkWidth);
     mDev->sysfs_get("", "link_speed", errmsg, info->mPCIeLinkSpeed);
@@ -698,18 +1026,64 @@ bool shim::zeroOutDDR()
     // Zero out the DDR so MIG ECC believes we have touched all the bits
     // and it does not complain when we try to read back without explicit
     // write. The latter usually happens as a result of read-modify-write
-    // TODO: Try and speed this up.
-    // [1] Possibly move to kernel mode driver.
-    // [2] Zero out specific buffers when they are allocated
-
-    // TODO: Implement this
-    //  static const unsigned long long BLOCK_SIZE = 0x4000000;
-    //  void *buf = 0;
-    //  if (posix_memalign(&buf, DDR_BUFFER_ALIGNMENT, BLOCK_SIZE))
-    //      return false;
-    //  memset(buf, 0, BLOCK_SIZE);
-    //  mDataMover->pset64(buf, BLOCK_SIZE, 0, mDeviceInfo.mDDRSize/BLOCK_SIZE);
-    //  free(buf);
+    //
+    // All used banks are cleared in parallel, one thread per bank, the
+    // driver hands out the DMA channels.  With Runtime.ddr_clear=lazy
+    // only the ranges of BOs are cleared as they get allocated.
+    std::string mode = xrt_core::config::get_ddr_clear();
+    mZeroOnAlloc = (mode == "lazy");
+    if (mode != "eager")
+        return true;
+
+    std::string err;
+    std::vector<char> buf;
+    mDev->sysfs_get("icap", "mem_topology", err, buf);
+    if (!err.empty() || buf.empty())
+        return false;
+
+    const mem_topology *topo = reinterpret_cast<const mem_topology *>(buf.data());
+    std::vector<std::thread> workers;
+    std::atomic<bool> ok(true);
+    for (int i = 0; i < topo->m_count; i++) {
+        const mem_data& mem = topo->m_mem_data[i];
+        if (!mem.m_used || mem.m_type == MEM_STREAMING)
+            continue;
+        uint64_t base = mem.m_base_address;
+        uint64_t size = mem.m_size << 10;
+        workers.emplace_back([this, base, size, &ok] {
+            if (!zeroRange(base, size))
+                ok = false;
+        });
+    }
+    for (auto& t : workers)
+        t.join();
+    return ok;
+}
+
+/*
+ * zeroRange()
+ *
+ * Source of the DMA is a read only anonymous mapping that is never
+ * touched, the driver pins it read only so every page resolves to the
+ * kernel zero page.  The host side of the transfer therefore comes
+ * from one cached page no matter how much DDR is cleared.
+ */
+bool shim::zeroRange(uint64_t paddr, uint64_t size)
+{
+    static const size_t chunk = 0x4000000;
+    static void *zero = mmap(nullptr, chunk, PROT_READ,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (zero == MAP_FAILED)
+        return false;
+
+    while (size) {
+        size_t count = std::min<uint64_t>(size, chunk);
+        drm_xocl_pwrite_unmgd unmgd = {0, 0, paddr, count, reinterpret_cast<uint64_t>(zero)};
+        if (mDev->ioctl(DRM_IOCTL_XOCL_PWRITE_UNMGD, &unmgd))
+            return false;
+        paddr += count;
+        size -= count;
+    }
     return true;
 }
 
@@ -749,6 +1123,44 @@ int shim::xclLoadXclBin(const xclBin *buffer)
     return ret;
 }
 
+/*
+ * xclLoadXclBinAsync()
+ *
+ * The download and the scheduler configuration that follows it run on a
+ * library thread.  Only one asynchronous download per device is pending
+ * at a time, the driver serializes downloads anyway.
+ */
+int shim::xclLoadXclBinAsync(xclDeviceHandle handle, const xclBin *buffer)
+{
+    std::lock_guard<std::mutex> l(mLoadLock);
+    if (mLoad.valid())
+        return -EBUSY;
+
+    mLoad = std::async(std::launch::async, [this, handle, buffer] {
+        int ret = xclLoadXclBin(buffer);
+        if (!ret)
+            ret = xrt_core::scheduler::init(handle, buffer);
+        return ret;
+    });
+    return 0;
+}
+
+/*
+ * xclLoadXclBinWait()
+ */
+int shim::xclLoadXclBinWait(int timeoutMilliSec)
+{
+    std::lock_guard<std::mutex> l(mLoadLock);
+    if (!mLoad.valid())
+        return -ENOENT;
+
+    if (timeoutMilliSec >= 0 &&
+        mLoad.wait_for(std::chrono::milliseconds(timeoutMilliSec)) == std::future_status::timeout)
+        return -ETIMEDOUT;
+
+    return mLoad.get();
+}
+
 /*
  * xclLoadAxlf()
  */
@@ -818,12 +1230,13 @@ unsigned int shim::xclImportBO(int fd, unsigned flags)
  */
 int shim::xclGetBOProperties(unsigned int boHandle, xclBOProperties *properties)
 {
-    drm_xocl_info_bo info = {boHandle, 0, mNullBO, mNullAddr};
+    drm_xocl_info_bo info = {boHandle, 0, mNullBO, mNullAddr, -1, 0};
     int result = mDev->ioctl(DRM_IOCTL_XOCL_INFO_BO, &info);
     properties->handle = info.handle;
     properties->flags  = info.flags;
     properties->size   = info.size;
     properties->paddr  = info.paddr;
+    properties->numa_node = info.numa_node;
     return result ? -errno : result;
 }
 
@@ -911,15 +1324,53 @@ void shim::xclSysfsGetUsageInfo(drm_xocl_usage_stat& stat)
     }
 }
 
+size_t shim::usageMapSize() const
+{
+    size_t pgsz = getpagesize();
+    return (sizeof(xocl_usage_page) + pgsz - 1) & ~(pgsz - 1);
+}
+
+/*
+ * usageMap() - Map the driver usage page once
+ */
+const xocl_usage_page *shim::usageMap()
+{
+    std::lock_guard<std::mutex> l(mUsageLock);
+
+    if (mUsageProbed)
+        return mUsagePage;
+    mUsageProbed = true;
+
+    void *p = mDev->mmap(usageMapSize(), PROT_READ, MAP_SHARED,
+        static_cast<off_t>(XOCL_USAGE_PAGE_PGOFF) * getpagesize());
+    if (p == MAP_FAILED)
+        return nullptr;
+    mUsagePage = reinterpret_cast<const xocl_usage_page *>(p);
+    return mUsagePage;
+}
+
 /*
  * xclGetUsageInfo()
  */
 int shim::xclGetUsageInfo(xclDeviceUsage *info)
 {
     drm_xocl_usage_stat stat = { 0 };
+    const xocl_usage_page *up = usageMap();
 
-    xclSysfsGetUsageInfo(stat);
     std::memset(info, 0, sizeof(xclDeviceUsage));
+    if (up) {
+        for (int i = 0; i < 8; i++) {
+            info->h2c[i] = up->h2c[i];
+            info->c2h[i] = up->c2h[i];
+            info->ddrMemUsed[i] = up->mm[i].memory_usage;
+            info->ddrBOAllocated[i] = up->mm[i].bo_count;
+        }
+        info->dma_channel_cnt = up->dma_channel_count;
+        info->mm_channel_cnt = up->mm_channel_count;
+        return 0;
+    }
+
+    xclSysfsGetUsageInfo(stat);
     std::memcpy(info->h2c, stat.h2c, sizeof(size_t) * 8);
     std::memcpy(info->c2h, stat.c2h, sizeof(size_t) * 8);
     for (int i = 0; i < 8; i++) {
@@ -963,7 +1414,7 @@ ssize_t shim::xclUnmgdPwrite(unsigned flags, const void *buf, size_t count, uint
     if (flags) {
         return -EINVAL;
     }
-    drm_xocl_pwrite_unmgd unmgd = {0, 0, offset, count, reinterpret_cast<uint64_t>(buf)};
+    drm_xocl_pwrite_unmgd unmgd = {0, dmaFlags(count), offset, count, reinterpret_cast<uint64_t>(buf)};
     return mDev->ioctl(DRM_IOCTL_XOCL_PWRITE_UNMGD, &unmgd);
 }
 
@@ -975,7 +1426,7 @@ ssize_t shim::xclUnmgdPread(unsigned flags, void *buf, size_t count, uint64_t of
     if (flags) {
         return -EINVAL;
     }
-    drm_xocl_pread_unmgd unmgd = {0, 0, offset, count, reinterpret_cast<uint64_t>(buf)};
+    drm_xocl_pread_unmgd unmgd = {0, dmaFlags(count), offset, count, reinterpret_cast<uint64_t>(buf)};
     return mDev->ioctl(DRM_IOCTL_XOCL_PREAD_UNMGD, &unmgd);
 }
 
@@ -989,6 +1440,7 @@ int shim::xclExecBuf(unsigned int cmdBO)
         mLogStream << __func__ << ", " << std::this_thread::get_id() << ", " << cmdBO << std::endl;
     }
     drm_xocl_execbuf exec = {0, cmdBO, 0,0,0,0,0,0,0,0};
+    XRT_PROBE_SCOPE(exec_buf);
     ret = mDev->ioctl(DRM_IOCTL_XOCL_EXECBUF, &exec);
     return ret ? -errno : ret;
 }
@@ -1006,10 +1458,55 @@ int shim::xclExecBuf(unsigned int cmdBO, size_t num_bo_in_wait_list, unsigned in
     unsigned int bwl[8] = {0};
     std::memcpy(bwl,bo_wait_list,num_bo_in_wait_list*sizeof(unsigned int));
     drm_xocl_execbuf exec = {0, cmdBO, bwl[0],bwl[1],bwl[2],bwl[3],bwl[4],bwl[5],bwl[6],bwl[7]};
+    XRT_PROBE_SCOPE(exec_buf);
     ret = mDev->ioctl(DRM_IOCTL_XOCL_EXECBUF, &exec);
     return ret ? -errno : ret;
 }
 
+/*
+ * xclExecBufBatch()
+ *
+ * Falls back on one ioctl per exec buffer if driver does not support
+ * batch submission.
+ */
+int shim::xclExecBufBatch(unsigned int *cmdBOs, unsigned int count)
+{
+    if (mLogStream.is_open()) {
+        mLogStream << __func__ << ", " << std::this_thread::get_id() << ", "
+                   << cmdBOs << ", " << count << std::endl;
+    }
+    XRT_PROBE_SCOPE(exec_buf_batch);
+    unsigned int submitted = 0;
+    while (submitted < count) {
+        unsigned int chunk = std::min<unsigned int>(count - submitted, DRM_XOCL_EXECBUF_BATCH_MAX);
+        drm_xocl_execbuf_batch batch = {0, chunk, reinterpret_cast<uint64_t>(cmdBOs + submitted)};
+        int ret = mBatchUnsupported ? -1 : mDev->ioctl(DRM_IOCTL_XOCL_EXECBUF_BATCH, &batch);
+        if (ret && !mBatchUnsupported && batch.count == 0 && (errno == EINVAL || errno == ENOTTY)) {
+            // Probe first exec buffer individually, if that succeeds the
+            // driver does not know the batch ioctl
+            ret = xclExecBuf(cmdBOs[submitted]);
+            if (ret)
+                return submitted ? submitted : ret;
+            mBatchUnsupported = true;
+            ++submitted;
+            continue;
+        }
+        if (mBatchUnsupported) {
+            for (unsigned int i = 0; i < chunk; ++i) {
+                ret = xclExecBuf(cmdBOs[submitted]);
+                if (ret)
+                    return submitted ? submitted : ret;
+                ++submitted;
+            }
+            continue;
+        }
+        submitted += batch.count;
+        if (ret)
+            return submitted ? submitted : -errno;
+    }
+    return submitted;
+}
+
 /*
  * xclRegisterEventNotify()
  */
@@ -1029,10 +1526,104 @@ int shim::xclExecWait(int timeoutMilliSec)
     return mDev->poll(POLLIN, timeoutMilliSec);
 }
 
+size_t shim::ringMapSize() const
+{
+    size_t pgsz = getpagesize();
+    return (sizeof(xocl_completion_ring) + pgsz - 1) & ~(pgsz - 1);
+}
+
+/*
+ * ringMap() - Map the driver completion ring, caller must hold mRingLock
+ *
+ * Mapping is attempted once, drivers without ring support fail the mmap
+ * and completions are then retrieved with DRM_IOCTL_XOCL_EXECBUF_DONE.
+ */
+xocl_completion_ring *shim::ringMap()
+{
+    if (mRingProbed)
+        return mRing;
+    mRingProbed = true;
+
+    void *p = mDev->mmap(ringMapSize(), PROT_READ | PROT_WRITE, MAP_SHARED,
+        static_cast<off_t>(XOCL_COMPLETION_RING_PGOFF) * getpagesize());
+    if (p == MAP_FAILED)
+        return nullptr;
+    mRing = reinterpret_cast<xocl_completion_ring *>(p);
+    return mRing;
+}
+
+/*
+ * xclExecBufDone()
+ *
+ * Consume completions from the shared completion ring when available,
+ * this requires no system call.
+ */
+int shim::xclExecBufDone(unsigned int *cmdBOs, unsigned int count, int *overflow)
+{
+    {
+        std::lock_guard<std::mutex> l(mRingLock);
+        if (auto ring = ringMap()) {
+            uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+            uint32_t tail = ring->tail;
+            unsigned int n = 0;
+            for (; n < count && tail != head; ++n, ++tail)
+                cmdBOs[n] = ring->entries[tail & (XOCL_COMPLETION_RING_ENTRIES - 1)].handle;
+            __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+            int lost = __atomic_exchange_n(&ring->overflow, 0, __ATOMIC_ACQ_REL);
+            if (overflow)
+                *overflow = lost ? 1 : 0;
+            return n;
+        }
+    }
+
+    drm_xocl_execbuf_done done = {0, count, 0, 0, reinterpret_cast<uint64_t>(cmdBOs)};
+    int ret = mDev->ioctl(DRM_IOCTL_XOCL_EXECBUF_DONE, &done);
+    if (ret)
+        return (errno == EINVAL || errno == ENOTTY) ? -ENOSYS : -errno;
+    if (overflow)
+        *overflow = (done.flags & DRM_XOCL_EXECBUF_DONE_OVERFLOW) ? 1 : 0;
+    return done.count;
+}
+
+/*
+ * xclExecBufWaitDone()
+ */
+int shim::xclExecBufWaitDone(unsigned int *cmdBOs, unsigned int count, unsigned int min,
+    int timeoutMilliSec, int *overflow)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMilliSec);
+    unsigned int n = 0;
+    int lost = 0;
+    while (true) {
+        int more = 0;
+        int ret = xclExecBufDone(cmdBOs + n, count - n, &more);
+        if (ret < 0)
+            return n ? n : ret;
+        n += ret;
+        lost |= more;
+        if (n >= min || n == count || lost)
+            break;
+
+        int wait = -1;
+        if (timeoutMilliSec >= 0) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>
+                (deadline - std::chrono::steady_clock::now()).count();
+            if (left <= 0)
+                break;
+            wait = static_cast<int>(left);
+        }
+        if (xclExecWait(wait) < 0 && errno != EINTR)
+            return n ? n : -errno;
+    }
+    if (overflow)
+        *overflow = lost;
+    return n;
+}
+
 /*
  * xclOpenContext
  */
-int shim::xclOpenContext(const uuid_t xclbinId, unsigned int ipIndex, bool shared) const
+int shim::xclOpenContext(const uuid_t xclbinId, unsigned int ipIndex, bool shared)
 {
     unsigned int flags = shared ? XOCL_CTX_SHARED : XOCL_CTX_EXCLUSIVE;
     int ret;
@@ -1041,7 +1632,17 @@ int shim::xclOpenContext(const uuid_t xclbinId, unsigned int ipIndex, bool share
     ctx.cu_index = ipIndex;
     ctx.flags = flags;
     ret = mDev->ioctl(DRM_IOCTL_XOCL_CTX, &ctx);
-    return ret ? -errno : ret;
+    if (ret)
+        return -errno;
+
+    // Exclusive owner gets the CU control aperture mapped right away so
+    // that xclRegRead/Write() never has to enter the driver. Failure is
+    // not fatal, xclRegRW() will retry and report it.
+    if (!shared && ipIndex < mCuMaps.size()) {
+        std::lock_guard<std::mutex> l(mCuMapLock);
+        mapCu(ipIndex);
+    }
+    return 0;
 }
 
 /*
@@ -1067,6 +1668,16 @@ int shim::xclCloseContext(const uuid_t xclbinId, unsigned int ipIndex)
     return ret ? -errno : ret;
 }
 
+/*
+ * xclResetCU
+ */
+int shim::xclResetCU(unsigned int ipIndex)
+{
+    drm_xocl_reset_cu reset = {ipIndex};
+    int ret = mDev->ioctl(DRM_IOCTL_XOCL_RESET_CU, &reset);
+    return ret ? -errno : ret;
+}
+
 /*
  * xclBootFPGA()
  */
@@ -1087,15 +1698,21 @@ int shim::xclCreateWriteQueue(xclQueueContext *q_ctx, uint64_t *q_hdl)
     q_info.write = 1;
     q_info.rid = q_ctx->route;
     q_info.flowid = q_ctx->flow;
-    q_info.flags = q_ctx->flags;
+    q_info.flags = q_ctx->flags & ~XRT_QUEUE_FLAG_PRIVATE_COMPL;
+    q_info.priority = q_ctx->priority;
+    q_info.weight = q_ctx->weight;
 
     rc = ioctl(mStreamHandle, XOCL_QDMA_IOC_CREATE_QUEUE, &q_info);
     if (rc) {
         std::cout << __func__ << " ERROR: Create Write Queue IOCTL failed" << std::endl;
-    } else
-        *q_hdl = q_info.handle;
+        return -errno;
+    }
 
-     return rc ? -errno : rc;
+    *q_hdl = q_info.handle;
+    if (q_ctx->flags & XRT_QUEUE_FLAG_BUSY_POLL)
+        return ringAttachQueue(q_info.handle);
+    aioAttachQueue(q_info.handle, q_ctx->flags & XRT_QUEUE_FLAG_PRIVATE_COMPL);
+    return 0;
 }
 
 /*
@@ -1110,15 +1727,21 @@ int shim::xclCreateReadQueue(xclQueueContext *q_ctx, uint64_t *q_hdl)
 
     q_info.rid = q_ctx->route;
     q_info.flowid = q_ctx->flow;
-    q_info.flags = q_ctx->flags;
+    q_info.flags = q_ctx->flags & ~XRT_QUEUE_FLAG_PRIVATE_COMPL;
+    q_info.priority = q_ctx->priority;
+    q_info.weight = q_ctx->weight;
 
     rc = ioctl(mStreamHandle, XOCL_QDMA_IOC_CREATE_QUEUE, &q_info);
     if (rc) {
         std::cout << __func__ << " ERROR: Create Read Queue IOCTL failed" << std::endl;
-    } else
-        *q_hdl = q_info.handle;
+        return -errno;
+    }
 
-    return rc ? -errno : rc;
+    *q_hdl = q_info.handle;
+    if (q_ctx->flags & XRT_QUEUE_FLAG_BUSY_POLL)
+        return ringAttachQueue(q_info.handle);
+    aioAttachQueue(q_info.handle, q_ctx->flags & XRT_QUEUE_FLAG_PRIVATE_COMPL);
+    return 0;
 }
 
 /*
@@ -1128,10 +1751,17 @@ int shim::xclDestroyQueue(uint64_t q_hdl)
 {
     int rc;
 
+    aioDetachQueue(q_hdl);
+
     rc = close((int)q_hdl);
     if (rc)
         std::cout << __func__ << " ERROR: Destroy Queue failed" << std::endl;
 
+    // Requests still in flight are freed as they complete
+    std::lock_guard<std::mutex> lk(mAioLock);
+    mAioFreeReqs.erase(q_hdl);
+    mQueueFrames.erase(q_hdl);
+
     return rc;
 }
 
@@ -1179,114 +1809,530 @@ int shim::xclFreeQDMABuf(uint64_t buf_hdl)
 }
 
 /*
- * xclPollCompletion()
+ * aioAttachQueue()
+ *
+ * Set up completion context of a new queue.  A queue created with
+ * XRT_QUEUE_FLAG_PRIVATE_COMPL gets its own AIO context or io_uring,
+ * polled with xclPollQueue(), all other queues complete to the shared
+ * context polled with xclPollCompletion().
  */
-int shim::xclPollCompletion(int min_compl, int max_compl, struct xclReqCompletion *comps, int* actual, int timeout /*ms*/)
+void shim::aioAttachQueue(uint64_t q_hdl, bool priv)
 {
-    /* TODO: populate actual and timeout args correctly */
-    struct timespec time, *ptime = NULL;
-    int num_evt, i;
+    if (!mAioEnabled)
+        return;
 
-    *actual = 0;
-    if (!mAioEnabled) {
-        num_evt = -EINVAL;
-        std::cout << __func__ << "ERROR: async io is not enabled" << std::endl;
-        goto done;
-    }
-    if (timeout > 0) {
-        memset(&time, 0, sizeof(time));
-        time.tv_sec = timeout / 1000;
-        time.tv_nsec = (timeout % 1000) * 1000000;
-        ptime = &time;
+    if (priv) {
+        auto qctx = std::make_unique<AioQueueContext>();
+        if (mUring)
+            qctx->ring = uring::create(SHIM_QDMA_URING_ENTRIES, xrt_core::config::get_stream_uring_sqpoll());
+        if (qctx->ring) {
+            qctx->ring->addFile((int)q_hdl);
+        } else if (io_setup(SHIM_QDMA_AIO_QUEUE_EVT_MAX, &qctx->ctx)) {
+            std::cout << __func__ << " ERROR: private completion context failed, using shared" << std::endl;
+            qctx.reset();
+        }
+        if (qctx) {
+            std::lock_guard<std::mutex> lk(mAioLock);
+            mAioQueueCtx[q_hdl] = std::move(qctx);
+            return;
+        }
     }
 
-    num_evt = io_getevents(mAioContext, min_compl, max_compl, (struct io_event *)comps, ptime);
-    if (num_evt < min_compl) {
-        std::cout << __func__ << " ERROR: failed to poll Queue Completions" << std::endl;
-        goto done;
-    }
-    *actual = num_evt;
+    if (mUring)
+        mUring->addFile((int)q_hdl);
+}
 
-    for (i = num_evt - 1; i >= 0; i--) {
-        comps[i].priv_data = (void *)((struct io_event *)comps)[i].data;
-    if (((struct io_event *)comps)[i].res < 0){
-            /* error returned by AIO framework */
-            comps[i].nbytes = 0;
-        comps[i].err_code = ((struct io_event *)comps)[i].res;
-    } else {
-            comps[i].nbytes = ((struct io_event *)comps)[i].res;
-        comps[i].err_code = ((struct io_event *)comps)[i].res2;
+/*
+ * aioDetachQueue()
+ *
+ * Tear down completion context of a queue that is being destroyed.
+ * Requests still in flight on a private context never report their
+ * completion and are freed here.
+ */
+void shim::aioDetachQueue(uint64_t q_hdl)
+{
+    std::unique_ptr<AioQueueContext> qctx;
+    {
+        std::lock_guard<std::mutex> lk(mAioLock);
+        auto itr = mAioQueueCtx.find(q_hdl);
+        if (itr != mAioQueueCtx.end()) {
+            qctx = std::move(itr->second);
+            mAioQueueCtx.erase(itr);
+        }
     }
+
+    if (!qctx) {
+        if (mUring)
+            mUring->removeFile((int)q_hdl);
+        return;
     }
-    num_evt = 0;
 
-done:
-    return num_evt;
+    if (qctx->cring)
+        munmap(qctx->cring, qctx->cringSize);
+    else if (qctx->ring)
+        qctx->ring.reset();
+    else
+        io_destroy(qctx->ctx);
+    for (auto req : qctx->busy)
+        delete req;
 }
 
 /*
- * xclWriteQueue()
+ * ringAttachQueue()
+ *
+ * Map the completion ring of a queue created with
+ * XRT_QUEUE_FLAG_BUSY_POLL.  The ring size follows from its number of
+ * entries, read from the first page.
  */
-ssize_t shim::xclWriteQueue(uint64_t q_hdl, xclQueueRequest *wr)
+int shim::ringAttachQueue(uint64_t q_hdl)
 {
-    ssize_t rc = 0;
-
-    for (unsigned i = 0; i < wr->buf_num; i++) {
-        void *buf = (void *)wr->bufs[i].va;
-        struct iovec iov[2];
-        struct xocl_qdma_req_header header;
-
-        header.flags = wr->flag;
-        iov[0].iov_base = &header;
-        iov[0].iov_len = sizeof(header);
-        iov[1].iov_base = buf;
-        iov[1].iov_len = wr->bufs[i].len;
+    size_t pageSize = getpagesize();
+    auto qctx = std::make_unique<AioQueueContext>();
 
-        if (wr->flag & XCL_QUEUE_REQ_NONBLOCKING) {
-            struct iocb cb;
-            struct iocb *cbs[1];
+    void *ptr = mmap(NULL, pageSize, PROT_READ, MAP_SHARED, (int)q_hdl, 0);
+    if (ptr == MAP_FAILED) {
+        std::cout << __func__ << " ERROR: Map completion ring failed" << std::endl;
+        return -errno;
+    }
+    size_t size = sizeof(xocl_qdma_cmpl_ring) +
+        ((xocl_qdma_cmpl_ring *)ptr)->num * sizeof(xocl_qdma_cmpl_entry);
+    munmap(ptr, pageSize);
+
+    qctx->cringSize = (size + pageSize - 1) & ~(pageSize - 1);
+    ptr = mmap(NULL, qctx->cringSize, PROT_READ | PROT_WRITE, MAP_SHARED, (int)q_hdl, 0);
+    if (ptr == MAP_FAILED) {
+        std::cout << __func__ << " ERROR: Map completion ring failed" << std::endl;
+        return -errno;
+    }
+    qctx->cring = (xocl_qdma_cmpl_ring *)ptr;
 
-            if (!mAioEnabled) {
-                std::cout << __func__ << "ERROR: async io is not enabled" << std::endl;
-                break;
-            }
+    std::lock_guard<std::mutex> lk(mAioLock);
+    mAioQueueCtx[q_hdl] = std::move(qctx);
+    return 0;
+}
 
-            if (!(wr->flag & XCL_QUEUE_REQ_EOT) && (wr->bufs[i].len & 0xfff)) {
-                std::cerr << "ERROR: write without EOT has to be multiple of 4k" << std::endl;
-                break;
-            }
+/*
+ * ringQueue()
+ *
+ * Completion context of q_hdl if it has a completion ring
+ */
+shim::AioQueueContext *shim::ringQueue(uint64_t q_hdl)
+{
+    std::lock_guard<std::mutex> lk(mAioLock);
+    auto itr = mAioQueueCtx.find(q_hdl);
+    if (itr == mAioQueueCtx.end() || !itr->second->cring)
+        return nullptr;
+    return itr->second.get();
+}
 
-            memset(&cb, 0, sizeof(cb));
-            cb.aio_fildes = (int)q_hdl;
-            cb.aio_lio_opcode = IOCB_CMD_PWRITEV;
-            cb.aio_buf = (uint64_t)iov;
-            cb.aio_offset = 0;
-            cb.aio_nbytes = 2;
-            cb.aio_data = (uint64_t)wr->priv_data;
-
-            cbs[0] = &cb;
-            if (io_submit(mAioContext, 1, cbs) > 0)
-                rc++;
-            else {
-                std::cerr << "ERROR: async write stream failed" << std::endl;
-                break;
-            }
+/*
+ * ringSubmitQueue()
+ *
+ * Queue each buffer of wr as one request completing to the ring, the
+ * driver returns as soon as the request is queued.  Returns number of
+ * buffers submitted.
+ */
+ssize_t shim::ringSubmitQueue(uint64_t q_hdl, xclQueueRequest *wr, bool write)
+{
+    QueueFrames frames;
+    unsigned num = 0;
+
+    if (wr->flag & XCL_QUEUE_REQ_FRAME) {
+        std::lock_guard<std::mutex> lk(mAioLock);
+        frames = mQueueFrames[q_hdl];
+    }
+
+    for (; num < wr->buf_num; num++) {
+        struct iovec iov[2];
+        struct xocl_qdma_req_header header;
+
+        if (write && !(wr->flag & XCL_QUEUE_REQ_EOT) && (wr->bufs[num].len & 0xfff)) {
+            std::cerr << "ERROR: write without EOT has to be multiple of 4k" << std::endl;
+            break;
+        }
+
+        fillQueueIov(frames, wr, num, &header, iov);
+        header.flags |= XOCL_QDMA_REQ_FLAG_RING;
+        header.tag = (uint64_t)wr->priv_data;
+        ssize_t rc = write ? writev((int)q_hdl, iov, 2) : readv((int)q_hdl, iov, 2);
+        if (rc < 0)
+            break;
+    }
+    return num;
+}
+
+/*
+ * ringPoll()
+ *
+ * Consume completions from the ring of a XRT_QUEUE_FLAG_BUSY_POLL queue.
+ * While fewer than min_compl are ready the driver is asked to reap the
+ * engine, no interrupt or AIO completion is waited for.
+ */
+int shim::ringPoll(uint64_t q_hdl, AioQueueContext *qctx, int min_compl, int max_compl,
+    xclReqCompletion *comps, int* actual, int timeout)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+    xocl_qdma_cmpl_ring *ring = qctx->cring;
+
+    std::lock_guard<std::mutex> lk(qctx->cringLock);
+    while (true) {
+        uint32_t head = ring->head;
+        uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+        for (; head != tail && *actual < max_compl; head++, (*actual)++) {
+            xocl_qdma_cmpl_entry *ent = &ring->ent[head & (ring->num - 1)];
+            xclReqCompletion *comp = &comps[*actual];
+
+            comp->priv_data = (void *)ent->tag;
+            comp->nbytes = ent->nbytes;
+            comp->err_code = ent->err;
+        }
+        __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+        if (*actual >= min_compl)
+            return 0;
+
+        if (timeout > 0 && std::chrono::steady_clock::now() >= deadline)
+            return -ETIMEDOUT;
+        if (ioctl((int)q_hdl, XOCL_QDMA_IOC_QUEUE_SERVICE) < 0)
+            return -errno;
+    }
+}
+
+/*
+ * aioPollUring()
+ *
+ * Reap io_uring completions into comps, returns number reaped
+ */
+int shim::aioPollUring(uring *ring, int min_compl, int max_compl, struct xclReqCompletion *comps, int timeout)
+{
+    std::vector<uring::completion> evts(max_compl);
+    int num_evt = ring->reap(min_compl, max_compl, evts.data(), timeout);
+
+    std::lock_guard<std::mutex> lk(mAioLock);
+    for (int i = 0; i < num_evt; i++) {
+        AioRequest *req = (AioRequest *)evts[i].data;
+
+        comps[i].priv_data = req->privData;
+        if (evts[i].res < 0) {
+            comps[i].nbytes = 0;
+            comps[i].err_code = evts[i].res;
+        } else {
+            comps[i].nbytes = evts[i].res;
+            comps[i].err_code = 0;
+        }
+
+        if (--req->pending == 0)
+            aioPutRequest(req);
+    }
+    return num_evt;
+}
+
+/*
+ * aioPoll()
+ *
+ * Poll completions of AIO context ctx, or of ring if not null
+ */
+int shim::aioPoll(aio_context_t ctx, uring *ring, int min_compl, int max_compl, struct xclReqCompletion *comps, int* actual, int timeout)
+{
+    struct timespec time, *ptime = NULL;
+    int num_evt, i;
+
+    if (ring) {
+        num_evt = aioPollUring(ring, min_compl, max_compl, comps, timeout);
+        if (num_evt < min_compl) {
+            std::cout << __func__ << " ERROR: failed to poll Queue Completions" << std::endl;
+            goto done;
+        }
+        *actual = num_evt;
+        num_evt = 0;
+        goto done;
+    }
+    if (timeout > 0) {
+        memset(&time, 0, sizeof(time));
+        time.tv_sec = timeout / 1000;
+        time.tv_nsec = (timeout % 1000) * 1000000;
+        ptime = &time;
+    }
+
+    num_evt = io_getevents(ctx, min_compl, max_compl, (struct io_event *)comps, ptime);
+    if (num_evt < min_compl) {
+        std::cout << __func__ << " ERROR: failed to poll Queue Completions" << std::endl;
+        goto done;
+    }
+    *actual = num_evt;
+
+    for (i = num_evt - 1; i >= 0; i--) {
+        struct io_event evt = ((struct io_event *)comps)[i];
+        AioRequest *req = (AioRequest *)evt.data;
+
+        comps[i].priv_data = req->privData;
+        if (evt.res < 0) {
+            /* error returned by AIO framework */
+            comps[i].nbytes = 0;
+            comps[i].err_code = evt.res;
         } else {
-            if (!(wr->flag & XCL_QUEUE_REQ_EOT) && (wr->bufs[i].len & 0xfff)) {
+            comps[i].nbytes = evt.res;
+            comps[i].err_code = evt.res2;
+        }
+
+        std::lock_guard<std::mutex> lk(mAioLock);
+        if (--req->pending == 0)
+            aioPutRequest(req);
+    }
+    num_evt = 0;
+
+done:
+    return num_evt;
+}
+
+/*
+ * xclPollCompletion()
+ */
+int shim::xclPollCompletion(int min_compl, int max_compl, struct xclReqCompletion *comps, int* actual, int timeout /*ms*/)
+{
+    /* TODO: populate actual and timeout args correctly */
+    *actual = 0;
+    if (!mAioEnabled) {
+        std::cout << __func__ << "ERROR: async io is not enabled" << std::endl;
+        return -EINVAL;
+    }
+    return aioPoll(mAioContext, mUring.get(), min_compl, max_compl, comps, actual, timeout);
+}
+
+/*
+ * xclPollQueue()
+ *
+ * Poll completions of a queue created with XRT_QUEUE_FLAG_PRIVATE_COMPL
+ */
+int shim::xclPollQueue(uint64_t q_hdl, int min_compl, int max_compl, struct xclReqCompletion *comps, int* actual, int timeout /*ms*/)
+{
+    AioQueueContext *qctx = nullptr;
+
+    *actual = 0;
+    {
+        std::lock_guard<std::mutex> lk(mAioLock);
+        auto itr = mAioQueueCtx.find(q_hdl);
+        if (itr != mAioQueueCtx.end())
+            qctx = itr->second.get();
+    }
+    if (!qctx) {
+        std::cout << __func__ << " ERROR: queue has no private completion context" << std::endl;
+        return -EINVAL;
+    }
+    if (qctx->cring)
+        return ringPoll(q_hdl, qctx, min_compl, max_compl, comps, actual, timeout);
+    return aioPoll(qctx->ctx, qctx->ring.get(), min_compl, max_compl, comps, actual, timeout);
+}
+
+/*
+ * aioGetRequest()
+ *
+ * Take an idle request of queue from pool, or allocate one, sized for
+ * num buffers.  Called with mAioLock held.
+ */
+shim::AioRequest *shim::aioGetRequest(uint64_t q_hdl, unsigned num)
+{
+    auto& pool = mAioFreeReqs[q_hdl];
+    std::unique_ptr<AioRequest> req;
+
+    if (pool.empty()) {
+        req = std::make_unique<AioRequest>();
+    } else {
+        req = std::move(pool.back());
+        pool.pop_back();
+    }
+
+    req->qHdl = q_hdl;
+    req->qCtx = nullptr;
+    auto qitr = mAioQueueCtx.find(q_hdl);
+    if (qitr != mAioQueueCtx.end()) {
+        req->qCtx = qitr->second.get();
+        req->qCtx->busy.insert(req.get());
+    }
+    req->pending = 0;
+    req->headers.resize(num);
+    req->iov.resize(2 * num);
+    req->cbs.resize(num);
+    req->cbPtrs.resize(num);
+    return req.release();
+}
+
+/*
+ * aioPutRequest()
+ *
+ * Return request to pool of its queue, or free it if queue has been
+ * destroyed.  Called with mAioLock held.
+ */
+void shim::aioPutRequest(AioRequest *req)
+{
+    std::unique_ptr<AioRequest> hold(req);
+    if (req->qCtx)
+        req->qCtx->busy.erase(req);
+    auto itr = mAioFreeReqs.find(req->qHdl);
+    if (itr != mAioFreeReqs.end())
+        itr->second.push_back(std::move(hold));
+}
+
+/*
+ * fillQueueIov()
+ *
+ * Header and data iovec of buffer i of wr.  With XCL_QUEUE_REQ_FRAME
+ * the va of the buffer is a frame index of the registered buffer.
+ */
+void shim::fillQueueIov(const QueueFrames& frames, const xclQueueRequest *wr, unsigned i,
+    struct xocl_qdma_req_header *header, struct iovec *iov)
+{
+    header->flags = wr->flag;
+    iov[0].iov_base = header;
+    iov[0].iov_len = sizeof(*header);
+    iov[1].iov_len = wr->bufs[i].len;
+    if (wr->flag & XCL_QUEUE_REQ_FRAME) {
+        header->flags |= wr->bufs[i].va << XOCL_QDMA_REQ_FRAME_SHIFT;
+        iov[1].iov_base = frames.base + wr->bufs[i].va * frames.frameSize;
+    } else {
+        iov[1].iov_base = (void *)wr->bufs[i].va;
+    }
+}
+
+/*
+ * xclRegisterQueueBuf()
+ */
+int shim::xclRegisterQueueBuf(uint64_t q_hdl, void *buf, size_t frame_size)
+{
+    struct xocl_qdma_ioc_reg_buf req;
+
+    memset(&req, 0, sizeof(req));
+    req.addr = (uint64_t)buf;
+    req.frame_size = frame_size;
+    if (ioctl((int)q_hdl, XOCL_QDMA_IOC_QUEUE_REG_BUF, &req)) {
+        std::cout << __func__ << " ERROR: Register queue buffer IOCTL failed" << std::endl;
+        return -errno;
+    }
+
+    std::lock_guard<std::mutex> lk(mAioLock);
+    mQueueFrames[q_hdl] = { (char *)buf, frame_size };
+    return req.frame_num;
+}
+
+/*
+ * aioSubmitQueue()
+ *
+ * Submit first num buffers of wr with one io_submit() call.  Returns
+ * number of buffers submitted.
+ */
+ssize_t shim::aioSubmitQueue(uint64_t q_hdl, xclQueueRequest *wr, unsigned num, uint16_t opcode)
+{
+    AioRequest *req;
+    QueueFrames frames;
+    int ret;
+
+    if (!num)
+        return 0;
+
+    {
+        std::lock_guard<std::mutex> lk(mAioLock);
+        req = aioGetRequest(q_hdl, num);
+        if (wr->flag & XCL_QUEUE_REQ_FRAME)
+            frames = mQueueFrames[q_hdl];
+    }
+    req->privData = wr->priv_data;
+    req->pending = num;
+
+    for (unsigned i = 0; i < num; i++) {
+        struct iovec *iov = &req->iov[2 * i];
+        struct iocb *cb = &req->cbs[i];
+
+        fillQueueIov(frames, wr, i, &req->headers[i], iov);
+
+        memset(cb, 0, sizeof(*cb));
+        cb->aio_fildes = (int)q_hdl;
+        cb->aio_lio_opcode = opcode;
+        cb->aio_buf = (uint64_t)iov;
+        cb->aio_offset = 0;
+        cb->aio_nbytes = 2;
+        cb->aio_data = (uint64_t)req;
+        req->cbPtrs[i] = cb;
+    }
+
+    // pending must cover all submitted iocbs before any can complete,
+    // so it is trimmed after a partial submit under the lock
+    uring *ring = req->qCtx ? req->qCtx->ring.get() : mUring.get();
+    if (ring)
+        ret = ring->submit((int)q_hdl, opcode == IOCB_CMD_PWRITEV, req->iov.data(), 2, num, (uint64_t)req);
+    else
+        ret = io_submit(req->qCtx ? req->qCtx->ctx : mAioContext, num, req->cbPtrs.data());
+
+    std::lock_guard<std::mutex> lk(mAioLock);
+    if (ret < (int)num) {
+        unsigned failed = num - (ret > 0 ? ret : 0);
+        req->pending -= failed;
+        if (req->pending == 0)
+            aioPutRequest(req);
+    }
+    return ret > 0 ? ret : 0;
+}
+
+/*
+ * xclWriteQueue()
+ */
+ssize_t shim::xclWriteQueue(uint64_t q_hdl, xclQueueRequest *wr)
+{
+    ssize_t rc = 0;
+    QueueFrames frames;
+
+    if (wr->flag & XCL_QUEUE_REQ_NONBLOCKING) {
+        unsigned num = 0;
+
+        if (ringQueue(q_hdl)) {
+            rc = ringSubmitQueue(q_hdl, wr, true);
+            if (rc < (ssize_t)wr->buf_num)
+                std::cerr << "ERROR: async write stream failed" << std::endl;
+            return rc;
+        }
+
+        if (!mAioEnabled) {
+            std::cout << __func__ << "ERROR: async io is not enabled" << std::endl;
+            return rc;
+        }
+
+        for (; num < wr->buf_num; num++) {
+            if (!(wr->flag & XCL_QUEUE_REQ_EOT) && (wr->bufs[num].len & 0xfff)) {
                 std::cerr << "ERROR: write without EOT has to be multiple of 4k" << std::endl;
-                rc = -EINVAL;
                 break;
             }
+        }
 
-            rc = writev((int)q_hdl, iov, 2);
-            if (rc < 0) {
-                std::cerr << "ERROR: write stream failed: " << rc << std::endl;
-                break;
-            } else if ((size_t)rc != wr->bufs[i].len) {
-                std::cerr << "ERROR: only " << rc << "/" << wr->bufs[i].len;
-                std::cerr << " bytes is written" << std::endl;
-                break;
-            }
+        rc = aioSubmitQueue(q_hdl, wr, num, IOCB_CMD_PWRITEV);
+        if (rc < (ssize_t)num)
+            std::cerr << "ERROR: async write stream failed" << std::endl;
+        return rc;
+    }
+
+    if (wr->flag & XCL_QUEUE_REQ_FRAME) {
+        std::lock_guard<std::mutex> lk(mAioLock);
+        frames = mQueueFrames[q_hdl];
+    }
+
+    for (unsigned i = 0; i < wr->buf_num; i++) {
+        struct iovec iov[2];
+        struct xocl_qdma_req_header header;
+
+        fillQueueIov(frames, wr, i, &header, iov);
+
+        if (!(wr->flag & XCL_QUEUE_REQ_EOT) && (wr->bufs[i].len & 0xfff)) {
+            std::cerr << "ERROR: write without EOT has to be multiple of 4k" << std::endl;
+            rc = -EINVAL;
+            break;
+        }
+
+        rc = writev((int)q_hdl, iov, 2);
+        if (rc < 0) {
+            std::cerr << "ERROR: write stream failed: " << rc << std::endl;
+            break;
+        } else if ((size_t)rc != wr->bufs[i].len) {
+            std::cerr << "ERROR: only " << rc << "/" << wr->bufs[i].len;
+            std::cerr << " bytes is written" << std::endl;
+            break;
         }
     }
     return rc;
@@ -1298,48 +2344,42 @@ ssize_t shim::xclWriteQueue(uint64_t q_hdl, xclQueueRequest *wr)
 ssize_t shim::xclReadQueue(uint64_t q_hdl, xclQueueRequest *wr)
 {
     ssize_t rc = 0;
+    QueueFrames frames;
+
+    if (wr->flag & XCL_QUEUE_REQ_NONBLOCKING) {
+        if (ringQueue(q_hdl)) {
+            rc = ringSubmitQueue(q_hdl, wr, false);
+            if (rc < (ssize_t)wr->buf_num)
+                std::cerr << "ERROR: async read stream failed" << std::endl;
+            return rc;
+        }
+
+        if (!mAioEnabled) {
+            std::cout << __func__ << "ERROR: async io is not enabled" << std::endl;
+            return rc;
+        }
+
+        rc = aioSubmitQueue(q_hdl, wr, wr->buf_num, IOCB_CMD_PREADV);
+        if (rc < (ssize_t)wr->buf_num)
+            std::cerr << "ERROR: async read stream failed" << std::endl;
+        return rc;
+    }
+
+    if (wr->flag & XCL_QUEUE_REQ_FRAME) {
+        std::lock_guard<std::mutex> lk(mAioLock);
+        frames = mQueueFrames[q_hdl];
+    }
 
     for (unsigned i = 0; i < wr->buf_num; i++) {
-        void *buf = (void *)wr->bufs[i].va;
         struct iovec iov[2];
         struct xocl_qdma_req_header header;
 
-        header.flags = wr->flag;
-        iov[0].iov_base = &header;
-        iov[0].iov_len = sizeof(header);
-        iov[1].iov_base = buf;
-        iov[1].iov_len = wr->bufs[i].len;
-
-        if (wr->flag & XCL_QUEUE_REQ_NONBLOCKING) {
-            struct iocb cb;
-            struct iocb *cbs[1];
-
-            if (!mAioEnabled) {
-                std::cout << __func__ << "ERROR: async io is not enabled" << std::endl;
-                break;
-            }
+        fillQueueIov(frames, wr, i, &header, iov);
 
-            memset(&cb, 0, sizeof(cb));
-            cb.aio_fildes = (int)q_hdl;
-            cb.aio_lio_opcode = IOCB_CMD_PREADV;
-            cb.aio_buf = (uint64_t)iov;
-            cb.aio_offset = 0;
-            cb.aio_nbytes = 2;
-            cb.aio_data = (uint64_t)wr->priv_data;
-
-            cbs[0] = &cb;
-            if (io_submit(mAioContext, 1, cbs) > 0)
-                rc++;
-            else {
-                std::cerr << "ERROR: async read stream failed" << std::endl;
-                break;
-            }
-        } else {
-            rc = readv((int)q_hdl, iov, 2);
-            if (rc < 0) {
-                std::cerr << "ERROR: read stream failed: " << rc << std::endl;
-                break;
-            }
+        rc = readv((int)q_hdl, iov, 2);
+        if (rc < 0) {
+            std::cerr << "ERROR: read stream failed: " << rc << std::endl;
+            break;
         }
     }
     return rc;
@@ -1364,6 +2404,21 @@ uint shim::xclGetNumLiveProcesses()
     return 0;
 }
 
+/*
+ * Map control aperture of an exclusively reserved CU, caller holds mCuMapLock.
+ * The driver refuses the mmap unless this process owns the CU exclusively.
+ */
+uint32_t *shim::mapCu(uint32_t cu_index)
+{
+    if (mCuMaps[cu_index] == nullptr) {
+        void *p = mDev->mmap(mCuMapSize,
+            PROT_READ | PROT_WRITE, MAP_SHARED, (cu_index + 1) * getpagesize());
+        if (p != MAP_FAILED)
+            mCuMaps[cu_index] = (uint32_t *)p;
+    }
+    return mCuMaps[cu_index];
+}
+
 int shim::xclRegRW(bool rd, uint32_t cu_index, uint32_t offset, uint32_t *datap)
 {
     std::lock_guard<std::mutex> l(mCuMapLock);
@@ -1381,14 +2436,7 @@ int shim::xclRegRW(bool rd, uint32_t cu_index, uint32_t offset, uint32_t *datap)
         return -EINVAL;
     }
 
-    if (mCuMaps[cu_index] == nullptr) {
-        void *p = mDev->mmap(mCuMapSize,
-            PROT_READ | PROT_WRITE, MAP_SHARED, (cu_index + 1) * getpagesize());
-        if (p != MAP_FAILED)
-            mCuMaps[cu_index] = (uint32_t *)p;
-    }
-
-    uint32_t *cumap = mCuMaps[cu_index];
+    uint32_t *cumap = mapCu(cu_index);
     if (cumap == nullptr) {
         std::string err = "xclRegRW: can't map CU ";
         err += std::to_string(cu_index);
@@ -1454,6 +2502,18 @@ int xclLoadXclBin(xclDeviceHandle handle, const xclBin *buffer)
     return ret;
 }
 
+int xclLoadXclBinAsync(xclDeviceHandle handle, const xclBin *buffer)
+{
+    xocl::shim *drv = xocl::shim::handleCheck(handle);
+    return drv ? drv->xclLoadXclBinAsync(handle, buffer) : -ENODEV;
+}
+
+int xclLoadXclBinWait(xclDeviceHandle handle, int timeoutMilliSec)
+{
+    xocl::shim *drv = xocl::shim::handleCheck(handle);
+    return drv ? drv->xclLoadXclBinWait(timeoutMilliSec) : -ENODEV;
+}
+
 int xclLogMsg(xclDeviceHandle handle, xrtLogMsgLevel level, const char* tag, const char* format, ...)
 {
     va_list args;
@@ -1522,6 +2582,19 @@ unsigned int xclAllocUserPtrBO(xclDeviceHandle handle, void *userptr, size_t siz
     return drv ? drv->xclAllocUserPtrBO(userptr, size, flags) : -ENODEV;
 }
 
+void *xclAllocHostBuffer(xclDeviceHandle handle, size_t size, unsigned flags, unsigned int *boHandle)
+{
+    xocl::shim *drv = xocl::shim::handleCheck(handle);
+    return drv ? drv->xclAllocHostBuffer(size, flags, boHandle) : nullptr;
+}
+
+void xclFreeHostBuffer(xclDeviceHandle handle, void *ptr)
+{
+    xocl::shim *drv = xocl::shim::handleCheck(handle);
+    if (drv)
+        drv->xclFreeHostBuffer(ptr);
+}
+
 void xclFreeBO(xclDeviceHandle handle, unsigned int boHandle) {
     xocl::shim *drv = xocl::shim::handleCheck(handle);
     if (!drv) {
@@ -1542,6 +2615,18 @@ size_t xclReadBO(xclDeviceHandle handle, unsigned int boHandle, void *dst, size_
     return drv ? drv->xclReadBO(boHandle, dst, size, skip) : -ENODEV;
 }
 
+int xclWriteBOv(xclDeviceHandle handle, unsigned int boHandle, const xclBOIovec *iov, unsigned int count)
+{
+    xocl::shim *drv = xocl::shim::handleCheck(handle);
+    return drv ? drv->xclRWBOv(boHandle, iov, count, true) : -ENODEV;
+}
+
+int xclReadBOv(xclDeviceHandle handle, unsigned int boHandle, const xclBOIovec *iov, unsigned int count)
+{
+    xocl::shim *drv = xocl::shim::handleCheck(handle);
+    return drv ? drv->xclRWBOv(boHandle, iov, count, false) : -ENODEV;
+}
+
 void *xclMapBO(xclDeviceHandle handle, unsigned int boHandle, bool write)
 {
     xocl::shim *drv = xocl::shim::handleCheck(handle);
@@ -1554,6 +2639,25 @@ int xclSyncBO(xclDeviceHandle handle, unsigned int boHandle, xclBOSyncDirection
     return drv ? drv->xclSyncBO(boHandle, dir, size, offset) : -ENODEV;
 }
 
+int xclSyncBOAsync(xclDeviceHandle handle, unsigned int boHandle, xclBOSyncDirection dir, size_t size, size_t offset,
+    int efd, uint64_t *fence)
+{
+    xocl::shim *drv = xocl::shim::handleCheck(handle);
+    return drv ? drv->xclSyncBOAsync(boHandle, dir, size, offset, efd, fence) : -ENODEV;
+}
+
+int xclSyncBOWait(xclDeviceHandle handle, uint64_t fence, int timeoutMilliSec)
+{
+    xocl::shim *drv = xocl::shim::handleCheck(handle);
+    return drv ? drv->xclSyncBOWait(fence, timeoutMilliSec) : -ENODEV;
+}
+
+int xclSyncBOBatch(xclDeviceHandle handle, const xclBOSyncItem *items, unsigned int count)
+{
+    xocl::shim *drv = xocl::shim::handleCheck(handle);
+    return drv ? drv->xclSyncBOBatch(items, count) : -ENODEV;
+}
+
 int xclCopyBO(xclDeviceHandle handle, unsigned int dst_boHandle,
             unsigned int src_boHandle, size_t size, size_t dst_offset, size_t src_offset)
 {
@@ -1562,6 +2666,16 @@ int xclCopyBO(xclDeviceHandle handle, unsigned int dst_boHandle,
       drv->xclCopyBO(dst_boHandle, src_boHandle, size, dst_offset, src_offset) : -ENODEV;
 }
 
+int xclCopyBOPeer(xclDeviceHandle dstHandle, unsigned int dst_boHandle,
+            xclDeviceHandle srcHandle, unsigned int src_boHandle,
+            size_t size, size_t dst_offset, size_t src_offset)
+{
+    xocl::shim *dst_drv = xocl::shim::handleCheck(dstHandle);
+    xocl::shim *src_drv = xocl::shim::handleCheck(srcHandle);
+    return (dst_drv && src_drv) ?
+      dst_drv->xclCopyBOPeer(dst_boHandle, src_drv, src_boHandle, size, dst_offset, src_offset) : -ENODEV;
+}
+
 int xclReClock2(xclDeviceHandle handle, unsigned short region, const unsigned short *targetFreqMHz)
 {
     xocl::shim *drv = xocl::shim::handleCheck(handle);
@@ -1673,6 +2787,25 @@ int xclExecWait(xclDeviceHandle handle, int timeoutMilliSec)
   return drv ? drv->xclExecWait(timeoutMilliSec) : -ENODEV;
 }
 
+int xclExecBufDone(xclDeviceHandle handle, unsigned int *cmdBOs, unsigned int count, int *overflow)
+{
+  xocl::shim *drv = xocl::shim::handleCheck(handle);
+  return drv ? drv->xclExecBufDone(cmdBOs, count, overflow) : -ENODEV;
+}
+
+int xclExecBufBatch(xclDeviceHandle handle, unsigned int *cmdBOs, unsigned int count)
+{
+  xocl::shim *drv = xocl::shim::handleCheck(handle);
+  return drv ? drv->xclExecBufBatch(cmdBOs, count) : -ENODEV;
+}
+
+int xclExecBufWaitDone(xclDeviceHandle handle, unsigned int *cmdBOs, unsigned int count,
+    unsigned int min, int timeoutMilliSec, int *overflow)
+{
+  xocl::shim *drv = xocl::shim::handleCheck(handle);
+  return drv ? drv->xclExecBufWaitDone(cmdBOs, count, min, timeoutMilliSec, overflow) : -ENODEV;
+}
+
 int xclOpenContext(xclDeviceHandle handle, uuid_t xclbinId, unsigned int ipIndex, bool shared)
 {
   xocl::shim *drv = xocl::shim::handleCheck(handle);
@@ -1685,6 +2818,12 @@ int xclCloseContext(xclDeviceHandle handle, uuid_t xclbinId, unsigned ipIndex)
   return drv ? drv->xclCloseContext(xclbinId, ipIndex) : -ENODEV;
 }
 
+int xclResetCU(xclDeviceHandle handle, unsigned int ipIndex)
+{
+  xocl::shim *drv = xocl::shim::handleCheck(handle);
+  return drv ? drv->xclResetCU(ipIndex) : -ENODEV;
+}
+
 const axlf_section_header* wrap_get_axlf_section(const axlf* top, axlf_section_kind kind)
 {
     return xclbin::get_axlf_section(top, kind);
@@ -1739,6 +2878,18 @@ int xclPollCompletion(xclDeviceHandle handle, int min_compl, int max_compl, xclR
         return drv ? drv->xclPollCompletion(min_compl, max_compl, comps, actual, timeout) : -ENODEV;
 }
 
+int xclRegisterQueueBuf(xclDeviceHandle handle, uint64_t q_hdl, void *buf, size_t frame_size)
+{
+        xocl::shim *drv = xocl::shim::handleCheck(handle);
+        return drv ? drv->xclRegisterQueueBuf(q_hdl, buf, frame_size) : -ENODEV;
+}
+
+int xclPollQueue(xclDeviceHandle handle, uint64_t q_hdl, int min_compl, int max_compl, xclReqCompletion *comps, int* actual, int timeout)
+{
+        xocl::shim *drv = xocl::shim::handleCheck(handle);
+        return drv ? drv->xclPollQueue(q_hdl, min_compl, max_compl, comps, actual, timeout) : -ENODEV;
+}
+
 uint xclGetNumLiveProcesses(xclDeviceHandle handle)
 {
     xocl::shim *drv = xocl::shim::handleCheck(handle);
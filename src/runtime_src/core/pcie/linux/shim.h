@@ -24,17 +24,21 @@
  */
 
 #include "scan.h"
+#include "uring.h"
 #include "xclhal2.h"
 #include "core/pcie/driver/linux/include/xocl_ioctl.h"
 #include "core/pcie/driver/linux/include/qdma_ioctl.h"
 
 #include <linux/aio_abi.h>
+#include <sys/uio.h>
 #include <libdrm/drm.h>
 
 #include <mutex>
+#include <future>
 #include <fstream>
 #include <list>
 #include <map>
+#include <set>
 #include <cassert>
 #include <vector>
 #include <memory>
@@ -67,12 +71,21 @@ public:
     unsigned int xclAllocBO(size_t size, int unused, unsigned flags);
     unsigned int xclAllocUserPtrBO(void *userptr, size_t size, unsigned flags);
     void xclFreeBO(unsigned int boHandle);
+    void *xclAllocHostBuffer(size_t size, unsigned flags, unsigned int *boHandle);
+    void xclFreeHostBuffer(void *ptr);
     int xclWriteBO(unsigned int boHandle, const void *src, size_t size, size_t seek);
     int xclReadBO(unsigned int boHandle, void *dst, size_t size, size_t skip);
+    int xclRWBOv(unsigned int boHandle, const xclBOIovec *iov, unsigned int count, bool write);
     void *xclMapBO(unsigned int boHandle, bool write);
     int xclSyncBO(unsigned int boHandle, xclBOSyncDirection dir, size_t size, size_t offset);
+    int xclSyncBOAsync(unsigned int boHandle, xclBOSyncDirection dir, size_t size, size_t offset,
+                       int efd, uint64_t *fence);
+    int xclSyncBOWait(uint64_t fence, int timeoutMilliSec);
+    int xclSyncBOBatch(const xclBOSyncItem *items, unsigned int count);
     int xclCopyBO(unsigned int dst_boHandle, unsigned int src_boHandle, size_t size,
                   size_t dst_offset, size_t src_offset);
+    int xclCopyBOPeer(unsigned int dst_boHandle, shim *src_drv, unsigned int src_boHandle,
+                      size_t size, size_t dst_offset, size_t src_offset);
 
     int xclExportBO(unsigned int boHandle);
     unsigned int xclImportBO(int fd, unsigned flags);
@@ -80,6 +93,8 @@ public:
 
     // Bitstream/bin download
     int xclLoadXclBin(const xclBin *buffer);
+    int xclLoadXclBinAsync(xclDeviceHandle handle, const xclBin *buffer);
+    int xclLoadXclBinWait(int timeoutMilliSec);
     int xclGetErrorStatus(xclErrorStatus *info);
     int xclGetDeviceInfo2(xclDeviceInfo2 *info);
     bool isGood() const;
@@ -148,8 +163,13 @@ public:
     int xclExecBuf(unsigned int cmdBO,size_t numdeps, unsigned int* bo_wait_list);
     int xclRegisterEventNotify(unsigned int userInterrupt, int fd);
     int xclExecWait(int timeoutMilliSec);
-    int xclOpenContext(const uuid_t xclbinId, unsigned int ipIndex, bool shared) const;
+    int xclExecBufDone(unsigned int *cmdBOs, unsigned int count, int *overflow);
+    int xclExecBufBatch(unsigned int *cmdBOs, unsigned int count);
+    int xclExecBufWaitDone(unsigned int *cmdBOs, unsigned int count, unsigned int min,
+                           int timeoutMilliSec, int *overflow);
+    int xclOpenContext(const uuid_t xclbinId, unsigned int ipIndex, bool shared);
     int xclCloseContext(const uuid_t xclbinId, unsigned int ipIndex);
+    int xclResetCU(unsigned int ipIndex);
 
     int getBoardNumber( void ) { return mBoardNumber; }
     const char *getLogfileName( void ) { return mLogfileName; }
@@ -164,11 +184,34 @@ public:
     ssize_t xclWriteQueue(uint64_t q_hdl, xclQueueRequest *wr);
     ssize_t xclReadQueue(uint64_t q_hdl, xclQueueRequest *wr);
     int xclPollCompletion(int min_compl, int max_compl, xclReqCompletion *comps, int * actual, int timeout /*ms*/);
+    int xclRegisterQueueBuf(uint64_t q_hdl, void *buf, size_t frame_size);
+    int xclPollQueue(uint64_t q_hdl, int min_compl, int max_compl, xclReqCompletion *comps, int * actual, int timeout /*ms*/);
 
 private:
     std::shared_ptr<pcidev::pci_device> mDev;
     xclVerbosityLevel mVerbosity;
     std::ofstream mLogStream;
+    bool mBatchUnsupported = false;
+
+    /*
+     * Completion ring shared with driver, mapped on first call to
+     * xclExecBufDone().  Consumers serialize on mRingLock.
+     */
+    xocl_completion_ring *mRing = nullptr;
+    bool mRingProbed = false;
+    std::mutex mRingLock;
+    size_t ringMapSize() const;
+    xocl_completion_ring *ringMap();
+
+    /*
+     * Read only device usage page, mapped on first call to
+     * xclGetUsageInfo(). Falls back to sysfs if the driver has none.
+     */
+    const xocl_usage_page *mUsagePage = nullptr;
+    bool mUsageProbed = false;
+    std::mutex mUsageLock;
+    size_t usageMapSize() const;
+    const xocl_usage_page *usageMap();
     int mStreamHandle;
     int mBoardNumber;
     bool mLocked;
@@ -190,7 +233,25 @@ private:
     const size_t mCuMapSize = 64 * 1024;
     std::mutex mCuMapLock;
 
+    /*
+     * Host buffers from xclAllocHostBuffer() with their mapped length
+     * and the userptr BO registered for them.
+     */
+    struct host_buffer {
+        size_t length;
+        unsigned int bo;
+    };
+    std::map<void *, host_buffer> mHostBuffers;
+    std::mutex mHostBufferLock;
+
+    // Download started by xclLoadXclBinAsync(), valid until waited for
+    std::future<int> mLoad;
+    std::mutex mLoadLock;
+
     bool zeroOutDDR();
+    bool zeroRange(uint64_t paddr, uint64_t size);
+    // Clear DDR range of BOs at allocation instead of whole DDR at load
+    bool mZeroOnAlloc = false;
     bool isXPR() const {
         return ((mDeviceInfo.mSubsystemId >> 12) == 4);
     }
@@ -206,6 +267,7 @@ private:
     int freezeAXIGate();
     int freeAXIGate();
 
+    uint32_t *mapCu(uint32_t cu_index);
     int xclRegRW(bool rd, uint32_t cu_index, uint32_t offset, uint32_t *datap);
 
     bool readPage(unsigned addr, uint8_t readCmd = 0xff);
@@ -267,6 +329,62 @@ private:
     // QDMA AIO
     aio_context_t mAioContext;
     bool mAioEnabled;
+    // io_uring backend, used instead of mAioContext when present
+    std::unique_ptr<uring> mUring;
+
+    /*
+     * Storage of one async queue request, kept alive from io_submit()
+     * until the last of its buffers completes.  Every buffer has its
+     * own iocb and header/data iovec pair, aio_data of each iocb points
+     * back to the request.  Idle requests are recycled per queue.
+     */
+    struct AioQueueContext;
+    struct AioRequest {
+        uint64_t qHdl;
+        AioQueueContext *qCtx;
+        void *privData;
+        unsigned pending;
+        std::vector<xocl_qdma_req_header> headers;
+        std::vector<struct iovec> iov;
+        std::vector<struct iocb> cbs;
+        std::vector<struct iocb *> cbPtrs;
+    };
+    std::map<uint64_t, std::vector<std::unique_ptr<AioRequest>>> mAioFreeReqs;
+
+    // Completion context of a queue with XRT_QUEUE_FLAG_PRIVATE_COMPL,
+    // busy holds its requests in flight
+    struct AioQueueContext {
+        aio_context_t ctx = 0;
+        std::unique_ptr<uring> ring;
+        std::set<AioRequest *> busy;
+        // Completion ring of a queue with XRT_QUEUE_FLAG_BUSY_POLL
+        xocl_qdma_cmpl_ring *cring = nullptr;
+        size_t cringSize = 0;
+        std::mutex cringLock;
+    };
+    std::map<uint64_t, std::unique_ptr<AioQueueContext>> mAioQueueCtx;
+
+    // Frame buffer registered with xclRegisterQueueBuf() per queue
+    struct QueueFrames {
+        char *base = nullptr;
+        size_t frameSize = 0;
+    };
+    std::map<uint64_t, QueueFrames> mQueueFrames;
+    static void fillQueueIov(const QueueFrames& frames, const xclQueueRequest *wr, unsigned i,
+        struct xocl_qdma_req_header *header, struct iovec *iov);
+    std::mutex mAioLock;
+    void aioAttachQueue(uint64_t q_hdl, bool priv);
+    void aioDetachQueue(uint64_t q_hdl);
+    int ringAttachQueue(uint64_t q_hdl);
+    AioQueueContext *ringQueue(uint64_t q_hdl);
+    ssize_t ringSubmitQueue(uint64_t q_hdl, xclQueueRequest *wr, bool write);
+    int ringPoll(uint64_t q_hdl, AioQueueContext *qctx, int min_compl, int max_compl,
+        xclReqCompletion *comps, int* actual, int timeout);
+    int aioPoll(aio_context_t ctx, uring *ring, int min_compl, int max_compl, xclReqCompletion *comps, int *actual, int timeout);
+    int aioPollUring(uring *ring, int min_compl, int max_compl, xclReqCompletion *comps, int timeout);
+    AioRequest *aioGetRequest(uint64_t q_hdl, unsigned num);
+    void aioPutRequest(AioRequest *req);
+    ssize_t aioSubmitQueue(uint64_t q_hdl, xclQueueRequest *wr, unsigned num, uint16_t opcode);
 }; /* shim */
 
 } /* xocl */
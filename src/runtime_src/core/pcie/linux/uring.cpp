@@ -0,0 +1,375 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "uring.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include <unistd.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#if defined(__has_include)
+# if __has_include(<linux/io_uring.h>)
+#  include <linux/io_uring.h>
+#  if defined(__NR_io_uring_setup) && defined(IORING_OFF_SQES)
+#   define XRT_HAVE_IO_URING
+#  endif
+# endif
+#endif
+
+namespace xocl {
+
+#ifdef XRT_HAVE_IO_URING
+
+// Size of fixed file table, one slot per open stream queue
+static const unsigned URING_MAX_FILES = 1024;
+
+// Idle time in ms before SQPOLL kernel thread goes to sleep
+static const unsigned URING_SQ_THREAD_IDLE = 1000;
+
+static int uringSetup(unsigned entries, struct io_uring_params *p)
+{
+    return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int uringEnter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+    return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int uringRegister(int fd, unsigned opcode, void *arg, unsigned nr_args)
+{
+    return syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+struct uring::impl {
+    int fd = -1;
+    bool sqpoll = false;
+    bool fixedFiles = false;
+
+    void *ringPtr = MAP_FAILED;
+    size_t ringSize = 0;
+    void *sqePtr = MAP_FAILED;
+    size_t sqeSize = 0;
+
+    unsigned *sqHead = nullptr;
+    unsigned *sqTail = nullptr;
+    unsigned *sqMask = nullptr;
+    unsigned *sqFlags = nullptr;
+    unsigned *sqArray = nullptr;
+    unsigned sqEntries = 0;
+    struct io_uring_sqe *sqes = nullptr;
+
+    unsigned *cqHead = nullptr;
+    unsigned *cqTail = nullptr;
+    unsigned *cqMask = nullptr;
+    struct io_uring_cqe *cqes = nullptr;
+
+    // Queued in SQ ring but not yet consumed by io_uring_enter()
+    unsigned toSubmit = 0;
+
+    std::vector<int> files;
+    std::map<int, unsigned> slots;
+
+    std::mutex sqLock;
+    std::mutex cqLock;
+    std::mutex fileLock;
+
+    ~impl()
+    {
+        if (sqePtr != MAP_FAILED)
+            munmap(sqePtr, sqeSize);
+        if (ringPtr != MAP_FAILED)
+            munmap(ringPtr, ringSize);
+        if (fd >= 0)
+            close(fd);
+    }
+
+    int init(unsigned entries, bool poll)
+    {
+        struct io_uring_params p;
+
+        memset(&p, 0, sizeof(p));
+        if (poll) {
+            p.flags = IORING_SETUP_SQPOLL;
+            p.sq_thread_idle = URING_SQ_THREAD_IDLE;
+        }
+        fd = uringSetup(entries, &p);
+        if (fd < 0)
+            return -errno;
+        sqpoll = poll;
+
+        // SQ and CQ rings share one mapping, IORING_FEAT_SINGLE_MMAP
+        // is present on every kernel that has the fixed file update
+        size_t sqSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        size_t cqSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+        if (!(p.features & IORING_FEAT_SINGLE_MMAP))
+            return -EOPNOTSUPP;
+        ringSize = std::max(sqSize, cqSize);
+        ringPtr = mmap(NULL, ringSize, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (ringPtr == MAP_FAILED)
+            return -errno;
+        sqeSize = p.sq_entries * sizeof(struct io_uring_sqe);
+        sqePtr = mmap(NULL, sqeSize, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sqePtr == MAP_FAILED)
+            return -errno;
+
+        char *ring = (char *)ringPtr;
+        sqHead = (unsigned *)(ring + p.sq_off.head);
+        sqTail = (unsigned *)(ring + p.sq_off.tail);
+        sqMask = (unsigned *)(ring + p.sq_off.ring_mask);
+        sqFlags = (unsigned *)(ring + p.sq_off.flags);
+        sqArray = (unsigned *)(ring + p.sq_off.array);
+        sqEntries = p.sq_entries;
+        sqes = (struct io_uring_sqe *)sqePtr;
+        cqHead = (unsigned *)(ring + p.cq_off.head);
+        cqTail = (unsigned *)(ring + p.cq_off.tail);
+        cqMask = (unsigned *)(ring + p.cq_off.ring_mask);
+        cqes = (struct io_uring_cqe *)(ring + p.cq_off.cqes);
+
+        // Sparse table, slots are filled in as queues are created
+        files.assign(URING_MAX_FILES, -1);
+        fixedFiles = (uringRegister(fd, IORING_REGISTER_FILES, files.data(), files.size()) == 0);
+
+        // Older kernels poll only registered files
+        if (sqpoll && !fixedFiles && !(p.features & IORING_FEAT_SQPOLL_NONFIXED))
+            return -EOPNOTSUPP;
+        return 0;
+    }
+
+    bool updateFile(unsigned slot, int qfd)
+    {
+        struct io_uring_files_update up;
+
+        memset(&up, 0, sizeof(up));
+        up.offset = slot;
+        up.fds = (uint64_t)&qfd;
+        return uringRegister(fd, IORING_REGISTER_FILES_UPDATE, &up, 1) == 1;
+    }
+
+    // Hand the SQ ring to the kernel, called with sqLock held
+    void flush()
+    {
+        if (sqpoll) {
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+            if (__atomic_load_n(sqFlags, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP)
+                uringEnter(fd, 0, 0, IORING_ENTER_SQ_WAKEUP);
+            return;
+        }
+
+        // Requests not consumed on error stay in the ring and go out
+        // with the next submit
+        while (toSubmit) {
+            int ret = uringEnter(fd, toSubmit, 0, 0);
+            if (ret < 0) {
+                if (errno == EINTR)
+                    continue;
+                break;
+            }
+            toSubmit -= ret;
+        }
+    }
+};
+
+uring::uring(std::unique_ptr<impl> i) : mImpl(std::move(i))
+{
+}
+
+uring::~uring()
+{
+}
+
+std::unique_ptr<uring> uring::create(unsigned entries, bool sqpoll)
+{
+    auto i = std::make_unique<impl>();
+    if (i->init(entries, sqpoll)) {
+        if (!sqpoll)
+            return nullptr;
+        // SQPOLL needs privileges on older kernels, retry without
+        i = std::make_unique<impl>();
+        if (i->init(entries, false))
+            return nullptr;
+    }
+    return std::unique_ptr<uring>(new uring(std::move(i)));
+}
+
+void uring::addFile(int fd)
+{
+    if (!mImpl->fixedFiles)
+        return;
+
+    std::lock_guard<std::mutex> lk(mImpl->fileLock);
+    auto itr = std::find(mImpl->files.begin(), mImpl->files.end(), -1);
+    if (itr == mImpl->files.end())
+        return;
+    unsigned slot = itr - mImpl->files.begin();
+    if (mImpl->updateFile(slot, fd)) {
+        mImpl->files[slot] = fd;
+        mImpl->slots[fd] = slot;
+    }
+}
+
+void uring::removeFile(int fd)
+{
+    if (!mImpl->fixedFiles)
+        return;
+
+    std::lock_guard<std::mutex> lk(mImpl->fileLock);
+    auto itr = mImpl->slots.find(fd);
+    if (itr == mImpl->slots.end())
+        return;
+    mImpl->updateFile(itr->second, -1);
+    mImpl->files[itr->second] = -1;
+    mImpl->slots.erase(itr);
+}
+
+int uring::submit(int fd, bool write, const struct iovec *iov, unsigned iovcnt,
+    unsigned num, uint64_t data)
+{
+    int sqfd = fd;
+    bool fixed = false;
+
+    if (mImpl->fixedFiles) {
+        std::lock_guard<std::mutex> lk(mImpl->fileLock);
+        auto itr = mImpl->slots.find(fd);
+        if (itr != mImpl->slots.end()) {
+            sqfd = itr->second;
+            fixed = true;
+        }
+    }
+    // SQPOLL without registered file is not supported by older kernels,
+    // init() has made sure such a ring is never created
+
+    std::lock_guard<std::mutex> lk(mImpl->sqLock);
+    unsigned tail = *mImpl->sqTail;
+    unsigned head = __atomic_load_n(mImpl->sqHead, __ATOMIC_ACQUIRE);
+    unsigned space = mImpl->sqEntries - (tail - head);
+    unsigned queued = std::min(num, space);
+
+    for (unsigned i = 0; i < queued; i++, tail++) {
+        unsigned idx = tail & *mImpl->sqMask;
+        struct io_uring_sqe *sqe = &mImpl->sqes[idx];
+
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = write ? IORING_OP_WRITEV : IORING_OP_READV;
+        sqe->fd = sqfd;
+        if (fixed)
+            sqe->flags = IOSQE_FIXED_FILE;
+        sqe->addr = (uint64_t)&iov[i * iovcnt];
+        sqe->len = iovcnt;
+        sqe->off = 0;
+        sqe->user_data = data;
+        mImpl->sqArray[idx] = idx;
+    }
+    __atomic_store_n(mImpl->sqTail, tail, __ATOMIC_RELEASE);
+    mImpl->toSubmit += queued;
+    mImpl->flush();
+    return queued;
+}
+
+int uring::reap(int min, int max, completion *comps, int timeout)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+    int num = 0;
+
+    std::lock_guard<std::mutex> lk(mImpl->cqLock);
+    while (true) {
+        unsigned head = *mImpl->cqHead;
+        unsigned tail = __atomic_load_n(mImpl->cqTail, __ATOMIC_ACQUIRE);
+
+        for (; head != tail && num < max; head++, num++) {
+            struct io_uring_cqe *cqe = &mImpl->cqes[head & *mImpl->cqMask];
+            comps[num].data = cqe->user_data;
+            comps[num].res = cqe->res;
+        }
+        __atomic_store_n(mImpl->cqHead, head, __ATOMIC_RELEASE);
+        if (num >= min)
+            break;
+
+        if (timeout > 0) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>
+                (deadline - std::chrono::steady_clock::now()).count();
+            if (left <= 0)
+                break;
+            struct pollfd pfd = { mImpl->fd, POLLIN, 0 };
+            if (poll(&pfd, 1, left) < 0 && errno != EINTR)
+                break;
+        } else if (uringEnter(mImpl->fd, 0, min - num, IORING_ENTER_GETEVENTS) < 0
+            && errno != EINTR) {
+            break;
+        }
+    }
+    return num;
+}
+
+bool uring::sqpoll() const
+{
+    return mImpl->sqpoll;
+}
+
+#else
+
+struct uring::impl {};
+
+uring::uring(std::unique_ptr<impl> i) : mImpl(std::move(i))
+{
+}
+
+uring::~uring()
+{
+}
+
+std::unique_ptr<uring> uring::create(unsigned, bool)
+{
+    return nullptr;
+}
+
+void uring::addFile(int)
+{
+}
+
+void uring::removeFile(int)
+{
+}
+
+int uring::submit(int, bool, const struct iovec *, unsigned, unsigned, uint64_t)
+{
+    return -EOPNOTSUPP;
+}
+
+int uring::reap(int, int, completion *, int)
+{
+    return 0;
+}
+
+bool uring::sqpoll() const
+{
+    return false;
+}
+
+#endif
+
+} /* xocl */
@@ -0,0 +1,72 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#ifndef _XCL_URING_H_
+#define _XCL_URING_H_
+
+#include <cstdint>
+#include <memory>
+#include <sys/uio.h>
+
+namespace xocl {
+
+/*
+ * io_uring backend for QDMA stream queues
+ *
+ * Submission and completion rings shared with the kernel, so that in
+ * the common case a stream request costs no more than one syscall and
+ * with SQPOLL none at all.  Queue fds are added to the registered file
+ * table of the ring so the kernel does not look up the fd per request.
+ *
+ * Raw syscalls are used, no dependency on liburing.  create() returns
+ * nullptr when the kernel or the build headers lack io_uring, callers
+ * then fall back to Linux AIO.
+ */
+class uring {
+public:
+    struct completion {
+        uint64_t data;
+        int32_t res;
+    };
+
+    static std::unique_ptr<uring> create(unsigned entries, bool sqpoll);
+    ~uring();
+
+    // Register / unregister a queue fd in the fixed file table
+    void addFile(int fd);
+    void removeFile(int fd);
+
+    // Queue num readv or writev requests on fd, request i transfers
+    // iov[i*iovcnt] .. iov[(i+1)*iovcnt-1].  All requests complete with
+    // the same data.  Returns number of requests queued.
+    int submit(int fd, bool write, const struct iovec *iov, unsigned iovcnt,
+        unsigned num, uint64_t data);
+
+    // Reap between min and max completions.  timeout in ms, <= 0
+    // waits forever.  Returns number of completions reaped.
+    int reap(int min, int max, completion *comps, int timeout);
+
+    bool sqpoll() const;
+
+private:
+    struct impl;
+    std::unique_ptr<impl> mImpl;
+
+    uring(std::unique_ptr<impl> i);
+};
+
+} /* xocl */
+
+#endif
@@ -20,12 +20,14 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
-#include <sys/select.h>
-#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
 #include <syslog.h>
 #include <unistd.h>
 #include <strings.h>
 #include <algorithm>
+#include <cstring>
 
 #include "common.h"
 #include "sw_msg.h"
@@ -42,56 +44,102 @@ int splitLine(std::string line, std::string& key, std::string& value)
     return 0;
 }
 
-/* Retrieve size for the next msg from socket fd. */
-size_t getSockMsgSize(pcieFunc& dev, int sockfd)
+/*
+ * Mailbox msgs are mostly small requests and replies. Read into a buffer
+ * of this size first, which takes the whole msg in one read. Only bigger
+ * msgs (e.g. xclbin) need a second read once the driver reported the size.
+ */
+static const size_t mailboxReadHint = 16 * 1024;
+static const size_t maxSockMsgSize = 1024 * 1024 * 1024;
+// Socket buffers big enough to keep an xclbin transfer streaming
+static const int sockBufSize = 4 * 1024 * 1024;
+
+/* Read exactly len bytes from fd. */
+static bool readFull(int fd, char *buf, size_t len)
 {
-    std::shared_ptr<sw_msg> swmsg = std::make_shared<sw_msg>(0);
+    size_t cur = 0;
 
-    if (recv(sockfd, swmsg->data(), swmsg->size(), MSG_PEEK) !=
-        static_cast<ssize_t>(swmsg->size())) {
-        dev.log(LOG_ERR, "can't receive sw_chan from socket, %m");
-        return 0;
+    while (cur < len) {
+        ssize_t ret = read(fd, buf + cur, len - cur);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0)
+            return false;
+        cur += ret;
     }
-
-    dev.log(LOG_INFO, "retrieved msg size from socket: %d bytes",
-        swmsg->payloadSize());
-    return swmsg->payloadSize();
+    return true;
 }
 
-/* Retrieve size for the next msg from mailbox fd. */
-size_t getMailboxMsgSize(pcieFunc& dev, int mbxfd)
+/* Read next msg from socket fd, header first, then payload. */
+std::shared_ptr<sw_msg> readSockMsg(pcieFunc& dev, int sockfd)
 {
-    std::shared_ptr<sw_msg> swmsg = std::make_shared<sw_msg>(0);
+    sw_chan sc;
 
-    // This read is expected to fail w/ errno == EMSGSIZE
-    // However, the real msg size should be filled out by driver.
-    if (read(mbxfd, swmsg->data(), swmsg->size()) >= 0 || errno != EMSGSIZE) {
-        dev.log(LOG_ERR, "can't read sw_chan from mailbox, %m");
-        return 0;
+    if (!readFull(sockfd, reinterpret_cast<char *>(&sc), sizeof(sc))) {
+        dev.log(LOG_ERR, "can't receive sw_chan from socket, %m");
+        return nullptr;
+    }
+    if (sc.sz > maxSockMsgSize) {
+        dev.log(LOG_ERR, "msg from socket is too big: %lu bytes", sc.sz);
+        return nullptr;
     }
 
-    dev.log(LOG_INFO, "retrieved msg size from mailbox: %d bytes",
-        swmsg->payloadSize());
-    return swmsg->payloadSize();
+    std::shared_ptr<sw_msg> swmsg = std::make_shared<sw_msg>(sc.sz);
+    std::memcpy(swmsg->data(), &sc, sizeof(sc));
+    if (!readFull(sockfd, swmsg->payloadData(), sc.sz)) {
+        dev.log(LOG_ERR, "short read of %lu bytes msg from socket, %m", sc.sz);
+        return nullptr;
+    }
+
+    dev.log(LOG_INFO, "read %d bytes msg from socket fd %d",
+        swmsg->size(), sockfd);
+    return swmsg;
 }
 
-/* Read a sw channel msg from fd (can be a socket or mailbox one). */
-bool readMsg(pcieFunc& dev, int fd, sw_msg *swmsg)
+/* Read next msg from mailbox fd. */
+std::shared_ptr<sw_msg> readMailboxMsg(pcieFunc& dev, int mbxfd)
 {
-    ssize_t total = swmsg->size();
-    ssize_t cur = 0;
-    char *buf = swmsg->data();
+    std::shared_ptr<sw_msg> swmsg = std::make_shared<sw_msg>(mailboxReadHint);
+
+    ssize_t ret = read(mbxfd, swmsg->data(), swmsg->size());
+    if (ret < 0 && errno == EMSGSIZE) {
+        // Driver filled in the real size in the header, try again.
+        dev.log(LOG_INFO, "retrieved msg size from mailbox: %d bytes",
+            swmsg->payloadSize());
+        swmsg->resize(swmsg->payloadSize());
+        ret = read(mbxfd, swmsg->data(), swmsg->size());
+    }
+    if (ret < 0 || static_cast<size_t>(ret) < sizeof(sw_chan)) {
+        dev.log(LOG_ERR, "can't read sw_chan from mailbox, %m");
+        return nullptr;
+    }
 
-    while (cur < total) {
-        ssize_t ret = read(fd, buf + cur, total - cur);
-        if (ret <= 0)
-            break;
-        cur += ret;
+    swmsg->resize(swmsg->payloadSize());
+    if (!swmsg->valid() || static_cast<size_t>(ret) != swmsg->size()) {
+        dev.log(LOG_ERR, "short read of %d bytes msg from mailbox",
+            swmsg->size());
+        return nullptr;
     }
 
-    dev.log(LOG_INFO, "read %d bytes out of %d bytes from fd %d, valid: %d",
-        cur, total, fd, swmsg->valid());
-    return (cur == total && swmsg->valid());
+    dev.log(LOG_INFO, "read %d bytes msg from mailbox fd %d",
+        swmsg->size(), mbxfd);
+    return swmsg;
+}
+
+/*
+ * Request and reply msgs are small and latency bound, so don't let Nagle
+ * hold them back. Large buffers let big msgs stream without stalling on
+ * the window.
+ */
+void tuneSocket(pcieFunc& dev, int sockfd)
+{
+    int on = 1;
+    int sz = sockBufSize;
+
+    if (setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on)) != 0)
+        dev.log(LOG_WARNING, "failed to set TCP_NODELAY: %m");
+    (void) setsockopt(sockfd, SOL_SOCKET, SO_SNDBUF, &sz, sizeof(sz));
+    (void) setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &sz, sizeof(sz));
 }
 
 /* Write a sw channel msg to fd (can be a socket or mailbox one). */
@@ -103,6 +151,8 @@ bool sendMsg(pcieFunc& dev, int fd, sw_msg *swmsg)
 
     while (cur < total) {
         ssize_t ret = write(fd, buf + cur, total - cur);
+        if (ret < 0 && errno == EINTR)
+            continue;
         if (ret <= 0)
             break;
         cur += ret;
@@ -119,32 +169,23 @@ bool sendMsg(pcieFunc& dev, int fd, sw_msg *swmsg)
  */
 int waitForMsg(pcieFunc& dev, int localfd, int remotefd, long interval)
 {
-    fd_set fds;
+    struct pollfd fds[2] = {
+        { localfd, POLLIN, 0 },
+        { remotefd, POLLIN, 0 },
+    };
     int retfd = -1;
-    int ret = 0;
-    struct timeval timeout = { interval, 0 };
-
-    FD_ZERO(&fds);
-    if (localfd >= 0)
-        FD_SET(localfd, &fds);
-    if (remotefd >= 0)
-        FD_SET(remotefd, &fds);
-
-    if (interval == 0) {
-        ret = select(std::max(localfd, remotefd) + 1, &fds, NULL, NULL, NULL);
-    } else {
-        ret = select(std::max(localfd, remotefd) + 1, &fds,
-            NULL, NULL, &timeout);
-    }
 
+    // poll() ignores negative fds, and unlike select() has no limit on
+    // fd numbers, which matters with many boards in one daemon.
+    int ret = poll(fds, 2, interval == 0 ? -1 : interval * 1000);
     if (ret == -1) {
-        dev.log(LOG_ERR, "failed to select: %m");
+        dev.log(LOG_ERR, "failed to poll: %m");
         return -EINVAL; // failed
     }
     if (ret == 0)
         return -EAGAIN; // time'd tout
 
-    if (FD_ISSET(localfd, &fds)) {
+    if (fds[0].revents) {
         retfd = localfd;
         dev.log(LOG_INFO, "msg arrived on mailbox fd %d", retfd);
     } else {
@@ -160,15 +201,8 @@ int waitForMsg(pcieFunc& dev, int localfd, int remotefd, long interval)
  */
 int processLocalMsg(pcieFunc& dev, int localfd, int remotefd, msgHandler cb)
 {
-    size_t msgsz = getMailboxMsgSize(dev, localfd);
-    if (msgsz == 0)
-        return -EINVAL;
-
-    std::shared_ptr<sw_msg> swmsg = std::make_shared<sw_msg>(msgsz);
+    std::shared_ptr<sw_msg> swmsg = readMailboxMsg(dev, localfd);
     if (swmsg == nullptr)
-        return -ENOMEM;
-
-    if (!readMsg(dev, localfd, swmsg.get()))
         return -EINVAL;
 
     int pass;
@@ -198,18 +232,8 @@ int processLocalMsg(pcieFunc& dev, int localfd, int remotefd, msgHandler cb)
  */
 int processRemoteMsg(pcieFunc& dev, int localfd, int remotefd, msgHandler cb)
 {
-    size_t msgsz = getSockMsgSize(dev, remotefd);
-    if (msgsz == 0)
-        return -EAGAIN;
-
-    if (msgsz > 1024 * 1024 * 1024)
-        return -EMSGSIZE;
-
-    std::shared_ptr<sw_msg> swmsg = std::make_shared<sw_msg>(msgsz);
+    std::shared_ptr<sw_msg> swmsg = readSockMsg(dev, remotefd);
     if (swmsg == nullptr)
-        return -ENOMEM;
-
-    if (!readMsg(dev, remotefd, swmsg.get()))
         return -EAGAIN;
 
     int pass;
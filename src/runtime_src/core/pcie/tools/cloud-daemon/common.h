@@ -36,10 +36,10 @@ using msgHandler = int(*)(pcieFunc& dev, std::shared_ptr<sw_msg>&,
 int splitLine(std::string line, std::string& key, std::string& value);
 sw_chan *allocmsg(pcieFunc& dev, size_t payloadSize);
 void freemsg(sw_chan *msg);
-size_t getSockMsgSize(pcieFunc& dev, int sockfd);
-size_t getMailboxMsgSize(pcieFunc& dev, int mbxfd);
-bool readMsg(pcieFunc& dev, int fd, sw_chan *sc);
-bool sendMsg(pcieFunc& dev, int fd, sw_chan *sc);
+std::shared_ptr<sw_msg> readSockMsg(pcieFunc& dev, int sockfd);
+std::shared_ptr<sw_msg> readMailboxMsg(pcieFunc& dev, int mbxfd);
+bool sendMsg(pcieFunc& dev, int fd, sw_msg *swmsg);
+void tuneSocket(pcieFunc& dev, int sockfd);
 int waitForMsg(pcieFunc& dev, int localfd, int remotefd, long interval);
 int processLocalMsg(pcieFunc& dev, int localfd, int remotefd,
     msgHandler cb = nullptr);
@@ -68,6 +68,8 @@ static int connectMsd(pcieFunc& dev, std::string ip, uint16_t port, int id)
         return -1;
     }
 
+    tuneSocket(dev, msdfd);
+
     id = htonl(id);
     if (write(msdfd, &id, sizeof(id)) != sizeof(id)) {
         dev.log(LOG_ERR, "failed to send id to msd: %m");
@@ -35,6 +35,7 @@
 #include "msd_plugin.h"
 #include "sw_msg.h"
 #include "common.h"
+#include "xclbin_cache.h"
 #include "xclbin.h"
 #include "core/pcie/driver/linux/include/mgmt-ioctl.h"
 
@@ -52,6 +53,12 @@ fini_fn plugin_fini;
 struct msd_plugin_callbacks plugin_cbs;
 static const std::string plugin_path("/lib/firmware/xilinx/msd_plugin.so");
 
+// Xclbins returned by the plugin, shared by all boards
+std::unique_ptr<xclbinCache> xclbin_cache;
+static const size_t xclbin_cache_mem_mb = 1024;
+static const std::string xclbin_cache_dir("/var/cache/msd");
+static const size_t xclbin_cache_disk_mb = 8192;
+
 // Init plugin callbacks
 static void init_plugin()
 {
@@ -66,8 +73,8 @@ static void init_plugin()
         syslog(LOG_ERR, "failed to find init/fini symbols in plugin");
 }
 
-// Get host configured in config file
-static std::string getHost()
+// Get value of name in config file, empty if not configured
+static std::string getConfig(const std::string& name)
 {
     std::ifstream cfile(configFile);
     if (!cfile.good()) {
@@ -80,14 +87,68 @@ static std::string getHost()
         int ret = splitLine(line, key, value);
         if (ret != 0)
             break;
-        if (key.compare("host") == 0)
+        if (key.compare(name) == 0)
             return value;
     }
-
-    syslog(LOG_ERR, "failed to read hostname from: %s", configFile.c_str());
     return "";
 }
 
+// Get host configured in config file
+static std::string getHost()
+{
+    std::string host = getConfig("host");
+    if (host.empty())
+        syslog(LOG_ERR, "failed to read hostname from: %s", configFile.c_str());
+    return host;
+}
+
+// Get size in MB configured in config file, in bytes
+static size_t getConfigMB(const std::string& name, size_t def)
+{
+    std::string value = getConfig(name);
+    try {
+        if (!value.empty())
+            def = std::stoul(value);
+    } catch (const std::exception&) {
+        syslog(LOG_ERR, "bad %s in %s: %s", name.c_str(), configFile.c_str(),
+            value.c_str());
+    }
+    return def << 20;
+}
+
+// Copy out the xclbin the plugin retrieved for the one sent by the VM
+static int retrieveXclbin(char *orig, size_t origLen, std::vector<char>& xclbin)
+{
+    retrieve_xclbin_fini_fn done = nullptr;
+    void *done_arg = nullptr;
+    char *newxclbin = nullptr;
+    size_t newlen = 0;
+
+    int ret = (*plugin_cbs.retrieve_xclbin)(orig, origLen,
+        &newxclbin, &newlen, &done, &done_arg);
+    if (ret)
+        return ret;
+
+    if (newxclbin == nullptr || newlen == 0)
+        ret = -EINVAL;
+    else
+        xclbin.assign(newxclbin, newxclbin + newlen);
+
+    if (done)
+        (*done)(done_arg, newxclbin, newlen);
+    return ret;
+}
+
+// Cache configured in config file, sizes of 0 disable a level
+static void init_xclbin_cache()
+{
+    std::string dir = getConfig("xclbin_cache_dir");
+    xclbin_cache.reset(new xclbinCache(retrieveXclbin,
+        getConfigMB("xclbin_cache_mem_mb", xclbin_cache_mem_mb),
+        dir.empty() ? xclbin_cache_dir : dir,
+        getConfigMB("xclbin_cache_disk_mb", xclbin_cache_disk_mb)));
+}
+
 static void createSocket(pcieFunc& dev, int& sockfd, uint16_t& port)
 {
     struct sockaddr_in saddr = { 0 };
@@ -162,6 +223,8 @@ static int connectMpd(pcieFunc& dev, int sockfd, int id, int& mpdfd)
         return -errno;
     }
 
+    tuneSocket(dev, mpdfd);
+
     if (verifyMpd(dev, mpdfd, id) != 0) {
         dev.log(LOG_ERR, "failed to verify mpd");
         close(mpdfd);
@@ -175,22 +238,21 @@ static int connectMpd(pcieFunc& dev, int sockfd, int id, int& mpdfd)
 
 static int download_xclbin(pcieFunc& dev, char *xclbin)
 {
-    retrieve_xclbin_fini_fn done = nullptr;
-    void *done_arg = nullptr;
+    xclbinBuf cached;
     char *newxclbin = nullptr;
     size_t newlen = 0;
     int ret = 0;
 
     xclmgmt_ioc_bitstream_axlf x = {reinterpret_cast<axlf *>(xclbin)};
     if (plugin_cbs.retrieve_xclbin) {
-        ret = (*plugin_cbs.retrieve_xclbin)(xclbin,
-            x.xclbin->m_header.m_length, &newxclbin, &newlen, &done, &done_arg);
+        ret = xclbin_cache->get(xclbin, x.xclbin->m_header.m_length, cached);
         if (ret)
             return ret;
+        newxclbin = const_cast<char *>(cached->data());
+        newlen = cached->size();
     } else {
         newxclbin = xclbin;
         newlen = x.xclbin->m_header.m_length;
-        done = NULL;
     }
 
     if (newxclbin == nullptr || newlen == 0)
@@ -199,9 +261,6 @@ static int download_xclbin(pcieFunc& dev, char *xclbin)
     xclmgmt_ioc_bitstream_axlf obj = {reinterpret_cast<axlf *>(newxclbin)};
     ret = dev.ioctl(XCLMGMT_IOCICAPDOWNLOAD_AXLF, &obj);
 
-    if (done)
-        (*done)(done_arg, newxclbin, newlen);
-
     return ret;
 }
 
@@ -338,6 +397,8 @@ int main(void)
             dlclose(plugin_handle);
             return 0;
         }
+        if (plugin_cbs.retrieve_xclbin)
+            init_xclbin_cache();
     }
 
     // Fetching host name from config file.
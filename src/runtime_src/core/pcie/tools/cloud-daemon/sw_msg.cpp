@@ -45,6 +45,11 @@ size_t sw_msg::size()
     return buf->size();
 }
 
+void sw_msg::resize(size_t len)
+{
+    buf->resize(sizeof(sw_chan) + len);
+}
+
 size_t sw_msg::payloadSize()
 {
     sw_chan *sc = reinterpret_cast<sw_chan *>(buf->data());
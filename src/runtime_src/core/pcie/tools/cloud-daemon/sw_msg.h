@@ -33,6 +33,8 @@ public:
     size_t size();
     char *data();
     bool valid();
+    // Resize the buffer to hold 'len' bytes of payload, keeps the header.
+    void resize(size_t len);
 
     size_t payloadSize();
     char *payloadData();
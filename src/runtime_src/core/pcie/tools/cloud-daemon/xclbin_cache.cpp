@@ -0,0 +1,242 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <syslog.h>
+#include <uuid/uuid.h>
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include <boost/filesystem.hpp>
+
+#include "xclbin_cache.h"
+#include "xclbin.h"
+
+namespace bfs = boost::filesystem;
+
+static const std::string suffix(".xclbin");
+
+xclbinCache::xclbinCache(xclbinFetcher f, size_t memLimit,
+    const std::string& dir, size_t diskLimit) :
+    fetcher(f), memLimit(memLimit), dir(dir), diskLimit(diskLimit)
+{
+    if (this->dir.empty() || diskLimit == 0) {
+        this->dir.clear();
+        return;
+    }
+
+    boost::system::error_code ec;
+    bfs::create_directories(this->dir, ec);
+    if (ec) {
+        syslog(LOG_ERR, "failed to create xclbin cache %s: %s",
+            this->dir.c_str(), ec.message().c_str());
+        this->dir.clear();
+    }
+}
+
+int xclbinCache::get(char *orig, size_t origLen, xclbinBuf& xclbin)
+{
+    const axlf *top = reinterpret_cast<const axlf *>(orig);
+
+    if (uuid_is_null(top->m_header.uuid) || (memLimit == 0 && dir.empty())) {
+        auto buf = std::make_shared<std::vector<char>>();
+        int ret = fetcher(orig, origLen, *buf);
+        xclbin = buf;
+        return ret;
+    }
+
+    char uuid[37];
+    uuid_unparse_lower(top->m_header.uuid, uuid);
+    std::string key(uuid);
+
+    std::promise<fetchResult> promise;
+    std::shared_future<fetchResult> result;
+    bool owner = false;
+    {
+        std::lock_guard<std::mutex> l(lock);
+        auto it = index.find(key);
+        if (it != index.end()) {
+            lru.splice(lru.begin(), lru, it->second);
+            xclbin = it->second->second;
+            return 0;
+        }
+
+        auto fit = inflight.find(key);
+        if (fit == inflight.end()) {
+            result = promise.get_future().share();
+            inflight[key] = result;
+            owner = true;
+        } else {
+            result = fit->second;
+        }
+    }
+
+    if (owner) {
+        fetchResult r = fetch(key, orig, origLen);
+        {
+            std::lock_guard<std::mutex> l(lock);
+            inflight.erase(key);
+            if (r.ret == 0)
+                memInsert(key, r.xclbin);
+        }
+        promise.set_value(r);
+    }
+
+    fetchResult r = result.get();
+    xclbin = r.xclbin;
+    return r.ret;
+}
+
+xclbinCache::fetchResult xclbinCache::fetch(const std::string& key,
+    char *orig, size_t origLen)
+{
+    fetchResult r = { 0, diskLoad(key) };
+    if (r.xclbin)
+        return r;
+
+    auto buf = std::make_shared<std::vector<char>>();
+    try {
+        r.ret = fetcher(orig, origLen, *buf);
+    } catch (const std::bad_alloc&) {
+        r.ret = -ENOMEM;
+    }
+    if (r.ret)
+        return r;
+
+    syslog(LOG_INFO, "fetched xclbin %s, %zu bytes", key.c_str(), buf->size());
+    diskStore(key, *buf);
+    r.xclbin = buf;
+    return r;
+}
+
+// Caller holds lock
+void xclbinCache::memInsert(const std::string& key, xclbinBuf xclbin)
+{
+    if (xclbin->size() > memLimit)
+        return;
+
+    lru.emplace_front(key, xclbin);
+    index[key] = lru.begin();
+    memSize += xclbin->size();
+
+    while (memSize > memLimit) {
+        auto& victim = lru.back();
+        memSize -= victim.second->size();
+        index.erase(victim.first);
+        lru.pop_back();
+    }
+}
+
+std::string xclbinCache::path(const std::string& key)
+{
+    return dir + "/" + key + suffix;
+}
+
+xclbinBuf xclbinCache::diskLoad(const std::string& key)
+{
+    if (dir.empty())
+        return nullptr;
+
+    std::string file = path(key);
+    std::ifstream in(file, std::ios::binary | std::ios::ate);
+    if (!in.good())
+        return nullptr;
+
+    auto buf = std::make_shared<std::vector<char>>(in.tellg());
+    in.seekg(0);
+    in.read(buf->data(), buf->size());
+
+    // Drop truncated or otherwise bad files
+    const axlf *top = reinterpret_cast<const axlf *>(buf->data());
+    if (!in.good() || buf->size() < sizeof(axlf) ||
+        std::memcmp(top->m_magic, "xclbin2", 8) ||
+        top->m_header.m_length != buf->size()) {
+        syslog(LOG_ERR, "removing bad cached xclbin %s", file.c_str());
+        boost::system::error_code ec;
+        bfs::remove(file, ec);
+        return nullptr;
+    }
+
+    // Modification time orders the files for eviction
+    boost::system::error_code ec;
+    bfs::last_write_time(file, std::time(nullptr), ec);
+    syslog(LOG_INFO, "xclbin %s from disk cache", key.c_str());
+    return buf;
+}
+
+void xclbinCache::diskStore(const std::string& key,
+    const std::vector<char>& xclbin)
+{
+    if (dir.empty() || xclbin.size() > diskLimit)
+        return;
+
+    // Readers never see a partial file
+    std::string file = path(key);
+    std::string tmp = file + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        out.write(xclbin.data(), xclbin.size());
+        if (!out.good()) {
+            syslog(LOG_ERR, "failed to write %s", tmp.c_str());
+            out.close();
+            std::remove(tmp.c_str());
+            return;
+        }
+    }
+    if (std::rename(tmp.c_str(), file.c_str())) {
+        syslog(LOG_ERR, "failed to rename %s: %m", tmp.c_str());
+        std::remove(tmp.c_str());
+        return;
+    }
+
+    diskTrim();
+}
+
+// Evict least recently used files until the cache fits its limit
+void xclbinCache::diskTrim()
+{
+    struct cachedFile {
+        std::time_t mtime;
+        uintmax_t size;
+        bfs::path path;
+    };
+    std::vector<cachedFile> files;
+    uintmax_t total = 0;
+    boost::system::error_code ec;
+
+    for (bfs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+        const bfs::path& p = it->path();
+        if (p.extension() != suffix)
+            continue;
+        boost::system::error_code fec;
+        cachedFile f = { bfs::last_write_time(p, fec), bfs::file_size(p, fec), p };
+        if (fec)
+            continue;
+        files.push_back(f);
+        total += f.size;
+    }
+
+    std::sort(files.begin(), files.end(),
+        [](const cachedFile& a, const cachedFile& b) { return a.mtime < b.mtime; });
+    for (auto& f : files) {
+        if (total <= diskLimit)
+            break;
+        syslog(LOG_INFO, "evicting cached xclbin %s", f.path.c_str());
+        bfs::remove(f.path, ec);
+        total -= f.size;
+    }
+}
@@ -0,0 +1,82 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+/* Cache of xclbins returned by the msd plugin. */
+
+#ifndef XCLBIN_CACHE_H
+#define XCLBIN_CACHE_H
+
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <future>
+#include <functional>
+
+using xclbinBuf = std::shared_ptr<const std::vector<char>>;
+
+// Fetches the xclbin to download for the one sent by the VM, e.g. through
+// retrieve_xclbin() of the plugin.
+using xclbinFetcher = std::function<int(char *orig, size_t origLen,
+    std::vector<char>& xclbin)>;
+
+/*
+ * Xclbins are keyed by the UUID of the xclbin sent by the VM and kept in
+ * an in-memory LRU list and, if a directory is configured, as files in
+ * that directory.  A miss on both fetches the xclbin, concurrent requests
+ * for the same UUID wait for that one fetch.  Xclbins without UUID are not
+ * cached.  A limit of 0 disables the memory or disk level.
+ */
+class xclbinCache {
+public:
+    xclbinCache(xclbinFetcher f, size_t memLimit, const std::string& dir,
+        size_t diskLimit);
+
+    // Get the xclbin to download, 0 or negative error code.
+    int get(char *orig, size_t origLen, xclbinBuf& xclbin);
+
+private:
+    struct fetchResult {
+        int ret;
+        xclbinBuf xclbin;
+    };
+
+    xclbinFetcher fetcher;
+    size_t memLimit;
+    size_t memSize = 0;
+    std::string dir;
+    size_t diskLimit;
+
+    // Most recently used first
+    std::list<std::pair<std::string, xclbinBuf>> lru;
+    std::map<std::string, decltype(lru)::iterator> index;
+    std::map<std::string, std::shared_future<fetchResult>> inflight;
+    std::mutex lock;
+
+    fetchResult fetch(const std::string& key, char *orig, size_t origLen);
+    void memInsert(const std::string& key, xclbinBuf xclbin);
+    xclbinBuf diskLoad(const std::string& key);
+    void diskStore(const std::string& key, const std::vector<char>& xclbin);
+    void diskTrim();
+    std::string path(const std::string& key);
+
+    xclbinCache(const xclbinCache& c) = delete;
+    xclbinCache& operator=(const xclbinCache& c) = delete;
+};
+
+#endif // XCLBIN_CACHE_H
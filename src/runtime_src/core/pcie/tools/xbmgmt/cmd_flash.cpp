@@ -19,7 +19,11 @@
 #include <iostream>
 #include <map>
 #include <functional>
+#include <vector>
 #include <getopt.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/wait.h>
 
 #include "flasher.h"
 #include "core/pcie/linux/scan.h"
@@ -29,7 +33,7 @@
 const char *subCmdFlashDesc = "Update SC firmware or shell on the device";
 const char *subCmdFlashUsage =
     "--scan [--verbose|--json]\n"
-    "--update [--shell name [--timestamp timestamp]] [--card bdf] [--force]\n"
+    "--update [--shell name [--timestamp timestamp]] [--card bdf|all] [--force]\n"
     "--shell --path file [--card bdf] [--type flash_type]\n"
     "--sc_firmware --path file [--card bdf]\n"
     "--reset [--card bdf]";
@@ -224,6 +228,151 @@ static int updateShellAndSC(unsigned boardIdx, DSAInfo& candidate, bool& reboot)
     return 0;
 }
 
+// Exit codes of a card update child process
+enum {
+    CHILD_UPDATED = 0,
+    CHILD_UPDATED_REBOOT = 1,
+    CHILD_FAILED = 2,
+};
+
+struct updateChild {
+    pid_t pid;
+    int fd;
+    std::string bdf;
+    std::string partial;
+};
+
+// Print complete lines from a child, tagged with the card they belong to.
+static void printChildOutput(updateChild& c, bool eof)
+{
+    size_t start = 0;
+    size_t end;
+    while ((end = c.partial.find('\n', start)) != std::string::npos) {
+        std::cout << "[" << c.bdf << "] " << c.partial.substr(start, end - start)
+            << std::endl;
+        start = end + 1;
+    }
+    c.partial.erase(0, start);
+    if (eof && !c.partial.empty()) {
+        std::cout << "[" << c.bdf << "] " << c.partial << std::endl;
+        c.partial.clear();
+    }
+}
+
+// Update all cards concurrently, one child process per card. The SPI
+// flashers keep their transfer state in file scope statics and report
+// progress on stdout, so each card is flashed in its own process and its
+// output is forwarded line by line with the card BDF in front.
+static void updateShellAndSCParallel(
+    const std::vector<std::pair<unsigned, DSAInfo>>& boards,
+    unsigned& success, bool& needreboot)
+{
+    std::vector<updateChild> children;
+
+    std::cout << std::flush;
+    fflush(stdout);
+    for (auto p : boards) {
+        updateChild c;
+        c.bdf = pcidev::get_dev(p.first, false)->sysfs_name;
+
+        int fds[2];
+        if (pipe(fds) != 0) {
+            std::cout << "ERROR: Failed to update card [" << c.bdf << "]: "
+                << strerror(errno) << std::endl;
+            continue;
+        }
+
+        c.pid = fork();
+        if (c.pid < 0) {
+            std::cout << "ERROR: Failed to update card [" << c.bdf << "]: "
+                << strerror(errno) << std::endl;
+            close(fds[0]);
+            close(fds[1]);
+            continue;
+        }
+
+        if (c.pid == 0) {
+            close(fds[0]);
+            dup2(fds[1], STDOUT_FILENO);
+            dup2(fds[1], STDERR_FILENO);
+            close(fds[1]);
+
+            bool reboot = false;
+            DSAInfo candidate = p.second;
+            int ret = updateShellAndSC(p.first, candidate, reboot);
+            std::cout << std::flush;
+            fflush(stdout);
+            _exit(ret != 0 ? CHILD_FAILED :
+                (reboot ? CHILD_UPDATED_REBOOT : CHILD_UPDATED));
+        }
+
+        close(fds[1]);
+        c.fd = fds[0];
+        children.push_back(c);
+    }
+
+    size_t done = 0;
+    size_t running = children.size();
+    while (running > 0) {
+        std::vector<pollfd> pfds;
+        std::vector<updateChild*> owners;
+        for (auto& c : children) {
+            if (c.fd < 0)
+                continue;
+            pfds.push_back({ c.fd, POLLIN, 0 });
+            owners.push_back(&c);
+        }
+
+        if (poll(pfds.data(), pfds.size(), -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        for (size_t i = 0; i < pfds.size(); i++) {
+            if (!pfds[i].revents)
+                continue;
+
+            updateChild& c = *owners[i];
+            char buf[4096];
+            ssize_t n = read(c.fd, buf, sizeof(buf));
+            if (n > 0) {
+                c.partial.append(buf, n);
+                printChildOutput(c, false);
+                continue;
+            }
+            if (n < 0 && errno == EINTR)
+                continue;
+
+            // EOF, collect the child and roll up progress
+            printChildOutput(c, true);
+            close(c.fd);
+            c.fd = -1;
+            running--;
+
+            int status = 0;
+            bool ok = false;
+            if (waitpid(c.pid, &status, 0) == c.pid && WIFEXITED(status)) {
+                int code = WEXITSTATUS(status);
+                ok = (code == CHILD_UPDATED || code == CHILD_UPDATED_REBOOT);
+                needreboot |= (code == CHILD_UPDATED_REBOOT);
+            }
+            if (ok)
+                success++;
+            std::cout << "[" << ++done << "/" << boards.size() << "] Card ["
+                << c.bdf << "] " << (ok ? "updated" : "FAILED") << std::endl;
+        }
+    }
+
+    // Only reached if poll() failed, do not leave children behind
+    for (auto& c : children) {
+        if (c.fd < 0)
+            continue;
+        close(c.fd);
+        waitpid(c.pid, nullptr, 0);
+    }
+}
+
 static DSAInfo selectShell(unsigned idx, std::string& dsa, uint64_t ts)
 {
     unsigned candidateDSAIndex = UINT_MAX;
@@ -351,12 +500,17 @@ static int autoFlash(unsigned index, std::string& shell,
             return -ECANCELED;
 
         // Perform DSA and BMC updating
-        for (auto p : boardsToUpdate) {
-            bool reboot;
+        if (boardsToUpdate.size() > 1) {
             std::cout << std::endl;
-            if (updateShellAndSC(p.first, p.second, reboot) == 0)
-                success++;
-            needreboot |= reboot;
+            updateShellAndSCParallel(boardsToUpdate, success, needreboot);
+        } else {
+            for (auto p : boardsToUpdate) {
+                bool reboot;
+                std::cout << std::endl;
+                if (updateShellAndSC(p.first, p.second, reboot) == 0)
+                    success++;
+                needreboot |= reboot;
+            }
         }
     }
 
@@ -529,6 +683,8 @@ static int update(int argc, char *argv[])
 
         switch (opt) {
         case '0':
+            if (std::string(optarg) == "all")
+                break;
             index = bdf2index(optarg);
             if (index == UINT_MAX)
                 return -ENOENT;
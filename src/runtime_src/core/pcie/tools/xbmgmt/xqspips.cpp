@@ -19,6 +19,7 @@
 #include <iostream>
 #include <cassert>
 #include <cstring>
+#include <algorithm>
 #include "xqspips.h"
 #include "core/pcie/driver/linux/include/mgmt-reg.h"
 #include "flasher.h"
@@ -849,8 +850,8 @@ bool XQSPIPS_Flasher::isFlashReady()
     xqspips_msg_t msgFlashStatus[2];
     uint8_t writeCmd = READ_STATUS_CMD;
     uint32_t StatusReg = 0;
-    const timespec req = {0, 20000};
     long long delay = 0;
+    long backoff = 5000;
 
     msgFlashStatus[0].byteCount = 1;
     msgFlashStatus[0].busWidth = XQSPIPSU_SELECT_MODE_SPI;
@@ -874,8 +875,11 @@ bool XQSPIPS_Flasher::isFlashReady()
         if (!(StatusReg & FLASH_SR_BUSY_MASK)) {
             return true;
         }
+        // Back off, erases take far longer than page programs
+        const timespec req = {0, backoff};
         nanosleep(&req, 0);
-        delay += 5000;
+        delay += backoff;
+        backoff = std::min(backoff * 2, 200000L);
     }
     std::cout << "Unable to get Flash Ready" << std::endl;
     return false;
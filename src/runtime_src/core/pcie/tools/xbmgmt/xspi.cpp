@@ -23,6 +23,8 @@
 #include <thread>
 #include <cstring>
 #include <vector>
+#include <algorithm>
+#include <map>
 #include <sys/ioctl.h>
 #include <sys/types.h>
 #include <errno.h>
@@ -50,6 +52,11 @@ uint32_t selected_sector = -1;
 //testing sizes.
 #define WRITE_DATA_SIZE 128
 #define READ_DATA_SIZE 128
+#define SUBSECTOR_SIZE 0x1000
+
+//isFlashReady poll interval in nsec
+static const long FLASH_READY_MIN_POLL = 5000;
+static const long FLASH_READY_MAX_POLL = 200000;
 
 
 #define COMMAND_PAGE_PROGRAM            0x02 /* Page Program command */
@@ -269,6 +276,7 @@ static void clearBuffers() {
 XSPI_Flasher::XSPI_Flasher(std::shared_ptr<pcidev::pci_device> dev)
 {
     mDev = dev;
+    mTxFifoDepth = 0;
 
     std::string err;
     mDev->sysfs_get("flash", "bar_off", err, flash_base);
@@ -627,8 +635,8 @@ bool XSPI_Flasher::waitTxEmpty() {
 
 bool XSPI_Flasher::isFlashReady() {
     uint32_t StatusReg;
-    const timespec req = {0, 5000};
     long long delay = 0;
+    long backoff = FLASH_READY_MIN_POLL;
     while (delay < 30000000000) {
         //StatusReg = XSpi_GetStatusReg();
         WriteBuffer[BYTE1] = COMMAND_STATUSREG_READ;
@@ -643,8 +651,12 @@ bool XSPI_Flasher::isFlashReady() {
         }
         //TODO: Try resetting. Uncomment next line?
         //XSpi_WriteReg(XSP_SRR_OFFSET, XSP_SRR_RESET_MASK);
+        //Page programs finish in well under a millisecond but erases take
+        //much longer, so back off instead of polling at a fixed rate
+        const timespec req = {0, backoff};
         nanosleep(&req, 0);
-        delay += 5000;
+        delay += backoff;
+        backoff = std::min(backoff * 2, FLASH_READY_MAX_POLL);
     }
     std::cout << "Unable to get Flash Ready\n";
     return false;
@@ -845,12 +857,94 @@ bool XSPI_Flasher::getFlashId()
 }
 
 
+// Fill the Tx FIFO with as many bytes as it takes, the transmitter is
+// inhibited meanwhile. The FIFO depth is not known up front, so the first
+// fill that starts empty and runs into Tx full checks the status register
+// after every byte and records the depth. Later fills into an empty FIFO
+// write up to that many bytes without touching the status register, which
+// saves a PCIe read per byte.
+bool XSPI_Flasher::fillTxFifo(uint8_t*& SendBufferPtr, int& RemainingBytes)
+{
+    uint32_t StatusReg = XSpi_GetStatusReg();
+    if ((StatusReg & (1<<10)) != 0) {
+        std::cout << "status reg in error situation " << std::endl;
+        return false;
+    }
+
+    if (mTxFifoDepth && (StatusReg & XSP_SR_TX_EMPTY_MASK)) {
+        int count = std::min<int>(mTxFifoDepth, RemainingBytes);
+        for (int i = 0; i < count; ++i) {
+            if (writeReg(XSP_DTR_OFFSET, *SendBufferPtr++) != 0)
+                return false;
+        }
+        RemainingBytes -= count;
+        StatusReg = XSpi_GetStatusReg();
+        if ((StatusReg & (1<<10)) != 0) {
+            std::cout << "Write command caused created error" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool empty = (StatusReg & XSP_SR_TX_EMPTY_MASK) != 0;
+    unsigned count = 0;
+    while (((StatusReg & XSP_SR_TX_FULL_MASK) == 0) && (RemainingBytes > 0)) {
+        if (writeReg(XSP_DTR_OFFSET, *SendBufferPtr) != 0)
+            return false;
+        SendBufferPtr++;
+        RemainingBytes--;
+        count++;
+        StatusReg = XSpi_GetStatusReg();
+        if ((StatusReg & (1<<10)) != 0) {
+            std::cout << "Write command caused created error" << std::endl;
+            return false;
+        }
+    }
+    if (empty && (StatusReg & XSP_SR_TX_FULL_MASK))
+        mTxFifoDepth = count;
+    return true;
+}
+
+// Read everything in the Rx FIFO. The occupancy register tells how many
+// bytes can be read before the status register has to be checked again.
+bool XSPI_Flasher::drainRxFifo(uint8_t*& RecvBufferPtr, int& ByteCount)
+{
+    uint32_t StatusReg = XSpi_GetStatusReg();
+    while ((StatusReg & XSP_SR_RX_EMPTY_MASK) == 0) {
+        unsigned count = 1;
+        if (mTxFifoDepth) {
+            try {
+                count = std::min<unsigned>(readReg(XSP_RFO_OFFSET) + 1, mTxFifoDepth);
+            } catch (const std::exception& ex) {
+                return false;
+            }
+        }
+
+        for (unsigned i = 0; i < count; ++i) {
+            uint32_t Data;
+            try {
+                Data = readReg(XSP_DRR_OFFSET);
+            } catch (const std::exception& ex) {
+                return false;
+            }
+            if (RecvBufferPtr != NULL)
+                *RecvBufferPtr++ = (uint8_t)Data;
+            ByteCount--;
+        }
+
+        StatusReg = XSpi_GetStatusReg();
+        if ((StatusReg & (1<<10)) != 0) {
+            std::cout << "status reg in error situation " << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
 bool XSPI_Flasher::finalTransfer(uint8_t *SendBufPtr, uint8_t *RecvBufPtr, int ByteCount)
 {
     uint32_t ControlReg;
     uint32_t StatusReg;
-    uint32_t Data = 0;
-    uint8_t  DataWidth = 8;
     uint32_t SlaveSelectMask = SLAVE_SELECT_MASK;
 
     uint32_t SlaveSelectReg = 0;
@@ -893,41 +987,13 @@ bool XSPI_Flasher::finalTransfer(uint8_t *SendBufPtr, uint8_t *RecvBufPtr, int B
     uint8_t* RecvBufferPtr = RecvBufPtr;
 
     int RemainingBytes = ByteCount;
-    unsigned int BytesTransferred = 0;
 
     /*
     * Fill the DTR/FIFO with as many bytes as it will take (or as many as
-    * we have to send). We use the tx full status bit to know if the device
-    * can take more data. By doing this, the driver does not need to know
-    * the size of the FIFO or that there even is a FIFO. The downside is
-    * that the status register must be read each loop iteration.
+    * we have to send).
     */
-    StatusReg = XSpi_GetStatusReg();
-    if((StatusReg & (1<<10)) != 0) {
-        std::cout << "status reg in error situation " << std::endl;
+    if (!fillTxFifo(SendBufferPtr, RemainingBytes))
         return false;
-    }
-
-    while (((StatusReg & XSP_SR_TX_FULL_MASK) == 0) && (RemainingBytes > 0)) {
-        if (DataWidth == 8) {
-            Data = *SendBufferPtr;
-        } else if (DataWidth == 16) {
-            Data = *(uint16_t *)SendBufferPtr;
-        } else if (DataWidth == 32){
-            Data = *(uint32_t *)SendBufferPtr;
-        }
-
-	if (writeReg(XSP_DTR_OFFSET, Data) != 0) {
-            return false;
-        }
-        SendBufferPtr += (DataWidth >> 3);
-        RemainingBytes -= (DataWidth >> 3);
-        StatusReg = XSpi_GetStatusReg();
-        if((StatusReg & (1<<10)) != 0) {
-            std::cout << "Write command caused created error" << std::endl;
-            return false;
-        }
-    }
 
 
     /*
@@ -1001,80 +1067,14 @@ bool XSPI_Flasher::finalTransfer(uint8_t *SendBufPtr, uint8_t *RecvBufPtr, int B
              * buffer if it points to something (the upper layer
              * software may not care to receive data).
              */
-            StatusReg = XSpi_GetStatusReg();
-
-            while ((StatusReg & XSP_SR_RX_EMPTY_MASK) == 0)
-            {
-                //read the data.
-                try {
-                    Data = readReg(XSP_DRR_OFFSET);
-		} catch (const std::exception& ex) {
-                    return false;
-                }
-
-                if (DataWidth == 8) {
-                    if(RecvBufferPtr != NULL) {
-                        *RecvBufferPtr++ = (uint8_t)Data;
-                    }
-                } else if (DataWidth == 16) {
-                    if (RecvBufferPtr != NULL){
-                        *(uint16_t *)RecvBufferPtr = (uint16_t)Data;
-                        RecvBufferPtr += 2;
-                    }
-                } else if (DataWidth == 32) {
-                    if (RecvBufferPtr != NULL){
-                        *(uint32_t *)RecvBufferPtr = Data;
-                        RecvBufferPtr += 4;
-                    }
-                }
-
-                BytesTransferred += (DataWidth >> 3);
-                ByteCount -= (DataWidth >> 3);
-                StatusReg = XSpi_GetStatusReg();
-                if((StatusReg & (1<<10)) != 0) {
-                    std::cout << "status reg in error situation " << std::endl;
-                    return false;
-                }
-            }
+            if (!drainRxFifo(RecvBufferPtr, ByteCount))
+                return false;
 
             //If there are still unwritten bytes, then finishing writing (below code)
             //and reading (above code) them.
             if (RemainingBytes > 0) {
-                /*
-                 * Fill the DTR/FIFO with as many bytes as it
-                 * will take (or as many as we have to send).
-                 * We use the Tx full status bit to know if the
-                 * device can take more data.
-                 * By doing this, the driver does not need to
-                 * know the size of the FIFO or that there even
-                 * is a FIFO.
-                 * The downside is that the status must be read
-                 * each loop iteration.
-                 */
-                StatusReg = XSpi_GetStatusReg();
-
-                while(((StatusReg & XSP_SR_TX_FULL_MASK)== 0) && (RemainingBytes > 0))
-                {
-                    if (DataWidth == 8) {
-                        Data = *SendBufferPtr;
-                    } else if (DataWidth == 16) {
-                        Data = *(uint16_t *)SendBufferPtr;
-                    } else if (DataWidth == 32) {
-                        Data = *(uint32_t *)SendBufferPtr;
-                    }
-
-		    if(writeReg(XSP_DTR_OFFSET, Data) != 0) {
-                        return false;
-                    }
-
-                    SendBufferPtr += (DataWidth >> 3);
-                    RemainingBytes -= (DataWidth >> 3);
-                    StatusReg = XSpi_GetStatusReg();
-                    if((StatusReg & (1<<10)) != 0) {
-                        std::cout << "status reg in error situation " << std::endl;
-                        return false;
-                    }
-                }
+                if (!fillTxFifo(SendBufferPtr, RemainingBytes))
+                    return false;
 
                 //Start the transfer by not inhibiting the transmitter any longer.
                 ControlReg = XSpi_GetControlReg();
@@ -1271,146 +1271,68 @@ bool XSPI_Flasher::prepareXSpi()
     return true;
 }
 
-int XSPI_Flasher::programXSpi(std::istream& mcsStream, const ELARecord& record) {
-    //TODO: decrease the sleep time.
-    const timespec req = {0, 20000};
-
-#if defined(_debug)
-    std::cout << "Programming block (" << std::hex << record.mStartAddress << ", " << record.mEndAddress << std::dec << ")" << std::endl;
-#endif
-
-    assert(mcsStream.tellg() < record.mDataPos);
-    mcsStream.seekg(record.mDataPos, std::ios_base::beg);
-    unsigned char* buffer = &WriteBuffer[READ_WRITE_EXTRA_BYTES];
-    int bufferIndex = 0;
-    int pageIndex = 0;
-    std::string prevLine("");
-    for (unsigned index = record.mDataCount; index > 0;) {
-        std::string line;
-        std::getline(mcsStream, line);
-        if(TEST_MODE)
-            std::cout << line << std::endl;
-        const unsigned dataLen = std::stoi(line.substr(1, 2), 0 , 16);
-        index -= dataLen;
-        const unsigned recordType = std::stoi(line.substr(7, 2), 0 , 16);
-        if (recordType != 0x00) {
-            continue;
-        }
-        const std::string data = line.substr(9, dataLen * 2);
-        // Write in byte swapped order
-        for (unsigned i = 0; i < data.length(); i += 2) {
-            unsigned value = std::stoi(data.substr(i, 2), 0, 16);
-            buffer[bufferIndex++] = (unsigned char)value;
-            assert(bufferIndex <= WRITE_DATA_SIZE);
-
-#if 0
-            //To enable byte swapping uncomment this.
-            //      if ((bufferIndex % 4) == 0) {
-            //        bufferIndex += 4;
-            //      }
-            //      assert(bufferIndex <= WRITE_DATA_SIZE);
-            //      unsigned value = std::stoi(data.substr(i, 2), 0, 16);
-            //      if(TEST_MODE)
-            //        std::cout << data.substr(i, 2);
-            //      buffer[--bufferIndex] = (unsigned char)value;
-            //      if ((bufferIndex % 4) == 0) {
-            //        bufferIndex += 4;
-            //      }
-#endif
-            if (bufferIndex == WRITE_DATA_SIZE) {
-                break;
-            }
-        }
-
-        if(TEST_MODE)
-            std::cout << std::endl;
-
-#if 0
-        //Uncomment if byte swapping enabled.
-
-        //account for the last line
-        //which can have say 14 bytes instead of 16
-        if((bufferIndex %4)!= 0) {
-            while ((bufferIndex %4)!= 0) {
-                unsigned char fillValue = 0xFF;
-                buffer[--bufferIndex] = fillValue;
-            }
-            bufferIndex += 4;
-        }
-
-        assert((bufferIndex % 4) == 0);
-#endif
-
-        assert(bufferIndex <= WRITE_DATA_SIZE);
-        if (bufferIndex == WRITE_DATA_SIZE) {
-#if defined(_debug)
-            std::cout << "writing page " << pageIndex << std::endl;
-#endif
-            const unsigned address = std::stoi(line.substr(3, 4), 0, 16);
-            if(TEST_MODE) {
-                std::cout << (address + dataLen) << " " << (pageIndex +1)*WRITE_DATA_SIZE << std::endl;
-                std::cout << record.mStartAddress << " " << record.mStartAddress + pageIndex*PAGE_SIZE;
-                std::cout << " " << address << std::endl;
-            } else {
-                if(!writePage(record.mStartAddress + pageIndex*WRITE_DATA_SIZE))
-                    return -ENXIO;
-                clearBuffers();
-                {
-                    //debug stuff
-#if defined(_debug)
-                    if(pageIndex == 0) {
-                        if(!readPage(record.mStartAddress + pageIndex*WRITE_DATA_SIZE))
-                            return -ENXIO;
-                        clearBuffers();
-                    }
-#endif
-                }
+// Collect the data of all records into 4KB subsectors. Bytes not covered
+// by any record are 0xFF, which is what an erased subsector holds.
+bool XSPI_Flasher::readImage(std::istream& mcsStream, FlashImage& image) {
+    for (ELARecordList::iterator i = recordList.begin(), e = recordList.end(); i != e; ++i) {
+        mcsStream.clear();
+        mcsStream.seekg(i->mDataPos, std::ios_base::beg);
+        unsigned address = i->mStartAddress;
+        for (unsigned index = i->mDataCount; index > 0;) {
+            std::string line;
+            if (!std::getline(mcsStream, line))
+                return false;
+            const unsigned dataLen = std::stoi(line.substr(1, 2), 0 , 16);
+            index -= dataLen;
+            const unsigned recordType = std::stoi(line.substr(7, 2), 0 , 16);
+            if (recordType != 0x00)
+                continue;
+            const std::string data = line.substr(9, dataLen * 2);
+            for (unsigned j = 0; j < data.length(); j += 2, ++address) {
+                std::vector<unsigned char>& subsector = image[address & ~(SUBSECTOR_SIZE - 1)];
+                if (subsector.empty())
+                    subsector.resize(SUBSECTOR_SIZE, 0xff);
+                subsector[address & (SUBSECTOR_SIZE - 1)] =
+                    (unsigned char)std::stoi(data.substr(j, 2), 0, 16);
             }
-            pageIndex++;
-            nanosleep(&req, 0);
-            bufferIndex = 0;
         }
-        prevLine = line;
-
     }
-    if (bufferIndex) {
-        //Write the last page
-        if(TEST_MODE) {
-            std::cout << "writing final page " << pageIndex << std::endl;
-            std::cout << bufferIndex << std::endl;
-            std::cout << prevLine << std::endl;
-        }
-
-        const unsigned address = std::stoi(prevLine.substr(3, 4), 0, 16);
-        const unsigned dataLen = std::stoi(prevLine.substr(1, 2), 0 , 16);
+    return true;
+}
 
-        if(TEST_MODE)
-            std::cout << address % WRITE_DATA_SIZE << " " << dataLen << std::endl;
+// Read a subsector back and compare it with the data to be flashed
+bool XSPI_Flasher::subsectorMatches(unsigned addr, const std::vector<unsigned char>& data) {
+    const unsigned dataOffset = READ_WRITE_EXTRA_BYTES + QUAD_READ_DUMMY_BYTES;
+    for (unsigned offset = 0; offset < SUBSECTOR_SIZE; offset += READ_DATA_SIZE) {
+        clearBuffers();
+        if (!readPage(addr + offset))
+            return false;
+        if (std::memcmp(&ReadBuffer[dataOffset], &data[offset], READ_DATA_SIZE) != 0)
+            return false;
+    }
+    return true;
+}
 
-        //assert( (address % WRITE_DATA_SIZE + dataLen) == bufferIndex);
+bool XSPI_Flasher::programSubsector(unsigned addr, const std::vector<unsigned char>& data) {
+    const timespec req = {0, 20000};
 
-        if(!TEST_MODE) {
+    if (!sectorErase(addr, COMMAND_4KB_SUBSECTOR_ERASE))
+        return false;
+    nanosleep(&req, 0);
 
-            //Fill unused half page to FF
-            for(unsigned i = bufferIndex; i < WRITE_DATA_SIZE; ++i) {
-                buffer[i] = 0xff;
-            }
+    for (unsigned offset = 0; offset < SUBSECTOR_SIZE; offset += WRITE_DATA_SIZE) {
+        // Erased pages are already all 0xFF
+        const unsigned char* page = &data[offset];
+        if (std::all_of(page, page + WRITE_DATA_SIZE, [](unsigned char c) { return c == 0xff; }))
+            continue;
 
-            if(!writePage(record.mStartAddress + pageIndex*WRITE_DATA_SIZE))
-                return -ENXIO;
-            nanosleep(&req, 0);
-            clearBuffers();
-            {
-                //debug stuff
-#if defined(_debug)
-                if(!readPage(record.mStartAddress + pageIndex*WRITE_DATA_SIZE))
-                    return -ENXIO;
-                clearBuffers();
-#endif
-            }
-        }
+        clearBuffers();
+        std::memcpy(&WriteBuffer[READ_WRITE_EXTRA_BYTES], page, WRITE_DATA_SIZE);
+        if (!writePage(addr + offset))
+            return false;
+        nanosleep(&req, 0);
     }
-    return 0;
+    return true;
 }
 
 int XSPI_Flasher::programXSpi(std::istream& mcsStream)
@@ -1447,62 +1369,47 @@ int XSPI_Flasher::programXSpi(std::istream& mcsStream)
         std::cout << "Enabled bitstream guard. Bitstream will not be loaded until flashing is finished." << std::endl;
     }
 
-    //Now we can safely erase all subsectors
-    int beatCount = 0;
-    std::cout << "Erasing flash" << std::flush;
+    //Shift all write addresses below bitstream guard
     for (ELARecordList::iterator i = recordList.begin(), e = recordList.end(); i != e; ++i) {
-        beatCount++;
-        if(beatCount%20==0) {
-            std::cout << "." << std::flush;
-        }
-
-        //Shift all write addresses below bitstream guard
         i->mStartAddress += bitstream_shift_addr;
         i->mEndAddress += bitstream_shift_addr;
+    }
 
-        //Erase any subsectors in address range.
-        for(uint32_t j = i->mStartAddress; j < i->mEndAddress; j+=0x1000) {
-            //std::cout << "DEBUG: Erasing subsector @ 0x" << std::hex << j << std::dec << std::endl;
-            if(!sectorErase(j, COMMAND_4KB_SUBSECTOR_ERASE)) {
-                std::cout << "\nERROR: Failed to erase subsector!" << std::endl;
-                return -EINVAL;
-            }
-            nanosleep(&req, 0); //Pause before next sector erase
-        }
+    FlashImage image;
+    if (!readImage(mcsStream, image)) {
+        std::cout << "ERROR: Unable to read the MCS file" << std::endl;
+        return -EINVAL;
     }
-    //New line after ...
-    std::cout << std::endl;
 
-    //Next we program flash. Note that bitstream guard is still active
-    beatCount = 0;
+    //Erase and program only the subsectors whose contents differ. Note
+    //that bitstream guard is still active.
+    int beatCount = 0;
+    unsigned changed = 0;
     std::cout << "Programming flash" << std::flush;
-    for (ELARecordList::iterator i = recordList.begin(), e = recordList.end(); i != e; ++i)
-    {
+    for (FlashImage::iterator i = image.begin(), e = image.end(); i != e; ++i) {
         beatCount++;
         if(beatCount%20==0) {
             std::cout << "." << std::flush;
         }
 
-        if(TEST_MODE) {
-            std::cout << "INFO: Start address 0x" << std::hex << recordList.front().mStartAddress << std::dec << "\n";
-            std::cout << "INFO: End address 0x" << std::hex << recordList.back().mEndAddress << std::dec << "\n";
-        }
-
         bool ready = isFlashReady();
         if(!ready){
             std::cout << "\nERROR: Unable to get flash ready" << std::endl;
             return -EINVAL;
         }
 
-        clearBuffers();
+        if (subsectorMatches(i->first, i->second))
+            continue;
 
-        if (programXSpi(mcsStream, *i)) {
-            std::cout << "\nERROR: Could not programXSpi the block" << std::endl;
+        changed++;
+        if (!programSubsector(i->first, i->second)) {
+            std::cout << "\nERROR: Failed to program subsector @ 0x" << std::hex << i->first << std::dec << std::endl;
             return -EINVAL;
         }
-        nanosleep(&req, 0);
     }
+    clearBuffers();
     std::cout << std::endl;
+    std::cout << "INFO: " << changed << " of " << image.size() << " subsectors updated" << std::endl;
 
     //Finally we clear bitstream guard if not writing to address 0
     //This will allow the bitstream to be loaded
@@ -21,6 +21,8 @@
 
 #include <sys/stat.h>
 #include <list>
+#include <map>
+#include <vector>
 #include <iostream>
 #include "core/pcie/linux/scan.h"
 
@@ -38,6 +40,9 @@ class XSPI_Flasher
     typedef std::list<ELARecord> ELARecordList;
     ELARecordList recordList;
 
+    // Subsector start address to subsector contents
+    typedef std::map<unsigned, std::vector<unsigned char>> FlashImage;
+
 public:
     XSPI_Flasher(std::shared_ptr<pcidev::pci_device> dev);
     int xclUpgradeFirmware2(std::istream& mcsStream1, std::istream& mcsStream2);
@@ -48,6 +53,7 @@ private:
     std::shared_ptr<pcidev::pci_device> mDev;
 
     unsigned long long flash_base;
+    unsigned mTxFifoDepth;
     int xclTestXSpi(int device_index);
     unsigned readReg(unsigned offset);
     int writeReg(unsigned regOffset, unsigned value);
@@ -59,11 +65,15 @@ private:
     bool bulkErase();
     bool writeEnable();
     bool getFlashId();
+    bool fillTxFifo(uint8_t*& sendBufPtr, int& remainingBytes);
+    bool drainRxFifo(uint8_t*& recvBufPtr, int& byteCount);
     bool finalTransfer(uint8_t *sendBufPtr, uint8_t *recvBufPtr, int byteCount);
     bool writePage(unsigned addr, uint8_t writeCmd = 0xff);
     bool readPage(unsigned addr, uint8_t readCmd = 0xff);
     bool prepareXSpi();
-    int programXSpi(std::istream& mcsStream, const ELARecord& record);
+    bool readImage(std::istream& mcsStream, FlashImage& image);
+    bool subsectorMatches(unsigned addr, const std::vector<unsigned char>& data);
+    bool programSubsector(unsigned addr, const std::vector<unsigned char>& data);
     int programXSpi(std::istream& mcsStream);
     bool readRegister(unsigned commandCode, unsigned bytes);
     bool writeRegister(unsigned commandCode, unsigned value, unsigned bytes);
@@ -24,6 +24,11 @@
 #include <algorithm>
 #include <getopt.h>
 #include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/mempolicy.h>
+#include <cstdio>
+#include <fstream>
 
 #include "xbutil.h"
 #include "base.h"
@@ -125,6 +130,7 @@ int main(int argc, char *argv[])
     std::string mcsFile1, mcsFile2;
     std::string xclbin;
     size_t blockSize = 0;
+    xcldev::StreamRunner::mode streamMode = xcldev::StreamRunner::LOOPBACK;
     int c;
     dd::ddArgs_t ddArgs;
 
@@ -204,11 +210,12 @@ int main(int argc, char *argv[])
         {"monitorfifofull", no_argument, 0, xcldev::STATUS_UNSUPPORTED},
         {"accelmonitor", no_argument, 0, xcldev::STATUS_UNSUPPORTED},
         {"stream", no_argument, 0, xcldev::STREAM},
+        {"sweep", no_argument, 0, xcldev::DMATEST_SWEEP},
         {0, 0, 0, 0}
     };
 
     int long_index;
-    const char* short_options = "a:b:c:d:e:f:g:h:i:o:p:r:s"; //don't add numbers
+    const char* short_options = "a:b:c:d:e:f:g:h:i:m:o:p:r:s"; //don't add numbers
     while ((c = getopt_long(argc, argv, short_options, long_options, &long_index)) != -1)
     {
         if (cmd == xcldev::LIST) {
@@ -285,6 +292,15 @@ int main(int argc, char *argv[])
             subcmd = xcldev::STREAM;
             break;
         }
+        case xcldev::DMATEST_SWEEP:
+        {
+            if(cmd != xcldev::DMATEST) {
+                std::cout << "ERROR: Option '" << long_options[long_index].name << "' cannot be used with command " << cmdname << "\n";
+                return -1;
+            }
+            subcmd = xcldev::DMATEST_SWEEP;
+            break;
+        }
         //short options are dealt here
         case 'a':{
             if (cmd != xcldev::MEM) {
@@ -364,7 +380,8 @@ int main(int argc, char *argv[])
             break;
         }
         case 'r':
-            if ((cmd == xcldev::BOOT) || (cmd == xcldev::DMATEST) ||(cmd == xcldev::STATUS)) {
+            if ((cmd == xcldev::BOOT) || (cmd == xcldev::DMATEST) ||(cmd == xcldev::STATUS) ||
+                (cmd == xcldev::STREAMTEST)) {
                 std::cout << "ERROR: '-r' not applicable for this command\n";
                 return -1;
             }
@@ -416,6 +433,25 @@ int main(int argc, char *argv[])
             }
             fanSpeed = std::atoi(optarg);
             break;
+        case 'm':
+        {
+            if (cmd != xcldev::STREAMTEST) {
+                std::cout << "ERROR: '-m' only allowed with 'streamtest' command\n";
+                return -1;
+            }
+            std::string tmp(optarg);
+            if (tmp == "h2c")
+                streamMode = xcldev::StreamRunner::H2C;
+            else if (tmp == "c2h")
+                streamMode = xcldev::StreamRunner::C2H;
+            else if (tmp == "loopback")
+                streamMode = xcldev::StreamRunner::LOOPBACK;
+            else {
+                std::cout << "ERROR: stream test mode should be h2c, c2h or loopback\n";
+                return -1;
+            }
+            break;
+        }
         case 'b':
         {
             if (cmd != xcldev::DMATEST) {
@@ -467,6 +503,7 @@ int main(int argc, char *argv[])
     case xcldev::SCAN:
     case xcldev::STATUS:
     case xcldev::M2MTEST:
+    case xcldev::STREAMTEST:
         break;
     case xcldev::PROGRAM:
     {
@@ -571,7 +608,10 @@ int main(int argc, char *argv[])
         result = deviceVec[index]->run(regionIndex, computeIndex);
         break;
     case xcldev::DMATEST:
-        result = deviceVec[index]->dmatest(blockSize, true);
+        if (subcmd == xcldev::DMATEST_SWEEP)
+            result = deviceVec[index]->dmatestSweep();
+        else
+            result = deviceVec[index]->dmatest(blockSize, true);
         break;
     case xcldev::MEM:
         if (subcmd == xcldev::MEM_READ) {
@@ -608,6 +648,9 @@ int main(int argc, char *argv[])
     case xcldev::M2MTEST:
         result = deviceVec[index]->testM2m();
         break;
+    case xcldev::STREAMTEST:
+        result = deviceVec[index]->streamtest(streamMode);
+        break;
     default:
         std::cout << "ERROR: Not implemented\n";
         result = -1;
@@ -628,6 +671,7 @@ void xcldev::printHelp(const std::string& exe)
     std::cout << "Command and option summary:\n";
     std::cout << "  clock   [-d card] [-r region] [-f clock1_freq_MHz] [-g clock2_freq_MHz] [-h clock3_freq_MHz]\n";
     std::cout << "  dmatest [-d card] [-b [0x]block_size_KB]\n";
+    std::cout << "  dmatest [-d card] --sweep\n";
     std::cout << "  dump\n";
     std::cout << "  help\n";
     std::cout << "  m2mtest\n";
@@ -636,8 +680,9 @@ void xcldev::printHelp(const std::string& exe)
     std::cout << "  program [-d card] [-r region] -p xclbin\n";
     std::cout << "  query   [-d card [-r region]]\n";
     std::cout << "  status [-d card] [--debug_ip_name]\n";
+    std::cout << "  streamtest [-d card] [-m h2c|c2h|loopback]\n";
     std::cout << "  scan\n";
-    std::cout << "  top [-i seconds]\n";
+    std::cout << "  top [-d card|all] [-i seconds]\n";
     std::cout << "  validate [-d card]\n";
     std::cout << " Requires root privileges:\n";
     std::cout << "  reset  [-d card]\n";
@@ -659,6 +704,8 @@ void xcldev::printHelp(const std::string& exe)
     std::cout << "  " << exe << " program -d 2 -p a.xclbin\n";
     std::cout << "Run DMA test on card 1 with 32 KB blocks of buffer\n";
     std::cout << "  " << exe << " dmatest -d 1 -b 0x2000\n";
+    std::cout << "Run stream test (64 B to 4 MB packets, queue depth 1 to 256) on card 0 with a loopback xclbin\n";
+    std::cout << "  " << exe << " streamtest -m loopback\n";
     std::cout << "Read 256 bytes from DDR starting at 0x1000 into file read.out\n";
     std::cout << "  " << exe << " mem --read -a 0x1000 -i 256 -o read.out\n";
     std::cout << "  " << "Default values for address is 0x0, size is DDR size and file is memread.out\n";
@@ -693,11 +740,17 @@ std::unique_ptr<xcldev::device> xcldev::xclGetDevice(unsigned index)
 
 struct topThreadCtrl {
     int interval;
-    std::unique_ptr<xcldev::device> dev;
+    std::vector<std::unique_ptr<xcldev::device>> devs;
     bool quit;
     int status;
 };
 
+struct topSample {
+    std::chrono::steady_clock::time_point time;
+    xclDeviceUsage usage;
+    std::vector<std::pair<std::string, uint64_t>> cus;
+};
+
 static void topPrintUsage(const xcldev::device *dev, xclDeviceUsage& devstat,
     xclDeviceInfo2 &devinfo)
 {
@@ -718,6 +771,38 @@ static void topPrintUsage(const xcldev::device *dev, xclDeviceUsage& devstat,
     }
 }
 
+static void topPrintRates(const xcldev::device *dev, const topSample& prev,
+    const topSample& cur)
+{
+    std::vector<std::string> lines;
+    double seconds = std::chrono::duration<double>(cur.time - prev.time).count();
+
+    dev->m_rate_stringize_dynamics(prev.usage, cur.usage, prev.cus, cur.cus,
+        seconds, lines);
+
+    for(auto line:lines) {
+        printw("%s\n", line.c_str());
+    }
+}
+
+// Compact per card summary used when watching all cards
+static void topPrintCard(unsigned index, xcldev::device *dev,
+    xclDeviceInfo2 &devinfo, const topSample& prev, topSample& cur)
+{
+    std::vector<std::string> lines;
+    char bdf[32];
+
+    snprintf(bdf, sizeof(bdf), "%04x:%02x:%02x.%x",
+        dev->domain(), dev->bus(), dev->dev(), dev->userFunc());
+    printw("Card [%u] %s %s\n", index, bdf, devinfo.mName);
+
+    dev->m_mem_usage_stringize_dynamics(cur.usage, devinfo, lines);
+    for(auto line:lines) {
+        printw("%s\n", line.c_str());
+    }
+    topPrintRates(dev, prev, cur);
+}
+
 static void topPrintStreamUsage(const xcldev::device *dev, xclDeviceInfo2 &devinfo)
 {
     std::vector<std::string> lines;
@@ -733,24 +818,44 @@ static void topPrintStreamUsage(const xcldev::device *dev, xclDeviceInfo2 &devin
 static void topThreadFunc(struct topThreadCtrl *ctrl)
 {
     int i = 0;
+    // The first refresh has no previous sample and shows zero rates
+    std::vector<topSample> prev(ctrl->devs.size());
+    bool first = true;
 
     while (!ctrl->quit) {
         if ((i % ctrl->interval) == 0) {
-            xclDeviceUsage devstat;
-            xclDeviceInfo2 devinfo;
-            int result = ctrl->dev->usageInfo(devstat);
-            if (result) {
-                ctrl->status = result;
-                return;
+            std::vector<topSample> cur(ctrl->devs.size());
+            std::vector<xclDeviceInfo2> devinfo(ctrl->devs.size());
+            for (unsigned d = 0; d < ctrl->devs.size(); d++) {
+                int result = ctrl->devs[d]->usageInfo(cur[d].usage);
+                if (result) {
+                    ctrl->status = result;
+                    return;
+                }
+                result = ctrl->devs[d]->deviceInfo(devinfo[d]);
+                if (result) {
+                    ctrl->status = result;
+                    return;
+                }
+                // No xclbin loaded means no CUs, not an error
+                ctrl->devs[d]->cuUsage(cur[d].cus);
+                cur[d].time = std::chrono::steady_clock::now();
             }
-            result = ctrl->dev->deviceInfo(devinfo);
-            if (result) {
-                ctrl->status = result;
-                return;
+            if (first) {
+                prev = cur;
+                first = false;
             }
+
             clear();
-            topPrintUsage(ctrl->dev.get(), devstat, devinfo);
+            if (ctrl->devs.size() == 1) {
+                topPrintUsage(ctrl->devs[0].get(), cur[0].usage, devinfo[0]);
+                topPrintRates(ctrl->devs[0].get(), prev[0], cur[0]);
+            } else {
+                for (unsigned d = 0; d < ctrl->devs.size(); d++)
+                    topPrintCard(d, ctrl->devs[d].get(), devinfo[d], prev[d], cur[d]);
+            }
             refresh();
+            prev.swap(cur);
         }
         std::this_thread::sleep_for(std::chrono::seconds(1));
         i++;
@@ -765,18 +870,18 @@ static void topThreadStreamFunc(struct topThreadCtrl *ctrl)
         if ((i % ctrl->interval) == 0) {
             xclDeviceUsage devstat;
             xclDeviceInfo2 devinfo;
-            int result = ctrl->dev->usageInfo(devstat);
+            int result = ctrl->devs[0]->usageInfo(devstat);
             if (result) {
                 ctrl->status = result;
                 return;
             }
-            result = ctrl->dev->deviceInfo(devinfo);
+            result = ctrl->devs[0]->deviceInfo(devinfo);
             if (result) {
                 ctrl->status = result;
                 return;
             }
             clear();
-            topPrintStreamUsage(ctrl->dev.get(), devinfo);
+            topPrintStreamUsage(ctrl->devs[0].get(), devinfo);
             refresh();
         }
         std::this_thread::sleep_for(std::chrono::seconds(1));
@@ -786,8 +891,8 @@ static void topThreadStreamFunc(struct topThreadCtrl *ctrl)
 
 void xclTopHelp()
 {
-    std::cout << "Options: [-d <card>]: device index\n";
-    std::cout << "         [-i <interval>]: refresh interval\n";
+    std::cout << "Options: [-d <card>|all]: device index, or all cards\n";
+    std::cout << "         [-i <interval>]: refresh interval in seconds\n";
     std::cout << "         [-s]: display stream topology \n";
 }
 
@@ -797,6 +902,7 @@ int xcldev::xclTop(int argc, char *argv[])
     unsigned index = 0;
     int c;
     bool printStreamOnly = false;
+    bool allCards = false;
     struct topThreadCtrl ctrl = { 0 };
 
     while ((c = getopt(argc, argv, "d:i:s")) != -1) {
@@ -805,6 +911,10 @@ int xcldev::xclTop(int argc, char *argv[])
             interval = std::atoi(optarg);
             break;
         case 'd': {
+            if (std::strcmp(optarg, "all") == 0) {
+                allCards = true;
+                break;
+            }
             int ret = str2index(optarg, index);
             if (ret != 0)
                 return ret;
@@ -819,15 +929,24 @@ int xcldev::xclTop(int argc, char *argv[])
         }
     }
 
-    if (optind != argc) {
+    if (optind != argc || interval <= 0 || (allCards && printStreamOnly)) {
         xclTopHelp();
         return -EINVAL;
     }
 
     ctrl.interval = interval;
 
-    ctrl.dev = xcldev::xclGetDevice(index);
-    if (!ctrl.dev) {
+    unsigned first = allCards ? 0 : index;
+    unsigned last = allCards ? pcidev::get_dev_total() : index + 1;
+    for (unsigned i = first; i < last; i++) {
+        auto dev = xcldev::xclGetDevice(i);
+        if (!dev) {
+            return -ENOENT;
+        }
+        ctrl.devs.push_back(std::move(dev));
+    }
+    if (ctrl.devs.empty()) {
+        std::cout << "ERROR: No card found" << std::endl;
         return -ENOENT;
     }
 
@@ -1653,3 +1772,162 @@ int xcldev::device::testM2m()
     }
     return ret;
 }
+
+/*
+ * Bind allocations of the calling thread to 'node', or restore the
+ * default policy when 'node' is negative. xocl allocates the host pages
+ * of a BO when it is created, so BOs created under the policy live on
+ * that node.
+ */
+static int setMemPolicy(int node)
+{
+    unsigned long mask = 0;
+
+    if (node < 0)
+        return syscall(SYS_set_mempolicy, MPOL_DEFAULT, nullptr, 0);
+    if (node >= static_cast<int>(sizeof(mask) * 8))
+        return -EINVAL;
+    mask = 1UL << node;
+    return syscall(SYS_set_mempolicy, MPOL_BIND, &mask, sizeof(mask) * 8);
+}
+
+// Online NUMA nodes, parsed from a list such as "0-1,3"
+static std::vector<int> onlineNumaNodes()
+{
+    std::vector<int> nodes;
+    std::ifstream ifs("/sys/devices/system/node/online");
+    std::string range;
+
+    while (std::getline(ifs, range, ',')) {
+        int first = 0, last = 0;
+        int n = std::sscanf(range.c_str(), "%d-%d", &first, &last);
+        if (n < 1)
+            continue;
+        if (n == 1)
+            last = first;
+        for (int node = first; node <= last; node++)
+            nodes.push_back(node);
+    }
+    return nodes;
+}
+
+/*
+ * dmatestSweep
+ *
+ * Measure DMA bandwidth and per sync latency on the first used bank for
+ * block sizes 4KB..1GB, 1..mDMAThreads workers and H2C, C2H and both
+ * directions at once. The sweep runs once with host buffers on the
+ * card's NUMA node and once on a remote node when there is one.
+ */
+int xcldev::device::dmatestSweep()
+{
+    std::string errmsg;
+    std::vector<char> buf;
+    auto dev = pcidev::get_dev(m_idx);
+
+    dev->sysfs_get("icap", "mem_topology", errmsg, buf);
+    if (!errmsg.empty()) {
+        std::cout << errmsg << std::endl;
+        return -EINVAL;
+    }
+    const mem_topology *map = (mem_topology *)buf.data();
+    if (buf.empty() || map->m_count == 0) {
+        std::cout << "WARNING: 'mem_topology' invalid, "
+            << "unable to perform DMA Test. Has the bitstream been loaded? "
+            << "See 'xbutil program'." << std::endl;
+        return -EINVAL;
+    }
+
+    int bank = -1;
+    for (int32_t i = 0; i < map->m_count; i++) {
+        if (map->m_mem_data[i].m_type != MEM_STREAMING && map->m_mem_data[i].m_used) {
+            bank = i;
+            break;
+        }
+    }
+    if (bank < 0) {
+        std::cout << "ERROR: no memory bank in use" << std::endl;
+        return -EINVAL;
+    }
+
+    std::string numa;
+    int localNode = -1;
+    dev->sysfs_get("", "numa_node", errmsg, numa);
+    if (errmsg.empty() && !numa.empty())
+        localNode = std::atoi(numa.c_str());
+
+    // Passes: (label, node), node -1 leaves placement to the kernel
+    std::vector<std::pair<std::string, int>> passes;
+    if (localNode < 0) {
+        passes.emplace_back("default", -1);
+    } else {
+        passes.emplace_back("local", localNode);
+        for (auto node : onlineNumaNodes()) {
+            if (node != localNode) {
+                passes.emplace_back("remote", node);
+                break;
+            }
+        }
+    }
+
+    unsigned maxThreads = m_devinfo.mDMAThreads ? m_devinfo.mDMAThreads : 2;
+    const size_t minSize = 4 * 1024;
+    const size_t maxSize = 1024 * 1024 * 1024;
+    // Enough data per point to be steady without a 4KB pass taking minutes
+    const unsigned long long passBytes = 256 * 1024 * 1024;
+    const long long maxBOs = 0x4000;
+
+    std::cout << "DMA sweep on " << map->m_mem_data[bank].m_tag
+              << ", up to " << maxThreads << " threads per direction\n";
+
+    int result = 0;
+    for (auto& pass : passes) {
+        std::cout << "\nHost buffers on NUMA node ";
+        if (pass.second < 0)
+            std::cout << "(unknown)\n";
+        else
+            std::cout << pass.second << " (" << pass.first << ")\n";
+
+        std::cout << std::left << std::setw(10) << "Size" << std::setw(5) << "Thr"
+                  << std::setw(12) << "H2C MB/s" << std::setw(10) << "H2C us"
+                  << std::setw(12) << "C2H MB/s" << std::setw(10) << "C2H us"
+                  << std::setw(12) << "Both MB/s" << "Both us\n";
+
+        for (size_t size = minSize; size <= maxSize; size *= 4) {
+            if (setMemPolicy(pass.second) != 0) {
+                int err = errno;
+                std::cout << "ERROR: cannot bind buffers to NUMA node "
+                          << pass.second << ": " << strerror(err) << std::endl;
+                return -err;
+            }
+            DMARunner runner(m_handle, size, bank, std::max<unsigned long long>(passBytes, size), maxBOs);
+            setMemPolicy(-1);
+            if (runner.count() == 0) {
+                std::cout << "ERROR: cannot allocate " << unitConvert(size) << " buffers" << std::endl;
+                return -ENOMEM;
+            }
+
+            for (unsigned threads = 1; threads <= maxThreads; threads++) {
+                DMARunner::Measurement h2c = {0, 0}, c2h = {0, 0}, both = {0, 0};
+                result += runner.measure(XCL_BO_SYNC_BO_TO_DEVICE, threads, h2c);
+                result += runner.measure(XCL_BO_SYNC_BO_FROM_DEVICE, threads, c2h);
+                // A single BO cannot be split across directions
+                if (runner.count() > 1)
+                    result += runner.measureDuplex(threads, both);
+                if (result)
+                    return result;
+
+                std::cout << std::left << std::setw(10) << unitConvert(size)
+                          << std::setw(5) << threads << std::fixed << std::setprecision(1)
+                          << std::setw(12) << h2c.mbps << std::setw(10) << h2c.latency
+                          << std::setw(12) << c2h.mbps << std::setw(10) << c2h.latency;
+                if (runner.count() > 1)
+                    std::cout << std::setw(12) << both.mbps << both.latency << "\n";
+                else
+                    std::cout << std::setw(12) << "-" << "-\n";
+                std::cout.unsetf(std::ios::floatfield);
+            }
+        }
+    }
+    return result;
+}
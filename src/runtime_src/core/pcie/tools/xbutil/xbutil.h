@@ -25,16 +25,20 @@
 #include <iomanip>
 #include <sstream>
 #include <string>
+#include <algorithm>
+#include <cstdlib>
 
 #include "xclhal2.h"
 #include "xclperf.h"
 #include "xcl_axi_checker_codes.h"
 #include "core/pcie/common/dmatest.h"
+#include "core/pcie/common/streamtest.h"
 #include "core/pcie/common/memaccess.h"
 #include "core/pcie/common/dd.h"
 #include "core/pcie/common/utils.h"
 #include "core/pcie/common/sensor.h"
 #include "core/pcie/linux/scan.h"
+#include "core/pcie/driver/linux/include/mailbox_proto.h"
 #include "xclbin.h"
 #include <version.h>
 
@@ -76,7 +80,8 @@ enum command {
     DD,
     STATUS,
     CMD_MAX,
-    M2MTEST
+    M2MTEST,
+    STREAMTEST
 };
 enum subcommand {
     MEM_READ = 0,
@@ -87,6 +92,7 @@ enum subcommand {
     STATUS_SPC,
     STREAM,
     STATUS_UNSUPPORTED,
+    DMATEST_SWEEP,
 };
 enum statusmask {
     STATUS_NONE_MASK = 0x0,
@@ -116,7 +122,8 @@ static const std::pair<std::string, command> map_pairs[] = {
     std::make_pair("mem", MEM),
     std::make_pair("dd", DD),
     std::make_pair("status", STATUS),
-    std::make_pair("m2mtest", M2MTEST)
+    std::make_pair("m2mtest", M2MTEST),
+    std::make_pair("streamtest", STREAMTEST)
 
 };
 
@@ -610,6 +617,88 @@ public:
         lines.push_back(ss.str());
     }
 
+    /*
+     * Completed command count of each CU, parsed from kds_custat. Every
+     * read of kds_custat round trips an ERT_CU_STAT command, so callers
+     * should sample it once per refresh.
+     */
+    int cuUsage(std::vector<std::pair<std::string, uint64_t>>& cus) const
+    {
+        std::string errmsg;
+        std::vector<std::string> buf;
+
+        cus.clear();
+        pcidev::get_dev(m_idx)->sysfs_get("mb_scheduler",
+            "kds_custat", errmsg, buf);
+        if (!errmsg.empty())
+            return -EINVAL;
+
+        for (auto& line : buf) {
+            // CU[@0x1800000] : 1234
+            auto pos = line.find(" : ");
+            if (pos == std::string::npos)
+                continue;
+            cus.emplace_back(line.substr(0, pos),
+                std::strtoull(line.c_str() + pos + 3, nullptr, 10));
+        }
+        return 0;
+    }
+
+    /*
+     * Rates between two samples taken 'seconds' apart. Counters that go
+     * backwards (xclbin reloaded, driver reloaded) count as idle.
+     */
+    void m_rate_stringize_dynamics(const xclDeviceUsage& prev,
+        const xclDeviceUsage& cur,
+        const std::vector<std::pair<std::string, uint64_t>>& prevCus,
+        const std::vector<std::pair<std::string, uint64_t>>& curCus,
+        double seconds, std::vector<std::string>& lines) const
+    {
+        std::stringstream ss;
+        auto delta = [](uint64_t before, uint64_t after) {
+            return after > before ? after - before : 0;
+        };
+
+        if (seconds <= 0)
+            seconds = 1;
+
+        unsigned channels = std::min<unsigned>(cur.dma_channel_cnt, 8);
+        if (channels == 0)
+            channels = 2;
+        ss << "DMA Throughput:" << "\n";
+        for (unsigned i = 0; i < channels; i++) {
+            ss << "  Chan[" << i << "].h2c:  " << std::left << std::setw(12)
+                << unitConvert(static_cast<size_t>(delta(prev.h2c[i], cur.h2c[i]) / seconds)) + "/s"
+                << "  Chan[" << i << "].c2h:  "
+                << unitConvert(static_cast<size_t>(delta(prev.c2h[i], cur.c2h[i]) / seconds)) + "/s"
+                << "\n";
+        }
+
+        std::vector<uint64_t> done(curCus.size(), 0);
+        uint64_t total = 0;
+        for (size_t i = 0; i < curCus.size(); i++) {
+            if (i < prevCus.size() && prevCus[i].first == curCus[i].first)
+                done[i] = delta(prevCus[i].second, curCus[i].second);
+            total += done[i];
+        }
+
+        ss << "\nCompute Unit Command Rate: " << std::fixed
+            << std::setprecision(1) << total / seconds << " cmds/s\n";
+        if (!curCus.empty()) {
+            ss << std::left << "  " << std::setw(20) << "CU" << std::setw(16)
+                << "Completed" << std::setw(16) << "cmds/s" << "Share" << "\n";
+        }
+        for (size_t i = 0; i < curCus.size(); i++) {
+            ss << "  " << std::setw(20) << curCus[i].first
+                << std::setw(16) << curCus[i].second
+                << std::setw(16) << done[i] / seconds
+                << (total ? 100.0 * done[i] / total : 0.0) << "%\n";
+        }
+
+        ss << std::setw(80) << std::setfill('#') << std::left << "\n";
+        lines.push_back(ss.str());
+    }
+
     int readSensors( void ) const
     {
         // info
@@ -646,13 +735,33 @@ public:
         sensor_tree::put( "board.physical.thermal.fpga_temp",                    m_devinfo.mOnChipTemp );
         sensor_tree::put( "board.physical.thermal.tcrit_temp",                   m_devinfo.mFanTemp );
         sensor_tree::put( "board.physical.thermal.fan_speed",                    m_devinfo.mFanRpm );
+        // Sensors not carried by xclDeviceInfo2, from the XMC snapshot when
+        // the driver has one.
+        xcl_sensor snapshot = {};
+        bool has_snapshot = false;
+        {
+            std::vector<char> buf;
+            std::string errmsg;
+            pcidev::get_dev(m_idx)->sysfs_get("xmc", "sensor_snapshot", errmsg, buf);
+            if (errmsg.empty() && buf.size() >= sizeof(snapshot)) {
+                std::memcpy(&snapshot, buf.data(), sizeof(snapshot));
+                has_snapshot = true;
+            }
+        }
         {
             unsigned short temp0 = 0, temp1 = 0, temp2 = 0, temp3 = 0;
             std::string errmsg;
-            pcidev::get_dev(m_idx)->sysfs_get("xmc", "xmc_cage_temp0", errmsg, temp0);
-            pcidev::get_dev(m_idx)->sysfs_get("xmc", "xmc_cage_temp1", errmsg, temp1);
-            pcidev::get_dev(m_idx)->sysfs_get("xmc", "xmc_cage_temp2", errmsg, temp2);
-            pcidev::get_dev(m_idx)->sysfs_get("xmc", "xmc_cage_temp3", errmsg, temp3);
+            if (has_snapshot) {
+                temp0 = snapshot.cage_temp0;
+                temp1 = snapshot.cage_temp1;
+                temp2 = snapshot.cage_temp2;
+                temp3 = snapshot.cage_temp3;
+            } else {
+                pcidev::get_dev(m_idx)->sysfs_get("xmc", "xmc_cage_temp0", errmsg, temp0);
+                pcidev::get_dev(m_idx)->sysfs_get("xmc", "xmc_cage_temp1", errmsg, temp1);
+                pcidev::get_dev(m_idx)->sysfs_get("xmc", "xmc_cage_temp2", errmsg, temp2);
+                pcidev::get_dev(m_idx)->sysfs_get("xmc", "xmc_cage_temp3", errmsg, temp3);
+            }
             sensor_tree::put( "board.physical.thermal.cage.temp0", temp0);
             sensor_tree::put( "board.physical.thermal.cage.temp1", temp1);
             sensor_tree::put( "board.physical.thermal.cage.temp2", temp2);
@@ -678,7 +787,10 @@ public:
         {
             unsigned short cur = 0;
             std::string errmsg;
-            pcidev::get_dev(m_idx)->sysfs_get("xmc", "xmc_vccint_curr", errmsg, cur);
+            if (has_snapshot)
+                cur = snapshot.vccint_curr;
+            else
+                pcidev::get_dev(m_idx)->sysfs_get("xmc", "xmc_vccint_curr", errmsg, cur);
             sensor_tree::put( "board.physical.electrical.vccint.current",            cur);
         }
 
@@ -739,6 +851,22 @@ public:
         if(errmsg.empty()) {
             sensor_tree::put( "board.info.p2p_enabled", p2p_enabled );
         }
+
+        // p2p copy bo: one line per direction, count bytes usecs
+        std::vector<std::string> p2p_copy;
+        pcidev::get_dev(m_idx)->sysfs_get("", "p2p_copy_stat", errmsg, p2p_copy);
+        if(errmsg.empty() && p2p_copy.size() == 2) {
+            const char *dir[] = { "write", "read" };
+            for (size_t i = 0; i < p2p_copy.size(); i++) {
+                unsigned long long count = 0, bytes = 0, usecs = 0;
+                std::stringstream ss(p2p_copy[i]);
+                ss >> count >> bytes >> usecs;
+                std::string pt = std::string("board.info.p2p_copy.") + dir[i];
+                sensor_tree::put( pt + ".count", count );
+                sensor_tree::put( pt + ".bytes", bytes );
+                sensor_tree::put( pt + ".usecs", usecs );
+            }
+        }
         return 0;
     }
 
@@ -797,6 +925,20 @@ public:
                  ostr << std::setw(16) << "no iomem" << std::endl;
              break;
         }
+        if (sensor_tree::get( "board.info.p2p_copy.write.count", 0ULL ) ||
+            sensor_tree::get( "board.info.p2p_copy.read.count", 0ULL )) {
+            ostr << std::setw(16) << "P2P Copy" << std::setw(16) << "Count"
+                 << std::setw(16) << "Size" << std::setw(16) << "MB/s" << std::endl;
+            for (auto dir : { "write", "read" }) {
+                std::string pt = std::string("board.info.p2p_copy.") + dir;
+                auto bytes = sensor_tree::get( pt + ".bytes", 0ULL );
+                auto usecs = sensor_tree::get( pt + ".usecs", 0ULL );
+                ostr << std::setw(16) << (std::string("peer ") + dir)
+                     << std::setw(16) << sensor_tree::get( pt + ".count", 0ULL )
+                     << std::setw(16) << unitConvert(bytes)
+                     << std::setw(16) << (usecs ? bytes / usecs : 0) << std::endl;
+            }
+        }
         ostr << "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~\n";
         ostr << "Temperature(C)\n";
         // use get_pretty for Temperature and Electrical since the driver may rail unsupported values high
@@ -1120,6 +1262,52 @@ public:
         return -1;
     }
 
+    /*
+     * streamtest
+     *
+     * Runs on the first write and the first read stream of the loaded
+     * xclbin, see StreamRunner.
+     */
+    int streamtest(StreamRunner::mode mode) {
+        std::string errmsg;
+        std::vector<char> buf;
+
+        pcidev::get_dev(m_idx)->sysfs_get("icap", "mem_topology", errmsg, buf);
+        if (!errmsg.empty()) {
+            std::cout << errmsg << std::endl;
+            return -EINVAL;
+        }
+        const mem_topology *map = (mem_topology *)buf.data();
+        if (buf.empty() || map->m_count == 0) {
+            std::cout << "WARNING: 'mem_topology' invalid, "
+                << "unable to perform Stream Test. Has the bitstream been loaded? "
+                << "See 'xbutil program'." << std::endl;
+            return -EINVAL;
+        }
+
+        const mem_data *wr = nullptr, *rd = nullptr;
+        for (int32_t i = 0; i < map->m_count; i++) {
+            const mem_data *mem = &map->m_mem_data[i];
+            if (mem->m_type != MEM_STREAMING)
+                continue;
+            if (!wr && strstr((char *)mem->m_tag, "_w"))
+                wr = mem;
+            else if (!rd && strstr((char *)mem->m_tag, "_r"))
+                rd = mem;
+        }
+
+        if ((mode != StreamRunner::C2H && !wr) || (mode != StreamRunner::H2C && !rd)) {
+            std::cout << "ERROR: xclbin has no stream for this test" << std::endl;
+            return -EINVAL;
+        }
+
+        StreamRunner runner(m_handle, mode != StreamRunner::C2H ? wr : nullptr,
+            mode != StreamRunner::H2C ? rd : nullptr);
+        return runner.run(mode);
+    }
+
+    int dmatestSweep();
+
     /*
      * dmatest
      *
@@ -1331,6 +1519,8 @@ public:
      *           REQUIRED for deviceToFile
      * --skip : specify the source offset (in block counts) OPTIONAL defaults to 0
      * --seek : specify the destination offset (in block counts) OPTIONAL defaults to 0
+     * --depth : number of blocks in flight between file I/O and DMA OPTIONAL defaults to 3
+     * --direct : use O_DIRECT file I/O, block size must be a multiple of the page size
      */
     int do_dd(dd::ddArgs_t args )
     {
@@ -1339,55 +1529,8 @@ public:
         }
         if( args.dir == dd::unset ) {
             return -1; // direction invalid
-        } else if( args.dir == dd::deviceToFile ) {
-            unsigned long long addr = args.skip; // ddr read offset
-            while( args.count-- > 0 ) { // writes all full blocks
-                memread( args.file, addr, args.blockSize ); // returns 0 on complete read.
-                // how to check for partial reads when device is empty?
-                addr += args.blockSize;
-            }
-        } else if( args.dir == dd::fileToDevice ) {
-            // write entire contents of file to device DDR at seek offset.
-            unsigned long long addr = args.seek; // ddr write offset
-            std::ifstream iStream( args.file.c_str(), std::ifstream::binary );
-            if( !iStream ) {
-                perror( "open input file" );
-                return errno;
-            }
-            // If unspecified count, calculate the count from the full file size.
-            if( args.count <= 0 ) {
-                iStream.seekg( 0, iStream.end );
-                int length = iStream.tellg();
-                args.count = length / args.blockSize + 1; // round up
-                iStream.seekg( 0, iStream.beg );
-            }
-            iStream.seekg( 0, iStream.beg );
-
-            char *buf;
-            static char *inBuf;
-            size_t inSize;
-
-            inBuf = (char*)malloc( args.blockSize );
-            if( !inBuf ) {
-                perror( "malloc block size" );
-                return errno;
-            }
-
-            while( args.count-- > 0 ) { // writes all full blocks
-                buf = inBuf;
-                inSize = iStream.read( inBuf, args.blockSize ).gcount();
-                if( (int)inSize == args.blockSize ) {
-                    // full read
-                } else {
-                    // Partial read--write size specified greater than read size. Writing remainder of input file.
-                    args.count = 0; // force break
-                }
-                memwrite( addr, inSize, buf );
-                addr += inSize;
-            }
-            iStream.close();
         }
-        return 0;
+        return dd::copy( m_handle, args );
     }
 
     int usageInfo(xclDeviceUsage& devstat) const {
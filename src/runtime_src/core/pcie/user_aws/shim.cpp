@@ -78,6 +78,13 @@ namespace awsbwhal {
     static std::mutex deviceListMutex;
     //  static std::vector<std::pair<int, int>> deviceList;
 
+#ifndef INTERNAL_TESTING
+    // AFI and xclbin uuid of the last successful load per slot, which lets
+    // a reload of the same xclbin skip reading back the uuid from sysfs
+    static std::mutex afiCacheMutex;
+    static std::map<int, std::pair<std::string, uint64_t>> afiCache;
+#endif
+
     const unsigned AwsXcl::TAG = 0X586C0C6C; // XL OpenCL X->58(ASCII), L->6C(ASCII), O->0 C->C L->6C(ASCII);
 
 #ifdef INTERNAL_TESTING
@@ -149,11 +156,27 @@ namespace awsbwhal {
           std::memset(&orig_info, 0, sizeof(struct fpga_mgmt_image_info));
           fpga_mgmt_describe_local_image(mBoardNumber, &orig_info, 0);
 
-          uint64_t xclbin_id_from_sysfs;
-          if( int retVal = xclGetXclBinIdFromSysfs( xclbin_id_from_sysfs ) != 0 )
-             return retVal;
+          // The loaded AFI matches and was loaded with this xclbin before
+          bool cached = false;
+          if ( (orig_info.status == FPGA_STATUS_LOADED) && !std::strcmp(orig_info.ids.afi_id, afi_id) ) {
+              std::lock_guard<std::mutex> lk(afiCacheMutex);
+              auto itr = afiCache.find(mBoardNumber);
+              cached = (itr != afiCache.end()) && (itr->second.first == afi_id) &&
+                       (itr->second.second == axlfbuffer->m_uniqueId);
+          }
 
-          if ( (xclbin_id_from_sysfs == 0) || (axlfbuffer->m_uniqueId != xclbin_id_from_sysfs) || checkAndSkipReload(afi_id, &orig_info) ) {
+          uint64_t xclbin_id_from_sysfs = 0;
+          if ( !cached ) {
+              if ( (retVal = xclGetXclBinIdFromSysfs( xclbin_id_from_sysfs )) != 0 )
+                  return retVal;
+          }
+
+          if ( (!cached && ((xclbin_id_from_sysfs == 0) || (axlfbuffer->m_uniqueId != xclbin_id_from_sysfs))) ||
+               checkAndSkipReload(afi_id, &orig_info) ) {
+              {
+                  std::lock_guard<std::mutex> lk(afiCacheMutex);
+                  afiCache.erase(mBoardNumber);
+              }
               // force data retention option
               union fpga_mgmt_load_local_image_options opt;
               fpga_mgmt_init_load_local_image_options(&opt);
@@ -181,6 +204,8 @@ namespace awsbwhal {
               if (retVal) {
                   std::cout << "IOCTL DRM_IOCTL_XOCL_READ_AXLF Failed: " << retVal << std::endl;
               } else {
+                  std::lock_guard<std::mutex> lk(afiCacheMutex);
+                  afiCache[mBoardNumber] = std::make_pair(std::string(afi_id), axlfbuffer->m_uniqueId);
                   std::cout << "AFI load complete." << std::endl;
               }
           }
@@ -413,6 +438,8 @@ namespace awsbwhal {
         ocl_kernel_bar = -1;
         ocl_global_mem_bar = -1;
         sda_mgmt_bar = -1;
+        mKernelBarMap = nullptr;
+        mKernelBarSize = 0;
 
 #endif
 
@@ -493,6 +520,21 @@ namespace awsbwhal {
                         sda_mgmt_bar = -1;
                         std::cout << "ERROR AwsXcl: PCI mgmt bar attach failed for slot# " << std::dec << slot_id << std::endl;
         }
+
+        // The library maps the BAR at attach, keep a pointer to the mapping
+        // so that kernel control and perfmon access is a plain load/store
+        // instead of a peek/poke call per word
+        mKernelBarMap = nullptr;
+        mKernelBarSize = 0;
+        if (ocl_kernel_bar >= 0) {
+            struct fpga_slot_spec spec;
+            void *map = nullptr;
+            if (!fpga_pci_get_slot_spec(slot_id, &spec) &&
+                !fpga_pci_get_address(ocl_kernel_bar, 0, spec.map[FPGA_APP_PF].resource_size[APP_PF_BAR0], &map)) {
+                mKernelBarMap = static_cast<char *>(map);
+                mKernelBarSize = spec.map[FPGA_APP_PF].resource_size[APP_PF_BAR0];
+            }
+        }
 #endif
 
         //
@@ -538,8 +580,8 @@ namespace awsbwhal {
 
     int AwsXcl::pcieBarRead(int bar_num, unsigned long long offset, void* buffer, unsigned long long length) {
         char *qBuf = (char *)buffer;
-#ifdef INTERNAL_TESTING
         char *mem = 0;
+#ifdef INTERNAL_TESTING
         switch (bar_num) {
         case 0:
         {
@@ -551,6 +593,10 @@ namespace awsbwhal {
         switch (bar_num) {
         case APP_PF_BAR0:
         {
+            if (mKernelBarMap && (length + offset) > mKernelBarSize) {
+                return -1;
+            }
+            mem = mKernelBarMap;
 #endif
             break;
         }
@@ -564,7 +610,10 @@ namespace awsbwhal {
 #ifdef INTERNAL_TESTING
             *(unsigned *)qBuf = *(unsigned *)(mem + offset);
 #else
-	    fpga_pci_peek(ocl_kernel_bar, (uint64_t)offset,(uint32_t*)qBuf);
+            if (mem)
+                *(uint32_t *)qBuf = *(volatile uint32_t *)(mem + offset);
+            else
+                fpga_pci_peek(ocl_kernel_bar, (uint64_t)offset,(uint32_t*)qBuf);
 #endif
             offset += 4;
             qBuf += 4;
@@ -588,8 +637,8 @@ namespace awsbwhal {
 
     int AwsXcl::pcieBarWrite(int bar_num, unsigned long long offset, const void* buffer, unsigned long long length) {
         char *qBuf = (char *)buffer;
-#ifdef INTERNAL_TESTING
         char *mem = 0;
+#ifdef INTERNAL_TESTING
         switch (bar_num) {
         case 0:
         {
@@ -601,6 +650,10 @@ namespace awsbwhal {
         switch (bar_num) {
         case APP_PF_BAR0:
         {
+          if (mKernelBarMap && (length + offset) > mKernelBarSize) {
+              return -1;
+          }
+          mem = mKernelBarMap;
 #endif
           break;
         }
@@ -614,7 +667,10 @@ namespace awsbwhal {
 #ifdef INTERNAL_TESTING
             *(unsigned *)(mem + offset) = *(unsigned *)qBuf;
 #else
-	    fpga_pci_poke(ocl_kernel_bar, uint64_t (offset), *((uint32_t*) qBuf));
+            if (mem)
+                *(volatile uint32_t *)(mem + offset) = *(uint32_t *)qBuf;
+            else
+                fpga_pci_poke(ocl_kernel_bar, uint64_t (offset), *((uint32_t*) qBuf));
 #endif
             offset += 4;
             qBuf += 4;
@@ -940,12 +996,13 @@ namespace awsbwhal {
 
     int AwsXcl::xclGetBOProperties(unsigned int boHandle, xclBOProperties *properties)
     {
-      drm_xocl_info_bo info = {boHandle, 0, 0, 0};
+      drm_xocl_info_bo info = {boHandle, 0, 0, 0, -1, 0};
       int result = ioctl(mUserHandle, DRM_IOCTL_XOCL_INFO_BO, &info);
       properties->handle = info.handle;
       properties->flags  = info.flags;
       properties->size   = info.size;
       properties->paddr  = info.paddr;
+      properties->numa_node = info.numa_node;
       return result ? mNullBO : 0;
     }
 
@@ -1040,8 +1097,14 @@ namespace awsbwhal {
 
     int AwsXcl::sleepUntilLoaded( const std::string afi )
     {
-        for( int i = 0; i < 20; i++ ) {
-            std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
+        // Poll at a short interval first, a load of an AFI that is cached
+        // on the instance completes in a few milliseconds.  Back off to
+        // 100ms for loads that take longer, within the same 2s budget.
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds( 2 );
+        auto delay = std::chrono::milliseconds( 1 );
+        while( std::chrono::steady_clock::now() < deadline ) {
+            std::this_thread::sleep_for( delay );
+            delay = std::min( delay * 2, std::chrono::milliseconds( 100 ) );
             fpga_mgmt_image_info info;
             std::memset( &info, 0, sizeof(struct fpga_mgmt_image_info) );
             int result = fpga_mgmt_describe_local_image( mBoardNumber, &info, 0 );
@@ -287,6 +287,8 @@ private:
   pci_bar_handle_t ocl_kernel_bar;     // AppPF BAR0 for OpenCL kernels
   pci_bar_handle_t sda_mgmt_bar;       // MgmtPF BAR4, for SDAccel Perf mon etc
   pci_bar_handle_t ocl_global_mem_bar; // AppPF BAR4
+  char *mKernelBarMap;                 // AppPF BAR0 mapping of ocl_kernel_bar
+  uint64_t mKernelBarSize;
 #endif
   uint32_t mMemoryProfilingNumberSlots;
   uint32_t mAccelProfilingNumberSlots;
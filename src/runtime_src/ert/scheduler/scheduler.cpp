@@ -288,6 +288,25 @@ static value_type mb_host_interrupt_enabled = 0;
 static value_type cu_dma_52                 = 0;
 static value_type cdma_enabled              = 0;
 static value_type dataflow_enabled          = 0;
+static value_type cu_policy                 = ERT_CU_POLICY_FIRST;
+
+// Register maps of at most this many words (control words included)
+// are written by the MicroBlaze, larger maps are transferred by the
+// CU DMA.  Programming the DMA takes about as many register writes as
+// a small map, but for a large map it is a few writes regardless of
+// size and the transfer runs while the scheduler moves on to other
+// slots.  Set in setup per DMA flavor
+static size_type cu_dma_min_words           = 0;
+
+// Round robin CU selection resumes search at this CU
+static size_type cu_next                    = 0;
+
+// Interrupt coalescing, host is notified of completed commands after
+// intr_coalesce completions or when a scheduler loop pass found no new
+// completions.  Pending masks are per status register
+static size_type intr_coalesce              = 0;
+static volatile bitmask_type notify_pending[4];
+static volatile size_type notify_pending_count = 0;
 
 // Struct slot_info is per command slot in command queue
 struct slot_info
@@ -311,6 +330,18 @@ struct slot_info
 
   // Size of register map in command slot (in 32 bit words)
   size_type regmap_size = 0;
+
+  // Number of nodes if command is a DAG (ERT_START_DAG), else 0
+  size_type dag_nodes = 0;
+
+  // Bitmask of DAG nodes that have been started
+  bitmask_type dag_started = 0;
+
+  // Bitmask of DAG nodes that have completed, updated by ISR
+  volatile bitmask_type dag_done = 0;
+
+  // Set when DAG nodes may be ready to start
+  volatile bool dag_progress = false;
 };
 
 // Fixed sized map from slot_idx -> slot info
@@ -319,6 +350,9 @@ static slot_info command_slots[max_slots];
 // Fixed sized map from cu_idx -> slot_idx
 static size_type cu_slot_usage[max_cus];
 
+// Fixed sized map from cu_idx -> DAG node running on CU
+static size_type cu_dag_node[max_cus];
+
 // Fixed sized map from cu_idx -> number of times executed
 static size_type cu_usage[max_cus];
 
@@ -328,6 +362,24 @@ static bitset_type cu_status;
 
 // Bitmask for interrupt enabled CUs.  (0) no interrupt (1) enabled
 static bitset_type cu_interrupt_mask;
+
+// Bitmask of slots that are not free (new, queued, or running).
+// Owned by scheduler loop, which visits only these slots.
+static bitset_type slot_pending;
+
+// Bitmask of queued slots with a high priority command, visited
+// before other pending slots.  Owned by scheduler loop.
+static bitset_type slot_high;
+
+// Bitmask of CUs wanted by high priority commands that could not be
+// started in current scheduler loop pass.  Normal priority commands
+// that can use any of these CUs are not started in the same pass.
+static bitset_type cu_high_wanted;
+static bool cu_high_waiting = false;
+
+// Bitmask of slots transitioned to new by the host interrupt handler,
+// merged into slot_pending by scheduler loop with interrupts disabled.
+static volatile bitmask_type slot_signaled[4];
 #ifndef ERT_HW_EMU
 /**
  * Utility to read a 32 bit value from any axi-lite peripheral
@@ -424,6 +476,28 @@ idx_in_mask(size_type idx, size_type mask_idx)
   return idx < ((mask_idx+1)<<5);
 }
 
+/**
+ * first_idx() - Index of lowest order bit set in non zero mask
+ */
+inline size_type
+first_idx(bitmask_type mask)
+{
+  return __builtin_ctz(mask);
+}
+
+/**
+ * valid_mask() - Bitmask of positions [0,num) covered by mask_idx
+ *
+ * @num: Number of valid positions, e.g. num_slots
+ * @mask_idx: Index of bit mask determines range of mask (1=>[63,32])
+ */
+inline bitmask_type
+valid_mask(size_type num, size_type mask_idx)
+{
+  auto bits = num - (mask_idx<<5);
+  return bits>=32 ? ~bitmask_type(0) : (bitmask_type(1)<<bits)-1;
+}
+
 /**
  * idx_to_mask() - Return the bitmask corresponding to idx in mask with idx
  *
@@ -465,9 +539,15 @@ setup()
 
   // In dataflow number of slots is number of CUs plus ctrl slot (0),
   // otherwise its as many slots as possible per slot_size
+  // Slot size is computed per xclbin by host, at most max_slots
   num_slots = dataflow_enabled ? num_cus+1 : ERT_CQ_SIZE / slot_size;
+  if (num_slots > max_slots)
+    num_slots = max_slots;
   num_slot_masks = ((num_slots-1)>>5) + 1;
   num_cu_masks = ((num_cus-1)>>5) + 1;
+  // 4 control words, plus the slot mask write and the cu address or
+  // cu mask writes of configure_cu_dma
+  cu_dma_min_words = 4 + 1 + (cu_dma_52 ? 1 : num_cu_masks);
 
   CTRL_DEBUGF("slot_size=0x%x\n",slot_size);
   CTRL_DEBUGF("num_slots=%d\n",num_slots);
@@ -478,11 +558,14 @@ setup()
   CTRL_DEBUGF("cu_base_address=0x%x\n",cu_base_address);
   CTRL_DEBUGF("cu_dma_enabled=%d\n",cu_dma_enabled);
   CTRL_DEBUGF("cu_dma_52=%d\n",cu_dma_52);
+  CTRL_DEBUGF("cu_dma_min_words=%d\n",cu_dma_min_words);
   CTRL_DEBUGF("cdma_enabled=%d\n",cdma_enabled);
   CTRL_DEBUGF("cu_isr_enabled=%d\n",cu_interrupt_enabled);
   CTRL_DEBUGF("cq_int_enabled=%d\n",cq_status_enabled);
   CTRL_DEBUGF("mb_host_int_enabled=%d\n",mb_host_interrupt_enabled);
   CTRL_DEBUGF("dataflow_enabled=%d\n",dataflow_enabled);
+  CTRL_DEBUGF("cu_policy=%d\n",cu_policy);
+  CTRL_DEBUGF("intr_coalesce=%d\n",intr_coalesce);
 
   // Initialize command slots
   for (size_type i=0; i<num_slots; ++i) {
@@ -502,6 +585,12 @@ setup()
     ERT_UNUSED volatile auto val = read_reg(STATUS_REGISTER_ADDR[i]);
 
   cu_status.reset(num_cus);
+  cu_next = 0;
+  slot_pending.reset(num_slots-1);
+  slot_high.reset(num_slots-1);
+  for (size_type i=0; i<4; ++i)
+    slot_signaled[i] = notify_pending[i] = 0;
+  notify_pending_count = 0;
 
   // Initialize cu_slot_usage
   for (size_type i=0; i<num_cus; ++i) {
@@ -626,6 +715,42 @@ notify_host(size_type cmd_idx)
   write_reg(STATUS_REGISTER_ADDR[cmd_idx>>5],1<<cmd_idx);
 }
 
+/**
+ * Write pending completion notifications to host status registers
+ */
+inline void
+flush_notify()
+{
+  for (size_type w=0; w<4; ++w) {
+    if (notify_pending[w]) {
+      write_reg(STATUS_REGISTER_ADDR[w],notify_pending[w]);
+      notify_pending[w] = 0;
+    }
+  }
+  notify_pending_count = 0;
+}
+
+/**
+ * Notify host of completed command subject to interrupt coalescing
+ *
+ * Caller must have interrupts disabled, either in ISR or guarded
+ */
+inline void
+notify_host_coalesced(size_type cmd_idx)
+{
+  if (!intr_coalesce) {
+    notify_host(cmd_idx);
+    return;
+  }
+
+  ERT_DEBUGF("notify_host_coalesced(%d)\n",cmd_idx);
+  auto mask_idx = cmd_idx>>5;
+  notify_pending[mask_idx] = notify_pending[mask_idx] | idx_to_mask(cmd_idx,mask_idx);
+  notify_pending_count = notify_pending_count + 1;
+  if (notify_pending_count >= intr_coalesce)
+    flush_notify();
+}
+
 /**
  * Configure a CU at argument address
  *
@@ -651,6 +776,28 @@ configure_cu(addr_type cu_addr, addr_type regmap_addr, size_type regmap_size)
   write_reg(cu_addr,0x1);
 }
 
+/**
+ * Write {offset,value} pairs of ERT_EXEC_WRITE command to CU and
+ * start CU
+ *
+ * @param cu_addr
+ *  The address of the CU to configure and start
+ * @param regmap_addr
+ *  The address of the register map with the pairs past the 4
+ *  control words
+ * @param regmap_size
+ *  The size of register map in 32 bit words
+ */
+inline void
+configure_cu_ooo(addr_type cu_addr, addr_type regmap_addr, size_type regmap_size)
+{
+  for (size_type i=4; i+1<regmap_size; i+=2)
+    write_reg(cu_addr + read_reg(regmap_addr + (i<<2)),read_reg(regmap_addr + ((i+1)<<2)));
+
+  // start kernel at base + 0x0
+  write_reg(cu_addr,0x1);
+}
+
 /**
  * Configure a CU DMA engine
  *
@@ -691,6 +838,53 @@ configure_cu_dma(size_type cu_idx, size_type slot_idx, addr_type slot_addr)
   write_reg(CU_DMA_REGISTER_ADDR[mask_idx],idx_to_mask(slot_idx,mask_idx));
 }
 
+/**
+ * Check if the register map of a command is transferred by CU DMA
+ *
+ * Small register maps are cheaper to write directly.  The cudma in
+ * 5.1 DSAs has a bug and supports at most 127 word copy excluding
+ * the 4 control words, larger maps are written by MicroBlaze.
+ *
+ * @param header_value
+ *  Command header
+ * @return
+ *  True if CU DMA should configure and start the CU
+ */
+inline bool
+use_cu_dma(value_type header_value)
+{
+  auto size = regmap_size(header_value);
+  return cu_dma_enabled
+    && size > cu_dma_min_words
+    && (cu_dma_52 || size<(127+4));
+}
+
+/**
+ * Select an idle CU for a command per cu_policy
+ *
+ * @param cus
+ *  CUs that can be used by the command
+ * @return
+ *  Index of selected CU or no_index if all are busy
+ */
+inline size_type
+select_cu(const bitset_type& cus)
+{
+  size_type start = (cu_policy==ERT_CU_POLICY_ROUND_ROBIN && cu_next<num_cus) ? cu_next : 0;
+  size_type select = no_index;
+
+  // Check all CUs against argument cus mask and against cu_status
+  for (size_type i=0, cu_idx=start; i<num_cus; ++i, cu_idx = (cu_idx+1==num_cus) ? 0 : cu_idx+1) {
+    if (!cus.test(cu_idx) || cu_status.test(cu_idx))
+      continue;
+    if (cu_policy!=ERT_CU_POLICY_LEAST_USED)
+      return cu_idx;
+    if (select==no_index || cu_usage[cu_idx]<cu_usage[select])
+      select = cu_idx;
+  }
+  return select;
+}
+
 /**
  * Start a cu for command in slot
  *
@@ -704,29 +898,111 @@ inline size_type
 start_cu(size_type slot_idx)
 {
   auto& slot = command_slots[slot_idx];
-  auto& cus = slot.cus;
+  auto cu_idx = select_cu(slot.cus);
+  if (cu_idx==no_index)
+    return no_index;
+
+  ERT_DEBUGF("start_cu cu(%d) for slot_idx(%d)\n",cu_idx,slot_idx);
+  ERT_ASSERT(read_reg(cu_idx_to_addr(cu_idx))==AP_IDLE,"cu not ready");
+  // cudma copies a consecutive register map, so {offset,value} pairs
+  // are written manually
+  if (opcode(slot.header_value)==ERT_EXEC_WRITE) {
+    configure_cu_ooo(cu_idx_to_addr(cu_idx),slot.regmap_addr,slot.regmap_size);
+  }
+  else if (use_cu_dma(slot.header_value)) {
+    // hardware transfer and start, no wait for the transfer
+    configure_cu_dma(cu_idx,slot_idx,slot.slot_addr);
+  }
+  else {
+    // manually configure and start cu
+    configure_cu(cu_idx_to_addr(cu_idx),slot.regmap_addr,slot.regmap_size);
+  }
+  cu_status.toggle(cu_idx);     // toggle cu status bit, it is now busy
+  set_cu_info(cu_idx,slot_idx); // record which slot cu associated with
+  cu_next = cu_idx+1;
+  return cu_idx;
+}
 
-  // Check all CUs against argument cus mask and against cu_status
-  for (size_type cu_idx=0; cu_idx<num_cus; ++cu_idx) {
-    if (cus.test(cu_idx) && !cu_status.test(cu_idx)) {
-      ERT_DEBUGF("start_cu cu(%d) for slot_idx(%d)\n",cu_idx,slot_idx);
-      ERT_ASSERT(read_reg(cu_idx_to_addr(cu_idx))==AP_IDLE,"cu not ready");
-      // cudma in 5.1 DSAs has a bug and supports at most 127 word copy
-      // excluding the 4 control words
-      if (cu_dma_enabled && (cu_dma_52 || regmap_size(slot.header_value)<(127+4))) {
-        // hardware transfer and start
-        configure_cu_dma(cu_idx,slot_idx,slot.slot_addr);
-      }
-      else {
-        // manually configure and start cu
-        configure_cu(cu_idx_to_addr(cu_idx),slot.regmap_addr,slot.regmap_size);
-      }
-      cu_status.toggle(cu_idx);     // toggle cu status bit, it is now busy
-      set_cu_info(cu_idx,slot_idx); // record which slot cu associated with
-      return cu_idx;
+/**
+ * Start DAG nodes whose dependencies have completed
+ *
+ * The nodes are read from the command slot, each is started on an
+ * idle CU selected per cu_policy.  A node that cannot be started
+ * because its CUs are busy is retried on next call.
+ *
+ * @param slot_idx
+ *  Index of DAG command
+ * @return
+ *  True if any node of the DAG is running or has completed
+ */
+static bool
+start_dag(size_type slot_idx)
+{
+  auto& slot = command_slots[slot_idx];
+  bitmask_type done = slot.dag_done;
+  bool blocked = false;
+
+  // first node follows the CU masks and the node count
+  addr_type node_addr = slot.regmap_addr + sizeof(addr_type);
+  for (size_type node=0; node<slot.dag_nodes; ++node) {
+    auto deps = read_reg(node_addr);
+    addr_type pkt_addr = node_addr + sizeof(addr_type);
+    auto pkt_header = read_reg(pkt_addr);
+    node_addr = pkt_addr + ((payload_size(pkt_header)+1)<<2);
+
+    bitmask_type node_mask = 1<<node;
+    if ((slot.dag_started & node_mask) || (deps & ~done))
+      continue;
+
+    bitset_type cus;
+    for (size_type idx=0; idx<cu_masks(pkt_header); ++idx)
+      cus.set_mask(idx,read_reg(cu_section_addr(pkt_addr) + (idx<<2)));
+    auto cu_idx = select_cu(cus);
+    if (cu_idx==no_index) {
+      blocked = true;
+      continue;
     }
+
+    ERT_DEBUGF("start_dag cu(%d) for slot_idx(%d) node(%d)\n",cu_idx,slot_idx,node);
+    ERT_ASSERT(read_reg(cu_idx_to_addr(cu_idx))==AP_IDLE,"cu not ready");
+    if (opcode(pkt_header)==ERT_EXEC_WRITE)
+      configure_cu_ooo(cu_idx_to_addr(cu_idx),regmap_section_addr(pkt_header,pkt_addr),regmap_size(pkt_header));
+    else
+      configure_cu(cu_idx_to_addr(cu_idx),regmap_section_addr(pkt_header,pkt_addr),regmap_size(pkt_header));
+    cu_status.toggle(cu_idx);
+    set_cu_info(cu_idx,slot_idx);
+    cu_dag_node[cu_idx] = node;
+    cu_next = cu_idx+1;
+    slot.cus.set(cu_idx);
+    slot.dag_started |= node_mask;
   }
-  return no_index;
+
+  slot.dag_progress = blocked;
+  return slot.dag_started != 0;
+}
+
+/**
+ * Record completion of the DAG node running on a CU
+ *
+ * The host is notified when the last node of the DAG completes.
+ *
+ * @return
+ *  True if DAG command is complete
+ */
+static bool
+check_dag(size_type slot_idx, size_type cu_idx)
+{
+  auto& slot = command_slots[slot_idx];
+  slot.cus.clear(cu_idx);
+  slot.dag_done = slot.dag_done | (1<<cu_dag_node[cu_idx]);
+  slot.dag_progress = true;
+  if (slot.dag_done != (((bitmask_type)1<<slot.dag_nodes)-1))
+    return false;
+
+  notify_host_coalesced(slot_idx);
+  slot.header_value = (slot.header_value & ~0xF) | 0x4; // free
+  ERT_DEBUGF("slot(%d) [running -> free]\n",slot_idx);
+  return true;
 }
 
 /**
@@ -746,10 +1022,14 @@ check_command(size_type slot_idx, size_type cu_idx)
 {
   auto& slot = command_slots[slot_idx];
   ERT_ASSERT(slot.cus.test(cu_idx),"cu is not used by slot");
+  if (slot.dag_nodes) {
+    check_dag(slot_idx,cu_idx);
+    return;
+  }
   // toggle cu mask in slot
   slot.cus.toggle(cu_idx);
   if (slot.cus.none()) {
-    notify_host(slot_idx);
+    notify_host_coalesced(slot_idx);
     slot.header_value = (slot.header_value & ~0xF) | 0x4; // free
     ERT_DEBUGF("slot(%d) [running -> free]\n",slot_idx);
 
@@ -840,6 +1120,8 @@ configure_mb(size_type slot_idx)
   cq_status_enabled = (features & 0x10)!=0;
   cdma_enabled = (features & 0x20)!=0;
   dataflow_enabled = (features & 0x40)!=0;
+  cu_policy = (features >> 7) & 0x3;
+  intr_coalesce = (features >> 9) & 0x3F;
   cu_dma_52 = (features & 0x80000000)!=0;
 
   // CU base address
@@ -919,7 +1201,7 @@ abort_mb(size_type slot_idx)
   auto& slot = command_slots[slot_idx];
   size_type sidx = (slot.header_value >>  15) & 0xFF;
   auto& s = command_slots[sidx];
-  if (opcode(s.header_value)!=ERT_START_KERNEL)
+  if (opcode(s.header_value)!=ERT_START_KERNEL && opcode(s.header_value)!=ERT_EXEC_WRITE)
     return true; // bail if not a start_kernel command
   if ((s.header_value & 0xF)!=0x3)
     return true; // bail if not running
@@ -931,6 +1213,7 @@ abort_mb(size_type slot_idx)
     }
   }
 
+  flush_notify();
   notify_host(slot_idx);
   return true;
 }
@@ -995,7 +1278,7 @@ new_to_queued(size_type slot_idx)
 
   auto opc = opcode(slot.header_value);
   ERT_DEBUGF("slot_idx(%d) opcode = %d\n",slot_idx,opc);
-  if (opc!=ERT_START_KERNEL) { // Non performance critical command
+  if (opc!=ERT_START_KERNEL && opc!=ERT_EXEC_WRITE && opc!=ERT_START_DAG) { // Non performance critical command
     process_special_command(opc,slot_idx);
     return false;
   }
@@ -1007,8 +1290,22 @@ new_to_queued(size_type slot_idx)
   }
   slot.regmap_addr = regmap_section_addr(slot.header_value,slot.slot_addr);
   slot.regmap_size = regmap_size(slot.header_value);
+  slot.dag_nodes = 0;
+
+  // DAG command, regmap section starts with number of nodes
+  if (opc==ERT_START_DAG) {
+    slot.dag_nodes = read_reg(slot.regmap_addr);
+    slot.dag_started = 0;
+    slot.dag_done = 0;
+    slot.dag_progress = true;
+    ERT_ASSERT(slot.dag_nodes && slot.dag_nodes<=ERT_DAG_MAX_NODES,"bad dag");
+  }
   slot.header_value = (slot.header_value & ~0xF) | 0x2; // queued
 
+  // Header [6] is command priority
+  if (opc!=ERT_START_DAG && (slot.header_value & 0x40))
+    slot_high.set(slot_idx);
+
   ERT_DEBUGF("slot(%d) [new -> queued]\n",slot_idx);
 
 #ifdef DEBUG_SLOT_STATE
@@ -1032,6 +1329,17 @@ queued_to_running(size_type slot_idx)
 
   // disable CU interrupts while starting command
   disable_interrupt_guard guard;
+
+  // DAG command, running once any node is started
+  if (slot.dag_nodes) {
+    slot.cus.reset(num_cus);       // bitmask now reflects running cus
+    if (!start_dag(slot_idx))
+      return false;
+    slot.header_value |= 0x1;      // running (0x2->0x3)
+    ERT_DEBUGF("slot(%d) [queued -> running]\n",slot_idx);
+    return true;
+  }
+
   // queued command, start if any of cus is ready
   auto cu_idx = start_cu(slot_idx);
   if (cu_idx != no_index) {
@@ -1064,7 +1372,13 @@ running_to_free(size_type slot_idx)
     auto cu_mask = slot.cus.get_mask(w);
     for (size_type cu_idx=offset; cu_mask; cu_mask >>=1, ++cu_idx) {
       if ((cu_mask & 0x1) && check_cu(cu_idx,false)) {
-        notify_host(slot_idx);
+        disable_interrupt_guard guard;
+        if (slot.dag_nodes) {
+          if (check_dag(slot_idx,cu_idx))
+            return true;
+          continue;
+        }
+        notify_host_coalesced(slot_idx);
         slot.header_value = (slot.header_value & ~0xF) | 0x4; // free
         ERT_DEBUGF("slot(%d) [running -> free]\n",slot_idx);
 
@@ -1078,6 +1392,103 @@ running_to_free(size_type slot_idx)
   return false;
 }
 
+/**
+ * Poll CUs in dataflow mode
+ *
+ * In dataflow mode ERT is polling CUs for completion after host has
+ * started CU or acknowleged completion.  Slot (cu_idx+1) is written
+ * by host to start or continue a CU, slot 0 is reserved for ctrl
+ * commands which are processed in normal flow.
+ */
+static void
+dataflow_poll()
+{
+  for (size_type w=0,offset=0; w<num_cu_masks; ++w,offset+=32) {
+    auto mask = valid_mask(num_cus,w);
+    while (mask) {
+      auto cuidx = offset + first_idx(mask);
+      mask &= mask-1;
+      auto slot_idx = cuidx+1;  // compensate for reserved slot (0)
+      auto& slot = command_slots[slot_idx];
+
+      // Check if host has started or continued this CU
+      if (!cu_status.test(cuidx)) {
+        auto cqvalue = read_reg(slot.slot_addr);
+        if (!(cqvalue & (AP_START|AP_CONTINUE)))
+          continue; // CU is not used
+        write_reg(slot.slot_addr,0x0); // clear
+        ERT_DEBUGF("enable cu(%d) cqvalue(0x%x)\n",cuidx,cqvalue);
+        cu_status.toggle(cuidx); // enable polling of this CU
+      }
+
+      auto cuvalue = read_reg(cu_idx_to_addr(cuidx));
+      if (!(cuvalue & AP_DONE))
+        continue;
+
+      cu_status.toggle(cuidx); // disable polling until host re-enables
+      ERT_DEBUGF("polled cu(%d) cuvalue(0x%x)\n",cuidx,cuvalue);
+
+      // wake up host
+      disable_interrupt_guard guard;
+      notify_host_coalesced(slot_idx);
+    }
+  }
+}
+
+/**
+ * Check if queued slot can use a CU wanted by a waiting high priority
+ * command
+ */
+inline bool
+held_for_high(size_type slot_idx)
+{
+  if (!cu_high_waiting || slot_high.test(slot_idx))
+    return false;
+  auto& slot = command_slots[slot_idx];
+  for (size_type w=0; w<num_cu_masks; ++w)
+    if (slot.cus.get_mask(w) & cu_high_wanted.get_mask(w))
+      return true;
+  return false;
+}
+
+/**
+ * Advance a pending slot through its states
+ *
+ * @return
+ *   True if slot is free after processing
+ */
+inline bool
+process_slot(size_type slot_idx)
+{
+  auto& slot = command_slots[slot_idx];
+
+  if ((slot.header_value & 0xF) == 0x1) { // new
+    if (!new_to_queued(slot_idx))
+      return (slot.header_value & 0xF) == 0x4;
+  }
+
+  if ((slot.header_value & 0xF) == 0x2) { // queued
+    if (held_for_high(slot_idx) || !queued_to_running(slot_idx))
+      return false;
+    slot_high.clear(slot_idx);
+  }
+
+  if (!cu_interrupt_enabled && ((slot.header_value & 0xF) == 0x3)) { // running
+    if (!running_to_free(slot_idx) && !slot.dag_nodes)
+      return false;
+  }
+
+  // running DAG, start nodes that became ready
+  if (slot.dag_nodes && slot.dag_progress && ((slot.header_value & 0xF) == 0x3)) {
+    disable_interrupt_guard guard;
+    start_dag(slot_idx);
+    return false;
+  }
+
+  // running slots with cu interrupts are freed by interrupt handler
+  return (slot.header_value & 0xF) == 0x4;
+}
+
 /**
  * Main routine executed by embedded scheduler loop
  *
@@ -1091,6 +1502,11 @@ running_to_free(size_type slot_idx)
  *  4. If status is running (0x4), then check CU status
  *     Status remains running (0x4) if CU is still running, or
  *     transitions to free if CU is done
+ *
+ * Only slots in slot_pending are visited for steps 2-4.  Free slots
+ * are polled for step 1 unless the host signals new commands through
+ * the CQ status interrupt, in which case the interrupt handler does
+ * step 1 and records the slot in slot_signaled.
  */
 static void
 scheduler_loop()
@@ -1102,71 +1518,85 @@ scheduler_loop()
   setup();
 
   while (1) {
-    for (size_type slot_idx=0; slot_idx<num_slots; ++slot_idx) {
-      auto& slot = command_slots[slot_idx];
+    size_type notify_count = notify_pending_count;
 
 #ifdef ERT_HW_EMU
-      if(sim_embedded_scheduler_sw_imp::getSchedularPtr()!=nullptr) {
-      sim_embedded_scheduler_sw_imp* sch=sim_embedded_scheduler_sw_imp::getSchedularPtr();
-        wait(sch->maxi_lite_mb_aclk.posedge_event());
-      } else {
-        sc_time t(1,SC_NS);
-        wait(t);
-      }
+    if(sim_embedded_scheduler_sw_imp::getSchedularPtr()!=nullptr) {
+    sim_embedded_scheduler_sw_imp* sch=sim_embedded_scheduler_sw_imp::getSchedularPtr();
+      wait(sch->maxi_lite_mb_aclk.posedge_event());
+    } else {
+      sc_time t(1,SC_NS);
+      wait(t);
+    }
 #endif
 
-      // In dataflow mode ERT is polling CUs for completion after
-      // host has started CU or acknowleged completion.  Ctrl cmds
-      // are processed in normal flow.
-      if (dataflow_enabled && slot_idx>0) {
-        size_type cuidx = slot_idx-1;  // compensate for reserved slot (0)
-
-        // Check if host has started or continued this CU
-        if (!cu_status.test(cuidx)) {
-          auto cqvalue = read_reg(slot.slot_addr);
-          if (cqvalue & (AP_START|AP_CONTINUE)) {
-            write_reg(slot.slot_addr,0x0); // clear
-            ERT_DEBUGF("enable cu(%d) cqvalue(0x%x)\n",cuidx,cqvalue);
-            cu_status.toggle(cuidx); // enable polling of this CU
-          }
+    if (dataflow_enabled)
+      dataflow_poll();
+
+    // In dataflow mode only the reserved ctrl slot (0) runs the state machine
+    auto slots = dataflow_enabled ? 1 : num_slots;
+    auto slot_masks = ((slots-1)>>5) + 1;
+
+    // CQ_STATUS_ENABLED CHECK WON'T WORK IF HOST TRANSITIONS
+    // FROM ENABLED -> DISABLED IN CONFIGURE COMMAND
+    if (!cq_status_enabled) {
+      for (size_type w=0,offset=0; w<slot_masks; ++w,offset+=32) {
+        auto mask = ~slot_pending.get_mask(w) & valid_mask(slots,w);
+        while (mask) {
+          auto slot_idx = offset + first_idx(mask);
+          mask &= mask-1;
+          if (free_to_new(slot_idx))
+            slot_pending.set(slot_idx);
         }
-
-        if (!cu_status.test(cuidx))
-          continue; // CU is not used
-
-        auto cuvalue = read_reg(cu_idx_to_addr(cuidx));
-        if (!(cuvalue & AP_DONE))
-          continue;
-
-        cu_status.toggle(cuidx); // disable polling until host re-enables
-        ERT_DEBUGF("polled cu(%d) cuvalue(0x%x)\n",cuidx,cuvalue);
-
-        // wake up host
-        notify_host(slot_idx);
-        continue;
       }
-
-      // CQ_STATUS_ENABLED CHECK WON'T WORK IF HOST TRANSITIONS
-      // FROM ENABLED -> DISABLED IN CONFIGURE COMMAND
-      if (!cq_status_enabled && ((slot.header_value & 0xF) == 0x4)) { // free
-        if (!free_to_new(slot_idx))
-          continue;
+    }
+    else {
+      bool signaled = false;
+      for (size_type w=0; w<slot_masks; ++w)
+        signaled = signaled || slot_signaled[w];
+      if (signaled) {
+        disable_interrupt_guard guard;
+        for (size_type w=0; w<slot_masks; ++w) {
+          slot_pending.set_mask(w,slot_pending.get_mask(w) | (slot_signaled[w] & valid_mask(slots,w)));
+          slot_signaled[w] = 0;
+        }
       }
+    }
 
-      if ((slot.header_value & 0xF) == 0x1) { // new
-        if (!new_to_queued(slot_idx))
+    // High priority commands get the first pick of free CUs
+    cu_high_waiting = false;
+    for (size_type w=0,offset=0; w<slot_masks; ++w,offset+=32) {
+      auto mask = slot_high.get_mask(w);
+      while (mask) {
+        auto slot_idx = offset + first_idx(mask);
+        mask &= mask-1;
+        if (process_slot(slot_idx))
+          slot_pending.clear(slot_idx);
+        if (!slot_high.test(slot_idx))
           continue;
+        if (!cu_high_waiting)
+          cu_high_wanted.reset(num_cus);
+        cu_high_waiting = true;
+        auto& cus = command_slots[slot_idx].cus;
+        for (size_type cw=0; cw<num_cu_masks; ++cw)
+          cu_high_wanted.set_mask(cw,cu_high_wanted.get_mask(cw) | cus.get_mask(cw));
       }
+    }
 
-      if ((slot.header_value & 0xF) == 0x2) { // queued
-        if (!queued_to_running(slot_idx))
-          continue;
+    for (size_type w=0,offset=0; w<slot_masks; ++w,offset+=32) {
+      auto mask = slot_pending.get_mask(w) & ~slot_high.get_mask(w);
+      while (mask) {
+        auto slot_idx = offset + first_idx(mask);
+        mask &= mask-1;
+        if (process_slot(slot_idx))
+          slot_pending.clear(slot_idx);
       }
+    }
 
-      if (!cu_interrupt_enabled && ((slot.header_value & 0xF) == 0x3)) { // running
-        if (!running_to_free(slot_idx))
-          continue;
-      }
+    // No new completions in this pass, notify host of pending ones
+    if (notify_pending_count && notify_pending_count==notify_count) {
+      disable_interrupt_guard guard;
+      flush_notify();
     }
   } // while
 }
@@ -1203,8 +1633,8 @@ cu_interrupt_handler()
       ERT_DEBUGF("command queue interrupt from host: 0x%x\n",slot_mask);
       // Transition each new command into new state
       for (size_type slot_idx=offset; slot_mask; slot_mask >>= 1, ++slot_idx)
-        if (slot_mask & 0x1)
-          free_to_new(slot_idx);
+        if ((slot_mask & 0x1) && free_to_new(slot_idx))
+          slot_signaled[w] |= idx_to_mask(slot_idx,w);
     }
   }
 
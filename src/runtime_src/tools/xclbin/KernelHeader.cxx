@@ -0,0 +1,240 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "KernelHeader.h"
+#include "Section.h"
+
+#include <cctype>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <boost/filesystem.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+
+#include "XclBinUtilities.h"
+namespace XUtil = XclBinUtilities;
+
+namespace {
+
+// Address qualifiers of kernel arguments in the embedded metadata
+enum {
+  AQ_SCALAR = 0,
+  AQ_GLOBAL = 1,
+  AQ_CONSTANT = 2
+};
+
+uint64_t
+convert(const std::string& _sValue)
+{
+  return _sValue.empty() ? 0 : std::stoull(_sValue, 0, 0);
+}
+
+// Members of xrtcpp::regmap::kernel and the C++ keywords likely to be
+// used as argument names
+bool
+isReserved(const std::string& _sName)
+{
+  static const std::set<std::string> reserved = {
+    "arg_tuple", "arg_type", "arg_count", "regmap_size",
+    "auto", "bool", "break", "case", "char", "class", "const", "continue",
+    "default", "delete", "do", "double", "else", "enum", "float", "for",
+    "int", "long", "new", "operator", "private", "register", "return",
+    "short", "signed", "sizeof", "static", "struct", "switch", "template",
+    "this", "union", "unsigned", "void", "volatile", "while"
+  };
+  return reserved.count(_sName) != 0;
+}
+
+std::string
+toIdentifier(const std::string& _sName)
+{
+  std::string sIdentifier;
+  for (auto c : _sName)
+    sIdentifier += std::isalnum(static_cast<unsigned char>(c)) ? c : '_';
+  if (sIdentifier.empty() || std::isdigit(static_cast<unsigned char>(sIdentifier[0])))
+    sIdentifier = "_" + sIdentifier;
+  if (isReserved(sIdentifier))
+    sIdentifier += "_";
+  return sIdentifier;
+}
+
+// Host type of a scalar argument, by its OpenCL type if the sizes match
+std::string
+getScalarType(const std::string& _sType, uint64_t _size)
+{
+  static const std::map<std::string, std::pair<std::string, uint64_t>> types = {
+    { "char",           { "int8_t",   1 } },
+    { "uchar",          { "uint8_t",  1 } },
+    { "unsigned char",  { "uint8_t",  1 } },
+    { "short",          { "int16_t",  2 } },
+    { "ushort",         { "uint16_t", 2 } },
+    { "unsigned short", { "uint16_t", 2 } },
+    { "int",            { "int32_t",  4 } },
+    { "uint",           { "uint32_t", 4 } },
+    { "unsigned int",   { "uint32_t", 4 } },
+    { "unsigned",       { "uint32_t", 4 } },
+    { "long",           { "int64_t",  8 } },
+    { "long long",      { "int64_t",  8 } },
+    { "ulong",          { "uint64_t", 8 } },
+    { "unsigned long",  { "uint64_t", 8 } },
+    { "float",          { "float",    4 } },
+    { "double",         { "double",   8 } }
+  };
+
+  auto iter = types.find(_sType);
+  if (iter != types.end() && iter->second.second == _size)
+    return iter->second.first;
+
+  switch (_size) {
+    case 1: return "uint8_t";
+    case 2: return "uint16_t";
+    case 4: return "uint32_t";
+    case 8: return "uint64_t";
+  }
+  return XUtil::format("std::array<uint8_t,%ld>", _size).c_str();
+}
+
+// Descriptor of one argument, empty type for arguments without registers
+struct Argument {
+  std::string sName;
+  std::string sType;
+  std::string sHostType;
+  uint64_t offset;
+  uint64_t size;
+};
+
+void
+writeKernel(std::ostream& _ostream, const boost::property_tree::ptree& _ptKernel)
+{
+  std::string sKernel = _ptKernel.get<std::string>("<xmlattr>.name");
+
+  std::vector<Argument> arguments;
+  std::set<std::string> names;
+  for (auto& xmlArg : _ptKernel) {
+    if (xmlArg.first != "arg")
+      continue;
+
+    // Arguments without id are runtime info (e.g. work group size), not
+    // part of the kernel signature
+    if (xmlArg.second.get<std::string>("<xmlattr>.id", "").empty())
+      continue;
+
+    Argument argument;
+    argument.sName = toIdentifier(xmlArg.second.get<std::string>("<xmlattr>.name"));
+    if (!names.insert(argument.sName).second) {
+      argument.sName += XUtil::format("_%ld", arguments.size()).c_str();
+      names.insert(argument.sName);
+    }
+    argument.sType = xmlArg.second.get<std::string>("<xmlattr>.type", "");
+    argument.offset = convert(xmlArg.second.get<std::string>("<xmlattr>.offset", ""));
+    argument.size = convert(xmlArg.second.get<std::string>("<xmlattr>.size", ""));
+
+    auto addressQualifier = xmlArg.second.get<unsigned int>("<xmlattr>.addressQualifier", AQ_SCALAR);
+    if (addressQualifier == AQ_GLOBAL || addressQualifier == AQ_CONSTANT)
+      // Device address of the buffer
+      argument.sHostType = "uint64_t";
+    else if (addressQualifier == AQ_SCALAR && argument.size)
+      argument.sHostType = getScalarType(argument.sType, argument.size);
+
+    arguments.push_back(argument);
+  }
+
+  _ostream << "// " << sKernel << "(";
+  for (auto& argument : arguments) {
+    _ostream << argument.sType << " " << argument.sName;
+    if (&argument != &arguments.back())
+      _ostream << ", ";
+  }
+  _ostream << ")" << std::endl;
+
+  _ostream << "struct " << toIdentifier(sKernel) << " : xrtcpp::regmap::kernel<";
+  for (auto& argument : arguments) {
+    _ostream << std::endl << "  ";
+    if (argument.sHostType.empty())
+      _ostream << "xrtcpp::regmap::none";
+    else
+      _ostream << XUtil::format("xrtcpp::regmap::arg<%s,0x%lx,%ld>", argument.sHostType.c_str(), argument.offset, argument.size).c_str();
+    if (&argument != &arguments.back())
+      _ostream << ",";
+  }
+  _ostream << ">" << std::endl;
+
+  _ostream << "{" << std::endl;
+  for (unsigned int index = 0; index < arguments.size(); ++index)
+    _ostream << "  static constexpr std::size_t " << arguments[index].sName << " = " << index << ";" << std::endl;
+  _ostream << "};" << std::endl;
+}
+
+}
+
+void
+KernelHeader::write(std::ostream &_ostream,
+                    const std::string &_sInputFile,
+                    const std::vector<Section*> _sections)
+{
+  const Section* pMetadata = nullptr;
+  for (auto pSection : _sections) {
+    if (pSection->getSectionKind() == EMBEDDED_METADATA) {
+      pMetadata = pSection;
+      break;
+    }
+  }
+
+  if (pMetadata == nullptr) {
+    std::string errMsg = "ERROR: Missing EMBEDDED_METADATA section.  Kernel register maps are not available.";
+    throw std::runtime_error(errMsg);
+  }
+
+  boost::property_tree::ptree ptProject;
+  try {
+    std::stringstream xmlStream;
+    xmlStream.write(pMetadata->getBuffer(), pMetadata->getSize());
+    boost::property_tree::read_xml(xmlStream, ptProject);
+  } catch (const std::exception& e) {
+    std::string errMsg = std::string("ERROR: Unable to parse the EMBEDDED_METADATA section: ") + e.what();
+    throw std::runtime_error(errMsg);
+  }
+
+  std::string sSource = _sInputFile.empty() ? "xclbin" : boost::filesystem::path(_sInputFile).filename().string();
+  std::string sGuard = "xclbin_kernels_" + toIdentifier(boost::filesystem::path(sSource).stem().string()) + "_h_";
+
+  _ostream << "// Generated by xclbinutil from " << sSource << ", do not edit." << std::endl;
+  _ostream << "//" << std::endl;
+  _ostream << "// Register map descriptors of the kernels for" << std::endl;
+  _ostream << "// xrtcpp::exec::kernel_command, see experimental/xrtregmap.hpp." << std::endl;
+  _ostream << std::endl;
+  _ostream << "#ifndef " << sGuard << std::endl;
+  _ostream << "#define " << sGuard << std::endl;
+  _ostream << "#include \"experimental/xrtregmap.hpp\"" << std::endl;
+  _ostream << "#include <array>" << std::endl;
+  _ostream << "#include <cstdint>" << std::endl;
+  _ostream << std::endl;
+  _ostream << "namespace xclbin_kernels {" << std::endl;
+
+  boost::property_tree::ptree empty;
+  for (auto& xmlKernel : ptProject.get_child("project.platform.device.core", empty)) {
+    if (xmlKernel.first != "kernel")
+      continue;
+    _ostream << std::endl;
+    writeKernel(_ostream, xmlKernel.second);
+  }
+
+  _ostream << std::endl;
+  _ostream << "} // xclbin_kernels" << std::endl;
+  _ostream << "#endif" << std::endl;
+}
@@ -0,0 +1,37 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef __KernelHeader_h_
+#define __KernelHeader_h_
+
+// ----------------------- I N C L U D E S -----------------------------------
+#include <ostream>
+#include <string>
+#include <vector>
+
+// ------------ F O R W A R D - D E C L A R A T I O N S ----------------------
+class Section;
+
+// --------------- N A M E S P A C E :   K e r n e l H e a d e r -------------
+
+// Writes a C++ header with a register map descriptor of each kernel in
+// the EMBEDDED_METADATA section, for use with xrtcpp::exec::kernel_command
+// (experimental/xrtregmap.hpp).
+namespace KernelHeader {
+  void write(std::ostream &_ostream, const std::string &_sInputFile, const std::vector<Section*> _sections);
+}
+
+#endif
@@ -55,13 +55,31 @@ Section::~Section() {
 void
 Section::purgeBuffers()
 {
+  if (m_pFileImage) {
+    m_pFileImage.reset();
+    m_pBuffer = nullptr;
+  }
+
   if (m_pBuffer != nullptr) {
-    delete m_pBuffer;
+    delete[] m_pBuffer;
     m_pBuffer = nullptr;
   }
   m_bufferSize = 0;
 }
 
+void
+Section::detachFileImage()
+{
+  if (!m_pFileImage) {
+    return;
+  }
+
+  char* pBuffer = new char[m_bufferSize];
+  memcpy(pBuffer, m_pBuffer, m_bufferSize);
+  m_pBuffer = pBuffer;
+  m_pFileImage.reset();
+}
+
 void
 Section::setName(const std::string &_sSectionName)
 {
@@ -205,6 +223,11 @@ Section::getSize() const {
   return m_bufferSize;
 }
 
+const char*
+Section::getBuffer() const {
+  return m_pBuffer;
+}
+
 void
 Section::initXclBinSectionHeader(axlf_section_header& _sectionHeader) {
   _sectionHeader.m_sectionKind = m_eKind;
@@ -262,6 +285,39 @@ Section::readXclBinBinary(std::fstream& _istream, const axlf_section_header& _se
 }
 
 
+void
+Section::readXclBinBinary(const std::shared_ptr<char>& _pFileImage,
+                          uint64_t _fileSize,
+                          const axlf_section_header& _sectionHeader) {
+  // Some error checking
+  if ((enum axlf_section_kind)_sectionHeader.m_sectionKind != getSectionKind()) {
+    std::string errMsg = XUtil::format("ERROR: Unexpected section kind.  Expected: %d, Read: %d", getSectionKind(), _sectionHeader.m_sectionKind);
+    throw std::runtime_error(errMsg);
+  }
+
+  if (m_pBuffer != nullptr) {
+    std::string errMsg = "ERROR: Binary buffer already exists.";
+    throw std::runtime_error(errMsg);
+  }
+
+  m_name = (char*)&_sectionHeader.m_sectionName;
+
+  if ((_sectionHeader.m_sectionOffset > _fileSize) ||
+      (_sectionHeader.m_sectionSize > _fileSize - _sectionHeader.m_sectionOffset)) {
+    std::string errMsg = "ERROR: Input stream for the binary buffer is smaller then the expected size.";
+    throw std::runtime_error(errMsg);
+  }
+
+  // Reference the section in place, pages are only read when used
+  m_bufferSize = (unsigned int) _sectionHeader.m_sectionSize;
+  m_pFileImage = _pFileImage;
+  m_pBuffer = _pFileImage.get() + _sectionHeader.m_sectionOffset;
+
+  XUtil::TRACE(XUtil::format("Section: %s (%d)", getSectionKindAsString().c_str(), (unsigned int)getSectionKind()));
+  XUtil::TRACE(XUtil::format("  m_name: %s", m_name.c_str()));
+  XUtil::TRACE(XUtil::format("  m_size: %ld", m_bufferSize));
+}
+
 void 
 Section::readJSONSectionImage(const boost::property_tree::ptree& _ptSection)
 {
@@ -607,11 +663,7 @@ Section::readSubPayload(std::fstream& _istream,
   readSubPayload(m_pBuffer, m_bufferSize, _istream, _sSubSection, _eFormatType, buffer);
 
   // Now for some how cleaning
-  if (m_pBuffer != nullptr) {
-    delete m_pBuffer;
-    m_pBuffer = nullptr;
-    m_bufferSize = 0;
-  }
+  purgeBuffers();
 
   m_bufferSize = (unsigned int) buffer.tellp();
 
@@ -26,6 +26,7 @@
 #include <fstream>
 #include <map>
 #include <functional>
+#include <memory>
 #include <vector>
 
 #include <boost/property_tree/ptree.hpp>
@@ -71,11 +72,13 @@ class Section {
   const std::string& getSectionKindAsString() const;
   std::string getName() const;
   unsigned int getSize() const;
+  const char* getBuffer() const;
 
  public:
   // Xclbin Binary helper methods - child classes can override them if they choose
   virtual void readXclBinBinary(std::fstream& _istream, const struct axlf_section_header& _sectionHeader);
   virtual void readXclBinBinary(std::fstream& _istream, const boost::property_tree::ptree& _ptSection);
+  void readXclBinBinary(const std::shared_ptr<char>& _pFileImage, uint64_t _fileSize, const struct axlf_section_header& _sectionHeader);
   void readXclBinBinary(std::fstream& _istream, enum FormatType _eFormatType);
   void readJSONSectionImage(const boost::property_tree::ptree& _ptSection);
   void readPayload(std::fstream& _istream, enum FormatType _eFormatType);
@@ -91,6 +94,7 @@ class Section {
 
   void getPayload(boost::property_tree::ptree& _pt) const;
   void purgeBuffers();
+  void detachFileImage();
   void setName(const std::string &_sSectionName);
 
  protected:
@@ -116,6 +120,10 @@ class Section {
   unsigned int m_bufferSize;
   std::string m_name;
 
+  // When set, m_pBuffer points into this mapped input file instead of
+  // owning a heap buffer
+  std::shared_ptr<char> m_pFileImage;
+
  private:
   static std::map<enum axlf_section_kind, std::string> m_mapIdToName;
   static std::map<std::string, enum axlf_section_kind> m_mapNameToId;
@@ -19,20 +19,32 @@
 #include "Section.h"
 
 #include <stdexcept>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/algorithm/string.hpp>
 
 #include <boost/uuid/uuid.hpp>          // for uuid
 #include <boost/uuid/uuid_io.hpp>       // for to_string
 #include <boost/uuid/uuid_generators.hpp> // generators
+#include <boost/uuid/detail/sha1.hpp>
 #include <boost/filesystem.hpp>
 
 #include "XclBinUtilities.h"
 namespace XUtil = XclBinUtilities;
 
 #include "FormattedOutput.h"
+#include "KernelHeader.h"
 // Generated include files
 #include <version.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 static const std::string MIRROR_DATA_START = "XCLBIN_MIRROR_DATA_START";
 static const std::string MIRROR_DATA_END = "XCLBIN_MIRROR_DATA_END";
 
@@ -130,8 +142,43 @@ XclBin::readXclBinBinaryHeader(std::fstream& _istream) {
   }
 }
 
+// Maps the whole file copy-on-write, sections then reference it in place
+// instead of each reading its own copy. Returns nullptr when the file
+// cannot be mapped, the sections are then read from the stream.
+static std::shared_ptr<char>
+mapXclBinFile(const std::string& _fileName, uint64_t& _fileSize)
+{
+  _fileSize = 0;
+#ifdef _WIN32
+  return nullptr;
+#else
+  int fd = open(_fileName.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return nullptr;
+  }
+
+  struct stat sb;
+  if ((fstat(fd, &sb) != 0) || !S_ISREG(sb.st_mode) || (sb.st_size == 0)) {
+    close(fd);
+    return nullptr;
+  }
+
+  size_t size = (size_t) sb.st_size;
+  void* pImage = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (pImage == MAP_FAILED) {
+    return nullptr;
+  }
+
+  _fileSize = size;
+  return std::shared_ptr<char>((char*) pImage, [size](char* _pImage) { munmap(_pImage, size); });
+#endif
+}
+
 void
-XclBin::readXclBinBinarySections(std::fstream& _istream) {
+XclBin::readXclBinBinarySections(std::fstream& _istream,
+                                 const std::shared_ptr<char>& _pFileImage,
+                                 uint64_t _fileSize) {
   // Read in each section
   unsigned int numberOfSections = m_xclBinHeader.m_header.m_numSections;
 
@@ -156,7 +203,11 @@ XclBin::readXclBinBinarySections(std::fstream& _istream) {
 
     // Here for testing purposes, when all segments are supported it should be removed
     if (pSection != nullptr) {
-      pSection->readXclBinBinary(_istream, sectionHeader);
+      if (_pFileImage) {
+        pSection->readXclBinBinary(_pFileImage, _fileSize, sectionHeader);
+      } else {
+        pSection->readXclBinBinary(_istream, sectionHeader);
+      }
       addSection(pSection);
     }
   }
@@ -191,7 +242,12 @@ XclBin::readXclBinBinary(const std::string &_binaryFileName,
     readXclBinBinaryHeader(ifXclBin);
 
     // Read the sections
-    readXclBinBinarySections(ifXclBin);
+    uint64_t fileSize = 0;
+    std::shared_ptr<char> pFileImage = mapXclBinFile(_binaryFileName, fileSize);
+    if (pFileImage) {
+      m_mappedFileName = _binaryFileName;
+    }
+    readXclBinBinarySections(ifXclBin, pFileImage, fileSize);
   }
 
   ifXclBin.close();
@@ -345,15 +401,115 @@ XclBin::updateUUID() {
     XUtil::TRACE("Updated xclbin UUID");
 }
 
+// Section data is hashed in fixed size leaves so that large sections
+// (e.g. the bitstream) are spread across threads as well
+static const uint64_t UUID_HASH_LEAF_SIZE = 16 * 1024 * 1024;
+
+typedef boost::uuids::detail::sha1::digest_type Sha1Digest;
+
+static void
+sha1Update(boost::uuids::detail::sha1& _sha1, const void* _pData, uint64_t _size) {
+  _sha1.process_bytes(_pData, (size_t) _size);
+}
+
+void
+XclBin::updateUUIDFromContent() {
+  static_assert (sizeof(axlf_header::uuid) == 16, "ERROR: UUID size mismatch");
+
+  // Work items: one per leaf of every section
+  struct Leaf {
+    const char* pData;
+    uint64_t size;
+    Sha1Digest digest;
+  };
+  std::vector<Leaf> leaves;
+  std::vector<size_t> firstLeaf;   // Index of each section's first leaf
+  for (Section *pSection : m_sections) {
+    firstLeaf.push_back(leaves.size());
+    uint64_t size = pSection->getSize();
+    uint64_t offset = 0;
+    do {
+      Leaf leaf = { pSection->getBuffer() + offset, std::min(UUID_HASH_LEAF_SIZE, size - offset), {0} };
+      leaves.push_back(leaf);
+      offset += leaf.size;
+    } while (offset < size);
+  }
+  firstLeaf.push_back(leaves.size());
+
+  // Hash the leaves with a pool of workers
+  std::atomic<size_t> nextLeaf(0);
+  auto worker = [&leaves, &nextLeaf]() {
+    for (size_t index = nextLeaf++; index < leaves.size(); index = nextLeaf++) {
+      boost::uuids::detail::sha1 sha1;
+      if (leaves[index].size != 0) {
+        sha1Update(sha1, leaves[index].pData, leaves[index].size);
+      }
+      sha1.get_digest(leaves[index].digest);
+    }
+  };
+
+  unsigned int numWorkers = std::max(1u, std::min<unsigned int>(std::thread::hardware_concurrency(), (unsigned int) leaves.size()));
+  std::vector<std::thread> workers;
+  for (unsigned int index = 1; index < numWorkers; ++index) {
+    workers.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : workers) {
+    thread.join();
+  }
+
+  // Combine: section digest = H(kind, name, size, leaf digests),
+  // root digest = H(platform, mode, section digests)
+  boost::uuids::detail::sha1 rootSha1;
+  sha1Update(rootSha1, m_xclBinHeader.m_header.m_platformVBNV, sizeof(m_xclBinHeader.m_header.m_platformVBNV));
+  sha1Update(rootSha1, &m_xclBinHeader.m_header.m_mode, sizeof(m_xclBinHeader.m_header.m_mode));
+  for (unsigned int index = 0; index < m_sections.size(); ++index) {
+    boost::uuids::detail::sha1 sectionSha1;
+    uint32_t kind = (uint32_t) m_sections[index]->getSectionKind();
+    std::string name = m_sections[index]->getName();
+    uint64_t size = m_sections[index]->getSize();
+    sha1Update(sectionSha1, &kind, sizeof(kind));
+    sha1Update(sectionSha1, name.c_str(), name.size() + 1);
+    sha1Update(sectionSha1, &size, sizeof(size));
+    for (size_t leaf = firstLeaf[index]; leaf < firstLeaf[index + 1]; ++leaf) {
+      sha1Update(sectionSha1, leaves[leaf].digest, sizeof(Sha1Digest));
+    }
+    Sha1Digest sectionDigest;
+    sectionSha1.get_digest(sectionDigest);
+    sha1Update(rootSha1, sectionDigest, sizeof(Sha1Digest));
+  }
+  Sha1Digest rootDigest;
+  rootSha1.get_digest(rootDigest);
+
+  // Name based (version 5) UUID of the root digest
+  boost::uuids::name_generator_sha1 generator(boost::uuids::ns::oid());
+  boost::uuids::uuid uuid = generator(rootDigest, sizeof(Sha1Digest));
+
+  memcpy((void *) &m_xclBinHeader.m_header.uuid, (void *)&uuid, sizeof(axlf_header::uuid));
+  XUtil::TRACE("Updated xclbin UUID from its content");
+}
+
 void
 XclBin::writeXclBinBinary(const std::string &_binaryFileName, 
-                          bool _bSkipUUIDInsertion) {
+                          bool _bSkipUUIDInsertion,
+                          bool _bContentUUID) {
   // Error checks
   if (_binaryFileName.empty()) {
     std::string errMsg = "ERROR: Missing file name to write to.";
     throw std::runtime_error(errMsg);
   }
 
+  // Sections still referencing the mapped input file need their own copy
+  // before that file is truncated by being rewritten in place
+  if (!m_mappedFileName.empty() &&
+      boost::filesystem::exists(_binaryFileName) &&
+      boost::filesystem::equivalent(_binaryFileName, m_mappedFileName)) {
+    for (Section *pSection : m_sections) {
+      pSection->detachFileImage();
+    }
+    m_mappedFileName.clear();
+  }
+
   // Write the xclbin file image
   XUtil::TRACE("Writing the xclbin binary file: " + _binaryFileName);
   std::fstream ofXclBin;
@@ -365,6 +521,8 @@ XclBin::writeXclBinBinary(const std::string &_binaryFileName,
 
   if (_bSkipUUIDInsertion) {
     XUtil::TRACE("Skipping xclbin's UUID insertion.");
+  } else if (_bContentUUID) {
+    updateUUIDFromContent();
   } else {
     updateUUID();
   }
@@ -1432,5 +1590,11 @@ XclBin::reportInfo(std::ostream &_ostream, const std::string & _sInputFile, bool
   FormattedOutput::reportInfo(_ostream, _sInputFile, m_xclBinHeader, m_sections, _bVerbose);
 }
 
+void
+XclBin::writeKernelHeader(std::ostream &_ostream, const std::string & _sInputFile) const
+{
+  KernelHeader::write(_ostream, _sInputFile, m_sections);
+}
+
 
 
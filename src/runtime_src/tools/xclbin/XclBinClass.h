@@ -41,10 +41,11 @@ class XclBin {
 
  public:
   void reportInfo(std::ostream &_ostream, const std::string & _sInputFile, bool _bVerbose) const;
+  void writeKernelHeader(std::ostream &_ostream, const std::string & _sInputFile) const;
   void printSections(std::ostream &_ostream) const;
 
   void readXclBinBinary(const std::string &_binaryFileName, bool _bMigrate = false);
-  void writeXclBinBinary(const std::string &_binaryFileName, bool _bSkipUUIDInsertion);
+  void writeXclBinBinary(const std::string &_binaryFileName, bool _bSkipUUIDInsertion, bool _bContentUUID = false);
   void removeSection(const std::string & _sSectionToRemove);
   void addSection(ParameterSectionData &_PSD);
   void addSections(ParameterSectionData &_PSD);
@@ -61,7 +62,7 @@ class XclBin {
  private:
   void updateHeaderFromSection(Section *_pSection);
   void readXclBinBinaryHeader(std::fstream& _istream);
-  void readXclBinBinarySections(std::fstream& _istream);
+  void readXclBinBinarySections(std::fstream& _istream, const std::shared_ptr<char>& _pFileImage, uint64_t _fileSize);
 
   void findAndReadMirrorData(std::fstream& _istream, boost::property_tree::ptree& _mirrorData) const;
   void readXclBinaryMirrorImage(std::fstream& _istream, const boost::property_tree::ptree& _mirrorData);
@@ -77,6 +78,7 @@ class XclBin {
   void removeSection(const Section* _pSection);
 
   void updateUUID();
+  void updateUUIDFromContent();
 
   void initializeHeader(axlf &_xclBinHeader);
 
@@ -95,6 +97,7 @@ class XclBin {
  private:
   std::vector<Section*> m_sections;
   axlf m_xclBinHeader;
+  std::string m_mappedFileName;
 
  protected:
   SchemaVersion m_SchemaVersionMirrorWrite;
@@ -95,6 +95,7 @@ int main_(int argc, char** argv) {
   bool bListNames = false;
   std::string sInfoFile;
   bool bSkipUUIDInsertion = false;
+  bool bContentUUID = false;
   bool bVersion = false;
   bool bForce = false;   
 
@@ -104,6 +105,7 @@ int main_(int argc, char** argv) {
 
   std::string sInputFile;
   std::string sOutputFile;
+  std::string sKernelHeaderFile;
 
   std::vector<std::string> sectionsToReplace;
   std::vector<std::string> sectionsToAdd;
@@ -141,9 +143,11 @@ int main_(int argc, char** argv) {
       ("get-signature", boost::program_options::bool_switch(&bGetSignature), "Returns the user defined signature (if set) of the xclbin image.")
 
       ("info", boost::program_options::value<std::string>(&sInfoFile)->default_value("")->implicit_value("<console>"), "Report accelerator binary content.  Including: generation and packaging data, kernel signatures, connectivity, clocks, sections, etc.  Note: Optionally an output file can be specified.  If none is specified, then the output will go to the console.")
+      ("kernel-header", boost::program_options::value<std::string>(&sKernelHeaderFile), "Write a C++ header with the register map descriptors of the kernels, for typed kernel commands of xrt++ (experimental/xrtregmap.hpp).")
       ("list-names", boost::program_options::bool_switch(&bListNames), "List all possible section names (Stand Alone Option)")
       ("version", boost::program_options::bool_switch(&bVersion), "Version of this executable.")
       ("force", boost::program_options::bool_switch(&bForce), "Forces a file overwrite.")
+      ("content-uuid", boost::program_options::bool_switch(&bContentUUID), "Derive the xclbin's UUID from a digest of its sections instead of generating a random one.  Identical content yields the same UUID.")
  ;
 
 // --remove-section=section
@@ -294,6 +298,10 @@ int main_(int argc, char** argv) {
       ParameterSectionData psd(section);
       outputFiles.push_back(psd.getFile());
     }
+
+    if (!sKernelHeaderFile.empty()) {
+      outputFiles.push_back(sKernelHeaderFile);
+    }
   }
 
   drcCheckFiles(inputFiles, outputFiles, bForce);
@@ -401,7 +409,7 @@ int main_(int argc, char** argv) {
   }
 
   if (!sOutputFile.empty()) {
-    xclBin.writeXclBinBinary(sOutputFile, bSkipUUIDInsertion);
+    xclBin.writeXclBinBinary(sOutputFile, bSkipUUIDInsertion, bContentUUID);
   }
 
   if (!sInfoFile.empty()) {
@@ -419,6 +427,17 @@ int main_(int argc, char** argv) {
     }
   }
   
+  if (!sKernelHeaderFile.empty()) {
+    std::fstream oHeaderFile;
+    oHeaderFile.open(sKernelHeaderFile, std::ifstream::out | std::ifstream::binary);
+    if (!oHeaderFile.is_open()) {
+      std::string errMsg = "ERROR: Unable to open the kernel header file for writing: " + sKernelHeaderFile;
+      throw std::runtime_error(errMsg);
+    }
+    xclBin.writeKernelHeader(oHeaderFile, sInputFile);
+    oHeaderFile.close();
+  }
+
   QUIET("Leaving xclbinutil.");
 
   return RC_SUCCESS;
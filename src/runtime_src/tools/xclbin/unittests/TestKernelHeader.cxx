@@ -0,0 +1,27 @@
+#include <gtest/gtest.h>
+#include "XclBinClass.h"
+
+#include <sstream>
+#include <string>
+
+TEST(KernelHeader, WriteFromEmbeddedMetadata) {
+  XclBin xclBin;
+  xclBin.readXclBinBinary("unittests/test_data/sample_1_2018.2.xclbin", false /* bMigrateForward */);
+
+  std::ostringstream header;
+  xclBin.writeKernelHeader(header, "unittests/test_data/sample_1_2018.2.xclbin");
+  const std::string sHeader = header.str();
+
+  ASSERT_NE(sHeader.find("struct rtl_krnl_vadd_const : xrtcpp::regmap::kernel<"), std::string::npos) << sHeader;
+  ASSERT_NE(sHeader.find("xrtcpp::regmap::arg<uint32_t,0x10,4>"), std::string::npos) << sHeader;
+  ASSERT_NE(sHeader.find("xrtcpp::regmap::arg<uint32_t,0x18,4>"), std::string::npos) << sHeader;
+  ASSERT_NE(sHeader.find("xrtcpp::regmap::arg<uint64_t,0x20,8>"), std::string::npos) << sHeader;
+  ASSERT_NE(sHeader.find("static constexpr std::size_t a = 2;"), std::string::npos) << sHeader;
+}
+
+TEST(KernelHeader, MissingEmbeddedMetadata) {
+  XclBin xclBin;
+
+  std::ostringstream header;
+  ASSERT_THROW(xclBin.writeKernelHeader(header, ""), std::runtime_error);
+}
@@ -17,6 +17,7 @@
 #include "counters.h"
 #include "results.h"
 #include "xdp/profile/config.h"
+#include "xdp/profile/core/telemetry.h"
 #include "xdp/profile/device/trace_parser.h"
 #include "xdp/profile/writer/base_profile.h"
 #include "xdp/profile/writer/base_trace.h"
@@ -68,7 +69,8 @@ namespace xdp {
   ProfileCounters::ProfileCounters() :
     TopKernelTimes(), TopBufferReadTimes(), TopBufferWriteTimes(),
     TopKernelReadTimes(), TopKernelWriteTimes(),
-    TopDeviceBufferReadTimes(), TopDeviceBufferWriteTimes()
+    TopDeviceBufferReadTimes(), TopDeviceBufferWriteTimes(),
+    LiveTelemetry(nullptr)
   {
     // do nothing
   }
@@ -85,16 +87,30 @@ namespace xdp {
     BufferTransferStats[kind].log(size, duration);
     BufferTransferStats[kind].setContextId(contextId);
     BufferTransferStats[kind].setNumDevices(numDevices);
+
+    if (LiveTelemetry) {
+      bool isRead = (kind == RTUtil::READ_BUFFER || kind == RTUtil::READ_BUFFER_P2P);
+      bool isWrite = (kind == RTUtil::WRITE_BUFFER || kind == RTUtil::WRITE_BUFFER_P2P);
+      std::string name;
+      RTUtil::commandKindToString(kind, name);
+      LiveTelemetry->log(isRead ? telemetry::ENTRY_HOST_READ :
+                         (isWrite ? telemetry::ENTRY_HOST_WRITE : telemetry::ENTRY_HOST_COPY),
+                         name, duration, size);
+    }
   }
 
   void ProfileCounters::logDeviceRead(size_t size, double duration)
   {
     DeviceBufferReadStat.log(size, duration);
+    if (LiveTelemetry)
+      LiveTelemetry->log(telemetry::ENTRY_DEVICE_READ, "ALL", duration, size);
   }
 
   void ProfileCounters::logDeviceWrite(size_t size, double duration)
   {
     DeviceBufferWriteStat.log(size, duration);
+    if (LiveTelemetry)
+      LiveTelemetry->log(telemetry::ENTRY_DEVICE_WRITE, "ALL", duration, size);
   }
 
   void ProfileCounters::logDeviceKernel(size_t size, double duration)
@@ -112,32 +128,31 @@ namespace xdp {
       DeviceKernelReadSummaryStats[name].log(size, duration, bitWidth, clockFreqMhz);
     else
       DeviceKernelWriteSummaryStats[name].log(size, duration, bitWidth, clockFreqMhz);
-  }
-
-  void ProfileCounters::logFunctionCallStart(const std::string& functionName, double timePoint)
-  {
-    auto threadId = std::this_thread::get_id() ;
-    auto key      = std::make_pair(functionName, threadId) ;
-    auto value    = std::make_pair(timePoint, (double)0.0) ;
 
-    if (CallCount.find(key) == CallCount.end())
-    {
-      std::vector<std::pair<double, double>> newValue ;
-      newValue.push_back(value) ;
-      CallCount[key] = newValue ;
-    }
-    else
-    {
-      CallCount[key].push_back(value);
+    if (LiveTelemetry) {
+      LiveTelemetry->log(isRead ? telemetry::ENTRY_KERNEL_READ : telemetry::ENTRY_KERNEL_WRITE,
+                         deviceName + "|" + kernelName, duration, size);
     }
   }
 
-  void ProfileCounters::logFunctionCallEnd(const std::string& functionName, double timePoint)
+  void ProfileCounters::logFunctionCallStart(const std::string& functionName, double timePoint,
+                                             std::thread::id threadId)
   {
-    auto threadId = std::this_thread::get_id() ;
     auto key = std::make_pair(functionName, threadId) ;
+    OpenCalls[key].push_back(timePoint);
+  }
 
-    CallCount[key].back().second = timePoint ;
+  void ProfileCounters::logFunctionCallEnd(const std::string& functionName, double timePoint,
+                                           std::thread::id threadId)
+  {
+    auto iter = OpenCalls.find(std::make_pair(functionName, threadId));
+    if (iter == OpenCalls.end() || iter->second.empty())
+      return;
+
+    auto& stats = CallStats[functionName];
+    stats.logStart(iter->second.back());
+    stats.logEnd(timePoint);
+    iter->second.pop_back();
   }
 
   void ProfileCounters::logKernelExecutionStart(const std::string& kernelName, const std::string& deviceName,
@@ -155,7 +170,10 @@ namespace xdp {
   void ProfileCounters::logKernelExecutionEnd(const std::string& kernelName, const std::string& deviceName,
                                                  double timePoint)
   {
-    KernelExecutionStats[kernelName].logEnd(timePoint);
+    auto& stats = KernelExecutionStats[kernelName];
+    stats.logEnd(timePoint);
+    if (LiveTelemetry)
+      LiveTelemetry->log(telemetry::ENTRY_KERNEL, kernelName, stats.getLastTime());
 
     auto iter = DeviceEndTimes.find(deviceName);
     if (iter == DeviceEndTimes.end())
@@ -180,7 +198,10 @@ namespace xdp {
 
   void ProfileCounters::logComputeUnitExecutionEnd(const std::string& cuName, double timePoint)
   {
-    ComputeUnitExecutionStats[cuName].logEnd(timePoint);
+    auto& stats = ComputeUnitExecutionStats[cuName];
+    stats.logEnd(timePoint);
+    if (LiveTelemetry)
+      LiveTelemetry->log(telemetry::ENTRY_COMPUTE_UNIT, cuName, stats.getLastTime());
   }
 
   void ProfileCounters::logComputeUnitStats(const std::string& cuName, const std::string& kernelName,
@@ -412,6 +433,48 @@ namespace xdp {
     }
   }
 
+  void ProfileCounters::writeLatencySummary(ProfileWriterI* writer) const
+  {
+    for (const auto &pair : KernelExecutionStats) {
+      auto& histogram = pair.second.getHistogram();
+      if (histogram.getCount() > 0)
+        writer->writeLatencySummary("Kernel", pair.first.substr(0, pair.first.find_first_of("|")), histogram);
+    }
+
+    // Host view of compute unit executions
+    for (const auto &pair : ComputeUnitExecutionStats) {
+      auto& histogram = pair.second.getHistogram();
+      if (histogram.getCount() == 0)
+        continue;
+      //"name" is of the form "deviceName|kernelName|globalSize|localSize|cuName|objId"
+      auto name = pair.first.substr(0, pair.first.find_last_of("|"));
+      name = name.substr(0, name.find_first_of("|")) + "|" + name.substr(name.find_last_of("|") + 1);
+      writer->writeLatencySummary("Compute Unit", name, histogram);
+    }
+
+    for (const auto &pair : BufferTransferStats) {
+      auto& histogram = pair.second.getHistogram();
+      if (histogram.getCount() == 0)
+        continue;
+      std::string name;
+      RTUtil::commandKindToString(pair.first, name);
+      writer->writeLatencySummary("Host Transfer", name, histogram);
+    }
+
+    if (DeviceBufferReadStat.getHistogram().getCount() > 0)
+      writer->writeLatencySummary("Device Transfer", "READ", DeviceBufferReadStat.getHistogram());
+    if (DeviceBufferWriteStat.getHistogram().getCount() > 0)
+      writer->writeLatencySummary("Device Transfer", "WRITE", DeviceBufferWriteStat.getHistogram());
+    for (const auto &pair : DeviceKernelReadSummaryStats) {
+      if (pair.second.getHistogram().getCount() > 0)
+        writer->writeLatencySummary("Kernel Transfer", "READ", pair.second.getHistogram());
+    }
+    for (const auto &pair : DeviceKernelWriteSummaryStats) {
+      if (pair.second.getHistogram().getCount() > 0)
+        writer->writeLatencySummary("Kernel Transfer", "WRITE", pair.second.getHistogram());
+    }
+  }
+
   void ProfileCounters::writeComputeUnitSummary(ProfileWriterI* writer) const
   {
     for (const auto &pair : ComputeUnitExecutionStats) {
@@ -436,28 +499,13 @@ namespace xdp {
     using std::pair;
     using std::sort;
     using std::string;
-    
-    // Go through all of the call values and consolidate all of the
-    //  API calls from different threads into a single TimeStats object
-    std::map<std::string, TimeStats> consolidated ;
-    for (auto iter : CallCount)
-    {
-      auto functionName = iter.first.first ;
-      auto pairVector   = iter.second ;
-
-      for (unsigned int i = 0 ; i < pairVector.size() ; ++i)
-      {
-	auto doublePair = pairVector[i] ;
-	consolidated[functionName].logStart(doublePair.first) ;
-	consolidated[functionName].logEnd(doublePair.second) ;
-      }
-    }
 
     // Print it in sorted order of Total Time. To sort it by duration
     // populate a vector and then using lambda function sort it by duration
+    // NOTE: calls still in progress are not reported
 
-    vector<pair<string, TimeStats>> callPairs(consolidated.begin(),
-        consolidated.end());
+    vector<pair<string, TimeStats>> callPairs(CallStats.begin(),
+        CallStats.end());
     sort(callPairs.begin(), callPairs.end(),
         [](const pair<string, TimeStats>& A, const pair<string, TimeStats>& B) {
       return A.second.getTotalTime() > B.second.getTotalTime();
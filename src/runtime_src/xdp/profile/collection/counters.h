@@ -25,6 +25,7 @@
 #include <map>
 #include <list>
 #include <string>
+#include <thread>
 
 // Use this class to build run time user services functions
 // such as debugging and profiling
@@ -32,6 +33,7 @@
 namespace xdp {
   class ProfileWriterI;
   class TraceWriterI;
+  class Telemetry;
 
   // Sorted list that keeps top 10 most time taking (end - start) Kernel/Buffer Trace
   // A simple singly linked list where a linear search is done to ensure sorted
@@ -61,6 +63,8 @@ namespace xdp {
     void setAllDeviceBufferBitWidth(uint32_t bitWidth);
     void setAllDeviceKernelBitWidth(uint32_t bitWidth);
     void setAllDeviceClockFreqMhz(double clockFreqMhz);
+    // Also publish aggregates to live telemetry (nullptr turns it off)
+    void setTelemetry(Telemetry* telemetry) { LiveTelemetry = telemetry; }
 
     // Functions required by guidance
     double getDeviceStartTime(const std::string& deviceName) const;
@@ -77,8 +81,10 @@ namespace xdp {
     void logDeviceKernel(size_t size, double duration);
     void logDeviceKernelTransfer(std::string& deviceName, std::string& kernelName, size_t size, double duration,
                                  uint32_t bitWidth, double clockFreqMhz, bool isRead);
-    void logFunctionCallStart(const std::string& functionName, double timePoint);
-    void logFunctionCallEnd(const std::string& functionName, double timePoint);
+    void logFunctionCallStart(const std::string& functionName, double timePoint,
+                              std::thread::id threadId = std::this_thread::get_id());
+    void logFunctionCallEnd(const std::string& functionName, double timePoint,
+                            std::thread::id threadId = std::this_thread::get_id());
     void logKernelExecutionStart(const std::string& kernelName, const std::string& deviceName, double timePoint);
     void logKernelExecutionEnd(const std::string& kernelName, const std::string& deviceName, double timePoint);
     void logComputeUnitDeviceStart(const std::string& deviceName, double timePoint);
@@ -101,6 +107,7 @@ namespace xdp {
     // Profile summary writers
     void writeAPISummary(ProfileWriterI* writer) const;
     void writeKernelSummary(ProfileWriterI* writer) const;
+    void writeLatencySummary(ProfileWriterI* writer) const;
     void writeComputeUnitSummary(ProfileWriterI* writer) const;
     void writeTopKernelTransferSummary(
         ProfileWriterI* writer, std::string &deviceName, std::string &cuName,
@@ -137,10 +144,12 @@ namespace xdp {
     std::map<std::string, double> DeviceStartTimes;
     std::map<std::string, double> DeviceEndTimes;
 
-    // For every API function called in every thread, keep track
-    //  of the start and stop time.
+    // Start times of API calls in progress, per function and thread.
+    // Completed calls are folded into CallStats, so memory does not
+    // grow with the number of calls.
     std::map<std::pair<std::string, std::thread::id>,
-             std::vector<std::pair<double, double>>> CallCount;
+             std::vector<double>> OpenCalls;
+    std::map<std::string, TimeStats> CallStats;
 
     std::map<std::string, TimeStats> KernelExecutionStats;
     std::map<std::string, TimeStats> ComputeUnitExecutionStats;
@@ -153,6 +162,7 @@ namespace xdp {
     TimeTraceSortedTopUsage<DeviceTrace> TopKernelWriteTimes;
     TimeTraceSortedTopUsage<DeviceTrace> TopDeviceBufferReadTimes;
     TimeTraceSortedTopUsage<DeviceTrace> TopDeviceBufferWriteTimes;
+    Telemetry* LiveTelemetry;
   };
 
 } // xdp
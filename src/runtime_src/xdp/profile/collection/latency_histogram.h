@@ -0,0 +1,148 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#ifndef __XDP_COLLECTION_LATENCY_HISTOGRAM_H
+#define __XDP_COLLECTION_LATENCY_HISTOGRAM_H
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace xdp {
+
+  // **************************************************************************
+  // Log-linear latency histogram
+  // **************************************************************************
+  // Values (nsec) below SUB_BUCKETS have a bucket each. Above that every
+  // power of two is split into SUB_BUCKETS linear buckets, so a bucket is
+  // never wider than 1/SUB_BUCKETS of its values. Values of 2^MAX_VALUE_BITS
+  // and more go to the last bucket. Recording is constant time and
+  // histograms merge by adding counts.
+  //
+  // Only depends on the standard library since the bucket layout is shared
+  // with the live telemetry readers.
+  class LatencyHistogram {
+  public:
+    static const uint32_t SUB_BUCKET_BITS = 4;
+    static const uint32_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const uint32_t MAX_VALUE_BITS = 40;
+    static const uint32_t NUM_BUCKETS = SUB_BUCKETS * (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1);
+
+    LatencyHistogram()
+      : TotalCount( 0 ),
+        MaxValue( 0 )
+      {};
+
+  public:
+    static uint32_t getBucket(uint64_t value)
+    {
+      if (value < SUB_BUCKETS)
+        return static_cast<uint32_t>(value);
+
+      uint32_t msb = getMostSignificantBit(value);
+      if (msb >= MAX_VALUE_BITS)
+        return NUM_BUCKETS - 1;
+      uint32_t shift = msb - SUB_BUCKET_BITS;
+      return (shift + 1) * SUB_BUCKETS
+             + static_cast<uint32_t>((value >> shift) & (SUB_BUCKETS - 1));
+    }
+
+    // Profile times are in msec, histograms are in nsec
+    static uint64_t msecToNsec(double msec)
+    {
+      return (msec > 0.0) ? static_cast<uint64_t>(std::llround(msec * 1.0e6)) : 0;
+    }
+
+    // Highest value that goes to the bucket
+    static uint64_t getBucketMaxValue(uint32_t bucket)
+    {
+      if (bucket < SUB_BUCKETS)
+        return bucket;
+      uint32_t shift = bucket / SUB_BUCKETS - 1;
+      uint64_t low = static_cast<uint64_t>(SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+      return low + (static_cast<uint64_t>(1) << shift) - 1;
+    }
+
+    void record(uint64_t value)
+    {
+      if (Counts.empty())
+        Counts.assign(static_cast<size_t>(NUM_BUCKETS), 0);
+      Counts[getBucket(value)]++;
+      TotalCount++;
+      if (MaxValue < value)
+        MaxValue = value;
+    }
+
+    void merge(const LatencyHistogram& other)
+    {
+      if (other.Counts.empty())
+        return;
+      if (Counts.empty())
+        Counts.assign(static_cast<size_t>(NUM_BUCKETS), 0);
+      for (uint32_t i = 0; i < NUM_BUCKETS; ++i)
+        Counts[i] += other.Counts[i];
+      TotalCount += other.TotalCount;
+      if (MaxValue < other.MaxValue)
+        MaxValue = other.MaxValue;
+    }
+
+    // Smallest recorded value such that percentile % of the values are at
+    // most that value, to within the bucket width. 0 if nothing is recorded.
+    uint64_t getValueAtPercentile(double percentile) const
+    {
+      if (TotalCount == 0)
+        return 0;
+      uint64_t target = static_cast<uint64_t>(std::ceil(percentile / 100.0 * TotalCount));
+      if (target == 0)
+        target = 1;
+
+      uint64_t count = 0;
+      for (uint32_t i = 0; i < NUM_BUCKETS; ++i) {
+        count += Counts[i];
+        if (count >= target) {
+          uint64_t value = getBucketMaxValue(i);
+          return (value < MaxValue) ? value : MaxValue;
+        }
+      }
+      return MaxValue;
+    }
+
+    inline uint64_t getCount() const { return TotalCount; }
+    inline uint64_t getMaxValue() const { return MaxValue; }
+
+  private:
+    static uint32_t getMostSignificantBit(uint64_t value)
+    {
+      uint32_t msb = 0;
+      for (uint32_t shift = 32; shift > 0; shift >>= 1) {
+        if (value >> shift) {
+          value >>= shift;
+          msb += shift;
+        }
+      }
+      return msb;
+    }
+
+  private:
+    std::vector<uint64_t> Counts;
+    uint64_t TotalCount;
+    uint64_t MaxValue;
+  };
+
+} // xdp
+
+#endif
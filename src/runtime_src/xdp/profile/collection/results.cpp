@@ -52,6 +52,7 @@ namespace xdp {
       Max = size;
     if(Min > size)
       Min = size;
+    Histogram.record(LatencyHistogram::msecToNsec(duration));
   };
 
   void BufferStats::log(size_t size, double duration, uint32_t bitWidth, double clockFreqMhz) {
@@ -76,6 +77,7 @@ namespace xdp {
     TotalTime += time;
     AveTime = (AveTime * NoOfCalls + time) / (NoOfCalls + 1);
     NoOfCalls++;
+    Histogram.record(LatencyHistogram::msecToNsec(time));
     if (MaxTime < time)
       MaxTime = time;
     if (MinTime > time)
@@ -101,6 +103,14 @@ namespace xdp {
     Flags = flags;
   }
 
+  void RatioStats::log(double ratio)
+  {
+    TotalRatio += ratio;
+    NoOfSamples++;
+    if (MaxRatio < ratio)
+      MaxRatio = ratio;
+  }
+
   //
   // Kernel Trace
   //
@@ -29,6 +29,8 @@
 #include <mutex>
 #include <CL/opencl.h>
 
+#include "latency_histogram.h"
+
 // Use these classes to store results from run time user
 // services functions such as debugging and profiling
 
@@ -78,6 +80,8 @@ namespace xdp {
       return ((100.0 * transferRateMBps) / maxTransferRateMBps);
     }
     inline double getClockFreqMhz() const { return ClockFreqMhz; }
+    // Transfer times, see LatencyHistogram
+    inline const LatencyHistogram& getHistogram() const { return Histogram; }
     inline std::string getDeviceName() const { return DeviceName; }
 
     inline void setContextId(uint32_t contextId) { ContextId = contextId; }
@@ -100,6 +104,7 @@ namespace xdp {
     // Unit: MB/s
     double AveTransferRate;
     double ClockFreqMhz;
+    LatencyHistogram Histogram;
     std::string DeviceName;
   };
 
@@ -131,10 +136,13 @@ namespace xdp {
     inline double getAveTime() const { return AveTime; }
     inline double getMaxTime() const { return MaxTime; }
     inline double getMinTime() const { return MinTime; }
+    inline double getLastTime() const { return EndTime - StartTime; }
     inline uint32_t getFlags() const { return Flags; }
     inline uint32_t getNoOfCalls() const { return NoOfCalls; }
     inline uint32_t getClockFreqMhz() const { return ClockFreqMhz; }
     inline uint64_t getMetadata() const { return StatMetadata; }
+    // Times of logStart/logEnd pairs, see LatencyHistogram
+    inline const LatencyHistogram& getHistogram() const { return Histogram; }
   private:
     double TotalTime;
     double StartTime;
@@ -146,6 +154,29 @@ namespace xdp {
     uint32_t Flags;
     uint32_t ClockFreqMhz;
     uint64_t StatMetadata;
+    LatencyHistogram Histogram;
+  };
+
+  // Class to record a ratio sampled at every read of the device counters,
+  // such as the share of a compute unit's run time stalled on memory
+  // All stored ratios are in percent
+  class RatioStats {
+  public:
+    RatioStats()
+      : TotalRatio( 0 ),
+        MaxRatio( 0 ),
+        NoOfSamples( 0 )
+      {};
+    ~RatioStats() {};
+  public:
+    void log(double ratio);
+    inline uint32_t getNoOfSamples() const { return NoOfSamples; }
+    inline double getAveRatio() const { return NoOfSamples ? (TotalRatio / NoOfSamples) : 0.0; }
+    inline double getMaxRatio() const { return MaxRatio; }
+  private:
+    double TotalRatio;
+    double MaxRatio;
+    uint32_t NoOfSamples;
   };
 
   // Class to store time trace of kernel execution, buffer read, or buffer write
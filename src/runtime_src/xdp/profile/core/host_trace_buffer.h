@@ -0,0 +1,139 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef __XDP_CORE_HOST_TRACE_BUFFER_H
+#define __XDP_CORE_HOST_TRACE_BUFFER_H
+
+#include "rt_util.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace xdp {
+
+  // **************************************************************************
+  // Fixed size record of a host trace event
+  // **************************************************************************
+  // Everything needed to log the event later, without string formatting.
+  // Strings that are not static (banks, event and dependency strings) are
+  // copied inline, events whose strings do not fit are logged synchronously.
+  struct HostTraceRecord {
+    enum e_record_kind : uint8_t {
+      FUNCTION_START,
+      FUNCTION_END,
+      DATA_TRANSFER,
+      DEPENDENCY
+    };
+
+    static const size_t BANK_CHARS = 32;
+    static const size_t EVENT_CHARS = 64;
+
+    e_record_kind Kind;
+    RTUtil::e_profile_command_kind CommandKind;
+    RTUtil::e_profile_command_state CommandStage;
+    double TimeStamp;
+
+    // Function calls (name points to __func__ of the API)
+    const char* FunctionName;
+    long long QueueAddress;
+    unsigned int FunctionID;
+
+    // Data transfers
+    uint64_t ObjId;
+    size_t Size;
+    uint32_t ContextId;
+    uint32_t NumDevices;
+    uint32_t CommandQueueId;
+    uint64_t SrcAddress;
+    uint64_t DstAddress;
+    std::thread::id ThreadId;
+    char SrcBank[BANK_CHARS];
+    char DstBank[BANK_CHARS];
+
+    // Data transfers and dependencies
+    char EventString[EVENT_CHARS];
+    char DependString[EVENT_CHARS];
+
+    static bool fits(const std::string& str, size_t chars) {
+      return str.size() < chars;
+    }
+    static void copy(char* dst, const std::string& src) {
+      std::memcpy(dst, src.c_str(), src.size() + 1);
+    }
+  };
+
+  // **************************************************************************
+  // Single producer, single consumer ring of host trace records
+  // **************************************************************************
+  // Each application thread owns one buffer and is its only producer. The
+  // consumer is whoever holds the logger lock while draining, so reserving
+  // and committing a record takes no lock.
+  class HostTraceBuffer {
+  public:
+    static const size_t CAPACITY = 2048;
+
+    explicit HostTraceBuffer(std::thread::id owner)
+    : mOwner(owner),
+      mRecords(CAPACITY),
+      mHead(0),
+      mTail(0)
+    {
+    }
+
+  public:
+    // Producer: next free record or nullptr if the buffer is full
+    HostTraceRecord* reserve()
+    {
+      size_t head = mHead.load(std::memory_order_relaxed);
+      if (head - mTail.load(std::memory_order_acquire) >= CAPACITY)
+        return nullptr;
+      return &mRecords[head % CAPACITY];
+    }
+
+    // Producer: publish the record returned by reserve
+    void commit()
+    {
+      mHead.store(mHead.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Consumer: hand all published records to f in order
+    template <typename F>
+    size_t drain(F f)
+    {
+      size_t tail = mTail.load(std::memory_order_relaxed);
+      size_t head = mHead.load(std::memory_order_acquire);
+      for (size_t i = tail; i < head; ++i)
+        f(mRecords[i % CAPACITY]);
+      mTail.store(head, std::memory_order_release);
+      return head - tail;
+    }
+
+    std::thread::id getOwner() const { return mOwner; }
+
+  private:
+    std::thread::id mOwner;
+    std::vector<HostTraceRecord> mRecords;
+    std::atomic<size_t> mHead;
+    std::atomic<size_t> mTail;
+  };
+
+} // xdp
+
+#endif
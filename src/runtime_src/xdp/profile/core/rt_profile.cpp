@@ -18,6 +18,7 @@
 #include "rt_util.h"
 #include "trace_logger.h"
 #include "summary_writer.h"
+#include "telemetry.h"
 #include "xdp/profile/config.h"
 #include "xdp/profile/collection/results.h"
 #include "xdp/profile/collection/counters.h"
@@ -68,6 +69,7 @@ namespace xdp {
     delete mLogger;
     delete mTraceParser;
     delete mProfileCounters;
+    delete mTelemetry;
     delete mRunSummary;
   }
 
@@ -114,6 +116,21 @@ namespace xdp {
     }
   }
 
+  void RTProfile::enableLiveTelemetry()
+  {
+    if (mTelemetry)
+      return;
+
+    try {
+      mTelemetry = new Telemetry(mPluginHandle.get());
+    }
+    catch (const std::runtime_error& ex) {
+      mPluginHandle->sendMessage(std::string(ex.what()) + ". Live telemetry will not be available.");
+      return;
+    }
+    mProfileCounters->setTelemetry(mTelemetry);
+  }
+
   bool RTProfile::isDeviceProfileOn() const
   {
     // Device profiling is not valid in cpu flow or old emulation flow
@@ -226,6 +243,8 @@ namespace xdp {
     if (!isApplicationProfileOn())
       return;
 
+    // Summary includes host events still buffered
+    mLogger->flush();
     mWriter->writeProfileSummary(this);
   }
 
@@ -316,10 +335,19 @@ namespace xdp {
   {
     mWriter->writeKernelSummary(writer);
   }
+
+  void RTProfile::writeLatencySummary(ProfileWriterI* writer) const
+  {
+    mWriter->writeLatencySummary(writer);
+  }
   void RTProfile::writeStallSummary(ProfileWriterI* writer) const
   {
     mWriter->writeStallSummary(writer);
   }
+  void RTProfile::writeStallSampleSummary(ProfileWriterI* writer) const
+  {
+    mWriter->writeStallSampleSummary(writer);
+  }
   void RTProfile::writeKernelStreamSummary(ProfileWriterI* writer)
   {
     mWriter->writeKernelStreamSummary(writer);
@@ -38,6 +38,7 @@ namespace xdp {
   class TraceWriterI;
   class TraceParser;
   class ProfileCounters;
+  class Telemetry;
 
   // **************************************************************************
   // Top-level profile class
@@ -57,6 +58,8 @@ namespace xdp {
     bool isApplicationProfileOn() const { return mProfileFlags & RTUtil::PROFILE_APPLICATION; }
     void setTransferTrace(const std::string traceStr);
     void setStallTrace(const std::string traceStr);
+    // Publish running aggregates to shared memory, call before logging starts
+    void enableLiveTelemetry();
     RTUtil::e_device_trace getTransferTrace() { return mDeviceTraceOption; }
     RTUtil::e_stall_trace getStallTrace() { return mStallTraceOption; }
     RunSummary * getRunSummary() { return mRunSummary; }
@@ -102,7 +105,9 @@ namespace xdp {
     // External access to writer
     void writeAPISummary(ProfileWriterI* writer) const;
     void writeKernelSummary(ProfileWriterI* writer) const;
+    void writeLatencySummary(ProfileWriterI* writer) const;
     void writeStallSummary(ProfileWriterI* writer) const;
+    void writeStallSampleSummary(ProfileWriterI* writer) const;
     void writeKernelStreamSummary(ProfileWriterI* writer);
     void writeComputeUnitSummary(ProfileWriterI* writer) const;
     void writeTransferSummary(ProfileWriterI* writer, RTUtil::e_monitor_type monitorType) const;
@@ -158,6 +163,7 @@ namespace xdp {
     RTUtil::e_stall_trace mStallTraceOption;
     bool mLoggingTrace[XCL_PERF_MON_TOTAL_PROFILE] = {false};
     ProfileCounters* mProfileCounters = nullptr;
+    Telemetry* mTelemetry = nullptr;
     TraceParser* mTraceParser;
     TraceLogger* mLogger;
     SummaryWriter* mWriter;
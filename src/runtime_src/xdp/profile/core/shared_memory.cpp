@@ -0,0 +1,80 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include "shared_memory.h"
+
+#include <cctype>
+#include <stdexcept>
+
+#ifndef _WINDOWS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace xdp {
+
+  SharedMemory::SharedMemory(const std::string& name, size_t size)
+  : mName(name),
+    mSize(size),
+    mAddress(nullptr)
+  {
+#ifdef _WINDOWS
+    throw std::runtime_error("Shared memory export is not supported on this platform");
+#else
+    // Replace a segment left behind by a process that died with our pid
+    shm_unlink(mName.c_str());
+    int fd = shm_open(mName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0)
+      throw std::runtime_error("Unable to create shared memory " + mName);
+
+    void* addr = MAP_FAILED;
+    if (ftruncate(fd, mSize) == 0)
+      addr = mmap(nullptr, mSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+      shm_unlink(mName.c_str());
+      throw std::runtime_error("Unable to map shared memory " + mName);
+    }
+    mAddress = addr;
+#endif
+  }
+
+  SharedMemory::~SharedMemory()
+  {
+#ifndef _WINDOWS
+    if (mAddress) {
+      munmap(mAddress, mSize);
+      shm_unlink(mName.c_str());
+    }
+#endif
+  }
+
+  std::string SharedMemory::makeName(const std::string& base, const std::string& id)
+  {
+    std::string name = "/" + base + "_";
+#ifndef _WINDOWS
+    name += std::to_string(getpid());
+#endif
+    if (!id.empty())
+      name += "_";
+    for (char c : id)
+      name += std::isalnum(static_cast<unsigned char>(c)) ? c : '_';
+    return name;
+  }
+
+} // xdp
@@ -0,0 +1,56 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#ifndef __XDP_CORE_SHARED_MEMORY_H
+#define __XDP_CORE_SHARED_MEMORY_H
+
+#include <cstddef>
+#include <string>
+
+namespace xdp {
+
+  // **************************************************************************
+  // Named shared memory segment
+  // **************************************************************************
+  // Created and zero filled by the profiled application so that external
+  // collectors can map it read only while the application runs. The name
+  // is removed again when the segment is destroyed.
+  class SharedMemory {
+  public:
+    SharedMemory(const std::string& name, size_t size);
+    ~SharedMemory();
+
+    SharedMemory(const SharedMemory&) = delete;
+    SharedMemory& operator=(const SharedMemory&) = delete;
+
+  public:
+    void* get() const { return mAddress; }
+    size_t getSize() const { return mSize; }
+    const std::string& getName() const { return mName; }
+
+    // Segment name unique to this process, derived from base and id
+    static std::string makeName(const std::string& base, const std::string& id);
+
+  private:
+    std::string mName;
+    size_t mSize;
+    void* mAddress;
+  };
+
+} // xdp
+
+#endif
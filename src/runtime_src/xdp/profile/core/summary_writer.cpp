@@ -187,6 +187,8 @@ namespace xdp {
         if (!deviceDataExists)
           mDeviceBinaryStrSlotsMap[key].push_back(slotName);
       }
+      if (!firstReadAfterProgram)
+        logStallSamples(key, deviceName, mFinalCounterResultsMap[key], counterResults);
       mFinalCounterResultsMap[key] = counterResults;
     }
     /*
@@ -261,6 +263,11 @@ namespace xdp {
     mProfileCounters->writeKernelSummary(writer);
   }
 
+  void SummaryWriter::writeLatencySummary(ProfileWriterI* writer) const
+  {
+    mProfileCounters->writeLatencySummary(writer);
+  }
+
   void SummaryWriter::writeComputeUnitSummary(ProfileWriterI* writer) const
   {
     mProfileCounters->writeComputeUnitSummary(writer);
@@ -441,6 +448,84 @@ namespace xdp {
     }
   }
 
+  // Stall breakdown over the intervals between counter reads. Intervals
+  // where a slot was idle or a counter rolled over are skipped.
+  void SummaryWriter::logStallSamples(const std::string& key, std::string deviceName,
+      const xclCounterResults& previous, const xclCounterResults& current)
+  {
+    auto ratio = [](unsigned long long cycles, unsigned long long totalCycles) {
+      return std::min(100.0, 100.0 * cycles / totalCycles);
+    };
+
+    uint32_t numSlots = mPluginHandle->getProfileNumberSlots(XCL_PERF_MON_ACCEL, deviceName);
+    auto& cuRatios = mCuStallRatiosMap[key];
+    cuRatios.resize(numSlots);
+    for (unsigned int s=0; s < numSlots; ++s) {
+      if (current.CuExecCycles[s] <= previous.CuExecCycles[s]
+          || current.CuStallIntCycles[s] < previous.CuStallIntCycles[s]
+          || current.CuStallExtCycles[s] < previous.CuStallExtCycles[s]
+          || current.CuStallStrCycles[s] < previous.CuStallStrCycles[s])
+        continue;
+      auto execCycles = current.CuExecCycles[s] - previous.CuExecCycles[s];
+      cuRatios[s][0].log(ratio(current.CuStallIntCycles[s] - previous.CuStallIntCycles[s], execCycles));
+      cuRatios[s][1].log(ratio(current.CuStallExtCycles[s] - previous.CuStallExtCycles[s], execCycles));
+      cuRatios[s][2].log(ratio(current.CuStallStrCycles[s] - previous.CuStallStrCycles[s], execCycles));
+    }
+
+    numSlots = mPluginHandle->getProfileNumberSlots(XCL_PERF_MON_STR, deviceName);
+    auto& strRatios = mStrStallRatiosMap[key];
+    strRatios.resize(numSlots);
+    for (unsigned int s=0; s < numSlots; ++s) {
+      if (current.StrBusyCycles[s] <= previous.StrBusyCycles[s]
+          || current.StrStallCycles[s] < previous.StrStallCycles[s]
+          || current.StrStarveCycles[s] < previous.StrStarveCycles[s])
+        continue;
+      auto busyCycles = current.StrBusyCycles[s] - previous.StrBusyCycles[s];
+      strRatios[s][0].log(ratio(current.StrStallCycles[s] - previous.StrStallCycles[s], busyCycles));
+      strRatios[s][1].log(ratio(current.StrStarveCycles[s] - previous.StrStarveCycles[s], busyCycles));
+    }
+  }
+
+  void SummaryWriter::writeStallSampleSummary(ProfileWriterI* writer) const
+  {
+    static const std::string cuStallTypes[] = {
+      "Intra-Kernel Dataflow Stall", "External Memory Stall", "Inter-Kernel Pipe Stall"
+    };
+    static const std::string strStallTypes[] = {"Stream Stall", "Stream Starve"};
+
+    for (auto& cuRatios : mCuStallRatiosMap) {
+      std::string key = cuRatios.first;
+      std::string deviceName = key.substr(0, key.find_first_of("|"));
+      auto cuNames = mDeviceBinaryCuSlotsMap.find(key);
+      if (cuNames == mDeviceBinaryCuSlotsMap.end())
+        continue;
+
+      for (unsigned int s=0; s < cuRatios.second.size() && s < cuNames->second.size(); ++s) {
+        for (unsigned int t=0; t < cuRatios.second[s].size(); ++t) {
+          if (cuRatios.second[s][t].getNoOfSamples() > 0)
+            writer->writeStallSampleSummary(deviceName, cuNames->second[s], cuStallTypes[t],
+                                            cuRatios.second[s][t]);
+        }
+      }
+    }
+
+    for (auto& strRatios : mStrStallRatiosMap) {
+      std::string key = strRatios.first;
+      std::string deviceName = key.substr(0, key.find_first_of("|"));
+      auto portNames = mDeviceBinaryStrSlotsMap.find(key);
+      if (portNames == mDeviceBinaryStrSlotsMap.end())
+        continue;
+
+      for (unsigned int s=0; s < strRatios.second.size() && s < portNames->second.size(); ++s) {
+        for (unsigned int t=0; t < strRatios.second[s].size(); ++t) {
+          if (strRatios.second[s][t].getNoOfSamples() > 0)
+            writer->writeStallSampleSummary(deviceName, portNames->second[s], strStallTypes[t],
+                                            strRatios.second[s][t]);
+        }
+      }
+    }
+  }
+
   void SummaryWriter::writeKernelStreamSummary(ProfileWriterI* writer)
   {
     auto iter = mFinalCounterResultsMap.begin();
@@ -21,7 +21,9 @@
 #include "xclperf.h"
 #include "xdp/profile/plugin/base_plugin.h"
 #include "xdp/profile/device/trace_parser.h"
+#include "xdp/profile/collection/results.h"
 
+#include <array>
 #include <map>
 #include <vector>
 #include <string>
@@ -57,7 +59,9 @@ namespace xdp {
     // Summaries of counts
     void writeAPISummary(ProfileWriterI* writer) const;
     void writeKernelSummary(ProfileWriterI* writer) const;
+    void writeLatencySummary(ProfileWriterI* writer) const;
     void writeStallSummary(ProfileWriterI* writer) const;
+    void writeStallSampleSummary(ProfileWriterI* writer) const;
     void writeKernelStreamSummary(ProfileWriterI* writer);
     void writeComputeUnitSummary(ProfileWriterI* writer) const;
     void writeTransferSummary(ProfileWriterI* writer, RTUtil::e_monitor_type monitorType) const;
@@ -84,6 +88,10 @@ namespace xdp {
     std::map<std::string, std::vector<unsigned>> mDataSlotsPropertiesMap;
     std::map<std::string, std::vector<std::string>> mDeviceBinaryCuSlotsMap;
     std::map<std::string, std::vector<std::string>> mDeviceBinaryStrSlotsMap;
+    // Stall ratios between consecutive counter reads, per compute unit
+    // (dataflow, memory, pipe) and per stream (stall, starve)
+    std::map<std::string, std::vector<std::array<RatioStats, 3>>> mCuStallRatiosMap;
+    std::map<std::string, std::vector<std::array<RatioStats, 2>>> mStrStallRatiosMap;
 
   private:
     TraceParser * mTraceParserHandle;
@@ -91,6 +99,8 @@ namespace xdp {
 
   private:
     double getGlobalMemoryMaxBandwidthMBps() const;
+    void logStallSamples(const std::string& key, std::string deviceName,
+        const xclCounterResults& previous, const xclCounterResults& current);
   };
 
 } // xdp
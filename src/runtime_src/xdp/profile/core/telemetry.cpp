@@ -0,0 +1,114 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include "telemetry.h"
+#include "shared_memory.h"
+#include "xdp/profile/plugin/base_plugin.h"
+
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <new>
+
+#ifndef _WINDOWS
+#include <unistd.h>
+#endif
+
+namespace xdp {
+
+  Telemetry::Telemetry(XDPPluginI* Plugin)
+  : mSegment(nullptr),
+    mFullWarned(false),
+    mPluginHandle(Plugin)
+  {
+    // Throws if the segment cannot be created
+    mMemory.reset(new SharedMemory(SharedMemory::makeName("xdp_telemetry", ""),
+                                   sizeof(telemetry::Segment)));
+
+    mSegment = new (mMemory->get()) telemetry::Segment;
+    mSegment->Version = telemetry::VERSION;
+    mSegment->SegmentSize = sizeof(telemetry::Segment);
+    mSegment->MaxEntries = telemetry::MAX_ENTRIES;
+#ifndef _WINDOWS
+    mSegment->Pid = getpid();
+#endif
+    mSegment->StartTimeMsec = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    mSegment->NumEntries.store(0, std::memory_order_relaxed);
+    mSegment->UpdateCount.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(mSegment->Magic, telemetry::MAGIC, sizeof(telemetry::MAGIC));
+  }
+
+  Telemetry::~Telemetry()
+  {
+  }
+
+  const std::string& Telemetry::getSegmentName() const
+  {
+    return mMemory->getName();
+  }
+
+  telemetry::Entry* Telemetry::getEntry(telemetry::e_entry_kind kind, const std::string& name)
+  {
+    auto key = std::make_pair(static_cast<uint32_t>(kind), name);
+    auto itr = mEntries.find(key);
+    if (itr != mEntries.end())
+      return itr->second;
+
+    uint32_t index = mSegment->NumEntries.load(std::memory_order_relaxed);
+    if (index >= telemetry::MAX_ENTRIES) {
+      if (!mFullWarned) {
+        mPluginHandle->sendMessage("Live telemetry is full, further kernels and compute units are not exported.");
+        mFullWarned = true;
+      }
+      mEntries[key] = nullptr;
+      return nullptr;
+    }
+
+    // Fill in the entry before readers can see it
+    telemetry::Entry* entry = &mSegment->Entries[index];
+    std::strncpy(entry->Name, name.c_str(), telemetry::NAME_CHARS - 1);
+    entry->Kind = kind;
+    entry->MinNsec.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+    mSegment->NumEntries.store(index + 1, std::memory_order_release);
+
+    mEntries[key] = entry;
+    return entry;
+  }
+
+  void Telemetry::log(telemetry::e_entry_kind kind, const std::string& name,
+                      double durationMsec, uint64_t bytes)
+  {
+    telemetry::Entry* entry = getEntry(kind, name);
+    if (!entry)
+      return;
+
+    uint64_t nsec = LatencyHistogram::msecToNsec(durationMsec);
+    entry->Buckets[LatencyHistogram::getBucket(nsec)].fetch_add(1, std::memory_order_relaxed);
+    entry->Count.fetch_add(1, std::memory_order_relaxed);
+    entry->TotalNsec.fetch_add(nsec, std::memory_order_relaxed);
+    entry->Bytes.fetch_add(bytes, std::memory_order_relaxed);
+    // Only this process writes, so a plain compare is enough
+    if (nsec < entry->MinNsec.load(std::memory_order_relaxed))
+      entry->MinNsec.store(nsec, std::memory_order_relaxed);
+    if (nsec > entry->MaxNsec.load(std::memory_order_relaxed))
+      entry->MaxNsec.store(nsec, std::memory_order_relaxed);
+    mSegment->UpdateCount.fetch_add(1, std::memory_order_release);
+  }
+
+} // xdp
@@ -0,0 +1,65 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#ifndef __XDP_CORE_TELEMETRY_H
+#define __XDP_CORE_TELEMETRY_H
+
+#include "telemetry_format.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace xdp {
+  class SharedMemory;
+  class XDPPluginI;
+
+  // **************************************************************************
+  // Live telemetry
+  // **************************************************************************
+  // Publishes running aggregates of ProfileCounters to a shared memory
+  // segment (see telemetry_format.h) while the application runs, so
+  // monitoring agents do not have to wait for the profile summary.
+  // Logging calls come with the logger lock held like all ProfileCounters
+  // updates, the atomics are for the readers in other processes.
+  class Telemetry {
+  public:
+    Telemetry(XDPPluginI* Plugin);
+    ~Telemetry();
+
+  public:
+    // Durations are in msec like everywhere in ProfileCounters
+    void log(telemetry::e_entry_kind kind, const std::string& name,
+             double durationMsec, uint64_t bytes = 0);
+
+    const std::string& getSegmentName() const;
+
+  private:
+    telemetry::Entry* getEntry(telemetry::e_entry_kind kind, const std::string& name);
+
+  private:
+    std::unique_ptr<SharedMemory> mMemory;
+    telemetry::Segment* mSegment;
+    std::map<std::pair<uint32_t, std::string>, telemetry::Entry*> mEntries;
+    bool mFullWarned;
+    XDPPluginI* mPluginHandle;
+  };
+
+} // xdp
+
+#endif
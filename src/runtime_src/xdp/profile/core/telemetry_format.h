@@ -0,0 +1,90 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#ifndef __XDP_CORE_TELEMETRY_FORMAT_H
+#define __XDP_CORE_TELEMETRY_FORMAT_H
+
+#include "xdp/profile/collection/latency_histogram.h"
+
+#include <atomic>
+#include <cstdint>
+
+// Live telemetry shared memory layout
+//
+// Shared by Telemetry and external monitoring agents, so it only depends
+// on latency_histogram.h for the bucket layout. The segment is named
+// /xdp_telemetry_<pid> and holds one Segment.
+//
+// Each entry aggregates one kernel, compute unit or transfer type. An
+// entry is filled in before NumEntries is raised past it, so readers
+// only look at the first NumEntries (acquire) entries. Statistics are
+// updated one field at a time with relaxed atomics, so a reader can see
+// Count one ahead of TotalNsec but never a torn value. UpdateCount
+// changes whenever anything in the segment does.
+//
+// Buckets is a LatencyHistogram of the times in nsec, percentiles are
+// computed by the reader like LatencyHistogram::getValueAtPercentile.
+
+namespace xdp {
+namespace telemetry {
+
+  const char MAGIC[8] = {'X', 'D', 'P', 'T', 'E', 'L', 'E', 'M'};
+  const uint32_t VERSION = 2;
+  const uint32_t MAX_ENTRIES = 1024;
+  const uint32_t NAME_CHARS = 128;
+
+  enum e_entry_kind : uint32_t {
+    ENTRY_KERNEL        = 0,  // kernel enqueue to completion, host view
+    ENTRY_COMPUTE_UNIT  = 1,  // compute unit execution, host view
+    ENTRY_HOST_READ     = 2,  // buffer reads (device to host)
+    ENTRY_HOST_WRITE    = 3,  // buffer writes (host to device)
+    ENTRY_HOST_COPY     = 4,  // buffer copies
+    ENTRY_DEVICE_READ   = 5,  // device trace, reads by the shell
+    ENTRY_DEVICE_WRITE  = 6,  // device trace, writes by the shell
+    ENTRY_KERNEL_READ   = 7,  // device trace, reads by compute units
+    ENTRY_KERNEL_WRITE  = 8   // device trace, writes by compute units
+  };
+
+  struct Entry {
+    char Name[NAME_CHARS];
+    uint32_t Kind;
+    uint32_t Reserved;
+    std::atomic<uint64_t> Count;
+    std::atomic<uint64_t> TotalNsec;
+    std::atomic<uint64_t> MinNsec;
+    std::atomic<uint64_t> MaxNsec;
+    std::atomic<uint64_t> Bytes;
+    std::atomic<uint64_t> Buckets[LatencyHistogram::NUM_BUCKETS];
+  };
+
+  struct Segment {
+    char Magic[8];
+    uint32_t Version;
+    uint32_t SegmentSize;
+    uint32_t MaxEntries;
+    uint32_t Pid;
+    uint64_t StartTimeMsec;   // msec since epoch when profiling started
+    std::atomic<uint32_t> NumEntries;
+    uint32_t Reserved;
+    std::atomic<uint64_t> UpdateCount;
+    Entry Entries[MAX_ENTRIES];
+  };
+
+} // telemetry
+} // xdp
+
+#endif
@@ -30,6 +30,8 @@
 #include <algorithm>
 #include <ctime>
 #include <cassert>
+#include <chrono>
+#include <cstring>
 
 namespace xdp {
   // ************************
@@ -41,13 +43,25 @@ namespace xdp {
     mCurrentContextId(0),
     mCuStarts(0),
     mProfileCounters(profileCounters),
+    mFlushRunning(true),
     mTraceParserHandle(TraceParserHandle),
     mPluginHandle(Plugin)
   {
+    static std::atomic<uint64_t> instanceCount(0);
+    mInstanceId = ++instanceCount;
+    mFlushThread = std::thread(&TraceLogger::flushLoop, this);
   }
 
   TraceLogger::~TraceLogger()
   {
+    {
+      std::lock_guard<std::mutex> lock(mFlushMutex);
+      mFlushRunning = false;
+    }
+    mFlushCondition.notify_all();
+    mFlushThread.join();
+    flush();
+
     mKernelTraceMap.clear();
     mBufferTraceMap.clear();
     mDeviceTraceMap.clear();
@@ -84,12 +98,103 @@ namespace xdp {
   // Detach new trace writer
   void TraceLogger::detach(TraceWriterI* writer)
   {
+    // Writer gets all events logged so far
+    flush();
+
     std::lock_guard < std::mutex > lock(mLogMutex);
     auto itr = std::find(mTraceWriters.begin(), mTraceWriters.end(), writer);
     if (itr != mTraceWriters.end())
       mTraceWriters.erase(itr);
   }
 
+  // ***************************************************************************
+  // Host event buffers
+  // ***************************************************************************
+
+  // Buffer of the calling thread, created on first use
+  HostTraceBuffer* TraceLogger::getHostBuffer()
+  {
+    // Cache is keyed by logger instance since a logger can be recreated
+    thread_local uint64_t cachedInstanceId = 0;
+    thread_local HostTraceBuffer* cachedBuffer = nullptr;
+    if (cachedInstanceId == mInstanceId)
+      return cachedBuffer;
+
+    std::lock_guard<std::mutex> lock(mBufferMutex);
+    mHostBuffers.emplace_back(new HostTraceBuffer(std::this_thread::get_id()));
+    cachedBuffer = mHostBuffers.back().get();
+    cachedInstanceId = mInstanceId;
+    return cachedBuffer;
+  }
+
+  // Reserve a record, if the buffer is full flush on this thread
+  HostTraceRecord* TraceLogger::reserveRecord(HostTraceBuffer* buffer)
+  {
+    HostTraceRecord* record = buffer->reserve();
+    if (record == nullptr) {
+      flush();
+      record = buffer->reserve();
+    }
+    return record;
+  }
+
+  // Process all buffered events, must be called with mLogMutex held
+  void TraceLogger::drainHostBuffers()
+  {
+    std::vector<HostTraceBuffer*> buffers;
+    {
+      std::lock_guard<std::mutex> lock(mBufferMutex);
+      for (auto& b : mHostBuffers)
+        buffers.push_back(b.get());
+    }
+
+    for (auto b : buffers)
+      b->drain([this](const HostTraceRecord& record) { processRecord(record); });
+  }
+
+  void TraceLogger::flush()
+  {
+    std::lock_guard<std::mutex> lock(mLogMutex);
+    drainHostBuffers();
+  }
+
+  void TraceLogger::flushLoop()
+  {
+    std::unique_lock<std::mutex> lock(mFlushMutex);
+    while (mFlushRunning) {
+      mFlushCondition.wait_for(lock, std::chrono::milliseconds(FLUSH_INTERVAL_MS),
+                               [this] { return !mFlushRunning; });
+      lock.unlock();
+      flush();
+      lock.lock();
+    }
+  }
+
+  void TraceLogger::processRecord(const HostTraceRecord& record)
+  {
+    switch (record.Kind) {
+    case HostTraceRecord::FUNCTION_START:
+      processFunctionCall(record.FunctionName, record.QueueAddress, record.FunctionID,
+                          "START", record.TimeStamp, record.ThreadId);
+      break;
+    case HostTraceRecord::FUNCTION_END:
+      processFunctionCall(record.FunctionName, record.QueueAddress, record.FunctionID,
+                          "END", record.TimeStamp, record.ThreadId);
+      break;
+    case HostTraceRecord::DATA_TRANSFER:
+      processDataTransfer(record.ObjId, record.CommandKind, record.CommandStage, record.Size,
+                          record.ContextId, record.NumDevices, record.CommandQueueId,
+                          record.SrcAddress, record.SrcBank, record.DstAddress, record.DstBank,
+                          record.ThreadId, record.EventString, record.DependString,
+                          record.TimeStamp);
+      break;
+    case HostTraceRecord::DEPENDENCY:
+      processDependency(record.CommandKind, record.EventString, record.DependString,
+                        record.TimeStamp);
+      break;
+    }
+  }
+
   // ***************************************************************************
   // Timeline trace writers
   // ***************************************************************************
@@ -171,17 +276,18 @@ namespace xdp {
   {
     double timeStamp = mPluginHandle->getTraceTime();
 
-    std::string name(functionName);
-    if (name.find("MigrateMem") != std::string::npos)
+    if (std::strstr(functionName, "MigrateMem") != nullptr)
       mMigrateMemCalls++;
 
-    if (queueAddress == 0)
-      name += "|General";
-    else
-      (name += "|") +=std::to_string(queueAddress);
-    std::lock_guard<std::mutex> lock(mLogMutex);
-    mProfileCounters->logFunctionCallStart(functionName, timeStamp);
-    writeTimelineTrace(timeStamp, name.c_str(), "START", functionID);
+    HostTraceBuffer* buffer = getHostBuffer();
+    HostTraceRecord* record = reserveRecord(buffer);
+    record->Kind = HostTraceRecord::FUNCTION_START;
+    record->TimeStamp = timeStamp;
+    record->FunctionName = functionName;
+    record->QueueAddress = queueAddress;
+    record->FunctionID = functionID;
+    record->ThreadId = std::this_thread::get_id();
+    buffer->commit();
     mFunctionStartLogged = true;
 
 #if 0
@@ -203,15 +309,15 @@ namespace xdp {
 
     double timeStamp = mPluginHandle->getTraceTime();
 
-    std::string name(functionName);
-    if (queueAddress == 0)
-      name += "|General";
-    else
-      (name += "|") +=std::to_string(queueAddress);
-
-    std::lock_guard<std::mutex> lock(mLogMutex);
-    mProfileCounters->logFunctionCallEnd(functionName, timeStamp);
-    writeTimelineTrace(timeStamp, name.c_str(), "END", functionID);
+    HostTraceBuffer* buffer = getHostBuffer();
+    HostTraceRecord* record = reserveRecord(buffer);
+    record->Kind = HostTraceRecord::FUNCTION_END;
+    record->TimeStamp = timeStamp;
+    record->FunctionName = functionName;
+    record->QueueAddress = queueAddress;
+    record->FunctionID = functionID;
+    record->ThreadId = std::this_thread::get_id();
+    buffer->commit();
 
 #if 0
     // Write host event to trace buffer
@@ -223,6 +329,22 @@ namespace xdp {
 #endif
   }
 
+  void TraceLogger::processFunctionCall(const char* functionName, long long queueAddress,
+      unsigned int functionID, const char* stageName, double timeStamp, std::thread::id threadId)
+  {
+    std::string name(functionName);
+    if (queueAddress == 0)
+      name += "|General";
+    else
+      (name += "|") +=std::to_string(queueAddress);
+
+    if (std::strcmp(stageName, "START") == 0)
+      mProfileCounters->logFunctionCallStart(functionName, timeStamp, threadId);
+    else
+      mProfileCounters->logFunctionCallEnd(functionName, timeStamp, threadId);
+    writeTimelineTrace(timeStamp, name.c_str(), stageName, functionID);
+  }
+
   // ***************************************************************************
   // Log Host Data Transfers
   // ***************************************************************************
@@ -237,9 +359,58 @@ namespace xdp {
     double timeStamp = (timeStampMsec > 0.0) ? timeStampMsec :
         mPluginHandle->getTraceTime();
 
+    if (HostTraceRecord::fits(srcBank, HostTraceRecord::BANK_CHARS)
+        && HostTraceRecord::fits(dstBank, HostTraceRecord::BANK_CHARS)
+        && HostTraceRecord::fits(eventString, HostTraceRecord::EVENT_CHARS)
+        && HostTraceRecord::fits(dependString, HostTraceRecord::EVENT_CHARS)) {
+      HostTraceBuffer* buffer = getHostBuffer();
+      HostTraceRecord* record = reserveRecord(buffer);
+      record->Kind = HostTraceRecord::DATA_TRANSFER;
+      record->CommandKind = objKind;
+      record->CommandStage = objStage;
+      record->TimeStamp = timeStamp;
+      record->ObjId = objId;
+      record->Size = objSize;
+      record->ContextId = contextId;
+      record->NumDevices = numDevices;
+      record->CommandQueueId = commandQueueId;
+      record->SrcAddress = srcAddress;
+      record->DstAddress = dstAddress;
+      record->ThreadId = threadId;
+      HostTraceRecord::copy(record->SrcBank, srcBank);
+      HostTraceRecord::copy(record->DstBank, dstBank);
+      HostTraceRecord::copy(record->EventString, eventString);
+      HostTraceRecord::copy(record->DependString, dependString);
+      buffer->commit();
+      return;
+    }
+
+    // Too long to buffer, log now but after what this thread buffered
+    std::lock_guard < std::mutex > lock(mLogMutex);
+    drainHostBuffers();
+    processDataTransfer(objId, objKind, objStage, objSize, contextId, numDevices,
+                        commandQueueId, srcAddress, srcBank, dstAddress, dstBank,
+                        threadId, eventString, dependString, timeStamp);
+
+#if 0
+    // Write host event to trace buffer
+    if (objStage == RTUtil::START || objStage == RTUtil::END) {
+      xclPerfMonEventType eventType = (objStage == RTUtil::START) ? XCL_PERF_MON_START_EVENT : XCL_PERF_MON_END_EVENT;
+      xclPerfMonEventID eventID = (objKind == RTUtil::READ_BUFFER) ? XCL_PERF_MON_READ_ID : XCL_PERF_MON_WRITE_ID;
+      xdp::profile::platform::write_host_event(xdp::RTSingleton::Instance()->getcl_platform_id(), eventType, eventID);
+    }
+#endif
+  }
+
+  void TraceLogger::processDataTransfer(uint64_t objId, RTUtil::e_profile_command_kind objKind,
+      RTUtil::e_profile_command_state objStage, size_t objSize, uint32_t contextId,
+      uint32_t numDevices, uint32_t commandQueueId,
+      uint64_t srcAddress, const std::string& srcBank, uint64_t dstAddress, const std::string& dstBank,
+      std::thread::id threadId, const std::string& eventString, const std::string& dependString,
+      double timeStamp)
+  {
     std::string commandString;
     std::string stageString;
-    std::lock_guard < std::mutex > lock(mLogMutex);
     RTUtil::commandKindToString(objKind, commandString);
     RTUtil::commandStageToString(objStage, stageString);
 
@@ -284,15 +455,6 @@ namespace xdp {
 
     writeTimelineTrace(timeStamp, objKind, commandString, stageString, eventString, dependString,
                        objSize, srcAddress, srcBank, dstAddress, dstBank, threadId);
-
-#if 0
-    // Write host event to trace buffer
-    if (objStage == RTUtil::START || objStage == RTUtil::END) {
-      xclPerfMonEventType eventType = (objStage == RTUtil::START) ? XCL_PERF_MON_START_EVENT : XCL_PERF_MON_END_EVENT;
-      xclPerfMonEventID eventID = (objKind == RTUtil::READ_BUFFER) ? XCL_PERF_MON_READ_ID : XCL_PERF_MON_WRITE_ID;
-      xdp::profile::platform::write_host_event(xdp::RTSingleton::Instance()->getcl_platform_id(), eventType, eventID);
-    }
-#endif
   }
 
   // ***************************************************************************
@@ -484,11 +646,31 @@ namespace xdp {
   void TraceLogger::logDependency(RTUtil::e_profile_command_kind objKind,
       const std::string eventString, const std::string dependString)
   {
-    std::string commandString;
+    double traceTime = mPluginHandle->getTraceTime();
+
+    if (HostTraceRecord::fits(eventString, HostTraceRecord::EVENT_CHARS)
+        && HostTraceRecord::fits(dependString, HostTraceRecord::EVENT_CHARS)) {
+      HostTraceBuffer* buffer = getHostBuffer();
+      HostTraceRecord* record = reserveRecord(buffer);
+      record->Kind = HostTraceRecord::DEPENDENCY;
+      record->CommandKind = objKind;
+      record->TimeStamp = traceTime;
+      HostTraceRecord::copy(record->EventString, eventString);
+      HostTraceRecord::copy(record->DependString, dependString);
+      buffer->commit();
+      return;
+    }
+
     std::lock_guard < std::mutex > lock(mLogMutex);
-    RTUtil::commandKindToString(objKind, commandString);
+    drainHostBuffers();
+    processDependency(objKind, eventString, dependString, traceTime);
+  }
 
-    double traceTime = mPluginHandle->getTraceTime();
+  void TraceLogger::processDependency(RTUtil::e_profile_command_kind objKind,
+      const std::string& eventString, const std::string& dependString, double traceTime)
+  {
+    std::string commandString;
+    RTUtil::commandKindToString(objKind, commandString);
     writeTimelineTrace(traceTime, commandString, "", eventString, dependString);
   }
 
@@ -18,6 +18,7 @@
 #define __XDP_CORE_LOGGER_H
 
 #include "rt_util.h"
+#include "host_trace_buffer.h"
 #include "xdp/profile/collection/counters.h"
 #include "xdp/profile/collection/results.h"
 #include "xdp/profile/plugin/base_plugin.h"
@@ -31,6 +32,9 @@
 #include <mutex>
 #include <map>
 #include <queue>
+#include <memory>
+#include <thread>
+#include <condition_variable>
 
 namespace xdp {
   class ProfileCounters;
@@ -54,6 +58,10 @@ namespace xdp {
     void attach(TraceWriterI* writer);
     void detach(TraceWriterI* writer);
 
+    // Log all host events still held in per-thread buffers
+    // NOTE: thread safe, also called periodically by the flush thread
+    void flush();
+
   public:
     // Log host function calls (e.g., OpenCL APIs)
     void logFunctionCallStart(const char* functionName, long long queueAddress, unsigned int functionID);
@@ -107,11 +115,31 @@ namespace xdp {
     int getMigrateMemCalls() const { return mMigrateMemCalls;}
     int getHostP2PTransfers() const { return mHostP2PTransfers;}
     std::string getCurrentBinaryName() const {return mCurrentBinaryName;}
-    const std::set<std::thread::id>& getThreadIds() {return mThreadIdSet;}
+    const std::set<std::thread::id>& getThreadIds() {flush(); return mThreadIdSet;}
 
   private:
     // helpers
     double getDeviceTimeStamp(double hostTimeStamp, std::string& deviceName);
+
+    // Host event buffers
+    // NOTE: events are recorded lock-free on the calling thread and
+    // processed (counters, string formatting, writers) when flushed
+    HostTraceBuffer* getHostBuffer();
+    HostTraceRecord* reserveRecord(HostTraceBuffer* buffer);
+    void drainHostBuffers();
+    void flushLoop();
+    void processRecord(const HostTraceRecord& record);
+    void processFunctionCall(const char* functionName, long long queueAddress,
+        unsigned int functionID, const char* stageName, double timeStamp,
+        std::thread::id threadId);
+    void processDataTransfer(uint64_t objId, RTUtil::e_profile_command_kind objKind,
+        RTUtil::e_profile_command_state objStage, size_t objSize, uint32_t contextId,
+        uint32_t numDevices, uint32_t commandQueueId,
+        uint64_t srcAddress, const std::string& srcBank, uint64_t dstAddress, const std::string& dstBank,
+        std::thread::id threadId, const std::string& eventString, const std::string& dependString,
+        double timeStamp);
+    void processDependency(RTUtil::e_profile_command_kind objKind,
+        const std::string& eventString, const std::string& dependString, double timeStamp);
     void addToThreadIds(const std::thread::id& threadId) {
       mThreadIdSet.insert(threadId);
     }
@@ -138,6 +166,16 @@ namespace xdp {
     ProfileCounters* mProfileCounters;
     std::vector<TraceWriterI*> mTraceWriters;
 
+    // Per-thread host event buffers and the thread that flushes them
+    static const unsigned int FLUSH_INTERVAL_MS = 100;
+    uint64_t mInstanceId;
+    std::mutex mBufferMutex;
+    std::vector<std::unique_ptr<HostTraceBuffer>> mHostBuffers;
+    std::thread mFlushThread;
+    std::mutex mFlushMutex;
+    std::condition_variable mFlushCondition;
+    bool mFlushRunning;
+
   private:
       TraceParser * mTraceParserHandle;
       XDPPluginI * mPluginHandle;
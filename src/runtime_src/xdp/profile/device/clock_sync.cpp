@@ -0,0 +1,153 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "clock_sync.h"
+#include "xrt/util/time.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <memory>
+
+namespace xdp {
+
+namespace {
+
+/**
+ * Same clock the host side of the clock training words is taken from
+ */
+uint64_t host_trace_time_nsec() {
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(high_resolution_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+ClockSync& ClockSync::get(const std::string& device_name) {
+    static std::mutex registry_lock;
+    static std::map<std::string, std::unique_ptr<ClockSync>> registry;
+
+    std::lock_guard<std::mutex> guard(registry_lock);
+    auto& sync = registry[device_name];
+    if (!sync) {
+        sync.reset(new ClockSync());
+    }
+    return *sync;
+}
+
+ClockSync::ClockSync()
+    : nominal_slope(1000.0 / 300.0)
+{
+    /**
+     * Offset between the two host clocks, taken once so that converted
+     * times do not move by the read jitter every time the model changes
+     */
+    uint64_t xrt_nsec = static_cast<uint64_t>(xrt::time_ns());
+    time_base_nsec = host_trace_time_nsec() - xrt_nsec;
+    fit();
+}
+
+void ClockSync::set_clock_mhz(double clock_mhz) {
+    if (clock_mhz <= 0.0) {
+        return;
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    double slope = 1000.0 / clock_mhz;
+    if (slope != nominal_slope) {
+        nominal_slope = slope;
+        fit();
+    }
+}
+
+bool ClockSync::add_training_pair(uint64_t device_timestamp, uint64_t host_nsec) {
+    uint64_t now = host_trace_time_nsec();
+    if (host_nsec > now || now - host_nsec > MAX_PAIR_AGE_NSEC) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    if (num_pairs > 0 && device_timestamp == last_timestamp && host_nsec == last_nsec) {
+        return true;
+    }
+    last_timestamp = device_timestamp;
+    last_nsec = host_nsec;
+
+    if (num_pairs == 0) {
+        reset_epoch(device_timestamp, host_nsec);
+        fit();
+        return true;
+    }
+
+    double x = static_cast<double>(static_cast<int64_t>(device_timestamp - base_timestamp));
+    double y = static_cast<double>(static_cast<int64_t>(host_nsec - base_nsec));
+    if (std::fabs(y - (fit_intercept + fit_slope * x)) > EPOCH_TOLERANCE_NSEC) {
+        reset_epoch(device_timestamp, host_nsec);
+        fit();
+        return true;
+    }
+
+    num_pairs++;
+    sum_x += x;
+    sum_y += y;
+    sum_xx += x * x;
+    sum_xy += x * y;
+    min_x = std::min(min_x, x);
+    max_x = std::max(max_x, x);
+    fit();
+    return true;
+}
+
+ClockSync::model ClockSync::get_model() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return current;
+}
+
+double ClockSync::to_host_msec(uint64_t device_timestamp) const {
+    std::lock_guard<std::mutex> guard(lock);
+    return current.slope * static_cast<double>(device_timestamp) + current.offset;
+}
+
+void ClockSync::reset_epoch(uint64_t device_timestamp, uint64_t host_nsec) {
+    base_timestamp = device_timestamp;
+    base_nsec = host_nsec;
+    num_pairs = 1;
+    sum_x = sum_y = sum_xx = sum_xy = 0.0;
+    min_x = max_x = 0.0;
+}
+
+void ClockSync::fit() {
+    fit_slope = nominal_slope;
+    fit_intercept = 0.0;
+    if (num_pairs > 0) {
+        double n = num_pairs;
+        double denom = n * sum_xx - sum_x * sum_x;
+        if (num_pairs >= 2 && denom > 0.0 && (max_x - min_x) * nominal_slope >= MIN_BASELINE_NSEC) {
+            fit_slope = (n * sum_xy - sum_x * sum_y) / denom;
+        }
+        fit_intercept = (sum_y - fit_slope * sum_x) / n;
+    }
+
+    /**
+     * host nsec = base_nsec + fit_intercept + fit_slope * (timestamp - base_timestamp),
+     * moved to the xrt::time_ns time line and to msec
+     */
+    double base = static_cast<double>(static_cast<int64_t>(base_nsec - time_base_nsec));
+    current.slope = fit_slope / 1.0e6;
+    current.offset = (base + fit_intercept - fit_slope * static_cast<double>(base_timestamp)) / 1.0e6;
+}
+
+} //  xdp
@@ -0,0 +1,120 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef XDP_PROFILE_DEVICE_CLOCK_SYNC_H_
+#define XDP_PROFILE_DEVICE_CLOCK_SYNC_H_
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace xdp {
+
+/**
+ * ClockSync
+ *
+ * Description:
+ *
+ * This class converts device trace timestamps (cycles) of one device to
+ * host time. Clock training pairs of a device timestamp and the host
+ * time it was taken at are added as they show up in the trace, and the
+ * model is a least squares line through all pairs of the current trace
+ * epoch, so it is not refitted from scratch for every trace chunk.
+ * Until the pairs span MIN_BASELINE_NSEC the slope is the nominal clock
+ * period, since pairs taken microseconds apart give a noisy slope.
+ *
+ * A pair far off the current line starts a new epoch, as happens when
+ * trace restarts and device timestamps start over. Pairs whose host
+ * time cannot be a training time of this run are ignored.
+ *
+ * Note:
+ *
+ * There is one instance per device, shared by everything in XDP that
+ * places device events on the host time line. Conversion is a multiply
+ * and an add on a model snapshot, see get_model.
+ */
+class ClockSync {
+public:
+    /**
+     * host msec = slope * device timestamp + offset, with host msec on
+     * the xrt::time_ns time line used by the rest of XDP
+     */
+    struct model {
+        double slope;
+        double offset;
+    };
+
+    /**
+     * The get API returns the instance of a device, created on first use.
+     */
+    static ClockSync& get(const std::string& device_name);
+
+    /**
+     * The set_clock_mhz API sets the trace clock, which gives the slope
+     * until the training pairs span enough time.
+     */
+    void set_clock_mhz(double clock_mhz);
+
+    /**
+     * The add_training_pair API adds a device timestamp and the host
+     * time in nsec (high resolution clock) it was taken at. Returns false
+     * if the pair was ignored.
+     */
+    bool add_training_pair(uint64_t device_timestamp, uint64_t host_nsec);
+
+    /**
+     * The get_model API returns a snapshot of the current model.
+     */
+    model get_model() const;
+
+    /**
+     * The to_host_msec API converts one device timestamp with the
+     * current model.
+     */
+    double to_host_msec(uint64_t device_timestamp) const;
+
+private:
+    ClockSync();
+    void reset_epoch(uint64_t device_timestamp, uint64_t host_nsec);
+    void fit();
+
+private:
+    static const uint64_t MIN_BASELINE_NSEC = 10000000;
+    static const uint64_t EPOCH_TOLERANCE_NSEC = 500000;
+    static const uint64_t MAX_PAIR_AGE_NSEC = 86400000000000ULL;
+
+    mutable std::mutex lock;
+    double nominal_slope;         /** < nsec per cycle of the trace clock */
+    uint64_t time_base_nsec;      /** < high resolution clock at xrt::time_ns zero */
+    uint64_t base_timestamp = 0;  /** < first pair of the epoch */
+    uint64_t base_nsec = 0;
+    uint64_t last_timestamp = 0;  /** < last pair, training is often repeated */
+    uint64_t last_nsec = 0;
+    uint32_t num_pairs = 0;
+    double sum_x = 0.0;           /** < sums of pairs relative to the first */
+    double sum_y = 0.0;
+    double sum_xx = 0.0;
+    double sum_xy = 0.0;
+    double min_x = 0.0;
+    double max_x = 0.0;
+    double fit_slope = 0.0;       /** < line through the pairs, relative to the first */
+    double fit_intercept = 0.0;
+    model current;
+};
+
+} //  xdp
+
+#endif
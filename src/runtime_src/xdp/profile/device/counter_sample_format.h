@@ -0,0 +1,126 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#ifndef XDP_PROFILE_DEVICE_COUNTER_SAMPLE_FORMAT_H_
+#define XDP_PROFILE_DEVICE_COUNTER_SAMPLE_FORMAT_H_
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Layout of the shared memory segment device counter samples are
+ * published to by DeviceCounterSampler.
+ *
+ * The segment is named /xdp_counters_<pid>_<device> and holds one
+ * Segment. It does not depend on anything else in xdp so external
+ * collectors can include it on its own.
+ *
+ * Sequence is odd while a sample is being written. A reader copies
+ * Sample between two reads of an even, unchanged Sequence, see
+ * read_sample. Totals are raw counter values, rates and utilizations
+ * are over the last sample interval.
+ */
+
+namespace xdp {
+namespace countersample {
+
+const char MAGIC[8] = {'X', 'D', 'P', 'C', 'N', 'T', 'R', 'S'};
+const uint32_t VERSION = 1;
+
+const uint32_t MAX_MEMORY_SLOTS = 34;
+const uint32_t MAX_ACCEL_SLOTS = 31;
+const uint32_t MAX_STREAM_SLOTS = 31;
+
+struct MemorySlot {
+    uint64_t ReadBytes;
+    uint64_t WriteBytes;
+    uint64_t ReadTranx;
+    uint64_t WriteTranx;
+    double ReadMBps;
+    double WriteMBps;
+    double ReadLatencyCycles; /** < average over the interval */
+    double WriteLatencyCycles;
+};
+
+struct AccelSlot {
+    uint64_t ExecCount;
+    uint64_t ExecCycles;
+    uint64_t StallIntCycles;
+    uint64_t StallStrCycles;
+    uint64_t StallExtCycles;
+    double Utilization; /** < percent of the interval the CU was busy */
+};
+
+struct StreamSlot {
+    uint64_t NumTranx;
+    uint64_t DataBytes;
+    uint64_t BusyCycles;
+    uint64_t StallCycles;
+    uint64_t StarveCycles;
+    double MBps;
+    double Utilization; /** < percent of the interval the stream was busy */
+};
+
+struct Sample {
+    uint64_t SampleCount;
+    uint64_t TimeNsec; /** < steady clock time of the sample */
+    double IntervalUsec; /** < time since the previous sample */
+    uint32_t NumMemorySlots;
+    uint32_t NumAccelSlots;
+    uint32_t NumStreamSlots;
+    uint32_t Reserved;
+    MemorySlot Memory[MAX_MEMORY_SLOTS];
+    AccelSlot Accel[MAX_ACCEL_SLOTS];
+    StreamSlot Stream[MAX_STREAM_SLOTS];
+};
+
+struct Segment {
+    char Magic[8];
+    uint32_t Version;
+    uint32_t SegmentSize;
+    double SampleRateHz;
+    double ClockMHz;
+    std::atomic<uint64_t> Sequence;
+    Sample Data;
+};
+
+/**
+ * Copies the last published sample, returns false if none has been
+ * published yet or the segment is not a counter sample segment.
+ */
+inline bool read_sample(const Segment* seg, Sample& sample) {
+    if (std::memcmp(seg->Magic, MAGIC, sizeof(MAGIC)) != 0 || seg->Version != VERSION) {
+        return false;
+    }
+    for (;;) {
+        uint64_t seq = seg->Sequence.load(std::memory_order_acquire);
+        if (seq & 1) {
+            continue;
+        }
+        std::memcpy(&sample, &seg->Data, sizeof(sample));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (seg->Sequence.load(std::memory_order_relaxed) == seq) {
+            return seq != 0;
+        }
+    }
+}
+
+} // countersample
+} // xdp
+
+#endif
@@ -0,0 +1,219 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include "counter_sampler.h"
+#include "xdp/profile/core/shared_memory.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+
+namespace xdp {
+
+static_assert(countersample::MAX_MEMORY_SLOTS == XSPM_MAX_NUMBER_SLOTS &&
+              countersample::MAX_ACCEL_SLOTS == XSAM_MAX_NUMBER_SLOTS &&
+              countersample::MAX_STREAM_SLOTS == XSSPM_MAX_NUMBER_SLOTS,
+              "counter sample layout does not match xclCounterResults");
+
+namespace {
+
+// Counters restart from zero when they are reset
+inline uint64_t delta(uint64_t current, uint64_t previous) {
+    return (current >= previous) ? current - previous : current;
+}
+
+} // namespace
+
+DeviceCounterSampler::DeviceCounterSampler(const std::string& name, reader read,
+                                           uint32_t memory_slots, uint32_t accel_slots,
+                                           uint32_t stream_slots, double mhz, uint32_t rate) :
+device_name(name),
+read_counters(read),
+num_memory_slots(std::min(memory_slots, countersample::MAX_MEMORY_SLOTS)),
+num_accel_slots(std::min(accel_slots, countersample::MAX_ACCEL_SLOTS)),
+num_stream_slots(std::min(stream_slots, countersample::MAX_STREAM_SLOTS)),
+clock_mhz(mhz),
+rate_hz(rate),
+segment(nullptr),
+sample_count(0),
+running(false) {
+    std::memset(&current, 0, sizeof(current));
+    std::memset(&previous, 0, sizeof(previous));
+}
+
+DeviceCounterSampler::~DeviceCounterSampler() {
+    stop();
+}
+
+bool DeviceCounterSampler::start() {
+    if (!rate_hz || running) {
+        return false;
+    }
+    try {
+        shm.reset(new SharedMemory(SharedMemory::makeName("xdp_counters", device_name),
+                                   sizeof(countersample::Segment)));
+    }
+    catch (const std::runtime_error& ex) {
+        std::cout << "Warning: device counters will not be sampled. Reason: " << ex.what() << std::endl;
+        return false;
+    }
+
+    segment = new (shm->get()) countersample::Segment;
+    segment->Version = countersample::VERSION;
+    segment->SegmentSize = sizeof(countersample::Segment);
+    segment->SampleRateHz = rate_hz;
+    segment->ClockMHz = clock_mhz;
+    segment->Sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(segment->Magic, countersample::MAGIC, sizeof(countersample::MAGIC));
+
+    // Rates of the first sample are relative to the counters at start
+    {
+        std::lock_guard<std::mutex> lock(sample_mutex);
+        read_counters(previous);
+        previous_time = std::chrono::steady_clock::now();
+    }
+
+    running = true;
+    sample_thread = std::thread(&DeviceCounterSampler::sample_loop, this);
+    return true;
+}
+
+void DeviceCounterSampler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(running_mutex);
+        if (!running) {
+            return;
+        }
+        running = false;
+    }
+    running_cv.notify_all();
+    sample_thread.join();
+}
+
+void DeviceCounterSampler::read(xclCounterResults& results) {
+    std::lock_guard<std::mutex> lock(sample_mutex);
+    sample();
+    results = current;
+}
+
+std::string DeviceCounterSampler::get_segment_name() const {
+    return shm ? shm->getName() : "";
+}
+
+void DeviceCounterSampler::sample_loop() {
+    auto period = std::chrono::microseconds(1000000 / rate_hz);
+    auto next = std::chrono::steady_clock::now() + period;
+    std::unique_lock<std::mutex> lock(running_mutex);
+    while (running) {
+        if (running_cv.wait_until(lock, next, [this] { return !running; })) {
+            break;
+        }
+        lock.unlock();
+        {
+            std::lock_guard<std::mutex> sample_lock(sample_mutex);
+            sample();
+        }
+        lock.lock();
+
+        // Skip samples missed while the device was busy instead of
+        // sampling back to back to catch up
+        auto now = std::chrono::steady_clock::now();
+        next += period;
+        if (next < now) {
+            next = now + period;
+        }
+    }
+}
+
+// Must be called with sample_mutex held
+void DeviceCounterSampler::sample() {
+    read_counters(current);
+    if (!segment) {
+        return;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    double interval_usec = std::chrono::duration<double, std::micro>(now - previous_time).count();
+    previous_time = now;
+    publish(interval_usec);
+    previous = current;
+}
+
+void DeviceCounterSampler::publish(double interval_usec) {
+    using namespace countersample;
+
+    // Bytes per usec is MB per sec, cycles per usec is MHz
+    double usec = (interval_usec > 0.0) ? interval_usec : 1.0;
+    double cycles = usec * ((clock_mhz > 0.0) ? clock_mhz : 1.0);
+
+    uint64_t seq = segment->Sequence.load(std::memory_order_relaxed);
+    segment->Sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    Sample& data = segment->Data;
+    data.SampleCount = ++sample_count;
+    data.TimeNsec = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        previous_time.time_since_epoch()).count();
+    data.IntervalUsec = interval_usec;
+    data.NumMemorySlots = num_memory_slots;
+    data.NumAccelSlots = num_accel_slots;
+    data.NumStreamSlots = num_stream_slots;
+
+    for (uint32_t s = 0; s < num_memory_slots; ++s) {
+        MemorySlot& slot = data.Memory[s];
+        uint64_t read_tranx = delta(current.ReadTranx[s], previous.ReadTranx[s]);
+        uint64_t write_tranx = delta(current.WriteTranx[s], previous.WriteTranx[s]);
+        slot.ReadBytes = current.ReadBytes[s];
+        slot.WriteBytes = current.WriteBytes[s];
+        slot.ReadTranx = current.ReadTranx[s];
+        slot.WriteTranx = current.WriteTranx[s];
+        slot.ReadMBps = delta(current.ReadBytes[s], previous.ReadBytes[s]) / usec;
+        slot.WriteMBps = delta(current.WriteBytes[s], previous.WriteBytes[s]) / usec;
+        slot.ReadLatencyCycles = read_tranx ?
+            static_cast<double>(delta(current.ReadLatency[s], previous.ReadLatency[s])) / read_tranx : 0.0;
+        slot.WriteLatencyCycles = write_tranx ?
+            static_cast<double>(delta(current.WriteLatency[s], previous.WriteLatency[s])) / write_tranx : 0.0;
+    }
+
+    for (uint32_t s = 0; s < num_accel_slots; ++s) {
+        AccelSlot& slot = data.Accel[s];
+        slot.ExecCount = current.CuExecCount[s];
+        slot.ExecCycles = current.CuExecCycles[s];
+        slot.StallIntCycles = current.CuStallIntCycles[s];
+        slot.StallStrCycles = current.CuStallStrCycles[s];
+        slot.StallExtCycles = current.CuStallExtCycles[s];
+        slot.Utilization = 100.0 * delta(current.CuExecCycles[s], previous.CuExecCycles[s]) / cycles;
+    }
+
+    for (uint32_t s = 0; s < num_stream_slots; ++s) {
+        StreamSlot& slot = data.Stream[s];
+        slot.NumTranx = current.StrNumTranx[s];
+        slot.DataBytes = current.StrDataBytes[s];
+        slot.BusyCycles = current.StrBusyCycles[s];
+        slot.StallCycles = current.StrStallCycles[s];
+        slot.StarveCycles = current.StrStarveCycles[s];
+        slot.MBps = delta(current.StrDataBytes[s], previous.StrDataBytes[s]) / usec;
+        slot.Utilization = 100.0 * delta(current.StrBusyCycles[s], previous.StrBusyCycles[s]) / cycles;
+    }
+
+    segment->Sequence.store(seq + 2, std::memory_order_release);
+}
+
+} //  xdp
@@ -0,0 +1,121 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#ifndef XDP_PROFILE_DEVICE_COUNTER_SAMPLER_H_
+#define XDP_PROFILE_DEVICE_COUNTER_SAMPLER_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "counter_sample_format.h"
+#include "xclperf.h"
+
+namespace xdp {
+
+class SharedMemory;
+
+/**
+ * DeviceCounterSampler
+ *
+ * Description:
+ *
+ * This class samples the device profile counters from a background
+ * thread at a fixed rate and publishes each sample to a shared memory
+ * segment (see counter_sample_format.h) for external collectors.
+ * Bandwidths and utilizations are computed from the difference to the
+ * previous sample, so each sample costs one counter read plus work
+ * linear in the number of monitor slots.
+ *
+ * Note:
+ *
+ * All counter reads of a device have to go through the sampler while
+ * it runs, the read API takes a sample on behalf of the caller.
+ */
+class DeviceCounterSampler {
+public:
+    typedef std::function<size_t(xclCounterResults&)> reader;
+
+    /**
+     * The constructor takes the device name used in the segment name,
+     * the function the counters are read with, the number of monitor
+     * slots of each type, the device clock and the sample rate in Hz.
+     */
+    DeviceCounterSampler(const std::string& device_name, reader read_counters,
+                         uint32_t num_memory_slots, uint32_t num_accel_slots,
+                         uint32_t num_stream_slots, double clock_mhz, uint32_t rate_hz);
+
+    /**
+     * The destructor stops sampling and removes the segment.
+     */
+    ~DeviceCounterSampler();
+
+    /**
+     * The start API creates the segment and starts the sampling thread.
+     * Returns false if the segment cannot be created.
+     */
+    bool start();
+
+    /**
+     * The stop API stops the sampling thread, the segment keeps the last
+     * sample until the sampler is destroyed. Safe to call more than once.
+     */
+    void stop();
+
+    /**
+     * The read API takes a sample now and returns the raw counters.
+     */
+    void read(xclCounterResults& results);
+
+    /**
+     * Name of the shared memory segment, empty before start.
+     */
+    std::string get_segment_name() const;
+
+private:
+    void sample_loop();
+    void sample();
+    void publish(double interval_usec);
+
+    std::string device_name;
+    reader read_counters;
+    uint32_t num_memory_slots;
+    uint32_t num_accel_slots;
+    uint32_t num_stream_slots;
+    double clock_mhz;
+    uint32_t rate_hz;
+
+    std::unique_ptr<SharedMemory> shm; /** < segment the samples go to */
+    countersample::Segment* segment;
+    uint64_t sample_count;
+    xclCounterResults current; /** < counters of the last sample */
+    xclCounterResults previous; /** < counters of the sample before */
+    std::chrono::steady_clock::time_point previous_time;
+
+    std::thread sample_thread;
+    std::mutex sample_mutex; /** < serializes counter reads */
+    std::mutex running_mutex;
+    std::condition_variable running_cv;
+    bool running;
+};
+
+} //  xdp
+
+#endif
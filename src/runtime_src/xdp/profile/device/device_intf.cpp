@@ -290,6 +290,9 @@ namespace xdp {
   }
 
   // Read SPM performance counters
+  // NOTE: reading the sample register of a monitor latches its sampled
+  // metric counters, the latched counters are then fetched with one
+  // contiguous read per monitor instead of one read per register
   size_t DeviceIntf::readCounters(xclPerfMonType type, xclCounterResults& counterResults) {
     if (mVerbose) {
       std::cout << __func__ << ", " << std::this_thread::get_id()
@@ -307,7 +310,12 @@ namespace xdp {
     uint64_t baseAddress;
     uint32_t sampleInterval;
     uint32_t numSlots = 0;
-    
+    // Large enough for the biggest register block below
+    uint32_t block[(XSPM_SAMPLE_READ_LATENCY_UPPER_OFFSET - XSPM_SAMPLE_WRITE_BYTES_OFFSET) / 4 + 1];
+    auto reg = [&block](uint64_t blockOffset, uint64_t offset) -> uint64_t {
+      return block[(offset - blockOffset) / 4];
+    };
+
     numSlots = getNumberSlots(XCL_PERF_MON_MEMORY);
     for (uint32_t s=0; s < numSlots; s++) {
       baseAddress = getBaseAddress(XCL_PERF_MON_MEMORY,s);
@@ -320,34 +328,30 @@ namespace xdp {
         counterResults.SampleIntervalUsec = sampleInterval / xclGetDeviceClockFreqMHz(mHandle);
       }
 
-      size += read(baseAddress + XSPM_SAMPLE_WRITE_BYTES_OFFSET,
-                   &counterResults.WriteBytes[s], 4);
-      size += read(baseAddress + XSPM_SAMPLE_WRITE_TRANX_OFFSET,
-                   &counterResults.WriteTranx[s], 4);
-      size += read(baseAddress + XSPM_SAMPLE_WRITE_LATENCY_OFFSET,
-                   &counterResults.WriteLatency[s], 4);
-      size += read(baseAddress + XSPM_SAMPLE_READ_BYTES_OFFSET,
-                   &counterResults.ReadBytes[s], 4);
-      size += read(baseAddress + XSPM_SAMPLE_READ_TRANX_OFFSET,
-                   &counterResults.ReadTranx[s], 4);
-      size += read(baseAddress + XSPM_SAMPLE_READ_LATENCY_OFFSET,
-                   &counterResults.ReadLatency[s], 4);
-
-      // Read upper 32 bits (if available)
-      if (mProperties[s] & XSPM_64BIT_PROPERTY_MASK) {
-        uint64_t upper[6] = {};
-        size += read(baseAddress + XSPM_SAMPLE_WRITE_BYTES_UPPER_OFFSET,
-                     &upper[0], 4);
-        size += read(baseAddress + XSPM_SAMPLE_WRITE_TRANX_UPPER_OFFSET,
-                     &upper[1], 4);
-        size += read(baseAddress + XSPM_SAMPLE_WRITE_LATENCY_UPPER_OFFSET,
-                     &upper[2], 4);
-        size += read(baseAddress + XSPM_SAMPLE_READ_BYTES_UPPER_OFFSET,
-                     &upper[3], 4);
-        size += read(baseAddress + XSPM_SAMPLE_READ_TRANX_UPPER_OFFSET,
-                     &upper[4], 4);
-        size += read(baseAddress + XSPM_SAMPLE_READ_LATENCY_UPPER_OFFSET,
-                     &upper[5], 4);
+      // Lower 32 bits are followed by the upper 32 bits (if available)
+      bool is64Bit = (mProperties[s] & XSPM_64BIT_PROPERTY_MASK);
+      uint64_t lastOffset = is64Bit ? XSPM_SAMPLE_READ_LATENCY_UPPER_OFFSET
+                                    : XSPM_SAMPLE_READ_LATENCY_OFFSET;
+      size += read(baseAddress + XSPM_SAMPLE_WRITE_BYTES_OFFSET, block,
+                   lastOffset + 4 - XSPM_SAMPLE_WRITE_BYTES_OFFSET);
+
+      const uint64_t first = XSPM_SAMPLE_WRITE_BYTES_OFFSET;
+      counterResults.WriteBytes[s]   = reg(first, XSPM_SAMPLE_WRITE_BYTES_OFFSET);
+      counterResults.WriteTranx[s]   = reg(first, XSPM_SAMPLE_WRITE_TRANX_OFFSET);
+      counterResults.WriteLatency[s] = reg(first, XSPM_SAMPLE_WRITE_LATENCY_OFFSET);
+      counterResults.ReadBytes[s]    = reg(first, XSPM_SAMPLE_READ_BYTES_OFFSET);
+      counterResults.ReadTranx[s]    = reg(first, XSPM_SAMPLE_READ_TRANX_OFFSET);
+      counterResults.ReadLatency[s]  = reg(first, XSPM_SAMPLE_READ_LATENCY_OFFSET);
+
+      if (is64Bit) {
+        uint64_t upper[6] = {
+          reg(first, XSPM_SAMPLE_WRITE_BYTES_UPPER_OFFSET),
+          reg(first, XSPM_SAMPLE_WRITE_TRANX_UPPER_OFFSET),
+          reg(first, XSPM_SAMPLE_WRITE_LATENCY_UPPER_OFFSET),
+          reg(first, XSPM_SAMPLE_READ_BYTES_UPPER_OFFSET),
+          reg(first, XSPM_SAMPLE_READ_TRANX_UPPER_OFFSET),
+          reg(first, XSPM_SAMPLE_READ_LATENCY_UPPER_OFFSET)
+        };
 
         counterResults.WriteBytes[s]   += (upper[0] << 32);
         counterResults.WriteTranx[s]   += (upper[1] << 32);
@@ -384,9 +388,9 @@ namespace xdp {
     numSlots = getNumberSlots(XCL_PERF_MON_ACCEL);
     for (uint32_t s=0; s < numSlots; s++) {
       baseAddress = getBaseAddress(XCL_PERF_MON_ACCEL,s);
-      uint32_t version = 0;
-      size += read(baseAddress, &version, 4);
       if (mVerbose) {
+        uint32_t version = 0;
+        size += read(baseAddress, &version, 4);
         std::cout << "Accelerator Monitor Core Version : " << version << std::endl;
       }
 
@@ -398,26 +402,27 @@ namespace xdp {
         std::cout << "Accelerator Monitor Sample Interval : " << sampleInterval << std::endl;
       }
 
-      size += read(baseAddress + XSAM_ACCEL_EXECUTION_COUNT_OFFSET,
-                   &counterResults.CuExecCount[s], 4);
-      size += read(baseAddress + XSAM_ACCEL_EXECUTION_CYCLES_OFFSET,
-                   &counterResults.CuExecCycles[s], 4);
-      size += read(baseAddress + XSAM_ACCEL_MIN_EXECUTION_CYCLES_OFFSET,
-                   &counterResults.CuMinExecCycles[s], 4);
-      size += read(baseAddress + XSAM_ACCEL_MAX_EXECUTION_CYCLES_OFFSET,
-                   &counterResults.CuMaxExecCycles[s], 4);
-
-      // Read upper 32 bits (if available)
-      if (mAccelmonProperties[s] & XSAM_64BIT_PROPERTY_MASK) {
-        uint64_t upper[4] = {};
-        size += read(baseAddress + XSAM_ACCEL_EXECUTION_COUNT_UPPER_OFFSET,
-                     &upper[0], 4);
-        size += read(baseAddress + XSAM_ACCEL_EXECUTION_CYCLES_UPPER_OFFSET,
-                     &upper[1], 4);
-        size += read(baseAddress + XSAM_ACCEL_MIN_EXECUTION_CYCLES_UPPER_OFFSET,
-                     &upper[2], 4);
-        size += read(baseAddress + XSAM_ACCEL_MAX_EXECUTION_CYCLES_UPPER_OFFSET,
-                     &upper[3], 4);
+      // Stall counters sit between the execution counters, upper 32 bits
+      // (if available) follow them
+      bool is64Bit = (mAccelmonProperties[s] & XSAM_64BIT_PROPERTY_MASK);
+      uint64_t lastOffset = is64Bit ? XSAM_ACCEL_MAX_EXECUTION_CYCLES_UPPER_OFFSET
+                                    : XSAM_ACCEL_MAX_EXECUTION_CYCLES_OFFSET;
+      size += read(baseAddress + XSAM_ACCEL_EXECUTION_COUNT_OFFSET, block,
+                   lastOffset + 4 - XSAM_ACCEL_EXECUTION_COUNT_OFFSET);
+
+      const uint64_t first = XSAM_ACCEL_EXECUTION_COUNT_OFFSET;
+      counterResults.CuExecCount[s]     = reg(first, XSAM_ACCEL_EXECUTION_COUNT_OFFSET);
+      counterResults.CuExecCycles[s]    = reg(first, XSAM_ACCEL_EXECUTION_CYCLES_OFFSET);
+      counterResults.CuMinExecCycles[s] = reg(first, XSAM_ACCEL_MIN_EXECUTION_CYCLES_OFFSET);
+      counterResults.CuMaxExecCycles[s] = reg(first, XSAM_ACCEL_MAX_EXECUTION_CYCLES_OFFSET);
+
+      if (is64Bit) {
+        uint64_t upper[4] = {
+          reg(first, XSAM_ACCEL_EXECUTION_COUNT_UPPER_OFFSET),
+          reg(first, XSAM_ACCEL_EXECUTION_CYCLES_UPPER_OFFSET),
+          reg(first, XSAM_ACCEL_MIN_EXECUTION_CYCLES_UPPER_OFFSET),
+          reg(first, XSAM_ACCEL_MAX_EXECUTION_CYCLES_UPPER_OFFSET)
+        };
 
         counterResults.CuExecCount[s]     += (upper[0] << 32);
         counterResults.CuExecCycles[s]    += (upper[1] << 32);
@@ -443,12 +448,9 @@ namespace xdp {
 
       // Check Stall bit
       if (mAccelmonProperties[s] & XSAM_STALL_PROPERTY_MASK) {
-        size += read(baseAddress + XSAM_ACCEL_STALL_INT_OFFSET,
-                     &counterResults.CuStallIntCycles[s], 4);
-        size += read(baseAddress + XSAM_ACCEL_STALL_STR_OFFSET,
-                     &counterResults.CuStallStrCycles[s], 4);
-        size += read(baseAddress + XSAM_ACCEL_STALL_EXT_OFFSET,
-                     &counterResults.CuStallExtCycles[s], 4);
+        counterResults.CuStallIntCycles[s] = reg(first, XSAM_ACCEL_STALL_INT_OFFSET);
+        counterResults.CuStallStrCycles[s] = reg(first, XSAM_ACCEL_STALL_STR_OFFSET);
+        counterResults.CuStallExtCycles[s] = reg(first, XSAM_ACCEL_STALL_EXT_OFFSET);
         if (mVerbose) {
           std::cout << "Stall Counters enabled : " << std::endl;
           std::cout << "Reading Accelerator Monitor... CuStallIntCycles : " << counterResults.CuStallIntCycles[s] << std::endl;
@@ -469,16 +471,16 @@ namespace xdp {
       // Sample Register
       size += read(baseAddress + XSSPM_SAMPLE_OFFSET,
                    &sampleInterval, 4);
-      size += read(baseAddress + XSSPM_NUM_TRANX_OFFSET,
-                   &counterResults.StrNumTranx[s], 8);
-      size += read(baseAddress + XSSPM_DATA_BYTES_OFFSET,
-                   &counterResults.StrDataBytes[s], 8);
-      size += read(baseAddress + XSSPM_BUSY_CYCLES_OFFSET,
-                   &counterResults.StrBusyCycles[s], 8);
-      size += read(baseAddress + XSSPM_STALL_CYCLES_OFFSET,
-                   &counterResults.StrStallCycles[s], 8);
-      size += read(baseAddress + XSSPM_STARVE_CYCLES_OFFSET,
-                   &counterResults.StrStarveCycles[s], 8);
+
+      // All stream counters are 64 bit
+      uint64_t counters[5] = {};
+      size += read(baseAddress + XSSPM_NUM_TRANX_OFFSET, counters,
+                   XSSPM_STARVE_CYCLES_OFFSET + 8 - XSSPM_NUM_TRANX_OFFSET);
+      counterResults.StrNumTranx[s]     = counters[(XSSPM_NUM_TRANX_OFFSET - XSSPM_NUM_TRANX_OFFSET) / 8];
+      counterResults.StrDataBytes[s]    = counters[(XSSPM_DATA_BYTES_OFFSET - XSSPM_NUM_TRANX_OFFSET) / 8];
+      counterResults.StrBusyCycles[s]   = counters[(XSSPM_BUSY_CYCLES_OFFSET - XSSPM_NUM_TRANX_OFFSET) / 8];
+      counterResults.StrStallCycles[s]  = counters[(XSSPM_STALL_CYCLES_OFFSET - XSSPM_NUM_TRANX_OFFSET) / 8];
+      counterResults.StrStarveCycles[s] = counters[(XSSPM_STARVE_CYCLES_OFFSET - XSSPM_NUM_TRANX_OFFSET) / 8];
       if (mVerbose) {
         std::cout << "Reading AXI Stream Monitor... SlotNum : " << s << std::endl;
         std::cout << "Reading AXI Stream Monitor... NumTranx : " << counterResults.StrNumTranx[s] << std::endl;
@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2019-2020, Xilinx Inc - All rights reserved
+ * Xilinx Debug & Profile (XDP) APIs
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "device_trace_offload.h"
+#include "xcl_perfmon_parameters.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <sys/mman.h>
+
+namespace xdp {
+
+const uint32_t DeviceTraceOffload::CHUNK_SAMPLES;
+const uint32_t DeviceTraceOffload::CLOCK_TRAIN_WORDS;
+const uint32_t DeviceTraceOffload::OFFLOAD_INTERVAL_MS;
+
+DeviceTraceOffload::DeviceTraceOffload(xclDeviceHandle handle, int ip_index,
+                                       uint64_t size, callback cb) :
+device_handle(handle),
+s2mm(handle, ip_index),
+bo_size(size & ~static_cast<uint64_t>(TS2MM_WORD_BYTES - 1)),
+log_trace(cb),
+bo_handle(NULLBO),
+host_buf(nullptr),
+words_read(0),
+overrun(false),
+word_num(0),
+first_timestamp(0),
+chunk(new xclTraceResultsVector),
+running(false) {
+    std::memset(training, 0, sizeof(training));
+    chunk->mLength = 0;
+}
+
+DeviceTraceOffload::~DeviceTraceOffload() {
+    stop();
+    if (host_buf) {
+        munmap(host_buf, bo_size);
+    }
+    if (bo_handle != NULLBO) {
+        xclFreeBO(device_handle, bo_handle);
+    }
+}
+
+bool DeviceTraceOffload::start() {
+    if (!bo_size) {
+        return false;
+    }
+    s2mm.map();
+    if (!s2mm.is_mapped()) {
+        return false;
+    }
+
+    bo_handle = xclAllocBO(device_handle, bo_size, 0, s2mm.get_mem_index());
+    if (bo_handle == NULLBO) {
+        s2mm.show_warning("Cannot allocate trace buffer");
+        return false;
+    }
+    void* ptr = xclMapBO(device_handle, bo_handle, false);
+    xclBOProperties props;
+    if (!ptr || ptr == MAP_FAILED || xclGetBOProperties(device_handle, bo_handle, &props)) {
+        s2mm.show_warning("Cannot map trace buffer");
+        if (ptr && ptr != MAP_FAILED) {
+            munmap(ptr, bo_size);
+        }
+        xclFreeBO(device_handle, bo_handle);
+        bo_handle = NULLBO;
+        return false;
+    }
+    host_buf = static_cast<uint64_t*>(ptr);
+
+    s2mm.init(bo_size, props.paddr, true);
+    running = true;
+    offload_thread = std::thread(&DeviceTraceOffload::offload_loop, this);
+    return true;
+}
+
+void DeviceTraceOffload::stop() {
+    {
+        std::lock_guard<std::mutex> lock(offload_mutex);
+        if (!running) {
+            return;
+        }
+        running = false;
+    }
+    offload_cv.notify_all();
+    offload_thread.join();
+
+    // Last trace written before the device stopped
+    read_trace();
+    s2mm.reset();
+}
+
+void DeviceTraceOffload::offload_loop() {
+    std::unique_lock<std::mutex> lock(offload_mutex);
+    while (running) {
+        lock.unlock();
+        read_trace();
+        lock.lock();
+        offload_cv.wait_for(lock, std::chrono::milliseconds(OFFLOAD_INTERVAL_MS),
+                            [this] { return !running; });
+    }
+}
+
+void DeviceTraceOffload::read_trace() {
+    /**
+     * The word count of the IP is cumulative, so the part of the
+     * buffer not consumed yet is [words_read, written) modulo the
+     * buffer size. If the device got more than a whole buffer ahead
+     * the oldest trace is lost, skip to the newer half of the buffer
+     * which is furthest from being overwritten again.
+     */
+    uint64_t buf_words = bo_size / TS2MM_WORD_BYTES;
+    uint64_t written = s2mm.get_word_count();
+    if (written - words_read > buf_words) {
+        if (!overrun) {
+            s2mm.show_warning("Trace buffer overrun, device trace is incomplete. "
+                              "Please increase trace_buffer_size.");
+            overrun = true;
+        }
+        words_read = written - buf_words / 2;
+    }
+
+    while (words_read < written) {
+        uint64_t offset = words_read % buf_words;
+        uint64_t count = std::min(written - words_read, buf_words - offset);
+        if (xclSyncBO(device_handle, bo_handle, XCL_BO_SYNC_BO_FROM_DEVICE,
+                      count * TS2MM_WORD_BYTES, offset * TS2MM_WORD_BYTES)) {
+            break;
+        }
+        parse(host_buf + offset, count);
+        words_read += count;
+    }
+    flush_chunk();
+}
+
+void DeviceTraceOffload::parse(const uint64_t* words, uint64_t count) {
+    /**
+     * Same packet format as the trace FIFO, see xclPerfMonReadTrace.
+     * The first CLOCK_TRAIN_WORDS words are two clock training results
+     * of four words each, every word after that is one event.
+     */
+    for (uint64_t i = 0; i < count; i++, word_num++) {
+        uint64_t temp = words[i];
+        if (!temp) {
+            continue;
+        }
+        if (word_num == 0) {
+            first_timestamp = temp & 0x1FFFFFFFFFFF;
+        }
+
+        if (word_num < CLOCK_TRAIN_WORDS) {
+            xclTraceResults& results = training[word_num / 4];
+            int mod = word_num % 4;
+            if (mod == 0) {
+                uint64_t currentTimestamp = temp & 0x1FFFFFFFFFFF;
+                if (currentTimestamp >= first_timestamp)
+                    results.Timestamp = currentTimestamp - first_timestamp;
+                else
+                    results.Timestamp = currentTimestamp + (0x1FFFFFFFFFFF - first_timestamp);
+            }
+            results.HostTimestamp |= (((temp >> 45) & 0xFFFF) << (16 * mod));
+            continue;
+        }
+
+        if (chunk->mLength == 0) {
+            chunk->mArray[0] = training[0];
+            chunk->mArray[1] = training[1];
+            chunk->mLength = 2;
+        }
+        xclTraceResults& results = chunk->mArray[chunk->mLength++];
+        std::memset(&results, 0, sizeof(xclTraceResults));
+        results.Timestamp = (temp & 0x1FFFFFFFFFFF) - first_timestamp;
+        results.EventType = ((temp >> 45) & 0xF) ? XCL_PERF_MON_END_EVENT :
+            XCL_PERF_MON_START_EVENT;
+        results.TraceID = (temp >> 49) & 0xFFF;
+        results.Reserved = (temp >> 61) & 0x1;
+        results.Overflow = (temp >> 62) & 0x1;
+        results.Error = (temp >> 63) & 0x1;
+        results.EventID = XCL_PERF_MON_HW_EVENT;
+        results.EventFlags = ((temp >> 45) & 0xF) | ((temp >> 57) & 0x10);
+
+        if (chunk->mLength == CHUNK_SAMPLES) {
+            flush_chunk();
+        }
+    }
+}
+
+void DeviceTraceOffload::flush_chunk() {
+    // Chunks stay below the FIFO size the parser assumes when there is
+    // no trace FIFO, so they are not taken for a full FIFO
+    if (chunk->mLength == 0) {
+        return;
+    }
+    log_trace(*chunk);
+    chunk->mLength = 0;
+}
+
+} //  xdp
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2019-2020, Xilinx Inc - All rights reserved
+ * Xilinx Debug & Profile (XDP) APIs
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef XDP_PROFILE_DEVICE_TRACE_OFFLOAD_H_
+#define XDP_PROFILE_DEVICE_TRACE_OFFLOAD_H_
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "traceS2MM.h"
+#include "xclperf.h"
+
+namespace xdp {
+
+/**
+ * DeviceTraceOffload
+ *
+ * Description:
+ *
+ * This class continuously moves device trace out of a circular buffer
+ * in device memory that a TraceS2MM IP writes to. A background thread
+ * syncs the newly written part of the buffer to the host every few
+ * milliseconds, parses the trace words and hands them to a callback in
+ * the same xclTraceResultsVector format the trace FIFO read produces,
+ * so the rest of the trace path is unchanged.
+ *
+ * Note:
+ *
+ * Clock training words are only expected at the start of the trace,
+ * every vector handed to the callback starts with them, followed by
+ * at most CHUNK_SAMPLES - 2 events.
+ */
+class DeviceTraceOffload {
+public:
+    typedef std::function<void(xclTraceResultsVector&)> callback;
+
+    /**
+     * The constructor takes a device handle, the debug_ip_layout index
+     * of the TraceS2MM IP, the size in bytes of the trace buffer to
+     * allocate and the callback the parsed trace is logged with.
+     */
+    DeviceTraceOffload(xclDeviceHandle handle, int ip_index, uint64_t bo_size, callback cb);
+
+    /**
+     * The destructor stops offloading and frees the trace buffer.
+     */
+    ~DeviceTraceOffload();
+
+    /**
+     * The start API allocates and maps the trace buffer, starts the IP
+     * and the offload thread. It has to be called before trace is
+     * started on the device since clock training goes to the buffer.
+     * Returns false if no trace can be offloaded.
+     */
+    bool start();
+
+    /**
+     * The stop API stops the offload thread and drains what is left in
+     * the buffer. Safe to call more than once.
+     */
+    void stop();
+
+private:
+    static const uint32_t CHUNK_SAMPLES = 4096;
+    static const uint32_t CLOCK_TRAIN_WORDS = 8;
+    static const uint32_t OFFLOAD_INTERVAL_MS = 10;
+
+    void offload_loop();
+    void read_trace();
+    void parse(const uint64_t* words, uint64_t count);
+    void flush_chunk();
+
+    xclDeviceHandle device_handle; /** < the xrt device handle from the hal layer */
+    TraceS2MM s2mm; /** < the trace offload IP */
+    uint64_t bo_size; /** < size of the trace buffer in bytes */
+    callback log_trace; /** < receives the parsed trace */
+
+    unsigned int bo_handle; /** < the trace buffer */
+    uint64_t* host_buf; /** < host mapping of the trace buffer */
+    uint64_t words_read; /** < trace words of the buffer consumed so far */
+    bool overrun; /** < the device has overwritten unread trace */
+
+    uint64_t word_num; /** < index of the next trace word in the trace stream */
+    uint64_t first_timestamp; /** < device timestamp of the first trace word */
+    xclTraceResults training[2]; /** < clock training results */
+    std::unique_ptr<xclTraceResultsVector> chunk; /** < trace passed to the callback */
+
+    std::thread offload_thread;
+    std::mutex offload_mutex;
+    std::condition_variable offload_cv;
+    bool running;
+};
+
+} //  xdp
+
+#endif
@@ -21,6 +21,7 @@
 #include <stdexcept>
 #include <fstream>
 #include <iostream>
+#include <vector>
 #include "xclhal2.h"
 #include "xclbin.h"
 
@@ -58,7 +59,7 @@ public:
      * The exclusive access should be release in the destructor
      * to prevent potential card hang.
      */
-    ~ProfileIP();
+    virtual ~ProfileIP();
 
     /**
      * The request_exclusive_ip_access API tries to claim exclusive
@@ -125,6 +126,25 @@ public:
      */
     void show_warning(std::string reason);
 
+    /**
+     * The read_debug_ip_layout API reads the raw debug_ip_layout of
+     * the device into buffer, so that users of this class can find
+     * the index of the IP they need before constructing it. Returns
+     * false if the layout cannot be read.
+     */
+    static bool read_debug_ip_layout(xclDeviceHandle handle, std::vector<char>& buffer);
+
+    /**
+     * The get_properties API returns the m_properties byte of the IP
+     * in debug_ip_layout, valid once the IP is mapped.
+     */
+    uint8_t get_properties() const { return ip_properties; }
+
+    /**
+     * The is_mapped API tells if the IP could be mapped and accessed.
+     */
+    bool is_mapped() const { return mapped; }
+
 private:
     xclDeviceHandle device_handle; /** < the xrt device handle from the hal layer */
     uint64_t mapped_address; /** < the mapped address in user space used 
@@ -133,6 +153,7 @@ private:
     bool exclusive; /** < a flag indicating if the IP has exclusive access */
     int ip_index; /** < the index of the IP in debug_ip_layout */
     std::string ip_name; /** < the string name of the IP for better debuggability */ 
+    uint8_t ip_properties; /** < the properties of the IP in debug_ip_layout */
 
     /**
      * TODO: the exclusive context from hal
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2019-2020, Xilinx Inc - All rights reserved
+ * Xilinx Debug & Profile (XDP) APIs
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "traceS2MM.h"
+#include "xcl_perfmon_parameters.h"
+
+namespace xdp {
+
+TraceS2MM::TraceS2MM(xclDeviceHandle handle, int index) :
+ProfileIP(handle, index) {
+}
+
+int TraceS2MM::find(xclDeviceHandle handle) {
+    std::vector<char> buffer;
+    if (!read_debug_ip_layout(handle, buffer)) {
+        return -1;
+    }
+    debug_ip_layout* layout = reinterpret_cast<debug_ip_layout*>(buffer.data());
+    for (int i = 0; i < layout->m_count; i++) {
+        if (layout->m_debug_ip_data[i].m_type == TRACE_S2MM) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void TraceS2MM::init(uint64_t bo_size, uint64_t buf_addr, bool circular) {
+    reset();
+
+    uint64_t words = bo_size / TS2MM_WORD_BYTES;
+    uint32_t reg = static_cast<uint32_t>(words);
+    write(TS2MM_COUNT_LOW, 4, &reg);
+    reg = static_cast<uint32_t>(words >> 32);
+    write(TS2MM_COUNT_HIGH, 4, &reg);
+
+    reg = static_cast<uint32_t>(buf_addr);
+    write(TS2MM_WRITE_OFFSET_LOW, 4, &reg);
+    reg = static_cast<uint32_t>(buf_addr >> 32);
+    write(TS2MM_WRITE_OFFSET_HIGH, 4, &reg);
+
+    reg = circular ? 1 : 0;
+    write(TS2MM_CIRCULAR_BUF, 4, &reg);
+
+    reg = TS2MM_AP_START;
+    write(TS2MM_AP_CTRL, 4, &reg);
+}
+
+void TraceS2MM::reset() {
+    uint32_t reg = 0x1;
+    write(TS2MM_RST, 4, &reg);
+    reg = 0x0;
+    write(TS2MM_RST, 4, &reg);
+}
+
+uint64_t TraceS2MM::get_word_count() {
+    uint32_t low = 0;
+    uint32_t high = 0;
+    uint32_t check = 0;
+    // The IP keeps writing, retry if the low word wrapped in between
+    read(TS2MM_WRITTEN_HIGH, 4, &high);
+    do {
+        check = high;
+        read(TS2MM_WRITTEN_LOW, 4, &low);
+        read(TS2MM_WRITTEN_HIGH, 4, &high);
+    } while (high != check);
+    return (static_cast<uint64_t>(high) << 32) | low;
+}
+
+} //  xdp
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2019-2020, Xilinx Inc - All rights reserved
+ * Xilinx Debug & Profile (XDP) APIs
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef XDP_PROFILE_DEVICE_TRACE_S2MM_H_
+#define XDP_PROFILE_DEVICE_TRACE_S2MM_H_
+
+#include "profile_ip_access.h"
+
+namespace xdp {
+
+/**
+ * TraceS2MM (trace offload IP)
+ *
+ * Description:
+ *
+ * This class represents the trace data mover that writes the device
+ * trace stream to a buffer in device memory. It replaces the AXI
+ * trace FIFO on designs built for trace offload to memory, the trace
+ * buffer itself is owned by the caller.
+ */
+class TraceS2MM : public ProfileIP {
+public:
+
+    /**
+     * The constructor takes the same arguments as ProfileIP, the
+     * index is usually found with find().
+     */
+    TraceS2MM(xclDeviceHandle handle /** < [in] the xrt hal device handle */,
+                int index /** < [in] the index of the IP in debug_ip_layout */);
+
+    /**
+     * The find API returns the debug_ip_layout index of the first
+     * TRACE_S2MM IP of the device, or -1 if there is none.
+     */
+    static int find(xclDeviceHandle handle);
+
+    /**
+     * The init API resets the IP, points it to the buffer of bo_size
+     * bytes at device address buf_addr and starts it. In circular mode
+     * the IP wraps around to the start of the buffer when it is full,
+     * otherwise it stops writing.
+     */
+    void init(uint64_t bo_size, uint64_t buf_addr, bool circular);
+
+    /**
+     * The reset API stops the IP and clears its counters.
+     */
+    void reset();
+
+    /**
+     * The get_word_count API returns the number of 64 bit trace words
+     * written by the IP since init. The count keeps growing when the
+     * IP wraps around in circular mode.
+     */
+    uint64_t get_word_count();
+
+    /**
+     * The get_mem_index API returns the memory bank the IP writes to.
+     */
+    uint8_t get_mem_index() const { return get_properties() >> 1; }
+};
+
+} //  xdp
+
+#endif
@@ -55,13 +55,11 @@ namespace xdp {
     // Analyzer assumes ID 0 as blank
     mCuEventID = 1;
 
-    // Since device timestamps are in cycles and host timestamps are in msec,
-    // then the slope of the line to convert from device to host timestamps
-    // is in msec/cycle
-    for (int i=0; i < XCL_PERF_MON_TOTAL_PROFILE; i++) {
-      mTrainSlope[i] = 1000.0 / mTraceClockRateMHz;
-      mTrainOffset[i] = 0.0;
-    }
+    // Device timestamps are in cycles and host timestamps are in msec,
+    // so the slope of the line from device to host timestamps is in
+    // msec/cycle
+    mClockModel.slope = 1.0 / (mTraceClockRateMHz * 1000.0);
+    mClockModel.offset = 0.0;
   }
 
   // Destructor
@@ -118,45 +116,37 @@ namespace xdp {
 Please use 'coarse' option for data transfer trace or turn off Stall profiling");
     }
 
+    // ***************
+    // Clock Training
+    // ***************
+    trainDeviceHostTimestamps(deviceName, traceVector);
+
+    // Decode the whole chunk up front, then convert all timestamps
+    // with the trained line in one pass
+    decodeTraceBatch(traceVector);
+    convertTraceBatchTimestamps();
+
+    // Direction of stream slots, looked up once per chunk
+    int streamSlotRead[XSSPM_MAX_NUMBER_SLOTS];
+    std::fill_n(streamSlotRead, XSSPM_MAX_NUMBER_SLOTS, -1);
+
     uint64_t timestamp = 0;
     uint64_t startTime = 0;
-    // x, y coordinates used for clock training
-    double y1=0;
-    double y2=0;
-    double x1=0;
-    double x2=0;
     DeviceTrace kernelTrace;
     // Parse Start
-    for (unsigned int i=0; i < traceVector.mLength; i++) {
+    for (unsigned int i=1; i < traceVector.mLength; i++) {
       auto& trace = traceVector.mArray[i];
       XDP_LOG("[profile_device] Parsing trace sample %d...\n", i);
 
-      timestamp = trace.Timestamp;
-      // ***************
-      // Clock Training
-      // ***************
-      // clock training relation is linear within small durations (1 sec)
-      if (i == 0) {
-        y1 = static_cast <double> (trace.HostTimestamp);
-        x1 = static_cast <double> (timestamp);
-        continue;
-      }
-      if (i == 1) {
-        y2 = static_cast <double> (trace.HostTimestamp);
-        x2 = static_cast <double> (timestamp);
-        mTrainSlope[type] = (y2 - y1) / (x2 - x1);
-        mTrainOffset[type] = y2 - mTrainSlope[type] * x2;
-        trainDeviceHostTimestamps(deviceName, type);
-      }
-      if (trace.Overflow == 1)
-        timestamp += LOOP_ADD_TIME_SPM;
+      timestamp = mBatch.Timestamp[i];
+      double hostTime = mBatch.HostTime[i];
 
       uint32_t s = 0;
-      bool SAMPacket = (trace.TraceID >= MIN_TRACE_ID_SAM && trace.TraceID <= MAX_TRACE_ID_SAM);
-      bool SPMPacket = (trace.TraceID >= MIN_TRACE_ID_SPM && trace.TraceID <= MAX_TRACE_ID_SPM);
-      bool SSPMPacket = (trace.TraceID >= MIN_TRACE_ID_SSPM && trace.TraceID < MAX_TRACE_ID_SSPM);
-      if (!SAMPacket && !SPMPacket && !SSPMPacket)
+      uint8_t packet = mBatch.Packet[i];
+      if (packet == PACKET_NONE)
         continue;
+      bool SAMPacket = (packet == PACKET_SAM);
+      bool SSPMPacket = (packet == PACKET_SSPM);
 
       if (SSPMPacket) {
         s = trace.TraceID - MIN_TRACE_ID_SSPM;
@@ -165,8 +155,11 @@ Please use 'coarse' option for data transfer trace or turn off Stall profiling")
         bool stallEvent =  trace.EventFlags & 0x4;
         bool starveEvent = trace.EventFlags & 0x2;
         bool isStart =     trace.EventFlags & 0x1;
-        unsigned ipInfo = mPluginHandle->getProfileSlotProperties(XCL_PERF_MON_STR, deviceName, s);
-        bool isRead = (ipInfo & 0x2) ? true : false;
+        if (streamSlotRead[s] < 0) {
+          unsigned ipInfo = mPluginHandle->getProfileSlotProperties(XCL_PERF_MON_STR, deviceName, s);
+          streamSlotRead[s] = (ipInfo & 0x2) ? 1 : 0;
+        }
+        bool isRead = (streamSlotRead[s] == 1);
         if (isStart) {
           if (txEvent)
             mStreamTxStarts[s].push_back(timestamp);
@@ -208,7 +201,7 @@ Please use 'coarse' option for data transfer trace or turn off Stall profiling")
           streamTrace.EndTime = timestamp;
           streamTrace.BurstLength = timestamp - startTime + 1;
           streamTrace.Start = convertDeviceToHostTimestamp(startTime, type, deviceName);
-          streamTrace.End = convertDeviceToHostTimestamp(timestamp, type, deviceName);
+          streamTrace.End = hostTime;
           resultVector.push_back(streamTrace);
           mStreamMonLastTranx[s] = timestamp;
         } // !isStart
@@ -225,7 +218,7 @@ Please use 'coarse' option for data transfer trace or turn off Stall profiling")
         kernelTrace.EndTime = timestamp;
         kernelTrace.BurstLength = 0;
         kernelTrace.NumBytes = 0;
-        kernelTrace.End = convertDeviceToHostTimestamp(timestamp, type, deviceName);
+        kernelTrace.End = hostTime;
         if (cuEvent) {
           if (!(trace.EventFlags & XSAM_TRACE_CU_MASK)) {
             kernelTrace.Type = "Kernel";
@@ -309,7 +302,7 @@ Please use 'coarse' option for data transfer trace or turn off Stall profiling")
           readTrace.EndTime = timestamp;
           readTrace.BurstLength = timestamp - startTime + 1;
           readTrace.Start = convertDeviceToHostTimestamp(startTime, type, deviceName);
-          readTrace.End = convertDeviceToHostTimestamp(timestamp, type, deviceName);
+          readTrace.End = hostTime;
           resultVector.push_back(readTrace);
           mPerfMonLastTranx[s] = timestamp;
         }
@@ -337,7 +330,7 @@ Please use 'coarse' option for data transfer trace or turn off Stall profiling")
           writeTrace.EndTime = timestamp;
           writeTrace.BurstLength = timestamp - startTime + 1;
           writeTrace.Start = convertDeviceToHostTimestamp(startTime, type, deviceName);
-          writeTrace.End = convertDeviceToHostTimestamp(timestamp, type, deviceName);
+          writeTrace.End = hostTime;
           resultVector.push_back(writeTrace);
           mPerfMonLastTranx[s] = timestamp;
         }
@@ -727,23 +720,56 @@ Please use 'coarse' option for data transfer trace or turn off Stall profiling")
 	  return std::string( result );
   }
 
-  // Complete training to convert device timestamp to host time domain
+  // Decode trace samples into struct of arrays
+  // NOTE: sample 0 is the first clock training sample and not an event
+  void TraceParser::decodeTraceBatch(const xclTraceResultsVector& traceVector) {
+    unsigned int n = traceVector.mLength;
+    mBatch.Timestamp.resize(n);
+    mBatch.HostTime.resize(n);
+    mBatch.Packet.resize(n);
+
+    uint64_t* timestamps = mBatch.Timestamp.data();
+    uint8_t* packets = mBatch.Packet.data();
+    for (unsigned int i=0; i < n; i++) {
+      const auto& trace = traceVector.mArray[i];
+      uint32_t id = trace.TraceID;
+      timestamps[i] = trace.Timestamp + (trace.Overflow ? LOOP_ADD_TIME_SPM : 0);
+      packets[i] = (id <= MAX_TRACE_ID_SPM) ? PACKET_SPM
+                 : (id >= MIN_TRACE_ID_SAM && id <= MAX_TRACE_ID_SAM) ? PACKET_SAM
+                 : (id >= MIN_TRACE_ID_SSPM && id < MAX_TRACE_ID_SSPM) ? PACKET_SSPM
+                 : PACKET_NONE;
+    }
+  }
+
+  // Bulk version of convertDeviceToHostTimestamp
+  void TraceParser::convertTraceBatchTimestamps() {
+    const double slope = mClockModel.slope;
+    const double offset = mClockModel.offset;
+    const uint64_t* timestamps = mBatch.Timestamp.data();
+    double* hostTimes = mBatch.HostTime.data();
+    size_t n = mBatch.Timestamp.size();
+    for (size_t i=0; i < n; i++)
+      hostTimes[i] = slope * (double)timestamps[i] + offset;
+  }
+
+  // First two samples of a chunk are the training pairs. They go to the
+  // device's ClockSync, which keeps one model across chunks instead of a
+  // line through the two pairs of each chunk.
   // NOTE: see description of PTP @ http://en.wikipedia.org/wiki/Precision_Time_Protocol
-  void TraceParser::trainDeviceHostTimestamps(std::string deviceName, xclPerfMonType type) {
-    using namespace std::chrono;
-    typedef duration<uint64_t, std::ratio<1, 1000000000>> duration_ns;
-    duration_ns time_span =
-        duration_cast<duration_ns>(high_resolution_clock::now().time_since_epoch());
-    uint64_t currentOffset = static_cast<uint64_t>(xrt::time_ns());
-    uint64_t currentTime = time_span.count();
-    mTrainProgramStart[type] = static_cast<double>(currentTime - currentOffset);
+  void TraceParser::trainDeviceHostTimestamps(const std::string& deviceName,
+      const xclTraceResultsVector& traceVector) {
+    auto& clockSync = ClockSync::get(deviceName);
+    clockSync.set_clock_mhz(mTraceClockRateMHz);
+    for (unsigned int i=0; i < 2 && i < traceVector.mLength; i++)
+      clockSync.add_training_pair(traceVector.mArray[i].Timestamp, traceVector.mArray[i].HostTimestamp);
+    mClockModel = clockSync.get_model();
   }
 
   // Convert device timestamp to host time domain (in msec)
   double TraceParser::convertDeviceToHostTimestamp(uint64_t deviceTimestamp, xclPerfMonType type,
-      const std::string& deviceName) { 
+      const std::string& deviceName) {
     // Return y = m*x + b with b relative to program start
-    return (mTrainSlope[type] * (double)deviceTimestamp)/1e6 + (mTrainOffset[type]-mTrainProgramStart[type])/1e6;
+    return mClockModel.slope * (double)deviceTimestamp + mClockModel.offset;
   }
 
 } // xdp
@@ -30,6 +30,7 @@
 #include "../config.h"
 #include "xdp/profile/plugin/base_plugin.h"
 #include "xdp/profile/core/rt_util.h"
+#include "clock_sync.h"
 
 namespace xdp {
   class DeviceTrace;
@@ -67,10 +68,6 @@ namespace xdp {
       }
       void setTraceClockFreqMHz(double clockRateMHz) {
         mTraceClockRateMHz = clockRateMHz;
-
-        // Update slope for conversion between device and host
-        for (int i=0; i < XCL_PERF_MON_TOTAL_PROFILE; i++)
-          mTrainSlope[i] = 1000.0 / clockRateMHz;
       }
       void setGlobalMemoryClockFreqMHz(double clockRateMHz) {
         mGlobalMemoryClockRateMHz = clockRateMHz;
@@ -99,8 +96,14 @@ namespace xdp {
       std::string dec2bin(uint32_t n);
       std::string dec2bin(uint32_t n, unsigned bits);
 
-      // Device/host timestamps: training and conversion
-      void trainDeviceHostTimestamps(std::string deviceName, xclPerfMonType type);
+      // Batched parsing: decode a chunk into mBatch, then convert its
+      // timestamps to host time in one pass
+      void decodeTraceBatch(const xclTraceResultsVector& traceVector);
+      void convertTraceBatchTimestamps();
+
+      // Device/host timestamps: training and conversion, see ClockSync
+      void trainDeviceHostTimestamps(const std::string& deviceName,
+          const xclTraceResultsVector& traceVector);
       double convertDeviceToHostTimestamp(uint64_t deviceTimestamp, xclPerfMonType type,
           const std::string& deviceName);
 
@@ -112,6 +115,22 @@ namespace xdp {
       }
       void ResetState();
 
+    private:
+      enum e_trace_packet : uint8_t {
+        PACKET_NONE = 0,
+        PACKET_SPM  = 1,
+        PACKET_SAM  = 2,
+        PACKET_SSPM = 3
+      };
+
+      // Decoded trace chunk (struct of arrays, reused between chunks)
+      struct TraceBatch {
+        std::vector<uint64_t> Timestamp;  // device cycles, overflow applied
+        std::vector<double> HostTime;     // msec
+        std::vector<uint8_t> Packet;      // e_trace_packet
+      };
+      TraceBatch mBatch;
+
     private:
       const double PCIE_DELAY_OFFSET_MSEC;
       uint32_t mCuEventID;
@@ -125,9 +144,8 @@ namespace xdp {
       double mDeviceClockRateMHz;
       double mGlobalMemoryClockRateMHz;
       double mEmuTraceMsecOneCycle;
-      double mTrainSlope[XCL_PERF_MON_TOTAL_PROFILE];
-      double mTrainOffset[XCL_PERF_MON_TOTAL_PROFILE];
-      double mTrainProgramStart[XCL_PERF_MON_TOTAL_PROFILE];
+      // Model of the device being parsed, fixed for the whole chunk
+      ClockSync::model mClockModel;
       uint64_t mAccelMonCuTime[XSAM_MAX_NUMBER_SLOTS]       = { 0 };
       uint64_t mAccelMonCuHostTime[XSAM_MAX_NUMBER_SLOTS]   = { 0 };
       uint64_t mAccelMonStallIntTime[XSAM_MAX_NUMBER_SLOTS] = { 0 };
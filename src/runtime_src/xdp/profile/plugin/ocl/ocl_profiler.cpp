@@ -57,6 +57,8 @@ namespace xdp {
 
   OCLProfiler::~OCLProfiler()
   {
+    waitDeviceProfilingSetup();
+    stopStallSampling();
     Plugin->setObjectsReleased(mEndDeviceProfilingCalled);
 
     if (!mEndDeviceProfilingCalled && applicationProfilingOn()) {
@@ -71,7 +73,32 @@ namespace xdp {
   }
 
   // Start device profiling
+  // Discovering the debug IPs and starting counters and trace is done on
+  // a separate thread, so it does not add to the time the application
+  // spends loading the program.  Users of the device profiling wait for
+  // it with waitDeviceProfilingSetup().
   void OCLProfiler::startDeviceProfiling(size_t numComputeUnits)
+  {
+    // Setup for a previous program must be done first
+    waitDeviceProfilingSetup();
+
+    std::lock_guard<std::mutex> lock(mDeviceSetupLock);
+    mDeviceSetup = std::async(std::launch::async,
+        &OCLProfiler::setupDeviceProfiling, this, numComputeUnits).share();
+  }
+
+  void OCLProfiler::waitDeviceProfilingSetup()
+  {
+    std::shared_future<void> setup;
+    {
+      std::lock_guard<std::mutex> lock(mDeviceSetupLock);
+      setup = mDeviceSetup;
+    }
+    if (setup.valid())
+      setup.wait();
+  }
+
+  void OCLProfiler::setupDeviceProfiling(size_t numComputeUnits)
   {
     auto platform = getclPlatformID();
     // Start counters
@@ -93,12 +120,29 @@ namespace xdp {
     }
 
     mProfileRunning = true;
+
+    // NOTE: We read from the counters to set a baseline for values and
+    // inform the reporting this is the first read after a program with
+    // binary. Otherwise, the counters will overflow.
+    if (deviceCountersProfilingOn()) {
+      std::lock_guard<std::mutex> lock(mDeviceCountersLock);
+      xoclp::platform::log_device_counters(platform, XCL_PERF_MON_MEMORY, true, true);
+    }
+
+    if (deviceCountersProfilingOn() && Plugin->getFlowMode() == xdp::RTUtil::DEVICE
+        && xrt::config::get_stall_sample_interval() > 0)
+      startStallSampling();
   }
 
   // End device profiling (for a given program)
   // Perform final read of counters and force flush of trace buffers
   void OCLProfiler::endDeviceProfiling()
   {
+    waitDeviceProfilingSetup();
+
+    // The final read below is the last sample
+    stopStallSampling();
+
     // Only needs to be called once
     if (mEndDeviceProfilingCalled)
    	  return;
@@ -149,21 +193,58 @@ namespace xdp {
   // Get device counters
   void OCLProfiler::getDeviceCounters(bool firstReadAfterProgram, bool forceReadCounters)
   {
+    waitDeviceProfilingSetup();
     if (!isProfileRunning() || !deviceCountersProfilingOn())
       return;
 
     XOCL_DEBUGF("getDeviceCounters: START (firstRead: %d, forceRead: %d)\n",
                  firstReadAfterProgram, forceReadCounters);
 
+    std::lock_guard<std::mutex> lock(mDeviceCountersLock);
     xoclp::platform::log_device_counters(getclPlatformID(),XCL_PERF_MON_MEMORY,
                                                 firstReadAfterProgram, forceReadCounters);
 
     XOCL_DEBUGF("getDeviceCounters: END\n");
   }
 
+  // Sampled stall profiling: read the counters periodically so the summary
+  // gets a stall breakdown per interval instead of only run totals
+  void OCLProfiler::startStallSampling()
+  {
+    if (mStallSampleThread.joinable())
+      return;
+
+    mStallSampleStop = false;
+    mStallSampleThread = std::thread(&OCLProfiler::sampleStalls, this);
+  }
+
+  void OCLProfiler::stopStallSampling()
+  {
+    if (!mStallSampleThread.joinable())
+      return;
+
+    {
+      std::lock_guard<std::mutex> lock(mStallSampleLock);
+      mStallSampleStop = true;
+    }
+    mStallSampleCondition.notify_one();
+    mStallSampleThread.join();
+  }
+
+  void OCLProfiler::sampleStalls()
+  {
+    auto interval = std::chrono::milliseconds(xrt::config::get_stall_sample_interval());
+    std::unique_lock<std::mutex> lock(mStallSampleLock);
+    while (!mStallSampleCondition.wait_for(lock, interval, [this] { return mStallSampleStop; })) {
+      std::lock_guard<std::mutex> countersLock(mDeviceCountersLock);
+      xoclp::platform::log_device_counters(getclPlatformID(), XCL_PERF_MON_MEMORY, false, true);
+    }
+  }
+
   // Get device trace
   void OCLProfiler::getDeviceTrace(bool forceReadTrace)
   {
+    waitDeviceProfilingSetup();
     auto platform = getclPlatformID();
     if (!isProfileRunning() ||
         (!deviceTraceProfilingOn() && !(Plugin->getFlowMode() == xdp::RTUtil::HW_EM) ))
@@ -213,6 +294,9 @@ namespace xdp {
     ProfileMgr->setTransferTrace(data_transfer_trace);
     ProfileMgr->setStallTrace(stall_trace);
 
+    if (xrt::config::get_live_telemetry())
+      ProfileMgr->enableLiveTelemetry();
+
     // Enable profile summary if profile is on
     std::string profileFile("profile_summary");
     ProfileMgr->turnOnFile(xdp::RTUtil::FILE_SUMMARY);
@@ -226,9 +310,19 @@ namespace xdp {
       timelineFile = "timeline_trace";
       ProfileMgr->turnOnFile(xdp::RTUtil::FILE_TIMELINE_TRACE);
     }
-    xdp::CSVTraceWriter* csvTraceWriter = new xdp::CSVTraceWriter(timelineFile, "Xilinx", Plugin.get());
-    TraceWriters.push_back(csvTraceWriter);
-    ProfileMgr->attach(csvTraceWriter);
+    std::string traceFormat = xrt::config::get_timeline_trace_format();
+    if (!timelineFile.empty() && traceFormat.find("binary") != std::string::npos) {
+      bool compress = (traceFormat.find("compressed") != std::string::npos);
+      xdp::BinaryTraceWriter* binaryTraceWriter =
+        new xdp::BinaryTraceWriter(timelineFile, "Xilinx", Plugin.get(), compress);
+      TraceWriters.push_back(binaryTraceWriter);
+      ProfileMgr->attach(binaryTraceWriter);
+    }
+    else {
+      xdp::CSVTraceWriter* csvTraceWriter = new xdp::CSVTraceWriter(timelineFile, "Xilinx", Plugin.get());
+      TraceWriters.push_back(csvTraceWriter);
+      ProfileMgr->attach(csvTraceWriter);
+    }
 
 #if 0
     // Not Used
@@ -301,6 +395,9 @@ namespace xdp {
         if (Plugin->getFlowMode() == RTUtil::DEVICE && numShellSlots > 0) {
           w->enableShellTables();
         }
+        if (Plugin->getFlowMode() == RTUtil::DEVICE && xrt::config::get_stall_sample_interval() > 0) {
+          w->enableStallSampleTable();
+        }
       }
     }
   }
@@ -20,12 +20,17 @@
 #include <CL/opencl.h>
 #include <string>
 #include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include "xocl_plugin.h"
 #include "xocl_profile.h"
 #include "xdp/profile/core/rt_util.h"
 #include "xdp/profile/writer/csv_profile.h"
 #include "xdp/profile/writer/csv_trace.h"
+#include "xdp/profile/writer/binary_trace.h"
 #include "xdp/profile/writer/unified_csv_profile.h"
 #include "xdp/profile/plugin/ocl/ocl_power_profile.h"
 
@@ -47,6 +52,7 @@ namespace xdp {
     void turnOnProfile(xdp::RTUtil::e_profile_mode mode);
     void turnOffProfile(xdp::RTUtil::e_profile_mode mode);
     void startDeviceProfiling(size_t numComputeUnits);
+    void waitDeviceProfilingSetup();
     void endDeviceProfiling();
     void getDeviceCounters(bool firstReadAfterProgram, bool forceReadCounters);
     void getDeviceTrace(bool forceReadTrace);
@@ -85,6 +91,10 @@ namespace xdp {
     void configureWriters();
     void logFinalTrace(xclPerfMonType type);
     void setTraceFooterString();
+    void setupDeviceProfiling(size_t numComputeUnits);
+    void startStallSampling();
+    void stopStallSampling();
+    void sampleStalls();
     bool isProfileRunning() {return mProfileRunning;}
     inline const int& getProfileFlag() { return ProfileFlags; }
     uint32_t getTimeDiffUsec(std::chrono::steady_clock::time_point start,
@@ -104,6 +114,16 @@ namespace xdp {
     std::shared_ptr<XoclPlugin> Plugin;
     std::unique_ptr<RTProfile> ProfileMgr;
     std::vector<std::unique_ptr<OclPowerProfile>> PowerProfileList;
+    // Periodic counter reads for the sampled stall breakdown
+    std::thread mStallSampleThread;
+    std::mutex mStallSampleLock;
+    std::condition_variable mStallSampleCondition;
+    bool mStallSampleStop = false;
+    // Serializes counter reads of the sampling thread and the host code
+    std::mutex mDeviceCountersLock;
+    // Device setup at program load, done off the application thread
+    std::shared_future<void> mDeviceSetup;
+    std::mutex mDeviceSetupLock;
   };
 
   /*
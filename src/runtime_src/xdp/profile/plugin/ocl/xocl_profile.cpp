@@ -17,6 +17,7 @@
 #include "xocl_profile.h"
 #include "ocl_profiler.h"
 #include "xdp/profile/config.h"
+#include "xrt/util/config_reader.h"
 #include "xclbin.h"
 
 namespace xdp { namespace xoclp {
@@ -505,6 +506,30 @@ startTrace(key k, xclPerfMonType type, size_t numComputeUnits)
   if (stallTrace & xdp::RTUtil::STALL_TRACE_STR)    traceOption   |= (0x1 << 3);
   if (stallTrace & xdp::RTUtil::STALL_TRACE_EXT)    traceOption   |= (0x1 << 4);
   XOCL_DEBUGF("Starting trace with option = 0x%x\n", traceOption);
+
+  // Designs with a trace offload IP have no trace FIFO, trace goes to a
+  // circular buffer in device memory that is drained in the background.
+  // The buffer has to be set up before startTrace does clock training.
+  data->mTraceOffload.reset();
+  auto halHandle = xdevice->getHalDeviceHandle();
+  if (type == XCL_PERF_MON_MEMORY && halHandle) {
+    auto handle = static_cast<xclDeviceHandle>(halHandle);
+    int index = xdp::TraceS2MM::find(handle);
+    if (index >= 0) {
+      std::string device_name = device->get_unique_name();
+      std::string binary_name = "binary";
+      if (device->is_active())
+        binary_name = device->get_xclbin().project_name();
+      uint64_t size = static_cast<uint64_t>(xrt::config::get_trace_buffer_size()) << 20;
+      auto offload = std::make_unique<xdp::DeviceTraceOffload>(handle, index, size,
+        [device_name, binary_name, type](xclTraceResultsVector& trace) {
+          OCLProfiler::Instance()->getProfileManager()->logDeviceTrace(device_name, binary_name, type, trace);
+        });
+      if (offload->start())
+        data->mTraceOffload = std::move(offload);
+    }
+  }
+
   xdevice->startTrace(type, traceOption);
 
   // Get/set clock freqs
@@ -585,6 +610,18 @@ startCounters(key k, xclPerfMonType type)
   data->mSampleIntervalMsec =
     OCLProfiler::Instance()->getProfileManager()->getSampleIntervalMsec();
 
+  // Sample all monitors in the background for external collectors
+  data->mCounterSampler.reset();
+  unsigned int sampleRate = xrt::config::get_device_counter_sample_rate();
+  if (type == XCL_PERF_MON_MEMORY && sampleRate > 0) {
+    auto sampler = std::make_unique<xdp::DeviceCounterSampler>(device->get_unique_name(),
+      [xdevice, type](xclCounterResults& results) { return xdevice->readCounters(type, results).get(); },
+      getProfileNumSlots(k, XCL_PERF_MON_MEMORY), getProfileNumSlots(k, XCL_PERF_MON_ACCEL),
+      getProfileNumSlots(k, XCL_PERF_MON_STR), deviceClockMHz, sampleRate);
+    if (sampler->start())
+      data->mCounterSampler = std::move(sampler);
+  }
+
   // Depends on Debug IP Layout data loaded in hal
   configureDataflow(k, XCL_PERF_MON_ACCEL);
   return CL_SUCCESS;
@@ -594,6 +631,9 @@ cl_int
 stopCounters(key k, xclPerfMonType type)
 {
   auto device = k;
+  auto data = get_data(k);
+  if (data->mCounterSampler)
+    data->mCounterSampler->stop();
   device->get_xrt_device()->stopCounters(type);
   return CL_SUCCESS;
 }
@@ -605,6 +645,16 @@ logTrace(key k, xclPerfMonType type, bool forceRead)
   auto device = k;
   auto xdevice = device->get_xrt_device();
 
+  // Offloaded trace is logged by the offload thread, clock training is
+  // only done at start.  Final read drains what is left.
+  if (data->mTraceOffload && type == XCL_PERF_MON_MEMORY) {
+    if (forceRead) {
+      data->mTraceOffload->stop();
+      data->mPerformingFlush = true;
+    }
+    return CL_SUCCESS;
+  }
+
   // Do clock training if enough time has passed
   // NOTE: once we start flushing FIFOs, we stop all training (no longer needed)
   std::chrono::steady_clock::time_point nowTime = std::chrono::steady_clock::now();
@@ -672,7 +722,11 @@ logCounters(key k, xclPerfMonType type, bool firstReadAfterProgram, bool forceRe
   if (forceRead || ((nowTime - data->mLastCountersSampleTime) > std::chrono::milliseconds(data->mSampleIntervalMsec))) {
     //warning : reading from the accelerator device only
     //read the device profile
-    xdevice->readCounters(type, data->mCounterResults);
+    // The sampler owns the counter reads while it runs
+    if (data->mCounterSampler)
+      data->mCounterSampler->read(data->mCounterResults);
+    else
+      xdevice->readCounters(type, data->mCounterResults);
     struct timespec now;
     int err = clock_gettime(CLOCK_MONOTONIC, &now);
     uint64_t timeNsec = (err < 0) ? 0 : (uint64_t) now.tv_sec * 1000000000UL + (uint64_t) now.tv_nsec;
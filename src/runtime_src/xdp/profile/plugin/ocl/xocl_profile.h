@@ -21,7 +21,9 @@
  * This file contains xocl core object helper code for profiling
  */
 
+#include "xdp/profile/device/counter_sampler.h"
 #include "xdp/profile/device/device_intf.h"
+#include "xdp/profile/device/device_trace_offload.h"
 #include "xclperf.h"
 #include "xcl_app_debug.h"
 #include "xocl/core/object.h"
@@ -149,6 +151,10 @@ struct data
   std::chrono::steady_clock::time_point mLastCountersSampleTime;
   std::chrono::steady_clock::time_point mLastTraceTrainingTime[XCL_PERF_MON_TOTAL_PROFILE];
   DeviceIntf mDeviceIntf;
+  // Set when device trace goes to a buffer in device memory instead of a FIFO
+  std::unique_ptr<xdp::DeviceTraceOffload> mTraceOffload;
+  // Set when device counters are sampled to shared memory
+  std::unique_ptr<xdp::DeviceCounterSampler> mCounterSampler;
 };
 
 void
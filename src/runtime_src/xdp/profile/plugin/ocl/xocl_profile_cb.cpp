@@ -136,6 +136,10 @@ cb_action_ndrange(xocl::event* event,cl_int status,const std::string& cu_name, c
     if (!isProfilingOn())
       return;
 
+    // Device counters and trace must be running before the kernel starts
+    if (status == CL_QUEUED)
+      OCLProfiler::Instance()->waitDeviceProfilingSetup();
+
     // Create string to specify event and its dependencies
     std::string eventStr;
     std::string dependStr;
@@ -0,0 +1,349 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Converts a binary timeline trace written by BinaryTraceWriter to the
+// CSV timeline trace or to Chrome trace event JSON (chrome://tracing).
+
+#include "xdp/profile/writer/binary_trace_format.h"
+
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef XDP_TRACE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+
+using namespace xdp::bintrace;
+
+struct Cell {
+  e_cell_type type;
+  std::string text;
+  double value;
+};
+
+struct Row {
+  double timeMsec;
+  std::vector<Cell> cells;
+};
+
+class TraceReader {
+public:
+  explicit TraceReader(std::istream& in) : mIn(in), mTimeNsec(0) {}
+
+  // Calls onText(const std::string&) and onRow(const Row&) in file order
+  template <typename TextF, typename RowF>
+  void read(TextF onText, RowF onRow)
+  {
+    char magic[sizeof(MAGIC)];
+    uint32_t version = 0;
+    uint32_t reserved = 0;
+    mIn.read(magic, sizeof(magic));
+    mIn.read(reinterpret_cast<char*>(&version), sizeof(version));
+    mIn.read(reinterpret_cast<char*>(&reserved), sizeof(reserved));
+    if (!mIn || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0)
+      throw std::runtime_error("not a binary timeline trace");
+    if (version != VERSION)
+      throw std::runtime_error("unsupported trace version " + std::to_string(version));
+
+    mStrings.push_back("");
+    std::string block;
+    while (readBlock(block)) {
+      const char* pos = block.data();
+      const char* end = pos + block.size();
+      while (pos < end) {
+        uint8_t type = static_cast<uint8_t>(*pos++);
+        if (type == RECORD_STRING) {
+          uint64_t len;
+          if (!getVarint(pos, end, len) || static_cast<uint64_t>(end - pos) < len)
+            throw std::runtime_error("truncated string record");
+          mStrings.emplace_back(pos, len);
+          pos += len;
+        }
+        else if (type == RECORD_TEXT) {
+          uint64_t id;
+          if (!getVarint(pos, end, id))
+            throw std::runtime_error("truncated text record");
+          onText(lookup(id));
+        }
+        else if (type == RECORD_ROW) {
+          readRow(pos, end);
+          onRow(mRow);
+        }
+        else {
+          throw std::runtime_error("unknown record type " + std::to_string(type));
+        }
+      }
+    }
+  }
+
+private:
+  bool readBlock(std::string& block)
+  {
+    uint32_t rawSize = 0;
+    uint32_t storedSize = 0;
+    uint8_t encoding = 0;
+    mIn.read(reinterpret_cast<char*>(&rawSize), sizeof(rawSize));
+    if (mIn.gcount() == 0)
+      return false;
+    mIn.read(reinterpret_cast<char*>(&storedSize), sizeof(storedSize));
+    mIn.read(reinterpret_cast<char*>(&encoding), sizeof(encoding));
+    std::string stored(storedSize, '\0');
+    mIn.read(&stored[0], storedSize);
+    if (!mIn)
+      throw std::runtime_error("truncated block");
+
+    if (encoding == ENCODING_RAW) {
+      block.swap(stored);
+      return true;
+    }
+#ifdef XDP_TRACE_ZLIB
+    if (encoding == ENCODING_ZLIB) {
+      block.resize(rawSize);
+      uLongf destSize = rawSize;
+      if (uncompress(reinterpret_cast<Bytef*>(&block[0]), &destSize,
+                     reinterpret_cast<const Bytef*>(stored.data()), storedSize) != Z_OK
+          || destSize != rawSize)
+        throw std::runtime_error("corrupt compressed block");
+      return true;
+    }
+#endif
+    throw std::runtime_error("unsupported block encoding " + std::to_string(encoding));
+  }
+
+  void readRow(const char*& pos, const char* end)
+  {
+    int64_t delta;
+    uint64_t numCells;
+    if (!getZigzag(pos, end, delta) || !getVarint(pos, end, numCells))
+      throw std::runtime_error("truncated row record");
+    mTimeNsec += delta;
+    mRow.timeMsec = mTimeNsec / 1.0e6;
+    mRow.cells.resize(numCells);
+
+    for (auto& cell : mRow.cells) {
+      if (pos >= end)
+        throw std::runtime_error("truncated row record");
+      cell.type = static_cast<e_cell_type>(*pos++);
+      cell.text.clear();
+      cell.value = 0.0;
+
+      bool ok = true;
+      uint64_t num = 0;
+      switch (cell.type) {
+      case CELL_EMPTY:
+        break;
+      case CELL_STRING:
+        ok = getVarint(pos, end, num);
+        if (ok)
+          cell.text = lookup(num);
+        break;
+      case CELL_INLINE:
+        ok = getVarint(pos, end, num) && static_cast<uint64_t>(end - pos) >= num;
+        if (ok) {
+          cell.text.assign(pos, num);
+          pos += num;
+        }
+        break;
+      case CELL_UINT:
+      case CELL_HEX: {
+        ok = getVarint(pos, end, num);
+        std::stringstream str;
+        if (cell.type == CELL_HEX)
+          str << std::showbase << std::hex << std::uppercase;
+        str << num;
+        cell.text = str.str();
+        cell.value = static_cast<double>(num);
+        break;
+      }
+      case CELL_DOUBLE:
+      case CELL_TIME: {
+        ok = getRaw(pos, end, &cell.value, sizeof(cell.value));
+        std::stringstream str;
+        if (cell.type == CELL_TIME)
+          str << std::setprecision(10);
+        str << cell.value;
+        cell.text = str.str();
+        break;
+      }
+      default:
+        throw std::runtime_error("unknown cell type " + std::to_string(cell.type));
+      }
+      if (!ok)
+        throw std::runtime_error("truncated row record");
+    }
+  }
+
+  const std::string& lookup(uint64_t id) const
+  {
+    if (id >= mStrings.size())
+      throw std::runtime_error("unknown string id " + std::to_string(id));
+    return mStrings[id];
+  }
+
+private:
+  std::istream& mIn;
+  std::vector<std::string> mStrings;
+  int64_t mTimeNsec;
+  Row mRow;
+};
+
+void
+writeCsv(TraceReader& reader, std::ostream& out)
+{
+  reader.read(
+    [&out](const std::string& text) { out << text; },
+    [&out](const Row& row) {
+      out << std::setprecision(10) << row.timeMsec << ",";
+      for (auto& cell : row.cells)
+        out << cell.text << ",";
+      out << "\n";
+    });
+}
+
+std::string
+jsonEscape(const std::string& str)
+{
+  std::string escaped;
+  for (char c : str) {
+    if (c == '"' || c == '\\')
+      escaped += '\\';
+    if (static_cast<unsigned char>(c) < 0x20)
+      continue;
+    escaped += c;
+  }
+  return escaped;
+}
+
+// START/END rows become begin/end events, device transfers complete
+// events and everything else instant events. Each name gets its own row
+// in the viewer.
+void
+writeJson(TraceReader& reader, std::ostream& out)
+{
+  std::map<std::string, unsigned int> tids;
+  bool first = true;
+
+  out << "{\"traceEvents\":[\n";
+  reader.read(
+    [](const std::string&) {},
+    [&](const Row& row) {
+      if (row.cells.size() < 2)
+        return;
+      const std::string& name = row.cells[0].text;
+      const std::string& event = row.cells[1].text;
+      auto itr = tids.emplace(name, tids.size() + 1).first;
+
+      std::stringstream str;
+      str << std::fixed << std::setprecision(3)
+          << "{\"name\":\"" << jsonEscape(name) << "\",\"pid\":1,\"tid\":" << itr->second
+          << ",\"ts\":" << row.timeMsec * 1000.0;
+      if (event == "START")
+        str << ",\"ph\":\"B\"}";
+      else if (event == "END")
+        str << ",\"ph\":\"E\"}";
+      else if (row.cells.size() >= 10 && row.cells[9].type == CELL_TIME)
+        str << ",\"ph\":\"X\",\"dur\":" << row.cells[7].value
+            << ",\"args\":{\"type\":\"" << jsonEscape(event) << "\"}}";
+      else
+        str << ",\"ph\":\"i\",\"s\":\"t\",\"args\":{\"event\":\"" << jsonEscape(event) << "\"}}";
+
+      out << (first ? "" : ",\n") << str.str();
+      first = false;
+    });
+
+  // Name the rows
+  for (auto& tid : tids) {
+    out << (first ? "" : ",\n")
+        << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid.second
+        << ",\"args\":{\"name\":\"" << jsonEscape(tid.first) << "\"}}";
+    first = false;
+  }
+  out << "\n]}\n";
+}
+
+void
+usage(const char* exe)
+{
+  std::cout << "Usage: " << exe << " [-f csv|json] [-o output] trace.xtrace\n"
+            << "  -f  output format, csv (default) or json (Chrome trace)\n"
+            << "  -o  output file, default is standard output\n";
+}
+
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+  std::string format = "csv";
+  std::string output;
+  int opt;
+  while ((opt = getopt(argc, argv, "f:o:h")) != -1) {
+    switch (opt) {
+    case 'f':
+      format = optarg;
+      break;
+    case 'o':
+      output = optarg;
+      break;
+    default:
+      usage(argv[0]);
+      return (opt == 'h') ? 0 : 1;
+    }
+  }
+  if (optind != argc - 1 || (format != "csv" && format != "json")) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  std::ifstream in(argv[optind], std::ios::in | std::ios::binary);
+  if (!in.is_open()) {
+    std::cerr << "ERROR: cannot open " << argv[optind] << std::endl;
+    return 1;
+  }
+  std::ofstream file;
+  if (!output.empty()) {
+    file.open(output);
+    if (!file.is_open()) {
+      std::cerr << "ERROR: cannot open " << output << std::endl;
+      return 1;
+    }
+  }
+  std::ostream& out = output.empty() ? std::cout : file;
+
+  try {
+    TraceReader reader(in);
+    if (format == "csv")
+      writeCsv(reader, out);
+    else
+      writeJson(reader, out);
+  }
+  catch (const std::exception& ex) {
+    std::cerr << "ERROR: " << argv[optind] << ": " << ex.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
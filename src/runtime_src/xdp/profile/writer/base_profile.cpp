@@ -162,6 +162,27 @@ namespace xdp {
       profile->writeTopKernelTransferSummary(this);
     }
     writeTableFooter(getStream());
+
+    // Table 12 : Latency Percentiles
+    std::vector<std::string> LatencySummaryColumnLabels = {
+        "Type", "Name", "Number Of Samples", "Median Time (ms)",
+        "90th Percentile Time (ms)", "99th Percentile Time (ms)",
+        "99.9th Percentile Time (ms)", "Maximum Time (ms)"
+    };
+    writeTableHeader(getStream(), "Latency Percentiles", LatencySummaryColumnLabels);
+    profile->writeLatencySummary(this);
+    writeTableFooter(getStream());
+
+    // Table 13 : Stall Breakdown from sampled counters
+    if (mEnStallSampleTable) {
+      std::vector<std::string> StallSampleSummaryColumnLabels = {
+          "Device", "Compute Unit/Port Name", "Stall Type", "Number Of Samples",
+          "Average Stall (%)", "Maximum Stall (%)"
+      };
+      writeTableHeader(getStream(), "Stall Breakdown (Sampled)", StallSampleSummaryColumnLabels);
+      profile->writeStallSampleSummary(this);
+      writeTableFooter(getStream());
+    }
   }
 
   // Tables 1 and 2: API Call and Kernel Execution Summary: Name, Number Of Calls,
@@ -184,6 +205,15 @@ namespace xdp {
     writeTableRowEnd(getStream());
   }
 
+  void ProfileWriterI::writeStallSampleSummary(const std::string& deviceName,
+      const std::string& name, const std::string& stallType, const RatioStats& stats)
+  {
+    writeTableRowStart(getStream());
+    writeTableCells(getStream(), deviceName, name, stallType, stats.getNoOfSamples(),
+                    stats.getAveRatio(), stats.getMaxRatio());
+    writeTableRowEnd(getStream());
+  }
+
   void ProfileWriterI::writeKernelStreamSummary(
     const std::string& deviceName, const std::string& MasterPort, const std::string& MasterArgs,
     const std::string& SlavePort, const std::string& SlaveArgs, uint64_t strNumTranx,
@@ -473,6 +503,20 @@ namespace xdp {
     writeTableRowEnd(getStream());
   }
 
+  // Percentiles are to within the histogram bucket width (6.25%)
+  void ProfileWriterI::writeLatencySummary(const std::string& type, const std::string& name,
+      const LatencyHistogram& histogram)
+  {
+    writeTableRowStart(getStream());
+    writeTableCells(getStream(), type, name, histogram.getCount(),
+        histogram.getValueAtPercentile(50.0) / 1.0e6,
+        histogram.getValueAtPercentile(90.0) / 1.0e6,
+        histogram.getValueAtPercentile(99.0) / 1.0e6,
+        histogram.getValueAtPercentile(99.9) / 1.0e6,
+        histogram.getMaxValue() / 1.0e6);
+    writeTableRowEnd(getStream());
+  }
+
   void ProfileWriterI::writeBufferStats(const std::string& name,
       const BufferStats& stats)
   {
@@ -52,6 +52,7 @@ namespace xdp {
       inline void enableStallTable() { mEnStallTable = true; }
       inline void enableStreamTable() { mEnStreamTable = true; }
       inline void enableShellTables() { mEnShellTables = true; }
+      inline void enableStallSampleTable() { mEnStallSampleTable = true; }
 
       // Returns the output file name for the writer
       virtual const std::string getFileName() { return ""; }
@@ -71,6 +72,9 @@ namespace xdp {
       virtual void writeComputeUnitSummary(const std::string& name, const TimeStats& stats);
       // Write accelerator table
       virtual void writeAcceleratorSummary(const std::string& name, const TimeStats& stats);
+      // Write latency percentiles
+      virtual void writeLatencySummary(const std::string& type, const std::string& name,
+          const LatencyHistogram& histogram);
 
       // Write Read/Write Buffer transfer stats
       virtual void writeHostTransferSummary(const std::string& name,
@@ -86,6 +90,8 @@ namespace xdp {
           double totalKernelTimeMsec, double totalTransferTimeMsec, double maxTransferRateMBps);
       void writeStallSummary(std::string& cuName, uint32_t cuRunCount, double cuRunTimeMsec,
           double cuStallExt, double cuStallStr, double cuStallInt);
+      void writeStallSampleSummary(const std::string& deviceName, const std::string& name,
+          const std::string& stallType, const RatioStats& stats);
       void writeKernelStreamSummary(const std::string& deviceName,
                                     const std::string& MasterPort, const std::string& MasterArgs,
                                     const std::string& SlavePort, const std::string& SlaveArgs,
@@ -160,6 +166,7 @@ namespace xdp {
       bool mEnStallTable = false;
       bool mEnStreamTable = false;
       bool mEnShellTables = false;
+      bool mEnStallSampleTable = false;
 
     protected:
       XDPPluginI * mPluginHandle;
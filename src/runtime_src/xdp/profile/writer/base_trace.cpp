@@ -92,6 +92,32 @@ namespace xdp {
     writeTableRowEnd(getStream());
   }
 
+  // Write out DDR physical addresses, banks, etc.
+  //
+  // Field format:
+  //   Read/write:
+  //     QUEUE/SUBMIT: address|bank
+  //     START/END:    address|bank|threadID
+  //   Copy:
+  //     QUEUE/SUBMIT: srcAddress|srcBank
+  //     START/END:    srcAddress|srcBank|threadID|dstAddress|dstBank|p2p
+  std::string TraceWriterI::getTransferAddressString(RTUtil::e_profile_command_kind kind,
+      const std::string& stageString, uint64_t srcAddress, const std::string& srcBank,
+      uint64_t dstAddress, const std::string& dstBank, std::thread::id threadId)
+  {
+    std::stringstream strAddress;
+    strAddress << (boost::format("0X%09x") % srcAddress) << "|" << srcBank;
+    if (stageString == "START" || stageString == "END") {
+      strAddress << "|" << (boost::format("0X%x") % threadId);
+
+      if (kind == RTUtil::COPY_BUFFER || kind == RTUtil::COPY_BUFFER_P2P) {
+        int p2p = (kind == RTUtil::COPY_BUFFER_P2P) ? 1 : 0;
+        strAddress << "|" << (boost::format("0X%09x") % dstAddress) << "|" << dstBank << "|" << p2p;
+      }
+    }
+    return strAddress.str();
+  }
+
   // Write read/write/copy data transfer event to trace
   void TraceWriterI::writeTransfer(double traceTime, RTUtil::e_profile_command_kind kind,
   	        const std::string& commandString, const std::string& stageString,
@@ -106,29 +132,12 @@ namespace xdp {
     std::stringstream timeStr;
     timeStr << std::setprecision(10) << traceTime;
 
-    // Write out DDR physical addresses, banks, etc.
-    //
-    // Field format:
-    //   Read/write:
-    //     QUEUE/SUBMIT: address|bank
-    //     START/END:    address|bank|threadID
-    //   Copy:
-    //     QUEUE/SUBMIT: srcAddress|srcBank
-    //     START/END:    srcAddress|srcBank|threadID|dstAddress|dstBank|p2p
-    std::stringstream strAddress;
-    strAddress << (boost::format("0X%09x") % srcAddress) << "|" << srcBank;
-    if (stageString == "START" || stageString == "END") {
-      strAddress << "|" << (boost::format("0X%x") % threadId);
-
-      if (kind == RTUtil::COPY_BUFFER || kind == RTUtil::COPY_BUFFER_P2P) {
-        int p2p = (kind == RTUtil::COPY_BUFFER_P2P) ? 1 : 0;
-        strAddress << "|" << (boost::format("0X%09x") % dstAddress) << "|" << dstBank << "|" << p2p;
-      }
-    }
+    std::string strAddress = getTransferAddressString(kind, stageString, srcAddress, srcBank,
+                                                      dstAddress, dstBank, threadId);
 
     writeTableRowStart(getStream());
     writeTableCells(getStream(), timeStr.str(), commandString,
-        stageString, strAddress.str(), size, "", "", "", "", "", "",
+        stageString, strAddress, size, "", "", "", "", "", "",
         eventString, dependString);
     writeTableRowEnd(getStream());
   }
@@ -263,6 +272,98 @@ namespace xdp {
     CountersPrev = results;
   }
 
+  // Names used for a device trace result in the timeline
+  // Returns false if the result is not shown
+  bool TraceWriterI::getDeviceTraceNames(const DeviceTrace& tr, std::string deviceName,
+      const std::string& binaryName, std::string& traceName, std::string& argNames,
+      std::string& workGroupSize)
+  {
+#ifndef XDP_VERBOSE
+    if (tr.Kind == DeviceTrace::DEVICE_BUFFER)
+      return false;
+#endif
+
+    bool showKernelCUNames = true;
+    bool showPortName = false;
+    std::string memoryName;
+    std::string cuName;
+
+    // Populate trace name string
+    if (tr.Kind == DeviceTrace::DEVICE_KERNEL) {
+      if (tr.Type == "Kernel") {
+        traceName = "KERNEL";
+      } else if (tr.Type.find("Stall") != std::string::npos) {
+        traceName = "Kernel_Stall";
+        showPortName = false;
+      } else if (tr.Type == "Write") {
+        showPortName = true;
+        traceName = "Kernel_Write";
+      } else {
+        showPortName = true;
+        traceName = "Kernel_Read";
+      }
+    }
+    else if (tr.Kind == DeviceTrace::DEVICE_STREAM) {
+      traceName = tr.Name;
+      showPortName = true;
+    } else {
+      showKernelCUNames = false;
+      if (tr.Type == "Write")
+        traceName = "Host_Write";
+      else
+        traceName = "Host_Read";
+    }
+
+    traceName += ("|" + deviceName + "|" + binaryName);
+
+    if (showKernelCUNames || showPortName) {
+      std::string portName;
+      std::string cuPortName;
+      if (tr.Kind == DeviceTrace::DEVICE_KERNEL && (tr.Type == "Kernel" || tr.Type.find("Stall") != std::string::npos)) {
+        mPluginHandle->getProfileSlotName(XCL_PERF_MON_ACCEL, deviceName, tr.SlotNum, cuName);
+      }
+      else {
+        if (tr.Kind == DeviceTrace::DEVICE_STREAM){
+          mPluginHandle->getProfileSlotName(XCL_PERF_MON_STR, deviceName, tr.SlotNum, cuPortName);
+          size_t sepIndex = cuPortName.find(IP_LAYOUT_SEP);
+          // New format : "MasterName-SlaveName"
+          if (sepIndex != std::string::npos) {
+            auto slaveName = cuPortName.substr(sepIndex + 1);
+            auto masterName = cuPortName.substr(0, sepIndex);
+            auto cuFound = masterName.find_first_of("/");
+            cuPortName = (cuFound == std::string::npos) ? slaveName : masterName;
+          }
+        }
+        else {
+          mPluginHandle->getProfileSlotName(XCL_PERF_MON_MEMORY, deviceName, tr.SlotNum, cuPortName);
+        }
+        cuName = cuPortName.substr(0, cuPortName.find_first_of("/"));
+        portName = cuPortName.substr(cuPortName.find_first_of("/")+1);
+        //std::transform(portName.begin(), portName.end(), portName.begin(), ::tolower);
+      }
+      std::string kernelName;
+      mPluginHandle->getProfileKernelName(deviceName, cuName, kernelName);
+
+      if (showKernelCUNames)
+        traceName += ("|" + kernelName + "|" + cuName);
+
+      if (showPortName) {
+        mPluginHandle->getArgumentsBank(deviceName, cuName, portName, argNames, memoryName);
+        traceName += ("|" + portName + "|" + memoryName);
+      }
+    }
+
+    if (tr.Type == "Kernel") {
+      mPluginHandle->getTraceStringFromComputeUnit(deviceName, cuName, traceName);
+      if (traceName.empty())
+        return false;
+      size_t pos = traceName.find_last_of("|");
+      workGroupSize = traceName.substr(pos + 1);
+      traceName = traceName.substr(0, pos);
+    }
+    return true;
+  }
+
   // Functions for device trace
   void TraceWriterI::writeDeviceTrace(const TraceParser::TraceResultVector &resultVector,
       std::string deviceName, std::string binaryName)
@@ -273,10 +374,11 @@ namespace xdp {
     for (auto it = resultVector.begin(); it != resultVector.end(); it++) {
       DeviceTrace tr = *it;
 
-#ifndef XDP_VERBOSE
-      if (tr.Kind == DeviceTrace::DEVICE_BUFFER)
+      std::string traceName;
+      std::string argNames;
+      std::string workGroupSize;
+      if (!getDeviceTraceNames(tr, deviceName, binaryName, traceName, argNames, workGroupSize))
         continue;
-#endif
 
       double deviceClockDurationUsec = (1.0 / (mPluginHandle->getKernelClockFreqMHz(deviceName)));
 
@@ -285,86 +387,7 @@ namespace xdp {
       std::stringstream endStr;
       endStr << std::setprecision(10) << tr.End;
 
-      bool showKernelCUNames = true;
-      bool showPortName = false;
-      std::string memoryName;
-      std::string traceName;
-      std::string cuName;
-      std::string argNames;
-
-      // Populate trace name string
-      if (tr.Kind == DeviceTrace::DEVICE_KERNEL) {
-        if (tr.Type == "Kernel") {
-          traceName = "KERNEL";
-        } else if (tr.Type.find("Stall") != std::string::npos) {
-          traceName = "Kernel_Stall";
-          showPortName = false;
-        } else if (tr.Type == "Write") {
-          showPortName = true;
-          traceName = "Kernel_Write";
-        } else {
-          showPortName = true;
-          traceName = "Kernel_Read";
-        }
-      }
-      else if (tr.Kind == DeviceTrace::DEVICE_STREAM) {
-        traceName = tr.Name;
-        showPortName = true;
-      } else {
-        showKernelCUNames = false;
-        if (tr.Type == "Write")
-          traceName = "Host_Write";
-        else
-          traceName = "Host_Read";
-      }
-
-      traceName += ("|" + deviceName + "|" + binaryName);
-
-      if (showKernelCUNames || showPortName) {
-        std::string portName;
-        std::string cuPortName;
-        if (tr.Kind == DeviceTrace::DEVICE_KERNEL && (tr.Type == "Kernel" || tr.Type.find("Stall") != std::string::npos)) {
-          mPluginHandle->getProfileSlotName(XCL_PERF_MON_ACCEL, deviceName, tr.SlotNum, cuName);
-        }
-        else {
-          if (tr.Kind == DeviceTrace::DEVICE_STREAM){
-            mPluginHandle->getProfileSlotName(XCL_PERF_MON_STR, deviceName, tr.SlotNum, cuPortName);
-            size_t sepIndex = cuPortName.find(IP_LAYOUT_SEP);
-            // New format : "MasterName-SlaveName"
-            if (sepIndex != std::string::npos) {
-              auto slaveName = cuPortName.substr(sepIndex + 1);
-              auto masterName = cuPortName.substr(0, sepIndex);
-              auto cuFound = masterName.find_first_of("/");
-              cuPortName = (cuFound == std::string::npos) ? slaveName : masterName;
-            }
-          }
-          else {
-            mPluginHandle->getProfileSlotName(XCL_PERF_MON_MEMORY, deviceName, tr.SlotNum, cuPortName);
-          }
-          cuName = cuPortName.substr(0, cuPortName.find_first_of("/"));
-          portName = cuPortName.substr(cuPortName.find_first_of("/")+1);
-          //std::transform(portName.begin(), portName.end(), portName.begin(), ::tolower);
-        }
-        std::string kernelName;
-        mPluginHandle->getProfileKernelName(deviceName, cuName, kernelName);
-
-        if (showKernelCUNames)
-          traceName += ("|" + kernelName + "|" + cuName);
-
-        if (showPortName) {
-          mPluginHandle->getArgumentsBank(deviceName, cuName, portName, argNames, memoryName);
-          traceName += ("|" + portName + "|" + memoryName);
-        }
-      }
-
       if (tr.Type == "Kernel") {
-        std::string workGroupSize;
-        mPluginHandle->getTraceStringFromComputeUnit(deviceName, cuName, traceName);
-        if (traceName.empty()) continue;
-        size_t pos = traceName.find_last_of("|");
-        workGroupSize = traceName.substr(pos + 1);
-        traceName = traceName.substr(0, pos);
-        
         writeTableRowStart(getStream());
         writeTableCells(getStream(), startStr.str(), traceName, "START", "", workGroupSize, tr.EventID);
         writeTableRowEnd(getStream());
@@ -0,0 +1,380 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "binary_trace.h"
+#include "util.h"
+
+#include <cmath>
+#include <sstream>
+
+#ifdef XDP_TRACE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace xdp {
+
+  BinaryTraceWriter::BinaryTraceWriter( const std::string& traceFileName,
+                                        const std::string& platformName,
+                                        XDPPluginI* Plugin,
+                                        bool compress) :
+      TraceFileName(traceFileName),
+      PlatformName(platformName),
+      mCompress(compress),
+      mLastTimeNsec(0)
+  {
+    mPluginHandle = Plugin;
+    if (TraceFileName == "")
+      return;
+
+#ifndef XDP_TRACE_ZLIB
+    if (mCompress) {
+      mPluginHandle->sendMessage(
+        "Compressed timeline trace is not supported in this build. Uncompressed binary trace will be used.");
+      mCompress = false;
+    }
+#endif
+
+    TraceFileName += FileExtension;
+    mStream.open(TraceFileName, std::ios::out | std::ios::binary);
+    if (!mStream.is_open()) {
+      throw std::runtime_error("Unable to open profile report for writing");
+    }
+    mBlock.reserve(bintrace::BLOCK_SIZE + 4096);
+
+    uint32_t version = bintrace::VERSION;
+    uint32_t reserved = 0;
+    mStream.write(bintrace::MAGIC, sizeof(bintrace::MAGIC));
+    mStream.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    mStream.write(reinterpret_cast<const char*>(&reserved), sizeof(reserved));
+
+    // Same header as CSVTraceWriter
+    std::stringstream header;
+    header << "Timeline Trace\n";
+    header << "Generated on: " << xdp::WriterI::getCurrentDateTime() << "\n";
+    header << "Msec since Epoch: " << xdp::WriterI::getCurrentTimeMsec() << "\n";
+    if (!xdp::WriterI::getCurrentExecutableName().empty()) {
+      header << "Profiled application: " << xdp::WriterI::getCurrentExecutableName() << "\n";
+    }
+    header << "Target platform: " << PlatformName << "\n";
+    header << "Tool version: " << xdp::WriterI::getToolVersion() << "\n";
+    header << "\n\n";
+    header << "Time_msec,Name,Event,Address_Port,Size,"
+           << "Latency_cycles,Start_cycles,End_cycles,"
+           << "Latency_usec,Start_msec,End_msec,\n";
+    writeText(header.str());
+  }
+
+  BinaryTraceWriter::~BinaryTraceWriter()
+  {
+    if (!mStream.is_open())
+      return;
+
+    std::string trString;
+    mPluginHandle->getTraceFooterString(trString);
+    writeText("Footer,begin\n" + trString + "Footer,end\n\n");
+    flushBlock();
+    mStream.close();
+  }
+
+  // ***************************************************************************
+  // Records
+  // ***************************************************************************
+
+  uint64_t BinaryTraceWriter::intern(const std::string& value)
+  {
+    auto itr = mStrings.find(value);
+    if (itr != mStrings.end())
+      return itr->second;
+
+    uint64_t id = mStrings.size() + 1;
+    mStrings.emplace(value, id);
+    mBlock.push_back(bintrace::RECORD_STRING);
+    bintrace::putVarint(mBlock, value.size());
+    mBlock.append(value);
+    return id;
+  }
+
+  void BinaryTraceWriter::writeText(const std::string& text)
+  {
+    uint64_t id = intern(text);
+    mBlock.push_back(bintrace::RECORD_TEXT);
+    bintrace::putVarint(mBlock, id);
+    endRecord();
+  }
+
+  // A string record cannot be inside a row record, so all strings of
+  // a row are interned before the row starts
+  void BinaryTraceWriter::writeRowStart(double time, uint32_t numCells)
+  {
+    int64_t timeNsec = std::llround(time * 1.0e6);
+    mBlock.push_back(bintrace::RECORD_ROW);
+    bintrace::putZigzag(mBlock, timeNsec - mLastTimeNsec);
+    bintrace::putVarint(mBlock, numCells);
+    mLastTimeNsec = timeNsec;
+  }
+
+  void BinaryTraceWriter::endRecord()
+  {
+    if (mBlock.size() >= bintrace::BLOCK_SIZE)
+      flushBlock();
+  }
+
+  void BinaryTraceWriter::cellEmpty(uint32_t count)
+  {
+    mBlock.append(count, static_cast<char>(bintrace::CELL_EMPTY));
+  }
+
+  void BinaryTraceWriter::cellString(const std::string& value)
+  {
+    auto itr = mStrings.find(value);
+    mBlock.push_back(bintrace::CELL_STRING);
+    bintrace::putVarint(mBlock, itr->second);
+  }
+
+  void BinaryTraceWriter::cellInline(const std::string& value)
+  {
+    if (value.empty()) {
+      cellEmpty();
+      return;
+    }
+    mBlock.push_back(bintrace::CELL_INLINE);
+    bintrace::putVarint(mBlock, value.size());
+    mBlock.append(value);
+  }
+
+  void BinaryTraceWriter::cellUInt(uint64_t value)
+  {
+    mBlock.push_back(bintrace::CELL_UINT);
+    bintrace::putVarint(mBlock, value);
+  }
+
+  void BinaryTraceWriter::cellHex(uint64_t value)
+  {
+    mBlock.push_back(bintrace::CELL_HEX);
+    bintrace::putVarint(mBlock, value);
+  }
+
+  void BinaryTraceWriter::cellDouble(double value)
+  {
+    mBlock.push_back(bintrace::CELL_DOUBLE);
+    bintrace::putRaw(mBlock, &value, sizeof(value));
+  }
+
+  void BinaryTraceWriter::cellTime(double value)
+  {
+    mBlock.push_back(bintrace::CELL_TIME);
+    bintrace::putRaw(mBlock, &value, sizeof(value));
+  }
+
+  void BinaryTraceWriter::flushBlock()
+  {
+    if (mBlock.empty())
+      return;
+
+    uint32_t rawSize = mBlock.size();
+    uint8_t encoding = bintrace::ENCODING_RAW;
+    const char* data = mBlock.data();
+    uint32_t storedSize = rawSize;
+
+#ifdef XDP_TRACE_ZLIB
+    std::string compressed;
+    if (mCompress) {
+      uLongf destSize = compressBound(rawSize);
+      compressed.resize(destSize);
+      if (compress2(reinterpret_cast<Bytef*>(&compressed[0]), &destSize,
+                    reinterpret_cast<const Bytef*>(mBlock.data()), rawSize, Z_BEST_SPEED) == Z_OK
+          && destSize < rawSize) {
+        encoding = bintrace::ENCODING_ZLIB;
+        data = compressed.data();
+        storedSize = destSize;
+      }
+    }
+#endif
+
+    mStream.write(reinterpret_cast<const char*>(&rawSize), sizeof(rawSize));
+    mStream.write(reinterpret_cast<const char*>(&storedSize), sizeof(storedSize));
+    mStream.write(reinterpret_cast<const char*>(&encoding), sizeof(encoding));
+    mStream.write(data, storedSize);
+    mBlock.clear();
+  }
+
+  // ***************************************************************************
+  // Timeline trace
+  // ***************************************************************************
+  // Columns are the same as the corresponding TraceWriterI functions
+
+  void BinaryTraceWriter::writeFunction(double time, const std::string& functionName,
+      const std::string& eventName, unsigned int functionID)
+  {
+    if (!mStream.is_open())
+      return;
+
+    intern(functionName);
+    intern(eventName);
+    writeRowStart(time, 13);
+    cellString(functionName);
+    cellString(eventName);
+    cellEmpty(10);
+    cellUInt(functionID);
+    endRecord();
+  }
+
+  void BinaryTraceWriter::writeKernel(double traceTime, const std::string& commandString,
+      const std::string& stageString, const std::string& eventString,
+      const std::string& dependString, uint64_t objId, size_t size)
+  {
+    if (!mStream.is_open())
+      return;
+
+    intern(commandString);
+    intern(stageString);
+    writeRowStart(traceTime, 12);
+    cellString(commandString);
+    cellString(stageString);
+    cellHex(objId);
+    cellUInt(size);
+    cellEmpty(6);
+    cellInline(eventString);
+    cellInline(dependString);
+    endRecord();
+  }
+
+  void BinaryTraceWriter::writeCu(double traceTime, const std::string& commandString,
+      const std::string& stageString, const std::string& eventString,
+      const std::string& dependString, uint64_t objId, size_t size, uint32_t cuId)
+  {
+    if (!mStream.is_open())
+      return;
+
+    intern(commandString);
+    intern(stageString);
+    writeRowStart(traceTime, 12);
+    cellString(commandString);
+    cellString(stageString);
+    cellHex(objId);
+    cellUInt(size);
+    cellUInt(cuId);
+    cellEmpty(5);
+    cellInline(eventString);
+    cellInline(dependString);
+    endRecord();
+  }
+
+  void BinaryTraceWriter::writeTransfer(double traceTime, RTUtil::e_profile_command_kind kind,
+      const std::string& commandString, const std::string& stageString,
+      const std::string& eventString, const std::string& dependString, size_t size,
+      uint64_t srcAddress, const std::string& srcBank,
+      uint64_t dstAddress, const std::string& dstBank,
+      std::thread::id threadId)
+  {
+    if (!mStream.is_open())
+      return;
+
+    std::string strAddress = getTransferAddressString(kind, stageString, srcAddress, srcBank,
+                                                      dstAddress, dstBank, threadId);
+
+    intern(commandString);
+    intern(stageString);
+    writeRowStart(traceTime, 12);
+    cellString(commandString);
+    cellString(stageString);
+    cellInline(strAddress);
+    cellUInt(size);
+    cellEmpty(6);
+    cellInline(eventString);
+    cellInline(dependString);
+    endRecord();
+  }
+
+  void BinaryTraceWriter::writeDependency(double traceTime, const std::string& commandString,
+      const std::string& stageString, const std::string& eventString,
+      const std::string& dependString)
+  {
+    if (!mStream.is_open())
+      return;
+
+    intern(commandString);
+    intern(stageString);
+    writeRowStart(traceTime, 4);
+    cellString(commandString);
+    cellString(stageString);
+    cellInline(eventString);
+    cellInline(dependString);
+    endRecord();
+  }
+
+  void BinaryTraceWriter::writeDeviceTrace(const TraceParser::TraceResultVector &resultVector,
+      std::string deviceName, std::string binaryName)
+  {
+    if (!mStream.is_open())
+      return;
+
+    double deviceClockDurationUsec = (1.0 / (mPluginHandle->getKernelClockFreqMHz(deviceName)));
+
+    for (auto it = resultVector.begin(); it != resultVector.end(); it++) {
+      const DeviceTrace& tr = *it;
+
+      std::string traceName;
+      std::string argNames;
+      std::string workGroupSize;
+      if (!getDeviceTraceNames(tr, deviceName, binaryName, traceName, argNames, workGroupSize))
+        continue;
+
+      intern(traceName);
+      if (tr.Type == "Kernel") {
+        intern("START");
+        intern("END");
+        intern(workGroupSize);
+
+        writeRowStart(tr.Start, 5);
+        cellString(traceName);
+        cellString("START");
+        cellEmpty();
+        cellString(workGroupSize);
+        cellUInt(tr.EventID);
+        endRecord();
+
+        writeRowStart(tr.End, 5);
+        cellString(traceName);
+        cellString("END");
+        cellEmpty();
+        cellString(workGroupSize);
+        cellUInt(tr.EventID);
+        endRecord();
+        continue;
+      }
+
+      double deviceDuration = 1000.0*(tr.End - tr.Start);
+      if (!(deviceDuration > 0.0)) deviceDuration = deviceClockDurationUsec;
+
+      intern(tr.Type);
+      intern(argNames);
+      writeRowStart(tr.Start, 10);
+      cellString(traceName);
+      cellString(tr.Type);
+      cellString(argNames);
+      cellUInt(tr.BurstLength);
+      cellUInt(tr.EndTime - tr.StartTime);
+      cellUInt(tr.StartTime);
+      cellUInt(tr.EndTime);
+      cellDouble(deviceDuration);
+      cellTime(tr.Start);
+      cellTime(tr.End);
+      endRecord();
+    }
+  }
+
+} // xdp
@@ -0,0 +1,93 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef __XDP_BINARY_TRACE_WRITER_H
+#define __XDP_BINARY_TRACE_WRITER_H
+
+#include "base_trace.h"
+#include "binary_trace_format.h"
+
+#include <unordered_map>
+
+namespace xdp {
+
+    // Writes the timeline trace in the compact binary format of
+    // binary_trace_format.h. Names are interned, times are delta encoded
+    // and blocks are optionally zlib compressed. xdp_trace_convert turns
+    // the file into the same CSV as CSVTraceWriter or Chrome trace JSON.
+    class BinaryTraceWriter: public TraceWriterI {
+
+    public:
+      BinaryTraceWriter(const std::string& traceFileName, const std::string& platformName,
+                        XDPPluginI* Plugin, bool compress);
+      ~BinaryTraceWriter();
+
+      virtual const std::string getFileName() { return TraceFileName; }
+
+    public:
+      void writeFunction(double time, const std::string& functionName,
+          const std::string& eventName, unsigned int functionID) override;
+      void writeKernel(double traceTime, const std::string& commandString,
+          const std::string& stageString, const std::string& eventString,
+          const std::string& dependString, uint64_t objId, size_t size) override;
+      void writeCu(double traceTime, const std::string& commandString,
+          const std::string& stageString, const std::string& eventString,
+          const std::string& dependString, uint64_t objId, size_t size, uint32_t cuId) override;
+      void writeTransfer(double traceTime, RTUtil::e_profile_command_kind kind,
+          const std::string& commandString, const std::string& stageString,
+          const std::string& eventString, const std::string& dependString, size_t size,
+          uint64_t srcAddress, const std::string& srcBank,
+          uint64_t dstAddress, const std::string& dstBank,
+          std::thread::id threadId) override;
+      void writeDependency(double traceTime, const std::string& commandString,
+          const std::string& stageString, const std::string& eventString,
+          const std::string& dependString) override;
+      void writeDeviceTrace(const TraceParser::TraceResultVector &resultVector,
+          std::string deviceName, std::string binaryName) override;
+
+    protected:
+      // Header and footer are stored as text records
+      void writeTableHeader(std::ofstream& ofs, const std::string& caption,
+          const std::vector<std::string>& columnLabels) override {}
+
+    private:
+      void writeText(const std::string& text);
+      void writeRowStart(double time, uint32_t numCells);
+      void endRecord();
+      void cellEmpty(uint32_t count = 1);
+      void cellString(const std::string& value);
+      void cellInline(const std::string& value);
+      void cellUInt(uint64_t value);
+      void cellHex(uint64_t value);
+      void cellDouble(double value);
+      void cellTime(double value);
+      uint64_t intern(const std::string& value);
+      void flushBlock();
+
+    private:
+      std::string TraceFileName;
+      std::string PlatformName;
+      const std::string FileExtension = ".xtrace";
+      std::ofstream mStream;
+      bool mCompress;
+      std::string mBlock;
+      std::unordered_map<std::string, uint64_t> mStrings;
+      int64_t mLastTimeNsec;
+    };
+
+} // xdp
+
+#endif
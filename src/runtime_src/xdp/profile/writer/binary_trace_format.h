@@ -0,0 +1,128 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef __XDP_BINARY_TRACE_FORMAT_H
+#define __XDP_BINARY_TRACE_FORMAT_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// Binary timeline trace format
+//
+// Shared by BinaryTraceWriter and the xdp_trace_convert tool, so it does
+// not depend on anything else in xdp.
+//
+// File:
+//   "XDPTRACE" magic, u32 version, u32 reserved
+//   blocks until end of file
+// Block:
+//   u32 raw size, u32 stored size, u8 encoding, stored size bytes
+//   The raw bytes are a sequence of whole records.
+// Records (first byte is the record type):
+//   STRING: varint length, bytes. Interned string, ids count from 1.
+//   TEXT:   varint string id. Text copied as is to CSV (header, footer).
+//   ROW:    zigzag varint time delta in nsec from the previous row,
+//           varint number of cells, cells. One timeline CSV row.
+// Cells (first byte is the cell type):
+//   EMPTY, STRING (varint id), INLINE (varint length, bytes),
+//   UINT (varint), HEX (varint), DOUBLE (8 bytes), TIME (8 bytes)
+//
+// The row time is the first CSV column, the cells are the others.
+// Fixed size values are in host byte order.
+
+namespace xdp {
+namespace bintrace {
+
+  const char MAGIC[8] = {'X', 'D', 'P', 'T', 'R', 'A', 'C', 'E'};
+  const uint32_t VERSION = 1;
+  const uint32_t BLOCK_SIZE = 1 << 20;
+
+  enum e_block_encoding : uint8_t {
+    ENCODING_RAW  = 0,
+    ENCODING_ZLIB = 1
+  };
+
+  enum e_record_type : uint8_t {
+    RECORD_STRING = 1,
+    RECORD_TEXT   = 2,
+    RECORD_ROW    = 3
+  };
+
+  enum e_cell_type : uint8_t {
+    CELL_EMPTY  = 0,
+    CELL_STRING = 1,
+    CELL_INLINE = 2,
+    CELL_UINT   = 3,
+    CELL_HEX    = 4,
+    CELL_DOUBLE = 5,
+    CELL_TIME   = 6
+  };
+
+  inline void putVarint(std::string& buf, uint64_t value)
+  {
+    while (value >= 0x80) {
+      buf.push_back(static_cast<char>((value & 0x7F) | 0x80));
+      value >>= 7;
+    }
+    buf.push_back(static_cast<char>(value));
+  }
+
+  inline void putZigzag(std::string& buf, int64_t value)
+  {
+    putVarint(buf, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+  }
+
+  inline void putRaw(std::string& buf, const void* data, size_t size)
+  {
+    buf.append(static_cast<const char*>(data), size);
+  }
+
+  // Readers return false when the buffer ends before the value does
+  inline bool getVarint(const char*& pos, const char* end, uint64_t& value)
+  {
+    value = 0;
+    for (unsigned int shift = 0; pos < end && shift < 64; shift += 7) {
+      uint8_t byte = static_cast<uint8_t>(*pos++);
+      value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+      if (!(byte & 0x80))
+        return true;
+    }
+    return false;
+  }
+
+  inline bool getZigzag(const char*& pos, const char* end, int64_t& value)
+  {
+    uint64_t raw;
+    if (!getVarint(pos, end, raw))
+      return false;
+    value = static_cast<int64_t>(raw >> 1) ^ -static_cast<int64_t>(raw & 1);
+    return true;
+  }
+
+  inline bool getRaw(const char*& pos, const char* end, void* data, size_t size)
+  {
+    if (static_cast<size_t>(end - pos) < size)
+      return false;
+    std::memcpy(data, pos, size);
+    pos += size;
+    return true;
+  }
+
+} // bintrace
+} // xdp
+
+#endif
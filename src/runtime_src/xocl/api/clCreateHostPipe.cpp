@@ -44,6 +44,9 @@ validOrError(cl_device_id device,
   if (flags & (flags - 1))
     throw error(CL_INVALID_VALUE);
 
+  if (!packet_size || !max_packets)
+    throw error(CL_INVALID_VALUE);
+
   if (!attributes)
     throw error(CL_INVALID_VALUE);
 
@@ -61,9 +64,10 @@ clCreateHostPipe(cl_device_id device,
 {
   validOrError(device,flags,packet_size,max_packets,attributes);
 
-  attributes++; // ???
+  // Stream route follows the DPDK id attribute
+  attributes++;
 
-  auto pipe = std::make_unique<pmd::pipe>(nullptr,xocl::xocl(device),flags,max_packets,*attributes);
+  auto pipe = std::make_unique<pmd::pipe>(nullptr,xocl::xocl(device),flags,packet_size,max_packets,*attributes);
   return pipe.release();
 }
 
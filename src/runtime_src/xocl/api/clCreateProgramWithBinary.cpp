@@ -138,11 +138,9 @@ clCreateProgramWithBinary(cl_context                      context ,
     }
   }
 
+  // Device profiling is set up asynchronously, including the baseline
+  // read of the counters, and done before the first kernel is enqueued
   xocl::profile::start_device_profiling(1);
-  // NOTE: We read from the counters to set a baseline for values and
-  // inform the reporting this is the first read after a program with
-  // binary. Otherwise, the counters will overflow.
-  xocl::profile::get_device_counters(true, true);
 
   xocl::assign(errcode_ret,CL_SUCCESS);
 
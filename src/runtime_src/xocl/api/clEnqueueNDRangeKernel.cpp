@@ -30,6 +30,8 @@
 #include "detail/kernel.h"
 #include "detail/event.h"
 
+#include "core/common/probe.h"
+
 #include "enqueue.h"
 #include "api.h"
 
@@ -251,6 +253,127 @@ validOrError(cl_command_queue command_queue,
   // required by the OpenCL implementation on the host.
 }
 
+// Queue migration of kernel arguments and kernel execution on a
+// command queue.  If end is non zero, then only workgroups [begin,end)
+// of the outermost work dimension are executed.
+static ptr<event>
+enqueueExecution(cl_command_queue command_queue, cl_kernel kernel, cl_uint work_dim,
+                 const size_t* global_work_offset, const size_t* global_work_size,
+                 const size_t* local_work_size,
+                 cl_uint num_events_in_wait_list, const cl_event* event_wait_list,
+                 size_t begin=0, size_t end=0)
+{
+  // Event for kernel arg migration (todo: experiment with multiple events, one pr arg)
+  auto umEvent = xocl::create_hard_event(command_queue,CL_COMMAND_MIGRATE_MEM_OBJECTS,num_events_in_wait_list,event_wait_list);
+  cl_event mEvent = umEvent.get();
+
+  // Migration action and enqueing
+  xocl::enqueue::set_event_action(umEvent.get(),xocl::enqueue::action_ndrange_migrate,mEvent,kernel);
+  xocl::profile::set_event_action(umEvent.get(),xocl::profile::action_ndrange_migrate,mEvent,kernel);
+  xocl::appdebug::set_event_action(umEvent.get(),xocl::appdebug::action_ndrange_migrate,mEvent,kernel);
+
+  // Schedule migration
+  umEvent->queue();
+
+  // Event for kernel execution, must wait on migration
+  auto ueEvent = xocl::create_hard_event(command_queue,CL_COMMAND_NDRANGE_KERNEL,1,&mEvent);
+  cl_event eEvent = ueEvent.get();
+
+  // execution context
+  auto device = ueEvent->get_command_queue()->get_device();
+    ueEvent->set_execution_context
+      (std::make_unique<execution_context>
+       (device,xocl(kernel),xocl(eEvent),work_dim,global_work_offset,global_work_size,local_work_size));
+    xocl::enqueue::set_event_action(ueEvent.get(),xocl::enqueue::action_ndrange_execute);
+
+  if (end)
+    ueEvent->get_execution_context()->set_workgroup_range(begin,end);
+
+  // Encode the command packet while the arguments migrate
+  ueEvent->get_execution_context()->prepare();
+
+  xocl::profile::set_event_action(ueEvent.get(),xocl::profile::action_ndrange,eEvent,kernel);
+  xocl::appdebug::set_event_action(ueEvent.get(),xocl::appdebug::action_ndrange,eEvent,kernel);
+
+  // Schedule execution
+  ueEvent->queue();
+  return ueEvent;
+}
+
+// Devices that execute part of an NDRange on a CL_QUEUE_SPLIT_NDRANGE
+// queue, the queue's device first.  A split requires more than one
+// workgroup in the outermost dimension, and buffer arguments backed
+// by host memory, which is the point of coherence between the
+// devices.  Kernels with printf or program scope variables are
+// executed by the queue's device only.
+static std::vector<device*>
+getSplitDevices(cl_command_queue command_queue, cl_kernel kernel, cl_uint work_dim,
+                const size_t* global_work_size, const size_t* local_work_size)
+{
+  std::vector<device*> devices;
+  auto xkernel = xocl(kernel);
+  auto dim = work_dim-1;
+  auto num_groups = global_work_size[dim]/local_work_size[dim];
+  if (num_groups<2 || xkernel->has_printf() || !xkernel->get_progvar_argument_range().empty())
+    return devices;
+
+  for (auto& arg : xkernel->get_indexed_argument_range()) {
+    auto mem = arg->get_memory_object();
+    if (mem && (!mem->get_host_ptr() || mem->no_host_memory() || mem->is_sub_buffer()))
+      return devices;
+  }
+
+  auto program = xkernel->get_program();
+  auto primary = xocl(command_queue)->get_device();
+  devices.push_back(primary);
+  for (auto device : program->get_context()->get_device_range()) {
+    if (device==primary || device->get_program()!=program)
+      continue;
+    auto cus = xkernel->get_cus();
+    if (std::any_of(cus.begin(),cus.end(),[device](const compute_unit* cu) { return cu->get_device()==device; }))
+      devices.push_back(device);
+  }
+
+  if (devices.size() > num_groups)
+    devices.resize(num_groups);
+  return devices;
+}
+
+// Split NDRange by workgroups of the outermost work dimension across
+// devices.  Each device executes its part on an internal queue, and
+// the buffer ranges written by each part are gathered by an event on
+// command_queue that waits for all parts.
+static ptr<event>
+enqueueSplitExecution(cl_command_queue command_queue, cl_kernel kernel, cl_uint work_dim,
+                      const size_t* global_work_offset, const size_t* global_work_size,
+                      const size_t* local_work_size,
+                      cl_uint num_events_in_wait_list, const cl_event* event_wait_list,
+                      const std::vector<device*>& devices)
+{
+  auto dim = work_dim-1;
+  auto num_groups = global_work_size[dim]/local_work_size[dim];
+  auto num_devices = devices.size();
+
+  std::vector<ptr<event>> parts;
+  std::vector<cl_event> part_events;
+  std::vector<enqueue::ndrange_part> ranges;
+  for (size_t idx=0; idx<num_devices; ++idx) {
+    auto device = devices[idx];
+    auto begin = num_groups*idx/num_devices;
+    auto end = num_groups*(idx+1)/num_devices;
+    auto queue = xocl(command_queue)->get_split_queue(device);
+    parts.push_back(enqueueExecution(queue,kernel,work_dim,global_work_offset,global_work_size
+                                     ,local_work_size,num_events_in_wait_list,event_wait_list,begin,end));
+    part_events.push_back(parts.back().get());
+    ranges.push_back({device,begin,end});
+  }
+
+  auto ugEvent = xocl::create_hard_event(command_queue,CL_COMMAND_MIGRATE_MEM_OBJECTS,part_events.size(),part_events.data());
+  xocl::enqueue::set_event_action(ugEvent.get(),xocl::enqueue::action_ndrange_gather,kernel,std::move(ranges),num_groups);
+  ugEvent->queue();
+  return ugEvent;
+}
+
 static cl_int
 clEnqueueNDRangeKernel(cl_command_queue command_queue,
                        cl_kernel        kernel,
@@ -262,6 +385,7 @@ clEnqueueNDRangeKernel(cl_command_queue command_queue,
                        const cl_event * event_wait_list,
                        cl_event *       event_parameter)
 {
+  XRT_PROBE_SCOPE(cl_enqueue_ndrange_kernel);
   validOrError(command_queue,kernel
                ,work_dim,global_work_offset,global_work_size,local_work_size
                ,num_events_in_wait_list,event_wait_list,event_parameter );
@@ -380,6 +504,20 @@ clEnqueueNDRangeKernel(cl_command_queue command_queue,
 
   } // api_checks
 
+  // Split the NDRange across the devices of the context.  The event
+  // returned to the application completes when all parts are done
+  // and their results are gathered.
+  if (xocl::xocl(command_queue)->is_split_ndrange_enabled()) {
+    auto devices = getSplitDevices(command_queue,kernel,work_dim,global_work_size_3D.data(),local_work_size_3D.data());
+    if (devices.size() > 1) {
+      auto ugEvent = enqueueSplitExecution
+        (command_queue,kernel,work_dim,global_work_offset_3D.data(),global_work_size_3D.data()
+         ,local_work_size_3D.data(),num_events_in_wait_list,event_wait_list,devices);
+      xocl::assign(event_parameter,ugEvent.get());
+      return CL_SUCCESS;
+    }
+  }
+
   // PRINTF - we need to allocate a buffer and do an initial memory transfer before kernel
   // execution starts to initialize the printf buffer to known values.
   auto printf_buffer_scoped = createPrintfBuffer(context, kernel, global_work_size_3D, local_work_size_3D);
@@ -402,40 +540,16 @@ clEnqueueNDRangeKernel(cl_command_queue command_queue,
     new_wait_list_size = printf_wait_list.size();
   }
 
-  // Event for kernel arg migration (todo: experiment with multiple events, one pr arg)
-  auto umEvent = xocl::create_hard_event(command_queue,CL_COMMAND_MIGRATE_MEM_OBJECTS,new_wait_list_size,new_wait_list);
-  cl_event mEvent = umEvent.get();
+  auto ueEvent = enqueueExecution
+    (command_queue,kernel,work_dim,global_work_offset_3D.data(),global_work_size_3D.data()
+     ,local_work_size_3D.data(),new_wait_list_size,new_wait_list);
+  cl_event eEvent = ueEvent.get();
 
   if (printf_init_event)
     // The printf_init_event has been added to the event waitlist
     // The event is no longer neeeded.
     api::clReleaseEvent(printf_init_event);
 
-  // Migration action and enqueing
-  xocl::enqueue::set_event_action(umEvent.get(),xocl::enqueue::action_ndrange_migrate,mEvent,kernel);
-  xocl::profile::set_event_action(umEvent.get(),xocl::profile::action_ndrange_migrate,mEvent,kernel);
-  xocl::appdebug::set_event_action(umEvent.get(),xocl::appdebug::action_ndrange_migrate,mEvent,kernel);
-
-  // Schedule migration
-  umEvent->queue();
-
-  // Event for kernel execution, must wait on migration
-  auto ueEvent = xocl::create_hard_event(command_queue,CL_COMMAND_NDRANGE_KERNEL,1,&mEvent);
-  cl_event eEvent = ueEvent.get();
-
-  // execution context
-  auto device = ueEvent->get_command_queue()->get_device();
-    ueEvent->set_execution_context
-      (std::make_unique<execution_context>
-       (device,xocl(kernel),xocl(eEvent),work_dim,global_work_offset_3D.data(),global_work_size_3D.data(),local_work_size_3D.data()));
-    xocl::enqueue::set_event_action(ueEvent.get(),xocl::enqueue::action_ndrange_execute);
-
-  xocl::profile::set_event_action(ueEvent.get(),xocl::profile::action_ndrange,eEvent,kernel);
-  xocl::appdebug::set_event_action(ueEvent.get(),xocl::appdebug::action_ndrange,eEvent,kernel);
-
-  // Schedule execution
-  ueEvent->queue();
-
   // Schdule the printf buffer retrieval to happen AFTER the kernel
   // execution completes (wait on ueEvent).  The execution event may
   // have already completed (it was queued above), but this function
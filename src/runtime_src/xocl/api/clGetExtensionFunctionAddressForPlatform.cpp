@@ -34,6 +34,8 @@ static const std::map<const std::string, void *> extensionFunctionTable = {
   std::pair<const std::string, void *>("xclGetXrtDevice", (void *)xclGetXrtDevice),
   std::pair<const std::string, void *>("xclGetMemObjDeviceAddress", (void *)xclGetMemObjDeviceAddress),
   std::pair<const std::string, void *>("xclGetComputeUnitInfo", (void *)xclGetComputeUnitInfo),
+  std::pair<const std::string, void *>("xclProfileRegionBegin", (void *)xclProfileRegionBegin),
+  std::pair<const std::string, void *>("xclProfileRegionEnd", (void *)xclProfileRegionEnd),
   std::pair<const std::string, void *>("clIcdGetPlatformIDsKHR", (void *)clIcdGetPlatformIDsKHR),
 };
 
@@ -40,6 +40,12 @@ clReleasePipeBuffer(cl_command_queue command_queue,
                     rte_mbuf*        buf)
 {
   validOrError(command_queue,pipe,buf);
+  if (buf) {
+    xocl::xocl(pipe)->releasePacket(buf);
+    return CL_SUCCESS;
+  }
+
+  // No buffer releases the pipe itself
   if (xocl::xocl(pipe)->release())
     delete xocl::xocl(pipe);
 
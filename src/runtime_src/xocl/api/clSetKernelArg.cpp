@@ -23,6 +23,7 @@
 
 #include <cstdlib>
 #include "plugin/xdp/profile.h"
+#include "core/common/probe.h"
 
 namespace xocl {
 
@@ -96,10 +97,12 @@ clSetKernelArg(cl_kernel    kernel,
                size_t       arg_size,
                const void * arg_value)
 {
+  XRT_PROBE_SCOPE(cl_set_kernel_arg);
   validOrError(kernel,arg_index,arg_size,arg_value);
 
   // XCL_CONFORMANCECOLLECT mode, not sure why return here?
-  if (getenv("XCL_CONFORMANCECOLLECT"))
+  static bool conformance_collect = getenv("XCL_CONFORMANCECOLLECT") != nullptr;
+  if (conformance_collect)
     return CL_SUCCESS;
 
   // May throw out-of-range
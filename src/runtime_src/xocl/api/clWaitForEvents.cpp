@@ -40,8 +40,11 @@ static cl_int
 clWaitForEvents(cl_uint num_events, const cl_event* event_list)
 {
   validOrError(num_events, event_list);
+  std::vector<const event*> events;
+  events.reserve(num_events);
   for (auto event : get_range(event_list,event_list+num_events))
-    xocl(event)->wait();  
+    events.push_back(xocl(event));
+  event::wait(events);
   return CL_SUCCESS;
 }
 
@@ -29,10 +29,17 @@
 #include "xocl/core/command_queue.h"
 #include "xocl/core/device.h"
 #include "xocl/core/kernel.h"
+#include "xocl/core/memory.h"
+#include "xrt/util/config_reader.h"
 
+#include <algorithm>
+#include <atomic>
+#include <tuple>
 
 namespace {
 
+static const size_t page_size = 4096;
+
 // Exception pointer for device exceptions during enqueue tasks.  The
 // pointer is set with the exception thrown by the task.
 static std::exception_ptr s_exception_ptr;
@@ -100,6 +107,22 @@ struct enqueue_command : xrt::command
 
 using async_type = xrt::device::queue_type;
 
+// Task queue of a transfer enqueued on the event's command queue,
+// read, write, and misc tasks of a high priority queue are latency class
+inline async_type
+io_queue(xocl::event* ev, async_type qt)
+{
+  if (!ev->get_command_queue()->is_high_priority())
+    return qt;
+  if (qt == async_type::read)
+    return async_type::read_high;
+  if (qt == async_type::write)
+    return async_type::write_high;
+  if (qt == async_type::misc)
+    return async_type::misc_high;
+  return qt;
+}
+
 auto event_completer = [](xocl::event* ev)
 {
   ev->set_status(CL_COMPLETE);
@@ -265,6 +288,80 @@ migrate_buffer(shared_event_completer sec,xocl::device* device
   }
 }
 
+// Marks a buffer resident on a device once all chunks of its
+// migration have landed, and holds the event until then
+struct resident_marker
+{
+  shared_event_completer sec;
+  xocl::memory* mem;
+  xocl::device* device;
+  std::atomic<bool> failed {false};
+
+  resident_marker(shared_event_completer s, xocl::memory* m, xocl::device* d)
+    : sec(std::move(s)), mem(m), device(d)
+  {}
+
+  ~resident_marker()
+  {
+    if (!failed)
+      mem->set_resident(device);
+  }
+};
+
+static void
+migrate_buffer_chunk(std::shared_ptr<resident_marker> marker,size_t offset,size_t size)
+{
+  try {
+    marker->sec->set_status(CL_RUNNING);
+    marker->device->migrate_buffer_range(marker->mem,offset,size);
+  }
+  catch (const std::exception& ex) {
+    marker->failed = true;
+    handle_device_exception(marker->sec.get(),ex);
+  }
+}
+
+static void
+migrate_buffers(shared_event_completer sec,xocl::device* device
+                ,const std::vector<xocl::memory*>& buffers)
+{
+  try {
+    sec->set_status(CL_RUNNING);
+    device->migrate_buffers(buffers);
+  }
+  catch (const std::exception& ex) {
+    handle_device_exception(sec.get(),ex);
+  }
+}
+
+static void
+gather_buffers(shared_event_completer sec,xocl::device* device
+               ,const std::vector<xocl::memory*>& buffers
+               ,const std::vector<xocl::enqueue::ndrange_part>& parts,size_t num_groups)
+{
+  try {
+    sec->set_status(CL_RUNNING);
+    for (auto& part : parts) {
+      if (part.device==device)
+        continue;
+      for (auto mem : buffers) {
+        if (!(mem->get_flags() & CL_MEM_READ_ONLY)) {
+          auto size = mem->get_size();
+          auto begin = size*part.begin/num_groups;
+          auto end = size*part.end/num_groups;
+          if (end > begin)
+            device->gather_buffer(mem,part.device,begin,end-begin);
+        }
+        // Host may change the buffer before next launch on part device
+        mem->clear_resident(part.device);
+      }
+    }
+  }
+  catch (const std::exception& ex) {
+    handle_device_exception(sec.get(),ex);
+  }
+}
+
 static void
 read_image(xocl::event* event,xocl::device* device,cl_mem image,
 	const size_t* origin,const size_t* region, size_t row_pitch,size_t slice_pitch,
@@ -308,7 +405,7 @@ action_fill_buffer(cl_mem buffer, const void* pattern, size_t pattern_size, size
     auto command_queue = event->get_command_queue();
     auto device = command_queue->get_device();
     auto xdevice = device->get_xrt_device();
-    xdevice->schedule(fill_buffer,async_type::misc,event,device,buffer, pattern, pattern_size, offset, size);
+    xdevice->schedule(fill_buffer,io_queue(event,async_type::misc),event,device,buffer, pattern, pattern_size, offset, size);
   };
 }
 
@@ -331,7 +428,7 @@ action_copy_p2p_buffer(cl_mem src_buffer,cl_mem dst_buffer,size_t src_offset,siz
     auto command_queue = ev->get_command_queue();
     auto device = command_queue->get_device();
     auto xdevice = device->get_xrt_device();
-    xdevice->schedule(copy_p2p_buffer,async_type::misc,ev,device,src_buffer,dst_buffer, src_offset, dst_offset, size);
+    xdevice->schedule(copy_p2p_buffer,io_queue(ev,async_type::misc),ev,device,src_buffer,dst_buffer, src_offset, dst_offset, size);
   };
 }
 
@@ -348,11 +445,18 @@ action_ndrange_migrate(cl_event event,cl_kernel kernel)
   std::vector<xocl::memory*> kernel_args;
   for (auto& arg : xocl::xocl(kernel)->get_argument_range()) {
     if (auto mem = arg->get_memory_object()) {
+      // host copy is stale once the kernel may have written the argument
+      if (!(mem->get_flags() & CL_MEM_READ_ONLY))
+        mem->set_device_written(0,mem->get_size());
       if (arg->is_progvar() && arg->get_address_qualifier()==CL_KERNEL_ARG_ADDRESS_GLOBAL /*1*/) {
         mem->get_buffer_object(device,xrt::device::memoryDomain::XRT_DEVICE_PREALLOCATED_BRAM,arg->get_baseaddr());
         // progvars are not to be transfered so dont add to kernel args
       }
       else {
+        // Pinned until the kernel execution context is done, the
+        // command packet holds the device address of the buffer
+        if (xrt::config::get_device_oversubscription())
+          mem->pin();
         mem->get_buffer_object(device);
         kernel_args.push_back(mem);
       }
@@ -366,6 +470,7 @@ action_ndrange_migrate(cl_event event,cl_kernel kernel)
     auto xdevice = device->get_xrt_device();
     auto ec = make_shared_event_completer(ev);
 
+    std::vector<xocl::memory*> migrate;
     for (auto mem : kernel_args) {
       // do not migrate if argument is write only, but trick the code
       // into assuming that the argument is resident
@@ -375,10 +480,13 @@ action_ndrange_migrate(cl_event event,cl_kernel kernel)
       }
 
       // only migrate if not already resident on device
-      if (!mem->is_resident(device)) {
-        xdevice->schedule(migrate_buffer,async_type::write,ec,device,mem,0);
-      }
+      if (!mem->is_resident(device))
+        migrate.push_back(mem);
     }
+
+    // One task migrates all arguments of the launch
+    if (!migrate.empty())
+      xdevice->schedule(migrate_buffers,io_queue(ev,async_type::write),ec,device,std::move(migrate));
   };
 }
 
@@ -391,7 +499,7 @@ action_read_buffer(cl_mem buffer,size_t offset, size_t size, const void* ptr)
     auto command_queue = ev->get_command_queue();
     auto device = command_queue->get_device();
     auto xdevice = device->get_xrt_device();
-    xdevice->schedule(read_buffer,async_type::read,ev,device,buffer,offset,size,const_cast<void*>(ptr));
+    xdevice->schedule(read_buffer,io_queue(ev,async_type::read),ev,device,buffer,offset,size,const_cast<void*>(ptr));
   };
 }
 
@@ -429,7 +537,7 @@ action_map_buffer(cl_event event,cl_mem buffer,cl_map_flags map_flags,size_t off
     auto command_queue = ev->get_command_queue();
     auto device = command_queue->get_device();
     auto xdevice = device->get_xrt_device();
-    xdevice->schedule(map_buffer,async_type::read,ev,device,buffer,map_flags,offset,size,userptr);
+    xdevice->schedule(map_buffer,io_queue(ev,async_type::read),ev,device,buffer,map_flags,offset,size,userptr);
   };
 }
 
@@ -442,7 +550,7 @@ action_map_svm_buffer(cl_event event,cl_map_flags map_flags,void* svm_ptr,size_t
     auto command_queue = ev->get_command_queue();
     auto device = command_queue->get_device();
     auto xdevice = device->get_xrt_device();
-    xdevice->schedule(map_svm_buffer,async_type::read,ev,device,map_flags,svm_ptr,size);
+    xdevice->schedule(map_svm_buffer,io_queue(ev,async_type::read),ev,device,map_flags,svm_ptr,size);
   };
 }
 
@@ -455,7 +563,7 @@ action_write_buffer(cl_mem buffer,size_t offset, size_t size, const void* ptr)
     auto command_queue = ev->get_command_queue();
     auto device = command_queue->get_device();
     auto xdevice = device->get_xrt_device();
-    xdevice->schedule(write_buffer,async_type::write,ev,device,buffer,offset,size,ptr);
+    xdevice->schedule(write_buffer,io_queue(ev,async_type::write),ev,device,buffer,offset,size,ptr);
   };
 }
 
@@ -468,7 +576,7 @@ action_unmap_buffer(cl_mem memobj,void* mapped_ptr)
     auto command_queue = ev->get_command_queue();
     auto device = command_queue->get_device();
     auto xdevice = device->get_xrt_device();
-    xdevice->schedule(unmap_buffer,async_type::write,ev,device,memobj,mapped_ptr);
+    xdevice->schedule(unmap_buffer,io_queue(ev,async_type::write),ev,device,memobj,mapped_ptr);
   };
 }
 
@@ -481,7 +589,7 @@ action_unmap_svm_buffer(void* svm_ptr)
     auto command_queue = ev->get_command_queue();
     auto device = command_queue->get_device();
     auto xdevice = device->get_xrt_device();
-    xdevice->schedule(unmap_svm_buffer,async_type::write,ev,device,svm_ptr);
+    xdevice->schedule(unmap_svm_buffer,io_queue(ev,async_type::write),ev,device,svm_ptr);
   };
 }
 
@@ -494,7 +602,7 @@ action_read_image(cl_mem image,const size_t* origin,const size_t* region, size_t
     auto command_queue = ev->get_command_queue();
     auto device = command_queue->get_device();
     auto xdevice = device->get_xrt_device();
-    xdevice->schedule(read_image,async_type::read,ev,device,image,origin,region,row_pitch,slice_pitch,const_cast<void*>(ptr));
+    xdevice->schedule(read_image,io_queue(ev,async_type::read),ev,device,image,origin,region,row_pitch,slice_pitch,const_cast<void*>(ptr));
   };
 }
 
@@ -507,7 +615,7 @@ action_write_image(cl_mem image,const size_t* origin,const size_t* region,size_t
     auto command_queue = ev->get_command_queue();
     auto device = command_queue->get_device();
     auto xdevice = device->get_xrt_device();
-    xdevice->schedule(write_image,async_type::write,ev,device,image,origin,region,row_pitch,slice_pitch,ptr);
+    xdevice->schedule(write_image,io_queue(ev,async_type::write),ev,device,image,origin,region,row_pitch,slice_pitch,ptr);
   };
 }
 
@@ -523,19 +631,84 @@ action_migrate_memobjects(size_t num, const cl_mem* memobjs, cl_mem_migration_fl
     auto device = command_queue->get_device();
     auto xdevice = device->get_xrt_device();
     auto ec = make_shared_event_completer(ev);
-    for (auto mem : mo) {
-      // do not migrate if argument is CL_MIGRATE_MEM_OBJECT_CONTENT_UNDERFINED
-      // but trick code into assuming that the argument is resident
-      if (flags & CL_MIGRATE_MEM_OBJECT_CONTENT_UNDEFINED) {
+
+    // do not migrate if argument is CL_MIGRATE_MEM_OBJECT_CONTENT_UNDERFINED
+    // but trick code into assuming that the argument is resident
+    if (flags & CL_MIGRATE_MEM_OBJECT_CONTENT_UNDEFINED) {
+      for (auto mem : mo) {
         // at least allocate buffer on device if necessary
         xocl::xocl(mem)->get_buffer_object(device);
         xocl::xocl(mem)->set_resident(device);
+      }
+      return;
+    }
+
+    // Largest first, so that the least loaded worker picking up each
+    // transfer evens out the workers
+    auto sorted = mo;
+    std::stable_sort(sorted.begin(),sorted.end(),[](cl_mem a, cl_mem b) {
+      return xocl::xocl(a)->get_size() > xocl::xocl(b)->get_size();
+    });
+
+    if (flags & CL_MIGRATE_MEM_OBJECT_HOST) {
+      for (auto mem : sorted)
+        xdevice->schedule(migrate_buffer,io_queue(ev,async_type::read),ec,device,mem,flags);
+      return;
+    }
+
+    // Host to device, split the non resident ranges into chunks that
+    // are spread over all DMA workers.  Event completes when the last
+    // chunk of the last buffer has landed.
+    static size_t chunk = [] {
+      size_t sz = xrt::config::get_dma_chunk();
+      return sz ? std::max<size_t>(sz*1024 & ~(page_size-1),page_size) : 0;
+    }();
+    using marker_ptr = std::shared_ptr<resident_marker>;
+    std::vector<std::tuple<marker_ptr,size_t,size_t>> chunks;
+    for (auto mem : sorted) {
+      auto xmem = xocl::xocl(mem);
+      xmem->get_buffer_object(device);
+      if (xmem->no_host_memory()) {
+        xmem->set_resident(device);
         continue;
       }
 
-      auto at = (flags & CL_MIGRATE_MEM_OBJECT_HOST) ? async_type::read : async_type::write;
-      xdevice->schedule(migrate_buffer,at,ec,device,mem,flags);
+      auto marker = std::make_shared<resident_marker>(ec,xmem,device);
+      for (auto& range : xmem->get_nonresident_ranges(device)) {
+        for (auto offset = range.first; offset < range.second;) {
+          // chunks end on page boundaries within the buffer object
+          auto end = chunk ? std::min(range.second,(offset+chunk) & ~(page_size-1)) : range.second;
+          chunks.emplace_back(marker,offset,end-offset);
+          offset = end;
+        }
+      }
     }
+
+    std::stable_sort(chunks.begin(),chunks.end(),[](const std::tuple<marker_ptr,size_t,size_t>& a
+                                                    ,const std::tuple<marker_ptr,size_t,size_t>& b) {
+      return std::get<2>(a) > std::get<2>(b);
+    });
+    for (auto& c : chunks)
+      xdevice->schedule(migrate_buffer_chunk,io_queue(ev,async_type::write),std::get<0>(c),std::get<1>(c),std::get<2>(c));
+  };
+}
+
+xocl::event::action_enqueue_type
+action_ndrange_gather(cl_kernel kernel, std::vector<ndrange_part> parts, size_t num_groups)
+{
+  throw_if_error();
+  std::vector<xocl::memory*> buffers;
+  for (auto& arg : xocl::xocl(kernel)->get_indexed_argument_range())
+    if (auto mem = arg->get_memory_object())
+      buffers.push_back(mem);
+
+  return [buffers,parts,num_groups](xocl::event* ev) {
+    XOCL_DEBUG(std::cout,"launching ndrange gather DMA event(",ev->get_uid(),")\n");
+    auto command_queue = ev->get_command_queue();
+    auto device = command_queue->get_device();
+    auto xdevice = device->get_xrt_device();
+    auto ec = make_shared_event_completer(ev);
+    xdevice->schedule(gather_buffers,io_queue(ev,async_type::read),ec,device,buffers,parts,num_groups);
   };
 }
 
@@ -28,6 +28,7 @@
 #include "xocl/core/object.h"
 #include "xocl/core/event.h"
 #include <utility>
+#include <vector>
 
 namespace xocl { namespace enqueue {
 
@@ -74,6 +75,29 @@ action_migrate_memobjects(size_t num, const cl_mem* memobjs, cl_mem_migration_fl
 xocl::event::action_enqueue_type
 action_ndrange_execute();
 
+/**
+ * Part of a split NDRange, workgroups [begin,end) of the outermost
+ * work dimension are executed by device
+ */
+struct ndrange_part
+{
+  xocl::device* device;
+  size_t begin;
+  size_t end;
+};
+
+/**
+ * Gather the results of a split NDRange to the event's device
+ *
+ * Each part's share of each writable buffer argument is synced from
+ * the part's device to the event's device.  The share is a byte range
+ * of the buffer proportional to the part's range of @num_groups
+ * workgroups.  Afterwards the buffer arguments are resident only on
+ * the event's device.
+ */
+xocl::event::action_enqueue_type
+action_ndrange_gather(cl_kernel kernel, std::vector<ndrange_part> parts, size_t num_groups);
+
 template <typename F, typename ...Args>
 inline void
 set_event_action(xocl::event* event, F&& f, Args&&... args)
@@ -36,6 +36,7 @@
 #include "xocl/xclbin/xclbin.h"
 
 #include <map>
+#include <mutex>
 #include <sstream>
 #include "plugin/xdp/profile.h"
 
@@ -51,6 +52,10 @@ struct X
   ~X() { s_exiting = true; }
 };
 
+// Nesting depth of open profile regions
+static std::mutex s_region_mutex;
+static int s_region_depth = 0;
+
 } // namespace
 
 namespace xocl { namespace profile {
@@ -87,6 +92,11 @@ cb_start_device_profiling_type cb_start_device_profiling;
 cb_reset_device_profiling_type cb_reset_device_profiling;
 cb_end_device_profiling_type cb_end_device_profiling;
 
+/*
+ * Capture everything until profile regions are known to be enabled
+ */
+std::atomic<bool> capture_active(true);
+
 
 /*
  * callback registration functions used by lambda generators called from profile
@@ -202,6 +212,9 @@ log(xocl::event* event, cl_int status, const std::string& cuname)
 void
 log_dependencies (xocl::event* event,  cl_uint num_deps, const cl_event* deps)
 {
+  if (!is_capture_active())
+    return;
+
   if(cb_log_dependencies)
     cb_log_dependencies(event, num_deps, deps);
 }
@@ -450,22 +463,48 @@ function_call_logger(const char* function, long long address)
     if (xrt::config::get_app_debug() || xrt::config::get_profile()) {
       xrt::hal::load_xdp();
     }
+    if (xrt::config::get_profile_regions()) {
+      std::lock_guard<std::mutex> lk(s_region_mutex);
+      capture_active.store(s_region_depth > 0, std::memory_order_relaxed);
+    }
   }
 
   m_funcid = m_funcid_global++;
-  if (cb_log_function_start)
+  m_active = is_capture_active();
+  if (m_active && cb_log_function_start)
     cb_log_function_start(m_name, m_address, m_funcid);
 }
 
 function_call_logger::
 ~function_call_logger()
 {
-  if (cb_log_function_end)
+  // calls are logged start to end or not at all, depending on
+  // whether capture was active when they started
+  if (m_active && cb_log_function_end)
     cb_log_function_end(m_name, m_address, m_funcid);
 }
 
 std::atomic <unsigned int>  function_call_logger::m_funcid_global(0);
 
+void
+region_begin()
+{
+  std::lock_guard<std::mutex> lk(s_region_mutex);
+  if (s_region_depth++ == 0 && xrt::config::get_profile_regions())
+    capture_active.store(true, std::memory_order_relaxed);
+}
+
+void
+region_end()
+{
+  std::lock_guard<std::mutex> lk(s_region_mutex);
+  // unbalanced end is ignored
+  if (s_region_depth == 0)
+    return;
+  if (--s_region_depth == 0 && xrt::config::get_profile_regions())
+    capture_active.store(false, std::memory_order_relaxed);
+}
+
 void add_to_active_devices(const std::string& device_name)
 {
   if (cb_add_to_active_devices)
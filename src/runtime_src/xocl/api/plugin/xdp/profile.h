@@ -28,6 +28,7 @@
 #include "xocl/core/object.h"
 #include "xocl/core/event.h"
 #include "xocl/core/command_queue.h"
+#include <atomic>
 #include <utility>
 #include <string>
 
@@ -106,6 +107,28 @@ void register_cb_start_device_profiling (cb_start_device_profiling_type&& cb);
 void register_cb_reset_device_profiling (cb_reset_device_profiling_type&& cb);
 void register_cb_end_device_profiling (cb_end_device_profiling_type&& cb);
 
+/*
+ * Profile regions
+ *
+ * With profile_regions=true in xrt.ini host side profiling (function
+ * calls, event actions, dependencies) is captured only while a region
+ * opened with region_begin is active.  Outside of regions each hook
+ * costs a single relaxed load of capture_active.
+ */
+extern std::atomic<bool> capture_active;
+
+inline bool
+is_capture_active()
+{
+  return capture_active.load(std::memory_order_relaxed);
+}
+
+void
+region_begin();
+
+void
+region_end();
+
 void get_address_bank(cl_mem buffer, uint64_t &address, int &bank);
 bool is_same_device(cl_mem buffer1, cl_mem buffer2);
 
@@ -143,6 +166,10 @@ template <typename F, typename ...Args>
 inline void
 set_event_action(xocl::event* event, F&& f, Args&&... args)
 {
+  // outside of a profile region, avoid creating the lambdas
+  if (!is_capture_active())
+    return;
+
   // if profiling is off, then avoid creating the lambdas
 #if 0 // For the time being, to preserve old log profile data behavior, 
       // always store the profile action, see comments in xocl/core/event.h
@@ -170,6 +197,7 @@ struct function_call_logger
 
   static std::atomic <unsigned int> m_funcid_global;
   unsigned int m_funcid;
+  bool m_active = false;
   const char* m_name = nullptr;
   long long m_address = 0;
 };
@@ -56,6 +56,8 @@ clGetMemObjDeviceAddress(cl_mem mem,
   validOrError(mem,device,size,address);
 
   if (auto boh = xocl(mem)->get_buffer_object_or_null(xocl(device))) {
+    // device writes through the raw address are not seen by xocl
+    xocl(mem)->disable_host_valid_tracking();
     auto xdevice = xocl(device)->get_xrt_device();
     auto addr = reinterpret_cast<uintptr_t*>(address);
     *addr = xdevice->getDeviceAddr(boh);
@@ -0,0 +1,76 @@
+/**
+ * Copyright (C) 2018-2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <CL/opencl.h>
+#include "xocl/core/stream.h"
+#include "xocl/core/error.h"
+#include "plugin/xdp/profile.h"
+
+namespace xocl {
+
+static void
+validOrError(cl_stream      stream,
+	     cl_stream_mem  mem,
+	     size_t         frame_size,
+	     cl_uint*       num_frames,
+	     cl_int*        errcode_ret)
+{
+  if (!mem)
+    throw xocl::error(CL_INVALID_MEM_OBJECT,"no stream buffer");
+  if (!frame_size || frame_size > xocl::xocl(mem)->m_size)
+    throw xocl::error(CL_INVALID_VALUE,"invalid frame size");
+}
+
+static cl_int
+clRegisterStreamBuffer(cl_stream      stream,
+		       cl_stream_mem  mem,
+		       size_t         frame_size,
+		       cl_uint*       num_frames,
+		       cl_int*        errcode_ret)
+{
+  validOrError(stream,mem,frame_size,num_frames,errcode_ret);
+  auto frames = xocl::xocl(stream)->register_buffer(xocl::xocl(mem),frame_size);
+  if (frames < 0)
+    throw xocl::error(CL_INVALID_OPERATION,"register stream buffer failed");
+  xocl::assign(num_frames,frames);
+  xocl::assign(errcode_ret,CL_SUCCESS);
+  return CL_SUCCESS;
+}
+
+} //xocl
+
+CL_API_ENTRY cl_int CL_API_CALL
+clRegisterStreamBuffer(cl_stream      stream,
+		       cl_stream_mem  mem,
+		       size_t         frame_size,
+		       cl_uint*       num_frames,
+		       cl_int*        errcode_ret) CL_API_SUFFIX__VERSION_1_0
+{
+  try {
+    PROFILE_LOG_FUNCTION_CALL;
+    return xocl::clRegisterStreamBuffer
+      (stream,mem,frame_size,num_frames,errcode_ret);
+  }
+  catch (const xrt::error& ex) {
+    xocl::send_exception_message(ex.what());
+    xocl::assign(errcode_ret,ex.get_code());
+  }
+  catch (const std::exception& ex) {
+    xocl::send_exception_message(ex.what());
+    xocl::assign(errcode_ret,CL_INVALID_VALUE);
+  }
+  return CL_INVALID_VALUE;
+}
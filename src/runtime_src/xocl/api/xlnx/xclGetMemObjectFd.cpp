@@ -49,6 +49,8 @@ clGetMemObjectFd(cl_mem mem,
   auto context = xmem->get_context();
   for (auto device : context->get_device_range()) {
     if (auto boh = xmem->get_buffer_object_or_null(device)) {
+      // device writes through the exported BO are not seen by xocl
+      xmem->disable_host_valid_tracking();
       *fd = device->get_xrt_device()->getMemObjectFd(boh);
       return CL_SUCCESS;
     }
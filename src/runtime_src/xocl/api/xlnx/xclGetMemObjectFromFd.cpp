@@ -78,6 +78,7 @@ clGetMemObjectFromFd(cl_context context,
     buffer->set_ext_flags(get_xlnx_ext_flags(flags,nullptr));
 
     buffer->update_buffer_object_map(xdevice,boh);
+    buffer->disable_host_valid_tracking();
     *mem = buffer.release();
     return CL_SUCCESS;
 
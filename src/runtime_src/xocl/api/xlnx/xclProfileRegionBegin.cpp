@@ -0,0 +1,56 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "xocl/core/error.h"
+#include "plugin/xdp/profile.h"
+#include <CL/cl_ext_xilinx.h>
+
+namespace xocl {
+
+static cl_int
+xclProfileRegionBegin()
+{
+  profile::region_begin();
+  return CL_SUCCESS;
+}
+
+} // xocl
+
+namespace xlnx {
+
+cl_int
+xclProfileRegionBegin()
+{
+  try {
+    return xocl::xclProfileRegionBegin();
+  }
+  catch (const xrt::error& ex) {
+    xocl::send_exception_message(ex.what());
+    return ex.get_code();
+  }
+  catch (const std::exception& ex) {
+    xocl::send_exception_message(ex.what());
+    return CL_OUT_OF_HOST_MEMORY;
+  }
+}
+
+} // xlnx
+
+CL_API_ENTRY cl_int CL_API_CALL
+xclProfileRegionBegin(void)
+{
+  return xlnx::xclProfileRegionBegin();
+}
@@ -0,0 +1,90 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "callback.h"
+
+#include "xrt/config.h"
+#include "xrt/util/task.h"
+#include "xrt/util/thread.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Pool of threads servicing a task queue of user callbacks
+class callback_executor
+{
+  xrt::task::queue m_queue;
+  std::vector<std::thread> m_workers;
+  std::atomic<bool> m_stopped {false};
+
+public:
+  explicit
+  callback_executor(unsigned int threads)
+  {
+    for (unsigned int i=0; i<threads; ++i)
+      m_workers.emplace_back(xrt::thread(xrt::task::worker,std::ref(m_queue)));
+  }
+
+  ~callback_executor()
+  {
+    m_stopped = true;
+    m_queue.stop();
+    for (auto& t : m_workers)
+      t.join();
+  }
+
+  bool
+  run(std::function<void()>& fcn)
+  {
+    if (m_stopped)
+      return false;
+    xrt::task::createF(m_queue,std::move(fcn));
+    return true;
+  }
+};
+
+static callback_executor*
+get_executor()
+{
+  static auto threads = xrt::config::get_callback_threads();
+  if (!threads)
+    return nullptr;
+  static callback_executor executor(threads);
+  return &executor;
+}
+
+} // namespace
+
+namespace xocl {
+
+bool
+async_user_callbacks()
+{
+  return get_executor() != nullptr;
+}
+
+void
+run_user_callback(std::function<void()> fcn)
+{
+  auto executor = get_executor();
+  if (!executor || !executor->run(fcn))
+    fcn();
+}
+
+} // xocl
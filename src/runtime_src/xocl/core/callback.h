@@ -0,0 +1,50 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef xocl_core_callback_h_
+#define xocl_core_callback_h_
+
+#include <functional>
+
+namespace xocl {
+
+/**
+ * Check if user callbacks are run by the callback executor
+ *
+ * @return
+ *   true if Runtime.callback_threads is non zero, false if callbacks
+ *   run inline on the calling thread
+ */
+bool
+async_user_callbacks();
+
+/**
+ * Run a user callback
+ *
+ * The function is queued to the callback executor, a pool of
+ * Runtime.callback_threads threads, and the calling thread returns
+ * immediately.  Runs the function inline if the executor is disabled
+ * or has been stopped at program exit.
+ *
+ * @param fcn
+ *   Function wrapping the user callback(s) to run
+ */
+void
+run_user_callback(std::function<void()> fcn);
+
+} // xocl
+
+#endif
@@ -65,10 +65,70 @@ command_queue::
   for (auto& cb : sg_destructor_callbacks)
     cb(this);
 
-  assert(m_events.empty());
+  assert(!m_num_events);
   m_context->remove_queue(this);
 }
 
+command_queue*
+command_queue::
+get_split_queue(device* device)
+{
+  if (device==get_device())
+    return this;
+
+  std::lock_guard<std::mutex> lk(m_split_mutex);
+  for (auto& queue : m_split_queues)
+    if (queue->get_device()==device)
+      return queue.get();
+
+  auto props = static_cast<cl_command_queue_properties>(m_props) & ~CL_QUEUE_SPLIT_NDRANGE;
+  ptr<command_queue> queue(new command_queue(m_context.get(),device,props));
+
+  // Release the refcount returned by ctor, it is now captured by queue
+  queue->release();
+  m_split_queues.push_back(queue);
+  return queue.get();
+}
+
+event*
+command_queue::
+next_event(const event* ev)
+{
+  return ev->m_queue_next;
+}
+
+void
+command_queue::
+link(event* ev)
+{
+  ev->m_queue_prev = m_events_tail;
+  ev->m_queue_next = nullptr;
+  ev->m_queue_linked = true;
+  if (m_events_tail)
+    m_events_tail->m_queue_next = ev;
+  else
+    m_events_head = ev;
+  m_events_tail = ev;
+  ++m_num_events;
+}
+
+void
+command_queue::
+unlink(event* ev)
+{
+  if (ev->m_queue_prev)
+    ev->m_queue_prev->m_queue_next = ev->m_queue_next;
+  else
+    m_events_head = ev->m_queue_next;
+  if (ev->m_queue_next)
+    ev->m_queue_next->m_queue_prev = ev->m_queue_prev;
+  else
+    m_events_tail = ev->m_queue_prev;
+  ev->m_queue_prev = ev->m_queue_next = nullptr;
+  ev->m_queue_linked = false;
+  --m_num_events;
+}
+
 bool
 command_queue::
 queue(event* ev)
@@ -85,16 +145,18 @@ queue(event* ev)
   }
 
   if (ooo) {
-    for (auto b: m_barriers)
-      b->chain(ev);
+    if (m_last_barrier) {
+      m_last_barrier->chain(ev);
 
-    xocl::profile::log_dependencies(ev, m_barriers.size(), reinterpret_cast<cl_event*>(m_barriers.data()) );
+      auto tmp_lval = static_cast<cl_event>(m_last_barrier);
+      xocl::profile::log_dependencies(ev, 1, &tmp_lval);
+    }
 
     if (ev->get_command_type()==CL_COMMAND_BARRIER)
-      m_barriers.push_back(ev);
+      m_last_barrier = ev;
   }
 
-  m_events.insert(ev);
+  link(ev);
   m_last_queued_event = ev;
   ev->retain();
 
@@ -133,33 +195,32 @@ bool
 command_queue::
 remove(event* ev)
 {
-  std::lock_guard<std::mutex> lk(m_events_mutex);
-
-  auto it = m_events.find(ev);
-  if (it==m_events.end())
-    throw xocl::error(CL_INVALID_EVENT,"event " + ev->get_suid() + " never submitted");
-  m_events.erase(it);
-  if (m_last_queued_event==ev)
-    m_last_queued_event = nullptr;
-
-  if ((ev->get_command_type()==CL_COMMAND_BARRIER) && (m_props.test(CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE)))  {
-    auto bit = std::find(m_barriers.begin(),m_barriers.end(),ev);
-    assert(bit!=m_barriers.end());
-    m_barriers.erase(bit);
+  bool empty = false;
+  ptr<event> last_queued;
+  {
+    std::lock_guard<std::mutex> lk(m_events_mutex);
+
+    if (!ev->m_queue_linked)
+      throw xocl::error(CL_INVALID_EVENT,"event " + ev->get_suid() + " never submitted");
+    unlink(ev);
+    if (m_last_queued_event==ev)
+      // released below, outside the lock
+      last_queued = std::move(m_last_queued_event);
+
+    // Barriers complete in queue order, only the most recent barrier
+    // can still be referenced
+    if (m_last_barrier==ev)
+      m_last_barrier = nullptr;
+
+    empty = (m_num_events==0);
   }
 
-  ev->release();
-  if (m_events.empty())
+  // Notify and drop the queue reference outside the lock.  The
+  // caller retains the event, which in turn retains this queue, for
+  // the duration of removal.
+  if (empty)
     m_has_events.notify_all();
-
-#if 0
-  if ((m_events.size() % 1000)==0) {
-    static unsigned long last = time_ns();
-    auto now = time_ns();
-    XOCL_PRINT(std::cout,m_events.size()," ",(now-last)*1e-6,"\n");
-    last = now;
-  }
-#endif
+  ev->release();
 
   return true;
 }
@@ -177,7 +238,7 @@ wait() const
 {
   XOCL_DEBUG(std::cout,"xocl::command_queue::wait(",m_uid,")\n");
   std::unique_lock<std::mutex> lk(m_events_mutex);
-  while (m_events.size())
+  while (m_num_events)
     m_has_events.wait(lk);
 }
 
@@ -187,7 +248,7 @@ flush() const
 {
   XOCL_DEBUG(std::cout,"xocl::command_queue::flush(",m_uid,")\n");
   std::unique_lock<std::mutex> lk(m_events_mutex);
-  while (m_events.size())
+  while (m_num_events)
     m_has_events.wait(lk);
 }
 
@@ -197,7 +258,7 @@ wait_and_lock() const
 {
   XOCL_DEBUG(std::cout,"xocl::command_queue::wait_and_lock(",m_uid,")\n");
   std::unique_lock<std::mutex> lk(m_events_mutex);
-  while (m_events.size())
+  while (m_num_events)
     m_has_events.wait(lk);
   return queue_lock(std::move(lk));
 }
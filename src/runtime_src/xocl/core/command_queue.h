@@ -23,7 +23,7 @@
 
 #include <vector>
 #include <set>
-#include <unordered_set>
+#include <iterator>
 #include <mutex>
 #include <condition_variable>
 #include <functional>
@@ -38,9 +38,69 @@ class command_queue : public refcount, public _cl_command_queue
   // store queued and submitted events as references.  instead
   // it retains the event upon queuing and releases it when the
   // event is removed.
+  // Next event in list of queued and submitted events
+  static event*
+  next_event(const event* ev);
+
 public:
-  using event_queue_type = std::unordered_set<event*>;
-  using event_iterator_type = event_queue_type::iterator;
+  /**
+   * Iterator over queued and submitted events.
+   *
+   * The events are linked in queue order through the events
+   * themselves, so queuing and removing an event neither hashes nor
+   * allocates.
+   */
+  class event_iterator_type
+  {
+    event* m_ev = nullptr;
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = event*;
+    using difference_type = std::ptrdiff_t;
+    using pointer = event* const*;
+    using reference = event* const&;
+
+    event_iterator_type() {}
+
+    explicit
+    event_iterator_type(event* ev)
+      : m_ev(ev)
+    {}
+
+    reference
+    operator*() const
+    {
+      return m_ev;
+    }
+
+    event_iterator_type&
+    operator++()
+    {
+      m_ev = next_event(m_ev);
+      return *this;
+    }
+
+    event_iterator_type
+    operator++(int)
+    {
+      auto tmp = *this;
+      m_ev = next_event(m_ev);
+      return tmp;
+    }
+
+    bool
+    operator==(const event_iterator_type& rhs) const
+    {
+      return m_ev==rhs.m_ev;
+    }
+
+    bool
+    operator!=(const event_iterator_type& rhs) const
+    {
+      return m_ev!=rhs.m_ev;
+    }
+  };
+
 
   using commandqueue_callback_type = std::function<void(command_queue*)>;
   using commandqueue_callback_list = std::vector<commandqueue_callback_type>;
@@ -101,6 +161,38 @@ public:
     return m_props.test(CL_QUEUE_PROFILING_ENABLE);
   }
 
+  /**
+   * Check if NDRange kernels are split across the context devices
+   */
+  bool
+  is_split_ndrange_enabled() const
+  {
+    return m_props.test(CL_QUEUE_SPLIT_NDRANGE);
+  }
+
+  /**
+   * Check if buffer transfers of this queue are latency class
+   */
+  bool
+  is_high_priority() const
+  {
+    return m_props.test(CL_QUEUE_HIGH_PRIORITY_XILINX);
+  }
+
+  /**
+   * Get queue for executing part of a split NDRange on a device
+   *
+   * The queues for devices other than this queue's device are
+   * created on first use and owned by this queue.  They have this
+   * queue's properties except CL_QUEUE_SPLIT_NDRANGE.
+   *
+   * @return
+   *   This queue if @device is the queue's device, otherwise the
+   *   internal queue for @device
+   */
+  command_queue*
+  get_split_queue(device* device);
+
   /**
    * Get range with events that are queued or submitted
    */
@@ -108,7 +200,7 @@ public:
   get_event_range()
   {
     std::unique_lock<std::mutex> lock(m_events_mutex);
-    return range_lock<event_iterator_type>(m_events.begin(),m_events.end(),std::move(lock));
+    return range_lock<event_iterator_type>(event_iterator_type(m_events_head),event_iterator_type(),std::move(lock));
   }
 
   /**
@@ -194,16 +286,37 @@ public:
   register_destructor_callbacks(commandqueue_callback_type&& aCallback);
 
 private:
+  // Append event to, and unlink event from, the event list.
+  // Pre-condition: m_events_mutex is locked
+  void
+  link(event* ev);
+
+  void
+  unlink(event* ev);
+
   unsigned int m_uid = 0;
   ptr<context> m_context;
   ptr<device> m_device;
 
   mutable std::mutex m_events_mutex;
   mutable std::condition_variable m_has_events;
-  event_queue_type m_events;
-  std::vector<event*> m_barriers;
+
+  // Queued and submitted events in queue order
+  event* m_events_head = nullptr;
+  event* m_events_tail = nullptr;
+  size_t m_num_events = 0;
+
+  // Most recently queued barrier of an out of order queue while it
+  // is outstanding.  Every barrier is chained behind the barrier
+  // queued before it, so the most recent barrier completes last and
+  // a new event needs to chain only that one.
+  event* m_last_barrier = nullptr;
   ptr<event> m_last_queued_event;
   property_type m_props;
+
+  // Internal queues of other devices used by split NDRanges
+  std::mutex m_split_mutex;
+  std::vector<ptr<command_queue>> m_split_queues;
 };
 
 } // xocl
@@ -17,6 +17,7 @@
 #include "context.h"
 #include "device.h"
 #include "platform.h"
+#include <future>
 #include <iostream>
 
 namespace xocl {
@@ -37,6 +38,16 @@ context(const cl_context_properties* properties
                  ,[](cl_device_id dev) {
                    return xocl::xocl(dev);
                  });
+
+  // Devices are opened on first use, open the devices of a multi
+  // device context in parallel
+  if (m_devices.size() > 1) {
+    std::vector<std::future<void>> opens;
+    for (auto device : m_devices)
+      opens.emplace_back(std::async(std::launch::async,[device] { device->get_xrt_device(); }));
+    for (auto& open : opens)
+      open.get();
+  }
 }
 
 context::
@@ -24,6 +24,7 @@
 #include "xocl/xclbin/xclbin.h"
 #include "xrt/scheduler/scheduler.h"
 #include "xrt/util/config_reader.h"
+#include "xrt/util/memcpy.h"
 
 #include "core/common/xclbin_parser.h"
 
@@ -31,11 +32,18 @@
 #include <fstream>
 #include <sstream>
 #include <cstring>
+#include <deque>
+#include <algorithm>
 
 namespace {
 
 static unsigned int uid_count = 0;
 
+// Pipelined buffer writes are split on page boundaries and keep at
+// most this many chunk syncs in flight
+static const size_t page_size = 4096;
+static const size_t write_pipeline_depth = 4;
+
 static
 std::string
 to_hex(void* addr)
@@ -76,7 +84,8 @@ default_allocation_message(const xocl::device* device,const xocl::memory* mem,
       << "before first enqueue operation; "
       << "allocating in default memory bank '" << memidx << "'.";
 
-  if (xrt::config::get_feature_toggle("Runtime.strict_bank_rule"))
+  static bool strict = xrt::config::get_feature_toggle("Runtime.strict_bank_rule");
+  if (strict)
     throw std::runtime_error(str.str());
   else
     xrt::message::send(xrt::message::severity_level::XRT_WARNING,str.str());
@@ -101,6 +110,40 @@ host_copy_message(const xocl::memory* dst, const xocl::memory* src)
   xrt::message::send(xrt::message::severity_level::XRT_WARNING,str.str());
 }
 
+// Allocate a buffer object.  With device memory oversubscription,
+// least recently used buffers are evicted from the device as long as
+// the allocation fails for lack of memory.
+template <typename AllocFunction>
+static xrt::device::BufferObjectHandle
+alloc_or_evict(xocl::device* device, const xocl::memory* mem,
+               xocl::device::memidx_type memidx, AllocFunction&& alloc)
+{
+  while (true) {
+    try {
+      return alloc();
+    }
+    catch (const std::bad_alloc&) {
+      if (!xrt::config::get_device_oversubscription() || !device->evict_buffer(mem,memidx))
+        throw;
+    }
+  }
+}
+
+// Fill dst with size bytes of repeated pattern.  The pattern is
+// copied once, then the filled prefix is doubled, which takes
+// log2(size/pattern_size) memcpy calls.
+static void
+fill_pattern(char* dst, const void* pattern, size_t pattern_size, size_t size)
+{
+  if (!size)
+    return;
+  auto sz = std::min(pattern_size,size);
+  std::memcpy(dst,pattern,sz);
+  for (size_t filled = sz; filled < size; filled += sz) {
+    sz = std::min(filled,size-filled);
+    std::memcpy(dst+filled,dst,sz);
+  }
+}
 
 static inline unsigned
 myctz(unsigned val)
@@ -133,11 +176,25 @@ sync_to_ubuf(xocl::memory* buffer, size_t offset, size_t size,
     if (ubuf!=hbuf) {
       ubuf = static_cast<char*>(ubuf) + offset;
       hbuf = static_cast<char*>(hbuf) + offset;
-      std::memcpy(ubuf,hbuf,size);
+      xrt::stream_copy(ubuf,hbuf,size);
     }
   }
 }
 
+// Sync from device the ranges of [offset,offset+size) written on
+// device since last synced, and record the range as valid on host.
+// Return the ranges that were synced.
+static xocl::memory::range_list
+sync_host_stale(xocl::memory* buffer, size_t offset, size_t size,
+                xrt::device* xdevice, const xrt::device::BufferObjectHandle& boh)
+{
+  auto ranges = buffer->get_host_stale_ranges(offset,size);
+  for (auto& range : ranges)
+    xdevice->sync(boh,range.second-range.first,range.first,xrt::hal::device::direction::DEVICE2HOST,false);
+  buffer->set_host_valid(offset,size);
+  return ranges;
+}
+
 // Copy ubuf to hbuf if necessary
 static void
 sync_to_hbuf(xocl::memory* buffer, size_t offset, size_t size,
@@ -153,7 +210,7 @@ sync_to_hbuf(xocl::memory* buffer, size_t offset, size_t size,
     if (ubuf!=hbuf) {
       ubuf = static_cast<char*>(ubuf) + offset;
       hbuf = static_cast<char*>(hbuf) + offset;
-      std::memcpy(hbuf,ubuf,size);
+      xrt::stream_copy(hbuf,ubuf,size);
     }
   }
 }
@@ -267,22 +324,26 @@ alloc(memory* mem, memidx_type memidx)
   auto host_ptr = mem->get_host_ptr();
   auto sz = mem->get_size();
   if (is_aligned_ptr(host_ptr)) {
-    auto boh = m_xdevice->alloc(sz,xrt::device::memoryDomain::XRT_DEVICE_RAM,memidx,host_ptr);
+    auto boh = alloc_or_evict(this,mem,memidx,[&] {
+      return get_xrt_device()->alloc(sz,xrt::device::memoryDomain::XRT_DEVICE_RAM,memidx,host_ptr);
+    });
     track(mem);
     return boh;
   }
 
   auto domain = get_mem_domain(mem);
 
-  auto boh = m_xdevice->alloc(sz,domain,memidx,nullptr);
+  auto boh = alloc_or_evict(this,mem,memidx,[&] {
+    return get_xrt_device()->alloc(sz,domain,memidx,nullptr);
+  });
   track(mem);
 
   // Handle unaligned user ptr
   if (host_ptr) {
     unaligned_message(host_ptr);
-    auto bo_host_ptr = m_xdevice->map(boh);
-    memcpy(bo_host_ptr, host_ptr, sz);
-    m_xdevice->unmap(boh);
+    auto bo_host_ptr = get_xrt_device()->map(boh);
+    xrt::stream_copy(bo_host_ptr, host_ptr, sz);
+    get_xrt_device()->unmap(boh);
   }
   return boh;
 }
@@ -295,18 +356,18 @@ alloc(memory* mem)
   auto sz = mem->get_size();
 
   if (is_aligned_ptr(host_ptr)) {
-    auto boh = m_xdevice->alloc(sz,host_ptr);
+    auto boh = alloc_or_evict(this,mem,-1,[&] { return get_xrt_device()->alloc(sz,host_ptr); });
     track(mem);
     return boh;
   }
 
-  auto boh = m_xdevice->alloc(sz);
+  auto boh = alloc_or_evict(this,mem,-1,[&] { return get_xrt_device()->alloc(sz); });
   // Handle unaligned user ptr
   if (host_ptr) {
     unaligned_message(host_ptr);
-    auto bo_host_ptr = m_xdevice->map(boh);
-    memcpy(bo_host_ptr, host_ptr, sz);
-    m_xdevice->unmap(boh);
+    auto bo_host_ptr = get_xrt_device()->map(boh);
+    xrt::stream_copy(bo_host_ptr, host_ptr, sz);
+    get_xrt_device()->unmap(boh);
   }
   track(mem);
   return boh;
@@ -314,7 +375,7 @@ alloc(memory* mem)
 
 int
 device::
-get_stream(xrt::device::stream_flags flags, xrt::device::stream_attrs attrs, const cl_mem_ext_ptr_t* ext, xrt::device::stream_handle* stream, int32_t& conn)
+get_stream(xrt::device::stream_flags flags, xrt::device::stream_attrs attrs, const cl_mem_ext_ptr_t* ext, std::vector<xrt::device::stream_handle>& streams, int32_t& conn)
 {
   uint64_t route = (uint64_t)-1;
   uint64_t flow = (uint64_t)-1;
@@ -353,15 +414,32 @@ get_stream(xrt::device::stream_flags flags, xrt::device::stream_attrs attrs, con
     xocl(kernel)->set_argument(ext->flags,sizeof(cl_mem),nullptr);
   }
 
-  if (flags & CL_STREAM_READ_ONLY)
-    rc = m_xdevice->createReadStream(flags, attrs, route, flow, stream);
-  else if (flags & CL_STREAM_WRITE_ONLY)
-    rc = m_xdevice->createWriteStream(flags, attrs, route, flow, stream);
-  else
-    throw xocl::error(CL_INVALID_OPERATION,"Unknown stream type specified");
+  // Sharded write stream, one queue per shard on the same route
+  unsigned int shards = (flags >> 8) & 0xf;
+  flags &= ~(CL_STREAM_SHARDS(0xf) | CL_STREAM_SHARDS_BY_SIZE);
+  if (shards > 1 && (flags & CL_STREAM_READ_ONLY))
+    throw xocl::error(CL_INVALID_OPERATION,"Read streams cannot be sharded");
+  if (shards > 1)
+    flags |= CL_STREAM_SHARED;
+  shards = std::max(shards,1u);
+
+  for (unsigned int i = 0; i < shards; ++i) {
+    xrt::device::stream_handle stream = 0;
+    if (flags & CL_STREAM_READ_ONLY)
+      rc = get_xrt_device()->createReadStream(flags, attrs, route, flow, &stream);
+    else if (flags & CL_STREAM_WRITE_ONLY)
+      rc = get_xrt_device()->createWriteStream(flags, attrs, route, flow, &stream);
+    else
+      throw xocl::error(CL_INVALID_OPERATION,"Unknown stream type specified");
 
-  if(rc)
-    throw xocl::error(CL_INVALID_OPERATION,"Create stream failed");
+    if(rc) {
+      for (auto s : streams)
+        get_xrt_device()->closeStream(s);
+      streams.clear();
+      throw xocl::error(CL_INVALID_OPERATION,"Create stream failed");
+    }
+    streams.push_back(stream);
+  }
   return rc;
 }
 
@@ -371,42 +449,63 @@ close_stream(xrt::device::stream_handle stream, int connidx)
 {
   assert(connidx!=-1);
   clear_connection(connidx);
-  return m_xdevice->closeStream(stream);
+  return get_xrt_device()->closeStream(stream);
+}
+
+int
+device::
+close_stream(xrt::device::stream_handle stream)
+{
+  return get_xrt_device()->closeStream(stream);
 }
 
 ssize_t
 device::
 write_stream(xrt::device::stream_handle stream, const void* ptr, size_t size, xrt::device::stream_xfer_req* req)
 {
-  return m_xdevice->writeStream(stream, ptr, size, req);
+  return get_xrt_device()->writeStream(stream, ptr, size, req);
 }
 
 ssize_t
 device::
 read_stream(xrt::device::stream_handle stream, void* ptr, size_t size, xrt::device::stream_xfer_req* req)
 {
-  return m_xdevice->readStream(stream, ptr, size, req);
+  return get_xrt_device()->readStream(stream, ptr, size, req);
 }
 
 xrt::device::stream_buf
 device::
 alloc_stream_buf(size_t size, xrt::device::stream_buf_handle* handle)
 {
-  return m_xdevice->allocStreamBuf(size,handle);
+  return get_xrt_device()->allocStreamBuf(size,handle);
 }
 
 int
 device::
 free_stream_buf(xrt::device::stream_buf_handle handle)
 {
-  return m_xdevice->freeStreamBuf(handle);
+  return get_xrt_device()->freeStreamBuf(handle);
 }
 
 int
 device::
 poll_streams(xrt::device::stream_xfer_completions* comps, int min, int max, int* actual, int timeout)
 {
-  return m_xdevice->pollStreams(comps, min,max,actual,timeout);
+  return get_xrt_device()->pollStreams(comps, min,max,actual,timeout);
+}
+
+int
+device::
+register_stream_buf(xrt::device::stream_handle stream, xrt::device::stream_buf buf, size_t frame_size)
+{
+  return get_xrt_device()->registerStreamBuf(stream, buf, frame_size);
+}
+
+int
+device::
+poll_stream(xrt::device::stream_handle stream, xrt::device::stream_xfer_completions* comps, int min, int max, int* actual, int timeout)
+{
+  return get_xrt_device()->pollStream(stream, comps, min,max,actual,timeout);
 }
 
 device::
@@ -420,9 +519,29 @@ device::
 device(platform* pltf, xrt::device* hw_device, xrt::device* swem_device, xrt::device* hwem_device)
   : m_uid(uid_count++), m_platform(pltf), m_xdevice(nullptr)
   , m_hw_device(hw_device), m_swem_device(swem_device), m_hwem_device(hwem_device)
+  , m_lazy_open(true)
 {
   XOCL_DEBUG(std::cout,"xocl::device::device(",m_uid,")\n");
 
+  // The xrt devices are opened on first use, see open_xrt_device()
+}
+
+void
+device::
+open_xrt_device() const
+{
+  if (!m_lazy_open)
+    return;
+
+  std::call_once(m_open_flag,[this] { const_cast<device*>(this)->open_xrt_device_once(); });
+}
+
+void
+device::
+open_xrt_device_once()
+{
+  XOCL_DEBUG(std::cout,"xocl::device::open_xrt_device(",m_uid,")\n");
+
   // Open the devices.  I don't recall what it means to open a device?
   std::string hallog = xrt::config::get_hal_logging();
   if (!hallog.compare("null"))
@@ -474,7 +593,7 @@ device(device* parent, const compute_unit_vector_type& cus)
   , m_active(parent->m_active)
   , m_xclbin(parent->m_xclbin)
   , m_platform(parent->m_platform)
-  , m_xdevice(parent->m_xdevice)
+  , m_xdevice(parent->get_xrt_device())
   , m_hw_device(parent->m_hw_device)
   , m_swem_device(parent->m_swem_device)
   , m_hwem_device(parent->m_hwem_device)
@@ -527,6 +646,7 @@ set_xrt_device(const xocl::xclbin& xclbin)
 {
   using target_type = xocl::xclbin::target_type;
   auto core_target = xclbin.target();
+  open_xrt_device();
 
   // Check device is capable of core_target
   if(core_target==target_type::bin && !m_hw_device)
@@ -551,6 +671,7 @@ unsigned int
 device::
 lock()
 {
+  open_xrt_device();
   std::lock_guard<std::mutex> lk(m_mutex);
   // If already locked, return increment lock count
   if (m_locks)
@@ -602,6 +723,7 @@ allocate_buffer_object(memory* mem)
   // sub buffer
   if (auto parent = mem->get_sub_buffer_parent()) {
     auto boh = parent->get_buffer_object(this);
+    parent->disable_rehome();
     auto offset = mem->get_sub_buffer_offset();
     auto size = mem->get_size();
     return xdevice->alloc(boh,size,offset);
@@ -636,6 +758,7 @@ allocate_buffer_object(memory* mem, memidx_type memidx)
   // sub buffer
   if (auto parent = mem->get_sub_buffer_parent()) {
     auto boh = parent->get_buffer_object(this);
+    parent->disable_rehome();
     auto pmemidx = get_boh_memidx(boh);
     if (pmemidx.test(memidx)) {
       auto offset = mem->get_sub_buffer_offset();
@@ -669,7 +792,7 @@ device::
 is_imported(const memory* mem) const
 {
   auto boh = mem->get_buffer_object_or_null(this);
-  return boh ? m_xdevice->is_imported(boh) : false;
+  return boh ? get_xrt_device()->is_imported(boh) : false;
 }
 
 xrt::device::BufferObjectHandle
@@ -738,6 +861,86 @@ get_cu_memidx() const
   return m_cu_memidx;
 }
 
+device::memidx_type
+device::
+place_buffer(size_t size, const memidx_bitmask_type& mask)
+{
+  auto mem = m_xclbin.get_mem_topology();
+  if (!mem)
+    return -1;
+
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_bank_usage.resize(mem->m_count,0);
+  memidx_type memidx = -1;
+  for (int idx=0; idx<mem->m_count && idx<static_cast<int>(mask.size()); ++idx) {
+    auto& md = mem->m_mem_data[idx];
+    if (!md.m_used || !mask.test(idx))
+      continue;
+    if (md.m_type!=MEM_DDR3 && md.m_type!=MEM_DDR4 && md.m_type!=MEM_DRAM && md.m_type!=MEM_HBM)
+      continue;
+    if (memidx==-1 || m_bank_usage[idx]<m_bank_usage[memidx])
+      memidx = idx;
+  }
+
+  if (memidx>=0)
+    m_bank_usage[memidx] += size;
+  return memidx;
+}
+
+void
+device::
+unplace_buffer(memidx_type memidx, size_t size)
+{
+  std::lock_guard<std::mutex> lk(m_mutex);
+  if (memidx>=0 && memidx<static_cast<memidx_type>(m_bank_usage.size()))
+    m_bank_usage[memidx] -= std::min(size,m_bank_usage[memidx]);
+}
+
+void
+device::
+touch_evictable(memory* mem)
+{
+  std::lock_guard<std::mutex> lk(m_evict_mutex);
+  auto itr = m_evict_pos.find(mem);
+  if (itr!=m_evict_pos.end())
+    m_evict_lru.splice(m_evict_lru.end(),m_evict_lru,(*itr).second);
+  else
+    m_evict_pos.emplace(mem,m_evict_lru.insert(m_evict_lru.end(),mem));
+}
+
+void
+device::
+untrack_evictable(const memory* mem)
+{
+  std::lock_guard<std::mutex> lk(m_evict_mutex);
+  auto itr = m_evict_pos.find(mem);
+  if (itr==m_evict_pos.end())
+    return;
+  m_evict_lru.erase((*itr).second);
+  m_evict_pos.erase(itr);
+}
+
+bool
+device::
+evict_buffer(const memory* exclude, memidx_type memidx)
+{
+  // Buffers are skipped when in use, memory::evict() only try-locks
+  // the buffer, so the buffer being allocated must be excluded
+  std::lock_guard<std::mutex> lk(m_evict_mutex);
+  for (auto itr=m_evict_lru.begin(); itr!=m_evict_lru.end(); ++itr) {
+    auto mem = *itr;
+    if (mem==exclude || (memidx!=-1 && mem->get_memidx()!=memidx))
+      continue;
+    if (!mem->evict(this))
+      continue;
+    XOCL_DEBUG(std::cout,"memory(",mem->get_uid(),") evicted from device(",m_uid,")\n");
+    m_evict_pos.erase(mem);
+    m_evict_lru.erase(itr);
+    return true;
+  }
+  return false;
+}
+
 device::memidx_bitmask_type
 device::
 get_cu_memidx(kernel* kernel, int argidx) const
@@ -782,11 +985,32 @@ map_buffer(memory* buffer, cl_map_flags map_flags, size_t offset, size_t size, v
   auto xdevice = get_xrt_device();
   xrt::device::BufferObjectHandle boh;
 
+  // Mapped ptr may reference the buffer object host memory
+  buffer->disable_rehome();
+
+  // P2P buffer host mapping is the device memory itself, the BO
+  // mapping is returned as is with no sync and no copy
+  void* result = nullptr;
+  if (buffer->is_device_memory_only_p2p()) {
+    boh = buffer->get_buffer_object(this);
+    auto hbuf = xdevice->map(boh);
+    xdevice->unmap(boh);
+    result = static_cast<char*>(hbuf) + offset;
+    assert(!assert_result || result==assert_result);
+    std::lock_guard<std::mutex> lk(m_mutex);
+    auto& mapinfo = m_mapped[result];
+    mapinfo.flags = map_flags;
+    mapinfo.offset = offset;
+    mapinfo.size = std::max(mapinfo.size,size);
+    return result;
+  }
+
   // If buffer is resident it must be refreshed unless CL_MAP_INVALIDATE_REGION
   // is specified in which case host will discard current content
+  // Only ranges written on device since last synced are refreshed.
   if (!(map_flags & CL_MAP_WRITE_INVALIDATE_REGION) && buffer->is_resident(this)) {
     boh = buffer->get_buffer_object_or_error(this);
-    xdevice->sync(boh,size,offset,xrt::hal::device::direction::DEVICE2HOST,false);
+    sync_host_stale(buffer,offset,size,xdevice,boh);
   }
 
   if (!boh)
@@ -801,13 +1025,13 @@ map_buffer(memory* buffer, cl_map_flags map_flags, size_t offset, size_t size, v
     if (ubuf) {
       auto dst = static_cast<char*>(ubuf) + offset;
       auto src = static_cast<char*>(hbuf) + offset;
-      memcpy(dst,src,size);
+      xrt::stream_copy(dst,src,size);
     }
     else
       ubuf = hbuf;
   }
 
-  void* result = static_cast<char*>(ubuf) + offset;
+  result = static_cast<char*>(ubuf) + offset;
   assert(!assert_result || result==assert_result);
 
   // If this buffer is being mapped for writing, then a following
@@ -845,12 +1069,19 @@ unmap_buffer(memory* buffer, void* mapped_ptr)
     }
   }
 
+  // P2P buffer was mapped directly, host writes are already in
+  // device memory
+  if (buffer->is_device_memory_only_p2p())
+    return;
+
   auto xdevice = get_xrt_device();
   auto boh = buffer->get_buffer_object_or_error(this);
 
-  // Sync data to boh if write flags, and sync to device if resident
+  // Sync data to boh if write flags, and sync to device if resident.
+  // An aligned host ptr is the BO host memory, no copy is needed.
   if (flags & (CL_MAP_WRITE | CL_MAP_WRITE_INVALIDATE_REGION)) {
-    if (auto ubuf = static_cast<char*>(buffer->get_host_ptr()))
+    auto ubuf = static_cast<char*>(buffer->get_host_ptr());
+    if (ubuf && !is_aligned_ptr(ubuf))
       xdevice->write(boh,ubuf+offset,size,offset,false);
     if (buffer->is_resident(this) && !buffer->no_host_memory())
       xdevice->sync(boh,size,offset,xrt::hal::device::direction::HOST2DEVICE,false);
@@ -863,12 +1094,15 @@ migrate_buffer(memory* buffer,cl_mem_migration_flags flags)
 {
   // Support clEnqueueMigrateMemObjects device->host
   if (flags & CL_MIGRATE_MEM_OBJECT_HOST) {
+    // Content of a buffer evicted from device memory is in host memory
+    if (xrt::config::get_device_oversubscription() && !buffer->get_buffer_object_or_null(this))
+      return;
     buffer_resident_or_error(buffer,this);
     auto boh = buffer->get_buffer_object_or_error(this);
     auto xdevice = get_xrt_device();
     if(!buffer->no_host_memory()){
-      xdevice->sync(boh,buffer->get_size(),0,xrt::hal::device::direction::DEVICE2HOST,false);
-      sync_to_ubuf(buffer,0,buffer->get_size(),xdevice,boh);
+      for (auto& range : sync_host_stale(buffer,0,buffer->get_size(),xdevice,boh))
+        sync_to_ubuf(buffer,range.first,range.second-range.first,xdevice,boh);
     }
     return;
   }
@@ -879,14 +1113,72 @@ migrate_buffer(memory* buffer,cl_mem_migration_flags flags)
   xrt::device::BufferObjectHandle boh = buffer->get_buffer_object(this);
 
   if(!buffer->no_host_memory()){
-    // Sync from host to device to make make buffer resident of this device
-    sync_to_hbuf(buffer,0,buffer->get_size(),xdevice,boh);
-    xdevice->sync(boh,buffer->get_size(), 0, xrt::hal::device::direction::HOST2DEVICE,false);
+    // Sync from host to device to make make buffer resident of this
+    // device.  Only ranges not already made resident through a
+    // parent or sub buffer are synced.
+    for (auto& range : buffer->get_nonresident_ranges(this)) {
+      auto size = range.second - range.first;
+      sync_to_hbuf(buffer,range.first,size,xdevice,boh);
+      xdevice->sync(boh,size,range.first,xrt::hal::device::direction::HOST2DEVICE,false);
+    }
   }
   // Now buffer is resident on this device and migrate is complete
   buffer->set_resident(this);
 }
 
+void
+device::
+migrate_buffer_range(memory* buffer, size_t offset, size_t size)
+{
+  auto xdevice = get_xrt_device();
+  auto boh = buffer->get_buffer_object_or_error(this);
+  sync_to_hbuf(buffer,offset,size,xdevice,boh);
+  xdevice->sync(boh,size,offset,xrt::hal::device::direction::HOST2DEVICE,false);
+}
+
+void
+device::
+gather_buffer(memory* buffer, device* from, size_t offset, size_t size)
+{
+  auto fxdevice = from->get_xrt_device();
+  auto fboh = buffer->get_buffer_object_or_error(from);
+  fxdevice->sync(fboh,size,offset,xrt::hal::device::direction::DEVICE2HOST,false);
+  sync_to_ubuf(buffer,offset,size,fxdevice,fboh);
+
+  auto xdevice = get_xrt_device();
+  auto boh = buffer->get_buffer_object_or_error(this);
+  sync_to_hbuf(buffer,offset,size,xdevice,boh);
+  if (buffer->is_resident(this))
+    xdevice->sync(boh,size,offset,xrt::hal::device::direction::HOST2DEVICE,false);
+}
+
+void
+device::
+migrate_buffers(const std::vector<memory*>& buffers)
+{
+  auto xdevice = get_xrt_device();
+
+  // Start all transfers before waiting on any of them
+  std::vector<xrt::device::event> syncs;
+  syncs.reserve(buffers.size());
+  for (auto buffer : buffers) {
+    auto boh = buffer->get_buffer_object(this);
+    if (buffer->no_host_memory())
+      continue;
+    for (auto& range : buffer->get_nonresident_ranges(this)) {
+      auto size = range.second - range.first;
+      sync_to_hbuf(buffer,range.first,size,xdevice,boh);
+      syncs.emplace_back(xdevice->sync(boh,size,range.first,xrt::hal::device::direction::HOST2DEVICE,true));
+    }
+  }
+
+  for (auto& ev : syncs)
+    ev.wait();
+
+  for (auto buffer : buffers)
+    buffer->set_resident(this);
+}
+
 void
 device::
 write_buffer(memory* buffer, size_t offset, size_t size, const void* ptr)
@@ -894,16 +1186,50 @@ write_buffer(memory* buffer, size_t offset, size_t size, const void* ptr)
   auto xdevice = get_xrt_device();
   auto boh = buffer->get_buffer_object(this);
 
+  // Chunk size is a multiple of page size, at least one page
+  static size_t chunk = [] {
+    size_t sz = xrt::config::get_write_pipeline_chunk();
+    return sz ? std::max<size_t>(sz*1024 & ~(page_size-1),page_size) : 0;
+  }();
+
+  if (chunk && size > chunk && buffer->is_resident(this)) {
+    // Copy chunk N+1 into buffer object while chunk N is synced.
+    // Chunks end on page boundaries within the buffer object.
+    std::deque<xrt::device::event> syncs;
+    auto src = static_cast<const char*>(ptr);
+    for (size_t done = 0; done < size;) {
+      auto end = std::min(size,((offset+done+chunk) & ~(page_size-1)) - offset);
+      auto sz = end - done;
+      xdevice->write(boh,src+done,sz,offset+done,false);
+      syncs.emplace_back(xdevice->sync(boh,sz,offset+done,xrt::hal::device::direction::HOST2DEVICE,true));
+      if (syncs.size() > write_pipeline_depth) {
+        syncs.front().wait();
+        syncs.pop_front();
+      }
+      done = end;
+    }
+
+    // Update unaligned ubuf while the last chunks are in flight
+    sync_to_ubuf(buffer,offset,size,xdevice,boh);
+
+    for (auto& ev : syncs)
+      ev.wait();
+    buffer->set_host_valid(offset,size);
+    return;
+  }
+
   // Write data to buffer object at offset
   xdevice->write(boh,ptr,size,offset,false);
 
   // Update unaligned ubuf if necessary
   sync_to_ubuf(buffer,offset,size,xdevice,boh);
 
-  if (buffer->is_resident(this))
+  if (buffer->is_resident(this)) {
     // Sync new written data to device at offset
     // HAL performs read/modify write if necesary
     xdevice->sync(boh,size,offset,xrt::hal::device::direction::HOST2DEVICE,false);
+    buffer->set_host_valid(offset,size);
+  }
 }
 
 void
@@ -914,9 +1240,9 @@ read_buffer(memory* buffer, size_t offset, size_t size, void* ptr)
   auto boh = buffer->get_buffer_object(this);
 
   if (buffer->is_resident(this))
-    // Sync back from device at offset to buffer object
-    // HAL performs skip/copy read if necesary
-    xdevice->sync(boh,size,offset,xrt::hal::device::direction::DEVICE2HOST,false);
+    // Sync back from device the ranges written on device since last
+    // synced.  HAL performs skip/copy read if necesary
+    sync_host_stale(buffer,offset,size,xdevice,boh);
 
   // Read data from buffer object at offset
   xdevice->read(boh,ptr,size,offset,false);
@@ -930,10 +1256,36 @@ device::
 copy_buffer(memory* src_buffer, memory* dst_buffer, size_t src_offset, size_t dst_offset, size_t size, const cmd_type& cmd)
 {
   auto xdevice = get_xrt_device();
+  dst_buffer->set_device_written(dst_offset,size);
 
   // Check if any of the buffers are imported
   bool imported = is_imported(src_buffer) || is_imported(dst_buffer);
 
+  // Copy card to card if src is resident on a peer device only and
+  // either buffer is p2p, the peer device DMAs straight into this device
+  auto src_device = src_buffer->get_resident_device();
+  if (!is_sw_emulation() && !imported && src_device && src_device!=this
+      && (src_buffer->is_device_memory_only_p2p() || dst_buffer->is_device_memory_only_p2p())) {
+    auto cb = [this,src_device](memory* sbuf, memory* dbuf, size_t soff, size_t doff, size_t sz,const cmd_type& c) {
+      try {
+        c->start();
+        auto src_boh = sbuf->get_buffer_object(const_cast<device*>(src_device));
+        auto dst_boh = dbuf->get_buffer_object(this);
+        auto rv = get_xrt_device()->copy_peer(dst_boh,src_boh,sz,doff,soff);
+        if (!rv.valid() || rv.get())
+          throw std::runtime_error("card to card copy failed: " + std::to_string(rv.get()));
+        dbuf->set_resident(this);
+        c->done();
+      }
+      catch (const std::exception& ex) {
+        c->error(ex);
+      }
+    };
+    XOCL_DEBUG(std::cout,"xocl::device::copy_buffer schedules card to card copy\n");
+    xdevice->schedule(cb,xrt::device::queue_type::misc,src_buffer,dst_buffer,src_offset,dst_offset,size,cmd);
+    return;
+  }
+
   // Copy via driver if p2p or device has kdma
   if (!is_sw_emulation() && (imported || get_num_cdmas())) {
     auto cppkt = xrt::command_cast<ert_start_copybo_cmd*>(cmd);
@@ -1013,6 +1365,7 @@ copy_p2p_buffer(memory* src_buffer, memory* dst_buffer, size_t src_offset, size_
   auto xdevice = get_xrt_device();
   auto src_boh = src_buffer->get_buffer_object(this);
   auto dst_boh = dst_buffer->get_buffer_object(this);
+  dst_buffer->set_device_written(dst_offset,size);
   auto rv = xdevice->copy(dst_boh, src_boh, size, dst_offset, src_offset);
   if (rv.get<int>() == 0)
     return;
@@ -1029,16 +1382,56 @@ void
 device::
 fill_buffer(memory* buffer, const void* pattern, size_t pattern_size, size_t offset, size_t size)
 {
-  auto boh = xocl::xocl(buffer)->get_buffer_object(this);
+  buffer->set_device_written(offset,size);
+
+  // Resident buffers are filled on the device when KDMA is available.
+  // Only a seed of replicated pattern crosses PCIe, the seed is then
+  // doubled in device memory with device to device copies.
+  constexpr size_t seed_size = 64*1024;
+  if (size > seed_size && !is_sw_emulation() && get_num_cdmas()
+      && !buffer->is_sub_buffer() && !buffer->no_host_memory() && !is_imported(buffer)
+      && buffer->is_resident(this)) {
+    auto xdevice = get_xrt_device();
+    auto boh = buffer->get_buffer_object(this);
+    auto seed = seed_size - seed_size % pattern_size;
+    if (seed) {
+      std::vector<char> hbuf(seed);
+      fill_pattern(hbuf.data(),pattern,pattern_size,seed);
+      xdevice->write(boh,hbuf.data(),seed,offset,false).wait();
+      xdevice->sync(boh,seed,offset,xrt::device::direction::HOST2DEVICE,false).wait();
+      size_t filled = seed;
+      while (filled < size) {
+        auto sz = std::min(filled,size-filled);
+        if (xdevice->copy(boh,boh,sz,offset+filled,offset).get<int>())
+          break;
+        filled += sz;
+      }
+      if (filled == size)
+        return;
+    }
+  }
+
   char* hbuf = static_cast<char*>(map_buffer(buffer,CL_MAP_WRITE_INVALIDATE_REGION,offset,size,nullptr));
-  char* dst = hbuf;
-  for (; pattern_size <= size; size-=pattern_size, dst+=pattern_size)
-    std::memcpy(dst,pattern,pattern_size);
-  if (size)
-    std::memcpy(dst,pattern,size);
+  fill_pattern(hbuf,pattern,pattern_size,size);
   unmap_buffer(buffer,hbuf);
 }
 
+// Byte range of image data covered by region at origin, from first
+// byte of first row to last byte of last row.  Only this range needs
+// to be synced between host and device.
+static std::pair<size_t,size_t>
+image_span(const memory* image,const size_t* origin,const size_t* region)
+{
+  size_t offset = image->get_image_data_offset()
+    + image->get_image_bytes_per_pixel()*origin[0]
+    + image->get_image_row_pitch()*origin[1]
+    + image->get_image_slice_pitch()*origin[2];
+  size_t size = image->get_image_slice_pitch()*(region[2]-1)
+    + image->get_image_row_pitch()*(region[1]-1)
+    + image->get_image_bytes_per_pixel()*region[0];
+  return {offset,size};
+}
+
 static void
 rw_image(device* device,
          memory* image,const size_t* origin,const size_t* region,size_t row_pitch,size_t slice_pitch
@@ -1047,10 +1440,7 @@ rw_image(device* device,
   auto boh = image->get_buffer_object(device);
   auto xdevice = device->get_xrt_device();
 
-  size_t image_offset = image->get_image_data_offset()
-    + image->get_image_bytes_per_pixel()*origin[0]
-    + image->get_image_row_pitch()*origin[1]
-    + image->get_image_slice_pitch()*origin[2];
+  size_t image_offset = image_span(image,origin,region).first;
 
   if (!origin[0] && region[0]==image->get_image_width() && row_pitch==image->get_image_row_pitch()
       && (region[2]==1
@@ -1062,29 +1452,28 @@ rw_image(device* device,
       xdevice->read(boh,read_to,sz,image_offset,false);
     else
       xdevice->write(boh,write_from,sz,image_offset,false);
+    return;
   }
-  else {
-    size_t image_offset_tmp = image_offset;
-    for (unsigned int j=0; j<region[2]; ++j) {
-      size_t offset = image_offset_tmp;
-      for (unsigned int i=0; i<region[1]; ++i) {
-        if (read_to) {
-          xdevice->read(boh,read_to,image->get_image_bytes_per_pixel()*region[0],offset,false);
-          read_to += row_pitch;
-        }
-        else {
-          xdevice->write(boh,write_from,image->get_image_bytes_per_pixel()*region[0],offset, false);
-          write_from += row_pitch;
-        }
-        offset += image->get_image_row_pitch();
-      }
-      image_offset_tmp += image->get_image_slice_pitch();
+
+  // Repack rows between host pointer and the mapped image with one
+  // memcpy per row
+  auto hbuf = static_cast<char*>(xdevice->map(boh)) + image_offset;
+  size_t row_size = image->get_image_bytes_per_pixel()*region[0];
+  size_t image_row_pitch = image->get_image_row_pitch();
+  size_t image_slice_pitch = image->get_image_slice_pitch();
+  for (size_t j=0; j<region[2]; ++j) {
+    auto image_row = hbuf + j*image_slice_pitch;
+    auto host_row = j*slice_pitch;
+    for (size_t i=0; i<region[1]; ++i) {
       if (read_to)
-        read_to += slice_pitch;
+        std::memcpy(read_to+host_row,image_row,row_size);
       else
-        write_from += slice_pitch;
+        std::memcpy(image_row,write_from+host_row,row_size);
+      image_row += image_row_pitch;
+      host_row += row_pitch;
     }
   }
+  xdevice->unmap(boh);
 }
 
 void
@@ -1094,10 +1483,11 @@ write_image(memory* image,const size_t* origin,const size_t* region,size_t row_p
   // Write from ptr into image
   rw_image(this,image,origin,region,row_pitch,slice_pitch,nullptr,static_cast<const char*>(ptr));
 
-  // Sync newly writte data to device if image is resident
+  // Sync newly written rows to device if image is resident
   if (image->is_resident(this)) {
     auto boh = image->get_buffer_object_or_error(this);
-    get_xrt_device()->sync(boh, image->get_size(), 0,xrt::hal::device::direction::HOST2DEVICE,false);
+    auto span = image_span(image,origin,region);
+    get_xrt_device()->sync(boh,span.second,span.first,xrt::hal::device::direction::HOST2DEVICE,false);
   }
 }
 
@@ -1105,10 +1495,11 @@ void
 device::
 read_image(memory* image,const size_t* origin,const size_t* region,size_t row_pitch,size_t slice_pitch,void *ptr)
 {
-  // Sync back from device if image is resident
+  // Sync rows back from device if image is resident
   if (image->is_resident(this)) {
     auto boh = image->get_buffer_object_or_error(this);
-    get_xrt_device()->sync(boh,image->get_size(),0,xrt::hal::device::direction::DEVICE2HOST,false);
+    auto span = image_span(image,origin,region);
+    get_xrt_device()->sync(boh,span.second,span.first,xrt::hal::device::direction::DEVICE2HOST,false);
   }
 
   // Now read from image into ptr
@@ -1235,6 +1626,10 @@ load_program(program* program)
   // isn't possible, we *must* iterator symbols explicitly
   clear_cus();
   m_cu_memidx = -2;
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_bank_usage.clear();
+  }
   auto cu2addr = get_xclbin_cus(this);
   for (auto symbol : m_xclbin.kernel_symbols()) {
     for (auto& inst : symbol->instances) {
@@ -1247,7 +1642,7 @@ load_program(program* program)
   profile::add_to_active_devices(get_unique_name());
 
   // In order to use virtual CUs (KDMA) we must open a virtual context
-  m_xdevice->acquire_cu_context(-1,true);
+  get_xrt_device()->acquire_cu_context(-1,true);
 
   init_scheduler(this);
 }
@@ -1258,7 +1653,7 @@ unload_program(const program* program)
 {
   if (m_active == program) {
     clear_cus();
-    m_xdevice->release_cu_context(-1); // release virtual CU context
+    get_xrt_device()->release_cu_context(-1); // release virtual CU context
     m_active = nullptr;
   }
 }
@@ -1305,7 +1700,7 @@ size_t
 device::
 get_num_cdmas() const
 {
-  return xrt::config::get_cdma() ? m_xdevice->get_cdma_count() : 0;
+  return xrt::config::get_cdma() ? get_xrt_device()->get_cdma_count() : 0;
 }
 
 xclbin
@@ -1330,10 +1725,11 @@ unsigned short
 device::
 get_max_clock_frequency() const
 {
-  if (!m_xdevice)
+  auto xdevice = get_xrt_device();
+  if (!xdevice)
     return 0;
 
-  auto freqs = m_xdevice->getClockFrequencies();
+  auto freqs = xdevice->getClockFrequencies();
   return *std::max_element(freqs.begin(),freqs.end());
 }
 
@@ -26,6 +26,8 @@
 #include "xrt/scheduler/command.h"
 
 #include <unistd.h>
+#include <mutex>
+#include <list>
 
 #include <cassert>
 
@@ -143,9 +145,13 @@ public:
     return m_parent.get() != nullptr;
   }
 
+  /**
+   * Get the xrt device, opening it if necessary
+   */
   xrt::device*
   get_xrt_device() const
   {
+    open_xrt_device();
     return  m_xdevice;
   }
 
@@ -158,7 +164,8 @@ public:
   std::string
   get_name() const
   {
-    return m_xdevice ? m_xdevice->getName() : "fpga0";
+    auto xdevice = get_xrt_device();
+    return xdevice ? xdevice->getName() : "fpga0";
   }
 
   std::string
@@ -176,7 +183,7 @@ public:
   unsigned int
   get_ddr_bank_count() const
   {
-    return m_xdevice->getBankCount();
+    return get_xrt_device()->getBankCount();
   }
 
   /**
@@ -188,7 +195,7 @@ public:
   size_t
   get_ddr_size() const
   {
-    return m_xdevice->getDdrSize();
+    return get_xrt_device()->getDdrSize();
   }
 
   /**
@@ -213,7 +220,7 @@ public:
   bool
   is_xare_device() const
   {
-    return m_xdevice->is_xare_device();
+    return get_xrt_device()->is_xare_device();
   }
 
 public:
@@ -223,7 +230,8 @@ public:
   size_t
   get_alignment() const
   {
-    return m_xdevice ? m_xdevice->getAlignment() : getpagesize();
+    auto xdevice = get_xrt_device();
+    return xdevice ? xdevice->getAlignment() : getpagesize();
   }
 
   /**
@@ -385,6 +393,56 @@ public:
   memidx_bitmask_type
   get_cu_memidx(kernel* kernel, int argidx) const;
 
+  /**
+   * Select memory bank for a buffer of @size bytes
+   *
+   * The buffer is placed in the DDR or HBM bank, among the banks used
+   * by the loaded xclbin and in @mask, with fewest bytes placed so far by
+   * this device.  Used to spread buffers that are not constrained by
+   * kernel connectivity across the banks of multi bank devices.
+   *
+   * @return
+   *   Memory index of selected bank, or -1 if there is no candidate bank
+   */
+  memidx_type
+  place_buffer(size_t size, const memidx_bitmask_type& mask);
+
+  /**
+   * Remove a buffer placed with place_buffer() from bank accounting
+   */
+  void
+  unplace_buffer(memidx_type memidx, size_t size);
+
+  /**
+   * Record use of a buffer that can be evicted from device memory
+   *
+   * With Runtime.device_oversubscription, buffers allocated on this
+   * device are kept in least recently used order.  When allocation
+   * of a buffer object fails, alloc() evicts buffers in that order
+   * until the allocation succeeds or no buffer can be evicted.
+   */
+  void
+  touch_evictable(memory* mem);
+
+  /**
+   * Remove a buffer from eviction order, e.g. when it is deleted
+   */
+  void
+  untrack_evictable(const memory* mem);
+
+  /**
+   * Evict least recently used buffer in bank @memidx to host memory
+   *
+   * @param exclude
+   *   Buffer that is being allocated and must not be evicted
+   * @param memidx
+   *   Bank to free memory in, -1 for any bank
+   * @return
+   *   true if a buffer was evicted, false otherwise
+   */
+  bool
+  evict_buffer(const memory* exclude, memidx_type memidx);
+
   /**
    * Map buffer (clEnqueueMapBuffer) implementation
    */
@@ -405,6 +463,37 @@ public:
   void
   migrate_buffer(memory* buffer,cl_mem_migration_flags flags);
 
+  /**
+   * Migrate kernel argument buffers to this device
+   *
+   * All buffers are synced asynchronously and then waited on, so the
+   * transfers of one kernel launch are in flight together rather
+   * than synced one after another.  After this call all buffers are
+   * resident on this device
+   */
+  void
+  migrate_buffers(const std::vector<memory*>& buffers);
+
+  /**
+   * Migrate a range of a buffer to this device
+   *
+   * Syncs [@offset,@offset+@size) from host to this device.  Used for
+   * one chunk of a migration planned by the caller, the caller marks
+   * the buffer resident once all chunks are migrated.
+   */
+  void
+  migrate_buffer_range(memory* buffer, size_t offset, size_t size);
+
+  /**
+   * Gather a range of a buffer computed by another device
+   *
+   * The range [@offset,@offset+@size) is synced from device @from to
+   * host, and from host to this device if the buffer is resident on
+   * this device.  Used to collect the results of a split NDRange.
+   */
+  void
+  gather_buffer(memory* buffer, device* from, size_t offset, size_t size);
+
   /**
    * Write data size bytes to buffer at specified offset
    *
@@ -478,6 +567,10 @@ public:
    *  The offset at which to start writing the pattern.
    * @param size
    *  The number of bytes to fill with pattern.
+   *
+   * A resident buffer on a device with KDMA is filled in device memory
+   * from a small seed of replicated pattern, otherwise the buffer is
+   * filled through its host mapping.
    */
   void
   fill_buffer(memory* buffer, const void* pattern, size_t pattern_size, size_t offset, size_t size);
@@ -489,11 +582,17 @@ public:
   read_image(memory* image,const size_t* origin,const size_t* region,size_t row_pitch,size_t slice_pitch,void *ptr);
 
   int
-  get_stream(xrt::device::stream_flags flags, xrt::device::stream_attrs attrs, const cl_mem_ext_ptr_t* ext, xrt::device::stream_handle* stream, int32_t& m_conn);
+  get_stream(xrt::device::stream_flags flags, xrt::device::stream_attrs attrs, const cl_mem_ext_ptr_t* ext, std::vector<xrt::device::stream_handle>& streams, int32_t& m_conn);
 
   int
   close_stream(xrt::device::stream_handle stream, int connidx);
 
+  /**
+   * Close a queue of a sharded stream, the stream keeps its connection
+   */
+  int
+  close_stream(xrt::device::stream_handle stream);
+
   ssize_t
   write_stream(xrt::device::stream_handle stream, const void* ptr, size_t size, xrt::device::stream_xfer_req* req);
 
@@ -509,6 +608,12 @@ public:
   int
   poll_streams(xrt::device::stream_xfer_completions* comps, int min, int max, int* actual, int timeout);
 
+  int
+  register_stream_buf(xrt::device::stream_handle stream, xrt::device::stream_buf buf, size_t frame_size);
+
+  int
+  poll_stream(xrt::device::stream_handle stream, xrt::device::stream_xfer_completions* comps, int min, int max, int* actual, int timeout);
+
   /**
    * Read a device register at specified offset
    *
@@ -725,6 +830,19 @@ private:
   void
   clear_cus();
 
+  /**
+   * Open the xrt devices of this device if not already open
+   *
+   * Platform devices are constructed without opening the underlying
+   * xrt devices.  They are opened, and their DMA threads started, on
+   * first use so that a process pays only for the devices it uses.
+   */
+  void
+  open_xrt_device() const;
+
+  void
+  open_xrt_device_once();
+
   /**
    * Set xrt device when the final device is determined
    *
@@ -789,6 +907,10 @@ private:
   xrt::device* m_swem_device = nullptr;
   xrt::device* m_hwem_device = nullptr;
 
+  // Platform devices defer opening of the xrt devices to first use
+  bool m_lazy_open = false;
+  mutable std::once_flag m_open_flag;
+
   // Set for sub-device only
   ptr<device> m_parent = nullptr;
 
@@ -808,6 +930,16 @@ private:
 
   // Caching.  Purely implementation detail (-2 => not initialized)
   mutable memidx_type m_cu_memidx = -2;
+
+  // Bytes per memory bank placed by place_buffer() for the loaded xclbin
+  std::vector<size_t> m_bank_usage;
+
+  // Evictable buffers, least recently used first, and position of
+  // each buffer in the list.  Separate mutex, eviction syncs buffer
+  // content while holding it.
+  std::mutex m_evict_mutex;
+  std::list<memory*> m_evict_lru;
+  std::map<const memory*,std::list<memory*>::iterator> m_evict_pos;
 };
 
 } // xocl
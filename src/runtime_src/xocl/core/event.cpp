@@ -17,17 +17,36 @@
 #include "event.h"
 #include "command_queue.h"
 #include "context.h"
+#include "callback.h"
 
 #include "xrt/config.h"
 #include "xrt/util/task.h"
 
 #include "xocl/api/plugin/xdp/profile.h"
+#include "core/common/probe.h"
 
 #include <iostream>
 #include <cassert>
+#include <climits>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 namespace {
 
+static void
+futex_wait(std::atomic<int>* word, int value)
+{
+  syscall(SYS_futex,reinterpret_cast<int*>(word),FUTEX_WAIT_PRIVATE,value,nullptr,nullptr,0);
+}
+
+static void
+futex_wake(std::atomic<int>* word)
+{
+  syscall(SYS_futex,reinterpret_cast<int*>(word),FUTEX_WAKE_PRIVATE,INT_MAX,nullptr,nullptr,0);
+}
+
 XOCL_UNUSED
 static std::string
 to_string(cl_int status)
@@ -59,6 +78,7 @@ event(command_queue* cq, context* ctx, cl_command_type cmd)
 {
   static unsigned int uid_count = 0;
   m_uid = uid_count++;
+  XRT_PROBE2(event_create,m_uid,cmd);
   debug::add_command_type(this,cmd);
 
   for (auto& cb : sg_constructor_callbacks)
@@ -93,8 +113,8 @@ set_status(cl_int s)
 {
   // Retain so that event is guaranteed to remain alive for the
   // duration of this function.  We could reorder to run callbacks
-  // first, but its vital to signal condition variables first to keep
-  // things rolling.  Only necessary to retain if CL_COMPLETE.
+  // first, but its vital to wake waiters first to keep things
+  // rolling.  Only necessary to retain if CL_COMPLETE.
   // - ex1) user thread waits for CL_COMPLETE triggered by this
   //   call at which point it squeezes in clReleaseEvent before this
   //   function runs the callbacks.
@@ -116,6 +136,10 @@ set_status(cl_int s)
 
     std::swap(m_status,s);
     time_set(m_status);
+
+    // Error status terminates the event, there are no callbacks
+    if (m_status<0)
+      notify_done_nolock();
   } // lk
 
   //Make the profile logging calls before notifying the event
@@ -124,24 +148,45 @@ set_status(cl_int s)
   profile::log(this,m_status);
 
   if (complete) {
-    // Run callbacks before notifying the event and before removing it from queue
-    // If events are notified or removed from queue before running callbacks then
-    // the user thread calling clWaitForEvents() or clFinish() will unblock and
-    // proceed (or exit main() as in CR-1002026) with the assumption that callback finished.
-    run_callbacks(CL_COMPLETE);
-
-    m_event_complete.notify_all();
-
-    // remove the completed event from queue (submitted queue)
-    // before event_scheduler attempts to submit next event.
-    queue_remove();   // 1 (order matters)
-    for (auto& c : m_chain) // not a race, since m_chain is blocked by CL_COMPLETE
-      c->submit();
+    // An event with user callbacks is completed by the callback
+    // executor, the thread completing the event (often the command
+    // notifier) must not be blocked by user code.
+    bool callbacks = false;
+    {
+      std::lock_guard<std::mutex> lk(m_mutex);
+      callbacks = (m_callbacks != nullptr);
+    }
+    if (callbacks && async_user_callbacks())
+      run_user_callback([retain] { retain->finish(); });
+    else
+      finish();
   }
 
   return s;
 }
 
+void
+event::
+finish()
+{
+  // Run callbacks before notifying the event and before removing it from queue
+  // If events are notified or removed from queue before running callbacks then
+  // the user thread calling clWaitForEvents() or clFinish() will unblock and
+  // proceed (or exit main() as in CR-1002026) with the assumption that callback finished.
+  run_callbacks(CL_COMPLETE);
+
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    notify_done_nolock();
+  }
+
+  // remove the completed event from queue (submitted queue)
+  // before event_scheduler attempts to submit next event.
+  queue_remove();   // 1 (order matters)
+  for (auto& c : m_chain) // not a race, since m_chain is blocked by CL_COMPLETE
+    c->submit();
+}
+
 bool
 event::
 queue(bool blocking_submit)
@@ -227,7 +272,7 @@ abort(cl_int status,bool fatal)
     if (abort_ev==this && (fatal || abort_ev->m_status==CL_QUEUED)) {
       abort_ev->m_status = status;  // abort ev
       abort_ev->queue_abort(fatal); // remove from queue if any
-      m_event_complete.notify_all();
+      notify_done_nolock();
     }
     else if (abort_ev!=this) {
       // recursively abort event that depends on this
@@ -243,14 +288,47 @@ abort(cl_int status,bool fatal)
   return true;
 }
 
+void
+event::
+notify_done_nolock()
+{
+  m_done.store(1,std::memory_order_release);
+  futex_wake(&m_done);
+
+  // A multi event waiter wakes when its last pending event is done
+  for (auto pending : m_waiters)
+    if (pending->fetch_sub(1,std::memory_order_acq_rel)==1)
+      futex_wake(pending);
+  m_waiters.clear();
+}
+
 void
 event::
 wait() const
 {
   XOCL_DEBUG(std::cout,"xocl::event::wait(",m_uid,")\n");
-  std::unique_lock<std::mutex> lk(m_mutex);
-  while (m_status>0)  // (<0 => aborted) (==0 => CL_COMPLETE)
-    m_event_complete.wait(lk);
+  while (!m_done.load(std::memory_order_acquire))
+    futex_wait(&m_done,0);
+}
+
+void
+event::
+wait(const std::vector<const event*>& events)
+{
+  // Register the pending count with each event that is not done,
+  // the count is decremented by the events as they complete
+  std::atomic<int> pending {0};
+  for (auto ev : events) {
+    std::lock_guard<std::mutex> lk(ev->m_mutex);
+    if (ev->m_done.load(std::memory_order_acquire))
+      continue;
+    pending.fetch_add(1,std::memory_order_relaxed);
+    ev->m_waiters.push_back(&pending);
+  }
+
+  int value;
+  while ((value=pending.load(std::memory_order_acquire)) > 0)
+    futex_wait(&pending,value);
 }
 
 void
@@ -26,7 +26,10 @@
 #include "xocl/core/execution_context.h"
 
 #include "xrt/config.h"
+#include "xrt/util/pool.h"
+#include "xrt/util/small_function.h"
 
+#include <atomic>
 #include <vector>
 #include <functional>
 #include <iostream>
@@ -56,7 +59,9 @@ public:
   using event_callback_type = std::function<void(event*)>;
   using event_callback_list = std::vector<event_callback_type>;
 
-  using action_enqueue_type = std::function<void (event*)>;
+  // Move only, the enqueue action lambdas fit inline so setting
+  // the action does not allocate
+  using action_enqueue_type = xrt::small_function<void (event*)>;
   using action_profile_type = std::function<void (event*, cl_int, const std::string&)>;
   using action_debug_type = std::function<void (event*)>;
 
@@ -64,6 +69,25 @@ public:
   event(command_queue* cq, context* ctx, cl_command_type cmd, cl_uint num_deps, const cl_event* deps);
   virtual ~event();
 
+  /**
+   * Events and derived events are allocated from xrt::pool
+   *
+   * An event is constructed for every enqueued command, the pool
+   * recycles event memory per thread without going through malloc.
+   * The virtual dtor ensures sz is the size of most derived type.
+   */
+  static void*
+  operator new(size_t sz)
+  {
+    return xrt::pool::allocate(sz);
+  }
+
+  static void
+  operator delete(void* ptr, size_t sz)
+  {
+    xrt::pool::deallocate(ptr,sz);
+  }
+
   /**
    */
   unsigned int
@@ -300,6 +324,15 @@ public:
   void
   wait() const;
 
+  /**
+   * Wait for all argument events to complete
+   *
+   * The calling thread blocks once on a count of pending events,
+   * which is decremented as each event completes.
+   */
+  static void
+  wait(const std::vector<const event*>& events);
+
   /**
    * If a profiling event, then support return requested values
    *
@@ -402,6 +435,21 @@ protected:
   chain(event* ev);
 
 private:
+  /**
+   * Run callbacks, wake waiters, and submit chained events of a
+   * CL_COMPLETE event
+   */
+  void
+  finish();
+
+  /**
+   * Mark this event done and wake all waiters
+   *
+   * Pre-condition: m_mutex is locked
+   */
+  void
+  notify_done_nolock();
+
   /**
    * Submit this event for execution if possible
    *
@@ -509,9 +557,17 @@ private:
   cl_int m_status = -1;
   cl_command_type m_command_type = 0;
   mutable std::mutex m_mutex;
-  mutable std::condition_variable m_event_complete;
   mutable std::condition_variable m_event_submitted;
 
+  // Futex word, 1 when the event is complete or aborted.  Waiters
+  // block on this word rather than on m_mutex and a condition
+  // variable.
+  mutable std::atomic<int> m_done {0};
+
+  // Pending counts of multi event waiters blocked on this event,
+  // see wait(const std::vector<const event*>&)
+  mutable std::vector<std::atomic<int>*> m_waiters;
+
   // List of callback functions. On heap to avoid
   // allocation unless needed.
   std::unique_ptr<callback_list> m_callbacks;
@@ -522,6 +578,12 @@ private:
   // Number of events this event is waiting on.  This includes
   // explicit event depedencies and events that chain this
   unsigned int m_wait_count = 0;
+
+  // Links in command queue list of queued and submitted events,
+  // owned and locked by the command queue
+  event* m_queue_prev = nullptr;
+  event* m_queue_next = nullptr;
+  bool m_queue_linked = false;
 };
 
 /**
@@ -17,11 +17,14 @@
 #include "execution_context.h"
 #include "device.h"
 #include "event.h"
+#include "command_queue.h"
 
 #include "xrt/scheduler/command.h"
 #include "xrt/scheduler/scheduler.h"
 
 #include "core/common/xclbin_parser.h"
+#include "core/common/probe.h"
+#include "core/common/config_reader.h"
 
 #include <iostream>
 #include <fstream>
@@ -180,8 +183,63 @@ struct execution_context::start_kernel_conformance : start_kernel
   }
 };
 
+inline void
+set_word(execution_context::regmap_type& regmap, size_t idx, uint32_t value)
+{
+  regmap[idx] = value;
+}
+
+inline void
+set_word(std::vector<execution_context::word_type>& regmap, size_t idx, uint32_t value)
+{
+  if (regmap.size() <= idx)
+    regmap.resize(idx+1,0);
+  regmap[idx] = value;
+}
+
+// Regmap encoded as ERT_EXEC_WRITE {offset,value} pairs, a regmap
+// word is written to the packet word holding its value
+struct exec_write_regmap
+{
+  execution_context::regmap_type& packet;
+  const std::vector<size_t>& slots;
+};
+
+inline void
+set_word(exec_write_regmap& regmap, size_t idx, uint32_t value)
+{
+  regmap.packet[regmap.slots[idx]] = value;
+}
+
+static void
+mark_regmap(std::vector<bool>& used, const xocl::kernel::argument::arginfo_range_type& arginforange)
+{
+  for (auto arginfo : arginforange) {
+    for (size_t wi=0, we=arginfo->size/sizeof(uint32_t); wi!=we; ++wi) {
+      size_t register_offset = (arginfo->offset + wi*sizeof(uint32_t)) / sizeof(uint32_t);
+      if (used.size() <= register_offset)
+        used.resize(register_offset+1,false);
+      used[register_offset] = true;
+    }
+  }
+}
+
+// ERT_EXEC_WRITE is scheduled by kds and ERT, but not by the
+// software scheduler nor by the embedded platform scheduler
+static bool
+exec_write_supported()
+{
+#if defined(__arm__) || defined(__aarch64__)
+  return false;
+#else
+  static bool value = xrt::config::get_exec_write() && xrt::scheduler::is_kds();
+  return value;
+#endif
+}
+
+template <typename RegmapType>
 static int
-fill_regmap(execution_context::regmap_type& regmap, size_t offset,
+fill_regmap(RegmapType& regmap, size_t offset,
             const void* data, const size_t size,
             const xocl::kernel::argument::arginfo_range_type& arginforange)
 {
@@ -202,7 +260,7 @@ fill_regmap(execution_context::regmap_type& regmap, size_t offset,
       size_t device_offset = arginfo->offset + wi*sizeof(uint32_t);
       uint32_t device_value = *word;
       size_t register_offset = device_offset / sizeof(uint32_t);
-      regmap[offset+register_offset] = device_value;
+      set_word(regmap,offset+register_offset,device_value);
       //      std::cout << "regmap[" << register_offset << "]=" << device_value << "\n";
       ++word;
     }
@@ -237,21 +295,51 @@ execution_context(device* device
   for (auto& arg : m_kernel->get_argument_range())
     m_kernel_args.push_back(arg->clone());
 
+  // The argument migration pinned the buffer arguments, this context
+  // releases the pins
+  if (xrt_core::config::get_device_oversubscription()) {
+    for (auto& arg : m_kernel_args) {
+      if (arg->is_progvar() && arg->get_address_qualifier()==CL_KERNEL_ARG_ADDRESS_GLOBAL)
+        continue;
+      if (auto mem = arg->get_memory_object())
+        m_pinned.push_back(mem);
+    }
+  }
+
   // Compute units to use
-  add_compute_units(device);
+  try {
+    add_compute_units(device);
+  }
+  catch (...) {
+    unpin_buffers();
+    throw;
+  }
 
   m_dataflow = xrt_core::xclbin::get_dataflow(device->get_axlf());
   XOCL_DEBUGF("execution_context(%d) has dataflow(%d)\n",m_uid,m_dataflow);
 }
 
+execution_context::
+~execution_context()
+{
+  unpin_buffers();
+}
+
+void
+execution_context::
+unpin_buffers()
+{
+  for (auto mem : m_pinned)
+    mem->unpin();
+  m_pinned.clear();
+}
+
 void
 execution_context::
 add_compute_units(device* device)
 {
-  // Collect kernel's filtered CUs
-  std::bitset<128> kernel_cus;
-  for (auto cu : m_kernel->get_cus())
-    kernel_cus.set(cu->get_index());
+  // Kernel's filtered CUs on targeted device
+  auto kernel_cus = m_kernel->get_cu_mask(device);
 
   // Targeted device CUs matching kernel CUs
   for (auto& scu : device->get_cus()) {
@@ -264,6 +352,7 @@ add_compute_units(device* device)
 
       XOCL_DEBUGF("execution_context(%d) added cu(%d)\n",m_uid,cu->get_uid());
       m_cus.push_back(cu);
+      m_cu_mask.set(cu->get_index());
     }
   }
 
@@ -307,35 +396,30 @@ write(const command_type& cmd)
       ostr << "0x" << std::uppercase << std::setfill('0') << std::setw(8) << std::hex << packet[i] << std::dec << "\n";
   }
 
-  xrt::scheduler::schedule(cmd);
   return true;
 }
 
-void
+execution_context::word_type
 execution_context::
-encode_compute_units(packet_type& packet)
+encode_compute_units(std::vector<word_type>& words)
 {
-  // Encode CUs in a bitmask with bits in position according to the
+  // CUs are in a bitmask with bits in position according to the
   // CU physical address.   The CU address is at 4k boundaries starting
   // at 0x0, so shift >> 12 to get CU index, the shift << idx
+  const xocl::kernel::cu_bitmask_type word_mask(0xffffffff);
   word_type cu_bitmask[4] = {0};
   size_t no_of_masks = 0;
-  for (auto cu : m_cus) {
-    auto cu_idx = cu->get_index();
-    auto mask_idx = cu_idx/32;
-    auto cu_mask_idx = cu_idx - mask_idx*32;
-    cu_bitmask[mask_idx] |= 1 << cu_mask_idx;
-    no_of_masks = std::max(no_of_masks,mask_idx+1);
+  for (size_t i=0; i<4; ++i) {
+    cu_bitmask[i] = ((m_cu_mask >> (i*32)) & word_mask).to_ulong();
+    if (cu_bitmask[i])
+      no_of_masks = i+1;
   }
   assert(no_of_masks >= 1);
 
-  size_t offset = 1; // past header
   for (size_t i=0; i<no_of_masks; ++i)
-    packet[offset++] = cu_bitmask[i];
+    words.push_back(cu_bitmask[i]);
 
-  // write extra cu mask count to header [11:10]
-  auto epacket = reinterpret_cast<ert_start_kernel_cmd*>(packet.data());
-  epacket->extra_cu_masks = no_of_masks-1;
+  return no_of_masks-1;
 }
 
 const compute_unit*
@@ -348,12 +432,34 @@ get_compute_unit(unsigned int cu_idx) const
   return nullptr;
 }
 
+void
+execution_context::
+set_workgroup_range(size begin, size end)
+{
+  assert(m_dim && begin<end);
+  auto dim = m_dim-1;
+  m_group_begin = begin;
+  m_group_end = end;
+  m_cu_group_id[dim] = begin;
+  m_cu_global_id[dim] += begin*m_lsize[dim];
+}
+
 void
 execution_context::
 update_work()
 {
   for (unsigned int dim=0; dim<m_dim; ++dim) {
 
+    // Outermost dimension of part of a split NDRange
+    if (m_group_end && dim==m_dim-1) {
+      if (m_cu_group_id[dim]+1 < m_group_end) {
+        m_cu_global_id[dim] += m_lsize[dim];
+        ++m_cu_group_id[dim];
+        return;
+      }
+      break;
+    }
+
     if (m_cu_global_id[dim]+m_lsize[dim] < m_gsize[dim]) {
       m_cu_global_id[dim] += m_lsize[dim];
       ++m_cu_group_id[dim];
@@ -368,55 +474,43 @@ update_work()
   m_done = true;
 }
 
-void
+std::vector<execution_context::word_type>
 execution_context::
-start()
+encode_kernel_arguments()
 {
-  XOCL_DEBUGF("execution_context(%d) starting workgroup(%d,%d,%d)\n"
-              ,get_uid(),m_cu_group_id[0],m_cu_group_id[1],m_cu_group_id[2]);
-
-  // On first work load, transition event to CL_RUNNING
-  if ( (m_cu_group_id[0]==0) && (m_cu_group_id[1]==0) && (m_cu_group_id[2]==0))
-    m_event->set_status(CL_RUNNING);
-
   auto xdevice = m_device->get_xrt_device();
 
-  // Construct command packet and send to hardware
-  auto cmd = conformance::on()
-    ? std::make_shared<start_kernel_conformance>(xdevice,this)
-    : std::make_shared<start_kernel>(xdevice,this);
-  ++m_active;
-  auto& packet = cmd->get_packet();
-
-  // Encode CUs in cu bitmasks with bits in position according to the
-  // CUs that can be used
-  encode_compute_units(packet);
+  // Reuse regmap template from prior launch on same device
+  auto tmpl = m_kernel->get_regmap_template();
+  // Evicted buffers may come back at another device address
+  bool reuse = tmpl.dev==m_device && tmpl.versions.size()==m_kernel_args.size()
+    && !xrt_core::config::get_device_oversubscription();
+  if (!reuse) {
+    tmpl.dev = m_device;
+    tmpl.regmap.clear();
+    tmpl.versions.assign(m_kernel_args.size(),0);
+  }
 
-  // Create the cu register map
-  auto offset = packet.size();  // start of regmap
-  auto& regmap = packet;
+  auto& regmap = tmpl.regmap;
+  size_t offset = 0;
 
   // Ensure that S_AXI_CONTROL is created even when kernel
   // has no arguments.
-  packet[offset]   = 0;  // control signals
-  packet[offset+1] = 0;  // gier
-  packet[offset+2] = 0;  // ier
-  packet[offset+3] = 0;  // isr
-
-  size3 num_workgroups {0,0,0};
-  for (auto d : {0,1,2}) {
-    if (m_lsize[d]) // actually always true
-      num_workgroups[d] = m_gsize[d]/m_lsize[d];
-  }
+  if (regmap.size() < 4)
+    regmap.resize(4,0); // control signals, gier, ier, isr
 
-  // Push kernel args
-  xocl::memory* printf_buffer = nullptr;
+  // Push kernel args that have changed since template was encoded
+  size_t argidx = 0;
   for (auto& arg : m_kernel_args) {
-    if (arg->is_printf()) {
-      printf_buffer = arg->get_memory_object();
-      assert(printf_buffer);
+    auto version = arg->get_version();
+    if (reuse && tmpl.versions[argidx]==version) {
+      ++argidx;
       continue;
     }
+    tmpl.versions[argidx++] = version;
+
+    if (arg->is_printf())
+      continue;
 
     auto address_space = arg->get_address_space();
     if (address_space == kernel::argument::addr_space_type::SPIR_ADDRSPACE_PRIVATE)
@@ -442,41 +536,77 @@ start()
     }
   }
 
-  for (auto& arg : m_kernel->get_progvar_argument_range()) {
-    uint64_t physaddr = 0;
-    if (auto mem = arg->get_memory_object()) {
-      auto boh = xocl::xocl(mem)->get_buffer_object_or_error(m_device);
-      physaddr = xdevice->getDeviceAddr(boh);
+  // Progvars are static per kernel
+  if (!reuse) {
+    for (auto& arg : m_kernel->get_progvar_argument_range()) {
+      uint64_t physaddr = 0;
+      if (auto mem = arg->get_memory_object()) {
+        auto boh = xocl::xocl(mem)->get_buffer_object_or_error(m_device);
+        physaddr = xdevice->getDeviceAddr(boh);
+      }
+      assert(arg->get_arginfo_range().size()==1);
+      fill_regmap(regmap,offset,&physaddr,arg->get_size(),arg->get_arginfo_range());
+    }
+  }
+
+  auto words = regmap;
+  m_kernel->set_regmap_template(std::move(tmpl));
+  return words;
+}
+
+std::vector<bool>
+execution_context::
+get_used_registers() const
+{
+  std::vector<bool> used(4,true); // control signals, gier, ier, isr
+  for (auto& arg : m_kernel_args) {
+    if (arg->is_printf())
+      continue;
+    if (arg->get_address_space() == kernel::argument::addr_space_type::SPIR_ADDRSPACE_PIPES)
+      continue;
+    mark_regmap(used,arg->get_arginfo_range());
+  }
+  for (auto& arg : m_kernel->get_progvar_argument_range())
+    mark_regmap(used,arg->get_arginfo_range());
+  for (auto& arg : m_kernel->get_rtinfo_argument_range())
+    mark_regmap(used,arg->get_arginfo_range());
+  return used;
+}
+
+void
+execution_context::
+init_packet_template()
+{
+  std::vector<word_type> words;
+
+  // Encode CUs in cu bitmasks with bits in position according to the
+  // CUs that can be used
+  m_extra_cu_masks = encode_compute_units(words);
+
+  // Create the cu register map
+  m_regmap_offset = words.size() + 1;  // start of regmap, past header
+  auto regmap = encode_kernel_arguments();
+
+  size3 num_workgroups {0,0,0};
+  for (auto d : {0,1,2}) {
+    if (m_lsize[d]) // actually always true
+      num_workgroups[d] = m_gsize[d]/m_lsize[d];
+  }
+
+  for (auto& arg : m_kernel_args) {
+    if (arg->is_printf()) {
+      m_printf_buffer = arg->get_memory_object();
+      assert(m_printf_buffer);
+      auto boh = m_printf_buffer->get_buffer_object_or_error(m_device);
+      m_printf_buffer_addr = static_cast<uint64_t>(m_device->get_xrt_device()->getDeviceAddr(boh));
     }
-    assert(arg->get_arginfo_range().size()==1);
-    fill_regmap(regmap,offset,&physaddr,arg->get_size(),arg->get_arginfo_range());
   }
 
-  // Set runtime arguments as required
+  // Push runtime args, those that depend on current workgroup are
+  // recorded for encoding per command
+  size_t offset = 0;
   size3 local_id {0,0,0};
-  uint64_t printf_buffer_addr = 0;
-  if ( printf_buffer ) {
-    // This computes the offset that gets added to a physical printf buffer
-    // address for a given workgroup. Necessary so we have a different
-    // segment to hold each workgroup in the overall buffer.
-    size_t lwsx = m_lsize[0];
-    size_t lwsy = m_lsize[1];
-    size_t lwsz = m_lsize[2];
-    size_t gwsx = m_gsize[0];
-    size_t gwsy = m_gsize[1];
-    size_t local_buffer_size = lwsx * lwsy * lwsz * 2048 /*XCL::Printf::getWorkItemPrintfBufferSize()*/;
-    size_t group_x_size = gwsx / lwsx;
-    size_t group_y_size = gwsy / lwsy;
-    size_t group_id = m_cu_group_id[0] +
-                      group_x_size * m_cu_group_id[1] +
-                      group_y_size * group_x_size * m_cu_group_id[2];
-    auto printf_buffer_offset = group_id * local_buffer_size;
-    auto boh = printf_buffer->get_buffer_object_or_error(m_device);
-    auto printf_buffer_base_addr = static_cast<uint64_t>(xdevice->getDeviceAddr(boh));
-    printf_buffer_addr = printf_buffer_base_addr + printf_buffer_offset;
-  }
-
-  // Push runtime args
+  m_rtinfo_patch.clear();
   for (auto& arg : m_kernel->get_rtinfo_argument_range()) {
     auto nm = arg->get_name();
     XOCL_DEBUGF("execution_context(%d) sets rtinfo(%s)\n",get_uid(),nm.c_str());
@@ -491,17 +621,152 @@ start()
     else if (nm=="num_groups")
       fill_regmap(regmap,offset,num_workgroups.data(),3*sizeof(size_t),arg->get_arginfo_range());
     else if (nm=="global_id")
-      fill_regmap(regmap,offset,m_cu_global_id.data(),3*sizeof(size_t),arg->get_arginfo_range());
+      m_rtinfo_patch.emplace_back(rtinfo_type::global_id,arg.get());
     else if (nm=="local_id")
       fill_regmap(regmap,offset,local_id.data(),3*sizeof(size_t),arg->get_arginfo_range());
     else if (nm=="group_id")
-      fill_regmap(regmap,offset,m_cu_group_id.data(),3*sizeof(size_t),arg->get_arginfo_range());
+      m_rtinfo_patch.emplace_back(rtinfo_type::group_id,arg.get());
     else if (nm=="printf_buffer")
-      fill_regmap(regmap,offset,&printf_buffer_addr,sizeof(printf_buffer_addr),arg->get_arginfo_range());
+      m_rtinfo_patch.emplace_back(rtinfo_type::printf_buffer,arg.get());
+  }
+
+  // Reserve regmap words for per workgroup runtime args
+  uint64_t zero[3] = {0,0,0};
+  for (auto& patch : m_rtinfo_patch)
+    fill_regmap(regmap,offset,zero,sizeof(zero),patch.second->get_arginfo_range());
+
+  // Encode the regmap as {offset,value} pairs of the registers that
+  // are written by arguments if that is smaller than the full regmap,
+  // which is the case for sparse regmaps with arguments at high offsets
+  m_exec_write = false;
+  m_exec_write_slots.clear();
+  if (exec_write_supported()) {
+    auto used = get_used_registers();
+    used.resize(regmap.size(),false);
+    size_t pairs = std::count(used.begin()+4,used.end(),true);
+    if (4 + 2*pairs < regmap.size()) {
+      XOCL_DEBUGF("execution_context(%d) uses exec_write with %d pairs\n",get_uid(),static_cast<int>(pairs));
+      m_exec_write = true;
+      m_exec_write_slots.resize(regmap.size(),0);
+      for (size_t idx=0; idx<regmap.size(); ++idx) {
+        if (idx >= 4 && !used[idx])
+          continue;
+        if (idx >= 4)
+          words.push_back(idx*sizeof(word_type));
+        m_exec_write_slots[idx] = words.size() + 1; // past header
+        words.push_back(regmap[idx]);
+      }
+      m_packet_template = std::move(words);
+      return;
+    }
+  }
+
+  words.insert(words.end(),regmap.begin(),regmap.end());
+  m_packet_template = std::move(words);
+}
+
+void
+execution_context::
+prepare()
+{
+  if (m_packet_template.empty())
+    init_packet_template();
+}
+
+execution_context::command_type
+execution_context::
+start()
+{
+  XRT_PROBE_SCOPE(ec_start);
+  XOCL_DEBUGF("execution_context(%d) starting workgroup(%d,%d,%d)\n"
+              ,get_uid(),m_cu_group_id[0],m_cu_group_id[1],m_cu_group_id[2]);
+
+  // On first work load, transition event to CL_RUNNING
+  size3 first_group {{0,0,0}};
+  if (m_group_end)
+    first_group[m_dim-1] = m_group_begin;
+  if (m_cu_group_id==first_group)
+    m_event->set_status(CL_RUNNING);
+
+  auto xdevice = m_device->get_xrt_device();
+
+  // Construct command packet and send to hardware.  The command and
+  // its shared_ptr control block are allocated together from pool
+  auto cmd = conformance::on()
+    ? std::allocate_shared<start_kernel_conformance>(xrt::pool::allocator<start_kernel_conformance>(),xdevice,this)
+    : std::allocate_shared<start_kernel>(xrt::pool::allocator<start_kernel>(),xdevice,this);
+  ++m_active;
+  auto& packet = cmd->get_packet();
+
+  prepare();
+
+  // Copy precompiled cu masks and regmap past header
+  std::copy(m_packet_template.begin(),m_packet_template.end(),packet.data()+1);
+  packet.resize(m_packet_template.size()+1);
+
+  // write extra cu mask count to header [11:10]
+  auto epacket = reinterpret_cast<ert_start_kernel_cmd*>(packet.data());
+  epacket->extra_cu_masks = m_extra_cu_masks;
+
+  // high priority queue commands are started ahead of others [6]
+  auto queue = m_event->get_command_queue();
+  epacket->priority = queue && queue->is_high_priority();
+  if (m_exec_write)
+    epacket->opcode = ERT_EXEC_WRITE;
+
+  // Encode runtime args that depend on current workgroup
+  if (m_exec_write) {
+    exec_write_regmap regmap {packet,m_exec_write_slots};
+    patch_rtinfo(regmap,0);
+  }
+  else {
+    patch_rtinfo(packet,m_regmap_offset);
   }
 
-  // send command to mbs
   write(cmd);
+  return cmd;
+}
+
+template <typename RegmapType>
+void
+execution_context::
+patch_rtinfo(RegmapType& regmap, size_t offset)
+{
+  for (auto& patch : m_rtinfo_patch) {
+    auto arg = patch.second;
+    switch (patch.first) {
+    case rtinfo_type::global_id:
+      fill_regmap(regmap,offset,m_cu_global_id.data(),3*sizeof(size_t),arg->get_arginfo_range());
+      break;
+    case rtinfo_type::group_id:
+      fill_regmap(regmap,offset,m_cu_group_id.data(),3*sizeof(size_t),arg->get_arginfo_range());
+      break;
+    case rtinfo_type::printf_buffer:
+    {
+      uint64_t printf_buffer_addr = 0;
+      if (m_printf_buffer) {
+        // This computes the offset that gets added to a physical printf buffer
+        // address for a given workgroup. Necessary so we have a different
+        // segment to hold each workgroup in the overall buffer.
+        size_t lwsx = m_lsize[0];
+        size_t lwsy = m_lsize[1];
+        size_t lwsz = m_lsize[2];
+        size_t gwsx = m_gsize[0];
+        size_t gwsy = m_gsize[1];
+        size_t local_buffer_size = lwsx * lwsy * lwsz * 2048 /*XCL::Printf::getWorkItemPrintfBufferSize()*/;
+        size_t group_x_size = gwsx / lwsx;
+        size_t group_y_size = gwsy / lwsy;
+        size_t group_id = m_cu_group_id[0] +
+                          group_x_size * m_cu_group_id[1] +
+                          group_y_size * group_x_size * m_cu_group_id[2];
+        auto printf_buffer_offset = group_id * local_buffer_size;
+        printf_buffer_addr = m_printf_buffer_addr + printf_buffer_offset;
+      }
+      fill_regmap(regmap,offset,&printf_buffer_addr,sizeof(printf_buffer_addr),arg->get_arginfo_range());
+      break;
+    }
+    }
+  }
 }
 
 bool
@@ -520,6 +785,7 @@ done(const xrt::command*)
   // Only one thread will be able to set local ctx_done to true, so it's
   // safe to proceed without exclusive lock (mutex is a data member)
   if (ctx_done) {
+    unpin_buffers();
     m_event->set_status(CL_COMPLETE);
     return true;
   }
@@ -553,12 +819,16 @@ execute()
   // In order to keep scheduler busy, we need more than just one
   // workgroup at a time, so here we try to ensure that the scheduled
   // commands at any given time is twice the number of available CUs.
+  //
+  // All commands ready here are sent to mbs in one batch.
   auto limit = m_dataflow ? 20*m_cus.size() : 2*m_cus.size();
+  std::vector<command_type> cmds;
   for (size_t i=m_active; !m_done && i<limit; ++i) {
-    start();
+    cmds.push_back(start());
     update_work();
     XOCL_DEBUG(std::cout,"active=",m_active,"\n");
   }
+  xrt::scheduler::schedule(cmds);
 
   return m_done;
 }
@@ -588,6 +858,7 @@ conformance_done(const xrt::command*)
   // Only one thread will be able to set local ctx_done to true, so it's
   // safe to proceed without exclusive lock
   if (ctx_done) {
+    unpin_buffers();
     m_event->set_status(CL_COMPLETE);
     conformance::try_pending(); // if no active, then try execute all pending
   }
@@ -614,6 +885,8 @@ conformance_execute()
 
     // Remove current CUs if any
     m_cus.clear();
+    m_cu_mask.reset();
+    m_packet_template.clear();
 
     // reload new program and add new CUs
     m_device->load_program(m_kernel->get_program());
@@ -623,10 +896,12 @@ conformance_execute()
   // Run
   conformance::active(this);
   // Schedule all workgroups
+  std::vector<command_type> cmds;
   for (size_t i=0; !m_done; ++i) {
-    start();
+    cmds.push_back(start());
     update_work();
   }
+  xrt::scheduler::schedule(cmds);
 
   return true;
 }
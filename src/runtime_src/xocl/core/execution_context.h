@@ -22,7 +22,10 @@
 #include "xocl/core/compute_unit.h"
 
 #include "xrt/scheduler/command.h"
+#include "xrt/util/pool.h"
 #include <mutex>
+#include <vector>
+#include <utility>
 #include <array>
 #include <algorithm>
 #include <iostream>
@@ -77,6 +80,12 @@ private:
   size3 m_cu_global_id {{0,0,0}};
   size3 m_cu_group_id  {{0,0,0}};
 
+  // Workgroups [begin,end) of outermost dimension executed by this
+  // context when the NDRange is split across devices, end is 0 if
+  // all workgroups are executed
+  size m_group_begin = 0;
+  size m_group_end = 0;
+
   // The event that represents the kernel execution.  This is the
   // event created by clEnqueueNDRangeKernel and it is the event that
   // has an owning pointer to this execution_context object.
@@ -100,6 +109,9 @@ private:
   // that starts the mbs.
   std::vector<const compute_unit*> m_cus;
 
+  // Same CUs as bitmask, the CU mask words of the command packet
+  xocl::kernel::cu_bitmask_type m_cu_mask;
+
   // Number of active start_kernel commands in this context
   size_t m_active = 0;
 
@@ -109,17 +121,90 @@ private:
 
   std::mutex m_mutex;
 
+  // Runtime (rtinfo) arguments that change per workgroup
+  enum class rtinfo_type { global_id, group_id, printf_buffer };
+  using rtinfo_patch_type = std::pair<rtinfo_type,const xocl::kernel::argument*>;
+
+  // Precompiled command packet words following the packet header,
+  // i.e. the CU masks followed by the CU regmap with all kernel
+  // arguments and static rtinfo arguments encoded.  The template is
+  // built on first start() and copied into every command of this
+  // context, after which only m_rtinfo_patch args are re-encoded.
+  std::vector<word_type> m_packet_template;
+  std::vector<rtinfo_patch_type> m_rtinfo_patch;
+  size_t m_regmap_offset = 0;
+  word_type m_extra_cu_masks = 0;
+
+  // Set when the template encodes the regmap as ERT_EXEC_WRITE
+  // {offset,value} pairs because that is smaller than the full
+  // regmap.  m_exec_write_slots maps a regmap word index to the
+  // packet word holding its value.
+  bool m_exec_write = false;
+  std::vector<size_t> m_exec_write_slots;
+
+  // Printf buffer argument if any, and its device address
+  xocl::memory* m_printf_buffer = nullptr;
+  uint64_t m_printf_buffer_addr = 0;
+
+  // Buffer arguments pinned by the argument migration with device
+  // memory oversubscription, unpinned when execution is done
+  std::vector<xocl::memory*> m_pinned;
+
+  /**
+   * Release pins of buffer arguments
+   */
+  void
+  unpin_buffers();
+
   /**
    * Add the device's matching compute units
    */
   void
   add_compute_units(xocl::device* device);
 
+  /**
+   * Validate command packet before it is scheduled
+   */
   bool
   write(const command_type& cmd);
 
+  /**
+   * Encode CU masks
+   *
+   * @return
+   *   Number of extra CU masks (in addition to first mask)
+   */
+  word_type
+  encode_compute_units(std::vector<word_type>& words);
+
+  /**
+   * Encode kernel arguments into regmap
+   *
+   * Reuses the regmap template saved with the kernel by a prior
+   * context if any, and re-encodes only the arguments that have
+   * changed (per argument version) since the template was saved.
+   */
+  std::vector<word_type>
+  encode_kernel_arguments();
+
+  /**
+   * Mark the regmap words that are written by kernel arguments
+   */
+  std::vector<bool>
+  get_used_registers() const;
+
+  /**
+   * Build m_packet_template for this context
+   */
+  void
+  init_packet_template();
+
+  /**
+   * Encode runtime args that depend on current workgroup
+   */
+  template <typename RegmapType>
   void
-  encode_compute_units(packet_type& pkt);
+  patch_rtinfo(RegmapType& regmap, size_t offset);
 
   /**
    * Update workgroup accounting.
@@ -127,7 +212,13 @@ private:
   void
   update_work();
 
-  void
+  /**
+   * Create command for current workgroup
+   *
+   * @return
+   *   Command ready to be scheduled
+   */
+  command_type
   start();
 
   /**
@@ -158,12 +249,57 @@ public:
                     ,const size_t* global_work_size
                     ,const size_t* local_work_size);
 
+  ~execution_context();
+
+  /**
+   * Execution contexts are allocated from xrt::pool, one is
+   * constructed for every enqueued NDRange
+   */
+  static void*
+  operator new(size_t sz)
+  {
+    return xrt::pool::allocate(sz);
+  }
+
+  static void
+  operator delete(void* ptr, size_t sz)
+  {
+    xrt::pool::deallocate(ptr,sz);
+  }
+
   unsigned long
   get_uid() const
   {
     return m_uid;
   }
 
+  /**
+   * Build the command packet template used by all commands of this
+   * context.
+   *
+   * This is called by clEnqueueNDRangeKernel after the argument
+   * migration has been queued, so that the template is constructed
+   * while the arguments are being migrated.  If not called, the
+   * template is built when the first command is started.
+   *
+   * Pre-condition: The kernel event is not yet queued.
+   */
+  void
+  prepare();
+
+  /**
+   * Restrict this context to part of the NDRange
+   *
+   * The context executes only workgroups [begin,end) of the outermost
+   * work dimension.  The kernel still sees the global size and offset
+   * of the entire NDRange.  Used when an NDRange is split across
+   * devices.
+   *
+   * Pre-condition: The kernel event is not yet queued.
+   */
+  void
+  set_workgroup_range(size begin, size end);
+
   const size_t*
   get_global_work_size() const
   { return m_gsize.data(); }
@@ -352,8 +352,10 @@ kernel(program* prog, const std::string& name, const xclbin::symbol& symbol)
   auto context = prog->get_context();
   for (auto device : context->get_device_range())
     for  (auto& scu : device->get_cus())
-      if (scu->get_symbol_uid()==get_symbol_uid() && (cus.empty() || range_find(cus,scu->get_name())!=cus.end()))
+      if (scu->get_symbol_uid()==get_symbol_uid() && (cus.empty() || range_find(cus,scu->get_name())!=cus.end())) {
         m_cus.push_back(scu.get());
+        m_cu_connectivity[device].cus.set(scu->get_index());
+      }
   if (m_cus.empty())
     throw std::runtime_error("No kernel compute units matching '" + name + "'");
 }
@@ -402,19 +404,55 @@ kernel::
   XOCL_DEBUG(std::cout,"xocl::kernel::~kernel(",m_uid,")\n");
 }
 
+kernel::cu_bitmask_type
+kernel::
+get_cu_mask(const device* device) const
+{
+  auto itr = m_cu_connectivity.find(device);
+  return itr != m_cu_connectivity.end() ? itr->second.cus : cu_bitmask_type();
+}
+
+const std::vector<kernel::cu_bitmask_type>&
+kernel::
+get_arg_connectivity(const device* device, cu_connectivity& conn, unsigned long argidx) const
+{
+  if (argidx < conn.arg_memidx.size() && !conn.arg_memidx[argidx].empty())
+    return conn.arg_memidx[argidx];
+
+  if (conn.arg_memidx.size() <= argidx)
+    conn.arg_memidx.resize(argidx+1);
+
+  // CUs trimmed from conn.cus are never used again, so only the
+  // current ones need to be recorded
+  auto& memidx_cus = conn.arg_memidx[argidx];
+  memidx_cus.resize(memidx_bitmask_type().size());
+  for (auto& scu : device->get_cus()) {
+    auto cu_idx = scu->get_index();
+    if (!conn.cus.test(cu_idx) || scu->get_symbol_uid()!=get_symbol_uid())
+      continue;
+    auto mset = scu->get_memidx(argidx);
+    for (size_t memidx=0; memidx<mset.size(); ++memidx)
+      if (mset.test(memidx))
+        memidx_cus[memidx].set(cu_idx);
+  }
+  return memidx_cus;
+}
+
 kernel::memidx_bitmask_type
 kernel::
 get_memidx(const device* device, unsigned int argidx) const
 {
-  std::bitset<128> kcu;
-  for (auto cu : m_cus)
-    kcu.set(cu->get_index());
+  auto itr = m_cu_connectivity.find(device);
+  if (itr == m_cu_connectivity.end())
+    return memidx_bitmask_type();
 
   // Compute the union of all connections for all CUs
+  auto& conn = itr->second;
+  auto& memidx_cus = get_arg_connectivity(device,conn,argidx);
   memidx_bitmask_type mset;
-  for (auto& scu : device->get_cus())
-    if (kcu.test(scu->get_index()) && scu->get_symbol_uid()==get_symbol_uid())
-      mset |= scu->get_memidx(argidx);
+  for (size_t memidx=0; memidx<memidx_cus.size(); ++memidx)
+    if ((memidx_cus[memidx] & conn.cus).any())
+      mset.set(memidx);
 
   return mset;
 }
@@ -431,29 +469,50 @@ validate_cus(const device* device, unsigned long argidx, int memidx) const
 #endif
 
   XOCL_DEBUG(std::cout,"xocl::kernel::validate_cus(",argidx,",",memidx,")\n");
-  xclbin::memidx_bitmask_type connections;
-  connections.set(memidx);
-  auto end = m_cus.end();
-  for (auto itr=m_cus.begin(); itr!=end; ) {
-    auto cu = (*itr);
-    auto cuconn = cu->get_memidx(argidx);
-    if ((cuconn & connections).none()) {
-      auto axlf = device->get_axlf();
-      xrt::message::send
-        (xrt::message::severity_level::XRT_WARNING
-         , "Argument '" + std::to_string(argidx)
-         + "' of kernel '" + get_name()
-         + "' is allocated in memory bank '" + xrt_core::xclbin::memidx_to_name(axlf,memidx)
-         + "'; compute unit '" + cu->get_name()
-         + "' cannot be used with this argument and is ignored.");
-      XOCL_DEBUG(std::cout,"xocl::kernel::validate_cus removing cu(",cu->get_uid(),") ",cu->get_name(),"\n");
-      itr = m_cus.erase(itr);
-      end = m_cus.end();
-    }
+
+  // Eligible CUs of each device are those connecting argidx to memidx
+  bool trimmed = false;
+  for (auto& dconn : m_cu_connectivity) {
+    auto& conn = dconn.second;
+    auto& memidx_cus = get_arg_connectivity(dconn.first,conn,argidx);
+    auto eligible = conn.cus;
+    if (memidx >= 0 && static_cast<size_t>(memidx) < memidx_cus.size())
+      eligible &= memidx_cus[memidx];
     else
-      ++itr;
+      eligible.reset();
+    if (eligible != conn.cus) {
+      conn.cus = eligible;
+      trimmed = true;
+    }
+  }
+
+  if (trimmed) {
+    auto end = m_cus.end();
+    for (auto itr=m_cus.begin(); itr!=end; ) {
+      auto cu = (*itr);
+      if (!m_cu_connectivity[cu->get_device()].cus.test(cu->get_index())) {
+        auto axlf = device->get_axlf();
+        xrt::message::send
+          (xrt::message::severity_level::XRT_WARNING
+           , "Argument '" + std::to_string(argidx)
+           + "' of kernel '" + get_name()
+           + "' is allocated in memory bank '" + xrt_core::xclbin::memidx_to_name(axlf,memidx)
+           + "'; compute unit '" + cu->get_name()
+           + "' cannot be used with this argument and is ignored.");
+        XOCL_DEBUG(std::cout,"xocl::kernel::validate_cus removing cu(",cu->get_uid(),") ",cu->get_name(),"\n");
+        itr = m_cus.erase(itr);
+        end = m_cus.end();
+      }
+      else
+        ++itr;
+    }
   }
   XOCL_DEBUG(std::cout,"xocl::kernel::validate_cus remaining CUs ",m_cus.size(),"\n");
+  if (!m_cus.empty()) {
+    if (m_validated_memidx.size() <= argidx)
+      m_validated_memidx.resize(argidx+1,-1);
+    m_validated_memidx[argidx] = memidx;
+  }
   return m_cus.size();
 }
 
@@ -462,9 +521,9 @@ kernel::
 select_cu(const device* device) const
 {
   // Select a CU from device that is also available to kernel
-  std::bitset<128> kcu;
-  for (auto cu : m_cus)
-    kcu.set(cu->get_index());
+  auto kcu = get_cu_mask(device);
+  if (kcu.none())
+    return nullptr;
 
   for (auto& scu : device->get_cus()) {
     if (kcu.test(scu->get_index()) && scu->get_symbol_uid()==get_symbol_uid()) {
@@ -504,15 +563,25 @@ void
 kernel::
 assign_buffer_to_argidx(memory* buf, unsigned long argidx)
 {
+  // Fast path for a buffer that is already allocated in a bank the
+  // compute units have been validated against for this argument,
+  // e.g. when an application cycles through a set of buffers
+  auto memidx = buf->get_memidx();
+  if (memidx>=0 && argidx<m_validated_memidx.size() && m_validated_memidx[argidx]==memidx)
+    return;
+
   bool trim = buf->set_kernel_argidx(this,argidx);
 
   // Do early buffer allocation if context has single active device
   auto ctx = buf->get_context();
   auto device = ctx->get_single_active_device();
   if (device) {
+    // Buffer placed before this first use may be in the wrong bank
+    if (trim)
+      buf->rehome(device);
     auto boh = buf->get_buffer_object(device);
     if (trim) {
-      auto memidx = buf->get_memidx();
+      memidx = buf->get_memidx();
       assert(memidx>=0);
       validate_cus(device,argidx,memidx);
     }
@@ -23,7 +23,11 @@
 #include "xocl/xclbin/xclbin.h"
 
 #include "xrt/util/td.h"
+#include <bitset>
 #include <limits>
+#include <map>
+#include <mutex>
+#include <vector>
 
 #include <iostream>
 
@@ -35,6 +39,9 @@ class kernel : public refcount, public _cl_kernel
 {
   using memidx_bitmask_type = xclbin::memidx_bitmask_type;
 public:
+  // Bitmask of CUs of a device in CU index positions
+  using cu_bitmask_type = std::bitset<128>;
+
   /**
    * class argument is a class hierarchy that represents a kernel
    * object argument constructed from xclbin::symbol::arg meta data.
@@ -234,9 +241,25 @@ public:
     static std::unique_ptr<kernel::argument>
       create(arginfo_type arg,kernel* kernel);
 
+    /**
+     * Version of argument value.
+     *
+     * Incremented every time the argument is set.  The version is
+     * copied when the argument is cloned and is used to identify
+     * arguments that have changed since a regmap was encoded.
+     */
+    unsigned long
+    get_version() const
+    { return m_version; }
+
+    void
+    bump_version()
+    { ++m_version; }
+
   protected:
     kernel* m_kernel = nullptr;
     unsigned long m_argidx = std::numeric_limits<unsigned long>::max();
+    unsigned long m_version = 0;
     bool m_set = false;
   };
 
@@ -501,19 +524,66 @@ public:
   void
   set_argument(unsigned long idx, size_t sz, const void* arg)
   {
-    m_indexed_args.at(idx)->set(idx,sz,arg);
+    auto& karg = m_indexed_args.at(idx);
+    karg->set(idx,sz,arg);
+    karg->bump_version();
   }
 
   void
   set_svm_argument(unsigned long idx, size_t sz, const void* arg)
   {
-    m_indexed_args.at(idx)->set_svm(sz,arg);
+    auto& karg = m_indexed_args.at(idx);
+    karg->set_svm(sz,arg);
+    karg->bump_version();
   }
 
   void
   set_printf_argument(size_t sz, const void* arg)
   {
-    m_printf_args.at(0)->set(sz,arg);
+    auto& karg = m_printf_args.at(0);
+    karg->set(sz,arg);
+    karg->bump_version();
+  }
+
+  /**
+   * Precompiled register map of kernel arguments
+   *
+   * The regmap is encoded by an execution context and saved with the
+   * kernel so that later launches on same device only need to
+   * re-encode the arguments whose version has changed since the
+   * regmap was encoded.
+   *
+   * @dev: device for which the regmap was encoded
+   * @regmap: encoded argument words starting at CU control register
+   * @versions: version of each argument (per get_argument_range())
+   *   at the time it was encoded
+   */
+  struct regmap_template
+  {
+    const device* dev = nullptr;
+    std::vector<uint32_t> regmap;
+    std::vector<unsigned long> versions;
+  };
+
+  /**
+   * @return
+   *   Copy of current regmap template, empty if none has been saved
+   */
+  regmap_template
+  get_regmap_template() const
+  {
+    std::lock_guard<std::mutex> lk(m_regmap_mutex);
+    return m_regmap_template;
+  }
+
+  /**
+   * Save regmap template for reuse by subsequent launches
+   */
+  void
+  set_regmap_template(regmap_template&& tmpl)
+  {
+    std::lock_guard<std::mutex> lk(m_regmap_mutex);
+    m_regmap_template = std::move(tmpl);
   }
 
   /**
@@ -589,6 +659,13 @@ public:
     return m_cus.size();
   }
 
+  /**
+   * @return
+   *  Bitmask of CUs of device that can be used by this kernel object
+   */
+  cu_bitmask_type
+  get_cu_mask(const device* dev) const;
+
   /**
    * Get the set of memory banks an argument can connect to given the
    * current set of kernel compute units for specified device
@@ -644,6 +721,26 @@ private:
   // contract.
   mutable std::vector<const compute_unit*> m_cus;
 
+  // Memory index per argidx that the current m_cus have been
+  // validated against, or -1.  Since m_cus is only ever trimmed, a
+  // buffer allocated in the validated bank can be set as argument
+  // without validating again.
+  mutable std::vector<int> m_validated_memidx;
+
+  // CUs of m_cus per device as bitmask, and per argument and memory
+  // index the bitmask of kernel CUs that connect the argument to the
+  // memory bank.  The connectivity is computed on first use of an
+  // argument, CUs eligible for a bank are then the AND of the two.
+  struct cu_connectivity
+  {
+    cu_bitmask_type cus;
+    std::vector<std::vector<cu_bitmask_type>> arg_memidx;
+  };
+  mutable std::map<const device*, cu_connectivity> m_cu_connectivity;
+
+  const std::vector<cu_bitmask_type>&
+  get_arg_connectivity(const device* dev, cu_connectivity& conn, unsigned long argidx) const;
+
   // Select a CU for argument buffer
   const compute_unit*
   select_cu(const device* dev) const;
@@ -664,6 +761,9 @@ private:
   argument_vector_type m_printf_args;
   argument_vector_type m_progvar_args;
   argument_vector_type m_rtinfo_args;
+
+  mutable std::mutex m_regmap_mutex;
+  regmap_template m_regmap_template;
 };
 
 namespace kernel_utils {
@@ -18,10 +18,15 @@
 #include "device.h"
 #include "kernel.h"
 #include "context.h"
+#include "callback.h"
 #include "error.h"
 
+#include "xrt/util/config_reader.h"
 
+#include <algorithm>
 #include <iostream>
+#include <cstring>
+#include <new>
 
 namespace {
 
@@ -48,6 +53,76 @@ singleContextDevice(cl_context context)
     : nullptr;
 }
 
+using range_list = xocl::memory::range_list;
+
+// Add [begin,end) to ordered list of ranges, merging overlapping and
+// adjacent ranges
+static void
+add_range(range_list& ranges, size_t begin, size_t end)
+{
+  auto itr = ranges.begin();
+  while (itr!=ranges.end() && (*itr).second<begin)
+    ++itr;
+  auto last = itr;
+  while (last!=ranges.end() && (*last).first<=end) {
+    begin = std::min(begin,(*last).first);
+    end = std::max(end,(*last).second);
+    ++last;
+  }
+  itr = ranges.erase(itr,last);
+  ranges.emplace(itr,begin,end);
+}
+
+// Remove [begin,end) from ordered list of ranges
+static void
+remove_range(range_list& ranges, size_t begin, size_t end)
+{
+  range_list result;
+  for (auto& range : ranges) {
+    if (range.second<=begin || range.first>=end) {
+      result.push_back(range);
+      continue;
+    }
+    if (range.first<begin)
+      result.emplace_back(range.first,begin);
+    if (range.second>end)
+      result.emplace_back(end,range.second);
+  }
+  ranges.swap(result);
+}
+
+// Parts of [begin,end) not covered by ordered list of ranges
+static range_list
+uncovered_ranges(const range_list& ranges, size_t begin, size_t end)
+{
+  range_list result;
+  for (auto& range : ranges) {
+    if (range.second<=begin)
+      continue;
+    if (range.first>=end)
+      break;
+    if (range.first>begin)
+      result.emplace_back(begin,range.first);
+    begin = range.second;
+  }
+  if (begin<end)
+    result.emplace_back(begin,end);
+  return result;
+}
+
+// Buffers that device memory oversubscription may evict, plain
+// buffers backed by host memory
+static bool
+is_evictable(const xocl::memory* mem)
+{
+  return xrt::config::get_device_oversubscription()
+    && mem->get_type()==CL_MEM_OBJECT_BUFFER
+    && !mem->get_sub_buffer_parent()
+    && !(mem->get_flags() & CL_MEM_REGISTER_MAP)
+    && !mem->is_device_memory_only()
+    && !mem->is_device_memory_only_p2p();
+}
+
 static xocl::memory::memory_callback_list sg_constructor_callbacks;
 static xocl::memory::memory_callback_list sg_destructor_callbacks;
 
@@ -75,13 +150,22 @@ memory::
   XOCL_DEBUG(std::cout,"xocl::memory::~memory(): ",m_uid,"\n");
 
   try {
-    if (m_dtor_notify)
-      std::for_each(m_dtor_notify->rbegin(),m_dtor_notify->rend(),
-                    [](std::function<void()>& fcn) { fcn(); });
+    // Destructor callbacks run in reverse order of registration on
+    // the callback executor, this object is gone when they run.
+    if (m_dtor_notify) {
+      std::shared_ptr<std::vector<std::function<void()>>> notify(std::move(m_dtor_notify));
+      run_user_callback([notify] {
+        std::for_each(notify->rbegin(),notify->rend(),
+                      [](std::function<void()>& fcn) { fcn(); });
+      });
+    }
 
     for (auto& cb: sg_destructor_callbacks)
       cb(this);
 
+    if (m_placed_device)
+      m_placed_device->unplace_buffer(m_memidx,m_placed_size);
+
     if(m_connidx==-1)
       return;
     //Not very clean, having to remove a const cast.
@@ -120,6 +204,123 @@ update_buffer_object_map(const device* device, buffer_object_handle boh)
   }
 }
 
+bool
+memory::
+rehome(device* device)
+{
+  std::lock_guard<std::mutex> lk(m_boh_mutex);
+  if (!m_rehome || device!=m_placed_device || m_karg.size()!=1
+      || !m_resident.empty() || !m_resident_ranges.empty())
+    return false;
+
+  auto itr = m_bomap.find(device);
+  if (m_bomap.size()!=1 || itr==m_bomap.end())
+    return false;
+
+  auto& karg = m_karg.front();
+  auto mset = karg.first->get_memidx(device,karg.second);
+  if (m_memidx<0 || mset.none() || mset.test(m_memidx))
+    return false;
+
+  auto memidx = device->place_buffer(m_placed_size,mset);
+  if (memidx<0)
+    return false;
+
+  buffer_object_handle boh;
+  try {
+    boh = device->allocate_buffer_object(this,memidx);
+  }
+  catch (...) {
+    device->unplace_buffer(memidx,m_placed_size);
+    throw;
+  }
+
+  // Preserve content written to the buffer object so far, the
+  // host memory of both buffer objects is the same for an aligned
+  // host ptr
+  auto xdevice = device->get_xrt_device();
+  auto dst = xdevice->map(boh);
+  auto src = xdevice->map((*itr).second);
+  if (dst!=src)
+    std::memcpy(dst,src,m_placed_size);
+  xdevice->unmap((*itr).second);
+  xdevice->unmap(boh);
+
+  XOCL_DEBUG(std::cout,"memory(",get_uid(),") moved from memory index(",m_memidx,") to (",memidx,")\n");
+  device->unplace_buffer(m_memidx,m_placed_size);
+  (*itr).second = std::move(boh);
+  m_memidx = memidx;
+  m_rehome = false;
+  return true;
+}
+
+bool
+memory::
+evict(device* device)
+{
+  // Never wait for a buffer, a locked buffer is in use
+  std::unique_lock<std::mutex> lk(m_boh_mutex,std::try_to_lock);
+  if (!lk.owns_lock() || m_bo_shared || m_pins || m_bomap.size()!=1)
+    return false;
+
+  // The buffer object must not be referenced outside of this memory
+  // object, e.g. by an ongoing read or copy
+  auto itr = m_bomap.find(device);
+  if (itr==m_bomap.end() || (*itr).second.use_count()!=1)
+    return false;
+
+  auto& boh = (*itr).second;
+  auto xdevice = device->get_xrt_device();
+  auto size = get_size();
+
+  // Sync device content that is not valid in host memory
+  range_list resident;
+  if (std::find(m_resident.begin(),m_resident.end(),device)!=m_resident.end())
+    resident.emplace_back(0,size);
+  else if (m_resident_ranges.count(device))
+    resident = m_resident_ranges[device];
+  for (auto& range : resident) {
+    auto stale = m_host_valid_tracking
+      ? uncovered_ranges(m_host_valid,range.first,range.second)
+      : range_list{range};
+    for (auto& srange : stale)
+      xdevice->sync(boh,srange.second-srange.first,srange.first,
+                    xrt::device::direction::DEVICE2HOST,false).wait();
+  }
+
+  // Save host memory of the buffer object unless it is the host ptr
+  auto host_ptr = get_host_ptr();
+  auto hbuf = xdevice->map(boh);
+  if (!host_ptr) {
+    m_evicted.reset(new (std::nothrow) char[size]);
+    if (m_evicted)
+      std::memcpy(m_evicted.get(),hbuf,size);
+  }
+  else if (hbuf!=host_ptr) {
+    std::memcpy(host_ptr,hbuf,size);
+  }
+  xdevice->unmap(boh);
+  if (!host_ptr && !m_evicted)
+    return false;
+
+  m_bomap.erase(itr); // frees the buffer object
+  m_resident.erase(std::remove(m_resident.begin(),m_resident.end(),device),m_resident.end());
+  m_resident_ranges.erase(device);
+  m_host_valid.clear();
+  if (m_host_valid_tracking)
+    add_range(m_host_valid,0,size);
+  return true;
+}
+
+void
+memory::
+untrack_evictable()
+{
+  std::lock_guard<std::mutex> lk(m_boh_mutex);
+  for (auto& value : m_bomap)
+    const_cast<device*>(value.first)->untrack_evictable(this);
+}
+
 memory::buffer_object_handle
 memory::
 get_buffer_object(device* device, xrt::device::memoryDomain domain, uint64_t memidx)
@@ -141,8 +342,11 @@ get_buffer_object(device* device)
   std::lock_guard<std::mutex> lk(m_boh_mutex);
   auto itr = m_bomap.find(device);
 
-  if (itr!=m_bomap.end())
+  if (itr!=m_bomap.end()) {
+    if (is_evictable(this))
+      device->touch_evictable(this);
     return (*itr).second;
+  }
 
   // Maybe import from XARE device
   if (m_bomap.size() && itr==m_bomap.end() && device->is_xare_device()) {
@@ -153,8 +357,32 @@ get_buffer_object(device* device)
   // Get memory bank index if assigned, -1 if not assigned, which will trigger
   // allocation error when default allocation is disabled
   get_memidx_nolock(device); // computes m_memidx
+
+  // Spread buffers not constrained by connectivity across memory banks
+  if (m_memidx==-1 && m_karg.empty() && !m_placed_device
+      && !(m_flags & CL_MEM_REGISTER_MAP) && !get_sub_buffer_parent()) {
+    memidx_bitmask_type mask;
+    mask.set();
+    m_memidx = device->place_buffer(get_size(),mask);
+    if (m_memidx>=0) {
+      m_placed_device = device;
+      m_placed_size = get_size();
+      m_rehome = true;
+    }
+  }
+
   auto boh = (m_bomap[device] = device->allocate_buffer_object(this,m_memidx));
 
+  // Restore content of a buffer evicted from device memory
+  if (m_evicted && boh) {
+    auto xdevice = device->get_xrt_device();
+    std::memcpy(xdevice->map(boh),m_evicted.get(),get_size());
+    xdevice->unmap(boh);
+    m_evicted.reset();
+  }
+  if (boh && is_evictable(this))
+    device->touch_evictable(this);
+
   // To be deleted when strict bank rules are enforced
   if (boh && m_memidx==-1) {
     auto mset = device->get_boh_memidx(boh);
@@ -220,6 +448,126 @@ try_get_buffer_object_or_error(const device* device) const
   return (*itr).second;
 }
 
+bool
+memory::
+is_resident_range(const device* device, size_t offset, size_t size) const
+{
+  std::lock_guard<std::mutex> lk(m_boh_mutex);
+  if (std::find(m_resident.begin(),m_resident.end(),device) != m_resident.end())
+    return true;
+  auto itr = m_resident_ranges.find(device);
+  if (itr == m_resident_ranges.end())
+    return false;
+  return uncovered_ranges((*itr).second,offset,offset+size).empty();
+}
+
+bool
+memory::
+is_resident_range(size_t offset, size_t size) const
+{
+  return get_resident_range_device(offset,size) || is_resident();
+}
+
+const device*
+memory::
+get_resident_range_device(size_t offset, size_t size) const
+{
+  std::lock_guard<std::mutex> lk(m_boh_mutex);
+  const device* resident = nullptr;
+  size_t count = m_resident.size();
+  if (count)
+    resident = m_resident[0];
+  for (auto& value : m_resident_ranges) {
+    if (uncovered_ranges(value.second,offset,offset+size).empty()) {
+      resident = value.first;
+      ++count;
+    }
+  }
+  return count==1 ? resident : nullptr;
+}
+
+void
+memory::
+set_resident_range(const device* device, size_t offset, size_t size)
+{
+  auto bufsize = get_size();
+  std::lock_guard<std::mutex> lk(m_boh_mutex);
+  if (std::find(m_resident.begin(),m_resident.end(),device) != m_resident.end())
+    return;
+  auto& ranges = m_resident_ranges[device];
+  add_range(ranges,offset,offset+size);
+  if (uncovered_ranges(ranges,0,bufsize).empty()) {
+    m_resident_ranges.erase(device);
+    m_resident.push_back(device);
+  }
+}
+
+void
+memory::
+clear_resident_range(const device* device, size_t offset, size_t size)
+{
+  auto bufsize = get_size();
+  std::lock_guard<std::mutex> lk(m_boh_mutex);
+  auto itr = std::find(m_resident.begin(),m_resident.end(),device);
+  if (itr != m_resident.end()) {
+    m_resident.erase(itr);
+    m_resident_ranges[device].emplace_back(0,bufsize);
+  }
+  auto ritr = m_resident_ranges.find(device);
+  if (ritr == m_resident_ranges.end())
+    return;
+  remove_range((*ritr).second,offset,offset+size);
+  if ((*ritr).second.empty())
+    m_resident_ranges.erase(ritr);
+}
+
+memory::range_list
+memory::
+get_nonresident_ranges(const device* device, size_t offset, size_t size) const
+{
+  std::lock_guard<std::mutex> lk(m_boh_mutex);
+  if (std::find(m_resident.begin(),m_resident.end(),device) != m_resident.end())
+    return {};
+  auto itr = m_resident_ranges.find(device);
+  if (itr == m_resident_ranges.end())
+    return {{offset,offset+size}};
+  return uncovered_ranges((*itr).second,offset,offset+size);
+}
+
+void
+memory::
+set_device_written(size_t offset, size_t size)
+{
+  std::lock_guard<std::mutex> lk(m_boh_mutex);
+  remove_range(m_host_valid,offset,offset+size);
+}
+
+void
+memory::
+set_host_valid(size_t offset, size_t size)
+{
+  std::lock_guard<std::mutex> lk(m_boh_mutex);
+  if (m_host_valid_tracking)
+    add_range(m_host_valid,offset,offset+size);
+}
+
+memory::range_list
+memory::
+get_host_stale_ranges(size_t offset, size_t size) const
+{
+  std::lock_guard<std::mutex> lk(m_boh_mutex);
+  return uncovered_ranges(m_host_valid,offset,offset+size);
+}
+
+void
+memory::
+disable_host_valid_tracking()
+{
+  std::lock_guard<std::mutex> lk(m_boh_mutex);
+  m_host_valid_tracking = false;
+  m_host_valid.clear();
+}
+
 // private
 memory::memidx_type
 memory::
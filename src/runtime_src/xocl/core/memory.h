@@ -28,6 +28,7 @@
 #include "core/common/memalign.h"
 
 #include <map>
+#include <atomic>
 
 namespace xocl {
 
@@ -52,6 +53,10 @@ public:
   using memory_callback_type = std::function<void (memory*)>;
   using memory_callback_list = std::vector<memory_callback_type>;
 
+  // Byte range [first,second) of a memory object
+  using range_type = std::pair<size_t,size_t>;
+  using range_list = std::vector<range_type>;
+
   memory(context* cxt, cl_mem_flags flags);
   virtual ~memory();
 
@@ -108,6 +113,66 @@ public:
   bool
   set_kernel_argidx(const kernel* kernel, unsigned int argidx);
 
+  /**
+   * Move buffer to a memory bank required by kernel connectivity
+   *
+   * A buffer placed in a bank by device::place_buffer() before it was
+   * used as a kernel argument is reallocated, with its content, in a
+   * bank connected to the compute units of the first kernel argument
+   * it is used with.  Nothing is done if the buffer is resident,
+   * mapped, parent of a sub-buffer, or allocated on several devices.
+   *
+   * @return
+   *   true if buffer was moved, false otherwise
+   */
+  bool
+  rehome(device* device);
+
+  /**
+   * Prevent rehome() and evict() once the buffer object is referenced
+   * elsewhere
+   */
+  void
+  disable_rehome()
+  {
+    std::lock_guard<std::mutex> lk(m_boh_mutex);
+    m_rehome = false;
+    m_bo_shared = true;
+  }
+
+  /**
+   * Evict the buffer object on argument device to host memory
+   *
+   * Used by device::alloc() for device memory oversubscription.  The
+   * device content is synced to host and the buffer object is freed.
+   * Next get_buffer_object() allocates it again and the buffer is
+   * migrated as any buffer that is not resident.  Nothing is done if
+   * the buffer object is pinned, referenced outside this memory object,
+   * mapped, parent of a sub-buffer, device only, or allocated on several
+   * devices.
+   *
+   * @return
+   *   true if buffer was evicted, false otherwise
+   */
+  bool
+  evict(device* device);
+
+  /**
+   * Pin the buffer object of this memory while a command using it is
+   * enqueued.  A pinned buffer is never evicted.
+   */
+  void
+  pin()
+  {
+    ++m_pins;
+  }
+
+  void
+  unpin()
+  {
+    --m_pins;
+  }
+
   void
   set_ext_kernel(const kernel* kernel)
   {
@@ -413,10 +478,11 @@ public:
   /**
    * Set device resident
    */
-  void
+  virtual void
   set_resident(const device* device)
   {
     std::lock_guard<std::mutex> lk(m_boh_mutex);
+    m_resident_ranges.erase(device);
     if (std::find(m_resident.begin(),m_resident.end(),device) == m_resident.end())
       m_resident.push_back(device);
   }
@@ -429,8 +495,114 @@ public:
   {
     std::lock_guard<std::mutex> lk(m_boh_mutex);
     m_resident.clear();
+    m_resident_ranges.clear();
+  }
+
+  /**
+   * Clear resident device
+   */
+  virtual void
+  clear_resident(const device* device)
+  {
+    std::lock_guard<std::mutex> lk(m_boh_mutex);
+    m_resident_ranges.erase(device);
+    auto itr = std::find(m_resident.begin(),m_resident.end(),device);
+    if (itr != m_resident.end())
+      m_resident.erase(itr);
+  }
+
+  /**
+   * Check if a byte range of this buffer is resident on device
+   *
+   * A buffer is partially resident when some of its sub-buffers have
+   * been migrated, but not the buffer itself.
+   */
+  bool
+  is_resident_range(const device* device, size_t offset, size_t size) const;
+
+  /**
+   * Check if a byte range of this buffer is resident on any device
+   */
+  bool
+  is_resident_range(size_t offset, size_t size) const;
+
+  /**
+   * Get the device on which a byte range is resident if exactly one
+   */
+  const device*
+  get_resident_range_device(size_t offset, size_t size) const;
+
+  /**
+   * Mark a byte range of this buffer resident on device
+   *
+   * The device becomes fully resident when its ranges cover the
+   * entire buffer.
+   */
+  void
+  set_resident_range(const device* device, size_t offset, size_t size);
+
+  /**
+   * Clear residency of a byte range of this buffer on device
+   */
+  void
+  clear_resident_range(const device* device, size_t offset, size_t size);
+
+  /**
+   * Get the byte ranges of a range of this buffer that are not
+   * resident on device
+   *
+   * Return: Ordered list of ranges relative to this buffer, empty if
+   * the range is resident.
+   */
+  range_list
+  get_nonresident_ranges(const device* device, size_t offset, size_t size) const;
+
+  /**
+   * Get the byte ranges of this buffer that must be migrated to
+   * make it resident on device
+   */
+  virtual range_list
+  get_nonresident_ranges(const device* device) const
+  {
+    return get_nonresident_ranges(device,0,get_size());
   }
 
+  /**
+   * Record that a byte range of this buffer was written on device
+   *
+   * The host copy of the range is stale until it is synced from
+   * device again.
+   */
+  virtual void
+  set_device_written(size_t offset, size_t size);
+
+  /**
+   * Record that host and device agree on a byte range of this buffer
+   *
+   * Called after the range has been synced in either direction.
+   */
+  virtual void
+  set_host_valid(size_t offset, size_t size);
+
+  /**
+   * Get the byte ranges of a range of this buffer that must be
+   * synced from device to bring the host copy up to date
+   *
+   * Return: Ordered list of ranges relative to this buffer
+   */
+  virtual range_list
+  get_host_stale_ranges(size_t offset, size_t size) const;
+
+  /**
+   * Stop tracking host valid ranges of this buffer
+   *
+   * Used when the buffer object is shared outside of xocl, in which
+   * case device writes are not seen and the entire range is always
+   * synced from device.
+   */
+  virtual void
+  disable_host_valid_tracking();
+
   /**
    * Add a dtor callback
    */
@@ -451,6 +623,15 @@ public:
    */
   static void register_destructor_callbacks(memory_callback_type&& aCallback);
 
+protected:
+  /**
+   * Remove this buffer from the eviction lists of all devices.  Must
+   * be called by the destructor of an evictable derived class, before
+   * the derived object is torn down.
+   */
+  void
+  untrack_evictable();
+
 private:
   memidx_type
   get_memidx_nolock(const device* d) const;
@@ -485,7 +666,32 @@ private:
   mutable std::mutex m_boh_mutex;
   bomap_type m_bomap;
   std::vector<const device*> m_resident;
+
+  // Resident byte ranges per device on which this buffer is only
+  // partially resident.  Ranges are ordered and never adjacent.
+  std::map<const device*,range_list> m_resident_ranges;
+
+  // Byte ranges where the host copy is known to match device, ranges
+  // are removed when written on device.  Not used when tracking is
+  // disabled for a shared buffer object.
+  range_list m_host_valid;
+  bool m_host_valid_tracking = true;
   connidx_type m_connidx = -1;
+
+  // Device that placed this buffer in a bank, size accounted in the
+  // bank, and if buffer can still be moved to another bank
+  device* m_placed_device = nullptr;
+  size_t m_placed_size = 0;
+  bool m_rehome = false;
+
+  // Buffer object is mapped or shared with a sub-buffer, and must
+  // not be evicted.  Pins are held by enqueued kernel commands.
+  bool m_bo_shared = false;
+  std::atomic<unsigned int> m_pins {0};
+
+  // Content of an evicted buffer without host ptr, copied into the
+  // buffer object when it is allocated again
+  std::unique_ptr<char[]> m_evicted;
 };
 
 class buffer : public memory
@@ -509,6 +715,7 @@ public:
 
   ~buffer()
   {
+    untrack_evictable();
     if (m_host_ptr && (get_flags() & (CL_MEM_COPY_HOST_PTR | CL_MEM_ALLOC_HOST_PTR)))
       free(m_host_ptr);
   }
@@ -566,49 +773,83 @@ public:
     return m_parent.get();
   }
 
+  // A sub buffer is a view of its parent, residency is tracked by
+  // the parent for the range covered by the sub buffer.
+
   virtual const device*
   get_resident_device() const
   {
-    if (auto d = memory::get_resident_device())
-      return d;
-    return m_parent->get_resident_device();
+    return m_parent->get_resident_range_device(m_offset,get_size());
   }
 
   virtual bool
   is_resident() const
   {
-    // sub buffer is resident if it itself is resident on some device
-    if (memory::is_resident())
-      return true;
-
-    // or if parent is resident on some device
-    if (m_parent->is_resident())
-      return true;
-
-    return false;
+    return m_parent->is_resident_range(m_offset,get_size());
   }
 
   virtual bool
   is_resident(const device* device) const
   {
-    // sub buffer is resident if it itself is marked resident
-    if (memory::is_resident(device))
-      return true;
+    if (!m_parent->is_resident_range(device,m_offset,get_size()))
+      return false;
 
-    // or, if parent is resident
-    if (m_parent->is_resident(device)) {
-      // make sub buffer explicit resident, logically const
-      const_cast<sub_buffer*>(this)->make_resident(device);
-      return true;
-    }
-    return false;
+    // make sure the sub buffer view exists on device, logically const
+    const_cast<sub_buffer*>(this)->get_buffer_object(const_cast<xocl::device*>(device));
+    return true;
   }
+
+  virtual void
+  set_resident(const device* device)
+  {
+    m_parent->set_resident_range(device,m_offset,get_size());
+  }
+
+  virtual void
+  clear_resident(const device* device)
+  {
+    m_parent->clear_resident_range(device,m_offset,get_size());
+  }
+
+  virtual range_list
+  get_nonresident_ranges(const device* device) const
+  {
+    return to_sub_ranges(m_parent->get_nonresident_ranges(device,m_offset,get_size()));
+  }
+
+  virtual void
+  set_device_written(size_t offset, size_t size)
+  {
+    m_parent->set_device_written(m_offset+offset,size);
+  }
+
+  virtual void
+  set_host_valid(size_t offset, size_t size)
+  {
+    m_parent->set_host_valid(m_offset+offset,size);
+  }
+
+  virtual range_list
+  get_host_stale_ranges(size_t offset, size_t size) const
+  {
+    return to_sub_ranges(m_parent->get_host_stale_ranges(m_offset+offset,size));
+  }
+
+  virtual void
+  disable_host_valid_tracking()
+  {
+    m_parent->disable_host_valid_tracking();
+  }
+
 private:
-  void
-  make_resident(const device* device)
+  range_list
+  to_sub_ranges(range_list ranges) const
   {
-    memory::get_buffer_object(const_cast<xocl::device*>(device));
-    memory::set_resident(device);
+    for (auto& range : ranges) {
+      range.first -= m_offset;
+      range.second -= m_offset;
+    }
+    return ranges;
   }
 
 
@@ -17,60 +17,171 @@
 #include "pipe.h"
 #include "xocl/core/context.h"
 #include "xocl/core/device.h"
+#include "xocl/core/error.h"
+
+#include <algorithm>
 
 namespace xocl { namespace pmd {
 
 pipe::
-pipe(context* ctx, device* dev, cl_mem_flags flags, cl_uint max_packets, cl_pipe_attributes attributes)
-  : m_context(ctx), m_device(dev), m_strm(0)
+pipe(context* ctx, device* dev, cl_mem_flags flags, cl_uint packet_size, cl_uint max_packets, cl_pipe_attributes attributes)
+  : m_context(ctx), m_device(dev)
+  , m_write(flags == CL_MEM_RTE_MBUF_WRITE_ONLY), m_packet_size(packet_size)
 {
   static unsigned int uid_count = 0;
   m_uid = uid_count++;
 
   XOCL_DEBUG(std::cout,"xocl::pmd::pipe::pipe(",m_uid,")\n");
 
-  auto dir = (flags == CL_MEM_RTE_MBUF_WRITE_ONLY)
-    ? xrt::device::direction::HOST2DEVICE 
-    : xrt::device::direction::DEVICE2HOST;
-
-  (void) dir;
-
-  //m_strm = dev->get_xrt_device()->openStream(max_packets,attributes,dir);
+  // The pipe attribute is the route of the stream
+  auto xdevice = dev->get_xrt_device();
+  xrt::device::stream_flags sflags = CL_STREAM_PRIVATE_COMPLETIONS;
+  uint64_t route = attributes;
+  uint64_t flow = (uint64_t)-1;
+  int rc = m_write
+    ? xdevice->createWriteStream(sflags | CL_STREAM_WRITE_ONLY, 0, route, flow, &m_strm)
+    : xdevice->createReadStream(sflags | CL_STREAM_READ_ONLY, 0, route, flow, &m_strm);
+  if (rc)
+    throw xocl::error(CL_INVALID_OPERATION,"Create stream failed");
+
+  m_buf = static_cast<char*>(xdevice->allocStreamBuf(m_packet_size * max_packets, &m_buf_handle));
+  if (!m_buf) {
+    xdevice->closeStream(m_strm);
+    throw xocl::error(CL_OUT_OF_RESOURCES,"Failed to allocate stream buffer for pipe");
+  }
+
+  m_packets.resize(max_packets);
+  m_free.reserve(max_packets);
+  m_comps.resize(max_packets);
+  for (size_t i = 0; i < max_packets; ++i) {
+    m_packets[i] = { m_buf + i * m_packet_size, static_cast<uint32_t>(m_packet_size) };
+    m_free.push_back(&m_packets[i]);
+  }
+
+  if (!m_write) {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    post();
+  }
 }
 
 pipe::
 ~pipe()
 {
   XOCL_DEBUG(std::cout,"xocl::pmd::pipe::~pipe(",m_uid,")\n");
-  //m_device->get_xrt_device()->closeStream(m_strm);
+  auto xdevice = m_device->get_xrt_device();
+  xdevice->closeStream(m_strm);
+  xdevice->freeStreamBuf(m_buf_handle);
+}
+
+void
+pipe::
+reap(size_t max)
+{
+  if (!m_inflight)
+    return;
+
+  int actual = 0;
+  int num = static_cast<int>(std::min(max, m_inflight));
+  if (m_device->get_xrt_device()->pollStream(m_strm, m_comps.data(), 0, num, &actual, 0) < 0)
+    return;
+
+  m_inflight -= actual;
+  for (int i = 0; i < actual; ++i) {
+    auto& comp = m_comps[i];
+    auto pkt = static_cast<packet*>(comp.priv_data);
+    if (m_write || comp.err_code) {
+      m_free.push_back(pkt);
+      continue;
+    }
+    pkt->data_len = static_cast<uint32_t>(comp.nbytes);
+    m_received.push_back(pkt);
+  }
+}
+
+void
+pipe::
+post()
+{
+  auto xdevice = m_device->get_xrt_device();
+  while (!m_free.empty()) {
+    auto pkt = m_free.back();
+    xrt::device::stream_xfer_req req = {0};
+    req.flags = CL_STREAM_EOT | CL_STREAM_NONBLOCKING;
+    req.priv_data = pkt;
+    if (xdevice->readStream(m_strm, pkt->buf_addr, m_packet_size, &req) <= 0)
+      break;
+    m_free.pop_back();
+    ++m_inflight;
+  }
 }
 
 rte_mbuf*
 pipe::
-acquirePacket() const
+acquirePacket()
 {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  if (m_free.empty())
+    reap(m_packets.size());
+  if (m_free.empty())
     return nullptr;
-  //return m_device->get_xrt_device()->acquirePacket();
+
+  auto pkt = m_free.back();
+  m_free.pop_back();
+  pkt->data_len = static_cast<uint32_t>(m_packet_size);
+  return reinterpret_cast<rte_mbuf*>(pkt);
 }
 
-size_t
+void
 pipe::
-send(rte_mbuf** buf, size_t count) const
+releasePacket(rte_mbuf* buf)
 {
-    return 0;
-  //return m_device->get_xrt_device()->send(m_strm,buf,count);
+  // Read pipes post released packets on next recv
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_free.push_back(reinterpret_cast<packet*>(buf));
 }
 
 size_t
 pipe::
-recv(rte_mbuf** buf, size_t count) const
+send(rte_mbuf** buf, size_t count)
 {
+  if (!m_write)
     return 0;
-  //return m_device->get_xrt_device()->recv(m_strm,buf,count);
-}
 
-}} // xocl
+  std::lock_guard<std::mutex> lk(m_mutex);
+  auto xdevice = m_device->get_xrt_device();
+  size_t sent = 0;
+  for (; sent < count; ++sent) {
+    auto pkt = reinterpret_cast<packet*>(buf[sent]);
+    xrt::device::stream_xfer_req req = {0};
+    req.flags = CL_STREAM_EOT | CL_STREAM_NONBLOCKING;
+    req.priv_data = pkt;
+    if (xdevice->writeStream(m_strm, pkt->buf_addr, pkt->data_len, &req) <= 0)
+      break;
+    ++m_inflight;
+  }
+
+  // Recycle packets of earlier writes while here
+  reap(m_packets.size());
+  return sent;
+}
 
+size_t
+pipe::
+recv(rte_mbuf** buf, size_t count)
+{
+  if (m_write)
+    return 0;
 
+  std::lock_guard<std::mutex> lk(m_mutex);
+  post();
+  reap(m_packets.size());
 
+  size_t received = 0;
+  for (; received < count && !m_received.empty(); ++received) {
+    buf[received] = reinterpret_cast<rte_mbuf*>(m_received.front());
+    m_received.pop_front();
+  }
+  return received;
+}
 
+}} // xocl
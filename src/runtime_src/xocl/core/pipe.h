@@ -22,6 +22,10 @@
 
 #include "xrt/device/device.h"
 
+#include <deque>
+#include <mutex>
+#include <vector>
+
 namespace xocl {
 
 namespace pmd { class pipe; class notype;}
@@ -33,15 +37,35 @@ struct _cl_pipe : public xocl::object<xocl::pmd::pipe,_cl_pipe> {};
 namespace xocl { namespace pmd {
 
 /**
- * The pmd_pipe class is for Huawei only.
+ * Host pipe on a QDMA stream
+ *
+ * The packets of a pipe are carved from one stream buffer
+ * (xclAllocQDMABuf) and are handed to the application as rte_mbuf.
+ * The application fills or reads the packet data in place, packets
+ * are transferred by the stream queue without copies.
+ *
+ * A write pipe submits the packets passed to send() as one batch of
+ * non-blocking writes, a packet returns to the pool when its write
+ * completes.  A read pipe keeps its free packets posted as
+ * non-blocking reads, recv() returns the packets whose read completed
+ * and the application hands them back with releasePacket().
  */
-
 class pipe : public refcount, public _cl_pipe
 {
   using stream_handle = xrt::device::stream_handle;
+  using stream_buf_handle = xrt::device::stream_buf_handle;
+
+  // Packet handed out as rte_mbuf.  As with a DPDK rte_mbuf the
+  // first word is the address of the packet data, followed here by
+  // the length of the data
+  struct packet
+  {
+    void* buf_addr;
+    uint32_t data_len;
+  };
 
 public:
-  pipe(context* ctx, device* dev, cl_mem_flags flags, cl_uint max_packets, cl_pipe_attributes attributes);
+  pipe(context* ctx, device* dev, cl_mem_flags flags, cl_uint packet_size, cl_uint max_packets, cl_pipe_attributes attributes);
   virtual ~pipe();
 
   unsigned int
@@ -56,20 +80,62 @@ public:
     return m_device.get();
   }
 
+  /**
+   * @return
+   *   Packet from the pool or nullptr if all packets are in use
+   */
   rte_mbuf*
-  acquirePacket() const;
-
+  acquirePacket();
+
+  /**
+   * Return a packet to the pool
+   */
+  void
+  releasePacket(rte_mbuf* buf);
+
+  /**
+   * Submit packets to a write pipe
+   *
+   * @return
+   *   Number of packets submitted, the pipe owns them from here
+   */
   size_t
-  send(rte_mbuf** buf, size_t count) const;
-
+  send(rte_mbuf** buf, size_t count);
+
+  /**
+   * Receive packets from a read pipe
+   *
+   * @return
+   *   Number of packets received, the application owns them until
+   *   released
+   */
   size_t
-  recv(rte_mbuf** buf, size_t count) const;
+  recv(rte_mbuf** buf, size_t count);
 
 private:
+  // Collect completed transfers, caller holds lock
+  void
+  reap(size_t max);
+
+  // Post free packets as reads, caller holds lock
+  void
+  post();
+
   unsigned int m_uid = 0;
   ptr<context> m_context;
   ptr<xocl::device> m_device;
-  stream_handle m_strm;
+  bool m_write = false;
+  size_t m_packet_size = 0;
+  stream_handle m_strm = 0;
+  stream_buf_handle m_buf_handle = 0;
+  char* m_buf = nullptr;
+
+  std::vector<packet> m_packets;
+  std::vector<packet*> m_free;      // in pool
+  std::deque<packet*> m_received;   // read completed, not yet returned by recv
+  std::vector<xrt::device::stream_xfer_completions> m_comps;
+  size_t m_inflight = 0;
+  std::mutex m_mutex;
 };
 
 }} // pmd,xocl
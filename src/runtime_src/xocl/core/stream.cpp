@@ -17,6 +17,19 @@
 #include "stream.h"
 #include "device.h"
 
+#include <chrono>
+#include <thread>
+
+namespace {
+
+// With CL_STREAM_SHARDS_BY_SIZE, packets up to this size keep to shard 0
+const size_t shard_small_packet = 64 * 1024;
+
+// Sweep interval when polling several shards
+const std::chrono::microseconds shard_poll_interval(20);
+
+}
+
 namespace xocl { 
 
 stream::
@@ -34,21 +47,87 @@ stream::
 stream::get_stream(device* device)
 {
   m_device = device;
-  return device->get_stream(m_flags, m_attrs, m_ext, &m_handle, m_connidx);
+  return device->get_stream(m_flags, m_attrs, m_ext, m_handles, m_connidx);
+}
+
+stream::stream_handle
+stream::
+select_shard(size_t size, bool eot)
+{
+  auto shards = m_handles.size();
+  if (shards == 1)
+    return m_handles[0];
+
+  std::lock_guard<std::mutex> lk(m_mutex);
+  if (!m_in_packet) {
+    if (!m_flags.test(CL_STREAM_SHARDS_BY_SIZE))
+      m_current = m_next++ % shards;
+    else if (size <= shard_small_packet)
+      m_current = 0;
+    else
+      m_current = 1 + m_next++ % (shards - 1);
+  }
+  m_in_packet = !eot;
+  return m_handles[m_current];
 }
 
 ssize_t 
 stream
 ::read(void* ptr, size_t size, stream_xfer_req* req)
 {
-  return m_device->read_stream(m_handle, ptr, size, req);
+  return m_device->read_stream(m_handles[0], ptr, size, req);
 }
 
 ssize_t 
 stream
 ::write(const void* ptr, size_t size, stream_xfer_req* req)
 {
-  return m_device->write_stream(m_handle, ptr, size, req);
+  auto handle = select_shard(size, req->flags & CL_STREAM_EOT);
+  return m_device->write_stream(handle, ptr, size, req);
+}
+
+int
+stream::
+register_buffer(stream_mem* mem, size_t frame_size)
+{
+  int frames = 0;
+  for (auto handle : m_handles) {
+    frames = m_device->register_stream_buf(handle, mem->map(), frame_size);
+    if (frames < 0)
+      break;
+  }
+  return frames;
+}
+
+int
+stream::
+poll(xrt::device::stream_xfer_completions* comps, int min, int max, int* actual, int timeout)
+{
+  if (m_handles.size() == 1)
+    return m_device->poll_stream(m_handles[0], comps, min, max, actual, timeout);
+
+  // Merge completions of all shards, a queue cannot wait for completions
+  // of another, so sweep the shards without waiting until min completions
+  // or timeout
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+  *actual = 0;
+  while (true) {
+    for (auto handle : m_handles) {
+      if (*actual >= max)
+        break;
+      int num = 0;
+      int rc = m_device->poll_stream(handle, comps + *actual, 0, max - *actual, &num, 0);
+      if (rc < 0)
+        return rc;
+      *actual += num;
+    }
+    if (*actual >= min)
+      break;
+    if (timeout > 0 && std::chrono::steady_clock::now() >= deadline)
+      return -ETIMEDOUT;
+    std::this_thread::sleep_for(shard_poll_interval);
+  }
+  return 0;
 }
 
 int
@@ -56,7 +135,13 @@ stream::
 stream::close()
 {
   assert(m_connidx!=-1);
-  return m_device->close_stream(m_handle,m_connidx);
+  int rc = 0;
+  for (size_t i = 1; i < m_handles.size(); ++i)
+    if (int err = m_device->close_stream(m_handles[i]))
+      rc = err;
+  if (int err = m_device->close_stream(m_handles[0],m_connidx))
+    rc = err;
+  return rc;
 }
 
 
@@ -23,7 +23,12 @@
 
 #include "xrt/device/device.h"
 
+#include <mutex>
+#include <vector>
+
 namespace xocl {
+class stream_mem;
+
 //class stream for qdma and other streaming purposes.
 class stream : public _cl_stream // TODO: public refcount
 {  
@@ -40,13 +45,26 @@ private:
   stream_flags_type m_flags {0};
   stream_attributes_type m_attrs {0};
   cl_mem_ext_ptr_t* m_ext {nullptr};
-  stream_handle m_handle {0};
+  // One handle per hardware queue, see CL_STREAM_SHARDS
+  std::vector<stream_handle> m_handles;
   device* m_device {nullptr};
   int m_connidx = -1;
+
+  // Shard selection of writes, a packet does not span shards
+  std::mutex m_mutex;
+  size_t m_next = 0;
+  size_t m_current = 0;
+  bool m_in_packet = false;
+
+  stream_handle
+  select_shard(size_t size, bool eot);
 public:
   int get_stream(device* device); 
   ssize_t read(void* ptr, size_t size, stream_xfer_req* req );
   ssize_t write(const void* ptr, size_t size, stream_xfer_req* req);
+  int register_buffer(stream_mem* mem, size_t frame_size);
+  int poll(xrt::device::stream_xfer_completions* comps, int min, int max, int* actual, int timeout);
+  bool has_private_completions() const { return m_flags.test(CL_STREAM_PRIVATE_COMPLETIONS) || m_flags.test(CL_STREAM_BUSY_POLL); }
   int close();
 };
 
@@ -28,6 +28,8 @@
 
 #include <map>
 #include <limits>
+#include <memory>
+#include <mutex>
 #include <cassert>
 #include <cstdlib>
 #include <sstream>
@@ -779,6 +781,37 @@ public:
   }
 }; // metadata
 
+// Parsed metadata is shared by all xclbin objects created from a
+// binary with the same uuid, e.g. the per device xclbins of a
+// program or repeated clCreateProgramWithBinary of same binary.
+// Conformance mode renames kernels in the metadata and is excluded.
+static std::shared_ptr<metadata>
+get_metadata(const ::xclbin::binary& binary, const xocl::xclbin::uuid_type& uuid)
+{
+  static bool conformance = (std::getenv("XCL_CONFORMANCE")!=nullptr);
+  if (conformance || uuid_is_null(uuid.get()))
+    return std::make_shared<metadata>(binary.meta_data());
+
+  static std::mutex mutex;
+  static std::map<std::string,std::weak_ptr<metadata>> cache;
+  std::lock_guard<std::mutex> lk(mutex);
+  auto& entry = cache[uuid.to_string()];
+  if (auto md = entry.lock())
+    return md;
+
+  // Drop entries of xclbins no longer in use
+  for (auto itr=cache.begin(); itr!=cache.end(); ) {
+    if (itr->second.expired() && &itr->second!=&entry)
+      itr = cache.erase(itr);
+    else
+      ++itr;
+  }
+
+  auto md = std::make_shared<metadata>(binary.meta_data());
+  entry = md;
+  return md;
+}
+
 class xclbin_data_sections
 {
   const ::axlf* m_top                  = nullptr;
@@ -1010,54 +1043,54 @@ namespace xocl {
 struct xclbin::impl
 {
   binary_type m_binary;
-  metadata m_xml;
   xclbin_data_sections m_sections;
+  std::shared_ptr<metadata> m_xml;
 
   impl(std::vector<char>&& xb)
     : m_binary(std::move(xb))
-    , m_xml(m_binary.meta_data())
     , m_sections(m_binary)
+    , m_xml(get_metadata(m_binary,m_sections.uuid()))
   {}
 
   std::string
   project_name() const
-  { return m_xml.project_name(); }
+  { return m_xml->project_name(); }
 
   target_type
   target() const
-  { return m_xml.target(); }
+  { return m_xml->target(); }
 
   unsigned int
   num_kernels() const
-  { return m_xml.num_kernels(); }
+  { return m_xml->num_kernels(); }
 
   std::vector<std::string>
   kernel_names() const
-  { return m_xml.kernel_names(); }
+  { return m_xml->kernel_names(); }
 
   std::vector<const symbol*>
   kernel_symbols() const
-  { return m_xml.kernel_symbols(); }
+  { return m_xml->kernel_symbols(); }
 
   const symbol&
   lookup_kernel(const std::string& name) const
-  { return m_xml.lookup_kernel(name); }
+  { return m_xml->lookup_kernel(name); }
 
   system_clocks_type
   system_clocks() const
-  { return m_xml.system_clocks(); }
+  { return m_xml->system_clocks(); }
 
   kernel_clocks_type
   kernel_clocks() const
-  { return m_xml.kernel_clocks(); }
+  { return m_xml->kernel_clocks(); }
 
   profilers_type
   profilers() const
-  { return m_xml.profilers(); }
+  { return m_xml->profilers(); }
 
   std::vector<uint64_t>
   cu_base_address_map() const
-  { return m_xml.cu_base_address_map(); }
+  { return m_xml->cu_base_address_map(); }
 
   uuid_type
   uuid() const
@@ -1105,11 +1138,11 @@ struct xclbin::impl
 
   unsigned int
   conformance_rename_kernel(const std::string& hash)
-  { return m_xml.conformance_rename_kernel(hash); }
+  { return m_xml->conformance_rename_kernel(hash); }
 
   std::vector<std::string>
   conformance_kernel_hashes() const
-  { return m_xml.conformance_kernel_hashes(); }
+  { return m_xml->conformance_kernel_hashes(); }
 
 };
 
@@ -1,5 +1,5 @@
 /**
- * Copyright (C) 2016-2017 Xilinx, Inc
+ * Copyright (C) 2016-2019 Xilinx, Inc
  *
  * Licensed under the Apache License, Version 2.0 (the "License"). You may
  * not use this file except in compliance with the License. A copy of the
@@ -14,35 +14,418 @@
  * under the License.
  */
 
-#ifdef PMD_OCL_DISABLED
 #include "PMDOperations.h"
-#include "hal.h"
+#include "xrt/config.h"
+#include "xrt.h"
 
 #include <dlfcn.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+
+namespace {
+
+// Max packets per rx/tx burst
+const unsigned int burst_size = 32;
+
+using clock_type = std::chrono::steady_clock;
+
+// Transfer and poll timeouts are in ms, 0 is no timeout
+static clock_type::time_point
+deadline(uint32_t timeout)
+{
+  return timeout
+    ? clock_type::now() + std::chrono::milliseconds(timeout)
+    : clock_type::time_point::max();
+}
+
+static bool
+expired(clock_type::time_point deadline)
+{
+  return deadline != clock_type::time_point::max() && clock_type::now() >= deadline;
+}
+
+static std::vector<std::string>
+split(const std::string& args)
+{
+  std::vector<std::string> vec;
+  std::istringstream istr(args);
+  std::string arg;
+  while (istr >> arg)
+    vec.push_back(arg);
+  return vec;
+}
+
+template <typename FuncType>
+static FuncType
+resolve(void* handle, const char* sym)
+{
+  auto func = reinterpret_cast<FuncType>(dlsym(handle,sym));
+  if (!func)
+    throw std::runtime_error(std::string("PMD library is missing symbol '") + sym + "'");
+  return func;
+}
+
+static unsigned int s_port_count = 0;
+
+}
 
 namespace xrt { namespace pmd {
-    PMDOperations::PMDOperations(const std::string &dll, void *handle) : dllHandle(handle)
-    {
-      //      dllHandle = dlopen(dll.c_str(), RTLD_LAZY | RTLD_GLOBAL);
-      //if (!dllHandle)
-      //  throw std::runtime_error("Failed to open DPDK library '" + dll + "'");
-
-//      probeFunc = (probeFuncType)dlsym(dllHandle, "pmdProbe");
-//      openFunc = (openFuncType)dlsym(dllHandle, "pmdOpen");
-//      openStreamFunc = (openStreamFuncType)dlsym(dllHandle, "pmdOpenStream");
-//      closeStreamFunc = (closeStreamFuncType)dlsym(dllHandle, "pmdCloseStream");
-//      sendPktsFunc = (sendPktsFuncType)dlsym(dllHandle, "pmdSendPkts");
-//      recvPktsFunc = (recvPktsFuncType)dlsym(dllHandle, "pmdRecvPkts");
-//      acquirePacketFunc = (acquirePktFuncType)dlsym(dllHandle, "pmdAcquirePkts");
-//      releasePacketFunc = (releasePktFuncType)dlsym(dllHandle, "pmdReleasePkts");
-//      infoFunc = (infoFuncType)dlsym(dllHandle, "pmdGetDeviceInfo");
+
+PMDOperations::
+PMDOperations(const std::string& dll)
+{
+  dllHandle = dlopen(dll.c_str(), RTLD_LAZY | RTLD_GLOBAL);
+  if (!dllHandle)
+    throw std::runtime_error("Failed to open DPDK library '" + dll + "'\n" + dlerror());
+
+  try {
+    probeFunc = resolve<probeFuncType>(dllHandle, "pmdProbe");
+    openFunc = resolve<openFuncType>(dllHandle, "pmdOpen");
+    closeFunc = resolve<closeFuncType>(dllHandle, "pmdClose");
+    openStreamFunc = resolve<openStreamFuncType>(dllHandle, "pmdOpenStream");
+    closeStreamFunc = resolve<closeStreamFuncType>(dllHandle, "pmdCloseStream");
+    sendPktsFunc = resolve<burstFuncType>(dllHandle, "pmdSendPkts");
+    recvPktsFunc = resolve<burstFuncType>(dllHandle, "pmdRecvPkts");
+    acquirePacketsFunc = resolve<acquirePktsFuncType>(dllHandle, "pmdAcquirePkts");
+    releasePacketsFunc = resolve<releasePktsFuncType>(dllHandle, "pmdReleasePkts");
+    pktDataFunc = resolve<pktDataFuncType>(dllHandle, "pmdPktData");
+    pktLenFunc = resolve<pktLenFuncType>(dllHandle, "pmdPktLen");
+    pktSetLenFunc = resolve<pktSetLenFuncType>(dllHandle, "pmdPktSetLen");
+    pktRoomFunc = resolve<pktLenFuncType>(dllHandle, "pmdPktRoom");
+  }
+  catch (...) {
+    dlclose(dllHandle);
+    throw;
+  }
+}
+
+PMDOperations::
+~PMDOperations()
+{
+  dlclose(dllHandle);
+}
+
+PMDOperations*
+get_operations()
+{
+  static std::unique_ptr<PMDOperations> ops = []() {
+    std::unique_ptr<PMDOperations> ops;
+    auto dll = xrt::config::get_pmd_library();
+    if (dll.empty())
+      return ops;
+
+    ops.reset(new PMDOperations(dll));
+    auto args = split(xrt::config::get_pmd_eal_args());
+    args.insert(args.begin(),"xrt");
+    std::vector<char*> argv;
+    for (auto& arg : args)
+      argv.push_back(&arg[0]);
+    argv.push_back(nullptr);
+
+    auto count = ops->probe(static_cast<int>(args.size()),argv.data());
+    if (count == 0xFFFFFFFF)
+      throw std::runtime_error("PMD EAL initialization failed with args '" + xrt::config::get_pmd_eal_args() + "'");
+    s_port_count = count;
+    return ops;
+  }();
+  return ops.get();
+}
+
+unsigned int
+get_port_count()
+{
+  return get_operations() ? s_port_count : 0;
+}
+
+struct port::queue
+{
+  // Read posted with XCL_QUEUE_REQ_NONBLOCKING
+  struct pending_read
+  {
+    char* ptr;
+    size_t size;
+    void* priv_data;
+  };
+
+  unsigned dir;
+  StreamHandle id;
+  std::mutex mutex;
+  unsigned int room = 0;                       // data room of a packet, 0 until known
+  std::deque<PacketObject> rx;                 // received and not yet read
+  size_t rx_offset = 0;                        // bytes of rx.front() already read
+  std::deque<pending_read> reads;
+  std::deque<streams_poll_req_completions> completions;
+
+  queue(unsigned d, StreamHandle i) : dir(d), id(i) {}
+};
+
+port::
+port(PMDOperations* ops, unsigned int idx)
+  : m_ops(ops), m_idx(idx)
+{
+  auto queues = xrt::config::get_pmd_queues();
+  auto err = m_ops->openPort(m_idx, queues, queues, xrt::config::get_pmd_queue_depth());
+  if (err)
+    throw std::runtime_error("Failed to open PMD port " + std::to_string(m_idx) + " err=" + std::to_string(err));
+  m_queues.resize(2 * queues);
+}
+
+port::
+~port()
+{
+  for (auto& q : m_queues) {
+    if (!q)
+      continue;
+    for (auto pkt : q->rx)
+      m_ops->releasePackets(m_idx, &pkt, 1);
+    m_ops->closeStream(m_idx, q->id, q->dir);
+  }
+  m_ops->closePort(m_idx);
+}
+
+port::queue*
+port::
+get_queue(handle_type handle)
+{
+  auto idx = (handle >> 16 & 1) * (m_queues.size() / 2) + (handle & 0xFFFF);
+  std::lock_guard<std::mutex> lk(m_mutex);
+  return idx < m_queues.size() ? m_queues[idx].get() : nullptr;
+}
+
+int
+port::
+openStream(unsigned dir, handle_type* handle)
+{
+  std::lock_guard<std::mutex> lk(m_mutex);
+  auto id = m_ops->openStream(m_idx, dir);
+  if (id == PMD_INVALID_STREAM)
+    return -EBUSY;
+  auto idx = dir * (m_queues.size() / 2) + id;
+  m_queues[idx].reset(new queue(dir, id));
+  *handle = (static_cast<handle_type>(dir) << 16) | id;
+  return 0;
+}
+
+int
+port::
+closeStream(handle_type handle)
+{
+  auto q = get_queue(handle);
+  if (!q)
+    return -EINVAL;
+
+  std::lock_guard<std::mutex> lk(m_mutex);
+  for (auto pkt : q->rx)
+    m_ops->releasePackets(m_idx, &pkt, 1);
+  m_ops->closeStream(m_idx, q->id, q->dir);
+  m_queues[(handle >> 16 & 1) * (m_queues.size() / 2) + (handle & 0xFFFF)].reset();
+  return 0;
+}
+
+size_t
+port::
+send(queue* q, const char* ptr, size_t size, uint32_t timeout)
+{
+  auto until = deadline(timeout);
+  size_t sent = 0;
+  while (sent < size) {
+    // Size the burst by the packet room, learned from the first packet
+    auto remaining = size - sent;
+    auto count = q->room
+      ? static_cast<unsigned int>(std::min<size_t>(burst_size, (remaining + q->room - 1) / q->room))
+      : 1;
+
+    PacketObject pkts[burst_size];
+    while (m_ops->acquirePackets(m_idx, pkts, count)) {
+      // pool is empty until the NIC has transmitted earlier packets
+      if (expired(until))
+        throw std::system_error(ETIMEDOUT, std::generic_category());
+    }
+
+    size_t filled = 0;
+    for (unsigned int i = 0; i < count; ++i) {
+      q->room = m_ops->room(pkts[i]);
+      auto len = std::min<size_t>(q->room, remaining - filled);
+      std::memcpy(m_ops->data(pkts[i]), ptr + sent + filled, len);
+      m_ops->setLength(pkts[i], static_cast<unsigned int>(len));
+      filled += len;
+    }
+
+    unsigned int tx = 0;
+    while (tx < count) {
+      tx += m_ops->send(m_idx, q->id, pkts + tx, count - tx);
+      if (tx < count && expired(until)) {
+        m_ops->releasePackets(m_idx, pkts + tx, count - tx);
+        throw std::system_error(ETIMEDOUT, std::generic_category());
+      }
     }
+    sent += filled;
+  }
+  return sent;
+}
+
+size_t
+port::
+recv(queue* q, char* ptr, size_t size, bool wait, uint32_t timeout)
+{
+  auto until = deadline(timeout);
+  while (q->rx.empty()) {
+    PacketObject pkts[burst_size];
+    auto count = m_ops->recv(m_idx, q->id, pkts, burst_size);
+    q->rx.insert(q->rx.end(), pkts, pkts + count);
+    if (count || !wait)
+      break;
+    if (expired(until))
+      throw std::system_error(ETIMEDOUT, std::generic_category());
+  }
+
+  if (q->rx.empty())
+    return 0;
+
+  // A transfer ends at the end of a packet
+  auto pkt = q->rx.front();
+  auto len = std::min<size_t>(m_ops->length(pkt) - q->rx_offset, size);
+  std::memcpy(ptr, static_cast<char*>(m_ops->data(pkt)) + q->rx_offset, len);
+  q->rx_offset += len;
+  if (q->rx_offset == m_ops->length(pkt)) {
+    m_ops->releasePackets(m_idx, &pkt, 1);
+    q->rx.pop_front();
+    q->rx_offset = 0;
+  }
+  return len;
+}
 
-    PMDOperations::~PMDOperations()
+ssize_t
+port::
+write(handle_type handle, const void* ptr, size_t size, stream_xfer_req* req)
+{
+  auto q = get_queue(handle);
+  if (!q || q->dir != 0)
+    return -EINVAL;
+
+  std::lock_guard<std::mutex> lk(q->mutex);
+  try {
+    auto sent = send(q, static_cast<const char*>(ptr), size, req->timeout);
+    // Data is in packet buffers, so a non blocking write is complete
+    // once sent and is reported by the next poll
+    if (req->flags & XCL_QUEUE_REQ_NONBLOCKING) {
+      streams_poll_req_completions cmpl = {};
+      cmpl.priv_data = req->priv_data;
+      cmpl.nbytes = sent;
+      q->completions.push_back(cmpl);
+    }
+    return sent;
+  }
+  catch (const std::system_error& ex) {
+    return -ex.code().value();
+  }
+}
+
+ssize_t
+port::
+read(handle_type handle, void* ptr, size_t size, stream_xfer_req* req)
+{
+  auto q = get_queue(handle);
+  if (!q || q->dir != 1)
+    return -EINVAL;
+
+  std::lock_guard<std::mutex> lk(q->mutex);
+  if (req->flags & XCL_QUEUE_REQ_NONBLOCKING) {
+    q->reads.push_back({static_cast<char*>(ptr), size, req->priv_data});
+    return 0;
+  }
+
+  try {
+    // Earlier non blocking reads get the data first
+    while (!q->reads.empty()) {
+      auto& rd = q->reads.front();
+      streams_poll_req_completions cmpl = {};
+      cmpl.priv_data = rd.priv_data;
+      cmpl.nbytes = recv(q, rd.ptr, rd.size, true, req->timeout);
+      q->completions.push_back(cmpl);
+      q->reads.pop_front();
+    }
+    return recv(q, static_cast<char*>(ptr), size, true, req->timeout);
+  }
+  catch (const std::system_error& ex) {
+    return -ex.code().value();
+  }
+}
+
+int
+port::
+progress(queue* q, streams_poll_req_completions* comps, int max)
+{
+  while (!q->reads.empty()) {
+    auto& rd = q->reads.front();
+    auto len = recv(q, rd.ptr, rd.size, false, 0);
+    if (!len)
+      break;
+    streams_poll_req_completions cmpl = {};
+    cmpl.priv_data = rd.priv_data;
+    cmpl.nbytes = len;
+    q->completions.push_back(cmpl);
+    q->reads.pop_front();
+  }
+
+  int count = 0;
+  while (count < max && !q->completions.empty()) {
+    comps[count++] = q->completions.front();
+    q->completions.pop_front();
+  }
+  return count;
+}
+
+int
+port::
+poll(handle_type handle, streams_poll_req_completions* comps, int min, int max, int* actual, int timeout)
+{
+  auto q = get_queue(handle);
+  if (!q)
+    return -EINVAL;
+
+  auto until = deadline(timeout > 0 ? timeout : 0);
+  *actual = 0;
+  while (true) {
     {
-      //      dlclose(dllHandle);
+      std::lock_guard<std::mutex> lk(q->mutex);
+      *actual += progress(q, comps + *actual, max - *actual);
     }
-}};
-#endif
+    if (*actual >= min)
+      return 0;
+    if (expired(until))
+      return -ETIMEDOUT;
+  }
+}
 
+int
+port::
+pollAll(streams_poll_req_completions* comps, int min, int max, int* actual, int timeout)
+{
+  auto until = deadline(timeout > 0 ? timeout : 0);
+  *actual = 0;
+  while (true) {
+    for (size_t idx = 0; idx < m_queues.size() && *actual < max; ++idx) {
+      queue* q = nullptr;
+      {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        q = m_queues[idx].get();
+      }
+      if (!q)
+        continue;
+      std::lock_guard<std::mutex> lk(q->mutex);
+      *actual += progress(q, comps + *actual, max - *actual);
+    }
+    if (*actual >= min)
+      return 0;
+    if (expired(until))
+      return -ETIMEDOUT;
+  }
+}
 
+}} // pmd,xrt
@@ -1,5 +1,5 @@
 /**
- * Copyright (C) 2016-2017 Xilinx, Inc
+ * Copyright (C) 2016-2019 Xilinx, Inc
  *
  * Licensed under the Apache License, Version 2.0 (the "License"). You may
  * not use this file except in compliance with the License. A copy of the
@@ -18,72 +18,213 @@
 #define xrt_device_pmd_operations_h_
 
 #include "pmdhal.h"
+#include "stream.h"
 
-#ifdef PMD_OCL_DISABLED
-#include "xclhal.h"
+#include <sys/types.h>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 namespace xrt { namespace pmd {
-  class PMDOperations {
-  public:
-    PMDOperations(const std::string &dll, void *handle);
-    ~PMDOperations();
-
-  public:
-//    unsigned probe(int argc, char *argv[]) {
-//      return probeFunc(argc, argv);
-//    }
-//    unsigned openPort(unsigned port) {
-//      return openFunc(port);
-//    }
-//    unsigned getPortInfo(unsigned port, xclDeviceInfo *info) {
-//      return infoFunc(port, info);
-//    }
-//    StreamHandle openStream(unsigned port, unsigned q, unsigned depth, unsigned dir) {
-//      return openStreamFunc(port, q, depth, dir);
-//    }
-//    void closeStream(unsigned port, StreamHandle strm) {
-//      closeStreamFunc(port, strm);
-//    }
-//    unsigned send(unsigned port, StreamHandle strm, PacketObject *pkts, unsigned count) {
-//      return sendPktsFunc(port, strm, pkts, count);
-//    }
-//    unsigned recv(unsigned port, StreamHandle strm, PacketObject *pkts, unsigned count) {
-//      return recvPktsFunc(port, strm, pkts, count);
-//    }
-//    PacketObject acquirePacket(unsigned port) {
-//      return acquirePacketFunc(port);
-//    }
-//    void releasePacket(unsigned port, PacketObject pkt) {
-//      return releasePacketFunc(port, pkt);
-//    }
-
-  private:
-//    typedef unsigned (* probeFuncType)(int argc, char *argv[]);
-//    typedef unsigned (* openFuncType)(unsigned port);
-//    typedef StreamHandle (* openStreamFuncType)(unsigned port, unsigned q, unsigned depth, unsigned dir);
-//    typedef void (* closeStreamFuncType)(unsigned port, StreamHandle strm);
-//    typedef unsigned (* sendPktsFuncType)(unsigned port, StreamHandle strm, PacketObject *pkts, unsigned count);
-//    typedef unsigned (* recvPktsFuncType)(unsigned port, StreamHandle strm, PacketObject *pkts, unsigned count);
-//    typedef PacketObject (* acquirePktFuncType)(unsigned port);
-//    typedef void (* releasePktFuncType)(unsigned port, PacketObject pkt);
-//    typedef unsigned (* infoFuncType)(unsigned port, xclDeviceInfo *info);
-
-  private:
-//    probeFuncType probeFunc;
-//    openFuncType openFunc;
-//    infoFuncType infoFunc;
-//    openStreamFuncType openStreamFunc;
-//    closeStreamFuncType closeStreamFunc;
-//    sendPktsFuncType sendPktsFunc;
-//    recvPktsFuncType recvPktsFunc;
-//    acquirePktFuncType acquirePacketFunc;
-//    releasePktFuncType releasePacketFunc;
-    void *dllHandle;
-  };
-}};
 
-#endif
-#endif
+/**
+ * Entry points of the poll mode driver library (pmd.so built from
+ * xrt/pmd/pmdhal.c).  XRT does not link with DPDK, the library is
+ * opened at runtime and every symbol must be present.
+ */
+class PMDOperations
+{
+public:
+  explicit
+  PMDOperations(const std::string& dll);
+  ~PMDOperations();
+
+  unsigned
+  probe(int argc, char* argv[])
+  {
+    return probeFunc(argc, argv);
+  }
+
+  int
+  openPort(unsigned port, unsigned rxq, unsigned txq, unsigned depth)
+  {
+    return openFunc(port, rxq, txq, depth);
+  }
+
+  void
+  closePort(unsigned port)
+  {
+    closeFunc(port);
+  }
+
+  StreamHandle
+  openStream(unsigned port, unsigned dir)
+  {
+    return openStreamFunc(port, dir);
+  }
+
+  void
+  closeStream(unsigned port, StreamHandle strm, unsigned dir)
+  {
+    closeStreamFunc(port, strm, dir);
+  }
+
+  unsigned
+  send(unsigned port, StreamHandle strm, PacketObject* pkts, unsigned count)
+  {
+    return sendPktsFunc(port, strm, pkts, count);
+  }
+
+  unsigned
+  recv(unsigned port, StreamHandle strm, PacketObject* pkts, unsigned count)
+  {
+    return recvPktsFunc(port, strm, pkts, count);
+  }
+
+  int
+  acquirePackets(unsigned port, PacketObject* pkts, unsigned count)
+  {
+    return acquirePacketsFunc(port, pkts, count);
+  }
+
+  void
+  releasePackets(unsigned port, PacketObject* pkts, unsigned count)
+  {
+    releasePacketsFunc(port, pkts, count);
+  }
+
+  void*
+  data(PacketObject pkt) const
+  {
+    return pktDataFunc(pkt);
+  }
+
+  unsigned
+  length(PacketObject pkt) const
+  {
+    return pktLenFunc(pkt);
+  }
+
+  void
+  setLength(PacketObject pkt, unsigned len)
+  {
+    pktSetLenFunc(pkt, len);
+  }
+
+  unsigned
+  room(PacketObject pkt) const
+  {
+    return pktRoomFunc(pkt);
+  }
+
+private:
+  typedef unsigned (* probeFuncType)(int argc, char *argv[]);
+  typedef int (* openFuncType)(unsigned port, unsigned rxq, unsigned txq, unsigned depth);
+  typedef void (* closeFuncType)(unsigned port);
+  typedef StreamHandle (* openStreamFuncType)(unsigned port, unsigned dir);
+  typedef void (* closeStreamFuncType)(unsigned port, StreamHandle strm, unsigned dir);
+  typedef unsigned (* burstFuncType)(unsigned port, StreamHandle strm, PacketObject *pkts, unsigned count);
+  typedef int (* acquirePktsFuncType)(unsigned port, PacketObject *pkts, unsigned count);
+  typedef void (* releasePktsFuncType)(unsigned port, PacketObject *pkts, unsigned count);
+  typedef void* (* pktDataFuncType)(PacketObject pkt);
+  typedef unsigned (* pktLenFuncType)(PacketObject pkt);
+  typedef void (* pktSetLenFuncType)(PacketObject pkt, unsigned len);
+
+  probeFuncType probeFunc;
+  openFuncType openFunc;
+  closeFuncType closeFunc;
+  openStreamFuncType openStreamFunc;
+  closeStreamFuncType closeStreamFunc;
+  burstFuncType sendPktsFunc;
+  burstFuncType recvPktsFunc;
+  acquirePktsFuncType acquirePacketsFunc;
+  releasePktsFuncType releasePacketsFunc;
+  pktDataFuncType pktDataFunc;
+  pktLenFuncType pktLenFunc;
+  pktSetLenFuncType pktSetLenFunc;
+  pktLenFuncType pktRoomFunc;
+  void *dllHandle;
+};
+
+/**
+ * Process wide PMD library per Runtime.pmd_library
+ *
+ * The library is opened and EAL is initialized with
+ * Runtime.pmd_eal_args on first call.
+ *
+ * @return nullptr if no library is configured
+ */
+PMDOperations*
+get_operations();
+
+/**
+ * Number of ports found by EAL init, 0 if no library is configured
+ */
+unsigned int
+get_port_count();
+
+/**
+ * Streams of one PMD port
+ *
+ * Provides the hal stream semantics on top of packet bursts.  A
+ * write copies the host buffer into as few packets as fit the data
+ * and bursts them to the transmit queue, a read bursts from the
+ * receive queue and copies out one packet per transfer, keeping any
+ * remainder staged for the next read.  Non blocking transfers are
+ * progressed and completed by poll.  All transfers are busy polled
+ * by the calling thread, there is no interrupt path.
+ *
+ * Stream handles encode the queue id and direction.
+ */
+class port
+{
+public:
+  using handle_type = uint64_t;
+
+  port(PMDOperations* ops, unsigned int idx);
+  ~port();
+
+  int
+  openStream(unsigned dir, handle_type* handle);
+
+  int
+  closeStream(handle_type handle);
 
+  ssize_t
+  write(handle_type handle, const void* ptr, size_t size, stream_xfer_req* req);
 
+  ssize_t
+  read(handle_type handle, void* ptr, size_t size, stream_xfer_req* req);
+
+  int
+  poll(handle_type handle, streams_poll_req_completions* comps, int min, int max, int* actual, int timeout);
+
+  int
+  pollAll(streams_poll_req_completions* comps, int min, int max, int* actual, int timeout);
+
+private:
+  struct queue;
+
+  queue*
+  get_queue(handle_type handle);
+
+  size_t
+  send(queue* q, const char* ptr, size_t size, uint32_t timeout);
+
+  size_t
+  recv(queue* q, char* ptr, size_t size, bool wait, uint32_t timeout);
+
+  int
+  progress(queue* q, streams_poll_req_completions* comps, int max);
+
+  PMDOperations* m_ops;
+  unsigned int m_idx;
+  std::mutex m_mutex;
+  std::vector<std::unique_ptr<queue>> m_queues;
+};
+
+}} // pmd,xrt
+
+#endif
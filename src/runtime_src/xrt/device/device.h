@@ -306,6 +306,19 @@ public:
                 ,size_t sz, size_t dst_offset, size_t src_offset,ert_start_copybo_cmd* pkt)
   { return m_hal->fill_copy_pkt(dst_bo,src_bo,sz,dst_offset,src_offset,pkt); }
 
+  /**
+   * Copy from a buffer object owned by a peer device into a buffer
+   * object owned by this device.  One of the buffer objects must be
+   * a P2P buffer object.
+   *
+   * @return
+   *   Invalid result if hal does not support card to card copy,
+   *   otherwise 0 on success or standard errno
+   */
+  hal::operations_result<int>
+  copy_peer(const BufferObjectHandle& dst_bo, const BufferObjectHandle& src_bo, size_t sz, size_t dst_offset, size_t src_offset)
+  { return m_hal->copy_peer(dst_bo,src_bo,sz,dst_offset,src_offset); }
+
   /**
    * Read a device register
    *
@@ -389,10 +402,34 @@ public:
   exec_buf(const ExecBufferObjectHandle& bo)
   { return m_hal->exec_buf(bo); }
 
+  /**
+   * Submit several exec buffers with as few driver calls as possible
+   *
+   * @returns
+   *   Number of exec buffers submitted, in order from first
+   */
+  size_t
+  exec_bufs(const std::vector<ExecBufferObjectHandle>& bos)
+  { return m_hal->exec_bufs(bos); }
+
   int
   exec_wait(int timeout_ms) const
   { return m_hal->exec_wait(timeout_ms); }
 
+  /**
+   * Retrieve handles of exec buffers completed since last call.
+   *
+   * @returns
+   *   Number of handles, -1 if not supported by device
+   */
+  int
+  exec_done(std::vector<unsigned int>& handles, bool& overflow) const
+  { return m_hal->exec_done(handles,overflow); }
+
+  unsigned int
+  get_exec_buf_handle(const ExecBufferObjectHandle& bo) const
+  { return m_hal->get_exec_buf_handle(bo); }
+
 public:
   /**
    * @returns
@@ -541,6 +578,18 @@ public:
     return m_hal->pollStreams(comps, min,max,actual,timeout);
   };
 
+  int
+  registerStreamBuf(hal::StreamHandle stream, hal::StreamBuf buf, size_t frame_size)
+  {
+    return m_hal->registerStreamBuf(stream, buf, frame_size);
+  };
+
+  int
+  pollStream(hal::StreamHandle stream, hal::StreamXferCompletions* comps, int min, int max, int* actual, int timeout)
+  {
+    return m_hal->pollStream(stream, comps, min,max,actual,timeout);
+  };
+
 //End Streaming APIs
 #ifdef PMD_OCL
 public:
@@ -744,6 +793,18 @@ public:
     return m_hal->countTrace(type);
   }
 
+  /**
+   * Raw HAL handle, for profiling code that drives debug IPs and
+   * buffers itself (device trace offload)
+   *
+   * Return: nullptr if the HAL has no handle
+   */
+  void*
+  getHalDeviceHandle()
+  {
+    return m_hal->getHalDeviceHandle();
+  }
+
   hal::operations_result<double>
   getDeviceClock()
   {
@@ -29,6 +29,7 @@
 #include "ert.h"
 
 #include <memory>
+#include <cerrno>
 #include <string>
 #include <vector>
 #include <thread>
@@ -61,7 +62,10 @@ enum class queue_type : unsigned short
   read=0 // queue used for DMA read  (device2host)
  ,write  // queue used for DMA write (host2device)
  ,misc   // queue used for non misc work (no actual hal)
- ,max=3
+ ,read_high  // latency class DMA read, served ahead of bulk reads
+ ,write_high // latency class DMA write, served ahead of bulk writes
+ ,misc_high  // short or latency class misc work, not behind bulk misc work
+ ,max=6
 };
 
 //typedef rte_mbuf * PacketObject;
@@ -249,6 +253,20 @@ public:
   fill_copy_pkt(const BufferObjectHandle& dst_boh, const BufferObjectHandle& src_boh
                 ,size_t sz, size_t dst_offset, size_t src_offset,ert_start_copybo_cmd* pkt) = 0;
 
+  /**
+   * Copy from a buffer object owned by another device of the same
+   * hal into a buffer object owned by this device.
+   *
+   * Invalid result if not supported by the hal, otherwise 0 on success
+   * or standard errno (-EOPNOTSUPP if neither bo is a P2P bo)
+   */
+  virtual operations_result<int>
+  copy_peer(const BufferObjectHandle& dst_bo, const BufferObjectHandle& src_bo, size_t sz,
+            size_t dst_offset, size_t src_offset)
+  {
+    return operations_result<int>(); // invalid result
+  }
+
   virtual size_t
   read_register(size_t offset, void* buffer, size_t size) = 0;
 
@@ -273,12 +291,52 @@ public:
     throw std::runtime_error("exec_buf not supported");
   }
 
+  /**
+   * Submit several exec buffers in order
+   *
+   * @returns
+   *   Number of exec buffers submitted.  Throws if none could be
+   *   submitted.
+   */
+  virtual size_t
+  exec_bufs(const std::vector<ExecBufferObjectHandle>& bos)
+  {
+    for (auto& bo : bos)
+      exec_buf(bo);
+    return bos.size();
+  }
+
   virtual int
   exec_wait(int timeout_ms) const
   {
     throw std::runtime_error("exec_wait not supported");
   }
 
+  /**
+   * Retrieve handles of exec buffers that completed since last call
+   *
+   * @handles: cleared and filled with completed exec buffer handles
+   * @overflow: set to true if completions were lost, in which
+   *   case caller must check all outstanding exec buffers
+   * @returns
+   *   Number of handles retrieved, or -1 if not supported
+   */
+  virtual int
+  exec_done(std::vector<unsigned int>& handles, bool& overflow) const
+  {
+    return -1;
+  }
+
+  /**
+   * @returns
+   *   Handle of exec buffer as reported by exec_done()
+   */
+  virtual unsigned int
+  get_exec_buf_handle(const ExecBufferObjectHandle& bo) const
+  {
+    throw std::runtime_error("get_exec_buf_handle not supported");
+  }
+
 public:
   virtual int
   createWriteStream(StreamFlags flags, hal::StreamAttributes attr, uint64_t route, uint64_t flow, hal::StreamHandle *stream) = 0;
@@ -304,6 +362,30 @@ public:
   virtual int
   pollStreams(StreamXferCompletions* comps, int min, int max, int* actual, int timeout) = 0;
 
+  /**
+   * Register a buffer from allocStreamBuf() as frames of stream
+   *
+   * @returns
+   *   Number of frames, or negative error code.  Transfers with
+   *   XCL_QUEUE_REQ_FRAME pass a frame index instead of a pointer,
+   *   reads with XCL_QUEUE_REQ_AGGR also land several packets in it.
+   */
+  virtual int
+  registerStreamBuf(hal::StreamHandle stream, hal::StreamBuf buf, size_t frame_size)
+  {
+    return -ENOSYS;
+  }
+
+  /**
+   * Poll completions of one stream created with a private completion
+   * context (XRT_QUEUE_FLAG_PRIVATE_COMPL)
+   */
+  virtual int
+  pollStream(hal::StreamHandle stream, StreamXferCompletions* comps, int min, int max, int* actual, int timeout)
+  {
+    return -ENOSYS;
+  }
+
 public:
   /**
    * @returns
@@ -16,19 +16,112 @@
 
 #include "hal2.h"
 #include "xrt/util/thread.h"
+#include "xrt/util/memcpy.h"
 #include "ert.h"
 
+#include <chrono>
 #include <cstring> // for std::memcpy
 #include <iostream>
+#include <fstream>
 #include <cerrno>
 #include <sys/mman.h> // for POSIX munmap
 
+namespace {
+
+// Set for worker threads of the latency class queues
+static thread_local bool t_latency_class = false;
+
+// Asynchronous host copies below this size are short misc tasks
+const size_t short_copy_size = 1 << 20;
+
+static xrt::hal::queue_type
+misc_queue(size_t sz)
+{
+  return sz < short_copy_size ? xrt::hal::queue_type::misc_high : xrt::hal::queue_type::misc;
+}
+
+static void
+latency_worker(xrt::task::queue& q, const std::string& id)
+{
+  t_latency_class = true;
+  xrt::task::worker2(q,id);
+}
+
+// Event for asynchronous sync bo, waits on driver fence.  The fence
+// is retired when the event is waited on or destroyed.
+class sync_fence_event
+{
+  struct state
+  {
+    xrt::hal2::operations* ops = nullptr;
+    xclDeviceHandle handle = nullptr;
+    uint64_t fence = 0;
+    bool done = false;
+    int status = 0;
+
+    bool
+    poll(int timeout)
+    {
+      if (done)
+        return true;
+      auto ret = ops->mSyncBOWait(handle,fence,timeout);
+      if (ret == -ETIMEDOUT || ret == -EINTR)
+        return false;
+      status = ret;
+      done = true;
+      return true;
+    }
+
+    ~state()
+    {
+      poll(-1);
+    }
+  };
+
+  std::unique_ptr<state> m_state;
+
+public:
+  using value_type = int;
+
+  sync_fence_event(xrt::hal2::operations* ops, xclDeviceHandle handle, uint64_t fence)
+    : m_state(std::make_unique<state>())
+  {
+    m_state->ops = ops;
+    m_state->handle = handle;
+    m_state->fence = fence;
+  }
+
+  int
+  wait() const
+  {
+    while (!m_state->poll(-1)) ;
+    return m_state->status;
+  }
+
+  bool
+  ready() const
+  {
+    return m_state->poll(0);
+  }
+};
+
+}
+
 namespace xrt { namespace hal2 {
 
 device::
 device(std::shared_ptr<operations> ops, unsigned int idx)
   : m_ops(std::move(ops)), m_idx(idx), m_handle(nullptr), m_devinfo{}
 {
+  if (config::get_task_queue_lockfree())
+    for (auto& q : m_queue)
+      q.enable_lockfree(config::get_task_queue_capacity());
+
+  if (auto mb = config::get_bo_pool_size()) {
+    auto destroy = [this](PooledBufferObject& pbo) { destroyPooledBufferObject(pbo); };
+    m_bo_pool = std::make_unique<bo_pool_type>
+      (static_cast<size_t>(mb)<<20,std::chrono::milliseconds(config::get_bo_pool_idle()),destroy);
+  }
 }
 
 device::
@@ -37,6 +130,8 @@ device::
   close();
   for (auto& q : m_queue)
     q.stop();
+  for (auto& q : m_channel_queues)
+    q->stop();
   for (auto& t : m_workers)
     t.join();
 }
@@ -88,14 +183,104 @@ setup()
   if (!threads) // Guard against drivers who do not set m_devinfo.mDMAThreads
     threads = 2;
 
+  // One read and one write queue per channel, first channel uses
+  // the default queues
+  auto add_channel_queue = [this](std::vector<task::queue*>& queues, hal::queue_type qt) {
+    if (queues.empty()) {
+      queues.push_back(&m_queue[static_cast<qtype>(qt)]);
+      return;
+    }
+    m_channel_queues.emplace_back(std::make_unique<task::queue>());
+    if (config::get_task_queue_lockfree())
+      m_channel_queues.back()->enable_lockfree(config::get_task_queue_capacity());
+    queues.push_back(m_channel_queues.back().get());
+  };
+
+  auto node = (config::get_dma_thread_affinity()=="numa") ? getNumaNode() : -1;
+  auto add_worker = [this,node](task::queue& q, const char* id) {
+    m_workers.emplace_back(xrt::thread(task::worker2,std::ref(q),id));
+    if (node >= 0 && !xrt::set_numa_affinity(m_workers.back(),node))
+      XRT_DEBUG(std::cout,"Failed to pin DMA worker to numa node #",node,"\n");
+  };
+
   XRT_DEBUG(std::cout,"Creating ",2*threads," DMA worker threads\n");
   for (unsigned int i=0; i<threads; ++i) {
+    add_channel_queue(m_read_queues,hal::queue_type::read);
+    add_channel_queue(m_write_queues,hal::queue_type::write);
     // read and write queue workers
-    m_workers.emplace_back(xrt::thread(task::worker2,std::ref(m_queue[static_cast<qtype>(hal::queue_type::read)]),"read"));
-    m_workers.emplace_back(xrt::thread(task::worker2,std::ref(m_queue[static_cast<qtype>(hal::queue_type::write)]),"write"));
+    add_worker(*m_read_queues.back(),"read");
+    add_worker(*m_write_queues.back(),"write");
+  }
+  // latency class read and write queue workers
+  m_workers.emplace_back(xrt::thread(latency_worker,std::ref(m_queue[static_cast<qtype>(hal::queue_type::read_high)]),"read_high"));
+  m_workers.emplace_back(xrt::thread(latency_worker,std::ref(m_queue[static_cast<qtype>(hal::queue_type::write_high)]),"write_high"));
+  // misc queue workers, and one for short misc tasks
+  auto misc_threads = std::max(config::get_misc_threads(),1u);
+  XRT_DEBUG(std::cout,"Creating ",misc_threads," misc worker threads\n");
+  for (unsigned int i=0; i<misc_threads; ++i)
+    m_workers.emplace_back(xrt::thread(task::worker2,std::ref(m_queue[static_cast<qtype>(hal::queue_type::misc)]),"misc"));
+  m_workers.emplace_back(xrt::thread(task::worker2,std::ref(m_queue[static_cast<qtype>(hal::queue_type::misc_high)]),"misc_high"));
+#endif
+}
+
+task::queue&
+device::
+get_queue(hal::queue_type qt)
+{
+  if (t_latency_class) {
+    if (qt==hal::queue_type::read)
+      qt = hal::queue_type::read_high;
+    else if (qt==hal::queue_type::write)
+      qt = hal::queue_type::write_high;
+    else if (qt==hal::queue_type::misc)
+      qt = hal::queue_type::misc_high;
   }
-  // single misc queue worker
-  m_workers.emplace_back(xrt::thread(task::worker2,std::ref(m_queue[static_cast<qtype>(hal::queue_type::misc)]),"misc"));
+  if (qt==hal::queue_type::read && m_read_queues.size()>1)
+    return get_channel_queue(m_read_queues);
+  if (qt==hal::queue_type::write && m_write_queues.size()>1)
+    return get_channel_queue(m_write_queues);
+  return m_queue[static_cast<qtype>(qt)];
+}
+
+task::queue&
+device::
+get_channel_queue(const std::vector<task::queue*>& queues)
+{
+  // Least loaded channel queue, ties broken round robin
+  auto start = m_next_channel++;
+  auto sz = queues.size();
+  task::queue* q = queues[start % sz];
+  auto qsz = q->size();
+  for (size_t i=1; i<sz && qsz; ++i) {
+    auto candidate = queues[(start + i) % sz];
+    auto csz = candidate->size();
+    if (csz < qsz) {
+      q = candidate;
+      qsz = csz;
+    }
+  }
+  return *q;
+}
+
+int
+device::
+getNumaNode() const
+{
+#ifndef PMD_OCL
+  if (!m_ops->mGetSysfsPath)
+    return -1;
+
+  char path[256] = {0};
+  if (m_ops->mGetSysfsPath(m_handle,"","numa_node",path,sizeof(path)))
+    return -1;
+
+  std::ifstream ifs(path);
+  int node = -1;
+  if (!(ifs >> node))
+    return -1;
+  return node;
+#else
+  return -1;
 #endif
 }
 
@@ -172,6 +357,78 @@ allocExecBuffer(size_t sz)
   return ExecBufferObjectHandle(ubo.release(),delBufferObject);
 }
 
+void
+device::
+destroyPooledBufferObject(PooledBufferObject& pbo)
+{
+  XRT_DEBUGF("deleted pooled buffer object device address(%p,%d)\n",pbo.deviceAddr,pbo.size);
+  munmap(pbo.hostAddr, pbo.size);
+  m_ops->mFreeBO(m_handle, pbo.handle);
+}
+
+void
+device::
+printBufferPoolStats() const
+{
+  if (!config::get_xrt_debug())
+    return;
+  auto stats = m_bo_pool->get_statistics();
+  XRT_PRINT(std::cout,"BO pool device(",m_idx,")"
+            ,", hits: ",stats.hits
+            ,", misses: ",stats.misses
+            ,", recycled: ",stats.recycled
+            ,", rejected: ",stats.rejected
+            ,", trimmed: ",stats.trimmed
+            ,", cached: ",stats.cached," (",stats.bytes," bytes)\n");
+}
+
+// Allocate data BO through m_bo_pool.  The BO is allocated with the
+// size of its pool size class such that it can be recycled for any
+// other request in same class.
+BufferObjectHandle
+device::
+allocPooled(size_t sz, uint64_t flags)
+{
+  auto class_size = bo_pool_type::size_class(sz);
+  PooledBufferObject pbo;
+  if (!m_bo_pool->acquire(flags,class_size,pbo)) {
+    pbo.handle = m_ops->mAllocBO(m_handle, class_size, 0, flags);
+    if (pbo.handle == 0xffffffff) {
+      // cached BOs may hold the memory, release and retry
+      m_bo_pool->clear();
+      pbo.handle = m_ops->mAllocBO(m_handle, class_size, 0, flags);
+    }
+    if (pbo.handle == 0xffffffff)
+      throw std::bad_alloc();
+    pbo.size = class_size;
+    pbo.hostAddr = m_ops->mMapBO(m_handle, pbo.handle, true /*write*/);
+    pbo.deviceAddr = m_ops->mGetDeviceAddr(m_handle, pbo.handle);
+  }
+
+  auto delBufferObject = [this,flags](BufferObjectHandle::element_type* vbo) {
+    BufferObject* bo = static_cast<BufferObject*>(vbo);
+    PooledBufferObject pbo;
+    pbo.handle = bo->handle;
+    pbo.deviceAddr = bo->deviceAddr;
+    pbo.hostAddr = bo->hostAddr;
+    pbo.size = bo_pool_type::size_class(bo->size);
+    if (!m_bo_pool->release(flags,pbo.size,pbo))
+      destroyPooledBufferObject(pbo);
+    delete bo;
+  };
+
+  auto ubo = std::make_unique<BufferObject>();
+  ubo->handle = pbo.handle;
+  ubo->deviceAddr = pbo.deviceAddr;
+  ubo->hostAddr = pbo.hostAddr;
+  ubo->size = sz;
+  ubo->flags = flags;
+  ubo->owner = m_handle;
+
+  XRT_DEBUGF("allocated pooled buffer object device address(%p,%d)\n",ubo->deviceAddr,ubo->size);
+  return BufferObjectHandle(ubo.release(), delBufferObject);
+}
+
 BufferObjectHandle
 device::
 alloc(size_t sz)
@@ -185,6 +442,9 @@ alloc(size_t sz)
   };
 
   uint64_t flags = 0xFFFFFF; //TODO: check default, any bank.
+  if (m_bo_pool)
+    return allocPooled(sz,flags);
+
   auto ubo = std::make_unique<BufferObject>();
   ubo->handle = m_ops->mAllocBO(m_handle, sz, 0, flags);
   if (ubo->handle == 0xffffffff)
@@ -254,6 +514,9 @@ alloc(size_t sz, Domain domain, uint64_t memory_index, void* userptr)
     } else
       flags |= XCL_BO_FLAGS_CACHEABLE;
 
+    if (m_bo_pool && !userptr)
+      return allocPooled(sz,flags);
+
     if (userptr)
       ubo->handle = m_ops->mAllocUserPtrBO(m_handle, userptr, sz, flags);
     else
@@ -343,8 +606,8 @@ write(const BufferObjectHandle& boh, const void* src, size_t sz, size_t offset,
 
   char *hostAddr = static_cast<char*>(bo->hostAddr) + offset;
   return async
-    ? event(addTaskF(std::memcpy,hal::queue_type::misc,hostAddr, src, sz))
-    : event(typed_event<void *>(std::memcpy(hostAddr, src, sz)));
+    ? event(addTaskF(xrt::stream_copy,misc_queue(sz),hostAddr, src, sz))
+    : event(typed_event<void *>(xrt::stream_copy(hostAddr, src, sz)));
 }
 
 event
@@ -354,8 +617,8 @@ read(const BufferObjectHandle& boh, void* dst, size_t sz, size_t offset, bool as
   BufferObject* bo = getBufferObject(boh);
   char *hostAddr = static_cast<char*>(bo->hostAddr) + offset;
   return async
-    ? event(addTaskF(std::memcpy,hal::queue_type::misc,dst,hostAddr,sz))
-    : event(typed_event<void *>(std::memcpy(dst, hostAddr, sz)));
+    ? event(addTaskF(xrt::stream_copy,misc_queue(sz),dst,hostAddr,sz))
+    : event(typed_event<void *>(xrt::stream_copy(dst, hostAddr, sz)));
 }
 
 event
@@ -367,11 +630,61 @@ device::sync(const BufferObjectHandle& boh, size_t sz, size_t offset, direction
 
   BufferObject* bo = getBufferObject(boh);
 
+  if (async && m_ops->mSyncBOAsync && m_ops->mSyncBOWait) {
+    // Driver splits the transfer across DMA channels, no worker
+    // thread is tied up while the transfer is in flight
+    uint64_t fence = 0;
+    if (m_ops->mSyncBOAsync(m_handle,bo->handle,dir,sz,offset+bo->offset,-1,&fence) == 0)
+      return event(sync_fence_event(m_ops.get(),m_handle,fence));
+  }
+
   if (async) {
     auto qt = (dir==XCL_BO_SYNC_BO_FROM_DEVICE) ? hal::queue_type::read : hal::queue_type::write;
-    return event(addTaskF(m_ops->mSyncBO,qt,m_handle,bo->handle,dir,sz,offset));
+    return event(addTaskM(&device::syncBO,qt,bo->handle,dir,sz,offset+bo->offset));
+  }
+  return event(typed_event<int>(syncBO(bo->handle, dir, sz, offset+bo->offset)));
+}
+
+int
+device::
+syncBO(unsigned int handle, xclBOSyncDirection dir, size_t sz, size_t offset)
+{
+  static size_t chunk = static_cast<size_t>(config::get_dma_chunk()) << 10;
+  auto start = std::chrono::steady_clock::now();
+
+  // Each chunk acquires a DMA channel anew
+  int ret = 0;
+  size_t done = 0;
+  do {
+    auto csz = (chunk && sz - done > chunk) ? chunk : sz - done;
+    ret = m_ops->mSyncBO(m_handle, handle, dir, csz, offset + done);
+    done += csz;
+  } while (!ret && done < sz);
+
+  auto& stats = m_io_stats[t_latency_class ? 1 : 0];
+  stats.ops++;
+  stats.bytes += sz;
+  stats.usecs += std::chrono::duration_cast<std::chrono::microseconds>
+    (std::chrono::steady_clock::now() - start).count();
+  return ret;
+}
+
+void
+device::
+printIOStats() const
+{
+  if (!config::get_xrt_debug())
+    return;
+  const char* names[] = {"bulk", "latency"};
+  for (int i=0; i<2; ++i) {
+    auto& stats = m_io_stats[i];
+    if (!stats.ops)
+      continue;
+    XRT_PRINT(std::cout,"DMA ",names[i]," class device(",m_idx,")"
+              ,", syncs: ",stats.ops.load()
+              ,", bytes: ",stats.bytes.load()
+              ,", avg usecs: ",stats.usecs.load()/stats.ops.load(),"\n");
   }
-  return event(typed_event<int>(m_ops->mSyncBO(m_handle, bo->handle, dir, sz, offset+bo->offset)));
 }
 
 event
@@ -383,6 +696,19 @@ copy(const BufferObjectHandle& dst_boh, const BufferObjectHandle& src_boh, size_
   return event(typed_event<int>(m_ops->mCopyBO(m_handle, dst_bo->handle, src_bo->handle, sz, dst_offset, src_offset)));
 }
 
+hal::operations_result<int>
+device::
+copy_peer(const BufferObjectHandle& dst_boh, const BufferObjectHandle& src_boh, size_t sz, size_t dst_offset, size_t src_offset)
+{
+  if (!m_ops->mCopyBOPeer)
+    return hal::operations_result<int>();
+  BufferObject* dst_bo = getBufferObject(dst_boh);
+  // src bo is owned by the peer device, not by this device
+  BufferObject* src_bo = static_cast<BufferObject*>(src_boh.get());
+  return m_ops->mCopyBOPeer(m_handle, dst_bo->handle, src_bo->owner, src_bo->handle,
+                            sz, dst_offset + dst_bo->offset, src_offset + src_bo->offset);
+}
+
 void
 device::
 fill_copy_pkt(const BufferObjectHandle& dst_boh, const BufferObjectHandle& src_boh
@@ -446,6 +772,24 @@ exec_buf(const ExecBufferObjectHandle& boh)
   return 0;
 }
 
+size_t
+device::
+exec_bufs(const std::vector<ExecBufferObjectHandle>& bos)
+{
+  if (!m_ops->mExecBufBatch)
+    return hal::device::exec_bufs(bos);
+
+  std::vector<unsigned int> handles;
+  handles.reserve(bos.size());
+  for (auto& boh : bos)
+    handles.push_back(getExecBufferObject(boh)->handle);
+
+  auto retval = m_ops->mExecBufBatch(m_handle,handles.data(),handles.size());
+  if (retval < 0)
+    throw std::runtime_error(std::string("failed to launch exec buffers '") + std::strerror(-retval) + "'");
+  return retval;
+}
+
 int
 device::
 exec_wait(int timeout_ms) const
@@ -461,6 +805,43 @@ exec_wait(int timeout_ms) const
   return retval;
 }
 
+int
+device::
+exec_done(std::vector<unsigned int>& handles, bool& overflow) const
+{
+  handles.clear();
+  overflow = false;
+  if (!m_ops->mExecBufDone)
+    return -1;
+
+  // drain in chunks until driver has no more completions
+  const unsigned int chunk = 256;
+  while (true) {
+    auto offset = handles.size();
+    handles.resize(offset + chunk);
+    int ovf = 0;
+    auto retval = m_ops->mExecBufDone(m_handle,handles.data()+offset,chunk,&ovf);
+    if (retval < 0) {
+      handles.resize(offset);
+      if (retval == -ENOSYS)
+        return -1;
+      throw std::runtime_error(std::string("exec done failed '") + std::strerror(-retval) + "'");
+    }
+    overflow = overflow || ovf;
+    handles.resize(offset + retval);
+    if (static_cast<unsigned int>(retval) < chunk)
+      break;
+  }
+  return handles.size();
+}
+
+unsigned int
+device::
+get_exec_buf_handle(const ExecBufferObjectHandle& boh) const
+{
+  return getExecBufferObject(boh)->handle;
+}
+
 BufferObjectHandle
 device::
 import(const BufferObjectHandle& boh)
@@ -544,6 +925,7 @@ void
 device::
 emplaceSVMBufferObjectMap(const BufferObjectHandle& boh, void* ptr)
 {
+  std::lock_guard<std::mutex> lk(m_svm_mutex);
   auto itr = m_svmbomap.find(ptr);
   if (itr == m_svmbomap.end())
     m_svmbomap[ptr] = boh;
@@ -553,6 +935,7 @@ void
 device::
 eraseSVMBufferObjectMap(void* ptr)
 {
+  std::lock_guard<std::mutex> lk(m_svm_mutex);
   auto itr = m_svmbomap.find(ptr);
   if (itr != m_svmbomap.end())
     m_svmbomap.erase(itr);
@@ -562,6 +945,7 @@ BufferObjectHandle
 device::
 svm_bo_lookup(void* ptr)
 {
+  std::lock_guard<std::mutex> lk(m_svm_mutex);
   auto itr = m_svmbomap.find(ptr);
   if (itr != m_svmbomap.end())
     return (*itr).second;
@@ -570,15 +954,32 @@ svm_bo_lookup(void* ptr)
 }
 
 //Stream
+xrt::pmd::port*
+device::
+get_pmd()
+{
+  std::call_once(m_pmd_once,[this]() {
+    if (auto ops = xrt::pmd::get_operations())
+      if (m_idx < xrt::pmd::get_port_count())
+        m_pmd.reset(new xrt::pmd::port(ops,m_idx));
+  });
+  return m_pmd.get();
+}
+
 int
 device::
 createWriteStream(hal::StreamFlags flags, hal::StreamAttributes attr, uint64_t route, uint64_t flow, hal::StreamHandle *stream)
 {
-  xclQueueContext ctx;
+  if (auto pmd = get_pmd())
+    return pmd->openStream(0,stream);
+
+  xclQueueContext ctx = {};
   ctx.flags = flags;
   ctx.type = attr;
   ctx.route = route;
   ctx.flow = flow;
+  ctx.priority = XRT_QUEUE_ATTR_PRIO(attr);
+  ctx.weight = XRT_QUEUE_ATTR_WEIGHT(attr);
   return m_ops->mCreateWriteQueue(m_handle,&ctx,stream);
 }
 
@@ -586,11 +987,16 @@ int
 device::
 createReadStream(hal::StreamFlags flags, hal::StreamAttributes attr, uint64_t route, uint64_t flow, hal::StreamHandle *stream)
 {
-  xclQueueContext ctx;
+  if (auto pmd = get_pmd())
+    return pmd->openStream(1,stream);
+
+  xclQueueContext ctx = {};
   ctx.flags = flags;
   ctx.type = attr;
   ctx.route = route;
   ctx.flow = flow;
+  ctx.priority = XRT_QUEUE_ATTR_PRIO(attr);
+  ctx.weight = XRT_QUEUE_ATTR_WEIGHT(attr);
   return m_ops->mCreateReadQueue(m_handle,&ctx,stream);
 }
 
@@ -598,6 +1004,8 @@ int
 device::
 closeStream(hal::StreamHandle stream)
 {
+  if (auto pmd = get_pmd())
+    return pmd->closeStream(stream);
   return m_ops->mDestroyQueue(m_handle,stream);
 }
 
@@ -619,6 +1027,9 @@ ssize_t
 device::
 writeStream(hal::StreamHandle stream, const void* ptr, size_t size, hal::StreamXferReq* request)
 {
+  if (auto pmd = get_pmd())
+    return pmd->write(stream,ptr,size,request);
+
   //TODO:
   xclQueueRequest req;
   xclReqBuffer buffer;
@@ -644,6 +1055,9 @@ ssize_t
 device::
 readStream(hal::StreamHandle stream, void* ptr, size_t size, hal::StreamXferReq* request)
 {
+  if (auto pmd = get_pmd())
+    return pmd->read(stream,ptr,size,request);
+
   xclQueueRequest req;
   xclReqBuffer buffer;
 
@@ -665,10 +1079,35 @@ int
 device::
 pollStreams(hal::StreamXferCompletions* comps, int min, int max, int* actual, int timeout)
 {
+  if (auto pmd = get_pmd())
+    return pmd->pollAll(comps,min,max,actual,timeout);
   xclReqCompletion* req = reinterpret_cast<xclReqCompletion*>(comps);
   return m_ops->mPollQueues(m_handle,min,max,req,actual,timeout);
 }
 
+int
+device::
+registerStreamBuf(hal::StreamHandle stream, hal::StreamBuf buf, size_t frame_size)
+{
+  if (get_pmd())
+    return -ENOSYS;
+  if (!m_ops->mRegisterQueueBuf)
+    return -ENOSYS;
+  return m_ops->mRegisterQueueBuf(m_handle,stream,buf,frame_size);
+}
+
+int
+device::
+pollStream(hal::StreamHandle stream, hal::StreamXferCompletions* comps, int min, int max, int* actual, int timeout)
+{
+  if (auto pmd = get_pmd())
+    return pmd->poll(stream,comps,min,max,actual,timeout);
+  if (!m_ops->mPollQueue)
+    return -ENOSYS;
+  xclReqCompletion* req = reinterpret_cast<xclReqCompletion*>(comps);
+  return m_ops->mPollQueue(m_handle,stream,min,max,req,actual,timeout);
+}
+
 #ifdef PMD_OCL
 void
 createDevices(hal::device_list& devices,
@@ -20,16 +20,20 @@
 #include "xrt/device/hal.h"
 #include "xrt/device/halops2.h"
 #include "xrt/device/PMDOperations.h"
+#include "core/common/bo_pool.h"
 
 #include "ert.h"
 
 #include <cassert>
 
+#include <array>
+#include <atomic>
 #include <functional>
 #include <type_traits>
 #include <cstring>
 #include <memory>
 #include <map>
+#include <mutex>
 
 namespace xrt { namespace hal2 {
 
@@ -61,7 +65,17 @@ class device : public xrt::hal::device
   using qtype = std::underlying_type<hal::queue_type>::type;
   std::array<task::queue,static_cast<qtype>(hal::queue_type::max)> m_queue;
   std::vector<std::thread> m_workers;
+
+  // Per DMA channel read and write queues, each serviced by its own
+  // worker.  The first channel uses the read and write queue of m_queue,
+  // additional channel queues are owned by m_channel_queues.
+  std::vector<std::unique_ptr<task::queue>> m_channel_queues;
+  std::vector<task::queue*> m_read_queues;
+  std::vector<task::queue*> m_write_queues;
+  std::atomic<unsigned int> m_next_channel {0};
+  // m_svmbomap owns SVM buffer handles and is guarded by m_svm_mutex
   svmbomap_type m_svmbomap;
+  std::mutex m_svm_mutex;
 
   std::shared_ptr<hal2::operations> m_ops;
   unsigned int m_idx;
@@ -69,6 +83,14 @@ class device : public xrt::hal::device
   hal2::device_handle m_handle;
   hal2::device_info m_devinfo;
 
+  // Poll mode stream backend, port m_idx when Runtime.pmd_library is
+  // configured, created on first stream use
+  std::unique_ptr<xrt::pmd::port> m_pmd;
+  std::once_flag m_pmd_once;
+
+  xrt::pmd::port*
+  get_pmd();
+
   struct BufferObject : hal::buffer_object
   {
     unsigned int handle = 0xffffffff;
@@ -90,6 +112,24 @@ class device : public xrt::hal::device
     hal2::device_handle owner = nullptr;
   };
 
+  // Data BO as recycled by m_bo_pool, size is the pool class size
+  struct PooledBufferObject
+  {
+    unsigned int handle = 0xffffffff;
+    uint64_t deviceAddr = 0xffffffffffffffff;
+    void* hostAddr = nullptr;
+    size_t size = 0;
+  };
+
+  using bo_pool_type = xrt_core::bo_pool<PooledBufferObject>;
+  std::unique_ptr<bo_pool_type> m_bo_pool;
+
+  void
+  destroyPooledBufferObject(PooledBufferObject& pbo);
+
+  BufferObjectHandle
+  allocPooled(size_t sz, uint64_t flags);
+
   BufferObject*
   getBufferObject(const BufferObjectHandle& boh) const;
 
@@ -116,10 +156,37 @@ class device : public xrt::hal::device
   }
 
   task::queue&
-  get_queue(hal::queue_type qt)
+  get_channel_queue(const std::vector<task::queue*>& queues);
+
+  /**
+   * Queue for a task of type qt.  Read, write, and misc tasks
+   * scheduled from a latency class worker are latency class tasks
+   * themselves.
+   */
+  task::queue&
+  get_queue(hal::queue_type qt);
+
+  /**
+   * Sync a buffer object, chunked per Runtime.dma_chunk, and account
+   * the transfer to the I/O class of the calling thread
+   */
+  int
+  syncBO(unsigned int handle, xclBOSyncDirection dir, size_t sz, size_t offset);
+
+  // Sync statistics per I/O class, bulk and latency
+  struct io_stats
   {
-    return m_queue[static_cast<qtype>(qt)];
-  }
+    std::atomic<uint64_t> ops {0};
+    std::atomic<uint64_t> bytes {0};
+    std::atomic<uint64_t> usecs {0};
+  };
+  std::array<io_stats,2> m_io_stats;
+
+  void
+  printIOStats() const;
+
+  int
+  getNumaNode() const;
 
   /**
    * emplace, erase, and find operations for m_svmbomap
@@ -203,11 +270,19 @@ public:
   close()
   {
     if (m_handle) {
+      printIOStats();
+      if (m_bo_pool) {
+        printBufferPoolStats();
+        m_bo_pool->close();
+      }
       m_ops->mClose(m_handle);
       m_handle=nullptr;
     }
   }
 
+  void
+  printBufferPoolStats() const;
+
   virtual void
   acquire_cu_context(const uuid& uuid,size_t cuidx,bool shared);
 
@@ -217,7 +292,7 @@ public:
   virtual task::queue*
   getQueue(hal::queue_type qt)
   {
-    return &m_queue[static_cast<qtype>(qt)];
+    return &get_queue(qt);
   }
 
   virtual std::string
@@ -309,6 +384,10 @@ public:
   fill_copy_pkt(const BufferObjectHandle& dst_boh, const BufferObjectHandle& src_boh
                 ,size_t sz, size_t dst_offset, size_t src_offset,ert_start_copybo_cmd* pkt);
 
+  virtual hal::operations_result<int>
+  copy_peer(const BufferObjectHandle& dst_bo, const BufferObjectHandle& src_bo, size_t sz,
+            size_t dst_offset, size_t src_offset);
+
   virtual size_t
   read_register(size_t offset, void* buffer, size_t size);
 
@@ -330,9 +409,18 @@ public:
   virtual int
   exec_buf(const ExecBufferObjectHandle& bo);
 
+  virtual size_t
+  exec_bufs(const std::vector<ExecBufferObjectHandle>& bos);
+
   virtual int
   exec_wait(int timeout_ms) const;
 
+  virtual int
+  exec_done(std::vector<unsigned int>& handles, bool& overflow) const;
+
+  virtual unsigned int
+  get_exec_buf_handle(const ExecBufferObjectHandle& bo) const;
+
 public:
 
   virtual int
@@ -359,6 +447,12 @@ public:
   virtual int
   pollStreams(hal::StreamXferCompletions* comps, int min, int max, int* actual, int timeout);
 
+  virtual int
+  registerStreamBuf(hal::StreamHandle stream, hal::StreamBuf buf, size_t frame_size);
+
+  virtual int
+  pollStream(hal::StreamHandle stream, hal::StreamXferCompletions* comps, int min, int max, int* actual, int timeout);
+
 public:
   virtual bool
   is_imported(const BufferObjectHandle& boh) const;
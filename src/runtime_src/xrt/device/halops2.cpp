@@ -35,13 +35,18 @@ operations(const std::string &fileName, void *fileHandle, unsigned int count)
   ,mGetBOProperties(0)
   ,mExecBuf(0)
   ,mExecWait(0)
+  ,mExecBufDone(0)
+  ,mExecBufBatch(0)
   ,mOpenContext(0)
   ,mCloseContext(0)
   ,mFreeBO(0)
   ,mWriteBO(0)
   ,mReadBO(0)
   ,mSyncBO(0)
+  ,mSyncBOAsync(0)
+  ,mSyncBOWait(0)
   ,mCopyBO(0)
+  ,mCopyBOPeer(0)
   ,mMapBO(0)
   ,mWrite(0)
   ,mRead(0)
@@ -76,6 +81,8 @@ operations(const std::string &fileName, void *fileHandle, unsigned int count)
   ,mWriteQueue(0)
   ,mReadQueue(0)
   ,mPollQueues(0)
+  ,mPollQueue(0)
+  ,mRegisterQueueBuf(0)
   ,mGetNumLiveProcesses(0)
   ,mGetSysfsPath(0)
 {
@@ -104,6 +111,8 @@ operations(const std::string &fileName, void *fileHandle, unsigned int count)
   mGetBOProperties = (getBOPropertiesFuncType)dlsym(const_cast<void *>(mDriverHandle), "xclGetBOProperties");
   mExecBuf = (execBOFuncType)dlsym(const_cast<void *>(mDriverHandle), "xclExecBuf");
   mExecWait = (execWaitFuncType)dlsym(const_cast<void *>(mDriverHandle), "xclExecWait");
+  mExecBufDone = (execBufDoneFuncType)dlsym(const_cast<void *>(mDriverHandle), "xclExecBufDone");
+  mExecBufBatch = (execBufBatchFuncType)dlsym(const_cast<void *>(mDriverHandle), "xclExecBufBatch");
 
   mOpenContext = (openContextFuncType)dlsym(const_cast<void*>(mDriverHandle), "xclOpenContext");
   mCloseContext = (closeContextFuncType)dlsym(const_cast<void*>(mDriverHandle), "xclCloseContext");
@@ -119,7 +128,10 @@ operations(const std::string &fileName, void *fileHandle, unsigned int count)
     return;
 
   mSyncBO   = (syncBOFuncType)dlsym(const_cast<void *>(mDriverHandle), "xclSyncBO");
+  mSyncBOAsync = (syncBOAsyncFuncType)dlsym(const_cast<void *>(mDriverHandle), "xclSyncBOAsync");
+  mSyncBOWait = (syncBOWaitFuncType)dlsym(const_cast<void *>(mDriverHandle), "xclSyncBOWait");
   mCopyBO   = (copyBOFuncType)dlsym(const_cast<void *>(mDriverHandle), "xclCopyBO");
+  mCopyBOPeer = (copyBOPeerFuncType)dlsym(const_cast<void *>(mDriverHandle), "xclCopyBOPeer");
   mMapBO    = (mapBOFuncType)dlsym(const_cast<void *>(mDriverHandle), "xclMapBO");
 
   mWrite    = (writeFuncType)dlsym(const_cast<void *>(mDriverHandle), "xclWrite");
@@ -142,6 +154,8 @@ operations(const std::string &fileName, void *fileHandle, unsigned int count)
   mWriteQueue = (writeQueueFuncType)dlsym(const_cast<void *>(mDriverHandle), "xclWriteQueue");
   mReadQueue = (readQueueFuncType)dlsym(const_cast<void *>(mDriverHandle), "xclReadQueue");
   mPollQueues = (pollQueuesFuncType)dlsym(const_cast<void *>(mDriverHandle), "xclPollCompletion");
+  mPollQueue = (pollQueueFuncType)dlsym(const_cast<void *>(mDriverHandle), "xclPollQueue");
+  mRegisterQueueBuf = (registerQueueBufFuncType)dlsym(const_cast<void *>(mDriverHandle), "xclRegisterQueueBuf");
 
   // Profiling Functions
   mGetDeviceTime = (getDeviceTimeFuncType)dlsym(const_cast<void *>(mDriverHandle), "xclGetDeviceTimestamp");
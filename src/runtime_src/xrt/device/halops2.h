@@ -63,14 +63,22 @@ private:
   typedef int (*getBOPropertiesFuncType)(xclDeviceHandle handle, unsigned int boHandle, xclBOProperties*);
   typedef unsigned int (*execBOFuncType)(xclDeviceHandle handle, unsigned int cmdBO);
   typedef int (*execWaitFuncType)(xclDeviceHandle handle, int timeoutMS);
+  typedef int (*execBufDoneFuncType)(xclDeviceHandle handle, unsigned int* cmdBOs, unsigned int count, int* overflow);
+  typedef int (*execBufBatchFuncType)(xclDeviceHandle handle, unsigned int* cmdBOs, unsigned int count);
 
   typedef void (* freeBOFuncType)(xclDeviceHandle handle, unsigned int boHandle);
   typedef size_t (* writeBOFuncType)(xclDeviceHandle handle, unsigned int boHandle, const void *src, size_t size, size_t seek);
   typedef size_t (* readBOFuncType)(xclDeviceHandle handle, unsigned int boHandle, void *dst, size_t size, size_t skip);
   typedef int (* syncBOFuncType)(xclDeviceHandle handle, unsigned int boHandle, xclBOSyncDirection dir,
                                  size_t size, size_t offset);
+  typedef int (* syncBOAsyncFuncType)(xclDeviceHandle handle, unsigned int boHandle, xclBOSyncDirection dir,
+                                      size_t size, size_t offset, int efd, uint64_t *fence);
+  typedef int (* syncBOWaitFuncType)(xclDeviceHandle handle, uint64_t fence, int timeoutMilliSec);
   typedef int (* copyBOFuncType)(xclDeviceHandle handle, unsigned int dstBoHandle, unsigned int srcBoHandle,
                                  size_t size, size_t dst_offset, size_t src_offset);
+  typedef int (* copyBOPeerFuncType)(xclDeviceHandle dstHandle, unsigned int dstBoHandle,
+                                     xclDeviceHandle srcHandle, unsigned int srcBoHandle,
+                                     size_t size, size_t dst_offset, size_t src_offset);
 
   typedef void* (* mapBOFuncType)(xclDeviceHandle handle, unsigned int boHandle, bool write);
 
@@ -126,6 +134,8 @@ private:
   typedef ssize_t (*writeQueueFuncType)(xclDeviceHandle handle,uint64_t q_hdl, xclQueueRequest *wr);
   typedef ssize_t (*readQueueFuncType)(xclDeviceHandle handle,uint64_t q_hdl, xclQueueRequest *wr);
   typedef int     (*pollQueuesFuncType)(xclDeviceHandle handle,int min, int max, xclReqCompletion* completions, int* actual, int timeout);
+  typedef int     (*registerQueueBufFuncType)(xclDeviceHandle handle, uint64_t q_hdl, void* buf, size_t frame_size);
+  typedef int     (*pollQueueFuncType)(xclDeviceHandle handle,uint64_t q_hdl, int min, int max, xclReqCompletion* completions, int* actual, int timeout);
 //End Streaming
 
   //APIs using sysfs
@@ -169,6 +179,8 @@ public:
 
   execBOFuncType mExecBuf;
   execWaitFuncType mExecWait;
+  execBufDoneFuncType mExecBufDone;
+  execBufBatchFuncType mExecBufBatch;
 
   openContextFuncType mOpenContext;
   closeContextFuncType mCloseContext;
@@ -177,7 +189,10 @@ public:
   writeBOFuncType mWriteBO;
   readBOFuncType mReadBO;
   syncBOFuncType mSyncBO;
+  syncBOAsyncFuncType mSyncBOAsync;
+  syncBOWaitFuncType mSyncBOWait;
   copyBOFuncType mCopyBO;
+  copyBOPeerFuncType mCopyBOPeer;
   mapBOFuncType mMapBO;
   writeFuncType mWrite;
   readFuncType mRead;
@@ -214,6 +229,8 @@ public:
   writeQueueFuncType mWriteQueue;
   readQueueFuncType mReadQueue;
   pollQueuesFuncType mPollQueues;
+  pollQueueFuncType mPollQueue;
+  registerQueueBufFuncType mRegisterQueueBuf;
 //End Streaming
 
   // APIs using sysfs
@@ -14,8 +14,9 @@
  *
  * 4. The wrapper helps to decouple XRT from DPDK
  *
- * 5. Need to bring in the concept of device here which is represented by m_port. Today there is
- *    only one device with m_port == 0.
+ * 5. A device is an ethdev port.  Each opened port gets its own packet pool allocated from
+ *    hugepages on the port's NUMA socket, and a fixed number of rx/tx queues that are handed
+ *    out as streams.  A queue is not thread safe, callers serialize bursts per stream.
  *
  * 6. Compile this with DPDK static objects to create pmd.so shared library. Use the command like
  *    below:
@@ -42,18 +43,25 @@
 
 #include "pmdhal.h"
 
+#include <errno.h>
+#include <stdio.h>
 #include <string.h>
 
 #define NUM_MBUFS 8191
-#define MBUF_SIZE (1600 + sizeof(struct rte_mbuf) + RTE_PKTMBUF_HEADROOM)
+#define MBUF_DATA_SIZE RTE_MBUF_DEFAULT_BUF_SIZE
 #define MBUF_CACHE_SIZE 250
-#define MAX_RECV_Q 1
-#define MAX_SEND_Q 1
+#define MAX_QUEUES 64
 
-static unsigned char m_port;
-static unsigned short m_recv_q;
-static unsigned short m_send_q;
-static PacketObjectPool m_po_pool;
+struct pmd_port {
+  struct rte_mempool *pool;
+  unsigned nb_rxq;
+  unsigned nb_txq;
+  uint64_t rxq_used;
+  uint64_t txq_used;
+  int started;
+};
+
+static struct pmd_port m_ports[RTE_MAX_ETHPORTS];
 
 /* Copy paste XCLHAL device info here for now. Later we would like to redefine
  * this or include xclhal.h directly */
@@ -84,44 +92,86 @@ struct xclDeviceInfo2 {
 };
 
 
-unsigned pmdProbe(int argc, char *argv[])
+static struct pmd_port *get_port(unsigned port)
 {
-  m_port = 0xff;
-  m_recv_q = 0xffff;
-  m_send_q = 0xffff;
+  if (port >= RTE_MAX_ETHPORTS || !m_ports[port].started)
+    return NULL;
+  return &m_ports[port];
+}
 
+unsigned pmdProbe(int argc, char *argv[])
+{
   int ret = rte_eal_init(argc, argv);
-  if (ret)
-    return ret;
-  //throw std::runtime_error("Error with EAL initialization");
-
-  unsigned count = rte_eth_dev_count();
-  if (count == 0)
+  if (ret < 0)
     return 0xffffffff;
-    //    throw std::runtime_error("Unable to find any stream capable ports");
-
-  m_po_pool = rte_mempool_create("MBUF_POOL",
-                                 NUM_MBUFS * 1,
-                                 MBUF_SIZE,
-                                 MBUF_CACHE_SIZE,
-                                 sizeof(struct rte_pktmbuf_pool_private),
-                                 rte_pktmbuf_pool_init, NULL,
-                                 rte_pktmbuf_init,      NULL,
-                                 rte_socket_id(),
-                                 0);
-
-  if (!m_po_pool)
-    return 0xffff;
-  return count;
+
+  return rte_eth_dev_count_avail();
 }
 
-unsigned pmdOpen(unsigned port)
+int pmdOpen(unsigned port, unsigned rxq, unsigned txq, unsigned depth)
 {
+  struct pmd_port *p;
   struct rte_eth_conf port_conf;
+  char name[RTE_MEMPOOL_NAMESIZE];
+  int socket;
+  unsigned q;
+  int ret;
+
+  if (port >= RTE_MAX_ETHPORTS || !rte_eth_dev_is_valid_port(port))
+    return -ENODEV;
+  if (rxq > MAX_QUEUES || txq > MAX_QUEUES)
+    return -EINVAL;
+
+  p = &m_ports[port];
+  if (p->started)
+    return -EBUSY;
+
+  /* Packet buffers come from hugepages local to the port */
+  socket = rte_eth_dev_socket_id(port);
+  if (socket < 0)
+    socket = rte_socket_id();
+  snprintf(name, sizeof(name), "xrt_pmd_pool_%u", port);
+  if (!p->pool)
+    p->pool = rte_pktmbuf_pool_create(name, NUM_MBUFS, MBUF_CACHE_SIZE, 0, MBUF_DATA_SIZE, socket);
+  if (!p->pool)
+    return -rte_errno;
+
   memset(&port_conf, 0, sizeof(port_conf));
   port_conf.rxmode.max_rx_pkt_len = ETHER_MAX_LEN;
-  m_port = port;
-  return rte_eth_dev_configure(port, MAX_RECV_Q, MAX_SEND_Q, &port_conf);
+  ret = rte_eth_dev_configure(port, rxq, txq, &port_conf);
+  if (ret)
+    return ret;
+
+  for (q = 0; q < rxq; ++q) {
+    ret = rte_eth_rx_queue_setup(port, q, depth, socket, NULL, p->pool);
+    if (ret)
+      return ret;
+  }
+  for (q = 0; q < txq; ++q) {
+    ret = rte_eth_tx_queue_setup(port, q, depth, socket, NULL);
+    if (ret)
+      return ret;
+  }
+
+  ret = rte_eth_dev_start(port);
+  if (ret)
+    return ret;
+
+  p->nb_rxq = rxq;
+  p->nb_txq = txq;
+  p->rxq_used = 0;
+  p->txq_used = 0;
+  p->started = 1;
+  return 0;
+}
+
+void pmdClose(unsigned port)
+{
+  struct pmd_port *p = get_port(port);
+  if (!p)
+    return;
+  rte_eth_dev_stop(port);
+  p->started = 0;
 }
 
 unsigned pmdGetDeviceInfo(unsigned port, struct xclDeviceInfo2 *info)
@@ -140,52 +190,81 @@ unsigned pmdGetDeviceInfo(unsigned port, struct xclDeviceInfo2 *info)
   return 0;
 }
 
-StreamHandle pmdOpenStream(unsigned port, unsigned depth, unsigned dir)
+StreamHandle pmdOpenStream(unsigned port, unsigned dir)
 {
-  int result;
-  StreamHandle handle;
-  const char *d;
-  if (dir == 1) {
-    result = rte_eth_rx_queue_setup(m_port, ++m_recv_q, depth, SOCKET_ID_ANY, 0, m_po_pool);
-    handle = m_recv_q;
-    d = "receive";
-  }
-  else {
-    result = rte_eth_tx_queue_setup(m_port, ++m_send_q, depth, SOCKET_ID_ANY, 0);
-    handle = m_send_q;
-    d = "transmit";
-  }
-  if (result) {
-    return 0xFFFF;
-    //    throw xrt::error(result, "Unable to open " + d + " stream on port "
-    //                     + std::to_string(m_port) + "with depth " + std::to_string(depth));
+  struct pmd_port *p = get_port(port);
+  uint64_t *used;
+  unsigned count, q;
+
+  if (!p)
+    return PMD_INVALID_STREAM;
+
+  used = (dir == 1) ? &p->rxq_used : &p->txq_used;
+  count = (dir == 1) ? p->nb_rxq : p->nb_txq;
+  for (q = 0; q < count; ++q) {
+    if (!(*used & (1ULL << q))) {
+      *used |= (1ULL << q);
+      return q;
+    }
   }
-  return handle;
+  return PMD_INVALID_STREAM;
 }
 
-void pmdCloseStream(unsigned port, StreamHandle strm)
+void pmdCloseStream(unsigned port, StreamHandle strm, unsigned dir)
 {
-
+  struct pmd_port *p = get_port(port);
+  if (!p || strm >= MAX_QUEUES)
+    return;
+  if (dir == 1)
+    p->rxq_used &= ~(1ULL << strm);
+  else
+    p->txq_used &= ~(1ULL << strm);
 }
 
 unsigned pmdSendPkts(unsigned port, StreamHandle strm, PacketObject *pkts, unsigned count)
 {
-  return rte_eth_tx_burst(m_port, (unsigned short)strm, pkts, (unsigned short)count);
+  return rte_eth_tx_burst(port, strm, (struct rte_mbuf **)pkts, (unsigned short)count);
 }
 
 unsigned pmdRecvPkts(unsigned port, StreamHandle strm, PacketObject *pkts, unsigned count)
 {
-  return rte_eth_rx_burst(m_port, (unsigned short)strm, pkts, (unsigned short)count);
+  return rte_eth_rx_burst(port, strm, (struct rte_mbuf **)pkts, (unsigned short)count);
 }
 
-PacketObject pmdAcquirePkts(unsigned port)
+int pmdAcquirePkts(unsigned port, PacketObject *pkts, unsigned count)
 {
-  return rte_pktmbuf_alloc(m_po_pool);
+  struct pmd_port *p = get_port(port);
+  if (!p)
+    return -ENODEV;
+  return rte_pktmbuf_alloc_bulk(p->pool, (struct rte_mbuf **)pkts, count);
 }
 
-void pmdReleasePkts(unsigned port, PacketObject pkt)
+void pmdReleasePkts(unsigned port, PacketObject *pkts, unsigned count)
 {
-  rte_pktmbuf_free(pkt);
+  unsigned i;
+  for (i = 0; i < count; ++i)
+    rte_pktmbuf_free((struct rte_mbuf *)pkts[i]);
 }
 
+void *pmdPktData(PacketObject pkt)
+{
+  return rte_pktmbuf_mtod((struct rte_mbuf *)pkt, void *);
+}
+
+unsigned pmdPktLen(PacketObject pkt)
+{
+  return rte_pktmbuf_data_len((struct rte_mbuf *)pkt);
+}
 
+void pmdPktSetLen(PacketObject pkt, unsigned len)
+{
+  struct rte_mbuf *m = (struct rte_mbuf *)pkt;
+  m->data_len = len;
+  m->pkt_len = len;
+}
+
+unsigned pmdPktRoom(PacketObject pkt)
+{
+  struct rte_mbuf *m = (struct rte_mbuf *)pkt;
+  return rte_pktmbuf_tailroom(m) + rte_pktmbuf_data_len(m);
+}
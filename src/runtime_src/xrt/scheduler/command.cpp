@@ -17,13 +17,27 @@
 #include "command.h"
 #include "scheduler.h"
 
+#include <atomic>
 #include <map>
+#include <set>
 #include <vector>
+#include <iostream>
 
 namespace {
 
 using buffer_type = xrt::device::ExecBufferObjectHandle;
-static std::mutex s_mutex;
+using magazine_type = std::vector<buffer_type>;
+
+// Exec buffers are recycled through per thread magazines backed by a
+// central depot of full magazines per device.  A thread allocates from
+// and frees to its own magazine without locking.  Only when a magazine
+// runs empty or full is it exchanged with the depot under s_mutex.
+// New exec buffers are allocated under a separate lock so that depot
+// exchanges are not blocked by allocExecBuffer.
+static const size_t magazine_size = 16;
+
+static std::mutex s_mutex;        // depot, registry, and retired stats
+static std::mutex s_alloc_mutex;  // allocExecBuffer is not thread safe
 
 // Static destruction logic to prevent double purging.
 
@@ -32,55 +46,188 @@ static std::mutex s_mutex;
 // commands, but static destruction could have deleted the static
 // object in this file first.
 static bool s_purged = false;
+static bool s_destroyed = false;
+
+struct thread_cache;
+
+// Counters of one thread, written only by the owning thread and read
+// by any thread collecting stats
+struct thread_stats
+{
+  std::atomic<unsigned long> thread_hits {0};
+  std::atomic<unsigned long> depot_hits {0};
+  std::atomic<unsigned long> allocations {0};
+  std::atomic<unsigned long> frees {0};
+};
+
+inline void
+increment(std::atomic<unsigned long>& counter)
+{
+  // single writer, no need for an atomic read-modify-write
+  counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
 
 struct X {
-  std::map<xrt::device*,std::vector<buffer_type>> freelist;
+  std::map<xrt::device*,std::vector<magazine_type>> depot;
+  std::set<thread_cache*> registry;
+  xrt::command_freelist_stats retired;  // stats from exited threads
   X() {}
-  ~X() { s_purged = true; }
+  ~X() { s_purged = true; s_destroyed = true; }
 };
 
 static X sx;
 
+static void
+add_stats(xrt::command_freelist_stats& to, const xrt::command_freelist_stats& from)
+{
+  to.thread_hits += from.thread_hits;
+  to.depot_hits += from.depot_hits;
+  to.allocations += from.allocations;
+  to.frees += from.frees;
+}
+
+static void
+add_stats(xrt::command_freelist_stats& to, const thread_stats& from)
+{
+  to.thread_hits += from.thread_hits.load(std::memory_order_relaxed);
+  to.depot_hits += from.depot_hits.load(std::memory_order_relaxed);
+  to.allocations += from.allocations.load(std::memory_order_relaxed);
+  to.frees += from.frees.load(std::memory_order_relaxed);
+}
+
+// Per thread magazines and counters.  The magazines are only touched
+// by the owning thread, the registry is used to collect counters.
+struct thread_cache
+{
+  std::map<xrt::device*,magazine_type> magazines;
+  thread_stats stats;
+
+  thread_cache()
+  {
+    std::lock_guard<std::mutex> lk(s_mutex);
+    sx.registry.insert(this);
+  }
+
+  // Return magazines to the depot when the thread exits
+  ~thread_cache()
+  {
+    if (s_destroyed)
+      return;
+    std::lock_guard<std::mutex> lk(s_mutex);
+    sx.registry.erase(this);
+    add_stats(sx.retired,stats);
+    for (auto& elem : magazines) {
+      if (!elem.second.empty()) {
+        s_purged=false;
+        sx.depot[elem.first].emplace_back(std::move(elem.second));
+      }
+    }
+  }
+};
+
+static thread_cache&
+get_thread_cache()
+{
+  static thread_local thread_cache tc;
+  return tc;
+}
+
 static buffer_type
 get_buffer(xrt::device* device,size_t sz)
 {
-  std::lock_guard<std::mutex> lk(s_mutex);
+  auto& tc = get_thread_cache();
+  auto& magazine = tc.magazines[device];
 
-  auto itr = sx.freelist.find(device);
-  if (itr != sx.freelist.end()) {
-    auto& freelist = (*itr).second;
-    if (!freelist.empty()) {
-      auto buffer = freelist.back();
-      freelist.pop_back();
-      return buffer;
+  if (!magazine.empty()) {
+    increment(tc.stats.thread_hits);
+    auto buffer = std::move(magazine.back());
+    magazine.pop_back();
+    return buffer;
+  }
+
+  {
+    // refill from depot
+    std::lock_guard<std::mutex> lk(s_mutex);
+    auto itr = sx.depot.find(device);
+    if (itr != sx.depot.end() && !(*itr).second.empty()) {
+      magazine = std::move((*itr).second.back());
+      (*itr).second.pop_back();
     }
   }
 
+  if (!magazine.empty()) {
+    increment(tc.stats.depot_hits);
+    auto buffer = std::move(magazine.back());
+    magazine.pop_back();
+    return buffer;
+  }
+
+  increment(tc.stats.allocations);
+  std::lock_guard<std::mutex> lk(s_alloc_mutex);
   return device->allocExecBuffer(sz); // not thread safe
 }
 
 static void
 free_buffer(xrt::device* device,buffer_type bo)
 {
-  std::lock_guard<std::mutex> lk(s_mutex);
-  s_purged=false;
-  sx.freelist[device].emplace_back(std::move(bo));
+  auto& tc = get_thread_cache();
+  auto& magazine = tc.magazines[device];
+  increment(tc.stats.frees);
+
+  if (magazine.size() >= magazine_size) {
+    // hand full magazine to depot
+    std::lock_guard<std::mutex> lk(s_mutex);
+    s_purged=false;
+    sx.depot[device].emplace_back(std::move(magazine));
+    magazine = magazine_type();
+  }
+
+  if (magazine.capacity() < magazine_size)
+    magazine.reserve(magazine_size);
+  magazine.emplace_back(std::move(bo));
 }
 
 } // namespace
 
 namespace xrt {
 
+command_freelist_stats
+get_command_freelist_stats()
+{
+  std::lock_guard<std::mutex> lk(s_mutex);
+  command_freelist_stats stats = sx.retired;
+  for (auto tc : sx.registry)
+    add_stats(stats,tc->stats);
+  return stats;
+}
+
 // Purge exec buffer freelist during static destruction.
-// Not safe to call outside of static descruction, can't lock
-// static mutex since it could have been destructed
+// Only the depot is purged, it holds the magazines of exited threads
+// and full magazines handed over by live threads.  Magazines of live
+// threads are owned by those threads and are not touched.  s_mutex
+// outlives sx, so it can be locked as long as sx is not destroyed.
 void
 purge_command_freelist()
 {
+  if (s_destroyed)
+    return;
+
+  std::lock_guard<std::mutex> lk(s_mutex);
   if (s_purged)
     return;
 
-  for (auto& elem : sx.freelist)
+  if (xrt::config::get_xrt_debug()) {
+    command_freelist_stats stats = sx.retired;
+    for (auto tc : sx.registry)
+      add_stats(stats,tc->stats);
+    XRT_PRINT(std::cout,"exec buffer freelist"
+              ,", thread hits: ",stats.thread_hits
+              ,", depot hits: ",stats.depot_hits
+              ,", allocations: ",stats.allocations
+              ,", frees: ",stats.frees,"\n");
+  }
+
+  for (auto& elem : sx.depot)
     elem.second.clear();
 
   s_purged = true;
@@ -134,4 +281,13 @@ execute()
   xrt::scheduler::schedule(get_ptr());
 }
 
+void
+command::
+execute(const std::vector<std::shared_ptr<command>>& cmds)
+{
+  for (auto& cmd : cmds)
+    cmd->m_done=false;
+  xrt::scheduler::schedule(cmds);
+}
+
 } // xrt
@@ -24,6 +24,7 @@
 #include <cstddef>
 #include <array>
 #include <memory>
+#include <vector>
 
 namespace xrt {
 
@@ -182,6 +183,14 @@ public:
   void
   execute();
 
+  /**
+   * Execute several commands, submitted as one batch when possible
+   *
+   * @cmds: commands to execute, all on the same device
+   */
+  static void
+  execute(const std::vector<std::shared_ptr<command>>& cmds);
+
   /**
    * Wait for command completion
    */
@@ -268,7 +277,29 @@ command_cast(const std::shared_ptr<command>& cmd)
   return cmd->get_ert_cmd<ERT_COMMAND_TYPE>();
 }
 
-  /**
+/**
+ * Exec buffer freelist counters
+ *
+ * @thread_hits: exec buffers served from calling thread's magazine
+ * @depot_hits: exec buffers served from a magazine taken from the depot
+ * @allocations: exec buffers allocated from device
+ * @frees: exec buffers returned to freelist
+ */
+struct command_freelist_stats
+{
+  unsigned long thread_hits = 0;
+  unsigned long depot_hits = 0;
+  unsigned long allocations = 0;
+  unsigned long frees = 0;
+};
+
+/**
+ * Get current exec buffer freelist counters accumulated over all threads
+ */
+command_freelist_stats
+get_command_freelist_stats();
+
+/**
  * Clear free list of exec buffer objects
  *
  * Command exec buffer objects are recycled, the freelist
@@ -33,18 +33,25 @@
 #include "ert.h"
 #include "command.h"
 
+#include "core/common/probe.h"
+#include "core/common/xclbin_parser.h"
+
 #include <memory>
 #include <cstring>
+#include <cstdlib>
 #include <cerrno>
 #include <algorithm>
 #include <thread>
-#include <list>
 #include <map>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <condition_variable>
 
 namespace {
 
 using command_type = std::shared_ptr<xrt::command>;
-using command_queue_type = std::list<command_type>;
 
 ////////////////////////////////////////////////////////////////
 // Command notification is threaded through task queue
@@ -58,13 +65,35 @@ static bool threaded_notification = true;
 ////////////////////////////////////////////////////////////////
 // Main command monitor interfacing to embedded MB scheduler
 ////////////////////////////////////////////////////////////////
-static std::mutex s_mutex;
-static std::condition_variable s_work;
+static std::mutex s_mutex;  // protects s_device_state insertion and start/stop
 static bool s_running = false;
 static bool s_stop = false;
 static std::exception_ptr s_exception;
-static std::map<const xrt::device*, command_queue_type> s_device_cmds;
-static std::map<const xrt::device*, std::thread> s_device_monitor_threads;
+static bool busy_poll = xrt::config::get_kds_busy_poll();
+
+// Per device monitor state.  Submitted commands are keyed by the
+// handle of their exec buffer so that completions reported by the
+// driver can be looked up directly.  If the driver does not report
+// completions, or reports that completions were lost, the monitor
+// falls back to checking all submitted commands.
+struct device_state
+{
+  std::mutex mutex;
+  std::condition_variable work;
+  std::unordered_map<unsigned int, command_type> submitted_cmds;
+  std::vector<unsigned int> done_handles;
+  bool done_supported = true;
+  std::thread monitor;
+
+  // Commands are packed only when the driver schedules in full ERT
+  // mode for the loaded xclbin
+  bool pack = false;
+
+  // ERT command slot size for the loaded xclbin
+  size_t slot_size = 0x1000;
+};
+
+static std::map<const xrt::device*, std::unique_ptr<device_state>> s_device_state;
 
 inline bool
 is_51_dsa(const xrt::device* device)
@@ -92,6 +121,7 @@ check(const command_type& cmd)
   if (!is_command_done(cmd))
     return false;
 
+  XRT_PROBE1(kds_done,cmd->get_uid());
   XRT_DEBUG(std::cout,"xrt::kds::command(",cmd->get_uid(),") [running->done]\n");
   if (!threaded_notification) {
     cmd->notify(ERT_CMD_STATE_COMPLETED);
@@ -109,86 +139,318 @@ check(const command_type& cmd)
 static void
 launch(command_type cmd)
 {
+  XRT_PROBE_SCOPE(kds_launch);
   XRT_DEBUG(std::cout,"xrt::kds::command(",cmd->get_uid(),") [new->submitted->running]\n");
 
   auto device = cmd->get_device();
-  auto& submitted_cmds = s_device_cmds[device]; // safe since inserted in init
-
-  command_queue_type::const_iterator pos;
+  auto ds = s_device_state[device].get(); // safe since inserted in init
+  auto exec_bo = cmd->get_exec_bo();
+  auto handle = device->get_exec_buf_handle(exec_bo);
 
   // Store command so completion can be tracked.  Make sure this is
   // done prior to exec_buf as exec_wait can otherwise be missed.
   {
-    std::lock_guard<std::mutex> lk(s_mutex);
-    pos = submitted_cmds.insert(submitted_cmds.end(),cmd);
-    s_work.notify_all();
+    std::lock_guard<std::mutex> lk(ds->mutex);
+    ds->submitted_cmds.emplace(handle,cmd);
+    ds->work.notify_all();
   }
 
   // Submit the command
-  auto exec_bo = cmd->get_exec_bo();
   try {
     device->exec_buf(exec_bo);
   }
   catch (...) {
     // Remove the pending command
-    std::lock_guard<std::mutex> lk(s_mutex);
+    std::lock_guard<std::mutex> lk(ds->mutex);
     assert(get_command_state(cmd)==ERT_CMD_STATE_NEW);
-    submitted_cmds.erase(pos);
+    ds->submitted_cmds.erase(handle);
     throw;
   }
 }
 
+// Launch several commands for the same device with one submission.
+// Commands are tracked before they are submitted, commands that
+// could not be submitted are removed again.
+static void
+launch(const std::vector<command_type>& cmds)
+{
+  if (cmds.size()==1)
+    return launch(cmds.front());
+
+  XRT_PROBE_SCOPE(kds_launch_batch);
+  auto device = cmds.front()->get_device();
+  auto ds = s_device_state[device].get(); // safe since inserted in init
+
+  std::vector<xrt::device::ExecBufferObjectHandle> exec_bos;
+  std::vector<unsigned int> handles;
+  exec_bos.reserve(cmds.size());
+  handles.reserve(cmds.size());
+  for (auto& cmd : cmds) {
+    XRT_DEBUG(std::cout,"xrt::kds::command(",cmd->get_uid(),") [new->submitted->running]\n");
+    assert(cmd->get_device()==device);
+    exec_bos.push_back(cmd->get_exec_bo());
+    handles.push_back(device->get_exec_buf_handle(exec_bos.back()));
+  }
+
+  {
+    std::lock_guard<std::mutex> lk(ds->mutex);
+    for (size_t i=0; i<cmds.size(); ++i)
+      ds->submitted_cmds.emplace(handles[i],cmds[i]);
+    ds->work.notify_all();
+  }
+
+  size_t submitted = 0;
+  try {
+    submitted = device->exec_bufs(exec_bos);
+  }
+  catch (...) {
+    std::lock_guard<std::mutex> lk(ds->mutex);
+    for (auto handle : handles)
+      ds->submitted_cmds.erase(handle);
+    throw;
+  }
+
+  if (submitted < cmds.size()) {
+    {
+      std::lock_guard<std::mutex> lk(ds->mutex);
+      for (size_t i=submitted; i<cmds.size(); ++i)
+        ds->submitted_cmds.erase(handles[i]);
+    }
+    throw std::runtime_error("failed to launch exec buffer for command("
+                             + std::to_string(cmds[submitted]->get_uid()) + ")");
+  }
+}
+
+////////////////////////////////////////////////////////////////
+// Command packing.  Start kernel commands submitted together are
+// packed as nodes without dependencies of one ERT_START_DAG command
+// so that ERT processes them as a unit in one command slot.  The
+// completion of the packed command is reported to each packed
+// command.  DAG commands require ERT, packing is enabled per device
+// only when the driver reports full ERT scheduling mode.
+////////////////////////////////////////////////////////////////
+static bool
+pack_enabled()
+{
+#if defined(__arm__) || defined(__aarch64__)
+  return false;
+#else
+  static bool value = xrt::config::get_kds_pack() && (std::getenv("XCL_EMULATION_MODE") == nullptr);
+  return value;
+#endif
+}
+
+// Scheduling mode is decided by the driver when the xclbin is loaded
+static bool
+is_ert_mode(xrt::device* device)
+{
+  auto path = device->getSysfsPath("mb_scheduler","kds_mode");
+  if (!path.valid())
+    return false;
+  std::ifstream ifs(path.get());
+  std::string mode;
+  ifs >> mode;
+  return mode=="ert";
+}
+
+class packed_command : public xrt::command
+{
+public:
+  packed_command(std::vector<command_type> cmds);
+
+  virtual void
+  done() const;
+
+private:
+  std::vector<command_type> m_cmds;
+};
+
+packed_command::
+packed_command(std::vector<command_type> cmds)
+  : xrt::command(cmds.front()->get_device(),ERT_START_DAG)
+  , m_cmds(std::move(cmds))
+{
+  // CU masks of packed command are the union of all nodes' masks
+  uint32_t cu_masks[4] = {0};
+  size_t num_masks = 1;
+  for (auto& cmd : m_cmds) {
+    auto skcmd = xrt::command_cast<ert_start_kernel_cmd*>(cmd);
+    size_t masks = 1 + skcmd->extra_cu_masks;
+    cu_masks[0] |= skcmd->cu_mask;
+    for (size_t i=1; i<masks; ++i)
+      cu_masks[i] |= skcmd->data[i-1];
+    num_masks = std::max(num_masks,masks);
+  }
+
+  auto& packet = get_packet();
+  size_t idx = 1; // past header
+  for (size_t i=0; i<num_masks; ++i)
+    packet[idx++] = cu_masks[i];
+  packet[idx++] = m_cmds.size();
+  for (auto& cmd : m_cmds) {
+    auto& node = cmd->get_packet();
+    auto words = 1 + xrt::command_cast<ert_packet*>(cmd)->count;
+    packet[idx++] = 0; // no dependencies
+    std::copy(node.data(),node.data()+words,packet.data()+idx);
+    idx += words;
+  }
+  packet.resize(idx);
+
+  auto dcmd = get_ert_cmd<ert_start_dag_cmd*>();
+  dcmd->type = ERT_CU;
+  dcmd->extra_cu_masks = num_masks-1;
+  dcmd->count = idx-1;
+}
+
+void
+packed_command::
+done() const
+{
+  auto state = get_ert_cmd<const ert_packet*>()->state;
+  for (auto& cmd : m_cmds) {
+    xrt::command_cast<ert_packet*>(cmd)->state = state;
+    cmd->notify(ERT_CMD_STATE_COMPLETED);
+  }
+}
+
+// Command can be a node of a packed command.  Persistent commands,
+// commands with phase timestamps, and high priority commands depend
+// on being submitted through their own exec buffer
+static bool
+packable(const command_type& cmd)
+{
+  auto skcmd = xrt::command_cast<ert_start_kernel_cmd*>(cmd);
+  return (skcmd->opcode==ERT_START_CU || skcmd->opcode==ERT_EXEC_WRITE)
+    && skcmd->type!=ERT_CTRL && !skcmd->persistent && !skcmd->stat_enabled
+    && !skcmd->priority;
+}
+
+// Pack consecutive packable commands for the same device, at most
+// ERT_DAG_MAX_NODES commands per packed command and no more than
+// what fits in an ERT command slot
+static std::vector<command_type>
+pack(device_state* ds, const std::vector<command_type>& cmds)
+{
+  if (cmds.size()<2 || !ds->pack)
+    return cmds;
+
+  auto max_words = std::min<size_t>(ds->slot_size,0x1000) / sizeof(uint32_t);
+  const size_t fixed_words = 1 + 4 + 1; // header, cu masks, number of nodes
+
+  std::vector<command_type> packed;
+  std::vector<command_type> nodes;
+  size_t node_words = 0;
+  auto flush = [&]() {
+    if (nodes.size()==1)
+      packed.push_back(nodes.front());
+    else if (nodes.size()>1)
+      packed.push_back(std::make_shared<packed_command>(std::move(nodes)));
+    nodes.clear();
+    node_words = 0;
+  };
+
+  for (auto& cmd : cmds) {
+    if (!packable(cmd)) {
+      flush();
+      packed.push_back(cmd);
+      continue;
+    }
+    auto words = 2 + xrt::command_cast<ert_packet*>(cmd)->count; // deps, header, payload
+    if (nodes.size()==ERT_DAG_MAX_NODES || fixed_words+node_words+words > max_words)
+      flush();
+    nodes.push_back(cmd);
+    node_words += words;
+  }
+  flush();
+
+  XRT_DEBUG(std::cout,"xrt::kds packed ",cmds.size()," commands into ",packed.size(),"\n");
+  return packed;
+}
+
+// Check all submitted commands, O(n) in number of submitted commands
+static void
+check_all(device_state* ds)
+{
+  auto& submitted_cmds = ds->submitted_cmds;
+  for (auto itr=submitted_cmds.begin(); itr!=submitted_cmds.end(); ) {
+    if (check((*itr).second))
+      itr = submitted_cmds.erase(itr);
+    else
+      ++itr;
+  }
+}
+
+// Check only commands reported done by driver
 static void
-monitor_loop(const xrt::device* device)
+check_done(device_state* ds)
+{
+  auto& submitted_cmds = ds->submitted_cmds;
+  for (auto handle : ds->done_handles) {
+    auto itr = submitted_cmds.find(handle);
+    if (itr==submitted_cmds.end())
+      continue; // not submitted by kds or already retired by check_all
+    if (check((*itr).second))
+      submitted_cmds.erase(itr);
+  }
+}
+
+static void
+monitor_loop(const xrt::device* device, device_state* ds)
 {
   unsigned long loops = 0;           // number of outer loops
   unsigned long sleeps = 0;          // number of sleeps
 
-  // thread safe access, since guaranteed to be inserted in init
-  auto& submitted_cmds = s_device_cmds[device];
-
   while (1) {
     ++loops;
 
     {
-      {
-        std::unique_lock<std::mutex> lk(s_mutex);
-
-        // Larger wait
-        while (!s_stop && submitted_cmds.empty()) {
-          ++sleeps;
-          s_work.wait(lk);
-        }
+      std::unique_lock<std::mutex> lk(ds->mutex);
+
+      // Larger wait
+      while (!s_stop && ds->submitted_cmds.empty()) {
+        ++sleeps;
+        ds->work.wait(lk);
       }
+    }
 
-      if (s_stop)
-        return;
+    if (s_stop)
+      return;
 
-      // Finer wait
+    // Finer wait, in busy poll mode spin on the driver completion
+    // ring, which requires no system call when the ring is mapped
+    if (!busy_poll || !ds->done_supported)
       while (device->exec_wait(1000)==0) ;
 
-      std::lock_guard<std::mutex> lk(s_mutex);
-      auto end = submitted_cmds.end();
-      for (auto itr=submitted_cmds.begin(); itr!=end; ) {
-        auto& cmd = (*itr);
-        if (check(cmd)) {
-          itr = submitted_cmds.erase(itr);
-          end = submitted_cmds.end();
-        }
-        else {
-          ++itr;
-        }
-      }
+    // Ask driver which commands completed, done handles are
+    // accessed by this monitor thread only
+    bool overflow = false;
+    int done = 0;
+    while (ds->done_supported) {
+      done = device->exec_done(ds->done_handles,overflow);
+      if (done!=0 || overflow || !busy_poll || s_stop)
+        break;
+      std::this_thread::yield();
     }
+
+    if (done < 0) {
+      XRT_DEBUG(std::cout,"xrt::kds driver does not report completions, checking all commands\n");
+      ds->done_supported = false;
+    }
+
+    std::lock_guard<std::mutex> lk(ds->mutex);
+    if (!ds->done_supported || overflow)
+      check_all(ds);
+    else
+      check_done(ds);
   }
 }
 
 
 static void
-monitor(const xrt::device* device)
+monitor(const xrt::device* device, device_state* ds)
 {
   try {
-    monitor_loop(device);
+    monitor_loop(device,ds);
   }
   catch (const std::exception& ex) {
     std::string msg = std::string("kds command monitor died unexpectedly: ") + ex.what();
@@ -212,6 +474,25 @@ schedule(const command_type& cmd)
   return launch(cmd);
 }
 
+void
+schedule(const std::vector<command_type>& cmds)
+{
+  if (cmds.empty())
+    return;
+
+  // Commands are submitted in batches per device
+  auto first = cmds.begin();
+  while (first != cmds.end()) {
+    auto device = (*first)->get_device();
+    auto last = std::find_if(first,cmds.end(),[device](const command_type& cmd) { return cmd->get_device()!=device; });
+    auto ds = s_device_state[device].get(); // safe since inserted in init
+    if (first==cmds.begin() && last==cmds.end())
+      return launch(pack(ds,cmds));
+    launch(pack(ds,std::vector<command_type>(first,last)));
+    first = last;
+  }
+}
+
 void
 start()
 {
@@ -235,9 +516,14 @@ stop()
     s_stop = true;
   }
 
-  s_work.notify_all();
-  for (auto& e : s_device_monitor_threads)
-    e.second.join();
+  for (auto& e : s_device_state) {
+    auto ds = e.second.get();
+    {
+      std::lock_guard<std::mutex> lk(ds->mutex);
+      ds->work.notify_all();
+    }
+    ds->monitor.join();
+  }
 
   notify_queue.stop();
   if (threaded_notification)
@@ -247,17 +533,25 @@ stop()
 }
 
 void
-init(xrt::device* device, const axlf*)
+init(xrt::device* device, const axlf* top)
 {
   // create a submitted command queue for this device if necessary,
   // create a command monitor thread for this device if necessary
   std::lock_guard<std::mutex> lk(s_mutex);
-  auto itr = s_device_monitor_threads.find(device);
-  if (itr==s_device_monitor_threads.end()) {
+  auto itr = s_device_state.find(device);
+  if (itr==s_device_state.end()) {
     XRT_DEBUG(std::cout,"creating monitor thread and queue for device '",device->getName(),"'\n");
-    s_device_cmds.emplace(device,command_queue_type());
-    s_device_monitor_threads.emplace(device,xrt::thread(::monitor,device));
+    auto ds = new device_state;
+    itr = s_device_state.emplace(device,std::unique_ptr<device_state>(ds)).first;
+    ds->monitor = xrt::thread(::monitor,device,ds);
   }
+
+  // slot size matches what the scheduler is configured with
+  (*itr).second->slot_size = top
+    ? xrt_core::xclbin::get_ert_slot_size(top,xrt::config::get_ert_slotsize())
+    : xrt::config::get_ert_slotsize();
+
+  (*itr).second->pack = pack_enabled() && is_ert_mode(device);
 }
 
 }} // kds,xrt
@@ -110,6 +110,18 @@ schedule(const command_type& cmd)
     sws::schedule(cmd);
 }
 
+void
+schedule(const std::vector<command_type>& cmds)
+{
+  if (kds_enabled()) {
+    kds::schedule(cmds);
+    return;
+  }
+
+  for (auto& cmd : cmds)
+    sws::schedule(cmd);
+}
+
 void
 init(xrt::device* device, const axlf* top)
 {
@@ -121,4 +133,10 @@ init(xrt::device* device, const axlf* top)
     sws::init(device,top);
 }
 
+bool
+is_kds()
+{
+  return kds_enabled();
+}
+
 }} // scheduler,xrt
@@ -54,6 +54,12 @@ namespace kds {
 void
 schedule(const command_type& cmd);
 
+/**
+ * Schedule several commands with as few driver calls as possible
+ */
+void
+schedule(const std::vector<command_type>& cmds);
+
 void
 start();
 
@@ -72,6 +78,15 @@ namespace scheduler {
 void
 schedule(const command_type& cmd);
 
+/**
+ * Schedule several commands for execution in order
+ *
+ * When scheduling through the kernel driver, the commands are
+ * submitted as one batch per device.
+ */
+void
+schedule(const std::vector<command_type>& cmds);
+
 void
 start();
 
@@ -81,6 +96,14 @@ stop();
 void
 init(xrt::device* device, const axlf* top);
 
+/**
+ * @return
+ *   true if commands are scheduled by the kernel driver (kds), false
+ *   if scheduled by the software scheduler (sws)
+ */
+bool
+is_kds();
+
 } // scheduler
 
 
@@ -32,10 +32,14 @@
 #include <limits>
 #include <bitset>
 #include <vector>
-#include <list>
+#include <queue>
 #include <map>
 #include <mutex>
+#include <atomic>
 #include <condition_variable>
+#include <algorithm>
+#include <chrono>
+#include <sstream>
 
 namespace {
 
@@ -295,18 +299,6 @@ public:
 
 using xcmd_ptr = std::shared_ptr<xocl_cmd>;
 
-////////////////////////////////////////////////////////////////
-// List of new pending xocl_cmd objects
-//
-// @s_pending_cmds: populated from user space with new commands for buffer objects
-// @s_num_pending: number of pending commands
-//
-// Scheduler copies pending commands to its private queue when necessary
-////////////////////////////////////////////////////////////////
-static std::vector<xcmd_ptr> s_pending_cmds;
-static std::mutex s_pending_mutex;
-static std::atomic<unsigned int> s_num_pending {0};
-
 ////////////////////////////////////////////////////////////////
 // class xocl_cu represents a compute unit on a device
 //
@@ -329,7 +321,7 @@ static std::atomic<unsigned int> s_num_pending {0};
 class xocl_cu
 {
 private:
-  std::queue<xocl_cmd*> running_queue;
+  std::queue<xcmd_ptr> running_queue;
   xrt::device* xdev = nullptr;
   size_type idx = 0;
   value_type addr = 0;
@@ -380,6 +372,13 @@ public:
       : !(ctrlreg & AP_START);
   }
 
+  // Check if CU has started commands that are not yet popped
+  bool
+  busy() const
+  {
+    return !running_queue.empty();
+  }
+
   // Get the first completed command from the running queue
   //
   // @return
@@ -393,27 +392,32 @@ public:
     }
 
     return done_cnt
-      ? running_queue.front()
+      ? running_queue.front().get()
       : nullptr;
   }
 
   // Pop the first completed command off of the running queue
-  void
+  //
+  // @return
+  //   The popped command, caller takes over ownership
+  xcmd_ptr
   pop_done()
   {
     if (!done_cnt)
-      return;
+      return nullptr;
 
+    auto xcmd = std::move(running_queue.front());
     running_queue.pop();
     --done_cnt;
     XRT_DEBUGF("sws pop_done() popped cu(%d) done(%d) run(%d)\n",idx,done_cnt,run_cnt);
+    return xcmd;
   }
 
   // Start the CU with a new command.
   //
   // The command is pushed onto the running queue
   void
-  start(xocl_cmd* xcmd)
+  start(const xcmd_ptr& xcmd)
   {
     XRT_ASSERT(!(ctrlreg & AP_START),"cu not ready");
 
@@ -423,7 +427,10 @@ public:
 
     // write register map, starting at base + 0xC
     // 0x4, 0x8 used for interrupt, which is initialized in setu
-    xdev->write_register(addr,regmap,size*4);
+    // In emulation every write is a round trip to the model and the
+    // whole register map is written along with AP_START below
+    if (!is_emulation())
+      xdev->write_register(addr,regmap,size*4);
 
     // invoke callback for starting cu
     xcmd->notify_start(idx);
@@ -447,10 +454,10 @@ public:
 // class exec_core: core data struct for command execution on a device
 //
 // @xdev: the xrt device on which to execute
-// @scheduler: scheduler that manages this execution core
 // @submit_queue: queue holding command that have been submitted by scheduler
 // @slot_status: bitset representing free/busy slots in submit_queue
-// @cu_usage: list of CUs managed by this execution core (device)
+// @cus: CUs managed by this execution core (device), indexed by CU idx
+// @cu_active: bitset of CUs with started commands that are not yet popped
 // @num_slots: number of slots in submit queue
 // @num_cus: number of CUs on device
 //
@@ -462,43 +469,33 @@ public:
 // affect performance.
 //
 // Once a command is started on a CU it is removed from the submit
-// queue.  The command is annotated with the CU on which is has been
-// started, so scheduler will revisit the command and check for its
-// completion.
+// queue and owned by the CU running queue.  Completion is checked by
+// visiting the active CUs, not the commands.
 ////////////////////////////////////////////////////////////////
 class exec_core
 {
   // device
   xrt::device* m_xdev = nullptr;
 
-  // scheduler for this device
-  xocl_scheduler* m_scheduler = nullptr;
-
   // Commands submitted to this device, the queue is slot based
   // and a slot becomes free when its command is started on a CU
   xocl_cmd* submit_queue[MAX_SLOTS] = {nullptr}; // reflects ERT CQ # slots
   std::bitset<MAX_SLOTS> slot_status;
 
   // Compute units on this device
-  std::vector<std::unique_ptr<xocl_cu>> cu_usage;
+  std::vector<xocl_cu> m_cus;
+  cu_bitset_type m_cu_active;
 
   size_type num_slots = 0;
   size_type num_cus = 0;
 
 public:
-  exec_core(xrt::device* xdev, xocl_scheduler* xs, size_t slots, const std::vector<uint64_t>& cu_amap)
-    : m_xdev(xdev), m_scheduler(xs), num_slots(slots), num_cus(cu_amap.size())
+  exec_core(xrt::device* xdev, size_t slots, const std::vector<uint64_t>& cu_amap)
+    : m_xdev(xdev), num_slots(slots), num_cus(cu_amap.size())
   {
-    cu_usage.reserve(cu_amap.size());
+    m_cus.reserve(cu_amap.size());
     for (size_type idx=0; idx<cu_amap.size(); ++idx)
-      cu_usage.push_back(std::make_unique<xocl_cu>(xdev,idx,cu_amap[idx]));
-  }
-
-  // Scheduler mananging this execution core
-  xocl_scheduler*
-  get_scheduler() const
-  {
-    return m_scheduler;
+      m_cus.emplace_back(xdev,idx,cu_amap[idx]);
   }
 
   // Get a free slot index into submit queue
@@ -553,14 +550,15 @@ public:
   // @return
   //  True if started successfully, false otherwise
   bool
-  penguin_start(xocl_cmd* xcmd)
+  penguin_start(const xcmd_ptr& xcmd)
   {
     // Find a ready CU
     for (size_type cuidx=0; cuidx<num_cus; ++cuidx) {
-      auto& cu = cu_usage[cuidx];
-      if (xcmd->has_cu(cuidx) && cu->ready()) {
+      auto& cu = m_cus[cuidx];
+      if (xcmd->has_cu(cuidx) && cu.ready()) {
         xcmd->cuidx = cuidx;
-        cu->start(xcmd);
+        cu.start(xcmd);
+        m_cu_active.set(cuidx);
         return true;
       }
     }
@@ -572,7 +570,7 @@ public:
   // @return
   //  True if started successfully, false otherwise
   bool
-  start(xocl_cmd* xcmd)
+  start(const xcmd_ptr& xcmd)
   {
     if (penguin_start(xcmd)) {
       submit_queue[xcmd->slotidx]=nullptr;
@@ -582,52 +580,46 @@ public:
     return false;
   }
 
-  // Check if a command has completed execution
+  // Pop all completed commands off of active CUs
   //
-  // It is precond that command has been started, so the CU that executes
-  // the command is indicated by the cuidx in the command.  Simply check
-  // if the first completed command in the CU is the argument command
-  // and if so pop it off the CU.
-  //
-  // @return
-  //   True if completed, false otherwise
-  bool
-  penguin_query(xocl_cmd* xcmd)
+  // @done: callable invoked with each completed command
+  template <typename F>
+  void
+  query(F&& done)
   {
-    // no point to query a command
-    auto& cu = cu_usage[xcmd->cuidx];
-    if (cu->get_done()==xcmd) {
-      cu->pop_done();
-      return true;
-    }
-    return false;
-  }
+    if (m_cu_active.none())
+      return;
 
-  // Check if a command has completed execution
-  bool
-  query(xocl_cmd* xcmd)
-  {
-    return penguin_query(xcmd);
+    for (size_type cuidx=0; cuidx<num_cus; ++cuidx) {
+      if (!m_cu_active.test(cuidx))
+        continue;
+      auto& cu = m_cus[cuidx];
+      while (cu.get_done())
+        done(cu.pop_done());
+      if (!cu.busy())
+        m_cu_active.reset(cuidx);
+    }
   }
 };
 
 ////////////////////////////////////////////////////////////////
 // class xocl_scheduler: The scheduler data structure
 //
-// @m_command_queue: all the commands managed by scheduler
+// @m_pending: new commands populated by user threads
+// @m_queued: commands waiting to be started, in submission order
+// @m_num_running: number of started commands not yet completed
 //
 // The scheduler babysits all commands launched by user. It
 // transitions the commands from state to state until the command
 // completes.
 //
-// The scheduler runs on its own thread and manages command execution
-// on execution cores.  An execution core is 1-1 with a scheduler, but
-// a scheduler can manage any number of cores.  Because the scheduler
-// is the only client of an exec_core, and exec_core is the only
-// client of xocl_cu, no locking is necessary is any of the data
-// structures.  Exception is the pending command list which is copied
-// to the scheduler command queue, the pending list is populated by
-// user thread, and harvested by scheduler thread.
+// There is one scheduler per device, each running on its own thread
+// and managing the execution core of its device.  Because the
+// scheduler is the only client of an exec_core, and exec_core is the
+// only client of xocl_cu, no locking is necessary is any of the data
+// structures.  Exception is the pending command list which is
+// swapped into the scheduler queue in one batch, the pending list is
+// populated by user threads, and harvested by scheduler thread.
 ////////////////////////////////////////////////////////////////
 class xocl_scheduler
 {
@@ -635,27 +627,37 @@ class xocl_scheduler
   std::condition_variable    m_work;
 
   bool                       m_stop = false;
-  std::list<xcmd_ptr>        m_command_queue;
+  std::vector<xcmd_ptr>      m_pending;
+  std::atomic<unsigned int>  m_num_pending {0};
+
+  std::vector<xcmd_ptr>      m_queued;
+  std::vector<xcmd_ptr>      m_harvest;
+  size_type                  m_num_running = 0;
+
+  std::unique_ptr<exec_core> m_exec;
+  std::thread                m_thread;
+  unsigned int               m_index = 0;
+  unsigned int               m_backoff_us = 0;
 
   // Copy pending commands into command queue.
   void
   queue_cmds()
   {
-    std::lock_guard<std::mutex> lk(s_pending_mutex);
-    for (auto itr=s_pending_cmds.begin(); itr!=s_pending_cmds.end(); ) {
-      auto xcmd = (*itr);
-      auto exec = xcmd->get_exec();
-      if (exec->get_scheduler()==this) {
-        XRT_DEBUGF("xcmd(%d) [new->queued]\n",xcmd->get_uid());
-        itr = s_pending_cmds.erase(itr);
-        xcmd->set_int_state(ERT_CMD_STATE_QUEUED);
-        m_command_queue.push_back(std::move(xcmd));
-      }
-      else {
-        ++itr;
-      }
+    if (!m_num_pending)
+      return;
+
+    {
+      std::lock_guard<std::mutex> lk(m_mutex);
+      std::swap(m_pending,m_harvest);
+      m_num_pending = 0;
+    }
+
+    for (auto& xcmd : m_harvest) {
+      XRT_DEBUGF("xcmd(%d) [new->queued]\n",xcmd->get_uid());
+      xcmd->set_int_state(ERT_CMD_STATE_QUEUED);
+      m_queued.push_back(std::move(xcmd));
     }
-    s_num_pending = s_pending_cmds.size();
+    m_harvest.clear();
   }
 
   // Transition command to submitted state if possible
@@ -663,8 +665,7 @@ class xocl_scheduler
   queued_to_submitted(const xcmd_ptr& xcmd)
   {
     bool retval = false;
-    auto exec = xcmd->get_exec();
-    if (exec->submit(xcmd.get())) {
+    if (m_exec->submit(xcmd.get())) {
       XRT_DEBUGF("xcmd(%d) [queued->submitted]\n",xcmd->get_uid());
       xcmd->set_int_state(ERT_CMD_STATE_SUBMITTED);
       retval = true;
@@ -677,28 +678,25 @@ class xocl_scheduler
   submitted_to_running(const xcmd_ptr& xcmd)
   {
     bool retval = false;
-    auto exec = xcmd->get_exec();
-    if (exec->start(xcmd.get())) {
+    if (m_exec->start(xcmd)) {
       XRT_DEBUGF("xcmd(%d) [submitted->running]\n",xcmd->get_uid());
       xcmd->set_int_state(ERT_CMD_STATE_RUNNING);
+      ++m_num_running;
       retval = true;
     }
     return retval;
   }
 
-  // Transition command to complete state if command has completed
-  bool
+  // Transition command to complete state, command has been
+  // popped off its CU
+  void
   running_to_complete(const xcmd_ptr& xcmd)
   {
-    bool retval = false;
-    auto exec = xcmd->get_exec();
-    if (exec->query(xcmd.get())) {
-      XRT_DEBUGF("xcmd(%d) [running->complete]\n",xcmd->get_uid());
-      xcmd->set_state(ERT_CMD_STATE_COMPLETED);
-      xcmd->notify_host();
-      retval = true;
-    }
-    return retval;
+    XRT_DEBUGF("xcmd(%d) [running->complete]\n",xcmd->get_uid());
+    xcmd->set_state(ERT_CMD_STATE_COMPLETED);
+    xcmd->notify_host();
+    --m_num_running;
+    complete_to_free(xcmd);
   }
 
   // Free a command
@@ -709,97 +707,197 @@ class xocl_scheduler
     return true;
   }
 
-  // Iterate command queue and baby sit all commands
+  // Start queued commands, commands that are started are handed
+  // over to the CU that runs them and compacted out of the queue
   void
-  iterate_cmds()
+  start_cmds()
   {
-    auto end = m_command_queue.end();
-    auto nitr = m_command_queue.begin();
-    for (auto itr=nitr; itr!=end; itr=nitr) {
-      auto& xcmd = (*itr);
+    size_type keep = 0;
+    for (size_type idx=0; idx<m_queued.size(); ++idx) {
+      auto& xcmd = m_queued[idx];
       if (xcmd->get_state() == ERT_CMD_STATE_QUEUED)
         queued_to_submitted(xcmd);
-      if (xcmd->get_state() == ERT_CMD_STATE_SUBMITTED)
-        submitted_to_running(xcmd);
-      if (xcmd->get_state() == ERT_CMD_STATE_RUNNING)
-        running_to_complete(xcmd);
-      if (xcmd->get_state() == ERT_CMD_STATE_COMPLETED) {
-        complete_to_free(xcmd);
-        nitr = m_command_queue.erase(itr);
-        end = m_command_queue.end();
+      if (xcmd->get_state() == ERT_CMD_STATE_SUBMITTED && submitted_to_running(xcmd))
         continue;
-      }
-
-      nitr = ++itr;
+      if (keep!=idx)
+        m_queued[keep] = std::move(xcmd);
+      ++keep;
     }
+    m_queued.resize(keep);
+  }
+
+  // Baby sit all commands
+  //
+  // @return
+  //  True if any command was started or completed
+  bool
+  iterate_cmds()
+  {
+    auto num_running = m_num_running;
+    auto num_queued = m_queued.size();
+    if (m_num_running)
+      m_exec->query([this](const xcmd_ptr& xcmd) { running_to_complete(xcmd); });
+    if (!m_queued.empty())
+      start_cmds();
+    return m_num_running != num_running || m_queued.size() != num_queued;
+  }
+
+  // In sw emulation every CU poll is an RPC to the model process, which
+  // also runs the kernels. Back off while no command makes progress so
+  // polling does not compete with the CUs for host cores.  New commands
+  // end the back off early.
+  void
+  backoff()
+  {
+    const unsigned int min_backoff_us = 10;
+    const unsigned int max_backoff_us = 1000;
+    m_backoff_us = m_backoff_us ? std::min(2*m_backoff_us,max_backoff_us) : min_backoff_us;
+
+    std::unique_lock<std::mutex> lk(m_mutex);
+    m_work.wait_for(lk,std::chrono::microseconds(m_backoff_us),[this] { return m_stop || m_num_pending; });
   }
 
   // Wait until something interesting happens
   void
   wait()
   {
+    if (m_num_pending || !m_queued.empty() || m_num_running)
+      return;
+
     std::unique_lock<std::mutex> lk(m_mutex);
-    while (!m_stop && !s_num_pending && m_command_queue.empty())
+    while (!m_stop && !m_num_pending)
       m_work.wait(lk);
 
     if (m_stop) {
-      if (!m_command_queue.empty() || s_num_pending)
+      if (!m_queued.empty() || m_num_pending || m_num_running)
         throw std::runtime_error("software scheduler stopping while there are active commands");
     }
   }
 
-
   // Loop once
   void
   loop()
   {
     wait();
     queue_cmds();
-    iterate_cmds();
+    if (iterate_cmds() || !is_sw_emulation() || !m_num_running)
+      m_backoff_us = 0;
+    else
+      backoff();
+  }
+
+  // Run the scheduler until it is stopped
+  void
+  run()
+  {
+    while (!m_stop)
+      loop();
   }
 
 public:
+  xocl_scheduler(std::unique_ptr<exec_core> exec, unsigned int index)
+    : m_exec(std::move(exec)), m_index(index)
+  {}
+
+  ~xocl_scheduler()
+  {
+    stop();
+  }
+
+  unsigned int
+  get_index() const
+  {
+    return m_index;
+  }
+
+  exec_core*
+  get_exec() const
+  {
+    return m_exec.get();
+  }
 
-  // Wake up the scheduler if it is waiting
+  // Add a new command, wake up the scheduler if it is waiting
   void
-  notify()
+  add(xcmd_ptr xcmd)
   {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_pending.push_back(std::move(xcmd));
+    ++m_num_pending;
     m_work.notify_one();
   }
 
-  // Run the scheduler until it is stopped
+  // Start the scheduler thread, optionally pinned to a cpu
   void
-  run()
+  start(const std::vector<unsigned int>& cpus)
   {
-    while (!m_stop)
-      loop();
+    if (m_thread.joinable())
+      return;
+
+    m_stop = false;
+    m_thread = xrt::thread([this] { run(); });
+    if (!cpus.empty())
+      xrt::set_cpu_affinity(m_thread,cpus[m_index % cpus.size()]);
   }
 
-  // Stop the scheduler
+  // Stop the scheduler thread
   void
   stop()
   {
-    std::lock_guard<std::mutex> lk(m_mutex);
-    m_stop = true;
-    m_work.notify_one();
+    if (!m_thread.joinable())
+      return;
+
+    {
+      std::lock_guard<std::mutex> lk(m_mutex);
+      m_stop = true;
+      m_work.notify_one();
+    }
+    m_thread.join();
   }
 
 };
 
 ////////////////////////////////////////////////////////////////
-// One static scheduler currently on a single thread
-static xocl_scheduler s_global_scheduler;
-static std::thread s_scheduler_thread;
+// Each device has a scheduler with its own execution core and thread
+static std::map<const xrt::device*, std::unique_ptr<xocl_scheduler>> s_device_scheduler;
 static bool s_running=false;
 
-// Each device has a execution core
-static std::map<const xrt::device*, std::unique_ptr<exec_core>> s_device_exec_core;
+// Cpus per Runtime.sws_cpu_affinity, empty if threads are not pinned
+static const std::vector<unsigned int>&
+get_scheduler_cpus()
+{
+  static std::vector<unsigned int> cpus = [] {
+    std::vector<unsigned int> v;
+    auto str = xrt::config::get_sws_cpu_affinity();
+    if (str == "none")
+      return v;
+    std::stringstream ss(str);
+    std::string tok;
+    while (std::getline(ss,tok,','))
+      v.push_back(std::stoul(tok));
+    return v;
+  }();
+  return cpus;
+}
 
-// Thread routine for scheduler loop
+// (Re)create scheduler for device, the device keeps its index
+// for cpu pinning across xclbin loads
 static void
-scheduler_loop()
+init_scheduler(xrt::device* xdev, size_t slots, const std::vector<uint64_t>& cu_amap)
 {
-  s_global_scheduler.run();
+  static unsigned int num_devices = 0;
+  unsigned int index = num_devices;
+  auto itr = s_device_scheduler.find(xdev);
+  if (itr != s_device_scheduler.end()) {
+    index = (*itr).second->get_index();
+    s_device_scheduler.erase(itr);
+  }
+  else
+    ++num_devices;
+
+  auto xs = std::make_unique<xocl_scheduler>(std::make_unique<exec_core>(xdev,slots,cu_amap),index);
+  if (s_running)
+    xs->start(get_scheduler_cpus());
+  s_device_scheduler.insert(std::make_pair(xdev,std::move(xs)));
 }
 
 } // namespace
@@ -811,14 +909,9 @@ schedule(const cmd_ptr& cmd)
 {
   auto device = cmd->get_device();
 
-  auto& exec = s_device_exec_core[device];
-  auto xcmd = xocl_cmd::create(exec.get(),cmd);
-  auto scheduler = exec->get_scheduler();
-
-  std::lock_guard<std::mutex> lk(s_pending_mutex);
-  s_pending_cmds.push_back(xcmd);
-  ++s_num_pending;
-  scheduler->notify();
+  auto& xs = s_device_scheduler[device];
+  auto xcmd = xocl_cmd::create(xs->get_exec(),cmd);
+  xs->add(std::move(xcmd));
 }
 
 void
@@ -827,7 +920,8 @@ start()
   if (s_running)
     throw std::runtime_error("software command scheduler is already started");
 
-  s_scheduler_thread = std::move(xrt::thread(scheduler_loop));
+  for (auto& entry : s_device_scheduler)
+    entry.second->start(get_scheduler_cpus());
   if (threaded_notification)
     notifier = std::move(xrt::thread(xrt::task::worker,std::ref(notify_queue)));
   s_running = true;
@@ -839,8 +933,8 @@ stop()
   if (!s_running)
     return;
 
-  s_global_scheduler.stop();
-  s_scheduler_thread.join();
+  for (auto& entry : s_device_scheduler)
+    entry.second->stop();
 
   if (threaded_notification) {
     // wait for notifier to drain
@@ -865,22 +959,16 @@ init(xrt::device* xdev, const std::vector<uint64_t>& cu_addr_map)
   std::copy(cu_addr_map.begin(),cu_addr_map.end(),std::back_inserter(amap));
   auto slots = ERT_CQ_SIZE / xrt::config::get_ert_slotsize();
   cu_trace_enabled = xrt::config::get_profile();
-  s_device_exec_core.erase(xdev);
-  s_device_exec_core.insert
-    (std::make_pair
-     (xdev,std::make_unique<exec_core>(xdev,&s_global_scheduler,slots,amap)));
+  init_scheduler(xdev,slots,amap);
 }
 
 void
 init(xrt::device* xdev, const axlf* top)
 {
   // create execution core for this device
-  auto slots = ERT_CQ_SIZE / xrt::config::get_ert_slotsize();
+  auto slots = ERT_CQ_SIZE / xrt_core::xclbin::get_ert_slot_size(top,xrt::config::get_ert_slotsize());
   cu_trace_enabled = xrt::config::get_profile();
-  s_device_exec_core.erase(xdev);
-  s_device_exec_core.insert
-    (std::make_pair
-     (xdev,std::make_unique<exec_core>(xdev,&s_global_scheduler,slots,xrt_core::xclbin::get_cus(top))));
+  init_scheduler(xdev,slots,xrt_core::xclbin::get_cus(top));
 }
 
 }} // sws,xrt
@@ -0,0 +1,232 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include "../test_helpers.h"
+
+#include "xrt/device/device.h"
+#include "core/common/memalign.h"
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <iomanip>
+#include <new>
+#include <vector>
+
+using namespace xrt::test;
+
+// Buffer object lifecycle benchmark.
+//
+// For each kind of buffer object, bank, size, and thread count, every
+// thread repeatedly allocates a buffer object, maps it, syncs it both
+// directions, and frees it.  Per operation latency percentiles and
+// operation throughput are printed one line per configuration:
+//
+//   bo kind bank size threads op count ops/s p50us p90us p99us maxus
+//
+// xrt::device::alloc maps host backed buffer objects, so 'alloc'
+// includes the mmap and 'map' is the cost of looking up the mapping.
+// Sizes range from 4 KB to 4 GB, sizes that cannot be allocated in a
+// bank end the size sweep for that bank.
+
+namespace {
+
+enum class bo_kind { ram, devonly, p2p, userptr };
+
+static const char*
+to_string(bo_kind kind)
+{
+  switch (kind) {
+  case bo_kind::ram:     return "ram";
+  case bo_kind::devonly: return "devonly";
+  case bo_kind::p2p:     return "p2p";
+  case bo_kind::userptr: return "userptr";
+  }
+  return "unknown";
+}
+
+enum op { op_alloc, op_map, op_sync_h2d, op_sync_d2h, op_free, op_count };
+static const char* op_names[op_count] = { "alloc", "map", "sync_h2d", "sync_d2h", "free" };
+
+using sample_vector = std::vector<double>; // usecs
+
+struct samples
+{
+  sample_vector ops[op_count];
+};
+
+static double
+elapsed_us(std::chrono::high_resolution_clock::time_point start)
+{
+  auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double,std::micro>(end-start).count();
+}
+
+// Number of lifecycles per thread, fewer for larger sizes
+static size_t
+iterations(size_t size)
+{
+  return std::max<size_t>(4,std::min<size_t>(1000,(256ull<<20)/size));
+}
+
+static samples
+run_lifecycles(xrt::device* device, bo_kind kind, unsigned int bank, size_t size, size_t count)
+{
+  samples s;
+  for (auto& v : s.ops)
+    v.reserve(count);
+
+  void* userptr = nullptr;
+  if (kind==bo_kind::userptr && xrt_core::posix_memalign(&userptr,4096,size))
+    throw std::bad_alloc();
+
+  auto domain = xrt::device::memoryDomain::XRT_DEVICE_RAM;
+  if (kind==bo_kind::devonly)
+    domain = xrt::device::memoryDomain::XRT_DEVICE_ONLY_MEM;
+  else if (kind==bo_kind::p2p)
+    domain = xrt::device::memoryDomain::XRT_DEVICE_ONLY_MEM_P2P;
+  bool host_backed = (kind==bo_kind::ram || kind==bo_kind::userptr);
+
+  try {
+    for (size_t i=0; i<count; ++i) {
+      auto t = std::chrono::high_resolution_clock::now();
+      auto bo = device->alloc(size,domain,bank,userptr);
+      s.ops[op_alloc].push_back(elapsed_us(t));
+
+      t = std::chrono::high_resolution_clock::now();
+      auto data = device->map(bo);
+      s.ops[op_map].push_back(elapsed_us(t));
+      if (host_backed)
+        static_cast<char*>(data)[0] = static_cast<char>(i);
+      device->unmap(bo);
+
+      if (host_backed) {
+        t = std::chrono::high_resolution_clock::now();
+        device->sync(bo,size,0,xrt::device::direction::HOST2DEVICE,false).wait();
+        s.ops[op_sync_h2d].push_back(elapsed_us(t));
+
+        t = std::chrono::high_resolution_clock::now();
+        device->sync(bo,size,0,xrt::device::direction::DEVICE2HOST,false).wait();
+        s.ops[op_sync_d2h].push_back(elapsed_us(t));
+      }
+
+      t = std::chrono::high_resolution_clock::now();
+      bo.reset();
+      s.ops[op_free].push_back(elapsed_us(t));
+    }
+  }
+  catch (...) {
+    std::free(userptr);
+    throw;
+  }
+
+  std::free(userptr);
+  return s;
+}
+
+static void
+report(bo_kind kind, unsigned int bank, size_t size, size_t threads, samples& s, double seconds)
+{
+  for (int o=0; o<op_count; ++o) {
+    auto& v = s.ops[o];
+    if (v.empty())
+      continue;
+    std::sort(v.begin(),v.end());
+    auto pct = [&v](double p) { return v[std::min(v.size()-1,static_cast<size_t>(p*v.size()))]; };
+    std::cout << "bo " << to_string(kind) << " " << bank << " " << size << " " << threads
+              << " " << op_names[o] << " " << v.size()
+              << " " << std::fixed << std::setprecision(1) << v.size()/seconds
+              << " " << pct(0.50) << " " << pct(0.90) << " " << pct(0.99) << " " << v.back()
+              << "\n";
+  }
+}
+
+// Return false if size could not be allocated
+static bool
+run(xrt::device* device, bo_kind kind, unsigned int bank, size_t size, size_t threads)
+{
+  auto count = iterations(size);
+  std::vector<std::future<samples>> futures;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (size_t t=0; t<threads; ++t)
+    futures.push_back(std::async(std::launch::async,run_lifecycles,device,kind,bank,size,count));
+
+  samples all;
+  bool ok = true;
+  for (auto& f : futures) {
+    try {
+      auto s = f.get();
+      for (int o=0; o<op_count; ++o)
+        all.ops[o].insert(all.ops[o].end(),s.ops[o].begin(),s.ops[o].end());
+    }
+    catch (const std::exception&) {
+      ok = false;
+    }
+  }
+
+  if (!ok)
+    return false;
+
+  report(kind,bank,size,threads,all,elapsed_us(start)/1e6);
+  return true;
+}
+
+static void
+run(xrt::device* device)
+{
+  device->open();
+  device->setup(); // this creates the worker threads
+  device->printDeviceInfo(std::cout) << "\n";
+
+  auto banks = std::max<size_t>(1,device->getBankCount());
+  for (auto kind : {bo_kind::ram, bo_kind::devonly, bo_kind::p2p, bo_kind::userptr}) {
+    for (unsigned int bank=0; bank<banks; ++bank) {
+      for (size_t size=4096; size<=(4ull<<30); size<<=2) {
+        bool ok = true;
+        for (size_t threads : {1,4}) {
+          if (!(ok = run(device,kind,bank,size,threads)))
+            break;
+        }
+        if (!ok) {
+          std::cout << "bo " << to_string(kind) << " " << bank << " " << size
+                    << " allocation failed, skipping larger sizes\n";
+          break;
+        }
+      }
+    }
+  }
+
+  device->close();
+}
+
+}
+
+// invoke with --run_test=test_bo_bench
+BOOST_AUTO_TEST_SUITE ( test_bo_bench )
+
+BOOST_AUTO_TEST_CASE ( test_bo_bench1 )
+{
+  auto pred = [](const xrt::hal::device& hal) {
+    return (hal.getDriverLibraryName().find("xcldrv")!=std::string::npos);
+  };
+  auto devices = xrt::test::loadDevices(std::move(pred));
+
+  for (auto& device : devices)
+    run(&device);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
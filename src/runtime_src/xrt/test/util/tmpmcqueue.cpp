@@ -0,0 +1,149 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+////////////////////////////////////////////////////////////////
+// Unit testing and microbenchmark of xrt::task::mpmcqueue in
+// locked (default) and lock-free mode
+////////////////////////////////////////////////////////////////
+#include <boost/test/unit_test.hpp>
+
+#include "xrt/util/task.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE ( test_mpmcqueue )
+
+namespace {
+
+const unsigned int producers = 8;
+const unsigned int consumers = 4;
+const unsigned int tasks_per_producer = 100000;
+
+// Run producers and consumers against queue, return elapsed ms.
+// Every consumed task bumps count, which must match total tasks.
+static double
+run(xrt::task::queue& queue, std::atomic<unsigned long>& count)
+{
+  std::vector<std::thread> workers;
+  for (unsigned int i=0; i<consumers; ++i)
+    workers.push_back(std::thread(xrt::task::worker,std::ref(queue)));
+
+  auto start = std::chrono::high_resolution_clock::now();
+
+  std::vector<std::thread> feeders;
+  for (unsigned int p=0; p<producers; ++p)
+    feeders.push_back(std::thread([&queue,&count] {
+          for (unsigned int t=0; t<tasks_per_producer; ++t)
+            queue.addWork(xrt::task::task([&count]{ ++count; }));
+        }));
+
+  for (auto& t : feeders)
+    t.join();
+
+  while (count < producers*tasks_per_producer)
+    std::this_thread::yield();
+
+  auto end = std::chrono::high_resolution_clock::now();
+
+  queue.stop();
+  for (auto& t : workers)
+    t.join();
+
+  return std::chrono::duration<double,std::milli>(end-start).count();
+}
+
+}
+
+BOOST_AUTO_TEST_CASE( test_mpmcqueue_ptr )
+{
+  xrt::task::mpmcqueue<int*> queue;
+  queue.enable_lockfree(4);
+  BOOST_CHECK_EQUAL(queue.is_lockfree(),true);
+
+  int values[3] = {0,1,2};
+  for (auto& v : values)
+    queue.addWork(&v);
+  BOOST_CHECK_EQUAL(queue.size(),3);
+  for (auto& v : values)
+    BOOST_CHECK_EQUAL(queue.getWork(),&v);
+
+  queue.stop();
+  BOOST_CHECK(queue.getWork()==nullptr);
+}
+
+BOOST_AUTO_TEST_CASE( test_mpmcqueue_overflow )
+{
+  // Full ring spills to the locked queue, nothing is lost
+  xrt::task::mpmcqueue<int*> queue;
+  queue.enable_lockfree(4);
+
+  int values[10] = {0};
+  for (auto& v : values)
+    queue.addWork(&v);
+  BOOST_CHECK_EQUAL(queue.size(),10);
+
+  std::vector<int*> got;
+  for (size_t i=0; i<10; ++i)
+    got.push_back(queue.getWork());
+  std::sort(got.begin(),got.end());
+  for (size_t i=0; i<10; ++i)
+    BOOST_CHECK_EQUAL(got[i],&values[i]);
+  BOOST_CHECK_EQUAL(queue.size(),0);
+
+  queue.stop();
+}
+
+BOOST_AUTO_TEST_CASE( test_mpmcqueue_events )
+{
+  xrt::task::queue queue;
+  queue.enable_lockfree(16);
+  std::thread worker(xrt::task::worker,std::ref(queue));
+
+  std::vector<xrt::task::event<int>> events;
+  for (int i=0; i<100; ++i)
+    events.emplace_back(xrt::task::createF(queue,[](int v){ return v; },i));
+  for (int i=0; i<100; ++i)
+    BOOST_CHECK_EQUAL(events[i].get(),i);
+
+  queue.stop();
+  worker.join();
+}
+
+BOOST_AUTO_TEST_CASE( test_mpmcqueue_bench )
+{
+  std::atomic<unsigned long> locked_count {0};
+  xrt::task::queue locked;
+  auto locked_ms = run(locked,locked_count);
+  BOOST_CHECK_EQUAL(locked_count,producers*tasks_per_producer);
+
+  std::atomic<unsigned long> lockfree_count {0};
+  xrt::task::queue lockfree;
+  lockfree.enable_lockfree(1024);
+  auto lockfree_ms = run(lockfree,lockfree_count);
+  BOOST_CHECK_EQUAL(lockfree_count,producers*tasks_per_producer);
+
+  std::cout << "mpmcqueue " << producers << " producers, " << consumers << " consumers, "
+            << producers*tasks_per_producer << " tasks\n"
+            << "  locked   (ms): " << locked_ms << "\n"
+            << "  lockfree (ms): " << lockfree_ms << "\n";
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,137 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+////////////////////////////////////////////////////////////////
+// Unit testing of xrt::pool and xrt::small_function
+////////////////////////////////////////////////////////////////
+#include <boost/test/unit_test.hpp>
+
+#include "xrt/util/pool.h"
+#include "xrt/util/small_function.h"
+
+#include <array>
+#include <memory>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE ( test_pool )
+
+namespace {
+
+struct pooled
+{
+  char data[200];
+  int value = 0;
+
+  static void*
+  operator new(size_t sz)
+  {
+    return xrt::pool::allocate(sz);
+  }
+
+  static void
+  operator delete(void* ptr, size_t sz)
+  {
+    xrt::pool::deallocate(ptr,sz);
+  }
+};
+
+}
+
+BOOST_AUTO_TEST_CASE( test_pool_reuse )
+{
+  // Freed block is recycled by same thread
+  auto p1 = new pooled;
+  BOOST_CHECK_EQUAL(reinterpret_cast<uintptr_t>(p1) % 64,0);
+  delete p1;
+  auto p2 = new pooled;
+  BOOST_CHECK(p1==p2);
+  delete p2;
+
+  // Steady state allocation is served from thread freelist
+  auto before = xrt::pool::get_stats();
+  for (int i=0; i<1000; ++i)
+    delete new pooled;
+  auto after = xrt::pool::get_stats();
+  BOOST_CHECK_EQUAL(after.thread_hits-before.thread_hits,1000);
+  BOOST_CHECK_EQUAL(after.slabs,before.slabs);
+}
+
+BOOST_AUTO_TEST_CASE( test_pool_threads )
+{
+  // Allocate in one thread, free in another
+  std::vector<pooled*> objs;
+  for (int i=0; i<10000; ++i) {
+    objs.push_back(new pooled);
+    objs.back()->value = i;
+  }
+
+  std::thread t([&objs] {
+      for (int i=0; i<10000; ++i) {
+        BOOST_CHECK_EQUAL(objs[i]->value,i);
+        delete objs[i];
+      }
+    });
+  t.join();
+}
+
+BOOST_AUTO_TEST_CASE( test_pool_allocate_shared )
+{
+  auto sp = std::allocate_shared<pooled>(xrt::pool::allocator<pooled>());
+  sp->value = 42;
+  std::weak_ptr<pooled> wp = sp;
+  sp.reset();
+  BOOST_CHECK(wp.expired());
+
+  // Large requests bypass the pool
+  auto big = xrt::pool::allocate(xrt::pool::max_size+1);
+  xrt::pool::deallocate(big,xrt::pool::max_size+1);
+}
+
+BOOST_AUTO_TEST_CASE( test_small_function )
+{
+  int count = 0;
+  xrt::small_function<void(int)> f;
+  BOOST_CHECK(!f);
+
+  // Local storage
+  f = [&count](int v) { count += v; };
+  f(2);
+  BOOST_CHECK_EQUAL(count,2);
+
+  // Move leaves source empty
+  auto g = std::move(f);
+  BOOST_CHECK(!f);
+  g(3);
+  BOOST_CHECK_EQUAL(count,5);
+
+  // Captures that own memory
+  auto sp = std::make_shared<int>(10);
+  xrt::small_function<int()> h = [sp] { return *sp; };
+  BOOST_CHECK_EQUAL(sp.use_count(),2);
+  BOOST_CHECK_EQUAL(h(),10);
+  h = nullptr;
+  BOOST_CHECK_EQUAL(sp.use_count(),1);
+
+  // Too large for local storage
+  std::array<char,128> big;
+  big.fill(1);
+  xrt::small_function<int()> b = [big] { return big[127]; };
+  auto c = std::move(b);
+  BOOST_CHECK_EQUAL(c(),1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,160 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "memcpy.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+# include <immintrin.h>
+# define XRT_COPY_NT 1
+#endif
+
+namespace {
+
+// Below this std::memcpy is as fast and leaves the data in cache for
+// whoever touches it next
+constexpr size_t stream_threshold = 1 << 20;
+
+// Copies are split over threads with at least this much per thread
+constexpr size_t thread_chunk = 64 << 20;
+constexpr unsigned int max_threads = 4;
+
+using copy_fn = void (*)(char*, const char*, size_t);
+
+static void
+plain_copy(char* dst, const char* src, size_t sz)
+{
+  std::memcpy(dst,src,sz);
+}
+
+#ifdef XRT_COPY_NT
+// Copy the unaligned head with memcpy so that the streaming stores
+// are aligned, then the tail after the fence
+static inline void
+align_head(char*& dst, const char*& src, size_t& sz, size_t align)
+{
+  auto head = std::min(sz,(align - (reinterpret_cast<uintptr_t>(dst) & (align-1))) & (align-1));
+  std::memcpy(dst,src,head);
+  dst += head;
+  src += head;
+  sz -= head;
+}
+
+__attribute__((target("avx2")))
+static void
+avx2_copy(char* dst, const char* src, size_t sz)
+{
+  align_head(dst,src,sz,32);
+  for (; sz >= 128; sz -= 128, dst += 128, src += 128) {
+    auto s = reinterpret_cast<const __m256i*>(src);
+    auto d = reinterpret_cast<__m256i*>(dst);
+    __m256i r0 = _mm256_loadu_si256(s);
+    __m256i r1 = _mm256_loadu_si256(s+1);
+    __m256i r2 = _mm256_loadu_si256(s+2);
+    __m256i r3 = _mm256_loadu_si256(s+3);
+    _mm256_stream_si256(d,r0);
+    _mm256_stream_si256(d+1,r1);
+    _mm256_stream_si256(d+2,r2);
+    _mm256_stream_si256(d+3,r3);
+  }
+  _mm_sfence();
+  std::memcpy(dst,src,sz);
+}
+
+__attribute__((target("avx512f")))
+static void
+avx512_copy(char* dst, const char* src, size_t sz)
+{
+  align_head(dst,src,sz,64);
+  for (; sz >= 256; sz -= 256, dst += 256, src += 256) {
+    auto s = reinterpret_cast<const __m512i*>(src);
+    auto d = reinterpret_cast<__m512i*>(dst);
+    __m512i r0 = _mm512_loadu_si512(s);
+    __m512i r1 = _mm512_loadu_si512(s+1);
+    __m512i r2 = _mm512_loadu_si512(s+2);
+    __m512i r3 = _mm512_loadu_si512(s+3);
+    _mm512_stream_si512(d,r0);
+    _mm512_stream_si512(d+1,r1);
+    _mm512_stream_si512(d+2,r2);
+    _mm512_stream_si512(d+3,r3);
+  }
+  _mm_sfence();
+  std::memcpy(dst,src,sz);
+}
+#endif
+
+static copy_fn
+select_copy()
+{
+#ifdef XRT_COPY_NT
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+    return avx512_copy;
+  if (__builtin_cpu_supports("avx2"))
+    return avx2_copy;
+#endif
+  return plain_copy;
+}
+
+static unsigned int
+copy_threads(size_t sz)
+{
+  static unsigned int hw = std::max(1u,std::thread::hardware_concurrency());
+  return static_cast<unsigned int>(std::min<size_t>({max_threads, hw, sz / thread_chunk}));
+}
+
+} // namespace
+
+namespace xrt {
+
+void*
+stream_copy(void* dst, const void* src, size_t sz)
+{
+  if (sz < stream_threshold)
+    return std::memcpy(dst,src,sz);
+
+  static copy_fn copy = select_copy();
+  auto d = static_cast<char*>(dst);
+  auto s = static_cast<const char*>(src);
+
+  auto nthreads = copy_threads(sz);
+  if (nthreads <= 1) {
+    copy(d,s,sz);
+    return dst;
+  }
+
+  // Chunks are cache line multiples, the calling thread takes the
+  // first chunk and any remainder goes with the last
+  size_t chunk = (sz / nthreads) & ~size_t(63);
+  std::vector<std::thread> workers;
+  workers.reserve(nthreads-1);
+  for (unsigned int i = 1; i < nthreads; ++i) {
+    size_t offset = i * chunk;
+    size_t len = (i == nthreads-1) ? sz - offset : chunk;
+    workers.emplace_back(copy,d+offset,s+offset,len);
+  }
+  copy(d,s,chunk);
+  for (auto& t : workers)
+    t.join();
+  return dst;
+}
+
+} // xrt
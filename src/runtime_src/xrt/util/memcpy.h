@@ -0,0 +1,41 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef xrt_util_memcpy_h_
+#define xrt_util_memcpy_h_
+
+#include <cstddef>
+
+namespace xrt {
+
+/**
+ * Copy between host buffers and mapped buffer objects
+ *
+ * Same contract as std::memcpy.  Small copies are std::memcpy, large
+ * copies use non-temporal stores (AVX-512 or AVX2, picked at run time
+ * from the CPU) so that staging a buffer does not evict the
+ * application's working set from the caches.  Very large copies are
+ * split over a few threads.
+ *
+ * @return
+ *   dst
+ */
+void*
+stream_copy(void* dst, const void* src, size_t sz);
+
+} // xrt
+
+#endif
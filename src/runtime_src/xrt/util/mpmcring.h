@@ -0,0 +1,310 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef xrt_util_mpmcring_h_
+#define xrt_util_mpmcring_h_
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <climits>
+#include <new>
+
+#include "core/common/memalign.h"
+
+#ifdef __linux__
+# include <linux/futex.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+#endif
+
+namespace xrt { namespace task {
+
+namespace detail {
+
+/**
+ * Park calling thread while *addr == expected.
+ *
+ * Spurious wakeups are allowed, callers must re-check their condition.
+ * On platforms without futex the thread simply yields.
+ */
+inline void
+futex_wait(std::atomic<uint32_t>* addr, uint32_t expected)
+{
+#ifdef __linux__
+  static_assert(sizeof(std::atomic<uint32_t>)==sizeof(uint32_t),"bad atomic size");
+  syscall(SYS_futex,reinterpret_cast<uint32_t*>(addr),FUTEX_WAIT_PRIVATE,expected,nullptr,nullptr,0);
+#else
+  if (addr->load()==expected)
+    std::this_thread::yield();
+#endif
+}
+
+inline void
+futex_wake(std::atomic<uint32_t>* addr, int count)
+{
+#ifdef __linux__
+  syscall(SYS_futex,reinterpret_cast<uint32_t*>(addr),FUTEX_WAKE_PRIVATE,count,nullptr,nullptr,0);
+#endif
+}
+
+} // detail
+
+/**
+ * Bounded lock-free multiple producer / multiple consumer ring buffer
+ *
+ * Each slot carries a sequence number that tells producers and
+ * consumers whether the slot is free to be written or ready to be
+ * read.  Enqueue and dequeue claim a slot with a single CAS on the
+ * tail or head index, so no thread ever holds a lock on the queue.
+ *
+ * Consumers that find the ring empty park on a futex, producers only
+ * issue the wake system call when some consumer is actually parked.
+ * Producers that find the ring full yield in push() until a slot frees
+ * up, or use try_push_notify() and handle a full ring themselves.
+ *
+ * Capacity is rounded up to a power of 2.  The ring is over-aligned,
+ * allocate it with new, which is aligned by the class operator new
+ * also in C++14.
+ */
+template <typename T>
+class mpmcring
+{
+  struct cell
+  {
+    std::atomic<size_t> seq;
+    T data;
+  };
+
+  // keep indices on separate cache lines to avoid false sharing
+  struct alignas(64) index
+  {
+    std::atomic<size_t> value {0};
+  };
+
+  std::unique_ptr<cell[]> m_cells;
+  size_t m_mask;
+  index m_head; // next slot to dequeue
+  index m_tail; // next slot to enqueue
+
+  alignas(64) std::atomic<uint32_t> m_signal {0};
+  std::atomic<uint32_t> m_waiters {0};
+  std::atomic<bool> m_stop {false};
+
+  static size_t
+  round_up(size_t capacity)
+  {
+    size_t sz = 2;
+    while (sz < capacity)
+      sz <<= 1;
+    return sz;
+  }
+
+  void
+  wake(int count)
+  {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_waiters.load(std::memory_order_relaxed)) {
+      m_signal.fetch_add(1,std::memory_order_release);
+      detail::futex_wake(&m_signal,count);
+    }
+  }
+
+public:
+  explicit
+  mpmcring(size_t capacity)
+    : m_cells(new cell[round_up(capacity)]), m_mask(round_up(capacity)-1)
+  {
+    for (size_t i=0; i<=m_mask; ++i)
+      m_cells[i].seq.store(i,std::memory_order_relaxed);
+  }
+
+  mpmcring(const mpmcring&) = delete;
+  mpmcring& operator=(const mpmcring&) = delete;
+
+  static void*
+  operator new(size_t sz)
+  {
+    void* ptr = nullptr;
+    if (xrt_core::posix_memalign(&ptr,alignof(mpmcring),sz))
+      throw std::bad_alloc();
+    return ptr;
+  }
+
+  static void
+  operator delete(void* ptr)
+  {
+    free(ptr);
+  }
+
+  /**
+   * Non blocking enqueue
+   *
+   * @return
+   *   false if ring is full, in which case @t is left untouched
+   */
+  bool
+  try_push(T& t)
+  {
+    size_t pos = m_tail.value.load(std::memory_order_relaxed);
+    while (true) {
+      cell* c = &m_cells[pos & m_mask];
+      auto seq = c->seq.load(std::memory_order_acquire);
+      auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff==0) {
+        if (m_tail.value.compare_exchange_weak(pos,pos+1,std::memory_order_relaxed)) {
+          c->data = std::move(t);
+          c->seq.store(pos+1,std::memory_order_release);
+          return true;
+        }
+      }
+      else if (diff < 0)
+        return false;
+      else
+        pos = m_tail.value.load(std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * Non blocking dequeue
+   *
+   * @return
+   *   false if ring is empty
+   */
+  bool
+  try_pop(T& t)
+  {
+    size_t pos = m_head.value.load(std::memory_order_relaxed);
+    while (true) {
+      cell* c = &m_cells[pos & m_mask];
+      auto seq = c->seq.load(std::memory_order_acquire);
+      auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos+1);
+      if (diff==0) {
+        if (m_head.value.compare_exchange_weak(pos,pos+1,std::memory_order_relaxed)) {
+          t = std::move(c->data);
+          c->seq.store(pos+m_mask+1,std::memory_order_release);
+          return true;
+        }
+      }
+      else if (diff < 0)
+        return false;
+      else
+        pos = m_head.value.load(std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * Non blocking enqueue, wake a parked consumer on success
+   *
+   * @return
+   *   false if ring is full, in which case @t is left untouched
+   */
+  bool
+  try_push_notify(T& t)
+  {
+    if (!try_push(t))
+      return false;
+    wake(1);
+    return true;
+  }
+
+  /**
+   * Enqueue, yield while the ring is full
+   *
+   * Never returns if the ring stays full, e.g. when the only consumer
+   * is the calling thread.
+   */
+  void
+  push(T&& t)
+  {
+    while (!try_push(t))
+      std::this_thread::yield();
+    wake(1);
+  }
+
+  /**
+   * Dequeue, park on futex while the ring is empty
+   *
+   * @return
+   *   false if the ring was stopped before an element became available
+   */
+  bool
+  pop(T& t)
+  {
+    while (true) {
+      if (try_pop(t))
+        return true;
+      if (m_stop.load(std::memory_order_acquire))
+        return false;
+
+      auto key = m_signal.load(std::memory_order_acquire);
+      m_waiters.fetch_add(1,std::memory_order_seq_cst);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (try_pop(t)) {
+        m_waiters.fetch_sub(1,std::memory_order_relaxed);
+        return true;
+      }
+      if (m_stop.load(std::memory_order_acquire)) {
+        m_waiters.fetch_sub(1,std::memory_order_relaxed);
+        return false;
+      }
+      detail::futex_wait(&m_signal,key);
+      m_waiters.fetch_sub(1,std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * Approximate number of elements in ring
+   */
+  size_t
+  size() const
+  {
+    auto tail = m_tail.value.load(std::memory_order_relaxed);
+    auto head = m_head.value.load(std::memory_order_relaxed);
+    return tail > head ? tail - head : 0;
+  }
+
+  size_t
+  capacity() const
+  {
+    return m_mask + 1;
+  }
+
+  /**
+   * Stop the ring and release all parked consumers
+   */
+  void
+  stop()
+  {
+    m_stop.store(true,std::memory_order_release);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    m_signal.fetch_add(1,std::memory_order_release);
+    detail::futex_wake(&m_signal,INT_MAX);
+  }
+
+  bool
+  stopped() const
+  {
+    return m_stop.load(std::memory_order_acquire);
+  }
+};
+
+}} // task,xrt
+
+#endif
@@ -0,0 +1,278 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "pool.h"
+
+#include "core/common/memalign.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <set>
+
+namespace {
+
+using namespace xrt::pool;
+
+static const std::size_t granule = 64;
+static const std::size_t num_classes = max_size/granule;
+
+// Blocks moved between a thread and the depot at a time, and the
+// freelist length at which a thread gives a batch back
+static const std::size_t batch_size = 32;
+static const std::size_t thread_limit = 2*batch_size;
+
+// Minimum slab size, a slab has at least batch_size blocks
+static const std::size_t slab_bytes = 64*1024;
+
+// Freed blocks are linked through their first word
+struct block
+{
+  block* next;
+};
+
+struct freelist
+{
+  block* head = nullptr;
+  std::size_t count = 0;
+
+  void
+  push(block* b)
+  {
+    b->next = head;
+    head = b;
+    ++count;
+  }
+
+  block*
+  pop()
+  {
+    auto b = head;
+    head = b->next;
+    --count;
+    return b;
+  }
+};
+
+// Counters of one thread, written only by the owning thread and read
+// by any thread collecting stats
+struct thread_stats
+{
+  std::atomic<unsigned long> thread_hits {0};
+  std::atomic<unsigned long> depot_hits {0};
+  std::atomic<unsigned long> slabs {0};
+  std::atomic<unsigned long> large {0};
+};
+
+inline void
+increment(std::atomic<unsigned long>& counter)
+{
+  // single writer, no need for an atomic read-modify-write
+  counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+static void
+add_stats(stats& to, const thread_stats& from)
+{
+  to.thread_hits += from.thread_hits.load(std::memory_order_relaxed);
+  to.depot_hits += from.depot_hits.load(std::memory_order_relaxed);
+  to.slabs += from.slabs.load(std::memory_order_relaxed);
+  to.large += from.large.load(std::memory_order_relaxed);
+}
+
+struct thread_cache;
+
+// The depot is never destroyed, blocks can be freed during static
+// destruction by objects that outlive this translation unit
+struct depot_type
+{
+  std::mutex mutex;
+  std::array<freelist,num_classes> lists;
+  std::set<thread_cache*> registry;
+  stats retired;  // stats from exited threads
+};
+
+static depot_type&
+get_depot()
+{
+  static auto depot = new depot_type;
+  return *depot;
+}
+
+// Set when the calling thread's cache has been destroyed, frees
+// after that point go directly to the depot
+static thread_local bool t_exited = false;
+
+// Per thread freelists and counters.  The freelists are only touched
+// by the owning thread, the registry is used to collect counters.
+struct thread_cache
+{
+  std::array<freelist,num_classes> lists;
+  thread_stats counters;
+
+  thread_cache()
+  {
+    auto& depot = get_depot();
+    std::lock_guard<std::mutex> lk(depot.mutex);
+    depot.registry.insert(this);
+  }
+
+  // Return freelists to the depot when the thread exits
+  ~thread_cache()
+  {
+    auto& depot = get_depot();
+    std::lock_guard<std::mutex> lk(depot.mutex);
+    depot.registry.erase(this);
+    add_stats(depot.retired,counters);
+    for (std::size_t idx=0; idx<num_classes; ++idx) {
+      auto& list = lists[idx];
+      while (list.head)
+        depot.lists[idx].push(list.pop());
+    }
+    t_exited = true;
+  }
+};
+
+static thread_cache&
+get_thread_cache()
+{
+  static thread_local thread_cache tc;
+  return tc;
+}
+
+static std::size_t
+size_class(std::size_t sz)
+{
+  return sz ? (sz-1)/granule : 0;
+}
+
+// Carve a new slab for size class into list, called with depot mutex held
+static void
+add_slab(freelist& list, std::size_t idx)
+{
+  auto bsz = (idx+1)*granule;
+  auto num = std::max(slab_bytes/bsz,batch_size);
+  void* slab = nullptr;
+  if (xrt_core::posix_memalign(&slab,granule,num*bsz))
+    throw std::bad_alloc();
+  auto data = static_cast<char*>(slab);
+  for (std::size_t i=num; i>0; --i)
+    list.push(reinterpret_cast<block*>(data+(i-1)*bsz));
+}
+
+// Refill thread freelist with a batch from the depot
+static void
+refill(thread_cache& tc, std::size_t idx)
+{
+  auto& depot = get_depot();
+  auto& from = depot.lists[idx];
+  auto& to = tc.lists[idx];
+  std::lock_guard<std::mutex> lk(depot.mutex);
+  if (from.count < batch_size) {
+    add_slab(from,idx);
+    increment(tc.counters.slabs);
+  }
+  for (std::size_t i=0; i<batch_size; ++i)
+    to.push(from.pop());
+}
+
+// Return a batch from thread freelist to the depot
+static void
+drain(thread_cache& tc, std::size_t idx)
+{
+  auto& depot = get_depot();
+  auto& from = tc.lists[idx];
+  auto& to = depot.lists[idx];
+  std::lock_guard<std::mutex> lk(depot.mutex);
+  for (std::size_t i=0; i<batch_size; ++i)
+    to.push(from.pop());
+}
+
+} // namespace
+
+namespace xrt { namespace pool {
+
+void*
+allocate(std::size_t sz)
+{
+  if (sz > max_size || t_exited) {
+    if (sz > max_size) {
+      if (!t_exited)
+        increment(get_thread_cache().counters.large);
+      return ::operator new(sz);
+    }
+    auto& depot = get_depot();
+    auto idx = size_class(sz);
+    std::lock_guard<std::mutex> lk(depot.mutex);
+    if (!depot.lists[idx].count) {
+      add_slab(depot.lists[idx],idx);
+      ++depot.retired.slabs;
+    }
+    return depot.lists[idx].pop();
+  }
+
+  auto& tc = get_thread_cache();
+  auto idx = size_class(sz);
+  auto& list = tc.lists[idx];
+  if (list.head) {
+    increment(tc.counters.thread_hits);
+    return list.pop();
+  }
+
+  increment(tc.counters.depot_hits);
+  refill(tc,idx);
+  return list.pop();
+}
+
+void
+deallocate(void* ptr, std::size_t sz)
+{
+  if (!ptr)
+    return;
+
+  if (sz > max_size) {
+    ::operator delete(ptr);
+    return;
+  }
+
+  auto idx = size_class(sz);
+  if (t_exited) {
+    auto& depot = get_depot();
+    std::lock_guard<std::mutex> lk(depot.mutex);
+    depot.lists[idx].push(static_cast<block*>(ptr));
+    return;
+  }
+
+  auto& tc = get_thread_cache();
+  auto& list = tc.lists[idx];
+  list.push(static_cast<block*>(ptr));
+  if (list.count > thread_limit)
+    drain(tc,idx);
+}
+
+stats
+get_stats()
+{
+  auto& depot = get_depot();
+  std::lock_guard<std::mutex> lk(depot.mutex);
+  stats s = depot.retired;
+  for (auto tc : depot.registry)
+    add_stats(s,tc->counters);
+  return s;
+}
+
+}} // pool,xrt
@@ -0,0 +1,121 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef xrt_util_pool_h_
+#define xrt_util_pool_h_
+
+#include <cstddef>
+#include <new>
+
+namespace xrt { namespace pool {
+
+/**
+ * Slab pool for small, frequently allocated runtime objects
+ *
+ * Requests are rounded up to a size class (multiple of 64 bytes) and
+ * served from slabs carved into blocks of that size.  Freed blocks
+ * go to a per thread freelist from which the same thread allocates
+ * without locking.  Only when a thread's freelist runs empty or
+ * grows too long is a batch of blocks exchanged with a central
+ * depot under a lock.  Slabs are never returned to the system.
+ *
+ * Requests larger than max_size are forwarded to ::operator new.
+ * Blocks are aligned to 64 bytes.
+ *
+ * For a unit test live example see xrt/test/util/tpool.cpp
+ */
+static constexpr std::size_t max_size = 1024;
+
+/**
+ * Allocate a block of at least @sz bytes
+ *
+ * Throws std::bad_alloc if memory cannot be allocated
+ */
+void*
+allocate(std::size_t sz);
+
+/**
+ * Return a block to the pool
+ *
+ * @sz must be the size that was passed to allocate()
+ */
+void
+deallocate(void* ptr, std::size_t sz);
+
+/**
+ * Pool counters accumulated over all threads
+ *
+ * @thread_hits: blocks served from calling thread's freelist
+ * @depot_hits: blocks served from a batch taken from the depot
+ * @slabs: slabs allocated from the system
+ * @large: requests forwarded to ::operator new
+ */
+struct stats
+{
+  unsigned long thread_hits = 0;
+  unsigned long depot_hits = 0;
+  unsigned long slabs = 0;
+  unsigned long large = 0;
+};
+
+stats
+get_stats();
+
+/**
+ * Allocator for use with std::allocate_shared and std containers
+ *
+ * auto cmd = std::allocate_shared<my_command>(xrt::pool::allocator<my_command>(),...);
+ */
+template <typename T>
+struct allocator
+{
+  using value_type = T;
+
+  allocator() = default;
+
+  template <typename U>
+  allocator(const allocator<U>&) {}
+
+  T*
+  allocate(std::size_t num)
+  {
+    return static_cast<T*>(pool::allocate(num*sizeof(T)));
+  }
+
+  void
+  deallocate(T* p, std::size_t num)
+  {
+    pool::deallocate(p,num*sizeof(T));
+  }
+};
+
+template <typename T, typename U>
+inline bool
+operator==(const allocator<T>&, const allocator<U>&)
+{
+  return true;
+}
+
+template <typename T, typename U>
+inline bool
+operator!=(const allocator<T>&, const allocator<U>&)
+{
+  return false;
+}
+
+}} // pool,xrt
+
+#endif
@@ -0,0 +1,230 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef xrt_util_small_function_h_
+#define xrt_util_small_function_h_
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <functional>
+
+namespace xrt {
+
+template <typename Signature, std::size_t Capacity = 56>
+class small_function;
+
+/**
+ * Move only polymorphic function wrapper with inline storage
+ *
+ * Unlike std::function, which heap allocates every callable that
+ * is not trivially copyable and at most two words in size, a
+ * small_function stores any nothrow movable callable of up to
+ * Capacity bytes inside the object itself.  Larger callables are
+ * heap allocated.  The default capacity fits a lambda capturing
+ * seven pointer sized values.
+ *
+ * For a unit test live example see xrt/test/util/tpool.cpp
+ */
+template <typename R, typename ...Args, std::size_t Capacity>
+class small_function<R(Args...),Capacity>
+{
+  using storage_type = typename std::aligned_storage<Capacity,alignof(void*)>::type;
+
+  // Type erased operations on the stored callable
+  struct ops_type
+  {
+    R (*invoke)(storage_type&, Args&&...);
+    void (*move)(storage_type& to, storage_type& from);
+    void (*destroy)(storage_type&);
+  };
+
+  template <typename F>
+  struct is_local
+  {
+    static constexpr bool value =
+      sizeof(F) <= Capacity
+      && alignof(void*) % alignof(F) == 0
+      && std::is_nothrow_move_constructible<F>::value;
+  };
+
+  struct local
+  {
+    template <typename F>
+    static F&
+    get(storage_type& s)
+    {
+      return *reinterpret_cast<F*>(&s);
+    }
+
+    template <typename F>
+    static R invoke(storage_type& s, Args&&... args)
+    {
+      return get<F>(s)(std::forward<Args>(args)...);
+    }
+
+    template <typename F>
+    static void move(storage_type& to, storage_type& from)
+    {
+      new (&to) F(std::move(get<F>(from)));
+      get<F>(from).~F();
+    }
+
+    template <typename F>
+    static void destroy(storage_type& s)
+    {
+      get<F>(s).~F();
+    }
+  };
+
+  struct remote
+  {
+    template <typename F>
+    static F*&
+    get(storage_type& s)
+    {
+      return *reinterpret_cast<F**>(&s);
+    }
+
+    template <typename F>
+    static R invoke(storage_type& s, Args&&... args)
+    {
+      return (*get<F>(s))(std::forward<Args>(args)...);
+    }
+
+    template <typename F>
+    static void move(storage_type& to, storage_type& from)
+    {
+      new (&to) F*(get<F>(from));
+    }
+
+    template <typename F>
+    static void destroy(storage_type& s)
+    {
+      delete get<F>(s);
+    }
+  };
+
+  template <typename F, typename Impl>
+  static const ops_type*
+  get_ops()
+  {
+    static const ops_type ops = {
+      &Impl::template invoke<F>, &Impl::template move<F>, &Impl::template destroy<F>
+    };
+    return &ops;
+  }
+
+  template <typename F>
+  void
+  init(F&& f, std::true_type)
+  {
+    using fn_type = typename std::decay<F>::type;
+    new (&m_storage) fn_type(std::forward<F>(f));
+    m_ops = get_ops<fn_type,local>();
+  }
+
+  template <typename F>
+  void
+  init(F&& f, std::false_type)
+  {
+    using fn_type = typename std::decay<F>::type;
+    new (&m_storage) fn_type*(new fn_type(std::forward<F>(f)));
+    m_ops = get_ops<fn_type,remote>();
+  }
+
+  void
+  reset()
+  {
+    if (m_ops)
+      m_ops->destroy(m_storage);
+    m_ops = nullptr;
+  }
+
+  storage_type m_storage;
+  const ops_type* m_ops = nullptr;
+
+public:
+  small_function()
+  {}
+
+  small_function(std::nullptr_t)
+  {}
+
+  template <typename F,
+            typename = typename std::enable_if<
+              !std::is_same<typename std::decay<F>::type,small_function>::value>::type>
+  small_function(F&& f)
+  {
+    using fn_type = typename std::decay<F>::type;
+    init(std::forward<F>(f),std::integral_constant<bool,is_local<fn_type>::value>());
+  }
+
+  small_function(small_function&& rhs) noexcept
+  {
+    if (rhs.m_ops) {
+      rhs.m_ops->move(m_storage,rhs.m_storage);
+      std::swap(m_ops,rhs.m_ops);
+    }
+  }
+
+  small_function&
+  operator=(small_function&& rhs) noexcept
+  {
+    if (this != &rhs) {
+      reset();
+      if (rhs.m_ops) {
+        rhs.m_ops->move(m_storage,rhs.m_storage);
+        std::swap(m_ops,rhs.m_ops);
+      }
+    }
+    return *this;
+  }
+
+  small_function&
+  operator=(std::nullptr_t)
+  {
+    reset();
+    return *this;
+  }
+
+  small_function(const small_function&) = delete;
+  small_function& operator=(const small_function&) = delete;
+
+  ~small_function()
+  {
+    reset();
+  }
+
+  explicit
+  operator bool() const
+  {
+    return m_ops != nullptr;
+  }
+
+  R
+  operator() (Args... args)
+  {
+    if (!m_ops)
+      throw std::bad_function_call();
+    return m_ops->invoke(m_storage,std::forward<Args>(args)...);
+  }
+};
+
+} // xrt
+
+#endif
@@ -19,12 +19,15 @@
 
 #include "xrt/util/time.h"
 #include "xrt/util/debug.h"
+#include "xrt/util/mpmcring.h"
 #include "xrt/config.h"
 
 #include <future>
 #include <functional>
 #include <chrono>
 #include <queue>
+#include <atomic>
+#include <memory>
 #include <mutex>
 #include <condition_variable>
 #include <iostream>
@@ -103,6 +106,12 @@ public:
  *
  * This code is not specifically tied to task::task, but we keep
  * the defintion here to make task.h stand-alone
+ *
+ * By default the queue is an unbounded std::queue protected by a
+ * mutex.  Calling enable_lockfree() before the queue is used switches
+ * the queue to a bounded lock-free ring buffer (see mpmcring.h).  When
+ * the ring is full, tasks spill to the locked queue so that the queue
+ * stays unbounded and a producer never waits on its own consumer.
  */
 template <typename Task>
 class mpmcqueue
@@ -110,6 +119,8 @@ class mpmcqueue
   std::queue<Task> m_tasks;
   mutable std::mutex m_mutex;
   std::condition_variable m_work;
+  std::unique_ptr<mpmcring<Task>> m_ring;
+  std::atomic<size_t> m_overflow {0}; // tasks spilled from full ring
   bool m_stop = false;
   unsigned long tp = 0;       // time point when last task consumed
   unsigned long waittime = 0; // wait time from tp to next task avail
@@ -122,9 +133,56 @@ public:
     : debug(dbg)
   {}
 
+  /**
+   * Switch to lock-free ring buffer of specified capacity
+   *
+   * Must be called before any producer or consumer uses the queue,
+   * it is a no-op if the queue already has work.
+   */
+  void
+  enable_lockfree(size_t capacity)
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    if (!m_ring && m_tasks.empty() && !m_stop)
+      m_ring.reset(new mpmcring<Task>(capacity));
+  }
+
+  bool
+  is_lockfree() const
+  {
+    return m_ring!=nullptr;
+  }
+
+private:
+  template <typename T>
+  bool
+  pop_overflow(T& task)
+  {
+    if (!m_overflow.load(std::memory_order_acquire))
+      return false;
+    std::lock_guard<std::mutex> lk(m_mutex);
+    if (m_tasks.empty())
+      return false;
+    task = std::move(m_tasks.front());
+    m_tasks.pop();
+    m_overflow.fetch_sub(1,std::memory_order_relaxed);
+    return true;
+  }
+
+public:
+
   void
   addWork(Task&& t)
   {
+    if (m_ring) {
+      if (!m_ring->try_push_notify(t)) {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        m_tasks.push(std::move(t));
+        m_overflow.fetch_add(1,std::memory_order_release);
+      }
+      return;
+    }
+
     std::lock_guard<std::mutex> lk(m_mutex);
     m_tasks.push(std::move(t));
     if (debug && tp) {
@@ -140,6 +198,19 @@ public:
   Task
   getWork()
   {
+    if (m_ring) {
+      // Spilled tasks are taken before parking, a task spills only
+      // while the ring is full so consumers are not parked then
+      Task task;
+      if (m_ring->stopped())
+        return Task();
+      if (m_ring->try_pop(task) || pop_overflow(task))
+        return task;
+      if (!m_ring->pop(task) || m_ring->stopped())
+        return Task();
+      return task;
+    }
+
     std::unique_lock<std::mutex> lk(m_mutex);
     while (!m_stop && m_tasks.empty()) {
       m_work.wait(lk);
@@ -159,6 +230,9 @@ public:
   size_t
   size() const
   {
+    if (m_ring)
+      return m_ring->size() + m_overflow.load(std::memory_order_relaxed);
+
     std::lock_guard<std::mutex> lk(m_mutex);
     return m_tasks.size();
   }
@@ -166,6 +240,9 @@ public:
   void
   stop()
   {
+    if (m_ring)
+      m_ring->stop();
+
     std::lock_guard<std::mutex> lk(m_mutex);
     m_stop=true;
     m_work.notify_all();
@@ -184,13 +261,56 @@ class mpmcqueue<Task*>
   std::queue<Task*> m_tasks;
   mutable std::mutex m_mutex;
   std::condition_variable m_work;
+  std::unique_ptr<mpmcring<Task*>> m_ring;
+  std::atomic<size_t> m_overflow {0}; // tasks spilled from full ring
   bool m_stop;
 public:
   mpmcqueue() : m_stop(false) {}
 
+  void
+  enable_lockfree(size_t capacity)
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    if (!m_ring && m_tasks.empty() && !m_stop)
+      m_ring.reset(new mpmcring<Task*>(capacity));
+  }
+
+  bool
+  is_lockfree() const
+  {
+    return m_ring!=nullptr;
+  }
+
+private:
+  template <typename T>
+  bool
+  pop_overflow(T& task)
+  {
+    if (!m_overflow.load(std::memory_order_acquire))
+      return false;
+    std::lock_guard<std::mutex> lk(m_mutex);
+    if (m_tasks.empty())
+      return false;
+    task = std::move(m_tasks.front());
+    m_tasks.pop();
+    m_overflow.fetch_sub(1,std::memory_order_relaxed);
+    return true;
+  }
+
+public:
+
   void
   addWork(Task* t)
   {
+    if (m_ring) {
+      if (!m_ring->try_push_notify(t)) {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        m_tasks.push(t);
+        m_overflow.fetch_add(1,std::memory_order_release);
+      }
+      return;
+    }
+
     std::lock_guard<std::mutex> lk(m_mutex);
     m_tasks.push(t);
     m_work.notify_one();
@@ -199,6 +319,17 @@ public:
   Task*
   getWork()
   {
+    if (m_ring) {
+      Task* task = nullptr;
+      if (m_ring->stopped())
+        return nullptr;
+      if (m_ring->try_pop(task) || pop_overflow(task))
+        return task;
+      if (!m_ring->pop(task) || m_ring->stopped())
+        return nullptr;
+      return task;
+    }
+
     std::unique_lock<std::mutex> lk(m_mutex);
     while (!m_stop && m_tasks.empty()) {
       m_work.wait(lk);
@@ -215,6 +346,9 @@ public:
   size_t
   size() const
   {
+    if (m_ring)
+      return m_ring->size() + m_overflow.load(std::memory_order_relaxed);
+
     std::lock_guard<std::mutex> lk(m_mutex);
     return m_tasks.size();
   }
@@ -222,6 +356,9 @@ public:
   void
   stop()
   {
+    if (m_ring)
+      m_ring->stop();
+
     std::lock_guard<std::mutex> lk(m_mutex);
     m_stop=true;
     m_work.notify_all();
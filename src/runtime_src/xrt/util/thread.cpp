@@ -21,6 +21,8 @@
 
 #include <thread>
 #include <iostream>
+#include <fstream>
+#include <string>
 
 #include <boost/algorithm/string/trim.hpp>
 #include <boost/tokenizer.hpp>
@@ -132,6 +134,64 @@ set_cpu_affinity(std::thread& thread)
   }
 }
 
+// Parse sysfs node cpulist, e.g. "0-7,16-23"
+static bool
+get_numa_cpuset(int node, cpu_set_t& cpuset)
+{
+  std::ifstream ifs("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+  std::string cpus;
+  if (!std::getline(ifs,cpus))
+    return false;
+
+  using tokenizer=boost::tokenizer<boost::char_separator<char> >;
+  boost::char_separator<char> sep(", \n");
+  auto max_cpus = std::thread::hardware_concurrency();
+  bool found = false;
+  CPU_ZERO(&cpuset);
+  for (auto& tok : tokenizer(cpus,sep)) {
+    auto dash = tok.find('-');
+    auto first = std::stoul(tok.substr(0,dash));
+    auto last = (dash==std::string::npos) ? first : std::stoul(tok.substr(dash+1));
+    for (auto cpu=first; cpu<=last && cpu<max_cpus; ++cpu) {
+      CPU_SET(cpu,&cpuset);
+      found = true;
+    }
+  }
+  return found;
+}
+
+static bool
+set_numa_affinity(std::thread& thread, int node)
+{
+  if (node < 0)
+    return false;
+
+  cpu_set_t cpuset;
+  try {
+    if (!get_numa_cpuset(node,cpuset))
+      return false;
+  }
+  catch (const std::exception&) {
+    return false;
+  }
+
+  XRT_DEBUG(std::cout,"pinning thread to numa node #",node,"\n");
+  return pthread_setaffinity_np(thread.native_handle(),sizeof(cpu_set_t),&cpuset)==0;
+}
+
+static bool
+set_cpu_affinity(std::thread& thread, unsigned int cpu)
+{
+  if (cpu >= std::thread::hardware_concurrency())
+    return false;
+
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  CPU_SET(cpu,&cpuset);
+  XRT_DEBUG(std::cout,"pinning thread to cpu #",cpu,"\n");
+  return pthread_setaffinity_np(thread.native_handle(),sizeof(cpu_set_t),&cpuset)==0;
+}
+
 #else
 
 static void
@@ -144,6 +204,18 @@ set_cpu_affinity(std::thread& thread)
 {
 }
 
+static bool
+set_numa_affinity(std::thread& thread, int node)
+{
+  return false;
+}
+
+static bool
+set_cpu_affinity(std::thread& thread, unsigned int cpu)
+{
+  return false;
+}
+
 #endif
 
 } // platform_specific
@@ -166,4 +238,16 @@ void set_cpu_affinity(std::thread& thread)
 
 } // detail
 
+bool
+set_numa_affinity(std::thread& thread, int node)
+{
+  return ::platform_specific::set_numa_affinity(thread,node);
+}
+
+bool
+set_cpu_affinity(std::thread& thread, unsigned int cpu)
+{
+  return ::platform_specific::set_cpu_affinity(thread,cpu);
+}
+
 } // xrt
@@ -40,6 +40,27 @@ set_cpu_affinity(std::thread& thread);
 
 }
 
+/**
+ * Pin a thread to the cpus of a NUMA node
+ *
+ * The cpus of the node are read from sysfs.
+ *
+ * @return
+ *   true if the thread was pinned, false if node is invalid or
+ *   its cpus cannot be determined
+ */
+bool
+set_numa_affinity(std::thread& thread, int node);
+
+/**
+ * Pin a thread to a single cpu
+ *
+ * @return
+ *   true if the thread was pinned, false if cpu is out of range
+ */
+bool
+set_cpu_affinity(std::thread& thread, unsigned int cpu);
+
 /**
  * Construct a thread and set policy according to sdaccel.ini
  * 
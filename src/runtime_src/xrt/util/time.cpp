@@ -15,21 +15,18 @@
  */
 
 #include "time.h"
-#include <chrono>
+#include "core/common/t_time.h"
 
 namespace xrt {
 
 /**
  * @return
- *   nanoseconds since first call
+ *   nanoseconds since first call, same time line as xrt_core::time_ns
  */
 unsigned long
 time_ns()
 {
-  static auto zero = std::chrono::high_resolution_clock::now();
-  auto now = std::chrono::high_resolution_clock::now();
-  auto integral_duration = std::chrono::duration_cast<std::chrono::nanoseconds>(now-zero).count();
-  return static_cast<unsigned long>(integral_duration);
+  return xrt_core::time_ns();
 }
 
 } // xocl
@@ -21,4 +21,5 @@
 #ifndef XRT_XRTCPP_H_
 #define XRT_XRTCPP_H_
 #include "experimental/xrtexec.hpp"
+#include "experimental/xrtregmap.hpp"
 #endif
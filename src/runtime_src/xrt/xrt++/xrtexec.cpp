@@ -17,6 +17,10 @@
 #include "xrt/device/device.h"
 #include "xrt/scheduler/command.h"
 
+#include <condition_variable>
+#include <mutex>
+#include <string>
+
 namespace xrtcpp {
 
 void
@@ -35,6 +39,10 @@ release_cu_context(xrt_device* device, value_type cuidx)
 
 namespace exec {
 
+// Completion of any command is signalled on s_any_done for wait_any
+static std::mutex s_any_mutex;
+static std::condition_variable s_any_done;
+
 struct command::impl : xrt::command
 {
   impl(xrt::device* device, ert_cmd_opcode opcode)
@@ -44,7 +52,41 @@ struct command::impl : xrt::command
     ecmd = get_ert_cmd<ert_packet*>();
   }
 
+  // Re-arm packet state which the scheduler left at completed
+  void
+  rearm()
+  {
+    ecmd->state = ERT_CMD_STATE_NEW;
+  }
+
+  virtual void
+  done() const
+  {
+    auto state = static_cast<ert_cmd_state>(ecmd->state);
+    if (callback)
+      callback(state);
+
+    if (has_promise) {
+      has_promise = false;
+      if (state == ERT_CMD_STATE_COMPLETED)
+        promise.set_value();
+      else
+        promise.set_exception
+          (std::make_exception_ptr
+           (std::runtime_error("command(" + std::to_string(get_uid())
+                               + ") failed with state " + std::to_string(state))));
+    }
+
+    std::lock_guard<std::mutex> lk(s_any_mutex);
+    s_any_done.notify_all();
+  }
+
   ert_packet* ecmd = nullptr;
+
+  // Completion hooks, invoked from done() on the notification thread
+  std::function<void(ert_cmd_state)> callback;
+  mutable std::promise<void> promise;
+  mutable bool has_promise = false;
 };
 
 command::
@@ -56,6 +98,7 @@ void
 command::
 execute()
 {
+  m_impl->rearm();
   m_impl->execute();
 }
 
@@ -73,6 +116,61 @@ completed() const
   return m_impl->completed();
 }
 
+std::future<void>
+command::
+execute_async()
+{
+  m_impl->promise = std::promise<void>();
+  m_impl->has_promise = true;
+  auto future = m_impl->promise.get_future();
+  try {
+    execute();
+  }
+  catch (...) {
+    m_impl->has_promise = false;
+    throw;
+  }
+  return future;
+}
+
+void
+command::
+set_done_callback(std::function<void(ert_cmd_state)> fn)
+{
+  m_impl->callback = std::move(fn);
+}
+
+void
+execute(const std::vector<command>& cmds)
+{
+  if (cmds.empty())
+    return;
+
+  std::vector<std::shared_ptr<xrt::command>> xcmds;
+  xcmds.reserve(cmds.size());
+  for (auto& cmd : cmds) {
+    cmd.m_impl->rearm();
+    xcmds.push_back(cmd.m_impl);
+  }
+
+  xrt::command::execute(xcmds);
+}
+
+size_t
+wait_any(const std::vector<command>& cmds)
+{
+  if (cmds.empty())
+    throw std::runtime_error("wait_any requires at least one command");
+
+  std::unique_lock<std::mutex> lk(s_any_mutex);
+  while (true) {
+    for (size_t idx=0; idx<cmds.size(); ++idx)
+      if (cmds[idx].m_impl->completed())
+        return idx;
+    s_any_done.wait(lk);
+  }
+}
+
 exec_write_command::
 exec_write_command(xrt_device* device)
   : command(device,ERT_EXEC_WRITE)
@@ -99,6 +197,17 @@ add(addr_type addr, value_type value)
   (*m_impl)[++m_impl->ecmd->count] = value;
 }
 
+// Pairs follow header, cumask, and 4 ctrl words
+void
+exec_write_command::
+set(size_t idx, value_type value)
+{
+  auto vidx = 1+4+2*idx+2;
+  if (vidx > m_impl->ecmd->count)
+    throw std::runtime_error("write_command has no {addr,value} pair " + std::to_string(idx));
+  (*m_impl)[vidx] = value;
+}
+
 void
 exec_write_command::
 clear()
@@ -111,4 +220,90 @@ clear()
   m_impl->ecmd->count = 1+4; // cumask + 4 ctrl
 }
 
+// The persistent iteration words alias the first ctrl words of the
+// regmap, which follow the header and the cumask
+void
+exec_write_command::
+set_persistent(value_type iterations)
+{
+  auto skcmd = reinterpret_cast<ert_start_kernel_cmd*>(m_impl->ecmd);
+  skcmd->persistent = 1;
+  (*m_impl)[2+ERT_PERSISTENT_ITERATIONS] = iterations;
+  (*m_impl)[2+ERT_PERSISTENT_COMPLETED] = 0;
+  (*m_impl)[2+ERT_PERSISTENT_CANCEL] = 0;
+}
+
+void
+exec_write_command::
+cancel()
+{
+  reinterpret_cast<volatile value_type&>((*m_impl)[2+ERT_PERSISTENT_CANCEL]) = 1;
+}
+
+value_type
+exec_write_command::
+completed_iterations() const
+{
+  return reinterpret_cast<volatile value_type&>((*m_impl)[2+ERT_PERSISTENT_COMPLETED]);
+}
+
+void
+exec_write_command::
+enable_timestamps(bool enable)
+{
+  auto skcmd = reinterpret_cast<ert_start_kernel_cmd*>(m_impl->ecmd);
+  skcmd->stat_enabled = enable;
+}
+
+void
+exec_write_command::
+set_priority(bool high)
+{
+  auto skcmd = reinterpret_cast<ert_start_kernel_cmd*>(m_impl->ecmd);
+  skcmd->priority = high;
+}
+
+ert_cmd_timestamps
+exec_write_command::
+timestamps() const
+{
+  auto skcmd = reinterpret_cast<ert_start_kernel_cmd*>(m_impl->ecmd);
+  ert_cmd_timestamps ts = {0,0,0,0,0};
+  if (skcmd->stat_enabled)
+    ts = *ert_start_kernel_timestamps(skcmd);
+  return ts;
+}
+
+// The 4K command packet holds header, cumask, and regmap
+start_kernel_command::
+start_kernel_command(xrt_device* device, size_t regmap_size)
+  : command(device,ERT_START_CU)
+{
+  auto words = (regmap_size+sizeof(value_type)-1)/sizeof(value_type);
+  if (2+words > 4096/sizeof(value_type))
+    throw std::runtime_error("register map of " + std::to_string(regmap_size)
+                             + " bytes does not fit in command");
+  m_impl->ecmd->type = ERT_CU;
+  m_impl->ecmd->count = 1+words; // cumask + regmap
+}
+
+void
+start_kernel_command::
+add_cu(value_type cuidx)
+{
+  if (cuidx>=32)
+    throw std::runtime_error("start_kernel_command supports at most 32 CUs");
+  auto skcmd = reinterpret_cast<ert_start_kernel_cmd*>(m_impl->ecmd);
+  skcmd->cu_mask |= 1<<cuidx;
+}
+
+// No extra cu masks, the regmap follows header and cumask
+value_type*
+start_kernel_command::
+regmap()
+{
+  auto skcmd = reinterpret_cast<ert_start_kernel_cmd*>(m_impl->ecmd);
+  return skcmd->data;
+}
+
 }} // exec,xrt
@@ -20,7 +20,10 @@
 
 #ifndef _XRT_XRTEXEC_H_
 #define _XRT_XRTEXEC_H_
+#include <functional>
+#include <future>
 #include <memory>
+#include <vector>
 #include "ert.h"
 
 struct xrt_device;
@@ -66,6 +69,9 @@ public:
   /**
    * Execute a command
    *
+   * A completed command can be executed again as is, or after
+   * modifying its values, without being rebuilt.
+   *
    * Throws on error
    */
   void
@@ -76,8 +82,54 @@ public:
 
   bool
   completed() const;
+
+  /**
+   * Execute a command and return a future for its completion
+   *
+   * The future becomes ready when the command completes, or holds
+   * an exception if the command ended in error or abort.  Many
+   * commands can be in flight without a waiting thread each.
+   *
+   * Throws on error
+   */
+  std::future<void>
+  execute_async();
+
+  /**
+   * Set function called when the command completes
+   *
+   * @fn: called with the command state on completion
+   *
+   * The callback is invoked from the scheduler's notification
+   * thread for each execution of the command.  It must not block,
+   * and should hand off any lengthy work to another thread.
+   */
+  void
+  set_done_callback(std::function<void(ert_cmd_state)> fn);
+
+  friend void execute(const std::vector<command>& cmds);
+  friend size_t wait_any(const std::vector<command>& cmds);
 };
 
+/**
+ * Execute several commands with as few driver submissions as possible
+ *
+ * @cmds: commands to execute, all on the same device
+ *
+ * Throws on error
+ */
+void
+execute(const std::vector<command>& cmds);
+
+/**
+ * Wait for any of several commands to complete
+ *
+ * @cmds: commands previously executed
+ * Return: index in @cmds of a completed command
+ */
+size_t
+wait_any(const std::vector<command>& cmds);
+
 /**
  * class exec_write_command : concrete class for ERT_EXEC_WRITE
  *
@@ -109,11 +161,111 @@ public:
   void
   add(addr_type addr, value_type value);
 
+  /**
+   * Change the value of an {addr,value} pair in place
+   *
+   * @idx: index of pair in the order it was added
+   * @value: the new value to write to the pair's address
+   *
+   * Allows a completed command to be executed again with new
+   * values without clear() and add() of all pairs.
+   */
+  void
+  set(size_t idx, value_type value);
+
   /**
    * Clear current CUs and {addr,value} pairs if any
    */
   void
   clear();
+
+  /**
+   * Make the command persistent
+   *
+   * @iterations: number of times to run the CU, 0 runs until cancel()
+   *
+   * A persistent command restarts its CU each time the CU completes
+   * without involving the host.  The command itself completes once,
+   * when all iterations are done or the command is cancelled.
+   * Requires kernel driver scheduling (ert disabled or ert_polling).
+   */
+  void
+  set_persistent(value_type iterations);
+
+  /**
+   * Stop a persistent command after its current iteration
+   */
+  void
+  cancel();
+
+  /**
+   * Number of iterations completed by a persistent command
+   */
+  value_type
+  completed_iterations() const;
+
+  /**
+   * Record phase timestamps of the command when executed
+   *
+   * @enable: true to have the kernel driver record timestamps
+   *
+   * The timestamps are written after the command payload in the
+   * command buffer.  Only the PCIe kernel driver records them.
+   */
+  void
+  enable_timestamps(bool enable);
+
+  /**
+   * Start the command ahead of normal priority commands
+   *
+   * @high: true to start the command on the next free CU before
+   *  queued normal priority commands
+   */
+  void
+  set_priority(bool high);
+
+  /**
+   * Phase timestamps of last execution, all zero if not enabled
+   *
+   * Timestamps are CLOCK_MONOTONIC nanoseconds, see ert.h
+   */
+  ert_cmd_timestamps
+  timestamps() const;
+};
+
+/**
+ * class start_kernel_command : concrete class for ERT_START_CU
+ *
+ * The command carries the complete register map of the selected
+ * CU.  The register map is written to the CU before the CU is
+ * started.  Arguments are stored directly into the register map,
+ * see kernel_command in xrtregmap.hpp for typed access.
+ */
+class start_kernel_command : public command
+{
+public:
+  /**
+   * @regmap_size: size in bytes of the CU register map including
+   *  the control registers
+   */
+  start_kernel_command(xrt_device* dev, size_t regmap_size);
+
+  /**
+   * Add cu to execute the command
+   *
+   * @cuidx: index of cu to execute
+   */
+  void
+  add_cu(value_type cuidx);
+
+  /**
+   * Register map in the command buffer
+   *
+   * Stays valid for the lifetime of the command.  Word 0 is the
+   * CU control register.
+   */
+  value_type*
+  regmap();
 };
 
 }} //exec, xrtcpp
@@ -0,0 +1,149 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+////////////////////////////////////////////////////////////////
+// This is experimental code, subject to disappear without warning
+////////////////////////////////////////////////////////////////
+
+#ifndef _XRT_XRTREGMAP_H_
+#define _XRT_XRTREGMAP_H_
+#include "xrtexec.hpp"
+#include <cstddef>
+#include <cstring>
+#include <tuple>
+
+namespace xrtcpp { namespace regmap {
+
+/**
+ * struct arg : descriptor of a kernel argument in the CU register map
+ *
+ * @T: host type of the argument value
+ * @Offset: byte offset of the argument in the register map
+ * @Size: bytes of the argument in the register map
+ */
+template <typename T, addr_type Offset, size_t Size = sizeof(T)>
+struct arg
+{
+  static_assert(Offset % sizeof(value_type) == 0, "argument offset must be word aligned");
+  static_assert(sizeof(T) <= Size, "argument type is larger than its registers");
+
+  using type = T;
+  static constexpr addr_type offset = Offset;
+  static constexpr size_t size = Size;
+};
+
+/**
+ * struct none : descriptor of a kernel argument without registers
+ *
+ * Streams are not part of the register map, but keep their position
+ * in the kernel signature.
+ */
+struct none
+{
+  using type = none;
+  static constexpr addr_type offset = 0;
+  static constexpr size_t size = 0;
+};
+
+namespace detail {
+
+// End of the last argument, at least past the 4 control registers
+template <typename... Args>
+struct regmap_end
+{
+  static constexpr size_t value = 0x10;
+};
+
+template <typename Arg, typename... Args>
+struct regmap_end<Arg,Args...>
+{
+  static constexpr size_t rest = regmap_end<Args...>::value;
+  static constexpr size_t value = (Arg::offset + Arg::size > rest) ? Arg::offset + Arg::size : rest;
+};
+
+} // detail
+
+/**
+ * struct kernel : signature descriptor of a kernel
+ *
+ * @Args: arg<> or none descriptor of each kernel argument in order
+ *
+ * Descriptors of the kernels in an xclbin are generated with
+ * 'xclbinutil --kernel-header'.
+ */
+template <typename... Args>
+struct kernel
+{
+  using arg_tuple = std::tuple<Args...>;
+
+  template <size_t Index>
+  using arg_type = typename std::tuple_element<Index,arg_tuple>::type;
+
+  static constexpr size_t arg_count = sizeof...(Args);
+  static constexpr size_t regmap_size = detail::regmap_end<Args...>::value;
+};
+
+}} // regmap, xrtcpp
+
+namespace xrtcpp { namespace exec {
+
+/**
+ * class kernel_command : start kernel command with typed arguments
+ *
+ * @Kernel: regmap::kernel<> descriptor of the kernel
+ *
+ *   xrtcpp::exec::kernel_command<vadd> cmd(device);
+ *   cmd.add_cu(0);
+ *   cmd.set<vadd::a>(a_addr);
+ *   cmd.set<vadd::n>(n);
+ *   cmd.execute();
+ *
+ * Argument offsets and sizes are compile time constants, so setting
+ * an argument is a store into the command buffer.  The value type is
+ * checked at compile time, there is no run time validation.
+ */
+template <typename Kernel>
+class kernel_command : public start_kernel_command
+{
+public:
+  explicit
+  kernel_command(xrt_device* dev)
+    : start_kernel_command(dev,Kernel::regmap_size)
+    , m_regmap(reinterpret_cast<char*>(regmap()))
+  {}
+
+  /**
+   * Set value of argument
+   *
+   * @Index: index of argument in kernel signature
+   * @value: the argument value
+   */
+  template <size_t Index>
+  void
+  set(const typename Kernel::template arg_type<Index>::type& value)
+  {
+    using arg = typename Kernel::template arg_type<Index>;
+    static_assert(arg::size > 0, "argument has no registers");
+    std::memcpy(m_regmap + arg::offset, &value, sizeof(value));
+  }
+
+private:
+  char* m_regmap;
+};
+
+}} // exec, xrtcpp
+
+#endif
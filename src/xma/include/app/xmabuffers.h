@@ -44,7 +44,8 @@ typedef struct XmaFraction
 /**
  * enum XmaBufferType - Describes the location of a buffer. Device buffers
  * reside on DDR banks located on the PCIe board hosting
- * the device.
+ * the device. The buffer of a device buffer is owned by XMA and is not
+ * host memory; Use xma_frame_download() to access the data.
 */
 typedef enum XmaBufferType
 {
@@ -142,6 +143,37 @@ typedef struct XmaFrameFormatDesc
 XmaFrame*
 xma_frame_alloc(XmaFrameProperties *frame_props);
 
+/**
+ * xma_frame_alloc_pinned() - Allocate a new frame buffer in host mapped device memory
+ *
+ * Planes are backed by host mapped buffers on the given device DDR bank,
+ * taken from a pool that xma_frame_free() returns them to. Plugins on that
+ * bank get the device buffer of a plane with xma_plg_buffer_lookup() and
+ * sync it without copying the frame.
+ *
+ * @frame_props: Description of frame buffer to be allocated
+ * @dev_index: Device of the session the frame is sent to
+ * @ddr_bank: DDR bank of the session the frame is sent to
+ *
+ * RETURN: XmaFrame pointer, NULL on failure
+*/
+XmaFrame*
+xma_frame_alloc_pinned(XmaFrameProperties *frame_props, int32_t dev_index, int32_t ddr_bank);
+
+/**
+ * xma_frame_download() - Copy the device planes of a frame to host memory
+ *
+ * Frames produced by plugins with xma_plg_frame_attach_buffer() stay in
+ * device memory and can be sent to another session on the same device
+ * as is.  This function makes them host frames for the application.
+ *
+ * @frame: Frame received from a session
+ *
+ * RETURN: XMA_SUCCESS on success, XMA_ERROR on failure
+*/
+int32_t
+xma_frame_download(XmaFrame *frame);
+
 /**
  * xma_frame_planes_get() - Return the number of planes in the frame specified
  *
@@ -187,6 +219,20 @@ xma_frame_free(XmaFrame *frame);
 XmaDataBuffer*
 xma_data_buffer_alloc(size_t size);
 
+/**
+ * xma_data_buffer_alloc_pinned() - Allocate a single buffer in host mapped device memory
+ *
+ * See xma_frame_alloc_pinned()
+ *
+ * @size: of buffer to allocate
+ * @dev_index: Device of the session the buffer is sent to
+ * @ddr_bank: DDR bank of the session the buffer is sent to
+ *
+ * RETURN: pointer to XmaDataBuffer with allocated memory, NULL on failure
+*/
+XmaDataBuffer*
+xma_data_buffer_alloc_pinned(size_t size, int32_t dev_index, int32_t ddr_bank);
+
 /**
  * xma_data_from_buffer_clone() - Create an XmaDataBuffer object from data of given size
  *
@@ -18,6 +18,7 @@
 #define _XMDECODER_H_
 
 #include "app/xmabuffers.h"
+#include "app/xmastats.h"
 #include "app/xmaparam.h"
 
 #ifdef __cplusplus
@@ -240,7 +241,8 @@ typedef struct XmaDecoderProperties
     int32_t         ddr_bank_index;//Used for allocating device buffers. Used only if valid index is provide (>= 0); value of -1 imples that XMA should select automatically and then XMA will set it with bank index used automatically
     int32_t         channel_id;
     char            *plugin_lib;
-    int32_t         reserved[4];
+    int32_t         cu_select;//XmaCuSelect; With XMA_CU_SELECT_LEAST_LOADED XMA sets dev_index and cu_index to the CU it selected
+    int32_t         reserved[3];
 } XmaDecoderProperties;
 
 /* Forward declaration */
@@ -334,6 +336,21 @@ int32_t
 xma_dec_session_recv_frame(XmaDecoderSession *session,
                            XmaFrame          *frame);
 
+/**
+ *  xma_dec_session_stats_get() - This function copies the statistics of
+ *  the session, see app/xmastats.h.
+ *
+ *  @session: Pointer to session created by xma_dec_session_create
+ *  @stats:   Pointer to the statistics to fill in
+ *
+ *  RETURN:   XMA_SUCCESS on success
+ *
+ * XMA_ERROR on error.
+*/
+int32_t
+xma_dec_session_stats_get(XmaDecoderSession *session,
+                          XmaSessionStats   *stats);
+
 #ifdef __cplusplus
 }
 #endif
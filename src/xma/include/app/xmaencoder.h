@@ -19,6 +19,7 @@
 
 
 #include "app/xmabuffers.h"
+#include "app/xmastats.h"
 #include "app/xmaparam.h"
 
 #ifdef __cplusplus
@@ -263,7 +264,8 @@ typedef struct XmaEncoderProperties
     int32_t         ddr_bank_index;//Used for allocating device buffers. Used only if valid index is provide (>= 0); value of -1 imples that XMA should select automatically and then XMA will set it with bank index used automatically
     int32_t         channel_id;
     char            *plugin_lib;//Lib with full path
-    int32_t         reserved[4];
+    int32_t         cu_select;//XmaCuSelect; With XMA_CU_SELECT_LEAST_LOADED XMA sets dev_index and cu_index to the CU it selected
+    int32_t         reserved[3];
 } XmaEncoderProperties;
 
 /* Forward declaration */
@@ -353,6 +355,21 @@ xma_enc_session_recv_data(XmaEncoderSession *session,
                           XmaDataBuffer     *data,
                           int32_t           *data_size);
 
+/**
+ *  xma_enc_session_stats_get() - This function copies the statistics of
+ *  the session, see app/xmastats.h.
+ *
+ *  @session: Pointer to session created by xma_enc_session_create
+ *  @stats:   Pointer to the statistics to fill in
+ *
+ *  RETURN:   XMA_SUCCESS on success
+ *
+ * XMA_ERROR on error.
+*/
+int32_t
+xma_enc_session_stats_get(XmaEncoderSession *session,
+                          XmaSessionStats   *stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -18,6 +18,7 @@
 #define _XMAAPP_FILTER_H_
 
 #include "app/xmabuffers.h"
+#include "app/xmastats.h"
 #include "app/xmaparam.h"
 
 #ifdef __cplusplus
@@ -167,6 +168,20 @@ int32_t
 xma_filter_session_recv_frame(XmaFilterSession *session,
                               XmaFrame         *frame);
 
+/**
+ *  xma_filter_session_stats_get() - This function copies the statistics of
+ *  the session, see app/xmastats.h.
+ *
+ *  @session: Pointer to session created by xma_filter_session_create
+ *  @stats:   Pointer to the statistics to fill in
+ *
+ *  RETURN:   XMA_SUCCESS on success
+ *
+ * XMA_ERROR on error.
+*/
+int32_t
+xma_filter_session_stats_get(XmaFilterSession *session,
+                             XmaSessionStats  *stats);
 
 #ifdef __cplusplus
 }
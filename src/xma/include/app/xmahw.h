@@ -24,13 +24,23 @@ extern "C" {
 //typedef void * XmaKernelRes;
 typedef struct XmaHwKernel XmaHwKernel;
 
+/**
+ * enum XmaCuSelect - How session create chooses the CU of a session
+ */
+typedef enum XmaCuSelect
+{
+    XMA_CU_SELECT_FIXED = 0, /**< CU given by dev_index and cu_index */
+    XMA_CU_SELECT_LEAST_LOADED, /**< Least loaded CU with the same kernel as dev_index and cu_index, on any device */
+} XmaCuSelect;
+
 typedef struct XmaHwSession
 {
     void            *dev_handle;
     //For execbo:
     uint32_t         dev_index;
     XmaHwKernel     *kernel_info;
-    uint32_t         reserved[4];
+    struct XmaSessionStats *stats;//Allocated and updated by XMA; See app/xmastats.h
+    uint32_t         reserved[2];
 } XmaHwSession;
 
 
@@ -18,6 +18,7 @@
 #define _XMAAPP_KERNEL_H_
 
 #include "app/xmabuffers.h"
+#include "app/xmastats.h"
 #include "app/xmaparam.h"
 
 #ifdef __cplusplus
@@ -343,6 +344,21 @@ xma_kernel_session_read(XmaKernelSession  *session,
                         XmaParameter      *param,
                         int32_t           *param_cnt);
 
+/**
+ *  xma_kernel_session_stats_get() - This function copies the statistics of
+ *  the session, see app/xmastats.h.
+ *
+ *  @session: Pointer to session created by xma_kernel_session_create
+ *  @stats:   Pointer to the statistics to fill in
+ *
+ *  RETURN:   XMA_SUCCESS on success
+ *
+ * XMA_ERROR on error.
+*/
+int32_t
+xma_kernel_session_stats_get(XmaKernelSession *session,
+                             XmaSessionStats  *stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2018, Xilinx Inc - All rights reserved
+ * Xilinx SDAccel Media Accelerator API
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#ifndef _XMA_STATS_H_
+#define _XMA_STATS_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * DOC: XMA session statistics
+ * Every session keeps counters of the frames and data passed through it,
+ * the host time spent in each API call and the time its work items spend
+ * on the CU.  Comparing the stages of the sessions in a pipeline shows
+ * which one limits the frame rate.  The counters are updated by XMA on
+ * every call without locking and are read with the
+ * xma_<type>_session_stats_get() function of the session type.
+*/
+
+/**
+ * enum XmaStatsStage - API calls of a session counted together
+ */
+typedef enum XmaStatsStage
+{
+    XMA_STATS_SEND = 0, /**< send_frame, send_data, write */
+    XMA_STATS_RECV, /**< recv_frame, recv_frame_list, recv_data, read */
+    XMA_STATS_NUM_STAGES
+} XmaStatsStage;
+
+/**
+ * struct XmaStageStats - Counters of one stage of a session
+ */
+typedef struct XmaStageStats
+{
+    uint64_t    calls; /**< API calls */
+    uint64_t    frames; /**< frames or data buffers passed on success */
+    uint64_t    pixels; /**< pixels of the frames passed */
+    uint64_t    bytes; /**< bytes of the data buffers passed */
+    uint64_t    host_ns; /**< time spent in the calls by XMA and the plugin */
+    uint64_t    max_host_ns; /**< longest call */
+} XmaStageStats;
+
+/**
+ * struct XmaSessionStats - Counters of a session since it was created
+ */
+typedef struct XmaSessionStats
+{
+    XmaStageStats   stage[XMA_STATS_NUM_STAGES];
+    uint64_t        work_items; /**< work items completed on the CU */
+    uint64_t        work_item_errors; /**< work items failed or not submitted */
+    uint64_t        kernel_ns; /**< submit to completion time of completed work items */
+    int32_t         queue_depth; /**< work items in flight now */
+    int32_t         max_queue_depth; /**< most work items in flight */
+    uint32_t        reserved[4];
+} XmaSessionStats;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -24,16 +24,24 @@
 #include "lib/xmalimits_lib.h"
 #include "app/xmahw.h"
 #include "app/xmaparam.h"
+#include "app/xmabuffers.h"
+#include "app/xmastats.h"
 #include "plg/xmasess.h"
 #include "xrt.h"
 #include <atomic>
 #include <vector>
 #include <memory>
+#include <mutex>
+#include <deque>
+#include <unordered_map>
 
 #define MIN_EXECBO_POOL_SIZE      16
 #define MAX_EXECBO_BUFF_SIZE      4096// 4KB
 #define MAX_KERNEL_REGMAP_SIZE    4032//Some space used by ert pkt
 #define MAX_REGMAP_ENTRIES        1024//Int32 entries; So 4B x 1024 = 4K Bytes
+#define XMA_LOAD_WINDOW_NS        1000000000ULL//1 sec; CU busy ratio is measured over this window
+#define MAX_BUFFER_POOL_SIZE      (1024ULL * 1024 * 1024)//1GB; Free device buffers cached per device
+#define MAX_SHM_CU_PROCS          64//Processes tracked per CU in the shared CU table
 
 //#ifdef __cplusplus
 //extern "C" {
@@ -59,11 +67,32 @@ typedef struct XmaHwKernel
     uint32_t    cu_mask1;
     //For execbo:
     int32_t     kernel_complete_count;
+    //execBOs scheduled on this CU and not yet reaped; Protected by XmaHwDevice execbo_mutex
+    std::deque<int32_t> execbo_inflight;
+    //Completed work items per session; Key is xma_plg session key (type and id)
+    std::unordered_map<uint64_t, int32_t> session_complete_count;
+    //Work items in flight per session and the limit set with
+    //xma_plg_session_max_work_items; Key is xma_plg session key
+    std::unordered_map<uint64_t, int32_t> session_inflight_count;
+    std::unordered_map<uint64_t, int32_t> session_max_inflight;
+    //Load for CU selection; Protected by XmaHwDevice execbo_mutex
+    int32_t     num_sessions;//Sessions bound to this CU
+    uint64_t    busy_ns;//Time with execBOs in flight, excluding current busy period
+    uint64_t    busy_start_ns;//Start of current busy period
+    uint64_t    load_window_start_ns;
+    uint64_t    load_window_busy_ns;//busy_ns at load_window_start_ns
+    double      busy_ratio;//Busy fraction of the previous load window
+    int32_t     shm_slot;//Slot of this process in XmaHwDevice shm_cu_table; -1 if none
     //std::unique_ptr<std::atomic<bool>> kernel_complete_locked;
 
     uint32_t    reg_map[MAX_REGMAP_ENTRIES];//4KB = 4B x 1024; Supported Max regmap of 4032 Bytes only in xmaplugin.cpp; execBO size is 4096 = 4KB in xmahw_hal.cpp
     //pthread_mutex_t *lock;
     std::unique_ptr<std::atomic<bool>> reg_map_locked;
+    //Regmap usage tracked by xma_plg_register_prep_write; Offsets in bytes
+    uint32_t    reg_map_max;//Highest offset written + 1
+    uint32_t    reg_map_dirty_lo;//Range written since last work item was scheduled
+    uint32_t    reg_map_dirty_hi;
+    uint64_t    reg_map_serial;//Number of work items scheduled from reg_map
     int32_t         locked_by_session_id;
     XmaSessionType locked_by_session_type;
     void*   private_do_not_use;
@@ -78,13 +107,76 @@ typedef struct XmaHwKernel
     cu_mask0 = 0;
     cu_mask1 = 0;
     kernel_complete_count = 0;
+    num_sessions = 0;
+    busy_ns = 0;
+    busy_start_ns = 0;
+    load_window_start_ns = 0;
+    load_window_busy_ns = 0;
+    busy_ratio = 0;
+    shm_slot = -1;
     //*kernel_complete_locked = false;
     *reg_map_locked = false;
+    reg_map_max = 0;
+    reg_map_dirty_lo = MAX_KERNEL_REGMAP_SIZE;
+    reg_map_dirty_hi = 0;
+    reg_map_serial = 0;
     locked_by_session_id = -100;
     private_do_not_use = NULL;
   }
 } XmaHwKernel;
 
+//Device buffer freed by a plugin and kept for reuse by xma_plg_buffer_alloc
+typedef struct XmaHwBufferPoolEntry
+{
+    uint64_t    boHandle;
+    uint64_t    paddr;
+    uint8_t*    data;//NULL for device only buffers
+} XmaHwBufferPoolEntry;
+
+//Host mapped device buffer handed out by xma_frame_alloc_pinned and
+//xma_data_buffer_alloc_pinned
+typedef struct XmaHwPinnedBuffer
+{
+    int32_t     dev_index;
+    int32_t     ddr_bank;
+    uint64_t    size;//Size bucket
+    XmaHwBufferPoolEntry bo;
+} XmaHwPinnedBuffer;
+
+//Device buffer owned by an XmaFrame plane of XMA_DEVICE_BUFFER_TYPE;
+//XmaBufferRef buffer points to it
+typedef struct XmaHwFrameBuffer
+{
+    int32_t     dev_index;
+    int32_t     ddr_bank;
+    uint64_t    size;//Size requested by the plugin
+    bool        device_only_buffer;
+    XmaHwBufferPoolEntry bo;
+} XmaHwFrameBuffer;
+
+//Sessions bound to a CU by one process; pid 0 is a free slot and
+//pid -1 a slot being reclaimed from a process that exited
+typedef struct XmaShmCuSlot
+{
+    std::atomic<int32_t> pid;
+    std::atomic<int32_t> num_sessions;
+} XmaShmCuSlot;
+
+//Sessions bound to the CUs of a device by all processes using the same
+//xclbin. Lives in POSIX shared memory and is only updated with atomics,
+//so no process ever waits on another; See xma_hw_shm_map
+typedef struct XmaShmCuTable
+{
+    XmaShmCuSlot slots[MAX_KERNEL_CONFIGS][MAX_SHM_CU_PROCS];
+} XmaShmCuTable;
+
+//Work items submitted together by xma_plg_schedule_work_group
+typedef struct XmaHwWorkGroup
+{
+    int32_t     pending;//Work items not yet complete
+    bool        failed;//A work item failed or could not be submitted
+} XmaHwWorkGroup;
+
 typedef struct XmaHwDevice
 {
     //char        dsa[MAX_DSA_NAME];
@@ -99,20 +191,46 @@ typedef struct XmaHwDevice
     //XmaHwKernel kernels[MAX_KERNEL_CONFIGS];
     std::vector<XmaHwKernel> kernels;
 
-    std::unique_ptr<std::atomic<bool>> execbo_locked;
+    std::unique_ptr<std::mutex> execbo_mutex;
+    //Indexes of execBOs not in use; O(1) allocation
+    std::vector<int32_t> execbo_free;
     std::vector<uint32_t> kernel_execbo_handle;
     std::vector<char*> kernel_execbo_data;//execBO size is 4096 in xmahw_hal.cpp
     std::vector<bool> kernel_execbo_inuse;
     std::vector<int32_t> kernel_execbo_cu_index;
+    //Kernel and session that scheduled the execBO currently in use
+    std::vector<XmaHwKernel*> kernel_execbo_kernel;
+    std::vector<uint64_t> kernel_execbo_session;
+    //Work group of the execBO, 0 if none; See xma_plg_schedule_work_group
+    std::vector<int32_t> kernel_execbo_group;
+    //Stats of the session and submit time of the work item in the execBO
+    std::vector<XmaSessionStats*> kernel_execbo_stats;
+    std::vector<uint64_t> kernel_execbo_submit_ns;
+    //Kernel whose reg_map was last copied into execBO and its reg_map_serial at that time
+    std::vector<XmaHwKernel*> kernel_execbo_regmap_kernel;
+    std::vector<uint64_t> kernel_execbo_regmap_serial;
     int32_t    num_execbo_allocated;
+    //Work groups not yet waited for; Protected by execbo_mutex
+    std::unordered_map<int32_t, XmaHwWorkGroup> work_groups;
+    int32_t    last_work_group;
+
+    //Free device buffers per DDR bank and size bucket; See xmaplugin.cpp
+    std::unique_ptr<std::mutex> buffer_pool_mutex;
+    std::unordered_map<uint64_t, std::vector<XmaHwBufferPoolEntry>> buffer_pool;
+    uint64_t   buffer_pool_size;//Bytes in buffer_pool
 
-  XmaHwDevice(): execbo_locked(new std::atomic<bool>) {
+    //Sessions of all processes per CU; NULL if shared memory is not available
+    XmaShmCuTable*  shm_cu_table;
+
+  XmaHwDevice(): execbo_mutex(new std::mutex), buffer_pool_mutex(new std::mutex) {
     //in_use = false;
     dev_index = -1;
     number_of_cus = 0;
-    *execbo_locked = false;
     number_of_mem_banks = 0;
     num_execbo_allocated = -1;
+    last_work_group = 0;
+    buffer_pool_size = 0;
+    shm_cu_table = NULL;
     handle = NULL;
   }
 } XmaHwDevice;
@@ -190,6 +308,88 @@ bool xma_hw_configure(XmaHwCfg *hwcfg, XmaSystemCfg *systemcfg, bool hw_cfg_stat
  */
 bool xma_hw_configure(XmaHwCfg *hwcfg, XmaXclbinParameter *devXclbins, int32_t num_parms);
 
+/**
+ *  CU load tracking and selection.
+ *
+ *  xma_hw_now_ns() is the clock used for CU busy time.
+ *  xma_hw_kernel_load() returns the load of a CU: its busy fraction over
+ *  the last load window plus a small weight per bound session and work
+ *  item in flight, so that idle CUs are filled evenly.  Caller must hold
+ *  the execbo_mutex of the device.
+ *  xma_hw_select_cu() replaces dev_index and cu_index with the least
+ *  loaded CU running the same kernel, on any device.
+ *  xma_hw_kernel_bind() adds delta to the sessions bound to a CU.
+ */
+uint64_t xma_hw_now_ns();
+double xma_hw_kernel_load(XmaHwKernel *kernel, uint64_t now_ns);
+int32_t xma_hw_select_cu(XmaHwCfg *hwcfg, int32_t *dev_index, int32_t *cu_index);
+void xma_hw_kernel_bind(XmaHwKernel *kernel, int32_t delta);
+
+/**
+ *  Session statistics; See app/xmastats.h.
+ *
+ *  xma_hw_session_stats_init() allocates the stats of a session once its
+ *  hw_session is set up.
+ *  xma_hw_session_stats_release() detaches the stats from execBOs still
+ *  in flight and frees them.
+ *  xma_hw_session_stats_record() counts an API call of stage that started
+ *  at start_ns, from xma_hw_now_ns().
+ *  xma_hw_session_stats_get() copies the stats of a session.
+ */
+void xma_hw_session_stats_init(XmaSession *session);
+void xma_hw_session_stats_release(XmaSession *session);
+void xma_hw_session_stats_record(XmaSession *session, XmaStatsStage stage, uint64_t start_ns,
+                                 uint64_t frames, uint64_t pixels, uint64_t bytes);
+int32_t xma_hw_session_stats_get(XmaSession *session, XmaSessionStats *stats);
+
+/**
+ *  Shared CU table of all processes.
+ *
+ *  xma_hw_shm_map() maps the XmaShmCuTable of a device, creating it if
+ *  this is the first process, and reclaims the slots of processes that
+ *  exited without unbinding their sessions.  Failure is not fatal; CU
+ *  selection then only sees the sessions of this process.
+ *  xma_hw_shm_sessions() returns the sessions bound to a CU by other
+ *  processes.
+ *  xma_hw_shm_bind() adds delta to the sessions of this process in the
+ *  table.  Caller must hold the execbo_mutex of the device.
+ */
+void xma_hw_shm_map(XmaHwDevice *dev);
+int32_t xma_hw_shm_sessions(XmaHwDevice *dev, XmaHwKernel *kernel);
+void xma_hw_shm_bind(XmaHwDevice *dev, XmaHwKernel *kernel, int32_t delta);
+
+/**
+ *  Device buffer pool shared by xma_plg_buffer_alloc and the pinned
+ *  host buffers of xmabuffer.cpp. Buffers are kept per DDR bank,
+ *  buffer type and size bucket in XmaHwDevice buffer_pool.
+ *
+ *  xma_hw_buffer_bucket() rounds a size up to its size bucket.
+ *  xma_hw_buffer_pool_key() returns the buffer_pool key, 0 if the
+ *  buffer can not be pooled.
+ *  xma_hw_buffer_pool_get() takes a free buffer, false if none.
+ *  xma_hw_buffer_pool_put() returns a buffer, false if the pool is
+ *  full and the caller must free the buffer.
+ *  xma_hw_buffer_alloc_bo() allocates and maps a new buffer.
+ *  xma_hw_pinned_buffer_get() looks up the pinned buffer containing
+ *  a host address returned by the pinned allocators.
+ */
+uint64_t xma_hw_buffer_bucket(size_t size);
+uint64_t xma_hw_buffer_pool_key(int32_t ddr_bank, uint64_t bucket, bool device_only_buffer);
+bool xma_hw_buffer_pool_get(XmaHwDevice *dev_tmp1, uint64_t key, XmaHwBufferPoolEntry& entry);
+bool xma_hw_buffer_pool_put(XmaHwDevice *dev_tmp1, uint64_t key, const XmaHwBufferPoolEntry& entry);
+bool xma_hw_buffer_alloc_bo(xclDeviceHandle dev_handle, uint64_t size, uint32_t ddr_bank,
+                            bool device_only_buffer, XmaHwBufferPoolEntry& entry);
+bool xma_hw_pinned_buffer_get(const void *host_ptr, XmaHwPinnedBuffer& pinned);
+
+/**
+ *  Device resident frames. xma_hw_frame_attach() makes a device buffer
+ *  the given plane of frame, releasing the plane's previous buffer. The
+ *  frame owns buf from then on. xma_hw_frame_buffer_release() returns a
+ *  plane's device buffer to the pool and deletes buf.
+ */
+void xma_hw_frame_attach(XmaFrame *frame, int32_t plane, XmaHwFrameBuffer *buf);
+void xma_hw_frame_buffer_release(XmaHwFrameBuffer *buf);
+
 /**
  *  @}
  */
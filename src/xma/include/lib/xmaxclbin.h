@@ -68,7 +68,10 @@ typedef struct XmaXclbinInfo
     uint32_t    reserved[32];
 } XmaXclbinInfo;
 
-char *xma_xclbin_file_open(const char *xclbin_name);
+//Maps the xclbin file read only; release with xma_xclbin_file_close
+char *xma_xclbin_file_open(const char *xclbin_name, size_t *size);
+void xma_xclbin_file_close(char *buffer, size_t size);
+//Parsed info is cached per process by xclbin uuid
 int xma_xclbin_info_get(char *buffer, XmaXclbinInfo *info);
 int xma_xclbin_map2ddr(uint16_t bit_map, int* ddr_bank);
 #endif
@@ -72,6 +72,9 @@ typedef struct XmaBufferObj
  *  This function knows which DDR bank is associated with this
  *  session and therefore automatically selects the correct
  *  DDR bank.
+ *  Buffers released with @ref xma_plg_buffer_free() are kept
+ *  in a per device pool and reused for later allocations of
+ *  a similar size on the same DDR bank.
  *
  *  @s_handle: The session handle associated with this plugin instance.
  *  @size:     Size in bytes of the device buffer to be allocated.
@@ -93,6 +96,85 @@ XmaBufferObj xma_plg_buffer_alloc(XmaSession s_handle, size_t size, bool device_
  */
 void xma_plg_buffer_free(XmaSession s_handle, XmaBufferObj b_obj);
 
+/**
+ *  xma_plg_buffer_lookup() - Get the device buffer of a pinned host buffer
+ *  This function returns the device buffer backing a frame plane or data
+ *  buffer allocated with xma_frame_alloc_pinned() or
+ *  xma_data_buffer_alloc_pinned().  The buffer can be synced with
+ *  @ref xma_plg_buffer_write() and @ref xma_plg_buffer_read() without
+ *  copying it to a buffer of the plugin.  Release it with
+ *  @ref xma_plg_buffer_free(); The host buffer is not freed.
+ *
+ *  @s_handle: The session handle associated with this plugin instance.
+ *  @host_ptr: Plane or data buffer pointer
+ *  @return_code: XMA_ERROR if host_ptr is not a pinned buffer on the
+ *                device and DDR bank of the session.  Plugins then copy
+ *                the data to a buffer from @ref xma_plg_buffer_alloc()
+ *
+ */
+XmaBufferObj xma_plg_buffer_lookup(XmaSession s_handle, void* host_ptr, int32_t* return_code);
+
+/**
+ *  xma_plg_frame_attach_buffer() - Make a device buffer a plane of a frame
+ *  This function hands a buffer from @ref xma_plg_buffer_alloc() to a
+ *  frame, typically the output frame of a decoder or scaler.  The plane
+ *  becomes an XMA_DEVICE_BUFFER_TYPE plane and the frame owns the buffer
+ *  from then on; The plugin must not free it.  The previous buffer of the
+ *  plane is released.  The frame stays on the device until the next
+ *  session on the same device gets the buffer with
+ *  @ref xma_plg_frame_buffer_get() or the application calls
+ *  xma_frame_download().
+ *
+ *  @s_handle: The session handle associated with this plugin instance.
+ *  @frame:    Frame to attach the buffer to
+ *  @plane:    Plane index
+ *  @b_obj:    The buffer handle returned from @ref xma_plg_buffer_alloc()
+ *
+ *  RETURN:    XMA_SUCCESS on success
+ *
+ *  XMA_ERROR on failure
+ *
+ */
+int32_t xma_plg_frame_attach_buffer(XmaSession s_handle, XmaFrame* frame, int32_t plane, XmaBufferObj b_obj);
+
+/**
+ *  xma_plg_frame_buffer_get() - Get the device buffer of a frame plane
+ *  This function returns the device buffer of an XMA_DEVICE_BUFFER_TYPE
+ *  plane so that a plugin can use a frame produced by another session on
+ *  the same device without a host round trip.  If the plane is on another
+ *  DDR bank, it is first copied to the bank of this session with
+ *  xclCopyBO.  Release it with @ref xma_plg_buffer_free(); The frame keeps
+ *  the buffer.
+ *
+ *  @s_handle: The session handle associated with this plugin instance.
+ *  @frame:    Frame received by the plugin
+ *  @plane:    Plane index
+ *  @return_code: XMA_ERROR if the plane is a host plane or on another
+ *                device.  Plugins then use the host data as before
+ *
+ */
+XmaBufferObj xma_plg_frame_buffer_get(XmaSession s_handle, XmaFrame* frame, int32_t plane, int32_t* return_code);
+
+/**
+ *  xma_plg_buffer_pool_reserve() - Pre-allocate device buffers
+ *  This function allocates device buffers and places them in the
+ *  buffer pool used by @ref xma_plg_buffer_alloc() so that the
+ *  first frames of a session do not allocate from the driver.
+ *  Plugins call it from their init function with the sizes they
+ *  allocate per frame.
+ *
+ *  @s_handle: The session handle associated with this plugin instance.
+ *  @size:     Size in bytes of each device buffer
+ *  @count:    Number of buffers to add to the pool
+ *  @device_only_buffer: Buffers without a host mapping
+ *
+ *  RETURN:    XMA_SUCCESS on success
+ *
+ *  XMA_ERROR on failure
+ *
+ */
+int32_t xma_plg_buffer_pool_reserve(XmaSession s_handle, size_t size, int32_t count, bool device_only_buffer);
+
 /**
  *  xma_plg_buffer_free() - Get a physical address for a buffer handle
  *  This function returns the physical address of DDR memory on the FPGA
@@ -156,6 +238,8 @@ int32_t xma_plg_buffer_read(XmaSession     s_handle,
  * and push a new work item onto the scheduler queue.  Work items are processed
  * in FIFO order.  After calling schedule_work_item() one or more times, the caller
  * can invoke xma_plg_is_work_item_done() to wait for one item of work to complete.
+ * If all command buffers of the device are in use, this function fails unless
+ * the session has a work item limit, see xma_plg_session_max_work_items().
  *
  * @s_handle: The session handle associated with this plugin instance
  *
@@ -166,6 +250,93 @@ int32_t xma_plg_buffer_read(XmaSession     s_handle,
  */
 int32_t xma_plg_schedule_work_item(XmaSession s_handle);
 
+/**
+ * xma_plg_schedule_work_item_regmap() - This function schedules a work item
+ * with a register map supplied by the plugin instead of the kernel regmap.
+ * The register map is copied into the command at submit time, so the plugin
+ * does not lock the kernel regmap and may prepare and schedule the next work
+ * item while earlier ones are still queued or running.  Up to the limit set
+ * with xma_plg_session_max_work_items() are kept in flight per session;
+ * When the limit is reached this function blocks until one completes.
+ * Completions are counted by xma_plg_work_item_done_count() and
+ * xma_plg_is_work_item_done() as for xma_plg_schedule_work_item().
+ *
+ * @s_handle: The session handle associated with this plugin instance
+ * @regmap:   Register map of the work item, starting at the CU control
+ *            register
+ * @size:     Size of regmap in bytes; Multiple of 4, at least 16 and at
+ *            most 4032
+ *
+ * RETURN:    XMA_SUCCESS on success
+ *
+ * XMA_ERROR on failure
+ *
+ */
+int32_t xma_plg_schedule_work_item_regmap(XmaSession s_handle, void* regmap, size_t size);
+
+/**
+ * xma_plg_schedule_work_group() - This function schedules one work item on
+ * each of several CUs as a group, for plugins that start more than one CU
+ * per frame.  The execBOs of all work items are taken with one search and
+ * the commands are submitted back to back.  The sessions must be on the
+ * same device and each may appear in the group once.  Completion of the
+ * whole group is waited for with xma_plg_work_group_done(); The work items
+ * are also counted by xma_plg_work_item_done_count() of their session.
+ * Waits for free command buffers only if every session of the group has a
+ * work item limit, see xma_plg_session_max_work_items().
+ *
+ * @s_handles: Session handles, one per work item
+ * @regmaps:   Register map per work item as for
+ *             xma_plg_schedule_work_item_regmap(); NULL entry, or NULL
+ *             array, to use the kernel regmap of the session as for
+ *             xma_plg_schedule_work_item()
+ * @sizes:     Size of each regmap in bytes; Ignored for NULL regmaps
+ * @count:     Number of work items
+ *
+ * RETURN:     >0 work group handle on success
+ *
+ * XMA_ERROR on failure
+ *
+ */
+int32_t xma_plg_schedule_work_group(XmaSession* s_handles, void** regmaps, size_t* sizes, int32_t count);
+
+/**
+ * xma_plg_work_group_done() - This function waits for all work items of a
+ * work group scheduled by xma_plg_schedule_work_group() to complete.  The
+ * handle is released unless the timeout expires.
+ *
+ * @s_handle:      Any session of the work group
+ * @group:         Work group handle
+ * @timeout_in_ms: A timeout value in milliseconds, 0 to not wait
+ *
+ * RETURN:         XMA_SUCCESS when all work items completed
+ *
+ * XMA_ERROR_TIMEOUT if work items are still pending
+ *
+ * XMA_ERROR if a work item failed or the handle is unknown
+ *
+ */
+int32_t xma_plg_work_group_done(XmaSession s_handle, int32_t group, int32_t timeout_in_ms);
+
+/**
+ * xma_plg_session_max_work_items() - This function sets the number of work
+ * items a session may have in flight.  Scheduling another work item blocks
+ * until one of them completes.  A session keeps the CU busy between frames
+ * with a limit of 2 or more.  A session with a limit also blocks when all
+ * command buffers of the device are in use, and scheduling fails only after
+ * no work item on the device has completed for 10 seconds; Without a limit
+ * scheduling fails right away in that case.
+ *
+ * @s_handle:       The session handle associated with this plugin instance
+ * @max_work_items: Maximum work items in flight; 0 for no limit (default)
+ *
+ * RETURN:          XMA_SUCCESS on success
+ *
+ * XMA_ERROR on failure
+ *
+ */
+int32_t xma_plg_session_max_work_items(XmaSession s_handle, int32_t max_work_items);
+
 /**
  * xma_plg_is_work_item_done() - This function checks if at least one work item
  * previously submitted via xma_plg_schedule_work_item() has completed.  If the
@@ -182,6 +353,43 @@ int32_t xma_plg_schedule_work_item(XmaSession s_handle);
  */
 int32_t xma_plg_is_work_item_done(XmaSession s_handle, int32_t timeout_in_ms);
 
+/**
+ * xma_plg_work_item_done_count() - This function returns the number of work
+ * items scheduled by this session via xma_plg_schedule_work_item() that have
+ * completed since the previous call.  If none have completed, the function
+ * blocks for up to the supplied timeout waiting for one to complete.  The
+ * count is independent of the per kernel count consumed by
+ * xma_plg_is_work_item_done().
+ *
+ * @s_handle:      The session handle associated with this plugin instance
+ * @timeout_in_ms: A timeout value in milliseconds, 0 to not wait
+ *
+ * RETURN:         >=0 number of completed work items
+ *
+ * XMA_ERROR on failure
+ *
+ */
+int32_t xma_plg_work_item_done_count(XmaSession s_handle, int32_t timeout_in_ms);
+
+/**
+ * xma_plg_session_migrate() - Move the session to a less loaded CU
+ * Plugins call this function at a point where the session carries no
+ * state in the CU, such as a keyframe boundary.  The session moves only
+ * to a CU of the same kernel on the same device and DDR bank, so its
+ * device buffers stay valid, and only when it has no work items in
+ * flight.  After a move the plugin must write its whole register map
+ * again before scheduling the next work item.
+ *
+ * @s_handle: Pointer to the session handle associated with this plugin
+ *            instance; Updated when the session moves
+ *
+ * RETURN:    1 if the session moved, 0 if it stayed
+ *
+ * XMA_ERROR on failure
+ *
+ */
+int32_t xma_plg_session_migrate(XmaSession* s_handle);
+
 int32_t xma_plg_kernel_lock_regmap(XmaSession s_handle);
 int32_t xma_plg_kernel_unlock_regmap(XmaSession s_handle);
 
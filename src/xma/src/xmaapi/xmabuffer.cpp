@@ -16,12 +16,169 @@
  */
 #include <stdlib.h>
 #include <string.h>
+#include <mutex>
+#include <unordered_map>
 
 #include "app/xmabuffers.h"
 #include "app/xmalogger.h"
+#include "lib/xmaapi.h"
 
 #define XMA_BUFFER_MOD "xmabuffer"
 
+extern XmaSingleton *g_xma_singleton;
+
+//Device buffer pool: xma_plg_buffer_free and the pinned buffer frees
+//keep buffers in XmaHwDevice buffer_pool and the allocators hand them
+//out again, so steady state frame processing does no xclAllocBO/xclFreeBO.
+//Sizes are rounded up to 4KB pages, and above 64KB to 1/16 of the power
+//of two below them. So a buffer is at most 12.5% larger than requested
+//and frames of one resolution share a bucket.
+uint64_t
+xma_hw_buffer_bucket(size_t size)
+{
+    uint64_t step = 4096;
+    uint64_t bucket = (size + step - 1) & ~(step - 1);
+    while (step * 16 <= bucket)
+        step <<= 1;
+    return (bucket + step - 1) & ~(step - 1);
+}
+
+//Bucket is a multiple of 4KB; Bank and buffer type go in the low bits
+//Returns 0 if buffer can not be pooled
+uint64_t
+xma_hw_buffer_pool_key(int32_t ddr_bank, uint64_t bucket, bool device_only_buffer)
+{
+    if (ddr_bank < 0 || ddr_bank >= 2048)
+        return 0;
+    return bucket | ((uint64_t)ddr_bank << 1) | (device_only_buffer ? 1 : 0);
+}
+
+bool
+xma_hw_buffer_pool_get(XmaHwDevice *dev_tmp1, uint64_t key, XmaHwBufferPoolEntry& entry)
+{
+    if (dev_tmp1 == NULL || key == 0)
+        return false;
+    std::lock_guard<std::mutex> lk(*dev_tmp1->buffer_pool_mutex);
+    auto itr = dev_tmp1->buffer_pool.find(key);
+    if (itr == dev_tmp1->buffer_pool.end() || itr->second.empty())
+        return false;
+    entry = itr->second.back();
+    itr->second.pop_back();
+    dev_tmp1->buffer_pool_size -= key & ~(uint64_t)4095;
+    return true;
+}
+
+//Returns false if pool is full; Caller should free the buffer
+bool
+xma_hw_buffer_pool_put(XmaHwDevice *dev_tmp1, uint64_t key, const XmaHwBufferPoolEntry& entry)
+{
+    if (dev_tmp1 == NULL || key == 0)
+        return false;
+    uint64_t bucket = key & ~(uint64_t)4095;
+    std::lock_guard<std::mutex> lk(*dev_tmp1->buffer_pool_mutex);
+    if (dev_tmp1->buffer_pool_size + bucket > MAX_BUFFER_POOL_SIZE)
+        return false;
+    dev_tmp1->buffer_pool[key].emplace_back(entry);
+    dev_tmp1->buffer_pool_size += bucket;
+    return true;
+}
+
+bool
+xma_hw_buffer_alloc_bo(xclDeviceHandle dev_handle, uint64_t size, uint32_t ddr_bank,
+                        bool device_only_buffer, XmaHwBufferPoolEntry& entry)
+{
+    /*
+    #define XRT_BO_FLAGS_MEMIDX_MASK        (0xFFFFFFUL)
+    #define XCL_BO_FLAGS_CACHEABLE          (1 << 24)
+    #define XCL_BO_FLAGS_SVM                (1 << 27)
+    #define XCL_BO_FLAGS_DEV_ONLY           (1 << 28)
+    #define XCL_BO_FLAGS_HOST_ONLY          (1 << 29)
+    #define XCL_BO_FLAGS_P2P                (1 << 30)
+    #define XCL_BO_FLAGS_EXECBUF            (1 << 31)
+    */
+    unsigned int b_obj_handle = 0;
+    if (device_only_buffer) {
+        b_obj_handle = xclAllocBO(dev_handle, size, 0, XCL_BO_FLAGS_DEV_ONLY | ddr_bank);
+    } else {
+        b_obj_handle = xclAllocBO(dev_handle, size, 0, ddr_bank);
+    }
+    if (b_obj_handle == NULLBO) {
+        xma_logmsg(XMA_ERROR_LOG, XMA_BUFFER_MOD, "xclAllocBO failed.\n");
+        return false;
+    }
+    entry.boHandle = b_obj_handle;
+    entry.paddr = xclGetDeviceAddr(dev_handle, b_obj_handle);
+    entry.data = NULL;
+    if (!device_only_buffer) {
+        entry.data = (uint8_t*) xclMapBO(dev_handle, b_obj_handle, true);
+    }
+    return true;
+}
+
+//Pinned buffers in use; Key is host address
+static std::mutex pinned_mutex;
+static std::unordered_map<const void*, XmaHwPinnedBuffer> pinned_inuse;
+
+bool
+xma_hw_pinned_buffer_get(const void *host_ptr, XmaHwPinnedBuffer& pinned)
+{
+    std::lock_guard<std::mutex> lk(pinned_mutex);
+    auto itr = pinned_inuse.find(host_ptr);
+    if (itr == pinned_inuse.end())
+        return false;
+    pinned = itr->second;
+    return true;
+}
+
+static void*
+xma_pinned_alloc(size_t size, int32_t dev_index, int32_t ddr_bank)
+{
+    XmaHwCfg *hwcfg = &g_xma_singleton->hwcfg;
+    if (!g_xma_singleton->xma_initialized || dev_index < 0 || dev_index >= hwcfg->num_devices) {
+        xma_logmsg(XMA_ERROR_LOG, XMA_BUFFER_MOD,
+                   "%s() Invalid device index %d\n", __func__, dev_index);
+        return NULL;
+    }
+    XmaHwDevice *dev_tmp1 = &hwcfg->devices[dev_index];
+    XmaHwPinnedBuffer pinned;
+    pinned.dev_index = dev_index;
+    pinned.ddr_bank = ddr_bank;
+    pinned.size = xma_hw_buffer_bucket(size);
+    uint64_t key = xma_hw_buffer_pool_key(ddr_bank, pinned.size, false);
+    if (key == 0) {
+        xma_logmsg(XMA_ERROR_LOG, XMA_BUFFER_MOD,
+                   "%s() Invalid DDR bank %d\n", __func__, ddr_bank);
+        return NULL;
+    }
+    if (!xma_hw_buffer_pool_get(dev_tmp1, key, pinned.bo) &&
+        !xma_hw_buffer_alloc_bo(dev_tmp1->handle, pinned.size, ddr_bank, false, pinned.bo))
+        return NULL;
+
+    std::lock_guard<std::mutex> lk(pinned_mutex);
+    pinned_inuse.emplace(pinned.bo.data, pinned);
+    return pinned.bo.data;
+}
+
+//Returns false if buffer is not pinned
+static bool
+xma_pinned_free(void *host_ptr)
+{
+    XmaHwPinnedBuffer pinned;
+    {
+        std::lock_guard<std::mutex> lk(pinned_mutex);
+        auto itr = pinned_inuse.find(host_ptr);
+        if (itr == pinned_inuse.end())
+            return false;
+        pinned = itr->second;
+        pinned_inuse.erase(itr);
+    }
+    XmaHwDevice *dev_tmp1 = &g_xma_singleton->hwcfg.devices[pinned.dev_index];
+    uint64_t key = xma_hw_buffer_pool_key(pinned.ddr_bank, pinned.size, false);
+    if (!xma_hw_buffer_pool_put(dev_tmp1, key, pinned.bo))
+        xclFreeBO(dev_tmp1->handle, pinned.bo.boHandle);
+    return true;
+}
+
 int32_t
 xma_frame_planes_get(XmaFrameProperties *frame_props)
 {
@@ -39,6 +196,19 @@ xma_frame_planes_get(XmaFrameProperties *frame_props)
     return frame_format_desc[frame_props->format].num_planes;
 }
 
+//Frees the buffer of a plane that is not a clone
+static void
+xma_frame_plane_release(XmaBufferRef *ref)
+{
+    if (ref->buffer == NULL || ref->is_clone)
+        return;
+    if (ref->buffer_type == XMA_DEVICE_BUFFER_TYPE)
+        xma_hw_frame_buffer_release((XmaHwFrameBuffer*) ref->buffer);
+    else if (!xma_pinned_free(ref->buffer))
+        free(ref->buffer);
+    ref->buffer = NULL;
+}
+
 XmaFrame*
 xma_frame_alloc(XmaFrameProperties *frame_props)
 {
@@ -65,6 +235,40 @@ xma_frame_alloc(XmaFrameProperties *frame_props)
     return frame;
 }
 
+XmaFrame*
+xma_frame_alloc_pinned(XmaFrameProperties *frame_props, int32_t dev_index, int32_t ddr_bank)
+{
+    int32_t num_planes;
+
+    xma_logmsg(XMA_DEBUG_LOG, XMA_BUFFER_MOD, "%s()\n", __func__);
+    XmaFrame *frame = (XmaFrame*) malloc(sizeof(XmaFrame));
+    if (frame  == NULL)
+        return NULL;
+    memset(frame, 0, sizeof(XmaFrame));
+    frame->frame_props = *frame_props;
+    num_planes = xma_frame_planes_get(frame_props);
+
+    for (int32_t i = 0; i < num_planes; i++)
+    {
+        frame->data[i].refcount++;
+        frame->data[i].buffer_type = XMA_HOST_BUFFER_TYPE;
+        frame->data[i].is_clone = false;
+        // TODO: Get plane size for each plane
+        frame->data[i].buffer = xma_pinned_alloc(frame_props->width *
+                                                 frame_props->height,
+                                                 dev_index, ddr_bank);
+        if (frame->data[i].buffer == NULL)
+        {
+            for (int32_t j = 0; j < i; j++)
+                xma_pinned_free(frame->data[j].buffer);
+            free(frame);
+            return NULL;
+        }
+    }
+
+    return frame;
+}
+
 XmaFrame*
 xma_frame_from_buffers_clone(XmaFrameProperties *frame_props,
                              XmaFrameData       *frame_data)
@@ -107,12 +311,95 @@ xma_frame_free(XmaFrame *frame)
     if (frame->data[0].refcount > 0)
         return;
 
-    for (int32_t i = 0; i < num_planes && !frame->data[i].is_clone; i++)
-        free(frame->data[i].buffer);
+    for (int32_t i = 0; i < num_planes; i++)
+        xma_frame_plane_release(&frame->data[i]);
 
     free(frame);
 }
 
+//Converts device planes to host planes. A host mapped device buffer
+//becomes a pinned buffer after a sync. A device only buffer is copied to
+//a pinned buffer on the same bank first.
+int32_t
+xma_frame_download(XmaFrame *frame)
+{
+    int32_t num_planes;
+
+    xma_logmsg(XMA_DEBUG_LOG, XMA_BUFFER_MOD,
+               "%s() Download frame %p\n", __func__, frame);
+    num_planes = xma_frame_planes_get(&frame->frame_props);
+
+    for (int32_t i = 0; i < num_planes; i++)
+    {
+        if (frame->data[i].buffer_type != XMA_DEVICE_BUFFER_TYPE)
+            continue;
+        XmaHwFrameBuffer *buf = (XmaHwFrameBuffer*) frame->data[i].buffer;
+        XmaHwDevice *dev_tmp1 = &g_xma_singleton->hwcfg.devices[buf->dev_index];
+        XmaHwPinnedBuffer pinned;
+        pinned.dev_index = buf->dev_index;
+        pinned.ddr_bank = buf->ddr_bank;
+        pinned.size = xma_hw_buffer_bucket(buf->size);
+        if (buf->device_only_buffer)
+        {
+            uint64_t key = xma_hw_buffer_pool_key(buf->ddr_bank, pinned.size, false);
+            if (!xma_hw_buffer_pool_get(dev_tmp1, key, pinned.bo) &&
+                !xma_hw_buffer_alloc_bo(dev_tmp1->handle, pinned.size, buf->ddr_bank, false, pinned.bo))
+                return XMA_ERROR;
+            if (xclCopyBO(dev_tmp1->handle, pinned.bo.boHandle, buf->bo.boHandle, buf->size, 0, 0) != 0)
+            {
+                xma_logmsg(XMA_ERROR_LOG, XMA_BUFFER_MOD,
+                           "%s() xclCopyBO failed\n", __func__);
+                if (!xma_hw_buffer_pool_put(dev_tmp1, key, pinned.bo))
+                    xclFreeBO(dev_tmp1->handle, pinned.bo.boHandle);
+                return XMA_ERROR;
+            }
+            xma_hw_frame_buffer_release(buf);
+        }
+        else
+        {
+            pinned.bo = buf->bo;
+            delete buf;
+        }
+        {
+            std::lock_guard<std::mutex> lk(pinned_mutex);
+            pinned_inuse.emplace(pinned.bo.data, pinned);
+        }
+        frame->data[i].buffer_type = XMA_HOST_BUFFER_TYPE;
+        frame->data[i].buffer = pinned.bo.data;
+        frame->data[i].is_clone = false;
+        if (xclSyncBO(dev_tmp1->handle, pinned.bo.boHandle, XCL_BO_SYNC_BO_FROM_DEVICE, pinned.size, 0) != 0)
+        {
+            xma_logmsg(XMA_ERROR_LOG, XMA_BUFFER_MOD,
+                       "%s() xclSyncBO failed\n", __func__);
+            return XMA_ERROR;
+        }
+    }
+
+    return XMA_SUCCESS;
+}
+
+void
+xma_hw_frame_buffer_release(XmaHwFrameBuffer *buf)
+{
+    XmaHwDevice *dev_tmp1 = &g_xma_singleton->hwcfg.devices[buf->dev_index];
+    uint64_t key = xma_hw_buffer_pool_key(buf->ddr_bank, xma_hw_buffer_bucket(buf->size),
+                                          buf->device_only_buffer);
+    if (!xma_hw_buffer_pool_put(dev_tmp1, key, buf->bo))
+        xclFreeBO(dev_tmp1->handle, buf->bo.boHandle);
+    delete buf;
+}
+
+void
+xma_hw_frame_attach(XmaFrame *frame, int32_t plane, XmaHwFrameBuffer *buf)
+{
+    xma_frame_plane_release(&frame->data[plane]);
+    if (frame->data[plane].refcount == 0)
+        frame->data[plane].refcount = frame->data[0].refcount > 0 ? frame->data[0].refcount : 1;
+    frame->data[plane].buffer_type = XMA_DEVICE_BUFFER_TYPE;
+    frame->data[plane].buffer = buf;
+    frame->data[plane].is_clone = false;
+}
+
 XmaDataBuffer*
 xma_data_from_buffer_clone(uint8_t *data, size_t size)
 {
@@ -156,6 +443,32 @@ xma_data_buffer_alloc(size_t size)
     return buffer;
 }
 
+XmaDataBuffer*
+xma_data_buffer_alloc_pinned(size_t size, int32_t dev_index, int32_t ddr_bank)
+{
+    xma_logmsg(XMA_DEBUG_LOG, XMA_BUFFER_MOD,
+               "%s() Allocate pinned buffer of size %lu\n", __func__, size);
+    XmaDataBuffer *buffer = (XmaDataBuffer*) malloc(sizeof(XmaDataBuffer));
+    if (buffer  == NULL)
+        return NULL;
+    memset(buffer, 0, sizeof(XmaDataBuffer));
+    buffer->data.refcount++;
+    buffer->data.buffer_type = XMA_HOST_BUFFER_TYPE;
+    buffer->data.is_clone = false;
+    buffer->data.buffer = xma_pinned_alloc(size, dev_index, ddr_bank);
+    if (buffer->data.buffer == NULL)
+    {
+        free(buffer);
+        return NULL;
+    }
+    buffer->alloc_size = size;
+    buffer->is_eof = 0;
+    buffer->pts = 0;
+    buffer->poc = 0;
+
+    return buffer;
+}
+
 void
 xma_data_buffer_free(XmaDataBuffer *data)
 {
@@ -165,7 +478,7 @@ xma_data_buffer_free(XmaDataBuffer *data)
     if (data->data.refcount > 0)
         return;
 
-    if (!data->data.is_clone)
+    if (!data->data.is_clone && !xma_pinned_free(data->data.buffer))
         free(data->data.buffer);
 
     free(data);
@@ -152,6 +152,19 @@ xma_dec_session_create(XmaDecoderProperties *dec_props)
     //dec_handle = dec_props->cu_index;
     
     XmaHwCfg *hwcfg = &g_xma_singleton->hwcfg;
+    if (dec_props->cu_select == XMA_CU_SELECT_LEAST_LOADED) {
+        if (xma_hw_select_cu(hwcfg, &dev_index, &cu_index) != XMA_SUCCESS) {
+            xma_logmsg(XMA_ERROR_LOG, XMA_DECODER_MOD,
+                       "XMA session creation failed. No CU to select\n");
+            //Release singleton lock
+            g_xma_singleton->locked = false;
+            return NULL;
+        }
+        dec_props->dev_index = dev_index;
+        dec_props->cu_index = cu_index;
+        dec_session->decoder_props.dev_index = dev_index;
+        dec_session->decoder_props.cu_index = cu_index;
+    }
     if (dev_index >= hwcfg->num_devices) {
         xma_logmsg(XMA_ERROR_LOG, XMA_DECODER_MOD,
                    "XMA session creation failed. dev_index not found\n");
@@ -169,6 +182,7 @@ xma_dec_session_create(XmaDecoderProperties *dec_props)
     dec_session->base.hw_session.kernel_info = &hwcfg->devices[dev_index].kernels[cu_index];
 
     dec_session->base.hw_session.dev_index = hwcfg->devices[dev_index].dev_index;
+    xma_hw_kernel_bind(dec_session->base.hw_session.kernel_info, 1);
 
     //dec_session->decoder_plugin = &g_xma_singleton->decodercfg[dec_handle];
 
@@ -194,8 +208,11 @@ xma_dec_session_create(XmaDecoderProperties *dec_props)
     //Sarab: Remove it later on
     return NULL;
 
+    xma_hw_session_stats_init(&dec_session->base);
     if (dec_session->decoder_plugin->init(dec_session)) {
         free(dec_session->base.plugin_data);
+        xma_hw_kernel_bind(dec_session->base.hw_session.kernel_info, -1);
+        xma_hw_session_stats_release(&dec_session->base);
         free(dec_session);
         return NULL;
     }
@@ -227,6 +244,8 @@ xma_dec_session_destroy(XmaDecoderSession *session)
     */
     // Free the session
     // TODO: (should also free the Hw sessions)
+    xma_hw_kernel_bind(session->base.hw_session.kernel_info, -1);
+    xma_hw_session_stats_release(&session->base);
     free(session);
 
     return XMA_SUCCESS;
@@ -238,7 +257,12 @@ xma_dec_session_send_data(XmaDecoderSession *session,
 						  int32_t           *data_used)
 {
     xma_logmsg(XMA_DEBUG_LOG, XMA_DECODER_MOD, "%s()\n", __func__);
-    return session->decoder_plugin->send_data(session, data, data_used);
+    uint64_t start_ns = xma_hw_now_ns();
+    int32_t rc = session->decoder_plugin->send_data(session, data, data_used);
+    bool sent = rc >= 0 && *data_used > 0;
+    xma_hw_session_stats_record(&session->base, XMA_STATS_SEND, start_ns,
+                                sent ? 1 : 0, 0, sent ? *data_used : 0);
+    return rc;
 }
 
 int32_t
@@ -254,5 +278,18 @@ xma_dec_session_recv_frame(XmaDecoderSession *session,
                            XmaFrame           *frame)
 {
     xma_logmsg(XMA_DEBUG_LOG, XMA_DECODER_MOD, "%s()\n", __func__);
-    return session->decoder_plugin->recv_frame(session, frame);
+    uint64_t start_ns = xma_hw_now_ns();
+    int32_t rc = session->decoder_plugin->recv_frame(session, frame);
+    bool received = rc == XMA_SUCCESS;
+    xma_hw_session_stats_record(&session->base, XMA_STATS_RECV, start_ns, received ? 1 : 0,
+                                received ? (uint64_t)frame->frame_props.width * frame->frame_props.height : 0, 0);
+    return rc;
+}
+
+int32_t
+xma_dec_session_stats_get(XmaDecoderSession *session,
+                          XmaSessionStats   *stats)
+{
+    xma_logmsg(XMA_DEBUG_LOG, XMA_DECODER_MOD, "%s()\n", __func__);
+    return xma_hw_session_stats_get(&session->base, stats);
 }
@@ -187,6 +187,19 @@ xma_enc_session_create(XmaEncoderProperties *enc_props)
     //enc_handle = enc_props->cu_index;
 
     XmaHwCfg *hwcfg = &g_xma_singleton->hwcfg;
+    if (enc_props->cu_select == XMA_CU_SELECT_LEAST_LOADED) {
+        if (xma_hw_select_cu(hwcfg, &dev_index, &cu_index) != XMA_SUCCESS) {
+            xma_logmsg(XMA_ERROR_LOG, XMA_ENCODER_MOD,
+                       "XMA session creation failed. No CU to select\n");
+            //Release singleton lock
+            g_xma_singleton->locked = false;
+            return NULL;
+        }
+        enc_props->dev_index = dev_index;
+        enc_props->cu_index = cu_index;
+        enc_session->encoder_props.dev_index = dev_index;
+        enc_session->encoder_props.cu_index = cu_index;
+    }
     if (dev_index >= hwcfg->num_devices) {
         xma_logmsg(XMA_ERROR_LOG, XMA_ENCODER_MOD,
                    "XMA session creation failed. dev_index not found\n");
@@ -203,6 +216,7 @@ xma_enc_session_create(XmaEncoderProperties *enc_props)
     enc_session->base.hw_session.kernel_info = &hwcfg->devices[dev_index].kernels[cu_index];
 
     enc_session->base.hw_session.dev_index = hwcfg->devices[dev_index].dev_index;
+    xma_hw_kernel_bind(enc_session->base.hw_session.kernel_info, 1);
 
     //enc_session->encoder_plugin = &g_xma_singleton->encodercfg[enc_handle];
 
@@ -240,6 +254,7 @@ xma_enc_session_create(XmaEncoderProperties *enc_props)
     //Sarab: Remove it later on
     return NULL;
 
+    xma_hw_session_stats_init(&enc_session->base);
     rc = enc_session->encoder_plugin->init(enc_session);
     if (rc) {
         xma_logmsg(XMA_ERROR_LOG, XMA_ENCODER_MOD,
@@ -247,6 +262,8 @@ xma_enc_session_create(XmaEncoderProperties *enc_props)
                    rc);
         free(enc_session->base.plugin_data);
         //xma_connect_free(enc_session->conn_recv_handle, XMA_CONNECT_RECEIVER);
+        xma_hw_kernel_bind(enc_session->base.hw_session.kernel_info, -1);
+        xma_hw_session_stats_release(&enc_session->base);
         free(enc_session);
         return NULL;
     }
@@ -290,6 +307,8 @@ xma_enc_session_destroy(XmaEncoderSession *session)
     */
     // Free the session
     // TODO: (should also free the Hw sessions)
+    xma_hw_kernel_bind(session->base.hw_session.kernel_info, -1);
+    xma_hw_session_stats_release(&session->base);
     free(session);
 
     return XMA_SUCCESS;
@@ -307,14 +326,18 @@ xma_enc_session_send_frame(XmaEncoderSession *session,
     xma_logmsg(XMA_DEBUG_LOG, XMA_ENCODER_MOD, "%s()\n", __func__);
     clock_gettime(CLOCK_MONOTONIC, &ts);  
     timestamp = (ts.tv_sec * 1000000000) + ts.tv_nsec;
+    uint64_t start_ns = xma_hw_now_ns();
     rc = session->encoder_plugin->send_frame(session, frame);
+    frame_size = frame->frame_props.width * frame->frame_props.height; 
     if (frame->do_not_encode == false)
     {
-        frame_size = frame->frame_props.width * frame->frame_props.height; 
         xma_enc_session_statsfile_send_frame(session, 
                                              timestamp,
                                              frame_size);
     }
+    bool sent = rc >= 0 && frame->data[0].buffer != NULL;
+    xma_hw_session_stats_record(&session->base, XMA_STATS_SEND, start_ns,
+                                sent ? 1 : 0, sent ? frame_size : 0, 0);
     return rc;
 
 }
@@ -329,7 +352,10 @@ xma_enc_session_recv_data(XmaEncoderSession *session,
     uint64_t timestamp;
 
     xma_logmsg(XMA_DEBUG_LOG, XMA_ENCODER_MOD, "%s()\n", __func__);
+    uint64_t start_ns = xma_hw_now_ns();
     rc = session->encoder_plugin->recv_data(session, data, data_size);
+    xma_hw_session_stats_record(&session->base, XMA_STATS_RECV, start_ns,
+                                *data_size > 0 ? 1 : 0, 0, *data_size > 0 ? *data_size : 0);
     if (*data_size)
     {
         clock_gettime(CLOCK_MONOTONIC, &ts);  
@@ -342,6 +368,14 @@ xma_enc_session_recv_data(XmaEncoderSession *session,
     return rc;
 }
 
+int32_t
+xma_enc_session_stats_get(XmaEncoderSession *session,
+                          XmaSessionStats   *stats)
+{
+    xma_logmsg(XMA_DEBUG_LOG, XMA_ENCODER_MOD, "%s()\n", __func__);
+    return xma_hw_session_stats_get(&session->base, stats);
+}
+
 void 
 xma_enc_session_statsfile_init(XmaEncoderSession *session)
 {
@@ -206,12 +206,14 @@ xma_filter_session_create(XmaFilterProperties *filter_props)
     //Sarab: Remove it later on
     return NULL;
 
+    xma_hw_session_stats_init(&filter_session->base);
     rc = filter_session->filter_plugin->init(filter_session);
     if (rc) {
         xma_logmsg(XMA_ERROR_LOG, XMA_FILTER_MOD,
                    "Initalization of filter plugin failed. Return code %d\n",
                    rc);
         free(filter_session->base.plugin_data);
+        xma_hw_session_stats_release(&filter_session->base);
         //xma_connect_free(filter_session->conn_send_handle, XMA_CONNECT_SENDER);
         free(filter_session);
         return NULL;
@@ -251,6 +253,7 @@ xma_filter_session_destroy(XmaFilterSession *session)
     */
     // Free the session
     // TODO: (should also free the Hw sessions)
+    xma_hw_session_stats_release(&session->base);
     free(session);
 
     return XMA_SUCCESS;
@@ -285,7 +288,12 @@ xma_filter_session_send_frame(XmaFilterSession  *session,
     }
 send:
     */
-    return session->filter_plugin->send_frame(session, frame);
+    uint64_t start_ns = xma_hw_now_ns();
+    int32_t rc = session->filter_plugin->send_frame(session, frame);
+    bool sent = rc >= 0 && frame->data[0].buffer != NULL;
+    xma_hw_session_stats_record(&session->base, XMA_STATS_SEND, start_ns, sent ? 1 : 0,
+                                sent ? (uint64_t)frame->frame_props.width * frame->frame_props.height : 0, 0);
+    return rc;
 }
 
 int32_t
@@ -293,5 +301,18 @@ xma_filter_session_recv_frame(XmaFilterSession  *session,
                               XmaFrame          *frame)
 {
     xma_logmsg(XMA_DEBUG_LOG, XMA_FILTER_MOD, "%s()\n", __func__);
-    return session->filter_plugin->recv_frame(session, frame);
+    uint64_t start_ns = xma_hw_now_ns();
+    int32_t rc = session->filter_plugin->recv_frame(session, frame);
+    bool received = rc == XMA_SUCCESS;
+    xma_hw_session_stats_record(&session->base, XMA_STATS_RECV, start_ns, received ? 1 : 0,
+                                received ? (uint64_t)frame->frame_props.width * frame->frame_props.height : 0, 0);
+    return rc;
+}
+
+int32_t
+xma_filter_session_stats_get(XmaFilterSession *session,
+                             XmaSessionStats  *stats)
+{
+    xma_logmsg(XMA_DEBUG_LOG, XMA_FILTER_MOD, "%s()\n", __func__);
+    return xma_hw_session_stats_get(&session->base, stats);
 }
@@ -23,6 +23,10 @@
 #include <fcntl.h>
 #include <sys/ioctl.h>
 #include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "xrt.h"
 #include "app/xmaerror.h"
 #include "app/xmalogger.h"
@@ -31,6 +35,10 @@
 #include "lib/xmahw_private.h"
 #include <dlfcn.h>
 #include <iostream>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include "ert.h"
 
 //#define xma_logmsg(f_, ...) printf((f_), ##__VA_ARGS__)
@@ -85,6 +93,16 @@ int load_xclbin_to_device(xclDeviceHandle dev_handle, const char *buffer)
     return rc;
 }
 
+//A shared context on the virtual CU can only be opened for the loaded xclbin
+static bool xclbin_loaded_on_device(xclDeviceHandle dev_handle, uuid_t uuid)
+{
+    if (xclOpenContext(dev_handle, uuid, -1, true) != 0)
+        return false;
+
+    xclCloseContext(dev_handle, uuid, -1);
+    return true;
+}
+
 /*Sarab: Remove yaml system cfg stuff
 int get_max_dev_id(XmaSystemCfg *systemcfg)
 {
@@ -165,10 +183,164 @@ bool hal_is_compatible(XmaHwCfg *hwcfg, XmaXclbinParameter *devXclbins, int32_t
 }
 
 
+//Opens the device, loads the xclbin unless already loaded and sets up its CUs and execBOs
+static bool hal_configure_device(XmaHwDevice& dev_tmp1, const std::string& xclbin, int32_t dev_index)
+{
+    XmaXclbinInfo info;
+    size_t buffer_size = 0;
+    char *buffer = xma_xclbin_file_open(xclbin.c_str(), &buffer_size);
+    if (!buffer)
+    {
+        xma_logmsg(XMA_ERROR_LOG, XMAAPI_MOD, "Could not open xclbin file %s\n",
+                   xclbin.c_str());
+        return false;
+    }
+    int32_t rc = xma_xclbin_info_get(buffer, &info);
+    if (rc != XMA_SUCCESS)
+    {
+        xma_logmsg(XMA_ERROR_LOG, XMAAPI_MOD, "Could not get info for xclbin file %s\n",
+                   xclbin.c_str());
+        xma_xclbin_file_close(buffer, buffer_size);
+        return false;
+    }
+
+    dev_tmp1.kernels.reserve(MAX_KERNEL_CONFIGS);
+
+    dev_tmp1.handle = xclOpen(dev_index, NULL, XCL_QUIET);
+    if (dev_tmp1.handle == NULL){
+        xma_logmsg(XMA_ERROR_LOG, XMAAPI_MOD, "Unable to open device  id: %d\n", dev_index);
+        xma_xclbin_file_close(buffer, buffer_size);
+        return false;
+    }
+    dev_tmp1.dev_index = dev_index;
+    xma_logmsg(XMA_INFO_LOG, XMAAPI_MOD, "get_device_list xclOpen handle = %p\n",
+        dev_tmp1.handle);
+    rc = xclGetDeviceInfo2(dev_tmp1.handle, &dev_tmp1.info);
+    if (rc != 0)
+    {
+        xma_logmsg(XMA_ERROR_LOG, XMAAPI_MOD, "xclGetDeviceInfo2 failed for device id: %d, rc=%d\n", dev_index, rc);
+        xma_xclbin_file_close(buffer, buffer_size);
+        return false;
+    }
+
+    /* Download xclbin unless the device already has it */
+    if (xclbin_loaded_on_device(dev_tmp1.handle, info.uuid)) {
+        xma_logmsg(XMA_INFO_LOG, XMAAPI_MOD, "xclbin %s already loaded on device %d\n",
+                    xclbin.c_str(), dev_index);
+        rc = 0;
+    } else {
+        rc = load_xclbin_to_device(dev_tmp1.handle, buffer);
+    }
+    if (rc != 0) {
+        xma_xclbin_file_close(buffer, buffer_size);
+        xma_logmsg(XMA_ERROR_LOG, XMAAPI_MOD, "Could not download xclbin file %s to device %d\n",
+                    xclbin.c_str(), dev_index);
+        return false;
+    }
+    uuid_copy(dev_tmp1.uuid, info.uuid); 
+    dev_tmp1.number_of_cus = info.number_of_kernels;
+    dev_tmp1.number_of_mem_banks = info.number_of_mem_banks;
+
+    xma_logmsg(XMA_DEBUG_LOG, XMAAPI_MOD,"For device id: %d; CUs are:\n", dev_index);
+    for (uint32_t d = 0; d < info.number_of_kernels; d++) {
+        dev_tmp1.kernels.emplace_back(XmaHwKernel{});
+        XmaHwKernel& tmp1 = dev_tmp1.kernels.back();
+        strcpy((char*)tmp1.name,
+            (const char*)info.ip_layout[d].kernel_name);
+        tmp1.base_address = info.ip_layout[d].base_addr;
+        tmp1.cu_index = (int32_t)d;
+
+        rc = xma_xclbin_map2ddr(info.ip_ddr_mapping[d], &tmp1.ddr_bank);
+        //XMA supports only 1 Bank per Kernel
+
+        xma_logmsg(XMA_DEBUG_LOG, XMAAPI_MOD,"\tCU# %d - %s - DDR bank:\n", d, tmp1.name, tmp1.ddr_bank);
+        if (xclOpenContext(dev_tmp1.handle, info.uuid, d, true) != 0) {
+            xma_xclbin_file_close(buffer, buffer_size);
+            xma_logmsg(XMA_ERROR_LOG, XMAAPI_MOD, "Failed to open context to this CU\n");
+            return false;
+        }
+        tmp1.private_do_not_use = (void*) &dev_tmp1;
+    }
+
+    for (uint32_t d1 = 0; d1 < info.number_of_kernels; d1++) {
+        uint64_t base_addr1 = dev_tmp1.kernels[d1].base_address;
+        uint64_t cu_mask = 1;
+        for (uint32_t d2 = 0; d2 < info.number_of_kernels; d2++) {
+            if (d1 != d2) {
+                if (dev_tmp1.kernels[d2].base_address < base_addr1) {
+                    cu_mask = cu_mask << 1;
+                }
+            }
+        }
+        dev_tmp1.kernels[d1].cu_mask0 = cu_mask & 0xFFFFFFFF;
+        dev_tmp1.kernels[d1].cu_mask1 = ((uint64_t)(cu_mask >> 32)) & 0xFFFFFFFF;
+    }
+
+    int32_t num_execbo = 0;
+    if (dev_tmp1.number_of_cus > MIN_EXECBO_POOL_SIZE) {
+        num_execbo = dev_tmp1.number_of_cus;
+    } else {
+        num_execbo = MIN_EXECBO_POOL_SIZE;
+    }
+    dev_tmp1.kernel_execbo_handle.reserve(num_execbo);
+    dev_tmp1.kernel_execbo_data.reserve(num_execbo);
+    dev_tmp1.kernel_execbo_inuse.reserve(num_execbo);
+    dev_tmp1.kernel_execbo_cu_index.reserve(num_execbo);
+    dev_tmp1.kernel_execbo_regmap_kernel.reserve(num_execbo);
+    dev_tmp1.kernel_execbo_regmap_serial.reserve(num_execbo);
+    dev_tmp1.kernel_execbo_kernel.reserve(num_execbo);
+    dev_tmp1.kernel_execbo_session.reserve(num_execbo);
+    dev_tmp1.kernel_execbo_group.reserve(num_execbo);
+    dev_tmp1.kernel_execbo_stats.reserve(num_execbo);
+    dev_tmp1.kernel_execbo_submit_ns.reserve(num_execbo);
+    dev_tmp1.execbo_free.reserve(num_execbo);
+    dev_tmp1.num_execbo_allocated = num_execbo;
+    for (int32_t d = 0; d < num_execbo; d++) {
+        uint32_t  bo_handle;
+        int       execBO_size = MAX_EXECBO_BUFF_SIZE;
+        //uint32_t  execBO_flags = (1<<31);
+        char     *bo_data;
+        bo_handle = xclAllocBO(dev_tmp1.handle, 
+                                execBO_size, 
+                                0, 
+                                XCL_BO_FLAGS_EXECBUF);
+        if (!bo_handle || bo_handle == mNullBO) 
+        {
+            xma_xclbin_file_close(buffer, buffer_size);
+            xma_logmsg(XMA_ERROR_LOG, XMAAPI_MOD, "Unable to create bo for cu start\n");
+            return false;
+        }
+        bo_data = (char*)xclMapBO(dev_tmp1.handle, bo_handle, true);
+        memset((void*)bo_data, 0x0, execBO_size);
+        dev_tmp1.kernel_execbo_handle.emplace_back(bo_handle);
+        dev_tmp1.kernel_execbo_data.emplace_back(bo_data);
+        dev_tmp1.kernel_execbo_inuse.emplace_back(false);
+        dev_tmp1.kernel_execbo_cu_index.emplace_back(-1);
+        dev_tmp1.kernel_execbo_regmap_kernel.emplace_back(nullptr);
+        dev_tmp1.kernel_execbo_regmap_serial.emplace_back(0);
+        dev_tmp1.kernel_execbo_kernel.emplace_back(nullptr);
+        dev_tmp1.kernel_execbo_session.emplace_back(0);
+        dev_tmp1.kernel_execbo_group.emplace_back(0);
+        dev_tmp1.kernel_execbo_stats.emplace_back(nullptr);
+        dev_tmp1.kernel_execbo_submit_ns.emplace_back(0);
+        dev_tmp1.execbo_free.emplace_back(num_execbo - 1 - d);
+        /*
+        ert_start_kernel_cmd* cu_start_cmd = (ert_start_kernel_cmd*) bo_data;
+        cu_start_cmd->state = ERT_CMD_STATE_NEW;
+        cu_start_cmd->opcode = ERT_START_CU;
+        cu_start_cmd->cu_mask = cu_bit_mask;
+        */
+    }
+
+    xma_hw_shm_map(&dev_tmp1);
+    xma_xclbin_file_close(buffer, buffer_size);
+
+    return true;
+}
+
 //bool hal_configure(XmaHwCfg *hwcfg, XmaSystemCfg *systemcfg, bool hw_configured)
 bool hal_configure(XmaHwCfg *hwcfg, XmaXclbinParameter *devXclbins, int32_t num_parms)
 {
-    XmaXclbinInfo info;
     if (hwcfg == NULL) {
         xma_logmsg(XMA_ERROR_LOG, XMAAPI_MOD, "hwcfg is NULL\n");
         return false;
@@ -179,142 +351,226 @@ bool hal_configure(XmaHwCfg *hwcfg, XmaXclbinParameter *devXclbins, int32_t num_
         return false;
     }
 
-    /* Download the requested image to the associated device */
+    std::vector<bool> requested(hwcfg->num_devices, false);
     for (int32_t i = 0; i < num_parms; i++) {
-        std::string xclbin = std::string(devXclbins[i].xclbin_name);
         int32_t dev_index = devXclbins[i].device_id;
-        if (dev_index >= hwcfg->num_devices) {
+        if (dev_index < 0 || dev_index >= hwcfg->num_devices) {
             xma_logmsg(XMA_ERROR_LOG, XMAAPI_MOD, "Illegal dev_index for xclbin to load into. dev_index = %d\n",
                        dev_index);
             return false;
         }
-        char *buffer = xma_xclbin_file_open(xclbin.c_str());
-        if (!buffer)
-        {
-            xma_logmsg(XMA_ERROR_LOG, XMAAPI_MOD, "Could not open xclbin file %s\n",
-                       xclbin.c_str());
-            return false;
-        }
-        int32_t rc = xma_xclbin_info_get(buffer, &info);
-        if (rc != XMA_SUCCESS)
-        {
-            xma_logmsg(XMA_ERROR_LOG, XMAAPI_MOD, "Could not get info for xclbin file %s\n",
-                       xclbin.c_str());
-            free(buffer);
+        if (requested[dev_index]) {
+            xma_logmsg(XMA_ERROR_LOG, XMAAPI_MOD, "More than one xclbin for device %d\n", dev_index);
             return false;
         }
+        requested[dev_index] = true;
+    }
 
+    //Kernels point to their device, no reallocation once configured
+    size_t first = hwcfg->devices.size();
+    hwcfg->devices.reserve(first + num_parms);
+    for (int32_t i = 0; i < num_parms; i++)
         hwcfg->devices.emplace_back(XmaHwDevice{});
 
-        XmaHwDevice& dev_tmp1 = hwcfg->devices.back();
-        dev_tmp1.kernels.reserve(MAX_KERNEL_CONFIGS);
+    //Download the requested images to the devices concurrently; xclbin
+    //load time dominates and devices are independent
+    std::vector<char> configured(num_parms, false);
+    std::vector<std::thread> threads;
+    for (int32_t i = 0; i < num_parms; i++) {
+        threads.emplace_back([&, i] {
+            configured[i] = hal_configure_device(hwcfg->devices[first + i],
+                                                 devXclbins[i].xclbin_name,
+                                                 devXclbins[i].device_id);
+        });
+    }
+    for (auto& t : threads)
+        t.join();
 
-        dev_tmp1.handle = xclOpen(dev_index, NULL, XCL_QUIET);
-        if (dev_tmp1.handle == NULL){
-            xma_logmsg(XMA_ERROR_LOG, XMAAPI_MOD, "Unable to open device  id: %d\n", dev_index);
-            free(buffer);
-            return false;
-        }
-        dev_tmp1.dev_index = dev_index;
-        xma_logmsg(XMA_INFO_LOG, XMAAPI_MOD, "get_device_list xclOpen handle = %p\n",
-            dev_tmp1.handle);
-        rc = xclGetDeviceInfo2(dev_tmp1.handle, &dev_tmp1.info);
-        if (rc != 0)
-        {
-            xma_logmsg(XMA_ERROR_LOG, XMAAPI_MOD, "xclGetDeviceInfo2 failed for device id: %d, rc=%d\n", dev_index, rc);
-            free(buffer);
-            return false;
+    bool rc = true;
+    for (int32_t i = 0; i < num_parms; i++) {
+        if (!configured[i]) {
+            xma_logmsg(XMA_ERROR_LOG, XMAAPI_MOD, "Failed to configure device %d with xclbin %s\n",
+                       devXclbins[i].device_id, devXclbins[i].xclbin_name);
+            rc = false;
         }
+    }
+    return rc;
+}
 
-        /* Always attempt download xclbin */
-        rc = load_xclbin_to_device(dev_tmp1.handle, buffer);
-        if (rc != 0) {
-            free(buffer);
-            xma_logmsg(XMA_ERROR_LOG, XMAAPI_MOD, "Could not download xclbin file %s to device %d\n",
-                        xclbin.c_str(), dev_index);
-            return false;
-        }
-        uuid_copy(dev_tmp1.uuid, info.uuid); 
-        dev_tmp1.number_of_cus = info.number_of_kernels;
-        dev_tmp1.number_of_mem_banks = info.number_of_mem_banks;
-
-        xma_logmsg(XMA_DEBUG_LOG, XMAAPI_MOD,"For device id: %d; CUs are:\n", dev_index);
-        for (uint32_t d = 0; d < info.number_of_kernels; d++) {
-            dev_tmp1.kernels.emplace_back(XmaHwKernel{});
-            XmaHwKernel& tmp1 = dev_tmp1.kernels.back();
-            strcpy((char*)tmp1.name,
-                (const char*)info.ip_layout[d].kernel_name);
-            tmp1.base_address = info.ip_layout[d].base_addr;
-            tmp1.cu_index = (int32_t)d;
-
-            rc = xma_xclbin_map2ddr(info.ip_ddr_mapping[d], &tmp1.ddr_bank);
-            //XMA supports only 1 Bank per Kernel
-
-            xma_logmsg(XMA_DEBUG_LOG, XMAAPI_MOD,"\tCU# %d - %s - DDR bank:\n", d, tmp1.name, tmp1.ddr_bank);
-            if (xclOpenContext(dev_tmp1.handle, info.uuid, d, true) != 0) {
-                free(buffer);
-                xma_logmsg(XMA_ERROR_LOG, XMAAPI_MOD, "Failed to open context to this CU\n");
-                return false;
-            }
-            tmp1.private_do_not_use = (void*) &hwcfg->devices[hwcfg->devices.size()-1];
-        }
+uint64_t
+xma_hw_now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
 
-        for (uint32_t d1 = 0; d1 < info.number_of_kernels; d1++) {
-            uint64_t base_addr1 = dev_tmp1.kernels[d1].base_address;
-            uint64_t cu_mask = 1;
-            for (uint32_t d2 = 0; d2 < info.number_of_kernels; d2++) {
-                if (d1 != d2) {
-                    if (dev_tmp1.kernels[d2].base_address < base_addr1) {
-                        cu_mask = cu_mask << 1;
-                    }
-                }
+double
+xma_hw_kernel_load(XmaHwKernel *kernel, uint64_t now_ns)
+{
+    uint64_t busy_ns = kernel->busy_ns;
+    if (!kernel->execbo_inflight.empty())
+        busy_ns += now_ns - kernel->busy_start_ns;
+    uint64_t elapsed_ns = now_ns - kernel->load_window_start_ns;
+    if (elapsed_ns >= XMA_LOAD_WINDOW_NS) {
+        kernel->busy_ratio = (double)(busy_ns - kernel->load_window_busy_ns) / elapsed_ns;
+        kernel->load_window_start_ns = now_ns;
+        kernel->load_window_busy_ns = busy_ns;
+    }
+    int32_t num_sessions = kernel->num_sessions;
+    XmaHwDevice *dev_tmp1 = (XmaHwDevice*)kernel->private_do_not_use;
+    if (dev_tmp1 != NULL)
+        num_sessions += xma_hw_shm_sessions(dev_tmp1, kernel);
+    return kernel->busy_ratio + 0.1 * num_sessions + 0.01 * kernel->execbo_inflight.size();
+}
+
+int32_t
+xma_hw_select_cu(XmaHwCfg *hwcfg, int32_t *dev_index, int32_t *cu_index)
+{
+    if (*dev_index < 0 || *dev_index >= hwcfg->num_devices ||
+        *cu_index < 0 || *cu_index >= (int32_t)hwcfg->devices[*dev_index].kernels.size()) {
+        xma_logmsg(XMA_ERROR_LOG, XMAAPI_MOD, "CU selection failed. Invalid dev_index %d or cu_index %d\n",
+                   *dev_index, *cu_index);
+        return XMA_ERROR;
+    }
+    const char *name = (const char*)hwcfg->devices[*dev_index].kernels[*cu_index].name;
+    uint64_t now_ns = xma_hw_now_ns();
+    double best_load = 0;
+    bool found = false;
+    for (int32_t d = 0; d < hwcfg->num_devices; d++) {
+        XmaHwDevice& dev_tmp1 = hwcfg->devices[d];
+        std::lock_guard<std::mutex> lk(*dev_tmp1.execbo_mutex);
+        for (uint32_t k = 0; k < dev_tmp1.kernels.size(); k++) {
+            XmaHwKernel& kernel = dev_tmp1.kernels[k];
+            if (strcmp((const char*)kernel.name, name) != 0)
+                continue;
+            double load = xma_hw_kernel_load(&kernel, now_ns);
+            if (!found || load < best_load) {
+                found = true;
+                best_load = load;
+                *dev_index = d;
+                *cu_index = k;
             }
-            dev_tmp1.kernels[d1].cu_mask0 = cu_mask & 0xFFFFFFFF;
-            dev_tmp1.kernels[d1].cu_mask1 = ((uint64_t)(cu_mask >> 32)) & 0xFFFFFFFF;
         }
+    }
+    xma_logmsg(XMA_DEBUG_LOG, XMAAPI_MOD, "Selected CU %d on device %d for kernel %s; load %f\n",
+               *cu_index, *dev_index, name, best_load);
+    return XMA_SUCCESS;
+}
 
-        int32_t num_execbo = 0;
-        if (dev_tmp1.number_of_cus > MIN_EXECBO_POOL_SIZE) {
-            num_execbo = dev_tmp1.number_of_cus;
-        } else {
-            num_execbo = MIN_EXECBO_POOL_SIZE;
-        }
-        dev_tmp1.kernel_execbo_handle.reserve(num_execbo);
-        dev_tmp1.kernel_execbo_data.reserve(num_execbo);
-        dev_tmp1.kernel_execbo_inuse.reserve(num_execbo);
-        dev_tmp1.num_execbo_allocated = num_execbo;
-        for (int32_t d = 0; d < num_execbo; d++) {
-            uint32_t  bo_handle;
-            int       execBO_size = MAX_EXECBO_BUFF_SIZE;
-            //uint32_t  execBO_flags = (1<<31);
-            char     *bo_data;
-            bo_handle = xclAllocBO(dev_tmp1.handle, 
-                                    execBO_size, 
-                                    0, 
-                                    XCL_BO_FLAGS_EXECBUF);
-            if (!bo_handle || bo_handle == mNullBO) 
-            {
-                free(buffer);
-                xma_logmsg(XMA_ERROR_LOG, XMAAPI_MOD, "Unable to create bo for cu start\n");
-                return false;
-            }
-            bo_data = (char*)xclMapBO(dev_tmp1.handle, bo_handle, true);
-            memset((void*)bo_data, 0x0, execBO_size);
-            dev_tmp1.kernel_execbo_handle.emplace_back(bo_handle);
-            dev_tmp1.kernel_execbo_data.emplace_back(bo_data);
-            dev_tmp1.kernel_execbo_inuse.emplace_back(false);
-            /*
-            ert_start_kernel_cmd* cu_start_cmd = (ert_start_kernel_cmd*) bo_data;
-            cu_start_cmd->state = ERT_CMD_STATE_NEW;
-            cu_start_cmd->opcode = ERT_START_CU;
-            cu_start_cmd->cu_mask = cu_bit_mask;
-            */
+void
+xma_hw_kernel_bind(XmaHwKernel *kernel, int32_t delta)
+{
+    XmaHwDevice *dev_tmp1 = (XmaHwDevice*)kernel->private_do_not_use;
+    if (dev_tmp1 == NULL)
+        return;
+    std::lock_guard<std::mutex> lk(*dev_tmp1->execbo_mutex);
+    kernel->num_sessions += delta;
+    xma_hw_shm_bind(dev_tmp1, kernel, delta);
+}
+
+//Frees the slot if its process no longer exists
+static void
+xma_hw_shm_reclaim(XmaShmCuSlot *slot)
+{
+    int32_t pid = slot->pid.load();
+    if (pid <= 0 || kill(pid, 0) == 0 || errno != ESRCH)
+        return;
+    if (!slot->pid.compare_exchange_strong(pid, -1))
+        return;
+    slot->num_sessions.store(0);
+    slot->pid.store(0);
+}
+
+void
+xma_hw_shm_map(XmaHwDevice *dev)
+{
+    //One table per device and xclbin; CU indexes differ between xclbins
+    char uuid_str[40];
+    uuid_unparse(dev->uuid, uuid_str);
+    std::string shm_name = "/xma_cu_table_" + std::to_string(dev->dev_index) + "_" + uuid_str;
+
+    //Every process creates and sizes the table the same way; ftruncate
+    //to the current size keeps the contents, so no init lock is needed
+    int fd = shm_open(shm_name.c_str(), O_CREAT | O_RDWR, 0666);
+    if (fd < 0) {
+        xma_logmsg(XMA_INFO_LOG, XMAAPI_MOD, "Unable to open shared CU table %s. errno %d\n",
+                   shm_name.c_str(), errno);
+        return;
+    }
+    fchmod(fd, 0666);
+    if (ftruncate(fd, sizeof(XmaShmCuTable)) != 0) {
+        xma_logmsg(XMA_INFO_LOG, XMAAPI_MOD, "Unable to size shared CU table %s. errno %d\n",
+                   shm_name.c_str(), errno);
+        close(fd);
+        return;
+    }
+    void *addr = mmap(NULL, sizeof(XmaShmCuTable), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        xma_logmsg(XMA_INFO_LOG, XMAAPI_MOD, "Unable to map shared CU table %s. errno %d\n",
+                   shm_name.c_str(), errno);
+        return;
+    }
+    dev->shm_cu_table = (XmaShmCuTable*)addr;
+
+    for (uint32_t k = 0; k < dev->kernels.size() && k < MAX_KERNEL_CONFIGS; k++) {
+        for (int32_t i = 0; i < MAX_SHM_CU_PROCS; i++) {
+            xma_hw_shm_reclaim(&dev->shm_cu_table->slots[k][i]);
         }
+    }
+    xma_logmsg(XMA_DEBUG_LOG, XMAAPI_MOD, "Mapped shared CU table %s\n", shm_name.c_str());
+}
 
-        free(buffer);
+int32_t
+xma_hw_shm_sessions(XmaHwDevice *dev, XmaHwKernel *kernel)
+{
+    if (dev->shm_cu_table == NULL || kernel->cu_index < 0 || kernel->cu_index >= MAX_KERNEL_CONFIGS)
+        return 0;
+    int32_t num_sessions = 0;
+    XmaShmCuSlot *slots = dev->shm_cu_table->slots[kernel->cu_index];
+    for (int32_t i = 0; i < MAX_SHM_CU_PROCS; i++) {
+        if (i == kernel->shm_slot || slots[i].pid.load(std::memory_order_relaxed) <= 0)
+            continue;
+        num_sessions += slots[i].num_sessions.load(std::memory_order_relaxed);
     }
+    return num_sessions;
+}
 
-    return true;
+void
+xma_hw_shm_bind(XmaHwDevice *dev, XmaHwKernel *kernel, int32_t delta)
+{
+    if (dev->shm_cu_table == NULL || kernel->cu_index < 0 || kernel->cu_index >= MAX_KERNEL_CONFIGS)
+        return;
+    XmaShmCuSlot *slots = dev->shm_cu_table->slots[kernel->cu_index];
+    if (kernel->shm_slot < 0) {
+        if (delta <= 0)
+            return;
+        int32_t pid = getpid();
+        //Second pass frees slots of processes that exited
+        for (int32_t pass = 0; pass < 2 && kernel->shm_slot < 0; pass++) {
+            for (int32_t i = 0; i < MAX_SHM_CU_PROCS; i++) {
+                int32_t expected = 0;
+                if (pass == 1)
+                    xma_hw_shm_reclaim(&slots[i]);
+                if (slots[i].pid.compare_exchange_strong(expected, pid)) {
+                    kernel->shm_slot = i;
+                    break;
+                }
+            }
+        }
+        if (kernel->shm_slot < 0) {
+            xma_logmsg(XMA_DEBUG_LOG, XMAAPI_MOD, "Shared CU table full for CU %d\n", kernel->cu_index);
+            return;
+        }
+        slots[kernel->shm_slot].num_sessions.store(0);
+    }
+    slots[kernel->shm_slot].num_sessions.fetch_add(delta);
+    if (kernel->num_sessions <= 0) {
+        //Last session of this process on the CU
+        slots[kernel->shm_slot].num_sessions.store(0);
+        slots[kernel->shm_slot].pid.store(0);
+        kernel->shm_slot = -1;
+    }
 }
 
 XmaHwInterface hw_if = {
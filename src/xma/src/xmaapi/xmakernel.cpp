@@ -181,12 +181,14 @@ xma_kernel_session_create(XmaKernelProperties *props)
     }
     return NULL;
 
+    xma_hw_session_stats_init(&session->base);
     rc = session->kernel_plugin->init(session);
     if (rc) {
         xma_logmsg(XMA_ERROR_LOG, XMA_KERNEL_MOD,
                    "Initalization of kernel plugin failed. Return code %d\n",
                    rc);
         free(session->base.plugin_data);
+        xma_hw_session_stats_release(&session->base);
         free(session);
         return NULL;
     }
@@ -217,6 +219,7 @@ xma_kernel_session_destroy(XmaKernelSession *session)
     */
     // Free the session
     // TODO: (should also free the Hw sessions)
+    xma_hw_session_stats_release(&session->base);
     free(session);
 
     return XMA_SUCCESS;
@@ -228,7 +231,11 @@ xma_kernel_session_write(XmaKernelSession *session,
                          int32_t           param_cnt)
 {
     xma_logmsg(XMA_DEBUG_LOG, XMA_KERNEL_MOD, "%s()\n", __func__);
-    return session->kernel_plugin->write(session, param, param_cnt);
+    uint64_t start_ns = xma_hw_now_ns();
+    int32_t rc = session->kernel_plugin->write(session, param, param_cnt);
+    xma_hw_session_stats_record(&session->base, XMA_STATS_SEND, start_ns,
+                                rc == XMA_SUCCESS ? 1 : 0, 0, 0);
+    return rc;
 }
 
 int32_t
@@ -237,5 +244,17 @@ xma_kernel_session_read(XmaKernelSession *session,
                         int32_t           *param_cnt)
 {
     xma_logmsg(XMA_DEBUG_LOG, XMA_KERNEL_MOD, "%s()\n", __func__);
-    return session->kernel_plugin->read(session, param, param_cnt);
+    uint64_t start_ns = xma_hw_now_ns();
+    int32_t rc = session->kernel_plugin->read(session, param, param_cnt);
+    xma_hw_session_stats_record(&session->base, XMA_STATS_RECV, start_ns,
+                                rc == XMA_SUCCESS ? 1 : 0, 0, 0);
+    return rc;
+}
+
+int32_t
+xma_kernel_session_stats_get(XmaKernelSession *session,
+                             XmaSessionStats  *stats)
+{
+    xma_logmsg(XMA_DEBUG_LOG, XMA_KERNEL_MOD, "%s()\n", __func__);
+    return xma_hw_session_stats_get(&session->base, stats);
 }
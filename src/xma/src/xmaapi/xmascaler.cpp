@@ -232,6 +232,19 @@ xma_scaler_session_create(XmaScalerProperties *sc_props)
     //enc_handle = enc_props->cu_index;
 
     XmaHwCfg *hwcfg = &g_xma_singleton->hwcfg;
+    if (sc_props->cu_select == XMA_CU_SELECT_LEAST_LOADED) {
+        if (xma_hw_select_cu(hwcfg, &dev_index, &cu_index) != XMA_SUCCESS) {
+            xma_logmsg(XMA_ERROR_LOG, XMA_SCALER_MOD,
+                       "XMA session creation failed. No CU to select\n");
+            //Release singleton lock
+            g_xma_singleton->locked = false;
+            return NULL;
+        }
+        sc_props->dev_index = dev_index;
+        sc_props->cu_index = cu_index;
+        sc_session->props.dev_index = dev_index;
+        sc_session->props.cu_index = cu_index;
+    }
     if (dev_index >= hwcfg->num_devices) {
         xma_logmsg(XMA_ERROR_LOG, XMA_SCALER_MOD,
                    "XMA session creation failed. dev_index not found\n");
@@ -248,6 +261,7 @@ xma_scaler_session_create(XmaScalerProperties *sc_props)
     sc_session->base.hw_session.kernel_info = &hwcfg->devices[dev_index].kernels[cu_index];
 
     sc_session->base.hw_session.dev_index = hwcfg->devices[dev_index].dev_index;
+    xma_hw_kernel_bind(sc_session->base.hw_session.kernel_info, 1);
 
     // Assume it is the first scaler plugin for now
     //sc_session->scaler_plugin = &g_xma_singleton->scalercfg[scal_handle];
@@ -291,11 +305,14 @@ xma_scaler_session_create(XmaScalerProperties *sc_props)
     //Sarab: Remove it later on
     return NULL;
 
+    xma_hw_session_stats_init(&sc_session->base);
     rc = sc_session->scaler_plugin->init(sc_session);
     if (rc) {
         xma_logmsg(XMA_ERROR_LOG, XMA_SCALER_MOD,
                    "Initalization of scaler plugin failed. Return code %d\n",
                    rc);
+        xma_hw_kernel_bind(sc_session->base.hw_session.kernel_info, -1);
+        xma_hw_session_stats_release(&sc_session->base);
         return NULL;
     }
 
@@ -331,6 +348,8 @@ xma_scaler_session_destroy(XmaScalerSession *session)
     */
     // Free the session
     // TODO: (should also free the Hw sessions)
+    xma_hw_kernel_bind(session->base.hw_session.kernel_info, -1);
+    xma_hw_session_stats_release(&session->base);
     free(session);
 
     return XMA_SUCCESS;
@@ -372,7 +391,12 @@ xma_scaler_session_send_frame(XmaScalerSession  *session,
     }
     */
 
-    return session->scaler_plugin->send_frame(session, frame);
+    uint64_t start_ns = xma_hw_now_ns();
+    int32_t rc = session->scaler_plugin->send_frame(session, frame);
+    bool sent = rc >= 0 && frame->data[0].buffer != NULL;
+    xma_hw_session_stats_record(&session->base, XMA_STATS_SEND, start_ns, sent ? 1 : 0,
+                                sent ? (uint64_t)frame->frame_props.width * frame->frame_props.height : 0, 0);
+    return rc;
 }
 
 int32_t
@@ -380,6 +404,25 @@ xma_scaler_session_recv_frame_list(XmaScalerSession  *session,
                                    XmaFrame          **frame_list)
 {
     xma_logmsg(XMA_DEBUG_LOG, XMA_SCALER_MOD, "%s()\n", __func__);
-    return session->scaler_plugin->recv_frame_list(session,
-                                                   frame_list);
+    uint64_t start_ns = xma_hw_now_ns();
+    int32_t rc = session->scaler_plugin->recv_frame_list(session,
+                                                         frame_list);
+    uint64_t frames = 0;
+    uint64_t pixels = 0;
+    if (rc == XMA_SUCCESS) {
+        for (int32_t i = 0; i < session->props.num_outputs; i++) {
+            frames++;
+            pixels += (uint64_t)frame_list[i]->frame_props.width * frame_list[i]->frame_props.height;
+        }
+    }
+    xma_hw_session_stats_record(&session->base, XMA_STATS_RECV, start_ns, frames, pixels, 0);
+    return rc;
+}
+
+int32_t
+xma_scaler_session_stats_get(XmaScalerSession *session,
+                             XmaSessionStats  *stats)
+{
+    xma_logmsg(XMA_DEBUG_LOG, XMA_SCALER_MOD, "%s()\n", __func__);
+    return xma_hw_session_stats_get(&session->base, stats);
 }
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2018, Xilinx Inc - All rights reserved
+ * Xilinx SDAccel Media Accelerator API
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <mutex>
+
+#include "app/xmaerror.h"
+#include "app/xmalogger.h"
+#include "lib/xmaapi.h"
+
+#define XMA_STATS_MOD "xmastats"
+
+//Stage counters are only touched by the thread calling the session API,
+//like the rest of the session. Work item counters are updated by
+//xmaplugin.cpp under the execbo_mutex of the device.
+void
+xma_hw_session_stats_init(XmaSession *session)
+{
+    session->hw_session.stats = (XmaSessionStats*) calloc(1, sizeof(XmaSessionStats));
+    if (session->hw_session.stats == NULL)
+        xma_logmsg(XMA_ERROR_LOG, XMA_STATS_MOD, "Unable to allocate session stats\n");
+}
+
+void
+xma_hw_session_stats_release(XmaSession *session)
+{
+    XmaSessionStats *stats = session->hw_session.stats;
+    if (stats == NULL)
+        return;
+    XmaHwKernel *kernel_tmp1 = session->hw_session.kernel_info;
+    XmaHwDevice *dev_tmp1 = (kernel_tmp1 == NULL) ? NULL : (XmaHwDevice*)kernel_tmp1->private_do_not_use;
+    if (dev_tmp1 != NULL) {
+        std::lock_guard<std::mutex> lk(*dev_tmp1->execbo_mutex);
+        for (auto& execbo_stats : dev_tmp1->kernel_execbo_stats) {
+            if (execbo_stats == stats)
+                execbo_stats = nullptr;
+        }
+    }
+    session->hw_session.stats = NULL;
+    free(stats);
+}
+
+void
+xma_hw_session_stats_record(XmaSession *session, XmaStatsStage stage, uint64_t start_ns,
+                            uint64_t frames, uint64_t pixels, uint64_t bytes)
+{
+    XmaSessionStats *stats = session->hw_session.stats;
+    if (stats == NULL)
+        return;
+    uint64_t host_ns = xma_hw_now_ns() - start_ns;
+    XmaStageStats& stage_stats = stats->stage[stage];
+    stage_stats.calls++;
+    stage_stats.frames += frames;
+    stage_stats.pixels += pixels;
+    stage_stats.bytes += bytes;
+    stage_stats.host_ns += host_ns;
+    if (host_ns > stage_stats.max_host_ns)
+        stage_stats.max_host_ns = host_ns;
+}
+
+int32_t
+xma_hw_session_stats_get(XmaSession *session, XmaSessionStats *stats)
+{
+    if (session == NULL || stats == NULL || session->hw_session.stats == NULL) {
+        xma_logmsg(XMA_ERROR_LOG, XMA_STATS_MOD, "Session stats are not available\n");
+        return XMA_ERROR;
+    }
+    XmaHwKernel *kernel_tmp1 = session->hw_session.kernel_info;
+    XmaHwDevice *dev_tmp1 = (kernel_tmp1 == NULL) ? NULL : (XmaHwDevice*)kernel_tmp1->private_do_not_use;
+    if (dev_tmp1 != NULL) {
+        std::lock_guard<std::mutex> lk(*dev_tmp1->execbo_mutex);
+        *stats = *session->hw_session.stats;
+    } else {
+        *stats = *session->hw_session.stats;
+    }
+    return XMA_SUCCESS;
+}
@@ -19,6 +19,13 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <map>
+#include <mutex>
+#include <string>
 #include "xclbin.h"
 #include "app/xmaerror.h"
 #include "app/xmalogger.h"
@@ -31,27 +38,41 @@ static int get_xclbin_iplayout(char *buffer, XmaXclbinInfo *xclbin_info);
 static int get_xclbin_mem_topology(char *buffer, XmaXclbinInfo *xclbin_info);
 static int get_xclbin_connectivity(char *buffer, XmaXclbinInfo *xclbin_info);
 
-char *xma_xclbin_file_open(const char *xclbin_name)
+//Parsed xclbins of this process, keyed by uuid
+static std::mutex xclbin_cache_mutex;
+static std::map<std::string, XmaXclbinInfo> xclbin_cache;
+
+char *xma_xclbin_file_open(const char *xclbin_name, size_t *size)
 {
     xma_logmsg(XMA_INFO_LOG, XMAAPI_MOD, "Loading %s\n", xclbin_name);
 
-    std::ifstream file(xclbin_name, std::ios::binary | std::ios::ate);
-    std::streamsize size = file.tellg();
-    file.seekg(0, std::ios::beg);
-
-    char *buffer = (char*)malloc(size);
-    if (buffer == NULL) {
-        xma_logmsg(XMA_ERROR_LOG, XMAAPI_MOD, "Could not allocate buffer for file %s\n", xclbin_name);
+    int fd = open(xclbin_name, O_RDONLY);
+    if (fd < 0) {
+        xma_logmsg(XMA_ERROR_LOG, XMAAPI_MOD, "Could not open file %s\n", xclbin_name);
         return NULL;
     }
-    if (!file.read(buffer, size))
-    {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(axlf)) {
         xma_logmsg(XMA_ERROR_LOG, XMAAPI_MOD, "Could not read file %s\n", xclbin_name);
-        free(buffer);
-        buffer = NULL;
+        close(fd);
+        return NULL;
     }
+    //Pages are only faulted in for the sections that are parsed or loaded
+    void *buffer = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (buffer == MAP_FAILED) {
+        xma_logmsg(XMA_ERROR_LOG, XMAAPI_MOD, "Could not map file %s\n", xclbin_name);
+        return NULL;
+    }
+    *size = st.st_size;
+
+    return (char*)buffer;
+}
 
-    return buffer;
+void xma_xclbin_file_close(char *buffer, size_t size)
+{
+    if (buffer)
+        munmap(buffer, size);
 }
 
 static int get_xclbin_iplayout(char *buffer, XmaXclbinInfo *xclbin_info)
@@ -170,6 +191,18 @@ static int get_xclbin_connectivity(char *buffer, XmaXclbinInfo *xclbin_info)
 int xma_xclbin_info_get(char *buffer, XmaXclbinInfo *info)
 {
     int rc = 0;
+    axlf *xclbin = reinterpret_cast<axlf *>(buffer);
+    std::string uuid_key((const char*)xclbin->m_header.uuid, sizeof(xclbin->m_header.uuid));
+    {
+        std::lock_guard<std::mutex> lock(xclbin_cache_mutex);
+        auto itr = xclbin_cache.find(uuid_key);
+        if (itr != xclbin_cache.end()) {
+            memcpy(info, &itr->second, sizeof(XmaXclbinInfo));
+            xma_logmsg(XMA_DEBUG_LOG, XMAAPI_MOD, "Using cached xclbin info\n");
+            return XMA_SUCCESS;
+        }
+    }
+
     rc = get_xclbin_mem_topology(buffer, info);
     if(rc == XMA_ERROR)
         return rc;
@@ -193,6 +226,9 @@ int xma_xclbin_info_get(char *buffer, XmaXclbinInfo *info)
     }
     //For execbo:
     //info->num_ips = info->number_of_kernels;
+
+    std::lock_guard<std::mutex> lock(xclbin_cache_mutex);
+    xclbin_cache.emplace(uuid_key, *info);
     return XMA_SUCCESS;
 }
 
@@ -20,6 +20,7 @@
 #include "lib/xmahw_lib.h"
 //#include "lib/xmares.h"
 
+#include <algorithm>
 #include <cstdio>
 #include <iostream>
 #include <cstring>
@@ -34,12 +35,14 @@ constexpr std::uint64_t signature = 0xF42F1F8F4F2F1F0F;
 typedef struct XmaBufferObjPrivate
 {
     void*    dummy;
-    uint64_t size;
+    uint64_t size;//Size of the device buffer; Size bucket of the requested size
     uint64_t paddr;
     int32_t  bank_index;
     int32_t  dev_index;
     uint64_t boHandle;
     bool     device_only_buffer;
+    uint8_t* data;
+    bool     borrowed;//Owned by a pinned host buffer or a frame, see xmabuffer.cpp
     uint32_t reserved[4];
 
   XmaBufferObjPrivate() {
@@ -48,6 +51,8 @@ typedef struct XmaBufferObjPrivate
    bank_index = -1;
    dev_index = -1;
    boHandle = 0;
+   data = NULL;
+   borrowed = false;
   }
 } XmaBufferObjPrivate;
 
@@ -81,45 +86,29 @@ xma_plg_buffer_alloc(XmaSession s_handle, size_t size, bool device_only_buffer,
         return b_obj_error;
     }
 
-    /*
-    #define XRT_BO_FLAGS_MEMIDX_MASK        (0xFFFFFFUL)
-    #define XCL_BO_FLAGS_CACHEABLE          (1 << 24)
-    #define XCL_BO_FLAGS_SVM                (1 << 27)
-    #define XCL_BO_FLAGS_DEV_ONLY           (1 << 28)
-    #define XCL_BO_FLAGS_HOST_ONLY          (1 << 29)
-    #define XCL_BO_FLAGS_P2P                (1 << 30)
-    #define XCL_BO_FLAGS_EXECBUF            (1 << 31)
-    */
-    uint64_t b_obj_handle = 0;
-    if (device_only_buffer) {
-        b_obj_handle = xclAllocBO(dev_handle, size, 0, XCL_BO_FLAGS_DEV_ONLY | ddr_bank);
-    } else {
-        b_obj_handle = xclAllocBO(dev_handle, size, 0, ddr_bank);
-    }
-    /*BO handlk is uint64_t
-    if (b_obj_handle < 0) {
-        std::cout << "ERROR: xma_plg_buffer_alloc failed. handle=0x" << std::hex << b_obj_handle << std::endl;
-        //printf("xclAllocBO failed. handle=0x%ullx\n", b_obj_handle);
-        xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD, "xclAllocBO failed.\n");
+    XmaHwDevice *dev_tmp1 = (XmaHwDevice*)s_handle.hw_session.kernel_info->private_do_not_use;
+    uint64_t bucket = xma_hw_buffer_bucket(size);
+    uint64_t key = xma_hw_buffer_pool_key(b_obj.bank_index, bucket, device_only_buffer);
+    XmaHwBufferPoolEntry entry;
+    if (!xma_hw_buffer_pool_get(dev_tmp1, key, entry) &&
+        !xma_hw_buffer_alloc_bo(dev_handle, bucket, ddr_bank, device_only_buffer, entry)) {
+        std::cout << "ERROR: xma_plg_buffer_alloc failed. xclAllocBO failed" << std::endl;
         if (return_code) *return_code = XMA_ERROR;
         return b_obj_error;
     }
-    */
-    b_obj.paddr = xclGetDeviceAddr(dev_handle, b_obj_handle);
-    if (device_only_buffer) {
-        b_obj.device_only_buffer = true;
-    } else {
-        b_obj.data = (uint8_t*) xclMapBO(dev_handle, b_obj_handle, true);
-    }
+    b_obj.paddr = entry.paddr;
+    b_obj.device_only_buffer = device_only_buffer;
+    b_obj.data = entry.data;
     XmaBufferObjPrivate* tmp1 = new XmaBufferObjPrivate;
     b_obj.private_do_not_touch = (void*) tmp1;
     tmp1->dummy = (void*)(((uint64_t)tmp1) | signature);
-    tmp1->size = size;
+    tmp1->size = bucket;
     tmp1->paddr = b_obj.paddr;
     tmp1->bank_index = b_obj.bank_index;
     tmp1->dev_index = b_obj.dev_index;
-    tmp1->boHandle = b_obj_handle;
+    tmp1->boHandle = entry.boHandle;
     tmp1->device_only_buffer = b_obj.device_only_buffer;
+    tmp1->data = entry.data;
 
     if (return_code) *return_code = XMA_SUCCESS;
     return b_obj;
@@ -150,9 +139,204 @@ xma_plg_buffer_free(XmaSession s_handle, XmaBufferObj b_obj)
         return;
     }
 
+    XmaHwDevice *dev_tmp1 = (XmaHwDevice*)s_handle.hw_session.kernel_info->private_do_not_use;
+    uint64_t key = xma_hw_buffer_pool_key(b_obj_priv->bank_index, b_obj_priv->size, b_obj_priv->device_only_buffer);
+    XmaHwBufferPoolEntry entry;
+    entry.boHandle = b_obj_priv->boHandle;
+    entry.paddr = b_obj_priv->paddr;
+    entry.data = b_obj_priv->data;
+    if (!b_obj_priv->borrowed && !xma_hw_buffer_pool_put(dev_tmp1, key, entry)) {
+        xclDeviceHandle dev_handle = s_handle.hw_session.dev_handle;
+        xclFreeBO(dev_handle, b_obj_priv->boHandle);
+    }
+    b_obj_priv->dummy = NULL;
+    delete b_obj_priv;
+}
+
+//Buffer object for a buffer owned by a pinned host buffer or a frame;
+//xma_plg_buffer_free releases only the buffer object
+static XmaBufferObj
+xma_plg_buffer_borrow(int32_t dev_index, int32_t ddr_bank, uint64_t size,
+                      bool device_only_buffer, const XmaHwBufferPoolEntry& bo)
+{
+    XmaBufferObj b_obj;
+    b_obj.data = bo.data;
+    b_obj.size = size;
+    b_obj.paddr = bo.paddr;
+    b_obj.bank_index = ddr_bank;
+    b_obj.dev_index = dev_index;
+    b_obj.device_only_buffer = device_only_buffer;
+    XmaBufferObjPrivate* tmp1 = new XmaBufferObjPrivate;
+    b_obj.private_do_not_touch = (void*) tmp1;
+    tmp1->dummy = (void*)(((uint64_t)tmp1) | signature);
+    tmp1->size = xma_hw_buffer_bucket(size);
+    tmp1->paddr = bo.paddr;
+    tmp1->bank_index = ddr_bank;
+    tmp1->dev_index = dev_index;
+    tmp1->boHandle = bo.boHandle;
+    tmp1->device_only_buffer = device_only_buffer;
+    tmp1->data = bo.data;
+    tmp1->borrowed = true;
+    return b_obj;
+}
+
+XmaBufferObj
+xma_plg_buffer_lookup(XmaSession s_handle, void* host_ptr, int32_t* return_code)
+{
+    XmaBufferObj b_obj_error;
+    b_obj_error.data = NULL;
+    b_obj_error.size = 0;
+    b_obj_error.bank_index = -1;
+    b_obj_error.dev_index = -1;
+    b_obj_error.device_only_buffer = false;
+    b_obj_error.private_do_not_touch = NULL;
+
+    if (s_handle.session_signature != (void*)(((uint64_t)s_handle.hw_session.kernel_info) | ((uint64_t)s_handle.hw_session.dev_handle))) {
+        std::cout << "ERROR: xma_plg_buffer_lookup failed. XMASession is corrupted" << std::endl;
+        xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD, "xma_plg_buffer_lookup failed. XMASession is corrupted.\n");
+        if (return_code) *return_code = XMA_ERROR;
+        return b_obj_error;
+    }
+    //Not an error for the plugin to log; It falls back to a copy
+    XmaHwPinnedBuffer pinned;
+    if (!xma_hw_pinned_buffer_get(host_ptr, pinned) ||
+        pinned.dev_index != (int32_t)s_handle.hw_session.dev_index ||
+        pinned.ddr_bank != s_handle.hw_session.kernel_info->ddr_bank) {
+        if (return_code) *return_code = XMA_ERROR;
+        return b_obj_error;
+    }
+
+    if (return_code) *return_code = XMA_SUCCESS;
+    return xma_plg_buffer_borrow(pinned.dev_index, pinned.ddr_bank, pinned.size, false, pinned.bo);
+}
+
+int32_t
+xma_plg_frame_attach_buffer(XmaSession s_handle, XmaFrame* frame, int32_t plane, XmaBufferObj b_obj)
+{
+    if (s_handle.session_signature != (void*)(((uint64_t)s_handle.hw_session.kernel_info) | ((uint64_t)s_handle.hw_session.dev_handle))) {
+        std::cout << "ERROR: xma_plg_frame_attach_buffer failed. XMASession is corrupted" << std::endl;
+        xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD, "xma_plg_frame_attach_buffer failed. XMASession is corrupted.\n");
+        return XMA_ERROR;
+    }
+    if (frame == NULL || plane < 0 || plane >= xma_frame_planes_get(&frame->frame_props)) {
+        xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD, "xma_plg_frame_attach_buffer failed. Invalid frame plane\n");
+        return XMA_ERROR;
+    }
+    XmaBufferObjPrivate* b_obj_priv = (XmaBufferObjPrivate*) b_obj.private_do_not_touch;
+    if (b_obj_priv == NULL || b_obj_priv->dummy != (void*)(((uint64_t)b_obj_priv) | signature)) {
+        std::cout << "ERROR: xma_plg_frame_attach_buffer failed. XMABufferObj is corrupted" << std::endl;
+        xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD, "xma_plg_frame_attach_buffer failed. XMABufferObj is corrupted.\n");
+        return XMA_ERROR;
+    }
+    if (b_obj_priv->borrowed) {
+        xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD, "xma_plg_frame_attach_buffer failed. XMABufferObj is not owned by plugin\n");
+        return XMA_ERROR;
+    }
+
+    XmaHwFrameBuffer *buf = new XmaHwFrameBuffer;
+    buf->dev_index = b_obj_priv->dev_index;
+    buf->ddr_bank = b_obj_priv->bank_index;
+    buf->size = b_obj.size;
+    buf->device_only_buffer = b_obj_priv->device_only_buffer;
+    buf->bo.boHandle = b_obj_priv->boHandle;
+    buf->bo.paddr = b_obj_priv->paddr;
+    buf->bo.data = b_obj_priv->data;
+    xma_hw_frame_attach(frame, plane, buf);
+
+    b_obj_priv->dummy = NULL;
+    delete b_obj_priv;
+    return XMA_SUCCESS;
+}
+
+XmaBufferObj
+xma_plg_frame_buffer_get(XmaSession s_handle, XmaFrame* frame, int32_t plane, int32_t* return_code)
+{
+    XmaBufferObj b_obj_error;
+    b_obj_error.data = NULL;
+    b_obj_error.size = 0;
+    b_obj_error.bank_index = -1;
+    b_obj_error.dev_index = -1;
+    b_obj_error.device_only_buffer = false;
+    b_obj_error.private_do_not_touch = NULL;
+
+    if (s_handle.session_signature != (void*)(((uint64_t)s_handle.hw_session.kernel_info) | ((uint64_t)s_handle.hw_session.dev_handle))) {
+        std::cout << "ERROR: xma_plg_frame_buffer_get failed. XMASession is corrupted" << std::endl;
+        xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD, "xma_plg_frame_buffer_get failed. XMASession is corrupted.\n");
+        if (return_code) *return_code = XMA_ERROR;
+        return b_obj_error;
+    }
+    //Host planes and planes on other devices are not an error for the
+    //plugin to log; It falls back to a copy
+    if (frame == NULL || plane < 0 || plane >= xma_frame_planes_get(&frame->frame_props) ||
+        frame->data[plane].buffer_type != XMA_DEVICE_BUFFER_TYPE) {
+        if (return_code) *return_code = XMA_ERROR;
+        return b_obj_error;
+    }
+    XmaHwFrameBuffer *buf = (XmaHwFrameBuffer*) frame->data[plane].buffer;
+    if (buf->dev_index != (int32_t)s_handle.hw_session.dev_index) {
+        if (return_code) *return_code = XMA_ERROR;
+        return b_obj_error;
+    }
+
+    //Move the plane to the bank of this session
+    int32_t ddr_bank = s_handle.hw_session.kernel_info->ddr_bank;
+    if (buf->ddr_bank != ddr_bank) {
+        xclDeviceHandle dev_handle = s_handle.hw_session.dev_handle;
+        XmaHwDevice *dev_tmp1 = (XmaHwDevice*)s_handle.hw_session.kernel_info->private_do_not_use;
+        uint64_t bucket = xma_hw_buffer_bucket(buf->size);
+        uint64_t key = xma_hw_buffer_pool_key(ddr_bank, bucket, buf->device_only_buffer);
+        XmaHwFrameBuffer *moved = new XmaHwFrameBuffer(*buf);
+        moved->ddr_bank = ddr_bank;
+        if (!xma_hw_buffer_pool_get(dev_tmp1, key, moved->bo) &&
+            !xma_hw_buffer_alloc_bo(dev_handle, bucket, ddr_bank, buf->device_only_buffer, moved->bo)) {
+            delete moved;
+            if (return_code) *return_code = XMA_ERROR;
+            return b_obj_error;
+        }
+        int rc = xclCopyBO(dev_handle, moved->bo.boHandle, buf->bo.boHandle, buf->size, 0, 0);
+        if (rc != 0) {
+            std::cout << "ERROR: xma_plg_frame_buffer_get xclCopyBO failed " << std::dec << rc << std::endl;
+            xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD, "xclCopyBO failed %d\n", rc);
+            xma_hw_frame_buffer_release(moved);
+            if (return_code) *return_code = XMA_ERROR;
+            return b_obj_error;
+        }
+        xma_hw_frame_attach(frame, plane, moved);
+        buf = moved;
+    }
+
+    if (return_code) *return_code = XMA_SUCCESS;
+    return xma_plg_buffer_borrow(buf->dev_index, buf->ddr_bank, buf->size, buf->device_only_buffer, buf->bo);
+}
+
+int32_t
+xma_plg_buffer_pool_reserve(XmaSession s_handle, size_t size, int32_t count, bool device_only_buffer)
+{
+    if (s_handle.session_signature != (void*)(((uint64_t)s_handle.hw_session.kernel_info) | ((uint64_t)s_handle.hw_session.dev_handle))) {
+        std::cout << "ERROR: xma_plg_buffer_pool_reserve failed. XMASession is corrupted" << std::endl;
+        xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD, "xma_plg_buffer_pool_reserve failed. XMASession is corrupted.\n");
+        return XMA_ERROR;
+    }
     xclDeviceHandle dev_handle = s_handle.hw_session.dev_handle;
-    xclFreeBO(dev_handle, b_obj_priv->boHandle);
-    free(b_obj_priv);
+    int32_t ddr_bank = s_handle.hw_session.kernel_info->ddr_bank;
+    XmaHwDevice *dev_tmp1 = (XmaHwDevice*)s_handle.hw_session.kernel_info->private_do_not_use;
+    uint64_t bucket = xma_hw_buffer_bucket(size);
+    uint64_t key = xma_hw_buffer_pool_key(ddr_bank, bucket, device_only_buffer);
+    if (dev_tmp1 == NULL || key == 0) {
+        xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD, "xma_plg_buffer_pool_reserve failed. Buffer pool not available\n");
+        return XMA_ERROR;
+    }
+    for (int32_t i = 0; i < count; i++) {
+        XmaHwBufferPoolEntry entry;
+        if (!xma_hw_buffer_alloc_bo(dev_handle, bucket, ddr_bank, device_only_buffer, entry))
+            return XMA_ERROR;
+        if (!xma_hw_buffer_pool_put(dev_tmp1, key, entry)) {
+            xclFreeBO(dev_handle, entry.boHandle);
+            xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD, "xma_plg_buffer_pool_reserve failed. Buffer pool is full\n");
+            return XMA_ERROR;
+        }
+    }
+    return XMA_SUCCESS;
 }
 
 /*Sarab: padd API not required with buffer Object
@@ -303,8 +487,18 @@ xma_plg_register_prep_write(XmaSession  s_handle,
         return XMA_ERROR;
     }
 
+    XmaHwKernel* kernel_tmp1 = s_handle.hw_session.kernel_info;
     for (uint32_t i = 0, tmp_idx = start; i < entries; i++, tmp_idx++) {
-        s_handle.hw_session.kernel_info->reg_map[tmp_idx] = src_array[i];
+        kernel_tmp1->reg_map[tmp_idx] = src_array[i];
+    }
+
+    //Track used and dirty part of regmap so only that is copied into execBO
+    uint32_t lo = start * sizeof(uint32_t);
+    uint32_t hi = (start + entries) * sizeof(uint32_t);
+    if (entries > 0) {
+        kernel_tmp1->reg_map_max = std::max(kernel_tmp1->reg_map_max, hi);
+        kernel_tmp1->reg_map_dirty_lo = std::min(kernel_tmp1->reg_map_dirty_lo, lo);
+        kernel_tmp1->reg_map_dirty_hi = std::max(kernel_tmp1->reg_map_dirty_hi, hi);
     }
 
     return XMA_SUCCESS;
@@ -359,6 +553,129 @@ int32_t xma_plg_kernel_unlock_regmap(XmaSession s_handle)
     return XMA_SUCCESS;
 }
 
+static uint64_t
+xma_plg_session_key(const XmaSession& s_handle)
+{
+    return ((uint64_t)s_handle.session_type << 32) | (uint32_t)s_handle.session_id;
+}
+
+//Ends the busy period of kernel once no execBOs are in flight; Busy time
+//is used by xma_hw_kernel_load; Caller must hold execbo_mutex
+static void
+xma_plg_kernel_busy_update(XmaHwKernel *kernel_tmp1)
+{
+    if (kernel_tmp1->execbo_inflight.empty())
+        kernel_tmp1->busy_ns += xma_hw_now_ns() - kernel_tmp1->busy_start_ns;
+}
+
+//Count the work item in execBO bo_idx as done in the stats of its session;
+//Kernel time runs from submit until the work item is reaped. Caller must
+//hold execbo_mutex
+static void
+xma_plg_work_item_stats_done(XmaHwDevice *dev_tmp1, int32_t bo_idx, bool failed)
+{
+    XmaSessionStats *stats = dev_tmp1->kernel_execbo_stats[bo_idx];
+    if (stats == nullptr)
+        return;
+    dev_tmp1->kernel_execbo_stats[bo_idx] = nullptr;
+    stats->queue_depth--;
+    if (failed) {
+        stats->work_item_errors++;
+        return;
+    }
+    stats->work_items++;
+    stats->kernel_ns += xma_hw_now_ns() - dev_tmp1->kernel_execbo_submit_ns[bo_idx];
+}
+
+//Count the work item in execBO bo_idx as done for its work group, if it
+//belongs to one; Caller must hold execbo_mutex
+static void
+xma_plg_work_group_item_done(XmaHwDevice *dev_tmp1, int32_t bo_idx, bool failed)
+{
+    int32_t group = dev_tmp1->kernel_execbo_group[bo_idx];
+    if (group == 0)
+        return;
+    dev_tmp1->kernel_execbo_group[bo_idx] = 0;
+    auto itr = dev_tmp1->work_groups.find(group);
+    if (itr == dev_tmp1->work_groups.end())
+        return;
+    itr->second.pending--;
+    if (failed)
+        itr->second.failed = true;
+}
+
+//Reap completed execBOs scheduled on kernel; Caller must hold execbo_mutex
+//Returns number of execBOs returned to free list
+static int32_t
+xma_plg_execbo_reap(XmaHwDevice *dev_tmp1, XmaHwKernel *kernel_tmp1)
+{
+    int32_t reaped = 0;
+    auto& inflight = kernel_tmp1->execbo_inflight;
+    for (auto itr = inflight.begin(); itr != inflight.end(); ) {
+        int32_t i = *itr;
+        ert_start_kernel_cmd *cu_cmd = 
+            (ert_start_kernel_cmd*)dev_tmp1->kernel_execbo_data[i];
+        switch(cu_cmd->state)
+        {
+            case ERT_CMD_STATE_NEW:
+            case ERT_CMD_STATE_QUEUED:
+            case ERT_CMD_STATE_RUNNING:
+                ++itr;
+                continue;
+            case ERT_CMD_STATE_COMPLETED:
+                // Update count of completed work items
+                kernel_tmp1->kernel_complete_count++;
+                kernel_tmp1->session_complete_count[dev_tmp1->kernel_execbo_session[i]]++;
+                xma_plg_work_item_stats_done(dev_tmp1, i, false);
+                xma_plg_work_group_item_done(dev_tmp1, i, false);
+                break;
+            case ERT_CMD_STATE_ERROR:
+            case ERT_CMD_STATE_ABORT:
+            default:
+                xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD,
+                        "Work item failed with ERT state %d\n", cu_cmd->state);
+                xma_plg_work_item_stats_done(dev_tmp1, i, true);
+                xma_plg_work_group_item_done(dev_tmp1, i, true);
+                break;
+        }
+        kernel_tmp1->session_inflight_count[dev_tmp1->kernel_execbo_session[i]]--;
+        dev_tmp1->kernel_execbo_inuse[i] = false;
+        dev_tmp1->kernel_execbo_kernel[i] = nullptr;
+        dev_tmp1->execbo_free.emplace_back(i);
+        itr = inflight.erase(itr);
+        reaped++;
+    }
+    if (reaped)
+        xma_plg_kernel_busy_update(kernel_tmp1);
+    return reaped;
+}
+
+//Take a free execBO for a work item of session key on kernel_tmp1; Caller
+//must hold execbo_mutex and have checked that execbo_free is not empty
+static int32_t
+xma_plg_execbo_take(XmaHwDevice *dev_tmp1, XmaHwKernel *kernel_tmp1, uint64_t key,
+                    XmaSessionStats *stats)
+{
+    int32_t i = dev_tmp1->execbo_free.back();
+    dev_tmp1->execbo_free.pop_back();
+    dev_tmp1->kernel_execbo_inuse[i] = true;
+    dev_tmp1->kernel_execbo_cu_index[i] = kernel_tmp1->cu_index;
+    dev_tmp1->kernel_execbo_kernel[i] = kernel_tmp1;
+    dev_tmp1->kernel_execbo_session[i] = key;
+    dev_tmp1->kernel_execbo_group[i] = 0;
+    dev_tmp1->kernel_execbo_stats[i] = stats;
+    if (stats != nullptr) {
+        stats->queue_depth++;
+        if (stats->queue_depth > stats->max_queue_depth)
+            stats->max_queue_depth = stats->queue_depth;
+    }
+    if (kernel_tmp1->execbo_inflight.empty())
+        kernel_tmp1->busy_start_ns = xma_hw_now_ns();
+    kernel_tmp1->execbo_inflight.emplace_back(i);
+    kernel_tmp1->session_inflight_count[key]++;
+    return i;
+}
+
 int32_t xma_plg_execbo_avail_get(XmaSession s_handle)
 {
     XmaHwKernel* kernel_tmp1 = s_handle.hw_session.kernel_info;
@@ -372,58 +689,126 @@ int32_t xma_plg_execbo_avail_get(XmaSession s_handle)
         xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD, "Session XMA private: No execbo allocated\n");
         return -1;
     }
-    int32_t i;
-    int32_t rc = -1;
-    bool    found = false;
-    bool expected = false;
-    bool desired = true;
-    while (!(*(dev_tmp1->execbo_locked)).compare_exchange_weak(expected, desired)) {
-        expected = false;
-    }
-    //kernel completion lock acquired
 
-    for (i = 0; i < num_execbo; i++) {
-        ert_start_kernel_cmd *cu_cmd = 
-            (ert_start_kernel_cmd*)dev_tmp1->kernel_execbo_data[i];
-        if (dev_tmp1->kernel_execbo_inuse[i]) {
-            if (dev_tmp1->kernel_execbo_cu_index[i] == kernel_tmp1->cu_index) {
-                switch(cu_cmd->state)
-                {
-                    case ERT_CMD_STATE_NEW:
-                    case ERT_CMD_STATE_QUEUED:
-                    case ERT_CMD_STATE_RUNNING:
-                        continue;
-                    break;
-                    case ERT_CMD_STATE_COMPLETED:
-                        found = true;
-                        // Update count of completed work items
-                        kernel_tmp1->kernel_complete_count++;
-
-                    break;
-                    case ERT_CMD_STATE_ERROR:
-                    case ERT_CMD_STATE_ABORT:
-                        xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD,
-                                "Could not find free execBO cmd buffer\n");
-                    break;
-                }
+    // Sessions with a work item limit (xma_plg_session_max_work_items)
+    // block on xclExecWait while all execBOs are busy or the session has
+    // its maximum of work items in flight, and give up if no work item
+    // completes for a while; Other sessions fail when no execBO is free
+    const int32_t wait_ms = 1000;
+    const int32_t max_timeouts = 10;
+    int32_t timeouts = 0;
+    uint64_t key = xma_plg_session_key(s_handle);
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lk(*dev_tmp1->execbo_mutex);
+            auto max_itr = kernel_tmp1->session_max_inflight.find(key);
+            int32_t max_inflight = (max_itr == kernel_tmp1->session_max_inflight.end()) ? 0 : max_itr->second;
+            int32_t& session_inflight = kernel_tmp1->session_inflight_count[key];
+            if (max_inflight > 0 && session_inflight >= max_inflight)
+                xma_plg_execbo_reap(dev_tmp1, kernel_tmp1);
+            bool at_max = max_inflight > 0 && session_inflight >= max_inflight;
+            if (!at_max && dev_tmp1->execbo_free.empty())
+                xma_plg_execbo_reap(dev_tmp1, kernel_tmp1);
+            if (!at_max && dev_tmp1->execbo_free.empty()) {
+                for (auto& kernel : dev_tmp1->kernels)
+                    if (&kernel != kernel_tmp1)
+                        xma_plg_execbo_reap(dev_tmp1, &kernel);
+            }
+            if (!at_max && !dev_tmp1->execbo_free.empty())
+                return xma_plg_execbo_take(dev_tmp1, kernel_tmp1, key, s_handle.hw_session.stats);
+            if (max_inflight <= 0) {
+                xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD,
+                        "Could not find free execBO cmd buffer\n");
+                return -1;
+            }
+        }
+
+        if (xclExecWait(s_handle.hw_session.dev_handle, wait_ms) <= 0) {
+            if (++timeouts >= max_timeouts) {
+                xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD,
+                        "Could not find free execBO cmd buffer\n");
+                return -1;
             }
         }
         else
-            found = true;
+            timeouts = 0;
+    }
 
-        if (found)
-            break;
+    return -1;
+}
+
+//Return execBO that could not be submitted to free list
+static void
+xma_plg_execbo_release(XmaHwDevice *dev_tmp1, XmaHwKernel *kernel_tmp1, int32_t bo_idx)
+{
+    std::lock_guard<std::mutex> lk(*dev_tmp1->execbo_mutex);
+    auto& inflight = kernel_tmp1->execbo_inflight;
+    auto itr = std::find(inflight.begin(), inflight.end(), bo_idx);
+    if (itr != inflight.end()) {
+        inflight.erase(itr);
+        kernel_tmp1->session_inflight_count[dev_tmp1->kernel_execbo_session[bo_idx]]--;
+        xma_plg_kernel_busy_update(kernel_tmp1);
     }
-    if (found)
-    {
-        dev_tmp1->kernel_execbo_inuse[i] = true;
-        dev_tmp1->kernel_execbo_cu_index[i] = kernel_tmp1->cu_index;
-        rc = i;
+    xma_plg_work_item_stats_done(dev_tmp1, bo_idx, true);
+    xma_plg_work_group_item_done(dev_tmp1, bo_idx, true);
+    dev_tmp1->kernel_execbo_inuse[bo_idx] = false;
+    dev_tmp1->kernel_execbo_kernel[bo_idx] = nullptr;
+    dev_tmp1->execbo_free.emplace_back(bo_idx);
+}
+
+//Fill execBO bo_idx with a start command for kernel_tmp1 and submit it.
+//regmap is the register map of the work item. If it is the kernel
+//reg_map, only the range written since the execBO last held it is copied.
+static int32_t
+xma_plg_execbo_submit(XmaSession s_handle, XmaHwDevice *dev_tmp1, XmaHwKernel *kernel_tmp1,
+                      int32_t bo_idx, const uint8_t *regmap, size_t size)
+{
+    // Setup ert_start_kernel_cmd 
+    ert_start_kernel_cmd *cu_cmd = 
+        (ert_start_kernel_cmd*)dev_tmp1->kernel_execbo_data[bo_idx];
+    cu_cmd->state = ERT_CMD_STATE_NEW;
+    cu_cmd->opcode = ERT_START_CU;
+    cu_cmd->extra_cu_masks = 1;//XMA now supports 60 CUs
+    cu_cmd->cu_mask = kernel_tmp1->cu_mask0;
+
+    cu_cmd->data[0] = kernel_tmp1->cu_mask1;
+    if (regmap == (const uint8_t*)kernel_tmp1->reg_map) {
+        // Copy reg_map into execBO buffer. If the execBO still holds this
+        // kernel's regmap from the previous work item, then only the range
+        // written since then needs to be copied
+        uint64_t serial = kernel_tmp1->reg_map_serial;
+        if (dev_tmp1->kernel_execbo_regmap_kernel[bo_idx] == kernel_tmp1 &&
+            dev_tmp1->kernel_execbo_regmap_serial[bo_idx] == serial) {
+            if (kernel_tmp1->reg_map_dirty_lo < kernel_tmp1->reg_map_dirty_hi) {
+                uint32_t lo = kernel_tmp1->reg_map_dirty_lo;
+                memcpy((uint8_t*)&cu_cmd->data[1] + lo, regmap + lo, kernel_tmp1->reg_map_dirty_hi - lo);
+            }
+        } else {
+            memcpy(&cu_cmd->data[1], regmap, size);
+        }
+        kernel_tmp1->reg_map_dirty_lo = MAX_KERNEL_REGMAP_SIZE;
+        kernel_tmp1->reg_map_dirty_hi = 0;
+        kernel_tmp1->reg_map_serial = ++serial;
+        dev_tmp1->kernel_execbo_regmap_kernel[bo_idx] = kernel_tmp1;
+        dev_tmp1->kernel_execbo_regmap_serial[bo_idx] = serial;
+    } else {
+        memcpy(&cu_cmd->data[1], regmap, size);
+        dev_tmp1->kernel_execbo_regmap_kernel[bo_idx] = nullptr;
     }
-    //Release completion lock
-    *(dev_tmp1->execbo_locked) = false;
 
-    return rc;
+    // Set count to size in 32-bit words + 2; One extra_cu_mask is present
+    cu_cmd->count = (size >> 2) + 2;
+    dev_tmp1->kernel_execbo_submit_ns[bo_idx] = xma_hw_now_ns();
+ 
+    if (xclExecBuf(s_handle.hw_session.dev_handle, 
+                   dev_tmp1->kernel_execbo_handle[bo_idx]) != 0)
+    {
+        xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD,
+                   "Failed to submit kernel start with xclExecBuf\n");
+        xma_plg_execbo_release(dev_tmp1, kernel_tmp1, bo_idx);
+        return XMA_ERROR;
+    }
+    return XMA_SUCCESS;
 }
 
 int32_t
@@ -441,10 +826,11 @@ xma_plg_schedule_work_item(XmaSession s_handle)
         return XMA_ERROR;
     }
     uint8_t *src = (uint8_t*)kernel_tmp1->reg_map;
-    //size_t  size = s_handle.hw_session.kernel_info->max_offset;
-    size_t  size = MAX_KERNEL_REGMAP_SIZE;//Max regmap in xmahw.h is 4KB; execBO size is 4096; Supported max regmap size is 4032 Bytes only
+    //Only the part of regmap written by xma_plg_register_prep_write is submitted
+    //Supported max regmap size is 4032 Bytes only; execBO size is 4096
+    //Always include the CU control registers (ctrl, gier, ier, isr)
+    size_t  size = std::max<size_t>(kernel_tmp1->reg_map_max, 4 * sizeof(uint32_t));
     int32_t bo_idx;
-    int32_t rc = XMA_SUCCESS;
     
     if (*(kernel_tmp1->reg_map_locked)) {
         if (s_handle.session_id != kernel_tmp1->locked_by_session_id || s_handle.session_type != kernel_tmp1->locked_by_session_type) {
@@ -461,38 +847,239 @@ xma_plg_schedule_work_item(XmaSession s_handle)
     if (bo_idx == -1) {
         xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD, "Unable to find free execbo to use\n");
         return XMA_ERROR;
-    } else {
-        // Setup ert_start_kernel_cmd 
-        ert_start_kernel_cmd *cu_cmd = 
-            (ert_start_kernel_cmd*)dev_tmp1->kernel_execbo_data[bo_idx];
-        cu_cmd->state = ERT_CMD_STATE_NEW;
-        cu_cmd->opcode = ERT_START_CU;
-        cu_cmd->extra_cu_masks = 1;//XMA now supports 60 CUs
-        cu_cmd->cu_mask = kernel_tmp1->cu_mask0;
-
-        cu_cmd->data[0] = kernel_tmp1->cu_mask1;
-        // Copy reg_map into execBO buffer 
-        memcpy(&cu_cmd->data[1], src, size);
-
-        // Set count to size in 32-bit words + 2; One extra_cu_mask is present
-        cu_cmd->count = (size >> 2) + 2;
-     
-        if (xclExecBuf(s_handle.hw_session.dev_handle, 
-                       dev_tmp1->kernel_execbo_handle[bo_idx]) != 0)
+    }
+    return xma_plg_execbo_submit(s_handle, dev_tmp1, kernel_tmp1, bo_idx, src, size);
+}
+
+int32_t
+xma_plg_schedule_work_item_regmap(XmaSession s_handle, void* regmap, size_t size)
+{
+    if (s_handle.session_signature != (void*)(((uint64_t)s_handle.hw_session.kernel_info) | ((uint64_t)s_handle.hw_session.dev_handle))) {
+        std::cout << "ERROR: xma_plg_schedule_work_item_regmap failed. XMASession is corrupted" << std::endl;
+        xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD, "xma_plg_schedule_work_item_regmap failed. XMASession is corrupted.\n");
+        return XMA_ERROR;
+    }
+    XmaHwKernel* kernel_tmp1 = s_handle.hw_session.kernel_info;
+    XmaHwDevice *dev_tmp1 = (XmaHwDevice*)kernel_tmp1->private_do_not_use;
+    if (dev_tmp1 == NULL) {
+        xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD, "Session XMA private pointer is NULL\n");
+        return XMA_ERROR;
+    }
+    //Supported max regmap size is 4032 Bytes only; execBO size is 4096
+    //Always include the CU control registers (ctrl, gier, ier, isr)
+    if (regmap == NULL || size < 4 * sizeof(uint32_t) || size > MAX_KERNEL_REGMAP_SIZE || (size % sizeof(uint32_t))) {
+        xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD, "xma_plg_schedule_work_item_regmap failed. Invalid regmap size %lu\n", size);
+        return XMA_ERROR;
+    }
+
+    int32_t bo_idx = xma_plg_execbo_avail_get(s_handle);
+    if (bo_idx == -1) {
+        xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD, "Unable to find free execbo to use\n");
+        return XMA_ERROR;
+    }
+    return xma_plg_execbo_submit(s_handle, dev_tmp1, kernel_tmp1, bo_idx, (const uint8_t*)regmap, size);
+}
+
+int32_t
+xma_plg_schedule_work_group(XmaSession* s_handles, void** regmaps, size_t* sizes, int32_t count)
+{
+    if (s_handles == NULL || count <= 0 || count > MAX_KERNEL_CONFIGS) {
+        xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD, "xma_plg_schedule_work_group failed. Invalid arguments\n");
+        return XMA_ERROR;
+    }
+    XmaHwDevice *dev_tmp1 = NULL;
+    std::vector<const uint8_t*> srcs(count);
+    std::vector<size_t> src_sizes(count);
+    for (int32_t i = 0; i < count; i++) {
+        XmaSession& s_handle = s_handles[i];
+        if (s_handle.session_signature != (void*)(((uint64_t)s_handle.hw_session.kernel_info) | ((uint64_t)s_handle.hw_session.dev_handle))) {
+            std::cout << "ERROR: xma_plg_schedule_work_group failed. XMASession is corrupted" << std::endl;
+            xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD, "xma_plg_schedule_work_group failed. XMASession is corrupted.\n");
+            return XMA_ERROR;
+        }
+        XmaHwKernel* kernel_tmp1 = s_handle.hw_session.kernel_info;
+        XmaHwDevice *dev_tmp2 = (XmaHwDevice*)kernel_tmp1->private_do_not_use;
+        if (dev_tmp2 == NULL) {
+            xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD, "Session XMA private pointer is NULL\n");
+            return XMA_ERROR;
+        }
+        //One device so that the group completes on one xclExecWait
+        if (dev_tmp1 != NULL && dev_tmp2 != dev_tmp1) {
+            xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD, "xma_plg_schedule_work_group failed. Sessions are on different devices\n");
+            return XMA_ERROR;
+        }
+        dev_tmp1 = dev_tmp2;
+        for (int32_t j = 0; j < i; j++) {
+            if (s_handles[j].hw_session.kernel_info == kernel_tmp1 &&
+                xma_plg_session_key(s_handles[j]) == xma_plg_session_key(s_handle)) {
+                xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD, "xma_plg_schedule_work_group failed. Session is in the group twice\n");
+                return XMA_ERROR;
+            }
+        }
+        if (regmaps == NULL || regmaps[i] == NULL) {
+            //Kernel regmap as for xma_plg_schedule_work_item
+            if (!*(kernel_tmp1->reg_map_locked) || s_handle.session_id != kernel_tmp1->locked_by_session_id ||
+                s_handle.session_type != kernel_tmp1->locked_by_session_type) {
+                xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD, "Must lock kernel regamp before writing to it and submitting work item\n");
+                return XMA_ERROR;
+            }
+            srcs[i] = (const uint8_t*)kernel_tmp1->reg_map;
+            src_sizes[i] = std::max<size_t>(kernel_tmp1->reg_map_max, 4 * sizeof(uint32_t));
+        } else {
+            size_t size = (sizes == NULL) ? 0 : sizes[i];
+            if (size < 4 * sizeof(uint32_t) || size > MAX_KERNEL_REGMAP_SIZE || (size % sizeof(uint32_t))) {
+                xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD, "xma_plg_schedule_work_group failed. Invalid regmap size %lu\n", size);
+                return XMA_ERROR;
+            }
+            srcs[i] = (const uint8_t*)regmaps[i];
+            src_sizes[i] = size;
+        }
+    }
+    if (count > dev_tmp1->num_execbo_allocated) {
+        xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD, "xma_plg_schedule_work_group failed. Group larger than execBO pool\n");
+        return XMA_ERROR;
+    }
+
+    // Take the execBOs of all work items at once, so that a group never
+    // holds some execBOs while waiting for others; Same waits as
+    // xma_plg_execbo_avail_get, the group waits for free execBOs only
+    // if all its sessions have a work item limit
+    const int32_t wait_ms = 1000;
+    const int32_t max_timeouts = 10;
+    int32_t timeouts = 0;
+    int32_t group = 0;
+    std::vector<int32_t> bo_idx(count);
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lk(*dev_tmp1->execbo_mutex);
+            bool at_max = false;
+            bool limited = true;
+            for (int32_t i = 0; i < count && !at_max; i++) {
+                XmaHwKernel* kernel_tmp1 = s_handles[i].hw_session.kernel_info;
+                uint64_t key = xma_plg_session_key(s_handles[i]);
+                auto max_itr = kernel_tmp1->session_max_inflight.find(key);
+                int32_t max_inflight = (max_itr == kernel_tmp1->session_max_inflight.end()) ? 0 : max_itr->second;
+                if (max_inflight <= 0)
+                    limited = false;
+                if (max_inflight > 0 && kernel_tmp1->session_inflight_count[key] >= max_inflight) {
+                    xma_plg_execbo_reap(dev_tmp1, kernel_tmp1);
+                    at_max = kernel_tmp1->session_inflight_count[key] >= max_inflight;
+                }
+            }
+            if (!at_max && (int32_t)dev_tmp1->execbo_free.size() < count) {
+                for (auto& kernel : dev_tmp1->kernels)
+                    xma_plg_execbo_reap(dev_tmp1, &kernel);
+            }
+            if (!at_max && (int32_t)dev_tmp1->execbo_free.size() >= count) {
+                do {
+                    group = (dev_tmp1->last_work_group == INT32_MAX) ? 1 : dev_tmp1->last_work_group + 1;
+                    dev_tmp1->last_work_group = group;
+                } while (dev_tmp1->work_groups.count(group));
+                dev_tmp1->work_groups[group] = XmaHwWorkGroup{count, false};
+                for (int32_t i = 0; i < count; i++) {
+                    bo_idx[i] = xma_plg_execbo_take(dev_tmp1, s_handles[i].hw_session.kernel_info,
+                                                    xma_plg_session_key(s_handles[i]),
+                                                    s_handles[i].hw_session.stats);
+                    dev_tmp1->kernel_execbo_group[bo_idx[i]] = group;
+                }
+                break;
+            }
+            if (!at_max && !limited) {
+                xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD,
+                        "Could not find free execBO cmd buffers for work group\n");
+                return XMA_ERROR;
+            }
+        }
+
+        if (xclExecWait(s_handles[0].hw_session.dev_handle, wait_ms) <= 0) {
+            if (++timeouts >= max_timeouts) {
+                xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD,
+                        "Could not find free execBO cmd buffers for work group\n");
+                return XMA_ERROR;
+            }
+        }
+        else
+            timeouts = 0;
+    }
+
+    // Commands are filled and submitted back to back. A command that
+    // fails to submit marks the group failed; Reported by
+    // xma_plg_work_group_done
+    for (int32_t i = 0; i < count; i++) {
+        xma_plg_execbo_submit(s_handles[i], dev_tmp1, s_handles[i].hw_session.kernel_info,
+                              bo_idx[i], srcs[i], src_sizes[i]);
+    }
+    return group;
+}
+
+int32_t
+xma_plg_work_group_done(XmaSession s_handle, int32_t group, int32_t timeout_ms)
+{
+    if (s_handle.session_signature != (void*)(((uint64_t)s_handle.hw_session.kernel_info) | ((uint64_t)s_handle.hw_session.dev_handle))) {
+        std::cout << "ERROR: xma_plg_work_group_done failed. XMASession is corrupted" << std::endl;
+        xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD, "xma_plg_work_group_done failed. XMASession is corrupted.\n");
+        return XMA_ERROR;
+    }
+    XmaHwKernel* kernel_tmp1 = s_handle.hw_session.kernel_info;
+    XmaHwDevice *dev_tmp1 = (XmaHwDevice*)kernel_tmp1->private_do_not_use;
+    if (dev_tmp1 == NULL) {
+        xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD, "Session XMA private pointer is NULL\n");
+        return XMA_ERROR;
+    }
+
+    bool waited = false;
+    while (true)
+    {
         {
-            xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD,
-                       "Failed to submit kernel start with xclExecBuf\n");
-            rc = XMA_ERROR;
+            std::lock_guard<std::mutex> lk(*dev_tmp1->execbo_mutex);
+            auto itr = dev_tmp1->work_groups.find(group);
+            if (itr == dev_tmp1->work_groups.end()) {
+                xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD, "xma_plg_work_group_done failed. Unknown work group %d\n", group);
+                return XMA_ERROR;
+            }
+            if (itr->second.pending > 0) {
+                for (auto& kernel : dev_tmp1->kernels)
+                    xma_plg_execbo_reap(dev_tmp1, &kernel);
+            }
+            if (itr->second.pending <= 0) {
+                bool failed = itr->second.failed;
+                dev_tmp1->work_groups.erase(itr);
+                return failed ? XMA_ERROR : XMA_SUCCESS;
+            }
+            if (waited || timeout_ms <= 0)
+                return XMA_ERROR_TIMEOUT;
         }
+
+        // Wait for a notification, then take one more look
+        if (xclExecWait(s_handle.hw_session.dev_handle, timeout_ms) <= 0)
+            waited = true;
     }
-    return rc;
+}
+
+int32_t
+xma_plg_session_max_work_items(XmaSession s_handle, int32_t max_work_items)
+{
+    if (s_handle.session_signature != (void*)(((uint64_t)s_handle.hw_session.kernel_info) | ((uint64_t)s_handle.hw_session.dev_handle))) {
+        std::cout << "ERROR: xma_plg_session_max_work_items failed. XMASession is corrupted" << std::endl;
+        xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD, "xma_plg_session_max_work_items failed. XMASession is corrupted.\n");
+        return XMA_ERROR;
+    }
+    XmaHwKernel* kernel_tmp1 = s_handle.hw_session.kernel_info;
+    XmaHwDevice *dev_tmp1 = (XmaHwDevice*)kernel_tmp1->private_do_not_use;
+    if (dev_tmp1 == NULL || max_work_items < 0) {
+        xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD, "xma_plg_session_max_work_items failed. Invalid arguments\n");
+        return XMA_ERROR;
+    }
+    std::lock_guard<std::mutex> lk(*dev_tmp1->execbo_mutex);
+    kernel_tmp1->session_max_inflight[xma_plg_session_key(s_handle)] = max_work_items;
+    return XMA_SUCCESS;
 }
 
 int32_t xma_plg_is_work_item_done(XmaSession s_handle, int32_t timeout_ms)
 {
     if (s_handle.session_signature != (void*)(((uint64_t)s_handle.hw_session.kernel_info) | ((uint64_t)s_handle.hw_session.dev_handle))) {
-        std::cout << "ERROR: xma_plg_schedule_work_item failed. XMASession is corrupted" << std::endl;
-        xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD, "xma_plg_schedule_work_item failed. XMASession is corrupted.\n");
+        std::cout << "ERROR: xma_plg_is_work_item_done failed. XMASession is corrupted" << std::endl;
+        xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD, "xma_plg_is_work_item_done failed. XMASession is corrupted.\n");
         return XMA_ERROR;
     }
     XmaHwKernel* kernel_tmp1 = s_handle.hw_session.kernel_info;
@@ -507,67 +1094,142 @@ int32_t xma_plg_is_work_item_done(XmaSession s_handle, int32_t timeout_ms)
         return XMA_ERROR;
     }
 
-    int32_t count = 0;
     // Keep track of the number of kernel completions
-    while (count == 0)
+    while (true)
     {
-        bool expected = false;
-        bool desired = true;
-        while (!(*(dev_tmp1->execbo_locked)).compare_exchange_weak(expected, desired)) {
-            expected = false;
-        }
-        //kernel completion lock acquired
-
-        // Look for inuse commands that have completed and increment the count
-        for (int32_t i = 0; i < num_execbo; i++)
         {
-            if (dev_tmp1->kernel_execbo_inuse[i] && (dev_tmp1->kernel_execbo_cu_index[i] == kernel_tmp1->cu_index))
-            {
-                ert_start_kernel_cmd *cu_cmd = 
-                    (ert_start_kernel_cmd*)dev_tmp1->kernel_execbo_data[i];
-                if (cu_cmd->state == ERT_CMD_STATE_COMPLETED)
-                {
-                    // Increment completed kernel count and make BO buffer available
-                    count++;
-                    dev_tmp1->kernel_execbo_inuse[i] = false;
-                } 
+            std::lock_guard<std::mutex> lk(*dev_tmp1->execbo_mutex);
+            xma_plg_execbo_reap(dev_tmp1, kernel_tmp1);
+            if (kernel_tmp1->kernel_complete_count) {
+                kernel_tmp1->kernel_complete_count--;
+                return XMA_SUCCESS;
             }
         }
-        //Release completion lock
-        *(dev_tmp1->execbo_locked) = false;
-
-        if (count)
-            break;
 
         // Wait for a notification
         if (xclExecWait(s_handle.hw_session.dev_handle, timeout_ms) <= 0)
             break;
     }
 
-    bool expected = false;
-    bool desired = true;
-    while (!(*(dev_tmp1->execbo_locked)).compare_exchange_weak(expected, desired)) {
-        expected = false;
-    }
-    //kernel completion lock acquired
-
-    kernel_tmp1->kernel_complete_count += count;
-    if (kernel_tmp1->kernel_complete_count)
-    {
+    std::lock_guard<std::mutex> lk(*dev_tmp1->execbo_mutex);
+    xma_plg_execbo_reap(dev_tmp1, kernel_tmp1);
+    if (kernel_tmp1->kernel_complete_count) {
         kernel_tmp1->kernel_complete_count--;
-        
-        //Release completion lock
-        *(dev_tmp1->execbo_locked) = false;
         return XMA_SUCCESS;
     }
-    else
+
+    xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD,
+                "Could not find completed work item\n");
+    return XMA_ERROR;
+}
+
+int32_t xma_plg_work_item_done_count(XmaSession s_handle, int32_t timeout_ms)
+{
+    if (s_handle.session_signature != (void*)(((uint64_t)s_handle.hw_session.kernel_info) | ((uint64_t)s_handle.hw_session.dev_handle))) {
+        std::cout << "ERROR: xma_plg_work_item_done_count failed. XMASession is corrupted" << std::endl;
+        xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD, "xma_plg_work_item_done_count failed. XMASession is corrupted.\n");
+        return XMA_ERROR;
+    }
+    XmaHwKernel* kernel_tmp1 = s_handle.hw_session.kernel_info;
+    XmaHwDevice *dev_tmp1 = (XmaHwDevice*)kernel_tmp1->private_do_not_use;
+    if (dev_tmp1 == NULL) {
+        xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD, "Session XMA private pointer is NULL\n");
+        return XMA_ERROR;
+    }
+
+    // Notifications for other sessions wake up xclExecWait too, so
+    // each wait is for the time remaining until the deadline
+    uint64_t key = xma_plg_session_key(s_handle);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (true)
     {
-        //Release completion lock
-        *(dev_tmp1->execbo_locked) = false;
-        xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD,
-                    "Could not find completed work item\n");
+        int32_t remaining_ms = 0;
+        {
+            std::lock_guard<std::mutex> lk(*dev_tmp1->execbo_mutex);
+            xma_plg_execbo_reap(dev_tmp1, kernel_tmp1);
+            auto itr = kernel_tmp1->session_complete_count.find(key);
+            int32_t count = (itr == kernel_tmp1->session_complete_count.end()) ? 0 : itr->second;
+            if (count) {
+                itr->second = 0;
+                return count;
+            }
+            if (timeout_ms > 0) {
+                auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>
+                    (deadline - std::chrono::steady_clock::now()).count();
+                remaining_ms = static_cast<int32_t>(std::max<decltype(remaining)>(remaining, 0));
+            }
+            if (remaining_ms <= 0)
+                return 0;
+        }
+
+        xclExecWait(s_handle.hw_session.dev_handle, remaining_ms);
+    }
+}
+
+int32_t xma_plg_session_migrate(XmaSession* s_handle)
+{
+    if (s_handle->session_signature != (void*)(((uint64_t)s_handle->hw_session.kernel_info) | ((uint64_t)s_handle->hw_session.dev_handle))) {
+        std::cout << "ERROR: xma_plg_session_migrate failed. XMASession is corrupted" << std::endl;
+        xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD, "xma_plg_session_migrate failed. XMASession is corrupted.\n");
+        return XMA_ERROR;
+    }
+    XmaHwKernel* kernel_tmp1 = s_handle->hw_session.kernel_info;
+    XmaHwDevice *dev_tmp1 = (XmaHwDevice*)kernel_tmp1->private_do_not_use;
+    if (dev_tmp1 == NULL) {
+        xma_logmsg(XMA_ERROR_LOG, XMAPLUGIN_MOD, "Session XMA private pointer is NULL\n");
         return XMA_ERROR;
     }
+    if (*kernel_tmp1->reg_map_locked &&
+        kernel_tmp1->locked_by_session_id == s_handle->session_id &&
+        kernel_tmp1->locked_by_session_type == s_handle->session_type)
+        return 0;
 
-    return XMA_SUCCESS;
+    uint64_t key = xma_plg_session_key(*s_handle);
+    std::lock_guard<std::mutex> lk(*dev_tmp1->execbo_mutex);
+    xma_plg_execbo_reap(dev_tmp1, kernel_tmp1);
+    for (int32_t i : kernel_tmp1->execbo_inflight)
+        if (dev_tmp1->kernel_execbo_session[i] == key)
+            return 0;
+
+    //Device buffers of the session are on its DDR bank, so only CUs on
+    //the same bank qualify.  Load of the current CU excludes this session.
+    //Move only when the gain is worth the plugin rewriting its reg_map.
+    const double min_gain = 0.2;
+    uint64_t now_ns = xma_hw_now_ns();
+    double best_load = xma_hw_kernel_load(kernel_tmp1, now_ns) - 0.1 - min_gain;
+    XmaHwKernel* best = nullptr;
+    for (auto& kernel : dev_tmp1->kernels) {
+        if (&kernel == kernel_tmp1 || kernel.ddr_bank != kernel_tmp1->ddr_bank ||
+            strcmp((const char*)kernel.name, (const char*)kernel_tmp1->name) != 0)
+            continue;
+        double load = xma_hw_kernel_load(&kernel, now_ns);
+        if (load < best_load) {
+            best_load = load;
+            best = &kernel;
+        }
+    }
+    if (best == nullptr)
+        return 0;
+
+    //Completions not yet consumed by the session move with it
+    auto itr = kernel_tmp1->session_complete_count.find(key);
+    if (itr != kernel_tmp1->session_complete_count.end()) {
+        best->session_complete_count[key] += itr->second;
+        kernel_tmp1->session_complete_count.erase(itr);
+    }
+    auto max_itr = kernel_tmp1->session_max_inflight.find(key);
+    if (max_itr != kernel_tmp1->session_max_inflight.end()) {
+        best->session_max_inflight[key] = max_itr->second;
+        kernel_tmp1->session_max_inflight.erase(max_itr);
+    }
+    kernel_tmp1->session_inflight_count.erase(key);
+    kernel_tmp1->num_sessions--;
+    best->num_sessions++;
+    xma_hw_shm_bind(dev_tmp1, kernel_tmp1, -1);
+    xma_hw_shm_bind(dev_tmp1, best, 1);
+    s_handle->hw_session.kernel_info = best;
+    s_handle->session_signature = (void*)(((uint64_t)s_handle->hw_session.kernel_info) | ((uint64_t)s_handle->hw_session.dev_handle));
+    xma_logmsg(XMA_DEBUG_LOG, XMAPLUGIN_MOD, "Session %d moved from CU %d to CU %d\n",
+               s_handle->session_id, kernel_tmp1->cu_index, best->cu_index);
+    return 1;
 }
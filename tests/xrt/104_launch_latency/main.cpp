@@ -0,0 +1,382 @@
+/**
+ * Copyright (C) 2019 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "utils.hpp"
+#include "xaddone_hw_64.h"
+
+// driver includes
+#include "ert.h"
+#include "xclhal2.h"
+#include "xclbin.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <getopt.h>
+
+// Launch latency and throughput benchmark.
+//
+// Each configuration keeps 'depth' commands in flight on the first
+// 'cus' CUs, padding the regmap of each command with 'regmap' extra
+// words, and records for every command the time from xclExecBuf until
+// the host observes the command completed.  The scheduling mode is
+// selected with the configure command and is fixed until the xclbin
+// is reloaded, so sweep modes by running the benchmark once per mode.
+
+const size_t ELEMENTS = 16;
+const size_t ARRAY_SIZE = 8;
+const size_t MAXCUS = 8;
+const size_t EXECBO_SIZE = 4096;
+
+const static struct option long_options[] = {
+  {"bitstream",       required_argument, 0, 'k'},
+  {"hal_logfile",     required_argument, 0, 'l'},
+  {"device",          required_argument, 0, 'd'},
+  {"mode",            required_argument, 0, 'm'},
+  {"cus",             required_argument, 0, 'c'},
+  {"depth",           required_argument, 0, 'q'},
+  {"regmap",          required_argument, 0, 'r'},
+  {"commands",        required_argument, 0, 'n'},
+  {"json",            required_argument, 0, 'j'},
+  {"help",            no_argument,       0, 'h'},
+  {0, 0, 0, 0}
+};
+
+static void printHelp()
+{
+  std::cout << "usage: %s [options] -k <bitstream>\n\n";
+  std::cout << "  -k <bitstream>\n";
+  std::cout << "  -l <hal_logfile>\n";
+  std::cout << "  -d <device_index>\n";
+  std::cout << "  -h\n\n";
+  std::cout << "  [--mode <penguin|ert|ert-poll>]: scheduling mode (default: ert)\n";
+  std::cout << "  [--cus <list>]: comma separated CU counts to sweep (default: 1,8) (max: 8)\n";
+  std::cout << "  [--depth <list>]: comma separated queue depths to sweep (default: 1,16,128)\n";
+  std::cout << "  [--regmap <list>]: comma separated extra regmap words to sweep (default: 0)\n";
+  std::cout << "  [--commands <number>]: commands to run per configuration (default: 10000)\n";
+  std::cout << "  [--json <file>]: write results to file rather than stdout\n";
+  std::cout << "";
+  std::cout << "* Results are JSON with one entry per (cus,depth,regmap) configuration\n";
+  std::cout << "* holding throughput and submit to host notification latency in usecs.\n";
+}
+
+static std::vector<size_t>
+parse_list(const std::string& str)
+{
+  std::vector<size_t> values;
+  std::stringstream ss(str);
+  std::string item;
+  while (std::getline(ss,item,','))
+    if (!item.empty())
+      values.push_back(std::stoul(item));
+  if (values.empty())
+    throw std::runtime_error("bad list '" + str + "'");
+  return values;
+}
+
+// Result of one configuration
+struct result_type
+{
+  size_t cus = 0;
+  size_t depth = 0;
+  size_t regmap = 0;
+  size_t commands = 0;
+  double seconds = 0;
+  std::vector<unsigned long> latency; // nsecs per command
+};
+
+// Command in flight
+struct job_type
+{
+  utils::buffer ebo;
+  utils::buffer b;
+  unsigned long submitted = 0;
+  bool running = false;
+};
+
+static void
+configure(const utils::device& d, const std::string& mode)
+{
+  auto ebo = utils::create_exec_bo(d,EXECBO_SIZE);
+  auto ecmd = reinterpret_cast<ert_configure_cmd*>(ebo->data);
+
+  ecmd->state = ERT_CMD_STATE_NEW;
+  ecmd->opcode = ERT_CONFIGURE;
+  ecmd->slot_size = EXECBO_SIZE;
+  ecmd->num_cus = MAXCUS;
+  ecmd->cu_shift = 16;
+  ecmd->cu_base_addr = d->cu_base_addr;
+
+  if (mode == "ert" || mode == "ert-poll") {
+    ecmd->ert = 1;
+    ecmd->polling = (mode == "ert-poll");
+    ecmd->cu_dma = 1;
+    ecmd->cu_isr = 1;
+  }
+  else if (mode != "penguin")
+    throw std::runtime_error("unknown mode '" + mode + "'");
+
+  // CU -> base address mapping
+  for (size_t i=0; i<MAXCUS; ++i)
+    ecmd->data[i] = d->cu_base_addr + (i << ecmd->cu_shift);
+  ecmd->count = 5 + ecmd->num_cus;
+
+  if (xclExecBuf(d->handle,ebo->bo))
+    throw std::runtime_error("unable to issue configure command");
+
+  while (ecmd->state < ERT_CMD_STATE_COMPLETED)
+    while (xclExecWait(d->handle,1000)==0);
+
+  if (ecmd->state != ERT_CMD_STATE_COMPLETED)
+    throw std::runtime_error("configure command failed");
+}
+
+static void
+init_command(job_type& job, uint64_t a_addr, size_t cus, size_t regmap)
+{
+  xclBOProperties p;
+  uint64_t b_addr = !xclGetBOProperties(job.b->dev,job.b->bo,&p) ? p.paddr : -1;
+  if (b_addr==static_cast<uint64_t>(-1))
+    throw std::runtime_error("bad 'b' buffer object address");
+
+  size_t regmap_size = (XADDONE_CONTROL_ADDR_ELEMENTS_DATA/4+1) + regmap;
+  if ((regmap_size + 2) * sizeof(uint32_t) > EXECBO_SIZE)
+    throw std::runtime_error("regmap too large for exec buffer");
+
+  auto ecmd = reinterpret_cast<ert_start_kernel_cmd*>(job.ebo->data);
+  std::memset(ecmd,0,EXECBO_SIZE);
+
+  ecmd->state = ERT_CMD_STATE_NEW;
+  ecmd->opcode = ERT_START_CU;
+  ecmd->count = 1 + regmap_size;  // cu_mask + regmap
+  ecmd->cu_mask = (1<<cus)-1;
+
+  ecmd->data[XADDONE_CONTROL_ADDR_AP_CTRL] = 0x0; // ap_start
+  ecmd->data[XADDONE_CONTROL_ADDR_A_DATA/4] = a_addr;
+  ecmd->data[XADDONE_CONTROL_ADDR_B_DATA/4] = b_addr;
+  ecmd->data[XADDONE_CONTROL_ADDR_A_DATA/4 + 1] = (a_addr >> 32) & 0xFFFFFFFF;
+  ecmd->data[XADDONE_CONTROL_ADDR_B_DATA/4 + 1] = (b_addr >> 32) & 0xFFFFFFFF;
+  ecmd->data[XADDONE_CONTROL_ADDR_ELEMENTS_DATA/4] = ELEMENTS;
+  // words past ELEMENTS are zero padding written to unused CU registers
+}
+
+static void
+submit(const utils::device& d, job_type& job)
+{
+  auto ecmd = reinterpret_cast<ert_start_kernel_cmd*>(job.ebo->data);
+  ecmd->state = ERT_CMD_STATE_NEW;
+  job.running = true;
+  job.submitted = utils::time_ns();
+  if (xclExecBuf(d->handle,job.ebo->bo))
+    throw std::runtime_error("unable to issue xclExecBuf");
+}
+
+static result_type
+run(const utils::device& d, std::vector<job_type>& jobs, uint64_t a_addr,
+    size_t cus, size_t depth, size_t regmap, size_t commands)
+{
+  result_type result;
+  result.cus = cus;
+  result.depth = depth;
+  result.regmap = regmap;
+  result.latency.reserve(commands);
+
+  for (size_t i=0; i<depth; ++i)
+    init_command(jobs[i],a_addr,cus,regmap);
+
+  size_t issued = 0;
+  auto start = utils::time_ns();
+  for (size_t i=0; i<depth && issued<commands; ++i, ++issued)
+    submit(d,jobs[i]);
+
+  while (result.latency.size() < issued) {
+    while (xclExecWait(d->handle,1000)==0);
+
+    for (size_t i=0; i<depth; ++i) {
+      auto& job = jobs[i];
+      if (!job.running)
+        continue;
+      auto state = reinterpret_cast<ert_packet*>(job.ebo->data)->state;
+      if (state < ERT_CMD_STATE_COMPLETED)
+        continue;
+      if (state != ERT_CMD_STATE_COMPLETED)
+        throw std::runtime_error("command failed with state " + std::to_string(state));
+
+      result.latency.push_back(utils::time_ns() - job.submitted);
+      job.running = false;
+      if (issued < commands) {
+        submit(d,job);
+        ++issued;
+      }
+    }
+  }
+
+  result.seconds = (utils::time_ns() - start) / 1e9;
+  result.commands = result.latency.size();
+  return result;
+}
+
+static void
+write_json(std::ostream& ostr, const std::string& mode, std::vector<result_type>& results)
+{
+  auto usecs = [](unsigned long ns) { return ns / 1000.0; };
+
+  ostr << "{\n  \"benchmark\": \"launch_latency\",\n  \"path\": \"hal\",\n"
+       << "  \"mode\": \"" << mode << "\",\n  \"results\": [";
+  for (size_t r=0; r<results.size(); ++r) {
+    auto& res = results[r];
+    auto& lat = res.latency;
+    std::sort(lat.begin(),lat.end());
+    unsigned long sum = 0;
+    for (auto ns : lat)
+      sum += ns;
+    auto pct = [&lat](double p) { return lat[std::min(lat.size()-1,size_t(p*lat.size()))]; };
+
+    ostr << (r ? "," : "") << "\n    {"
+         << "\"cus\": " << res.cus
+         << ", \"depth\": " << res.depth
+         << ", \"regmap\": " << res.regmap
+         << ", \"commands\": " << res.commands
+         << ", \"seconds\": " << res.seconds
+         << ", \"commands_per_sec\": " << (res.seconds ? res.commands / res.seconds : 0)
+         << ", \"latency_us\": {"
+         << "\"min\": " << usecs(lat.front())
+         << ", \"avg\": " << usecs(sum / lat.size())
+         << ", \"p50\": " << usecs(pct(0.50))
+         << ", \"p99\": " << usecs(pct(0.99))
+         << ", \"max\": " << usecs(lat.back())
+         << "}}";
+  }
+  ostr << "\n  ]\n}\n";
+}
+
+int run(int argc, char** argv)
+{
+  std::string bitstream;
+  std::string hallog;
+  std::string json;
+  std::string mode = "ert";
+  int option_index = 0;
+  unsigned device_index = 0;
+  std::vector<size_t> cus = {1, MAXCUS};
+  std::vector<size_t> depths = {1, 16, 128};
+  std::vector<size_t> regmaps = {0};
+  size_t commands = 10000;
+  int c;
+  while ((c = getopt_long(argc, argv, "k:l:d:h", long_options, &option_index)) != -1) {
+    switch (c) {
+    case 'k':
+      bitstream = optarg;
+      break;
+    case 'l':
+      hallog = optarg;
+      break;
+    case 'd':
+      device_index = std::atoi(optarg);
+      break;
+    case 'm':
+      mode = optarg;
+      break;
+    case 'c':
+      cus = parse_list(optarg);
+      break;
+    case 'q':
+      depths = parse_list(optarg);
+      break;
+    case 'r':
+      regmaps = parse_list(optarg);
+      break;
+    case 'n':
+      commands = std::atoi(optarg);
+      break;
+    case 'j':
+      json = optarg;
+      break;
+    case 'h':
+      printHelp();
+      return 0;
+    default:
+      printHelp();
+      return -1;
+    }
+  }
+
+  if (bitstream.empty())
+    throw std::runtime_error("No bitstream specified");
+
+  if (!commands)
+    throw std::runtime_error("No commands to run");
+
+  for (auto n : cus)
+    if (!n || n > MAXCUS)
+      throw std::runtime_error("bad number of cus " + std::to_string(n));
+
+  for (auto n : depths)
+    if (!n)
+      throw std::runtime_error("bad queue depth 0");
+
+  int first_used_mem = 0;
+  auto device = utils::init(bitstream,device_index,hallog,first_used_mem);
+  configure(device,mode);
+
+  // All commands share input vector 'a', each command in flight has
+  // its own exec buffer and output vector 'b'
+  const size_t data_size = ELEMENTS * ARRAY_SIZE;
+  auto a = utils::create_bo(device,data_size*sizeof(unsigned long),first_used_mem);
+  xclBOProperties p;
+  uint64_t a_addr = !xclGetBOProperties(a->dev,a->bo,&p) ? p.paddr : -1;
+  if (a_addr==static_cast<uint64_t>(-1))
+    throw std::runtime_error("bad 'a' buffer object address");
+
+  std::vector<job_type> jobs(*std::max_element(depths.begin(),depths.end()));
+  for (auto& job : jobs) {
+    job.ebo = utils::create_exec_bo(device,EXECBO_SIZE);
+    job.b = utils::create_bo(device,data_size*sizeof(unsigned long),first_used_mem);
+  }
+
+  std::vector<result_type> results;
+  for (auto ncus : cus)
+    for (auto depth : depths)
+      for (auto regmap : regmaps)
+        results.push_back(run(device,jobs,a_addr,ncus,depth,regmap,commands));
+
+  if (json.empty()) {
+    write_json(std::cout,mode,results);
+  }
+  else {
+    std::ofstream ostr(json);
+    write_json(ostr,mode,results);
+  }
+
+  return 0;
+}
+
+int
+main(int argc, char* argv[])
+{
+  try {
+    run(argc,argv);
+    return 0;
+  }
+  catch (const std::exception& ex) {
+    std::cout << "TEST FAILED: " << ex.what() << "\n";
+  }
+  catch (...) {
+    std::cout << "TEST FAILED\n";
+  }
+
+  return 1;
+}